@@ -110,6 +110,10 @@ set(USE_KHRONOS_SPIRV OFF)
 # whether enable SPIRV_KHR_DOT_PRODUCT
 set(USE_SPIRV_KHR_INTEGER_DOT_PRODUCT OFF)
 
+# whether enable SPIRV_KHR_COOPERATIVE_MATRIX, the cross-vendor cooperative matrices
+# (needs the SPIR-V headers of the Vulkan SDK 1.3.255 or later)
+set(USE_SPIRV_KHR_COOPERATIVE_MATRIX OFF)
+
 # Whether enable OpenGL runtime
 set(USE_OPENGL OFF)
 
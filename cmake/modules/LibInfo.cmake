@@ -116,6 +116,7 @@ function(add_lib_info src_file)
     TVM_INFO_USE_RTTI="${USE_RTTI}"
     TVM_INFO_USE_RUST_EXT="${USE_RUST_EXT}"
     TVM_INFO_USE_SORT="${USE_SORT}"
+    TVM_INFO_USE_SPIRV_KHR_COOPERATIVE_MATRIX="${USE_SPIRV_KHR_COOPERATIVE_MATRIX}"
     TVM_INFO_USE_SPIRV_KHR_INTEGER_DOT_PRODUCT="${USE_SPIRV_KHR_INTEGER_DOT_PRODUCT}"
     TVM_INFO_USE_STACKVM_RUNTIME="${USE_STACKVM_RUNTIME}"
     TVM_INFO_USE_TARGET_ONNX="${USE_TARGET_ONNX}"
@@ -26,6 +26,10 @@ if(USE_VULKAN)
     add_definitions(-DTVM_SPIRV_KHR_INTEGER_DOT_PRODUCT=1)
     message(STATUS "Enable SPIRV_KHR_INTEGER_DOT_PRODUCT")
   endif()
+  if (USE_SPIRV_KHR_COOPERATIVE_MATRIX)
+    add_definitions(-DTVM_SPIRV_KHR_COOPERATIVE_MATRIX=1)
+    message(STATUS "Enable SPIRV_KHR_COOPERATIVE_MATRIX")
+  endif()
   include_directories(SYSTEM ${Vulkan_INCLUDE_DIRS})
   message(STATUS "Build with Vulkan support")
   tvm_file_glob(GLOB RUNTIME_VULKAN_SRCS src/runtime/vulkan/*.cc)
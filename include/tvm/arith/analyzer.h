@@ -750,6 +750,111 @@ class TVM_DLL Analyzer {
    * \note Analyzer will call into sub-analyzers to get the result.
    */
   PrimExpr Simplify(const PrimExpr& expr, int steps = 2);
+
+  /*!
+   * \brief Enable or disable the memoization of Simplify.
+   *
+   * The results are keyed by the expression, the steps and the constraints in effect, and are
+   * dropped whenever a variable is bound through the Analyzer. Passes that simplify the same
+   * index expressions many times can enable it for their analyzer.
+   *
+   * \param enable Whether to memoize the results.
+   *
+   * \note The cache is not invalidated by updating the sub-analyzers directly, e.g. with
+   *       const_int_bound.Update, only enable it if this is not done while it is on.
+   */
+  void EnableSimplifyCache(bool enable = true);
+
+  /*!
+   * \brief Get the statistics of the Simplify cache.
+   * \return The number of hits, misses and entries of the cache.
+   */
+  Map<String, Integer> GetSimplifyCacheStats() const;
+
+  /*!
+   * \brief Enable or disable the memoization of DetectIterMap and NormalizeToIterSum.
+   *
+   * The results are keyed by the expressions, the iterators and their domains, the predicate and
+   * the constraints in effect, and are dropped whenever a variable is bound through the Analyzer.
+   * A cached result is returned with new IterMarks, as a new detection would create them.
+   *
+   * Inside an IterMapCacheScope, the results that only depend on their iterators are also shared
+   * with the other analyzers of the thread, whether their cache is enabled or not.
+   *
+   * \param enable Whether to memoize the results.
+   */
+  void EnableIterMapCache(bool enable = true);
+
+  /*!
+   * \brief Get the statistics of the iter map cache.
+   * \return The number of hits, misses and entries of the cache.
+   */
+  Map<String, Integer> GetIterMapCacheStats() const;
+
+  /*! \return Whether LookupIterMap may find results, the cache or a shared one being on. */
+  bool UsesIterMapCache() const;
+
+  /*!
+   * \brief Look up a memoized iter map, used by DetectIterMap and NormalizeToIterSum.
+   * \param key The arguments of the detection, compared structurally.
+   * \param context_free Whether the result only depends on the iterators of the key.
+   * \param result The memoized result.
+   * \return Whether a result was found.
+   */
+  bool LookupIterMap(const ObjectRef& key, bool context_free, ObjectRef* result);
+
+  /*!
+   * \brief Memoize an iter map, see LookupIterMap.
+   * \param key The arguments of the detection.
+   * \param context_free Whether the result only depends on the iterators of the key.
+   * \param result The result of the detection.
+   */
+  void InsertIterMap(const ObjectRef& key, bool context_free, const ObjectRef& result);
+
+  /*! \brief destructor */
+  ~Analyzer();
+
+ private:
+  friend class ConstraintContext;
+  friend class IterMapCacheScope;
+  class SimplifyCache;
+  class IterMapCache;
+  /*! \return The iter map cache shared by the analyzers of the thread, null outside a scope. */
+  static std::shared_ptr<IterMapCache>& SharedIterMapCache();
+  /*! \brief The memoized results of Simplify and the constraints in effect. */
+  std::unique_ptr<SimplifyCache> simplify_cache_;
+  /*! \brief The memoized results of DetectIterMap and NormalizeToIterSum. */
+  std::unique_ptr<IterMapCache> iter_map_cache_;
+};
+
+/*!
+ * \brief A scope sharing the iter maps memoized by the analyzers of the current thread, e.g.
+ *  those of the passes of one compilation, see Analyzer::EnableIterMapCache.
+ *
+ *  Only the results that depend on nothing but their iterators are shared: the free variables
+ *  of the expressions are iterators, their domains are constant and no constraint is in effect.
+ *  The nested scopes share the cache of the outermost one. The scope is not propagated to other
+ *  threads, e.g. the workers of a function-local PrimFunc pass run in parallel, whose analyzers
+ *  only use their own caches.
+ *
+ * \code
+ *  {
+ *    With<arith::IterMapCacheScope> scope;
+ *    // the passes run here reuse each other's iter maps.
+ *  }
+ * \endcode
+ */
+class IterMapCacheScope {
+ private:
+  // declare friend to enable with.
+  friend class With<IterMapCacheScope>;
+  IterMapCacheScope() = default;
+  // enter the scope.
+  void EnterWithScope();
+  // exit the scope.
+  void ExitWithScope();
+  /*! \brief Whether the scope created the shared cache. */
+  bool owner_{false};
 };
 
 }  // namespace arith
@@ -104,6 +104,7 @@ class PrimExprNode : public BaseExprNode {
 
   static constexpr const char* _type_key = "PrimExpr";
   static constexpr const uint32_t _type_child_slots = 38;
+  static constexpr const bool _type_use_pool_allocator = true;
   TVM_DECLARE_BASE_OBJECT_INFO(PrimExprNode, BaseExprNode);
 };
 
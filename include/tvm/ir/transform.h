@@ -63,6 +63,7 @@
 #include <tvm/runtime/container/string.h>
 #include <tvm/support/with.h>
 
+#include <functional>
 #include <string>
 #include <utility>
 
@@ -188,6 +189,17 @@ class PassContext : public ObjectRef {
    */
   TVM_DLL static Map<String, Map<String, String>> ListConfigs();
 
+  /*!
+   * \brief Run a function with this context current on the calling thread, without calling the
+   *        instruments' callbacks.
+   *
+   * Used by the worker threads of a pass transforming the functions of a module in parallel, so
+   * that PassContext::Current() in the pass sees the configurations of the context it runs in.
+   *
+   * \param f The function to run.
+   */
+  TVM_DLL void RunOnWorkerThread(const std::function<void()>& f) const;
+
   /*!
    * \brief Call instrument implementations' callbacks when entering PassContext.
    *        The callbacks are called in order, and if one raises an exception, the rest will not be
@@ -483,6 +483,17 @@ class Database : public runtime::ObjectRef {
    */
   TVM_DLL static Database JSONDatabase(String path_workload, String path_tuning_record,
                                        bool allow_missing, String mod_eq_name = "structural");
+  /*!
+   * \brief Create a database in the json tables of JSONDatabase, indexed by workload in a file next
+   * to the tuning record table, so that opening it does not load the tuning records and a query
+   * parses only the records it returns. The index is shared by the processes using the tables.
+   * \param path_workload The path to the workload table.
+   * \param path_tuning_record The path to the database table.
+   * \param allow_missing Whether to create new file when the given path is not found.
+   * \param mod_eq_name A string to specify the module equality testing and hashing method.
+   */
+  TVM_DLL static Database IndexedDatabase(String path_workload, String path_tuning_record,
+                                          bool allow_missing, String mod_eq_name = "structural");
   /*!
    * \brief A database composed of multiple databases, allowing users to guide IR rewriting using
    * combined knowledge of those databases. To each query, it returns the best record among all the
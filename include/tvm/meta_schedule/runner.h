@@ -40,11 +40,17 @@ class RunnerInputNode : public runtime::Object {
   String device_type;
   /*! \brief The argument information. */
   Array<ArgInfo> args_info;
+  /*!
+   * \brief The best run time in seconds known for the workload, if any. A runner may stop measuring
+   * a candidate early once it is clearly slower than this.
+   */
+  Optional<FloatImm> threshold_secs;
 
   void VisitAttrs(tvm::AttrVisitor* v) {
     v->Visit("artifact_path", &artifact_path);
     v->Visit("device_type", &device_type);
     v->Visit("args_info", &args_info);
+    v->Visit("threshold_secs", &threshold_secs);
   }
 
   static constexpr const char* _type_key = "meta_schedule.RunnerInput";
@@ -62,8 +68,10 @@ class RunnerInput : public runtime::ObjectRef {
    * \param artifact_path The path to the built artifact.
    * \param device_type The type of device.
    * \param args_info The argument information.
+   * \param threshold_secs The best run time in seconds known for the workload, if any.
    */
-  TVM_DLL explicit RunnerInput(String artifact_path, String device_type, Array<ArgInfo> args_info);
+  TVM_DLL explicit RunnerInput(String artifact_path, String device_type, Array<ArgInfo> args_info,
+                               Optional<FloatImm> threshold_secs = NullOpt);
   TVM_DEFINE_NOTNULLABLE_OBJECT_REF_METHODS(RunnerInput, runtime::ObjectRef, RunnerInputNode);
 };
 
@@ -47,5 +47,35 @@ TVM_DLL std::string SaveJSON(const runtime::ObjectRef& node);
  */
 TVM_DLL runtime::ObjectRef LoadJSON(std::string json_str);
 
+/*!
+ * \brief save the node as well as all the node it depends on in the compact binary format.
+ *
+ *  The nodes are referred to by varint indices, the type keys, field names and strings are
+ *  stored once in a string table, and the NDArrays are stored as raw blobs.
+ *
+ * \return the binary representation of the node.
+ */
+TVM_DLL std::string SaveBinary(const runtime::ObjectRef& node);
+
+/*!
+ * \brief Load tvm Node object from the binary format of SaveBinary.
+ *
+ *  The blob is only read, it can be a memory mapped file and does not need to outlive the call.
+ *
+ * \param data The start of the blob.
+ * \param size The size of the blob in bytes.
+ * \return The loaded node.
+ */
+TVM_DLL runtime::ObjectRef LoadBinary(const char* data, size_t size);
+
+/*!
+ * \brief Load tvm Node object from the binary format of SaveBinary.
+ * \param blob The blob to load from.
+ * \return The loaded node.
+ */
+inline runtime::ObjectRef LoadBinary(const std::string& blob) {
+  return LoadBinary(blob.data(), blob.size());
+}
+
 }  // namespace tvm
 #endif  // TVM_NODE_SERIALIZATION_H_
@@ -92,6 +92,19 @@ class StructuralHash : public BaseValueHash {
   TVM_DLL uint64_t operator()(const ObjectRef& key) const;
 };
 
+/*!
+ * \brief Set the size of the process-wide cache of the structural hashes of large subtrees.
+ *
+ * The cache is disabled by default. When it is enabled, the hash of a subtree seen before
+ * is reused instead of visiting it again, so that hashing a module whose functions mostly did
+ * not change is close to proportional to the changed nodes. The cached subtrees are kept
+ * alive until the cache is cleared, which happens when it is full or resized. The handlers
+ * customizing DispatchSHash don't use the cache.
+ *
+ * \param max_entries The maximum number of cached subtrees, 0 disables and clears the cache.
+ */
+TVM_DLL void SetStructuralHashCacheSize(int64_t max_entries);
+
 /*!
  * \brief A Reducer class to reduce the structural hash value.
  *
@@ -195,6 +195,11 @@ constexpr const char* kInline = "Inline";
 constexpr const char* kPartitionedFromPattern = "PartitionedFromPattern";
 /*! \brief Mark the function as only composed of reshape operations. */
 constexpr const char* kReshapeOnly = "relay.reshape_only";
+/*!
+ * \brief Set by LowerTE in the metadata of the calls of the lowered functions only composed of
+ * elementwise and broadcast operations, whose output may be written over an input of the same type.
+ */
+constexpr const char* kInplaceSafe = "relay.inplace_safe";
 
 }  // namespace attr
 
@@ -281,6 +281,18 @@ TVM_DLL Pass DynamicToStatic();
  */
 TVM_DLL Pass InferType();
 
+/*!
+ * \brief Infer the type of the functions of a module changed since the last type inference.
+ *
+ * A function all of whose sub-expressions still have a checked type, e.g. one a pass
+ * did not rewrite, keeps its types. The other functions, and the functions calling them
+ * directly or indirectly, are checked as by InferType. This assumes the populated type
+ * information is correct, use InferType() when it may not be.
+ *
+ * \return The pass.
+ */
+TVM_DLL Pass InferTypeIncremental();
+
 /*!
  * \brief Infer the type of an expression, reusing existing type information.
  *
@@ -32,6 +32,9 @@
 
 namespace tvm {
 namespace runtime {
+/*! \brief Handle of an event of a device. */
+using TVMEventHandle = void*;
+
 /*!
  * \brief the query type into GetAttr
  */
@@ -139,6 +142,30 @@ class TVM_DLL DeviceAPI {
    * \param ptr The data space.
    */
   virtual void FreeDataSpace(Device dev, void* ptr) = 0;
+  /*!
+   * \brief Allocate a data space ordered on a stream, usable by the work queued on the stream
+   *  after the allocation. The default allocates with AllocDataSpace.
+   * \param dev The device to perform operation.
+   * \param nbytes The number of bytes in memory.
+   * \param alignment The alignment of the memory.
+   * \param type_hint The type of elements.
+   * \param stream The stream the allocation is ordered on.
+   * \return The allocated device pointer.
+   */
+  virtual void* AllocDataSpaceAsync(Device dev, size_t nbytes, size_t alignment,
+                                    DLDataType type_hint, TVMStreamHandle stream) {
+    return AllocDataSpace(dev, nbytes, alignment, type_hint);
+  }
+  /*!
+   * \brief Free a data space allocated by AllocDataSpaceAsync once the work queued on the stream
+   *  before is done. The default frees with FreeDataSpace.
+   * \param dev The device to perform operation.
+   * \param ptr The data space.
+   * \param stream The stream the free is ordered on.
+   */
+  virtual void FreeDataSpaceAsync(Device dev, void* ptr, TVMStreamHandle stream) {
+    FreeDataSpace(dev, ptr);
+  }
   /*!
    * \brief copy data from one place to another
    * \note This API is designed to support special memory with shape dependent layout.
@@ -175,6 +202,12 @@ class TVM_DLL DeviceAPI {
    * \param stream The stream to be set.
    */
   virtual void SetStream(Device dev, TVMStreamHandle stream) {}
+  /*!
+   * \brief Get the current stream of the calling thread
+   * \param dev The device of the stream.
+   * \return The stream set by SetStream, nullptr for the default stream.
+   */
+  virtual TVMStreamHandle GetCurrentStream(Device dev) { return nullptr; }
   /*!
    * \brief Synchronize 2 streams of execution.
    *
@@ -188,6 +221,41 @@ class TVM_DLL DeviceAPI {
    * \param event_dst The destination stream to synchronize.
    */
   virtual void SyncStreamFromTo(Device dev, TVMStreamHandle event_src, TVMStreamHandle event_dst);
+  /*!
+   * \brief Create an event, which marks a point of the work queued on a stream.
+   * \param dev The device of the event.
+   * \return The event, nullptr if the device has no events.
+   */
+  virtual TVMEventHandle CreateEvent(Device dev) { return nullptr; }
+  /*!
+   * \brief Free an event.
+   * \param dev The device of the event.
+   * \param event The event to be freed.
+   */
+  virtual void FreeEvent(Device dev, TVMEventHandle event) {}
+  /*!
+   * \brief Record in the event the work queued on the stream so far.
+   *  Without events the stream is synchronized, so that the work is done on return.
+   * \param dev The device of the event.
+   * \param event The event.
+   * \param stream The stream.
+   */
+  virtual void RecordEvent(Device dev, TVMEventHandle event, TVMStreamHandle stream) {
+    StreamSync(dev, stream);
+  }
+  /*!
+   * \brief Block the host until the work recorded in the event is done.
+   * \param dev The device of the event.
+   * \param event The event.
+   */
+  virtual void EventSync(Device dev, TVMEventHandle event) {}
+  /*!
+   * \brief Make the work queued afterwards on the stream wait for the work recorded in the event.
+   * \param dev The device of the event.
+   * \param stream The stream.
+   * \param event The event.
+   */
+  virtual void StreamWaitEvent(Device dev, TVMStreamHandle stream, TVMEventHandle event) {}
   /*!
    * \brief Allocate temporal workspace for backend execution.
    *
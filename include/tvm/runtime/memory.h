@@ -25,9 +25,11 @@
 
 #include <tvm/runtime/object.h>
 
+#include <cstdint>
 #include <cstdlib>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 namespace tvm {
 namespace runtime {
@@ -47,8 +49,10 @@ inline ObjectPtr<T> make_object(Args&&... args);
 //
 // Possible future allocator optimizations:
 // - Arena allocator that gives ownership of memory to arena (deleter_= nullptr)
-// - Thread-local object pools: one pool per size and alignment requirement.
 // - Can specialize by type of object to give the specific allocator to each object.
+//
+// The object types that set _type_use_pool_allocator are allocated
+// from the thread-local object pools of PoolObjAllocator.
 
 /*!
  * \brief Base class of object allocators that implements make.
@@ -191,9 +195,100 @@ class SimpleObjAllocator : public ObjAllocatorBase<SimpleObjAllocator> {
   };
 };
 
+/*! \brief The statistics of PoolObjAllocator, summed over the threads. */
+struct PoolObjAllocatorStats {
+  /*! \brief The slot size of each size class, in bytes. */
+  std::vector<int64_t> slot_bytes;
+  /*! \brief The number of objects allocated from each size class. */
+  std::vector<int64_t> num_allocs;
+  /*! \brief The number of objects freed to each size class. */
+  std::vector<int64_t> num_frees;
+  /*! \brief The bytes of the pages reserved from the system, never given back. */
+  int64_t reserved_bytes{0};
+};
+
+/*!
+ * \brief Allocator of the small objects from thread-local pools, one per size class.
+ *
+ * The objects are rounded up to a multiple of kGranularity bytes, and
+ * allocated from the free list of their size class in the pool of the
+ * current thread, which is refilled from pages of kPageBytes. A freed
+ * object goes to the free list of the thread freeing it. The free lists
+ * of an exiting thread move to a global depot the other threads refill
+ * from, and the pages are never given back to the system, so an object
+ * can outlive the thread that allocated it.
+ *
+ * The objects larger than kMaxSize bytes, or more aligned than
+ * kGranularity, are allocated with new as by SimpleObjAllocator.
+ */
+class PoolObjAllocator : public ObjAllocatorBase<PoolObjAllocator> {
+ public:
+  /*! \brief The size and alignment granularity of the size classes. */
+  static constexpr size_t kGranularity = 16;
+  /*! \brief The size of the largest size class. */
+  static constexpr size_t kMaxSize = 256;
+  /*! \brief The size of the pages the slots are carved from. */
+  static constexpr size_t kPageBytes = 64 << 10;
+
+  /*!
+   * \brief Allocates a slot of the size class of \p size bytes.
+   * \param size The size of the object, at most kMaxSize.
+   * \return The slot, aligned to kGranularity.
+   */
+  TVM_DLL static void* Allocate(size_t size);
+  /*!
+   * \brief Frees a slot returned by Allocate.
+   * \param ptr The slot.
+   * \param size The size the slot was allocated with.
+   */
+  TVM_DLL static void Free(void* ptr, size_t size);
+  /*!
+   * \return The statistics of the pools. The counts of each live thread
+   *  are flushed to them every few thousand allocations, so they lag a little.
+   */
+  TVM_DLL static PoolObjAllocatorStats Stats();
+
+  template <typename T>
+  class Handler {
+   public:
+    /*! \brief Whether T fits a size class, otherwise it is allocated with new. */
+    static constexpr bool kPooled = sizeof(T) <= kMaxSize && alignof(T) <= kGranularity;
+
+    template <typename... Args>
+    static T* New(PoolObjAllocator*, Args&&... args) {
+      if constexpr (kPooled) {
+        void* data = Allocate(sizeof(T));
+        new (data) T(std::forward<Args>(args)...);
+        return static_cast<T*>(data);
+      } else {
+        return SimpleObjAllocator::Handler<T>::New(nullptr, std::forward<Args>(args)...);
+      }
+    }
+
+    static Object::FDeleter Deleter() {
+      if constexpr (kPooled) {
+        return Deleter_;
+      } else {
+        return SimpleObjAllocator::Handler<T>::Deleter();
+      }
+    }
+
+   private:
+    static void Deleter_(Object* objptr) {
+      T* tptr = static_cast<T*>(objptr);
+      tptr->T::~T();
+      Free(tptr, sizeof(T));
+    }
+  };
+};
+
 template <typename T, typename... Args>
 inline ObjectPtr<T> make_object(Args&&... args) {
-  return SimpleObjAllocator().make_object<T>(std::forward<Args>(args)...);
+  if constexpr (T::_type_use_pool_allocator) {
+    return PoolObjAllocator().make_object<T>(std::forward<Args>(args)...);
+  } else {
+    return SimpleObjAllocator().make_object<T>(std::forward<Args>(args)...);
+  }
 }
 
 template <typename ArrayType, typename ElemType, typename... Args>
@@ -42,6 +42,8 @@ namespace memory {
 enum AllocatorType {
   kNaive = 1,
   kPooled,
+  kCaching,
+  kStreamOrdered,
 };
 
 struct Buffer {
@@ -53,6 +55,8 @@ struct Buffer {
   Device device;
   /*! \brief The allocator that created this buffer. */
   AllocatorType alloc_type;
+  /*! \brief The stream of the allocation, recorded by the caching and stream ordered allocators. */
+  TVMStreamHandle stream{nullptr};
 };
 
 class Allocator {
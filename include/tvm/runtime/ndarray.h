@@ -44,6 +44,37 @@ using Device = DLDevice;
 
 namespace runtime {
 
+/*! \brief The completion of an asynchronous copy, see NDArray::CopyFromToAsync. */
+class CopyEventObj : public Object {
+ public:
+  /*! \brief The device of the event. */
+  Device device;
+  /*! \brief The event of the device, nullptr when the copy was complete on return. */
+  void* event{nullptr};
+
+  TVM_DLL ~CopyEventObj();
+
+  static constexpr const char* _type_key = "runtime.CopyEvent";
+  TVM_DECLARE_FINAL_OBJECT_INFO(CopyEventObj, Object);
+};
+
+/*!
+ * \brief Managed reference to CopyEventObj.
+ * \sa CopyEventObj
+ */
+class CopyEvent : public ObjectRef {
+ public:
+  /*! \brief Block the host until the copy is done. */
+  TVM_DLL void Wait() const;
+  /*!
+   * \brief Make the work queued afterwards on a stream wait for the copy, the host does not block.
+   * \param stream The stream.
+   */
+  TVM_DLL void StreamWait(TVMStreamHandle stream) const;
+
+  TVM_DEFINE_OBJECT_REF_METHODS(CopyEvent, ObjectRef, CopyEventObj);
+};
+
 /*!
  * \brief Managed NDArray.
  *  The array is backed by reference counted blocks.
@@ -187,6 +218,23 @@ class NDArray : public ObjectRef {
    */
   TVM_DLL static void CopyFromTo(const DLTensor* from, DLTensor* to,
                                  TVMStreamHandle stream = nullptr);
+  /*!
+   * \brief Function to copy data from one array to another asynchronously.
+   *
+   *  A copy from pageable host memory to a device that has pinned host memory goes in chunks
+   *  through a pool of pinned staging buffers, the host filling a buffer while the previous
+   *  chunks are transferred. The source can be reused once the call returns, the target once
+   *  the copy is done.
+   *
+   * \param from The source array.
+   * \param to The target array.
+   * \param stream The stream used in copy. By default an upload from the host uses a copy stream
+   *  of the device, ordered after the work queued on the current stream, and the other copies
+   *  are done as CopyFromTo.
+   * \return The completion of the copy.
+   */
+  TVM_DLL static CopyEvent CopyFromToAsync(const DLTensor* from, DLTensor* to,
+                                           TVMStreamHandle stream = nullptr);
 
   TVM_DLL ShapeTuple Shape() const;
   TVM_DLL runtime::DataType DataType() const;
@@ -114,6 +114,13 @@ struct TypeIndex {
  *       exceeds the _type_child_slots. A fallback mechanism to check global type table will be
  * used. Recommendation: set to false for optimal runtime speed if we know exact number of children.
  *
+ * The following field is optional, and inherited by the sub-classes.
+ *
+ * - _type_use_pool_allocator:
+ *       Whether make_object allocates the objects with PoolObjAllocator instead of new.
+ *       Recommendation: set to true for the small objects created and freed in large numbers,
+ *       such as the IR nodes.
+ *
  * Two macros are used to declare helper functions in the object:
  * - Use TVM_DECLARE_BASE_OBJECT_INFO for object classes that can be sub-classed.
  * - Use TVM_DECLARE_FINAL_OBJECT_INFO for object classes that cannot be sub-classed.
@@ -230,6 +237,7 @@ class TVM_DLL Object {
   static constexpr bool _type_final = false;
   static constexpr uint32_t _type_child_slots = 0;
   static constexpr bool _type_child_slots_can_overflow = true;
+  static constexpr bool _type_use_pool_allocator = false;
   // member information
   static constexpr bool _type_has_method_visit_attrs = true;
   static constexpr bool _type_has_method_sequal_reduce = false;
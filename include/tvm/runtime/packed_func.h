@@ -61,6 +61,10 @@ template <typename FType>
 class TypedPackedFunc;
 template <typename TSignature>
 struct SignaturePrinter;
+namespace detail {
+template <typename R, typename... Args>
+class TypedLambdaObj;
+}  // namespace detail
 
 /*!
  * \brief Object container class that backs PackedFunc.
@@ -108,6 +112,9 @@ class PackedFuncObj : public Object {
 
   /*! \brief Internal callable function pointer used to call the packed function. */
   FCallPacked* f_call_packed_;
+
+  template <typename R, typename... Args>
+  friend class detail::TypedLambdaObj;
 };
 
 /*! \brief Derived object class for constructing PackedFuncObj. */
@@ -1773,6 +1780,100 @@ TVM_ALWAYS_INLINE R call_packed(const PackedFunc& pf, Args&&... args) {
   return R(pf(std::forward<Args>(args)...));
 }
 
+/*!
+ * \brief The PackedFuncObj of a function made from a typed lambda, which also carries an entry
+ *  point taking the arguments unboxed. The fields of PackedFuncObj are unchanged, the typed entry
+ *  follows them in the derived objects.
+ */
+template <typename R, typename... Args>
+class TypedLambdaObj : public PackedFuncObj {
+ public:
+  /*! \brief The typed entry point. */
+  using FCallTyped = R (*)(const TypedLambdaObj*, Args...);
+
+  /*!
+   * \brief The f_call_packed_ of all the TypedLambdaObj of this signature, whose address
+   *  identifies them. A function whose f_call_packed_ differs, e.g. an instantiation of another
+   *  shared library, is called boxed.
+   */
+  static void CallPacked(const PackedFuncObj* obj, TVMArgs args, TVMRetValue* rv) {
+    static_cast<const TypedLambdaObj*>(obj)->f_call_boxed_(obj, args, rv);
+  }
+
+  /*! \brief Whether obj is a TypedLambdaObj of this signature. */
+  static bool Matches(const PackedFuncObj* obj) {
+    return obj != nullptr && obj->f_call_packed_ == &TypedLambdaObj::CallPacked;
+  }
+
+  /*! \brief Call the lambda with the arguments unboxed. */
+  TVM_ALWAYS_INLINE R CallTyped(Args... args) const {
+    return f_call_typed_(this, std::forward<Args>(args)...);
+  }
+
+ protected:
+  TypedLambdaObj(FCallPacked* f_call_boxed, FCallTyped f_call_typed)
+      : PackedFuncObj(&TypedLambdaObj::CallPacked),
+        f_call_boxed_(f_call_boxed),
+        f_call_typed_(f_call_typed) {}
+
+  /*! \brief The entry point taking the arguments boxed into TVMArgs. */
+  FCallPacked* f_call_boxed_;
+  /*! \brief The entry point taking the arguments unboxed. */
+  FCallTyped f_call_typed_;
+};
+
+/*! \brief The TypedLambdaObj holding the typed lambda. */
+template <typename R, typename... Args>
+struct TypedLambdaCall {
+  template <typename FLambda>
+  struct Callable {
+    FLambda flambda;
+    std::string name;
+    bool has_name;
+    FSig* f_sig;
+
+    void operator()(const TVMArgs& args, TVMRetValue* rv) const {
+      if (args.size() != sizeof...(Args)) {
+        LOG(FATAL) << "Function " << (has_name ? name : "<anonymous> ")
+                   << (f_sig == nullptr ? "" : (*f_sig)()) << " expects " << sizeof...(Args)
+                   << " arguments, but " << args.size() << " were provided.";
+      }
+      unpack_call<R, sizeof...(Args)>(has_name ? &name : nullptr, flambda, args, rv);
+    }
+  };
+
+  template <typename FLambda>
+  class SubObj : public TypedLambdaObj<R, Args...> {
+   public:
+    explicit SubObj(Callable<FLambda> callable)
+        : TypedLambdaObj<R, Args...>(&SubObj::CallBoxed, &SubObj::CallTyped),
+          callable_(std::move(callable)) {}
+
+    static void CallBoxed(const PackedFuncObj* obj, TVMArgs args, TVMRetValue* rv) {
+      static_cast<const SubObj*>(obj)->callable_(args, rv);
+    }
+
+    static R CallTyped(const TypedLambdaObj<R, Args...>* obj, Args... args) {
+      const FLambda& f = static_cast<const SubObj*>(obj)->callable_.flambda;
+      if constexpr (std::is_void_v<R>) {
+        // The lambda may return a value the signature discards.
+        f(std::forward<Args>(args)...);
+      } else {
+        return f(std::forward<Args>(args)...);
+      }
+    }
+
+    Callable<FLambda> callable_;
+  };
+
+  /*! \brief Make the PackedFunc of a typed lambda. */
+  template <typename FLambda>
+  static PackedFunc Make(FLambda flambda, std::string name, bool has_name, FSig* f_sig) {
+    return PackedFunc(make_object<SubObj<FLambda>>(
+        Callable<FLambda>{std::move(flambda), std::move(name), has_name, f_sig}));
+  }
+};
+
 template <typename R>
 struct typed_packed_call_dispatcher {
   template <typename... Args>
@@ -1809,30 +1910,24 @@ template <typename R, typename... Args>
 template <typename FType>
 inline void TypedPackedFunc<R(Args...)>::AssignTypedLambda(FType flambda, std::string name) {
   FSig* f_sig = detail::SignaturePrinter<detail::function_signature<FType>>::F;
-  packed_ = PackedFunc([flambda, name, f_sig](const TVMArgs& args, TVMRetValue* rv) {
-    if (args.size() != sizeof...(Args)) {
-      LOG(FATAL) << "Function " << name << (f_sig == nullptr ? "" : (*f_sig)()) << " expects "
-                 << sizeof...(Args) << " arguments, but " << args.size() << " were provided.";
-    }
-    detail::unpack_call<R, sizeof...(Args)>(&name, flambda, args, rv);
-  });
+  packed_ = detail::TypedLambdaCall<R, Args...>::Make(flambda, name, true, f_sig);
 }
 
 template <typename R, typename... Args>
 template <typename FType>
 inline void TypedPackedFunc<R(Args...)>::AssignTypedLambda(FType flambda) {
   FSig* f_sig = detail::SignaturePrinter<detail::function_signature<FType>>::F;
-  packed_ = PackedFunc([flambda, f_sig](const TVMArgs& args, TVMRetValue* rv) {
-    if (args.size() != sizeof...(Args)) {
-      LOG(FATAL) << "Function <anonymous> " << (*f_sig)() << " expects " << sizeof...(Args)
-                 << " arguments, but " << args.size() << " were provided.";
-    }
-    detail::unpack_call<R, sizeof...(Args)>(nullptr, flambda, args, rv);
-  });
+  packed_ = detail::TypedLambdaCall<R, Args...>::Make(flambda, "", false, f_sig);
 }
 
 template <typename R, typename... Args>
 TVM_ALWAYS_INLINE R TypedPackedFunc<R(Args...)>::operator()(Args... args) const {
+  using TypedObj = detail::TypedLambdaObj<R, Args...>;
+  const auto* obj = static_cast<const PackedFuncObj*>(packed_.get());
+  if (TypedObj::Matches(obj)) {
+    // Made from a typed lambda of this very signature, skip the boxing into TVMArgs.
+    return static_cast<const TypedObj*>(obj)->CallTyped(std::forward<Args>(args)...);
+  }
   return detail::typed_packed_call_dispatcher<R>::run(packed_, std::forward<Args>(args)...);
 }
 
@@ -122,6 +122,14 @@ int MaxConcurrency();
  * \brief Setting the maximum number of available cores.
  */
 void SetMaxConcurrency(int value);
+/*!
+ * \return The number of NUMA nodes of the system, 1 if the topology is unknown.
+ */
+int NumaNodeCount();
+/*!
+ * \return The NUMA node of a CPU, 0 if the topology is unknown.
+ */
+int NumaNodeOfCpu(unsigned int cpu);
 /*!
  * \brief Reset the threads in the pool. All current threads are destroyed and
  * new ones are created.
@@ -32,6 +32,8 @@
 #include <tvm/runtime/vm/bytecode.h>
 
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -114,6 +116,28 @@ class TVM_DLL Executable : public ModuleNode {
    */
   static runtime::Module Load(const std::string& code, const runtime::Module lib);
 
+  /*!
+   * \brief Load the VM executable saved by \p SaveToFile, mapping the file into memory.
+   *
+   * The immediate constants are left in the mapped file until \p GetConstant reads them, so the
+   * pages of the constants never used are not read from the disk.
+   *
+   * \param path The path of the file.
+   * \param lib The compiled runtime library.
+   *
+   * \return exe The constructed executable.
+   */
+  static runtime::Module LoadFromFile(const std::string& path, const runtime::Module lib);
+
+  /*!
+   * \brief Get a constant, deserializing it on its first use if it was loaded lazily.
+   *
+   * \param const_index The index of the constant.
+   *
+   * \return The constant.
+   */
+  ObjectRef GetConstant(Index const_index);
+
   /*!
    * \brief Returns the late-bound constants for the executable (if any) as a byte-stream.
    * Leaves the executable's late-bound constants map empty. Only constants who's byte
@@ -275,7 +299,8 @@ class TVM_DLL Executable : public ModuleNode {
    * \brief The global constant array.
    *
    * LoadConst instructions indexes are w.r.t. this vector. Late-bound constants are removed
-   * from this table after saving late-bound constants.
+   * from this table after saving late-bound constants. The immediate constants of a loaded
+   * executable are undefined until \p GetConstant deserializes them.
    */
   std::vector<ObjectRef> constants;
   /*!
@@ -326,6 +351,26 @@ class TVM_DLL Executable : public ModuleNode {
    */
   void LoadConstantSection(dmlc::Stream* stream);
 
+  /*!
+   * \brief Load the sections of the serialized executable, leaving its immediate constants in it.
+   *
+   * \param bytes The serialized executable, kept alive until the constants are deserialized.
+   * \param size The size of the serialized executable.
+   */
+  void LoadSections(std::shared_ptr<const char> bytes, size_t size);
+
+  /*!
+   * \brief Deserialize a constant left in the serialized executable, without keeping it.
+   *
+   * \param const_index The index of the constant.
+   *
+   * \return The constant.
+   */
+  NDArray ReadConstant(Index const_index) const;
+
+  /*! \brief Deserialize all the constants left in the serialized executable. */
+  void LoadLazyConstants();
+
   /*!
    * \brief Save primitive op names.
    *
@@ -370,6 +415,15 @@ class TVM_DLL Executable : public ModuleNode {
 
   /*! \brief The serialized bytecode. */
   std::string code_;
+  /*! \brief The serialized executable holding the constants not deserialized yet. */
+  std::shared_ptr<const char> lazy_bytes_;
+  /*! \brief The size of \p lazy_bytes_. */
+  size_t lazy_bytes_size_{0};
+  /*! \brief The offset of each constant in \p lazy_bytes_, kNotLazy once it is deserialized. */
+  std::vector<size_t> lazy_constant_offsets_;
+  /*! \brief Guards the deserialization of the constants by the VMs sharing the executable. */
+  mutable std::mutex lazy_mutex_;
+  static constexpr size_t kNotLazy = static_cast<size_t>(-1);
 };
 
 }  // namespace vm
@@ -126,18 +126,18 @@ struct VMFrame {
   /*! \brief A pointer into the caller function's instructions. */
   const Instruction* code;
 
-  /*! \brief Statically allocated space for objects */
-  std::vector<ObjectRef> register_file;
+  /*! \brief The offset of the frame's registers in the register file of the virtual machine. */
+  Index register_base;
 
   /*! \brief Register in caller's frame to put return value */
   RegName caller_return_register;
 
-  VMFrame(Index pc, Index func_index, Index args, const Instruction* code, Index register_file_size)
+  VMFrame(Index pc, Index func_index, Index args, const Instruction* code, Index register_base)
       : pc(pc),
         func_index(func_index),
         args(args),
         code(code),
-        register_file(register_file_size),
+        register_base(register_base),
         caller_return_register(0) {}
 };
 
@@ -210,7 +210,7 @@ class TVM_DLL VirtualMachine : public runtime::ModuleNode {
    * \param reg The register to read from.
    * \return The read object.
    */
-  ObjectRef ReadRegister(RegName reg) const;
+  const ObjectRef& ReadRegister(RegName reg) const;
 
   /*!
    * \brief Read a VM register and cast it to int32_t
@@ -336,7 +336,7 @@ class TVM_DLL VirtualMachine : public runtime::ModuleNode {
    *
    * \param instr Instruction that will be executed after this hook fires
    */
-  virtual void OpStartHook(Instruction instr);
+  virtual void OpStartHook(const Instruction& instr);
 
   /*!
    * \brief Internal hook for profiling the end of an op.
@@ -430,10 +430,30 @@ class TVM_DLL VirtualMachine : public runtime::ModuleNode {
   bool FindIndex(const std::vector<Index>& indices, Index val) const;
 
  protected:
-  /*! \brief The virtual machine's packed function table. */
+  /*!
+   * \brief Get a packed function, looking it up in the library on its first call.
+   * \param packed_index The index of the packed function.
+   * \return The packed function.
+   */
+  const PackedFunc& GetPackedFunc(Index packed_index);
+
+  /*! \brief The virtual machine's packed function table, null until a function is called. */
   std::vector<PackedFunc> packed_funcs_;
+  /*! \brief The name of each packed function in the library. */
+  std::vector<std::string> packed_names_;
   /*! \brief The current stack of call frames. */
   std::vector<VMFrame> frames_;
+  /*!
+   * \brief The registers of all the frames on the call stack, each frame owns the
+   * register_file_size registers of its function from its register_base. Popping a frame
+   * releases its registers but keeps the capacity, so the calls don't allocate once it is warm.
+   */
+  std::vector<ObjectRef> registers_;
+  /*! \brief The register_base of the current frame. */
+  Index register_base_{0};
+  /*! \brief The reused argument and type code arrays of InvokePacked. */
+  std::vector<TVMValue> packed_values_;
+  std::vector<int> packed_codes_;
   /*! \brief The fuction table index of the current function. */
   Index func_index_;
   /*! \brief The current pointer to the code section. */
@@ -257,6 +257,36 @@ struct MemCpyDetails {
  */
 TVM_DLL std::optional<MemCpyDetails> IdentifyMemCpy(const For& loop, arith::Analyzer* analyzer);
 
+/*! \brief The vectorization of a loop planned by PlanVectorize */
+struct VectorizePlan {
+  /*! \brief The number of lanes to vectorize the loop with, 1 if it cannot be vectorized. */
+  int lanes;
+  /*!
+   * \brief The conditions, evaluated before the loop, under which its vector accesses are
+   *  aligned. The vectorized loop is only valid under them, e.g. as the fast path of an
+   *  IfThenElse falling back to the original loop.
+   */
+  Array<PrimExpr> alignment_checks;
+};
+
+/*!
+ * \brief Plan the vectorization of an innermost loop from the buffer accesses of its body,
+ *  independently of any schedule.
+ *
+ * The lanes are the widest power of two that divides the extent of the loop, fits in the vector
+ * registers for the widest element type accessed, and for which every access varying in the loop
+ * is contiguous and aligned: the Buffer::data_alignment of its buffer is a multiple of the bytes
+ * of a vector, and its first element is a multiple of the lanes.
+ *
+ * \param loop The loop to be vectorized, whose body contains no loop.
+ * \param max_vector_bits The width of the vector registers of the target in bits.
+ * \param allow_runtime_checks Whether the alignment of the accesses whose offsets depend on
+ *  runtime values is checked at runtime, instead of reducing the lanes.
+ * \return The plan, whose lanes are 1 if the loop cannot be vectorized.
+ */
+TVM_DLL VectorizePlan PlanVectorize(const For& loop, int max_vector_bits,
+                                    bool allow_runtime_checks = false);
+
 /*!
  * \brief Calculate the expresion complexity based on number of symbols it contains.
  * \param expr The expr to be calculated.
@@ -225,6 +225,22 @@ TVM_DLL const Op& call_spirv_pure_glsl450();
  */
 TVM_DLL const Op& prefetch();
 
+/*!
+ * \brief Load the active lanes of a contiguous vector, the other lanes are the passthru ones.
+ *
+ *  Type masked_load(Handle ptr, BoolVector mask, Type passthru)
+ *
+ *  The inactive lanes are not read, so that the tail of an array can be loaded as a vector.
+ */
+TVM_DLL const Op& masked_load();
+
+/*!
+ * \brief Store the active lanes of a vector to contiguous memory.
+ *
+ *  void masked_store(Handle ptr, Type value, BoolVector mask)
+ */
+TVM_DLL const Op& masked_store();
+
 /*!
  * \brief Get head access address with memory access pattern info.
  *
@@ -599,6 +615,49 @@ TVM_DLL const Op& tvm_fill_fragment();
  */
 TVM_DLL const Op& tvm_store_matrix_sync();
 
+/*!
+ * \brief tvm intrinsic for filling a metal simdgroup matrix with a value.
+ *
+ *  void make_filled_simdgroup_matrix(Var d, Expr index, Expr value,
+ *                                    UIntImm col = 8, UIntImm row = 8) {
+ *    // col, row are the shape of the simdgroup matrix, only 8x8 is supported.
+ *    // d must be in 'metal.simdgroup' scope.
+ *    d[index] = make_filled_simdgroup_matrix<T, col, row>(value);
+ *  }
+ */
+TVM_DLL const Op& make_filled_simdgroup_matrix();
+
+/*!
+ * \brief tvm intrinsic for metal simdgroup matrix load operators.
+ *
+ *  void simdgroup_load(Var d, Expr index, Expr ptr, Expr stride,
+ *                      UIntImm col = 8, UIntImm row = 8, Bool transpose_matrix = false) {
+ *    // ptr points to device or threadgroup memory, stride is the elements per row.
+ *    simdgroup_load(d[index], ptr, stride, ulong2(0, 0), transpose_matrix);
+ *  }
+ */
+TVM_DLL const Op& simdgroup_load();
+
+/*!
+ * \brief tvm intrinsic for metal simdgroup matrix store operators.
+ *
+ *  void simdgroup_store(Var d, Expr index, Expr ptr, Expr stride,
+ *                       UIntImm col = 8, UIntImm row = 8, Bool transpose_matrix = false) {
+ *    simdgroup_store(d[index], ptr, stride, ulong2(0, 0), transpose_matrix);
+ *  }
+ */
+TVM_DLL const Op& simdgroup_store();
+
+/*!
+ * \brief tvm intrinsic for metal simdgroup matrix multiply accumulate operators.
+ *
+ *  void simdgroup_multiply_accumulate(Var d, Expr index_d, Var a, Expr index_a,
+ *                                     Var b, Expr index_b, Var c, Expr index_c) {
+ *    simdgroup_multiply_accumulate(d[index_d], a[index_a], b[index_b], c[index_c]);
+ *  }
+ */
+TVM_DLL const Op& simdgroup_multiply_accumulate();
+
 /*!
  * \brief tvm intrinsic for ptx tensor core mma instructions.
  *
@@ -52,6 +52,7 @@ class StmtNode : public Object {
   static constexpr const bool _type_has_method_sequal_reduce = true;
   static constexpr const bool _type_has_method_shash_reduce = true;
   static constexpr const uint32_t _type_child_slots = 15;
+  static constexpr const bool _type_use_pool_allocator = true;
   TVM_DECLARE_BASE_OBJECT_INFO(StmtNode, Object);
 };
 
@@ -1545,6 +1546,13 @@ constexpr const char* fragment_layout = "fragment_layout";
  */
 constexpr const char* hand_threaded = "hand_threaded";
 
+/*!
+ * \brief Mark the region executed by a fixed group of threads of the thread block.
+ *  The node is the id of the named barrier of the group and the value is the number of threads
+ *  in the group, the syncs inserted in the region only synchronize the group.
+ */
+constexpr const char* thread_partial_scope = "thread_partial_scope";
+
 /*!
  * \brief Mark whether the script-completer need to fill in missing access region
  *        during script parsing.
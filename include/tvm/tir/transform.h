@@ -51,12 +51,15 @@ using tvm::transform::Sequential;
  * \param opt_level The optimization level of the function pass.
  * \param name The name of the function pass.
  * \param required The list of the passes that the function pass is dependent on.
+ * \param function_local Whether the pass only reads and writes the function it is given, so
+ *        that the functions of a module can be transformed in parallel when the
+ *        "tir.parallel_function_passes" option of the PassContext is set.
  *
  * \return The created function pass.
  */
 TVM_DLL Pass CreatePrimFuncPass(
     const runtime::TypedPackedFunc<PrimFunc(PrimFunc, IRModule, PassContext)>& pass_func,
-    int opt_level, String name, tvm::Array<String> required);
+    int opt_level, String name, tvm::Array<String> required, bool function_local = false);
 
 /*!
  * \brief Inject prefetch instructions into stmt.
@@ -123,6 +126,16 @@ TVM_DLL Pass LoopPartition();
  */
 TVM_DLL Pass VectorizeLoop(bool enable_vectorize = true);
 
+/*!
+ * \brief Vectorize the innermost serial loops without annotations, with the lanes planned by
+ *  tir::PlanVectorize for vectors of "tir.vectorize_dynamic_vector_bits" bits. The loops whose
+ *  alignment depends on runtime values are vectorized under an IfThenElse checking it, falling
+ *  back to the scalar loop.
+ *
+ * \return The pass.
+ */
+TVM_DLL Pass AutoVectorize();
+
 /*!
  * \brief Inject virtual thread loops.
  *
@@ -607,8 +620,10 @@ TVM_DLL Pass UnifyThreadBinding();
 
 /*!
  *  A pass to merge multiple TIR-level dynamic shared memory allocations into one
+ * \param align_bytes The minimal alignment in bytes of the merged buffers, e.g. 1024 for the
+ *        swizzled TMA tiles. The buffers are aligned to their dtype if 0.
  */
-TVM_DLL Pass MergeDynamicSharedMemoryAllocations();
+TVM_DLL Pass MergeDynamicSharedMemoryAllocations(int align_bytes = 0);
 
 /*!
  * \brief This pass is post-scheduling pass to convert all
@@ -76,6 +76,26 @@ Map<BufferInfo, PoolAllocation> HillClimb(const Array<BufferInfo>& buffer_info_a
 Map<BufferInfo, PoolAllocation> HillClimb(const Array<BufferInfo>& buffer_info_arr,
                                           const Integer& memory_pressure);
 
+/*!
+ * \brief The portfolio of the algorithms to plan memory
+ *
+ * This will run the greedy algorithms and hill climbing, then solve exactly the instances with
+ * few buffers, within a time limit, and keep the allocation with the smallest total pool size.
+ *
+ * \return A Map of BufferInfo objects and their associated PoolAllocation
+ */
+Map<BufferInfo, PoolAllocation> Portfolio(const Array<BufferInfo>& buffer_info_arr,
+                                          const Integer& memory_pressure);
+
+/*!
+ * \brief Measures the quality of a memory plan
+ *
+ * \return The total and per pool sizes in bytes, the bytes of the buffers, the memory pressure
+ * and the fragmentation, i.e. the fraction of the pools not used at the peak of the liveness.
+ */
+Map<String, ObjectRef> AllocationMetrics(const Map<BufferInfo, PoolAllocation>& allocations,
+                                         const Integer& memory_pressure);
+
 }  // namespace algo
 }  // namespace usmp
 }  // namespace tir
@@ -51,6 +51,20 @@ constexpr const char* kUSMPUseWorkspaceIO = "tir.usmp.use_workspace_io";
  * The algorithm should be provided as registered PackedFunc with the name tir.usmp.algorithm.NAME
  */
 constexpr const char* kUSMPCustomAlgorithmOption = "tir.usmp.custom_algorithm";
+/*!
+ * \brief PassContext option to bound the time in milliseconds spent by the "portfolio" algorithm
+ */
+constexpr const char* kUSMPPortfolioTimeLimitOption = "tir.usmp.portfolio.time_limit_ms";
+/*!
+ * \brief PassContext option to set the largest number of buffers the "portfolio" algorithm
+ * allocates with its exact search
+ */
+constexpr const char* kUSMPPortfolioExactMaxBuffersOption = "tir.usmp.portfolio.exact_max_buffers";
+/*!
+ * \brief PassContext option to plan every workspace buffer of an AOT build at a compile-time
+ * offset of a pool, failing the build if any allocation is left to the runtime allocator
+ */
+constexpr const char* kUSMPStaticArenaOption = "tir.usmp.static_arena";
 
 namespace tir {
 namespace usmp {
@@ -319,6 +333,12 @@ static constexpr const char* kPoolArgs = "pool_args";
  */
 static constexpr const char* kIOTensorPoolAllocations = "io_tensor_pool_allocations";
 
+/*!
+ * \brief This is a IRModule attribute that contains the planned buffers to their pool
+ * allocations, set when the static arena is enabled.
+ */
+static constexpr const char* kArenaBufferAllocations = "arena_buffer_allocations";
+
 }  // namespace attr
 
 }  // namespace tvm
@@ -85,6 +85,22 @@ class ConstraintScope:
         self._fexit()
 
 
+class IterMapCacheScope(ConstraintScope):
+    """A scope in which the analyzers of the current thread share the iter maps they detect that
+    only depend on their iterators, e.g. those of the passes of one compilation.
+
+    Example
+    -------
+    .. code-block:: python
+
+      with tvm.arith.IterMapCacheScope():
+          mod = passes(mod)
+    """
+
+    def __init__(self):
+        super().__init__(_ffi_api.EnterIterMapCacheScope)
+
+
 class Analyzer:
     """Integer arithmetic analyzer
 
@@ -107,6 +123,10 @@ class Analyzer:
         self._enter_constraint_context = _mod("enter_constraint_context")
         self._can_prove_equal = _mod("can_prove_equal")
         self._can_prove = _mod("can_prove")
+        self._enable_simplify_cache = _mod("enable_simplify_cache")
+        self._get_simplify_cache_stats = _mod("get_simplify_cache_stats")
+        self._enable_iter_map_cache = _mod("enable_iter_map_cache")
+        self._get_iter_map_cache_stats = _mod("get_iter_map_cache_stats")
 
     def const_int_bound(self, expr):
         """Find constant integer bound for expr.
@@ -158,6 +178,40 @@ class Analyzer:
         """
         return self._simplify(expr, steps)
 
+    def enable_simplify_cache(self, enable=True):
+        """Enable or disable the memoization of simplify.
+
+        The results are dropped whenever a variable is bound to a new value and are only
+        reused under the same constraints.
+
+        Parameters
+        ----------
+        enable : bool
+            Whether to memoize the results.
+        """
+        self._enable_simplify_cache(enable)
+
+    @property
+    def simplify_cache_stats(self):
+        return self._get_simplify_cache_stats()
+
+    def enable_iter_map_cache(self, enable=True):
+        """Enable or disable the memoization of detect_iter_map and normalize_to_iter_sum.
+
+        The results are dropped whenever a variable is bound and are only reused under the
+        same constraints, see also IterMapCacheScope.
+
+        Parameters
+        ----------
+        enable : bool
+            Whether to memoize the results.
+        """
+        self._enable_iter_map_cache(enable)
+
+    @property
+    def iter_map_cache_stats(self):
+        return self._get_iter_map_cache_stats()
+
     def rewrite_simplify(self, expr):
         """Simplify expression via rewriting rules.
 
@@ -542,6 +542,46 @@ class BaseGraphTuner(object):
         self._iterate_layout_transform(self._create_matrix_callback)
         self._logger.info("Benchmarking layout transformation successful.")
 
+    def model_layout_transform(self, bandwidth=10e9, overhead=1e-6):
+        """Model the time of all possible layout transformation in the graph instead of
+        benchmarking them, e.g. when the target device is not at hand or the layout plan is
+        made at compile time: a transformation reads and writes its tensor once at the
+        memory bandwidth of the target, after a fixed overhead.
+
+        Parameters
+        ----------
+        bandwidth : float, optional
+            Memory bandwidth of the target in bytes per second.
+
+        overhead : float, optional
+            Fixed time of a layout transformation in seconds, the launch of its kernel.
+        """
+        self._logger.info("Start to model layout transformation...")
+
+        def _model_callback(from_node_idx, to_node_idx, from_sch_idx, to_sch_idx, args):
+            """Callback function to model the time of layout transform"""
+            data, in_layout, out_layout = args
+            ltf_workload = autotvm.task.args_to_workload(args, "layout_transform")
+            if in_layout == out_layout or ltf_workload in self._layout_transform_perf_records:
+                return
+            in_size = int(np.prod(topi.utils.get_const_tuple(data.shape)))
+            # Rule out invalid layout transformations
+            out = topi.layout_transform(data, in_layout, out_layout)
+            if in_size != int(np.prod(topi.utils.get_const_tuple(out.shape))):
+                modeled_time = INVALID_LAYOUT_TIME
+            else:
+                num_bytes = in_size * tvm.DataType(data.dtype).bits // 8
+                modeled_time = overhead + 2 * num_bytes / bandwidth
+            record_input = MeasureInput(target=self._target, task=None, config=None)
+            record_output = MeasureResult(
+                costs=(modeled_time,), error_no=0, all_cost=-1, timestamp=-1
+            )
+            self._layout_transform_perf_records[ltf_workload] = (record_input, record_output)
+
+        self._iterate_layout_transform(_model_callback)
+        self._iterate_layout_transform(self._create_matrix_callback)
+        self._logger.info("Modeling layout transformation successful.")
+
     @property
     def layout_transform_perf_records(self):
         """Get layout transformation dictionary for input graph.
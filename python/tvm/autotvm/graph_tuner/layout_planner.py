@@ -0,0 +1,129 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+# pylint: disable=too-many-arguments
+"""Global planning of the layouts picked by AlterOpLayout."""
+import tvm
+from tvm import relay
+
+from ..task.dispatcher import ApplyGraphBest
+from .dynamic_programming_tuner import DPTuner
+from .pbqp_tuner import PBQPTuner
+
+
+def plan_layouts(
+    mod,
+    input_shapes,
+    records,
+    target,
+    target_ops=None,
+    solver="dp",
+    layout_records=None,
+    measure_layout_transform=False,
+    bandwidth=10e9,
+    max_sch_num=20,
+    dtype="float32",
+    log_file="graph_tuner.log",
+):
+    """Plan the layouts of the target ops of a graph globally.
+
+    AlterOpLayout picks the layout of each op (e.g. the block size of NCHWc) from its own best
+    schedule, and inserts a layout_transform between the neighbors which picked different
+    layouts. The planner chooses the schedule of every op among its tuned candidates so that
+    the total time of the ops and of the layout transformations between them is minimal, by
+    dynamic programming ("dp") or PBQP ("pbqp", for large graphs with many branches). The
+    time of the transformations is measured on the target, inferred from the layout_records
+    or modeled from the memory bandwidth.
+
+    The plan is applied by building the graph in the returned context:
+
+    .. code-block:: python
+
+        plan = plan_layouts(mod, {"data": dshape}, "conv2d.log", target)
+        with plan:
+            with tvm.transform.PassContext(opt_level=3):
+                lib = relay.build(mod, target=target, params=params)
+
+    Parameters
+    ----------
+    mod : tvm.IRModule or tvm.relay.Function
+        The graph, planned in the order AlterOpLayout visits it: the same graph should be built.
+
+    input_shapes : dict of str to tuple
+        The shapes of the inputs of the graph.
+
+    records : str or iterator of (MeasureInput, MeasureResult)
+        The tuning records of the target ops, their candidate schedules and times.
+
+    target : str or tvm.target.Target
+        The compilation target.
+
+    target_ops : List of tvm.ir.Op, optional
+        The ops whose layouts are planned, nn.conv2d by default.
+
+    solver : str, optional
+        "dp" or "pbqp".
+
+    layout_records : str or iterator of (MeasureInput, MeasureResult), optional
+        Measured layout transformations. The time of the other ones is inferred from them.
+
+    measure_layout_transform : bool, optional
+        Whether to benchmark the layout transformations missing in layout_records on the target
+        instead of inferring or modeling them.
+
+    bandwidth : float, optional
+        The memory bandwidth of the target in bytes per second, modeling the time of the layout
+        transformations when they are neither measured nor inferred.
+
+    max_sch_num : int, optional
+        The maximum number of candidate schedules of each op.
+
+    dtype : str, optional
+        The data type of the inputs.
+
+    log_file : str, optional
+        The log file of the graph tuner.
+
+    Returns
+    -------
+    plan : ApplyGraphBest
+        The dispatch context applying the planned schedules, and so layouts, to AlterOpLayout.
+    """
+    if target_ops is None:
+        target_ops = [relay.op.get("nn.conv2d")]
+    solvers = {"dp": DPTuner, "pbqp": PBQPTuner}
+    if solver not in solvers:
+        raise ValueError(f"Unknown layout planning solver {solver}, expecting dp or pbqp")
+    graph = mod["main"] if isinstance(mod, tvm.IRModule) else mod
+    executor = solvers[solver](
+        graph,
+        input_shapes,
+        records,
+        target_ops,
+        target,
+        max_sch_num=max_sch_num,
+        dtype=dtype,
+        verbose=False,
+        log_file=log_file,
+    )
+    if measure_layout_transform:
+        executor.benchmark_layout_transform(layout_records=layout_records)
+    elif layout_records is not None:
+        executor.benchmark_layout_transform(layout_records=layout_records, infer_layout=True)
+    else:
+        executor.model_layout_transform(bandwidth=bandwidth)
+    executor.run()
+    return ApplyGraphBest(executor.get_optimal_records())
@@ -79,30 +79,58 @@ class GraphModuleCudaGraph(graph_executor.GraphModule):
     def __init__(self, module):
         self._start_capture = module["start_capture"]
         self._end_capture = module["end_capture"]
+        self._capture_multi_stream = module["capture_multi_stream"]
         self._run_cuda_graph = module["run_cuda_graph"]
+        self._num_patchable_entries = module["num_patchable_entries"]
         self._cuda_graph_captured = False
         graph_executor.GraphModule.__init__(self, module)
 
-    def capture_cuda_graph(self):
+    def capture_cuda_graph(self, num_streams=1):
         """Capture a CUDA graph for tvm_op graph
 
         This should be called before run_cuda_graph() to capture and
         instantiate a CUDA graph instance.
+
+        Parameters
+        ----------
+        num_streams : int
+            The number of streams the ops are captured on. With more than one,
+            the independent branches of the graph run concurrently in the CUDA graph.
         """
         self._run()  # call cuModuleLoadData before cudaStream API
-        self._start_capture()
-        self._run()
-        self._end_capture()
+        if num_streams > 1:
+            self._capture_multi_stream(num_streams)
+        else:
+            self._start_capture()
+            self._run()
+            self._end_capture()
         self._cuda_graph_captured = True
 
     def run_cuda_graph(self):
         """Run the CUDA graph for tvm_op graph
 
         Run the captured CUDA graph instance instead of the
-        for-loop kernel launch of default graph executor
+        for-loop kernel launch of default graph executor.
+
+        The inputs and the outputs rebound since the capture (set_input_zero_copy,
+        set_output_zero_copy, bind_input, swap_input...) are patched into the kernel
+        nodes of the instance, the graph is only captured again when one of them
+        can not be patched.
         """
         self._run_cuda_graph()
 
+    def num_patchable_entries(self):
+        """Get the number of inputs and outputs whose rebinding is patched into the
+        captured CUDA graph without a new capture
+
+        Returns
+        -------
+        count : int
+            The number of patchable inputs and outputs, 0 before the capture or when the
+            kernel params can not be listed (CUDA before 12.4).
+        """
+        return self._num_patchable_entries()
+
     def run(self, **input_dict):
         """A run wrapper for graph capture / launch, user can just
         change default graph executor to cuda graph executor, and
@@ -132,3 +160,107 @@ class GraphModuleCudaGraph(graph_executor.GraphModule):
             The output array container
         """
         raise NotImplementedError("Please use debugger.debug_executor as graph_executor instead.")
+
+
+class BucketedCudaGraph(object):
+    """CUDA graphs of a model compiled for several static shapes (the buckets), e.g. the
+    padded batch sizes of a server.
+
+    Each bucket is a CUDA graph executor module captured at its first run, the inputs are
+    run by the smallest bucket holding them. The inputs and outputs rebound with
+    set_input_zero_copy / bind_input are patched in the captured graphs, so a bucket is
+    only captured once.
+
+    Parameters
+    ----------
+    modules : dict of int to GraphModuleCudaGraph
+        The module of each bucket, the key being the size of the bucketed dimension.
+
+    num_streams : int
+        The number of streams the graphs are captured on.
+
+    Examples
+    --------
+    .. code-block:: python
+
+        modules = {}
+        for batch in [1, 2, 4, 8]:
+            lib = relay.build(get_model(batch), target="cuda")
+            modules[batch] = cuda_graph_executor.GraphModuleCudaGraph(lib["default"](dev))
+        graphs = cuda_graph_executor.BucketedCudaGraph(modules)
+        module = graphs.run(3, data=padded)  # runs the graph of the bucket 4
+    """
+
+    def __init__(self, modules, num_streams=1):
+        assert modules, "BucketedCudaGraph needs at least one bucket"
+        self._modules = dict(modules)
+        self._buckets = sorted(self._modules)
+        self._captured = set()
+        self._num_streams = num_streams
+
+    @property
+    def buckets(self):
+        """The sizes of the buckets, in increasing order"""
+        return list(self._buckets)
+
+    def select(self, size):
+        """Get the smallest bucket holding size
+
+        Parameters
+        ----------
+        size : int
+            The size of the bucketed dimension of the inputs.
+
+        Returns
+        -------
+        bucket : int
+            The size of the bucket.
+        """
+        for bucket in self._buckets:
+            if bucket >= size:
+                return bucket
+        raise ValueError(
+            "The size %d is larger than the largest bucket %d" % (size, self._buckets[-1])
+        )
+
+    def module(self, size):
+        """Get the module of the bucket of size, e.g. to bind its inputs and outputs
+
+        Parameters
+        ----------
+        size : int
+            The size of the bucketed dimension of the inputs.
+
+        Returns
+        -------
+        module : GraphModuleCudaGraph
+            The module of the smallest bucket holding size.
+        """
+        return self._modules[self.select(size)]
+
+    def run(self, size, **input_dict):
+        """Run the CUDA graph of the bucket of size, captured at its first run
+
+        Parameters
+        ----------
+        size : int
+            The size of the bucketed dimension of the inputs.
+
+        input_dict: dict of str to NDArray
+            The inputs, padded to the size of the bucket.
+
+        Returns
+        -------
+        module : GraphModuleCudaGraph
+            The module run, to get the outputs from.
+        """
+        bucket = self.select(size)
+        module = self._modules[bucket]
+        if input_dict:
+            module.set_input(**input_dict)
+        if bucket not in self._captured:
+            module.capture_cuda_graph(self._num_streams)
+            self._captured.add(bucket)
+        else:
+            module.run_cuda_graph()
+        return module
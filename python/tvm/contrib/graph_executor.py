@@ -66,6 +66,48 @@ def create(graph_json_str, libmod, device):
     return GraphModule(fcreate(graph_json_str, libmod, *device_type_id))
 
 
+def create_streamed(lib, device, window_bytes=0, params=None, min_bytes=1 << 20, pin=False):
+    """Create a runtime executor module that keeps the large params of a model in the host memory
+    and streams them through a window of device memory, for the models whose params do not fit
+    on the device.
+
+    During a run each streamed param is uploaded on a copy stream before the first op reading it,
+    into a region of the window freed by the params whose last op is done, so that the uploads of
+    the next ops overlap the current ones. The params read by no op or sharing their storage with
+    another entry stay resident.
+
+    Parameters
+    ----------
+    lib : tvm.runtime.Module
+        The factory module of a library built by relay.build.
+
+    device : Device or list of Device
+        The devices to deploy the module on, the streamed params are those of the first one.
+
+    window_bytes : int
+        The size of the window of device memory. The default 0 sizes it from the params read by
+        the ops, twice the largest amount read at once, grown until the ring of the regions fits.
+
+    params : dict of str to NDArray, optional
+        The params replacing the ones of the library, e.g. the arrays mapped from a file by
+        tvm.runtime.load_param_dict_mapped so that the params are paged in from the disk.
+
+    min_bytes : int
+        The size of the smallest streamed param, the smaller ones stay resident.
+
+    pin : bool
+        Whether to copy the streamed params into the pinned host memory of the device, instead of
+        staging their uploads through pinned buffers.
+
+    Returns
+    -------
+    graph_module : GraphModule
+        Runtime graph module that can be used to execute the graph.
+    """
+    devices = device if isinstance(device, (list, tuple)) else [device]
+    return GraphModule(lib["streamed_create"](window_bytes, min_bytes, pin, params or {}, *devices))
+
+
 def get_device(libmod, device):
     """Parse and validate all the device(s).
 
@@ -177,6 +219,11 @@ class GraphModule(object):
         self._get_num_inputs = module["get_num_inputs"]
         self._load_params = module["load_params"]
         self._share_params = module["share_params"]
+        self._share_storage = module["share_storage"]
+        self._bind_input = module["bind_input"]
+        self._bind_output = module["bind_output"]
+        self._swap_input = module["swap_input"]
+        self._swap_output = module["swap_output"]
 
     def set_input(self, key=None, value=None, **params):
         """Set inputs to the module via kwargs
@@ -251,6 +298,62 @@ class GraphModule(object):
         """
         self._set_output_zero_copy(key, value)
 
+    def bind_input(self, key, value):
+        """Bind an input to an NDArray for all the following runs without copying it. The
+        executor holds a reference to the array until the input is bound again or set with
+        set_input, which copies into the own array of the executor.
+
+        Parameters
+        ----------
+        key : int or str
+           The input key
+
+        value : NDArray
+           The array the input is read from
+        """
+        self._bind_input(key, value)
+
+    def bind_output(self, key, value):
+        """Bind an output to an NDArray for all the following runs without copying it. The
+        executor holds a reference to the array until the output is bound again.
+
+        Parameters
+        ----------
+        key : int or str
+           The output key
+
+        value : NDArray
+           The array the output is written to
+        """
+        self._bind_output(key, value)
+
+    def swap_input(self, key, value):
+        """Swap a bound input for an NDArray of the same size on the same device, e.g. to
+        alternate between two buffers. Only the pointers are replaced.
+
+        Parameters
+        ----------
+        key : int or str
+           The input key
+
+        value : NDArray
+           The array the input is read from
+        """
+        self._swap_input(key, value)
+
+    def swap_output(self, key, value):
+        """Swap a bound output for an NDArray of the same size on the same device.
+
+        Parameters
+        ----------
+        key : int or str
+           The output key
+
+        value : NDArray
+           The array the output is written to
+        """
+        self._swap_output(key, value)
+
     def run(self, **input_dict):
         """Run forward execution of the graph
 
@@ -263,6 +366,45 @@ class GraphModule(object):
             self.set_input(**input_dict)
         self._run()
 
+    def enable_sampling_profiler(self, sample_every=100, capacity=65536):
+        """Profile the operators of one run in every `sample_every`, without synchronizing.
+
+        Unlike the debug executor, the operators of the sampled runs are timed with the
+        asynchronous device timers, which are only read once the device is done with them, so
+        the profiler can stay on in production. Read the timings with
+        :py:meth:`sampling_profile_chrome_trace` and :py:meth:`sampling_profile_prometheus`.
+
+        Parameters
+        ----------
+        sample_every : int
+            Profile one run in this many.
+
+        capacity : int
+            The number of operator calls kept for the Chrome trace, the oldest ones are dropped
+            first.
+        """
+        self.module["enable_sampling_profiler"](sample_every, capacity)
+
+    def sampling_profile_chrome_trace(self):
+        """Drain the operator calls kept by the sampling profiler as a Chrome trace.
+
+        Returns
+        -------
+        trace : str
+            The trace in JSON, as read by chrome://tracing and Perfetto.
+        """
+        return self.module["sampling_profiler_chrome_trace"]()
+
+    def sampling_profile_prometheus(self):
+        """Report the durations of the operators profiled by the sampling profiler.
+
+        Returns
+        -------
+        metrics : str
+            The histograms of the durations per operator, in the Prometheus text format.
+        """
+        return self.module["sampling_profiler_prometheus"]()
+
     def get_num_outputs(self):
         """Get the number of outputs from the graph
 
@@ -394,6 +536,58 @@ class GraphModule(object):
         """
         self._share_params(other.module, bytearray(params_bytes))
 
+    def share_storage(self, other):
+        """Share the planned storage of the intermediate results and the outputs with a
+        pre-existing GraphExecutor instance of the same graph, e.g. the replicas of a model
+        served on one device. The inputs and the params stay separate.
+
+        The instances sharing their storage must not run concurrently, and the outputs of one
+        are overwritten by the next run of the others.
+
+        Parameters
+        ----------
+        other: GraphExecutor
+            The GraphExecutor of the same graph on the same devices to share the storage of.
+        """
+        self._share_storage(other.module)
+
+    def is_streamed(self, name):
+        """Whether the param is streamed from the host memory, see create_streamed.
+
+        Parameters
+        ----------
+        name : str
+            The name of the param.
+        """
+        return bool(self.module["is_streamed"](name))
+
+    def get_stream_window_bytes(self):
+        """The size of the window of device memory of the streamed params, 0 if none is."""
+        return self.module["get_stream_window_bytes"]()
+
+    def set_l2_prefetch(self, enable=True, persisting_bytes=0):
+        """Prefetch the params of the next op reading params into the L2 cache of the CUDA device
+        on a side stream while each op runs, e.g. the weights of the next layer of a memory bound
+        decode step. The streamed params are not prefetched.
+
+        Parameters
+        ----------
+        enable : bool
+            Whether to prefetch the params.
+
+        persisting_bytes : int
+            The size of the persisting part of the L2 cache set aside for the prefetched params
+            (cudaLimitPersistingL2CacheSize), so that the other accesses do not evict them. -1
+            for the max of the device, 0 to prefetch them as normal lines into half of the L2
+            cache.
+
+        Returns
+        -------
+        persisting_bytes : int
+            The size of the persisting L2 cache set aside, 0 if none is.
+        """
+        return self.module["set_l2_prefetch"](enable, persisting_bytes)
+
     def __getitem__(self, key):
         """Get internal module function
 
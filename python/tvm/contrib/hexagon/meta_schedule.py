@@ -133,7 +133,14 @@ def get_hexagon_local_builder(
     max_workers: Optional[int] = None,
     timeout_sec: float = 30.0,
 ):
-    """Return Hexagon-compatible Builder for meta schedule."""
+    """Return Hexagon-compatible Builder for meta schedule.
+
+    Without a pass_context, the builds lower the asynchronous copies into VTCM of the
+    software pipelined schedules to the user DMA ("tir.use_async_copy").
+    """
+
+    if pass_context is None:
+        pass_context = tvm.transform.PassContext(config={"tir.use_async_copy": True})
 
     def export_func(mod):
         binary_path = export_module(mod, tempfile.mkdtemp())
@@ -146,15 +153,12 @@ def get_hexagon_local_builder(
             mod = RemoveWeightLayoutRewriteBlock(skip_ndarray_rewrite=True)(mod)
             return tvm_build(mod, target=target)
 
-    if pass_context is not None:
-        return LocalBuilder(
-            f_build=default_build_with_context,
-            f_export=export_func,
-            max_workers=max_workers,
-            timeout_sec=timeout_sec,
-        )
-    else:
-        return LocalBuilder(f_export=export_func, max_workers=max_workers, timeout_sec=timeout_sec)
+    return LocalBuilder(
+        f_build=default_build_with_context,
+        f_export=export_func,
+        max_workers=max_workers,
+        timeout_sec=timeout_sec,
+    )
 
 
 def get_hexagon_rpc_runner(
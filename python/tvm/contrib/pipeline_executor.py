@@ -59,6 +59,7 @@ class PipelineModule(object):
         self._get_num_inputs = self.module["get_num_inputs"]
         self._get_input_pipeline_map = self.module["get_input_pipeline_map"]
         self._get_pipe_execute_count = self.module["get_execute_count"]
+        self._get_statistics = self.module["get_statistics"]
 
     def run(self):
         """Run the pipeline executor."""
@@ -163,6 +164,17 @@ class PipelineModule(object):
         """
         return self._get_pipe_execute_count()
 
+    def get_statistics(self):
+        """Get the statistics of each stage of the pipeline.
+        Returns
+        -------
+        statistics : List[Dict[str, Union[int, float]]]
+            For each backend runtime, the batch size, the number of runs and requests, the time
+            in microseconds spent running, waiting for inputs and held back by full queues, the
+            number of queued inputs, the throughput in requests per second and the utilization.
+        """
+        return json.loads(self._get_statistics())
+
     @property
     def num_outputs(self):
         """Get the number of outputs.
@@ -418,6 +418,13 @@ class PipelineConfig(object):
             self.dev = None
             self.export_cc = None
             self.cpu_affinity = ""
+            # The number of requests coalesced into one run, the module has to be built with
+            # a first dimension 'batch_size' times larger than the one of a request.
+            self.batch_size = 1
+            # How long to wait in microseconds for a batch to fill up once a request arrived.
+            self.batch_timeout_us = 0
+            # The capacity of the input queues, the producers wait when they are full.
+            self.queue_capacity = 0
             self.idx = None
             self.mod = mod
             self.input_params = InferType()(mod)["main"].params
@@ -594,6 +601,12 @@ class PipelineConfig(object):
 
             mconf["mod_idx"] = module.idx
             mconf["cpu_affinity"] = module.cpu_affinity
+            # The batching and queue settings are only written when they are not the defaults.
+            if module.batch_size != 1:
+                mconf["batch_size"] = module.batch_size
+                mconf["batch_timeout_us"] = module.batch_timeout_us
+            if module.queue_capacity:
+                mconf["queue_capacity"] = module.queue_capacity
             mconf["output"] = output_conf
 
             module_connection[mod] = {
@@ -27,10 +27,14 @@ from .base import (
     Span,
     SequentialSpan,
     assert_structural_equal,
+    load_binary,
     load_json,
+    save_binary,
     save_json,
+    set_structural_hash_cache_size,
     structural_equal,
     structural_hash,
+    structural_hash_cache_stats,
 )
 from .container import Array, Map
 from .expr import BaseExpr, GlobalVar, PrimExpr, Range, RelayExpr
@@ -149,6 +149,41 @@ def save_json(node) -> str:
     return _ffi_node_api.SaveJSON(node)
 
 
+def load_binary(blob) -> Object:
+    """Load tvm object from the binary format of save_binary.
+
+    Parameters
+    ----------
+    blob : Union[bytes, bytearray]
+        The binary blob
+
+    Returns
+    -------
+    node : Object
+        The loaded tvm node.
+    """
+    return _ffi_node_api.LoadBinary(bytearray(blob))
+
+
+def save_binary(node) -> bytearray:
+    """Save tvm object in the compact binary format.
+
+    Compared with save_json, the nodes are referred to by varint indices, the strings are
+    deduplicated and the NDArrays are stored raw, which makes it smaller and faster to load.
+
+    Parameters
+    ----------
+    node : Object
+        A TVM object to be saved.
+
+    Returns
+    -------
+    blob : bytearray
+        Saved binary blob.
+    """
+    return _ffi_node_api.SaveBinary(node)
+
+
 def structural_equal(lhs, rhs, map_free_vars=False):
     """Check structural equality of lhs and rhs.
 
@@ -301,6 +336,34 @@ def structural_hash(node, map_free_vars=False):
     return _ffi_node_api.StructuralHash(node, map_free_vars)  # type: ignore # pylint: disable=no-member
 
 
+def set_structural_hash_cache_size(max_entries):
+    """Set the size of the process-wide cache of the structural hashes of large subtrees.
+
+    When the cache is enabled, structural_hash reuses the hash of a subtree seen before
+    instead of visiting it again. The cached subtrees are kept alive until the cache is
+    cleared, which happens when it is full or resized. The IRModules, which are mutated in
+    place, and the subtrees containing them are not cached.
+
+    Parameters
+    ----------
+    max_entries : int
+        The maximum number of cached subtrees, 0 disables and clears the cache.
+    """
+    # pylint: disable=no-member
+    _ffi_node_api.SetStructuralHashCacheSize(max_entries)  # type: ignore
+
+
+def structural_hash_cache_stats():
+    """Get the statistics of the structural hash cache.
+
+    Return
+    ------
+    result : Map[str, int]
+        The number of hits, misses and entries of the cache.
+    """
+    return _ffi_node_api.GetStructuralHashCacheStats()  # type: ignore # pylint: disable=no-member
+
+
 def deprecated(
     method_name: str,
     new_method_name: str,
@@ -21,3 +21,4 @@ and then export
 """
 from .builder import Builder, BuilderInput, BuilderResult, PyBuilder, create
 from .local_builder import LocalBuilder
+from .rpc_builder import RPCBuilder
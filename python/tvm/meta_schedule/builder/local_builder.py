@@ -16,10 +16,12 @@
 # under the License.
 """Local builder that compile on the local host"""
 import os
+import shutil
 import tempfile
+import weakref
 from typing import Callable, Dict, List, Optional, Union
 
-from tvm._ffi import register_func
+from tvm._ffi import get_global_func, register_func
 from tvm.ir import IRModule
 from tvm.runtime import Module, NDArray, load_param_dict, save_param_dict
 from tvm.target import Target
@@ -70,6 +72,9 @@ class LocalBuilder(PyBuilder):
     f_export : Union[None, str, T_EXPORT]
         Name of the export function to be used.
         Defaults to `meta_schedule.builder.default_export`.
+    object_cache_dir : Optional[str]
+        The directory caching the host object files emitted by LLVM, shared by the workers, so that
+        the candidates whose host code does not change are not compiled again.
 
     Attributes
     ----------
@@ -106,6 +111,7 @@ class LocalBuilder(PyBuilder):
     initializer: Optional[Callable[[], None]]
     f_build: Union[None, str, T_BUILD]
     f_export: Union[None, str, T_EXPORT]
+    object_cache_dir: Optional[str]
 
     def __init__(
         self,
@@ -115,6 +121,7 @@ class LocalBuilder(PyBuilder):
         f_build: Union[None, str, T_BUILD] = None,
         f_export: Union[None, str, T_EXPORT] = None,
         initializer: Optional[Callable[[], None]] = None,
+        object_cache_dir: Optional[str] = None,
     ) -> None:
         """Constructor.
 
@@ -133,6 +140,9 @@ class LocalBuilder(PyBuilder):
             Defaults to `meta_schedule.builder.default_export`.
         initializer : Optional[Callable[[], None]]
             The initializer to be used for the worker processes.
+        object_cache_dir : Optional[str]
+            The directory caching the host object files across the builds.
+            Defaults to a temporary directory owned by the builder, removed with it.
         """
         super().__init__()
 
@@ -145,6 +155,11 @@ class LocalBuilder(PyBuilder):
         self.initializer = initializer
         self.f_build = f_build
         self.f_export = f_export
+        if object_cache_dir is None:
+            object_cache_dir = tempfile.mkdtemp(prefix="tvm_ms_object_cache_")
+            # the directory owned by the builder is removed with it
+            weakref.finalize(self, shutil.rmtree, object_cache_dir, ignore_errors=True)
+        self.object_cache_dir = object_cache_dir
         self._sanity_check()
 
     def build(self, build_inputs: List[BuilderInput]) -> List[BuilderResult]:
@@ -167,6 +182,7 @@ class LocalBuilder(PyBuilder):
                 (
                     self.f_build,
                     self.f_export,
+                    self.object_cache_dir,
                     build_input.mod,
                     build_input.target,
                     _serialize_params(build_input.params),
@@ -214,6 +230,7 @@ class LocalBuilder(PyBuilder):
 def _worker_func(
     _f_build: Union[None, str, T_BUILD],
     _f_export: Union[None, str, T_EXPORT],
+    object_cache_dir: Optional[str],
     mod: IRModule,
     target: Target,
     params: Optional[bytearray],
@@ -227,6 +244,10 @@ def _worker_func(
         _f_export,
         default_export,
     )
+    if object_cache_dir:
+        f_set_cache_dir = get_global_func("target.llvm_set_object_cache_dir", allow_missing=True)
+        if f_set_cache_dir is not None:
+            f_set_cache_dir(object_cache_dir)
     # Step 1. Build the IRModule
     rt_mod: Module = f_build(mod, target, _deserialize_params(params))
     # Step 2. Export the Module
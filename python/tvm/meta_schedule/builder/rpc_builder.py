@@ -0,0 +1,219 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""RPC builder that compiles on the remote workers of an RPC tracker"""
+import argparse
+import concurrent.futures
+import math
+import os
+import shutil
+import tempfile
+import time
+from typing import List, Optional
+
+from tvm import rpc
+from tvm._ffi import register_func
+from tvm.ir import load_json, save_json
+
+from ..logging import get_logger
+from ..runner.config import RPCConfig
+from ..utils import derived_object
+from .builder import BuilderInput, BuilderResult, PyBuilder
+from .local_builder import (
+    _deserialize_params,
+    _serialize_params,
+    default_build,
+    default_export,
+)
+
+logger = get_logger(__name__)  # pylint: disable=invalid-name
+
+
+@derived_object
+class RPCBuilder(PyBuilder):
+    """A builder that builds the given input on the build workers of an RPC tracker, which
+    compile in parallel and send the exported modules back to the local host.
+
+    A build worker is an RPC server which has the build function registered, started on each
+    host with:
+
+    .. code-block:: bash
+
+        python3 -m tvm.meta_schedule.builder.rpc_builder \\
+            --tracker=$TVM_TRACKER_HOST:$TVM_TRACKER_PORT --key=$BUILDER_KEY
+
+    The tracker queues the build requests of the tuning jobs until a worker is free, so that
+    the workers of a cluster are shared by all the jobs, and the measurements are done by an
+    `RPCRunner` on the devices of the same tracker.
+
+    Parameters
+    ----------
+    rpc_config : RPCConfig
+        The rpc configuration, whose tracker key is the key of the build workers.
+    max_workers : int
+        The max number of concurrent builds.
+    timeout_sec : float
+        The timeout in seconds for the build.
+    """
+
+    rpc_config: RPCConfig
+    max_workers: int
+    timeout_sec: float
+
+    def __init__(
+        self,
+        rpc_config: Optional[RPCConfig] = None,
+        *,
+        max_workers: Optional[int] = None,
+        timeout_sec: float = 30.0,
+    ) -> None:
+        """Constructor.
+
+        Parameters
+        ----------
+        rpc_config : Optional[RPCConfig]
+            The rpc configuration, whose tracker key is the key of the build workers.
+        max_workers : Optional[int]
+            The max number of concurrent builds. Defaults to the number of build workers
+            free in the tracker.
+        timeout_sec : float
+            The timeout in seconds for the build.
+        """
+        super().__init__()
+        self.rpc_config = RPCConfig._normalized(rpc_config)  # pylint: disable=protected-access
+        if max_workers is None:
+            max_workers = max(1, self.rpc_config.count_num_servers(allow_missing=True))
+        logger.info("RPCBuilder: max_workers = %d", max_workers)
+        self.max_workers = max_workers
+        self.timeout_sec = timeout_sec
+
+    def build(self, build_inputs: List[BuilderInput]) -> List[BuilderResult]:
+        def _build(build_input: BuilderInput) -> str:
+            session = self.rpc_config.connect_server()
+            f_build = session.get_function("meta_schedule.builder.rpc_build")
+            params = _serialize_params(build_input.params)
+            blob = f_build(
+                save_json(build_input.mod),
+                save_json(build_input.target),
+                params if params is not None else bytearray(),
+            )
+            artifact_dir = tempfile.mkdtemp()
+            try:
+                artifact_path = os.path.join(artifact_dir, "tvm_tmp_mod.tar")
+                with open(artifact_path, "wb") as file:
+                    file.write(blob)
+            except:  # pylint: disable=bare-except
+                shutil.rmtree(artifact_dir, ignore_errors=True)
+                raise
+            return artifact_path
+
+        def _remove_artifact(future: concurrent.futures.Future) -> None:
+            # the artifact of a build completing after its timeout is not returned
+            if not future.cancelled() and future.exception() is None:
+                shutil.rmtree(os.path.dirname(future.result()), ignore_errors=True)
+
+        # one deadline for the batch, which runs in rounds of max_workers builds
+        num_rounds = math.ceil(len(build_inputs) / self.max_workers)
+        deadline = time.monotonic() + self.timeout_sec * num_rounds
+        results: List[BuilderResult] = []
+        pool = concurrent.futures.ThreadPoolExecutor(max_workers=self.max_workers)
+        try:
+            futures = [pool.submit(_build, build_input) for build_input in build_inputs]
+            for future in futures:
+                try:
+                    timeout = max(0.0, deadline - time.monotonic())
+                    results.append(BuilderResult(future.result(timeout=timeout), None))
+                except concurrent.futures.TimeoutError:
+                    future.add_done_callback(_remove_artifact)
+                    results.append(
+                        BuilderResult(
+                            None,
+                            f"RPCBuilder: Timeout, killed after {self.timeout_sec} seconds",
+                        )
+                    )
+                except Exception as exception:  # pylint: disable=broad-except
+                    results.append(
+                        BuilderResult(
+                            None,
+                            "RPCBuilder: An exception occurred\n" + str(exception),
+                        )
+                    )
+        finally:
+            # the hung builds are left to their threads instead of blocking the tuning
+            pool.shutdown(wait=False, cancel_futures=True)
+        return results
+
+
+@register_func("meta_schedule.builder.rpc_build")
+def rpc_build(mod_json: str, target_json: str, params: bytearray) -> bytearray:
+    """The build function of the build workers, with the arguments serialized for RPC.
+
+    Parameters
+    ----------
+    mod_json : str
+        The IRModule to be built, in json.
+    target_json : str
+        The target to be built, in json.
+    params : bytearray
+        The parameters to be used for the build, empty if None.
+
+    Returns
+    -------
+    artifact : bytearray
+        The content of the exported Module.
+    """
+    rt_mod = default_build(
+        load_json(mod_json),
+        load_json(target_json),
+        _deserialize_params(params) if len(params) != 0 else None,
+    )
+    artifact_path = default_export(rt_mod)
+    try:
+        with open(artifact_path, "rb") as file:
+            return bytearray(file.read())
+    finally:
+        shutil.rmtree(os.path.dirname(artifact_path), ignore_errors=True)
+
+
+def _server_init_callback() -> None:
+    # registers `meta_schedule.builder.rpc_build` in the server process
+    # pylint: disable=import-outside-toplevel,unused-import
+    import tvm.meta_schedule.builder.rpc_builder
+
+
+def main() -> None:
+    """Start a build worker of RPCBuilder on this host."""
+    parser = argparse.ArgumentParser(description="Start a build worker of RPCBuilder")
+    parser.add_argument("--host", type=str, default="0.0.0.0", help="The host IP address")
+    parser.add_argument("--port", type=int, default=9090, help="The port of the worker")
+    parser.add_argument("--port-end", type=int, default=9199, help="The end search port")
+    parser.add_argument("--tracker", type=str, required=True, help="The tracker, as host:port")
+    parser.add_argument("--key", type=str, required=True, help="The key of the build workers")
+    args = parser.parse_args()
+    tracker_host, tracker_port = args.tracker.rsplit(":", 1)
+    server = rpc.Server(
+        args.host,
+        args.port,
+        args.port_end,
+        tracker_addr=(tracker_host, int(tracker_port)),
+        key=args.key,
+        server_init_callback=_server_init_callback,
+    )
+    server.proc.join()
+
+
+if __name__ == "__main__":
+    main()
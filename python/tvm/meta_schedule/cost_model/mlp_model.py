@@ -449,7 +449,12 @@ def extract_features(
             return 1e10
         return float(np.median([float(s) for s in res.run_secs]))
 
-    new_features = [_feature(x) for x in extractor.extract_from(context, candidates)]
+    if isinstance(extractor, PerStoreFeature):
+        # One contiguous float32 buffer, split into views per candidate
+        features, offsets = extractor.extract_batched(context, candidates)
+        new_features = np.split(features, offsets[1:-1])
+    else:
+        new_features = [_feature(x) for x in extractor.extract_from(context, candidates)]
     new_mean_costs = (
         np.array([_mean_cost(x) for x in results]).astype("float32")
         if results is not None
@@ -28,7 +28,7 @@ import numpy as np  # type: ignore
 from ...contrib.tar import tar, untar
 from ...runtime import NDArray
 from ..cost_model import PyCostModel
-from ..feature_extractor import FeatureExtractor
+from ..feature_extractor import FeatureExtractor, PerStoreFeature
 from ..logging import get_logger
 from ..runner import RunnerResult
 from ..search_strategy import MeasureCandidate
@@ -360,7 +360,7 @@ class XGBModel(PyCostModel):
                 config = config._replace(nthread=num_tuning_cores)
 
         if tree_method is not None:
-            config._replace(tree_method=tree_method)
+            config = config._replace(tree_method=tree_method)
 
         self.config = config
         # behavior of randomness
@@ -564,7 +564,15 @@ class XGBModel(PyCostModel):
         result : np.ndarray
             The predicted normalized score.
         """
-        if self.data_size >= self.num_warmup_samples and self.booster is not None:
+        if self.data_size < self.num_warmup_samples or self.booster is None:
+            ret = np.random.uniform(
+                low=0,
+                high=1,
+                size=(len(candidates),),
+            )
+        elif isinstance(self.extractor, PerStoreFeature):
+            ret = self._predict_batched(*self.extractor.extract_batched(context, candidates))
+        else:
             ret = self._predict(
                 xs=[
                     x.numpy().astype("float32")
@@ -574,12 +582,6 @@ class XGBModel(PyCostModel):
                     )
                 ]
             )
-        else:
-            ret = np.random.uniform(
-                low=0,
-                high=1,
-                size=(len(candidates),),
-            )
         return ret.astype("float64")
 
     def _train(  # type: ignore # pylint: disable=invalid-name
@@ -627,6 +629,18 @@ class XGBModel(PyCostModel):
         ret = d_test.predict_with_score(pred)
         return ret
 
+    def _predict_batched(
+        self,
+        features: np.ndarray,
+        offsets: np.ndarray,
+    ) -> np.ndarray:
+        import xgboost as xgb  # type: ignore # pylint: disable=import-outside-toplevel
+
+        n = len(offsets) - 1
+        pred = self.booster.predict(xgb.DMatrix(data=features, label=None))
+        ids = np.repeat(np.arange(n), np.diff(offsets))
+        return np.bincount(ids, weights=pred, minlength=n)
+
     def _validate(  # type: ignore # pylint: disable=invalid-name
         self,
         xs: List[np.ndarray],
@@ -380,6 +380,7 @@ class Database(Object):
         kind: Union[
             Literal[
                 "json",
+                "indexed",
                 "memory",
                 "union",
                 "ordered_union",
@@ -393,10 +394,10 @@ class Database(Object):
 
         Parameters
         ----------
-        kind : str = "json" | "memory" | "union" | "ordered_union" | Callable[[tvm.tir.Schedule],
-        bool]
+        kind : str = "json" | "indexed" | "memory" | "union" | "ordered_union" |
+        Callable[[tvm.tir.Schedule], bool]
             The kind of the database to be created. The following kinds are supported:
-            "json", "memory", "union", "ordered_union", and a custom schedule function.
+            "json", "indexed", "memory", "union", "ordered_union", and a custom schedule function.
 
         Returns
         -------
@@ -404,6 +405,7 @@ class Database(Object):
             The created database.
         """
         from . import (  # pylint: disable=import-outside-toplevel
+            IndexedDatabase,
             JSONDatabase,
             MemoryDatabase,
             OrderedUnionDatabase,
@@ -415,6 +417,8 @@ class Database(Object):
             return ScheduleFnDatabase(kind, *args, **kwargs)  # type: ignore
         if kind == "json":
             return JSONDatabase(*args, **kwargs)
+        if kind == "indexed":
+            return IndexedDatabase(*args, **kwargs)  # type: ignore
         if kind == "memory":
             return MemoryDatabase(*args, **kwargs)  # type: ignore
         if kind == "union":
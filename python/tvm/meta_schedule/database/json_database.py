@@ -34,6 +34,8 @@ class JSONDatabase(Database):
         The path to the workload table.
     path_tuning_record : str
         The path to the tuning record table.
+        A table whose path ends with ".bin" is stored in the binary format of
+        `tvm.ir.save_binary`, which loads much faster than JSON for large databases.
     module_equality : Optional[str]
         A string to specify the module equality testing and hashing method.
         It must be one of the followings:
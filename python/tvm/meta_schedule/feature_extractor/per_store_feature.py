@@ -18,9 +18,15 @@
 """We extract one feature vector per BufferStoreNode statement in a TIR Stmt,
 so we call this feature as "per-store" feature.
 """
+from typing import List, Tuple
+
+import numpy as np  # type: ignore
+
 from tvm._ffi import register_object
 
 from .. import _ffi_api
+from ..search_strategy import MeasureCandidate
+from ..tune_context import TuneContext
 from .feature_extractor import FeatureExtractor
 
 
@@ -65,3 +71,29 @@ class PerStoreFeature(FeatureExtractor):
             cache_line_bytes,
             extract_workload,
         )
+
+    def extract_batched(
+        self,
+        context: TuneContext,
+        candidates: List[MeasureCandidate],
+    ) -> Tuple[np.ndarray, np.ndarray]:
+        """Extract the features of all the candidates in parallel into one contiguous buffer.
+
+        Parameters
+        ----------
+        context : TuneContext
+            The tuning context for feature extraction.
+        candidates : List[MeasureCandidate]
+            The measure candidates to extract features from.
+
+        Returns
+        -------
+        features : np.ndarray
+            The float32 features of shape [total number of stores, feature_vector_length].
+        offsets : np.ndarray
+            The int64 offsets of shape [len(candidates) + 1], the features of candidate i being
+            the rows in [offsets[i], offsets[i + 1]).
+        """
+        extract = getattr(_ffi_api, "FeatureExtractorPerStoreFeatureExtractBatched")
+        features, offsets = extract(self, context, candidates)
+        return features.numpy(), offsets.numpy()
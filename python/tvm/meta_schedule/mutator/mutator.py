@@ -79,6 +79,7 @@ class Mutator(Object):
             "llvm",
             "cuda",
             "cuda-tensorcore",
+            "vulkan-cooperative-matrix",
             "hexagon",
         ]
     ) -> Dict["Mutator", float]:
@@ -86,7 +87,7 @@ class Mutator(Object):
 
         Parameters
         ----------
-        kind : Literal["llvm", "cuda", "cuda-tensorcore", "hexagon"]
+        kind : Literal["llvm", "cuda", "cuda-tensorcore", "vulkan-cooperative-matrix", "hexagon"]
             The kind of mutators.
 
         Returns
@@ -99,6 +100,7 @@ class Mutator(Object):
             "llvm": _ffi_api.MutatorDefaultLLVM,  # type: ignore
             "cuda": _ffi_api.MutatorDefaultCUDA,  # type: ignore
             "cuda-tensorcore": _ffi_api.MutatorDefaultCUDATensorCore,  # type: ignore
+            "vulkan-cooperative-matrix": _ffi_api.MutatorDefaultCUDATensorCore,  # type: ignore
             "hexagon": _ffi_api.MutatorDefaultHexagon,  # type: ignore
             # pylint: enable=no-member
         }
@@ -75,12 +75,14 @@ class Postproc(Object):
         return _ffi_api.PostprocClone(self)  # type: ignore # pylint: disable=no-member
 
     @staticmethod
-    def create(kind: Literal["llvm", "cuda", "cuda-tensorcore", "hexagon"]) -> List["Postproc"]:
+    def create(
+        kind: Literal["llvm", "cuda", "cuda-tensorcore", "vulkan-cooperative-matrix", "hexagon"]
+    ) -> List["Postproc"]:
         """Create a list of default postprocessors.
 
         Parameters
         ----------
-        kind : Literal["llvm", "cuda", "cuda-tensorcore", "hexagon"]
+        kind : Literal["llvm", "cuda", "cuda-tensorcore", "vulkan-cooperative-matrix", "hexagon"]
             The kind of the postprocessors.
 
         Returns
@@ -93,6 +95,7 @@ class Postproc(Object):
             "llvm": _ffi_api.PostprocDefaultLLVM,  # type: ignore
             "cuda": _ffi_api.PostprocDefaultCUDA,  # type: ignore
             "cuda-tensorcore": _ffi_api.PostprocDefaultCUDATensorCore,  # type: ignore
+            "vulkan-cooperative-matrix": _ffi_api.PostprocDefaultCUDATensorCore,  # type: ignore
             "hexagon": _ffi_api.PostprocDefaultHexagon,  # type: ignore
             # pylint: enable=no-member
         }
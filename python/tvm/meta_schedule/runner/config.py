@@ -17,7 +17,7 @@
 """Configurations for measurements in the runner"""
 import os
 from threading import Thread
-from typing import NamedTuple, Optional, Union
+from typing import Any, NamedTuple, Optional, Union
 
 from tvm import rpc
 
@@ -41,6 +41,18 @@ class EvaluatorConfig(NamedTuple):
         increase the number of runs to the given time (in ms) to reduce the measurement error.
     enable_cpu_cache_flush: bool
         Whether to flush the cache on CPU.
+    enable_gpu_cache_flush: bool
+        Whether to flush the L2 cache between the repeats on CUDA.
+    max_relative_ci: Optional[float]
+        If set, the repeats are measured one by one, and the measurement stops once the half
+        width of the 95% confidence interval of the mean is below this fraction of the mean.
+        At most `repeat` repeats are measured.
+    early_stop_ratio: Optional[float]
+        If set, the measurement stops after the first repeat when the candidate is slower than
+        this many times the best run time known for the workload.
+    threshold_secs: Optional[float]
+        The best run time in seconds known for the workload, filled in by the runner from
+        `RunnerInput.threshold_secs`.
 
     Note
     ----
@@ -52,6 +64,10 @@ class EvaluatorConfig(NamedTuple):
     repeat: int = 1
     min_repeat_ms: int = 100
     enable_cpu_cache_flush: bool = False
+    enable_gpu_cache_flush: bool = False
+    max_relative_ci: Optional[float] = None
+    early_stop_ratio: Optional[float] = None
+    threshold_secs: Optional[float] = None
 
     @staticmethod
     def _normalized(config: Optional["EvaluatorConfig"]) -> "EvaluatorConfig":
@@ -62,9 +78,18 @@ class EvaluatorConfig(NamedTuple):
             repeat=config.repeat,
             min_repeat_ms=config.min_repeat_ms,
             enable_cpu_cache_flush=config.enable_cpu_cache_flush,
+            enable_gpu_cache_flush=config.enable_gpu_cache_flush,
+            max_relative_ci=config.max_relative_ci,
+            early_stop_ratio=config.early_stop_ratio,
+            threshold_secs=config.threshold_secs,
         )
         return config
 
+    def _with_threshold(self, threshold_secs: Optional[Any]) -> "EvaluatorConfig":
+        if threshold_secs is None or self.early_stop_ratio is None:
+            return self
+        return self._replace(threshold_secs=float(threshold_secs.value))
+
 
 class RPCConfig(NamedTuple):
     """RPC configuration
@@ -295,7 +295,7 @@ class LocalRunner(PyRunner):
                 self.f_alloc_argument,
                 self.f_run_evaluator,
                 self.f_cleanup,
-                self.evaluator_config,
+                self.evaluator_config._with_threshold(runner_input.threshold_secs),
                 self.alloc_repeat,
                 str(runner_input.artifact_path),
                 str(runner_input.device_type),
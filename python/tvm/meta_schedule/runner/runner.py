@@ -24,6 +24,7 @@ from typing_extensions import Literal
 
 from tvm._ffi import register_object
 from tvm.runtime import Object
+from tvm.tir import FloatImm
 
 from .. import _ffi_api
 from ..arg_info import ArgInfo
@@ -41,17 +42,21 @@ class RunnerInput(Object):
         The device type.
     args_info : List[ArgInfo]
         The argument information.
+    threshold_secs : Optional[FloatImm]
+        The best run time in seconds known for the workload, if any.
     """
 
     artifact_path: str
     device_type: str
     args_info: List[ArgInfo]
+    threshold_secs: Optional[FloatImm]
 
     def __init__(
         self,
         artifact_path: str,
         device_type: str,
         args_info: List[ArgInfo],
+        threshold_secs: Optional[float] = None,
     ) -> None:
         """Constructor
 
@@ -63,12 +68,16 @@ class RunnerInput(Object):
             The device type.
         args_info : List[ArgInfo]
             The argument information.
+        threshold_secs : Optional[float]
+            The best run time in seconds known for the workload, if any. A runner may stop
+            measuring a candidate early once it is clearly slower than this.
         """
         self.__init_handle_by_constructor__(
             _ffi_api.RunnerInput,  # type: ignore # pylint: disable=no-member
             artifact_path,
             device_type,
             args_info,
+            None if threshold_secs is None else FloatImm("float64", threshold_secs),
         )
 
 
@@ -16,8 +16,10 @@
 # under the License.
 """Runner utility functions"""
 import itertools
+import math
 from typing import Any, Callable, Dict, List
 
+from ..._ffi.runtime_ctypes import RPC_SESS_MASK
 from ...runtime import Device, Module, ndarray
 from .config import EvaluatorConfig
 
@@ -101,20 +103,55 @@ def run_evaluator_common(
     costs: List[float]
         The evaluator results
     """
+    config = evaluator_config
+    adaptive = config.max_relative_ci is not None or (
+        config.early_stop_ratio is not None and config.threshold_secs is not None
+    )
     evaluator = rt_mod.time_evaluator(
         func_name=rt_mod.entry_name,
         dev=device,
-        number=evaluator_config.number,
-        repeat=evaluator_config.repeat,
-        min_repeat_ms=evaluator_config.min_repeat_ms,
-        f_preproc="cache_flush_cpu_non_first_arg"
-        if evaluator_config.enable_cpu_cache_flush
-        else "",
+        number=config.number,
+        repeat=1 if adaptive else config.repeat,
+        min_repeat_ms=config.min_repeat_ms,
+        f_preproc=_cache_flush_preproc(config, device),
     )
-    repeated_costs: List[List[float]] = []
-    for args in repeated_args:
+    if not adaptive:
+        repeated_costs: List[List[float]] = []
+        for args in repeated_args:
+            device.sync()
+            profile_result = evaluator(*args)
+            repeated_costs.append(profile_result.results)
+        costs = [float(cost) for cost in itertools.chain.from_iterable(repeated_costs)]
+        return costs
+    # Measure one repeat at a time, cycling through the argument sets, and stop as soon as the
+    # candidate is clearly slower than the best known, or the mean is tight enough
+    costs = []
+    for i in range(config.repeat * len(repeated_args)):
+        args = repeated_args[i % len(repeated_args)]
         device.sync()
-        profile_result = evaluator(*args)
-        repeated_costs.append(profile_result.results)
-    costs = [float(cost) for cost in itertools.chain.from_iterable(repeated_costs)]
+        costs.extend(float(cost) for cost in evaluator(*args).results)
+        if (
+            i == 0
+            and config.early_stop_ratio is not None
+            and config.threshold_secs is not None
+            and costs[0] > config.early_stop_ratio * config.threshold_secs
+        ):
+            break
+        if config.max_relative_ci is not None and len(costs) >= 3:
+            mean = sum(costs) / len(costs)
+            var = sum((cost - mean) ** 2 for cost in costs) / (len(costs) - 1)
+            half_width = 1.96 * math.sqrt(var / len(costs))
+            if half_width <= config.max_relative_ci * mean:
+                break
     return costs
+
+
+def _cache_flush_preproc(evaluator_config: EvaluatorConfig, device: Device) -> str:
+    if evaluator_config.enable_cpu_cache_flush:
+        return "cache_flush_cpu_non_first_arg"
+    if (
+        evaluator_config.enable_gpu_cache_flush
+        and device.device_type % RPC_SESS_MASK == Device.kDLCUDA
+    ):
+        return "l2_cache_flush_cuda"
+    return ""
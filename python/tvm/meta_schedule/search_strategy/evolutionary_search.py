@@ -45,6 +45,10 @@ class EvolutionarySearch(SearchStrategy):
         The maximum number to retry mutation.
     eps_greedy : float
         The ratio of greedy selected samples in the final picks.
+    num_similar_workloads : int
+        The number of tuned workloads in the database that differ from the workload only in
+        shapes, whose best traces are re-applied to seed the measured part of the initial
+        population while the workload itself has too few records. 0 disables warm starting.
     """
 
     population_size: int
@@ -54,6 +58,7 @@ class EvolutionarySearch(SearchStrategy):
     genetic_mutate_prob: float
     genetic_max_fail_count: int
     eps_greedy: float
+    num_similar_workloads: int
 
     def __init__(
         self,
@@ -66,6 +71,7 @@ class EvolutionarySearch(SearchStrategy):
         genetic_mutate_prob: float = 0.85,
         genetic_max_fail_count: int = 10,
         eps_greedy: float = 0.05,
+        num_similar_workloads: int = 0,
     ) -> None:
         """Constructor"""
         self.__init_handle_by_constructor__(
@@ -78,4 +84,5 @@ class EvolutionarySearch(SearchStrategy):
             genetic_mutate_prob,
             genetic_max_fail_count,
             eps_greedy,
+            num_similar_workloads,
         )
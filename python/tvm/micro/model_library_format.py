@@ -166,9 +166,42 @@ def _build_memory_map(mod):
     if isinstance(mod, executor_factory.GraphExecutorFactoryModule):
         ret["sids"] = _build_sid_map(mod.graph_json)
     ret["functions"] = _build_function_memory_map(mod.function_metadata)
+    if isinstance(mod, executor_factory.AOTExecutorFactoryModule):
+        arena_buffer_allocations = mod.executor_codegen_metadata.arena_buffer_allocations
+        if arena_buffer_allocations:
+            ret["arena"] = _build_arena_map(arena_buffer_allocations)
     return ret
 
 
+def _build_arena_map(arena_buffer_allocations):
+    """Build the layout of the static arena, as planned by USMP with tir.usmp.static_arena.
+
+    Parameters
+    ----------
+    arena_buffer_allocations : Map[tvm.tir.usmp.BufferInfo, tvm.tir.usmp.PoolAllocation]
+        The pool allocations of all the buffers of the model.
+
+    Returns
+    -------
+    dict :
+        For each pool, its high-water mark and the buffers sorted by their offset.
+    """
+    arena = {}
+    for buffer_info, pool_allocation in arena_buffer_allocations.items():
+        pool = arena.setdefault(
+            str(pool_allocation.pool_info.pool_name), {"high_water_mark_bytes": 0, "buffers": []}
+        )
+        offset = int(pool_allocation.byte_offset)
+        size = int(buffer_info.size_bytes)
+        pool["buffers"].append(
+            {"name": str(buffer_info.name_hint), "offset_bytes": offset, "size_bytes": size}
+        )
+        pool["high_water_mark_bytes"] = max(pool["high_water_mark_bytes"], offset + size)
+    for pool in arena.values():
+        pool["buffers"].sort(key=lambda buffer: (buffer["offset_bytes"], buffer["name"]))
+    return arena
+
+
 def _build_sid_map(graph_json):
     """Build a simpler storage id info map from graph JSON.
 
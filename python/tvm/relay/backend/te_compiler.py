@@ -414,6 +414,14 @@ def get():
     return _backend._TECompilerGlobal()
 
 
+def clear_global_lowering_cache():
+    """Clear the primitives kept across the builds by the
+    "relay.backend.use_global_lowering_cache" pass config, to be called when the tuning records
+    change.
+    """
+    _backend._ClearGlobalLoweringCache()
+
+
 def lower_to_primfunc(relay_func, target):
     """Lower Relay Function to TIR PrimFunc.
 
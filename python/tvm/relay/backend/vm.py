@@ -24,14 +24,19 @@ import numpy as np
 
 import tvm.runtime.ndarray as _nd
 import tvm.runtime.vm as vm_rt
-from tvm import autotvm
+from tvm import autotvm, tir
+from tvm.ir import GlobalVar, IRModule
 from tvm.relay import expr as _expr
+from tvm.relay import function as _function
+from tvm.relay import op as _op
+from tvm.relay import transform as _transform
+from tvm.relay import ty as _ty
 from tvm.relay.backend.interpreter import Executor
 from tvm.target import Target
 from . import _vm
 
 
-def compile(mod, target=None, target_host=None, params=None):
+def compile(mod, target=None, target_host=None, params=None, shape_buckets=None):
     """Compile the module to VM executable. A helper function for VMCompiler.
 
     Parameters
@@ -56,6 +61,9 @@ def compile(mod, target=None, target_host=None, params=None):
         Input parameters to the graph that do not change
         during inference time. Used for constant folding.
 
+    shape_buckets : ShapeBuckets, optional
+        The static specializations of the entry function for the buckets of a dynamic length.
+
     Returns
     -------
     exec : tvm.runtime.vm.Executable
@@ -64,7 +72,7 @@ def compile(mod, target=None, target_host=None, params=None):
     compiler = VMCompiler()
     if params:
         compiler.set_params(params)
-    compiler.lower(mod, target, target_host)
+    compiler.lower(mod, target, target_host, shape_buckets)
     compiler.codegen()
     return compiler.get_exec()
 
@@ -105,7 +113,7 @@ class VMCompiler(object):
             ret[key] = value.data
         return ret
 
-    def lower(self, mod, target=None, target_host=None):
+    def lower(self, mod, target=None, target_host=None, shape_buckets=None):
         """Lower the module to VM bytecode.
 
         Parameters
@@ -119,8 +127,14 @@ class VMCompiler(object):
 
         target_host : any target-like object, see Target.canon_target
             Host compilation target, if target is device.
+
+        shape_buckets : ShapeBuckets, optional
+            The static specializations of the entry function for the buckets of a dynamic
+            length. The params are bound first, so that they are folded into each of them.
         """
         raw_targets = Target.canon_multi_target_and_host(target, target_host)
+        if shape_buckets is not None:
+            mod = shape_buckets(mod, self.get_params())
         tophub_context = self._tophub_context(raw_targets)
         with tophub_context:
             self._lower(mod, raw_targets)
@@ -181,6 +195,196 @@ class VMCompiler(object):
         return tophub_context
 
 
+class ShapeBuckets(object):
+    """Static specializations of the entry function of a module for the buckets of a dynamic
+    length, e.g. the sequence length of an NLP model.
+
+    The kernels of the dynamic dimensions (``relay.Any()``) are generic and much slower than the
+    static ones. For each bucketed length the entry function is specialized with that length in
+    the types of the bucketed inputs, so its kernels are compiled for static shapes. The entry
+    function becomes a dispatcher run by the VM per call: it calls the specialization of the
+    smallest bucket that fits the length of the inputs, with the inputs padded to the bucket and
+    the outputs cropped back, and the generic function for the longer inputs.
+
+    The padding must not change the unpadded part of the outputs, e.g. the padded positions of
+    a sequence are masked out by an attention mask input padded with zeros.
+
+    Parameters
+    ----------
+    dims : dict of str to int
+        The bucketed axis of each input, by name. The inputs should be of the same length along
+        these axes, dynamic in the types of the inputs.
+
+    buckets : list of int, optional
+        The bucketed lengths. By default the powers of two from min_size to max_size.
+
+    max_size : int
+        The largest bucket by default, the longer inputs run the generic function.
+
+    min_size : int
+        The smallest bucket by default.
+
+    out_axes : int or list of int or None, optional
+        The axis along which each output is cropped back to the length of the inputs, None for
+        the outputs that are not. A list for the fields of a tuple output.
+
+    pad_value : float or dict of str to float
+        The value of the padding, or the one of each bucketed input by name.
+
+    func_name : str
+        The entry function.
+    """
+
+    def __init__(
+        self,
+        dims,
+        buckets=None,
+        max_size=512,
+        min_size=16,
+        out_axes=None,
+        pad_value=0,
+        func_name="main",
+    ):
+        if not dims:
+            raise ValueError("No input to bucket")
+        if buckets is None:
+            buckets = []
+            size = min_size
+            while size <= max_size:
+                buckets.append(size)
+                size *= 2
+        self.dims = dict(dims)
+        self.buckets = sorted(set(int(b) for b in buckets))
+        self.out_axes = out_axes
+        self.pad_value = pad_value
+        self.func_name = func_name
+
+    def _pad_value(self, name):
+        if isinstance(self.pad_value, dict):
+            return self.pad_value.get(name, 0)
+        return self.pad_value
+
+    def _specialize(self, func, size):
+        """The function with the bucketed axes of its inputs of the given size."""
+        binds = {}
+        params = []
+        for param in func.params:
+            ty = param.checked_type
+            if param.name_hint in self.dims:
+                shape = list(ty.shape)
+                shape[self.dims[param.name_hint]] = size
+                ty = _ty.TensorType(shape, ty.dtype)
+            new_param = _expr.var(param.name_hint, type_annotation=ty)
+            binds[param] = new_param
+            params.append(new_param)
+        body = _expr.bind(func.body, binds)
+        return _function.Function(params, body, None, func.type_params, func.attrs)
+
+    @staticmethod
+    def _pad(data, axis, ndim, amount, value, dtype):
+        zeros = _expr.const(np.zeros((2,), "int64"))
+        rows = [zeros] * ndim
+        rows[axis] = _op.stack([_expr.const(0, "int64"), amount], 0)
+        return _op.nn.pad(data, _op.stack(rows, 0), _expr.const(value, dtype))
+
+    @staticmethod
+    def _crop(data, axis, ndim, length):
+        shape = _op.shape_of(data, "int64")
+        end = [_op.reshape(length, [1])]
+        if axis > 0:
+            end.insert(0, _op.strided_slice(shape, [0], [axis]))
+        if axis + 1 < ndim:
+            end.append(_op.strided_slice(shape, [axis + 1], [ndim]))
+        end = _op.concatenate(end, 0) if len(end) > 1 else end[0]
+        begin = _expr.const(np.zeros((ndim,), "int64"))
+        strides = _expr.const(np.ones((ndim,), "int64"))
+        return _op.strided_slice(data, begin, end, strides)
+
+    def __call__(self, mod, params=None):
+        """Add the specializations to the module and dispatch the entry function to them.
+
+        Parameters
+        ----------
+        mod : tvm.IRModule
+            The module, its entry function with the bucketed inputs.
+
+        params : dict of str to NDArray, optional
+            The params bound to the entry function first.
+
+        Returns
+        -------
+        mod : tvm.IRModule
+            The module with the dispatching entry function.
+        """
+        func = mod[self.func_name]
+        if params:
+            binds = {p: _expr.const(params[p.name_hint]) for p in func.params}
+            binds = {p: v for p, v in binds.items() if p.name_hint in params}
+            func = _expr.bind(func, binds)
+        funcs = {gv: f for gv, f in mod.functions.items() if gv.name_hint != self.func_name}
+        mod = IRModule(funcs, mod.type_definitions)
+        mod[self.func_name] = func
+        mod = _transform.InferType()(mod)
+        func = mod[self.func_name]
+
+        by_name = {p.name_hint: p for p in func.params}
+        for name, axis in self.dims.items():
+            if name not in by_name:
+                raise ValueError("%s is not an input of %s" % (name, self.func_name))
+            shape = by_name[name].checked_type.shape
+            if not isinstance(shape[axis], tir.Any):
+                raise ValueError("The axis %d of the input %s is not dynamic" % (axis, name))
+
+        ret_type = func.checked_type.ret_type
+        is_tuple = isinstance(ret_type, _ty.TupleType)
+        out_axes = self.out_axes
+        if is_tuple:
+            fields = list(ret_type.fields)
+            out_axes = list(out_axes) if out_axes is not None else [None] * len(fields)
+            if len(out_axes) != len(fields):
+                raise ValueError("out_axes should give an axis per field of the output")
+        else:
+            fields = [ret_type]
+            out_axes = [out_axes]
+
+        generic = GlobalVar(self.func_name + "__generic")
+        mod[generic] = func
+        specialized = []
+        for size in self.buckets:
+            gv = GlobalVar("%s__bucket%d" % (self.func_name, size))
+            mod[gv] = self._specialize(func, size)
+            specialized.append((size, gv))
+
+        # the dispatcher, the length taken from the first bucketed input
+        params = [_expr.var(p.name_hint, type_annotation=p.checked_type) for p in func.params]
+        first = next(p for p in params if p.name_hint in self.dims)
+        length = _op.take(_op.shape_of(first, "int64"), _expr.const(self.dims[first.name_hint]))
+        body = _expr.Call(generic, params)
+        for size, gv in reversed(specialized):
+            args = []
+            for p in params:
+                if p.name_hint not in self.dims:
+                    args.append(p)
+                    continue
+                ty = p.type_annotation
+                amount = _expr.const(size, "int64") - length
+                value = self._pad_value(p.name_hint)
+                args.append(
+                    self._pad(p, self.dims[p.name_hint], len(ty.shape), amount, value, ty.dtype)
+                )
+            out = _expr.Call(gv, args)
+            crops = []
+            for i, (field, axis) in enumerate(zip(fields, out_axes)):
+                item = _expr.TupleGetItem(out, i) if is_tuple else out
+                if axis is not None:
+                    item = self._crop(item, axis, len(field.shape), length)
+                crops.append(item)
+            out = _expr.Tuple(crops) if is_tuple else crops[0]
+            body = _expr.If(_op.less_equal(length, _expr.const(size, "int64")), out, body)
+        mod[self.func_name] = _function.Function(params, body, None, func.type_params, func.attrs)
+        return _transform.InferType()(mod)
+
+
 class VMExecutor(Executor):
     """
     An implementation of the executor interface for
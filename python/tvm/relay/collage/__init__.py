@@ -22,4 +22,6 @@ from .collage import (
     CostEstimator,
     MockCostEstimator,
     CustomCostEstimator,
+    CostCache,
+    set_cost_cache,
 )
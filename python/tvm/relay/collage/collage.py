@@ -18,10 +18,12 @@
 """Mostly helper methods which interface the main C++ Collage implementation with Python.
    See relay.transform.CollagePartition for the main Collage entrypoint."""
 
+import json
 import logging
 import os
 import math
 import tempfile
+import threading
 
 import numpy as np
 
@@ -35,6 +37,10 @@ MEASURE_NUMBER = 20
 MEASURE_REPEAT = 5
 WARMUP_MIN_REPEAT_MS = 250
 
+# The JSON lines file persisting the estimated costs across the partitioning runs, see
+# set_cost_cache. Defaults to the TVM_COLLAGE_COST_CACHE environment variable.
+COST_CACHE_ENV = "TVM_COLLAGE_COST_CACHE"
+
 
 @register_object("relay.collage.CostEstimator")
 class CostEstimator(Object):
@@ -86,10 +92,112 @@ def vm_estimate_seconds(device, the_vm, func_name, args):
     )
 
 
+class CostCache:
+    """The costs of the candidate modules, keyed by their structural hash and target, appended to
+    a JSON lines file so that the next partitioning runs do not measure them again."""
+
+    def __init__(self, path):
+        self.path = path
+        self.costs = {}
+        self.lock = threading.Lock()
+        if os.path.exists(path):
+            with open(path, "r", encoding="utf-8") as file:
+                for line in file:
+                    line = line.strip()
+                    if line:
+                        key, seconds = json.loads(line)
+                        self.costs[key] = seconds
+
+    @staticmethod
+    def key(mod, target):
+        return f"{tvm.ir.structural_hash(mod, map_free_vars=True):x}|{target}"
+
+    def get(self, mod, target):
+        return self.costs.get(self.key(mod, target))
+
+    def put(self, mod, target, seconds):
+        key = self.key(mod, target)
+        with self.lock:
+            self.costs[key] = seconds
+            with open(self.path, "a", encoding="utf-8") as file:
+                file.write(json.dumps([key, seconds]) + "\n")
+
+
+_COST_CACHE = None
+
+
+def set_cost_cache(path):
+    """Persist the costs estimated by estimate_seconds in the JSON lines file at path, reused by
+    the later runs. None disables the cache."""
+    global _COST_CACHE  # pylint: disable=global-statement
+    _COST_CACHE = CostCache(path) if path else None
+
+
+def _cost_cache():
+    if _COST_CACHE is None and os.environ.get(COST_CACHE_ENV):
+        set_cost_cache(os.environ[COST_CACHE_ENV])
+    return _COST_CACHE
+
+
+def _tl_predicted_seconds(func, target):
+    """The latency of the TL program of a "tl" partition predicted by the roofline model of
+    tvm.tl.CostModel, None if the model is not available."""
+    try:
+        # pylint: disable=import-outside-toplevel
+        from tvm.relay.op.contrib.tl import _PROGRAMS
+        from tvm.tl import CostModel
+    except ImportError:
+        return None
+    call = func.body
+    if not (isinstance(call, tvm.relay.Call) and isinstance(call.op, tvm.relay.Function)):
+        return None
+    program = _PROGRAMS.get(str(call.op.attrs["Composite"]))
+    if program is None or target.kind.name != "cuda":
+        return None
+    return CostModel().predict(program(call.op)) / 1e3
+
+
+def prefilter_seconds(mod, target):
+    """The cost of mod known without building it, or None: inf if one of its external functions
+    has no codegen, or is a TL program which can't be launched."""
+    for _, func in mod.functions.items():
+        if not isinstance(func, tvm.relay.Function) or not func.attrs:
+            continue
+        if "Compiler" not in func.attrs:
+            continue
+        compiler = func.attrs["Compiler"]
+        if tvm.get_global_func("relay.ext." + str(compiler), allow_missing=True) is None:
+            return math.inf
+        if str(compiler) == "tl":
+            predicted = _tl_predicted_seconds(func, target)
+            if predicted is not None and math.isinf(predicted):
+                return math.inf
+    return None
+
+
 @register_func("tvm.relay.collage.estimate_seconds")
 def estimate_seconds(mod, target):
     """Returns the mean execution time of "main" in mod on target with params. The module
-    may contain "Primitive" functions, possibly with "Compiler" attributes."""
+    may contain "Primitive" functions, possibly with "Compiler" attributes.
+
+    The cost is looked up in the cost cache first (see set_cost_cache), then the candidates whose
+    cost is known without building them (see prefilter_seconds) are not measured."""
+    cache = _cost_cache()
+    if cache is not None:
+        seconds = cache.get(mod, target)
+        if seconds is not None:
+            logging.info("Reusing the cached cost %s", seconds)
+            return seconds
+    seconds = prefilter_seconds(mod, target)
+    if seconds is None:
+        seconds = _measure_seconds(mod, target)
+    if cache is not None:
+        cache.put(mod, target, seconds)
+    return seconds
+
+
+def _measure_seconds(mod, target):
+    """The median execution time of "main" in mod on target, inf if it can't be built."""
     device = tvm.device(target.get_target_device_type())
 
     try:
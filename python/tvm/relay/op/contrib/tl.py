@@ -0,0 +1,955 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+# pylint: disable=invalid-name, import-outside-toplevel
+"""TL external codegen: the fused dense, attention and conv2d patterns of a Relay graph offloaded
+to TL tile programs, each compiled with tl.lower for the static shapes of its partition.
+
+.. code-block:: python
+
+    from tvm.relay.op.contrib.tl import partition_for_tl
+
+    mod = partition_for_tl(mod, params)
+    with tvm.transform.PassContext(opt_level=3):
+        lib = relay.build(mod, target="cuda", params=params)
+
+The attention pattern is batch_matmul(softmax(batch_matmul(q, k) [* or / scale]), v), the scores
+never leaving the chip, like tl_scripts/mha_example.py. The conv2d pattern is the NHWC / HWIO
+implicit gemm of tl_scripts/conv_example.py. The fp8 dense pattern is the scaled float8 dense
+of relay.transform.mixed_precision_calibration, run by the fp8 mma of TL. The qnn dense patterns
+are the int8 qnn.dense of symmetric quantization (e.g. the W8A8 layers of SmoothQuant) followed by
+qnn.requantize or qnn.dequantize, run by the int8 mma of TL with the requantization in the
+epilogue of the kernel. The dense reading the same input, like the q, k and v projections, are
+fused into one kernel with an output per dense.
+"""
+from typing import Optional
+
+import tvm
+from tvm import relay
+from tvm.ir.transform import PassContext, Sequential
+from tvm.relay import transform
+from tvm.relay.build_module import bind_params_by_name
+
+from ...dataflow_pattern import is_constant, is_op, wildcard
+from .register import register_pattern_table
+
+
+def _with_bias_relu(out, with_bias, with_relu):
+    if with_bias:
+        out = (is_op("add") | is_op("nn.bias_add"))(out, wildcard())
+    if with_relu:
+        out = is_op("nn.relu")(out)
+    return out
+
+
+def make_dense_pattern(with_bias=False, with_relu=False):
+    """dense, followed by the bias and relu of the epilogue."""
+    return _with_bias_relu(is_op("nn.dense")(wildcard(), wildcard()), with_bias, with_relu)
+
+
+def make_dense_fp8_pattern():
+    """The float8 dense of ToMixedPrecision with a calibrated plan: accumulated in float32,
+    multiplied by the product of the scales of its args and cast to float16."""
+    dense = is_op("nn.dense")(wildcard(), wildcard())
+    return is_op("cast")(is_op("multiply")(dense, is_constant()))
+
+
+def make_qnn_dense_pattern(with_bias=False, dequantize=False):
+    """The int8 qnn.dense accumulated in int32 and the int32 bias, requantized by qnn.requantize,
+    or dequantized by qnn.dequantize and cast or not."""
+    zero_points_and_scales = [is_constant() for _ in range(4)]
+    dense = is_op("qnn.dense")(wildcard(), wildcard(), *zero_points_and_scales)
+    out = _with_bias_relu(dense, with_bias, False)
+    if dequantize:
+        out = is_op("qnn.dequantize")(out, wildcard(), is_constant())
+        return is_op("cast")(out) | out
+    return is_op("qnn.requantize")(out, wildcard(), is_constant(), is_constant(), is_constant())
+
+
+def make_attention_pattern():
+    """The scores of q and k, scaled by a constant or not, their softmax, times v."""
+    scores = is_op("nn.batch_matmul")(wildcard(), wildcard())
+    scaled = (
+        scores
+        | is_op("multiply")(scores, is_constant())
+        | is_op("divide")(scores, is_constant())
+    )
+    return is_op("nn.batch_matmul")(is_op("nn.softmax")(scaled), wildcard())
+
+
+def make_conv2d_pattern(with_bias=False, with_relu=False):
+    """conv2d, followed by the bias and relu of the epilogue."""
+    return _with_bias_relu(is_op("nn.conv2d")(wildcard(), wildcard()), with_bias, with_relu)
+
+
+def _find_calls(expr, op_name):
+    calls = []
+
+    def visit(node):
+        if isinstance(node, relay.Call) and isinstance(node.op, tvm.ir.Op):
+            if node.op.name == op_name:
+                calls.append(node)
+
+    relay.analysis.post_order_visit(expr, visit)
+    return calls
+
+
+def _static_shape(ty) -> Optional[list]:
+    if not all(isinstance(dim, tvm.tir.IntImm) for dim in ty.shape):
+        return None
+    return [int(dim) for dim in ty.shape]
+
+
+def _check_bias(call, channels, dtype="float16"):
+    """The bias of the epilogue is a vector of dtype of the output channels, on the last axis."""
+    for add in _find_calls(call, "add") + _find_calls(call, "nn.bias_add"):
+        bias = add.args[1].checked_type
+        if bias.dtype != dtype or _static_shape(bias) not in ([channels], [1, channels]):
+            return False
+        if add.op.name == "nn.bias_add":
+            if int(add.attrs.axis) not in (-1, len(add.args[0].checked_type.shape) - 1):
+                return False
+    return True
+
+
+def _all_float16(exprs):
+    return all(expr.checked_type.dtype == "float16" for expr in exprs)
+
+
+def check_dense(call):
+    """float16 dense of static shapes, whose rows are aligned for the vectorized copies."""
+    dense = _find_calls(call, "nn.dense")[0]
+    data, weight = (_static_shape(arg.checked_type) for arg in dense.args)
+    if not _all_float16(list(dense.args) + [dense]):
+        return False
+    if data is None or weight is None or len(data) != 2:
+        return False
+    N, K = weight
+    return K % 8 == 0 and N % 8 == 0 and _check_bias(call, N)
+
+
+def _compute_capability():
+    """The (major, minor) compute capability of the current cuda target, else of the GPU, None
+    when there is neither."""
+    from tvm.contrib import nvcc
+
+    target = tvm.target.Target.current(allow_none=True)
+    if target is not None and target.kind.name != "cuda":
+        return None
+    try:
+        return nvcc.parse_compute_version(nvcc.get_target_compute_version(target))
+    except ValueError:
+        return None
+
+
+def check_dense_fp8(call):
+    """float8 dense of static shapes accumulated in float32, whose rows are aligned for the
+    vectorized copies of 16 float8 elements, on sm_89 or newer which have the float8 mma."""
+    capability = _compute_capability()
+    if capability is None or capability < (8, 9):
+        return False
+    dense = _find_calls(call, "nn.dense")[0]
+    if not all(arg.checked_type.dtype in ("e4m3_float8", "e5m2_float8") for arg in dense.args):
+        return False
+    if dense.checked_type.dtype != "float32" or call.checked_type.dtype != "float16":
+        return False
+    if _find_calls(call, "multiply")[0].args[1].data.numpy().size != 1:
+        return False
+    data, weight = (_static_shape(arg.checked_type) for arg in dense.args)
+    if data is None or weight is None or len(data) != 2:
+        return False
+    N, K = weight
+    return K % 16 == 0 and N % 8 == 0
+
+
+def _is_zero(expr):
+    return isinstance(expr, relay.Constant) and not expr.data.numpy().any()
+
+
+def check_qnn_dense(call):
+    """int8 qnn.dense of static shapes with zero points of 0, whose rows are aligned for the
+    vectorized copies of 16 int8 elements, and a constant per-tensor or per-channel scale of the
+    accumulator."""
+    dense = _find_calls(call, "qnn.dense")[0]
+    if not all(arg.checked_type.dtype == "int8" for arg in dense.args[:2]):
+        return False
+    if dense.checked_type.dtype != "int32" or not all(_is_zero(x) for x in dense.args[2:4]):
+        return False
+    data, weight = (_static_shape(arg.checked_type) for arg in dense.args[:2])
+    if data is None or weight is None or len(data) != 2:
+        return False
+    N, K = weight
+    quant = (_find_calls(call, "qnn.requantize") or _find_calls(call, "qnn.dequantize"))[0]
+    scale = quant.args[1]
+    if not isinstance(scale, relay.Constant) or scale.data.numpy().size not in (1, N):
+        return False
+    if not _is_zero(quant.args[2]) or int(quant.attrs.axis) not in (-1, 1):
+        return False
+    if quant.op.name == "qnn.requantize":
+        if any(arg.data.numpy().size != 1 for arg in quant.args[3:]):
+            return False
+        if str(quant.attrs.rounding) not in ("None", "UPWARD", "TONEAREST"):
+            return False
+    if call.checked_type.dtype not in ("int8", "uint8", "float16", "float32"):
+        return False
+    return K % 16 == 0 and N % 16 == 0 and _check_bias(call, N, "int32")
+
+
+def check_attention(call):
+    """float16 attention of static shapes, the keys a multiple of the K block, since a partial
+    block would enter the softmax with zero scores."""
+    first, second = _find_calls(call, "nn.batch_matmul")
+    if first.attrs.transpose_a or not first.attrs.transpose_b or second.attrs.transpose_a:
+        return False
+    if int(_find_calls(call, "nn.softmax")[0].attrs.axis) not in (-1, 2):
+        return False
+    if not _all_float16(list(first.args) + [second.args[1], second]):
+        return False
+    q, k = (_static_shape(arg.checked_type) for arg in first.args)
+    v = _static_shape(second.args[1].checked_type)
+    if q is None or k is None or v is None:
+        return False
+    for scale in _find_calls(call, "multiply") + _find_calls(call, "divide"):
+        if scale.args[1].data.numpy().size != 1:
+            return False
+    # the batch of q, k and v are the heads of the same blocks of the kernel
+    if not q[0] == k[0] == v[0]:
+        return False
+    dim = q[2]
+    v_dim = v[1] if second.attrs.transpose_b else v[2]
+    seq_k = v[2] if second.attrs.transpose_b else v[1]
+    return dim == v_dim and seq_k == k[1] and dim % 16 == 0 and dim <= 256 and k[1] % 64 == 0
+
+
+@tvm._ffi.register_func("relay.ext.tl.check_attention")
+def _check_outlined_attention(call):
+    """The attention outlined by FuseOps with relay.FuseOps.attention_compiler set to "tl"."""
+    return check_attention(call)
+
+
+def _uniform(values):
+    return len(set(int(x) for x in values)) == 1
+
+
+def check_conv2d(call):
+    """float16 NHWC / HWIO conv2d of static shapes, with the same stride, dilation and padding in
+    both dims."""
+    conv2d = _find_calls(call, "nn.conv2d")[0]
+    attrs = conv2d.attrs
+    if attrs.data_layout != "NHWC" or attrs.kernel_layout != "HWIO" or int(attrs.groups) != 1:
+        return False
+    if not _all_float16(list(conv2d.args) + [conv2d]):
+        return False
+    data, weight = (_static_shape(arg.checked_type) for arg in conv2d.args)
+    if data is None or weight is None:
+        return False
+    if not (_uniform(attrs.padding) and _uniform(attrs.strides) and _uniform(attrs.dilation)):
+        return False
+    return data[3] % 8 == 0 and weight[3] % 8 == 0 and _check_bias(call, weight[3])
+
+
+@register_pattern_table("tl")
+def pattern_table():
+    """The name, dataflow pattern and predicate of the patterns offloaded to TL, the larger
+    fusions first."""
+    return [
+        ("tl.attention", make_attention_pattern(), check_attention),
+        ("tl.dense_bias_relu", make_dense_pattern(True, True), check_dense),
+        ("tl.dense_bias", make_dense_pattern(True, False), check_dense),
+        ("tl.dense", make_dense_pattern(), check_dense),
+        ("tl.dense_fp8", make_dense_fp8_pattern(), check_dense_fp8),
+        ("tl.qnn_dense_bias", make_qnn_dense_pattern(True), check_qnn_dense),
+        ("tl.qnn_dense", make_qnn_dense_pattern(), check_qnn_dense),
+        ("tl.qnn_dense_bias_dequantize", make_qnn_dense_pattern(True, True), check_qnn_dense),
+        ("tl.qnn_dense_dequantize", make_qnn_dense_pattern(False, True), check_qnn_dense),
+        ("tl.conv2d_bias_relu", make_conv2d_pattern(True, True), check_conv2d),
+        ("tl.conv2d_bias", make_conv2d_pattern(True, False), check_conv2d),
+        ("tl.conv2d", make_conv2d_pattern(), check_conv2d),
+    ]
+
+
+def _dense_blocks(M, N, dtype):
+    """The block sizes of the TL gemm of a dense, the K block of 64 bytes."""
+    block_M = 128 if M % 128 == 0 else 64
+    block_N = 128 if N % 128 == 0 else 64
+    block_K = 64 if dtype in ("e4m3_float8", "e5m2_float8", "int8") else 32
+    return block_M, block_N, block_K
+
+
+def _dense_weight_layout(composite):
+    """The tiled layout of the weight of a dense, see pack_tl_weights."""
+    dense = (_find_calls(composite.body, "nn.dense") or _find_calls(composite.body, "qnn.dense"))[0]
+    M, K = _static_shape(dense.args[0].checked_type)
+    N = _static_shape(dense.args[1].checked_type)[0]
+    _, block_N, block_K = _dense_blocks(M, N, dense.args[1].checked_type.dtype)
+    if N % block_N or K % block_K:
+        return None
+    return 1, block_N, block_K
+
+
+# The composites whose kernels prefer a packed weight: the index of the weight param and the
+# block sizes of its tiles along its two axes, or None when it can not be packed.
+_WEIGHT_LAYOUTS = {
+    "tl.dense_bias_relu": _dense_weight_layout,
+    "tl.dense_bias": _dense_weight_layout,
+    "tl.dense": _dense_weight_layout,
+    "tl.dense_fp8": _dense_weight_layout,
+    "tl.qnn_dense_bias": _dense_weight_layout,
+    "tl.qnn_dense": _dense_weight_layout,
+    "tl.qnn_dense_bias_dequantize": _dense_weight_layout,
+    "tl.qnn_dense_dequantize": _dense_weight_layout,
+}
+
+
+def _is_packed(composite):
+    return "TLPackedWeight" in composite.attrs.keys()
+
+
+def pack_tl_weights(mod):
+    """Pack the constant weights of the TL composites into the tiled layout their kernels prefer.
+
+    A weight [N, K] of blocks [block_N, block_K] becomes [N / block_N, K / block_K, block_N,
+    block_K], each tile of the mainloop a contiguous block copied to the shared memory by 128 bit
+    loads. The packing is a reshape and transpose of the constant, folded at compile time by
+    FoldConstant, and the composite unpacks it back so that its body keeps the semantics of the
+    pattern. The composite is marked with the TLPackedWeight attr read by its TL program.
+    """
+
+    class Packer(relay.ExprMutator):
+        """Rewrite the calls of the composites with a constant weight."""
+
+        def visit_call(self, call):
+            composite = call.op
+            if not isinstance(composite, relay.Function) or "Composite" not in composite.attrs:
+                return super().visit_call(call)
+            layout = _WEIGHT_LAYOUTS.get(str(composite.attrs["Composite"]))
+            tiles = layout(composite) if layout and not _is_packed(composite) else None
+            if tiles is None:
+                return super().visit_call(call)
+            index, block_N, block_K = tiles
+            weight = call.args[index]
+            if not isinstance(weight, relay.Constant):
+                return super().visit_call(call)
+            N, K = _static_shape(composite.params[index].checked_type)
+            tiled = [N // block_N, block_N, K // block_K, block_K]
+            packed = relay.transpose(relay.reshape(weight, tiled), [0, 2, 1, 3])
+            param = composite.params[index]
+            packed_param = relay.var(
+                param.name_hint,
+                shape=[N // block_N, K // block_K, block_N, block_K],
+                dtype=param.checked_type.dtype,
+            )
+            unpacked = relay.reshape(relay.transpose(packed_param, [0, 2, 1, 3]), [N, K])
+            params = list(composite.params)
+            params[index] = packed_param
+            body = relay.bind(composite.body, {param: unpacked})
+            new_composite = relay.Function(params, body, attrs=composite.attrs).with_attr(
+                "TLPackedWeight", 1
+            )
+            args = [self.visit(arg) for arg in call.args]
+            args[index] = packed
+            return relay.Call(new_composite, args, call.attrs, call.type_args, call.span)
+
+    mod["main"] = Packer().visit(mod["main"])
+    return Sequential([transform.InferType(), transform.FoldConstant()])(mod)
+
+
+_PARALLEL_DENSES = ("tl.dense_bias_relu", "tl.dense_bias", "tl.dense")
+
+
+def fuse_parallel_tl_dense(mod, min_num_branches=2):
+    """Fuse the TL dense composites reading the same input, e.g. the q, k and v projections or
+    the gate and up projections of a gated MLP, into a tl.dense_parallel composite returning the
+    tuple of their outputs.
+
+    Its single kernel splits its blocks between the dense slices, each running its own epilogue
+    and storing into its own output, where CombineParallelDense concatenates the weights then
+    splits the output back with strided slices. The slices are grouped by input, K and block
+    sizes, their weights and biases being constants or params.
+    """
+
+    def key(call):
+        composite = call.op
+        if not isinstance(composite, relay.Function) or "Composite" not in composite.attrs:
+            return None
+        if str(composite.attrs["Composite"]) not in _PARALLEL_DENSES:
+            return None
+        if not all(isinstance(arg, (relay.Constant, relay.Var)) for arg in call.args[1:]):
+            return None
+        dense = _DenseSlice(composite)
+        if dense.N % dense.blocks[1]:
+            return None
+        return (call.args[0], dense.K, dense.blocks)
+
+    groups = {}
+
+    def visit(node):
+        if isinstance(node, relay.Call):
+            group = key(node)
+            if group is not None:
+                groups.setdefault(group, []).append(node)
+
+    relay.analysis.post_order_visit(mod["main"], visit)
+    groups = [calls for calls in groups.values() if len(calls) >= min_num_branches]
+    if not groups:
+        return mod
+
+    class Fuser(relay.ExprMutator):
+        """Replace the calls of a group by the fields of their tl.dense_parallel call."""
+
+        def __init__(self):
+            super().__init__()
+            self.slices = {call: (i, calls) for calls in groups for i, call in enumerate(calls)}
+            self.fused = {}
+
+        def fuse(self, calls):
+            data = relay.var("data", calls[0].args[0].checked_type)
+            params, fields, args = [data], [], [self.visit(calls[0].args[0])]
+            for call in calls:
+                slice_params = [
+                    relay.var(param.name_hint, param.checked_type) for param in call.op.params[1:]
+                ]
+                fields.append(relay.Call(call.op, [data] + slice_params))
+                params += slice_params
+                args += [self.visit(arg) for arg in call.args[1:]]
+            fused = relay.Function(params, relay.Tuple(fields))
+            return relay.Call(fused.with_attr("Composite", "tl.dense_parallel"), args)
+
+        def visit_call(self, call):
+            if call not in self.slices:
+                return super().visit_call(call)
+            index, calls = self.slices[call]
+            if id(calls) not in self.fused:
+                self.fused[id(calls)] = self.fuse(calls)
+            return relay.TupleGetItem(self.fused[id(calls)], index)
+
+    mod["main"] = Fuser().visit(mod["main"])
+    return transform.InferType()(mod)
+
+
+def partition_for_tl(mod, params=None, pack_weights=True, fuse_parallel=True):
+    """Partition the module into the subgraphs of the TL patterns, each compiled by the "tl"
+    external codegen. With pack_weights the constant weights are packed in the layout their
+    kernels prefer, see pack_tl_weights, with fuse_parallel the dense reading the same input
+    share a kernel, see fuse_parallel_tl_dense."""
+    if params is not None:
+        mod["main"] = bind_params_by_name(mod["main"], params)
+        with PassContext(opt_level=3):
+            mod = Sequential(
+                [
+                    transform.InferType(),
+                    transform.SimplifyInference(),
+                    transform.FoldConstant(),
+                    transform.FoldScaleAxis(),
+                ]
+            )(mod)
+
+    mod = Sequential([transform.InferType(), transform.MergeComposite(pattern_table())])(mod)
+    if pack_weights:
+        mod = pack_tl_weights(mod)
+    if fuse_parallel:
+        mod = fuse_parallel_tl_dense(mod)
+    seq = Sequential(
+        [
+            transform.AnnotateTarget(["tl"], include_non_call_ops=False),
+            transform.PartitionGraph(bind_constants=False),
+        ]
+    )
+    return seq(mod)
+
+
+class _Weight:
+    """The B operand [N, K] of a dense, in the tiled layout of pack_tl_weights or not."""
+
+    def __init__(self, composite, N, K, block_N, block_K):
+        self.packed = _is_packed(composite)
+        self.N, self.K, self.block_N, self.block_K = N, K, block_N, block_K
+
+    @property
+    def shape(self):
+        """The shape of the param."""
+        if self.packed:
+            return (self.N // self.block_N, self.K // self.block_K, self.block_N, self.block_K)
+        return (self.N, self.K)
+
+    def rows(self, B):
+        """A 2D view of the param whose tiles are copied by tile."""
+        from tvm.tl import language as T
+
+        if self.packed:
+            return T.Buffer((self.N * self.K // self.block_K, self.block_K), B.dtype, B.data)
+        return B
+
+    def tile(self, B_rows, bx, k):
+        """The origin of the tile (bx, k) in the 2D view, a contiguous block once packed."""
+        if self.packed:
+            return B_rows[(bx * (self.K // self.block_K) + k) * self.block_N, 0]
+        return B_rows[bx * self.block_N, k * self.block_K]
+
+
+def _bias_value(bias, channel, channels, accum_dtype):
+    """The bias of the channel in the accumulator dtype, 0 past the channels of the last partial
+    block of the output."""
+    from tvm.tl import language as T
+
+    value = T.cast(bias[channel], accum_dtype)
+    return T.if_then_else(channel < channels, value, T.cast(0, accum_dtype))
+
+
+class _DenseSlice:
+    """The TL gemm of a dense composite emitted into the TL programs by the IR builder: the
+    mainloop over K of the block (bx, by) of the output, the bias and relu of its epilogue, then
+    its store."""
+
+    def __init__(self, composite):
+        dense = _find_calls(composite.body, "nn.dense")[0]
+        M, K = _static_shape(dense.args[0].checked_type)
+        N = _static_shape(dense.args[1].checked_type)[0]
+        dtype, accum_dtype = "float16", "float32"
+        block_M, block_N, block_K = _dense_blocks(M, N, dtype)
+        self.M, self.N, self.K = M, N, K
+        self.dtype, self.accum_dtype = dtype, accum_dtype
+        self.blocks = (block_M, block_N, block_K)
+        self.weight = _Weight(composite, N, K, block_N, block_K)
+        self.with_relu = bool(_find_calls(composite.body, "nn.relu"))
+        with_bias = len(composite.params) == 3
+        self.bias_shape = _static_shape(composite.params[2].checked_type) if with_bias else None
+
+    def emit(self, A, B, Bias, C, A_shared, B_shared, C_local, bx, by):
+        """Emit the statements of the block (bx, by) into the current frame, within a parsed
+        prim_func or a function under construction by the IR builder."""
+        from tvm.tl import language as T
+
+        N, K, dtype, accum_dtype = self.N, self.K, self.dtype, self.accum_dtype
+        block_M, block_N, block_K = self.blocks
+        B_rows = self.weight.rows(B)
+        T.evaluate(T.clear(C_local))
+        with T.Pipelined(T.ceildiv(K, block_K), num_stages=3) as k:
+            T.evaluate(T.copy(A[by * block_M, k * block_K], A_shared))
+            T.evaluate(T.copy(self.weight.tile(B_rows, bx, k), B_shared))
+            T.evaluate(T.gemm(A_shared, B_shared, C_local, transpose_B=True))
+        if self.bias_shape is not None:
+            bias = T.Buffer((N,), dtype, Bias.data)
+            with T.Parallel(block_M, block_N) as (i, j):
+                value = C_local[i, j] + _bias_value(bias, bx * block_N + j, N, accum_dtype)
+                if self.with_relu:
+                    value = T.max(value, T.float32(0))
+                T.buffer_store(C_local, value, [i, j])
+        T.evaluate(T.copy(C_local, C[by * block_M, bx * block_N]))
+
+
+def _dense_program(composite):
+    """The TL gemm of the dense of A [M, K] and B [N, K], the bias and relu in its epilogue."""
+    from tvm.tl import language as T
+
+    dense = _DenseSlice(composite)
+    M, N, K = dense.M, dense.N, dense.K
+    dtype, accum_dtype = dense.dtype, dense.accum_dtype
+    block_M, block_N, block_K = dense.blocks
+
+    if dense.bias_shape is None:
+
+        @T.prim_func
+        def main(
+            A: T.Buffer((M, K), dtype),
+            B: T.Buffer(dense.weight.shape, dtype),
+            C: T.Buffer((M, N), dtype),
+        ):
+            with T.Kernel(T.ceildiv(N, block_N), T.ceildiv(M, block_M), threads=128) as (bx, by):
+                A_shared = T.alloc_shared((block_M, block_K), dtype)
+                B_shared = T.alloc_shared((block_N, block_K), dtype)
+                C_local = T.alloc_fragment((block_M, block_N), accum_dtype)
+                dense.emit(A, B, None, C, A_shared, B_shared, C_local, bx, by)
+
+        return main
+
+    @T.prim_func
+    def main_bias(
+        A: T.Buffer((M, K), dtype),
+        B: T.Buffer(dense.weight.shape, dtype),
+        Bias: T.Buffer(dense.bias_shape, dtype),
+        C: T.Buffer((M, N), dtype),
+    ):
+        with T.Kernel(T.ceildiv(N, block_N), T.ceildiv(M, block_M), threads=128) as (bx, by):
+            A_shared = T.alloc_shared((block_M, block_K), dtype)
+            B_shared = T.alloc_shared((block_N, block_K), dtype)
+            C_local = T.alloc_fragment((block_M, block_N), accum_dtype)
+            dense.emit(A, B, Bias, C, A_shared, B_shared, C_local, bx, by)
+
+    return main_bias
+
+
+def _dense_parallel_program(composite):
+    """The single TL kernel of a tl.dense_parallel: the blocks along x are split between its
+    dense slices, each running its own epilogue and storing into its own output. The program is
+    built by the IR builder since its params depend on the number of slices."""
+    from tvm.script.ir_builder import IRBuilder
+    from tvm.script.ir_builder import tir as I
+    from tvm.tl import language as T
+
+    slices = [_DenseSlice(call.op) for call in composite.body.fields]
+    first = slices[0]
+    block_M, block_N, block_K = first.blocks
+    dtype, accum_dtype = first.dtype, first.accum_dtype
+    ends = []
+    for dense in slices:
+        ends.append((ends[-1] if ends else 0) + dense.N // block_N)
+
+    with IRBuilder() as builder:
+        with I.prim_func():
+            I.func_name("main")
+            A = I.arg("A", I.buffer((first.M, first.K), dtype))
+            weights = []
+            for i, dense in enumerate(slices):
+                B = I.arg(f"B{i}", I.buffer(dense.weight.shape, dtype))
+                Bias = None
+                if dense.bias_shape is not None:
+                    Bias = I.arg(f"Bias{i}", I.buffer(dense.bias_shape, dtype))
+                weights.append((B, Bias))
+            outputs = [
+                I.arg(f"C{i}", I.buffer((dense.M, dense.N), dtype))
+                for i, dense in enumerate(slices)
+            ]
+            grid_y = (first.M + block_M - 1) // block_M
+            with T.Kernel(ends[-1], grid_y, threads=128) as (bx, by):
+                A_shared = T.alloc_shared((block_M, block_K), dtype)
+                B_shared = T.alloc_shared((block_N, block_K), dtype)
+                C_local = T.alloc_fragment((block_M, block_N), accum_dtype)
+
+                def emit_slice(i):
+                    B, Bias = weights[i]
+                    start = ends[i - 1] if i else 0
+                    args = (A_shared, B_shared, C_local, bx - start, by)
+                    if i + 1 == len(slices):
+                        slices[i].emit(A, B, Bias, outputs[i], *args)
+                        return
+                    with I.If(bx < ends[i]):
+                        with I.Then():
+                            slices[i].emit(A, B, Bias, outputs[i], *args)
+                        with I.Else():
+                            emit_slice(i + 1)
+
+                emit_slice(0)
+    return builder.get()
+
+
+def _dense_fp8_program(composite):
+    """The TL fp8 gemm of the dense of A [M, K] and B [N, K], the K-major operands of the fp8
+    mma, the dequantization scale and the float16 cast in its epilogue."""
+    from tvm.tl import language as T
+
+    dense = _find_calls(composite.body, "nn.dense")[0]
+    M, K = _static_shape(dense.args[0].checked_type)
+    N = _static_shape(dense.args[1].checked_type)[0]
+    a_dtype, b_dtype = (arg.checked_type.dtype for arg in dense.args)
+    scale = float(_find_calls(composite.body, "multiply")[0].args[1].data.numpy().item())
+    dtype, accum_dtype = "float16", "float32"
+    block_M, block_N, block_K = _dense_blocks(M, N, b_dtype)
+    weight = _Weight(composite, N, K, block_N, block_K)
+
+    @T.prim_func
+    def main(
+        A: T.Buffer((M, K), a_dtype),
+        B: T.Buffer(weight.shape, b_dtype),
+        C: T.Buffer((M, N), dtype),
+    ):
+        with T.Kernel(T.ceildiv(N, block_N), T.ceildiv(M, block_M), threads=128) as (bx, by):
+            A_shared = T.alloc_shared((block_M, block_K), a_dtype)
+            B_shared = T.alloc_shared((block_N, block_K), b_dtype)
+            C_local = T.alloc_fragment((block_M, block_N), accum_dtype)
+            B_rows = weight.rows(B)
+            T.clear(C_local)
+            for k in T.Pipelined(T.ceildiv(K, block_K), num_stages=3):
+                T.copy(A[by * block_M, k * block_K], A_shared)
+                T.copy(weight.tile(B_rows, bx, k), B_shared)
+                T.gemm(A_shared, B_shared, C_local, transpose_B=True)
+            T.copy(
+                C_local,
+                C[by * block_M, bx * block_N],
+                epilogue=[T.quantize(dtype, T.float32(scale))],
+            )
+
+    return main
+
+
+def _qnn_dense_program(composite):
+    """The TL int8 gemm of the qnn.dense of A [M, K] and B [N, K] accumulated in int32, the bias
+    and T.requantize in its epilogue: the scale of the accumulator (per-channel scales are loaded
+    once per tile) over the output scale, then the rounding, zero point and saturating cast to
+    int8 of qnn.requantize, or the cast to float of qnn.dequantize."""
+    from tvm.tl import language as T
+
+    body = composite.body
+    dense = _find_calls(body, "qnn.dense")[0]
+    quant = (_find_calls(body, "qnn.requantize") or _find_calls(body, "qnn.dequantize"))[0]
+    M, K = _static_shape(dense.args[0].checked_type)
+    N = _static_shape(dense.args[1].checked_type)[0]
+    with_bias = bool(_find_calls(body, "add") + _find_calls(body, "nn.bias_add"))
+    scale_shape = _static_shape(composite.params[-1].checked_type)
+    scale_size = scale_shape[0] if scale_shape else 1
+    out_dtype = body.checked_type.dtype
+    inv_scale, zero_point, rounding = 1.0, 0, "TONEAREST"
+    if quant.op.name == "qnn.requantize":
+        inv_scale = 1.0 / float(quant.args[3].data.numpy().item())
+        zero_point = int(quant.args[4].data.numpy().item())
+        rounding = "UPWARD" if str(quant.attrs.rounding) == "None" else str(quant.attrs.rounding)
+    dtype, accum_dtype = "int8", "int32"
+    block_M, block_N, block_K = _dense_blocks(M, N, dtype)
+    weight = _Weight(composite, N, K, block_N, block_K)
+
+    def epilogue(bias, scale, bx):
+        ops = [T.bias_add(bias[bx * block_N : (bx + 1) * block_N])] if with_bias else []
+        per_channel = scale[bx * block_N : (bx + 1) * block_N] if scale_size > 1 else scale[0]
+        scales = [per_channel, T.float32(inv_scale)]
+        return ops + [T.requantize(out_dtype, scales, zero_point, rounding=rounding)]
+
+    @T.macro
+    def run(A, B, bias, scale, C, bx, by):
+        A_shared = T.alloc_shared((block_M, block_K), dtype)
+        B_shared = T.alloc_shared((block_N, block_K), dtype)
+        C_local = T.alloc_fragment((block_M, block_N), accum_dtype)
+        B_rows = weight.rows(B)
+        T.clear(C_local)
+        for k in T.Pipelined(T.ceildiv(K, block_K), num_stages=3):
+            T.copy(A[by * block_M, k * block_K], A_shared)
+            T.copy(weight.tile(B_rows, bx, k), B_shared)
+            T.gemm(A_shared, B_shared, C_local, transpose_B=True)
+        T.copy(C_local, C[by * block_M, bx * block_N], epilogue=epilogue(bias, scale, bx))
+
+    if not with_bias:
+
+        @T.prim_func
+        def main(
+            A: T.Buffer((M, K), dtype),
+            B: T.Buffer(weight.shape, dtype),
+            Scale: T.Buffer(scale_shape, "float32"),
+            C: T.Buffer((M, N), out_dtype),
+        ):
+            with T.Kernel(T.ceildiv(N, block_N), T.ceildiv(M, block_M), threads=128) as (bx, by):
+                scale = T.Buffer((scale_size,), "float32", Scale.data)
+                run(A, B, None, scale, C, bx, by)
+
+        return main
+
+    bias_shape = _static_shape(composite.params[2].checked_type)
+
+    @T.prim_func
+    def main_bias(
+        A: T.Buffer((M, K), dtype),
+        B: T.Buffer(weight.shape, dtype),
+        Bias: T.Buffer(bias_shape, accum_dtype),
+        Scale: T.Buffer(scale_shape, "float32"),
+        C: T.Buffer((M, N), out_dtype),
+    ):
+        with T.Kernel(T.ceildiv(N, block_N), T.ceildiv(M, block_M), threads=128) as (bx, by):
+            bias = T.Buffer((N,), accum_dtype, Bias.data)
+            scale = T.Buffer((scale_size,), "float32", Scale.data)
+            run(A, B, bias, scale, C, bx, by)
+
+    return main_bias
+
+
+def _attention_program(composite):
+    """The flash attention of q [BH, Sq, D], k [BH, Sk, D] and v [BH, Sk, D] (or [BH, D, Sk]
+    if transposed), like tl_scripts/mha_example.py."""
+    from tvm.tl import language as T
+
+    first, second = _find_calls(composite.body, "nn.batch_matmul")
+    BH, seq_q, dim = _static_shape(first.args[0].checked_type)
+    seq_k = _static_shape(first.args[1].checked_type)[1]
+    trans_V = bool(second.attrs.transpose_b)
+    v_shape = (BH, dim, seq_k) if trans_V else (BH, seq_k, dim)
+    sm_scale = 1.0
+    for scale in _find_calls(composite.body, "multiply"):
+        sm_scale *= float(scale.args[1].data.numpy().item())
+    for scale in _find_calls(composite.body, "divide"):
+        sm_scale /= float(scale.args[1].data.numpy().item())
+    dtype, accum_dtype = "float16", "float32"
+    block_M = 64
+    block_N = 64 if dim <= 128 else 32
+
+    @T.prim_func
+    def main(
+        Q: T.Buffer((BH, seq_q, dim), dtype),
+        K: T.Buffer((BH, seq_k, dim), dtype),
+        V: T.Buffer(v_shape, dtype),
+        Output: T.Buffer((BH, seq_q, dim), dtype),
+    ):
+        with T.Kernel(T.ceildiv(seq_q, block_M), BH, threads=128) as (bx, by):
+            Q_shared = T.alloc_shared([block_M, dim], dtype)
+            K_shared = T.alloc_shared([block_N, dim], dtype)
+            V_shared = T.alloc_shared([dim, block_N] if trans_V else [block_N, dim], dtype)
+            acc_s = T.alloc_fragment([block_M, block_N], accum_dtype)
+            acc_s_cast = T.alloc_fragment([block_M, block_N], dtype)
+            acc_o = T.alloc_fragment([block_M, dim], accum_dtype)
+            scores_max = T.alloc_fragment([block_M], accum_dtype)
+            logsum = T.alloc_fragment([block_M], accum_dtype)
+
+            T.copy(Q[by, bx * block_M : (bx + 1) * block_M, :], Q_shared)
+            T.fill(acc_o, 0)
+            T.fill(logsum, 0)
+            T.fill(scores_max, -T.infinity(accum_dtype))
+            for k in T.Pipelined(T.ceildiv(seq_k, block_N), num_stages=1):
+                T.copy(K[by, k * block_N : (k + 1) * block_N, :], K_shared)
+                T.clear(acc_s)
+                T.gemm(Q_shared, K_shared, acc_s, transpose_B=True, policy=T.GemmWarpPolicy.FullRow)
+                if trans_V:
+                    T.copy(V[by, :, k * block_N : (k + 1) * block_N], V_shared)
+                else:
+                    T.copy(V[by, k * block_N : (k + 1) * block_N, :], V_shared)
+                T.online_softmax(acc_s, scores_max, logsum, acc_o, sm_scale)
+                T.copy(acc_s, acc_s_cast)
+                T.gemm(
+                    acc_s_cast,
+                    V_shared,
+                    acc_o,
+                    transpose_B=trans_V,
+                    policy=T.GemmWarpPolicy.FullRow,
+                )
+            for i, j in T.Parallel(block_M, dim):
+                acc_o[i, j] /= logsum[i]
+            T.copy(acc_o, Output[by, bx * block_M : (bx + 1) * block_M, :])
+
+    return main
+
+
+def _conv2d_program(composite):
+    """The implicit gemm of the NHWC / HWIO conv2d of tl_scripts/conv_example.py, the bias and relu
+    in its epilogue."""
+    from tvm.tl import language as T
+
+    conv2d = _find_calls(composite.body, "nn.conv2d")[0]
+    data_shape = _static_shape(conv2d.args[0].checked_type)
+    KH, KW, INC, C = _static_shape(conv2d.args[1].checked_type)
+    N, H, W, _ = _static_shape(conv2d.checked_type)
+    S, P, D = (int(getattr(conv2d.attrs, key)[0]) for key in ("strides", "padding", "dilation"))
+    with_relu = bool(_find_calls(composite.body, "nn.relu"))
+    dtype, accum_dtype = "float16", "float32"
+    block_M = 128
+    block_N = 128 if C % 128 == 0 else 64
+    block_K = 32
+
+    @T.macro
+    def mainloop(data, kernel, out_local, bx, by):
+        data_shared = T.alloc_shared((block_M, block_K), dtype)
+        kernel_shared = T.alloc_shared((block_K, block_N), dtype)
+        kernel_flat = T.Buffer((KH * KW * INC, C), dtype, kernel.data)
+        T.clear(out_local)
+        for k_iter in T.Pipelined(T.ceildiv(KH * KW * INC, block_K), num_stages=3):
+            T.im2col_copy(
+                data,
+                data_shared,
+                by * block_M,
+                k_iter * block_K,
+                (H, W),
+                (KH, KW),
+                stride=S,
+                padding=P,
+                dilation=D,
+            )
+            T.copy(kernel_flat[k_iter * block_K, bx * block_N], kernel_shared)
+            T.gemm(data_shared, kernel_shared, out_local)
+
+    @T.macro
+    def epilogue(out_local, bias, bx):
+        for i, j in T.Parallel(block_M, block_N):
+            if with_relu:
+                out_local[i, j] = T.max(
+                    out_local[i, j] + _bias_value(bias, bx * block_N + j, C, accum_dtype),
+                    T.float32(0),
+                )
+            else:
+                out_local[i, j] = out_local[i, j] + _bias_value(
+                    bias, bx * block_N + j, C, accum_dtype
+                )
+
+    grid = (T.ceildiv(C, block_N), T.ceildiv(N * H * W, block_M))
+
+    if len(composite.params) == 2:
+
+        @T.prim_func
+        def main(
+            data: T.Buffer(data_shape, dtype),
+            kernel: T.Buffer((KH, KW, INC, C), dtype),
+            out: T.Buffer((N, H, W, C), dtype),
+        ):
+            with T.Kernel(*grid, threads=128) as (bx, by):
+                out_local = T.alloc_fragment((block_M, block_N), accum_dtype)
+                out_flat = T.Buffer((N * H * W, C), dtype, out.data)
+                mainloop(data, kernel, out_local, bx, by)
+                T.copy(out_local, out_flat[by * block_M, bx * block_N])
+
+        return main
+
+    bias_shape = _static_shape(composite.params[2].checked_type)
+
+    @T.prim_func
+    def main_bias(
+        data: T.Buffer(data_shape, dtype),
+        kernel: T.Buffer((KH, KW, INC, C), dtype),
+        Bias: T.Buffer(bias_shape, dtype),
+        out: T.Buffer((N, H, W, C), dtype),
+    ):
+        with T.Kernel(*grid, threads=128) as (bx, by):
+            out_local = T.alloc_fragment((block_M, block_N), accum_dtype)
+            out_flat = T.Buffer((N * H * W, C), dtype, out.data)
+            bias = T.Buffer((C,), dtype, Bias.data)
+            mainloop(data, kernel, out_local, bx, by)
+            epilogue(out_local, bias, bx)
+            T.copy(out_local, out_flat[by * block_M, bx * block_N])
+
+    return main_bias
+
+
+_PROGRAMS = {
+    "tl.attention": _attention_program,
+    "tl.dense_bias_relu": _dense_program,
+    "tl.dense_bias": _dense_program,
+    "tl.dense": _dense_program,
+    "tl.dense_parallel": _dense_parallel_program,
+    "tl.dense_fp8": _dense_fp8_program,
+    "tl.qnn_dense_bias": _qnn_dense_program,
+    "tl.qnn_dense": _qnn_dense_program,
+    "tl.qnn_dense_bias_dequantize": _qnn_dense_program,
+    "tl.qnn_dense_dequantize": _qnn_dense_program,
+    "tl.conv2d_bias_relu": _conv2d_program,
+    "tl.conv2d_bias": _conv2d_program,
+    "tl.conv2d": _conv2d_program,
+}
+
+
+@tvm._ffi.register_func("relay.ext.tl")
+def tl_compiler(func):
+    """Compile a partition of the "tl" codegen, a call of one composite function, to the TL
+    program of its pattern, named by the global symbol of the partition. Its parameters are the
+    ones of the composite function then the output, the order of the external call."""
+    from tvm.tl import lower
+
+    symbol = str(func.attrs.global_symbol)
+    call = func.body
+    if not (isinstance(call, relay.Call) and isinstance(call.op, relay.Function)):
+        raise ValueError("A TL partition should call a composite function: " + str(func))
+    if len(call.args) != len(func.params) or not all(
+        arg.same_as(param) for arg, param in zip(call.args, func.params)
+    ):
+        raise ValueError("The arguments of the composite function of " + symbol + " are reordered")
+    composite = call.op
+    program = _PROGRAMS[str(composite.attrs["Composite"])](composite)
+    target = tvm.target.Target.current(allow_none=True)
+    if target is None or target.kind.name not in ("cuda", "rocm"):
+        target = "cuda"
+    rt_mod, _ = lower(program.with_attr("global_symbol", symbol), target=target)
+    return rt_mod
@@ -146,6 +146,10 @@ reg.register_strategy("nn.batch_matmul", strategy.batch_matmul_strategy)
 reg.register_strategy("nn.batch_norm", strategy.batch_norm_strategy)
 
 
+# layer_norm, decomposed by SimplifyInference unless the pass is disabled
+reg.register_strategy("nn.layer_norm", strategy.layer_norm_strategy)
+
+
 # sparse_dense
 @reg.register_compute("nn.sparse_dense")
 def compute_sparse_dense(attrs, inputs, out_type):
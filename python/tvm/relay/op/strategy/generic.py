@@ -958,6 +958,32 @@ def batch_norm_strategy(attrs, inputs, out_type, target):
     return strategy
 
 
+# layer_norm
+def wrap_compute_layer_norm(topi_compute):
+    """wrap layer_norm topi compute"""
+
+    def _compute_layer_norm(attrs, inputs, out_type):
+        data, gamma, beta = inputs
+        gamma = gamma if attrs.scale else None
+        beta = beta if attrs.center else None
+        return [topi_compute(data, gamma, beta, [attrs.axis], attrs.epsilon)]
+
+    return _compute_layer_norm
+
+
+@override_native_generic_func("layer_norm_strategy")
+def layer_norm_strategy(attrs, inputs, out_type, target):
+    """layer_norm generic strategy"""
+    logger.warning("layer_norm is not optimized for this platform.")
+    strategy = _op.OpStrategy()
+    strategy.add_implementation(
+        wrap_compute_layer_norm(topi.nn.layer_norm),
+        wrap_topi_schedule(topi.generic.schedule_injective),
+        name="layer_norm.generic",
+    )
+    return strategy
+
+
 # sparse dense
 def wrap_compute_sparse_dense(topi_compute):
     """wrap sparse dense topi compute"""
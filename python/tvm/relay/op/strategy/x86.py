@@ -71,6 +71,13 @@ def softmax_strategy_cpu(attrs, inputs, out_type, target):
         wrap_topi_schedule(topi.x86.schedule_softmax),
         name="softmax.x86",
     )
+    if topi.x86.simd_row_supported(inputs[0], attrs.get_int("axis")):
+        strategy.add_implementation(
+            wrap_compute_softmax(topi.x86.softmax_simd),
+            wrap_topi_schedule(topi.x86.schedule_simd_row),
+            name="softmax_simd.x86",
+            plevel=11,
+        )
     return strategy
 
 
@@ -857,3 +864,22 @@ def batch_norm_strategy_cpu(attrs, inputs, out_type, target):
         name="batch_norm.cpu",
     )
     return strategy
+
+
+@layer_norm_strategy.register(["cpu"])
+def layer_norm_strategy_cpu(attrs, inputs, out_type, target):
+    """layer_norm x86 strategy"""
+    strategy = _op.OpStrategy()
+    strategy.add_implementation(
+        wrap_compute_layer_norm(topi.nn.layer_norm),
+        wrap_topi_schedule(topi.x86.schedule_injective),
+        name="layer_norm.cpu",
+    )
+    if topi.x86.simd_row_supported(inputs[0], attrs.axis, min_lanes=1):
+        strategy.add_implementation(
+            wrap_compute_layer_norm(topi.x86.layer_norm_simd),
+            wrap_topi_schedule(topi.x86.schedule_simd_row),
+            name="layer_norm_simd.x86",
+            plevel=11,
+        )
+    return strategy
@@ -19,5 +19,5 @@
 # transformation passes
 from .transform import *
 from .recast import recast
-from . import fake_quantization_to_integer, mixed_precision
+from . import fake_quantization_to_integer, mixed_precision, mixed_precision_calibration
 from .flexible_shape import FlexibleShapeDispatch
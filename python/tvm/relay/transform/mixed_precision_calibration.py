@@ -0,0 +1,372 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+# pylint: disable=import-outside-toplevel
+"""Calibrated mixed precision.
+
+The static op lists of mixed_precision.py run every dense, batch_matmul and conv in the mixed
+precision type. Here the error of each of these ops is instead measured on sample data, for each
+candidate dtype (float16, bfloat16, e4m3_float8, e5m2_float8), and the dtypes are picked per op
+to run as many of the MACs as possible in a low precision within an accuracy budget. The result
+is a plan for ToMixedPrecision, which gives the float8 ops a per-tensor scale of their args.
+
+.. code-block:: python
+
+    mod, report = to_mixed_precision_calibrated(
+        mod, dataset, params, dtypes=("float16", "e4m3_float8"), accuracy_budget=0.02
+    )
+
+The error of an op is the relative L2 error of its output when its args are rounded to the
+dtype, and its output to the dtype it produces, the accumulation being in float32 like on the
+tensor cores. The errors of the ops are summed against the budget, a proxy of the error of the
+model outputs.
+"""
+from typing import Dict, Iterable, List, Optional, Sequence
+
+import numpy as np
+
+import tvm
+from tvm import relay
+
+from .mixed_precision import MIXED_PRECISION_ALWAYS
+
+# The mantissa bits, the exponent of the smallest normal number and the largest value.
+_FORMATS = {
+    "float16": (10, -14, 65504.0),
+    "bfloat16": (7, -126, 3.3895313892515355e38),
+    "e4m3_float8": (3, -6, 448.0),
+    "e5m2_float8": (2, -14, 57344.0),
+}
+
+FLOAT8_DTYPES = ("e4m3_float8", "e5m2_float8")
+
+
+def round_to_dtype(x: np.ndarray, dtype: str) -> np.ndarray:
+    """Round to the nearest value of dtype, ties to even and saturating, returned in float32."""
+    if dtype == "float32":
+        return x.astype("float32")
+    mantissa, min_exponent, max_value = _FORMATS[dtype]
+    x = x.astype("float64")
+    _, exponent = np.frexp(x)
+    # The exponent of the leading bit, the subnormals share the one of the smallest normal.
+    step = np.ldexp(1.0, np.maximum(exponent - 1, min_exponent) - mantissa)
+    return np.clip(np.round(x / step) * step, -max_value, max_value).astype("float32")
+
+
+def _is_float32_tensor(ty):
+    return isinstance(ty, relay.TensorType) and ty.dtype == "float32"
+
+
+def _conversion_category(call, mixed_precision_type):
+    func = call.op.get_attr("FTVMMixedPrecisionConversionType")
+    if func is None:
+        return None
+    return int(func(call, mixed_precision_type)[0])
+
+
+def _macs(call) -> int:
+    """The multiply-accumulates of a dense, batch_matmul or conv, the output size otherwise."""
+    out = [int(dim) for dim in call.checked_type.shape]
+    size = int(np.prod(out))
+    shapes = [[int(dim) for dim in arg.checked_type.shape] for arg in call.args]
+    name = call.op.name
+    if name in ("nn.dense", "nn.matmul"):
+        return size * shapes[0][-1]
+    if name == "nn.batch_matmul":
+        return size * (shapes[0][-2] if call.attrs.transpose_a else shapes[0][-1])
+    if name.startswith("nn.conv"):
+        layout = str(call.attrs.kernel_layout)
+        out_channels = shapes[1][layout.index("O")] if "O" in layout else 1
+        return size * int(np.prod(shapes[1])) // max(out_channels, 1)
+    return size
+
+
+def _static(call):
+    types = [arg.checked_type for arg in call.args] + [call.checked_type]
+    return all(
+        isinstance(ty, relay.TensorType)
+        and all(isinstance(dim, tvm.tir.IntImm) for dim in ty.shape)
+        for ty in types
+    )
+
+
+def _candidates(func, mixed_precision_type):
+    """The float32 calls with static shapes which the op lists always run in low precision."""
+    calls = []
+
+    def visit(node):
+        if not isinstance(node, relay.Call) or not isinstance(node.op, tvm.ir.Op):
+            return
+        if _conversion_category(node, mixed_precision_type) != MIXED_PRECISION_ALWAYS:
+            return
+        types = [arg.checked_type for arg in node.args] + [node.checked_type]
+        if all(_is_float32_tensor(ty) for ty in types) and _static(node):
+            calls.append(node)
+
+    relay.analysis.post_order_visit(func.body, visit)
+    return calls
+
+
+def _evaluator(func, target):
+    mod = tvm.IRModule.from_expr(func)
+    return relay.create_executor("graph", mod=mod, device=tvm.cpu(0), target=target).evaluate()
+
+
+class CalibrationProfile:
+    """The errors of the candidate calls in each dtype, measured on the calibration data.
+
+    Attributes
+    ----------
+    calls : List[relay.Call]
+        The candidate calls, in post order.
+    macs : List[int]
+        The multiply-accumulates of each call.
+    errors : List[Dict[str, float]]
+        The relative error of each call in each dtype.
+    scales : List[Dict[str, List[float]]]
+        The per-tensor scale of the args of each call in each float8 dtype, their max magnitude
+        over the calibration data divided by the largest value of the dtype.
+    """
+
+    def __init__(self, calls, macs, errors, scales):
+        self.calls = calls
+        self.macs = macs
+        self.errors = errors
+        self.scales = scales
+
+
+def profile_mixed_precision(
+    func: relay.Function,
+    dataset: Iterable[Dict[str, np.ndarray]],
+    dtypes: Sequence[str] = ("float16", "e4m3_float8"),
+    mixed_precision_type: str = "float16",
+    target: str = "llvm",
+) -> CalibrationProfile:
+    """Measure the error of the candidate calls of a type inferred float32 function.
+
+    Parameters
+    ----------
+    func : relay.Function
+        The function, its params bound to constants but its inputs.
+    dataset : Iterable[Dict[str, numpy.ndarray]]
+        The calibration samples, the inputs of func by name.
+    dtypes : Sequence[str]
+        The candidate dtypes.
+    mixed_precision_type : str
+        The dtype of the outputs of the float8 calls and of the ops following the low precision
+        ones.
+    target : str
+        The target running the float32 calls.
+
+    Returns
+    -------
+    profile : CalibrationProfile
+        The errors of the candidate calls.
+    """
+    for dtype in dtypes:
+        if dtype not in _FORMATS:
+            raise ValueError(f"Unsupported mixed precision dtype {dtype}")
+    calls = _candidates(func, mixed_precision_type)
+    if not calls:
+        return CalibrationProfile([], [], [], [])
+
+    # The values read and produced by the candidates, computed once per sample in float32.
+    exprs = []
+    index = {}
+    for call in calls:
+        for expr in list(call.args) + [call]:
+            if isinstance(expr, (relay.Call, relay.TupleGetItem)) and expr not in index:
+                index[expr] = len(exprs)
+                exprs.append(expr)
+    values_of = _evaluator(relay.Function(func.params, relay.Tuple(exprs)), target)
+    samples = []
+    for inputs in dataset:
+        outputs = values_of(**inputs)
+        samples.append((inputs, [outputs[i].numpy() for i in range(len(exprs))]))
+    if not samples:
+        raise ValueError("The calibration needs at least one sample")
+
+    def value(expr, sample):
+        if isinstance(expr, relay.Constant):
+            return expr.data.numpy()
+        if isinstance(expr, relay.Var):
+            return np.asarray(sample[0][expr.name_hint], "float32")
+        return sample[1][index[expr]]
+
+    macs, errors, scales = [], [], []
+    for call in calls:
+        params = [relay.var(f"p{i}", arg.checked_type) for i, arg in enumerate(call.args)]
+        run = _evaluator(relay.Function(params, relay.Call(call.op, params, call.attrs)), target)
+        amax = [
+            max(float(np.abs(value(arg, sample)).max(initial=0)) for sample in samples)
+            for arg in call.args
+        ]
+        call_errors, call_scales = {}, {}
+        for dtype in dtypes:
+            fp8 = dtype in FLOAT8_DTYPES
+            arg_scales = (
+                [m / _FORMATS[dtype][2] if m > 0 else 1.0 for m in amax]
+                if fp8
+                else [1.0] * len(amax)
+            )
+            out_dtype = mixed_precision_type if fp8 else dtype
+            diff, norm = 0.0, 0.0
+            for sample in samples:
+                args = [
+                    round_to_dtype(value(arg, sample) / scale, dtype) * scale
+                    for arg, scale in zip(call.args, arg_scales)
+                ]
+                out = round_to_dtype(run(*args).numpy(), out_dtype)
+                ref = value(call, sample)
+                diff += float(np.sum(np.square(out.astype("float64") - ref)))
+                norm += float(np.sum(np.square(ref.astype("float64"))))
+            call_errors[dtype] = float(np.sqrt(diff / norm)) if norm > 0 else 0.0
+            if fp8:
+                call_scales[dtype] = arg_scales
+        macs.append(_macs(call))
+        errors.append(call_errors)
+        scales.append(call_scales)
+    return CalibrationProfile(calls, macs, errors, scales)
+
+
+def select_dtypes(
+    profile: CalibrationProfile,
+    accuracy_budget: float = 1e-2,
+    max_op_error: Optional[float] = None,
+):
+    """Pick the dtype of each call within the accuracy budget.
+
+    The calls go to their most accurate 16 bit dtype first, the most MACs per error first, until
+    the budget is spent. The float8 dtypes, of twice the tensor core throughput, then replace the
+    16 bit ones in the same order with the rest of the budget.
+
+    Parameters
+    ----------
+    profile : CalibrationProfile
+        The errors of the calls.
+    accuracy_budget : float
+        The largest sum of the errors of the calls.
+    max_op_error : Optional[float]
+        The largest error of a single call.
+
+    Returns
+    -------
+    choices : List[str]
+        The dtype of each call, float32 for the ones left in full precision.
+    spent : float
+        The sum of the errors of the calls.
+    """
+    max_op_error = accuracy_budget if max_op_error is None else max_op_error
+    choices = ["float32"] * len(profile.calls)
+    spent = 0.0
+
+    def by_cost(costs):
+        return sorted(
+            (i for i in costs if costs[i] <= max_op_error),
+            key=lambda i: (costs[i] / max(profile.macs[i], 1), i),
+        )
+
+    half = {}
+    for i, errors in enumerate(profile.errors):
+        options = [d for d in errors if d not in FLOAT8_DTYPES]
+        if options:
+            best = min(options, key=lambda d: errors[d])
+            half[i] = (best, errors[best])
+    for i in by_cost({i: err for i, (_, err) in half.items()}):
+        if spent + half[i][1] <= accuracy_budget:
+            choices[i] = half[i][0]
+            spent += half[i][1]
+
+    extra, fp8 = {}, {}
+    for i, errors in enumerate(profile.errors):
+        options = [d for d in errors if d in FLOAT8_DTYPES and errors[d] <= max_op_error]
+        if options:
+            best = min(options, key=lambda d: errors[d])
+            fp8[i] = best
+            current = half[i][1] if choices[i] != "float32" else 0.0
+            extra[i] = max(errors[best] - current, 0.0)
+    for i in sorted(extra, key=lambda i: (extra[i] / max(profile.macs[i], 1), i)):
+        if spent + extra[i] <= accuracy_budget:
+            choices[i] = fp8[i]
+            spent += extra[i]
+    return choices, spent
+
+
+def make_plan(profile: CalibrationProfile, choices: List[str]):
+    """The ToMixedPrecision plan of the chosen dtypes, with the arg scales of the float8 calls."""
+    plan = {}
+    for call, dtype, scales in zip(profile.calls, choices, profile.scales):
+        plan[call] = [dtype] + [float(s) for s in scales.get(dtype, [])]
+    return plan
+
+
+def to_mixed_precision_calibrated(
+    mod: tvm.IRModule,
+    dataset: Iterable[Dict[str, np.ndarray]],
+    params: Optional[Dict[str, np.ndarray]] = None,
+    dtypes: Sequence[str] = ("float16", "e4m3_float8"),
+    accuracy_budget: float = 1e-2,
+    max_op_error: Optional[float] = None,
+    mixed_precision_type: str = "float16",
+    missing_op_mode: int = 1,
+    target: str = "llvm",
+):
+    """Rewrite the float32 main function of mod in the calibrated mixed precision.
+
+    Parameters
+    ----------
+    mod : tvm.IRModule
+        The module.
+    dataset : Iterable[Dict[str, numpy.ndarray]]
+        The calibration samples, the inputs of main by name.
+    params : Optional[Dict[str, numpy.ndarray]]
+        The params bound to main as constants, so that the float8 scales of the weights are
+        known.
+    dtypes, mixed_precision_type, target : see profile_mixed_precision.
+    accuracy_budget, max_op_error : see select_dtypes.
+    missing_op_mode : see ToMixedPrecision.
+
+    Returns
+    -------
+    mod : tvm.IRModule
+        The module in mixed precision.
+    report : Dict
+        The "ops", each with its "op" name, "macs", "errors" per dtype and chosen "dtype", the
+        "estimated_error" and the "tensor_core_fraction", the fraction of the MACs of the
+        candidates run in a low precision dtype.
+    """
+    from ..build_module import bind_params_by_name
+    from .transform import InferType, ToMixedPrecision
+
+    if params is not None:
+        mod["main"] = bind_params_by_name(mod["main"], params)
+    mod = InferType()(mod)
+    profile = profile_mixed_precision(mod["main"], dataset, dtypes, mixed_precision_type, target)
+    choices, spent = select_dtypes(profile, accuracy_budget, max_op_error)
+    plan = make_plan(profile, choices)
+    mod = ToMixedPrecision(mixed_precision_type, missing_op_mode, plan)(mod)
+
+    total = sum(profile.macs)
+    low = sum(m for m, dtype in zip(profile.macs, choices) if dtype != "float32")
+    report = {
+        "ops": [
+            {"op": call.op.name, "macs": m, "errors": errors, "dtype": dtype}
+            for call, m, errors, dtype in zip(profile.calls, profile.macs, profile.errors, choices)
+        ],
+        "estimated_error": spent,
+        "tensor_core_fraction": low / total if total else 0.0,
+    }
+    return mod, report
@@ -99,6 +99,21 @@ def InferType():
     return _ffi_api.InferType()
 
 
+def InferTypeIncremental():
+    """Infer the type of the functions changed since the last type inference.
+
+    A function whose sub-expressions all still have a checked type keeps its types, the
+    other functions and their callers are checked again. We assume existing type information
+    in the module is correct!
+
+    Returns
+    -------
+    ret : tvm.transform.Pass
+        The registered incremental type inference pass.
+    """
+    return _ffi_api.InferTypeIncremental()
+
+
 def InferTypeLocal(expr):
     """Infer the type of a single expr, reusing type information to do so.
 
@@ -302,6 +317,24 @@ def FoldConstant(fold_qnn=False):
     return _ffi_api.FoldConstant(fold_qnn)
 
 
+def ClearFoldConstantCache():
+    """Drop the subexpressions folded by FoldConstant which the process keeps when the pass
+    config "relay.FoldConstant.cache_bytes" is set."""
+    _ffi_api.ClearFoldConstantCache()
+
+
+def FoldConstantCacheBytes():
+    """The bytes of the subexpressions folded by FoldConstant kept by the process, their constants
+    and their results.
+
+    Returns
+    -------
+    ret : int
+        The bytes held by the cache.
+    """
+    return _ffi_api.FoldConstantCacheBytes()
+
+
 def FuseOps(fuse_opt_level=-1):
     """Fuse operators in an expr to a larger operator according to some rules.
 
@@ -1340,7 +1373,7 @@ def FlattenAtrousConv():
     return _ffi_api.FlattenAtrousConv()
 
 
-def ToMixedPrecision(mixed_precision_type="float16", missing_op_mode=1):
+def ToMixedPrecision(mixed_precision_type="float16", missing_op_mode=1, plan=None):
     """
     Automatic mixed precision rewriter. Rewrite an FP32 relay graph into a version
     where as many operations as possible are in the target mixed_precision_type.
@@ -1356,6 +1389,12 @@ def ToMixedPrecision(mixed_precision_type="float16", missing_op_mode=1):
         1: Allow missing ops but emit warnings.
         2: Allow missing ops and silently ignore them.
 
+    plan: Optional[Dict[relay.Call, List[Union[str, float]]]]
+      The calibrated precision of some calls, see
+      relay.transform.mixed_precision_calibration. It maps a call to its dtype, followed for
+      the float8 calls by the per-tensor scale of each of its args. The float32 calls are left
+      in float32, the others run in their dtype whatever the op lists say.
+
     relay.ToMixedPrecision.keep_orig_output_dtype: boolean
       Defines if outputs should be retained in original data type or convert to
       mixed_precision_type. By default this parameter is False and transformation
@@ -1370,7 +1409,7 @@ def ToMixedPrecision(mixed_precision_type="float16", missing_op_mode=1):
     """
     if missing_op_mode < 0 or missing_op_mode > 2:
         raise ValueError("Missing op mode is either 0, 1, or 2")
-    return _ffi_api.ToMixedPrecision(mixed_precision_type, missing_op_mode)
+    return _ffi_api.ToMixedPrecision(mixed_precision_type, missing_op_mode, plan or {})
 
 
 def SplitArgs(max_function_args):
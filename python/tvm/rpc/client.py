@@ -214,6 +214,61 @@ class RPCSession(object):
             )
         return self._remote_funcs["download_linked_module"](path)
 
+    def set_transfer_options(
+        self, block_bytes=None, window=None, cache_min_bytes=None, compress_min_bytes=None
+    ):
+        """Set how the tensor copies to and from the remote are transferred.
+
+        The copies are split into blocks of which up to `window` are in flight at once.
+        An upload of at least `cache_min_bytes` is keyed by the digest of its content in a
+        tensor cache of the server, so that uploading the same content again in this session
+        only copies it on the remote. The cache does not outlive the session, the server
+        serves each connection from a separate process. An upload of at least
+        `compress_min_bytes` has the zero runs of each block compressed when that shrinks it.
+        Options left to None are unchanged.
+
+        Parameters
+        ----------
+        block_bytes : Optional[int]
+            The payload bytes of each copy packet, 0 for the default.
+
+        window : Optional[int]
+            The number of copy packets in flight, 0 for the default.
+
+        cache_min_bytes : Optional[int]
+            The smallest upload that goes through the tensor cache, 0 disables the cache.
+
+        compress_min_bytes : Optional[int]
+            The smallest upload that is compressed, 0 disables the compression.
+        """
+
+        def _value(option):
+            return -1 if option is None else option
+
+        _ffi_api.SessSetTransferOptions(
+            self._sess,
+            _value(block_bytes),
+            _value(window),
+            _value(cache_min_bytes),
+            _value(compress_min_bytes),
+        )
+
+    def clear_tensor_cache(self):
+        """Drop the uploads cached by the server, see :py:meth:`set_transfer_options`."""
+        self.get_function("tvm.rpc.server.TensorCacheClear")()
+
+    def tensor_cache_stats(self):
+        """The stats of the tensor cache of the session, see :py:meth:`set_transfer_options`.
+
+        Returns
+        -------
+        stats : Dict[str, int]
+            The number of uploads found in the cache ("hits") or not ("misses"), and the
+            bytes cached ("bytes").
+        """
+        stat = self.get_function("tvm.rpc.server.TensorCacheStat")
+        return {name: stat(name) for name in ("hits", "misses", "bytes")}
+
     def cpu(self, dev_id=0):
         """Construct CPU device."""
         return self.device(Device.kDLCPU, dev_id)
@@ -539,6 +594,83 @@ def connect(
     return RPCSession(sess)
 
 
+class MultiplexedConnection(object):
+    """A connection to an RPC server that carries many concurrent sessions.
+
+    Each session is a stream of the connection with a server session of its own, so the
+    sessions can be used from different threads with their calls in flight together.
+    Do not directly create the object, call connect_multiplexed.
+    """
+
+    def __init__(self, fopen):
+        self._fopen = fopen
+
+    def session(self, device_key="", session_constructor_args=None):
+        """Open a new session on the connection.
+
+        Parameters
+        ----------
+        device_key : str, optional
+            The calls of the sessions opened with the same device key run one at a time on the
+            server, in the order they arrive. Sessions with different keys run concurrently.
+
+        session_constructor_args: List
+            List of additional arguments to passed as the remote session constructor,
+            as in :py:func:`connect`.
+
+        Returns
+        -------
+        sess : RPCSession
+            The opened session.
+        """
+        session_constructor_args = session_constructor_args if session_constructor_args else []
+        if not isinstance(session_constructor_args, (list, tuple)):
+            raise TypeError("Expect the session constructor to be a list or tuple")
+        return RPCSession(self._fopen(device_key, *session_constructor_args))
+
+
+def connect_multiplexed(url, port, key="", session_timeout=0, enable_logging=False):
+    """Connect to RPC Server with a connection that carries many concurrent sessions.
+
+    Parameters
+    ----------
+    url : str
+        The url of the host
+
+    port : int
+        The port to connect to
+
+    key : str, optional
+        Additional key to match server
+
+    session_timeout : float, optional
+        The duration of the connection in seconds, as in :py:func:`connect`.
+
+    enable_logging: boolean
+        flag to enable/disable logging. Logging is disabled by default.
+
+    Returns
+    -------
+    conn : MultiplexedConnection
+        The connection, whose session method opens the sessions.
+
+    Examples
+    --------
+    .. code-block:: python
+
+        conn = rpc.connect_multiplexed(server_url, server_port, server_key)
+        remotes = [conn.session(device_key="gpu0") for _ in range(4)]
+    """
+    try:
+        key += " -mux"
+        if session_timeout:
+            key += f" -timeout={session_timeout}"
+        fopen = _ffi_api.ConnectMux(url, port, key, enable_logging)
+    except NameError:
+        raise RuntimeError("Please compile with USE_RPC=1")
+    return MultiplexedConnection(fopen)
+
+
 def connect_tracker(url, port):
     """Connect to a RPC tracker
 
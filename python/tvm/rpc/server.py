@@ -125,6 +125,8 @@ def _parse_server_opt(opts):
     for kv in opts:
         if kv.startswith("-timeout="):
             ret["timeout"] = float(kv[9:])
+        elif kv == "-mux":
+            ret["mux"] = True
     return ret
 
 
@@ -137,7 +139,10 @@ def _serving(sock, addr, opts, load_library):
 
     def _serve_loop():
         _server_env(load_library, work_path)
-        _ffi_api.ServerLoop(sock.fileno())
+        if opts.get("mux", False):
+            _ffi_api.MuxServerLoop(sock.fileno())
+        else:
+            _ffi_api.ServerLoop(sock.fileno())
 
     server_proc = multiprocessing.Process(target=_serve_loop)
     server_proc.start()
@@ -145,11 +150,13 @@ def _serving(sock, addr, opts, load_library):
 
     if server_proc.is_alive():
         logger.info("timeout in RPC session, kill..")
-        _ffi_api.ReturnException(
-            sock.fileno(),
-            f'RPCSessionTimeoutError: Your {opts["timeout"]}s session has expired, '
-            f'try to increase the "session_timeout" value.',
-        )
+        # A multiplexed connection is framed, its sessions only see it close.
+        if not opts.get("mux", False):
+            _ffi_api.ReturnException(
+                sock.fileno(),
+                f'RPCSessionTimeoutError: Your {opts["timeout"]}s session has expired, '
+                f'try to increase the "session_timeout" value.',
+            )
 
         try:
             import psutil  # pylint: disable=import-outside-toplevel
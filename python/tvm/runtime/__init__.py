@@ -37,6 +37,8 @@ from .params import (
     load_param_dict,
     save_param_dict_to_file,
     load_param_dict_from_file,
+    save_param_dict_mapped,
+    load_param_dict_mapped,
 )
 
 from . import executor
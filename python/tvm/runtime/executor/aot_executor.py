@@ -68,6 +68,10 @@ class AotModule(object):
         self._get_input_index = module["get_input_index"]
         self._get_num_inputs = module["get_num_inputs"]
         self._get_input_name = module["get_input_name"]
+        self._bind_input = module["bind_input"]
+        self._bind_output = module["bind_output"]
+        self._swap_input = module["swap_input"]
+        self._swap_output = module["swap_output"]
 
     def set_input(self, key=None, value=None, **params):
         """Set inputs to the module via kwargs
@@ -101,6 +105,61 @@ class AotModule(object):
                 if val:
                     self._get_input(k).copyfrom(params[k])
 
+    def bind_input(self, key, value):
+        """Bind an input to an NDArray for all the following runs without copying it. The
+        executor holds a reference to the array until the input is bound again.
+
+        Parameters
+        ----------
+        key : int or str
+           The input key
+
+        value : NDArray
+           The array the input is read from
+        """
+        self._bind_input(key, value)
+
+    def bind_output(self, key, value):
+        """Bind an output to an NDArray for all the following runs without copying it. The
+        executor holds a reference to the array until the output is bound again.
+
+        Parameters
+        ----------
+        key : int or str
+           The output key
+
+        value : NDArray
+           The array the output is written to
+        """
+        self._bind_output(key, value)
+
+    def swap_input(self, key, value):
+        """Swap a bound input for an NDArray of the same size on the same device, e.g. to
+        alternate between two buffers. Only the pointers are replaced.
+
+        Parameters
+        ----------
+        key : int or str
+           The input key
+
+        value : NDArray
+           The array the input is read from
+        """
+        self._swap_input(key, value)
+
+    def swap_output(self, key, value):
+        """Swap a bound output for an NDArray of the same size on the same device.
+
+        Parameters
+        ----------
+        key : int or str
+           The output key
+
+        value : NDArray
+           The array the output is written to
+        """
+        self._swap_output(key, value)
+
     def run(self, **input_dict):
         """Run forward execution of the model
 
@@ -108,3 +108,51 @@ def load_param_dict_from_file(path):
         The parameter dictionary.
     """
     return _ffi_api.LoadParamsFromFile(path)
+
+
+def save_param_dict_mapped(params, path, alignment=64):
+    """Save parameter dictionary to a file in the mapped format.
+
+    The data of the arrays are stored raw at aligned offsets, so that
+    load_param_dict_mapped can use the file in place.
+
+    Parameters
+    ----------
+    params : dict of str to NDArray
+        The parameter dictionary.
+
+    path: str
+        The path to the parameter file.
+
+    alignment: int
+        The alignment of the array offsets in the file, a multiple of 64.
+    """
+    return _ffi_api.SaveParamsMapped(_to_ndarray(params), path, alignment)
+
+
+def load_param_dict_mapped(path, device=None, chunk_bytes=64 << 20):
+    """Load parameter dictionary from a file in the mapped format.
+
+    The file is memory mapped. On CPU the arrays point into the mapping without any copy,
+    the writes to them are private to the process. On other devices the arrays are
+    uploaded in chunks while the next chunk is read ahead from the disk.
+
+    Parameters
+    ----------
+    path: str
+        The path to the parameter file to load from.
+
+    device: Optional[Device]
+        The device of the loaded arrays, CPU by default.
+
+    chunk_bytes: int
+        The size of the chunks uploaded to the device.
+
+    Returns
+    -------
+    params : dict of str to NDArray
+        The parameter dictionary.
+    """
+    if device is None:
+        device = ndarray.cpu(0)
+    return _ffi_api.LoadParamsMapped(path, device, chunk_bytes)
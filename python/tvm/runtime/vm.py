@@ -20,6 +20,8 @@ The Relay Virtual Machine runtime.
 
 Implements a Python interface to executing the compiled VM object.
 """
+import json
+
 import numpy as np
 
 import tvm
@@ -190,6 +192,26 @@ class Executable(object):
 
         return Executable(_ffi_api.Load_Executable(bytecode, lib))
 
+    @staticmethod
+    def load_exec_file(path, lib):
+        """Construct an executable from a file written by its module's save, the file is mapped
+        into memory and the constants are only read from it on their first use.
+
+        Parameters
+        ----------
+        path : str
+            The path of the file.
+
+        lib : :py:class:`~tvm.runtime.Module`
+            The runtime module that contains the generated code.
+
+        Returns
+        -------
+        exec: Executable
+            An executable constructed using the provided artifacts.
+        """
+        return Executable(_ffi_api.Load_ExecutableFromFile(path, lib))
+
     @property
     def lib(self):
         """Get the library that contains hardware dependent code.
@@ -342,15 +364,17 @@ class VirtualMachine(object):
 
     memory_cfg : str or Dict[tvm.runtime.Device, str], optional
         Config the type of memory allocator. The allocator type can be ["naive",
-        "pooled"]. If memory_cfg is None, all devices will use pooled allocator
-        by default. If memory_cfg is string, all devices will use the specified
-        allocator type. If memory_cfg is a dict, each device uses the allocator
-        type specified in the dict, or pooled allocator if not specified in the
-        dict.
+        "pooled", "caching", "stream_ordered"]. If memory_cfg is None, all devices
+        will use pooled allocator by default. If memory_cfg is string, all devices
+        will use the specified allocator type. If memory_cfg is a dict, each device
+        uses the allocator type specified in the dict, or pooled allocator if not
+        specified in the dict.
     """
 
     NAIVE_ALLOCATOR = 1
     POOLED_ALLOCATOR = 2
+    CACHING_ALLOCATOR = 3
+    STREAM_ORDERED_ALLOCATOR = 4
 
     def __init__(self, exe, device, memory_cfg=None):
         """
@@ -418,9 +442,13 @@ class VirtualMachine(object):
         if memory_cfg is None:
             memory_cfg = {}
         elif isinstance(memory_cfg, str):
-            assert memory_cfg in ["naive", "pooled"]
+            assert memory_cfg in ["naive", "pooled", "caching", "stream_ordered"]
             if memory_cfg == "naive":
                 default_alloc_type = VirtualMachine.NAIVE_ALLOCATOR
+            elif memory_cfg == "caching":
+                default_alloc_type = VirtualMachine.CACHING_ALLOCATOR
+            elif memory_cfg == "stream_ordered":
+                default_alloc_type = VirtualMachine.STREAM_ORDERED_ALLOCATOR
             memory_cfg = {}
         elif not isinstance(memory_cfg, dict):
             raise TypeError(
@@ -736,3 +764,134 @@ class VirtualMachine(object):
             cooldown_interval_ms=cooldown_interval_ms,
             repeats_to_cooldown=repeats_to_cooldown,
         )(func_name)
+
+
+class BatchScheduler(object):
+    """Continuous batching of the requests to a function of a Relay VM.
+
+    The requests are grouped by the shapes of their inputs, but the batch axis, and run as one
+    batch concatenated along the first axis. The inputs are zero padded along ``pad_axis`` to a
+    multiple of ``bucket_size`` so that requests of close lengths share a batch, and the outputs
+    are split back per request and cropped along that axis.
+
+    A request may run for several steps, the outputs of a step being the inputs of the next one,
+    as for autoregressive decoding. Every step batches all the active requests, so that the
+    requests submitted meanwhile join at the next step. The steps may be run from several threads,
+    including the background one, and are serialized.
+
+    Parameters
+    ----------
+    vm : VirtualMachine
+        The virtual machine, its function should accept a batch of any size.
+
+    func_name : str
+        The function to run.
+
+    max_batch_size : int
+        The largest number of rows of a batch.
+
+    bucket_size : int
+        The padded lengths are rounded up to a multiple of this.
+
+    pad_axis : int
+        The axis of the inputs to pad, 0 to disable padding.
+
+    pass_lengths : bool
+        Whether to pass the unpadded lengths of the rows as an extra int32 input.
+    """
+
+    def __init__(
+        self,
+        vm,
+        func_name="main",
+        max_batch_size=32,
+        bucket_size=16,
+        pad_axis=0,
+        pass_lengths=False,
+    ):
+        self.module = _ffi_api.VMBatchScheduler(
+            vm.module, func_name, max_batch_size, bucket_size, pad_axis, pass_lengths
+        )
+        self._submit = self.module["submit"]
+        self._step = self.module["step"]
+        self._poll = self.module["poll"]
+
+    def submit(self, *inputs, num_steps=1):
+        """Queue a request.
+
+        Parameters
+        ----------
+        inputs : List[Union[numpy.ndarray, tvm.nd.NDArray]]
+            The inputs of the first step, batched along the first axis.
+
+        num_steps : int
+            The number of steps to run the request for.
+
+        Returns
+        -------
+        request : int
+            The id of the request.
+        """
+        return self._submit(num_steps, *convert(inputs))
+
+    def step(self):
+        """Run one step of all the active requests.
+
+        Returns
+        -------
+        num_requests : int
+            The number of requests which ran.
+        """
+        return self._step()
+
+    def run_until_done(self):
+        """Step until no request is left."""
+        self.module["run_until_done"]()
+
+    def poll(self, request, wait=False):
+        """Get the outputs of a request.
+
+        Parameters
+        ----------
+        request : int
+            The id of the request.
+
+        wait : bool
+            Whether to block until the request is done, stepping the requests when the scheduler
+            is not started.
+
+        Returns
+        -------
+        outputs : Optional[List[tvm.nd.NDArray]]
+            The outputs of the last step, None while the request is not done.
+
+        Raises
+        ------
+        TVMError
+            If a step of the request failed, with the error of its batch.
+        """
+        outputs = self._poll(request, wait)
+        return list(outputs) if outputs else None
+
+    def start(self):
+        """Start stepping the requests in a background thread as they are submitted."""
+        self.module["start"]()
+
+    def stop(self):
+        """Stop the background thread."""
+        self.module["stop"]()
+
+    @property
+    def num_pending(self):
+        """The number of requests not done."""
+        return self.module["num_pending"]()
+
+    def get_statistics(self):
+        """Get the batching statistics.
+
+        Returns
+        -------
+        statistics : Dict[str, float]
+            The number of batches and of rows, and the average batch and padding ratio.
+        """
+        return json.loads(self.module["get_statistics"]())
@@ -264,6 +264,13 @@ class Target(Object):
         else:
             return False
 
+    @property
+    def supports_cooperative_matrix_khr(self):
+        if self.attrs.get("supports_cooperative_matrix_khr", []):
+            return bool(self.attrs["supports_cooperative_matrix_khr"])
+        else:
+            return False
+
     @property
     def features(self):
         return TargetFeatures(self)
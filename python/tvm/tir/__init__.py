@@ -59,6 +59,12 @@ from .op import (
     tvm_bmma_sync,
     tvm_fill_fragment,
 )
+from .op import (
+    make_filled_simdgroup_matrix,
+    simdgroup_load,
+    simdgroup_store,
+    simdgroup_multiply_accumulate,
+)
 from .op import ptx_mma, ptx_mma_sp, mma_store, mma_fill
 from .op import (
     ptx_ldmatrix,
@@ -16,13 +16,13 @@
 # under the License.
 """Wrapping existing analysis utils."""
 # pylint: disable=invalid-name
-from typing import Dict, List, Optional, Union
+from typing import Dict, List, Optional, Tuple, Union
 
 import tvm
 from tvm import Object
 from tvm.ir import IRModule
 from tvm.tir.expr import Var
-from tvm.tir.stmt import Block, BufferRegion, PrimExpr
+from tvm.tir.stmt import Block, BufferRegion, For, PrimExpr
 
 from .. import Buffer, Stmt
 from ..function import PrimFunc
@@ -417,3 +417,32 @@ def get_vtcm_compaction_passes() -> List[tvm.transform.Pass]:
         returns list of passes
     """
     return _ffi_api.get_vtcm_compaction_passes()  # type: ignore # pylint: disable=no-member
+
+
+def plan_vectorize(
+    loop: For, max_vector_bits: int = 128, allow_runtime_checks: bool = False
+) -> Tuple[int, List[PrimExpr]]:
+    """Plan the vectorization of an innermost loop from the contiguity and the alignment of the
+    buffer accesses of its body, independently of any schedule.
+
+    Parameters
+    ----------
+    loop : tvm.tir.For
+        The loop to be vectorized, whose body contains no loop.
+    max_vector_bits : int
+        The width of the vector registers of the target in bits.
+    allow_runtime_checks : bool
+        Whether the alignment of the accesses whose offsets depend on runtime values is checked
+        at runtime, instead of reducing the lanes.
+
+    Returns
+    -------
+    lanes : int
+        The number of lanes to vectorize the loop with, 1 if it cannot be vectorized.
+    alignment_checks : List[PrimExpr]
+        The conditions, evaluated before the loop, under which its vector accesses are aligned.
+    """
+    lanes, alignment_checks = _ffi_api.PlanVectorize(  # type: ignore # pylint: disable=no-member
+        loop, max_vector_bits, allow_runtime_checks
+    )
+    return int(lanes), list(alignment_checks)
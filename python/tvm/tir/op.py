@@ -999,6 +999,170 @@ def tvm_store_matrix_sync(fragment, m, n, k, index, buffer_ptr, stride, layout):
     )
 
 
+def make_filled_simdgroup_matrix(d, index, value, col=8, row=8):
+    """Metal intrinsic for filling a simdgroup matrix with a value
+
+    Parameters
+    ----------
+    d : Var
+        The simdgroup matrix var.
+
+    index : Expr
+        The index of the matrix in the simdgroup matrix var.
+
+    value : Expr
+        The value to be filled in the matrix.
+
+    col : int
+        The number of columns of the matrix, only 8 is supported.
+
+    row : int
+        The number of rows of the matrix, only 8 is supported.
+
+    Returns
+    -------
+    call : PrimExpr
+        The call expression.
+    """
+    return call_intrin("handle", "tir.make_filled_simdgroup_matrix", d, index, value, col, row)
+
+
+def simdgroup_load(d, index, ptr, stride, col=8, row=8, transpose_matrix=False):
+    """Metal intrinsic for loading a simdgroup matrix from device or threadgroup memory
+
+    Parameters
+    ----------
+    d : Var
+        The simdgroup matrix var.
+
+    index : Expr
+        The index of the matrix in the simdgroup matrix var.
+
+    ptr : Expr
+        The pointer to the first element of the matrix.
+
+    stride : Expr
+        The number of elements per row of the source.
+
+    col : int
+        The number of columns of the matrix, only 8 is supported.
+
+    row : int
+        The number of rows of the matrix, only 8 is supported.
+
+    transpose_matrix : bool
+        Whether the source holds the transposed matrix.
+
+    Returns
+    -------
+    call : PrimExpr
+        The call expression.
+    """
+    return call_intrin(
+        "handle",
+        "tir.simdgroup_load",
+        d,
+        index,
+        ptr,
+        stride,
+        col,
+        row,
+        transpose_matrix,
+    )
+
+
+def simdgroup_store(d, index, ptr, stride, col=8, row=8, transpose_matrix=False):
+    """Metal intrinsic for storing a simdgroup matrix to device or threadgroup memory
+
+    Parameters
+    ----------
+    d : Var
+        The simdgroup matrix var.
+
+    index : Expr
+        The index of the matrix in the simdgroup matrix var.
+
+    ptr : Expr
+        The pointer to the first element of the destination.
+
+    stride : Expr
+        The number of elements per row of the destination.
+
+    col : int
+        The number of columns of the matrix, only 8 is supported.
+
+    row : int
+        The number of rows of the matrix, only 8 is supported.
+
+    transpose_matrix : bool
+        Whether to store the transposed matrix.
+
+    Returns
+    -------
+    call : PrimExpr
+        The call expression.
+    """
+    return call_intrin(
+        "handle",
+        "tir.simdgroup_store",
+        d,
+        index,
+        ptr,
+        stride,
+        col,
+        row,
+        transpose_matrix,
+    )
+
+
+def simdgroup_multiply_accumulate(d, index_d, a, index_a, b, index_b, c, index_c):
+    """Metal intrinsic for simdgroup matrix multiply accumulate, d = a * b + c
+
+    Parameters
+    ----------
+    d : Var
+        The destination simdgroup matrix var.
+
+    index_d : Expr
+        The index of the destination matrix.
+
+    a : Var
+        The multiplicand simdgroup matrix var.
+
+    index_a : Expr
+        The index of the multiplicand matrix.
+
+    b : Var
+        The multiplier simdgroup matrix var.
+
+    index_b : Expr
+        The index of the multiplier matrix.
+
+    c : Var
+        The accumulator simdgroup matrix var.
+
+    index_c : Expr
+        The index of the accumulator matrix.
+
+    Returns
+    -------
+    call : PrimExpr
+        The call expression.
+    """
+    return call_intrin(
+        "handle",
+        "tir.simdgroup_multiply_accumulate",
+        d,
+        index_d,
+        a,
+        index_a,
+        b,
+        index_b,
+        c,
+        index_c,
+    )
+
+
 def ptx_mma(
     dtype,
     shape,
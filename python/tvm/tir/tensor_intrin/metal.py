@@ -0,0 +1,349 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+# pylint: disable=invalid-name,missing-function-docstring,unused-variable
+"""Intrinsics for tensorization on Apple GPUs with the metal simdgroup matrices."""
+from typing import Dict, Tuple
+
+from typing_extensions import Literal
+
+from tvm.script import tir as T
+from tvm.tir.function import PrimFunc
+
+from .. import IntImm, TensorIntrin
+
+# The only shape of the metal simdgroup matrices.
+SIMDGROUP_DIM = 8
+
+
+def get_simdgroup_index(buffer, stride, col, row):
+    """Compute the simdgroup matrix index using elem_offset of the buffer"""
+    frag_index_m = buffer.elem_offset // stride // col
+    frag_index_n = buffer.elem_offset % stride // row
+
+    num_fragments_per_row = stride // row
+    return frag_index_m * num_fragments_per_row + frag_index_n
+
+
+def get_make_filled_simdgroup_matrix_intrin(
+    dtype: str, col: int = SIMDGROUP_DIM, row: int = SIMDGROUP_DIM
+) -> Tuple[PrimFunc, PrimFunc]:
+    """Generator of the simdgroup matrix fill intrins"""
+    zero = IntImm("int32", 0).astype(dtype)
+
+    @T.prim_func
+    def simdgroup_fill_desc(a: T.handle) -> None:
+        A = T.match_buffer(a, (col, row), dtype, offset_factor=1, scope="metal.simdgroup")
+        with T.block("root"):
+            T.reads()
+            T.writes(A[0:col, 0:row])
+            for i, j in T.grid(col, row):
+                with T.block("init"):
+                    vii, vjj = T.axis.remap("SS", [i, j])
+                    A[vii, vjj] = zero
+
+    @T.prim_func
+    def simdgroup_fill_impl(a: T.handle) -> None:
+        d1 = T.int32()
+        d0 = T.int32()
+        A = T.match_buffer(
+            a,
+            (col, row),
+            dtype,
+            offset_factor=1,
+            scope="metal.simdgroup",
+            strides=[d1, d0],
+        )
+        with T.block("root"):
+            T.reads()
+            T.writes(A[0:col, 0:row])
+            T.evaluate(
+                T.make_filled_simdgroup_matrix(
+                    A.data,
+                    get_simdgroup_index(A, d1, col, row),
+                    zero,
+                    col,
+                    row,
+                    dtype="handle",
+                )
+            )
+
+    return simdgroup_fill_desc, simdgroup_fill_impl
+
+
+def get_simdgroup_load_intrin(
+    dtype: str,
+    scope: str,
+    transpose_matrix: bool,
+    col: int = SIMDGROUP_DIM,
+    row: int = SIMDGROUP_DIM,
+) -> Tuple[PrimFunc, PrimFunc]:
+    """Generator of the simdgroup matrix load intrins, the transposed load reads the matrix from
+    its transpose in the source"""
+
+    def maybe_swap(i, j):
+        if transpose_matrix:
+            return j, i
+        return i, j
+
+    src_rows, src_cols = maybe_swap(col, row)
+
+    @T.prim_func
+    def simdgroup_load_desc(a: T.handle, c: T.handle) -> None:
+        A = T.match_buffer(a, (src_rows, src_cols), dtype, offset_factor=1, scope=scope)
+        C = T.match_buffer(c, (col, row), dtype, offset_factor=1, scope="metal.simdgroup")
+        with T.block("root"):
+            T.reads(A[0:src_rows, 0:src_cols])
+            T.writes(C[0:col, 0:row])
+            for i, j in T.grid(col, row):
+                with T.block("load"):
+                    vii, vjj = T.axis.remap("SS", [i, j])
+                    A_index_0, A_index_1 = T.meta_var(maybe_swap(vii, vjj))
+                    C[vii, vjj] = A[A_index_0, A_index_1]
+
+    @T.prim_func
+    def simdgroup_load_impl(a: T.handle, c: T.handle) -> None:
+        s1 = T.int32()
+        s0 = T.int32()
+        d1 = T.int32()
+        d0 = T.int32()
+        A = T.match_buffer(
+            a, (src_rows, src_cols), dtype, offset_factor=1, scope=scope, strides=[s1, s0]
+        )
+        C = T.match_buffer(
+            c,
+            (col, row),
+            dtype,
+            offset_factor=1,
+            scope="metal.simdgroup",
+            strides=[d1, d0],
+        )
+        with T.block("root"):
+            T.reads(A[0:src_rows, 0:src_cols])
+            T.writes(C[0:col, 0:row])
+            T.evaluate(
+                T.simdgroup_load(
+                    C.data,
+                    get_simdgroup_index(C, d1, col, row),
+                    A.access_ptr("r"),
+                    s1,
+                    col,
+                    row,
+                    transpose_matrix,
+                    dtype="handle",
+                )
+            )
+
+    return simdgroup_load_desc, simdgroup_load_impl
+
+
+def get_simdgroup_store_intrin(
+    dtype: str, scope: str, col: int = SIMDGROUP_DIM, row: int = SIMDGROUP_DIM
+) -> Tuple[PrimFunc, PrimFunc]:
+    """Generator of the simdgroup matrix store intrins"""
+
+    @T.prim_func
+    def simdgroup_store_desc(a: T.handle, c: T.handle) -> None:
+        A = T.match_buffer(a, (col, row), dtype, offset_factor=1, scope="metal.simdgroup")
+        C = T.match_buffer(c, (col, row), dtype, offset_factor=1, scope=scope)
+        with T.block("root"):
+            T.reads(A[0:col, 0:row])
+            T.writes(C[0:col, 0:row])
+            for i, j in T.grid(col, row):
+                with T.block("store"):
+                    vii, vjj = T.axis.remap("SS", [i, j])
+                    C[vii, vjj] = A[vii, vjj]
+
+    @T.prim_func
+    def simdgroup_store_impl(a: T.handle, c: T.handle) -> None:
+        s1 = T.int32()
+        s0 = T.int32()
+        d1 = T.int32()
+        d0 = T.int32()
+        A = T.match_buffer(
+            a,
+            (col, row),
+            dtype,
+            offset_factor=1,
+            scope="metal.simdgroup",
+            strides=[s1, s0],
+        )
+        C = T.match_buffer(c, (col, row), dtype, offset_factor=1, scope=scope, strides=[d1, d0])
+        with T.block("root"):
+            T.reads(A[0:col, 0:row])
+            T.writes(C[0:col, 0:row])
+            T.evaluate(
+                T.simdgroup_store(
+                    A.data,
+                    get_simdgroup_index(A, s1, col, row),
+                    C.access_ptr("w"),
+                    d1,
+                    col,
+                    row,
+                    False,
+                    dtype="handle",
+                )
+            )
+
+    return simdgroup_store_desc, simdgroup_store_impl
+
+
+def get_simdgroup_multiply_accumulate_intrin(
+    dtype: str,
+    m_dim: int = SIMDGROUP_DIM,
+    n_dim: int = SIMDGROUP_DIM,
+    k_dim: int = SIMDGROUP_DIM,
+) -> Tuple[PrimFunc, PrimFunc]:
+    """Generator of the simdgroup matrix multiply accumulate intrins, C += A * B"""
+
+    @T.prim_func
+    def simdgroup_mma_desc(a: T.handle, b: T.handle, c: T.handle) -> None:
+        A = T.match_buffer(a, (m_dim, k_dim), dtype, offset_factor=1, scope="metal.simdgroup")
+        B = T.match_buffer(b, (k_dim, n_dim), dtype, offset_factor=1, scope="metal.simdgroup")
+        C = T.match_buffer(c, (m_dim, n_dim), dtype, offset_factor=1, scope="metal.simdgroup")
+        with T.block("root"):
+            T.reads(C[0:m_dim, 0:n_dim], A[0:m_dim, 0:k_dim], B[0:k_dim, 0:n_dim])
+            T.writes(C[0:m_dim, 0:n_dim])
+            for i, j, k in T.grid(m_dim, n_dim, k_dim):
+                with T.block(""):
+                    vii, vjj, vkk = T.axis.remap("SSR", [i, j, k])
+                    C[vii, vjj] = C[vii, vjj] + A[vii, vkk] * B[vkk, vjj]
+
+    @T.prim_func
+    def simdgroup_mma_impl(a: T.handle, b: T.handle, c: T.handle) -> None:
+        a1 = T.int32()
+        a0 = T.int32()
+        b1 = T.int32()
+        b0 = T.int32()
+        c1 = T.int32()
+        c0 = T.int32()
+        A = T.match_buffer(
+            a,
+            (m_dim, k_dim),
+            dtype,
+            offset_factor=1,
+            scope="metal.simdgroup",
+            strides=[a1, a0],
+        )
+        B = T.match_buffer(
+            b,
+            (k_dim, n_dim),
+            dtype,
+            offset_factor=1,
+            scope="metal.simdgroup",
+            strides=[b1, b0],
+        )
+        C = T.match_buffer(
+            c,
+            (m_dim, n_dim),
+            dtype,
+            offset_factor=1,
+            scope="metal.simdgroup",
+            strides=[c1, c0],
+        )
+        with T.block("root"):
+            T.reads(C[0:m_dim, 0:n_dim], A[0:m_dim, 0:k_dim], B[0:k_dim, 0:n_dim])
+            T.writes(C[0:m_dim, 0:n_dim])
+            T.evaluate(
+                T.simdgroup_multiply_accumulate(
+                    C.data,
+                    get_simdgroup_index(C, c1, m_dim, n_dim),
+                    A.data,
+                    get_simdgroup_index(A, a1, m_dim, k_dim),
+                    B.data,
+                    get_simdgroup_index(B, b1, k_dim, n_dim),
+                    C.data,
+                    get_simdgroup_index(C, c1, m_dim, n_dim),
+                    dtype="handle",
+                )
+            )
+
+    return simdgroup_mma_desc, simdgroup_mma_impl
+
+
+for _dtype, _short in [("float16", "f16"), ("float32", "f32")]:
+    # e.g. simdgroup_fill_8x8x8_f16
+    TensorIntrin.register(
+        f"simdgroup_fill_8x8x8_{_short}", *get_make_filled_simdgroup_matrix_intrin(_dtype)
+    )
+    # e.g. simdgroup_multiply_accumulate_8x8x8_f16
+    TensorIntrin.register(
+        f"simdgroup_multiply_accumulate_8x8x8_{_short}",
+        *get_simdgroup_multiply_accumulate_intrin(_dtype),
+    )
+    for _scope in ["shared", "global"]:
+        # e.g. simdgroup_load_8x8x8_f16_shared, simdgroup_load_8x8x8_f16_trans_shared
+        TensorIntrin.register(
+            f"simdgroup_load_8x8x8_{_short}_{_scope}",
+            *get_simdgroup_load_intrin(_dtype, _scope, transpose_matrix=False),
+        )
+        TensorIntrin.register(
+            f"simdgroup_load_8x8x8_{_short}_trans_{_scope}",
+            *get_simdgroup_load_intrin(_dtype, _scope, transpose_matrix=True),
+        )
+        # e.g. simdgroup_store_8x8x8_f16_global
+        TensorIntrin.register(
+            f"simdgroup_store_8x8x8_{_short}_{_scope}", *get_simdgroup_store_intrin(_dtype, _scope)
+        )
+
+
+def get_simdgroup_intrin_group(
+    load_scope: Literal["shared", "global"],
+    store_scope: Literal["shared", "global"],
+    dtype: Literal["float16", "float32"],
+    trans_a: bool = False,
+    trans_b: bool = False,
+) -> Dict[str, str]:
+    """Get a group of intrinsics for the metal simdgroup matrices with the given configurations
+
+    Parameters
+    ----------
+    load_scope : Literal["shared", "global"]
+        The memory scope of the input buffer, "shared" is the threadgroup memory.
+
+    store_scope : Literal["shared", "global"]
+        The memory scope of the result buffer.
+
+    dtype : Literal["float16", "float32"]
+        The data type of the inputs and of the accumulator.
+
+    trans_a : bool
+        Whether the input matrix A is transposed.
+
+    trans_b : bool
+        Whether the input matrix B is transposed.
+
+    Returns
+    -------
+    ret : Dict[str, str]
+        A group of tensor intrinsics.
+    """
+    assert load_scope in ["shared", "global"]
+    assert store_scope in ["shared", "global"]
+    assert dtype in ["float16", "float32"]
+
+    shape = "8x8x8"
+    dtype = "f16" if dtype == "float16" else "f32"
+    trans_a = "_trans" if trans_a else ""
+    trans_b = "_trans" if trans_b else ""
+
+    return {
+        "init": f"simdgroup_fill_{shape}_{dtype}",
+        "load_a": f"simdgroup_load_{shape}_{dtype}{trans_a}_{load_scope}",
+        "load_b": f"simdgroup_load_{shape}_{dtype}{trans_b}_{load_scope}",
+        "compute": f"simdgroup_multiply_accumulate_{shape}_{dtype}",
+        "store": f"simdgroup_store_{shape}_{dtype}_{store_scope}",
+    }
@@ -182,6 +182,20 @@ def VectorizeLoop(enable_vectorize: bool = True):
     return _ffi_api.VectorizeLoop(enable_vectorize)  # type: ignore
 
 
+def AutoVectorize():
+    """Vectorize the innermost serial loops without annotations, with the lanes planned by
+    tvm.tir.analysis.plan_vectorize for vectors of "tir.vectorize_dynamic_vector_bits" bits.
+    The loops whose alignment depends on runtime values are vectorized under a check of it,
+    falling back to the scalar loop.
+
+    Returns
+    -------
+    fpass : tvm.transform.Pass
+        The result pass
+    """
+    return _ffi_api.AutoVectorize()  # type: ignore
+
+
 def InjectVirtualThread():
     """Inject virtual thread loops.
 
@@ -985,16 +999,22 @@ def UnifyThreadBinding():
     return _ffi_api.UnifyThreadBinding()  # type: ignore
 
 
-def MergeDynamicSharedMemoryAllocations():
+def MergeDynamicSharedMemoryAllocations(align_bytes: int = 0):
     """This pass merges multiple TIR-level dynamic shared memory allocations
     into one allocation.
 
+    Parameters
+    ----------
+    align_bytes : int
+        The minimal alignment in bytes of the merged buffers, e.g. 1024 for
+        the swizzled TMA tiles. The buffers are aligned to their dtype if 0.
+
     Returns
     -------
     fpass : tvm.transform.Pass
         The result pass
     """
-    return _ffi_api.MergeDynamicSharedMemoryAllocations()  # type: ignore
+    return _ffi_api.MergeDynamicSharedMemoryAllocations(align_bytes)  # type: ignore
 
 
 def ConvertForLoopsToSerial():
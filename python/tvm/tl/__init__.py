@@ -16,5 +16,40 @@
 # under the License.
 
 from . import transform
-from .engine import lower
-from .utils import Profiler, ConvertTorch, TensorSupplyType, cached
+from .engine import (
+    CompileProfile,
+    lower,
+    lower_many,
+    specialize_func,
+    get_resource_usage,
+    get_occupancy,
+    get_kernel_metadata,
+)
+from .utils import (
+    Profiler,
+    BenchResult,
+    ConvertTorch,
+    SpecializedKernel,
+    JITKernel,
+    TensorSupplyType,
+    cached,
+    jit,
+    set_tvm_stream,
+    invalidate_tvm_stream,
+    preload_kernels,
+    set_l2_persisting,
+    reset_l2_persisting,
+    prefetch_l2,
+    SMPartition,
+    make_peer_table,
+    map_torch_type,
+    map_tvm_type,
+    make_group_offsets,
+    make_block_sparse_lut,
+    compress_2_4,
+    decode_timer_trace,
+)
+from .autotuner import Autotuner, TuningDatabase
+from .cost_model import CostModel, extract_features
+from .cuda_graph import CUDAGraph
+from .launcher import RawKernel
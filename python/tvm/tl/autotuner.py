@@ -0,0 +1,291 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Tune the template parameters of TL programs."""
+
+import itertools
+import json
+import math
+import os
+import os.path as osp
+from typing import Any, Callable, Dict, List, Optional
+
+import torch
+
+import tvm
+from tvm import tir
+
+from . import transform
+from .cost_model import CostModel
+from .engine import lower_many
+from .utils import Profiler, TensorSupplyType
+
+# The max dynamic shared memory per block (opt-in) of each compute capability
+_MAX_SHARED_MEMORY = {
+    (7, 0): 98304,
+    (7, 5): 65536,
+    (8, 0): 166912,
+    (8, 6): 101376,
+    (8, 7): 166912,
+    (8, 9): 101376,
+    (9, 0): 232448,
+}
+
+
+def _device_key():
+    prop = torch.cuda.get_device_properties(torch.cuda.current_device())
+    return f"{prop.name} sm_{prop.major}{prop.minor}"
+
+
+class TuningDatabase:
+    """The tuning records in a JSON file, one record per line, like the JSONDatabase of
+    meta_schedule. The records are keyed by the kernel, the problem shape and the GPU, and only
+    appended, so that the file can be shared by the tuning processes.
+
+    Parameters
+    ----------
+    path : Optional[str]
+        The path of the database file, defaults to $TL_TUNING_DATABASE or
+        ~/.cache/tvm/tl_tuning.json.
+    """
+
+    def __init__(self, path: Optional[str] = None):
+        if path is None:
+            path = os.environ.get(
+                "TL_TUNING_DATABASE", osp.expanduser("~/.cache/tvm/tl_tuning.json")
+            )
+        self.path = path
+        self._best = {}
+        if osp.exists(path):
+            with open(path, "r", encoding="utf-8") as f:
+                for line in f:
+                    line = line.strip()
+                    if line:
+                        self._update(json.loads(line))
+
+    @staticmethod
+    def _key(kernel: str, shape: List[Any], device: str):
+        return (kernel, json.dumps(shape), device)
+
+    def _update(self, record: Dict[str, Any]):
+        key = self._key(record["kernel"], record["shape"], record["device"])
+        if key not in self._best or record["latency"] < self._best[key]["latency"]:
+            self._best[key] = record
+
+    def commit_record(self, kernel: str, shape: List[Any], config: Dict[str, Any], latency: float):
+        """Add a tuning record of the current GPU."""
+        record = {
+            "kernel": kernel,
+            "shape": list(shape),
+            "device": _device_key(),
+            "config": config,
+            "latency": latency,
+        }
+        self._update(record)
+        os.makedirs(osp.dirname(osp.abspath(self.path)), exist_ok=True)
+        with open(self.path, "a", encoding="utf-8") as f:
+            f.write(json.dumps(record) + "\n")
+
+    def get_best(self, kernel: str, shape: List[Any]) -> Optional[Dict[str, Any]]:
+        """The best record of the kernel and shape on the current GPU, or None."""
+        return self._best.get(self._key(kernel, list(shape), _device_key()))
+
+
+class _ResourceCollector:
+    """Estimate the resource usage of a TL program before it is compiled."""
+
+    def __init__(self, func: tir.PrimFunc):
+        self.threads = 1
+        self.num_stages = 1
+        self.shared_bytes = 0
+        self.fragment_bits = 0
+        self.analyzer = tvm.arith.Analyzer()
+        tir.stmt_functor.post_order_visit(func.body, self._visit)
+
+    def _upper_bound(self, expr) -> Optional[int]:
+        """The upper bound of a possibly symbolic extent, None if it is unbounded."""
+        if isinstance(expr, tir.IntImm):
+            return expr.value
+        bound = self.analyzer.const_int_bound(expr).max_value
+        return None if bound >= tvm.arith.ConstIntBound.POS_INF else bound
+
+    def _visit(self, node):
+        if isinstance(node, tir.AttrStmt) and node.attr_key == "thread_extent":
+            # the registers per thread are not estimated for a dynamic number of threads
+            if node.node.thread_tag == "threadIdx.x" and isinstance(node.value, tir.IntImm):
+                self.threads = node.value.value
+        elif isinstance(node, tir.For) and "num_stages" in node.annotations:
+            self.num_stages = max(self.num_stages, int(node.annotations["num_stages"]))
+        elif isinstance(node, tir.Block):
+            for buffer in node.alloc_buffers:
+                num_elems = 1
+                for extent in buffer.shape:
+                    bound = self._upper_bound(extent)
+                    # the unbounded dynamic buffers are left to the checks of the compiler
+                    if bound is None:
+                        num_elems = 0
+                        break
+                    num_elems *= bound
+                bits = num_elems * tvm.DataType(buffer.dtype).bits
+                if buffer.scope() in ("shared", "shared.dyn"):
+                    self.shared_bytes += bits // 8
+                elif buffer.scope() == "local.fragment":
+                    self.fragment_bits += bits
+
+    def shared_memory(self):
+        # every shared buffer is counted as multi-buffered by the pipeline, which is an upper bound
+        return self.shared_bytes * self.num_stages
+
+    def registers_per_thread(self):
+        return self.fragment_bits // 32 // self.threads
+
+
+class Autotuner:
+    """Search the template parameters of a TL program for the best latency.
+
+    The configs failing the static checks are pruned before compiling: the shared memory and the
+    fragment registers are estimated from the program, and the front passes of lower (e.g. the
+    warp partition and the layout inference of the gemms) must succeed. The rest are compiled
+    concurrently with lower_many and benchmarked with the Profiler, the winner is committed into
+    the database. With a cost model, only the configs ranked best by it are compiled.
+
+    Parameters
+    ----------
+    program : Callable[..., tir.PrimFunc]
+        Builds the program from the problem shape (positional) and a config (keywords).
+    configs : Dict[str, List[Any]] or List[Dict[str, Any]]
+        The config space, either the candidates of each parameter or a list of configs.
+    result_idx : List[int]
+        The output params of the program, see Profiler.
+    ref_prog : Optional[Callable]
+        The reference program, the configs with wrong results are dropped when it is given.
+    max_registers : int
+        The max estimated fragment registers per thread.
+    max_shared_memory : Optional[int]
+        The shared memory capacity in bytes, defaults to the capacity of the GPU.
+    workers : Optional[int]
+        The number of compile workers.
+    database : Optional[TuningDatabase]
+        The database of the tuning records.
+    cost_model : Optional[CostModel]
+        The model ranking the configs before compiling.
+    keep_ratio : float
+        The ratio of the configs ranked by the cost model which are compiled and benchmarked.
+    """
+
+    def __init__(
+        self,
+        program: Callable[..., tir.PrimFunc],
+        configs,
+        result_idx: List[int],
+        supply_type: TensorSupplyType = TensorSupplyType.Normal,
+        ref_prog: Optional[Callable] = None,
+        atol: float = 1e-2,
+        rtol: float = 1e-2,
+        max_registers: int = 255,
+        max_shared_memory: Optional[int] = None,
+        workers: Optional[int] = None,
+        database: Optional[TuningDatabase] = None,
+        warmup: int = 25,
+        rep: int = 100,
+        cost_model: Optional[CostModel] = None,
+        keep_ratio: float = 0.1,
+    ):
+        if isinstance(configs, dict):
+            keys = list(configs.keys())
+            configs = [dict(zip(keys, values)) for values in itertools.product(*configs.values())]
+        self.program = program
+        self.configs = configs
+        self.result_idx = result_idx
+        self.supply_type = supply_type
+        self.ref_prog = ref_prog
+        self.atol = atol
+        self.rtol = rtol
+        self.max_registers = max_registers
+        if max_shared_memory is None:
+            prop = torch.cuda.get_device_properties(torch.cuda.current_device())
+            max_shared_memory = _MAX_SHARED_MEMORY.get((prop.major, prop.minor), 49152)
+        self.max_shared_memory = max_shared_memory
+        self.workers = workers
+        self.database = database if database is not None else TuningDatabase()
+        self.warmup = warmup
+        self.rep = rep
+        self.cost_model = cost_model
+        self.keep_ratio = keep_ratio
+
+    def _check(self, func: tir.PrimFunc) -> Optional[str]:
+        """Returns the reason if the program fails the static checks."""
+        resources = _ResourceCollector(func)
+        if resources.shared_memory() > self.max_shared_memory:
+            return f"shared memory {resources.shared_memory()} > {self.max_shared_memory}"
+        if resources.registers_per_thread() > self.max_registers:
+            return f"registers {resources.registers_per_thread()} > {self.max_registers}"
+        target = tvm.target.Target("cuda", tvm.target.Target("llvm -keys=cpu"))
+        mod = tvm.IRModule({func.attrs["global_symbol"]: func})
+        try:
+            mod = tir.transform.BindTarget(target)(mod)
+            mod = transform.FrontendLegalize()(mod)
+            mod = tir.transform.Simplify()(mod)
+            mod = transform.LayoutInference()(mod)
+        except tvm.TVMError as err:
+            return str(err).strip().split("\n")[-1]
+        return None
+
+    def tune(self, *shape, verbose: bool = False) -> Dict[str, Any]:
+        """Tune the program of the shape, the best config in the database is returned directly."""
+        kernel = getattr(self.program, "__name__", str(self.program))
+        record = self.database.get_best(kernel, shape)
+        if record is not None:
+            return record["config"]
+
+        candidates = []
+        for config in self.configs:
+            func = self.program(*shape, **config)
+            reason = self._check(func)
+            if reason is None:
+                candidates.append((config, func))
+            elif verbose:
+                print(f"skip {config}: {reason}")
+        if self.cost_model is not None and candidates:
+            candidates.sort(key=lambda candidate: self.cost_model.predict(candidate[1]))
+            candidates = candidates[: max(1, math.ceil(len(candidates) * self.keep_ratio))]
+
+        results = lower_many([func for _, func in candidates], self.workers, return_exceptions=True)
+        best_config, best_latency = None, float("inf")
+        for (config, _), result in zip(candidates, results):
+            if isinstance(result, Exception):
+                if verbose:
+                    print(f"skip {config}: {result}")
+                continue
+            mod, params = result
+            profiler = Profiler(mod, params, self.result_idx, self.supply_type)
+            if self.ref_prog is not None:
+                try:
+                    profiler.assert_allclose(self.ref_prog, atol=self.atol, rtol=self.rtol)
+                except AssertionError:
+                    if verbose:
+                        print(f"skip {config}: wrong results")
+                    continue
+            latency = profiler.do_bench(profiler.func, warmup=self.warmup, rep=self.rep)
+            if verbose:
+                print(f"{config}: {latency:.4f} ms")
+            if latency < best_latency:
+                best_config, best_latency = config, latency
+
+        if best_config is None:
+            raise RuntimeError(f"No valid config for {kernel} with shape {shape}")
+        self.database.commit_record(kernel, shape, best_config, best_latency)
+        return best_config
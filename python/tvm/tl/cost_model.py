@@ -0,0 +1,198 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""An analytical cost model of TL programs."""
+
+import math
+from dataclasses import dataclass
+from typing import Optional
+
+import torch
+
+import tvm
+from tvm import tir
+
+# (peak fp16 tensor core TFLOPS, DRAM bandwidth GB/s, max opt-in shared memory per SM bytes)
+_DEVICE_SPECS = {
+    (7, 0): (125, 900, 98304),
+    (7, 5): (65, 320, 65536),
+    (8, 0): (312, 1555, 167936),
+    (8, 6): (71, 936, 102400),
+    (8, 9): (165, 1008, 102400),
+    (9, 0): (989, 3350, 233472),
+}
+
+
+@dataclass
+class KernelFeatures:
+    """The static features of a TL program."""
+
+    grid: int = 1
+    threads: int = 1
+    # M * N of the largest gemm, i.e. the output tile computed by a block
+    tile_volume: int = 0
+    shared_bytes_per_stage: int = 0
+    num_stages: int = 1
+    fragment_bits: int = 0
+    # the flops of all the T.gemm calls of all the blocks
+    mma_flops: int = 0
+    # the global memory read and written by all the blocks
+    global_bytes: int = 0
+
+
+class _FeatureExtractor:
+    def __init__(self):
+        self.features = KernelFeatures()
+
+    def __call__(self, func: tir.PrimFunc) -> KernelFeatures:
+        self._visit(func.body, 1)
+        # the global traffic is counted per block so far
+        self.features.mma_flops *= self.features.grid
+        self.features.global_bytes *= self.features.grid
+        return self.features
+
+    @staticmethod
+    def _volume(extents):
+        volume = 1
+        for extent in extents:
+            volume *= int(extent) if isinstance(extent, tir.IntImm) else 1
+        return volume
+
+    def _global_loads(self, expr, trips):
+        def visit(node):
+            if isinstance(node, tir.BufferLoad) and node.buffer.scope() == "global":
+                self.features.global_bytes += tvm.DataType(node.buffer.dtype).bits // 8 * trips
+
+        tir.stmt_functor.post_order_visit(expr, visit)
+
+    def _visit_call(self, call, trips):
+        if not isinstance(call, tir.Call) or not isinstance(call.op, tvm.ir.Op):
+            return
+        if call.op.name in ("tl.gemm", "tl.gemm_sp"):
+            M, N, K = (int(x) for x in call.args[5:8])
+            # the sparse tensor cores skip half of the products
+            flops = 2 * M * N * K if call.op.name == "tl.gemm" else M * N * K
+            self.features.mma_flops += flops * trips
+            self.features.tile_volume = max(self.features.tile_volume, M * N)
+        elif call.op.name in ("tl.copy", "tl.atomic_add", "tl.reduce_across_blocks"):
+            for region in call.args[:2]:
+                if isinstance(region, tir.Call) and region.op.name == "tl.region":
+                    buffer = region.args[0].buffer
+                    if buffer.scope() == "global":
+                        bits = tvm.DataType(buffer.dtype).bits
+                        self.features.global_bytes += (
+                            self._volume(region.args[2:]) * bits // 8 * trips
+                        )
+
+    def _visit(self, stmt, trips):
+        features = self.features
+        if isinstance(stmt, tir.For):
+            extent = int(stmt.extent) if isinstance(stmt.extent, tir.IntImm) else 1
+            if "num_stages" in stmt.annotations:
+                features.num_stages = max(features.num_stages, int(stmt.annotations["num_stages"]))
+            self._visit(stmt.body, trips * extent)
+        elif isinstance(stmt, tir.AttrStmt):
+            if stmt.attr_key == "thread_extent" and isinstance(stmt.value, tir.IntImm):
+                if stmt.node.thread_tag == "threadIdx.x":
+                    features.threads = int(stmt.value)
+                elif stmt.node.thread_tag.startswith("blockIdx"):
+                    features.grid *= int(stmt.value)
+            self._visit(stmt.body, trips)
+        elif isinstance(stmt, tir.SeqStmt):
+            for s in stmt.seq:
+                self._visit(s, trips)
+        elif isinstance(stmt, tir.BlockRealize):
+            self._visit(stmt.block, trips)
+        elif isinstance(stmt, tir.Block):
+            for buffer in stmt.alloc_buffers:
+                bits = self._volume(buffer.shape) * tvm.DataType(buffer.dtype).bits
+                if buffer.scope() in ("shared", "shared.dyn"):
+                    features.shared_bytes_per_stage += bits // 8
+                elif buffer.scope() == "local.fragment":
+                    features.fragment_bits += bits
+            self._visit(stmt.body, trips)
+        elif isinstance(stmt, tir.IfThenElse):
+            self._visit(stmt.then_case, trips)
+            if stmt.else_case is not None:
+                self._visit(stmt.else_case, trips)
+        elif isinstance(stmt, (tir.LetStmt, tir.Allocate, tir.DeclBuffer, tir.AssertStmt)):
+            self._visit(stmt.body, trips)
+        elif isinstance(stmt, tir.BufferStore):
+            if stmt.buffer.scope() == "global":
+                features.global_bytes += tvm.DataType(stmt.buffer.dtype).bits // 8 * trips
+            self._global_loads(stmt.value, trips)
+        elif isinstance(stmt, tir.Evaluate):
+            self._visit_call(stmt.value, trips)
+
+
+def extract_features(func: tir.PrimFunc) -> KernelFeatures:
+    """Extract the static features of a TL program."""
+    return _FeatureExtractor()(func)
+
+
+class CostModel:
+    """Predict the latency of a TL program with a roofline model.
+
+    The compute time of the mma flops and the memory time of the global traffic overlap when the
+    program is pipelined, the blocks are scheduled in waves with the occupancy bounded by the
+    threads, the shared memory and the fragment registers of a block.
+
+    Parameters
+    ----------
+    peak_tflops, bandwidth_gbps, shared_memory_per_sm : Optional
+        The specs of the GPU, default to the specs of the current GPU's architecture.
+    """
+
+    def __init__(
+        self,
+        peak_tflops: Optional[float] = None,
+        bandwidth_gbps: Optional[float] = None,
+        shared_memory_per_sm: Optional[int] = None,
+    ):
+        prop = torch.cuda.get_device_properties(torch.cuda.current_device())
+        specs = _DEVICE_SPECS.get((prop.major, prop.minor), (100, 1000, 65536))
+        self.peak_tflops = peak_tflops or specs[0]
+        self.bandwidth_gbps = bandwidth_gbps or specs[1]
+        self.shared_memory_per_sm = shared_memory_per_sm or specs[2]
+        self.num_sms = prop.multi_processor_count
+        self.max_threads_per_sm = prop.max_threads_per_multi_processor
+        self.registers_per_sm = 65536
+
+    def occupancy(self, features: KernelFeatures) -> int:
+        """The estimated number of resident blocks per SM."""
+        blocks = self.max_threads_per_sm // features.threads
+        shared = features.shared_bytes_per_stage * features.num_stages
+        if shared > 0:
+            blocks = min(blocks, self.shared_memory_per_sm // shared)
+        # the fragments plus a fixed overhead of the addresses and the loop variables
+        registers = features.fragment_bits // 32 // features.threads + 32
+        blocks = min(blocks, self.registers_per_sm // (registers * features.threads))
+        return max(blocks, 0)
+
+    def predict(self, func: tir.PrimFunc) -> float:
+        """The predicted latency in ms, inf if the program can't be launched."""
+        features = extract_features(func)
+        occupancy = self.occupancy(features)
+        if occupancy == 0:
+            return math.inf
+        compute = features.mma_flops / (self.peak_tflops * 1e12)
+        memory = features.global_bytes / (self.bandwidth_gbps * 1e9)
+        latency = max(compute, memory) if features.num_stages > 1 else compute + memory
+        # the last partial wave leaves SMs idle
+        concurrent = self.num_sms * occupancy
+        waves = math.ceil(features.grid / concurrent)
+        latency *= waves * concurrent / features.grid
+        return latency * 1e3
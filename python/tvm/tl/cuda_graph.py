@@ -0,0 +1,83 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Capture a sequence of TL kernel calls into a CUDA graph and replay it."""
+
+from typing import Any, Callable
+
+import torch
+
+
+class CUDAGraph:
+    """A fixed sequence of TL module calls replayed with a single graph launch.
+
+    func is called with the static input tensors, typically a function calling several
+    ConvertTorch/Profiler objects. The calls are recorded once and __call__ replays them, which
+    removes the packing of the arguments and the kernel launch of every call on the host.
+
+    Example
+    -------
+    .. code-block:: python
+
+        def step(x, w0, w1):
+            return mod1(mod0(x, w0), w1)
+
+        graph = tl.CUDAGraph(step, x, w0, w1)
+        out = graph(x_next, w0, w1)
+
+    The kernels read the addresses of the tensors recorded at capture time. Calling the graph
+    with other tensors copies them into the static inputs, use update() to record the graph again
+    on new tensors instead (e.g. large weights that should not be copied).
+    """
+
+    def __init__(self, func: Callable, *inputs: torch.Tensor, warmup: int = 1):
+        self.func = func
+        self.warmup = warmup
+        self.capture(*inputs)
+
+    def capture(self, *inputs: torch.Tensor):
+        """Record the calls of func on the inputs, the inputs become the static inputs."""
+        self.static_inputs = list(inputs)
+        stream = torch.cuda.Stream()
+        stream.wait_stream(torch.cuda.current_stream())
+        # the first launches load the modules and set the shared memory of the kernels, which can
+        # not be done during the capture
+        with torch.cuda.stream(stream):
+            for _ in range(self.warmup):
+                self.func(*self.static_inputs)
+        torch.cuda.current_stream().wait_stream(stream)
+
+        self.graph = torch.cuda.CUDAGraph()
+        with torch.cuda.graph(self.graph, stream=stream):
+            outs = self.func(*self.static_inputs)
+        self.static_outputs = outs
+        return outs
+
+    def update(self, *inputs: torch.Tensor):
+        """Record the graph again with new input tensors, i.e. update the recorded pointers."""
+        return self.capture(*inputs)
+
+    def replay(self):
+        """Replay the recorded calls on the static inputs."""
+        self.graph.replay()
+        return self.static_outputs
+
+    def __call__(self, *inputs: torch.Tensor) -> Any:
+        assert len(inputs) in (0, len(self.static_inputs))
+        for dst, src in zip(self.static_inputs, inputs):
+            if dst.data_ptr() != src.data_ptr():
+                dst.copy_(src)
+        return self.replay()
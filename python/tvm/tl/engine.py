@@ -16,11 +16,22 @@
 # under the License.
 """The compiler for TL programs."""
 
+import contextlib
+import hashlib
+import logging
 import os
 import os.path as osp
+import re
+import resource
+import subprocess
+import tempfile
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+from typing import Any, Dict, List, Optional, Union
 import tvm
 from tvm import tir, tl, relay
-from tvm.contrib import nvcc
+from tvm.contrib import nvcc, rocm
 
 
 def is_device_call(func: tir.PrimFunc):
@@ -31,8 +42,7 @@ def is_host_call(func: tir.PrimFunc):
     return not is_device_call(func)
 
 
-@tvm.register_func("tvm_tl_cuda_compile", override=True)
-def tvm_callback_cuda_compile(code, target):
+def _get_cuda_compile_options(target):
     tvm_root = osp.join(osp.dirname(__file__), "../../..")
     tl_template_path = osp.abspath(osp.join(tvm_root, "src/tl"))
     if "TL_CUTLASS_PATH" in os.environ:
@@ -40,39 +50,538 @@ def tvm_callback_cuda_compile(code, target):
     else:
         cutlass_path = osp.abspath(osp.join(tvm_root, "3rdparty/cutlass/include"))
     compute_version = "".join(nvcc.get_target_compute_version(target).split("."))
+    # wgmma and setmaxnreg are only available on the arch-specific sm_90a target
+    if compute_version == "90":
+        compute_version = "90a"
     arch = [f"-arch=sm_{compute_version}"]
-    ptx = nvcc.compile_cuda(
-        code,
-        "ptx",
-        arch,
-        options=[
-            "-std=c++17",
-            "--use_fast_math",
-            "-I" + tl_template_path,
-            "-I" + cutlass_path,
-        ],
+    pass_ctx = tvm.transform.PassContext.current()
+    archs = [int(a) for a in pass_ctx.config.get("tl.cuda_archs", [])]
+    if archs:
+        # a fat binary with the SASS of each arch, the driver loads the one of the device, and the
+        # PTX of the newest arch for the later ones
+        target_arch = int(compute_version.rstrip("a"))
+        arch_specific = compute_version.endswith("a")
+        for a in archs:
+            if a < target_arch:
+                raise ValueError(
+                    f"The kernels are generated for sm_{compute_version}, they can not run on "
+                    f"sm_{a} of tl.cuda_archs. Lower them for the oldest arch instead."
+                )
+            if arch_specific and a != target_arch:
+                raise ValueError(
+                    f"The kernels are generated for sm_{compute_version}, whose instructions "
+                    f"(wgmma, setmaxnreg) only run on sm_{target_arch}, not on sm_{a} of "
+                    "tl.cuda_archs."
+                )
+        suffix = "a" if arch_specific else ""
+        versions = [f"{a}{suffix}" for a in sorted(set(archs + [target_arch]))]
+        arch = [f"-gencode=arch=compute_{v},code=sm_{v}" for v in versions]
+        # the PTX of an arch-specific target is not forward compatible
+        if not arch_specific:
+            arch.append(f"-gencode=arch=compute_{versions[-1]},code=compute_{versions[-1]}")
+    options = [
+        "-std=c++17",
+        "--use_fast_math",
+        "-I" + tl_template_path,
+        "-I" + cutlass_path,
+    ]
+    return arch, options, tl_template_path, cutlass_path
+
+
+logger = logging.getLogger(__name__)
+
+# the ptxas reports of the kernels being compiled, read back by the codegen with the code
+_ptxas_reports: Dict[str, str] = {}
+_ptxas_reports_lock = threading.Lock()
+
+
+def _compile_cubin(code, arch, options):
+    """Compile to a cubin (a fatbin with several archs) with the resource usage of the kernels
+    printed by ptxas."""
+    target_format = "fatbin" if len(arch) > 1 else "cubin"
+    with tempfile.TemporaryDirectory(prefix="tl_nvcc_") as tmp_dir:
+        src_path = osp.join(tmp_dir, "kernel.cu")
+        out_path = osp.join(tmp_dir, "kernel." + target_format)
+        with open(src_path, "w") as f:
+            f.write(code)
+        cmd = ["nvcc", "--" + target_format, "-O3", "-Xptxas", "-v"] + arch + options
+        proc = subprocess.run(cmd + ["-o", out_path, src_path], capture_output=True, text=True)
+        if proc.returncode != 0:
+            raise RuntimeError(code + "\nCompilation error:\n" + proc.stdout + proc.stderr)
+        with open(out_path, "rb") as f:
+            cubin = f.read()
+    return bytearray(cubin), proc.stdout + proc.stderr
+
+
+def parse_ptxas_report(log: str) -> Dict[str, Dict[str, int]]:
+    """The registers, stack frame and spill bytes of the kernels from a ptxas -v log."""
+    usage = {}
+    kernel = None
+    for line in log.splitlines():
+        match = re.search(r"(?:Compiling entry function|Function properties for) '?(\w+)'?", line)
+        if match:
+            kernel = match.group(1)
+            usage.setdefault(kernel, {})
+            arch = re.search(r"for 'sm_(\d+)", line)
+            if arch:
+                usage[kernel]["arch"] = int(arch.group(1))
+            continue
+        if kernel is None:
+            continue
+        match = re.search(r"(\d+) bytes stack frame, (\d+) bytes spill stores, (\d+) bytes", line)
+        if match:
+            usage[kernel]["stack_frame"] = int(match.group(1))
+            usage[kernel]["spill_stores"] = int(match.group(2))
+            usage[kernel]["spill_loads"] = int(match.group(3))
+        match = re.search(r"Used (\d+) registers", line)
+        if match:
+            usage[kernel]["registers"] = int(match.group(1))
+    return usage
+
+
+def get_resource_usage(mod) -> Dict[str, Dict[str, int]]:
+    """The ptxas resource usage of the kernels of a module returned by lower, recorded at the end
+    of the kernel source (empty with NVRTC or when the report is disabled)."""
+    for device_mod in mod.imported_modules:
+        if device_mod.type_key == "cuda":
+            return parse_ptxas_report(device_mod.get_source())
+    return {}
+
+
+# the max threads, max blocks and shared memory bytes of an SM per arch
+_SM_LIMITS = {
+    70: (2048, 32, 96 << 10),
+    75: (1024, 16, 64 << 10),
+    80: (2048, 32, 164 << 10),
+    86: (1536, 16, 100 << 10),
+    87: (2048, 16, 164 << 10),
+    89: (1536, 24, 100 << 10),
+    90: (2048, 32, 228 << 10),
+}
+
+
+def get_occupancy(mod) -> Dict[str, Dict[str, int]]:
+    """The occupancy of the kernels of a module returned by lower, from the registers of the
+    ptxas report and the threads and shared memory of the kernels.
+
+    Returns, for each kernel, the threads, registers (per thread), shared_memory (bytes per block)
+    and min_blocks_per_sm of the kernel, the resident blocks_per_sm, the occupancy (the ratio of
+    the resident warps to the max warps of the SM) and the resource limiting it.
+    """
+    source = ""
+    for device_mod in mod.imported_modules:
+        if device_mod.type_key == "cuda":
+            source = device_mod.get_source()
+    usage = parse_ptxas_report(source)
+    results = {}
+    pattern = r"tl info : (\w+): (\d+) threads, (\d+) min blocks per SM, (\d+) bytes shared"
+    for kernel, threads, min_blocks, shared in re.findall(pattern, source):
+        threads, min_blocks, shared = int(threads), int(min_blocks), int(shared)
+        kernel_usage = usage.get(kernel, {})
+        arch = kernel_usage.get("arch", 80)
+        max_threads, max_blocks, shared_per_sm = _SM_LIMITS[max(a for a in _SM_LIMITS if a <= arch)]
+        warps = (threads + 31) // 32
+        limits = {"blocks": max_blocks, "threads": max_threads // (warps * 32)}
+        registers = kernel_usage.get("registers")
+        if registers:
+            # the registers are allocated per warp by 256
+            limits["registers"] = 65536 // ((registers * 32 + 255) // 256 * 256) // warps
+        if shared:
+            reserved = 1024 if arch >= 80 else 0
+            limits["shared_memory"] = shared_per_sm // (shared + reserved)
+        limiter = min(limits, key=limits.get)
+        results[kernel] = {
+            "threads": threads,
+            "registers": registers,
+            "shared_memory": shared,
+            "min_blocks_per_sm": min_blocks,
+            "blocks_per_sm": limits[limiter],
+            "occupancy": limits[limiter] * warps * 32 / max_threads,
+            "limiter": limiter,
+        }
+    return results
+
+
+def _parse_dims(text: str):
+    """The dims of a tl launch comment, the symbolic ones (dynamic shapes) kept as strings."""
+    dims, depth, start = [], 0, 0
+    for i, c in enumerate(text + ","):
+        depth += {"(": 1, ")": -1}.get(c, 0)
+        if c == "," and depth == 0:
+            dim = text[start:i].strip()
+            dims.append(int(dim) if dim.isdigit() else dim)
+            start = i + 1
+    return tuple(dims)
+
+
+def get_kernel_metadata(mod) -> Dict[str, Dict[str, Any]]:
+    """The static metadata of the kernels of a module returned by lower, known without running
+    them: the grid and block dims, the shared memory bytes per block, the min blocks per SM of the
+    launch bounds, the stages of the software pipelines and the registers per thread estimated for
+    the local arrays (local_registers), with the registers, stack frame and spills of the ptxas
+    report when available.
+    """
+    source = ""
+    for device_mod in mod.imported_modules:
+        if device_mod.type_key == "cuda":
+            source = device_mod.get_source()
+    results = {}
+    pattern = r"tl info : (\w+): (\d+) threads, (\d+) min blocks per SM, (\d+) bytes shared"
+    for kernel, threads, min_blocks, shared in re.findall(pattern, source):
+        results[kernel] = {
+            "threads": int(threads),
+            "min_blocks_per_sm": int(min_blocks),
+            "shared_memory": int(shared),
+        }
+    pattern = (
+        r"tl launch : (\w+): grid \((.*)\), block \((.*)\), (\d+) local registers, "
+        r"pipeline stages \[(.*)\]"
     )
-    return ptx
+    for kernel, grid, block, local_registers, stages in re.findall(pattern, source):
+        results.setdefault(kernel, {}).update(
+            {
+                "grid": _parse_dims(grid),
+                "block": _parse_dims(block),
+                "local_registers": int(local_registers),
+                "pipeline_stages": [int(s) for s in stages.split(",") if s.strip()],
+            }
+        )
+    for kernel, usage in parse_ptxas_report(source).items():
+        if kernel in results:
+            results[kernel].update(usage)
+    return results
+
+
+@tvm.register_func("tvm_tl_cuda_compile", override=True)
+def tvm_callback_cuda_compile(code, target):
+    arch, options, _, _ = _get_cuda_compile_options(target)
+    pass_ctx = tvm.transform.PassContext.current()
+    if not pass_ctx.config.get("tl.ptxas_report", True):
+        return nvcc.compile_cuda(code, "fatbin" if len(arch) > 1 else "ptx", arch, options=options)
+    cubin, log = _compile_cubin(code, arch, options)
+    report = [line for line in log.splitlines() if "ptxas" in line or "bytes stack frame" in line]
+    for kernel, usage in parse_ptxas_report(log).items():
+        if usage.get("spill_stores", 0) or usage.get("spill_loads", 0):
+            logger.warning(
+                "%s uses %d registers and spills %d bytes (stores) / %d bytes (loads)",
+                kernel,
+                usage.get("registers", 0),
+                usage["spill_stores"],
+                usage["spill_loads"],
+            )
+    with _ptxas_reports_lock:
+        _ptxas_reports[code] = "".join("\n// " + line.strip() for line in report)
+    return cubin
+
+
+@tvm.register_func("tvm_tl_cuda_compile_report", override=True)
+def tvm_callback_cuda_compile_report(code):
+    """The ptxas report of the code compiled by tvm_tl_cuda_compile, appended to the source of
+    the module as comments."""
+    with _ptxas_reports_lock:
+        return _ptxas_reports.pop(code, "")
+
+
+@tvm.register_func("tvm_tl_cuda_compile_options", override=True)
+def tvm_callback_cuda_compile_options(target):
+    """The nvcc style options used by the NVRTC compiler (pass config tl.use_nvrtc)."""
+    arch, options, _, _ = _get_cuda_compile_options(target)
+    if len(arch) > 1:
+        raise ValueError("NVRTC compiles for one arch, tl.cuda_archs needs nvcc")
+    return arch + options
+
+
+_compile_key_cache = {}
+
+
+def _compiler_identity():
+    """The git commit of libtvm and the size and the modification time of the library, which
+    change with every rebuild of the code generator and the passes, local changes included."""
+    identity = tvm.support.libinfo().get("GIT_COMMIT_HASH", "")
+    lib_path = getattr(tvm._ffi.base._LIB, "_name", None)
+    if lib_path and osp.exists(lib_path):
+        stat = os.stat(lib_path)
+        identity += f" {stat.st_size} {stat.st_mtime_ns}"
+    return identity
+
+
+@tvm.register_func("tvm_tl_cuda_compile_key", override=True)
+def tvm_callback_cuda_compile_key(target):
+    """The key of the kernel cache besides the device module, which changes with the libtvm
+    build, the nvcc version and options, the tl templates and the CUTLASS headers."""
+    arch, options, tl_template_path, cutlass_path = _get_cuda_compile_options(target)
+    # the arch flags cover the tl.cuda_archs of the current PassContext
+    cache_key = (str(target), tuple(arch), tl_template_path, cutlass_path)
+    if cache_key not in _compile_key_cache:
+        hasher = hashlib.sha256()
+        hasher.update(_compiler_identity().encode())
+        hasher.update(" ".join(arch + options).encode())
+        try:
+            nvcc_version = subprocess.run(["nvcc", "--version"], capture_output=True, check=False)
+            hasher.update(nvcc_version.stdout)
+        except OSError:
+            pass
+        # the headers of the subdirectories too (e.g. hip/), in a stable order
+        template_dir = osp.join(tl_template_path, "tl_templates")
+        for root, dirs, files in os.walk(template_dir):
+            dirs.sort()
+            for name in sorted(files):
+                path = osp.join(root, name)
+                if not osp.isfile(path):
+                    continue
+                hasher.update(osp.relpath(path, template_dir).encode())
+                with open(path, "rb") as f:
+                    hasher.update(f.read())
+        cutlass_version = osp.join(cutlass_path, "cutlass/version.h")
+        if osp.exists(cutlass_version):
+            with open(cutlass_version, "rb") as f:
+                hasher.update(f.read())
+        _compile_key_cache[cache_key] = hasher.hexdigest()
+    return _compile_key_cache[cache_key]
+
+
+def _get_hip_compile_options(target):
+    tvm_root = osp.join(osp.dirname(__file__), "../../..")
+    tl_template_path = osp.abspath(osp.join(tvm_root, "src/tl"))
+    return [
+        "-std=c++17",
+        "-O3",
+        "-ffast-math",
+        f"--offload-arch={target.mcpu}",
+        "-I" + tl_template_path,
+    ]
+
+
+@tvm.register_func("tvm_tl_hip_compile", override=True)
+def tvm_callback_hip_compile(code, target):
+    """Compile the HIP source of the ROCm targets to a code object (hsaco) with hipcc."""
+    hipcc = osp.join(rocm.find_rocm_path(), "bin/hipcc")
+    with tempfile.TemporaryDirectory(prefix="tl_hipcc_") as tmp_dir:
+        src_path = osp.join(tmp_dir, "kernel.hip")
+        out_path = osp.join(tmp_dir, "kernel.hsaco")
+        with open(src_path, "w") as f:
+            f.write(code)
+        cmd = [hipcc, "--genco"] + _get_hip_compile_options(target)
+        proc = subprocess.run(cmd + ["-o", out_path, src_path], capture_output=True, text=True)
+        if proc.returncode != 0:
+            raise RuntimeError(code + "\nCompilation error:\n" + proc.stdout + proc.stderr)
+        with open(out_path, "rb") as f:
+            hsaco = f.read()
+    return bytearray(hsaco)
 
 
 def extrac_params(func: tir.PrimFunc):
-    buffers = [func.buffer_map[var] for var in func.params]
-    tensor_types = [relay.TensorType(buffer.shape, buffer.dtype) for buffer in buffers]
+    tensor_types = []
+    for var in func.params:
+        if var in func.buffer_map:
+            buffer = func.buffer_map[var]
+            tensor_types.append(relay.TensorType(buffer.shape, buffer.dtype))
+        else:
+            # the scalar parameters, passed by value
+            tensor_types.append(relay.TensorType([], var.dtype))
     return tensor_types
 
 
-def lower(func):
+def specialize_func(func: tir.PrimFunc, values: Dict[str, Any]) -> tir.PrimFunc:
+    """Fold the values of some scalar parameters or dynamic dimensions of the buffers, by name,
+    into the program with PrimFunc.specialize. The specialized scalar parameters are removed from
+    the parameters, the dynamic dimensions are checked against the values at the calls."""
+    names = set(values)
+    shape_vars = {}
+    for buffer in func.buffer_map.values():
+        for dim in buffer.shape:
+            if isinstance(dim, tir.Var) and dim.name in names:
+                shape_vars[dim] = tir.const(values[dim.name], dim.dtype)
+    param_map = {}
+    for var in func.params:
+        if var not in func.buffer_map:
+            if var.name in names:
+                param_map[var] = tir.const(values[var.name], var.dtype)
+            continue
+        buffer = func.buffer_map[var]
+        if not any(isinstance(dim, tir.Var) and dim in shape_vars for dim in buffer.shape):
+            continue
+        param_map[var] = tir.decl_buffer(
+            [tir.stmt_functor.substitute(dim, shape_vars) for dim in buffer.shape],
+            buffer.dtype,
+            buffer.name,
+            strides=[tir.stmt_functor.substitute(x, shape_vars) for x in buffer.strides],
+            elem_offset=buffer.elem_offset,
+            scope=buffer.scope(),
+            data_alignment=buffer.data_alignment,
+            offset_factor=buffer.offset_factor,
+        )
+    bound = {var.name for var in param_map if var not in func.buffer_map}
+    bound |= {var.name for var in shape_vars}
+    assert bound == names, "No scalar parameter or dynamic dimension named {}".format(
+        sorted(names - bound)
+    )
+    return func.specialize(param_map)
+
+
+def _count_ir_nodes(mod) -> int:
+    """The number of statements and expressions of the PrimFuncs of the module."""
+    count = 0
+
+    def visit(_):
+        nonlocal count
+        count += 1
+
+    for func in mod.functions.values():
+        if isinstance(func, tir.PrimFunc):
+            tir.stmt_functor.post_order_visit(func.body, visit)
+    return count
+
+
+class CompileProfile:
+    """The compile time of a TL program in lower, per pass and per codegen step.
+
+    Each record holds the name of the step, its wall time in seconds, the number of IR nodes of
+    the module after it (None for the codegen) and the peak resident memory of the process in MiB
+    after it. The IR is counted outside of the timed sections.
+    """
+
+    def __init__(self, kernel: str = ""):
+        self.kernel = kernel
+        self.records: List[Dict[str, Any]] = []
+        self.total_seconds = 0.0
+
+    def add(self, name: str, seconds: float, ir_nodes: Optional[int] = None):
+        peak_mb = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss / 1024
+        self.records.append(
+            {"name": name, "seconds": seconds, "ir_nodes": ir_nodes, "peak_rss_mb": peak_mb}
+        )
+
+    @contextlib.contextmanager
+    def timed(self, name: str):
+        """Record the wall time of the enclosed step."""
+        start = time.perf_counter()
+        yield
+        self.add(name, time.perf_counter() - start)
+
+    def by_pass(self) -> Dict[str, float]:
+        """The total seconds of each pass, summed over its runs."""
+        totals: Dict[str, float] = {}
+        for record in self.records:
+            totals[record["name"]] = totals.get(record["name"], 0.0) + record["seconds"]
+        return totals
+
+    def to_dict(self) -> Dict[str, Any]:
+        return {"kernel": self.kernel, "total_seconds": self.total_seconds, "steps": self.records}
+
+    def table(self) -> str:
+        """The records as a text table, in the order of the passes."""
+        lines = [
+            f"compile profile of {self.kernel}: {self.total_seconds * 1e3:.1f} ms",
+            f"{'step':<44}{'ms':>10}{'%':>7}{'IR nodes':>10}{'peak MiB':>10}",
+        ]
+        total = max(self.total_seconds, 1e-9)
+        for record in self.records:
+            nodes = "" if record["ir_nodes"] is None else str(record["ir_nodes"])
+            lines.append(
+                f"{record['name']:<44}{record['seconds'] * 1e3:>10.2f}"
+                f"{record['seconds'] / total:>7.1%}{nodes:>10}{record['peak_rss_mb']:>10.0f}"
+            )
+        return "\n".join(lines)
+
+
+@tvm.instrument.pass_instrument
+class _PassProfiler:
+    """Records the passes run in its PassContext into a CompileProfile."""
+
+    def __init__(self, profile: CompileProfile):
+        self.profile = profile
+        self.starts = []
+
+    def run_before_pass(self, mod, info):
+        self.starts.append(time.perf_counter())
+
+    def run_after_pass(self, mod, info):
+        seconds = time.perf_counter() - self.starts.pop()
+        self.profile.add(info.name, seconds, _count_ir_nodes(mod))
+
+
+@contextlib.contextmanager
+def _profiling(profile: CompileProfile):
+    """The current pass context with the pass profiler of profile added to its instruments."""
+    ctx = tvm.transform.PassContext.current()
+    instruments = list(ctx.instruments) + [_PassProfiler(profile)]
+    with tvm.transform.PassContext(
+        opt_level=ctx.opt_level,
+        required_pass=list(ctx.required_pass),
+        disabled_pass=list(ctx.disabled_pass),
+        instruments=instruments,
+        config=dict(ctx.config),
+    ):
+        start = time.perf_counter()
+        yield
+        profile.total_seconds = time.perf_counter() - start
+
+
+def _lower_cpu(mod, target):
+    """The tile ops lowered to loops, the blocks of T.Kernel running in parallel on the TVM thread
+    pool, then the default TIR pipeline and the LLVM codegen of tvm.build."""
+    mod = tl.transform.FrontendLegalize()(mod)
+    mod = tir.transform.Simplify()(mod)
+    mod = tl.transform.LowerTileOpCPU()(mod)
+    mod = tir.transform.Simplify()(mod)
+    return tvm.build(mod, target=target)
+
+
+def lower(
+    func,
+    target="cuda",
+    specialize=None,
+    profile: Union[bool, CompileProfile, None] = None,
+    share_iter_maps: bool = True,
+):
+    """Compile a TL program for target, "cuda", "rocm" (CDNA, e.g. "rocm -mcpu=gfx90a") or "llvm"
+    (the CPU, e.g. "llvm -mcpu=sapphirerapids"). specialize maps the names of scalar parameters or
+    dynamic dimensions to the values folded into the program, see specialize_func.
+
+    With profile, the wall time, the IR size and the peak memory of each pass and codegen step are
+    recorded (see CompileProfile): profile=True prints their table, a CompileProfile is filled for
+    the caller to report.
+
+    With share_iter_maps, the passes reuse each other's detections of the iter maps of the layouts
+    and the tile ops, see tvm.arith.IterMapCacheScope."""
+    scope = tvm.arith.IterMapCacheScope() if share_iter_maps else contextlib.nullcontext()
+    with scope:
+        if profile:
+            record = profile if isinstance(profile, CompileProfile) else CompileProfile()
+            record.kernel = record.kernel or str(func.attrs["global_symbol"])
+            with _profiling(record):
+                result = _lower(func, target, specialize, record)
+            if profile is True:
+                print(record.table())
+            return result
+        return _lower(func, target, specialize, None)
+
+
+def _lower(func, target, specialize, profile: Optional[CompileProfile]):
+    timed = profile.timed if profile else lambda _: contextlib.nullcontext()
+    if specialize:
+        func = specialize_func(func, specialize)
     params = extrac_params(func)
     mod = tvm.IRModule({func.attrs["global_symbol"]: func})
 
     target_host = tvm.target.Target("llvm -keys=cpu")
-    target = tvm.target.Target("cuda", target_host)
+    target = tvm.target.Target(target, target_host)
     mod = tir.transform.BindTarget(target)(mod)
+    if target.kind.name == "llvm":
+        with timed("codegen.llvm"):
+            return _lower_cpu(mod, target), params
 
+    mod = tl.transform.RasterizationPlanning()(mod)
     mod = tl.transform.FrontendLegalize()(mod)
+    mod = tl.transform.BoundarySpecialize()(mod)
     mod = tir.transform.Simplify()(mod)
+    mod = tl.transform.PersistentKernel()(mod)
+    mod = tl.transform.ClusterPlanning()(mod)
+    mod = tl.transform.PlanNumStages()(mod)
     mod = tl.transform.LayoutInference()(mod)
     mod = tl.transform.LowerTileOp()(mod)
+    mod = tl.transform.WarpSpecialized()(mod)
 
     mod = tir.transform.PlanAndUpdateBufferAllocationLocation()(mod)
     mod = tl.transform.PipelinePlanning()(mod)
@@ -85,17 +594,22 @@ def lower(func):
     mod = tir.transform.VectorizeLoop()(mod)
     mod = tir.transform.StorageRewrite()(mod)
     mod = tir.transform.UnrollLoop()(mod)
+    mod = tl.transform.PromoteLocalArray()(mod)
     mod = tir.transform.RenormalizeSplitPattern()(mod)
     mod = tir.transform.Simplify()(mod)
     mod = tir.transform.RemoveNoOp()(mod)
     mod = tir.transform.RewriteUnsafeSelect()(mod)
     mod = tir.transform.HoistIfThenElse()(mod)
+    # after the unrolling, so that each timer binds its own start variables
+    mod = tl.transform.InstrumentTiming()(mod)
 
     mod = tir.transform.VerifyMemory()(mod)
     mod = tir.transform.AnnotateEntryFunc()(mod)
     mod = tir.transform.ThreadSync("shared")(mod)
     mod = tir.transform.ThreadSync("shared.dyn")(mod)
-    mod = tir.transform.MergeDynamicSharedMemoryAllocations()(mod)
+    mod = tl.transform.SharedMemoryReuse()(mod)
+    # the swizzled tma boxes of the functions not planned by the reuse pass need 1024B alignment
+    mod = tir.transform.MergeDynamicSharedMemoryAllocations(align_bytes=1024)(mod)
     mod = tir.transform.InjectPTXAsyncCopy()(mod)
 
     mod = tir.transform.AnnotateDeviceRegions()(mod)
@@ -105,6 +619,9 @@ def lower(func):
 
     host_mod = tir.transform.Filter(is_host_call)(mod)
     host_mod = tir.transform.BindTarget(target_host)(host_mod)
+    pass_ctx = tvm.transform.PassContext.current()
+    if pass_ctx.config.get("tl.disable_host_checks", False):
+        host_mod = tir.transform.SkipAssert()(host_mod)
     host_mod = tir.transform.FP8StorageLegalize()(host_mod)
     host_mod = tir.transform.BF16StorageLegalize()(host_mod)
     host_mod = tir.transform.LowerTVMBuiltin()(host_mod)
@@ -112,15 +629,61 @@ def lower(func):
     host_mod = tir.transform.LowerIntrin()(host_mod)
     host_mod = tir.transform.LowerDeviceStorageAccessInfo()(host_mod)
     host_mod = tir.transform.CombineContextCall()(host_mod)
-    host_mod = tvm._ffi.get_global_func("target.build.llvm")(host_mod, target)
+    with timed("codegen.host"):
+        host_mod = tvm._ffi.get_global_func("target.build.llvm")(host_mod, target)
 
     device_mod = tir.transform.Filter(is_device_call)(mod)
+    device_mod = tl.transform.EstimateRegisterUsage()(device_mod)
     device_mod = tir.transform.LowerDeviceStorageAccessInfo()(device_mod)
     device_mod = tir.transform.LowerIntrin()(device_mod)
     device_mod = tir.transform.Simplify()(device_mod)
+    device_mod = tl.transform.HoistIndex()(device_mod)
     # code = tvm._ffi.get_global_func("target.build.tl_debug_codegen")(device_mod, target)
     # print(code)
-    device_mod = tvm._ffi.get_global_func("target.build.tl")(device_mod, target)
+    with timed("codegen.device"):
+        device_mod = tvm._ffi.get_global_func("target.build.tl")(device_mod, target)
 
     host_mod.import_module(device_mod)
     return host_mod, params
+
+
+def lower_many(funcs, workers=None, return_exceptions=False):
+    """Lower and compile a list of TL programs concurrently.
+
+    The passes and the codegen release the GIL in the C++ side, and nvcc runs in subprocesses,
+    so a thread pool keeps all the workers busy. The NVRTC compilations sharing the precompiled
+    headers (CUDA 12.1+) are serialized. The pass context of the caller is used by all the
+    workers.
+
+    Parameters
+    ----------
+    funcs : List[tir.PrimFunc]
+        The programs to compile.
+    workers : Optional[int]
+        The number of worker threads, defaults to the number of CPUs.
+    return_exceptions : bool
+        Return the exception in place of the result of a program failing to compile, instead of
+        raising it.
+
+    Returns
+    -------
+    results : List[Tuple[tvm.runtime.Module, List[relay.TensorType]]]
+        The results of lower, in the order of funcs.
+    """
+    pass_ctx = tvm.transform.PassContext.current()
+
+    def run(func):
+        with pass_ctx:
+            return lower(func)
+
+    results = [None] * len(funcs)
+    with ThreadPoolExecutor(max_workers=workers or os.cpu_count()) as executor:
+        futures = {executor.submit(run, func): idx for idx, func in enumerate(funcs)}
+        for future, idx in futures.items():
+            try:
+                results[idx] = future.result()
+            except Exception as err:  # pylint: disable=broad-except
+                if not return_exceptions:
+                    raise
+                results[idx] = err
+    return results
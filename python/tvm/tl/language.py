@@ -16,11 +16,13 @@
 # under the License.
 """The language interface for tl programs."""
 
-from typing import Union, List
-from tvm import tir
+from functools import partial
+from typing import Callable, List, Optional, Tuple, Union
+import tvm
+from tvm import arith, ir, tir
 from tvm.script import tir as T
 from tvm.script.parser.tir import *
-from tvm.script.ir_builder.tir.frame import TIRFrame
+from tvm.script.ir_builder.tir.frame import LaunchThreadFrame, TIRFrame
 from tvm._ffi import register_object
 from . import _ffi_api
 from .layout import Layout, Fragment
@@ -43,7 +45,12 @@ def Parallel(*extents: tir.PrimExpr):
     return _ffi_api.Parallel(extents)  # type: ignore[attr-defined] # pylint: disable=no-member
 
 
-def Pipelined(start: tir.PrimExpr, stop: tir.PrimExpr = None, num_stages: int = 0):
+def Pipelined(
+    start: tir.PrimExpr,
+    stop: tir.PrimExpr = None,
+    num_stages: Union[int, str] = 0,
+    mode: str = "default",
+):
     """Tools to construct pipelined for loop.
 
     Parameters
@@ -52,9 +59,15 @@ def Pipelined(start: tir.PrimExpr, stop: tir.PrimExpr = None, num_stages: int =
         The minimum value of iteration.
     stop : PrimExpr
         The maximum value of iteration.
-    num_stages : int
+    num_stages : Union[int, str]
         The max number of buffer used between pipeline producers and consumers.
-        if num_stages is 0, pipeline will not be enabled.
+        if num_stages is 0, pipeline will not be enabled. "auto" sizes it from the shared
+        memory of the target, and prefetches the copies from the shared memory to the
+        registers one iteration ahead.
+    mode : str
+        "default" runs the pipeline stages on all the threads. "warp_specialized" adds a
+        producer warpgroup issuing the TMA copies while the original threads consume the
+        data (sm_90 only).
     Returns
     -------
     res : frame.ForFrame
@@ -66,20 +79,33 @@ def Pipelined(start: tir.PrimExpr, stop: tir.PrimExpr = None, num_stages: int =
             start = IntImm(start.dtype, 0)
         else:
             start = 0
+    if num_stages == "auto":
+        num_stages = -1
     # type: ignore[attr-defined] # pylint: disable=no-member
-    return _ffi_api.Pipelined(start, stop, num_stages)
+    return _ffi_api.Pipelined(start, stop, num_stages, mode)
 
 
 @register_object("tl.KernelLaunchFrame")
 class KernelLaunchFrame(TIRFrame):
     def __enter__(self) -> Union[Var, List[Var]]:  # type: ignore[override]
         super().__enter__()
-        if len(self.frames) == 3:
-            return self.frames[0].iter_var.var
-        return [frame.iter_var.var for frame in self.frames[0:-2]]
+        block_vars = [
+            frame.iter_var.var
+            for frame in self.frames
+            if isinstance(frame, LaunchThreadFrame)
+            and frame.iter_var.thread_tag.startswith("blockIdx")
+        ]
+        if len(block_vars) == 1:
+            return block_vars[0]
+        return block_vars
 
 
-def Kernel(*blocks: List[tir.PrimExpr], threads: int = 128):
+def Kernel(
+    *blocks: List[tir.PrimExpr],
+    threads: int = 128,
+    schedule: str = "default",
+    min_blocks_per_sm: int = 0,
+):
     """Tools to quickly construct a GPU kernel launch frame.
 
     Parameters
@@ -88,16 +114,69 @@ def Kernel(*blocks: List[tir.PrimExpr], threads: int = 128):
         A list of extent, can be 1-3 dimension, representing gridDim.(x|y|z)
     threads : int
         A integer representing blockDim.x
+    schedule : str
+        "default" launches a block per tile. "persistent" launches num_sms * ctas_per_sm blocks
+        looping over the tiles, "stream_k" also splits the iterations of the T.gemm loop evenly
+        among these blocks.
+    min_blocks_per_sm : int
+        The minimum number of resident blocks per SM of __launch_bounds__, which limits the
+        registers per thread to 65536 / (threads * min_blocks_per_sm). It is also the default
+        ctas_per_sm of the persistent schedules. 0 leaves it to the compiler.
     Returns
     -------
     res : Tuple[frame.LaunchThreadFrame]
         The result LaunchThreadFrame.
     """
-    return _ffi_api.KernelLaunch(blocks, threads)
+    return _ffi_api.KernelLaunch(blocks, threads, schedule, min_blocks_per_sm)
 
 
-def use_swizzle(panel_size: int):
-    return T.attr(None, "threadblock_swizzle_pattern", f"tl::rasterization2DRow<{panel_size}>")
+_RASTERIZATIONS = {
+    "row": "tl::rasterization2DRow<{panel}, {batch}>",
+    "column": "tl::rasterization2DColumn<{panel}, {batch}>",
+    "morton": "tl::rasterization2DCurve<{panel}, false, {batch}>",
+    "hilbert": "tl::rasterization2DCurve<{panel}, true, {batch}>",
+}
+
+
+def use_swizzle(
+    panel_size: Union[int, str] = "auto",
+    order: Optional[str] = None,
+    batch: Union[bool, str, None] = None,
+):
+    """Reorder the launch of the blocks for the reuse of the operands in the L2 cache.
+
+    Parameters
+    ----------
+    panel_size : Union[int, str]
+        The rows (columns in the column order) of blockIdx.y (blockIdx.x) in a panel, the blocks of
+        a panel are launched by columns (rows) and the panels are serpentined. The side of the
+        squares of the curve orders, a power of 2. "auto" picks it from the footprint in the
+        global memory of the copies of a block and the L2 size of the device.
+    order : Optional[str]
+        "row", "column", "morton", "hilbert", or "auto" to pick the row or the column order. The
+        default is "row" with a panel_size and "auto" otherwise.
+    batch : Union[bool, str, None]
+        Whether the blocks of the same tile of the blockIdx.z slices are launched together, for
+        the batches sharing an operand. The default is False with a panel_size and an order, and
+        "auto" otherwise, which interleaves the slices when an operand does not depend on
+        blockIdx.z.
+    """
+    if order is None:
+        order = "auto" if panel_size == "auto" else "row"
+    if batch is None:
+        batch = "auto" if panel_size == "auto" or order == "auto" else False
+    assert order in _RASTERIZATIONS or order == "auto", "Unknown rasterization order " + order
+    assert panel_size == "auto" or panel_size > 0, "panel_size should be positive or auto"
+    if order in ("morton", "hilbert") and panel_size != "auto":
+        assert panel_size & (panel_size - 1) == 0, "The side of the curves should be a power of 2"
+    if panel_size != "auto" and order != "auto" and batch != "auto":
+        pattern = _RASTERIZATIONS[order].format(panel=panel_size, batch=str(bool(batch)).lower())
+        return T.attr(None, "threadblock_swizzle_pattern", pattern)
+    # planned by the RasterizationPlanning pass
+    panel = 0 if panel_size == "auto" else panel_size
+    interleave = -1 if batch == "auto" else int(bool(batch))
+    options = tvm.runtime.convert([order, panel, interleave])
+    return T.attr(options, "threadblock_swizzle_pattern", "auto")
 
 
 def alloc_shared(shape, dtype):
@@ -134,10 +213,50 @@ def buffer_region_to_tile_region(buffer_region: tir.BufferRegion, access_type: s
     return region(T.BufferLoad(buffer_region.buffer, mins), access_type, *extents)
 
 
+_CACHE_HINTS = {"evict_first": 1, "evict_last": 2, "no_allocate": 3}
+_CONV_MODES = {"fprop": 0, "dgrad": 1, "wgrad": 0}
+
+
 def copy(
     src: Union[tir.Buffer, tir.BufferLoad, tir.BufferRegion],
     dst: Union[tir.Buffer, tir.BufferLoad],
+    epilogue: List[Callable] = None,
+    cache_hint: Optional[str] = None,
+    l2_prefetch: Optional[int] = None,
+    bound: Optional[tir.PrimExpr] = None,
 ):
+    """Copy the src region into the dst region.
+
+    Parameters
+    ----------
+    src : Union[Buffer, BufferLoad, BufferRegion]
+        The source region, a BufferLoad refers to its starting point.
+    dst : Union[Buffer, BufferLoad, BufferRegion]
+        The destination region.
+    epilogue : List[Callable]
+        The element-wise functions applied in order to the src elements before they are stored
+        (casted to the dtype of dst), e.g. [T.bias_add(bias[n0 : n0 + block_N]), T.gelu,
+        T.quantize("e4m3_float8", scale)]. The copy becomes a single T.Parallel loop over the
+        tile, see EpilogueOp.
+    cache_hint : Optional[str]
+        The L2 eviction priority of the lines read from the global memory by the async copies
+        into the shared memory: "evict_first" for the data read once, "evict_last" for the data
+        reused by many blocks, "no_allocate" streams them at the lowest priority without the L2
+        prefetch.
+    l2_prefetch : Optional[int]
+        The size in bytes (0, 64, 128 or 256) of the L2 prefetch of the async copies, the default
+        is set by the TL_ENABLE_L2_PREFETCH macro.
+    bound : Optional[PrimExpr]
+        The end of the rows (the first dim) of the global buffer, e.g. the end of a sequence of a
+        ragged batch (see ragged_tile): the rows past it are read as zeros and not written.
+    """
+    if epilogue:
+        assert cache_hint is None and l2_prefetch is None, "The epilogue copies take no hint"
+        assert bound is None, "The epilogue copies take no bound"
+        return _copy_with_epilogue(src, dst, epilogue)
+    assert cache_hint is None or cache_hint in _CACHE_HINTS, "Unknown cache hint " + cache_hint
+    assert l2_prefetch in (None, 0, 64, 128, 256), "l2_prefetch should be 0, 64, 128 or 256"
+
     def get_extent(data):
         if isinstance(data, tir.Buffer):
             return data.shape
@@ -168,7 +287,582 @@ def copy(
     src = _to_region(src, "r")
     dst = _to_region(dst, "w")
 
-    return tir.call_intrin("handle", tir.op.Op.get("tl.copy"), src, dst)
+    if cache_hint is None and l2_prefetch is None and bound is None:
+        return tir.call_intrin("handle", tir.op.Op.get("tl.copy"), src, dst)
+    hint = _CACHE_HINTS[cache_hint] if cache_hint else 0
+    prefetch = -1 if l2_prefetch is None else l2_prefetch
+    args = [src, dst, hint, prefetch] + ([] if bound is None else [bound])
+    return tir.call_intrin("handle", tir.op.Op.get("tl.copy"), *args)
+
+
+def gather_copy(
+    src: Union[tir.Buffer, tir.BufferRegion],
+    dst: Union[tir.Buffer, tir.BufferRegion],
+    index: tir.BufferLoad,
+    page_size: tir.PrimExpr = 1,
+    row_offset: tir.PrimExpr = 0,
+    cache_hint: Optional[str] = None,
+):
+    """Copy the rows of src selected by an index buffer into dst, e.g. the pages of a paged KV
+    cache listed by a block table.
+
+    Parameters
+    ----------
+    src : Union[Buffer, BufferRegion]
+        The global source, its dim 0 is gathered (its range along dim 0 is ignored), the other
+        dims are copied as the region.
+    dst : Union[Buffer, BufferRegion]
+        The destination tile, its dim 0 are the gathered rows.
+    index : BufferLoad
+        The first entry of the index vector along the last dim of the index buffer, e.g.
+        block_table[b, 0].
+    page_size : PrimExpr
+        The number of src rows of an index entry. Row r of the tile reads the src row
+        index[p] * page_size + s with (p, s) = divmod(row_offset + r, page_size), i.e. src is the
+        paged cache flattened to [num_pages * page_size, ...].
+    row_offset : PrimExpr
+        The first row of the tile in the gathered sequence, e.g. k * block_N.
+    cache_hint : Optional[str]
+        The L2 eviction priority of the src lines, see T.copy.
+    Returns
+    -------
+    handle : PrimExpr
+    """
+    assert cache_hint is None or cache_hint in _CACHE_HINTS, "Unknown cache hint " + cache_hint
+    if isinstance(dst, tir.Buffer):
+        rows = dst.shape[0]
+        dst = buffer_to_tile_region(dst, "w")
+    else:
+        rows = dst.region[0].extent
+        dst = buffer_region_to_tile_region(dst, "w")
+    if isinstance(src, tir.Buffer):
+        src = tir.BufferRegion(src, [ir.Range(0, x) for x in src.shape])
+    region = [ir.Range.from_min_extent(0, rows)] + list(src.region[1:])
+    src = buffer_region_to_tile_region(tir.BufferRegion(src.buffer, region), "r")
+    index = buffer_load_to_tile_region(index, "r", [1 for _ in index.indices])
+    args = [src, dst, index, page_size, row_offset]
+    if cache_hint is not None:
+        args += [_CACHE_HINTS[cache_hint], -1]
+    return tir.call_intrin("handle", tir.op.Op.get("tl.gather_copy"), *args)
+
+
+def scatter_copy(
+    src: Union[tir.Buffer, tir.BufferRegion],
+    dst: Union[tir.Buffer, tir.BufferRegion],
+    index: tir.BufferLoad,
+    page_size: tir.PrimExpr = 1,
+    row_offset: tir.PrimExpr = 0,
+    rows: tir.PrimExpr = None,
+):
+    """Copy the rows of the src tile into the rows of the global dst selected by an index buffer,
+    e.g. the K and V of the new tokens appended to the pages of a paged KV cache, the inverse of
+    gather_copy.
+
+    Parameters
+    ----------
+    src : Union[Buffer, BufferRegion]
+        The source tile, its dim 0 are the scattered rows (unless rows is 1).
+    dst : Union[Buffer, BufferRegion]
+        The global destination, its dim 0 is scattered (its range along dim 0 is ignored), the
+        other dims are copied as the region.
+    index : BufferLoad
+        The first entry of the index vector along the last dim of the index buffer, e.g.
+        block_table[b, 0].
+    page_size : PrimExpr
+        The number of dst rows of an index entry. Row r of the tile writes the dst row
+        index[p] * page_size + s with (p, s) = divmod(row_offset + r, page_size).
+    row_offset : PrimExpr
+        The first row of the tile in the scattered sequence, e.g. the position of the token.
+    rows : PrimExpr
+        The rows of the tile, dim 0 of src by default. With rows=1, src is the single row without
+        its dim 0, e.g. the [heads, dim] K of a decoded token.
+    Returns
+    -------
+    handle : PrimExpr
+    """
+    if isinstance(src, tir.Buffer):
+        if rows is None:
+            rows = src.shape[0]
+        src = buffer_to_tile_region(src, "r")
+    else:
+        if rows is None:
+            rows = src.region[0].extent
+        src = buffer_region_to_tile_region(src, "r")
+    if isinstance(dst, tir.Buffer):
+        dst = tir.BufferRegion(dst, [ir.Range(0, x) for x in dst.shape])
+    region = [ir.Range.from_min_extent(0, rows)] + list(dst.region[1:])
+    dst = buffer_region_to_tile_region(tir.BufferRegion(dst.buffer, region), "w")
+    index = buffer_load_to_tile_region(index, "r", [1 for _ in index.indices])
+    return tir.call_intrin(
+        "handle", tir.op.Op.get("tl.gather_copy"), src, dst, index, page_size, row_offset
+    )
+
+
+def _pair(value):
+    return tuple(value) if isinstance(value, (tuple, list)) else (value, value)
+
+
+def im2col_copy(
+    src: tir.Buffer,
+    dst: Union[tir.Buffer, tir.BufferRegion],
+    m_offset: tir.PrimExpr,
+    k_offset: tir.PrimExpr,
+    out_hw: Union[tir.PrimExpr, Tuple[tir.PrimExpr, tir.PrimExpr]],
+    kernel: Union[int, Tuple[int, int]],
+    stride: Union[int, Tuple[int, int]] = 1,
+    padding: Union[int, Tuple[int, int]] = 0,
+    dilation: Union[int, Tuple[int, int]] = 1,
+    mode: str = "fprop",
+):
+    """Copy a tile of the im2col matrix of an NHWC tensor, the A operand of an implicit GEMM
+    convolution.
+
+    Parameters
+    ----------
+    src : Buffer
+        The NHWC global tensor, the input of fprop and wgrad, the output gradient of dgrad.
+    dst : Union[Buffer, BufferRegion]
+        The 2D shared tile, its rows are pixels (n, h, w) and its columns are kernel taps and
+        channels (kh, kw, c) in this order.
+    m_offset : PrimExpr
+        The first pixel of the tile in the flattened n * h * w pixels.
+    k_offset : PrimExpr
+        The first column of the tile in the flattened kh * kw * c columns.
+    out_hw : Union[PrimExpr, Tuple[PrimExpr, PrimExpr]]
+        The spatial size of the pixels of the rows, the output of fprop and wgrad, the input of
+        dgrad.
+    kernel, stride, padding, dilation : Union[int, Tuple[int, int]]
+        The convolution window, a pair is (h, w).
+    mode : str
+        "fprop" gathers the input pixels under the window of each output pixel. "dgrad" gathers
+        the output gradient pixels whose window covers each input pixel (those not on the stride
+        are zero), the tile is multiplied by the weights indexed by (kh, kw, k). "wgrad" is the
+        fprop gather with the pixels as the reduction, use the tile as the transposed A.
+    Returns
+    -------
+    handle : PrimExpr
+    """
+    assert mode in _CONV_MODES, "Unknown conv mode " + mode
+    out_h, out_w = _pair(out_hw)
+    kernel, stride, padding, dilation = (_pair(x) for x in (kernel, stride, padding, dilation))
+    src = buffer_to_tile_region(src, "r")
+    if isinstance(dst, tir.Buffer):
+        dst = buffer_to_tile_region(dst, "w")
+    else:
+        dst = buffer_region_to_tile_region(dst, "w")
+    return tir.call_intrin(
+        "handle",
+        tir.op.Op.get("tl.conv_copy"),
+        src,
+        dst,
+        m_offset,
+        k_offset,
+        out_h,
+        out_w,
+        *kernel,
+        *stride,
+        *padding,
+        *dilation,
+        _CONV_MODES[mode],
+    )
+
+
+def _get_region(data: Union[tir.Buffer, tir.BufferLoad, tir.BufferRegion], extent=None):
+    """The buffer, mins and extents of a copy operand, a BufferLoad starts a region of extent."""
+    if isinstance(data, tir.Buffer):
+        return data, [0 for _ in data.shape], list(data.shape)
+    if isinstance(data, tir.BufferRegion):
+        return data.buffer, [x.min for x in data.region], [x.extent for x in data.region]
+    assert extent is not None, "Can't deduce copy extents from args"
+    return data.buffer, list(data.indices), list(extent)
+
+
+def _tile_indices(mins, extents, tile_index):
+    """The buffer indices of the tile index, the dims of extent 1 are not iterated."""
+    tile_index = list(tile_index)
+    indices = []
+    for lo, ext in zip(mins, extents):
+        indices.append(lo if _is_one(ext) else lo + tile_index.pop(0))
+    assert not tile_index, "The ranks of the regions do not match"
+    return indices
+
+
+def _is_one(expr):
+    return isinstance(expr, int) and expr == 1 or isinstance(expr, tir.IntImm) and expr.value == 1
+
+
+def _cast(value, dtype: str):
+    if not isinstance(value, tir.PrimExpr):
+        return tir.const(value, dtype)
+    return value if value.dtype == dtype else tir.Cast(dtype, value)
+
+
+class EpilogueOp:
+    """An element-wise function of the copy epilogue, called with the value of the element and its
+    index in the tile (without the dims of extent 1). prepare is called before the loop over the
+    tile with its extents, e.g. to load the broadcast operands once per tile. Any callable (value,
+    index) -> value can be used in the epilogue as well."""
+
+    def prepare(self, extents: List[tir.PrimExpr]):
+        pass
+
+    def __call__(self, value: tir.PrimExpr, index: List[tir.Var]) -> tir.PrimExpr:
+        raise NotImplementedError()
+
+
+class _Broadcast(EpilogueOp):
+    def __init__(self, operand, axis, combine, kind):
+        self.buffer, self.mins, extents = _get_region(operand)
+        dims = [i for i, ext in enumerate(extents) if not _is_one(ext)]
+        assert len(dims) <= 1, "The broadcast operand should be a vector"
+        self.dim = dims[0] if dims else None
+        self.extents = extents
+        self.axis = axis
+        self.combine = combine
+        # "add" or "mul", the name of the op in the gemm prologue
+        self.kind = kind
+
+    def prepare(self, extents):
+        axis = self.axis % len(extents)
+        if self.buffer.scope() == "global" and self.dim is not None:
+            # each thread loads the elements of its columns (or rows) of the tile once, instead of
+            # once per element of the loop
+            tile = alloc_fragment((self.extents[self.dim],), self.buffer.dtype)
+            region = tir.BufferRegion(
+                self.buffer,
+                [ir.Range.from_min_extent(lo, ext) for lo, ext in zip(self.mins, self.extents)],
+            )
+            T.evaluate(copy(region, tile))
+            self.load = lambda index: tile[index[axis]]
+        elif self.dim is not None:
+            self.load = lambda index: tir.BufferLoad(
+                self.buffer, _tile_indices(self.mins, self.extents, [index[axis]])
+            )
+        else:
+            self.load = lambda index: tir.BufferLoad(self.buffer, self.mins)
+
+    def __call__(self, value, index):
+        return self.combine(value, _cast(self.load(index), value.dtype))
+
+
+class _Elementwise(EpilogueOp):
+    def __init__(self, operand, combine):
+        self.operand = operand
+        self.combine = combine
+
+    def prepare(self, extents):
+        self.buffer, self.mins, self.extents = _get_region(self.operand, extents)
+
+    def __call__(self, value, index):
+        operand = tir.BufferLoad(self.buffer, _tile_indices(self.mins, self.extents, index))
+        return self.combine(value, _cast(operand, value.dtype))
+
+
+def bias_add(operand: Union[tir.Buffer, tir.BufferRegion], axis: int = -1):
+    """Add the vector operand broadcast along the other dims of the tile, indexed by the tile dim
+    axis (the columns by default). A global operand is loaded into a fragment once per tile."""
+    return _Broadcast(operand, axis, lambda x, y: x + y, "add")
+
+
+def broadcast_mul(operand: Union[tir.Buffer, tir.BufferRegion], axis: int = -1):
+    """Multiply by the vector operand broadcast like bias_add, e.g. the per-channel scales."""
+    return _Broadcast(operand, axis, lambda x, y: x * y, "mul")
+
+
+def residual_add(operand: Union[tir.Buffer, tir.BufferLoad, tir.BufferRegion]):
+    """Add the elements of the operand region, of the shape of the tile."""
+    return _Elementwise(operand, lambda x, y: x + y)
+
+
+class _Scale(EpilogueOp):
+    def __init__(self, factor):
+        self.factor = factor
+
+    def __call__(self, value, index):
+        return value * _cast(self.factor, value.dtype)
+
+
+def scale_by(factor: tir.PrimExpr):
+    """Multiply by a scalar, e.g. a per-tensor scale loaded from a buffer."""
+    return _Scale(factor)
+
+
+def relu(x, _=None):
+    return tir.Max(x, tir.const(0, x.dtype))
+
+
+def silu(x, _=None):
+    return x * tir.sigmoid(x)
+
+
+def gelu(x, _=None):
+    """The tanh approximation of gelu."""
+    inner = tir.const(0.7978845608028654, x.dtype) * (x + tir.const(0.044715, x.dtype) * x * x * x)
+    return tir.const(0.5, x.dtype) * x * (tir.const(1, x.dtype) + tir.tanh(inner))
+
+
+def quantize(dtype: str, scale: tir.PrimExpr = None):
+    """Multiply by scale and cast to dtype, e.g. the fp8 or int8 outputs."""
+
+    def func(x, _):
+        if scale is not None:
+            x = x * _cast(scale, x.dtype)
+        return tir.Cast(dtype, x)
+
+    return func
+
+
+class _Requantize(EpilogueOp):
+    def __init__(self, dtype, scale, zero_point, axis, rounding):
+        assert rounding in ("TONEAREST", "UPWARD"), "Unknown rounding " + rounding
+        scales = scale if isinstance(scale, (list, tuple)) else [scale]
+        self.scales = [
+            _Broadcast(s, axis, lambda x, y: x * y, "mul")
+            if isinstance(s, (tir.Buffer, tir.BufferRegion))
+            else _Scale(s)
+            for s in scales
+        ]
+        self.dtype = dtype
+        self.zero_point = zero_point
+        self.rounding = rounding
+
+    def prepare(self, extents):
+        for op in self.scales:
+            op.prepare(extents)
+
+    def __call__(self, value, index):
+        x = _cast(value, "float32")
+        for op in self.scales:
+            x = op(x, index)
+        dtype = tvm.DataType(self.dtype)
+        if dtype.type_code in (tvm.DataTypeCode.INT, tvm.DataTypeCode.UINT):
+            if self.rounding == "TONEAREST":
+                x = tir.round(x)
+            else:
+                x = tir.floor(x + tir.const(0.5, "float32"))
+            x = x + _cast(self.zero_point, "float32")
+        # saturated to the range of dtype
+        lo = _cast(tir.min_value(self.dtype), "float32")
+        hi = _cast(tir.max_value(self.dtype), "float32")
+        return tir.Cast(self.dtype, tir.Max(tir.Min(x, hi), lo))
+
+
+def requantize(
+    dtype: str,
+    scale,
+    zero_point: Union[int, tir.PrimExpr] = 0,
+    axis: int = -1,
+    rounding: str = "TONEAREST",
+):
+    """Requantize an integer accumulator (e.g. the int32 C of an int8 gemm) to dtype: the value is
+    multiplied in float32 by scale, rounded and shifted by zero_point for the integer dtypes (int8,
+    uint8), and saturated to the range of dtype (int8, uint8, float16 or bfloat16) before the
+    cast, as qnn.requantize.
+
+    scale is a scalar, a vector region broadcast like broadcast_mul along the tile dim axis (the
+    per-channel scales, the columns by default), or a list of them multiplied in order, e.g. the
+    per-channel scales then the inverse of the output scale. rounding is "TONEAREST" (half away
+    from zero) or "UPWARD" (half up)."""
+    return _Requantize(dtype, scale, zero_point, axis, rounding)
+
+
+def rand_uniform(seed: Union[int, tir.PrimExpr], counter: Union[int, tir.PrimExpr]):
+    """A uniform float32 in [0, 1) of the Philox4x32-10 stream seed at counter. It is a pure
+    function of seed and counter, without a state, so that a kernel regenerates the numbers of
+    another one, e.g. the dropout mask of the forward pass in the backward pass."""
+    return T.call_extern(
+        "float32", "tl::rand_uniform", _cast(seed, "uint64"), _cast(counter, "uint64")
+    )
+
+
+def _contiguous_strides(extents):
+    strides = [1] * len(extents)
+    for i in reversed(range(len(extents) - 1)):
+        strides[i] = strides[i + 1] * extents[i + 1]
+    return strides
+
+
+def _counter(offset, index, strides):
+    """The counter offset + sum(index * strides) of an element, in int64."""
+    counter = _cast(offset, "int64")
+    for i, stride in zip(index, strides):
+        counter = counter + _cast(i, "int64") * _cast(stride, "int64")
+    return counter
+
+
+def rand(
+    seed: Union[int, tir.PrimExpr],
+    offset: Union[int, tir.PrimExpr],
+    shape: List[tir.PrimExpr],
+    strides: Optional[List[tir.PrimExpr]] = None,
+):
+    """A float32 fragment of shape filled with the uniform numbers of rand_uniform, the element of
+    index (i, j, ...) at the counter offset + i * strides[0] + j * strides[1] + ... (the strides of
+    a contiguous shape by default).
+
+    The counters only depend on the logical index of the elements, not on the layout of the
+    fragment or the thread that holds them: with the offset and strides of the tile in a global
+    tensor, e.g. offset = (bh * seq_len + by * block_M) * seq_len + bx * block_N and strides =
+    [seq_len, 1] for the scores of an attention, the number of an element is the same in all the
+    kernels and block sizes, so the backward pass regenerates the dropout mask of the forward
+    pass instead of reading it from the memory."""
+    shape = list(shape)
+    strides = _contiguous_strides(shape) if strides is None else list(strides)
+    assert len(strides) == len(shape), "The strides should have a stride per dim of shape"
+    buffer = alloc_fragment(shape, "float32")
+    with Parallel(*shape) as loop_vars:
+        index = loop_vars if isinstance(loop_vars, list) else [loop_vars]
+        T.buffer_store(buffer, rand_uniform(seed, _counter(offset, index, strides)), index)
+    return buffer
+
+
+# The device types of tl::stochastic_round
+_STOCHASTIC_ROUND_TYPES = {
+    "bfloat16": "bfloat16_t",
+    "float16": "half_t",
+    "e4m3_float8": "float_e4m3_t",
+    "e5m2_float8": "float_e5m2_t",
+}
+
+
+def stochastic_cast(
+    value: tir.PrimExpr,
+    dtype: str,
+    seed: Union[int, tir.PrimExpr],
+    counter: Union[int, tir.PrimExpr],
+):
+    """Cast value to dtype (bfloat16, float16, e4m3_float8 or e5m2_float8) with stochastic
+    rounding: value is rounded up (in magnitude) with the probability of its distance to the
+    value of dtype below it over their spacing, by the uniform number of rand_uniform(seed,
+    counter), so that the rounding is unbiased in expectation. The finite values are saturated to
+    the range of dtype but bfloat16."""
+    assert dtype in _STOCHASTIC_ROUND_TYPES, "No stochastic rounding to " + dtype
+    return T.call_extern(
+        dtype,
+        "tl::stochastic_round<" + _STOCHASTIC_ROUND_TYPES[dtype] + ">",
+        _cast(value, "float32"),
+        _cast(seed, "uint64"),
+        _cast(counter, "uint64"),
+    )
+
+
+class _Random(EpilogueOp):
+    def __init__(self, seed, offset, strides, func):
+        self.seed = seed
+        self.offset = offset
+        self.strides = strides
+        self.func = func
+
+    def prepare(self, extents):
+        strides = _contiguous_strides(extents) if self.strides is None else list(self.strides)
+        assert len(strides) == len(extents), "The strides should have a stride per dim of the tile"
+        self.tile_strides = strides
+
+    def __call__(self, value, index):
+        counter = _counter(self.offset, index, self.tile_strides)
+        return self.func(value, counter)
+
+
+def dropout(
+    p: Union[float, tir.PrimExpr],
+    seed: Union[int, tir.PrimExpr],
+    offset: Union[int, tir.PrimExpr],
+    strides: Optional[List[tir.PrimExpr]] = None,
+):
+    """Zero the element with the probability p and scale the others by 1 / (1 - p). The element
+    of index (i, j) in the tile (without the dims of extent 1) is dropped if the number of
+    rand_uniform(seed, offset + i * strides[0] + j * strides[1]) is below p, the counters of rand:
+    the mask is regenerated from seed, offset and strides, never stored."""
+
+    def func(x, counter):
+        keep = tir.const(1, x.dtype) / (tir.const(1, x.dtype) - _cast(p, x.dtype))
+        dropped = rand_uniform(seed, counter) < _cast(p, "float32")
+        return tir.if_then_else(dropped, tir.const(0, x.dtype), x * keep)
+
+    return _Random(seed, offset, strides, func)
+
+
+def stochastic_round(
+    dtype: str,
+    seed: Union[int, tir.PrimExpr],
+    offset: Union[int, tir.PrimExpr],
+    strides: Optional[List[tir.PrimExpr]] = None,
+):
+    """Cast to dtype with stochastic_cast, the element of index (i, j) in the tile at the counter
+    offset + i * strides[0] + j * strides[1], e.g. the bfloat16 or float8 weights of an
+    optimizer step."""
+
+    def func(x, counter):
+        return stochastic_cast(x, dtype, seed, counter)
+
+    return _Random(seed, offset, strides, func)
+
+
+def _copy_with_epilogue(src, dst, epilogue: List[Callable]):
+    src_extent = _get_region(src)[2] if not isinstance(src, tir.BufferLoad) else None
+    dst_extent = _get_region(dst)[2] if not isinstance(dst, tir.BufferLoad) else None
+    extent = src_extent or dst_extent
+    src_buffer, src_mins, src_extents = _get_region(src, extent)
+    dst_buffer, dst_mins, dst_extents = _get_region(dst, extent)
+    extents = [ext for ext in src_extents if not _is_one(ext)]
+    for op in epilogue:
+        if isinstance(op, EpilogueOp):
+            op.prepare(extents)
+
+    analyzer = arith.Analyzer()
+    with Parallel(*extents) as loop_vars:
+        index = loop_vars if isinstance(loop_vars, list) else [loop_vars]
+        value = tir.BufferLoad(src_buffer, _tile_indices(src_mins, src_extents, index))
+        for op in epilogue:
+            value = op(value, index)
+        value = _cast(value, dst_buffer.dtype)
+        dst_indices = _tile_indices(dst_mins, dst_extents, index)
+        # the bound checks of the copies to the global memory
+        conds = []
+        if dst_buffer.scope() == "global":
+            for idx, lo, ext, size in zip(dst_indices, dst_mins, dst_extents, dst_buffer.shape):
+                if not analyzer.can_prove(lo + ext <= size):
+                    conds.append(idx < size)
+        if conds:
+            with T.If(tir.all(*conds)):
+                with T.Then():
+                    T.buffer_store(dst_buffer, value, dst_indices)
+        else:
+            T.buffer_store(dst_buffer, value, dst_indices)
+
+
+def _gemm_prologue_ops(prologue: List[Callable]):
+    """The names and the operands of the prologue ops applied in the registers by tl.gemm, or None
+    if one of the functions is not one of them."""
+    ops = []
+    for op in prologue:
+        if isinstance(op, _Broadcast):
+            assert op.axis in (0, 1, -1), "The axis of a gemm prologue op is 0 (M) or -1 (K)"
+            dim = "m" if op.axis == 0 else "k"
+            offset = op.buffer.offset_of(op.mins)[0]
+            ops.append((op.kind + "_" + dim, op.buffer.access_ptr("r", offset=offset)))
+        elif isinstance(op, _Scale):
+            ops.append(("scale", _cast(op.factor, "float32")))
+        elif op in (relu, silu, gelu):
+            ops.append((op.__name__, 0))
+        else:
+            return None
+    return ops
+
+
+def _transform_gemm_operand(A: tir.Buffer, M, transpose_A: bool, prologue: List[Callable]):
+    """A fragment [M, K] of the element-wise functions of prologue applied to A."""
+    K = A.shape[0] if transpose_A else A.shape[1]
+    A_local = alloc_fragment((M, K), A.dtype)
+    for op in prologue:
+        if isinstance(op, EpilogueOp):
+            op.prepare([M, K])
+    with Parallel(M, K) as (i, k):
+        value = A[k, i] if transpose_A else A[i, k]
+        for op in prologue:
+            value = op(value, [i, k])
+        T.buffer_store(A_local, _cast(value, A.dtype), [i, k])
+    return A_local
 
 
 class GemmWarpPolicy:
@@ -184,15 +878,66 @@ def gemm(
     transpose_A: bool = False,
     transpose_B: bool = False,
     policy: GemmWarpPolicy = GemmWarpPolicy.Square,
+    b_format: str = None,
+    scale: tir.Buffer = None,
+    zeros: tir.Buffer = None,
+    group_size: int = -1,
+    accum: str = None,
+    prologue: List[Callable] = None,
 ):
+    """C += A @ B, B is transposed ([N, K]) if transpose_B.
+
+    accum sets the accumulation of the mma, by default in the dtype of C. With "fp16" the float16
+    A and B are accumulated in float16 (twice the mma throughput of the consumer GPUs): into C if
+    it is float16, otherwise into float16 partial sums added to the float32 C at the end of the
+    gemm. With "promote_every:n" the partial sums are added to the float32 C every n k-steps of
+    the mma (16 elements of K), bounding the float16 rounding error. Both require sm80 or later,
+    as does a float16 C. "fp32" checks that C is float32.
+
+    With b_format ("int4", "uint4", "fp4" or "nf4"), B is a packed uint8 shared buffer [N, K / 2]
+    (transpose_B must be set) holding two 4-bit elements per byte, the even k in the low nibble.
+    Each element is dequantized in registers to the dtype of A as (q - zeros[n, g]) * scale[n, g]
+    with g = k // group_size, scale and zeros are shared buffers [N, max(K // group_size, 1)] of the
+    dtype of A (group_size -1 for one scale per row). zeros is only for the integer formats,
+    int4 is signed and uint4 unsigned.
+
+    prologue is a list of element-wise functions applied in order to the elements of A before the
+    product, e.g. the scales of a fused norm or the dequantization of an fp8 A, called with the
+    value and its (m, k) index in the tile like the epilogue of T.copy. With a shared A and only
+    T.broadcast_mul and T.bias_add (axis 0 for the rows of A, -1 for K), T.scale_by, T.relu,
+    T.silu and T.gelu, the functions are applied in float32 to the registers of each mma step of
+    A loaded from shared memory (sm75 and later, not with wgmma). Otherwise A is transformed into a
+    fragment of the whole tile first.
+    """
+    if prologue:
+        ops = _gemm_prologue_ops(prologue)
+        if ops is None or A.scope() not in ("shared", "shared.dyn"):
+            A = _transform_gemm_operand(A, C.shape[0], transpose_A, prologue)
+            transpose_A = False
+            prologue = None
     M = C.shape[0]
     N = C.shape[1]
     K = A.shape[0] if transpose_A else A.shape[1]
     K_B = B.shape[1] if transpose_B else B.shape[0]
+    if b_format is not None:
+        assert transpose_B, "the quantized B is packed along K"
+        K_B = K_B * 2
     assert K == K_B, "gemm K shape check failed"
     Aptr = A.access_ptr("r")
     Bptr = B.access_ptr("r")
     Cptr = C.access_ptr("rw")
+    extra = []
+    if b_format is not None:
+        extra = [
+            b_format,
+            group_size,
+            scale.access_ptr("r") if scale is not None else 0,
+            zeros.access_ptr("r") if zeros is not None else 0,
+        ]
+    if prologue:
+        if not extra:
+            extra = ["", -1, 0, 0]
+        extra += [",".join(name for name, _ in ops)] + [operand for _, operand in ops]
     return tir.call_intrin(
         "handle",
         tir.op.Op.get("tl.gemm"),
@@ -205,6 +950,101 @@ def gemm(
         N,
         K,
         policy,
+        accum if accum is not None else "",
+        *extra,
+    )
+
+
+def complex_gemm(
+    A: Tuple[tir.Buffer, tir.Buffer],
+    B: Tuple[tir.Buffer, tir.Buffer],
+    C: Tuple[tir.Buffer, tir.Buffer],
+    C_neg: tir.Buffer,
+    transpose_A: bool = False,
+    transpose_B: bool = False,
+    conjugate_A: bool = False,
+    conjugate_B: bool = False,
+    policy: GemmWarpPolicy = GemmWarpPolicy.Square,
+):
+    """C += op(A) @ op(B) on planar complex tiles, each a pair of buffers (real, imaginary), with
+    the four real gemms of the 4M method. op conjugates A (B) if conjugate_A (conjugate_B) is set.
+
+    The products subtracted from a part of C are accumulated into C_neg, a fragment of the shape
+    and the dtype of C cleared with C, and subtracted once by complex_gemm_finalize after the last
+    step rather than at each step. The float64 parts run on the m8n8k4 tensor cores (ZGEMM), the
+    float32 ones on the tf32 tensor cores like T.gemm.
+
+    Parameters
+    ----------
+    A, B : Tuple[Buffer, Buffer]
+        The real and imaginary shared tiles, of the shapes of the operands of T.gemm.
+    C : Tuple[Buffer, Buffer]
+        The real and imaginary accumulator fragments.
+    C_neg : Buffer
+        The accumulator fragment of the subtracted products.
+    conjugate_A, conjugate_B : bool
+        Conjugate the operand, e.g. for the Hermitian transpose with transpose_A. Conjugating
+        both is the conjugate of A @ B, conjugate C instead.
+    """
+    assert not (conjugate_A and conjugate_B), "conj(A) @ conj(B) is conj(A @ B)"
+    (A_re, A_im), (B_re, B_im), (C_re, C_im) = A, B, C
+    conjugate = conjugate_A or conjugate_B
+
+    def real_gemm(a, b, c):
+        T.evaluate(gemm(a, b, c, transpose_A, transpose_B, policy))
+
+    # re = A_re B_re - A_im B_im and im = A_re B_im + A_im B_re, one sign flips with a conjugate
+    real_gemm(A_re, B_re, C_re)
+    real_gemm(A_im, B_im, C_re if conjugate else C_neg)
+    real_gemm(A_re, B_im, C_neg if conjugate_B else C_im)
+    real_gemm(A_im, B_re, C_neg if conjugate_A else C_im)
+
+
+def complex_gemm_finalize(
+    C: Tuple[tir.Buffer, tir.Buffer],
+    C_neg: tir.Buffer,
+    conjugate_A: bool = False,
+    conjugate_B: bool = False,
+):
+    """Subtract the products accumulated into C_neg by complex_gemm from their part of C, with the
+    conjugations of the complex_gemm calls."""
+    part = C[1] if conjugate_A or conjugate_B else C[0]
+    with Parallel(*part.shape) as (i, j):
+        T.buffer_store(part, part[i, j] - C_neg[i, j], [i, j])
+
+
+def gemm_sp(
+    A: tir.Buffer,
+    E: tir.Buffer,
+    B: tir.Buffer,
+    C: tir.Buffer,
+    transpose_B: bool = False,
+    policy: GemmWarpPolicy = GemmWarpPolicy.Square,
+):
+    """C += A @ B with a 2:4 sparse A on the sparse tensor cores (mma.sp, sm_80 and later).
+
+    A is the [M, K / 2] compressed A and E its [M, K / 32] int32 metadata, as made by
+    tl.compress_2_4, both in shared memory with B. A and B are float16 or bfloat16, C is a float32
+    fragment, B is transposed ([N, K]) if transpose_B.
+    """
+    M = C.shape[0]
+    N = C.shape[1]
+    K = A.shape[1] * 2
+    K_B = B.shape[1] if transpose_B else B.shape[0]
+    assert K == K_B, "gemm_sp K shape check failed"
+    return tir.call_intrin(
+        "handle",
+        tir.op.Op.get("tl.gemm_sp"),
+        A.access_ptr("r"),
+        B.access_ptr("r"),
+        C.access_ptr("rw"),
+        False,
+        transpose_B,
+        M,
+        N,
+        K,
+        policy,
+        E.access_ptr("r"),
     )
 
 
@@ -217,15 +1057,30 @@ def clear(buffer: tir.Buffer):
     return fill(buffer, 0)
 
 
-def reduce(buffer: tir.Buffer, out: tir.Buffer, reduce_type: str, dim: int, clear: bool):
+def reduce(
+    buffer: tir.Buffer,
+    out: tir.Buffer,
+    reduce_type: str,
+    dim: Union[int, List[int]],
+    clear: bool,
+    aux: tir.Buffer = None,
+):
+    dims = [dim] if isinstance(dim, int) else list(dim)
+    dims = [d + len(buffer.shape) if d < 0 else d for d in dims]
+    # the extra reduced dims and the second output are appended after clear
+    extra = dims[1:]
+    if aux is not None:
+        extra.append(aux.access_ptr("w"))
     buffer = buffer.access_ptr("r")
     out = out.access_ptr("w")
     return tir.call_intrin(
-        "handle", tir.op.Op.get("tl.reduce"), buffer, out, reduce_type, dim, clear
+        "handle", tir.op.Op.get("tl.reduce"), buffer, out, reduce_type, dims[0], clear, *extra
     )
 
 
-def reduce_max(buffer: tir.Buffer, out: tir.Buffer, dim: int, clear: bool = True):
+def reduce_max(
+    buffer: tir.Buffer, out: tir.Buffer, dim: Union[int, List[int]], clear: bool = True
+):
     """Perform reduce max on input buffer, store the result to output buffer
 
     Parameters
@@ -234,8 +1089,8 @@ def reduce_max(buffer: tir.Buffer, out: tir.Buffer, dim: int, clear: bool = True
         The input buffer.
     out : Buffer
         The output buffer.
-    dim : int
-        The dimension to perform reduce on
+    dim : Union[int, List[int]]
+        The dimension to perform reduce on, or a list of dimensions reduced at once
     clear : bool
         If set to False, the output buffer will first be initialized to -inf.
     Returns
@@ -245,13 +1100,657 @@ def reduce_max(buffer: tir.Buffer, out: tir.Buffer, dim: int, clear: bool = True
     return reduce(buffer, out, "max", dim, clear)
 
 
-def reduce_min(buffer: tir.Buffer, out: tir.Buffer, dim: int, clear: bool = True):
+def reduce_min(
+    buffer: tir.Buffer, out: tir.Buffer, dim: Union[int, List[int]], clear: bool = True
+):
     return reduce(buffer, out, "min", dim, clear)
 
 
-def reduce_sum(buffer: tir.Buffer, out: tir.Buffer, dim: int):
+def reduce_sum(buffer: tir.Buffer, out: tir.Buffer, dim: Union[int, List[int]]):
     return reduce(buffer, out, "sum", dim, True)
 
 
-def atomic_add(dst, value):
-    return T.call_extern("handle", "atomicAdd", T.address_of(dst), value)
+def reduce_absmax(buffer: tir.Buffer, out: tir.Buffer, dim: Union[int, List[int]]):
+    """The max of the absolute values, e.g. the scale of a FP8 quantization."""
+    return reduce(buffer, out, "absmax", dim, True)
+
+
+def reduce_prod(buffer: tir.Buffer, out: tir.Buffer, dim: Union[int, List[int]]):
+    return reduce(buffer, out, "prod", dim, True)
+
+
+def reduce_argmax(buffer: tir.Buffer, out: tir.Buffer, out_index: tir.Buffer, dim: int):
+    """Reduce the max into out and its (first) index along dim into the int32 fragment out_index.
+    The value and the index are reduced together in a single pass."""
+    return reduce(buffer, out, "argmax", dim, True, out_index)
+
+
+def reduce_welford(
+    buffer: tir.Buffer, out_mean: tir.Buffer, out_var: tir.Buffer, dim: Union[int, List[int]]
+):
+    """Reduce the mean and the (biased) variance along dim in a single pass with the welford
+    algorithm, the partial states of the threads are combined with the parallel formula."""
+    return reduce(buffer, out_mean, "welford", dim, True, out_var)
+
+
+def reduce_sumsq(buffer: tir.Buffer, out: tir.Buffer, dim: Union[int, List[int]]):
+    """The sum of the squares, e.g. the mean square of the rows of an RMS norm."""
+    return reduce(buffer, out, "sumsq", dim, True)
+
+
+def _row_norm(x, out, eps, weight, bias, residual, residual_out, scale, rms):
+    assert x.scope() == "local.fragment" and len(x.shape) == 2, "x should be a 2D fragment"
+    block_M, N = x.shape
+    if residual is not None:
+        _copy_with_epilogue(x, x, [residual_add(residual)])
+        if residual_out is not None:
+            T.evaluate(copy(x, residual_out))
+
+    # the statistics of the rows take the layout of a row reduction of x
+    rstd = alloc_fragment((block_M,), "float32")
+    if rms:
+        T.evaluate(reduce_sumsq(x, rstd, 1))
+        mean = None
+    else:
+        mean = alloc_fragment((block_M,), "float32")
+        T.evaluate(reduce_welford(x, mean, rstd, 1))
+    with Parallel(block_M) as i:
+        value = rstd[i] / _cast(N, "float32") if rms else rstd[i]
+        T.buffer_store(rstd, tir.rsqrt(value + _cast(eps, "float32")), [i])
+
+    def normalize(value, index):
+        # the rows of extent 1 are not in the index of the epilogue
+        row = index[0] if len(index) == 2 else 0
+        value = _cast(value, "float32")
+        if mean is not None:
+            value = value - mean[row]
+        return value * rstd[row]
+
+    epilogue = [normalize]
+    if weight is not None:
+        epilogue.append(broadcast_mul(weight))
+    if bias is not None:
+        epilogue.append(bias_add(bias))
+    if scale is not None:
+        epilogue.append(scale_by(scale))
+    _copy_with_epilogue(x, out, epilogue)
+
+
+def rms_norm(
+    x: tir.Buffer,
+    out: Union[tir.Buffer, tir.BufferLoad, tir.BufferRegion],
+    weight: Union[tir.Buffer, tir.BufferRegion] = None,
+    eps: float = 1e-6,
+    residual: Union[tir.Buffer, tir.BufferLoad, tir.BufferRegion] = None,
+    residual_out: Union[tir.Buffer, tir.BufferLoad, tir.BufferRegion] = None,
+    scale: tir.PrimExpr = None,
+):
+    """Normalize the rows of the fragment x by their root mean square,
+    out = x / sqrt(mean(x^2) + eps) * weight, with the statistics in float32. The rows are read
+    from x once: load them into x with T.copy, the output is written by a single loop.
+
+    Parameters
+    ----------
+    x : Buffer
+        The [block_M, N] fragment of the whole rows.
+    out : Union[Buffer, BufferLoad, BufferRegion]
+        The output region of the shape of x, e.g. the rows of a global tensor, its dtype can be a
+        quantized one (float8 or int8), see scale.
+    weight : Union[Buffer, BufferRegion]
+        The [N] per-column scale, a global weight is loaded into a fragment once per tile.
+    eps : float
+        Added to the mean square.
+    residual : Union[Buffer, BufferLoad, BufferRegion]
+        Added to x before the normalization, x then holds the sum.
+    residual_out : Union[Buffer, BufferLoad, BufferRegion]
+        With residual, the sum is also written there, e.g. the residual stream of the next layer.
+    scale : PrimExpr
+        Multiplies the output before it is casted to the dtype of out, e.g. the inverse of the
+        scale of a per-tensor quantization.
+    """
+    _row_norm(x, out, eps, weight, None, residual, residual_out, scale, rms=True)
+
+
+def layer_norm(
+    x: tir.Buffer,
+    out: Union[tir.Buffer, tir.BufferLoad, tir.BufferRegion],
+    weight: Union[tir.Buffer, tir.BufferRegion] = None,
+    bias: Union[tir.Buffer, tir.BufferRegion] = None,
+    eps: float = 1e-5,
+    residual: Union[tir.Buffer, tir.BufferLoad, tir.BufferRegion] = None,
+    residual_out: Union[tir.Buffer, tir.BufferLoad, tir.BufferRegion] = None,
+    scale: tir.PrimExpr = None,
+):
+    """Normalize the rows of the fragment x by their mean and (biased) variance,
+    out = (x - mean) / sqrt(var + eps) * weight + bias, the statistics are reduced in a single
+    pass with the welford algorithm. The other parameters are the ones of rms_norm."""
+    _row_norm(x, out, eps, weight, bias, residual, residual_out, scale, rms=False)
+
+
+def rotary(
+    x: tir.Buffer,
+    cos: Union[tir.Buffer, tir.BufferRegion],
+    sin: Union[tir.Buffer, tir.BufferRegion],
+    interleaved: bool = False,
+):
+    """Apply the rotary position embedding in place to the [rows, dim] fragment x, e.g. the Q or
+    K of the tokens of a decode step before their attention: each pair (x1, x2) of a row becomes
+    (x1 * cos - x2 * sin, x2 * cos + x1 * sin), computed in float32.
+
+    Each iteration of the loop rotates a pair, whose two elements are held by the same thread:
+    the layout inference gives x a layout keeping the pairs together, or a copy of x in such a
+    layout if x has another one (e.g. from a gemm).
+
+    Parameters
+    ----------
+    x : Buffer
+        The [rows, dim] fragment.
+    cos, sin : Union[Buffer, BufferRegion]
+        The dim / 2 angles of the pairs, a vector shared by the rows (e.g. cos_table[pos, :] for
+        the heads of a token) or a [rows, dim / 2] region (e.g. one position per row). A global
+        vector is loaded into a fragment once.
+    interleaved : bool
+        The pairs are (2 * k, 2 * k + 1) (GPT-J) instead of (k, k + dim / 2) (GPT-NeoX).
+    """
+    assert x.scope() == "local.fragment" and len(x.shape) == 2, "x should be a 2D fragment"
+    rows, dim = x.shape
+    half = dim // 2
+
+    def angles(operand):
+        buffer, mins, extents = _get_region(operand)
+        dims = [ext for ext in extents if not _is_one(ext)]
+        if len(dims) == 1 and buffer.scope() == "global":
+            tile = alloc_fragment((half,), buffer.dtype)
+            region = tir.BufferRegion(
+                buffer, [ir.Range.from_min_extent(lo, ext) for lo, ext in zip(mins, extents)]
+            )
+            T.evaluate(copy(region, tile))
+            return lambda i, k: tile[k]
+        if len(dims) == 1:
+            return lambda i, k: tir.BufferLoad(buffer, _tile_indices(mins, extents, [k]))
+        assert len(dims) == 2, "The angles should be a vector or a [rows, dim / 2] region"
+        return lambda i, k: tir.BufferLoad(buffer, _tile_indices(mins, extents, [i, k]))
+
+    load_cos, load_sin = angles(cos), angles(sin)
+    with Parallel(rows, half) as (i, k):
+        first = [i, 2 * k] if interleaved else [i, k]
+        second = [i, 2 * k + 1] if interleaved else [i, k + half]
+        c = _cast(load_cos(i, k), "float32")
+        s = _cast(load_sin(i, k), "float32")
+        with T.LetStmt(_cast(x[first[0], first[1]], "float32")) as x1:
+            with T.LetStmt(_cast(x[second[0], second[1]], "float32")) as x2:
+                T.buffer_store(x, _cast(x1 * c - x2 * s, x.dtype), first)
+                T.buffer_store(x, _cast(x2 * c + x1 * s, x.dtype), second)
+
+
+def scan(buffer: tir.Buffer, out: tir.Buffer, scan_type: str, dim: int, exclusive: bool):
+    dim = dim + len(buffer.shape) if dim < 0 else dim
+    buffer = buffer.access_ptr("r")
+    out = out.access_ptr("w")
+    return tir.call_intrin(
+        "handle", tir.op.Op.get("tl.scan"), buffer, out, scan_type, dim, exclusive
+    )
+
+
+def cumsum(buffer: tir.Buffer, out: tir.Buffer, dim: int, exclusive: bool = False):
+    """The prefix sums of the fragment buffer along dim into the fragment out, out can be buffer.
+
+    Parameters
+    ----------
+    buffer : Buffer
+        The input fragment.
+    out : Buffer
+        The output fragment of the same shape.
+    dim : int
+        The scanned dimension.
+    exclusive : bool
+        If set to True, out[i] is the sum of the elements before i and out[0] is 0.
+    Returns
+    -------
+    handle : PrimExpr
+    """
+    return scan(buffer, out, "sum", dim, exclusive)
+
+
+def cummax(buffer: tir.Buffer, out: tir.Buffer, dim: int, exclusive: bool = False):
+    return scan(buffer, out, "max", dim, exclusive)
+
+
+def topk(
+    buffer: tir.Buffer,
+    values: tir.Buffer,
+    indices: tir.Buffer,
+    index_offset: tir.PrimExpr = 0,
+    merge: bool = False,
+    valid: tir.PrimExpr = None,
+):
+    """The k largest elements of each row (the last dim) of the shared buffer and their column
+    indices into the shared values and indices, k being the last dim of values.
+
+    Parameters
+    ----------
+    buffer : Buffer
+        The shared [..., n] input.
+    values : Buffer
+        The shared [..., k] output, in descending order, the smaller index first among the equal
+        values.
+    indices : Buffer
+        The shared int32 [..., k] output, the columns of the values plus index_offset.
+    index_offset : PrimExpr
+        The index of the first column of the buffer, e.g. the offset of a tile of the vocabulary.
+    merge : bool
+        If set to True, the elements already in values and indices are candidates too: the top k
+        of the rows are accumulated over the tiles of the buffer.
+    valid : PrimExpr
+        The number of the candidate columns of the buffer (all by default), e.g. for the last tile.
+    Returns
+    -------
+    handle : PrimExpr
+    """
+    if valid is None:
+        valid = buffer.shape[-1]
+    return tir.call_intrin(
+        "handle",
+        tir.op.Op.get("tl.topk"),
+        buffer.access_ptr("r"),
+        values.access_ptr("rw"),
+        indices.access_ptr("rw"),
+        index_offset,
+        merge,
+        valid,
+    )
+
+
+def online_softmax(
+    scores: tir.Buffer, m: tir.Buffer, l: tir.Buffer, acc: tir.Buffer, scale: tir.PrimExpr
+):
+    """One step of the online softmax of the attention, on the scores of a K block.
+
+    Parameters
+    ----------
+    scores : Buffer
+        The [block_M, block_N] float32 fragment of the unscaled scores, the C of a gemm. It is
+        overwritten with the exponentials p = 2^((scores - m) * scale * log2(e)), the A of the next
+        gemm once casted.
+    m : Buffer
+        The [block_M] running row max of the unscaled scores, initialized to -inf.
+    l : Buffer
+        The [block_M] running row sum of the exponentials, initialized to 0.
+    acc : Buffer
+        The [block_M, dim] output accumulator rescaled by 2^((m_prev - m) * scale * log2(e)), the C
+        of a gemm with the warp policy of the scores.
+    scale : PrimExpr
+        The softmax scale, e.g. 1 / sqrt(dim), log2(e) is folded in by the compiler.
+    Returns
+    -------
+    handle : PrimExpr
+    """
+    return tir.call_intrin(
+        "handle",
+        tir.op.Op.get("tl.online_softmax"),
+        scores.access_ptr("rw"),
+        m.access_ptr("rw"),
+        l.access_ptr("rw"),
+        acc.access_ptr("rw"),
+        scale,
+    )
+
+
+def shuffle_layout(src: tir.Buffer, dst: tir.Buffer):
+    """Move the fragment src into the fragment dst of another layout, through the registers.
+
+    Parameters
+    ----------
+    src : Buffer
+        The input fragment, e.g. the C of a gemm.
+    dst : Buffer
+        The output fragment of the same shape, e.g. the A of the next gemm, cast to its dtype.
+    Returns
+    -------
+    handle : PrimExpr
+    """
+    return tir.call_intrin(
+        "handle", tir.op.Op.get("tl.shuffle_layout"), src.access_ptr("r"), dst.access_ptr("w")
+    )
+
+
+def mask(
+    buffer: tir.Buffer,
+    fn: Callable,
+    row_offset: tir.PrimExpr,
+    col_offset: tir.PrimExpr,
+    value: tir.PrimExpr = None,
+):
+    """Set the elements of the 2D fragment buffer where fn is false to value, e.g. the causal mask
+    of the attention scores T.mask(acc_s, lambda i, j: i >= j, bx * block_M, k * block_N).
+
+    The tile is classified at compile time from the comparisons affine in (i, j) of fn: nothing is
+    emitted if fn provably holds on the whole tile, otherwise the element-wise masking only runs on
+    the tiles where fn does not hold everywhere.
+
+    Parameters
+    ----------
+    buffer : Buffer
+        The [rows, cols] tile.
+    fn : Callable
+        The mask (i, j) -> bool on the global row and column, the elements where it holds are kept.
+    row_offset, col_offset : PrimExpr
+        The global row and column of the first element of the tile.
+    value : PrimExpr
+        The value of the masked elements, -inf by default.
+    """
+    rows, cols = buffer.shape
+    if value is None:
+        value = -T.infinity(buffer.dtype)
+    i, j = tir.Var("i", "int32"), tir.Var("j", "int32")
+    full, _ = _ffi_api.ClassifyTileMask(fn(i, j), i, j, row_offset, rows, col_offset, cols)
+    if arith.Analyzer().can_prove(full):
+        return
+
+    def emit():
+        with Parallel(rows, cols) as (r, c):
+            keep = fn(row_offset + r, col_offset + c)
+            T.buffer_store(buffer, tir.if_then_else(keep, buffer[r, c], value), [r, c])
+
+    if isinstance(full, tir.IntImm) and full.value == 0:
+        emit()
+        return
+    with T.If(tir.Not(full)):
+        with T.Then():
+            emit()
+
+
+def mask_range(
+    fn: Callable,
+    row_offset: tir.PrimExpr,
+    block_M: int,
+    block_N: int,
+    num_tiles: tir.PrimExpr,
+):
+    """The [start, stop) column tiles of a row tile that are not empty under the mask fn (see
+    T.mask), the bounds of the T.Pipelined loop skipping the empty tiles, e.g. the tiles above the
+    diagonal of a causal mask or outside of a sliding window.
+
+    Parameters
+    ----------
+    fn : Callable
+        The mask (i, j) -> bool on the global row and column.
+    row_offset : PrimExpr
+        The first row of the row tile.
+    block_M, block_N : int
+        The rows of the row tile and the columns of a column tile.
+    num_tiles : PrimExpr
+        The number of column tiles.
+    Returns
+    -------
+    start, stop : PrimExpr
+    """
+    i, j = tir.Var("i", "int32"), tir.Var("j", "int32")
+    start, stop = _ffi_api.TileMaskRange(fn(i, j), i, j, row_offset, block_M, block_N, num_tiles)
+    return start, stop
+
+
+def reduce_across_blocks(
+    src: tir.Buffer,
+    dst: Union[tir.Buffer, tir.BufferLoad, tir.BufferRegion],
+    split_idx: tir.PrimExpr,
+    num_splits: tir.PrimExpr,
+    deterministic: bool = True,
+):
+    """Sum the src fragments of the blocks in a split into dst, e.g. for split-K gemms
+
+    Parameters
+    ----------
+    src : Buffer
+        The partial result fragment of this block.
+    dst : Union[Buffer, BufferLoad, BufferRegion]
+        The output region in the global memory, a BufferLoad refers to its starting point.
+    split_idx : PrimExpr
+        The index of this block in the split, should be the slowest varying block index.
+    num_splits : PrimExpr
+        The number of blocks in the split.
+    deterministic : bool
+        If set to True, the blocks add into dst in the order of split_idx, serialized by a
+        semaphore per tile of dst, so the result is reproducible. Otherwise the blocks add into
+        dst with atomics, which should be zero initialized.
+    Returns
+    -------
+    handle : PrimExpr
+    """
+    if isinstance(dst, tir.Buffer):
+        dst = buffer_to_tile_region(dst, "rw")
+    elif isinstance(dst, tir.BufferRegion):
+        dst = buffer_region_to_tile_region(dst, "rw")
+    else:
+        dst = buffer_load_to_tile_region(dst, "rw", src.shape)
+    src = buffer_to_tile_region(src, "r")
+    mode = 0 if deterministic else 1
+    return tir.call_intrin(
+        "handle",
+        tir.op.Op.get("tl.reduce_across_blocks"),
+        src,
+        dst,
+        split_idx,
+        num_splits,
+        mode,
+    )
+
+
+def atomic_add(
+    dst: Union[tir.Buffer, tir.BufferLoad, tir.BufferRegion],
+    value: Union[tir.PrimExpr, tir.Buffer, tir.BufferRegion],
+):
+    """Atomically add value to dst
+
+    Parameters
+    ----------
+    dst : Union[Buffer, BufferLoad, BufferRegion]
+        The element to update, or the region if value is a buffer (region).
+    value : Union[PrimExpr, Buffer, BufferRegion]
+        The value to add, or the region of values added element-wise into dst. The atomics on
+        consecutive fp16/bf16 (or fp32 on sm_90) elements from the registers are vectorized.
+    Returns
+    -------
+    handle : PrimExpr
+    """
+    if isinstance(value, (tir.Buffer, tir.BufferRegion)):
+        if isinstance(value, tir.Buffer):
+            extent = value.shape
+            src = buffer_to_tile_region(value, "r")
+        else:
+            extent = [x.extent for x in value.region]
+            src = buffer_region_to_tile_region(value, "r")
+        if isinstance(dst, tir.Buffer):
+            dst = buffer_to_tile_region(dst, "rw")
+        elif isinstance(dst, tir.BufferRegion):
+            dst = buffer_region_to_tile_region(dst, "rw")
+        else:
+            dst = buffer_load_to_tile_region(dst, "rw", extent)
+        return tir.call_intrin("handle", tir.op.Op.get("tl.atomic_add"), src, dst)
+    return T.call_extern("handle", "tl::AtomicAdd", T.address_of(dst), value)
+
+
+def group_search(offsets: tir.Buffer, num_groups: tir.PrimExpr, index: tir.PrimExpr):
+    """The group of a tile in the grouped kernels, e.g. the grouped GEMM of the MoE experts.
+
+    Parameters
+    ----------
+    offsets : Buffer
+        The int32 global buffer of num_groups + 1 elements, the prefix sum of the number of tiles
+        of the groups (offsets[0] = 0), see tl.make_group_offsets.
+    num_groups : PrimExpr
+        The number of groups.
+    index : PrimExpr
+        The tile index, uniform in the block. All the threads of the block must call it.
+    Returns
+    -------
+    group : PrimExpr
+        The g with offsets[g] <= index < offsets[g + 1], num_groups if index is past the last tile.
+    """
+    return T.call_extern("int32", "tl::group_search", T.address_of(offsets[0]), num_groups, index)
+
+
+def ragged_tile(cu_seqlens: tir.Buffer, batch: tir.PrimExpr, block: int, index: tir.PrimExpr):
+    """The sequence and the rows of a tile of a ragged batch, e.g. the variable length sequences
+    of an attention or the tokens of the MoE experts, whose rows are packed in the first dim of
+    the global buffers: `seq, start, end = T.ragged_tile(cu_seqlens, batch, block_M, bx)`.
+
+    The tiles of block rows of the sequences are numbered in order, so a kernel launches the
+    bound T.ceildiv(total_rows, block) + batch of the number of tiles, and the blocks whose seq
+    is batch exit. The rows of the tile are [start, min(start + block, end)), the copies of the
+    tile are bounded by end (see copy). The mapping is computed by a warp at the start of the
+    block from cu_seqlens, 32 sequences per step, without a tile table.
+
+    Parameters
+    ----------
+    cu_seqlens : Buffer
+        The int32 global buffer of batch + 1 elements, the prefix sum of the lengths of the
+        sequences (cu_seqlens[0] = 0).
+    batch : PrimExpr
+        The number of sequences.
+    block : int
+        The rows of a tile.
+    index : PrimExpr
+        The tile index, uniform in the block. All the threads of the block must call it.
+    Returns
+    -------
+    seq, start, end : Tuple[PrimExpr, PrimExpr, PrimExpr]
+        The sequence of the tile (batch past the last tile), the first row of the tile and the end
+        of the rows of its sequence.
+    """
+    packed = T.call_extern(
+        "int64", "tl::ragged_tile_search", T.address_of(cu_seqlens[0]), batch, block, index
+    )
+    # bound once, the sequence and the row are unpacked from it
+    frame = T.LetStmt(packed)
+    frame.add_callback(partial(frame.__exit__, None, None, None))
+    tile = frame.__enter__()
+    seq = T.Cast("int32", tile & T.int64(0xFFFFFFFF))
+    start = T.Cast("int32", tile >> T.int64(32))
+    end = cu_seqlens[T.min(seq + 1, batch)]
+    return seq, start, end
+
+
+def peer_buffer(buffer: tir.Buffer, peers: tir.Buffer, rank: tir.PrimExpr):
+    """The copy of a global buffer on the device of another rank, read and written over NVLink
+    (or PCIe peer to peer) by the copies and the loads and stores of the kernel, e.g. the shards
+    of an all-gather consumed tile by tile by a gemm.
+
+    Parameters
+    ----------
+    buffer : Buffer
+        The global buffer of this rank, each rank holding a copy of the same shape.
+    peers : Buffer
+        The int64 global buffer of the addresses of the copies of buffer on all the ranks, see
+        tl.make_peer_table.
+    rank : PrimExpr
+        The rank of the copy.
+    Returns
+    -------
+    buffer : Buffer
+        The buffer of the copy, declared until the end of the enclosing scope. It is not copied
+        with TMA, the tensor maps being encoded on the host.
+    """
+    data = T.call_extern("handle", "tl::peer_ptr", T.address_of(peers[0]), rank)
+    # bound like the assignment of an expression in the parser
+    frame = T.LetStmt(data, type_annotation=ir.PointerType(ir.PrimType(buffer.dtype), "global"))
+    frame.add_callback(partial(frame.__exit__, None, None, None))
+    var = frame.__enter__()
+    return T.decl_buffer(buffer.shape, buffer.dtype, data=var, strides=buffer.strides)
+
+
+def signal_wait(signal: tir.BufferLoad, value: tir.PrimExpr):
+    """Wait until the int32 signal (possibly of a peer_buffer) reaches at least value, the global
+    writes made before the signal_set or signal_add of the producers being visible after it. All the
+    threads of the block must call it.
+
+    Parameters
+    ----------
+    signal : BufferLoad
+        The signal, e.g. flags[shard] of the flags zeroed before the launch.
+    value : PrimExpr
+        The value to wait for.
+    Returns
+    -------
+    handle : PrimExpr
+    """
+    return T.call_extern("handle", "tl::signal_wait", T.address_of(signal), value)
+
+
+def signal_set(signal: tir.BufferLoad, value: tir.PrimExpr):
+    """Set the int32 signal to value once the global writes of the block, local or to the peers,
+    are visible to the system. All the threads of the block must call it.
+
+    Parameters
+    ----------
+    signal : BufferLoad
+        The signal, e.g. flags_peer[shard] of the consumer.
+    value : PrimExpr
+        The value to set.
+    Returns
+    -------
+    handle : PrimExpr
+    """
+    return T.call_extern("handle", "tl::signal_set", T.address_of(signal), value)
+
+
+def signal_add(signal: tir.BufferLoad, value: tir.PrimExpr = 1):
+    """Atomically add value to the int32 signal once the global writes of the block are visible to
+    the system, e.g. to count the tiles of a shard written by the blocks of the producers. All the
+    threads of the block must call it.
+
+    Parameters
+    ----------
+    signal : BufferLoad
+        The signal.
+    value : PrimExpr
+        The value to add.
+    Returns
+    -------
+    handle : PrimExpr
+    """
+    return T.call_extern("handle", "tl::signal_add", T.address_of(signal), value)
+
+
+def pdl_trigger():
+    """Allow the next kernel of the stream to start before this one completes, once all the blocks
+    of this kernel called it or exited (programmatic dependent launch, sm_90 and later). Called
+    after the last reads of the inputs that the next kernel may overwrite, e.g. before the epilogue
+    of a gemm, the next kernel then runs its prologue during the epilogue. It does not make the
+    writes of this kernel visible to the next one, see pdl_wait.
+
+    Returns
+    -------
+    handle : PrimExpr
+    """
+    return tir.call_intrin("handle", tir.op.Op.get("tl.pdl_trigger"))
+
+
+def pdl_wait():
+    """Wait for the previous kernel of the stream to complete, its writes being visible after it.
+    A kernel calling it is launched with the programmatic dependent launch on sm_90 and later: it
+    may start before the previous kernel completes, the work before pdl_wait (e.g. the shared memory
+    setup or the prefetch of the weights) overlapping the tail of the previous kernel. The threads
+    reading the results of the previous kernel, or writing the buffers it reads, must call it
+    before. Elsewhere the kernel is launched in the stream order and it does nothing.
+
+    Returns
+    -------
+    handle : PrimExpr
+    """
+    return tir.call_intrin("handle", tir.op.Op.get("tl.pdl_wait"))
+
+
+def grid_sync():
+    """Synchronize all the threads of the grid, the global writes made before it being visible to
+    all the blocks after it, e.g. between the phases of a split-K fix-up or of a two-pass softmax
+    kept in one kernel. All the threads of all the blocks must call it. The kernel is launched as a
+    cooperative kernel: the launch fails if the grid has more blocks than can be resident at once
+    on the device, with the threads and the shared memory of the kernel (at most the number of SMs
+    times the occupancy per SM). CUDA only.
+
+    Returns
+    -------
+    handle : PrimExpr
+    """
+    return tir.call_intrin("handle", tir.op.Op.get("tl.grid_sync"))
@@ -0,0 +1,194 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Call the host entry of TL kernels directly, bypassing the PackedFunc and DLPack conversions."""
+
+import ctypes
+import os
+import os.path as osp
+import shutil
+import tempfile
+import weakref
+from typing import Any, List, Optional, Union
+
+import torch
+
+import tvm
+from tvm._ffi.base import get_last_ffi_error
+from tvm._ffi._ctypes.types import TVMValue
+from tvm._ffi.runtime_ctypes import ArgTypeCode, DataType, Device, TVMArray
+
+from .utils import map_tvm_type, set_tvm_stream
+
+_ENTRY_TYPE = ctypes.CFUNCTYPE(
+    ctypes.c_int,
+    ctypes.POINTER(TVMValue),
+    ctypes.POINTER(ctypes.c_int),
+    ctypes.c_int,
+    ctypes.POINTER(TVMValue),
+    ctypes.POINTER(ctypes.c_int),
+    ctypes.c_void_p,
+)
+
+# DLDeviceType::kDLCPU and kDLCUDA
+_KDLCPU = 1
+_KDLCUDA = 2
+
+
+def _device(tensor: torch.Tensor) -> Device:
+    """The DLDevice of a tensor, the device of a CPU tensor has no index."""
+    if tensor.device.type == "cuda":
+        return Device(_KDLCUDA, tensor.device.index)
+    return Device(_KDLCPU, 0)
+
+
+def _unpacked_signature(args):
+    """The shapes, dtypes and devices of the tensors args, or None if an argument is not a
+    contiguous tensor, which the unpacked entry cannot take."""
+    signature = []
+    for arg in args:
+        if not isinstance(arg, torch.Tensor) or not arg.is_contiguous():
+            return None
+        signature.append((tuple(arg.shape), arg.dtype, arg.device))
+    return tuple(signature)
+
+
+class RawKernel:
+    """The exported C entry of a TL module, called with raw tensors, scalars and a stream.
+
+    The module is exported as a shared library, and the host function (the PackedFunc C ABI
+    `int32_t name(TVMValue* args, int* type_codes, int num_args, TVMValue* ret, int* ret_code,
+    void* resource)`) is called through ctypes with DLTensors pointing to the torch storage, no
+    NDArray or DLPack capsule is created. C++ callers can dlsym the same symbol from library_path.
+
+    Compile the module with the pass config "tl.disable_host_checks" to remove the validation of
+    the arguments in the host function, the caller is responsible for the shapes, dtypes and
+    devices of the arguments in that case.
+
+    For the deployment on several GPUs, compile the module with the pass config "tl.cuda_archs"
+    (e.g. [80, 86, 89]): the library then holds a fatbin with the SASS of each arch, the CUDA
+    driver loads the one of the device without JIT and nvcc is not needed at runtime. The kernels
+    are generated for the features of the target, the archs should not be older than it.
+
+    Compile the module with the pass config "tir.make_packed_api.emit_unpacked" to also export
+    `int32_t name_unpacked(void* data0, ..., int dev_id)` for the static-shape kernels. Nothing
+    validates the arguments of that entry, so it is only called with contiguous tensors of the
+    shapes, dtypes and device of a previous call through the host function, which checked them:
+    such a call passes the data pointers directly, without building the DLTensors and TVMValues.
+    The other calls take the host function.
+    """
+
+    def __init__(self, mod, name: str, library_path: Optional[str] = None):
+        if library_path is None:
+            tmp_dir = tempfile.mkdtemp(prefix="tl_kernel_")
+            library_path = osp.join(tmp_dir, name + ".so")
+            # the loaded library stays mapped, the file is kept for the dlsym of library_path
+            # while the kernel is alive
+            weakref.finalize(self, shutil.rmtree, tmp_dir, ignore_errors=True)
+        if not osp.exists(library_path):
+            mod.export_library(library_path)
+        self.library_path = library_path
+        # load_module initializes the module context used by the host code to find the kernels
+        self.module = tvm.runtime.load_module(library_path)
+        self.lib = ctypes.CDLL(library_path, mode=os.RTLD_NOLOAD | os.RTLD_GLOBAL)
+        self.entry = ctypes.cast(getattr(self.lib, name), _ENTRY_TYPE)
+        try:
+            self.unpacked_entry = getattr(self.lib, name + "_unpacked")
+        except AttributeError:
+            self.unpacked_entry = None
+        # the ctypes prototype of the unpacked entry, by number of tensors
+        self._unpacked_types = {}
+        # the _unpacked_signature of the arguments the host function accepted
+        self._checked_signature = None
+        self.name = name
+
+    def __call__(self, *args: Union[torch.Tensor, int, float], stream: Any = None):
+        num_args = len(args)
+        signature = _unpacked_signature(args) if self.unpacked_entry is not None else None
+        if signature is not None and signature == self._checked_signature:
+            self._call_unpacked(args, stream)
+            return
+        values = (TVMValue * num_args)()
+        codes = (ctypes.c_int * num_args)()
+        # keep the DLTensors and their shapes alive during the call
+        holders: List[object] = []
+        # the device of the CUDA tensors, the kernels of a CPU call need no stream
+        device_id = None
+        for i, arg in enumerate(args):
+            if isinstance(arg, torch.Tensor):
+                device = _device(arg)
+                if device.device_type == _KDLCUDA:
+                    device_id = device.device_id
+                shape = (ctypes.c_int64 * arg.dim())(*arg.shape)
+                strides = (ctypes.c_int64 * arg.dim())(*arg.stride())
+                array = TVMArray()
+                array.data = arg.data_ptr()
+                array.device = device
+                array.ndim = arg.dim()
+                array.dtype = DataType(map_tvm_type(arg.dtype))
+                array.shape = shape
+                array.strides = strides
+                array.byte_offset = 0
+                holders.append((array, shape, strides))
+                values[i].v_handle = ctypes.addressof(array)
+                codes[i] = ArgTypeCode.DLTENSOR_HANDLE
+            elif isinstance(arg, float):
+                values[i].v_float64 = arg
+                codes[i] = ArgTypeCode.FLOAT
+            else:
+                values[i].v_int64 = int(arg)
+                codes[i] = ArgTypeCode.INT
+        if device_id is not None or stream is not None:
+            set_tvm_stream(stream, device_id)
+        ret_value = TVMValue()
+        ret_code = ctypes.c_int()
+        result = self.entry(values, codes, num_args, ctypes.byref(ret_value),
+                            ctypes.byref(ret_code), None)
+        if result != 0:
+            raise get_last_ffi_error()
+        if signature is not None:
+            self._checked_signature = signature
+
+    def _call_unpacked(self, args, stream):
+        num_args = len(args)
+        entry_type = self._unpacked_types.get(num_args)
+        if entry_type is None:
+            arg_types = [ctypes.c_void_p] * num_args + [ctypes.c_int]
+            entry_type = ctypes.CFUNCTYPE(ctypes.c_int, *arg_types)
+            self._unpacked_types[num_args] = entry_type
+        cuda_ids = [arg.device.index for arg in args if arg.device.type == "cuda"]
+        device_id = cuda_ids[-1] if cuda_ids else None
+        if device_id is not None or stream is not None:
+            set_tvm_stream(stream, device_id)
+        entry = ctypes.cast(self.unpacked_entry, entry_type)
+        data = [ctypes.c_void_p(arg.data_ptr()) for arg in args]
+        result = entry(*data, device_id or 0)
+        if result != 0:
+            raise get_last_ffi_error()
+
+    def register_torch_op(self, op_name: str, schema: str, library: str = "tl"):
+        """Register the kernel as a torch custom op, e.g. schema "(Tensor a, Tensor b, Tensor(a!) c)
+        -> ()" with the outputs marked as mutated. The op launches on the current torch stream."""
+        lib = torch.library.Library(library, "FRAGMENT")
+        lib.define(op_name + schema)
+
+        def impl(*args):
+            self(*args)
+
+        lib.impl(op_name, impl, "CUDA")
+        # the library object unregisters the op when it is destroyed
+        self._torch_library = lib
+        return getattr(getattr(torch.ops, library), op_name)
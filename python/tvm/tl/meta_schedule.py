@@ -0,0 +1,358 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Tune the matmul workloads of meta_schedule with TL tile programs.
+
+A TL program is not reachable from a TIR schedule, so the design space of a matmul workload is
+the TIR function with its matmul block annotated by a sampled tile config ("tl.gemm_config", an
+index in gemm_configs), and the builder replaces the function with the TL program of that config
+and compiles it with tl.lower. The other workloads keep the default space and build. Compiling
+the model with the tuning database, the TE compiler hands the primitives whose record holds a tile
+config to "relay.backend.tl_gemm_config", which links the TL program of that config in place of
+the TIR one.
+
+.. code-block:: python
+
+    from tvm import meta_schedule as ms
+    from tvm.tl import meta_schedule as tl_ms
+
+    tasks, weights = ms.relay_integration.extracted_tasks_to_tune_contexts(
+        ms.relay_integration.extract_tasks(mod, target, params), work_dir
+    )
+    database = ms.tune.tune_tasks(
+        tasks=tl_ms.use_gemm_space(tasks),
+        task_weights=weights,
+        work_dir=work_dir,
+        max_trials_global=2000,
+        builder=tl_ms.Builder(),
+    )
+    lib = ms.relay_integration.compile_relay(database, mod, target, params)
+"""
+
+import functools
+import random
+from typing import Dict, List, NamedTuple, Optional, Tuple
+
+import tvm
+from tvm import DataType, IRModule, tir
+from tvm.meta_schedule.builder import LocalBuilder
+from tvm.meta_schedule.builder.local_builder import default_build
+from tvm.meta_schedule.mutator import PyMutator
+from tvm.meta_schedule.space_generator import ScheduleFn
+from tvm.meta_schedule.tune_context import TuneContext
+from tvm.meta_schedule.utils import derived_object
+from tvm.runtime import Module, NDArray
+from tvm.target import Target
+
+from .engine import lower
+
+# The knobs of the tile program: block_M, block_N, block_K, num_stages, threads
+_BLOCK_MN = (64, 128, 256)
+_BLOCK_K = (32, 64)
+_NUM_STAGES = (2, 3, 4)
+_THREADS = (128, 256)
+
+ANN_GEMM_CONFIG = "tl.gemm_config"
+
+
+class GemmSpec(NamedTuple):
+    """A matmul C[M, N] = A[M, K] @ B[K, N] of static shapes, with A stored [K, M] if trans_A and
+    B stored [N, K] if trans_B, the parameters of the function being (A, B, C)."""
+
+    M: int
+    N: int
+    K: int
+    in_dtype: str
+    out_dtype: str
+    trans_A: bool
+    trans_B: bool
+
+    @property
+    def accum_dtype(self) -> str:
+        return "int32" if self.in_dtype in ("int8", "uint8") else "float32"
+
+
+class GemmConfig(NamedTuple):
+    """The tile sizes, pipeline stages and threads of the TL program of a matmul."""
+
+    block_M: int
+    block_N: int
+    block_K: int
+    num_stages: int
+    threads: int
+
+
+def _as_loads(expr):
+    """The buffer loads multiplied in expr, looking through the casts, or None."""
+    while isinstance(expr, tir.Cast):
+        expr = expr.value
+    if not isinstance(expr, tir.Mul):
+        return None
+    loads = []
+    for operand in (expr.a, expr.b):
+        while isinstance(operand, tir.Cast):
+            operand = operand.value
+        if not isinstance(operand, tir.BufferLoad):
+            return None
+        loads.append(operand)
+    return loads
+
+
+def _same_vars(indices, iter_vars) -> bool:
+    return len(indices) == len(iter_vars) and all(
+        isinstance(index, tir.Var) and index.same_as(var) for index, var in zip(indices, iter_vars)
+    )
+
+
+def match_gemm(func: tir.PrimFunc) -> Optional[GemmSpec]:
+    """The matmul computed by func, if its only block is a static 2D matmul over its three
+    parameters (A, B, C), like the dense and matmul of TOPI, otherwise None."""
+    if len(func.params) != 3 or any(param not in func.buffer_map for param in func.params):
+        return None
+    A, B, C = (func.buffer_map[param] for param in func.params)
+    blocks = []
+    tir.stmt_functor.post_order_visit(
+        func.body, lambda node: blocks.append(node) if isinstance(node, tir.Block) else None
+    )
+    blocks = [block for block in blocks if block.name_hint != "root"]
+    if len(blocks) != 1 or A.dtype != B.dtype or len(C.shape) != 2:
+        return None
+    block = blocks[0]
+    kinds = [iter_var.iter_type for iter_var in block.iter_vars]
+    if kinds != [tir.IterVar.DataPar, tir.IterVar.DataPar, tir.IterVar.CommReduce]:
+        return None
+    i, j, k = (iter_var.var for iter_var in block.iter_vars)
+    store = block.body
+    if not isinstance(store, tir.BufferStore) or not store.buffer.same_as(C):
+        return None
+    if not _same_vars(store.indices, [i, j]) or not isinstance(store.value, tir.Add):
+        return None
+    acc, prod = store.value.a, store.value.b
+    if not (isinstance(acc, tir.BufferLoad) and acc.buffer.same_as(C)):
+        acc, prod = prod, acc
+    loads = _as_loads(prod)
+    if loads is None or not (isinstance(acc, tir.BufferLoad) and acc.buffer.same_as(C)):
+        return None
+    if loads[0].buffer.same_as(B):
+        loads.reverse()
+    load_a, load_b = loads
+    if not (load_a.buffer.same_as(A) and load_b.buffer.same_as(B)):
+        return None
+    if _same_vars(load_a.indices, [i, k]) or _same_vars(load_a.indices, [k, i]):
+        trans_A = _same_vars(load_a.indices, [k, i])
+    else:
+        return None
+    if _same_vars(load_b.indices, [k, j]) or _same_vars(load_b.indices, [j, k]):
+        trans_B = _same_vars(load_b.indices, [j, k])
+    else:
+        return None
+    extents = [iter_var.dom.extent for iter_var in block.iter_vars]
+    if not all(isinstance(extent, tir.IntImm) for extent in extents):
+        return None
+    M, N, K = (int(extent) for extent in extents)
+    return GemmSpec(M, N, K, A.dtype, C.dtype, trans_A, trans_B)
+
+
+def gemm_configs(spec: GemmSpec, target: Target) -> List[GemmConfig]:
+    """The tile configs of the design space of a matmul, the ones whose pipelined shared buffers
+    fit in the shared memory of a block of the target."""
+    max_shared = int(target.attrs.get("max_shared_memory_per_block", 49152))
+    in_bytes = DataType(spec.in_dtype).bits // 8
+    configs = []
+    for block_M in _BLOCK_MN:
+        for block_N in _BLOCK_MN:
+            # the blocks much larger than the problem only add padding
+            if block_M > max(64, spec.M) or block_N > max(64, spec.N):
+                continue
+            for block_K in _BLOCK_K:
+                for num_stages in _NUM_STAGES:
+                    shared = num_stages * (block_M + block_N) * block_K * in_bytes
+                    if shared > max_shared:
+                        continue
+                    for threads in _THREADS:
+                        if threads == 256 and block_M * block_N < 128 * 128:
+                            continue
+                        configs.append(GemmConfig(block_M, block_N, block_K, num_stages, threads))
+    return configs
+
+
+def gemm_program(spec: GemmSpec, config: GemmConfig) -> tir.PrimFunc:
+    """The TL program of a matmul with a tile config."""
+    # pylint: disable=import-outside-toplevel,invalid-name
+    from . import language as T
+
+    M, N, K = spec.M, spec.N, spec.K
+    trans_A, trans_B = spec.trans_A, spec.trans_B
+    in_dtype, out_dtype, accum_dtype = spec.in_dtype, spec.out_dtype, spec.accum_dtype
+    block_M, block_N, block_K = config.block_M, config.block_N, config.block_K
+    num_stages, threads = config.num_stages, config.threads
+    A_shape = (K, M) if trans_A else (M, K)
+    B_shape = (N, K) if trans_B else (K, N)
+    A_shared_shape = (block_K, block_M) if trans_A else (block_M, block_K)
+    B_shared_shape = (block_N, block_K) if trans_B else (block_K, block_N)
+
+    @T.prim_func
+    def main(
+        A: T.Buffer(A_shape, in_dtype),
+        B: T.Buffer(B_shape, in_dtype),
+        C: T.Buffer((M, N), out_dtype),
+    ):
+        with T.Kernel(T.ceildiv(N, block_N), T.ceildiv(M, block_M), threads=threads) as (bx, by):
+            A_shared = T.alloc_shared(A_shared_shape, in_dtype)
+            B_shared = T.alloc_shared(B_shared_shape, in_dtype)
+            C_local = T.alloc_fragment((block_M, block_N), accum_dtype)
+            T.clear(C_local)
+            for k in T.Pipelined(T.ceildiv(K, block_K), num_stages=num_stages):
+                if trans_A:
+                    T.copy(A[k * block_K, by * block_M], A_shared)
+                else:
+                    T.copy(A[by * block_M, k * block_K], A_shared)
+                if trans_B:
+                    T.copy(B[bx * block_N, k * block_K], B_shared)
+                else:
+                    T.copy(B[k * block_K, bx * block_N], B_shared)
+                T.gemm(A_shared, B_shared, C_local, trans_A, trans_B)
+            T.copy(C_local, C[by * block_M, bx * block_N])
+
+    return main
+
+
+def _entry_func(mod: IRModule) -> Tuple[Optional[str], Optional[tir.PrimFunc]]:
+    funcs = [(gv.name_hint, func) for gv, func in mod.functions.items()]
+    funcs = [(name, func) for name, func in funcs if isinstance(func, tir.PrimFunc)]
+    if len(funcs) != 1:
+        return None, None
+    return funcs[0]
+
+
+def _gemm_block(func: tir.PrimFunc) -> Optional[tir.Block]:
+    blocks = []
+    tir.stmt_functor.post_order_visit(
+        func.body, lambda node: blocks.append(node) if isinstance(node, tir.Block) else None
+    )
+    blocks = [block for block in blocks if block.name_hint != "root"]
+    return blocks[0] if len(blocks) == 1 else None
+
+
+def schedule_gemm(sch: tir.Schedule, target: Target) -> None:
+    """The design space of a matmul: its block annotated with a tile config sampled uniformly."""
+    _, func = _entry_func(sch.mod)
+    spec = match_gemm(func)
+    if spec is None:
+        raise ValueError("The workload is not a matmul of TL: " + str(sch.mod))
+    configs = gemm_configs(spec, target)
+    block = sch.get_block(_gemm_block(func).name_hint)
+    index = sch.sample_categorical(
+        candidates=list(range(len(configs))),
+        probs=[1.0 / len(configs)] * len(configs),
+    )
+    sch.annotate(block, ANN_GEMM_CONFIG, index)
+
+
+@derived_object
+class MutateGemmConfig(PyMutator):
+    """Resample the tile config of a matmul to another one."""
+
+    def _initialize_with_tune_context(self, context: TuneContext) -> None:
+        pass
+
+    def apply(self, trace: tir.schedule.Trace, _) -> Optional[tir.schedule.Trace]:
+        for inst in trace.insts:
+            if inst.kind.name == "SampleCategorical":
+                candidates = list(inst.attrs[0])
+                if len(candidates) < 2:
+                    return None
+                current = int(trace.get_decision(inst))
+                decision = random.choice([i for i in range(len(candidates)) if i != current])
+                return trace.with_decision(inst, decision, remove_postproc=True)
+        return None
+
+    def clone(self) -> "MutateGemmConfig":
+        return MutateGemmConfig()
+
+
+def gemm_space(target: Target) -> ScheduleFn:
+    """The design space generator of the matmul workloads of a target, whose configs are indexed
+    like the ones of the builder for the same target."""
+    return ScheduleFn(
+        functools.partial(schedule_gemm, target=target),
+        sch_rules=[],
+        postprocs=[],
+        mutator_probs={MutateGemmConfig(): 1.0},
+    )
+
+
+def use_gemm_space(contexts: List[TuneContext]) -> List[TuneContext]:
+    """The tuning contexts with the matmul workloads of a CUDA target tuned as TL programs, the
+    others unchanged."""
+    results = []
+    for context in contexts:
+        _, func = _entry_func(context.mod)
+        if func is None or context.target.kind.name != "cuda" or match_gemm(func) is None:
+            results.append(context)
+            continue
+        results.append(
+            TuneContext(
+                mod=context.mod,
+                target=context.target,
+                space_generator=gemm_space(context.target),
+                search_strategy=context.search_strategy.clone(),
+                task_name=context.task_name,
+                rand_state=context.rand_state,
+                num_threads=context.num_threads,
+                logger=context.logger,
+            ).clone()
+        )
+    return results
+
+
+def _config_program(func: tir.PrimFunc, target: Target) -> Optional[tir.PrimFunc]:
+    block = _gemm_block(func)
+    if block is None or ANN_GEMM_CONFIG not in block.annotations:
+        return None
+    spec = match_gemm(func)
+    return gemm_program(spec, gemm_configs(spec, target)[int(block.annotations[ANN_GEMM_CONFIG])])
+
+
+def build(mod: IRModule, target: Target, params: Optional[Dict[str, NDArray]]) -> Module:
+    """The f_build of meta_schedule: the TL program of the sampled config for an annotated
+    matmul, and the default build otherwise."""
+    name, func = _entry_func(mod)
+    program = _config_program(func, target) if func is not None else None
+    if program is None:
+        return default_build(mod, target, params)
+    rt_mod, _ = lower(program.with_attr("global_symbol", name), target=target)
+    return rt_mod
+
+
+@tvm.register_func("relay.backend.tl_gemm_config", override=True)
+def build_gemm_config(func: tir.PrimFunc, target: Target, name: str) -> Module:
+    """Compile a primitive of a Relay build whose tuning record holds a tile config as the TL
+    program of that config, the runtime module implementing the external function name. Called by
+    the TE compiler for the primitives with a block annotated "tl.gemm_config"."""
+    program = _config_program(func, target)
+    if program is None:
+        raise ValueError("The primitive is not a matmul annotated with a TL tile config: " + name)
+    rt_mod, _ = lower(program.with_attr("global_symbol", name), target=target)
+    return rt_mod
+
+
+class Builder(LocalBuilder):
+    """The LocalBuilder compiling the annotated matmul workloads with tl.lower."""
+
+    def __init__(self, **kwargs) -> None:
+        kwargs.setdefault("timeout_sec", 120.0)
+        super().__init__(f_build=build, **kwargs)
@@ -20,6 +20,28 @@
 from . import _ffi_api
 
 
+def PersistentKernel():
+    """PersistentKernel
+
+    Returns
+    -------
+    fpass : tvm.transform.Pass
+        The result pass
+    """
+    return _ffi_api.PersistentKernel()  # type: ignore
+
+
+def RasterizationPlanning():
+    """Pick the block order of T.use_swizzle("auto") from the L2 reuse of the operands
+
+    Returns
+    -------
+    fpass : tvm.transform.Pass
+        The result pass
+    """
+    return _ffi_api.RasterizationPlanning()  # type: ignore
+
+
 def ClusterPlanning():
     """ClusterPlanning
 
@@ -31,6 +53,17 @@ def ClusterPlanning():
     return _ffi_api.ClusterPlanning()  # type: ignore
 
 
+def PlanNumStages():
+    """Resolve num_stages="auto" of the pipelined loops
+
+    Returns
+    -------
+    fpass : tvm.transform.Pass
+        The result pass
+    """
+    return _ffi_api.PlanNumStages()  # type: ignore
+
+
 def PipelinePlanning():
     """infer the fragment/shared memory layout
 
@@ -64,6 +97,29 @@ def LowerTileOp():
     return _ffi_api.LowerTileOp()  # type: ignore
 
 
+def LowerTileOpCPU():
+    """LowerTileOpCPU, the tile ops of the CPU targets lowered to loops, the blocks of T.Kernel
+    to a parallel loop
+
+    Returns
+    -------
+    fpass : tvm.transform.Pass
+        The result pass
+    """
+    return _ffi_api.LowerTileOpCPU()  # type: ignore
+
+
+def WarpSpecialized():
+    """WarpSpecialized
+
+    Returns
+    -------
+    fpass : tvm.transform.Pass
+        The result pass
+    """
+    return _ffi_api.WarpSpecialized()  # type: ignore
+
+
 def InjectSoftwarePipeline():
     """InjectSoftwarePipeline
 
@@ -75,6 +131,17 @@ def InjectSoftwarePipeline():
     return _ffi_api.InjectSoftwarePipeline()  # type: ignore
 
 
+def BoundarySpecialize():
+    """BoundarySpecialize
+
+    Returns
+    -------
+    fpass : tvm.transform.Pass
+        The result pass
+    """
+    return _ffi_api.BoundarySpecialize()  # type: ignore
+
+
 def FrontendLegalize():
     """FrontendLegalize
 
@@ -84,3 +151,61 @@ def FrontendLegalize():
         The result pass
     """
     return _ffi_api.FrontendLegalize()  # type: ignore
+
+
+def EstimateRegisterUsage():
+    """Warn about the kernels whose local arrays exceed the registers of their launch bounds
+
+    Returns
+    -------
+    fpass : tvm.transform.Pass
+        The result pass
+    """
+    return _ffi_api.EstimateRegisterUsage()  # type: ignore
+
+
+def SharedMemoryReuse():
+    """Pack the dynamic shared buffers of the kernels whose live ranges do not intersect
+
+    Returns
+    -------
+    fpass : tvm.transform.Pass
+        The result pass
+    """
+    return _ffi_api.SharedMemoryReuse()  # type: ignore
+
+
+def HoistIndex():
+    """HoistIndex, the loop invariant index arithmetic of the device kernels computed before the
+    loops
+
+    Returns
+    -------
+    fpass : tvm.transform.Pass
+        The result pass
+    """
+    return _ffi_api.HoistIndex()  # type: ignore
+
+
+def InstrumentTiming():
+    """Time the stages of the pipelined loops and the tile ops into a ring buffer passed as the last
+    argument of the kernels (pass config tl.instrument_timing)
+
+    Returns
+    -------
+    fpass : tvm.transform.Pass
+        The result pass
+    """
+    return _ffi_api.InstrumentTiming()  # type: ignore
+
+
+def PromoteLocalArray():
+    """Keep the local arrays in registers: unroll the loops of their accesses by non-constant
+    indices or make them select chains, and warn about the other ones
+
+    Returns
+    -------
+    fpass : tvm.transform.Pass
+        The result pass
+    """
+    return _ffi_api.PromoteLocalArray()  # type: ignore
@@ -16,15 +16,32 @@
 # under the License.
 """The profiler and convert to torch utils"""
 
-from typing import Any, List
+from typing import Any, Callable, Dict, List, Optional, Tuple
+from collections import OrderedDict
+from dataclasses import asdict, dataclass, field
 from enum import Enum
 from functools import partial
+import ctypes
+import json
+import logging
+import os
+import re
+import tempfile
+import threading
+import weakref
 import torch
+import torch.utils.dlpack
 
+import tvm
+from tvm import tir
+from tvm._ffi.runtime_ctypes import DataType, Device, TVMArray
 from tvm.relay import TensorType
-from tvm.contrib.dlpack import to_pytorch_func
+from tvm.runtime.ndarray import _make_array
 
-from .engine import lower
+from .cost_model import CostModel, extract_features
+from .engine import get_kernel_metadata, lower, lower_many, specialize_func
+
+logger = logging.getLogger(__name__)
 
 
 class TensorSupplyType(Enum):
@@ -36,11 +53,420 @@ class TensorSupplyType(Enum):
     One = 6
 
 
+# the (device, stream handle, generation) of the TVM stream set by set_tvm_stream in each thread,
+# the generation counts the destroyed streams, whose handles may be reused by the new ones
+_stream_state = threading.local()
+_stream_generation = 0
+
+# the TVM names of the torch dtypes not spelled the same
+_TORCH_FP8_DTYPES = {
+    "float8_e4m3fn": "e4m3_float8",
+    "float8_e5m2": "e5m2_float8",
+}
+
+
+def map_torch_type(dtype: str) -> torch.dtype:
+    """The torch dtype of a TVM dtype name."""
+    for torch_name, tvm_name in _TORCH_FP8_DTYPES.items():
+        if dtype == tvm_name:
+            return getattr(torch, torch_name)
+    return getattr(torch, dtype)
+
+
+def map_tvm_type(dtype: torch.dtype) -> str:
+    """The TVM dtype name of a torch dtype."""
+    name = str(dtype).replace("torch.", "")
+    return _TORCH_FP8_DTYPES.get(name, name)
+
+
+def to_tvm_array(tensor: torch.Tensor) -> tvm.nd.NDArray:
+    """A TVM array sharing the storage of the tensor."""
+    name = str(tensor.dtype).replace("torch.", "")
+    if name not in _TORCH_FP8_DTYPES:
+        return tvm.nd.from_dlpack(torch.utils.dlpack.to_dlpack(tensor))
+    # DLPack has no fp8 type code, exchange the bytes and set the dtype of the TVM array
+    array = tvm.nd.from_dlpack(torch.utils.dlpack.to_dlpack(tensor.view(torch.uint8)))
+    array.handle.contents.dtype = tvm.DataType(_TORCH_FP8_DTYPES[name])
+    return array
+
+
+class DLTensorCache:
+    """The DLTensors of the torch tensors passed to the kernels, keyed by data pointer, shape,
+    strides, dtype and device.
+
+    Unlike to_tvm_array, no DLPack capsule and no NDArray is created per call: the kernels get a
+    view (passed as a DLTensor handle) of a DLTensor built on the first call with the same key.
+    The DLTensors do not own the storage of the tensors, a tensor freed and reallocated at the
+    same address with the same layout reuses a valid entry. The least recently used of the
+    capacity entries is evicted first.
+    """
+
+    def __init__(self, capacity: int = 256):
+        self.capacity = capacity
+        self._entries = OrderedDict()
+
+    def get(self, tensor: torch.Tensor):
+        """The TVM view of the tensor."""
+        device = tensor.device
+        key = (tensor.data_ptr(), tensor.shape, tensor.stride(), tensor.dtype, device)
+        entry = self._entries.get(key)
+        if entry is not None:
+            self._entries.move_to_end(key)
+            return entry[0]
+        shape = (ctypes.c_int64 * tensor.dim())(*tensor.shape)
+        strides = (ctypes.c_int64 * tensor.dim())(*tensor.stride())
+        array = TVMArray()
+        array.data = tensor.data_ptr()
+        device_type = Device.STR2MASK["cuda" if device.type == "cuda" else "cpu"]
+        array.device = Device(device_type, device.index or 0)
+        array.ndim = tensor.dim()
+        array.dtype = DataType(map_tvm_type(tensor.dtype))
+        array.shape = shape
+        array.strides = strides
+        array.byte_offset = 0
+        view = _make_array(ctypes.addressof(array), True, False)
+        # the view points to the ctypes structures, which live as long as the entry
+        self._entries[key] = (view, array, shape, strides)
+        if len(self._entries) > self.capacity:
+            self._entries.popitem(last=False)
+        return view
+
+    def clear(self):
+        self._entries.clear()
+
+
+def make_group_offsets(group_sizes: torch.Tensor, block_M: int):
+    """The offsets of the grouped kernels (T.group_search) from the number of rows of the groups.
+
+    Returns the int32 prefix sums (num_groups + 1 elements, starting from 0) of the rows and of the
+    ceildiv(rows, block_M) tiles of the groups, on the device of group_sizes. All the tiles fit in
+    ceildiv(sum(rows), block_M) + num_groups blocks, the bound to launch the kernel with.
+    """
+    sizes = group_sizes.to(torch.int32)
+    zero = torch.zeros(1, dtype=torch.int32, device=sizes.device)
+    row_offsets = torch.cat([zero, torch.cumsum(sizes, 0, dtype=torch.int32)])
+    tiles = (sizes + block_M - 1) // block_M
+    tile_offsets = torch.cat([zero, torch.cumsum(tiles, 0, dtype=torch.int32)])
+    return row_offsets, tile_offsets
+
+
+def make_block_sparse_lut(block_mask: torch.Tensor):
+    """The non-empty column tiles of each row tile of a block-sparse layout.
+
+    block_mask is the [num_row_tiles, num_col_tiles] layout, nonzero for the tiles to compute.
+    Returns the int32 offsets (num_row_tiles + 1 elements, starting from 0) and the int32 column
+    tile indices of the rows, on the device of block_mask: the row tile m iterates
+    `for t in T.Pipelined(offsets[m], offsets[m + 1])` over the tiles indices[t], so the empty
+    tiles are skipped without a branch in the pipelined loop.
+    """
+    mask = block_mask != 0
+    zero = torch.zeros(1, dtype=torch.int32, device=mask.device)
+    offsets = torch.cat([zero, torch.cumsum(mask.sum(1, dtype=torch.int32), 0, dtype=torch.int32)])
+    indices = mask.nonzero()[:, 1].to(torch.int32).contiguous()
+    return offsets, indices
+
+
+def compress_2_4(A: torch.Tensor):
+    """Compress the 2:4 sparse A for T.gemm_sp.
+
+    A is a [M, K] tensor with at most 2 nonzeros in each group of 4 consecutive elements of a row,
+    K a multiple of 32. Returns the [M, K / 2] compressed A holding the 2 kept elements of each
+    group in the order of K (the first ones of a group with less than 2 nonzeros), and the
+    [M, K / 32] int32 metadata: the indices in the group of the kept elements, 2 bits each with the
+    lower one first, the group g of a word in the bits [4 * (g % 8), 4 * (g % 8) + 4).
+    """
+    M, K = A.shape
+    assert K % 32 == 0, "the sparse gemm requires K a multiple of 32"
+    groups = A.reshape(M, K // 4, 4)
+    position = torch.arange(4, device=A.device)
+    # the nonzeros first, then the lower indices
+    score = (groups != 0).to(torch.int32) * 4 + (3 - position)
+    assert bool(((groups != 0).sum(-1) <= 2).all()), "A is not 2:4 sparse"
+    index = torch.topk(score, 2, dim=-1).indices.sort(dim=-1).values
+    values = torch.gather(groups, -1, index).reshape(M, K // 2).contiguous()
+    nibbles = (index[..., 0] | (index[..., 1] << 2)).to(torch.int64).reshape(M, K // 32, 8)
+    shifts = torch.arange(0, 32, 4, device=A.device, dtype=torch.int64)
+    words = (nibbles << shifts).sum(-1)
+    # the unsigned words as int32
+    meta = torch.where(words >= 2**31, words - 2**32, words).to(torch.int32).contiguous()
+    return values, meta
+
+
+def set_tvm_stream(stream: Any = None, device_id: Optional[int] = None):
+    """Launch the following TVM kernels of the current thread on the stream, a torch.cuda.Stream,
+    an SMPartition or a raw cudaStream_t, the current torch stream by default."""
+    if device_id is None:
+        device_id = torch.cuda.current_device()
+    if stream is None:
+        stream = torch.cuda.current_stream(device_id)
+    if isinstance(stream, SMPartition):
+        stream = stream.stream
+    if isinstance(stream, torch.cuda.Stream):
+        stream = stream.cuda_stream
+    key = (device_id, stream, _stream_generation)
+    if getattr(_stream_state, "stream", None) != key:
+        tvm.cuda(device_id).set_raw_stream(stream)
+        _stream_state.stream = key
+
+
+def invalidate_tvm_stream(stream: Any = None):
+    """Forget the streams set by set_tvm_stream in all the threads, called when a stream passed to
+    it is destroyed (the SMPartitions do it themselves), so that the next set_tvm_stream sets the
+    stream again even if the new one got the same handle. The kernels of the current thread are
+    launched on the default stream until then if it was the destroyed stream."""
+    global _stream_generation
+    _stream_generation += 1
+    if isinstance(stream, SMPartition):
+        stream = stream.stream
+    if isinstance(stream, torch.cuda.Stream):
+        stream = stream.cuda_stream
+    current = getattr(_stream_state, "stream", None)
+    if current is not None and (stream is None or current[1] == stream):
+        tvm.cuda(current[0]).set_raw_stream(0)
+    _stream_state.stream = None
+
+
+def preload_kernels(mod, devices: Optional[List[int]] = None):
+    """Load the kernels of a module returned by lower (or loaded from an exported library) on the
+    devices, all the visible ones by default, concurrently. Otherwise each device loads them on
+    the first launch of one of its kernels, e.g. in the first request served on the device."""
+    tvm.get_global_func("runtime.module.cuda_preload")(mod, *(devices or []))
+
+
+_cudart = None
+
+
+def _get_cudart():
+    global _cudart
+    if _cudart is None:
+        for name in ["libcudart.so", "libcudart.so.12", "libcudart.so.11.0"]:
+            try:
+                _cudart = ctypes.CDLL(name)
+                break
+            except OSError:
+                continue
+        assert _cudart is not None, "Can not load the CUDA runtime library"
+    return _cudart
+
+
+class _AccessPolicyWindow(ctypes.Structure):
+    _fields_ = [
+        ("base_ptr", ctypes.c_void_p),
+        ("num_bytes", ctypes.c_size_t),
+        ("hit_ratio", ctypes.c_float),
+        ("hit_prop", ctypes.c_int),
+        ("miss_prop", ctypes.c_int),
+    ]
+
+
+# cudaStreamAttrValue, a union of the launch attributes of 64 bytes
+class _StreamAttrValue(ctypes.Union):
+    _fields_ = [("window", _AccessPolicyWindow), ("pad", ctypes.c_char * 64)]
+
+
+def _set_access_policy_window(stream: int, window: _AccessPolicyWindow):
+    cudart = _get_cudart()
+    value = _StreamAttrValue()
+    value.window = window
+    # cudaStreamAttributeAccessPolicyWindow
+    err = cudart.cudaStreamSetAttribute(ctypes.c_void_p(stream), 1, ctypes.byref(value))
+    assert err == 0, "cudaStreamSetAttribute failed with error {}".format(err)
+
+
+def set_l2_persisting(tensor: torch.Tensor, hit_ratio: Optional[float] = None, stream: Any = None):
+    """Keep the tensor, e.g. the weights reused by all the blocks, in the persisting part of the L2
+    cache for the kernels launched on the stream (the current torch stream by default), so that
+    streaming the other tensors does not evict it. hit_ratio is the fraction of the tensor that
+    persists, by default as much as the persisting L2 holds."""
+    cudart = _get_cudart()
+    device_id = tensor.device.index
+    if stream is None:
+        stream = torch.cuda.current_stream(device_id)
+    if isinstance(stream, torch.cuda.Stream):
+        stream = stream.cuda_stream
+    max_persisting, max_window = ctypes.c_int(0), ctypes.c_int(0)
+    # cudaDevAttrMaxPersistingL2CacheSize and cudaDevAttrMaxAccessPolicyWindowSize
+    cudart.cudaDeviceGetAttribute(ctypes.byref(max_persisting), 108, device_id)
+    cudart.cudaDeviceGetAttribute(ctypes.byref(max_window), 109, device_id)
+    assert max_persisting.value > 0, "The device has no persisting L2 cache"
+    num_bytes = min(tensor.numel() * tensor.element_size(), max_window.value)
+    persisting = min(num_bytes, max_persisting.value)
+    # cudaLimitPersistingL2CacheSize
+    err = cudart.cudaDeviceSetLimit(0x06, ctypes.c_size_t(persisting))
+    assert err == 0, "cudaDeviceSetLimit failed with error {}".format(err)
+    if hit_ratio is None:
+        hit_ratio = persisting / num_bytes
+    # the hits persist (cudaAccessPropertyPersisting), the misses stream (Streaming)
+    window = _AccessPolicyWindow(tensor.data_ptr(), num_bytes, hit_ratio, 2, 1)
+    _set_access_policy_window(stream, window)
+
+
+def reset_l2_persisting(stream: Any = None):
+    """Remove the access policy window of set_l2_persisting from the stream and release the lines
+    held in the persisting L2 cache."""
+    cudart = _get_cudart()
+    if stream is None:
+        stream = torch.cuda.current_stream()
+    if isinstance(stream, torch.cuda.Stream):
+        stream = stream.cuda_stream
+    # cudaAccessPropertyNormal
+    _set_access_policy_window(stream, _AccessPolicyWindow(None, 0, 0.0, 0, 0))
+    err = cudart.cudaCtxResetPersistingL2Cache()
+    assert err == 0, "cudaCtxResetPersistingL2Cache failed with error {}".format(err)
+
+
+def prefetch_l2(tensors: List[torch.Tensor], stream: Any = None, persisting_bytes: int = 0):
+    """Prefetch the tensors into the L2 cache with a kernel on the stream (the current torch
+    stream by default), e.g. the weights of the next layer of a sequence of kernels on a side
+    stream waiting for the kernels before the current layer, so that they are loaded while the
+    current layer runs. With persisting_bytes, the size of the persisting L2 cache set aside by
+    set_l2_persisting, the lines are loaded as persisting ones through an access policy window of
+    the stream, which is restored to the one before, e.g. of set_l2_persisting, after the
+    prefetch is launched. Each tensor is prefetched in full, the caller keeps them within the L2
+    cache."""
+    prefetch = tvm.get_global_func("runtime.cuda.l2_prefetch")
+    for tensor in tensors:
+        device_id = tensor.device.index
+        if stream is None:
+            stream = torch.cuda.current_stream(device_id)
+        if isinstance(stream, torch.cuda.Stream):
+            stream = stream.cuda_stream
+        nbytes = tensor.numel() * tensor.element_size()
+        prefetch(
+            device_id,
+            ctypes.c_void_p(tensor.data_ptr()),
+            nbytes,
+            ctypes.c_void_p(stream),
+            persisting_bytes,
+        )
+
+
+class SMPartition:
+    """A stream whose kernels run on num_sms SMs of the device, e.g. to keep the latency critical
+    decode kernels isolated from a batch prefill running concurrently on the other SMs.
+
+    The SMs are split off the device into a CUDA green context (CUDA 12.5 and later, num_sms is
+    rounded up to the granularity of the arch, e.g. 8 SMs on sm_90), the kernels launched on
+    its stream are only scheduled on them. Otherwise it is a plain stream, only the persistent
+    kernels compiled for its num_sms stay within that many SMs.
+
+    Launch a kernel in the partition with kernel(*args, stream=partition), or with
+    set_tvm_stream(partition) for the modules called directly. The persistent and stream-K
+    schedules size their grids from the SMs of the partition when compiled under
+    partition.pass_config().
+
+    Parameters
+    ----------
+    num_sms : int
+        The number of SMs of the partition.
+    device_id : Optional[int]
+        The device, the current torch device by default.
+    """
+
+    def __init__(self, num_sms: int, device_id: Optional[int] = None):
+        if device_id is None:
+            device_id = torch.cuda.current_device()
+        self.device_id = device_id
+        self.handle = tvm.get_global_func("runtime.cuda.create_sm_partition")(device_id, num_sms)
+        self.num_sms = tvm.get_global_func("runtime.cuda.sm_partition_num_sms")(self.handle)
+        self.isolated = bool(tvm.get_global_func("runtime.cuda.sm_partition_isolated")(self.handle))
+        cuda_stream = tvm.get_global_func("runtime.cuda.sm_partition_stream")(self.handle)
+        self.stream = torch.cuda.ExternalStream(cuda_stream.value, device=device_id)
+        # the stream is destroyed with the handle
+        weakref.finalize(self, invalidate_tvm_stream, cuda_stream.value)
+
+    def pass_config(self) -> Dict[str, Any]:
+        """The PassContext config compiling the persistent kernels for the SMs of the partition."""
+        return {"tl.num_sms": self.num_sms}
+
+    def synchronize(self):
+        self.stream.synchronize()
+
+
+_cuda_driver = None
+
+
+def _get_cuda_driver():
+    global _cuda_driver
+    if _cuda_driver is None:
+        _cuda_driver = ctypes.CDLL("libcuda.so.1")
+    return _cuda_driver
+
+
+class _IpcMemHandle(ctypes.Structure):
+    _fields_ = [("reserved", ctypes.c_ubyte * 64)]
+
+
+# the addresses of the peer allocations opened in this process, by their IPC handle
+_peer_mappings: Dict[bytes, int] = {}
+
+
+def make_peer_table(tensor: torch.Tensor, group: Any = None) -> torch.Tensor:
+    """The addresses of the copies of tensor on all the ranks of the torch.distributed group, for
+    T.peer_buffer. Each rank calls it (a collective) with its own tensor of the same shape, the
+    ranks being the processes of the GPUs of one node. The copies are mapped with the CUDA IPC
+    handles of their allocations, peer to peer over NVLink when available, and stay mapped for the
+    lifetime of the process, the tensors should not be freed while the kernels use them.
+
+    Returns
+    -------
+    peers : torch.Tensor
+        The int64 tensor of the world size on the device of tensor, peers[r] being the address of
+        the copy of rank r.
+    """
+    import torch.distributed as dist  # pylint: disable=import-outside-toplevel
+
+    cudart, driver = _get_cudart(), _get_cuda_driver()
+    # the IPC handles refer to the whole allocation of the caching allocator
+    base, size = ctypes.c_uint64(0), ctypes.c_size_t(0)
+    err = driver.cuMemGetAddressRange_v2(
+        ctypes.byref(base), ctypes.byref(size), ctypes.c_uint64(tensor.data_ptr())
+    )
+    assert err == 0, "cuMemGetAddressRange failed with error {}".format(err)
+    handle = _IpcMemHandle()
+    err = cudart.cudaIpcGetMemHandle(ctypes.byref(handle), ctypes.c_void_p(base.value))
+    assert err == 0, "cudaIpcGetMemHandle failed with error {}".format(err)
+
+    entries = [None] * dist.get_world_size(group)
+    dist.all_gather_object(entries, (bytes(handle), tensor.data_ptr() - base.value), group=group)
+    addresses = []
+    for rank, (raw, offset) in enumerate(entries):
+        if rank == dist.get_rank(group):
+            addresses.append(tensor.data_ptr())
+            continue
+        if raw not in _peer_mappings:
+            ptr = ctypes.c_void_p()
+            # cudaIpcMemLazyEnablePeerAccess
+            err = cudart.cudaIpcOpenMemHandle(
+                ctypes.byref(ptr), _IpcMemHandle.from_buffer_copy(raw), 1
+            )
+            assert err == 0, "cudaIpcOpenMemHandle failed with error {}".format(err)
+            _peer_mappings[raw] = ptr.value
+        addresses.append(_peer_mappings[raw] + offset)
+    return torch.tensor(addresses, dtype=torch.int64, device=tensor.device)
+
+
+def _eval_shape(shape, shape_vars: Dict[tir.Var, int]) -> List[int]:
+    """Evaluate a (possibly symbolic) buffer shape under the bound shape variables."""
+    result = []
+    for dim in shape:
+        if not isinstance(dim, tir.IntImm):
+            dim = tir.stmt_functor.substitute(dim, shape_vars)
+            dim = tvm.arith.Analyzer().simplify(dim)
+            if not isinstance(dim, tir.IntImm):
+                raise ValueError(f"Unbound symbolic dimension {dim} in shape {shape}")
+        result.append(int(dim))
+    return result
+
+
 def get_tensor_supply(supply_type: TensorSupplyType):
-    def get_tensor(tensor: TensorType) -> torch.Tensor:
-        dtype = torch.__getattribute__(str(tensor.dtype))
+    def get_tensor(tensor: TensorType, shape_vars: Dict[tir.Var, int] = None) -> torch.Tensor:
+        dtype = map_torch_type(str(tensor.dtype))
         device = torch.cuda.current_device()
-        shape = list(map(int, tensor.shape))
+        shape = _eval_shape(tensor.shape, shape_vars or {})
+        if str(tensor.dtype) in _TORCH_FP8_DTYPES.values():
+            # the random generators do not support fp8, draw in float16 and round
+            return get_tensor(TensorType(tensor.shape, "float16"), shape_vars).to(dtype)
         if supply_type == TensorSupplyType.Integer:
             return torch.randint(low=-2, high=3, size=shape, device=device, dtype=dtype)
         elif supply_type == TensorSupplyType.Uniform:
@@ -59,44 +485,302 @@ def get_tensor_supply(supply_type: TensorSupplyType):
     return get_tensor
 
 
+def parse_timers(source: str) -> Tuple[int, Dict[int, str]]:
+    """The capacity of the ring buffer and the names of the timers of the kernels compiled with
+    the pass config tl.instrument_timing, from the kernel source (0 and {} if not instrumented)."""
+    capacity, names = 0, {}
+    for _, records, timers in re.findall(r"tl timer : (\w+): (\d+) records: (.*)", source):
+        capacity = int(records)
+        for timer in timers.split(";"):
+            tag, name = timer.split("=", 1)
+            names[int(tag)] = name
+    return capacity, names
+
+
+def decode_timer_trace(
+    trace: torch.Tensor, names: Dict[int, str], path: Optional[str] = None
+) -> Dict[str, Any]:
+    """Decode the ring buffer of the timers of an instrumented kernel into a Chrome trace (the
+    JSON object format, loaded by chrome://tracing or Perfetto), written to path if given.
+
+    Each record becomes a complete event of the timer on the thread of its warp, the warps grouped
+    by the SM running them. The times are the %globaltimer nanoseconds relative to the first
+    record, the elapsed clock64 cycles are kept in the args of the events. When more records than
+    the capacity were written, only the last ones are left in the buffer.
+    """
+    trace = trace.cpu().view(-1, 4)
+    capacity = trace.shape[0] - 1
+    count = int(trace[0, 0])
+    if count > capacity:
+        logger.warning(
+            "%d timer records written to a ring buffer of %d, increase tl.timer_capacity to keep "
+            "all of them",
+            count,
+            capacity,
+        )
+    records = trace[1 : 1 + min(count, capacity)]
+    events = []
+    if len(records):
+        mask = 0xFFFFFFFF
+        sms, blocks = (records[:, 0] >> 32).tolist(), (records[:, 0] & mask).tolist()
+        warps, tags = (records[:, 1] >> 32).tolist(), (records[:, 1] & mask).tolist()
+        starts = (records[:, 2] - records[:, 2].min()).tolist()
+        elapsed = ((records[:, 3] >> 32) & mask).tolist()
+        cycles = (records[:, 3] & mask).tolist()
+        threads = set()
+        for sm, block, warp, tag, start, ns, cycle in zip(
+            sms, blocks, warps, tags, starts, elapsed, cycles
+        ):
+            tid = block * 32 + warp
+            if (sm, tid) not in threads:
+                threads.add((sm, tid))
+                args = {"name": f"block {block} warp {warp}"}
+                events.append(
+                    {"name": "thread_name", "ph": "M", "pid": sm, "tid": tid, "args": args}
+                )
+            events.append(
+                {
+                    "name": names.get(tag, f"timer {tag}"),
+                    "ph": "X",
+                    "pid": sm,
+                    "tid": tid,
+                    "ts": start / 1000,
+                    "dur": ns / 1000,
+                    "args": {"cycles": cycle},
+                }
+            )
+        for sm in sorted(set(sms)):
+            events.append(
+                {"name": "process_name", "ph": "M", "pid": sm, "args": {"name": f"SM {sm}"}}
+            )
+    result = {"traceEvents": events, "displayTimeUnit": "ns"}
+    if path is not None:
+        with open(path, "w") as f:
+            json.dump(result, f)
+    return result
+
+
 class ConvertTorch:
-    def __init__(self, mod, params: List[TensorType], result_idx: List[int]) -> None:
+    """The kernels of a module called with torch tensors, the outputs (result_idx) allocated per
+    call, or passed with out= as contiguous tensors of their dtype and shape on the current device.
+
+    With reuse_outputs, the outputs are taken from a pool keyed by their shape instead, the
+    tensors returned by a call are then overwritten by the next calls with the same shapes: the
+    caller copies the ones it keeps, e.g. in a per token decode loop. At most pool_capacity
+    shapes are kept, the least recently used first evicted.
+    """
+
+    def __init__(
+        self,
+        mod,
+        params: List[TensorType],
+        result_idx: List[int],
+        reuse_outputs: bool = False,
+        pool_capacity: int = 64,
+    ) -> None:
         self.mod = mod
         self.params = params
         self.result_idx = result_idx
+        self.reuse_outputs = reuse_outputs
+        self.pool_capacity = pool_capacity
+        self.output_pool = OrderedDict()
+        # the ring buffer of the timers, the last argument of the kernels compiled with the pass
+        # config tl.instrument_timing
+        self.timer_capacity, self.timer_names = parse_timers(self.get_kernel_source())
+        self.timer_trace = None
+        self.dltensors = DLTensorCache()
+        # the dtypes of the outputs, and their shapes when static
+        self.result_dtypes = {i: map_torch_type(str(params[i].dtype)) for i in result_idx}
+        self.result_shapes = {}
+        for i in result_idx:
+            if all(isinstance(dim, tir.IntImm) for dim in params[i].shape):
+                self.result_shapes[i] = [int(dim) for dim in params[i].shape]
         self.func = self._convert_torch_func()
 
+    def _get_output(self, i: int, shape: List[int], device: int) -> torch.Tensor:
+        if not self.reuse_outputs:
+            return torch.empty(*shape, dtype=self.result_dtypes[i], device=device)
+        key = (i, tuple(shape), device)
+        tensor = self.output_pool.get(key)
+        if tensor is None:
+            tensor = torch.empty(*shape, dtype=self.result_dtypes[i], device=device)
+            self.output_pool[key] = tensor
+            if len(self.output_pool) > self.pool_capacity:
+                self.output_pool.popitem(last=False)
+        else:
+            self.output_pool.move_to_end(key)
+        return tensor
+
     def _convert_torch_func(self) -> callable:
-        torch_func = to_pytorch_func(self.mod)
+        # the cached PackedFunc, skipping the module lookup per call
+        entry = self.mod.entry_func
+        dltensors = self.dltensors
+        num_args = len(self.params)
+        result_idx = self.result_idx
+        input_idx = [i for i in range(num_args) if i not in result_idx]
+        # The arguments of the kernel are bound once per thread, the slots of the inputs and the
+        # outputs of a call are patched with their DLTensors, which are only built for the new
+        # tensors (the pooled outputs keep theirs).
+        bound = threading.local()
 
-        def func(*ins: List[torch.Tensor]):
-            assert len(ins) + len(self.result_idx) == len(self.params)
-            ins_idx = 0
-            args = []
+        def func(*ins: List[torch.Tensor], stream: Any = None, out: Any = None):
+            assert len(ins) == len(input_idx)
+            args = getattr(bound, "args", None)
+            if args is None:
+                args = bound.args = [None] * (num_args + (1 if self.timer_capacity else 0))
+            if self.timer_capacity:
+                if self.timer_trace is None:
+                    self.reset_timer_trace()
+                args[num_args] = dltensors.get(self.timer_trace)
             device = torch.cuda.current_device()
-            for i in range(len(self.params)):
-                if i in self.result_idx:
-                    dtype = torch.__getattribute__(str(self.params[i].dtype))
-                    shape = list(map(int, self.params[i].shape))
-                    tensor = torch.empty(*shape, dtype=dtype, device=device)
-                else:
-                    tensor = ins[ins_idx]
-                    ins_idx += 1
-                args.append(tensor)
-            torch_func(*args)
-            if len(self.result_idx) == 1:
-                return args[self.result_idx[0]]
+            # the outputs are allocated and the kernels launched on the stream of the caller
+            set_tvm_stream(stream, device)
+            for i, tensor in zip(input_idx, ins):
+                args[i] = dltensors.get(tensor) if isinstance(tensor, torch.Tensor) else tensor
+            if out is not None:
+                outs = [out] if isinstance(out, torch.Tensor) else list(out)
+                assert len(outs) == len(result_idx), "Expected {} outputs in out=".format(
+                    len(result_idx)
+                )
+                static = len(self.result_shapes) == len(result_idx)
+                shape_vars = {} if static else self._bind_shape_vars(ins)
+                for i, tensor in zip(result_idx, outs):
+                    assert tensor.dtype == self.result_dtypes[i], "out= expects {} for {}".format(
+                        self.result_dtypes[i], self.params[i]
+                    )
+                    shape = self.result_shapes.get(i)
+                    if shape is None:
+                        shape = _eval_shape(self.params[i].shape, shape_vars)
+                    assert list(tensor.shape) == shape, "out= expects the shape {} for {}".format(
+                        shape, self.params[i]
+                    )
+                    assert (
+                        tensor.is_cuda and tensor.device.index == device
+                    ), "out= expects a tensor on cuda:{} for {}".format(device, self.params[i])
+                    assert tensor.is_contiguous(), "out= expects a contiguous tensor for {}".format(
+                        self.params[i]
+                    )
+            else:
+                static = len(self.result_shapes) == len(result_idx)
+                shape_vars = {} if static else self._bind_shape_vars(ins)
+                outs = []
+                for i in result_idx:
+                    shape = self.result_shapes.get(i)
+                    if shape is None:
+                        shape = _eval_shape(self.params[i].shape, shape_vars)
+                    outs.append(self._get_output(i, shape, device))
+            for i, tensor in zip(result_idx, outs):
+                args[i] = dltensors.get(tensor)
+            entry(*args)
+            if len(outs) == 1:
+                return outs[0]
             else:
-                return [args[i] for i in self.result_idx]
+                return outs
 
         return func
 
+    def _bind_shape_vars(self, ins: List[torch.Tensor]) -> Dict[tir.Var, int]:
+        """Bind the symbolic dimensions of the inputs to the sizes of the given tensors, so that
+        the outputs of a dynamic-shape kernel can be allocated."""
+        shape_vars = {}
+        inputs = [p for i, p in enumerate(self.params) if i not in self.result_idx]
+        for param, tensor in zip(inputs, ins):
+            if not isinstance(tensor, torch.Tensor):
+                continue
+            for dim, size in zip(param.shape, tensor.shape):
+                if isinstance(dim, tir.Var):
+                    shape_vars[dim] = int(size)
+        return shape_vars
+
     def __call__(self, *args: Any, **kwds: Any) -> Any:
         return self.func(*args, **kwds)
 
     def get_kernel_source(self) -> str:
         return self.mod.imported_modules[0].get_source()
 
+    def get_kernel_metadata(self, query_driver: bool = True) -> Dict[str, Dict[str, Any]]:
+        """The static metadata of the kernels, see tl.get_kernel_metadata. With query_driver the
+        compiled module is loaded by the CUDA driver (on the current device) for the registers per
+        thread, the local memory bytes per thread and the static shared memory bytes of each
+        kernel (cuFuncGetAttribute), which do not need the ptxas report."""
+        metadata = get_kernel_metadata(self.mod)
+        device_mod = self.mod.imported_modules[0]
+        if not query_driver or device_mod.type_key != "cuda" or not metadata:
+            return metadata
+        with tempfile.TemporaryDirectory(prefix="tl_meta_") as tmp_dir:
+            path = os.path.join(tmp_dir, "kernel." + device_mod.format)
+            device_mod.save(path, device_mod.format)
+            with open(path, "rb") as f:
+                image = f.read() + b"\0"
+        driver = _get_cuda_driver()
+        # the runtime makes the primary context of the current device current
+        _get_cudart().cudaFree(ctypes.c_void_p(0))
+        module = ctypes.c_void_p()
+        err = driver.cuModuleLoadData(ctypes.byref(module), ctypes.c_char_p(image))
+        assert err == 0, "cuModuleLoadData failed with error {}".format(err)
+        try:
+            # CU_FUNC_ATTRIBUTE_NUM_REGS, LOCAL_SIZE_BYTES and SHARED_SIZE_BYTES
+            attributes = {"registers": 4, "local_memory": 3, "static_shared_memory": 1}
+            for kernel, info in metadata.items():
+                func = ctypes.c_void_p()
+                err = driver.cuModuleGetFunction(
+                    ctypes.byref(func), module, ctypes.c_char_p(kernel.encode())
+                )
+                assert err == 0, "cuModuleGetFunction failed with error {}".format(err)
+                for key, attribute in attributes.items():
+                    value = ctypes.c_int()
+                    err = driver.cuFuncGetAttribute(ctypes.byref(value), attribute, func)
+                    assert err == 0, "cuFuncGetAttribute failed with error {}".format(err)
+                    info[key] = value.value
+        finally:
+            driver.cuModuleUnload(module)
+        return metadata
+
+    def reset_timer_trace(self):
+        """Clear the records of the timers of an instrumented kernel, the following calls append
+        their records to the ring buffer."""
+        assert self.timer_capacity, "The kernel is not compiled with tl.instrument_timing"
+        size = (self.timer_capacity + 1) * 4
+        device = torch.cuda.current_device()
+        if self.timer_trace is None:
+            self.timer_trace = torch.zeros(size, dtype=torch.int64, device=device)
+        else:
+            self.timer_trace.zero_()
+
+    def get_timer_trace(self, path: Optional[str] = None) -> Dict[str, Any]:
+        """The Chrome trace of the timers recorded by the calls of an instrumented kernel since the
+        last reset_timer_trace, see decode_timer_trace."""
+        assert self.timer_trace is not None, "No call of an instrumented kernel"
+        torch.cuda.synchronize()
+        return decode_timer_trace(self.timer_trace, self.timer_names, path)
+
+
+@dataclass
+class BenchResult:
+    """The latency of a kernel and the throughput it achieves against the roofline of the device."""
+
+    latency_ms: float
+    # the T.gemm flops of all the blocks
+    flops: int
+    # the global memory read and written by the tile ops of all the blocks, the L2 hits included
+    global_bytes: int
+    # the bytes of the arguments, the DRAM traffic if each is read or written once
+    dram_bytes: int
+    tflops: float
+    # dram_bytes over the latency
+    bandwidth_gbps: float
+    peak_tflops: float
+    peak_bandwidth_gbps: float
+    # the latency at the peak flops or bandwidth, whichever is longer, over the measured latency
+    roofline: float
+    # "compute" or "memory", the bound of the roofline
+    bound: str
+    # the named hardware counters returned by the counters collector of Profiler.summarize
+    counters: Dict[str, float] = field(default_factory=dict)
+
+    def to_dict(self) -> Dict[str, Any]:
+        return asdict(self)
+
 
 class Profiler(ConvertTorch):
     def __init__(
@@ -105,15 +789,27 @@ class Profiler(ConvertTorch):
         params: List[TensorType],
         result_idx: List[int],
         supply_type: TensorSupplyType = TensorSupplyType.Normal,
+        shape_vars: Optional[Dict[str, int]] = None,
+        reuse_outputs: bool = False,
     ):
-        super().__init__(mod, params, result_idx)
+        super().__init__(mod, params, result_idx, reuse_outputs=reuse_outputs)
         self.supply = get_tensor_supply(supply_type)
+        self.set_shape_vars(shape_vars or {})
+
+    def set_shape_vars(self, shape_vars: Dict[str, int]):
+        """Set the sizes used for the symbolic dimensions when generating the inputs,
+        e.g. {"m": 4096} for a kernel compiled with a dynamic m."""
+        self.shape_vars = {}
+        for param in self.params:
+            for dim in param.shape:
+                if isinstance(dim, tir.Var) and dim.name in shape_vars:
+                    self.shape_vars[dim] = shape_vars[dim.name]
 
     def _get_inputs(self):
         ins = []
         for i in range(len(self.params)):
             if i not in self.result_idx:
-                ins.append(self.supply(self.params[i]))
+                ins.append(self.supply(self.params[i], self.shape_vars))
         return ins
 
     def assert_allclose(self, reference_program: callable, atol: float = 1e-8, rtol: float = 1e-5):
@@ -140,6 +836,62 @@ class Profiler(ConvertTorch):
         bench_func = partial(func, *ins)
         return do_bench(bench_func, warmup=warmup, rep=rep)
 
+    def summarize(
+        self,
+        program: tir.PrimFunc,
+        func: Optional[callable] = None,
+        warmup=25,
+        rep=100,
+        counters: Optional[Callable[[Callable[[], Any]], Dict[str, float]]] = None,
+        peak_tflops: Optional[float] = None,
+        bandwidth_gbps: Optional[float] = None,
+    ) -> BenchResult:
+        """Benchmark func (the kernel by default) and relate the latency to the flops and the bytes
+        of the TL program the kernel is compiled from, counted statically from the shapes of the
+        tile ops times the grid (see extract_features).
+
+        Parameters
+        ----------
+        program : tir.PrimFunc
+            The TL program of the kernel, its symbolic dimensions are bound by set_shape_vars.
+        counters : Optional[Callable]
+            A collector of hardware counters, e.g. with CUPTI, called with the benchmarked function
+            (taking no argument) and returning the counters by name, e.g. the L2 hit rate or the
+            shared memory bank conflicts, kept in the result.
+        peak_tflops, bandwidth_gbps : Optional[float]
+            The peaks of the roofline, default to the specs of the current GPU (see CostModel).
+        """
+        ins = self._get_inputs()
+        bench_func = partial(func or self.func, *ins)
+        latency = do_bench(bench_func, warmup=warmup, rep=rep)
+        if self.shape_vars:
+            vmap = {var: tir.const(value, var.dtype) for var, value in self.shape_vars.items()}
+            program = program.with_body(tir.stmt_functor.substitute(program.body, vmap))
+            program = tir.transform.Simplify()(tvm.IRModule({"main": program}))["main"]
+        features = extract_features(program)
+        dram_bytes = 0
+        for param in self.params:
+            numel = 1
+            for dim in _eval_shape(param.shape, self.shape_vars):
+                numel *= dim
+            dram_bytes += numel * tvm.DataType(str(param.dtype)).bits // 8
+        model = CostModel(peak_tflops, bandwidth_gbps)
+        compute_ms = features.mma_flops / (model.peak_tflops * 1e12) * 1e3
+        memory_ms = dram_bytes / (model.bandwidth_gbps * 1e9) * 1e3
+        return BenchResult(
+            latency_ms=latency,
+            flops=features.mma_flops,
+            global_bytes=features.global_bytes,
+            dram_bytes=dram_bytes,
+            tflops=features.mma_flops / (latency * 1e-3) / 1e12,
+            bandwidth_gbps=dram_bytes / (latency * 1e-3) / 1e9,
+            peak_tflops=model.peak_tflops,
+            peak_bandwidth_gbps=model.bandwidth_gbps,
+            roofline=max(compute_ms, memory_ms) / latency,
+            bound="compute" if compute_ms >= memory_ms else "memory",
+            counters=counters(bench_func) if counters is not None else {},
+        )
+
 
 def do_bench(
     fn, warmup=25, rep=100, grad_to_none=None, quantiles=None, fast_flush=True, return_mode="mean"
@@ -231,3 +983,209 @@ def cached(func, result_idx: List[int], *args):
         mod = ConvertTorch(mod, params, result_idx)
         _cached[key] = mod
     return _cached[key]
+
+
+# the compute capability of each device index, read once
+_device_archs: Dict[int, Tuple[int, int]] = {}
+
+
+def _device_arch(index: int) -> Tuple[int, int]:
+    arch = _device_archs.get(index)
+    if arch is None:
+        arch = _device_archs[index] = torch.cuda.get_device_capability(index)
+    return arch
+
+
+class JITKernel:
+    """The kernels of a TL program factory compiled for the inputs of the calls, see jit.
+
+    The key of a call is made of, for each input tensor, its shape, dtype, strides and whether its
+    data is 16-byte aligned, of the compute capability of the device, and of the other arguments,
+    which must be hashable. A call with a new key runs the factory on the arguments, lowers the
+    program for the arch of the device (the disk kernel cache of lower skips the codegen and nvcc
+    when the program was compiled before) and keeps the kernel, the calls with a known key only
+    look it up.
+    """
+
+    def __init__(
+        self,
+        func: Callable[..., tir.PrimFunc],
+        out_idx: Optional[List[int]] = None,
+        target: str = "cuda",
+        pass_configs: Optional[Dict[str, Any]] = None,
+    ):
+        self.func = func
+        self.out_idx = [out_idx] if isinstance(out_idx, int) else list(out_idx or [])
+        self.target = target
+        self.pass_configs = pass_configs or {}
+        self.kernels: Dict[Tuple, ConvertTorch] = {}
+        self.hits = 0
+        self.misses = 0
+        self.__name__ = getattr(func, "__name__", "jit_kernel")
+        self.__doc__ = func.__doc__
+
+    def _key(self, args, kwargs) -> Tuple:
+        key = []
+        arch = None
+        for a in args:
+            if isinstance(a, torch.Tensor):
+                if arch is None and a.is_cuda:
+                    arch = _device_arch(a.device.index)
+                key.append((a.shape, a.dtype, a.stride(), a.data_ptr() % 16 == 0))
+            else:
+                key.append(a)
+        key.append(arch)
+        if kwargs:
+            key.append(tuple(sorted(kwargs.items())))
+        return tuple(key)
+
+    def _compile(self, args, kwargs, arch: Optional[Tuple[int, int]]) -> ConvertTorch:
+        program = self.func(*args, **kwargs)
+        target = self.target
+        if target == "cuda" and arch is not None:
+            target = "cuda -arch=sm_{}{}".format(*arch)
+        with tvm.transform.PassContext(config=self.pass_configs):
+            mod, params = lower(program, target=target)
+        return ConvertTorch(mod, params, self.out_idx)
+
+    def __call__(self, *args: Any, **kwargs: Any) -> Any:
+        key = self._key(args, kwargs)
+        kernel = self.kernels.get(key)
+        if kernel is None:
+            self.misses += 1
+            kernel = self.kernels[key] = self._compile(args, kwargs, key[len(args)])
+        else:
+            self.hits += 1
+        return kernel(*[a for a in args if isinstance(a, torch.Tensor)])
+
+    def cache_info(self) -> Dict[str, int]:
+        return {"hits": self.hits, "misses": self.misses, "size": len(self.kernels)}
+
+    def cache_clear(self):
+        self.kernels.clear()
+        self.hits = 0
+        self.misses = 0
+
+
+def jit(
+    func: Optional[Callable[..., tir.PrimFunc]] = None,
+    *,
+    out_idx: Optional[List[int]] = None,
+    target: str = "cuda",
+    pass_configs: Optional[Dict[str, Any]] = None,
+):
+    """Turn a factory of TL programs into a kernel called with torch tensors, compiled on the
+    first call of each shape, dtype, layout and device arch of its inputs (see JITKernel).
+
+    The factory is called with the arguments of the call and reads the shapes and dtypes of the
+    tensors to build the program, the other arguments are its compile-time constants. The kernel is
+    then launched on the input tensors, in order, and the outputs of out_idx are allocated and
+    returned as by ConvertTorch.
+
+    Example
+    -------
+    .. code-block:: python
+
+        @tl.jit(out_idx=[2])
+        def matmul(A, B, block_M=128, block_N=128, block_K=32):
+            (M, K), (_, N) = A.shape, B.shape
+            dtype = tl.map_tvm_type(A.dtype)
+            ...
+            return main
+
+        C = matmul(A, B)
+    """
+
+    def decorate(f):
+        return JITKernel(f, out_idx=out_idx, target=target, pass_configs=pass_configs)
+
+    return decorate if func is None else decorate(func)
+
+
+class SpecializedKernel:
+    """A TL program compiled for the hot values of some of its scalar parameters or dynamic
+    dimensions, e.g. the sequence length of the decoding kernels, with a generic kernel for the
+    other values. The values are folded into the specializations, so the loops bounded by them are
+    simplified, partitioned and unrolled at compile time. The calls take the inputs of ConvertTorch
+    and run the specialization of the values of the call, or the generic kernel.
+
+    Example
+    -------
+    .. code-block:: python
+
+        kernel = tl.SpecializedKernel(program, [3], [{"seq_len": 1}, {"seq_len": 4096}])
+        out = kernel(q, k, v)
+
+    Parameters
+    ----------
+    func : tir.PrimFunc
+        The program.
+    result_idx : List[int]
+        The outputs, see ConvertTorch.
+    specialize : List[Dict[str, Any]]
+        The values of the specializations, all binding the same names. A dynamic dimension should
+        be a dimension of an input.
+    generic : bool
+        Compile the generic kernel, the calls with other values fail otherwise.
+    """
+
+    def __init__(
+        self,
+        func: tir.PrimFunc,
+        result_idx: List[int],
+        specialize: List[Dict[str, Any]],
+        generic: bool = True,
+    ):
+        self.names = sorted(specialize[0])
+        assert all(sorted(values) == self.names for values in specialize)
+        inputs = [i for i in range(len(func.params)) if i not in result_idx]
+        # how to read each name from the inputs of a call: the input index and the dimension, or
+        # None for a scalar parameter
+        self.locators = []
+        scalar_params = []
+        for name in self.names:
+            found = None
+            for k, i in enumerate(inputs):
+                var = func.params[i]
+                if var not in func.buffer_map:
+                    if var.name == name:
+                        found = (k, None)
+                        scalar_params.append(i)
+                        break
+                    continue
+                dims = [str(dim) for dim in func.buffer_map[var].shape]
+                if name in dims:
+                    found = (k, dims.index(name))
+                    break
+            assert found is not None, "{} is not a scalar or a dimension of an input".format(name)
+            self.locators.append(found)
+        # the specialized scalar parameters are removed from the parameters
+        self.removed_inputs = {k for k, dim in self.locators if dim is None}
+        variant_result_idx = [i - sum(p < i for p in scalar_params) for i in result_idx]
+
+        funcs = [specialize_func(func, values) for values in specialize]
+        if generic:
+            funcs.append(func)
+        results = lower_many(funcs)
+        self.variants = {}
+        for values, (mod, params) in zip(specialize, results):
+            key = tuple(values[name] for name in self.names)
+            self.variants[key] = ConvertTorch(mod, params, variant_result_idx)
+        self.generic = ConvertTorch(*results[-1], result_idx) if generic else None
+
+    def _key(self, ins) -> Tuple:
+        key = []
+        for k, dim in self.locators:
+            value = ins[k] if dim is None else ins[k].shape[dim]
+            key.append(value.item() if isinstance(value, torch.Tensor) else value)
+        return tuple(key)
+
+    def __call__(self, *ins: Any, **kwds: Any) -> Any:
+        variant = self.variants.get(self._key(ins))
+        if variant is not None:
+            ins = [x for k, x in enumerate(ins) if k not in self.removed_inputs]
+            return variant(*ins, **kwds)
+        assert self.generic is not None, "No specialization of {} = {}".format(
+            self.names, self._key(ins)
+        )
+        return self.generic(*ins, **kwds)
@@ -0,0 +1,61 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+# pylint: disable=invalid-name,unused-variable,unused-argument,no-member
+"""Dense alter op for Qualcomm Adreno GPU"""
+
+from tvm import relay
+from ..utils import get_const_tuple
+from ..nn import dense_alter_layout
+
+
+@dense_alter_layout.register("adreno")
+def _alter_dense_layout(attrs, inputs, tinfos, out_type):
+    """
+    Rewrite the dense of a constant weight into the 1x1 conv2d in NHWC4c / HWIO4o layouts,
+    so that the texture planner puts the weight into a 2D image and the image2d conv2d
+    schedule computes the tiled product. All the layout changes are reshapes except the
+    transposition of the weight, which is folded at compile time:
+      data (M, K) -> (1, M / 4, 4, K / 4, 4)
+      weight (N, K) -> (1, 1, K, N / 4, 4)
+      output (1, M / 4, 4, N / 4, 4) -> (M, N)
+    M is required to be a multiple of 16, the conv2d schedule rounding up its spatial
+    dimensions to multiples of 4.
+    """
+    data_tensor, weight_tensor = tinfos
+    if not isinstance(inputs[1], relay.Constant):
+        return None
+    if len(data_tensor.shape) != 2 or data_tensor.dtype not in ("float16", "float32"):
+        return None
+    if any(not isinstance(dim, int) for dim in get_const_tuple(data_tensor.shape)):
+        return None
+    M, K = get_const_tuple(data_tensor.shape)
+    N, _ = get_const_tuple(weight_tensor.shape)
+    if M % 16 != 0 or K % 4 != 0 or N % 4 != 0:
+        return None
+
+    data = relay.reshape(inputs[0], (1, M // 4, 4, K // 4, 4))
+    weight = relay.reshape(relay.transpose(inputs[1], (1, 0)), (1, 1, K, N // 4, 4))
+    conv = relay.nn.conv2d(
+        data,
+        weight,
+        channels=N,
+        kernel_size=(1, 1),
+        data_layout="NHWC4c",
+        kernel_layout="HWIO4o",
+        out_dtype=out_type.dtype,
+    )
+    return relay.reshape(conv, (M, N))
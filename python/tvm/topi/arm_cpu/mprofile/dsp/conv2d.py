@@ -29,6 +29,7 @@ from .micro_kernel.gemm import (
     intrin_gemm_MxKxN,
     gemm_MxKxN_impl,
 )
+from .micro_kernel.common import target_has_mve
 
 
 def conv2d_nhwc_dsp(*args, **kwargs):
@@ -181,7 +182,7 @@ def conv2d_nhwc_dsp_schedule(cfg, outs):
 
         gemm, uniq_id = intrin_gemm_MxKxN(M, K, N, data_vec.dtype, output.dtype, stride_w)
         sched[output].tensorize(owi, gemm)
-        sched[output].pragma(n, "import_c", gemm_MxKxN_impl(M, K, N, uniq_id))
+        sched[output].pragma(n, "import_c", gemm_MxKxN_impl(M, K, N, uniq_id, target_has_mve()))
 
         # this is the scope to attach global config inside this kernel
         kernel_scope = n
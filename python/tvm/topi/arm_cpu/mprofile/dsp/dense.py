@@ -24,6 +24,7 @@ from .micro_kernel.gemm import (
     intrin_gemm_MxKxN,
     gemm_MxKxN_impl,
 )
+from .micro_kernel.common import target_has_mve
 from .... import tag
 
 
@@ -80,7 +81,7 @@ def dense_dsp_schedule(cfg, outs):
 
         gemm, uniq_id = intrin_gemm_MxKxN(M, K, N, data.dtype, output.dtype, stride_w=1)
         sched[output].tensorize(x_i, gemm)
-        sched[output].pragma(x_o, "import_c", gemm_MxKxN_impl(M, K, N, uniq_id))
+        sched[output].pragma(x_o, "import_c", gemm_MxKxN_impl(M, K, N, uniq_id, target_has_mve()))
 
     traverse_inline(sched, outs[-1].op, _callback)
     return sched
@@ -27,7 +27,7 @@ from .micro_kernel.multi_channel_convolve import (
     intrin_multi_channel_convolve,
     multi_channel_convolve_impl,
 )
-from .micro_kernel.common import num_simd_lanes_per_word
+from .micro_kernel.common import num_simd_lanes_per_word, target_has_mve
 
 
 def depthwise_conv2d_nhwc_dsp_compute(_cfg, data, kernel, strides, padding, dilation, out_dtype):
@@ -159,7 +159,14 @@ def depthwise_conv2d_nhwc_dsp_schedule(_cfg, outs):
             b_ax,
             "import_c",
             multi_channel_convolve_impl(
-                in_dtype, padded_h, padded_w, channels, kernel_h, kernel_w, suffix
+                in_dtype,
+                padded_h,
+                padded_w,
+                channels,
+                kernel_h,
+                kernel_w,
+                suffix,
+                use_mve=target_has_mve(),
             ),
         )
 
@@ -17,6 +17,8 @@
 # pylint: disable=invalid-name, no-value-for-parameter
 """Defines common C code for all microkernel operations."""
 
+import tvm
+
 
 common_includes = """
 
@@ -62,9 +64,22 @@ __extension__ \
 #endif
 """
 
+mve_includes = """
+
+#include <arm_mve.h>
+"""
+
 MICRO_WORD_LENGTH_BITS = 32
 
 
+def target_has_mve() -> bool:
+    """Returns whether the current target is a Cortex-M with the M-profile Vector Extension
+    (Helium), e.g. -mcpu=cortex-m55 without +nomve. Its micro kernels then use the MVE
+    intrinsics of arm_mve.h instead of the v7e-m DSP ones."""
+    target = tvm.target.Target.current(allow_none=True)
+    return target is not None and bool(target.features.has_mve)
+
+
 def num_simd_lanes_per_word(dtype: str) -> int:
     """Takes a dtype, and returns how many of that dtype fit into a single microcontroller word.
 
@@ -123,8 +123,11 @@ def intrin_gemm_MxKxN(M, K, N, in_dtype, out_dtype, stride_w=1):
     return intrin_decl, uniq_id
 
 
-def gemm_MxKxN_impl(M, K, N, uniq_id):
-    """Emit C code for gemm impl."""
+def gemm_MxKxN_impl(M, K, N, uniq_id, use_mve=False):
+    """Emit C code for gemm impl. With use_mve, the functions are implemented with the MVE
+    (Helium) intrinsics instead of the v7e-m DSP ones."""
+    if use_mve:
+        return _gemm_MxKxN_mve_impl(M, K, N, uniq_id)
     # TODO(weberlo, areusch): are there any SIMD tricks to zero out arrays quickly?
     # aa_pad_size = M * K
     bb_pad_size = N * K
@@ -532,3 +535,62 @@ __attribute__((always_inline)) static inline int32_t gemm_{M}x{K}x{N}_reset_{uni
 """
     )
     return cc_code
+
+
+def _gemm_MxKxN_mve_impl(M, K, N, uniq_id):
+    """Emit C code for the gemm impl with MVE (Helium) instructions. Each output is a dot product
+    of rows of aa and bb, VMLADAVA multiplying and accumulating 16 int8 or 8 int16 lanes at a
+    time. The last vector of a row is tail predicated, so K needs no padding nor remainder."""
+
+    def _gemm(prefix, elem_bits, suffix, assign):
+        c_type = f"int{elem_bits}_t"
+        vec_type = f"int{elem_bits}x{128 // elem_bits}_t"
+        load = f"vldr{'b' if elem_bits == 8 else 'h'}q_z_s{elem_bits}"
+        return f"""
+#ifdef __cplusplus
+extern "C"
+#endif
+__attribute__((always_inline)) static inline int32_t {prefix}_{M}x{K}x{N}_{suffix}_{uniq_id}(
+    {c_type} *aa, {c_type} *bb, int32_t *cc,
+    int A_stride, int B_stride, int C_stride) {{
+  for (int i = 0; i < {M}; i++) {{
+    for (int j = 0; j < {N}; j++) {{
+      {c_type} *a_ptr = &aa[i * A_stride];
+      {c_type} *b_ptr = &bb[j * B_stride];
+      int32_t sum = 0;
+      for (int l = 0; l < {K}; l += {128 // elem_bits}) {{
+        mve_pred16_t p = vctp{elem_bits}q({K} - l);
+        {vec_type} a = {load}(&a_ptr[l], p);
+        {vec_type} b = {load}(&b_ptr[l], p);
+        sum = vmladavaq_s{elem_bits}(sum, a, b);
+      }}
+      cc[i*C_stride + j] {assign} sum;
+    }}
+  }}
+  return 0;
+}}
+"""
+
+    cc_code = (
+        common.common_includes
+        + common.mve_includes
+        + _gemm("gemm", 8, "body", "=")
+        + _gemm("gemm", 8, "update", "+=")
+        + _gemm("gemm16", 16, "body", "=")
+        + _gemm("gemm16", 16, "update", "+=")
+        + f"""
+#ifdef __cplusplus
+extern "C"
+#endif
+__attribute__((always_inline)) static inline int32_t gemm_{M}x{K}x{N}_reset_{uniq_id}(int32_t *cc, int C_stride) {{
+  for (int i = 0; i < {M}; i++) {{
+    for (int j = 0; j < {N}; j++) {{
+      cc[i*C_stride + j] = 0;
+    }}
+  }}
+  return 0;
+}}
+
+"""
+    )
+    return cc_code
@@ -23,7 +23,7 @@ repeated four times giving four int32 outputs - one per channel."""
 import textwrap
 
 from tvm import te, tir
-from .common import num_simd_lanes_per_word, common_includes
+from .common import num_simd_lanes_per_word, common_includes, mve_includes
 
 
 def _get_func_name(in_dtype, tensor_w, channels, kernel_h, kernel_w, suffix):
@@ -92,10 +92,13 @@ def intrin_multi_channel_convolve(
     )
 
 
-def multi_channel_convolve_impl(in_dtype, *args) -> str:
+def multi_channel_convolve_impl(in_dtype, *args, use_mve=False) -> str:
     """Generates C code for a fast multi-channel convolution function for ARM Cortex-M. This is done
     by calling a sub-function depending on the input data type, as since v7e-m has no quad multiply
-    accumulate instruction, the int8 and int16 cases work differently."""
+    accumulate instruction, the int8 and int16 cases work differently. With use_mve, the int8 case
+    uses the MVE (Helium) instructions."""
+    if in_dtype == "int8" and use_mve:
+        return _quad_int8_channel_convolve_mve_impl(*args)
     if in_dtype == "int8":
         return _quad_int8_channel_convolve_impl(*args)
     if in_dtype == "int16":
@@ -175,6 +178,44 @@ def _quad_int8_channel_convolve_impl(_tensor_h, tensor_w, channels, kernel_h, ke
     )
 
 
+def _quad_int8_channel_convolve_mve_impl(
+    _tensor_h, tensor_w, channels, kernel_h, kernel_w, suffix
+):
+    return textwrap.dedent(
+        (
+            common_includes
+            + mve_includes
+            + f"""
+        /* The four channels are the four int32 lanes of a vector: VLDRB.S32 loads and widens
+           their int8 values, which are multiplied and accumulated lane by lane. */
+        #ifdef __cplusplus
+        extern "C"
+        #endif
+        int32_t {_get_func_name("int8", tensor_w, channels, kernel_h, kernel_w, suffix)}(
+            int32_t *out,
+            int8_t *tensor,
+            int8_t *kernel) {{
+
+          int32x4_t sum = vdupq_n_s32(0);
+
+          #pragma GCC unroll 3
+          for (int i = 0; i < {kernel_h}; i++) {{
+            #pragma GCC unroll 3
+            for (int j = 0; j < {kernel_w}; j++) {{
+              int32x4_t tensor_c3210 = vldrbq_s32(tensor + j * {channels} + i * {tensor_w * channels});
+              int32x4_t kernel_c3210 = vldrbq_s32(kernel + (i * {kernel_w} + j) * 4);
+              sum = vaddq_s32(sum, vmulq_s32(tensor_c3210, kernel_c3210));
+            }}
+          }}
+
+          vst1q_s32(out, sum);
+          return 0;
+        }}
+        """
+        )
+    )
+
+
 def _dual_int16_channel_convolve_impl(_tensor_h, tensor_w, channels, kernel_h, kernel_w, suffix):
     return textwrap.dedent(
         (
@@ -16,6 +16,7 @@
 # under the License.
 """Layer normalization operator."""
 from .. import cpp
+from ..tensor import full
 
 
 def layer_norm(data, gamma, beta, axis, epsilon=1e-5):
@@ -27,7 +28,7 @@ def layer_norm(data, gamma, beta, axis, epsilon=1e-5):
         N-D with shape (d_0, d_1, ..., d_{N-1})
 
     gamma: tvm.te.Tensor
-        K-D with shape (r_0, r_1, ..., r_{K-1}) where K == len(axis) and d_{axis_k} == r_k
+        Optional, K-D with shape (r_0, r_1, ..., r_{K-1}) where K == len(axis) and d_{axis_k} == r_k
 
     beta: tvm.te.Tensor
         Optional, K-D with shape (r_0, r_1, ..., r_{K-1}) where K == len(axis) and d_{axis_k} == r_k
@@ -43,4 +44,6 @@ def layer_norm(data, gamma, beta, axis, epsilon=1e-5):
     result : tvm.te.Tensor
         N-D with shape (d_0, d_1, ..., d_{N-1})
     """
+    if gamma is None:
+        gamma = full([data.shape[i] for i in axis], data.dtype, 1.0)
     return cpp.nn.layer_norm(data, gamma, beta, axis, epsilon)
@@ -16,8 +16,10 @@
 # under the License.
 # pylint: disable=invalid-name,too-many-locals,unused-variable
 """x86 nn operators"""
+import tvm
 from tvm import te
-from ..utils import traverse_inline
+from tvm.target.x86 import get_simd_32bit_lanes
+from ..utils import get_const_tuple, traverse_inline, unravel_index
 from .injective import schedule_injective_from_existing
 
 
@@ -134,3 +136,289 @@ def schedule_batch_norm(outs):
         s[div].compute_inline()
         s[substract].compute_inline()
     return s
+
+
+def _simd_lanes(dtype):
+    """The elements of dtype in a SIMD register of the target"""
+    return max(1, get_simd_32bit_lanes() * 32 // tvm.DataType(dtype).bits)
+
+
+def simd_row_supported(data, axis, min_lanes=0):
+    """Whether the SIMD row kernels (softmax_simd, layer_norm_simd) support data normalized
+    over axis: a float tensor of static shape, normalized over its last axis.
+
+    Parameters
+    ----------
+    data : tvm.te.Tensor
+        The input of the op.
+
+    axis : int
+        The normalized axis.
+
+    min_lanes : int
+        The number of SIMD registers the rows should hold at least.
+
+    Returns
+    -------
+    supported : bool
+    """
+    ndim = len(data.shape)
+    if axis < 0:
+        axis += ndim
+    if axis != ndim - 1 or data.dtype not in ("float16", "float32", "float64"):
+        return False
+    if not all(isinstance(dim, tvm.tir.IntImm) for dim in data.shape):
+        return False
+    return int(data.shape[-1]) >= min_lanes * _simd_lanes(data.dtype)
+
+
+class _RowBuilder(object):
+    """Build the loops over the rows of the last axis of a tensor, the rows being processed a
+    SIMD register (lanes elements) at a time followed by the scalar tail.
+    """
+
+    def __init__(self, ib, shape, dtype):
+        self.ib = ib
+        self.n = shape[-1]
+        self.lanes = _simd_lanes(dtype)
+        self.body = self.n // self.lanes * self.lanes
+        self.dtype = dtype
+        self._outer = shape[:-1]
+
+    def rows(self):
+        """The parallel loop over the rows, yielding the indices of the row"""
+        num_rows = 1
+        for dim in self._outer:
+            num_rows *= dim
+        return self.ib.for_range(0, num_rows, name="row", kind="parallel")
+
+    def row_index(self, row):
+        """The indices of the outer axes of a row"""
+        return unravel_index(row, self._outer) if self._outer else []
+
+    def elementwise(self, fcompute):
+        """Call fcompute(k) on the elements k of the row, vectorized over the lanes"""
+        with self.ib.for_range(0, self.n // self.lanes, name="k") as k:
+            with self.ib.for_range(0, self.lanes, name="l", kind="vectorize") as l:
+                fcompute(k * self.lanes + l)
+        with self.ib.for_range(self.body, self.n, name="k") as k:
+            fcompute(k)
+
+    def reduce(self, init, fupdate, fcombine):
+        """Reduce the row into a scalar with a vector of lanes accumulators, each lane
+        accumulating the elements lanes apart: fupdate(acc, k) is the update of the accumulator
+        acc by the element k, fcombine(a, b) the combination of the accumulators. The lanes are
+        combined at the end (the horizontal reduction), then updated by the tail of the row.
+
+        Returns
+        -------
+        red : BufferVar
+            The 1-element buffer holding the reduction.
+        """
+        ib, lanes = self.ib, self.lanes
+        acc = ib.allocate(self.dtype, (lanes,), name="acc", scope="local")
+        red = ib.allocate(self.dtype, (1,), name="red", scope="local")
+        with ib.for_range(0, lanes, name="l", kind="vectorize") as l:
+            acc[l] = init
+        with ib.for_range(0, self.n // lanes, name="k") as k:
+            with ib.for_range(0, lanes, name="l", kind="vectorize") as l:
+                acc[l] = fupdate(acc[l], k * lanes + l)
+        red[0] = acc[0]
+        with ib.for_range(1, lanes, name="l") as l:
+            red[0] = fcombine(red[0], acc[l])
+        with ib.for_range(self.body, self.n, name="k") as k:
+            red[0] = fupdate(red[0], k)
+        return red
+
+
+def _softmax_simd_ir(data, out):
+    """Softmax of the rows of data: a pass for the max, a pass computing the exponentials into
+    out while summing them, and a pass scaling out by the inverse of the sum.
+    """
+    shape = get_const_tuple(data.shape)
+    ib = tvm.tir.ir_builder.create()
+    builder = _RowBuilder(ib, shape, data.dtype)
+    x = ib.buffer_ptr(data)
+    y = ib.buffer_ptr(out)
+    with builder.rows() as row:
+        idx = builder.row_index(row)
+        red = builder.reduce(
+            tvm.te.min_value(data.dtype), lambda a, k: te.max(a, x[(*idx, k)]), te.max
+        )
+        max_elem = ib.allocate(data.dtype, (1,), name="max_elem", scope="local")
+        max_elem[0] = red[0]
+
+        def _exp_sum(a, k):
+            y[(*idx, k)] = te.exp(x[(*idx, k)] - max_elem[0])
+            return a + y[(*idx, k)]
+
+        red = builder.reduce(tvm.tir.const(0, data.dtype), _exp_sum, lambda a, b: a + b)
+        inv_sum = ib.allocate(data.dtype, (1,), name="inv_sum", scope="local")
+        inv_sum[0] = tvm.tir.const(1, data.dtype) / red[0]
+
+        def _scale(k):
+            y[(*idx, k)] = y[(*idx, k)] * inv_sum[0]
+
+        builder.elementwise(_scale)
+    return ib.get()
+
+
+def softmax_simd(x, axis=-1):
+    """Softmax over the last axis for CPUs, computed row by row with SIMD accumulators and the
+    exponentials summed in the pass computing them.
+
+    Parameters
+    ----------
+    x : tvm.te.Tensor
+        A float tensor of static shape, see simd_row_supported.
+
+    axis : int
+        The axis of the softmax, the last one.
+
+    Returns
+    -------
+    output : tvm.te.Tensor
+        output shape is the same as input
+    """
+    assert simd_row_supported(x, axis), "softmax_simd only supports the last axis of static shapes"
+    return te.extern(
+        [x.shape],
+        [x],
+        lambda ins, outs: _softmax_simd_ir(ins[0], outs[0]),
+        dtype=x.dtype,
+        name="T_softmax_simd",
+        tag="softmax_simd",
+    )
+
+
+def _layer_norm_simd_ir(data, gamma, beta, out, epsilon):
+    """Layer norm of the rows of data: a Welford pass for the mean and the variance, the lanes
+    being merged with the pairwise formula of Chan et al., then a pass normalizing the row.
+    """
+    shape = get_const_tuple(data.shape)
+    dtype = data.dtype
+    ib = tvm.tir.ir_builder.create()
+    builder = _RowBuilder(ib, shape, dtype)
+    lanes, n = builder.lanes, builder.n
+    x = ib.buffer_ptr(data)
+    g = ib.buffer_ptr(gamma) if gamma is not None else None
+    b = ib.buffer_ptr(beta) if beta is not None else None
+    y = ib.buffer_ptr(out)
+
+    def const(value):
+        return tvm.tir.const(value, dtype)
+
+    with builder.rows() as row:
+        idx = builder.row_index(row)
+        mean = ib.allocate(dtype, (lanes,), name="mean", scope="local")
+        m2 = ib.allocate(dtype, (lanes,), name="m2", scope="local")
+        with ib.for_range(0, lanes, name="l", kind="vectorize") as l:
+            mean[l] = const(0)
+            m2[l] = const(0)
+        # every lane has seen k + 1 elements after the iteration k
+        with ib.for_range(0, n // lanes, name="k") as k:
+            inv_count = const(1) / (k + 1).astype(dtype)
+            with ib.for_range(0, lanes, name="l", kind="vectorize") as l:
+                value = x[(*idx, k * lanes + l)]
+                delta = value - mean[l]
+                mean[l] = mean[l] + delta * inv_count
+                m2[l] = m2[l] + delta * (value - mean[l])
+        # merge the lanes of n // lanes elements each
+        row_mean = ib.allocate(dtype, (1,), name="row_mean", scope="local")
+        row_m2 = ib.allocate(dtype, (1,), name="row_m2", scope="local")
+        row_mean[0] = const(0)
+        with ib.for_range(0, lanes, name="l") as l:
+            row_mean[0] = row_mean[0] + mean[l]
+        row_mean[0] = row_mean[0] / const(lanes)
+        row_m2[0] = const(0)
+        with ib.for_range(0, lanes, name="l") as l:
+            delta = mean[l] - row_mean[0]
+            row_m2[0] = row_m2[0] + m2[l] + const(n // lanes) * delta * delta
+        # the tail updates the row by Welford
+        with ib.for_range(builder.body, n, name="k") as k:
+            value = x[(*idx, k)]
+            delta = value - row_mean[0]
+            row_mean[0] = row_mean[0] + delta / (k + 1).astype(dtype)
+            row_m2[0] = row_m2[0] + delta * (value - row_mean[0])
+        rstd = ib.allocate(dtype, (1,), name="rstd", scope="local")
+        rstd[0] = tvm.te.rsqrt(row_m2[0] / const(n) + const(epsilon))
+
+        def _normalize(k):
+            value = (x[(*idx, k)] - row_mean[0]) * rstd[0]
+            if g is not None:
+                value = value * g[k]
+            if b is not None:
+                value = value + b[k]
+            y[(*idx, k)] = value
+
+        builder.elementwise(_normalize)
+    return ib.get()
+
+
+def layer_norm_simd(data, gamma, beta, axis, epsilon=1e-5):
+    """Layer normalization over the last axis for CPUs, the mean and the variance of each row
+    computed in a single Welford pass with SIMD accumulators.
+
+    Parameters
+    ----------
+    data : tvm.te.Tensor
+        A float tensor of static shape holding at least a SIMD register per row, see
+        simd_row_supported.
+
+    gamma : Optional[tvm.te.Tensor]
+        1-D with shape (r_0), the scale, None when not scaled.
+
+    beta : Optional[tvm.te.Tensor]
+        1-D with shape (r_0), the offset, None when not centered.
+
+    axis : list of int
+        The axis to normalize over, the last one.
+
+    epsilon : float
+        The epsilon value to avoid division by zero.
+
+    Returns
+    -------
+    result : tvm.te.Tensor
+        N-D with shape (d_0, d_1, ..., d_{N-1})
+    """
+    assert len(axis) == 1 and simd_row_supported(data, axis[0], min_lanes=1), (
+        "layer_norm_simd only supports the last axis of static shapes"
+    )
+    inputs = [t for t in (data, gamma, beta) if t is not None]
+
+    def _ir(ins, outs):
+        ins = list(ins)
+        data_buf = ins.pop(0)
+        gamma_buf = ins.pop(0) if gamma is not None else None
+        beta_buf = ins.pop(0) if beta is not None else None
+        return _layer_norm_simd_ir(data_buf, gamma_buf, beta_buf, outs[0], epsilon)
+
+    return te.extern(
+        [data.shape], inputs, _ir, dtype=data.dtype, name="T_layer_norm_simd", tag="layer_norm_simd"
+    )
+
+
+def schedule_simd_row(outs):
+    """Schedule for the SIMD row kernels (softmax_simd, layer_norm_simd) and the elementwise ops
+    fused after them
+
+    Parameters
+    ----------
+    outs: Array of Tensor
+          The computation graph description of the kernel
+          in the format of an array of tensors.
+
+    Returns
+    -------
+    sch: Schedule
+        The computation schedule for the op.
+    """
+    outs = [outs] if isinstance(outs, te.tensor.Tensor) else outs
+    s = te.create_schedule([x.op for x in outs])
+    # inline the elementwise ops between the kernel and the outputs
+    traverse_inline(s, outs[0].op, lambda op: None)
+    for out in outs:
+        if not isinstance(out.op, te.ExternOp):
+            schedule_injective_from_existing(s, out)
+    return s
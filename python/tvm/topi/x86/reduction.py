@@ -18,18 +18,61 @@
 """x86 declaration and schedules."""
 import tvm
 from tvm import te
+from tvm.target.x86 import get_simd_32bit_lanes
 from .injective import schedule_injective_from_existing
 from .. import tag
 from ..utils import get_const_tuple
 
 
+def _simd_rfactor(sch, out):
+    """Reduce the innermost axis of the inputs with a vector of accumulators, each lane
+    accumulating the elements a SIMD register apart, and reduce the lanes at the end.
+
+    Returns the rfactor-ed tensor of the accumulators, None when the reduction is not a single
+    reduction over a constant innermost axis of a multiple of the SIMD register.
+    """
+    bits = tvm.DataType(out.dtype).bits
+    if out.op.num_outputs != 1 or len(out.op.reduce_axis) != 1 or bits < 8:
+        return None
+    (k,) = out.op.reduce_axis
+    lanes = max(1, get_simd_32bit_lanes() * 32 // bits)
+    extent = k.dom.extent
+    if not isinstance(extent, tvm.tir.IntImm) or extent.value % lanes or extent.value < 2 * lanes:
+        return None
+
+    def _uses_k(expr):
+        found = []
+        tvm.tir.stmt_functor.post_order_visit(
+            expr, lambda node: found.append(node) if node.same_as(k.var) else None
+        )
+        return bool(found)
+
+    # the lanes are contiguous only when k indexes the innermost axis of the loads
+    contiguous = []
+
+    def _check_load(node):
+        if isinstance(node, tvm.tir.ProducerLoad) and _uses_k(node):
+            indices = list(node.indices)
+            contiguous.append(
+                indices[-1].same_as(k.var) and not any(_uses_k(i) for i in indices[:-1])
+            )
+
+    tvm.tir.stmt_functor.post_order_visit(out.op.body[0], _check_load)
+    if not contiguous or not all(contiguous):
+        return None
+    _, ki = sch[out].split(k, factor=lanes)
+    return sch.rfactor(out, ki)
+
+
 def _schedule_reduce(sch, op, is_idx_reduce=False):
+    out_rf = None
     if is_idx_reduce:
         real_out = op.output(0)
         fused = sch[real_out].fuse(*sch[real_out].op.axis)
         out = op.input_tensors[0]
     else:
         out = op.output(0)
+        out_rf = _simd_rfactor(sch, out)
 
     const_shape = True
     out_shape = get_const_tuple(out.shape)
@@ -58,6 +101,14 @@ def _schedule_reduce(sch, op, is_idx_reduce=False):
             fused = sch[out].fuse(*sch[out].op.axis)
             sch[out].parallel(fused)
 
+    if out_rf is not None:
+        # the accumulators of the outputs of the innermost spatial loop
+        inner = sch[out].leaf_iter_vars[len(sch[out].leaf_iter_vars) - 2]
+        sch[out_rf].compute_at(sch[out], inner)
+        lane = sch[out_rf].op.axis[0]
+        sch[out_rf].reorder(*sch[out_rf].op.axis[1:], sch[out_rf].op.reduce_axis[0], lane)
+        sch[out_rf].vectorize(lane)
+
 
 def schedule_reduce(outs):
     """X86 schedule for reduction op.
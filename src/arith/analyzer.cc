@@ -21,24 +21,272 @@
  * \file tvm/arith/analyzer.cc
  */
 #include <tvm/arith/analyzer.h>
+#include <tvm/node/structural_equal.h>
+#include <tvm/node/structural_hash.h>
 #include <tvm/runtime/registry.h>
 #include <tvm/tir/expr.h>
 #include <tvm/tir/op.h>
 
+#include <unordered_map>
+
+#include "../support/utils.h"
 #include "const_fold.h"
 #include "product_normal_form.h"
 
 namespace tvm {
 namespace arith {
 
+/*!
+ * \brief The memoized results of Analyzer::Simplify.
+ *
+ * The constraints in effect are tracked even when the cache is disabled, so that it can be enabled
+ * inside a constraint scope. An entry records the stack of constraints it was simplified under and
+ * is only reused under the same stack.
+ */
+class Analyzer::SimplifyCache {
+ public:
+  /*! \brief Whether Simplify looks up and records its results. */
+  bool enabled{false};
+
+  bool Lookup(const PrimExpr& expr, int steps, PrimExpr* result) {
+    size_t key = Key(expr, steps);
+    auto range = table_.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+      const Entry& entry = it->second;
+      if (entry.steps == steps && SameContext(entry.constraints) &&
+          StructuralEqual()(entry.expr, expr)) {
+        *result = entry.result;
+        ++hits_;
+        return true;
+      }
+    }
+    ++misses_;
+    return false;
+  }
+
+  void Insert(const PrimExpr& expr, int steps, const PrimExpr& result) {
+    if (table_.size() >= kMaxEntries) {
+      table_.clear();
+    }
+    table_.emplace(Key(expr, steps), Entry{expr, steps, constraints_, result});
+  }
+
+  /*! \brief Drop the results, called when a binding changes what they simplify to. */
+  void Clear() { table_.clear(); }
+
+  /*!
+   * \brief Record the binding of var, a PrimExpr or a Range.
+   * \return Whether the binding is new or changed, the results are then dropped by the caller.
+   */
+  bool Rebind(const Var& var, const ObjectRef& value) {
+    auto it = bindings_.find(var);
+    if (it != bindings_.end() && StructuralEqual()(it->second, value)) return false;
+    bindings_[var] = value;
+    return true;
+  }
+
+  /*! \brief Forget the binding of var, whose bounds are changed other than by a binding. */
+  void Unbind(const Var& var) { bindings_.erase(var); }
+
+  void EnterConstraint(const PrimExpr& constraint) {
+    constraints_.push_back(constraint);
+    size_t hash = support::HashCombine(CurrentContextHash(), StructuralHash()(constraint));
+    context_hash_.push_back(hash);
+  }
+
+  void ExitConstraint() {
+    ICHECK(!constraints_.empty());
+    constraints_.pop_back();
+    context_hash_.pop_back();
+  }
+
+  Map<String, Integer> GetStats() const {
+    auto count = [](int64_t value) { return Integer(IntImm(DataType::Int(64), value)); };
+    return {{"hit", count(hits_)},
+            {"miss", count(misses_)},
+            {"size", count(static_cast<int64_t>(table_.size()))}};
+  }
+
+  /*! \brief The stack of constraints in effect. */
+  const Array<PrimExpr>& constraints() const { return constraints_; }
+
+  /*! \brief The hash of the stack of constraints in effect. */
+  size_t CurrentContextHash() const { return context_hash_.empty() ? 0 : context_hash_.back(); }
+
+ private:
+  struct Entry {
+    PrimExpr expr;
+    int steps;
+    Array<PrimExpr> constraints;
+    PrimExpr result;
+  };
+
+  /*! \brief Bound of the number of entries, the table is reset when it is reached. */
+  static constexpr size_t kMaxEntries = 1 << 16;
+
+  size_t Key(const PrimExpr& expr, int steps) const {
+    size_t key = support::HashCombine(StructuralHash()(expr), static_cast<size_t>(steps));
+    return support::HashCombine(key, CurrentContextHash());
+  }
+
+  bool SameContext(const Array<PrimExpr>& constraints) const {
+    return constraints.same_as(constraints_) || StructuralEqual()(constraints, constraints_);
+  }
+
+  std::unordered_multimap<size_t, Entry> table_;
+  std::unordered_map<Var, ObjectRef, ObjectPtrHash, ObjectPtrEqual> bindings_;
+  Array<PrimExpr> constraints_;
+  std::vector<size_t> context_hash_;
+  int64_t hits_{0};
+  int64_t misses_{0};
+};
+
+/*!
+ * \brief The memoized results of DetectIterMap and NormalizeToIterSum.
+ *
+ * An entry records the stack of constraints it was detected under, empty for the entries of the
+ * cache shared by an IterMapCacheScope, and is only reused under the same stack.
+ */
+class Analyzer::IterMapCache {
+ public:
+  /*! \brief Whether the analyzer looks up and records its iter maps. */
+  bool enabled{false};
+
+  bool Lookup(const ObjectRef& key, const Array<PrimExpr>& constraints, size_t context_hash,
+              ObjectRef* result) const {
+    auto range = table_.equal_range(support::HashCombine(StructuralHash()(key), context_hash));
+    for (auto it = range.first; it != range.second; ++it) {
+      const Entry& entry = it->second;
+      if ((entry.constraints.same_as(constraints) ||
+           StructuralEqual()(entry.constraints, constraints)) &&
+          StructuralEqual()(entry.key, key)) {
+        *result = entry.result;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void Insert(const ObjectRef& key, const Array<PrimExpr>& constraints, size_t context_hash,
+              const ObjectRef& result) {
+    if (table_.size() >= kMaxEntries) {
+      table_.clear();
+    }
+    size_t hash = support::HashCombine(StructuralHash()(key), context_hash);
+    table_.emplace(hash, Entry{key, constraints, result});
+  }
+
+  /*! \brief Drop the results, called when a binding changes what they detect. */
+  void Clear() { table_.clear(); }
+
+  Map<String, Integer> GetStats() const {
+    auto count = [](int64_t value) { return Integer(IntImm(DataType::Int(64), value)); };
+    return {{"hit", count(hits)},
+            {"miss", count(misses)},
+            {"size", count(static_cast<int64_t>(table_.size()))}};
+  }
+
+  int64_t hits{0};
+  int64_t misses{0};
+
+ private:
+  struct Entry {
+    ObjectRef key;
+    Array<PrimExpr> constraints;
+    ObjectRef result;
+  };
+
+  /*! \brief Bound of the number of entries, the table is reset when it is reached. */
+  static constexpr size_t kMaxEntries = 1 << 16;
+
+  std::unordered_multimap<size_t, Entry> table_;
+};
+
 Analyzer::Analyzer()
     : const_int_bound(this),
       modular_set(this),
       rewrite_simplify(this),
       canonical_simplify(this),
-      int_set(this) {}
+      int_set(this),
+      simplify_cache_(std::make_unique<SimplifyCache>()),
+      iter_map_cache_(std::make_unique<IterMapCache>()) {}
+
+Analyzer::~Analyzer() {}
+
+void Analyzer::EnableSimplifyCache(bool enable) {
+  simplify_cache_->enabled = enable;
+  if (!enable) {
+    simplify_cache_->Clear();
+  }
+}
+
+Map<String, Integer> Analyzer::GetSimplifyCacheStats() const {
+  return simplify_cache_->GetStats();
+}
+
+std::shared_ptr<Analyzer::IterMapCache>& Analyzer::SharedIterMapCache() {
+  static thread_local std::shared_ptr<IterMapCache> shared;
+  return shared;
+}
+
+void Analyzer::EnableIterMapCache(bool enable) {
+  iter_map_cache_->enabled = enable;
+  if (!enable) {
+    iter_map_cache_->Clear();
+  }
+}
+
+Map<String, Integer> Analyzer::GetIterMapCacheStats() const {
+  return iter_map_cache_->GetStats();
+}
+
+bool Analyzer::UsesIterMapCache() const {
+  return iter_map_cache_->enabled || SharedIterMapCache() != nullptr;
+}
+
+bool Analyzer::LookupIterMap(const ObjectRef& key, bool context_free, ObjectRef* result) {
+  const Array<PrimExpr>& constraints = simplify_cache_->constraints();
+  size_t context_hash = simplify_cache_->CurrentContextHash();
+  const auto& shared = SharedIterMapCache();
+  bool found = (iter_map_cache_->enabled &&
+                iter_map_cache_->Lookup(key, constraints, context_hash, result)) ||
+               (context_free && constraints.empty() && shared != nullptr &&
+                shared->Lookup(key, constraints, context_hash, result));
+  ++(found ? iter_map_cache_->hits : iter_map_cache_->misses);
+  return found;
+}
+
+void Analyzer::InsertIterMap(const ObjectRef& key, bool context_free, const ObjectRef& result) {
+  const Array<PrimExpr>& constraints = simplify_cache_->constraints();
+  size_t context_hash = simplify_cache_->CurrentContextHash();
+  if (iter_map_cache_->enabled) {
+    iter_map_cache_->Insert(key, constraints, context_hash, result);
+  }
+  const auto& shared = SharedIterMapCache();
+  if (context_free && constraints.empty() && shared != nullptr) {
+    shared->Insert(key, constraints, context_hash, result);
+  }
+}
+
+void IterMapCacheScope::EnterWithScope() {
+  auto& shared = Analyzer::SharedIterMapCache();
+  if (shared == nullptr) {
+    shared = std::make_shared<Analyzer::IterMapCache>();
+    owner_ = true;
+  }
+}
+
+void IterMapCacheScope::ExitWithScope() {
+  if (owner_) {
+    Analyzer::SharedIterMapCache().reset();
+  }
+}
 
 void Analyzer::Bind(const Var& var, const PrimExpr& expr, bool allow_override) {
+  if (simplify_cache_->Rebind(var, expr)) {
+    simplify_cache_->Clear();
+    iter_map_cache_->Clear();
+  }
   PrimExpr new_expr = expr;
   new_expr = this->canonical_simplify(new_expr);
   new_expr = this->rewrite_simplify(new_expr);
@@ -56,6 +304,10 @@ void Analyzer::Bind(const Var& var, const Range& range, bool allow_override) {
   if (tir::is_one(range->extent)) {
     this->Bind(var, range->min, allow_override);
   } else {
+    if (simplify_cache_->Rebind(var, range)) {
+      simplify_cache_->Clear();
+      iter_map_cache_->Clear();
+    }
     this->const_int_bound.Bind(var, range, allow_override);
     this->int_set.Bind(var, range, allow_override);
     this->transitive_comparisons.Bind(var, range, allow_override);
@@ -111,6 +363,9 @@ void Analyzer::MarkGlobalNonNegValue(const PrimExpr& value) {
     // during bound proof which is not our intention
     this->const_int_bound.Update(var, ConstIntBound(-offset, ConstIntBound::kPosInf),
                                  allow_override);
+    simplify_cache_->Unbind(var);
+    simplify_cache_->Clear();
+    iter_map_cache_->Clear();
   }
 }
 
@@ -128,6 +383,9 @@ void ConstraintContext::EnterWithScope() {
   recovery_functions_.push_back(analyzer_->rewrite_simplify.EnterConstraint(constraint_));
   recovery_functions_.push_back(analyzer_->int_set.EnterConstraint(constraint_));
   recovery_functions_.push_back(analyzer_->transitive_comparisons.EnterConstraint(constraint_));
+  analyzer_->simplify_cache_->EnterConstraint(constraint_);
+  Analyzer* analyzer = analyzer_;
+  recovery_functions_.push_back([analyzer]() { analyzer->simplify_cache_->ExitConstraint(); });
 }
 
 void ConstraintContext::ExitWithScope() {
@@ -231,15 +489,19 @@ bool Analyzer::CanProve(const PrimExpr& expr, ProofStrength strength) {
 }
 
 PrimExpr Analyzer::Simplify(const PrimExpr& expr, int steps) {
-  PrimExpr res = expr;
+  PrimExpr res;
+  bool use_cache = simplify_cache_->enabled;
+  if (use_cache && simplify_cache_->Lookup(expr, steps, &res)) {
+    return res;
+  }
 
   // Always starts with a canonical simplification, as some structural property
   // of an expression might be destroyed by rewrite simplification.
-  res = this->canonical_simplify(res);
+  res = this->canonical_simplify(expr);
 
   for (int i = 0; i < steps; ++i) {
     if (tir::is_const_int(res)) {
-      return res;
+      break;
     }
     if (i % 2 == 0) {
       res = this->rewrite_simplify(res);
@@ -248,6 +510,9 @@ PrimExpr Analyzer::Simplify(const PrimExpr& expr, int steps) {
     }
   }
 
+  if (use_cache) {
+    simplify_cache_->Insert(expr, steps, res);
+  }
   return res;
 }
 
@@ -314,6 +579,18 @@ TVM_REGISTER_GLOBAL("arith.CreateAnalyzer").set_body([](TVMArgs args, TVMRetValu
         auto fexit = [ctx](TVMArgs, TVMRetValue*) mutable { ctx.reset(); };
         *ret = PackedFunc(fexit);
       });
+    } else if (name == "enable_simplify_cache") {
+      return PackedFunc(
+          [self](TVMArgs args, TVMRetValue* ret) { self->EnableSimplifyCache(args[0]); });
+    } else if (name == "get_simplify_cache_stats") {
+      return PackedFunc(
+          [self](TVMArgs args, TVMRetValue* ret) { *ret = self->GetSimplifyCacheStats(); });
+    } else if (name == "enable_iter_map_cache") {
+      return PackedFunc(
+          [self](TVMArgs args, TVMRetValue* ret) { self->EnableIterMapCache(args[0]); });
+    } else if (name == "get_iter_map_cache_stats") {
+      return PackedFunc(
+          [self](TVMArgs args, TVMRetValue* ret) { *ret = self->GetIterMapCacheStats(); });
     } else if (name == "can_prove_equal") {
       return PackedFunc(
           [self](TVMArgs args, TVMRetValue* ret) { *ret = self->CanProveEqual(args[0], args[1]); });
@@ -323,5 +600,11 @@ TVM_REGISTER_GLOBAL("arith.CreateAnalyzer").set_body([](TVMArgs args, TVMRetValu
   *ret = TypedPackedFunc<PackedFunc(std::string)>(f);
 });
 
+TVM_REGISTER_GLOBAL("arith.EnterIterMapCacheScope").set_body_typed([]() {
+  // can't use make_shared due to noexcept(false) decl in destructor
+  auto scope = std::shared_ptr<With<IterMapCacheScope>>(new With<IterMapCacheScope>());
+  return PackedFunc([scope](TVMArgs, TVMRetValue*) mutable { scope.reset(); });
+});
+
 }  // namespace arith
 }  // namespace tvm
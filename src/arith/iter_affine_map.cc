@@ -1428,9 +1428,81 @@ bool IterRangeSanityCheck(const Map<Var, Range>& iter_ranges) {
   return true;
 }
 
-IterMapResult DetectIterMap(const Array<PrimExpr>& indices, const Map<Var, Range>& input_iters,
-                            const PrimExpr& predicate, IterMapLevel check_level,
-                            arith::Analyzer* analyzer, bool simplify_trivial_iterators) {
+namespace {
+/*!
+ * \brief Copies iter map expressions with new IterMarks, as a new detection creates them, so that
+ *  the callers telling the marks apart by identity see the same marks with or without the cache.
+ */
+class IterMarkCloner {
+ public:
+  IterSumExpr Clone(const IterSumExpr& sum) {
+    Array<IterSplitExpr> args =
+        sum->args.Map([this](const IterSplitExpr& split) { return Clone(split); });
+    return IterSumExpr(args, sum->base);
+  }
+
+  IterSplitExpr Clone(const IterSplitExpr& split) {
+    return IterSplitExpr(Clone(split->source), split->lower_factor, split->extent, split->scale);
+  }
+
+  IterMark Clone(const IterMark& mark) {
+    auto it = marks_.find(mark);
+    if (it != marks_.end()) return it->second;
+    PrimExpr source = mark->source;
+    if (const auto* op = source.as<IterSumExprNode>()) {
+      source = Clone(GetRef<IterSumExpr>(op));
+    }
+    IterMark copy(source, mark->extent);
+    marks_.emplace(mark, copy);
+    return copy;
+  }
+
+ private:
+  std::unordered_map<IterMark, IterMark, ObjectPtrHash, ObjectPtrEqual> marks_;
+};
+
+IterMapResult CloneIterMapResult(const IterMapResultNode* result) {
+  IterMarkCloner cloner;
+  IterMapResult copy;
+  copy->indices = result->indices.Map([&](const IterSumExpr& sum) { return cloner.Clone(sum); });
+  copy->errors = result->errors;
+  copy->padding_predicate = result->padding_predicate;
+  return copy;
+}
+
+/*! \brief The arguments of an iter map detection, the key of the analyzer's cache. */
+Array<ObjectRef> IterMapCacheKey(const char* kind, const Array<PrimExpr>& exprs,
+                                 const Map<Var, Range>& input_iters, const PrimExpr& predicate,
+                                 IterMapLevel check_level, bool simplify_trivial_iterators) {
+  // the iterators in their order, the marks of the result being created in this order
+  Array<ObjectRef> iters;
+  for (const auto& kv : input_iters) {
+    iters.push_back(kv.first);
+    iters.push_back(kv.second);
+  }
+  return {String(kind),
+          exprs,
+          iters,
+          predicate,
+          Integer(static_cast<int>(check_level)),
+          Bool(simplify_trivial_iterators)};
+}
+
+/*! \brief Whether the iter map of the expressions only depends on the iterators. */
+bool IsIterMapContextFree(const Array<PrimExpr>& exprs, const Map<Var, Range>& input_iters) {
+  for (const auto& kv : input_iters) {
+    if (!is_const_int(kv.second->min) || !is_const_int(kv.second->extent)) return false;
+  }
+  auto is_other_var = [&](const VarNode* var) { return !input_iters.count(GetRef<Var>(var)); };
+  for (const PrimExpr& expr : exprs) {
+    if (UsesVar(expr, is_other_var)) return false;
+  }
+  return true;
+}
+
+IterMapResult DetectIterMapImpl(const Array<PrimExpr>& indices, const Map<Var, Range>& input_iters,
+                                const PrimExpr& predicate, IterMapLevel check_level,
+                                arith::Analyzer* analyzer, bool simplify_trivial_iterators) {
   IterMapResult result;
 
   // Overall detection algorithm is divided into two steps:
@@ -1513,17 +1585,8 @@ IterMapResult DetectIterMap(const Array<PrimExpr>& indices, const Map<Var, Range
   return result;
 }
 
-TVM_REGISTER_GLOBAL("arith.DetectIterMap")
-    .set_body_typed([](const Array<PrimExpr>& indices, const Map<Var, Range>& input_iters,
-                       const PrimExpr& input_pred, int check_level,
-                       bool simplify_trivial_iterators) {
-      arith::Analyzer ana;
-      return DetectIterMap(indices, input_iters, input_pred, IterMapLevel(check_level), &ana,
-                           simplify_trivial_iterators);
-    });
-
-IterSumExpr NormalizeToIterSum(PrimExpr index, const Map<Var, Range>& input_iters,
-                               arith::Analyzer* analyzer) {
+IterSumExpr NormalizeToIterSumImpl(PrimExpr index, const Map<Var, Range>& input_iters,
+                                   arith::Analyzer* analyzer) {
   IterMapResult result;
   ICHECK(IterRangeSanityCheck(input_iters))
       << "Invalid iterators.  Iterators may not be expressions of each other.";
@@ -1537,6 +1600,57 @@ IterSumExpr NormalizeToIterSum(PrimExpr index, const Map<Var, Range>& input_iter
 
   return rewriter.RewriteToNormalizedIterSum(index);
 }
+}  // namespace
+
+IterMapResult DetectIterMap(const Array<PrimExpr>& indices, const Map<Var, Range>& input_iters,
+                            const PrimExpr& predicate, IterMapLevel check_level,
+                            arith::Analyzer* analyzer, bool simplify_trivial_iterators) {
+  if (!analyzer->UsesIterMapCache()) {
+    return DetectIterMapImpl(indices, input_iters, predicate, check_level, analyzer,
+                             simplify_trivial_iterators);
+  }
+  Array<ObjectRef> key = IterMapCacheKey("DetectIterMap", indices, input_iters, predicate,
+                                         check_level, simplify_trivial_iterators);
+  Array<PrimExpr> exprs = indices;
+  exprs.push_back(predicate);
+  bool context_free = IsIterMapContextFree(exprs, input_iters);
+  ObjectRef cached;
+  if (analyzer->LookupIterMap(key, context_free, &cached)) {
+    return CloneIterMapResult(cached.as<IterMapResultNode>());
+  }
+  IterMapResult result = DetectIterMapImpl(indices, input_iters, predicate, check_level, analyzer,
+                                           simplify_trivial_iterators);
+  // the result is mutable, the cache keeps a copy
+  analyzer->InsertIterMap(key, context_free, CloneIterMapResult(result.operator->()));
+  return result;
+}
+
+TVM_REGISTER_GLOBAL("arith.DetectIterMap")
+    .set_body_typed([](const Array<PrimExpr>& indices, const Map<Var, Range>& input_iters,
+                       const PrimExpr& input_pred, int check_level,
+                       bool simplify_trivial_iterators) {
+      arith::Analyzer ana;
+      return DetectIterMap(indices, input_iters, input_pred, IterMapLevel(check_level), &ana,
+                           simplify_trivial_iterators);
+    });
+
+IterSumExpr NormalizeToIterSum(PrimExpr index, const Map<Var, Range>& input_iters,
+                               arith::Analyzer* analyzer) {
+  if (!analyzer->UsesIterMapCache()) {
+    return NormalizeToIterSumImpl(index, input_iters, analyzer);
+  }
+  PrimExpr predicate = Bool(true);
+  Array<ObjectRef> key = IterMapCacheKey("NormalizeToIterSum", {index}, input_iters, predicate,
+                                         IterMapLevel::NoCheck, true);
+  bool context_free = IsIterMapContextFree({index}, input_iters);
+  ObjectRef cached;
+  if (analyzer->LookupIterMap(key, context_free, &cached)) {
+    return IterMarkCloner().Clone(Downcast<IterSumExpr>(cached));
+  }
+  IterSumExpr result = NormalizeToIterSumImpl(index, input_iters, analyzer);
+  analyzer->InsertIterMap(key, context_free, result);
+  return result;
+}
 
 TVM_REGISTER_GLOBAL("arith.NormalizeToIterSum")
     .set_body_typed([](PrimExpr index, const Map<Var, Range>& input_iters) {
@@ -522,7 +522,11 @@ Array<State> SketchPolicyNode::EvolutionarySearch(const Array<State>& init_popul
   float max_score = -1e-10f;
   pop_scores.reserve(population);
   pop_selection_probs.reserve(population);
-  std::uniform_real_distribution<> dis(0.0, 1.0);
+  std::vector<std::mt19937> rand_gens;
+  rand_gens.reserve(population);
+  for (size_t i = 0; i < population; ++i) {
+    rand_gens.push_back(std::mt19937(rand_gen()));
+  }
 
   // mutation rules
   int mutation_success_ct, mutation_fail_ct;
@@ -534,10 +538,25 @@ Array<State> SketchPolicyNode::EvolutionarySearch(const Array<State>& init_popul
   }
   ComputePrefixSumProb(rule_weights, &rule_selection_probs);
 
+  // Whether the states of the populations already have their bounds inferred, empty for all false.
+  // The states copied to the next generation without mutation keep their bounds.
+  std::vector<bool> now_has_bound, next_has_bound;
+
   // Genetic Algorithm
   for (int k = 0; k < num_iters + 1; ++k) {
     // Maintain the heap
-    *pnow = search_task->compute_dag.InferBound(*pnow);
+    Array<State> changed_states;
+    std::vector<size_t> changed_ids;
+    for (size_t i = 0; i < pnow->size(); ++i) {
+      if (now_has_bound.empty() || !now_has_bound[i]) {
+        changed_states.push_back((*pnow)[i]);
+        changed_ids.push_back(i);
+      }
+    }
+    changed_states = search_task->compute_dag.InferBound(changed_states);
+    for (size_t i = 0; i < changed_ids.size(); ++i) {
+      pnow->Set(changed_ids[i], changed_states[i]);
+    }
     PruneInvalidState(search_task, pnow);
     program_cost_model->Predict(search_task, *pnow, &pop_scores);
 
@@ -587,25 +606,39 @@ Array<State> SketchPolicyNode::EvolutionarySearch(const Array<State>& init_popul
 
     // TODO(merrymercy, comaniac): add crossover.
 
-    // Do mutation
+    // Do mutation, in parallel and with one random generator per slot, so that the result does
+    // not depend on the scheduling of the threads
     while (pnext->size() < population) {
-      State tmp_s = (*pnow)[RandomChoose(pop_selection_probs, &rand_gen)];
-
-      if (dis(rand_gen) < mutation_prob) {
-        const auto& rule = mutation_rules[RandomChoose(rule_selection_probs, &rand_gen)];
-        if (rule->Apply(this, &tmp_s, &rand_gen) == PopulationGenerationRule::ResultKind::kValid) {
-          pnext->push_back(std::move(tmp_s));
-          mutation_success_ct++;
-        } else {
+      int num_slots = static_cast<int>(population - pnext->size());
+      std::vector<State> mutated(num_slots);
+      std::vector<int8_t> mutation_results(num_slots, -1);
+      support::parallel_for(0, num_slots, [&](int index) {
+        std::mt19937* gen = &rand_gens[index];
+        State tmp_s = (*pnow)[RandomChoose(pop_selection_probs, gen)];
+        if (std::uniform_real_distribution<>(0.0, 1.0)(*gen) < mutation_prob) {
+          const auto& rule = mutation_rules[RandomChoose(rule_selection_probs, gen)];
+          bool valid =
+              rule->Apply(this, &tmp_s, gen) == PopulationGenerationRule::ResultKind::kValid;
+          mutation_results[index] = valid;
+          if (!valid) return;
+        }
+        mutated[index] = std::move(tmp_s);
+      });
+      for (int i = 0; i < num_slots; ++i) {
+        if (mutation_results[i] == 0) {
           mutation_fail_ct++;
+          continue;
         }
-      } else {
-        pnext->push_back(std::move(tmp_s));
+        mutation_success_ct += mutation_results[i];
+        pnext->push_back(std::move(mutated[i]));
+        next_has_bound.push_back(mutation_results[i] == -1);
       }
     }
 
     std::swap(pnext, pnow);
     pnext->clear();
+    std::swap(next_has_bound, now_has_bound);
+    next_has_bound.clear();
   }
 
   // Copy best states in the heap to out_states
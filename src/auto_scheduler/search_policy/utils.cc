@@ -398,6 +398,7 @@ void PruneInvalidState(const SearchTask& task, Array<State>* states) {
 /********** SplitFactorizationMemo **********/
 const Array<Array<Integer>>& SplitFactorizationMemo::GetFactorizationSchemes(
     int extent, int n_lengths, int max_innermost_factor) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   QueryKey key = std::make_tuple(extent, n_lengths, max_innermost_factor);
   const auto& it = memory_.find(key);
   if (it != memory_.end()) {
@@ -427,6 +428,7 @@ void SplitFactorizationMemo::DfsEnumerate(int now, int remaining_length, int max
 }
 
 const std::vector<int>& SplitFactorizationMemo::GetFactors(int n) {
+  std::lock_guard<std::recursive_mutex> lock(mutex_);
   auto it = factor_memory_.find(n);
   if (it != factor_memory_.end()) {
     return it->second;
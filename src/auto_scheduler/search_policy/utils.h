@@ -33,6 +33,7 @@
 
 #include <algorithm>
 #include <condition_variable>
+#include <mutex>
 #include <set>
 #include <string>
 #include <tuple>
@@ -682,6 +683,8 @@ class SplitFactorizationMemo {
   Array<Integer> tmp_stack_;
   Array<Array<Integer>>* results_;
   std::unordered_map<int, std::vector<int>> factor_memory_;
+  /*! \brief Guards the memory, as the sampling and the mutation rules run in parallel. */
+  std::recursive_mutex mutex_;
 };
 
 /*! \brief Get the indexes of SplitStep that processes on spatial iterator. */
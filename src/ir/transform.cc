@@ -82,6 +82,18 @@ PassContext PassContext::Current() {
   }
 }
 
+void PassContext::RunOnWorkerThread(const std::function<void()>& f) const {
+  PassContextThreadLocalEntry* entry = RelayPassContextThreadLocalStore::Get();
+  entry->context_stack.push(*this);
+  try {
+    f();
+  } catch (...) {
+    entry->context_stack.pop();
+    throw;
+  }
+  entry->context_stack.pop();
+}
+
 // linearly scan the pass array to match pass_name
 bool PassArrayContains(const Array<runtime::String>& pass_array, const std::string& pass_name) {
   for (auto x : pass_array) {
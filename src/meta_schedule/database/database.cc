@@ -55,13 +55,15 @@ Workload Workload::FromJSON(const ObjectRef& json_obj) {
     CHECK(json_array && json_array->size() == 2);
     // Load json[0] => shash
     String str_shash = Downcast<String>(json_array->at(0));
-    // Load json[1] => mod
-    {
+    // Load json[1] => mod, the binary tables store the module itself
+    if (const auto* mod_node = json_array->at(1).as<IRModuleNode>()) {
+      mod = GetRef<IRModule>(mod_node);
+    } else {
       String b64_mod = Downcast<String>(json_array->at(1));
       std::string json_mod = Base64Decode(b64_mod);
       mod = Downcast<IRModule>(LoadJSON(json_mod));
-      std::stringstream(str_shash) >> shash;
     }
+    std::stringstream(str_shash) >> shash;
   } catch (const std::runtime_error& e) {  // includes tvm::Error and dmlc::Error
     LOG(FATAL) << "ValueError: Unable to parse the JSON object: " << json_obj
                << "\nThe error is: " << e.what();
@@ -0,0 +1,376 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <set>
+#include <thread>
+#include <unordered_map>
+
+#include "../../support/mapped_file.h"
+#include "../module_equality.h"
+#include "../utils.h"
+
+namespace tvm {
+namespace meta_schedule {
+
+/*!
+ * \brief The index of a tuning record table, memory mapped from "$path_tuning_record.idx".
+ *
+ * The layout is a header, the beginning of the entries of each workload, and the entries of all
+ * the workloads, each the offset of a line of the table and its mean run time, sorted by the
+ * mean run time within the workload:
+ *
+ *   uint64 magic, version, covered_bytes, num_workloads, num_entries
+ *   uint64 begin[num_workloads + 1]
+ *   {uint64 offset, double mean_secs} entries[num_entries]
+ *
+ * The index covers the lines of the table in its first covered_bytes bytes. It is rewritten to a
+ * temporary file renamed over the index, so the readers of other processes never see a partial
+ * index, and appending to the table does not invalidate it.
+ */
+class RecordIndex {
+ public:
+  static constexpr uint64_t kMagic = 0x5844494D53565454;  // "TTVSMIDX"
+  static constexpr uint64_t kVersion = 1;
+
+  struct Entry {
+    uint64_t offset;
+    double mean_secs;
+  };
+
+  /*! \brief Map the index at the path, which is empty unless it is valid for the table. */
+  RecordIndex(const std::string& path, size_t table_size) : file_(path) {
+    if (!file_.good() || file_.size() < sizeof(Header)) return;
+    const auto* header = reinterpret_cast<const Header*>(file_.data());
+    size_t size = sizeof(Header) + (header->num_workloads + 1) * sizeof(uint64_t) +
+                  header->num_entries * sizeof(Entry);
+    if (header->magic != kMagic || header->version != kVersion ||
+        header->covered_bytes > table_size || file_.size() != size) {
+      LOG(WARNING) << "Rebuilding the invalid or stale index " << path;
+      return;
+    }
+    header_ = header;
+    begin_ = reinterpret_cast<const uint64_t*>(header_ + 1);
+    entries_ = reinterpret_cast<const Entry*>(begin_ + header_->num_workloads + 1);
+  }
+
+  /*! \return The number of bytes of the table covered by the index. */
+  uint64_t covered_bytes() const { return header_ ? header_->covered_bytes : 0; }
+  /*! \return The number of workloads of the index. */
+  uint64_t num_workloads() const { return header_ ? header_->num_workloads : 0; }
+  /*! \return The number of entries of the index. */
+  uint64_t size() const { return header_ ? header_->num_entries : 0; }
+
+  /*! \return The entries of a workload, sorted by the mean run time. */
+  std::pair<const Entry*, const Entry*> Lookup(int workload_idx) const {
+    if (!header_ || static_cast<uint64_t>(workload_idx) >= header_->num_workloads) {
+      return {nullptr, nullptr};
+    }
+    return {entries_ + begin_[workload_idx], entries_ + begin_[workload_idx + 1]};
+  }
+
+  /*!
+   * \brief Write the index of the entries of each workload, which are sorted in place.
+   * \param path The path to the index.
+   * \param covered_bytes The number of bytes of the table covered.
+   * \param entries The entries of each workload.
+   */
+  static void Write(const std::string& path, uint64_t covered_bytes,
+                    std::vector<std::vector<Entry>>* entries) {
+    Header header{kMagic, kVersion, covered_bytes, entries->size(), 0};
+    std::vector<uint64_t> begin{0};
+    for (std::vector<Entry>& workload_entries : *entries) {
+      std::stable_sort(workload_entries.begin(), workload_entries.end(),
+                       [](const Entry& a, const Entry& b) { return a.mean_secs < b.mean_secs; });
+      header.num_entries += workload_entries.size();
+      begin.push_back(header.num_entries);
+    }
+    std::string tmp_path = path + "." + std::to_string(std::random_device()()) + ".tmp";
+    {
+      std::ofstream os(tmp_path, std::ofstream::binary | std::ofstream::trunc);
+      CHECK(os.good()) << "ValueError: Cannot create the index: " << tmp_path;
+      os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+      os.write(reinterpret_cast<const char*>(begin.data()), begin.size() * sizeof(uint64_t));
+      for (const std::vector<Entry>& workload_entries : *entries) {
+        os.write(reinterpret_cast<const char*>(workload_entries.data()),
+                 workload_entries.size() * sizeof(Entry));
+      }
+      CHECK(os.good()) << "ValueError: Cannot write the index: " << tmp_path;
+    }
+    CHECK_EQ(std::rename(tmp_path.c_str(), path.c_str()), 0)
+        << "ValueError: Cannot replace the index: " << path;
+  }
+
+ private:
+  struct Header {
+    uint64_t magic;
+    uint64_t version;
+    uint64_t covered_bytes;
+    uint64_t num_workloads;
+    uint64_t num_entries;
+  };
+
+  support::MappedFile file_;
+  const Header* header_{nullptr};
+  const uint64_t* begin_{nullptr};
+  const Entry* entries_{nullptr};
+};
+
+/*!
+ * \brief A database in the json tables of JSONDatabase, which are indexed by workload so that
+ * opening it only loads the workloads, and a query only parses the records it returns.
+ */
+class IndexedDatabaseNode : public DatabaseNode {
+ public:
+  explicit IndexedDatabaseNode(String mod_eq_name = "structural")
+      : DatabaseNode(mod_eq_name),
+        workloads2idx_(/*bucket_count*/ 0, WorkloadHash(), WorkloadEqual(GetModuleEquality())) {}
+
+  /*! \brief The path to the workload table */
+  String path_workload;
+  /*! \brief The path to the tuning record table */
+  String path_tuning_record;
+  /*! \brief The workloads of the lines of the workload table */
+  std::vector<Workload> workloads_;
+  /*! \brief The index of the first line of each distinct workload */
+  std::unordered_map<Workload, int, WorkloadHash, WorkloadEqual> workloads2idx_;
+  /*! \brief The tuning record table as of opening the database */
+  std::unique_ptr<support::MappedFile> table_;
+  /*! \brief The index of the table */
+  std::unique_ptr<RecordIndex> index_;
+  /*! \brief The tuning records committed since opening the database, by workload */
+  std::unordered_map<int, std::multiset<TuningRecord, SortTuningRecordByMeanRunSecs>> committed_;
+  /*! \brief The number of tuning records committed since opening the database */
+  int64_t num_committed_{0};
+
+  void VisitAttrs(tvm::AttrVisitor* v) {
+    v->Visit("path_workload", &path_workload);
+    v->Visit("path_tuning_record", &path_tuning_record);
+    // `workloads_` is not visited
+    // `workloads2idx_` is not visited
+    // `table_` is not visited
+    // `index_` is not visited
+    // `committed_` is not visited
+    // `num_committed_` is not visited
+  }
+
+  static constexpr const char* _type_key = "meta_schedule.IndexedDatabase";
+  TVM_DECLARE_FINAL_OBJECT_INFO(IndexedDatabaseNode, DatabaseNode);
+
+ public:
+  bool HasWorkload(const IRModule& mod) {
+    return workloads2idx_.find(Workload(mod, GetModuleEquality().Hash(mod))) !=
+           workloads2idx_.end();
+  }
+
+  Workload CommitWorkload(const IRModule& mod) {
+    auto [it, inserted] = this->workloads2idx_.emplace(
+        Workload(mod, GetModuleEquality().Hash(mod)), static_cast<int>(workloads_.size()));
+    if (inserted) {
+      workloads_.push_back(it->first);
+      JSONFileAppendLine(this->path_workload, JSONDumps(it->first->AsJSON()));
+    }
+    return it->first;
+  }
+
+  void CommitTuningRecord(const TuningRecord& record) {
+    int workload_idx = this->workloads2idx_.at(record->workload);
+    this->committed_[workload_idx].insert(record);
+    ++this->num_committed_;
+    JSONFileAppendLine(this->path_tuning_record,
+                       JSONDumps(Array<ObjectRef>{
+                           /*workload_index=*/Integer(workload_idx),
+                           /*tuning_record=*/record->AsJSON()  //
+                       }));
+  }
+
+  Array<TuningRecord> GetTopK(const Workload& workload, int top_k) {
+    CHECK_GE(top_k, 0) << "ValueError: top_k must be non-negative";
+    if (top_k == 0) {
+      return {};
+    }
+    auto it = this->workloads2idx_.find(workload);
+    if (it == this->workloads2idx_.end()) {
+      return {};
+    }
+    int workload_idx = it->second;
+    // merge the indexed records and the committed ones, both sorted by the mean run time
+    auto [indexed, indexed_end] = this->index_->Lookup(workload_idx);
+    std::multiset<TuningRecord, SortTuningRecordByMeanRunSecs> empty;
+    auto committed_it = this->committed_.find(workload_idx);
+    const auto& committed =
+        committed_it != this->committed_.end() ? committed_it->second : empty;
+    auto next = committed.begin();
+    Array<TuningRecord> results;
+    results.reserve(top_k);
+    while (results.size() < static_cast<size_t>(top_k) &&
+           (indexed != indexed_end || next != committed.end())) {
+      TuningRecord record{nullptr};
+      if (next == committed.end() ||
+          (indexed != indexed_end &&
+           indexed->mean_secs <= SortTuningRecordByMeanRunSecs::Mean(
+                                     (*next)->run_secs.value_or({})))) {
+        record = ReadRecord(indexed->offset);
+        ++indexed;
+      } else {
+        record = *next++;
+      }
+      if (record->IsValid()) {
+        results.push_back(record);
+      }
+    }
+    return results;
+  }
+
+  Array<TuningRecord> GetAllTuningRecords() {
+    Array<TuningRecord> results;
+    results.reserve(Size());
+    for (int i = 0, n = workloads_.size(); i < n; ++i) {
+      for (auto [entry, end] = this->index_->Lookup(i); entry != end; ++entry) {
+        results.push_back(ReadRecord(entry->offset));
+      }
+    }
+    for (const auto& kv : this->committed_) {
+      for (const TuningRecord& record : kv.second) {
+        results.push_back(record);
+      }
+    }
+    return results;
+  }
+
+  int64_t Size() { return this->index_->size() + this->num_committed_; }
+
+  /*!
+   * \brief Parse a line of the tuning record table.
+   * \param offset The offset of the line.
+   * \param workload_idx The index of the workload of the record, to be set if not null.
+   * \return The tuning record, or its json object if `workload_idx` is set.
+   */
+  ObjectRef ParseLine(uint64_t offset, int* workload_idx) const {
+    const char* begin = table_->data() + offset;
+    const void* end = std::memchr(begin, '\n', table_->size() - offset);
+    size_t size = end ? static_cast<const char*>(end) - begin : table_->size() - offset;
+    ObjectRef json_obj = JSONLoads(std::string(begin, size));
+    const ArrayNode* arr = json_obj.as<ArrayNode>();
+    CHECK(arr && arr->size() == 2) << "ValueError: Unable to parse TuningRecord at offset "
+                                   << offset << " of file " << path_tuning_record;
+    int line_workload = Downcast<Integer>(arr->at(0)).IntValue();
+    CHECK(line_workload >= 0 && line_workload < static_cast<int>(workloads_.size()))
+        << "ValueError: Unknown workload " << line_workload << " at offset " << offset
+        << " of file " << path_tuning_record;
+    if (workload_idx) {
+      *workload_idx = workloads2idx_.at(workloads_[line_workload]);
+      return arr->at(1);
+    }
+    return TuningRecord::FromJSON(arr->at(1), workloads_[line_workload]);
+  }
+
+ private:
+  TuningRecord ReadRecord(uint64_t offset) const {
+    return Downcast<TuningRecord>(ParseLine(offset, nullptr));
+  }
+};
+
+Database Database::IndexedDatabase(String path_workload, String path_tuning_record,
+                                   bool allow_missing, String mod_eq_name) {
+  int num_threads = std::thread::hardware_concurrency();
+  ObjectPtr<IndexedDatabaseNode> n = make_object<IndexedDatabaseNode>(mod_eq_name);
+  n->path_workload = path_workload;
+  n->path_tuning_record = path_tuning_record;
+  {
+    std::vector<ObjectRef> json_objs = JSONFileReadLines(path_workload, num_threads, allow_missing);
+    int n_objs = json_objs.size();
+    n->workloads2idx_.reserve(n_objs);
+    n->workloads_.reserve(n_objs);
+    for (int i = 0; i < n_objs; ++i) {
+      Workload workload = Workload::FromJSON(json_objs[i]);
+      auto recalc_hash = n->GetModuleEquality().Hash(workload->mod);
+      if (recalc_hash != workload->shash) {
+        ObjectPtr<WorkloadNode> wkl = make_object<WorkloadNode>(*workload.get());
+        wkl->shash = recalc_hash;
+        workload = Workload(wkl);
+      }
+      // the records of the duplicates of a workload are indexed under its first line
+      auto it = n->workloads2idx_.emplace(workload, i).first;
+      n->workloads_.push_back(it->first);
+    }
+  }
+  n->table_ = std::make_unique<support::MappedFile>(path_tuning_record);
+  if (!n->table_->good()) {
+    CHECK(allow_missing) << "ValueError: File doesn't exist: " << path_tuning_record;
+    std::ofstream os(path_tuning_record);
+    CHECK(os.good()) << "ValueError: Cannot create new file: " << path_tuning_record;
+    os.close();
+    n->table_ = std::make_unique<support::MappedFile>(path_tuning_record);
+  }
+  std::string path_index = path_tuning_record + ".idx";
+  n->index_ = std::make_unique<RecordIndex>(path_index, n->table_->size());
+  if (n->index_->num_workloads() > n->workloads_.size()) {
+    LOG(WARNING) << "Rebuilding the index " << path_index << " of more workloads than in "
+                 << path_workload;
+    n->index_ = std::make_unique<RecordIndex>("", 0);
+  }
+  // Index the complete lines appended since the index was written
+  uint64_t covered = n->index_->covered_bytes();
+  std::vector<uint64_t> offsets;
+  uint64_t end = covered;
+  for (uint64_t offset = covered; offset < n->table_->size();) {
+    const void* eol = std::memchr(n->table_->data() + offset, '\n', n->table_->size() - offset);
+    if (!eol) break;
+    uint64_t next = static_cast<const char*>(eol) - n->table_->data() + 1;
+    if (next - offset > 1) offsets.push_back(offset);
+    offset = end = next;
+  }
+  if (!offsets.empty() || n->index_->covered_bytes() == 0) {
+    std::vector<int> workload_idx(offsets.size());
+    std::vector<double> mean_secs(offsets.size());
+    support::parallel_for_dynamic(
+        0, static_cast<int>(offsets.size()), num_threads, [&](int thread_id, int task_id) {
+          ObjectRef json_obj = n->ParseLine(offsets[task_id], &workload_idx[task_id]);
+          const ArrayNode* json_record = json_obj.as<ArrayNode>();
+          CHECK(json_record && json_record->size() == 4)
+              << "ValueError: Unable to parse TuningRecord at offset " << offsets[task_id]
+              << " of file " << path_tuning_record;
+          Array<FloatImm> run_secs;
+          if (json_record->at(1).defined()) run_secs = AsFloatArray(json_record->at(1));
+          mean_secs[task_id] = SortTuningRecordByMeanRunSecs::Mean(run_secs);
+        });
+    std::vector<std::vector<RecordIndex::Entry>> entries(n->workloads_.size());
+    for (int i = 0, num_workloads = n->workloads_.size(); i < num_workloads; ++i) {
+      auto [entry, entry_end] = n->index_->Lookup(i);
+      entries[i].assign(entry, entry_end);
+    }
+    for (size_t i = 0; i < offsets.size(); ++i) {
+      entries[workload_idx[i]].push_back({offsets[i], mean_secs[i]});
+    }
+    RecordIndex::Write(path_index, end, &entries);
+    n->index_ = std::make_unique<RecordIndex>(path_index, n->table_->size());
+  }
+  return Database(n);
+}
+
+TVM_REGISTER_NODE_TYPE(IndexedDatabaseNode);
+TVM_REGISTER_GLOBAL("meta_schedule.DatabaseIndexedDatabase")
+    .set_body_typed(Database::IndexedDatabase);
+
+}  // namespace meta_schedule
+}  // namespace tvm
@@ -16,10 +16,12 @@
  * specific language governing permissions and limitations
  * under the License.
  */
+#include <cstring>
 #include <set>
 #include <thread>
 #include <unordered_map>
 
+#include "../../support/mapped_file.h"
 #include "../module_equality.h"
 #include "../utils.h"
 
@@ -65,6 +67,79 @@ void JSONFileAppendLine(const String& path, const std::string& line) {
   os << line << std::endl;
 }
 
+/*!
+ * \brief Whether a table is stored in the binary format of SaveBinary, by the ".bin" extension.
+ * \param path The path to the table.
+ */
+bool IsBinaryTable(const String& path) { return support::EndsWith(path, ".bin"); }
+
+/*!
+ * \brief Read the records of a binary file, each a uint64 size and the blob of SaveBinary.
+ * \param path The path to the binary file.
+ * \param num_threads The number of threads used to concurrently load the records.
+ * \param allow_missing Whether to create new file when the given path is not found.
+ * \return An array containing the records of the binary file.
+ */
+std::vector<ObjectRef> BinaryFileReadRecords(const String& path, int num_threads,
+                                             bool allow_missing) {
+  support::MappedFile file(path);
+  if (file.good()) {
+    // the records are loaded straight from the mapped pages
+    std::vector<std::pair<const char*, uint64_t>> blobs;
+    for (size_t offset = 0; offset < file.size();) {
+      uint64_t size;
+      CHECK_LE(offset + sizeof(size), file.size())
+          << "ValueError: Truncated record " << (blobs.size() + 1) << " of file " << path;
+      std::memcpy(&size, file.data() + offset, sizeof(size));
+      offset += sizeof(size);
+      CHECK_LE(size, file.size() - offset)
+          << "ValueError: Truncated record " << (blobs.size() + 1) << " of file " << path;
+      blobs.emplace_back(file.data() + offset, size);
+      offset += size;
+    }
+    int n = blobs.size();
+    std::vector<ObjectRef> objs;
+    objs.resize(n);
+    support::parallel_for_dynamic(0, n, num_threads, [&](int thread_id, int task_id) {
+      objs[task_id] = LoadBinary(blobs[task_id].first, blobs[task_id].second);
+    });
+    return objs;
+  }
+  CHECK(allow_missing) << "ValueError: File doesn't exist: " << path;
+  std::ofstream os(path, std::ofstream::binary);
+  CHECK(os.good()) << "ValueError: Cannot create new file: " << path;
+  return {};
+}
+
+/*!
+ * \brief Append a record to a binary file.
+ * \param path The path to the binary file.
+ * \param obj The object to append.
+ */
+void BinaryFileAppendRecord(const String& path, const ObjectRef& obj) {
+  std::string blob = SaveBinary(obj);
+  uint64_t size = blob.size();
+  std::ofstream os(path, std::ofstream::app | std::ofstream::binary);
+  CHECK(os.good()) << "ValueError: Cannot open the file to write: " << path;
+  os.write(reinterpret_cast<const char*>(&size), sizeof(size));
+  os.write(blob.data(), blob.size());
+}
+
+/*! \brief Read the objects of a table in the json or binary format. */
+std::vector<ObjectRef> TableReadRecords(const String& path, int num_threads, bool allow_missing) {
+  return IsBinaryTable(path) ? BinaryFileReadRecords(path, num_threads, allow_missing)
+                             : JSONFileReadLines(path, num_threads, allow_missing);
+}
+
+/*! \brief Append an object to a table in the json or binary format. */
+void TableAppendRecord(const String& path, const ObjectRef& obj) {
+  if (IsBinaryTable(path)) {
+    BinaryFileAppendRecord(path, obj);
+  } else {
+    JSONFileAppendLine(path, JSONDumps(obj));
+  }
+}
+
 /*! \brief The default database implementation, which mimics two database tables with two files. */
 class JSONDatabaseNode : public DatabaseNode {
  public:
@@ -105,18 +180,24 @@ class JSONDatabaseNode : public DatabaseNode {
     // If `mod` is new in `workloads2idx_`, append it to the workload file
     if (inserted) {
       it->second = static_cast<int>(this->workloads2idx_.size()) - 1;
-      JSONFileAppendLine(this->path_workload, JSONDumps(workload->AsJSON()));
+      if (IsBinaryTable(this->path_workload)) {
+        // the module is stored as is rather than as the base64 of its json
+        TableAppendRecord(this->path_workload,
+                          Array<ObjectRef>{SHash2Str(workload->shash), workload->mod});
+      } else {
+        TableAppendRecord(this->path_workload, workload->AsJSON());
+      }
     }
     return it->first;
   }
 
   void CommitTuningRecord(const TuningRecord& record) {
     this->tuning_records_.insert(record);
-    JSONFileAppendLine(this->path_tuning_record,
-                       JSONDumps(Array<ObjectRef>{
-                           /*workload_index=*/Integer(this->workloads2idx_.at(record->workload)),
-                           /*tuning_record=*/record->AsJSON()  //
-                       }));
+    TableAppendRecord(this->path_tuning_record,
+                      Array<ObjectRef>{
+                          /*workload_index=*/Integer(this->workloads2idx_.at(record->workload)),
+                          /*tuning_record=*/record->AsJSON()  //
+                      });
   }
 
   Array<TuningRecord> GetTopK(const Workload& workload, int top_k) {
@@ -161,7 +242,7 @@ Database Database::JSONDatabase(String path_workload, String path_tuning_record,
   // Load `n->workloads2idx_` from `path_workload`
   std::vector<Workload> workloads;
   {
-    std::vector<ObjectRef> json_objs = JSONFileReadLines(path_workload, num_threads, allow_missing);
+    std::vector<ObjectRef> json_objs = TableReadRecords(path_workload, num_threads, allow_missing);
     int n_objs = json_objs.size();
     n->workloads2idx_.reserve(n_objs);
     workloads.reserve(n_objs);
@@ -182,7 +263,7 @@ Database Database::JSONDatabase(String path_workload, String path_tuning_record,
   // Load `n->tuning_records_` from `path_tuning_record`
   {
     std::vector<ObjectRef> json_objs =
-        JSONFileReadLines(path_tuning_record, num_threads, allow_missing);
+        TableReadRecords(path_tuning_record, num_threads, allow_missing);
     std::vector<TuningRecord> records;
     records.resize(json_objs.size(), TuningRecord{nullptr});
     support::parallel_for_dynamic(
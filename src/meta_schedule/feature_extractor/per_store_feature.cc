@@ -19,6 +19,7 @@
 #include <tvm/tir/transform.h>
 
 #include <cmath>
+#include <functional>
 #include <memory>
 #include <numeric>
 #include <string>
@@ -1371,7 +1372,7 @@ class PerStoreFeatureNode : public FeatureExtractorNode {
     v->Visit("feature_vector_length", &feature_vector_length);
   }
 
-  void ExtractSingle(IRModule mod, bool is_gpu, std::vector<std::vector<double>>* results) {
+  void ExtractSingle(IRModule mod, bool is_gpu, std::vector<std::vector<double>>* results) const {
     static transform::Sequential passes = tir::transform::PassListForPerStoreFeature();
     mod = passes(std::move(mod));
     std::vector<tir::Feature> features = tir::PerStoreFeatureCollector::Collect(
@@ -1390,16 +1391,21 @@ class PerStoreFeatureNode : public FeatureExtractorNode {
     }
   }
 
-  Array<runtime::NDArray> ExtractFrom(const TuneContext& tune_context,
-                                      const Array<MeasureCandidate>& candidates) {
+  /*!
+   * \brief Extract the features of each candidate in parallel.
+   * \param tune_context The tuning context.
+   * \param candidates The measure candidates.
+   * \param f_done The callback on the features of a candidate, called from the worker threads.
+   */
+  void ExtractParallel(
+      const TuneContext& tune_context, const Array<MeasureCandidate>& candidates,
+      const std::function<void(int, std::vector<std::vector<double>>*)>& f_done) const {
     bool is_gpu = tune_context->target.value()->kind->name == "cuda";
-    std::vector<runtime::NDArray> results;
-    results.resize(candidates.size());
     std::unique_ptr<tir::group6::Feature> feature_group6 = nullptr;
     if (extract_workload) {
       feature_group6 = std::make_unique<tir::group6::Feature>(tune_context->mod.value());
     }
-    auto f = [this, is_gpu, &feature_group6, &candidates, &results](int, int task_id) -> void {
+    auto f = [this, is_gpu, &feature_group6, &candidates, &f_done](int, int task_id) -> void {
       const auto& candidate = candidates[task_id];
       std::vector<std::vector<double>> features;
       ExtractSingle(DeepCopyIRModule(candidate->sch->mod()), is_gpu, &features);
@@ -1408,12 +1414,65 @@ class PerStoreFeatureNode : public FeatureExtractorNode {
           feature_group6->Export(&feature);
         }
       }
-      results[task_id] = tir::utils::AsNDArray(features, this->feature_vector_length);
+      f_done(task_id, &features);
     };
     support::parallel_for_dynamic(0, candidates.size(), tune_context->num_threads, f);
+  }
+
+  Array<runtime::NDArray> ExtractFrom(const TuneContext& tune_context,
+                                      const Array<MeasureCandidate>& candidates) {
+    std::vector<runtime::NDArray> results;
+    results.resize(candidates.size());
+    ExtractParallel(tune_context, candidates,
+                    [this, &results](int task_id, std::vector<std::vector<double>>* features) {
+                      results[task_id] =
+                          tir::utils::AsNDArray(*features, this->feature_vector_length);
+                    });
     return results;
   }
 
+  /*!
+   * \brief Extract the features of all the candidates into one contiguous buffer.
+   * \param tune_context The tuning context.
+   * \param candidates The measure candidates.
+   * \return The float32 features of shape [total number of stores, feature_vector_length], and
+   * the int64 offsets of shape [number of candidates + 1], where the features of candidate i are
+   * the rows in [offsets[i], offsets[i + 1]).
+   */
+  Array<runtime::NDArray> ExtractBatched(const TuneContext& tune_context,
+                                         const Array<MeasureCandidate>& candidates) const {
+    int n = candidates.size();
+    std::vector<std::vector<std::vector<double>>> features(n);
+    ExtractParallel(tune_context, candidates,
+                    [&features](int task_id, std::vector<std::vector<double>>* result) {
+                      features[task_id] = std::move(*result);
+                    });
+    runtime::NDArray offsets = runtime::NDArray::Empty(
+        /*shape=*/{n + 1},
+        /*dtype=*/DLDataType{kDLInt, 64, 1},
+        /*ctx=*/DLDevice{kDLCPU, 0});
+    int64_t* offsets_data = static_cast<int64_t*>(offsets->data);
+    offsets_data[0] = 0;
+    for (int i = 0; i < n; ++i) {
+      offsets_data[i + 1] = offsets_data[i] + features[i].size();
+    }
+    int64_t m = this->feature_vector_length;
+    runtime::NDArray results = runtime::NDArray::Empty(
+        /*shape=*/{offsets_data[n], m},
+        /*dtype=*/DLDataType{kDLFloat, 32, 1},
+        /*ctx=*/DLDevice{kDLCPU, 0});
+    float* data = static_cast<float*>(results->data);
+    auto f_copy = [&features, offsets_data, data, m](int, int task_id) -> void {
+      float* dst = data + offsets_data[task_id] * m;
+      for (const std::vector<double>& row : features[task_id]) {
+        ICHECK_EQ(static_cast<int64_t>(row.size()), m);
+        dst = std::copy(row.begin(), row.end(), dst);
+      }
+    };
+    support::parallel_for_dynamic(0, n, tune_context->num_threads, f_copy);
+    return {results, offsets};
+  }
+
   static constexpr const char* _type_key = "meta_schedule.PerStoreFeature";
   TVM_DECLARE_FINAL_OBJECT_INFO(PerStoreFeatureNode, FeatureExtractorNode);
 };
@@ -1440,6 +1499,13 @@ FeatureExtractor FeatureExtractor::PerStoreFeature(int buffers_per_store,
 TVM_REGISTER_NODE_TYPE(PerStoreFeatureNode);
 TVM_REGISTER_GLOBAL("meta_schedule.FeatureExtractorPerStoreFeature")
     .set_body_typed(FeatureExtractor::PerStoreFeature);
+TVM_REGISTER_GLOBAL("meta_schedule.FeatureExtractorPerStoreFeatureExtractBatched")
+    .set_body_typed([](FeatureExtractor extractor, TuneContext context,
+                       Array<MeasureCandidate> candidates) -> Array<runtime::NDArray> {
+      const auto* self = extractor.as<PerStoreFeatureNode>();
+      ICHECK(self) << "TypeError: Expects PerStoreFeature, but gets: " << extractor->GetTypeKey();
+      return self->ExtractBatched(context, candidates);
+    });
 
 }  // namespace meta_schedule
 }  // namespace tvm
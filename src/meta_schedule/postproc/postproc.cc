@@ -97,6 +97,8 @@ Array<Postproc> Postproc::DefaultHexagon() {
       Postproc::DisallowDynamicLoop(),   Postproc::RewriteParallelVectorizeUnroll(),
       Postproc::RewriteReductionBlock(), Postproc::RewriteLayout(),
       Postproc::VerifyVTCMLimit(),
+      // The pipelined copies into VTCM are lowered to the user DMA, which copies contiguous data
+      Postproc::DisallowAsyncStridedMemCopy(),
   };
 }
 
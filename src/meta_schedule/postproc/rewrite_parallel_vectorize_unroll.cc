@@ -389,6 +389,26 @@ void RewriteVectorize(const Schedule& sch, size_t n, Array<LoopRV>* loop_rvs) {
   }
 }
 
+/*!
+ * \brief Vectorize a part of the innermost loop, too long to be vectorized as a whole, with the
+ *  lanes planned from the contiguity and the alignment of the accesses of its block.
+ */
+void RewriteVectorizeInnermost(const Schedule& sch, int max_extent, Array<LoopRV>* loop_rvs) {
+  const ForNode* loop = TVM_SREF_TO_FOR(sch->GetSRef(loop_rvs->back()));
+  if (loop->kind != ForKind::kSerial || HasAnnOrBinding(loop) || !IsSingleStmt(loop->body)) {
+    return;
+  }
+  // The lanes of the vectorized loop are capped by max_extent whatever the element type.
+  int lanes = PlanVectorize(GetRef<For>(loop), max_extent * 64).lanes;
+  while (lanes > max_extent) lanes /= 2;
+  if (lanes <= 1) {
+    return;
+  }
+  Array<LoopRV> split = sch->Split(loop_rvs->back(), {NullOpt, Integer(lanes)});
+  sch->Vectorize(split[1]);
+  loop_rvs->Set(loop_rvs->size() - 1, split[0]);
+}
+
 void RewriteUnroll(const Schedule& sch, int unroll_explicit, int max_step, const BlockRV& block,
                    const LoopRV& loop) {
   // Do not unroll for pure spatial block.
@@ -433,6 +453,8 @@ class RewriteParallelVectorizeUnrollNode : public PostprocNode {
           // Vectorize
           if (parsed.num_vectorize_loops > 0) {
             tir::RewriteVectorize(sch, parsed.num_vectorize_loops, &loop_rvs);
+          } else if (parsed.max_vectorize_extent != -1) {
+            tir::RewriteVectorizeInnermost(sch, parsed.max_vectorize_extent, &loop_rvs);
           }
         }
         // AutoUnroll
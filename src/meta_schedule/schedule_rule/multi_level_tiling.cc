@@ -97,6 +97,12 @@ void MultiLevelTilingNode::InitializeWithTuneContext(const TuneContext& context)
       }
     }
   }
+  if (context->target.value()->kind->name == "hexagon" &&
+      this->reuse_read_.req != ReuseType::kNoReuse) {
+    // Double buffer the reads cached in VTCM: the copies of the next tile, lowered to the user
+    // DMA, overlap the computation of the current one.
+    this->stages = {3};
+  }
   logger = context->logger;
 }
 
@@ -302,7 +308,8 @@ std::vector<State> MultiLevelTilingNode::AddAsyncPipeline(State state) const {
   if (r_indices_.size() < 1 || this->stages.empty()) {
     return {state};
   }
-  // Current only support default config used by ScheduleRule::DefaultCUDA
+  // Current only support default config used by ScheduleRule::DefaultCUDA and
+  // ScheduleRule::DefaultHexagon
   // @see src/meta_schedule/schedule_rule/schedule_rule.cc
   // check the reduce loop contains exactly 3 for loops
   // therefore it matches the notation array size in the following code
@@ -273,6 +273,64 @@ Array<ScheduleRule> ScheduleRule::DefaultCUDATensorCore() {
   return results;
 }
 
+Array<ScheduleRule> ScheduleRule::DefaultVulkanCooperativeMatrix() {
+  // The WMMA intrinsics, which the SPIR-V codegen lowers to cooperative matrices. Vulkan has no
+  // dynamic shared memory, and the fragments can only be filled with floats.
+  Array<Map<String, String>> wmma_intrin_groups = {
+      // f32 += f16 * f16
+      {
+          {"init", "wmma_fill_16x16x16_f32"},
+          {"load_a", "wmma_load_16x16x16_f16_a_shared"},
+          {"load_b", "wmma_load_16x16x16_f16_b_shared"},
+          {"compute", "wmma_sync_16x16x16_f16f16f32"},
+          {"store", "wmma_store_16x16x16_f32_shared"},
+      },
+      {
+          {"init", "wmma_fill_16x16x16_f32"},
+          {"load_a", "wmma_load_16x16x16_f16_a_shared"},
+          {"load_b", "wmma_load_16x16x16_f16_b_trans_shared"},
+          {"compute", "wmma_sync_16x16x16_f16f16f32_trans"},
+          {"store", "wmma_store_16x16x16_f32_shared"},
+      },
+      // f16 += f16 * f16
+      {
+          {"init", "wmma_fill_16x16x16_f16"},
+          {"load_a", "wmma_load_16x16x16_f16_a_shared"},
+          {"load_b", "wmma_load_16x16x16_f16_b_shared"},
+          {"compute", "wmma_sync_16x16x16_f16f16f16"},
+          {"store", "wmma_store_16x16x16_f16_shared"},
+      },
+      {
+          {"init", "wmma_fill_16x16x16_f16"},
+          {"load_a", "wmma_load_16x16x16_f16_a_shared"},
+          {"load_b", "wmma_load_16x16x16_f16_b_trans_shared"},
+          {"compute", "wmma_sync_16x16x16_f16f16f16_trans"},
+          {"store", "wmma_store_16x16x16_f16_shared"},
+      },
+  };
+  Array<ScheduleRule> results{
+      ScheduleRule::ApplyCustomRule(),
+      ScheduleRule::MultiLevelTilingTensorCore(
+          /*intrin_groups=*/wmma_intrin_groups,
+          /*structure=*/"SSSRRSRS",
+          /*tile_binds=*/Array<String>{"blockIdx.y", "blockIdx.x", "threadIdx.y"},
+          /*max_innermost_factor=*/Integer(4),
+          /*vector_load_lens=*/Array<Integer>{1, 2, 4, 8},
+          /*reuse_read=*/
+          Map<String, ObjectRef>{{"req", String("must")},
+                                 {"levels", Array<Integer>{4}},  //
+                                 {"scope", String("shared")}},
+          /*reuse_write=*/
+          Map<String, ObjectRef>{{"req", String("must")},
+                                 {"levels", Array<Integer>{2}},  //
+                                 {"scope", String("shared")}},
+          /*use_software_pipeline=*/false),
+  };
+  Array<ScheduleRule> append = ScheduleRule::DefaultCUDA();
+  results.insert(results.end(), append.begin() + 1, append.end());
+  return results;
+}
+
 Array<ScheduleRule> ScheduleRule::DefaultHexagon() {
   return {
       ScheduleRule::ApplyCustomRule(),
@@ -289,7 +347,10 @@ Array<ScheduleRule> ScheduleRule::DefaultHexagon() {
           /*structure=*/"SRSRS",
           /*vector_length_in_bits=*/1024,
           /*max_innermost_factor=*/Integer(128),
-          /*reuse_read=*/NullOpt,
+          /*reuse_read=*/
+          Map<String, ObjectRef>{{"req", String("must")},
+                                 {"levels", Array<Integer>{2}},
+                                 {"scope", String("global.vtcm")}},
           /*reuse_write=*/
           Map<String, ObjectRef>{{"req", String("may")},
                                  {"levels", Array<Integer>{1, 2}},
@@ -441,6 +502,8 @@ TVM_REGISTER_GLOBAL("meta_schedule.ScheduleRuleDefaultCUDA")
     .set_body_typed(ScheduleRule::DefaultCUDA);
 TVM_REGISTER_GLOBAL("meta_schedule.ScheduleRuleDefaultCUDATensorCore")
     .set_body_typed(ScheduleRule::DefaultCUDATensorCore);
+TVM_REGISTER_GLOBAL("meta_schedule.ScheduleRuleDefaultVulkanCooperativeMatrix")
+    .set_body_typed(ScheduleRule::DefaultVulkanCooperativeMatrix);
 TVM_REGISTER_GLOBAL("meta_schedule.ScheduleRuleDefaultHexagon")
     .set_body_typed(ScheduleRule::DefaultHexagon);
 TVM_REGISTER_GLOBAL("meta_schedule.ScheduleRuleDefaultMicro")
@@ -17,7 +17,10 @@
  * under the License.
  */
 
+#include <cmath>
+
 #include "../module_equality.h"
+#include "../trace_apply.h"
 #include "../utils.h"
 
 #define TVM_META_SCHEDULE_CHECK_PROB_RANGE(p, name)                               \
@@ -220,6 +223,63 @@ Array<MeasureCandidate> AssembleCandidates(const std::vector<Schedule>& picks) {
   return measure_inputs;
 }
 
+/*!
+ * \brief The shape-free structure of a workload, and the extents of its block iterators.
+ * Two workloads with the same structure differ only in their shapes.
+ */
+struct WorkloadShape {
+  /*! \brief The blocks, their iterator types and the buffer types, shapes erased. */
+  std::string structure;
+  /*! \brief The logarithm of the extents of the block iterators, in order. */
+  std::vector<double> log_extents;
+
+  explicit WorkloadShape(const IRModule& mod) {
+    const tir::PrimFuncNode* func = tir::FindEntryFunc(mod, nullptr);
+    if (func == nullptr) {
+      return;
+    }
+    std::ostringstream os;
+    for (const tir::Var& param : func->params) {
+      if (Optional<tir::Buffer> buffer = func->buffer_map.Get(param)) {
+        os << buffer.value()->dtype << "[" << buffer.value()->shape.size() << "]";
+      }
+    }
+    bool is_static = true;
+    tir::PreOrderVisit(func->body, [&](const ObjectRef& obj) -> bool {
+      if (const auto* block = obj.as<tir::BlockNode>()) {
+        os << ";" << block->name_hint << ":";
+        for (const tir::IterVar& iter : block->iter_vars) {
+          os << static_cast<int>(iter->iter_type);
+          if (const auto* extent = iter->dom->extent.as<IntImmNode>()) {
+            log_extents.push_back(std::log(static_cast<double>(extent->value)));
+          } else {
+            is_static = false;
+          }
+        }
+      }
+      return is_static;
+    });
+    if (is_static) {
+      structure = os.str();
+    }
+  }
+
+  /*!
+   * \brief The distance to another workload.
+   * \return The L1 distance between the log extents, or -1 if the structures differ.
+   */
+  double Distance(const WorkloadShape& other) const {
+    if (structure.empty() || structure != other.structure) {
+      return -1.0;
+    }
+    double distance = 0.0;
+    for (size_t i = 0; i < log_extents.size(); ++i) {
+      distance += std::abs(log_extents[i] - other.log_extents[i]);
+    }
+    return distance;
+  }
+};
+
 /*!
  * \brief Predict the normalized score of each candidate.
  * \param candidates The candidates for prediction
@@ -273,6 +333,10 @@ class EvolutionarySearchNode : public SearchStrategyNode {
     CostModel cost_model_{nullptr};
     /*! \brief The token registered for the given workload in database. */
     Workload token_{nullptr};
+    /*! \brief The best traces of the tuned workloads nearest to this one, nearest first. */
+    std::vector<tir::Trace> similar_traces_;
+    /*! \brief The similar traces re-applied to this workload, computed on first use. */
+    Optional<Array<Schedule>> similar_schedules_{NullOpt};
 
     explicit State(EvolutionarySearchNode* self, int max_trials, int num_trials_per_iter,
                    Array<Schedule> design_space_schedules, Database database, CostModel cost_model)
@@ -297,8 +361,25 @@ class EvolutionarySearchNode : public SearchStrategyNode {
       this->database_ = database;
       this->cost_model_ = cost_model;
       this->token_ = database->CommitWorkload(mod);
+      if (self->num_similar_workloads > 0) {
+        this->similar_traces_ = FindSimilarTraces(mod);
+      }
     }
 
+    /*!
+     * \brief Find the best traces of the tuned workloads that differ from this one only in their
+     * shapes, to warm start the search when this workload has few records.
+     * \param mod The workload.
+     * \return The traces, the nearest workloads first.
+     */
+    inline std::vector<tir::Trace> FindSimilarTraces(const IRModule& mod);
+    /*!
+     * \brief Pick up candidates from the best traces of similar workloads, re-applied to this one.
+     * \param num The number of traces to produce.
+     * \return The picked candidates.
+     */
+    inline std::vector<Schedule> PickFromSimilarWorkloads(int num);
+
     /*!
      * \brief Pick up best candidates from database.
      * \param num The number of traces to produce.
@@ -367,6 +448,11 @@ class EvolutionarySearchNode : public SearchStrategyNode {
   int init_min_unmeasured;
   /*! \brief The maximum number of failure during initial sampling. */
   int max_fail_count;
+  /*!
+   * \brief The number of tuned workloads differing only in shapes whose best traces seed the
+   * measured part of the initial population, when this workload has not enough records.
+   */
+  int num_similar_workloads;
   /*** Configuration: evolution ***/
   /*! \brief The number of iterations performed by generic algorithm. */
   int genetic_num_iters;
@@ -390,6 +476,7 @@ class EvolutionarySearchNode : public SearchStrategyNode {
     v->Visit("init_measured_ratio", &init_measured_ratio);
     v->Visit("init_min_unmeasured", &init_min_unmeasured);
     v->Visit("max_fail_count", &max_fail_count);
+    v->Visit("num_similar_workloads", &num_similar_workloads);
     /*** Configuration: evolution ***/
     v->Visit("genetic_num_iters", &genetic_num_iters);
     v->Visit("genetic_mutate_prob", &genetic_mutate_prob);
@@ -460,6 +547,7 @@ class EvolutionarySearchNode : public SearchStrategyNode {
     n->init_measured_ratio = this->init_measured_ratio;
     n->init_min_unmeasured = this->init_min_unmeasured;
     n->max_fail_count = this->max_fail_count;
+    n->num_similar_workloads = this->num_similar_workloads;
     n->genetic_num_iters = this->genetic_num_iters;
     n->genetic_mutate_prob = this->genetic_mutate_prob;
     n->genetic_max_fail_count = this->genetic_max_fail_count;
@@ -501,6 +589,78 @@ std::vector<Schedule> EvolutionarySearchNode::State::PickBestFromDatabase(int nu
   return results;
 }
 
+std::vector<tir::Trace> EvolutionarySearchNode::State::FindSimilarTraces(const IRModule& mod) {
+  auto _ = Profiler::TimedScope("EvoSearch/FindSimilarTraces");
+  WorkloadShape shape(mod);
+  std::unordered_set<Workload, ObjectPtrHash, ObjectPtrEqual> visited{this->token_};
+  std::vector<std::pair<double, Workload>> similar;
+  for (const TuningRecord& record : this->database_->GetAllTuningRecords()) {
+    if (!visited.insert(record->workload).second) {
+      continue;
+    }
+    double distance = shape.Distance(WorkloadShape(record->workload->mod));
+    if (distance > 0.0) {
+      similar.emplace_back(distance, record->workload);
+    }
+  }
+  int num_workloads = std::min<int>(similar.size(), self->num_similar_workloads);
+  if (num_workloads == 0) {
+    return {};
+  }
+  std::partial_sort(similar.begin(), similar.begin() + num_workloads, similar.end(),
+                    [](const auto& a, const auto& b) { return a.first < b.first; });
+  int num_per_workload = std::max(1, static_cast<int>(self->population_size *
+                                                      self->init_measured_ratio / num_workloads));
+  std::vector<tir::Trace> traces;
+  for (int i = 0; i < num_workloads; ++i) {
+    Array<TuningRecord> records = this->database_->GetTopK(similar[i].second, num_per_workload);
+    for (const TuningRecord& record : records) {
+      traces.push_back(record->trace->Simplified(/*remove_postproc=*/true));
+    }
+  }
+  TVM_PY_LOG(INFO, self->ctx_->logger) << "Found " << traces.size() << " trace(s) of "
+                                       << num_workloads << " similar workload(s) to warm start";
+  return traces;
+}
+
+std::vector<Schedule> EvolutionarySearchNode::State::PickFromSimilarWorkloads(int num) {
+  if (!similar_schedules_.defined()) {
+    auto _ = Profiler::TimedScope("EvoSearch/PickFromSimilarWorkloads");
+    Target target = self->ctx_->target.value();
+    ThreadedTraceApply pp(self->postprocs_);
+    int n = similar_traces_.size();
+    std::vector<Schedule> results(n, Schedule{nullptr});
+    auto f_proc_similar = [this, &target, &results, &pp](int thread_id, int trace_id) -> void {
+      PerThreadData& data = this->per_thread_data_.at(thread_id);
+      TRandState* rand_state = &data.rand_state;
+      const IRModule& mod = data.mod;
+      Schedule sch = Schedule::Traced(mod, /*rand_state=*/ForkSeed(rand_state),
+                                      /*debug_mode=*/0,
+                                      /*error_render_level=*/tir::ScheduleErrorRenderLevel::kNone);
+      // The tile sizes of the other shapes are adjusted to this one as the trace is re-applied
+      try {
+        ScheduleUsingAnchorTrace(sch, similar_traces_.at(trace_id), target);
+      } catch (const std::exception&) {
+        return;
+      }
+      if (Optional<Schedule> result = pp.Apply(mod, sch->trace().value(), rand_state)) {
+        results.at(trace_id) = result.value();
+      }
+    };
+    support::parallel_for_dynamic(0, n, self->ctx_->num_threads, f_proc_similar);
+    Array<Schedule> schedules;
+    for (const Schedule& sch : results) {
+      if (sch.defined()) {
+        schedules.push_back(sch);
+      }
+    }
+    similar_schedules_ = schedules;
+  }
+  Array<Schedule> schedules = similar_schedules_.value();
+  return std::vector<Schedule>(schedules.begin(),
+                               schedules.begin() + std::min<int>(num, schedules.size()));
+}
+
 std::vector<Schedule> EvolutionarySearchNode::State::SampleInitPopulation(int num) {
   auto _ = Profiler::TimedScope("EvoSearch/SampleInitPopulation");
   ThreadedTraceApply pp(self->postprocs_);
@@ -714,6 +874,14 @@ Optional<Array<MeasureCandidate>> EvolutionarySearchNode::State::GenerateMeasure
   std::vector<Schedule> measured = PickBestFromDatabase(pop * self->init_measured_ratio);
   TVM_PY_LOG(INFO, self->ctx_->logger)
       << "Picked top " << measured.size() << " candidate(s) from database";
+  if (!similar_traces_.empty() &&
+      static_cast<int>(measured.size()) < static_cast<int>(pop * self->init_measured_ratio)) {
+    std::vector<Schedule> similar = PickFromSimilarWorkloads(
+        static_cast<int>(pop * self->init_measured_ratio) - measured.size());
+    TVM_PY_LOG(INFO, self->ctx_->logger)
+        << "Picked " << similar.size() << " candidate(s) from similar workloads";
+    measured.insert(measured.end(), similar.begin(), similar.end());
+  }
   std::vector<Schedule> unmeasured = SampleInitPopulation(pop - measured.size());
   if (static_cast<int>(unmeasured.size()) < self->init_min_unmeasured) {
     TVM_PY_LOG(WARNING, self->ctx_->logger)
@@ -755,7 +923,8 @@ SearchStrategy SearchStrategy::EvolutionarySearch(int population_size,         /
                                                   int genetic_num_iters,       //
                                                   double genetic_mutate_prob,  //
                                                   int genetic_max_fail_count,  //
-                                                  double eps_greedy) {
+                                                  double eps_greedy,           //
+                                                  int num_similar_workloads) {
   TVM_META_SCHEDULE_CHECK_PROB_RANGE(init_measured_ratio, "Initial measured ratio");
   TVM_META_SCHEDULE_CHECK_PROB_RANGE(genetic_mutate_prob, "Mutation probability");
   TVM_META_SCHEDULE_CHECK_PROB_RANGE(eps_greedy, "Greedy pick probability");
@@ -765,6 +934,7 @@ SearchStrategy SearchStrategy::EvolutionarySearch(int population_size,         /
   n->init_measured_ratio = init_measured_ratio;
   n->init_min_unmeasured = init_min_unmeasured;
   n->max_fail_count = max_fail_count;
+  n->num_similar_workloads = num_similar_workloads;
   n->genetic_num_iters = genetic_num_iters;
   n->genetic_max_fail_count = genetic_max_fail_count;
   n->genetic_mutate_prob = genetic_mutate_prob;
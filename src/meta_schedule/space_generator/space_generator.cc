@@ -72,6 +72,13 @@ String GetRuleKindFromTarget(const Target& target) {
     return "cuda";
   }
 
+  if (target->kind->name == "vulkan") {
+    if (target->GetAttr<Bool>("supports_cooperative_matrix").value_or(Bool(false)) ||
+        target->GetAttr<Bool>("supports_cooperative_matrix_khr").value_or(Bool(false))) {
+      return "vulkan-cooperative-matrix";
+    }
+  }
+
   if (IsGPUTarget(target->kind->name)) {
     return "cuda";
   }
@@ -105,6 +112,10 @@ void SpaceGeneratorNode::InitializeWithTuneContext(const TuneContext& context) {
       default_sch_rules = ScheduleRule::DefaultCUDATensorCore();
       default_postprocs = Postproc::DefaultCUDATensorCore();
       default_mutator_probs = Mutator::DefaultCUDATensorCore();
+    } else if (kind == "vulkan-cooperative-matrix") {
+      default_sch_rules = ScheduleRule::DefaultVulkanCooperativeMatrix();
+      default_postprocs = Postproc::DefaultCUDATensorCore();
+      default_mutator_probs = Mutator::DefaultCUDATensorCore();
     } else if (kind == "hexagon") {
       default_sch_rules = ScheduleRule::DefaultHexagon();
       default_postprocs = Postproc::DefaultHexagon();
@@ -58,6 +58,14 @@ void SendToRunner(TaskRecordNode* self, const Runner& runner) {
   ICHECK_EQ(candidates.size(), builder_results.size());
   int n = candidates.size();
   int n_build_errors = 0;
+  // The best latency measured so far lets the runner stop measuring hopeless candidates early
+  Optional<FloatImm> threshold_secs = NullOpt;
+  if (!self->latency_ms.empty()) {
+    double best_ms = *std::min_element(self->latency_ms.begin(), self->latency_ms.end());
+    if (best_ms < 1e9) {
+      threshold_secs = FloatImm(DataType::Float(64), best_ms / 1000.0);
+    }
+  }
   Array<RunnerInput> inputs;
   inputs.reserve(n);
   for (int i = 0; i < n; ++i) {
@@ -69,7 +77,8 @@ void SendToRunner(TaskRecordNode* self, const Runner& runner) {
     }
     inputs.push_back(RunnerInput(/*artifact_path=*/builder_result->artifact_path.value(),
                                  /*device_type=*/target->kind->name,
-                                 /*args_info=*/candidate->args_info));
+                                 /*args_info=*/candidate->args_info,
+                                 /*threshold_secs=*/threshold_secs));
   }
   Array<RunnerFuture> futures = runner->Run(inputs);
   if (n_build_errors == 0) {
@@ -208,6 +208,22 @@ ObjectRef JSONLoads(std::string json_str);
  */
 std::string JSONDumps(ObjectRef json_obj);
 
+/*!
+ * \brief Read lines from a json file.
+ * \param path The path to the json file.
+ * \param num_threads The number of threads used to concurrently parse the lines.
+ * \param allow_missing Whether to create new file when the given path is not found.
+ * \return An array containing lines read from the json file.
+ */
+std::vector<ObjectRef> JSONFileReadLines(const String& path, int num_threads, bool allow_missing);
+
+/*!
+ * \brief Append a line to a json file.
+ * \param path The path to the json file.
+ * \param line The line to append.
+ */
+void JSONFileAppendLine(const String& path, const std::string& line);
+
 /*!
  * \brief Converts a structural hash code to string
  * \param hash_code The hash code
@@ -21,6 +21,7 @@
  * \file node/serialization.cc
  * \brief Utilities to serialize TVM AST/IR objects.
  */
+#include <dmlc/endian.h>
 #include <dmlc/json.h>
 #include <dmlc/memory_io.h>
 #include <tvm/ir/attrs.h>
@@ -32,9 +33,12 @@
 #include <tvm/runtime/packed_func.h>
 #include <tvm/runtime/registry.h>
 
+#include <algorithm>
 #include <cctype>
+#include <cstring>
 #include <map>
 #include <string>
+#include <string_view>
 
 #include "../runtime/object_internal.h"
 #include "../support/base64.h"
@@ -622,7 +626,608 @@ ObjectRef LoadJSON(std::string json_str) {
   return ObjectRef(nodes.at(jgraph.root));
 }
 
+// The binary format. The integers of fixed size are little-endian, the counts, lengths and
+// indices are LEB128 varints.
+//
+//   "TVMB" u32:version
+//   strings:  count, (length, bytes) * count   -- type keys, field names, strings, repr bytes
+//   version:  string index of the tvm version
+//   root:     node index
+//   nodes:    count, node * count              -- node 0 is None
+//   tensors:  count, (length, SaveDLTensor bytes) * count
+//
+// A node is one plus the string index of its type key (0 for None), then its kind and
+//   kRepr:    string index of the repr bytes
+//   kArray:   count, node index * count
+//   kStrMap:  count, (key string index, value node index) * count
+//   kMap:     count, (key node index, value node index) * count
+//   kObject:  count, (field name string index, tag, value) * count
+namespace binary {
+
+constexpr char kMagic[4] = {'T', 'V', 'M', 'B'};
+constexpr uint32_t kVersion = 1;
+
+enum NodeKind : uint8_t { kRepr = 0, kArray = 1, kStrMap = 2, kMap = 3, kObject = 4 };
+
+enum FieldTag : uint8_t {
+  kDouble = 0,     // 8 bytes
+  kInt64 = 1,      // zigzag varint
+  kUInt64 = 2,     // varint
+  kInt = 3,        // zigzag varint
+  kBool = 4,       // 1 byte
+  kString = 5,     // string index
+  kDataType = 6,   // code and bits bytes, lanes varint
+  kNDArray = 7,    // tensor index
+  kObjectRef = 8,  // node index
+};
+
+inline uint64_t ZigZagEncode(int64_t v) {
+  return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+inline int64_t ZigZagDecode(uint64_t v) {
+  return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+class Writer {
+ public:
+  void WriteVarint(uint64_t v) {
+    while (v >= 0x80) {
+      buf_.push_back(static_cast<char>((v & 0x7F) | 0x80));
+      v >>= 7;
+    }
+    buf_.push_back(static_cast<char>(v));
+  }
+  void WriteByte(uint8_t v) { buf_.push_back(static_cast<char>(v)); }
+  void WriteBytes(const void* data, size_t size) {
+    buf_.append(static_cast<const char*>(data), size);
+  }
+  template <typename T>
+  void WritePOD(T v) {
+    if (!DMLC_IO_NO_ENDIAN_SWAP) {
+      dmlc::ByteSwap(&v, sizeof(T), 1);
+    }
+    WriteBytes(&v, sizeof(T));
+  }
+  std::string* buffer() { return &buf_; }
+
+ private:
+  std::string buf_;
+};
+
+class Reader {
+ public:
+  Reader(const char* data, size_t size)
+      : ptr_(reinterpret_cast<const uint8_t*>(data)), end_(ptr_ + size) {}
+
+  uint64_t ReadVarint() {
+    uint64_t v = 0;
+    for (int shift = 0;; shift += 7) {
+      ICHECK(ptr_ < end_ && shift < 64) << "BinaryReader: truncated or corrupted blob";
+      uint8_t b = *ptr_++;
+      v |= static_cast<uint64_t>(b & 0x7F) << shift;
+      if ((b & 0x80) == 0) return v;
+    }
+  }
+  size_t ReadIndex(size_t limit) {
+    uint64_t v = ReadVarint();
+    ICHECK_LT(v, limit) << "BinaryReader: index out of range";
+    return static_cast<size_t>(v);
+  }
+  uint8_t ReadByte() { return *reinterpret_cast<const uint8_t*>(ReadBytes(1)); }
+  const char* ReadBytes(size_t size) {
+    ICHECK_LE(size, static_cast<size_t>(end_ - ptr_)) << "BinaryReader: truncated blob";
+    const char* data = reinterpret_cast<const char*>(ptr_);
+    ptr_ += size;
+    return data;
+  }
+  template <typename T>
+  T ReadPOD() {
+    T v;
+    std::memcpy(&v, ReadBytes(sizeof(T)), sizeof(T));
+    if (!DMLC_IO_NO_ENDIAN_SWAP) {
+      dmlc::ByteSwap(&v, sizeof(T), 1);
+    }
+    return v;
+  }
+
+ private:
+  const uint8_t* ptr_;
+  const uint8_t* end_;
+};
+
+// The deduplicated strings of a blob, in the order of their first use
+class StringTable {
+ public:
+  size_t Add(const std::string& str) {
+    auto it = index_.emplace(str, strings_.size());
+    if (it.second) {
+      strings_.push_back(&it.first->first);
+    }
+    return it.first->second;
+  }
+  const std::vector<const std::string*>& strings() const { return strings_; }
+
+ private:
+  std::unordered_map<std::string, size_t> index_;
+  std::vector<const std::string*> strings_;
+};
+
+/*! \brief Node of a loaded binary graph, its children are a range of data or fields. */
+struct NodeEntry {
+  /*! \brief One plus the string index of the type key, 0 for None. */
+  uint32_t type_key;
+  NodeKind kind;
+  /*! \brief The string index of the repr bytes. */
+  uint32_t repr;
+  uint32_t begin;
+  uint32_t end;
+};
+
+struct FieldEntry {
+  uint32_t key;
+  FieldTag tag;
+  /*! \brief The value, the bits of a double, and code | bits << 8 | lanes << 16 of a DataType */
+  uint64_t value;
+};
+
+/*! \brief The graph of a blob, the strings and tensors point into the blob. */
+struct Graph {
+  std::vector<std::string_view> strings;
+  size_t root;
+  std::vector<NodeEntry> nodes;
+  std::vector<uint64_t> data;
+  std::vector<FieldEntry> fields;
+  std::vector<std::string_view> tensors;
+
+  void Load(Reader* reader) {
+    const char* magic = reader->ReadBytes(sizeof(kMagic));
+    ICHECK(std::equal(magic, magic + sizeof(kMagic), kMagic))
+        << "BinaryReader: not a binary graph";
+    uint32_t version = reader->ReadPOD<uint32_t>();
+    ICHECK_EQ(version, kVersion) << "BinaryReader: unsupported version";
+    strings.resize(reader->ReadVarint());
+    for (std::string_view& str : strings) {
+      size_t size = reader->ReadVarint();
+      str = std::string_view(reader->ReadBytes(size), size);
+    }
+    // the tvm version, not checked as with the json format
+    reader->ReadIndex(strings.size());
+    root = reader->ReadVarint();
+    nodes.resize(reader->ReadVarint());
+    ICHECK_LT(root, nodes.size()) << "BinaryReader: index out of range";
+    for (NodeEntry& node : nodes) {
+      LoadNode(reader, &node);
+    }
+    tensors.resize(reader->ReadVarint());
+    for (std::string_view& tensor : tensors) {
+      size_t size = reader->ReadVarint();
+      tensor = std::string_view(reader->ReadBytes(size), size);
+    }
+  }
+
+  void LoadNode(Reader* reader, NodeEntry* node) {
+    node->type_key = reader->ReadIndex(strings.size() + 1);
+    node->kind = kRepr;
+    node->repr = 0;
+    node->begin = node->end = 0;
+    if (node->type_key == 0) return;
+    node->kind = static_cast<NodeKind>(reader->ReadByte());
+    switch (node->kind) {
+      case kRepr: {
+        node->repr = reader->ReadIndex(strings.size());
+        break;
+      }
+      case kArray:
+      case kStrMap:
+      case kMap: {
+        uint64_t count = reader->ReadVarint();
+        node->begin = data.size();
+        for (uint64_t i = 0; i < count; ++i) {
+          if (node->kind != kArray) {
+            size_t num_keys = node->kind == kStrMap ? strings.size() : nodes.size();
+            data.push_back(reader->ReadIndex(num_keys));
+          }
+          data.push_back(reader->ReadIndex(nodes.size()));
+        }
+        node->end = data.size();
+        break;
+      }
+      case kObject: {
+        uint64_t count = reader->ReadVarint();
+        node->begin = fields.size();
+        for (uint64_t i = 0; i < count; ++i) {
+          fields.push_back(LoadField(reader));
+        }
+        node->end = fields.size();
+        break;
+      }
+      default:
+        LOG(FATAL) << "BinaryReader: unknown node kind " << static_cast<int>(node->kind);
+    }
+  }
+
+  FieldEntry LoadField(Reader* reader) {
+    FieldEntry field;
+    field.key = reader->ReadIndex(strings.size());
+    field.tag = static_cast<FieldTag>(reader->ReadByte());
+    switch (field.tag) {
+      case kDouble:
+        field.value = reader->ReadPOD<uint64_t>();
+        break;
+      case kInt64:
+      case kUInt64:
+      case kInt:
+      case kNDArray:
+        field.value = reader->ReadVarint();
+        break;
+      case kBool:
+        field.value = reader->ReadByte();
+        break;
+      case kString:
+        field.value = reader->ReadIndex(strings.size());
+        break;
+      case kDataType: {
+        uint64_t code = reader->ReadByte();
+        uint64_t bits = reader->ReadByte();
+        field.value = code | (bits << 8) | (reader->ReadVarint() << 16);
+        break;
+      }
+      case kObjectRef:
+        field.value = reader->ReadIndex(nodes.size());
+        break;
+      default:
+        LOG(FATAL) << "BinaryReader: unknown field tag " << static_cast<int>(field.tag);
+    }
+    return field;
+  }
+
+  template <typename F>
+  void ForEachChild(const NodeEntry& node, F f) const {
+    if (node.kind == kObject) {
+      for (uint32_t i = node.begin; i < node.end; ++i) {
+        if (fields[i].tag == kObjectRef) f(fields[i].value);
+      }
+    } else if (node.kind == kStrMap) {
+      for (uint32_t i = node.begin + 1; i < node.end; i += 2) f(data[i]);
+    } else {
+      for (uint32_t i = node.begin; i < node.end; ++i) f(data[i]);
+    }
+  }
+
+  // Same as JSONGraph::TopoSort, the children come first
+  std::vector<size_t> TopoSort() const {
+    size_t n_nodes = nodes.size();
+    std::vector<size_t> topo_order;
+    std::vector<size_t> in_degree(n_nodes, 0);
+    for (const NodeEntry& node : nodes) {
+      ForEachChild(node, [&](size_t i) { ++in_degree[i]; });
+    }
+    for (size_t i = 0; i < n_nodes; ++i) {
+      if (in_degree[i] == 0) {
+        topo_order.push_back(i);
+      }
+    }
+    for (size_t p = 0; p < topo_order.size(); ++p) {
+      ForEachChild(nodes[topo_order[p]], [&](size_t i) {
+        if (--in_degree[i] == 0) {
+          topo_order.push_back(i);
+        }
+      });
+    }
+    ICHECK_EQ(topo_order.size(), n_nodes) << "Cyclic reference detected in binary graph";
+    std::reverse(std::begin(topo_order), std::end(topo_order));
+    return topo_order;
+  }
+};
+
+}  // namespace binary
+
+// Helper class to write the nodes in the binary format using the existing index.
+class BinaryAttrGetter : public AttrVisitor {
+ public:
+  const std::unordered_map<Object*, size_t>* node_index_;
+  const std::unordered_map<DLTensor*, size_t>* tensor_index_;
+  binary::StringTable* strings_;
+  ReflectionVTable* reflection_ = ReflectionVTable::Global();
+
+  void Visit(const char* key, double* value) final {
+    BeginField(key, binary::kDouble);
+    fields_.WritePOD(*value);
+  }
+  void Visit(const char* key, int64_t* value) final {
+    BeginField(key, binary::kInt64);
+    fields_.WriteVarint(binary::ZigZagEncode(*value));
+  }
+  void Visit(const char* key, uint64_t* value) final {
+    BeginField(key, binary::kUInt64);
+    fields_.WriteVarint(*value);
+  }
+  void Visit(const char* key, int* value) final {
+    BeginField(key, binary::kInt);
+    fields_.WriteVarint(binary::ZigZagEncode(*value));
+  }
+  void Visit(const char* key, bool* value) final {
+    BeginField(key, binary::kBool);
+    fields_.WriteByte(*value);
+  }
+  void Visit(const char* key, std::string* value) final {
+    BeginField(key, binary::kString);
+    fields_.WriteVarint(strings_->Add(*value));
+  }
+  void Visit(const char* key, void** value) final {
+    LOG(FATAL) << "not allowed to serialize a pointer";
+  }
+  void Visit(const char* key, DataType* value) final {
+    DLDataType dtype = *value;
+    BeginField(key, binary::kDataType);
+    fields_.WriteByte(dtype.code);
+    fields_.WriteByte(dtype.bits);
+    fields_.WriteVarint(dtype.lanes);
+  }
+  void Visit(const char* key, runtime::NDArray* value) final {
+    BeginField(key, binary::kNDArray);
+    fields_.WriteVarint(tensor_index_->at(const_cast<DLTensor*>((*value).operator->())));
+  }
+  void Visit(const char* key, ObjectRef* value) final {
+    BeginField(key, binary::kObjectRef);
+    fields_.WriteVarint(node_index_->at(const_cast<Object*>(value->get())));
+  }
+
+  // Write the node
+  void Get(Object* node, binary::Writer* out) {
+    if (node == nullptr) {
+      out->WriteVarint(0);
+      return;
+    }
+    out->WriteVarint(strings_->Add(node->GetTypeKey()) + 1);
+    std::string repr_bytes;
+    if (reflection_->GetReprBytes(node, &repr_bytes)) {
+      out->WriteByte(binary::kRepr);
+      out->WriteVarint(strings_->Add(repr_bytes));
+    } else if (node->IsInstance<ArrayNode>()) {
+      ArrayNode* n = static_cast<ArrayNode*>(node);
+      out->WriteByte(binary::kArray);
+      out->WriteVarint(n->size());
+      for (const ObjectRef& v : *n) {
+        out->WriteVarint(node_index_->at(const_cast<Object*>(v.get())));
+      }
+    } else if (node->IsInstance<MapNode>()) {
+      MapNode* n = static_cast<MapNode*>(node);
+      bool is_str_map = std::all_of(n->begin(), n->end(), [](const auto& v) {
+        return v.first->template IsInstance<StringObj>();
+      });
+      out->WriteByte(is_str_map ? binary::kStrMap : binary::kMap);
+      out->WriteVarint(n->size());
+      for (const auto& kv : *n) {
+        if (is_str_map) {
+          out->WriteVarint(strings_->Add(Downcast<String>(kv.first)));
+        } else {
+          out->WriteVarint(node_index_->at(const_cast<Object*>(kv.first.get())));
+        }
+        out->WriteVarint(node_index_->at(const_cast<Object*>(kv.second.get())));
+      }
+    } else {
+      fields_.buffer()->clear();
+      num_fields_ = 0;
+      reflection_->VisitAttrs(node, this);
+      out->WriteByte(binary::kObject);
+      out->WriteVarint(num_fields_);
+      out->WriteBytes(fields_.buffer()->data(), fields_.buffer()->size());
+    }
+  }
+
+ private:
+  void BeginField(const char* key, binary::FieldTag tag) {
+    fields_.WriteVarint(strings_->Add(key));
+    fields_.WriteByte(tag);
+    ++num_fields_;
+  }
+
+  binary::Writer fields_;
+  size_t num_fields_{0};
+};
+
+// Helper class to set the attributes of a node from the binary graph.
+class BinaryAttrSetter : public AttrVisitor {
+ public:
+  const std::vector<ObjectPtr<Object>>* node_list_;
+  const std::vector<runtime::NDArray>* tensor_list_;
+  const binary::Graph* graph_;
+
+  void Visit(const char* key, double* value) final {
+    uint64_t bits = GetField(key, binary::kDouble);
+    std::memcpy(value, &bits, sizeof(double));
+  }
+  void Visit(const char* key, int64_t* value) final {
+    *value = binary::ZigZagDecode(GetField(key, binary::kInt64));
+  }
+  void Visit(const char* key, uint64_t* value) final {
+    *value = GetField(key, binary::kUInt64);
+  }
+  void Visit(const char* key, int* value) final {
+    *value = static_cast<int>(binary::ZigZagDecode(GetField(key, binary::kInt)));
+  }
+  void Visit(const char* key, bool* value) final { *value = GetField(key, binary::kBool) != 0; }
+  void Visit(const char* key, std::string* value) final {
+    *value = std::string(graph_->strings[GetField(key, binary::kString)]);
+  }
+  void Visit(const char* key, void** value) final {
+    LOG(FATAL) << "not allowed to deserialize a pointer";
+  }
+  void Visit(const char* key, DataType* value) final {
+    uint64_t packed = GetField(key, binary::kDataType);
+    DLDataType dtype;
+    dtype.code = static_cast<uint8_t>(packed & 0xFF);
+    dtype.bits = static_cast<uint8_t>((packed >> 8) & 0xFF);
+    dtype.lanes = static_cast<uint16_t>(packed >> 16);
+    *value = DataType(dtype);
+  }
+  void Visit(const char* key, runtime::NDArray* value) final {
+    *value = tensor_list_->at(GetField(key, binary::kNDArray));
+  }
+  void Visit(const char* key, ObjectRef* value) final {
+    *value = ObjectRef(node_list_->at(GetField(key, binary::kObjectRef)));
+  }
+
+  // set the values of the node
+  void Set(ObjectPtr<Object>* node, const binary::NodeEntry& bnode) {
+    // Skip None and the objects that have their own string repr
+    if (node->get() == nullptr || bnode.kind == binary::kRepr) {
+      return;
+    }
+    if (bnode.kind == binary::kArray) {
+      std::vector<ObjectRef> container;
+      container.reserve(bnode.end - bnode.begin);
+      for (uint32_t i = bnode.begin; i < bnode.end; ++i) {
+        container.push_back(ObjectRef(node_list_->at(graph_->data[i])));
+      }
+      Array<ObjectRef> array(container);
+      *node = runtime::ObjectInternal::MoveObjectPtr(&array);
+      return;
+    }
+    if (bnode.kind == binary::kStrMap || bnode.kind == binary::kMap) {
+      std::unordered_map<ObjectRef, ObjectRef, ObjectHash, ObjectEqual> container;
+      for (uint32_t i = bnode.begin; i < bnode.end; i += 2) {
+        ObjectRef key = bnode.kind == binary::kStrMap
+                            ? String(std::string(graph_->strings[graph_->data[i]]))
+                            : ObjectRef(node_list_->at(graph_->data[i]));
+        container[key] = ObjectRef(node_list_->at(graph_->data[i + 1]));
+      }
+      Map<ObjectRef, ObjectRef> map(container);
+      *node = runtime::ObjectInternal::MoveObjectPtr(&map);
+      return;
+    }
+    bnode_ = &bnode;
+    cursor_ = bnode.begin;
+    reflection_->VisitAttrs(node->get(), this);
+  }
+
+ private:
+  // The fields are usually visited in the order they were saved, try the next one first
+  uint64_t GetField(const char* key, binary::FieldTag tag) {
+    const std::vector<binary::FieldEntry>& fields = graph_->fields;
+    uint32_t i = cursor_;
+    if (i >= bnode_->end || graph_->strings[fields[i].key] != key) {
+      for (i = bnode_->begin; i < bnode_->end; ++i) {
+        if (graph_->strings[fields[i].key] == key) break;
+      }
+    }
+    if (i == bnode_->end) {
+      LOG(FATAL) << "BinaryReader: cannot find field " << key;
+    }
+    ICHECK(fields[i].tag == tag) << "BinaryReader: wrong value type for field " << key;
+    cursor_ = i + 1;
+    return fields[i].value;
+  }
+
+  const binary::NodeEntry* bnode_{nullptr};
+  uint32_t cursor_{0};
+  ReflectionVTable* reflection_ = ReflectionVTable::Global();
+};
+
+std::string SaveBinary(const ObjectRef& n) {
+  NodeIndexer indexer;
+  indexer.MakeIndex(const_cast<Object*>(n.get()));
+  binary::StringTable strings;
+  binary::Writer body;
+  {
+    BinaryAttrGetter getter;
+    getter.node_index_ = &indexer.node_index_;
+    getter.tensor_index_ = &indexer.tensor_index_;
+    getter.strings_ = &strings;
+    body.WriteVarint(indexer.node_list_.size());
+    for (Object* node : indexer.node_list_) {
+      getter.Get(node, &body);
+    }
+  }
+  // the tensors are stored raw, without the base64 of the json format
+  body.WriteVarint(indexer.tensor_list_.size());
+  for (DLTensor* tensor : indexer.tensor_list_) {
+    std::string blob;
+    dmlc::MemoryStringStream mstrm(&blob);
+    runtime::SaveDLTensor(&mstrm, tensor);
+    body.WriteVarint(blob.size());
+    body.WriteBytes(blob.data(), blob.size());
+  }
+  size_t version = strings.Add(TVM_VERSION);
+  binary::Writer out;
+  out.WriteBytes(binary::kMagic, sizeof(binary::kMagic));
+  out.WritePOD(binary::kVersion);
+  out.WriteVarint(strings.strings().size());
+  for (const std::string* str : strings.strings()) {
+    out.WriteVarint(str->size());
+    out.WriteBytes(str->data(), str->size());
+  }
+  out.WriteVarint(version);
+  out.WriteVarint(indexer.node_index_.at(const_cast<Object*>(n.get())));
+  out.WriteBytes(body.buffer()->data(), body.buffer()->size());
+  return std::move(*out.buffer());
+}
+
+ObjectRef LoadBinary(const char* data, size_t size) {
+  ReflectionVTable* reflection = ReflectionVTable::Global();
+  binary::Graph graph;
+  {
+    binary::Reader reader(data, size);
+    graph.Load(&reader);
+  }
+  size_t n_nodes = graph.nodes.size();
+  std::vector<runtime::NDArray> tensors;
+  tensors.reserve(graph.tensors.size());
+  for (const std::string_view& blob : graph.tensors) {
+    dmlc::MemoryFixedSizeStream strm(const_cast<char*>(blob.data()), blob.size());
+    runtime::NDArray temp;
+    ICHECK(temp.Load(&strm));
+    tensors.emplace_back(std::move(temp));
+  }
+  // Pass 1: create all non-container objects
+  std::vector<ObjectPtr<Object>> nodes(n_nodes, nullptr);
+  for (size_t i = 0; i < n_nodes; ++i) {
+    const binary::NodeEntry& bnode = graph.nodes[i];
+    if (bnode.type_key != 0) {
+      std::string repr_bytes;
+      if (bnode.kind == binary::kRepr) {
+        repr_bytes = std::string(graph.strings[bnode.repr]);
+      }
+      nodes[i] =
+          reflection->CreateInitObject(std::string(graph.strings[bnode.type_key - 1]), repr_bytes);
+    }
+  }
+  // Pass 2: topo sort, the field dependencies are tagged in the blob
+  std::vector<size_t> topo_order = graph.TopoSort();
+  // Pass 3: set all values
+  {
+    BinaryAttrSetter setter;
+    setter.node_list_ = &nodes;
+    setter.tensor_list_ = &tensors;
+    setter.graph_ = &graph;
+    for (size_t i : topo_order) {
+      setter.Set(&nodes[i], graph.nodes[i]);
+    }
+  }
+  return ObjectRef(nodes.at(graph.root));
+}
+
 TVM_REGISTER_GLOBAL("node.SaveJSON").set_body_typed(SaveJSON);
 
 TVM_REGISTER_GLOBAL("node.LoadJSON").set_body_typed(LoadJSON);
+
+TVM_REGISTER_GLOBAL("node.SaveBinary").set_body_typed([](const ObjectRef& node) {
+  std::string blob = SaveBinary(node);
+  // copy return array so it is owned by the ret value
+  TVMRetValue rv;
+  rv = TVMByteArray{blob.data(), blob.size()};
+  return rv;
+});
+
+TVM_REGISTER_GLOBAL("node.LoadBinary").set_body([](TVMArgs args, TVMRetValue* rv) {
+  if (args[0].type_code() == kTVMBytes) {
+    const TVMByteArray* arr = static_cast<const TVMByteArray*>(args[0].value().v_handle);
+    *rv = LoadBinary(arr->data, arr->size);
+  } else {
+    std::string blob = args[0];
+    *rv = LoadBinary(blob);
+  }
+});
 }  // namespace tvm
@@ -20,6 +20,7 @@
  * \file src/node/structural_hash.cc
  */
 #include <dmlc/memory_io.h>
+#include <tvm/ir/expr.h>
 #include <tvm/node/functor.h>
 #include <tvm/node/node.h>
 #include <tvm/node/object_path.h>
@@ -31,6 +32,10 @@
 #include <tvm/target/codegen.h>
 
 #include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <typeinfo>
 #include <unordered_map>
 
 #include "../support/base64.h"
@@ -50,6 +55,101 @@ void ReflectionVTable::SHashReduce(const Object* self, SHashReducer reducer) con
   fshash_reduce_[tindex](self, reducer);
 }
 
+/*!
+ * \brief The process-wide cache of the structural hashes of large subtrees.
+ *
+ * A subtree can be reused when it is closed, i.e. the context dependent hashes it reads (the free
+ * variables mapped by their order and the graph nodes) were all computed inside it. Its hash then
+ * only depends on the counters of free variables and graph nodes when it is entered, unless it
+ * consumes none of them. Each entry keeps the subtree alive, which keeps it immutable since
+ * CopyOnWrite copies shared nodes. It also records the hashes of the mapped free variables and
+ * the graph nodes inside, the only ones that would differ if they were computed again, so that
+ * the later references to the subtree's nodes from outside of it see the same values.
+ *
+ * The nodes mutated in place through a unique reference rather than copied (IRModule, whose
+ * functions are added and updated in place) are never cached, nor the subtrees containing them.
+ */
+class SHashCache {
+ public:
+  struct Entry {
+    bool map_free_vars;
+    /*! \brief Whether the hash does not depend on the counters when the subtree is entered. */
+    bool pure;
+    uint32_t free_var_start;
+    uint32_t graph_node_start;
+    uint32_t free_var_count;
+    uint32_t graph_node_count;
+    uint64_t hash;
+    /*! \brief The hashes of the mapped free variables and the graph nodes of the subtree. */
+    std::vector<std::pair<ObjectRef, uint64_t>> counted_hashes;
+  };
+
+  /*! \brief The subtrees with less nodes are not cached. */
+  static constexpr uint64_t kMinNodes = 64;
+
+  static SHashCache* Global() {
+    static SHashCache* inst = new SHashCache();
+    return inst;
+  }
+
+  bool enabled() const { return capacity_.load(std::memory_order_relaxed) != 0; }
+
+  /*! \brief Whether the node is of a type mutated in place, whose hashes can't be cached. */
+  static bool IsMutable(const Object* node) {
+    static const uint32_t module_index = Object::TypeKey2Index("IRModule");
+    return node->type_index() == module_index;
+  }
+
+  std::shared_ptr<const Entry> Lookup(const ObjectRef& key, bool map_free_vars,
+                                      uint32_t free_var_counter, uint32_t graph_node_counter) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = table_.find(key);
+    if (it != table_.end()) {
+      for (const auto& entry : it->second) {
+        if (entry->map_free_vars == map_free_vars &&
+            (entry->pure || (entry->free_var_start == free_var_counter &&
+                             entry->graph_node_start == graph_node_counter))) {
+          ++hits_;
+          return entry;
+        }
+      }
+    }
+    ++misses_;
+    return nullptr;
+  }
+
+  void Insert(const ObjectRef& key, std::shared_ptr<const Entry> entry) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (table_.size() >= capacity_.load(std::memory_order_relaxed)) {
+      table_.clear();
+    }
+    table_[key].push_back(std::move(entry));
+  }
+
+  void SetCapacity(int64_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_.store(capacity > 0 ? capacity : 0, std::memory_order_relaxed);
+    table_.clear();
+  }
+
+  Map<String, Integer> GetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto count = [](int64_t value) { return Integer(IntImm(DataType::Int(64), value)); };
+    return {{"hit", count(hits_)},
+            {"miss", count(misses_)},
+            {"size", count(static_cast<int64_t>(table_.size()))}};
+  }
+
+ private:
+  std::mutex mutex_;
+  std::atomic<size_t> capacity_{0};
+  std::unordered_map<ObjectRef, std::vector<std::shared_ptr<const Entry>>, ObjectPtrHash,
+                     ObjectPtrEqual>
+      table_;
+  int64_t hits_{0};
+  int64_t misses_{0};
+};
+
 // Hash handler that handles free vars
 // by assigning an unique counter in the order of their occurrence.
 //
@@ -77,8 +177,22 @@ class SHashHandlerDefault::Impl {
     bool children_expanded{false};
     /*! \brief Whether the node is graph node. */
     bool graph_node_hash{false};
+    /*! \brief Whether the node is a free variable mapped by the counter. */
+    bool free_var_hash{false};
     /*! \brief whether to map the free variables. */
     bool map_free_vars;
+    /*! \brief The location of the task expanding this one in the task stack. */
+    uint64_t parent_index = std::numeric_limits<uint64_t>::max();
+    /*! \brief Whether the subtree contains a node mutated in place, see SHashCache::IsMutable. */
+    bool mutable_subtree{false};
+    /*! \brief The smallest order of the context dependent hashes read in the subtree. */
+    uint64_t min_dependent_order = std::numeric_limits<uint64_t>::max();
+    /*! \brief The state of the handler when the children were expanded, for the cache. */
+    uint64_t order_start{0};
+    uint64_t node_start{0};
+    uint64_t counted_log_start{0};
+    uint32_t free_var_start{0};
+    uint32_t graph_node_start{0};
 
     Task() = default;
     explicit Task(ObjectRef object, uint64_t reduced_hash, bool map_free_vars)
@@ -94,7 +208,11 @@ class SHashHandlerDefault::Impl {
   bool LookupHashedValue(const ObjectRef& key, uint64_t* hash_value) {
     auto it = hash_memo_.find(key);
     if (it != hash_memo_.end()) {
-      hash_value[0] = it->second;
+      hash_value[0] = it->second.hash;
+      if (it->second.dependent && !task_stack_.empty()) {
+        Task& task = task_stack_.back();
+        task.min_dependent_order = std::min(task.min_dependent_order, it->second.order);
+      }
       return true;
     }
     return false;
@@ -107,6 +225,9 @@ class SHashHandlerDefault::Impl {
   void SHashReduceFreeVar(const runtime::Object* var, bool map_free_vars) {
     ICHECK(!hash_memo_.count(GetRef<ObjectRef>(var)));
     if (map_free_vars) {
+      if (!task_stack_.empty()) {
+        task_stack_.back().free_var_hash = true;
+      }
       // use counter value.
       uint64_t value = std::hash<uint64_t>()(free_var_counter_++);
       pending_tasks_.emplace_back(Task(ObjectRef(nullptr), value, false));
@@ -127,7 +248,11 @@ class SHashHandlerDefault::Impl {
     }
     auto it = hash_memo_.find(object);
     if (it != hash_memo_.end()) {
-      pending_tasks_.emplace_back(Task(ObjectRef(nullptr), it->second, false));
+      pending_tasks_.emplace_back(Task(ObjectRef(nullptr), it->second.hash, false));
+      if (it->second.dependent) {
+        pending_tasks_.back().min_dependent_order = it->second.order;
+      }
+      pending_tasks_.back().mutable_subtree = it->second.mutable_subtree;
     } else {
       // Push a pending task with initial value.
       pending_tasks_.emplace_back(Task(object, object->GetTypeKeyHash(), map_free_vars));
@@ -139,6 +264,10 @@ class SHashHandlerDefault::Impl {
     ICHECK_EQ(pending_tasks_.size(), 0U);
     ICHECK_EQ(result_stack_.size(), 0U);
 
+    // The handlers customizing DispatchSHash may hash differently.
+    use_cache_ =
+        SHashCache::Global()->enabled() && typeid(*parent_) == typeid(SHashHandlerDefault);
+
     this->SHashReduce(object, map_free_vars);
     ICHECK_EQ(pending_tasks_.size(), 1U);
     ICHECK(allow_push_to_stack_);
@@ -159,14 +288,41 @@ class SHashHandlerDefault::Impl {
   }
 
  protected:
+  /*! \brief A memoized hash. */
+  struct MemoEntry {
+    uint64_t hash;
+    /*! \brief The order in which the hashes were memoized. */
+    uint64_t order;
+    /*! \brief Whether the hash depends on the free variable and graph node counters. */
+    bool dependent;
+    /*! \brief Whether the subtree contains a node mutated in place. */
+    bool mutable_subtree;
+  };
+
   /*!
    * \brief Pop the top entry of the task stack and push the hash into the result stack.
    */
   void PopTaskStack() {
     const auto& entry = task_stack_.back();
     result_stack_.push_back(entry.reduced_hash);
+    if (entry.parent_index < task_stack_.size() - 1) {
+      Task& parent = task_stack_[entry.parent_index];
+      parent.min_dependent_order = std::min(parent.min_dependent_order, entry.min_dependent_order);
+      parent.mutable_subtree |= entry.mutable_subtree;
+    }
     task_stack_.pop_back();
   }
+  /*!
+   * \brief Memoize the hash of an object.
+   * \param counted Whether the object is a mapped free variable or a graph node.
+   */
+  void Memoize(const ObjectRef& object, uint64_t hash, bool dependent, bool counted,
+               bool mutable_subtree = false) {
+    hash_memo_[object] = MemoEntry{hash, memo_order_++, dependent, mutable_subtree};
+    if (counted && use_cache_) {
+      counted_log_.emplace_back(object, hash);
+    }
+  }
   /*!
    * \brief Compute the reduced hash value for the task.
    * \param task The indicated task.
@@ -183,6 +339,44 @@ class SHashHandlerDefault::Impl {
     result_stack_.resize(stack_begin);
     return reduced_hash;
   }
+  /*!
+   * \brief Take the hash of the task from the cache.
+   * \return Whether the cache has the hash.
+   */
+  bool LookupCache(Task* task) {
+    auto cached = SHashCache::Global()->Lookup(task->object, task->map_free_vars,
+                                               free_var_counter_, graph_node_counter_);
+    if (cached == nullptr) return false;
+    for (const auto& [object, hash] : cached->counted_hashes) {
+      Memoize(object, hash, true, true);
+    }
+    free_var_counter_ += cached->free_var_count;
+    graph_node_counter_ += cached->graph_node_count;
+    task->reduced_hash = cached->hash;
+    if (!hash_memo_.count(task->object)) {
+      Memoize(task->object, cached->hash, !cached->pure, false);
+    }
+    return true;
+  }
+  /*!
+   * \brief Record the hash of the task in the cache if its subtree is closed and large enough.
+   */
+  void InsertCache(const Task& task, bool dependent) {
+    if (task.mutable_subtree || task.min_dependent_order < task.order_start ||
+        node_counter_ - task.node_start < SHashCache::kMinNodes) {
+      return;
+    }
+    auto entry = std::make_shared<SHashCache::Entry>();
+    entry->map_free_vars = task.map_free_vars;
+    entry->pure = !dependent;
+    entry->free_var_start = task.free_var_start;
+    entry->graph_node_start = task.graph_node_start;
+    entry->free_var_count = free_var_counter_ - task.free_var_start;
+    entry->graph_node_count = graph_node_counter_ - task.graph_node_start;
+    entry->hash = task.reduced_hash;
+    entry->counted_hashes.assign(counted_log_.begin() + task.counted_log_start, counted_log_.end());
+    SHashCache::Global()->Insert(task.object, std::move(entry));
+  }
   // run the tasks.
   void RunTasks() {
     while (task_stack_.size() != 0) {
@@ -196,7 +390,7 @@ class SHashHandlerDefault::Impl {
         auto it = hash_memo_.find(entry.object);
         if (it != hash_memo_.end()) {
           // use the pre-computed hash for the object.
-          entry.reduced_hash = it->second;
+          entry.reduced_hash = it->second.hash;
         } else {
           // Append the graph node counter to the hash
           // so that we can distinguish DAG from trees.
@@ -204,7 +398,14 @@ class SHashHandlerDefault::Impl {
             entry.reduced_hash = support::HashCombine(entry.reduced_hash,
                                                       std::hash<uint64_t>()(graph_node_counter_++));
           }
-          hash_memo_[entry.object] = entry.reduced_hash;
+          bool dependent = free_var_counter_ != entry.free_var_start ||
+                           graph_node_counter_ != entry.graph_node_start ||
+                           entry.min_dependent_order != std::numeric_limits<uint64_t>::max();
+          Memoize(entry.object, entry.reduced_hash, dependent,
+                  entry.graph_node_hash || entry.free_var_hash, entry.mutable_subtree);
+          if (use_cache_) {
+            InsertCache(entry, dependent);
+          }
         }
         // send value to parent.
         this->PopTaskStack();
@@ -215,13 +416,27 @@ class SHashHandlerDefault::Impl {
         // check if there are already hash for object.
         auto it = hash_memo_.find(entry.object);
         if (it != hash_memo_.end()) {
-          entry.reduced_hash = it->second;
+          entry.reduced_hash = it->second.hash;
+          if (it->second.dependent) {
+            entry.min_dependent_order = it->second.order;
+          }
+          entry.mutable_subtree = it->second.mutable_subtree;
+          this->PopTaskStack();
+        } else if (use_cache_ && !SHashCache::IsMutable(entry.object.get()) &&
+                   LookupCache(&entry)) {
           this->PopTaskStack();
         } else {
           // NOTE: important to modify entry before visit.
           // as entry becomes invalid after we change the stack.
           entry.children_expanded = true;
+          entry.mutable_subtree = SHashCache::IsMutable(entry.object.get());
           entry.result_stack_index = result_stack_.size();
+          entry.order_start = memo_order_;
+          entry.node_start = node_counter_++;
+          entry.counted_log_start = counted_log_.size();
+          entry.free_var_start = free_var_counter_;
+          entry.graph_node_start = graph_node_counter_;
+          uint64_t entry_index = task_stack_.size() - 1;
 
           ICHECK_EQ(pending_tasks_.size(), 0U);
           allow_push_to_stack_ = false;
@@ -231,6 +446,7 @@ class SHashHandlerDefault::Impl {
           // Move pending tasks to the stack until the marked point.
           while (pending_tasks_.size() != 0) {
             task_stack_.emplace_back(std::move(pending_tasks_.back()));
+            task_stack_.back().parent_index = entry_index;
             pending_tasks_.pop_back();
           }
         }
@@ -245,18 +461,26 @@ class SHashHandlerDefault::Impl {
   uint32_t free_var_counter_{0};
   // graph node counter.
   uint32_t graph_node_counter_{0};
+  // expanded node counter.
+  uint64_t node_counter_{0};
+  // the order of the next memoized hash.
+  uint64_t memo_order_{0};
   // record current stack top
   bool allow_push_to_stack_{true};
+  // whether to use the hash cache of the subtrees.
+  bool use_cache_{false};
   // list of pending tasks to be pushed to the stack.
   std::vector<Task> pending_tasks_;
   // Internal task stack to executed the task
   std::vector<Task> task_stack_;
   // Internal stack to store the result popped from the task stack.
   std::vector<uint64_t> result_stack_;
+  // the hashes of the mapped free variables and graph nodes, when the cache is used.
+  std::vector<std::pair<ObjectRef, uint64_t>> counted_log_;
   // reflection vtable
   ReflectionVTable* vtable_ = ReflectionVTable::Global();
   // map from lhs to rhs
-  std::unordered_map<ObjectRef, uint64_t, ObjectPtrHash, ObjectPtrEqual> hash_memo_;
+  std::unordered_map<ObjectRef, MemoEntry, ObjectPtrHash, ObjectPtrEqual> hash_memo_;
 };
 
 SHashHandlerDefault::SHashHandlerDefault() { impl = new Impl(this); }
@@ -298,6 +522,16 @@ uint64_t StructuralHash::operator()(const ObjectRef& object) const {
   return SHashHandlerDefault().Hash(object, false);
 }
 
+void SetStructuralHashCacheSize(int64_t max_entries) {
+  SHashCache::Global()->SetCapacity(max_entries);
+}
+
+TVM_REGISTER_GLOBAL("node.SetStructuralHashCacheSize").set_body_typed(SetStructuralHashCacheSize);
+
+TVM_REGISTER_GLOBAL("node.GetStructuralHashCacheStats").set_body_typed([]() {
+  return SHashCache::Global()->GetStats();
+});
+
 // SEQualReduce traits for runtime containers.
 struct StringObjTrait {
   static constexpr const std::nullptr_t VisitAttrs = nullptr;
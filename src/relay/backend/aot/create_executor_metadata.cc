@@ -60,6 +60,10 @@ ExecutorCodegenMetadata CreateExecutorMetadata(const IRModule& mod, String mod_n
   Map<String, tir::usmp::PoolAllocation> io_pool_allocations =
       mod->GetAttr<Map<String, tir::usmp::PoolAllocation>>(tvm::attr::kIOTensorPoolAllocations)
           .value_or({});
+  Map<tir::usmp::BufferInfo, tir::usmp::PoolAllocation> arena_buffer_allocations =
+      mod->GetAttr<Map<tir::usmp::BufferInfo, tir::usmp::PoolAllocation>>(
+             tvm::attr::kArenaBufferAllocations)
+          .value_or({});
 
   Array<tir::Var> outputs = tir_main_func->GetAttr<Array<tir::Var>>("output_vars").value();
   Array<TensorType> output_tensor_types;
@@ -74,7 +78,8 @@ ExecutorCodegenMetadata CreateExecutorMetadata(const IRModule& mod, String mod_n
   return ExecutorCodegenMetadata(inputs, input_tensor_types, output_var_names, output_tensor_types,
                                  pool_vars, devices, runtime::kTvmExecutorAot, mod_name,
                                  interface_api, unpacked_api, workspace_byte_alignment,
-                                 constant_byte_alignment, pool_var_info, io_pool_allocations);
+                                 constant_byte_alignment, pool_var_info, io_pool_allocations,
+                                 arena_buffer_allocations);
 }
 
 TVM_REGISTER_GLOBAL("relay.backend.aot.CreateExecutorMetadata")
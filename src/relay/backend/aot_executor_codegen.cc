@@ -36,6 +36,7 @@
 #include <tvm/tir/expr.h>
 #include <tvm/tir/function.h>
 #include <tvm/tir/stmt.h>
+#include <tvm/tir/stmt_functor.h>
 #include <tvm/tir/transform.h>
 #include <tvm/tir/usmp/utils.h>
 
@@ -979,6 +980,33 @@ class AOTExecutorCodegen : public MixedModeVisitor {
     return lowered_mod;
   }
 
+  /*!
+   * \brief Check that USMP placed every workspace buffer of the lowered IRModule in a pool, so
+   * that the generated code calls no TVMBackendAllocWorkspace and no runtime allocator is needed.
+   * The buffers small enough for LowerTVMBuiltin to put on the stack are allowed.
+   */
+  void CheckStaticArena(const IRModule& mod) {
+    for (const auto& kv : mod->functions) {
+      const auto* prim_func = kv.second.as<tir::PrimFuncNode>();
+      if (prim_func == nullptr) continue;
+      tir::PostOrderVisit(prim_func->body, [&](const ObjectRef& node) {
+        const auto* op = node.as<tir::AllocateNode>();
+        if (op == nullptr || tir::GetPtrStorageScope(op->buffer_var) != "global") return;
+        if (op->annotations.count(tir::transform::kDisableLowerTVMBuiltin) &&
+            Downcast<Bool>(op->annotations[tir::transform::kDisableLowerTVMBuiltin])) {
+          return;
+        }
+        int64_t nbytes = op->dtype.bytes() * op->dtype.lanes();
+        int64_t constant_size = op->ConstantAllocationSize();
+        LOG_IF(FATAL, constant_size == 0 || constant_size * nbytes >= runtime::kMaxStackAlloca)
+            << kUSMPStaticArenaOption << ": the buffer " << op->buffer_var->name_hint << " of "
+            << kv.first->name_hint << " is not planned in a pool and would be allocated by "
+            << "TVMBackendAllocWorkspace at runtime. USMP only plans the buffers of constant "
+            << "size allocated outside of the parallel loops.";
+      });
+    }
+  }
+
   /*!
    * \brief Run StorageRewrite to plan memory for lowered IRModule.
    */
@@ -1270,9 +1298,19 @@ class AOTExecutorCodegen : public MixedModeVisitor {
     if (pass_ctx->GetConfig<Bool>(kUSMPEnableOption) != nullptr) {
       enable_usmp = pass_ctx->GetConfig<Bool>(kUSMPEnableOption, Bool(false)).value();
     }
+    bool static_arena = pass_ctx->GetConfig<Bool>(kUSMPStaticArenaOption, Bool(false)).value();
+    if (static_arena) {
+      CHECK(enable_usmp || pass_ctx->GetConfig<Bool>(kUSMPEnableOption) == nullptr)
+          << kUSMPStaticArenaOption << " plans the workspace with USMP, it needs "
+          << kUSMPEnableOption;
+      enable_usmp = true;
+    }
 
     if (enable_usmp) {
       lowered_mod = PlanMemoryWithUSMP(lowered_mod);
+      if (static_arena) {
+        CheckStaticArena(lowered_mod);
+      }
     } else {
       lowered_mod = PlanMemoryWithStorageRewrite(lowered_mod);
     }
@@ -1318,6 +1356,11 @@ class AOTExecutorCodegen : public MixedModeVisitor {
         lowered_mod
             ->GetAttr<Map<String, tir::usmp::PoolAllocation>>(tvm::attr::kIOTensorPoolAllocations)
             .value_or({});
+    Map<tir::usmp::BufferInfo, tir::usmp::PoolAllocation> arena_buffer_allocations =
+        lowered_mod
+            ->GetAttr<Map<tir::usmp::BufferInfo, tir::usmp::PoolAllocation>>(
+                tvm::attr::kArenaBufferAllocations)
+            .value_or({});
 
     std::vector<String> output_var_names;
     if (auto opt = func->GetAttr<Array<String>>("output_tensor_names")) {
@@ -1344,7 +1387,7 @@ class AOTExecutorCodegen : public MixedModeVisitor {
         inputs, input_tensor_types, output_var_names, output_tensor_types, pool_vars, devices,
         runtime::kTvmExecutorAot, mod_name, interface_api, unpacked_api,
         GetModuleWorkspaceByteAlignment(mod), GetModuleConstantByteAlignment(mod), pool_var_info,
-        io_pool_allocations);
+        io_pool_allocations, arena_buffer_allocations);
     return ret;
   }
 
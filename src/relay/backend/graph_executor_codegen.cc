@@ -49,6 +49,7 @@ namespace relay {
 
 // TODO(@jroesch, @csullivan): declare directly elsewhere
 backend::StaticMemoryPlan GraphPlanMemory(const Function& func);
+Function ReorderForMemory(const Function& func);
 
 namespace backend {
 
@@ -237,6 +238,12 @@ class GraphExecutorCodegen : public backend::MemoizedExprTranslator<std::vector<
     function_metadata_.Set(runtime::symbol::tvm_module_main, main_func_info.value());
 
     Function lowered_main_func = Downcast<Function>(lowered_mod->Lookup("main"));
+    if (transform::PassContext::Current()
+            ->GetConfig<Bool>("relay.backend.reorder_for_memory", Bool(false))
+            .value()) {
+      // The planner and the graph follow the let order, so pick one with a lower peak memory.
+      lowered_main_func = ReorderForMemory(lowered_main_func);
+    }
 
     // Now that we have lowered all operators to TIR code, we can proceed with compilation.
     //
@@ -51,6 +51,8 @@ using backend::StaticMemoryPlan;
 using backend::StorageInfo;
 using IntegerArray = Array<Integer>;
 
+TVM_REGISTER_PASS_CONFIG_OPTION("relay.backend.disable_inplace_planning", Bool);
+
 class StorageAllocaBaseVisitor : public transform::DeviceAwareExprVisitor {
  public:
   StorageAllocaBaseVisitor() : transform::DeviceAwareExprVisitor(Optional<IRModule>()) {}
@@ -211,7 +213,10 @@ class StorageAllocaInit : protected StorageAllocaBaseVisitor {
 /*! \brief Associate storage with every expression, reusing storage where possible. */
 class StorageAllocator : public StorageAllocaBaseVisitor {
  public:
-  StorageAllocator() = default;
+  StorageAllocator()
+      : inplace_(!transform::PassContext::Current()
+                      ->GetConfig<Bool>("relay.backend.disable_inplace_planning", Bool(false))
+                      .value()) {}
 
   /*!
    * \return total number of bytes allocated
@@ -339,6 +344,8 @@ class StorageAllocator : public StorageAllocaBaseVisitor {
     if (call_lowered_props.lowered_func.defined() && IsReshapeOnly(call_lowered_props)) {
       ICHECK_EQ(call_lowered_props.arguments.size(), 1U);
       ReuseInputToken(call_node, args[0]);
+    } else if (StorageToken* input_token = FindInplaceInput(call_node, call_lowered_props)) {
+      ReuseInputToken(call_node, input_token);
     } else {
       // create token for the call node.
       CreateToken(call_node, true);
@@ -354,6 +361,30 @@ class StorageAllocator : public StorageAllocaBaseVisitor {
     }
   }
 
+  /*!
+   * \brief The input of an elementwise call whose storage the output can be written over: an
+   * input of the type of the output in flat memory, and this call its last use (its reference
+   * counter is 1, the params, the constants and the outputs of the function hold an extra one).
+   */
+  StorageToken* FindInplaceInput(const CallNode* call_node, const CallLoweredProps& props) {
+    if (!inplace_ || !props.lowered_func.defined() || !IsInplaceSafe(props)) return nullptr;
+    auto it = prototype_.find(call_node);
+    ICHECK(it != prototype_.end());
+    if (it->second.size() != 1U || TokenAllocator::Is2DStorage(it->second[0])) return nullptr;
+    StorageToken* prototype = it->second[0];
+    for (const Expr& arg : props.arguments) {
+      const auto& tokens = GetToken(arg);
+      if (tokens.size() != 1U) continue;
+      StorageToken* tok = tokens[0];
+      if (tok->ref_counter == 1 && tok->virtual_device == prototype->virtual_device &&
+          !TokenAllocator::Is2DStorage(tok) &&
+          StructuralEqual()(IgnoreOnDevice(arg)->checked_type(), call_node->checked_type())) {
+        return tok;
+      }
+    }
+    return nullptr;
+  }
+
   class TokenAllocator {
    public:
     StorageToken* Alloc(StorageToken* proto) {
@@ -399,6 +430,8 @@ class StorageAllocator : public StorageAllocaBaseVisitor {
   std::unordered_map<const ExprNode*, std::vector<StorageToken*>> prototype_;
   /*! \brief token allocator for optimizing 1d and 2d token alloc requests */
   TokenAllocator allocator_;
+  /*! \brief whether the outputs of the elementwise calls may be written over their inputs */
+  bool inplace_;
 };
 
 StaticMemoryPlan GraphPlanMemory(const Function& func) { return StorageAllocator().Plan(func); }
@@ -0,0 +1,277 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file relay/backend/memory_order.cc
+ * \brief Reorder the operators of a dataflow function to lower its peak activation memory.
+ *
+ * The memory planners allocate the storage in the order the calls are evaluated, which for a
+ * dataflow function is the post-order of its body. Here the calls are instead bound to lets in an
+ * order picked greedily, out of the ready calls, by the bytes it allocates minus the bytes it
+ * frees. The peak of both orders is estimated from the liveness of the let-bound vars and the
+ * reordered function is only returned when its peak is lower.
+ */
+
+#include <tvm/ir/transform.h>
+#include <tvm/relay/expr_functor.h>
+#include <tvm/runtime/registry.h>
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "../op/annotation/annotation.h"
+#include "./liveness_analysis.h"
+#include "./utils.h"
+
+namespace tvm {
+namespace relay {
+
+TVM_REGISTER_PASS_CONFIG_OPTION("relay.backend.reorder_for_memory", Bool);
+
+namespace {
+
+/*! \brief Returns whether all the tensors of \p type have a static shape. */
+bool IsStaticType(const Type& type) {
+  if (const auto* tuple_type = type.as<TupleTypeNode>()) {
+    return std::all_of(tuple_type->fields.begin(), tuple_type->fields.end(), IsStaticType);
+  }
+  const auto* tensor_type = type.as<TensorTypeNode>();
+  if (tensor_type == nullptr) return false;
+  return std::all_of(tensor_type->shape.begin(), tensor_type->shape.end(),
+                     [](const PrimExpr& dim) { return dim->IsInstance<IntImmNode>(); });
+}
+
+/*!
+ * \brief The calls of a dataflow function, in post-order, with the calls each of them reads.
+ * Tuples, projections and "on_device" annotations allocate nothing and are looked through.
+ */
+class CallGraph : public ExprVisitor {
+ public:
+  /*! \brief Returns false if \p func has control flow, nested functions or dynamic shapes. */
+  bool Build(const Function& func) {
+    VisitExpr(func->body);
+    if (!supported_) return false;
+    for (const CallNode* call : calls_) {
+      int64_t bytes = backend::CalculateRelayExprSizeBytes(call->checked_type());
+      bytes_.push_back(bytes);
+    }
+    inputs_.resize(calls_.size());
+    for (size_t i = 0; i < calls_.size(); ++i) {
+      std::unordered_set<size_t> seen;
+      for (const Expr& arg : calls_[i]->args) Producers(arg, &seen);
+      inputs_[i].assign(seen.begin(), seen.end());
+      std::sort(inputs_[i].begin(), inputs_[i].end());
+    }
+    std::unordered_set<size_t> outputs;
+    Producers(func->body, &outputs);
+    is_output_.assign(calls_.size(), false);
+    for (size_t i : outputs) is_output_[i] = true;
+    return true;
+  }
+
+  /*!
+   * \brief Picks a topological order of the calls, preferring at each step the ready call that
+   * grows the live bytes the least. Ties keep the post-order.
+   */
+  std::vector<size_t> MemoryAwareOrder() const {
+    size_t n = calls_.size();
+    std::vector<std::vector<size_t>> users(n);
+    std::vector<size_t> pending_inputs(n);
+    for (size_t i = 0; i < n; ++i) {
+      pending_inputs[i] = inputs_[i].size();
+      for (size_t p : inputs_[i]) users[p].push_back(i);
+    }
+    std::vector<size_t> pending_users(n);
+    for (size_t i = 0; i < n; ++i) pending_users[i] = users[i].size();
+
+    std::vector<size_t> ready;
+    for (size_t i = 0; i < n; ++i) {
+      if (pending_inputs[i] == 0) ready.push_back(i);
+    }
+    std::vector<size_t> order;
+    order.reserve(n);
+    while (!ready.empty()) {
+      size_t best = 0;
+      int64_t best_delta = 0;
+      for (size_t k = 0; k < ready.size(); ++k) {
+        size_t i = ready[k];
+        int64_t delta = bytes_[i];
+        for (size_t p : inputs_[i]) {
+          if (pending_users[p] == 1 && !is_output_[p]) delta -= bytes_[p];
+        }
+        if (k == 0 || delta < best_delta || (delta == best_delta && i < ready[best])) {
+          best = k;
+          best_delta = delta;
+        }
+      }
+      size_t i = ready[best];
+      ready.erase(ready.begin() + best);
+      order.push_back(i);
+      for (size_t p : inputs_[i]) --pending_users[p];
+      for (size_t u : users[i]) {
+        if (--pending_inputs[u] == 0) ready.push_back(u);
+      }
+    }
+    ICHECK_EQ(order.size(), n);
+    return order;
+  }
+
+  /*! \brief Rebinds the calls of \p func to a sequence of lets evaluated in \p order. */
+  Function BindInOrder(const Function& func, const std::vector<size_t>& order) const {
+    Binder binder;
+    std::vector<std::pair<Var, Expr>> bindings;
+    for (size_t i : order) {
+      const CallNode* call = calls_[i];
+      Expr value = binder.Rebuild(call);
+      Var var("x" + std::to_string(bindings.size()), call->checked_type());
+      var->checked_type_ = call->checked_type();
+      binder.Bind(call, var);
+      bindings.emplace_back(var, value);
+    }
+    Expr body = binder.VisitExpr(func->body);
+    Type body_type = func->body->checked_type();
+    for (auto it = bindings.rbegin(); it != bindings.rend(); ++it) {
+      body = Let(it->first, it->second, body);
+      body->checked_type_ = body_type;
+    }
+    return WithFields(func, func->params, body);
+  }
+
+  /*! \brief The number of calls. */
+  size_t size() const { return calls_.size(); }
+
+ private:
+  /*! \brief Substitutes the let-bound vars for the calls already bound. */
+  class Binder : public ExprMutator {
+   public:
+    Expr Rebuild(const CallNode* call) { return ExprMutator::VisitExpr_(call); }
+    void Bind(const CallNode* call, const Var& var) { bound_[call] = var; }
+
+    Expr VisitExpr_(const CallNode* call) final {
+      auto it = bound_.find(call);
+      if (it != bound_.end()) return it->second;
+      return ExprMutator::VisitExpr_(call);
+    }
+
+   private:
+    std::unordered_map<const CallNode*, Var> bound_;
+  };
+
+  void VisitExpr_(const CallNode* call) final {
+    ExprVisitor::VisitExpr_(call);
+    OnDeviceProps props = GetOnDeviceProps(call);
+    if (props.body.defined()) {
+      // An annotated call would lose its device once bound to a var.
+      if (props.body->IsInstance<CallNode>()) supported_ = false;
+      return;
+    }
+    if (!IsStaticType(call->checked_type())) supported_ = false;
+    index_[call] = calls_.size();
+    calls_.push_back(call);
+  }
+
+  void VisitExpr_(const LetNode* op) final { supported_ = false; }
+  void VisitExpr_(const IfNode* op) final { supported_ = false; }
+  void VisitExpr_(const MatchNode* op) final { supported_ = false; }
+  void VisitExpr_(const FunctionNode* op) final { supported_ = false; }
+
+  /*! \brief Collects the calls whose results \p expr reads. */
+  void Producers(const Expr& expr, std::unordered_set<size_t>* producers) const {
+    if (const auto* call = expr.as<CallNode>()) {
+      auto it = index_.find(call);
+      if (it != index_.end()) {
+        producers->insert(it->second);
+        return;
+      }
+      for (const Expr& arg : call->args) Producers(arg, producers);
+    } else if (const auto* tuple = expr.as<TupleNode>()) {
+      for (const Expr& field : tuple->fields) Producers(field, producers);
+    } else if (const auto* get = expr.as<TupleGetItemNode>()) {
+      Producers(get->tuple, producers);
+    }
+  }
+
+  bool supported_{true};
+  std::vector<const CallNode*> calls_;
+  std::unordered_map<const CallNode*, size_t> index_;
+  std::vector<int64_t> bytes_;
+  std::vector<std::vector<size_t>> inputs_;
+  std::vector<bool> is_output_;
+};
+
+}  // namespace
+
+/*!
+ * \brief Estimates the peak bytes held by the let-bound vars of \p func, from their liveness.
+ * The parameters are not counted.
+ */
+int64_t EstimatePeakActivationBytes(const Function& func) {
+  support::Arena arena;
+  transform::ControlFlowGraph cfg = transform::ControlFlowGraph::Create(&arena, func);
+  transform::UseDefAnalysis use_def = transform::UseDefAnalysis::Analyze(cfg);
+  transform::LivenessAnalysis liveness = transform::LivenessAnalysis::Analyze(cfg, use_def);
+
+  std::unordered_set<const VarNode*> params;
+  for (const Var& param : func->params) params.insert(param.get());
+  int64_t peak = 0;
+  for (const auto& node : cfg.reverse_post_order) {
+    transform::VarSet live = liveness.live_in.at(node);
+    const Var& def = use_def.def.at(node);
+    if (def.defined()) live.insert(def);
+    int64_t bytes = 0;
+    for (const Var& var : live) {
+      if (params.count(var.get())) continue;
+      bytes += backend::CalculateRelayExprSizeBytes(var->checked_type());
+    }
+    peak = std::max(peak, bytes);
+  }
+  return peak;
+}
+
+/*!
+ * \brief Binds the calls of the dataflow function \p func to lets, in a topological order that
+ * lowers its peak activation memory. \p func is returned unchanged when it is not a pure dataflow
+ * function with static shapes.
+ */
+Function ReorderForMemory(const Function& func) {
+  CallGraph graph;
+  if (!graph.Build(func)) {
+    VLOG(1) << "not reordering for memory, the function is not a static dataflow graph";
+    return func;
+  }
+  std::vector<size_t> post_order(graph.size());
+  for (size_t i = 0; i < post_order.size(); ++i) post_order[i] = i;
+  Function reordered = graph.BindInOrder(func, graph.MemoryAwareOrder());
+  int64_t before = EstimatePeakActivationBytes(graph.BindInOrder(func, post_order));
+  int64_t after = EstimatePeakActivationBytes(reordered);
+  VLOG(1) << "Peak activation memory " << before << " bytes before reordering, " << after
+          << " bytes after";
+  return after < before ? reordered : func;
+}
+
+TVM_REGISTER_GLOBAL("relay.backend.ReorderForMemory").set_body_typed(ReorderForMemory);
+TVM_REGISTER_GLOBAL("relay.backend.EstimatePeakActivationBytes")
+    .set_body_typed([](Function func) { return EstimatePeakActivationBytes(func); });
+
+}  // namespace relay
+}  // namespace tvm
@@ -18,12 +18,15 @@
  */
 #include <tvm/ir/name_supply.h>
 #include <tvm/meta_schedule/extracted_task.h>
+#include <tvm/node/structural_equal.h>
+#include <tvm/node/structural_hash.h>
 #include <tvm/relay/expr.h>
 #include <tvm/relay/expr_functor.h>
 #include <tvm/relay/function.h>
 #include <tvm/target/target.h>
 
 #include <numeric>
+#include <unordered_map>
 
 #include "../../meta_schedule/module_equality.h"
 #include "../../te/operation/create_primfunc.h"
@@ -77,6 +80,11 @@ Array<meta_schedule::ExtractedTask> ExtractTask(IRModule mod, Target target,
 
   NameSupply constant_name_supply("");
 
+  // The primitive functions repeated in the model, e.g. by its identical layers, are lowered once.
+  // Hashing a relay function is much cheaper than lowering it to TIR.
+  using LowerResult = std::pair<std::string, Optional<IRModule>>;
+  std::unordered_map<Function, LowerResult, StructuralHash, StructuralEqual> lowered;
+
   PostOrderVisit(mod->Lookup("main"), [&](const Expr& exp) {
     if (exp->IsInstance<FunctionNode>()) {
       Function relay_func = Downcast<Function>(exp);
@@ -84,10 +92,16 @@ Array<meta_schedule::ExtractedTask> ExtractTask(IRModule mod, Target target,
         return;
       }
 
-      auto [f, fused_name] = tec::LowerToPrimFunc(relay_func, target, constant_name_supply);
-      if (f) {
-        IRModule tir_mod = PrimFuncToIRModule(f.value());
-        lower_results.push_back(std::make_tuple(fused_name, relay_func, tir_mod));
+      auto it = lowered.find(relay_func);
+      if (it == lowered.end()) {
+        auto [f, fused_name] = tec::LowerToPrimFunc(relay_func, target, constant_name_supply);
+        Optional<IRModule> tir_mod = NullOpt;
+        if (f) tir_mod = PrimFuncToIRModule(f.value());
+        it = lowered.emplace(relay_func, LowerResult(fused_name, tir_mod)).first;
+      }
+      const auto& [fused_name, tir_mod] = it->second;
+      if (tir_mod) {
+        lower_results.push_back(std::make_tuple(fused_name, relay_func, tir_mod.value()));
       }
     }
   });
@@ -113,11 +127,19 @@ Array<meta_schedule::ExtractedTask> ExtractTask(IRModule mod, Target target,
               [&op_counts](int i1, int i2) { return op_counts[i1] < op_counts[i2]; });
   }
 
+  // The repeated functions share their lowered module, found without hashing it again
+  std::unordered_map<const IRModuleNode*, ExtractedTask> task_of_mod;
   for (auto i : indices) {
     const auto& [fused_name, relay_func, tir_mod] = lower_results[i];
+    auto it_same = task_of_mod.find(tir_mod.get());
+    if (it_same != task_of_mod.end()) {
+      it_same->second->weight += 1;
+      continue;
+    }
     auto it = cache.find(tir_mod);
     if (it != cache.end()) {
       it->second->weight += 1;
+      task_of_mod.emplace(tir_mod.get(), it->second);
       continue;
     }
     // Note that the cache is key-ed on the tir mod, rather than the relay mod
@@ -125,6 +147,7 @@ Array<meta_schedule::ExtractedTask> ExtractTask(IRModule mod, Target target,
     ExtractedTask task(fused_name, relay_mod, target, {tir_mod}, 1);
     tasks.push_back(task);
     cache.emplace(tir_mod, task);
+    task_of_mod.emplace(tir_mod.get(), task);
   }
 
   // Tasks are extracted via post order visit, return the reversed list.
@@ -104,6 +104,7 @@
 #include <tvm/runtime/registry.h>
 #include <tvm/te/schedule.h>
 #include <tvm/te/schedule_pass.h>
+#include <tvm/tir/stmt_functor.h>
 #include <tvm/tir/transform.h>
 #include <tvm/topi/tags.h>
 
@@ -133,6 +134,127 @@ using namespace tvm::relay::transform;
 
 TVM_REGISTER_OBJECT_TYPE(TECompilerNode);
 
+/*!
+ * \brief Whether the primitive function only calls elementwise and broadcast operators, each
+ * element of its output then only reads the same element of the inputs of its type and the output
+ * may be written over such an input (see attr::kInplaceSafe).
+ */
+static bool IsElementwisePrimitive(const Function& func) {
+  static auto fpattern = Op::GetAttrMap<TOpPattern>("TOpPattern");
+  bool has_call = false;
+  bool elementwise = true;
+  PostOrderVisit(func->body, [&](const Expr& expr) {
+    if (const auto* call = expr.as<CallNode>()) {
+      has_call = true;
+      const auto* op = call->op.as<OpNode>();
+      if (op == nullptr || fpattern.get(GetRef<Op>(op), kOpaque) > kBroadcast) {
+        elementwise = false;
+      }
+    }
+  });
+  return has_call && elementwise;
+}
+
+/*!
+ * \brief Whether a block of the primitive tuned by meta_schedule is annotated with a TL tile config
+ * ("tl.gemm_config", see python/tvm/tl/meta_schedule.py). Such a primitive is compiled as the TL
+ * program of that config by "relay.backend.tl_gemm_config" instead of the TIR pipeline.
+ */
+static bool HasTLGemmConfig(const tir::PrimFunc& func) {
+  bool found = false;
+  tir::PostOrderVisit(func->body, [&found](const ObjectRef& node) {
+    if (const auto* block = node.as<tir::BlockNode>()) {
+      found = found || block->annotations.count("tl.gemm_config");
+    }
+  });
+  return found;
+}
+
+/*!
+ * \brief The primitives lowered by the previous builds of the process, so that rebuilding a model,
+ * or a model sharing some of its primitives, reuses them.
+ *
+ * Enabled by the "relay.backend.use_global_lowering_cache" pass config. The entries are by the
+ * \p CCacheKey, that is the structural hash of the source function and the target, and hit only
+ * under the same pass config and opt level. The schedules chosen by the tuning records in scope
+ * are not part of the key, the cache must be cleared when those change.
+ */
+class GlobalLoweringCache {
+ public:
+  static GlobalLoweringCache* Global() {
+    static GlobalLoweringCache* inst = new GlobalLoweringCache();
+    return inst;
+  }
+
+  static bool Enabled() {
+    return tvm::transform::PassContext::Current()
+        ->GetConfig<Bool>("relay.backend.use_global_lowering_cache", Bool(false))
+        .value();
+  }
+
+  /*!
+   * \brief Look up the lowered primitive of the key, renamed with the global var supply of the
+   * current build.
+   */
+  Optional<CachedFunc> Lookup(const CCacheKey& key, const GlobalVarSupply& global_var_supply) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(key);
+    if (it == entries_.end()) return NullOpt;
+    tvm::transform::PassContext ctx = tvm::transform::PassContext::Current();
+    if (it->second.opt_level != ctx->opt_level ||
+        !StructuralEqual()(it->second.config, ctx->config)) {
+      return NullOpt;
+    }
+    const CachedFunc& cached = it->second.cached_func;
+    std::string name = cached->prim_fn_var->name_hint;
+    if (!it->second.prefix.empty() && name.rfind(it->second.prefix + "_", 0) == 0) {
+      name = name.substr(it->second.prefix.size() + 1);
+    }
+    GlobalVar prim_fn_var = global_var_supply->FreshGlobal(name);
+    prim_fn_var->checked_type_ = cached->prim_fn_var->checked_type_;
+    IRModule funcs({}, {});
+    for (const auto& kv : cached->funcs->functions) {
+      auto prim_func = Downcast<tir::PrimFunc>(kv.second);
+      funcs->Add(prim_fn_var,
+                 WithAttr(prim_func, tvm::attr::kGlobalSymbol, prim_fn_var->name_hint));
+    }
+    return CachedFunc(cached->target, prim_fn_var, cached->inputs, cached->outputs,
+                      cached->schedule, cached->prim_func, cached->shape_func_param_states, funcs,
+                      cached->constant_tensors);
+  }
+
+  /*! \brief Record the primitive lowered for the key under the current pass context. */
+  void Insert(const CCacheKey& key, const CachedFunc& cached_func,
+              const GlobalVarSupply& global_var_supply) {
+    // the callees of a primitive would be renamed as well, only the single functions are kept
+    if (cached_func->funcs->functions.size() != 1 ||
+        !cached_func->funcs->Lookup(cached_func->prim_fn_var)->IsInstance<tir::PrimFuncNode>()) {
+      return;
+    }
+    tvm::transform::PassContext ctx = tvm::transform::PassContext::Current();
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_[key] = {cached_func, global_var_supply->name_supply_->prefix_, ctx->config,
+                     ctx->opt_level};
+  }
+
+  void Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+  }
+
+ private:
+  struct Entry {
+    CachedFunc cached_func;
+    /*! \brief The prefix of the names of the build which lowered the primitive. */
+    std::string prefix;
+    Map<String, ObjectRef> config;
+    int opt_level;
+  };
+
+  std::mutex mutex_;
+  std::unordered_map<CCacheKey, Entry> entries_;
+};
+
 class TECompilerImpl : public TECompilerNode {
  public:
   explicit TECompilerImpl(Optional<IRModule> opt_mod, Optional<String> opt_mod_name)
@@ -164,6 +286,11 @@ class TECompilerImpl : public TECompilerNode {
     if (value->packed_func != nullptr) {
       return value->packed_func;
     }
+    auto it = tl_gemm_modules_.find(value->cached_func->prim_fn_var);
+    if (it != tl_gemm_modules_.end()) {
+      value->packed_func = (*it).second.GetFunction(value->cached_func->prim_fn_var->name_hint);
+      return value->packed_func;
+    }
     auto m = build(value->cached_func->funcs, key->target, Target(nullptr));
     value->packed_func = m.GetFunction(value->cached_func->prim_fn_var->name_hint);
     return value->packed_func;
@@ -256,6 +383,17 @@ class TECompilerImpl : public TECompilerNode {
         }
       }
     }
+    // Likewise for the primitives compiled as TL programs.
+    for (const auto& kv : cache_) {
+      GlobalVar prim_fn_var = kv.second->cached_func->prim_fn_var;
+      if (tl_gemm_modules_.count(prim_fn_var)) {
+        const Function& src_func = kv.first->source_func;
+        Function function = WithFields(src_func, src_func->params, src_func->body,
+                                       src_func->ret_type, src_func->type_params,
+                                       DictAttrs(Map<String, ObjectRef>()));
+        module->Add(prim_fn_var, WithAttr(std::move(function), attr::kExtern, Integer(1)));
+      }
+    }
   }
 
   Array<tvm::runtime::Module> LowerExternalFunctions() {
@@ -309,6 +447,15 @@ class TECompilerImpl : public TECompilerNode {
     for (const auto& it : cached_ext_funcs) {
       cache_.erase(it);
     }
+    for (auto it = cache_.begin(); it != cache_.end();) {
+      if (tl_gemm_modules_.count(it->second->cached_func->prim_fn_var)) {
+        ret.push_back(tl_gemm_modules_.at(it->second->cached_func->prim_fn_var));
+        it = cache_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    tl_gemm_modules_.clear();
     return ret;
   }
 
@@ -387,6 +534,16 @@ class TECompilerImpl : public TECompilerNode {
       return value;
     }
 
+    bool use_global_cache = GlobalLoweringCache::Enabled();
+    if (use_global_cache) {
+      if (Optional<CachedFunc> cached = GlobalLoweringCache::Global()->Lookup(key,
+                                                                             global_var_supply)) {
+        VLOG(1) << "reusing the lowering of a previous build";
+        value->cached_func = cached.value();
+        return value;
+      }
+    }
+
     // Enforce use the target.
     With<Target> target_scope(key->target);
 
@@ -394,6 +551,20 @@ class TECompilerImpl : public TECompilerNode {
     value->cached_func =
         PrimFuncFor(key->source_func, key->target, global_var_supply, constant_name_supply_);
 
+    if (value->cached_func->prim_func.defined() &&
+        HasTLGemmConfig(value->cached_func->prim_func.value())) {
+      // The tuning record holds a TL tile config, the primitive is then an external function of
+      // the TL runtime module, which is neither lowered here nor cached across the builds.
+      const auto* build_tl = runtime::Registry::Get("relay.backend.tl_gemm_config");
+      ICHECK(build_tl != nullptr) << "The tuning record of " << PrettyPrint(key->source_func)
+                                  << " holds a TL tile config, import tvm.tl.meta_schedule";
+      GlobalVar prim_fn_var = value->cached_func->prim_fn_var;
+      runtime::Module tl_mod = (*build_tl)(value->cached_func->prim_func.value(), key->target,
+                                           prim_fn_var->name_hint);
+      tl_gemm_modules_.Set(prim_fn_var, tl_mod);
+      VLOG(1) << "compiled the TL tile config of " << prim_fn_var->name_hint;
+      return value;
+    }
     if (value->cached_func->prim_func.defined()) {
       VLOG(1) << "Lowering PrimFunc";
       IRModule lowered = tvm::LowerPrimFunc(value->cached_func->prim_func.value(),
@@ -461,6 +632,9 @@ class TECompilerImpl : public TECompilerNode {
       ICHECK(value->cached_func->funcs->Lookup(value->cached_func->prim_fn_var)
                  .as<tir::PrimFuncNode>());
     }
+    if (use_global_cache) {
+      GlobalLoweringCache::Global()->Insert(key, value->cached_func, global_var_supply);
+    }
     VLOG(1) << "lowered to name:" << std::endl
             << PrettyPrint(value->cached_func->prim_fn_var) << std::endl
             << "with definitions:" << std::endl
@@ -534,6 +708,8 @@ class TECompilerImpl : public TECompilerNode {
   CCacheKey cur_ccache_key_;
   /*! \brief Map of GlobalVar to C Device API context names */
   Map<GlobalVar, String> device_contexts_;
+  /*! \brief The TL runtime modules of the primitives tuned with a TL tile config */
+  Map<GlobalVar, runtime::Module> tl_gemm_modules_;
 };
 
 TECompiler::TECompiler(Optional<IRModule> opt_mod, Optional<String> mod_name) {
@@ -552,6 +728,7 @@ TVM_REGISTER_PASS_CONFIG_OPTION("relay.backend.use_auto_scheduler", Bool);
 TVM_REGISTER_PASS_CONFIG_OPTION("relay.backend.use_meta_schedule", Bool);
 TVM_REGISTER_PASS_CONFIG_OPTION("relay.backend.use_meta_schedule_dispatch", Integer);
 TVM_REGISTER_PASS_CONFIG_OPTION("relay.backend.tir_converter", String);
+TVM_REGISTER_PASS_CONFIG_OPTION("relay.backend.use_global_lowering_cache", Bool);
 
 TVM_REGISTER_GLOBAL("relay.backend._TECompilerGlobal").set_body_typed([]() {
   return TECompiler::Global();
@@ -571,6 +748,10 @@ TVM_REGISTER_GLOBAL("relay.backend._TECompilerClear").set_body_typed([](TECompil
   self->Clear();
 });
 
+TVM_REGISTER_GLOBAL("relay.backend._ClearGlobalLoweringCache").set_body_typed([]() {
+  GlobalLoweringCache::Global()->Clear();
+});
+
 TVM_REGISTER_GLOBAL("relay.backend._TECompilerLower")
     .set_body_typed([](TECompiler self, CCacheKey key, const String mod_name) {
       return self->Lower(key, mod_name);
@@ -755,6 +936,10 @@ class LowerTensorExprMutator : public DeviceAwareExprMutator {
     if (!opt_compiler && original_function->HasNonzeroAttr(attr::kReshapeOnly)) {
       call_lowered_attrs.metadata.Set(attr::kReshapeOnly, tvm::Integer(1));
     }
+    if (!opt_compiler && original_function->IsInstance<FunctionNode>() &&
+        IsElementwisePrimitive(Downcast<Function>(original_function))) {
+      call_lowered_attrs.metadata.Set(attr::kInplaceSafe, tvm::Integer(1));
+    }
 
     call_lowered_attrs.metadata.Set("relay_attrs", original_function->attrs);
     call_lowered_attrs.metadata.Set("all_prim_fn_vars", all_prim_fn_vars);
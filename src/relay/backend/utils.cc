@@ -198,7 +198,8 @@ ExecutorCodegenMetadata::ExecutorCodegenMetadata(
     String executor, String mod_name, String interface_api, bool unpacked_api,
     Integer workspace_alignment, Integer constant_alignment,
     Map<tir::Var, tir::usmp::AllocatedPoolInfo> pool_inputs,
-    Map<String, tir::usmp::PoolAllocation> io_pool_allocations) {
+    Map<String, tir::usmp::PoolAllocation> io_pool_allocations,
+    Map<tir::usmp::BufferInfo, tir::usmp::PoolAllocation> arena_buffer_allocations) {
   auto n = make_object<ExecutorCodegenMetadataNode>();
   n->inputs = inputs;
   n->input_tensor_types = input_tensor_types;
@@ -214,6 +215,7 @@ ExecutorCodegenMetadata::ExecutorCodegenMetadata(
   n->constant_alignment = constant_alignment;
   n->pool_inputs = pool_inputs;
   n->io_pool_allocations = io_pool_allocations;
+  n->arena_buffer_allocations = arena_buffer_allocations;
   data_ = std::move(n);
 }
 
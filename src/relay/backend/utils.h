@@ -157,6 +157,8 @@ class ExecutorCodegenMetadataNode : public Object {
   Optional<Map<tir::Var, tir::usmp::AllocatedPoolInfo>> pool_inputs;
   /*! \brief the I/O tensor to PoolAllocations if any*/
   Map<String, tir::usmp::PoolAllocation> io_pool_allocations;
+  /*! \brief the planned buffers to their PoolAllocations, when the static arena is enabled */
+  Map<tir::usmp::BufferInfo, tir::usmp::PoolAllocation> arena_buffer_allocations;
 
   String mod_name = "";
 
@@ -174,6 +176,7 @@ class ExecutorCodegenMetadataNode : public Object {
     v->Visit("constant_alignment", &constant_alignment);
     v->Visit("pool_inputs", &pool_inputs);
     v->Visit("io_pool_allocations", &io_pool_allocations);
+    v->Visit("arena_buffer_allocations", &arena_buffer_allocations);
     v->Visit("mod_name", &mod_name);
   }
 
@@ -194,7 +197,9 @@ class ExecutorCodegenMetadata : public ObjectRef {
                                   Integer constant_alignment = 16,
                                   Map<tir::Var, tir::usmp::AllocatedPoolInfo> pool_inputs =
                                       Map<tir::Var, tir::usmp::AllocatedPoolInfo>(),
-                                  Map<String, tir::usmp::PoolAllocation> io_pool_allocations = {});
+                                  Map<String, tir::usmp::PoolAllocation> io_pool_allocations = {},
+                                  Map<tir::usmp::BufferInfo, tir::usmp::PoolAllocation>
+                                      arena_buffer_allocations = {});
   TVM_DEFINE_MUTABLE_OBJECT_REF_METHODS(ExecutorCodegenMetadata, ObjectRef,
                                         ExecutorCodegenMetadataNode);
 };
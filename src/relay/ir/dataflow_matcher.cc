@@ -30,6 +30,7 @@
 
 #include <stack>
 
+#include "../transforms/pass_utils.h"
 #include "dataflow_matcher_impl.h"
 
 namespace tvm {
@@ -431,6 +432,10 @@ bool DFPatternMatcher::VisitDFPattern_(const LetPatternNode* op, const Expr& exp
 }
 
 Expr InferTypeWithModule(const Expr& expr, const IRModule& m) {
+  // The expression is unchanged since it was last typed, e.g. no callback rewrote it.
+  if (IsCheckedTypePopulated(expr)) {
+    return expr;
+  }
   IRModule mod(m->functions, m->type_definitions, m->Imports());
   GlobalVarSupply global_var_supply = GlobalVarSupply(mod);
   GlobalVar gvar = global_var_supply->FreshGlobal("_tmp", false);
@@ -441,7 +446,8 @@ Expr InferTypeWithModule(const Expr& expr, const IRModule& m) {
     func = relay::Function(relay::FreeVars(expr), expr, Type(), relay::FreeTypeVars(expr, mod), {});
   }
   mod->Add(gvar, func);
-  mod = transform::InferType()(mod);
+  // Only the rewritten function is typed again, the other functions of the module keep their types.
+  mod = transform::InferTypeIncremental()(mod);
   Expr ret;
   if (expr.as<FunctionNode>()) {
     ret = mod->Lookup(gvar);
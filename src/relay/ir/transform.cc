@@ -149,6 +149,13 @@ IRModule FunctionPassNode::operator()(IRModule mod, const PassContext& pass_ctx)
 
   // TODO(@jroesch): move away from eager type checking for performance reasons
   // make issue.
+  // The passes requiring the incremental type inference leave the types of the functions they do
+  // not rewrite valid, so that only the rewritten ones and their callers are typed again.
+  for (const String& required : pass_info->required) {
+    if (required == "InferTypeIncremental") {
+      return transform::InferTypeIncremental()(updated_mod);
+    }
+  }
   return transform::InferType()(updated_mod);
 }
 
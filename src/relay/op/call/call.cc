@@ -135,5 +135,12 @@ bool IsReshapeOnly(const CallLoweredProps& props) {
   return false;
 }
 
+bool IsInplaceSafe(const CallLoweredProps& props) {
+  auto it = props.attrs.metadata.find(attr::kInplaceSafe);
+  if (it == props.attrs.metadata.end()) return false;
+  const auto* flag = (*it).second.as<IntImmNode>();
+  return flag != nullptr && flag->value != 0;
+}
+
 }  // namespace relay
 }  // namespace tvm
@@ -90,6 +90,12 @@ Call GetAnyCall(const CallNode* call_node);
  */
 bool IsReshapeOnly(const CallLoweredProps& props);
 
+/*!
+ * \brief Returns true if the output of the lowered call described by \p props may be written over
+ * one of its inputs of the same type.
+ */
+bool IsInplaceSafe(const CallLoweredProps& props);
+
 }  // namespace relay
 }  // namespace tvm
 
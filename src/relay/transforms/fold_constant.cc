@@ -20,6 +20,8 @@
 /*!
  * \file constant_folding.cc
  */
+#include <tvm/node/structural_equal.h>
+#include <tvm/node/structural_hash.h>
 #include <tvm/relay/analysis.h>
 #include <tvm/relay/attrs/annotation.h>
 #include <tvm/relay/attrs/transform.h>
@@ -32,6 +34,12 @@
 #include <tvm/runtime/ndarray.h>
 #include <tvm/runtime/object.h>
 
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "../ir/indexed_graph.h"
 #include "../op/memory/on_device.h"
 #include "./pattern_utils.h"
 
@@ -63,6 +71,81 @@ bool IsComplexConstant(const Expr& expr) {
   }
 }
 
+/*! \brief The bytes of the data of the constants of \p expr. */
+size_t ConstantBytes(const Expr& expr) {
+  size_t bytes = 0;
+  PostOrderVisit(expr, [&bytes](const Expr& e) {
+    if (const auto* constant = e.as<ConstantNode>()) {
+      bytes += runtime::GetDataSize(*constant->data.operator->());
+    }
+  });
+  return bytes;
+}
+
+/*!
+ * \brief The folded subexpressions and their results, shared by the FoldConstant passes of the
+ * process so that the repeated builds of a model (e.g. when tuning, or the FoldConstant passes
+ * of a build) evaluate its constant subexpressions once. The subexpressions are compared
+ * structurally, including the data of their constants, and the oldest ones are dropped beyond
+ * the bytes of relay.FoldConstant.cache_bytes (their constants and their results). The cache is
+ * off by default (0 bytes), and a pass run with fewer bytes drops the oldest entries down to them.
+ */
+class FoldedConstantCache {
+ public:
+  static FoldedConstantCache* Global() {
+    static FoldedConstantCache* cache = new FoldedConstantCache();
+    return cache;
+  }
+
+  Optional<Expr> Lookup(const Expr& expr) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = results_.find(expr);
+    if (it == results_.end()) return NullOpt;
+    return it->second.first;
+  }
+
+  void Insert(const Expr& expr, const Expr& result, size_t max_bytes) {
+    size_t bytes = ConstantBytes(expr) + ConstantBytes(result);
+    if (bytes > max_bytes) return;
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!results_.emplace(expr, std::make_pair(result, bytes)).second) return;
+    order_.push_back(expr);
+    bytes_ += bytes;
+    EvictTo(max_bytes);
+  }
+
+  /*! \brief Drop the oldest subexpressions until the cache holds at most max_bytes. */
+  void Shrink(size_t max_bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    EvictTo(max_bytes);
+  }
+
+  void Clear() { Shrink(0); }
+
+  size_t Bytes() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return bytes_;
+  }
+
+ private:
+  void EvictTo(size_t max_bytes) {
+    while (!order_.empty() && bytes_ > max_bytes) {
+      auto it = results_.find(order_.front());
+      bytes_ -= it->second.second;
+      results_.erase(it);
+      order_.pop_front();
+    }
+  }
+
+
+  std::mutex mutex_;
+  /*! \brief The result of each subexpression and their bytes. */
+  std::unordered_map<Expr, std::pair<Expr, size_t>, StructuralHash, StructuralEqual> results_;
+  /*! \brief The subexpressions in the order of their insertion. */
+  std::deque<Expr> order_;
+  size_t bytes_ = 0;
+};
+
 // TODO(tvm-team) consider combine dead-code with constant folder.
 // or make a more powerful partial evaluator.
 class ConstantFolder : public MixedModeMutator {
@@ -74,11 +157,100 @@ class ConstantFolder : public MixedModeMutator {
         shape_of_op_(Op::Get("shape_of")),
         vm_shape_of_op_(Op::Get("vm.shape_of")),
         cast_op_(Op::Get("cast")),
-        ndarray_size_op_(Op::Get("ndarray_size")) {}
+        ndarray_size_op_(Op::Get("ndarray_size")) {
+    FoldedConstantCache::Global()->Shrink(cache_bytes_);
+  }
+
+  /*!
+   * \brief Plan the folding of the constant subexpressions of \p expr and evaluate them together.
+   *
+   * The foldable calls whose uses are all foldable calls are folded with their users rather than
+   * on their own, so that a chain of foldable calls (e.g. the transforms of a weight) is built and
+   * run once rather than once per call. The maximal constant subexpressions are evaluated
+   * together by one build here, and the rewrite finds their results. The subexpressions only
+   * exposed by the rewrite (e.g. behind an inlined let) are evaluated on their own.
+   */
+  void PlanSubgraphs(const Expr& expr) {
+    std::unique_ptr<IndexedGraph<Expr>> graph = CreateIndexedGraph(expr);
+    std::unordered_set<const CallNode*> foldable;
+    std::vector<const CallNode*> roots;
+    for (PostDfsIndex i = 0; i < graph->size(); ++i) {
+      const auto* call_node = graph->index_to_node(i)->node_ref_->as<CallNode>();
+      if (call_node == nullptr || !IsFoldableOp(call_node)) continue;
+      bool constant_args = std::all_of(
+          call_node->args.begin(), call_node->args.end(), [&foldable](const Expr& arg) {
+            const auto* arg_call = arg.as<CallNode>();
+            return IsComplexConstant(arg) || (arg_call != nullptr && foldable.count(arg_call));
+          });
+      if (constant_args) foldable.insert(call_node);
+    }
+    for (PostDfsIndex i = 0; i < graph->size(); ++i) {
+      const IndexedGraph<Expr>::Node* node = graph->index_to_node(i);
+      const auto* call_node = node->node_ref_->as<CallNode>();
+      if (call_node == nullptr || !foldable.count(call_node)) continue;
+      bool inner = !node->is_external_ && !node->outputs_.empty() &&
+                   std::all_of(node->outputs_.begin(), node->outputs_.end(),
+                               [&foldable](const IndexedGraph<Expr>::Node* output) {
+                                 const auto* user = output->node_ref_->as<CallNode>();
+                                 return user != nullptr && foldable.count(user);
+                               });
+      if (inner) {
+        inner_calls_.insert(call_node);
+      } else {
+        roots.push_back(call_node);
+      }
+    }
+    // evaluating a single subexpression here would only duplicate the rewrite
+    if (roots.size() < 2) return;
+    Array<Expr> fields;
+    for (const CallNode* root : roots) {
+      if (cache_bytes_ == 0 || !FoldedConstantCache::Global()->Lookup(GetRef<Expr>(root))) {
+        fields.push_back(GetRef<Expr>(root));
+      }
+    }
+    if (fields.size() < 2) return;
+    VLOG(1) << "Evaluating " << fields.size() << " constant subexpressions together";
+    Optional<Expr> results;
+    try {
+      results = Evaluate(Tuple(fields));
+    } catch (const Error& e) {
+      // the subexpressions are evaluated one by one by the rewrite, where the error is reported
+      VLOG(1) << "Failed to evaluate the constant subexpressions together: " << e.what();
+      return;
+    }
+    const auto* tuple = results.value().as<TupleNode>();
+    ICHECK(tuple != nullptr && tuple->fields.size() == fields.size());
+    for (size_t i = 0; i < fields.size(); ++i) {
+      planned_results_[fields[i]] = tuple->fields[i];
+      if (cache_bytes_ != 0) {
+        FoldedConstantCache::Global()->Insert(fields[i], tuple->fields[i], cache_bytes_);
+      }
+    }
+  }
 
  private:
   using ExprMutator::VisitExpr_;
 
+  /*!
+   * \brief Whether \p call may be folded when its arguments are constants, besides shape_of and
+   * ndarray_size which are folded from the shapes of their arguments.
+   */
+  bool IsFoldableOp(const CallNode* call) const {
+    if (call->args.empty()) return false;
+    const auto* op_node = call->op.as<OpNode>();
+    if (op_node == nullptr) return false;
+    Op op = GetRef<Op>(op_node);
+    static auto op_stateful = Op::GetAttrMap<TOpIsStateful>("TOpIsStateful");
+    static auto fnoncomputational = Op::GetAttrMap<TNonComputational>("TNonComputational");
+    static auto qnn_canonicalize = Op::GetAttrMap<FTVMLegalize>("FTVMQnnCanonicalize");
+    if (op_stateful.get(op, false)) return false;
+    bool is_no_qnn_canonicalized = !qnn_canonicalize.count(op);
+    bool is_no_computational = fnoncomputational.count(op) && fnoncomputational[op];
+    if (is_no_computational && (is_no_qnn_canonicalized || !fold_qnn_)) return false;
+    return op != device_copy_op_ && op != shape_of_op_ && op != vm_shape_of_op_ &&
+           op != ndarray_size_op_;
+  }
+
   Expr VisitExpr_(const LetNode* let_node) final {
     auto pre_visit = [this](const LetNode* op) {
       // Rely on the Memoizer to cache pre-visit values
@@ -181,20 +353,20 @@ class ConstantFolder : public MixedModeMutator {
     if (Optional<Expr> opt_result = EvaluateNdarraySize(pre_call)) {
       return opt_result.value();
     }
-    static auto fnoncomputational = Op::GetAttrMap<TNonComputational>("TNonComputational");
-    static auto qnn_canonicalize = Op::GetAttrMap<FTVMLegalize>("FTVMQnnCanonicalize");
-    bool is_no_qnn_canonicalized = !qnn_canonicalize.count(op);
-    bool is_no_computational = fnoncomputational.count(op) && fnoncomputational[op];
-    if (is_no_computational && (is_no_qnn_canonicalized || !fold_qnn_)) {
+    // We should think about potentially constant evaluation over device_copy, shape_of and
+    // ndarray_size too.
+    if (!IsFoldableOp(post_call.get())) {
       return std::move(post_call);
     }
-    if (op == device_copy_op_ || op == shape_of_op_ || op == vm_shape_of_op_ ||
-        op == ndarray_size_op_) {
-      // We should think about potentially constant evaluation over these ops too.
+    if (!std::all_of(post_call->args.begin(), post_call->args.end(), [this](const Expr& arg) {
+          return IsComplexConstant(arg) || deferred_calls_.count(arg.get());
+        })) {
+      // At least one non-constant argument.
       return std::move(post_call);
     }
-    if (!std::all_of(post_call->args.begin(), post_call->args.end(), IsComplexConstant)) {
-      // At least one non-constant argument.
+    if (inner_calls_.count(pre_call_node)) {
+      // Folded with its users, see PlanSubgraphs.
+      deferred_calls_.insert(post_call.get());
       return std::move(post_call);
     }
     // During evaluation we have obviously lost all on_device annotations. However any
@@ -250,6 +422,20 @@ class ConstantFolder : public MixedModeMutator {
   // Constant evaluate an expression.
   Expr ConstEvaluate(const Expr& expr) {
     VLOG_CONTEXT << "ConstEvaluate";
+    auto it = planned_results_.find(expr);
+    if (it != planned_results_.end()) return it->second;
+    if (cache_bytes_ == 0) return Evaluate(expr);
+    if (Optional<Expr> cached = FoldedConstantCache::Global()->Lookup(expr)) {
+      VLOG(1) << "Found the evaluated constant of:" << std::endl << PrettyPrint(expr);
+      return cached.value();
+    }
+    Expr result = Evaluate(expr);
+    FoldedConstantCache::Global()->Insert(expr, result, cache_bytes_);
+    return result;
+  }
+
+  // Evaluate an expression with the interpreter.
+  Expr Evaluate(const Expr& expr) {
     VLOG(1) << "Evaluating :" << std::endl << PrettyPrint(expr);
 
     // We'll invoke the interpreter using the generic CPU device and target. Technically there's
@@ -411,16 +597,41 @@ class ConstantFolder : public MixedModeMutator {
 
   // True if currently within a "primitive" Relay Function.
   bool inside_primitive_ = false;
+
+  // The foldable calls whose uses are all foldable calls, folded with them.
+  std::unordered_set<const CallNode*> inner_calls_;
+  // The rewritten inner calls, constant arguments of their users.
+  std::unordered_set<const Object*> deferred_calls_;
+  // The results of the subexpressions evaluated together by PlanSubgraphs.
+  std::unordered_map<Expr, Expr, StructuralHash, StructuralEqual> planned_results_;
+  // The bytes of the results kept by the cache of the folded subexpressions.
+  size_t cache_bytes_ = static_cast<size_t>(
+      transform::PassContext::Current()
+          ->GetConfig<Integer>("relay.FoldConstant.cache_bytes", Integer(0))
+          .value()
+          ->value);
 };
 
 }  // namespace
 
+TVM_REGISTER_PASS_CONFIG_OPTION("relay.FoldConstant.cache_bytes", Integer);
+
 TVM_REGISTER_GLOBAL("relay.analysis.check_constant").set_body_typed(IsComplexConstant);
 
+TVM_REGISTER_GLOBAL("relay._transform.ClearFoldConstantCache").set_body_typed([]() {
+  FoldedConstantCache::Global()->Clear();
+});
+
+TVM_REGISTER_GLOBAL("relay._transform.FoldConstantCacheBytes").set_body_typed([]() {
+  return static_cast<int64_t>(FoldedConstantCache::Global()->Bytes());
+});
+
 Expr FoldConstantExpr(const Expr& expr, const IRModule& mod, bool fold_qnn) {
   VLOG_CONTEXT << "FoldConstantExpr";
   VLOG(1) << "folding:" << std::endl << PrettyPrint(expr);
-  Expr result = ConstantFolder(mod, fold_qnn).VisitExpr(expr);
+  ConstantFolder folder(mod, fold_qnn);
+  folder.PlanSubgraphs(expr);
+  Expr result = folder.VisitExpr(expr);
   VLOG(1) << "folded to:" << std::endl << PrettyPrint(result);
   return result;
 }
@@ -440,7 +651,7 @@ Pass FoldConstant(bool fold_qnn) {
       [=](Function f, IRModule m, PassContext /* pc */) {
         return Downcast<Function>(FoldConstantExpr(f, m, fold_qnn));
       };
-  return CreateFunctionPass(pass_func, 2, "FoldConstant", {});
+  return CreateFunctionPass(pass_func, 2, "FoldConstant", {"InferTypeIncremental"});
 }
 
 TVM_REGISTER_GLOBAL("relay._transform.FoldConstant").set_body_typed(FoldConstant);
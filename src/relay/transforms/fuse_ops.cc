@@ -24,13 +24,19 @@
  * \brief This is a backend-aware optimization pass.
  *   Fuse necessary ops into a single one.
  */
+#include <tvm/ir/name_supply.h>
 #include <tvm/relay/analysis.h>
+#include <tvm/relay/attrs/nn.h>
 #include <tvm/relay/executor.h>
 #include <tvm/relay/expr_functor.h>
 #include <tvm/relay/op_attr_types.h>
 #include <tvm/relay/transform.h>
+#include <tvm/runtime/registry.h>
 #include <tvm/tir/op.h>
 
+#include <algorithm>
+#include <string>
+
 #include "../../support/arena.h"
 #include "../analysis/graph_partitioner.h"
 #include "../op/annotation/annotation.h"
@@ -88,6 +94,7 @@ static const Op& stop_fusion_op = Op::Get("annotation.stop_fusion");
 
 TVM_REGISTER_PASS_CONFIG_OPTION("relay.FuseOps.max_depth", Integer);
 TVM_REGISTER_PASS_CONFIG_OPTION("relay.FuseOps.link_params", Bool);
+TVM_REGISTER_PASS_CONFIG_OPTION("relay.FuseOps.attention_compiler", String);
 
 // Creator of post dominator tree of the dataflow
 class IndexedForwardGraphCreator : private ExprVisitor {
@@ -551,6 +558,136 @@ class FuseMutator : private MixedModeMutator {
   }
 };
 
+/*!
+ * \brief Outline the attention subgraphs, batch_matmul(softmax(batch_matmul(q, k) [* or / scale]),
+ *  v), into "Primitive" functions of an external compiler, whose codegen lowers each of them to one
+ *  tiled online-softmax kernel, e.g. the "tl.attention" composite of the TL codegen. The fusion
+ *  rules stop at the batch_matmul anchors, so that the scores of the attention otherwise go
+ *  through the global memory.
+ *
+ *  The scores must be computed for the softmax only, and the softmax for the second batch_matmul
+ *  only. The codegen accepts the attention it supports (dtypes, shapes) with a
+ *  "relay.ext.<compiler>.check_attention" function of the attention call on the variables q, k
+ *  and v, returning a bool. Nothing is outlined for a compiler without it.
+ *
+ *  The functions are named tvmgen_<compiler>_<global var>_attention_<n>, n counting the outlined
+ *  attention of the function from the first free symbol.
+ */
+class AttentionOutliner : public MixedModeMutator {
+ public:
+  AttentionOutliner(String compiler, const String& func_name, const Expr& body)
+      : compiler_(std::move(compiler)), name_supply_("") {
+    class UseCounter : public ExprVisitor {
+     public:
+      using ExprVisitor::visit_counter_;
+    } counter;
+    counter(body);
+    use_count_ = std::move(counter.visit_counter_);
+    f_check_ = runtime::Registry::Get("relay.ext." + std::string(compiler_) + ".check_attention");
+    symbol_prefix_ = "tvmgen_" + std::string(compiler_) + "_";
+    if (!func_name.empty()) symbol_prefix_ += std::string(func_name) + "_";
+    symbol_prefix_ += "attention_";
+    // the attention outlined by a previous run keeps its symbol
+    PostOrderVisit(body, [this](const Expr& expr) {
+      if (const auto* fn = expr.as<FunctionNode>()) {
+        if (auto symbol = fn->GetAttr<String>(tvm::attr::kGlobalSymbol)) {
+          name_supply_->ReserveName(symbol.value(), false);
+        }
+      }
+    });
+  }
+
+ private:
+  using MixedModeMutator::VisitExpr_;
+
+  // Skip primitive function.
+  Expr VisitExpr_(const FunctionNode* fn_node) final {
+    if (fn_node->HasNonzeroAttr(attr::kPrimitive)) {
+      return GetRef<Expr>(fn_node);
+    } else {
+      return ExprMutator::VisitExpr_(fn_node);
+    }
+  }
+
+  /*! \return The call of op_name in expr, consumed by one expression only, or nullptr. */
+  const CallNode* AsSingleUseCall(const Expr& expr, const char* op_name) const {
+    const auto* call = expr.as<CallNode>();
+    if (call == nullptr || !call->op.same_as(Op::Get(op_name))) return nullptr;
+    auto it = use_count_.find(call);
+    return it != use_count_.end() && it->second == 1 ? call : nullptr;
+  }
+
+  static bool IsStaticTensor(const Expr& expr) {
+    const auto* ttype = expr->checked_type().as<TensorTypeNode>();
+    if (ttype == nullptr) return false;
+    return std::all_of(ttype->shape.begin(), ttype->shape.end(),
+                       [](const PrimExpr& dim) { return dim->IsInstance<IntImmNode>(); });
+  }
+
+  Expr Rewrite_(const CallNode* pre, const Expr& post) final {
+    static const Op& batch_matmul_op = Op::Get("nn.batch_matmul");
+    if (f_check_ == nullptr || !pre->op.same_as(batch_matmul_op)) return post;
+    const CallNode* softmax = AsSingleUseCall(pre->args[0], "nn.softmax");
+    if (softmax == nullptr) return post;
+    const CallNode* scale = AsSingleUseCall(softmax->args[0], "multiply");
+    if (scale == nullptr) scale = AsSingleUseCall(softmax->args[0], "divide");
+    if (scale != nullptr && !IsConstScalar(scale->args[1])) return post;
+    const CallNode* scores =
+        AsSingleUseCall(scale != nullptr ? scale->args[0] : softmax->args[0], "nn.batch_matmul");
+    if (scores == nullptr) return post;
+
+    const auto* scores_attrs = scores->attrs.as<BatchMatmulAttrs>();
+    const auto* attrs = pre->attrs.as<BatchMatmulAttrs>();
+    const auto* softmax_attrs = softmax->attrs.as<SoftmaxAttrs>();
+    if (scores_attrs->transpose_a || !scores_attrs->transpose_b || attrs->transpose_a) return post;
+    if (softmax_attrs->axis != -1 && softmax_attrs->axis != 2) return post;
+    Array<Expr> inputs = {scores->args[0], scores->args[1], pre->args[1]};
+    if (!std::all_of(inputs.begin(), inputs.end(), IsStaticTensor)) return post;
+
+    // the composite function of the attention, called by the function of the compiler
+    Array<Var> composite_params, params;
+    Array<Expr> args;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+      std::string name = "attention_arg" + std::to_string(i);
+      composite_params.push_back(Var(name, inputs[i]->checked_type()));
+      params.push_back(Var(name, inputs[i]->checked_type()));
+      args.push_back(VisitExpr(inputs[i]));
+    }
+    Expr body = Call(scores->op, {composite_params[0], composite_params[1]}, scores->attrs);
+    if (scale != nullptr) body = Call(scale->op, {body, scale->args[1]}, scale->attrs);
+    body = Call(softmax->op, {body}, softmax->attrs);
+    body = Call(pre->op, {body, composite_params[2]}, pre->attrs);
+    InferTypeLocal(body);
+    if (!static_cast<bool>((*f_check_)(body))) return post;
+    Function composite(composite_params, body, pre->checked_type(), {});
+    composite = WithAttr(std::move(composite), attr::kComposite,
+                         String(std::string(compiler_) + ".attention"));
+
+    Call call_composite(composite, Array<Expr>(params.begin(), params.end()));
+    Function func(params, call_composite, pre->checked_type(), {});
+    func = WithAttr(std::move(func), attr::kPrimitive, Integer(1));
+    func = WithAttr(std::move(func), attr::kCompiler, compiler_);
+    std::string symbol = symbol_prefix_ + std::to_string(num_outlined_++);
+    while (name_supply_->ContainsName(symbol, false)) {
+      symbol = symbol_prefix_ + std::to_string(num_outlined_++);
+    }
+    func = WithAttr(std::move(func), tvm::attr::kGlobalSymbol,
+                    name_supply_->ReserveName(symbol, false));
+    Call call(func, args, Attrs(), {}, pre->span);
+    InferTypeLocal(call);
+    return std::move(call);
+  }
+
+  String compiler_;
+  /*! \brief The number of expressions consuming each expression of the body. */
+  std::unordered_map<const Object*, size_t> use_count_;
+  const runtime::PackedFunc* f_check_;
+  /*! \brief The symbols of the outlined functions of the body. */
+  NameSupply name_supply_;
+  std::string symbol_prefix_;
+  int num_outlined_{0};
+};
+
 Expr FuseOps(const Expr& expr, int fuse_opt_level, size_t max_fuse_depth, size_t max_function_args,
              bool link_params, const IRModule& module) {
   return FuseMutator(fuse_opt_level, max_fuse_depth, max_function_args, link_params)
@@ -571,6 +708,15 @@ Pass FuseOps(int fuse_opt_level) {
         link_params = pc->GetConfig("relay.FuseOps.link_params", Bool(link_params)).value();
         int opt_level = fuse_opt_level == -1 ? pc->opt_level : fuse_opt_level;
         auto max_fuse_depth = pc->GetConfig("relay.FuseOps.max_depth", Integer(kMaxFusedOps));
+        String attention_compiler =
+            pc->GetConfig<String>("relay.FuseOps.attention_compiler", String("")).value();
+        if (!attention_compiler.empty() && opt_level > 0) {
+          String func_name;
+          for (const auto& [gvar, func] : m->functions) {
+            if (func.same_as(f)) func_name = gvar->name_hint;
+          }
+          f = Downcast<Function>(AttentionOutliner(attention_compiler, func_name, f)(f));
+        }
         auto target = Target::Current();
         size_t max_function_args =
             (target.defined())
@@ -579,7 +725,7 @@ Pass FuseOps(int fuse_opt_level) {
         return Downcast<Function>(FuseOps(f, opt_level, max_fuse_depth.value().IntValue(),
                                           max_function_args, link_params, m));
       };
-  return CreateFunctionPass(pass_func, 0, "FuseOps", {"InferType"});
+  return CreateFunctionPass(pass_func, 0, "FuseOps", {"InferTypeIncremental"});
 }
 
 TVM_REGISTER_GLOBAL("relay._transform.FuseOps").set_body_typed(FuseOps);
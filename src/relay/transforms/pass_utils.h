@@ -98,6 +98,13 @@ bool IsDynamic(const Type& ty);
  */
 bool IsDataDependent(const CallNode* call);
 
+/*!
+ * \brief Check if all the sub-expressions of an expression have a checked type.
+ * \param e The expression to be checked.
+ * \return Whether the types are populated, i.e. the expression needs no type inference.
+ */
+bool IsCheckedTypePopulated(const Expr& e);
+
 /*!
  * \brief Make arbitrary transformation preserve the out most function.
  * \param func The transformation.
@@ -1144,7 +1144,7 @@ Pass SimplifyExpr() {
       [=](Function f, IRModule m, PassContext pc) {
         return Downcast<Function>(SimplifyExpr(f, m));
       };
-  return CreateFunctionPass(pass_func, 0, "SimplifyExpr", {"InferType"});
+  return CreateFunctionPass(pass_func, 0, "SimplifyExpr", {"InferTypeIncremental"});
 }
 
 Pass SimplifyExprPostAlterOp() {
@@ -1152,7 +1152,7 @@ Pass SimplifyExprPostAlterOp() {
       [=](Function f, IRModule m, PassContext pc) {
         return Downcast<Function>(SimplifyExprPostAlterOp(f, m));
       };
-  return CreateFunctionPass(pass_func, 0, "SimplifyExprPostAlterOp", {"InferType"});
+  return CreateFunctionPass(pass_func, 0, "SimplifyExprPostAlterOp", {"InferTypeIncremental"});
 }
 
 TVM_REGISTER_GLOBAL("relay._transform.SimplifyExpr").set_body_typed(SimplifyExpr);
@@ -69,6 +69,11 @@ using CachedCastNodes = std::unordered_map<std::pair<const ExprNode*, DataType>,
 using FTVMMixedPrecisionConversionType = runtime::TypedPackedFunc<Array<ObjectRef>(
     const Call& call_node, const std::string& target_dtype_str)>;
 
+// A calibrated plan maps calls to the precision they run in : [dtype, arg_scales...]
+// The arg scales are only given for the float8 calls, whose args are divided by their scale
+// before the cast to float8, and whose accumulation is multiplied by the product of the scales.
+using MixedPrecisionPlan = Map<Call, Array<ObjectRef>>;
+
 /*! \brief This class transforms the given relay module into a version where
  * as many operations as possible operate in the target mixed precision dtype.
  *
@@ -94,6 +99,9 @@ using FTVMMixedPrecisionConversionType = runtime::TypedPackedFunc<Array<ObjectRe
  *         describe whether a larger dtype is used to accumulate the results
  *         of the operation. The output_dtype meanwhile describes the dtype
  *         most Ops should use from this accumulator.
+ *      4) The calls of a calibrated plan run in the dtype it gives them, float32
+ *         making them NEVER operations. The float8 calls are scaled per tensor,
+ *         accumulate in float32 and output the target mixed precision dtype.
  */
 class MixedPrecisionPass : public MixedModeMutator {
  private:
@@ -110,25 +118,27 @@ class MixedPrecisionPass : public MixedModeMutator {
   const RelayExprNode* root_;
   std::vector<DataType> original_dtype_;
   bool keep_orig_output_dtype_;
+  /*! \brief The calibrated precision of the calls, see MixedPrecisionPlan. */
+  MixedPrecisionPlan plan_;
 
   /*! \brief If some of the constant attributes are out of mixed_precision_type_ bounds, then
    * computation cannot be performed in mixed precision. */
-  bool IsMixedPrecisionApplicableToAttrs(const Attrs& attrs) const {
+  bool IsMixedPrecisionApplicableToAttrs(const Attrs& attrs, const DataType& dtype) const {
     if (attrs.get() != nullptr) {
       double min_bound;
       double max_bound;
-      if (mixed_precision_type_.is_float16()) {
+      if (dtype.is_float16()) {
         min_bound = -support::kMaxFloat16;
         max_bound = support::kMaxFloat16;
-      } else if (mixed_precision_type_.is_bfloat16()) {
+      } else if (dtype.is_bfloat16()) {
         min_bound = -support::kMaxBFloat16;
         max_bound = support::kMaxBFloat16;
-      } else if (mixed_precision_type_.is_float8()) {
-        double bound = (mixed_precision_type_.code() == DataType::kE4M3Float) ? support::kMaxE4M3
-                                                                              : support::kMaxE5M2;
+      } else if (dtype.is_float8()) {
+        double bound =
+            (dtype.code() == DataType::kE4M3Float) ? support::kMaxE4M3 : support::kMaxE5M2;
         min_bound = -bound;
         max_bound = bound;
-      } else if (mixed_precision_type_.is_float()) {
+      } else if (dtype.is_float()) {
         min_bound = std::numeric_limits<float>::lowest();
         max_bound = std::numeric_limits<float>::max();
       } else {
@@ -300,6 +310,18 @@ class MixedPrecisionPass : public MixedModeMutator {
     return expr;
   }
 
+  Expr ScaledCastArg(const Expr& expr, const Type& expr_type, const DataType& wanted_dtype,
+                     double scale) {
+    /* Divide a tensor argument by its scale before casting it, e.g. into the float8 range. */
+    const TensorTypeNode* tensor_type = expr_type.as<TensorTypeNode>();
+    CHECK(tensor_type) << "Only the tensor arguments can be scaled, got " << expr_type;
+    DataType expr_dtype = tensor_type->dtype;
+    if (!(expr_dtype.is_float() || expr_dtype.is_bfloat16())) {
+      return expr;
+    }
+    return Cast(Multiply(expr, MakeConstantScalar(expr_dtype, 1.0 / scale)), wanted_dtype);
+  }
+
   std::pair<Array<Expr>, Array<Type>> CastAllArgs(const Array<Expr>& cur_args,
                                                   const Array<Type>& cur_arg_types,
                                                   const DataType& wanted_dtype) {
@@ -320,11 +342,13 @@ class MixedPrecisionPass : public MixedModeMutator {
   using MixedModeMutator::VisitExpr_;
 
   explicit MixedPrecisionPass(Expr base, bool keep_orig_output_dtype,
-                              DataType mixed_precision_type = DataType::Float(16))
+                              DataType mixed_precision_type = DataType::Float(16),
+                              MixedPrecisionPlan plan = {})
       : MixedModeMutator(),
         mixed_precision_type_(mixed_precision_type),
         root_(Downcast<Function>(base)->body.get()),
-        keep_orig_output_dtype_(keep_orig_output_dtype) {
+        keep_orig_output_dtype_(keep_orig_output_dtype),
+        plan_(plan) {
     if (keep_orig_output_dtype_) {
       if (root_->IsInstance<tvm::relay::TupleNode>()) {
         const TupleTypeNode* tuple_type = (root_->checked_type_).as<TupleTypeNode>();
@@ -394,6 +418,32 @@ class MixedPrecisionPass : public MixedModeMutator {
       LOG(FATAL) << "Unsupported op type in CallNode: " << pre_call_node->op;
     }
 
+    // The calibrated plan overrides the category and dtypes of the calls it lists.
+    DataType op_dtype = mixed_precision_type_;
+    std::vector<double> arg_scales;
+    auto planned = plan_.find(GetRef<Call>(pre_call_node));
+    if (planned != plan_.end()) {
+      Array<ObjectRef> entry = (*planned).second;
+      ICHECK(!entry.empty()) << "The plan of " << GetRef<Call>(pre_call_node) << " is empty";
+      op_dtype = DataType(String2DLDataType(Downcast<String>(entry[0])));
+      for (size_t i = 1; i < entry.size(); ++i) {
+        arg_scales.push_back(Downcast<FloatImm>(entry[i])->value);
+      }
+      if (op_dtype == DataType::Float(32)) {
+        initial_category = MIXED_PRECISION_NEVER;
+      } else if (op_dtype.is_float8()) {
+        ICHECK_EQ(arg_scales.size(), post_call_node->args.size())
+            << "A float8 call of the plan needs the scale of each of its args";
+        initial_category = MIXED_PRECISION_ALWAYS;
+        accumulation_dtype = DataType::Float(32);
+        output_dtype = mixed_precision_type_;
+      } else {
+        initial_category = MIXED_PRECISION_ALWAYS;
+        accumulation_dtype = op_dtype;
+        output_dtype = op_dtype;
+      }
+    }
+
     // First check if all the new mutated args are in lower precision form
     Array<Type> cur_arg_types;
     bool all_args_mixed_type_compatible = true;
@@ -419,11 +469,22 @@ class MixedPrecisionPass : public MixedModeMutator {
 
     bool is_mixed_precision_applicable =
         static_cast<bool>(final_category == MIXED_PRECISION_ALWAYS &&
-                          IsMixedPrecisionApplicableToAttrs(pre_call_node->attrs));
+                          IsMixedPrecisionApplicableToAttrs(pre_call_node->attrs, op_dtype));
     // Create the new arguments to the call.
-    DataType wanted_arg_dtypes =
-        is_mixed_precision_applicable ? mixed_precision_type_ : DataType::Float(32);
+    DataType wanted_arg_dtypes = is_mixed_precision_applicable ? op_dtype : DataType::Float(32);
     auto call_args_and_types = CastAllArgs(post_call_node->args, cur_arg_types, wanted_arg_dtypes);
+    bool is_scaled = is_mixed_precision_applicable && !arg_scales.empty();
+    if (is_scaled) {
+      Array<Expr> scaled_args;
+      Array<Type> scaled_arg_types;
+      for (size_t i = 0; i < arg_scales.size(); ++i) {
+        Expr arg = ScaledCastArg(post_call_node->args[i], cur_arg_types[i], op_dtype,
+                                 arg_scales[i]);
+        scaled_args.push_back(arg);
+        scaled_arg_types.push_back(GetType(arg));
+      }
+      call_args_and_types = {scaled_args, scaled_arg_types};
+    }
     Array<Expr> new_args = call_args_and_types.first;
     Array<Type> new_arg_types;
 
@@ -438,6 +499,12 @@ class MixedPrecisionPass : public MixedModeMutator {
     if (is_mixed_precision_applicable) {
       Attrs new_attrs = GetNewAttrs(pre_call_node, accumulation_dtype);
       Expr output = Call(cur_op, new_args, new_attrs, new_arg_types, pre_call_node->span);
+      if (is_scaled) {
+        // The call is bilinear in its args, it is rescaled by the product of their scales.
+        double scale = 1.0;
+        for (double arg_scale : arg_scales) scale *= arg_scale;
+        output = Multiply(output, MakeConstantScalar(accumulation_dtype, scale));
+      }
       if (accumulation_dtype != output_dtype) {
         output = CastArg(output, GetType(output), output_dtype);
       }
@@ -502,11 +569,13 @@ class MixedPrecisionPass : public MixedModeMutator {
 
   // To access map of ops not registered for error reporting
   friend Expr ToMixedPrecision(const Expr& expr, bool keep_orig_output_dtype,
-                               const DataType& mixed_precision_type, int missing_op_mode);
+                               const DataType& mixed_precision_type, int missing_op_mode,
+                               const MixedPrecisionPlan& plan);
 };
 
 Expr ToMixedPrecision(const Expr& expr, bool keep_orig_output_dtype,
-                      const DataType& mixed_precision_type, int missing_op_mode) {
+                      const DataType& mixed_precision_type, int missing_op_mode,
+                      const MixedPrecisionPlan& plan) {
   /*
   missing_op_mode:
 
@@ -518,7 +587,7 @@ Expr ToMixedPrecision(const Expr& expr, bool keep_orig_output_dtype,
       << " missing_op_mode must be either 0, 1, or 2 got " << missing_op_mode;
 
   MixedPrecisionPass converter =
-      MixedPrecisionPass(expr, keep_orig_output_dtype, mixed_precision_type);
+      MixedPrecisionPass(expr, keep_orig_output_dtype, mixed_precision_type, plan);
   auto result = converter.Mutate(expr);
 
   for (auto it = converter.missing_ops_.begin();
@@ -539,15 +608,16 @@ Expr ToMixedPrecision(const Expr& expr, bool keep_orig_output_dtype,
 
 namespace transform {
 
-Pass ToMixedPrecision(DataType mixed_precision_type, int missing_op_mode) {
+Pass ToMixedPrecision(DataType mixed_precision_type, int missing_op_mode,
+                      MixedPrecisionPlan plan) {
   runtime::TypedPackedFunc<Function(Function, IRModule, PassContext)> pass_func =
       [=](Function f, IRModule m, PassContext pc) {
         bool keep_orig_output_dtype = false;
         keep_orig_output_dtype = pc->GetConfig("relay.ToMixedPrecision.keep_orig_output_dtype",
                                                Bool(keep_orig_output_dtype))
                                      .value();
-        return Downcast<Function>(
-            ToMixedPrecision(f, keep_orig_output_dtype, mixed_precision_type, missing_op_mode));
+        return Downcast<Function>(ToMixedPrecision(f, keep_orig_output_dtype, mixed_precision_type,
+                                                   missing_op_mode, plan));
       };
   return CreateFunctionPass(pass_func, 0, "ToMixedPrecision", {});
 }
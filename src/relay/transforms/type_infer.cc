@@ -46,6 +46,8 @@
 #include <tvm/relay/pattern_functor.h>
 #include <tvm/relay/transform.h>
 
+#include <unordered_set>
+
 #include "../analysis/type_solver.h"
 #include "pass_utils.h"
 
@@ -827,6 +829,93 @@ struct AllCheckTypePopulated : MixedModeVisitor {
 
 void EnsureCheckedType(const Expr& e) { AllCheckTypePopulated().VisitExpr(e); }
 
+/*!
+ * \brief Checks whether all the sub-expressions of an expression have a checked type, and collects
+ *  the global vars it references.
+ */
+struct CheckedTypePopulated : MixedModeVisitor {
+  using MixedModeVisitor::VisitExpr_;
+  bool populated{true};
+  std::unordered_set<const GlobalVarNode*> global_vars;
+
+  void DispatchExprVisit(const Expr& e) {
+    if (!populated || e.as<OpNode>() || e.as<ConstructorNode>()) {
+      return;
+    }
+    if (const auto* global_var = e.as<GlobalVarNode>()) {
+      global_vars.insert(global_var);
+      return;
+    }
+    if (!e->checked_type_.defined()) {
+      populated = false;
+      return;
+    }
+    return ExprVisitor::VisitExpr(e);
+  }
+  void VisitExpr_(const LetNode* op) final {
+    auto pre_visit = [this](const LetNode* op) {
+      this->VisitExpr(op->var);
+      this->VisitExpr(op->value);
+    };
+    auto post_visit = [this](const LetNode* op) {
+      this->VisitExpr(op->body);
+      this->visit_counter_[op] += 1;
+    };
+    ExpandANormalForm(op, pre_visit, post_visit);
+  }
+};
+
+bool IsCheckedTypePopulated(const Expr& e) {
+  CheckedTypePopulated visitor;
+  visitor.VisitExpr(e);
+  return visitor.populated;
+}
+
+bool HasIncompleteType(const Type& type) {
+  struct IncompleteTypeFinder : TypeVisitor {
+    bool found{false};
+    void VisitType_(const IncompleteTypeNode* op) final { found = true; }
+  } finder;
+  finder.VisitType(type);
+  return finder.found;
+}
+
+/*!
+ * \brief Returns the global vars of the Relay functions of a module which must be type checked
+ *  again: the ones with a sub-expression without a checked type, i.e. rewritten since the last
+ *  type inference, and the ones calling them, whose types may depend on the new callee types.
+ */
+std::unordered_set<const GlobalVarNode*> FunctionsToRecheck(const IRModule& mod) {
+  std::unordered_set<const GlobalVarNode*> changed;
+  std::vector<std::pair<const GlobalVarNode*, std::unordered_set<const GlobalVarNode*>>> typed;
+  for (const auto& it : mod->functions) {
+    if (!it.second.as<FunctionNode>()) continue;
+    CheckedTypePopulated visitor;
+    visitor.VisitExpr(Downcast<Function>(it.second));
+    // AddGlobalTypes sets the type annotations, possibly incomplete, of the functions it copies.
+    if (visitor.populated && !HasIncompleteType(it.second->checked_type_)) {
+      typed.emplace_back(it.first.get(), std::move(visitor.global_vars));
+    } else {
+      changed.insert(it.first.get());
+    }
+  }
+  bool grown = !changed.empty();
+  while (grown) {
+    grown = false;
+    for (const auto& it : typed) {
+      if (changed.count(it.first)) continue;
+      for (const GlobalVarNode* callee : it.second) {
+        if (changed.count(callee)) {
+          changed.insert(it.first);
+          grown = true;
+          break;
+        }
+      }
+    }
+  }
+  return changed;
+}
+
 // TODO(@jroesch): Can we optimize this?
 void AddGlobalTypes(IRModule mod) {
   std::vector<std::pair<GlobalVar, Function>> updates;
@@ -949,66 +1038,89 @@ TVM_REGISTER_GLOBAL("relay._transform.InferTypeLocal").set_body_typed([](const E
   return InferTypeLocal(expr);
 });
 
+IRModule InferTypeModule(IRModule mod, const PassContext& pass_ctx, bool incremental) {
+  // Execute the pass function and return a new module.
+  IRModule updated_mod = mod->ShallowCopy();
+
+  pass_ctx->diag_ctx = DiagnosticContext::Default(updated_mod);
+
+  // The functions to check again, computed before the annotations are added below.
+  std::unordered_set<const GlobalVarNode*> recheck;
+  if (incremental) {
+    recheck = FunctionsToRecheck(updated_mod);
+  }
+
+  // Add all the type annotations to the functions in the model.
+  AddGlobalTypes(mod);
+
+  std::vector<std::pair<GlobalVar, Function>> updates;
+  for (const auto& it : updated_mod->functions) {
+    // Currently we don't type check TIR.
+    //
+    // The inferencer will only check Relay functions.
+
+    // In the future we plan a unified type checker
+    // that works on TIR and Relay at the same time.
+    if (auto func = it.second.as<Function>()) {
+      // A function whose sub-expressions all kept the types of the last inference, and which
+      // calls no function checked again, has the same types.
+      if (incremental && !recheck.count(it.first.get())) {
+        it.first->checked_type_ = func.value()->checked_type();
+        continue;
+      }
+
+      // TODO(@jroesch): we should be able to move the type inferencer outside
+      // of this function but it seems to be more stateful then I expect.
+      auto inferencer = TypeInferencer(mod, pass_ctx->diag_ctx.value());
+      auto updated_func = inferencer.Infer(it.first, func.value());
+
+      pass_ctx->diag_ctx.value().Render();
+
+      // After we are done checking write the global type back
+      // into the global var.
+      it.first->checked_type_ = updated_func->checked_type();
+
+      if (!WellFormed(updated_func, pass_ctx->diag_ctx)) {
+        LOG(FATAL) << "The type checked intermediate representation is malformed";
+      }
+
+      auto free_tvars = FreeTypeVars(updated_func, mod);
+      ICHECK(free_tvars.size() == 0)
+          << "Found unbound type variables in " << updated_func << ": " << free_tvars;
+      EnsureCheckedType(updated_func);
+      updates.push_back({it.first, Downcast<Function>(updated_func)});
+    }
+  }
+
+  for (const auto& pair : updates) {
+    updated_mod->Add(pair.first, pair.second, true);
+  }
+
+  return updated_mod;
+}
+
 Pass InferType() {
-  auto pass_info = PassInfo(0, "InferType", {});
   return tvm::transform::CreateModulePass(
       [=](IRModule mod, const PassContext& pass_ctx) {
-        // Execute the pass function and return a new module.
-        IRModule updated_mod = mod->ShallowCopy();
-
-        pass_ctx->diag_ctx = DiagnosticContext::Default(updated_mod);
-
-        // Add all the type annotations to the functions in the model.
-        AddGlobalTypes(mod);
-
-        std::vector<std::pair<GlobalVar, Function>> updates;
-        for (const auto& it : updated_mod->functions) {
-          // Currently we don't type check TIR.
-          //
-          // The inferencer will only check Relay functions.
-
-          // In the future we plan a unified type checker
-          // that works on TIR and Relay at the same time.
-          if (auto func = it.second.as<Function>()) {
-            // // If a function already has type information we can skip checking it.
-            // if (func->checked_type_.defined()) {
-            //   continue;
-            // }
-
-            // TODO(@jroesch): we should be able to move the type inferencer outside
-            // of this function but it seems to be more stateful then I expect.
-            auto inferencer = TypeInferencer(mod, pass_ctx->diag_ctx.value());
-            auto updated_func = inferencer.Infer(it.first, func.value());
-
-            pass_ctx->diag_ctx.value().Render();
-
-            // After we are done checking write the global type back
-            // into the global var.
-            it.first->checked_type_ = updated_func->checked_type();
-
-            if (!WellFormed(updated_func, pass_ctx->diag_ctx)) {
-              LOG(FATAL) << "The type checked intermediate representation is malformed";
-            }
-
-            auto free_tvars = FreeTypeVars(updated_func, mod);
-            ICHECK(free_tvars.size() == 0)
-                << "Found unbound type variables in " << updated_func << ": " << free_tvars;
-            EnsureCheckedType(updated_func);
-            updates.push_back({it.first, Downcast<Function>(updated_func)});
-          }
-        }
-
-        for (const auto& pair : updates) {
-          updated_mod->Add(pair.first, pair.second, true);
-        }
-
-        return updated_mod;
+        return InferTypeModule(mod, pass_ctx, /*incremental=*/false);
       },
       0, "InferType", {});
 }
 
+Pass InferTypeIncremental() {
+  return tvm::transform::CreateModulePass(
+      [=](IRModule mod, const PassContext& pass_ctx) {
+        return InferTypeModule(mod, pass_ctx, /*incremental=*/true);
+      },
+      0, "InferTypeIncremental", {});
+}
+
 TVM_REGISTER_GLOBAL("relay._transform.InferType").set_body_typed([]() { return InferType(); });
 
+TVM_REGISTER_GLOBAL("relay._transform.InferTypeIncremental").set_body_typed([]() {
+  return InferTypeIncremental();
+});
+
 }  // namespace transform
 
 }  // namespace relay
@@ -27,6 +27,7 @@
 
 #include <tvm/runtime/c_runtime_api.h>
 #include <tvm/runtime/data_type.h>
+#include <tvm/runtime/device_api.h>
 #include <tvm/runtime/name_transforms.h>
 
 #include <limits>
@@ -91,6 +92,19 @@ AotExecutor::AotExecutor(tvm::runtime::Module module, const std::vector<Device>&
       args_.emplace_back(NDArray::Empty({pool_len}, DataType::UInt(8), devices_[0]));
     }
   }
+
+  // the arguments of the entrypoint are set up once, the bindings only patch their data
+  call_tensors_.reserve(args_.size());
+  for (const NDArray& arg : args_) {
+    call_tensors_.push_back(*arg.operator->());
+  }
+  for (DLTensor& tensor : call_tensors_) {
+    TVMValue value;
+    value.v_handle = &tensor;
+    call_values_.push_back(value);
+    call_type_codes_.push_back(kTVMDLTensorHandle);
+  }
+  bound_.resize(args_.size());
 }
 
 PackedFunc AotExecutor::GetFunction(const String& name, const ObjectPtr<Object>& sptr_to_self) {
@@ -122,6 +136,32 @@ PackedFunc AotExecutor::GetFunction(const String& name, const ObjectPtr<Object>&
         this->SetOutputZeroCopy(args[0], args[1]);
       }
     });
+  } else if (name == "bind_input" || name == "swap_input") {
+    bool swap = name == "swap_input";
+    return PackedFunc([sptr_to_self, this, swap](TVMArgs args, TVMRetValue* rv) {
+      int in_idx = String::CanConvertFrom(args[0])
+                       ? this->GetInputIndex(tvm::runtime::SanitizeName(args[0].operator String()))
+                       : args[0].operator int();
+      if (swap) {
+        this->SwapInput(in_idx, args[1]);
+      } else {
+        this->BindInput(in_idx, args[1]);
+      }
+    });
+  } else if (name == "bind_output" || name == "swap_output") {
+    bool swap = name == "swap_output";
+    return PackedFunc([sptr_to_self, this, swap](TVMArgs args, TVMRetValue* rv) {
+      int out_idx =
+          String::CanConvertFrom(args[0])
+              ? this->GetOutputIndex(tvm::runtime::SanitizeName(args[0].operator String()))
+              : args[0].operator int();
+      ICHECK_GE(out_idx, 0) << "Invalid output name";
+      if (swap) {
+        this->SwapOutput(out_idx, args[1]);
+      } else {
+        this->BindOutput(out_idx, args[1]);
+      }
+    });
   } else if (name == "get_output") {
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
       if (args.num_args == 2) {
@@ -164,23 +204,16 @@ PackedFunc AotExecutor::GetFunction(const String& name, const ObjectPtr<Object>&
 }
 
 void AotExecutor::Run() {
-  auto pf = module_.GetFunction(
-      get_name_mangled(metadata_->mod_name(), ::tvm::runtime::symbol::tvm_module_main),
-      true /* query_imports */);
-  ICHECK(pf != nullptr) << "Module entrypoint is not defined";
-
-  const int num_args = args_.size();
-  auto call_values = ::std::make_unique<TVMValue[]>(num_args);
-  auto call_type_codes = ::std::make_unique<int[]>(num_args);
-  for (int i = 0; i < num_args; ++i) {
-    auto managed = args_[i].ToDLPack();
-    call_values.get()[i].v_handle = &managed->dl_tensor;
-    call_type_codes.get()[i] = kTVMDLTensorHandle;
+  if (main_ == nullptr) {
+    main_ = module_.GetFunction(
+        get_name_mangled(metadata_->mod_name(), ::tvm::runtime::symbol::tvm_module_main),
+        true /* query_imports */);
+    ICHECK(main_ != nullptr) << "Module entrypoint is not defined";
   }
-
-  TVMArgs args{call_values.get(), call_type_codes.get(), num_args};
+  TVMArgs args{call_values_.data(), call_type_codes_.data(),
+               static_cast<int>(call_values_.size())};
   TVMRetValue rv;
-  pf.CallPacked(args, &rv);
+  main_.CallPacked(args, &rv);
 }
 
 int AotExecutor::GetInputIndex(const std::string& name) {
@@ -208,23 +241,82 @@ int AotExecutor::GetOutputIndex(const std::string& name) {
   return -1;
 }
 
-void AotExecutor::SetInput(int index, DLTensor* data_ref) { args_[index].CopyFrom(data_ref); }
+void AotExecutor::SetInput(int index, DLTensor* data_ref) {
+  // the input is read from its own array again
+  call_tensors_[index].data = args_[index]->data;
+  bound_[index] = NDArray();
+  args_[index].CopyFrom(data_ref);
+}
+
+void AotExecutor::BindArg(size_t i, const DLTensor* external) {
+  const DLTensor* internal = args_[i].operator->();
+  ICHECK_EQ(internal->ndim, external->ndim);
+  for (int k = 0; k < external->ndim; ++k) {
+    ICHECK_EQ(internal->shape[k], external->shape[k]);
+  }
+  ICHECK(TypeEqual(internal->dtype, external->dtype));
+  ICHECK_EQ(internal->device.device_type, external->device.device_type);
+  ICHECK_EQ(internal->device.device_id, external->device.device_id);
+  void* data = static_cast<char*>(external->data) + external->byte_offset;
+  ICHECK_EQ(reinterpret_cast<size_t>(data) % kAllocAlignment, 0);
+  call_tensors_[i].data = data;
+  bound_[i] = NDArray();
+}
+
+void AotExecutor::SwapArg(size_t i, NDArray data) {
+  ICHECK(bound_[i].defined()) << "The array should be bound before it is swapped";
+  ICHECK(data->device.device_type == bound_[i]->device.device_type &&
+         data->device.device_id == bound_[i]->device.device_id &&
+         GetDataSize(*data.operator->()) == GetDataSize(*bound_[i].operator->()))
+      << "The swapped array should be of the size and on the device of the bound one";
+  void* ptr = static_cast<char*>(data->data) + data->byte_offset;
+  ICHECK_EQ(reinterpret_cast<size_t>(ptr) % kAllocAlignment, 0);
+  call_tensors_[i].data = ptr;
+  bound_[i] = std::move(data);
+}
 
 void AotExecutor::SetInputZeroCopy(int index, DLTensor* data_ref) {
-  ICHECK(false) << "not implemented";
+  ICHECK_LT(index, NumInputs());
+  BindArg(index, data_ref);
 }
 
 void AotExecutor::SetOutputZeroCopy(int index, DLTensor* data_ref) {
-  ICHECK(false) << "not implemented";
+  ICHECK_LT(index, NumOutputs());
+  BindArg(NumInputs() + index, data_ref);
+}
+
+void AotExecutor::BindInput(int index, NDArray data) {
+  SetInputZeroCopy(index, const_cast<DLTensor*>(data.operator->()));
+  bound_[index] = std::move(data);
+}
+
+void AotExecutor::BindOutput(int index, NDArray data) {
+  SetOutputZeroCopy(index, const_cast<DLTensor*>(data.operator->()));
+  bound_[NumInputs() + index] = std::move(data);
+}
+
+void AotExecutor::SwapInput(int index, NDArray data) {
+  ICHECK_LT(index, NumInputs());
+  SwapArg(index, std::move(data));
+}
+
+void AotExecutor::SwapOutput(int index, NDArray data) {
+  ICHECK_LT(index, NumOutputs());
+  SwapArg(NumInputs() + index, std::move(data));
 }
 
 int AotExecutor::NumOutputs() const { return metadata_->num_outputs(); }
 
 int AotExecutor::NumInputs() const { return metadata_->num_inputs(); }
 
-NDArray AotExecutor::GetInput(int index) const { return args_[index]; }
+NDArray AotExecutor::GetInput(int index) const {
+  return bound_[index].defined() ? bound_[index] : args_[index];
+}
 
-NDArray AotExecutor::GetOutput(int index) const { return args_[metadata_->num_inputs() + index]; }
+NDArray AotExecutor::GetOutput(int index) const {
+  size_t i = metadata_->num_inputs() + index;
+  return bound_[i].defined() ? bound_[i] : args_[i];
+}
 
 void AotExecutor::CopyOutputTo(int index, DLTensor* data_out) { GetOutput(index).CopyTo(data_out); }
 
@@ -104,6 +104,33 @@ class TVM_DLL AotExecutor : public ModuleNode {
    * \param data_ref The output data that is referred.
    */
   void SetOutputZeroCopy(int index, DLTensor* data_ref);
+  /*!
+   * \brief Bind index-th input to data for all the following runs, as SetInputZeroCopy but
+   *  holding a reference to data until the input is bound or set again.
+   * \param index The input index.
+   * \param data The input data that is referred.
+   */
+  void BindInput(int index, NDArray data);
+  /*!
+   * \brief Bind index-th output to data for all the following runs, as SetOutputZeroCopy but
+   *  holding a reference to data until the output is bound again.
+   * \param index The output index.
+   * \param data The output data that is referred.
+   */
+  void BindOutput(int index, NDArray data);
+  /*!
+   * \brief Swap the bound index-th input for data of the same size on the same device, only the
+   *  pointer passed to the entrypoint changes, e.g. to alternate between two buffers.
+   * \param index The input index.
+   * \param data The input data that is referred.
+   */
+  void SwapInput(int index, NDArray data);
+  /*!
+   * \brief Swap the bound index-th output for data of the same size on the same device.
+   * \param index The output index.
+   * \param data The output data that is referred.
+   */
+  void SwapOutput(int index, NDArray data);
   /*!
    * \brief Get the number of outputs
    *
@@ -138,6 +165,14 @@ class TVM_DLL AotExecutor : public ModuleNode {
   void CopyOutputTo(int index, DLTensor* data_out);
 
  private:
+  /*!
+   * \brief Point the i-th argument of the entrypoint to external after checking it matches the
+   *  argument.
+   */
+  void BindArg(size_t i, const DLTensor* external);
+  /*! \brief Swap the array bound to the i-th argument for data of the same size. */
+  void SwapArg(size_t i, NDArray data);
+
   /*! \brief Metadata provided to the runtime from the compiler. */
   metadata::Metadata metadata_;
 
@@ -149,6 +184,17 @@ class TVM_DLL AotExecutor : public ModuleNode {
 
   /*! \brief Holds one NDArray per function argument in the same order. */
   std::vector<NDArray> args_;
+
+  /*! \brief The arguments of the entrypoint, the DLTensors of args_ or of the bound data. */
+  std::vector<DLTensor> call_tensors_;
+  std::vector<TVMValue> call_values_;
+  std::vector<int> call_type_codes_;
+
+  /*! \brief The arrays bound by BindInput and BindOutput, undefined for the others. */
+  std::vector<NDArray> bound_;
+
+  /*! \brief The module entrypoint, looked up by the first run. */
+  PackedFunc main_;
 };
 
 }  // namespace runtime
@@ -22,9 +22,14 @@
  */
 
 #include <dlpack/dlpack.h>
+#include <tvm/runtime/c_backend_api.h>
 #include <tvm/runtime/registry.h>
 
 #include <algorithm>
+#include <array>
+#include <cstring>
+#include <functional>
+#include <numeric>
 #include <vector>
 
 #include "../../../../3rdparty/compiler-rt/builtin_fp16.h"
@@ -34,26 +39,44 @@ namespace contrib {
 
 using namespace runtime;
 
+// Whether x is a NaN, never for the integer types.
+template <typename DType>
+bool IsNaN(const DType& x) {
+  return x != x;
+}
+
+// Whether lhs sorts before rhs. The NaNs sort after all the other values in both orders and are
+// equivalent, as are -0.0 and 0.0, so that this is a strict weak ordering of the floats, the same
+// as the one of the radix keys.
+template <typename DType>
+bool SortsBefore(const DType& lhs, const DType& rhs, bool is_ascend) {
+  if (IsNaN(lhs) || IsNaN(rhs)) {
+    return !IsNaN(lhs);
+  }
+  return is_ascend ? lhs < rhs : lhs > rhs;
+}
+
 template <typename DType, bool stable_comparison = false>
 bool CompareAscend(const std::pair<int64_t, DType>& lhs, const std::pair<int64_t, DType>& rhs) {
   if constexpr (stable_comparison) {
-    if (lhs.second == rhs.second) {
+    if (!SortsBefore(lhs.second, rhs.second, true) && !SortsBefore(rhs.second, lhs.second, true)) {
       return lhs.first < rhs.first;
     }
   }
 
-  return lhs.second < rhs.second;
+  return SortsBefore(lhs.second, rhs.second, true);
 }
 
 template <typename DType, bool stable_comparison = false>
 bool CompareDescend(const std::pair<int64_t, DType>& lhs, const std::pair<int64_t, DType>& rhs) {
   if constexpr (stable_comparison) {
-    if (lhs.second == rhs.second) {
+    if (!SortsBefore(lhs.second, rhs.second, false) &&
+        !SortsBefore(rhs.second, lhs.second, false)) {
       return lhs.first < rhs.first;
     }
   }
 
-  return lhs.second > rhs.second;
+  return SortsBefore(lhs.second, rhs.second, false);
 }
 
 struct float16 {
@@ -70,6 +93,219 @@ struct float16 {
   inline bool operator>=(const float16& rhs) const { return to_float() >= rhs.to_float(); }
 };
 
+// The rows of at least this many elements are sorted by the radix sort.
+constexpr int64_t kRadixSortMinLength = 256;
+// The sorts of fewer elements in total run on the calling thread.
+constexpr int64_t kParallelMinElements = 1 << 14;
+
+// Runs fn(begin, end) on the chunks of the rows [0, num_rows) on the TVM thread pool, a task keeps
+// its scratch buffers across the rows of its chunk.
+template <typename F>
+void ParallelForRows(int64_t num_rows, int64_t row_length, const F& fn) {
+  struct ParallelTask {
+    static int RunTask(int task_id, TVMParallelGroupEnv* penv, void* cdata) {
+      ParallelTask* task = static_cast<ParallelTask*>(cdata);
+      int64_t chunk_size = (task->num_rows + penv->num_task - 1) / penv->num_task;
+      int64_t st = std::min(task_id * chunk_size, task->num_rows);
+      int64_t ed = std::min(st + chunk_size, task->num_rows);
+      if (st < ed) {
+        (*task->fn)(st, ed);
+      }
+      return 0;
+    }
+
+    const F* fn;
+    int64_t num_rows;
+  };
+
+  if (num_rows <= 1 || num_rows * row_length < kParallelMinElements) {
+    fn(0, num_rows);
+    return;
+  }
+  ParallelTask task{&fn, num_rows};
+  int res = TVMBackendParallelLaunch(ParallelTask::RunTask, &task, 0);
+  ICHECK_EQ(res, 0) << "Sort: TVMBackendParallelLaunch failed";
+}
+
+// The order preserving map of the values to the unsigned keys of the radix sort. The NaNs get the
+// largest key, kept by the descending order (see RowSorter::Sort), so they sort last as with
+// SortsBefore.
+template <typename DType>
+struct RadixKey {
+  static constexpr bool enabled = false;
+  using KeyType = uint32_t;
+};
+
+template <>
+struct RadixKey<int32_t> {
+  static constexpr bool enabled = true;
+  using KeyType = uint32_t;
+  static KeyType Get(int32_t x) { return static_cast<uint32_t>(x) ^ 0x80000000u; }
+};
+
+template <>
+struct RadixKey<int64_t> {
+  static constexpr bool enabled = true;
+  using KeyType = uint64_t;
+  static KeyType Get(int64_t x) { return static_cast<uint64_t>(x) ^ 0x8000000000000000ull; }
+};
+
+template <>
+struct RadixKey<float> {
+  static constexpr bool enabled = true;
+  using KeyType = uint32_t;
+  static KeyType Get(float x) {
+    if (IsNaN(x)) return ~KeyType(0);
+    // -0.0 and 0.0 compare equal, they get the same key
+    x = x == 0.0f ? 0.0f : x;
+    uint32_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+  }
+};
+
+template <>
+struct RadixKey<double> {
+  static constexpr bool enabled = true;
+  using KeyType = uint64_t;
+  static KeyType Get(double x) {
+    if (IsNaN(x)) return ~KeyType(0);
+    x = x == 0.0 ? 0.0 : x;
+    uint64_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    return (bits & 0x8000000000000000ull) ? ~bits : bits | 0x8000000000000000ull;
+  }
+};
+
+// Sorts keys and the indices along with them by a stable LSD radix sort of 8 bit digits. The
+// histograms of all the digits are counted in one pass over the keys, and the digits shared by all
+// the keys are skipped.
+template <typename KeyType>
+void RadixSort(std::vector<KeyType>* keys, std::vector<int64_t>* indices,
+               std::vector<KeyType>* keys_buf, std::vector<int64_t>* indices_buf) {
+  constexpr int kDigits = sizeof(KeyType);
+  constexpr int kBins = 256;
+  size_t n = keys->size();
+  if (n < 2) {
+    return;
+  }
+  std::array<std::array<size_t, kBins>, kDigits> hist{};
+  const KeyType* key_ptr = keys->data();
+  for (size_t i = 0; i < n; ++i) {
+    for (int d = 0; d < kDigits; ++d) {
+      hist[d][(key_ptr[i] >> (8 * d)) & (kBins - 1)]++;
+    }
+  }
+  keys_buf->resize(n);
+  indices_buf->resize(n);
+  for (int d = 0; d < kDigits; ++d) {
+    if (hist[d][((*keys)[0] >> (8 * d)) & (kBins - 1)] == n) {
+      continue;
+    }
+    size_t offset = 0;
+    for (int b = 0; b < kBins; ++b) {
+      size_t count = hist[d][b];
+      hist[d][b] = offset;
+      offset += count;
+    }
+    const KeyType* src_keys = keys->data();
+    const int64_t* src_indices = indices->data();
+    KeyType* dst_keys = keys_buf->data();
+    int64_t* dst_indices = indices_buf->data();
+    for (size_t i = 0; i < n; ++i) {
+      size_t pos = hist[d][(src_keys[i] >> (8 * d)) & (kBins - 1)]++;
+      dst_keys[pos] = src_keys[i];
+      dst_indices[pos] = src_indices[i];
+    }
+    keys->swap(*keys_buf);
+    indices->swap(*indices_buf);
+  }
+}
+
+// Sorts the rows of DataType, the scratch buffers are reused across the rows sorted by a task.
+template <typename DataType>
+class RowSorter {
+ public:
+  // The indices of value(0), ..., value(n - 1) in the order of their stable sort. The long rows of
+  // the types with a radix key are sorted by the radix sort of their keys, stored apart from the
+  // indices: the descending order sorts the complemented keys but the ones of the NaNs, the ties
+  // stay in index order.
+  template <typename ValueFn>
+  const std::vector<int64_t>& Sort(int64_t n, ValueFn value, bool is_ascend) {
+    order_.resize(n);
+    if constexpr (RadixKey<DataType>::enabled) {
+      if (n >= kRadixSortMinLength) {
+        keys_.resize(n);
+        for (int64_t k = 0; k < n; ++k) {
+          DataType v = value(k);
+          KeyType key = RadixKey<DataType>::Get(v);
+          keys_[k] = is_ascend || IsNaN(v) ? key : ~key;
+          order_[k] = k;
+        }
+        RadixSort(&keys_, &order_, &keys_buf_, &order_buf_);
+        return order_;
+      }
+    }
+    sorter_.clear();
+    for (int64_t k = 0; k < n; ++k) {
+      sorter_.emplace_back(k, value(k));
+    }
+    if (is_ascend) {
+      std::stable_sort(sorter_.begin(), sorter_.end(), CompareAscend<DataType>);
+    } else {
+      std::stable_sort(sorter_.begin(), sorter_.end(), CompareDescend<DataType>);
+    }
+    for (int64_t k = 0; k < n; ++k) {
+      order_[k] = sorter_[k].first;
+    }
+    return order_;
+  }
+
+ private:
+  using KeyType = typename RadixKey<DataType>::KeyType;
+
+  std::vector<std::pair<int64_t, DataType>> sorter_;
+  std::vector<KeyType> keys_;
+  std::vector<KeyType> keys_buf_;
+  std::vector<int64_t> order_;
+  std::vector<int64_t> order_buf_;
+};
+
+template <typename DataType>
+void argsort_nms(DLTensor* input, DLTensor* sort_num, DLTensor* output, int32_t axis,
+                 bool is_ascend) {
+  auto data_ptr = static_cast<DataType*>(input->data);
+  auto sort_num_ptr = static_cast<int32_t*>(sort_num->data);
+  auto out_ptr = static_cast<int32_t*>(output->data);
+  int64_t axis_mul_before = 1;
+  int64_t axis_mul_after = 1;
+  for (int i = 0; i < input->ndim; ++i) {
+    if (i < axis) {
+      axis_mul_before *= input->shape[i];
+    } else if (i > axis) {
+      axis_mul_after *= input->shape[i];
+    }
+  }
+  int64_t axis_len = input->shape[axis];
+
+  ParallelForRows(axis_mul_before * axis_mul_after, axis_len, [&](int64_t begin, int64_t end) {
+    RowSorter<DataType> sorter;
+    for (int64_t row = begin; row < end; ++row) {
+      int64_t i = row / axis_mul_after;
+      int64_t j = row % axis_mul_after;
+      int64_t current_sort_num = std::max(sort_num_ptr[row], 0);
+      int64_t base_idx = i * axis_len * axis_mul_after + j;
+      const std::vector<int64_t>& order = sorter.Sort(
+          current_sort_num, [&](int64_t k) { return data_ptr[base_idx + k * axis_mul_after]; },
+          is_ascend);
+      for (int64_t k = 0; k < axis_len; ++k) {
+        out_ptr[base_idx + k * axis_mul_after] =
+            static_cast<int32_t>(k < current_sort_num ? order[k] : k);
+      }
+    }
+  });
+}
+
 // Argsort implemented C library sort for nms.
 // Return indices of sorted tensor.
 // By default, the last axis will be used to sort.
@@ -85,11 +321,6 @@ TVM_REGISTER_GLOBAL("tvm.contrib.sort.argsort_nms").set_body([](TVMArgs args, TV
   bool is_ascend = args[4];
 
   auto dtype = input->dtype;
-  auto data_ptr = static_cast<float*>(input->data);
-  auto sort_num_ptr = static_cast<int32_t*>(sort_num->data);
-  std::vector<std::pair<int32_t, float>> sorter;
-  int64_t axis_mul_before = 1;
-  int64_t axis_mul_after = 1;
 
   if (axis < 0) {
     axis = input->ndim + axis;
@@ -106,50 +337,13 @@ TVM_REGISTER_GLOBAL("tvm.contrib.sort.argsort_nms").set_body([](TVMArgs args, TV
                                   "input ndim "
                                << input->ndim;
 
-  for (int i = 0; i < input->ndim; ++i) {
-    if (i < axis) {
-      axis_mul_before *= input->shape[i];
-    } else if (i > axis) {
-      axis_mul_after *= input->shape[i];
-    }
-  }
-
-  for (int64_t i = 0; i < axis_mul_before; ++i) {
-    for (int64_t j = 0; j < axis_mul_after; ++j) {
-      sorter.clear();
-      int32_t current_sort_num = *(sort_num_ptr + i * axis_mul_after + j);
-      int64_t base_idx = i * input->shape[axis] * axis_mul_after + j;
-      for (int64_t k = 0; k < current_sort_num; ++k) {
-        int64_t full_idx = base_idx + k * axis_mul_after;
-        sorter.emplace_back(std::make_pair(k, *(data_ptr + full_idx)));
-      }
-      if (is_ascend) {
-#if (__ARM_FEATURE_FP16_SCALAR_ARITHMETIC == 1)
-        if (dtype.bits == 16) {
-          std::stable_sort(sorter.begin(), sorter.end(), CompareAscend<__fp16>);
-        } else {
-#endif
-          std::stable_sort(sorter.begin(), sorter.end(), CompareAscend<float>);
-#if (__ARM_FEATURE_FP16_SCALAR_ARITHMETIC == 1)
-        }
-#endif
-      } else {
 #if (__ARM_FEATURE_FP16_SCALAR_ARITHMETIC == 1)
-        if (dtype.bits == 16) {
-          std::stable_sort(sorter.begin(), sorter.end(), CompareDescend<__fp16>);
-        } else {
-#endif
-          std::stable_sort(sorter.begin(), sorter.end(), CompareDescend<float>);
-#if (__ARM_FEATURE_FP16_SCALAR_ARITHMETIC == 1)
-        }
-#endif
-      }
-      for (int32_t k = 0; k < input->shape[axis]; ++k) {
-        *(static_cast<int32_t*>(output->data) + base_idx + k * axis_mul_after) =
-            k < static_cast<int32_t>(sorter.size()) ? sorter[k].first : k;
-      }
-    }
+  if (dtype.bits == 16) {
+    argsort_nms<__fp16>(input, sort_num, output, axis, is_ascend);
+    return;
   }
+#endif
+  argsort_nms<float>(input, sort_num, output, axis, is_ascend);
 });
 
 template <typename DataType, typename OutType>
@@ -158,10 +352,9 @@ void sort_impl(
     std::function<void(OutType*, size_t, const std::pair<int64_t, DataType>&)> epilogue) {
   auto data_ptr = static_cast<DataType*>(input->data);
   auto out_ptr = static_cast<OutType*>(output->data);
-  std::vector<std::pair<int64_t, DataType>> sorter;
 
-  int axis_mul_before = 1;
-  int axis_mul_after = 1;
+  int64_t axis_mul_before = 1;
+  int64_t axis_mul_after = 1;
   for (int i = 0; i < input->ndim; ++i) {
     if (i < axis) {
       axis_mul_before *= input->shape[i];
@@ -169,25 +362,21 @@ void sort_impl(
       axis_mul_after *= input->shape[i];
     }
   }
-
-  for (int i = 0; i < axis_mul_before; ++i) {
-    for (int j = 0; j < axis_mul_after; ++j) {
-      sorter.clear();
-      int64_t base_idx = i * input->shape[axis] * axis_mul_after + j;
-      for (int64_t k = 0; k < input->shape[axis]; ++k) {
-        int64_t full_idx = base_idx + k * axis_mul_after;
-        sorter.emplace_back(std::make_pair(k, data_ptr[full_idx]));
-      }
-      if (is_ascend) {
-        std::stable_sort(sorter.begin(), sorter.end(), CompareAscend<DataType>);
-      } else {
-        std::stable_sort(sorter.begin(), sorter.end(), CompareDescend<DataType>);
-      }
-      for (int64_t k = 0; k < input->shape[axis]; ++k) {
-        epilogue(out_ptr, base_idx + k * axis_mul_after, sorter[k]);
+  int64_t axis_len = input->shape[axis];
+
+  ParallelForRows(axis_mul_before * axis_mul_after, axis_len, [&](int64_t begin, int64_t end) {
+    RowSorter<DataType> sorter;
+    for (int64_t row = begin; row < end; ++row) {
+      int64_t i = row / axis_mul_after;
+      int64_t j = row % axis_mul_after;
+      int64_t base_idx = i * axis_len * axis_mul_after + j;
+      auto value = [&](int64_t k) { return data_ptr[base_idx + k * axis_mul_after]; };
+      const std::vector<int64_t>& order = sorter.Sort(axis_len, value, is_ascend);
+      for (int64_t k = 0; k < axis_len; ++k) {
+        epilogue(out_ptr, base_idx + k * axis_mul_after, std::make_pair(order[k], value(order[k])));
       }
     }
-  }
+  });
 }
 
 template <typename DataType, typename OutType>
@@ -355,14 +544,8 @@ void topk(DLTensor* input, DLTensor* out_values, DLTensor* out_indices, int k, i
   IndicesType* indices_ptr =
       (out_indices == nullptr) ? nullptr : static_cast<IndicesType*>(out_indices->data);
 
-  // Maintain a min/max containing the top-k elements
-  std::vector<std::pair<int64_t, DataType>> running_heap;
-
-  // Need +1 when inserting new element before maintaining heap invariant
-  running_heap.reserve(k + 1);
-
-  int axis_mul_before = 1;
-  int axis_mul_after = 1;
+  int64_t axis_mul_before = 1;
+  int64_t axis_mul_after = 1;
   for (int i = 0; i < input->ndim; ++i) {
     if (i < axis) {
       axis_mul_before *= input->shape[i];
@@ -370,66 +553,48 @@ void topk(DLTensor* input, DLTensor* out_values, DLTensor* out_indices, int k, i
       axis_mul_after *= input->shape[i];
     }
   }
+  int64_t axis_len = input->shape[axis];
   if (k < 1) {
-    k = input->shape[axis];
+    k = axis_len;
   }
-
-  for (int i = 0; i < axis_mul_before; ++i) {
-    for (int j = 0; j < axis_mul_after; ++j) {
-      running_heap.clear();
-      int64_t src_base_idx = i * input->shape[axis] * axis_mul_after + j;
+  int64_t num_selected = std::min<int64_t>(k, axis_len);
+
+  ParallelForRows(axis_mul_before * axis_mul_after, axis_len, [&](int64_t begin, int64_t end) {
+    // The values of the row and the indices being selected, apart.
+    std::vector<DataType> values(axis_len);
+    std::vector<int64_t> order(axis_len);
+    // Selects the first num_selected indices in the order of compare without sorting the rest of
+    // the row: compare is a total order, SortsBefore then the smaller index first among the
+    // equivalent values, so the selection is the one of the stable sort.
+    auto compare = [&](int64_t lhs, int64_t rhs) {
+      if (SortsBefore(values[lhs], values[rhs], is_ascend)) return true;
+      if (SortsBefore(values[rhs], values[lhs], is_ascend)) return false;
+      return lhs < rhs;
+    };
+    for (int64_t row = begin; row < end; ++row) {
+      int64_t i = row / axis_mul_after;
+      int64_t j = row % axis_mul_after;
+      int64_t src_base_idx = i * axis_len * axis_mul_after + j;
       int64_t dst_base_idx = i * k * axis_mul_after + j;
-
-      // Start by creating min/max heap with fixed-k elements
-      int cur_axis_index = 0;
-      for (; cur_axis_index < k && cur_axis_index < input->shape[axis]; cur_axis_index++) {
-        int64_t full_idx = src_base_idx + cur_axis_index * axis_mul_after;
-        running_heap.emplace_back(std::make_pair(cur_axis_index, data_ptr[full_idx]));
+      for (int64_t kk = 0; kk < axis_len; ++kk) {
+        values[kk] = data_ptr[src_base_idx + kk * axis_mul_after];
       }
-      if (!is_ascend) {
-        std::make_heap(running_heap.begin(), running_heap.end(), CompareDescend<DataType, true>);
-      } else {
-        std::make_heap(running_heap.begin(), running_heap.end(), CompareAscend<DataType, true>);
+      std::iota(order.begin(), order.end(), 0);
+      if (num_selected < axis_len) {
+        std::nth_element(order.begin(), order.begin() + num_selected, order.end(), compare);
       }
+      std::sort(order.begin(), order.begin() + num_selected, compare);
 
-      // Iterate through all elements, adding to heap along the way
-      for (; cur_axis_index < input->shape[axis]; cur_axis_index++) {
-        int64_t full_idx = src_base_idx + cur_axis_index * axis_mul_after;
-        std::pair<int64_t, DataType> cur_val = {cur_axis_index, data_ptr[full_idx]};
-
-        // Eq. to cur_val.second > running_heap.second
-        if (!is_ascend && CompareDescend<DataType, true>(cur_val, running_heap[0])) {
-          running_heap.push_back(cur_val);
-          std::push_heap(running_heap.begin(), running_heap.end(), CompareDescend<DataType, true>);
-          std::pop_heap(running_heap.begin(), running_heap.end(), CompareDescend<DataType, true>);
-          running_heap.pop_back();
-        } else if (is_ascend && CompareAscend<DataType, true>(cur_val, running_heap[0])) {
-          running_heap.push_back(cur_val);
-          std::push_heap(running_heap.begin(), running_heap.end(), CompareAscend<DataType, true>);
-          std::pop_heap(running_heap.begin(), running_heap.end(), CompareAscend<DataType, true>);
-          running_heap.pop_back();
-        }
-      }
-
-      // finally sort heap and deliver results
-      if (is_ascend) {
-        std::stable_sort(running_heap.begin(), running_heap.end(), CompareAscend<DataType, true>);
-      } else {
-        std::stable_sort(running_heap.begin(), running_heap.end(), CompareDescend<DataType, true>);
-      }
-
-      for (uint32_t kk = 0; kk < running_heap.size(); ++kk) {
+      for (int64_t kk = 0; kk < num_selected; ++kk) {
         if (indices_ptr != nullptr) {
-          indices_ptr[dst_base_idx + kk * axis_mul_after] =
-              static_cast<IndicesType>(running_heap[kk].first);
+          indices_ptr[dst_base_idx + kk * axis_mul_after] = static_cast<IndicesType>(order[kk]);
         }
         if (values_ptr != nullptr) {
-          values_ptr[dst_base_idx + kk * axis_mul_after] =
-              static_cast<DataType>(running_heap[kk].second);
+          values_ptr[dst_base_idx + kk * axis_mul_after] = values[order[kk]];
         }
       }
     }
-  }
+  });
 }
 
 // Argsort implemented C library sort.
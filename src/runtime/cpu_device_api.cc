@@ -24,18 +24,71 @@
 #include <tvm/runtime/device_api.h>
 #include <tvm/runtime/logging.h>
 #include <tvm/runtime/registry.h>
+#include <tvm/runtime/threading_backend.h>
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
+#include <string>
+#include <vector>
 
 #include "workspace_pool.h"
 
 #ifdef __ANDROID__
 #include <android/api-level.h>
 #endif
+#if defined(__linux__) && !defined(__ANDROID__)
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 namespace tvm {
 namespace runtime {
+
+#if defined(__linux__) && !defined(__ANDROID__)
+/*!
+ * \brief Place the pages of a large allocation by the NUMA policy of TVM_NUMA_ALLOC: "local" on the
+ *  node of the allocating thread, "interleave" round robin over the nodes (the weights read by the
+ *  workers of all the nodes), the first touch of the kernel otherwise. The policy applies to the
+ *  first fault of the pages, and the pages malloc reuses already faulted in are moved with
+ *  MPOL_MF_MOVE.
+ */
+static void PlaceOnNumaNodes(void* ptr, size_t nbytes) {
+  static const int policy = [] {
+    const char* val = getenv("TVM_NUMA_ALLOC");
+    std::string name = val ? val : "";
+    if (threading::NumaNodeCount() < 2) return -1;
+    if (name == "local") return static_cast<int>(MPOL_PREFERRED);
+    if (name == "interleave") return static_cast<int>(MPOL_INTERLEAVE);
+    return -1;
+  }();
+  if (policy < 0) return;
+  int num_nodes = threading::NumaNodeCount();
+  std::vector<unsigned long> mask((num_nodes + 63) / 64, 0);  // NOLINT(runtime/int)
+  if (policy == MPOL_PREFERRED) {
+    int node = threading::NumaNodeOfCpu(sched_getcpu());
+    mask[node / 64] |= 1UL << (node % 64);
+  } else {
+    for (int node = 0; node < num_nodes; ++node) mask[node / 64] |= 1UL << (node % 64);
+  }
+  syscall(SYS_mbind, ptr, nbytes, policy, mask.data(), mask.size() * 64 + 1, MPOL_MF_MOVE);
+}
+
+/*! \return The size of the pages mbind places, 4KB if sysconf does not know it. */
+static size_t PageBytes() {
+  static const size_t bytes = [] {
+    long val = sysconf(_SC_PAGESIZE);  // NOLINT(runtime/int)
+    return val > 0 ? static_cast<size_t>(val) : size_t{4096};
+  }();
+  return bytes;
+}
+#endif
+
+// the allocations placed by TVM_NUMA_ALLOC, aligned to the pages
+constexpr size_t kNumaMinBytes = 1 << 20;
+
 class CPUDeviceAPI final : public DeviceAPI {
  public:
   void SetDevice(Device dev) final {}
@@ -53,9 +106,15 @@ class CPUDeviceAPI final : public DeviceAPI {
     ptr = memalign(alignment, nbytes);
     if (ptr == nullptr) throw std::bad_alloc();
 #else
+#if defined(__linux__) && !defined(__ANDROID__)
+    if (nbytes >= kNumaMinBytes) alignment = std::max(alignment, PageBytes());
+#endif
     // posix_memalign is available in android ndk since __ANDROID_API__ >= 17
     int ret = posix_memalign(&ptr, alignment, nbytes);
     if (ret != 0) throw std::bad_alloc();
+#if defined(__linux__) && !defined(__ANDROID__)
+    if (nbytes >= kNumaMinBytes) PlaceOnNumaNodes(ptr, nbytes);
+#endif
 #endif
     return ptr;
   }
@@ -32,6 +32,19 @@
 
 #include "crt_config.h"
 
+#ifdef TVM_CRT_STATIC_ARENA
+// The workspace of the model is planned at compile time with tir.usmp.static_arena, the generated
+// code does not allocate and no memory manager is linked through these functions.
+void* TVMBackendAllocWorkspace(int device_type, int device_id, uint64_t nbytes, int dtype_code_hint,
+                               int dtype_bits_hint) {
+  TVMPlatformAbort(kTvmErrorPlatformNoMemory);
+  return 0;
+}
+
+int TVMBackendFreeWorkspace(int device_type, int device_id, void* ptr) {
+  return kTvmErrorPlatformCheckFailure;
+}
+#else
 void* TVMBackendAllocWorkspace(int device_type, int device_id, uint64_t nbytes, int dtype_code_hint,
                                int dtype_bits_hint) {
   tvm_crt_error_t err = kTvmErrorNoError;
@@ -51,6 +64,7 @@ int TVMBackendFreeWorkspace(int device_type, int device_id, void* ptr) {
   err = TVMPlatformMemoryFree(ptr, dev);
   return err;
 }
+#endif  // TVM_CRT_STATIC_ARENA
 
 int TVMBackendParallelLaunch(FTVMParallelLambda flambda, void* cdata, int num_task) {
   TVMParallelGroupEnv env;
@@ -28,13 +28,41 @@
 #include <tvm/runtime/profiling.h>
 #include <tvm/runtime/registry.h>
 
+#include <cstdlib>
 #include <cstring>
+#include <mutex>
+#include <unordered_map>
 
 #include "cuda_common.h"
 
 namespace tvm {
 namespace runtime {
 
+#if CUDART_VERSION >= 11020
+/*!
+ * \brief Whether the device has the stream ordered allocator. Its default memory pool is given the
+ * release threshold of TVM_CUDA_MEMPOOL_RELEASE_THRESHOLD (bytes, unlimited by default) on the
+ * first query, the pool keeps up to that much of the freed memory across the synchronizations.
+ */
+static bool CUDAMemPoolReady(int device_id) {
+  static std::mutex mu;
+  static std::unordered_map<int, bool> ready;
+  std::lock_guard<std::mutex> lock(mu);
+  auto it = ready.find(device_id);
+  if (it != ready.end()) return it->second;
+  int supported = 0;
+  CUDA_CALL(cudaDeviceGetAttribute(&supported, cudaDevAttrMemoryPoolsSupported, device_id));
+  if (supported) {
+    const char* val = std::getenv("TVM_CUDA_MEMPOOL_RELEASE_THRESHOLD");
+    uint64_t threshold = val != nullptr ? std::strtoull(val, nullptr, 10) : UINT64_MAX;
+    cudaMemPool_t pool;
+    CUDA_CALL(cudaDeviceGetDefaultMemPool(&pool, device_id));
+    CUDA_CALL(cudaMemPoolSetAttribute(pool, cudaMemPoolAttrReleaseThreshold, &threshold));
+  }
+  return ready[device_id] = supported != 0;
+}
+#endif
+
 class CUDADeviceAPI final : public DeviceAPI {
  public:
   void SetDevice(Device dev) final { CUDA_CALL(cudaSetDevice(dev.device_id)); }
@@ -142,6 +170,31 @@ class CUDADeviceAPI final : public DeviceAPI {
     }
   }
 
+  void* AllocDataSpaceAsync(Device dev, size_t nbytes, size_t alignment, DLDataType type_hint,
+                            TVMStreamHandle stream) final {
+#if CUDART_VERSION >= 11020
+    if (dev.device_type == kDLCUDA && CUDAMemPoolReady(dev.device_id)) {
+      ICHECK_EQ(256 % alignment, 0U) << "CUDA space is aligned at 256 bytes";
+      void* ret;
+      CUDA_CALL(cudaSetDevice(dev.device_id));
+      CUDA_CALL(cudaMallocAsync(&ret, nbytes, static_cast<cudaStream_t>(stream)));
+      return ret;
+    }
+#endif
+    return AllocDataSpace(dev, nbytes, alignment, type_hint);
+  }
+
+  void FreeDataSpaceAsync(Device dev, void* ptr, TVMStreamHandle stream) final {
+#if CUDART_VERSION >= 11020
+    if (dev.device_type == kDLCUDA && CUDAMemPoolReady(dev.device_id)) {
+      CUDA_CALL(cudaSetDevice(dev.device_id));
+      CUDA_CALL(cudaFreeAsync(ptr, static_cast<cudaStream_t>(stream)));
+      return;
+    }
+#endif
+    FreeDataSpace(dev, ptr);
+  }
+
  protected:
   void CopyDataFromTo(const void* from, size_t from_offset, void* to, size_t to_offset, size_t size,
                       Device dev_from, Device dev_to, DLDataType type_hint,
@@ -212,10 +265,42 @@ class CUDADeviceAPI final : public DeviceAPI {
     CUDA_CALL(cudaStreamSynchronize(static_cast<cudaStream_t>(stream)));
   }
 
+  TVMEventHandle CreateEvent(Device dev) final {
+    CUDA_CALL(cudaSetDevice(dev.device_id));
+    cudaEvent_t evt;
+    CUDA_CALL(cudaEventCreateWithFlags(&evt, cudaEventDisableTiming));
+    return static_cast<TVMEventHandle>(evt);
+  }
+
+  void FreeEvent(Device dev, TVMEventHandle event) final {
+    CUDA_CALL(cudaSetDevice(dev.device_id));
+    CUDA_CALL(cudaEventDestroy(static_cast<cudaEvent_t>(event)));
+  }
+
+  void RecordEvent(Device dev, TVMEventHandle event, TVMStreamHandle stream) final {
+    CUDA_CALL(cudaSetDevice(dev.device_id));
+    CUDA_CALL(cudaEventRecord(static_cast<cudaEvent_t>(event), static_cast<cudaStream_t>(stream)));
+  }
+
+  void EventSync(Device dev, TVMEventHandle event) final {
+    CUDA_CALL(cudaSetDevice(dev.device_id));
+    CUDA_CALL(cudaEventSynchronize(static_cast<cudaEvent_t>(event)));
+  }
+
+  void StreamWaitEvent(Device dev, TVMStreamHandle stream, TVMEventHandle event) final {
+    CUDA_CALL(cudaSetDevice(dev.device_id));
+    CUDA_CALL(cudaStreamWaitEvent(static_cast<cudaStream_t>(stream),
+                                  static_cast<cudaEvent_t>(event), 0));
+  }
+
   void SetStream(Device dev, TVMStreamHandle stream) final {
     CUDAThreadEntry::ThreadLocal()->stream = static_cast<cudaStream_t>(stream);
   }
 
+  TVMStreamHandle GetCurrentStream(Device dev) final {
+    return static_cast<TVMStreamHandle>(CUDAThreadEntry::ThreadLocal()->stream);
+  }
+
   void* AllocWorkspace(Device dev, size_t size, DLDataType type_hint) final {
     return CUDAThreadEntry::ThreadLocal()->pool.AllocWorkspace(dev, size);
   }
@@ -306,5 +391,31 @@ TVM_DLL String GetCudaFreeMemory() {
 
 TVM_REGISTER_GLOBAL("runtime.GetCudaFreeMemory").set_body_typed(GetCudaFreeMemory);
 
+// Zero nbytes at ptr on the stream of the thread, e.g. the workspaces of a kernel allocated for
+// each launch by the host code
+TVM_REGISTER_GLOBAL("runtime.cuda.memset_zero").set_body_typed([](void* ptr, int64_t nbytes) {
+  CUDA_CALL(cudaMemsetAsync(ptr, 0, nbytes, CUDAThreadEntry::ThreadLocal()->stream));
+});
+
+#if CUDART_VERSION >= 11020
+TVM_REGISTER_GLOBAL("runtime.cuda_mempool_set_release_threshold")
+    .set_body_typed([](int device_id, int64_t threshold) {
+      ICHECK(CUDAMemPoolReady(device_id))
+          << "The device " << device_id << " has no stream ordered allocator";
+      cudaMemPool_t pool;
+      CUDA_CALL(cudaDeviceGetDefaultMemPool(&pool, device_id));
+      uint64_t value = threshold < 0 ? UINT64_MAX : static_cast<uint64_t>(threshold);
+      CUDA_CALL(cudaMemPoolSetAttribute(pool, cudaMemPoolAttrReleaseThreshold, &value));
+    });
+
+TVM_REGISTER_GLOBAL("runtime.cuda_mempool_trim").set_body_typed([](int device_id, int64_t keep) {
+  ICHECK(CUDAMemPoolReady(device_id))
+      << "The device " << device_id << " has no stream ordered allocator";
+  cudaMemPool_t pool;
+  CUDA_CALL(cudaDeviceGetDefaultMemPool(&pool, device_id));
+  CUDA_CALL(cudaMemPoolTrimTo(pool, static_cast<size_t>(keep)));
+});
+#endif
+
 }  // namespace runtime
 }  // namespace tvm
@@ -27,8 +27,11 @@
 #include <tvm/runtime/registry.h>
 
 #include <array>
+#include <atomic>
+#include <cstring>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -44,21 +47,21 @@ namespace runtime {
 // Module to support thread-safe multi-GPU execution.
 // cuModule is a per-GPU module
 // The runtime will contain a per-device module table
-// The modules will be lazily loaded
+// The modules will be lazily loaded, or eagerly on all the devices at once by Preload
 class CUDAModuleNode : public runtime::ModuleNode {
  public:
   explicit CUDAModuleNode(std::string data, std::string fmt,
                           std::unordered_map<std::string, FunctionInfo> fmap,
                           std::string cuda_source)
       : data_(data), fmt_(fmt), fmap_(fmap), cuda_source_(cuda_source) {
-    std::fill(module_.begin(), module_.end(), nullptr);
+    for (auto& device : devices_) device.module = nullptr;
   }
   // destructor
   ~CUDAModuleNode() {
-    for (size_t i = 0; i < module_.size(); ++i) {
-      if (module_[i] != nullptr) {
+    for (size_t i = 0; i < devices_.size(); ++i) {
+      if (CUmodule module = devices_[i].module.load()) {
         CUDA_CALL(cudaSetDevice(static_cast<int>(i)));
-        CUDA_DRIVER_CALL(cuModuleUnload(module_[i]));
+        CUDA_DRIVER_CALL(cuModuleUnload(module));
       }
     }
   }
@@ -102,15 +105,63 @@ class CUDAModuleNode : public runtime::ModuleNode {
     }
   }
 
-  // get a CUfunction from primary context in device_id
-  CUfunction GetFunc(int device_id, const std::string& func_name) {
-    std::lock_guard<std::mutex> lock(mutex_);
+  // get the module loaded in the primary context of device_id, the current device when it is
+  // loaded. The functions of fmap_ are resolved with the module and published with it, the loaded
+  // modules are then looked up without a lock.
+  CUmodule GetModule(int device_id) {
+    DeviceModule& device = devices_[device_id];
+    CUmodule module = device.module.load(std::memory_order_acquire);
+    if (module != nullptr) return module;
+    std::lock_guard<std::mutex> lock(device.mutex);
     // must recheck under the lock scope
-    if (module_[device_id] == nullptr) {
-      CUDA_DRIVER_CALL(cuModuleLoadData(&(module_[device_id]), data_.c_str()));
+    module = device.module.load(std::memory_order_relaxed);
+    if (module == nullptr) {
+      CUDA_DRIVER_CALL(cuModuleLoadData(&module, data_.c_str()));
+      for (const auto& kv : fmap_) {
+        CUfunction func;
+        if (cuModuleGetFunction(&func, module, kv.first.c_str()) == CUDA_SUCCESS) {
+          device.funcs[kv.first] = func;
+        }
+      }
+      device.module.store(module, std::memory_order_release);
+    }
+    return module;
+  }
+  // load the module and its functions on each of the devices concurrently
+  void Preload(const std::vector<int>& device_ids) {
+    // check the devices before any thread is spawned, a throw would leave them joinable
+    for (int device_id : device_ids) {
+      ICHECK(device_id >= 0 && device_id < kMaxNumGPUs) << "Invalid device " << device_id;
     }
+    // the errors of the threads are raised after all of them are joined
+    std::vector<std::thread> threads;
+    std::vector<std::string> errors(device_ids.size());
+    for (size_t i = 0; i < device_ids.size(); ++i) {
+      threads.emplace_back([this, &device_ids, &errors, i]() {
+        try {
+          CUDA_CALL(cudaSetDevice(device_ids[i]));
+          // initialize the primary context of the device
+          CUDA_CALL(cudaFree(nullptr));
+          GetModule(device_ids[i]);
+        } catch (const std::exception& e) {
+          errors[i] = e.what();
+        }
+      });
+    }
+    for (auto& thread : threads) thread.join();
+    for (size_t i = 0; i < device_ids.size(); ++i) {
+      ICHECK(errors[i].empty()) << "Failed to load the module on device " << device_ids[i]
+                                << ": " << errors[i];
+    }
+  }
+  // get a CUfunction from primary context in device_id
+  CUfunction GetFunc(int device_id, const std::string& func_name) {
+    CUmodule module = GetModule(device_id);
+    const auto& funcs = devices_[device_id].funcs;
+    auto it = funcs.find(func_name);
+    if (it != funcs.end()) return it->second;
     CUfunction func;
-    CUresult result = cuModuleGetFunction(&func, module_[device_id], func_name.c_str());
+    CUresult result = cuModuleGetFunction(&func, module, func_name.c_str());
     if (result != CUDA_SUCCESS) {
       const char* msg;
       cuGetErrorName(result, &msg);
@@ -120,15 +171,11 @@ class CUDAModuleNode : public runtime::ModuleNode {
   }
   // get a global var from primary context in device_id
   CUdeviceptr GetGlobal(int device_id, const std::string& global_name, size_t expect_nbytes) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    // must recheck under the lock scope
-    if (module_[device_id] == nullptr) {
-      CUDA_DRIVER_CALL(cuModuleLoadData(&(module_[device_id]), data_.c_str()));
-    }
+    CUmodule module = GetModule(device_id);
     CUdeviceptr global;
     size_t nbytes;
 
-    CUresult result = cuModuleGetGlobal(&global, &nbytes, module_[device_id], global_name.c_str());
+    CUresult result = cuModuleGetGlobal(&global, &nbytes, module, global_name.c_str());
     ICHECK_EQ(nbytes, expect_nbytes);
     if (result != CUDA_SUCCESS) {
       const char* msg;
@@ -147,10 +194,15 @@ class CUDAModuleNode : public runtime::ModuleNode {
   std::unordered_map<std::string, FunctionInfo> fmap_;
   // The cuda source.
   std::string cuda_source_;
+  // the module of a GPU and its functions, written once under the mutex before the module is
+  // published
+  struct DeviceModule {
+    std::atomic<CUmodule> module;
+    std::unordered_map<std::string, CUfunction> funcs;
+    std::mutex mutex;
+  };
   // the internal modules per GPU, to be lazily initialized.
-  std::array<CUmodule, kMaxNumGPUs> module_;
-  // internal mutex when updating the module
-  std::mutex mutex_;
+  std::array<DeviceModule, kMaxNumGPUs> devices_;
 };
 
 // a wrapped function class to get packed func.
@@ -163,6 +215,8 @@ class CUDAWrappedFunc {
     sptr_ = sptr;
     func_name_ = func_name;
     std::fill(fcache_.begin(), fcache_.end(), nullptr);
+    std::fill(dyn_shmem_limit_.begin(), dyn_shmem_limit_.end(), 48 << 10);
+    std::fill(pdl_supported_.begin(), pdl_supported_.end(), -1);
     launch_param_config_.Init(num_void_args, launch_param_tags);
   }
   // invoke the function with void arguments
@@ -173,21 +227,31 @@ class CUDAWrappedFunc {
 
     if (fcache_[device_id] == nullptr) {
       fcache_[device_id] = m_->GetFunc(device_id, func_name_);
-      if (wl.dyn_shmem_size >= (48 << 10)) {
-        // Assumption: dyn_shmem_size doesn't change across different invocations of
-        // fcache_[device_id]
-        CUresult result = cuFuncSetAttribute(
-            fcache_[device_id], CU_FUNC_ATTRIBUTE_MAX_DYNAMIC_SHARED_SIZE_BYTES, wl.dyn_shmem_size);
-        if (result != CUDA_SUCCESS) {
-          LOG(FATAL) << "Failed to set the allowed dynamic shared memory size to "
-                     << wl.dyn_shmem_size;
-        }
+    }
+    // the dynamic shared memory size can change with the shapes of the arguments, raise the limit
+    // of the function whenever a launch needs more than the previous ones
+    if (wl.dyn_shmem_size > dyn_shmem_limit_[device_id]) {
+      CUresult result = cuFuncSetAttribute(
+          fcache_[device_id], CU_FUNC_ATTRIBUTE_MAX_DYNAMIC_SHARED_SIZE_BYTES, wl.dyn_shmem_size);
+      if (result != CUDA_SUCCESS) {
+        LOG(FATAL) << "Failed to set the allowed dynamic shared memory size of " << func_name_
+                   << " to " << wl.dyn_shmem_size;
       }
+      dyn_shmem_limit_[device_id] = wl.dyn_shmem_size;
     }
     CUstream strm = static_cast<CUstream>(CUDAThreadEntry::ThreadLocal()->stream);
-    CUresult result = cuLaunchKernel(fcache_[device_id], wl.grid_dim(0), wl.grid_dim(1),
-                                     wl.grid_dim(2), wl.block_dim(0), wl.block_dim(1),
-                                     wl.block_dim(2), wl.dyn_shmem_size, strm, void_args, nullptr);
+    bool pdl = launch_param_config_.use_programmatic_dependent_launch() &&
+               SupportsProgrammaticDependentLaunch(device_id);
+    bool cooperative = launch_param_config_.use_cooperative_launch();
+    if (cooperative) CheckCoResidency(device_id, wl, strm);
+    CUresult result;
+    if (pdl || cooperative) {
+      result = LaunchWithAttributes(fcache_[device_id], wl, strm, void_args, pdl, cooperative);
+    } else {
+      result = cuLaunchKernel(fcache_[device_id], wl.grid_dim(0), wl.grid_dim(1), wl.grid_dim(2),
+                              wl.block_dim(0), wl.block_dim(1), wl.block_dim(2),
+                              wl.dyn_shmem_size, strm, void_args, nullptr);
+    }
     if (result != CUDA_SUCCESS && result != CUDA_ERROR_DEINITIALIZED) {
       const char* msg;
       cuGetErrorName(result, &msg);
@@ -208,6 +272,108 @@ class CUDAWrappedFunc {
   }
 
  private:
+  // The programmatic dependent launch needs the griddepcontrol instructions of sm_90, the binaries
+  // of the kernel for the older archs (e.g. the sm_80 SASS of a fatbin run on sm_90) do not wait
+  // for the previous kernel and are launched normally.
+  bool SupportsProgrammaticDependentLaunch(int device_id) const {
+    if (pdl_supported_[device_id] < 0) {
+      int binary_version = 0;
+      CUDA_DRIVER_CALL(cuFuncGetAttribute(&binary_version, CU_FUNC_ATTRIBUTE_BINARY_VERSION,
+                                          fcache_[device_id]));
+      pdl_supported_[device_id] = CUDA_VERSION >= 12000 && binary_version >= 90;
+    }
+    return pdl_supported_[device_id] == 1;
+  }
+
+  // The SMs the kernels of a stream run on: the ones of its green context (an SM partition, see
+  // sm_partition.cc), or all the SMs of the device.
+  static int StreamNumSMs(int device_id, CUstream strm) {
+#if CUDA_VERSION >= 12050
+    CUgreenCtx green_ctx = nullptr;
+    if (strm != nullptr && cuStreamGetGreenCtx(strm, &green_ctx) == CUDA_SUCCESS &&
+        green_ctx != nullptr) {
+      CUdevResource sms;
+      CUDA_DRIVER_CALL(cuGreenCtxGetDevResource(green_ctx, &sms, CU_DEV_RESOURCE_TYPE_SM));
+      return sms.sm.smCount;
+    }
+#endif
+    int num_sms = 0;
+    CUDA_CALL(cudaDeviceGetAttribute(&num_sms, cudaDevAttrMultiProcessorCount, device_id));
+    return num_sms;
+  }
+
+  // The blocks of a cooperative launch synchronize with each other (tl::grid_sync) and must all be
+  // resident at once: the grid may not exceed the number of blocks that fit on the SMs of the
+  // stream with the threads and the shared memory of the launch.
+  void CheckCoResidency(int device_id, const ThreadWorkLoad& wl, CUstream strm) const {
+    size_t block_size = wl.block_dim(0) * wl.block_dim(1) * wl.block_dim(2);
+    size_t num_blocks = wl.grid_dim(0) * wl.grid_dim(1) * wl.grid_dim(2);
+    int num_sms = StreamNumSMs(device_id, strm);
+    CoResidency& cache = co_residency_[device_id];
+    if (cache.max_blocks < 0 || cache.block_size != block_size ||
+        cache.dyn_shmem_size != wl.dyn_shmem_size || cache.num_sms != num_sms) {
+      int blocks_per_sm = 0;
+      CUDA_DRIVER_CALL(cuOccupancyMaxActiveBlocksPerMultiprocessor(
+          &blocks_per_sm, fcache_[device_id], block_size, wl.dyn_shmem_size));
+      cache = {block_size, wl.dyn_shmem_size, num_sms,
+               static_cast<int64_t>(blocks_per_sm) * num_sms};
+    }
+    ICHECK_LE(num_blocks, cache.max_blocks)
+        << "The cooperative kernel " << func_name_ << " synchronizes its " << num_blocks
+        << " blocks, but at most " << cache.max_blocks << " blocks of " << block_size
+        << " threads and " << wl.dyn_shmem_size
+        << " bytes of dynamic shared memory are resident at once on the " << num_sms
+        << " SMs of the stream on device " << device_id;
+  }
+
+  // Launch with the programmatic stream serialization (pdl) and/or as a cooperative kernel. With
+  // the former the kernel may start before the previous kernel of the stream completes, once all
+  // the blocks of the previous kernel triggered (griddepcontrol.launch_dependents) or exited. Its
+  // prologue then overlaps the tail of the previous kernel until it waits for it
+  // (griddepcontrol.wait).
+  CUresult LaunchWithAttributes(CUfunction func, const ThreadWorkLoad& wl, CUstream strm,
+                                void** void_args, bool pdl, bool cooperative) const {
+#if CUDA_VERSION >= 12000
+    CUlaunchAttribute attrs[2];
+    unsigned num_attrs = 0;
+    if (pdl) {
+      attrs[num_attrs].id = CU_LAUNCH_ATTRIBUTE_PROGRAMMATIC_STREAM_SERIALIZATION;
+      attrs[num_attrs].value.programmaticStreamSerializationAllowed = 1;
+      ++num_attrs;
+    }
+    if (cooperative) {
+      attrs[num_attrs].id = CU_LAUNCH_ATTRIBUTE_COOPERATIVE;
+      attrs[num_attrs].value.cooperative = 1;
+      ++num_attrs;
+    }
+    CUlaunchConfig config;
+    config.gridDimX = wl.grid_dim(0);
+    config.gridDimY = wl.grid_dim(1);
+    config.gridDimZ = wl.grid_dim(2);
+    config.blockDimX = wl.block_dim(0);
+    config.blockDimY = wl.block_dim(1);
+    config.blockDimZ = wl.block_dim(2);
+    config.sharedMemBytes = wl.dyn_shmem_size;
+    config.hStream = strm;
+    config.attrs = attrs;
+    config.numAttrs = num_attrs;
+    return cuLaunchKernelEx(&config, func, void_args, nullptr);
+#else
+    // pdl is never requested before CUDA 12.0, see SupportsProgrammaticDependentLaunch
+    return cuLaunchCooperativeKernel(func, wl.grid_dim(0), wl.grid_dim(1), wl.grid_dim(2),
+                                     wl.block_dim(0), wl.block_dim(1), wl.block_dim(2),
+                                     wl.dyn_shmem_size, strm, void_args);
+#endif
+  }
+
+  // The maximum number of the co-resident blocks of the last cooperative launch configuration.
+  struct CoResidency {
+    size_t block_size{0};
+    size_t dyn_shmem_size{0};
+    int num_sms{0};
+    int64_t max_blocks{-1};
+  };
+
   // internal module
   CUDAModuleNode* m_;
   // the resource holder
@@ -217,6 +383,12 @@ class CUDAWrappedFunc {
   // Device function cache per device.
   // mark as mutable, to enable lazy initialization
   mutable std::array<CUfunction, kMaxNumGPUs> fcache_;
+  // The dynamic shared memory size allowed for the function per device.
+  mutable std::array<size_t, kMaxNumGPUs> dyn_shmem_limit_;
+  // Whether the device supports the programmatic dependent launch, -1 if not queried yet.
+  mutable std::array<int, kMaxNumGPUs> pdl_supported_;
+  // The co-residency limit of the cooperative launches per device.
+  mutable std::array<CoResidency, kMaxNumGPUs> co_residency_;
   // launch parameters configuration
   LaunchParamConfig launch_param_config_;
 };
@@ -257,7 +429,7 @@ PackedFunc CUDAModuleNode::GetFunction(const String& name, const ObjectPtr<Objec
   const FunctionInfo& info = it->second;
   CUDAWrappedFunc f;
   f.Init(this, sptr_to_self, name, info.arg_types.size(), info.launch_param_tags);
-  return PackFuncVoidAddr(f, info.arg_types);
+  return PackFuncVoidAddr(f, info.arg_types, info.arg_extra_tags);
 }
 
 Module CUDAModuleCreate(std::string data, std::string fmt,
@@ -294,5 +466,102 @@ TVM_REGISTER_GLOBAL("runtime.module.loadfile_cubin").set_body_typed(CUDAModuleLo
 TVM_REGISTER_GLOBAL("runtime.module.loadfile_ptx").set_body_typed(CUDAModuleLoadFile);
 
 TVM_REGISTER_GLOBAL("runtime.module.loadbinary_cuda").set_body_typed(CUDAModuleLoadBinary);
+
+// Load the cuda modules imported by mod (or mod itself) on the devices given by the remaining
+// arguments (all the visible ones if none) at once, instead of on the first launch of a kernel on
+// each device
+TVM_REGISTER_GLOBAL("runtime.module.cuda_preload").set_body([](TVMArgs args, TVMRetValue* rv) {
+  Module mod = args[0];
+  std::vector<int> device_ids;
+  for (int i = 1; i < args.size(); ++i) device_ids.push_back(args[i]);
+  if (device_ids.empty()) {
+    int count = 0;
+    CUDA_CALL(cudaGetDeviceCount(&count));
+    for (int i = 0; i < count; ++i) device_ids.push_back(i);
+  }
+  std::vector<Module> stack{mod};
+  while (!stack.empty()) {
+    Module m = stack.back();
+    stack.pop_back();
+    if (std::string(m->type_key()) == "cuda") {
+      static_cast<CUDAModuleNode*>(m.operator->())->Preload(device_ids);
+    }
+    for (const auto& imported : m->imports()) stack.push_back(imported);
+  }
+});
+
+#if CUDA_VERSION >= 12000
+static CUtensorMapDataType GetTensorMapDataType(int code, int bits) {
+  if (code == kDLFloat) {
+    if (bits == 16) return CU_TENSOR_MAP_DATA_TYPE_FLOAT16;
+    if (bits == 32) return CU_TENSOR_MAP_DATA_TYPE_FLOAT32;
+    if (bits == 64) return CU_TENSOR_MAP_DATA_TYPE_FLOAT64;
+  } else if (code == kDLBfloat && bits == 16) {
+    return CU_TENSOR_MAP_DATA_TYPE_BFLOAT16;
+  } else if (code == kDLInt) {
+    if (bits == 32) return CU_TENSOR_MAP_DATA_TYPE_INT32;
+    if (bits == 64) return CU_TENSOR_MAP_DATA_TYPE_INT64;
+  } else if (code == kDLUInt) {
+    if (bits == 32) return CU_TENSOR_MAP_DATA_TYPE_UINT32;
+    if (bits == 64) return CU_TENSOR_MAP_DATA_TYPE_UINT64;
+  }
+  // the remaining types are copied as raw bits
+  if (bits == 8) return CU_TENSOR_MAP_DATA_TYPE_UINT8;
+  if (bits == 16) return CU_TENSOR_MAP_DATA_TYPE_UINT16;
+  LOG(FATAL) << "Unsupported tensor map data type, code=" << code << ", bits=" << bits;
+}
+
+/*!
+ * \brief Encode a tiled tensor map for the bulk tensor copies into the 128 bytes pointed by
+ *  the first argument. The remaining arguments are
+ *  (dtype_code, dtype_bits, rank, global_address, global_dim[rank], global_stride[rank],
+ *   box_dim[rank], element_strides[rank], interleave, swizzle, l2_promotion, oob_fill),
+ *  dims are ordered from the innermost, strides are in bytes.
+ */
+TVM_REGISTER_GLOBAL("tvm_tensormap_create_tiled").set_body([](TVMArgs args, TVMRetValue* rv) {
+  ICHECK_GE(args.size(), 5);
+  void* out = args[0];
+  int dtype_code = args[1];
+  int dtype_bits = args[2];
+  int rank = args[3];
+  ICHECK(rank >= 1 && rank <= 5) << "Tensor map only supports rank 1 to 5, got " << rank;
+  ICHECK_EQ(args.size(), 9 + rank * 4);
+  void* global_address = args[4];
+  cuuint64_t global_dim[5], global_stride[5];
+  cuuint32_t box_dim[5], element_strides[5];
+  for (int i = 0; i < rank; i++) {
+    global_dim[i] = args[5 + i].operator int64_t();
+    global_stride[i] = args[5 + rank + i].operator int64_t();
+    box_dim[i] = args[5 + rank * 2 + i].operator int();
+    element_strides[i] = args[5 + rank * 3 + i].operator int();
+  }
+  int base = 5 + rank * 4;
+  int interleave = args[base], swizzle = args[base + 1];
+  int l2_promotion = args[base + 2], oob_fill = args[base + 3];
+
+  alignas(64) CUtensorMap tensor_map;
+  // The stride of the innermost dimension is implied by the element size
+  CUresult result = cuTensorMapEncodeTiled(
+      &tensor_map, GetTensorMapDataType(dtype_code, dtype_bits), rank, global_address, global_dim,
+      global_stride + 1, box_dim, element_strides, static_cast<CUtensorMapInterleave>(interleave),
+      static_cast<CUtensorMapSwizzle>(swizzle), static_cast<CUtensorMapL2promotion>(l2_promotion),
+      static_cast<CUtensorMapFloatOOBfill>(oob_fill));
+  if (result != CUDA_SUCCESS) {
+    const char* msg;
+    cuGetErrorName(result, &msg);
+    std::ostringstream os;
+    os << "Failed to create the tensor map: " << msg << "\n rank=" << rank
+       << ", address=" << global_address << ", dim=(";
+    for (int i = 0; i < rank; i++) os << (i ? "," : "") << global_dim[i];
+    os << "), stride=(";
+    for (int i = 0; i < rank; i++) os << (i ? "," : "") << global_stride[i];
+    os << "), box=(";
+    for (int i = 0; i < rank; i++) os << (i ? "," : "") << box_dim[i];
+    os << "), swizzle=" << swizzle;
+    LOG(FATAL) << os.str();
+  }
+  std::memcpy(out, &tensor_map, sizeof(CUtensorMap));
+});
+#endif  // CUDA_VERSION >= 12000
 }  // namespace runtime
 }  // namespace tvm
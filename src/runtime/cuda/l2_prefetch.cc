@@ -0,0 +1,187 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file l2_prefetch.cc
+ * \brief The prefetch of device memory into the L2 cache on a stream, e.g. the weights of the next
+ *  layer while the current one runs, and the size of the persisting part of the L2 cache.
+ */
+#include <cuda.h>
+#include <cuda_runtime.h>
+#include <tvm/runtime/registry.h>
+
+#include <algorithm>
+#include <array>
+#include <mutex>
+
+#include "cuda_common.h"
+#include "cuda_module.h"
+
+namespace tvm {
+namespace runtime {
+namespace {
+
+// Each thread prefetches the 128 byte lines of [ptr, ptr + nbytes) strided by the threads of the
+// grid. The PTX is compiled by the driver for the arch of the device when it is loaded.
+const char* kL2PrefetchPTX = R"(
+.version 6.0
+.target sm_50
+.address_size 64
+
+.visible .entry tvm_l2_prefetch(.param .u64 ptr, .param .u64 nbytes) {
+  .reg .pred %p;
+  .reg .b32 %r<5>;
+  .reg .b64 %rd<6>;
+  ld.param.u64 %rd1, [ptr];
+  ld.param.u64 %rd2, [nbytes];
+  mov.u32 %r1, %ctaid.x;
+  mov.u32 %r2, %ntid.x;
+  mov.u32 %r3, %tid.x;
+  mad.lo.u32 %r4, %r1, %r2, %r3;
+  cvt.u64.u32 %rd3, %r4;
+  shl.b64 %rd3, %rd3, 7;
+  mov.u32 %r1, %nctaid.x;
+  mul.lo.u32 %r4, %r1, %r2;
+  cvt.u64.u32 %rd4, %r4;
+  shl.b64 %rd4, %rd4, 7;
+LOOP:
+  setp.ge.u64 %p, %rd3, %rd2;
+  @%p bra DONE;
+  add.s64 %rd5, %rd1, %rd3;
+  prefetch.global.L2 [%rd5];
+  add.s64 %rd3, %rd3, %rd4;
+  bra LOOP;
+DONE:
+  ret;
+}
+)";
+
+constexpr int kPrefetchThreads = 256;
+constexpr int kMaxPrefetchBlocks = 1024;
+constexpr size_t kLineBytes = 128;
+
+// the prefetch kernel loaded in the primary context of each device
+CUfunction GetPrefetchFunc(int device_id) {
+  static std::array<CUfunction, kMaxNumGPUs> funcs{};
+  static std::mutex mutex;
+  ICHECK(device_id >= 0 && device_id < kMaxNumGPUs) << "Invalid device " << device_id;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (funcs[device_id] == nullptr) {
+    // initialize the primary context of the device
+    CUDA_CALL(cudaFree(nullptr));
+    CUmodule module;
+    CUDA_DRIVER_CALL(cuModuleLoadData(&module, kL2PrefetchPTX));
+    CUDA_DRIVER_CALL(cuModuleGetFunction(&funcs[device_id], module, "tvm_l2_prefetch"));
+  }
+  return funcs[device_id];
+}
+
+}  // namespace
+
+/*!
+ * \brief Set the size of the persisting part of the L2 cache of the device.
+ * \param device_id The device.
+ * \param bytes The size, clamped to the max of the device, -1 for the max.
+ * \return The size set, 0 if the device has no persisting L2 cache.
+ */
+int64_t SetPersistingL2Limit(int device_id, int64_t bytes) {
+  CUDA_CALL(cudaSetDevice(device_id));
+  int max_persisting = 0;
+  CUDA_CALL(cudaDeviceGetAttribute(&max_persisting, cudaDevAttrMaxPersistingL2CacheSize,
+                                   device_id));
+  if (bytes < 0 || bytes > max_persisting) bytes = max_persisting;
+  if (max_persisting > 0) {
+    CUDA_CALL(cudaDeviceSetLimit(cudaLimitPersistingL2CacheSize, static_cast<size_t>(bytes)));
+  }
+  return bytes;
+}
+
+/*!
+ * \brief Get the size of the persisting part of the L2 cache of the device.
+ * \param device_id The device.
+ * \return The size, 0 if the device has no persisting L2 cache.
+ */
+int64_t GetPersistingL2Limit(int device_id) {
+  CUDA_CALL(cudaSetDevice(device_id));
+  int max_persisting = 0;
+  CUDA_CALL(cudaDeviceGetAttribute(&max_persisting, cudaDevAttrMaxPersistingL2CacheSize,
+                                   device_id));
+  if (max_persisting == 0) return 0;
+  size_t bytes = 0;
+  CUDA_CALL(cudaDeviceGetLimit(&bytes, cudaLimitPersistingL2CacheSize));
+  return static_cast<int64_t>(bytes);
+}
+
+/*!
+ * \brief Prefetch the memory into the L2 cache with a kernel on the stream.
+ * \param device_id The device of the memory.
+ * \param ptr The start of the memory.
+ * \param nbytes The size of the memory.
+ * \param stream The stream of the kernel.
+ * \param persisting_bytes The size of the persisting L2 cache the lines are loaded into through
+ *  the access policy window of the stream, 0 to load them as normal lines. The window of the
+ *  stream, e.g. the one of set_l2_persisting, is restored once the kernel is launched.
+ */
+void L2Prefetch(int device_id, void* ptr, int64_t nbytes, TVMStreamHandle stream,
+                int64_t persisting_bytes) {
+  if (nbytes <= 0) return;
+  CUDA_CALL(cudaSetDevice(device_id));
+  cudaStream_t strm = static_cast<cudaStream_t>(stream);
+  cudaStreamAttrValue saved = {};
+  if (persisting_bytes > 0) {
+    CUDA_CALL(cudaStreamGetAttribute(strm, cudaStreamAttributeAccessPolicyWindow, &saved));
+    int max_window = 0;
+    CUDA_CALL(cudaDeviceGetAttribute(&max_window, cudaDevAttrMaxAccessPolicyWindowSize,
+                                     device_id));
+    size_t window_bytes = std::min<size_t>(nbytes, max_window);
+    cudaStreamAttrValue value = {};
+    value.accessPolicyWindow.base_ptr = ptr;
+    value.accessPolicyWindow.num_bytes = window_bytes;
+    value.accessPolicyWindow.hitRatio =
+        std::min(1.0f, static_cast<float>(persisting_bytes) / static_cast<float>(window_bytes));
+    value.accessPolicyWindow.hitProp = cudaAccessPropertyPersisting;
+    value.accessPolicyWindow.missProp = cudaAccessPropertyStreaming;
+    CUDA_CALL(cudaStreamSetAttribute(strm, cudaStreamAttributeAccessPolicyWindow, &value));
+  }
+  CUfunction func = GetPrefetchFunc(device_id);
+  uint64_t lines = (static_cast<uint64_t>(nbytes) + kLineBytes - 1) / kLineBytes;
+  unsigned blocks = static_cast<unsigned>(
+      std::min<uint64_t>((lines + kPrefetchThreads - 1) / kPrefetchThreads, kMaxPrefetchBlocks));
+  uint64_t address = reinterpret_cast<uint64_t>(ptr), size = static_cast<uint64_t>(nbytes);
+  void* args[] = {&address, &size};
+  CUDA_DRIVER_CALL(cuLaunchKernel(func, blocks, 1, 1, kPrefetchThreads, 1, 1, 0,
+                                  static_cast<CUstream>(strm), args, nullptr));
+  // the window is captured by the launch, the next kernels of the stream see the saved one
+  if (persisting_bytes > 0) {
+    CUDA_CALL(cudaStreamSetAttribute(strm, cudaStreamAttributeAccessPolicyWindow, &saved));
+  }
+}
+
+TVM_REGISTER_GLOBAL("runtime.cuda.set_persisting_l2_limit").set_body_typed(SetPersistingL2Limit);
+
+TVM_REGISTER_GLOBAL("runtime.cuda.get_persisting_l2_limit").set_body_typed(GetPersistingL2Limit);
+
+TVM_REGISTER_GLOBAL("runtime.cuda.l2_prefetch")
+    .set_body_typed([](int device_id, void* ptr, int64_t nbytes, void* stream,
+                       int64_t persisting_bytes) {
+      L2Prefetch(device_id, ptr, nbytes, stream, persisting_bytes);
+    });
+
+}  // namespace runtime
+}  // namespace tvm
@@ -0,0 +1,149 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file sm_partition.cc
+ * \brief The partitions of the SMs of a device, each with a stream whose kernels only run on the
+ *  SMs of the partition, e.g. to isolate the latency critical decode kernels from a concurrent
+ *  prefill on the same GPU.
+ */
+#include <cuda.h>
+#include <cuda_runtime.h>
+#include <tvm/runtime/object.h>
+#include <tvm/runtime/registry.h>
+
+#include "cuda_common.h"
+
+namespace tvm {
+namespace runtime {
+
+/*!
+ * \brief A stream running on num_sms SMs of a device.
+ *
+ * With CUDA 12.5 and later the SMs are split off the device into a green context, the kernels of
+ * its stream are only scheduled on them whatever the other streams of the device run. The kernels
+ * loaded in the primary context are launched on it as on any stream. Otherwise the partition is a
+ * plain stream with the number of SMs the persistent kernels are compiled for (tl.num_sms), their
+ * grids then bound the SMs they occupy but the other kernels are not isolated.
+ */
+class SMPartitionObj : public Object {
+ public:
+  SMPartitionObj(int device_id, int num_sms) : device_id_(device_id) {
+    ICHECK_GT(num_sms, 0) << "A partition needs at least one SM";
+    CUDA_CALL(cudaSetDevice(device_id));
+    // initialize the primary context of the device
+    CUDA_CALL(cudaFree(nullptr));
+    int device_sms = 0;
+    CUDA_CALL(cudaDeviceGetAttribute(&device_sms, cudaDevAttrMultiProcessorCount, device_id));
+    ICHECK_LE(num_sms, device_sms) << "The device " << device_id << " has " << device_sms
+                                   << " SMs, can not partition " << num_sms << " of them";
+#if CUDA_VERSION >= 12050
+    if (CreateGreenContext(num_sms)) return;
+#endif
+    num_sms_ = num_sms;
+    CUDA_CALL(cudaStreamCreateWithFlags(reinterpret_cast<cudaStream_t*>(&stream_),
+                                        cudaStreamNonBlocking));
+  }
+
+  ~SMPartitionObj() {
+    cudaSetDevice(device_id_);
+    if (stream_ != nullptr) {
+      cuStreamSynchronize(stream_);
+      cuStreamDestroy(stream_);
+    }
+#if CUDA_VERSION >= 12050
+    if (green_ctx_ != nullptr) cuGreenCtxDestroy(green_ctx_);
+#endif
+  }
+
+  /*! \return The stream of the partition. */
+  CUstream stream() const { return stream_; }
+  /*! \return The SMs of the partition, num_sms rounded up to the granularity of the device. */
+  int num_sms() const { return num_sms_; }
+  /*! \return Whether the kernels of the stream are isolated on the SMs by a green context. */
+  bool isolated() const { return isolated_; }
+
+  static constexpr const char* _type_key = "runtime.cuda.SMPartition";
+  TVM_DECLARE_FINAL_OBJECT_INFO(SMPartitionObj, Object);
+
+ private:
+#if CUDA_VERSION >= 12050
+  // Split num_sms SMs off the device into a green context with its own stream, false when the
+  // driver or the device do not support the green contexts.
+  bool CreateGreenContext(int num_sms) {
+    CUdevice device;
+    CUDA_DRIVER_CALL(cuDeviceGet(&device, device_id_));
+    CUdevResource sms, partition, remaining;
+    if (cuDeviceGetDevResource(device, &sms, CU_DEV_RESOURCE_TYPE_SM) != CUDA_SUCCESS) {
+      return false;
+    }
+    // the group is rounded up to the minimum and to the multiple of SMs of the arch (e.g. 8 SMs
+    // on sm_90, 2 SMs on sm_80)
+    unsigned num_groups = 1;
+    CUresult result =
+        cuDevSmResourceSplitByCount(&partition, &num_groups, &sms, &remaining, 0, num_sms);
+    if (result != CUDA_SUCCESS || num_groups != 1) {
+      LOG(WARNING) << "Can not split " << num_sms << " SMs off the device " << device_id_
+                   << ", the partition is not isolated";
+      return false;
+    }
+    CUdevResourceDesc desc;
+    CUDA_DRIVER_CALL(cuDevResourceGenerateDesc(&desc, &partition, 1));
+    CUDA_DRIVER_CALL(cuGreenCtxCreate(&green_ctx_, desc, device, CU_GREEN_CTX_DEFAULT_STREAM));
+    CUDA_DRIVER_CALL(cuGreenCtxStreamCreate(&stream_, green_ctx_, CU_STREAM_NON_BLOCKING, 0));
+    num_sms_ = partition.sm.smCount;
+    isolated_ = true;
+    return true;
+  }
+
+  CUgreenCtx green_ctx_{nullptr};
+#endif
+  int device_id_;
+  int num_sms_{0};
+  bool isolated_{false};
+  CUstream stream_{nullptr};
+};
+
+TVM_REGISTER_OBJECT_TYPE(SMPartitionObj);
+
+TVM_REGISTER_GLOBAL("runtime.cuda.create_sm_partition")
+    .set_body_typed([](int device_id, int num_sms) -> ObjectRef {
+      return ObjectRef(make_object<SMPartitionObj>(device_id, num_sms));
+    });
+
+static const SMPartitionObj* AsSMPartition(const ObjectRef& partition) {
+  const auto* node = partition.as<SMPartitionObj>();
+  ICHECK(node != nullptr) << "Expected an SM partition, got " << partition->GetTypeKey();
+  return node;
+}
+
+TVM_REGISTER_GLOBAL("runtime.cuda.sm_partition_stream").set_body_typed([](ObjectRef partition) {
+  return static_cast<void*>(AsSMPartition(partition)->stream());
+});
+
+TVM_REGISTER_GLOBAL("runtime.cuda.sm_partition_num_sms").set_body_typed([](ObjectRef partition) {
+  return AsSMPartition(partition)->num_sms();
+});
+
+TVM_REGISTER_GLOBAL("runtime.cuda.sm_partition_isolated").set_body_typed([](ObjectRef partition) {
+  return AsSMPartition(partition)->isolated();
+});
+
+}  // namespace runtime
+}  // namespace tvm
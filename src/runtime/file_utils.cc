@@ -28,10 +28,15 @@
 #include <tvm/runtime/registry.h>
 #include <tvm/runtime/serializer.h>
 
+#include <algorithm>
 #include <fstream>
+#include <limits>
+#include <memory>
 #include <unordered_map>
 #include <vector>
 
+#include "../support/mapped_file.h"
+
 namespace tvm {
 namespace runtime {
 
@@ -44,34 +49,71 @@ void FunctionInfo::Save(dmlc::JSONWriter* writer) const {
   writer->WriteObjectKeyValue("name", name);
   writer->WriteObjectKeyValue("arg_types", sarg_types);
   writer->WriteObjectKeyValue("launch_param_tags", launch_param_tags);
+  // only written when used, so that the other functions load in the runtimes without the field
+  if (!arg_extra_tags.empty()) {
+    std::vector<int> iarg_extra_tags(arg_extra_tags.size());
+    for (size_t i = 0; i < arg_extra_tags.size(); ++i) {
+      iarg_extra_tags[i] = static_cast<int>(arg_extra_tags[i]);
+    }
+    writer->WriteObjectKeyValue("arg_extra_tags", iarg_extra_tags);
+  }
   writer->EndObject();
 }
 
 void FunctionInfo::Load(dmlc::JSONReader* reader) {
   dmlc::JSONObjectReadHelper helper;
   std::vector<std::string> sarg_types;
+  std::vector<int> iarg_extra_tags;
   helper.DeclareField("name", &name);
   helper.DeclareField("arg_types", &sarg_types);
   helper.DeclareOptionalField("launch_param_tags", &launch_param_tags);
   helper.DeclareOptionalField("thread_axis_tags",
                               &launch_param_tags);  // for backward compatibility
+  helper.DeclareOptionalField("arg_extra_tags", &iarg_extra_tags);
   helper.ReadAllFields(reader);
   arg_types.resize(sarg_types.size());
   for (size_t i = 0; i < arg_types.size(); ++i) {
     arg_types[i] = String2DLDataType(sarg_types[i]);
   }
+  arg_extra_tags.resize(iarg_extra_tags.size());
+  for (size_t i = 0; i < arg_extra_tags.size(); ++i) {
+    arg_extra_tags[i] = static_cast<ArgExtraTags>(iarg_extra_tags[i]);
+  }
 }
 
 void FunctionInfo::Save(dmlc::Stream* writer) const {
   writer->Write(name);
   writer->Write(arg_types);
-  writer->Write(launch_param_tags);
+  if (arg_extra_tags.empty()) {
+    // the format of the runtimes without arg_extra_tags
+    writer->Write(launch_param_tags);
+    return;
+  }
+  // the binary format has no optional fields, the last launch param tag marks that the extra tags
+  // follow
+  std::vector<std::string> tags = launch_param_tags;
+  tags.push_back(kArgExtraTagsMarker);
+  writer->Write(tags);
+  std::vector<int> iarg_extra_tags(arg_extra_tags.size());
+  for (size_t i = 0; i < arg_extra_tags.size(); ++i) {
+    iarg_extra_tags[i] = static_cast<int>(arg_extra_tags[i]);
+  }
+  writer->Write(iarg_extra_tags);
 }
 
 bool FunctionInfo::Load(dmlc::Stream* reader) {
   if (!reader->Read(&name)) return false;
   if (!reader->Read(&arg_types)) return false;
   if (!reader->Read(&launch_param_tags)) return false;
+  arg_extra_tags.clear();
+  if (launch_param_tags.empty() || launch_param_tags.back() != kArgExtraTagsMarker) return true;
+  launch_param_tags.pop_back();
+  std::vector<int> iarg_extra_tags;
+  if (!reader->Read(&iarg_extra_tags)) return false;
+  arg_extra_tags.resize(iarg_extra_tags.size());
+  for (size_t i = 0; i < arg_extra_tags.size(); ++i) {
+    arg_extra_tags[i] = static_cast<ArgExtraTags>(iarg_extra_tags[i]);
+  }
   return true;
 }
 
@@ -236,6 +278,174 @@ std::string SaveParams(const Map<String, NDArray>& params) {
   return bytes;
 }
 
+namespace {
+
+/*! \brief The header entry of a tensor in the mapped format. */
+struct MappedTensorInfo {
+  DLDataType dtype;
+  std::vector<int64_t> shape;
+  uint64_t offset;
+  uint64_t nbytes;
+};
+
+void WriteMappedHeader(dmlc::Stream* strm, uint64_t alignment,
+                       const std::vector<std::string>& names,
+                       const std::vector<MappedTensorInfo>& infos) {
+  uint64_t header = kTVMNDArrayMappedListMagic;
+  strm->Write(header);
+  strm->Write(alignment);
+  strm->Write(names);
+  uint64_t sz = static_cast<uint64_t>(infos.size());
+  strm->Write(sz);
+  for (const MappedTensorInfo& info : infos) {
+    strm->Write(info.dtype);
+    strm->Write(info.shape);
+    strm->Write(info.offset);
+    strm->Write(info.nbytes);
+  }
+}
+
+/*! \brief The manager of an array pointing into a mapped parameter file. */
+struct MappedTensorContext {
+  std::shared_ptr<support::MappedFile> file;
+  std::vector<int64_t> shape;
+  DLManagedTensor tensor;
+
+  static void Deleter(DLManagedTensor* tensor) {
+    delete static_cast<MappedTensorContext*>(tensor->manager_ctx);
+  }
+};
+
+}  // namespace
+
+void SaveParamsMapped(const std::string& path, const Map<String, NDArray>& params,
+                      size_t alignment) {
+  ICHECK(alignment != 0 && alignment % kAllocAlignment == 0)
+      << "The alignment must be a multiple of " << kAllocAlignment;
+  std::vector<std::string> names;
+  std::vector<NDArray> arrays;
+  std::vector<MappedTensorInfo> infos;
+  for (auto& p : params) {
+    ICHECK(p.second.IsContiguous()) << "Can only save contiguous arrays, but " << p.first
+                                    << " is strided";
+    names.push_back(p.first);
+    arrays.push_back(p.second);
+    const DLTensor* tensor = p.second.operator->();
+    std::vector<int64_t> shape(tensor->shape, tensor->shape + tensor->ndim);
+    infos.push_back({tensor->dtype, shape, 0, GetDataSize(*tensor)});
+  }
+  // the size of the header does not depend on the offsets
+  std::string header;
+  dmlc::MemoryStringStream header_strm(&header);
+  WriteMappedHeader(&header_strm, alignment, names, infos);
+  uint64_t offset = header.size();
+  for (MappedTensorInfo& info : infos) {
+    offset = (offset + alignment - 1) / alignment * alignment;
+    info.offset = offset;
+    offset += info.nbytes;
+  }
+  header.clear();
+  header_strm.Seek(0);
+  WriteMappedHeader(&header_strm, alignment, names, infos);
+
+  SimpleBinaryFileStream strm(path, "wb");
+  strm.Write(header.data(), header.size());
+  uint64_t written = header.size();
+  std::vector<char> padding(alignment, 0), host;
+  for (size_t i = 0; i < arrays.size(); ++i) {
+    strm.Write(padding.data(), infos[i].offset - written);
+    const DLTensor* tensor = arrays[i].operator->();
+    if (tensor->device.device_type == kDLCPU) {
+      strm.Write(static_cast<const char*>(tensor->data) + tensor->byte_offset, infos[i].nbytes);
+    } else {
+      host.resize(infos[i].nbytes);
+      arrays[i].CopyToBytes(host.data(), host.size());
+      strm.Write(host.data(), host.size());
+    }
+    written = infos[i].offset + infos[i].nbytes;
+  }
+}
+
+Map<String, NDArray> LoadParamsMapped(const std::string& path, Device dev, size_t chunk_bytes) {
+  ICHECK_GT(chunk_bytes, 0);
+  // the arrays on CPU are the pages of the mapping, which they may write to
+  bool in_place = dev.device_type == kDLCPU;
+  auto file = std::make_shared<support::MappedFile>(path, /*copy_on_write=*/in_place);
+  ICHECK(file->good()) << "Cannot open the parameter file " << path;
+  dmlc::MemoryFixedSizeStream strm(const_cast<char*>(file->data()), file->size());
+  uint64_t header, alignment;
+  ICHECK(strm.Read(&header)) << "Invalid parameters file format";
+  ICHECK(header == kTVMNDArrayMappedListMagic) << "Invalid parameters file format";
+  ICHECK(strm.Read(&alignment)) << "Invalid parameters file format";
+  std::vector<std::string> names;
+  ICHECK(strm.Read(&names)) << "Invalid parameters file format";
+  uint64_t sz;
+  ICHECK(strm.Read(&sz) && sz == names.size()) << "Invalid parameters file format";
+  std::vector<MappedTensorInfo> infos(sz);
+  for (MappedTensorInfo& info : infos) {
+    ICHECK(strm.Read(&info.dtype) && strm.Read(&info.shape) && strm.Read(&info.offset) &&
+           strm.Read(&info.nbytes))
+        << "Invalid parameters file format";
+    // the bytes of the shape, checked without overflow, as the sizes of the file
+    uint64_t nbytes = (static_cast<uint64_t>(info.dtype.bits) * info.dtype.lanes + 7) / 8;
+    for (int64_t dim : info.shape) {
+      ICHECK(dim >= 0 && (dim == 0 || nbytes <= std::numeric_limits<uint64_t>::max() / dim))
+          << "Invalid parameters file format";
+      nbytes *= static_cast<uint64_t>(dim);
+    }
+    ICHECK(info.nbytes == nbytes) << "Invalid parameters file format";
+    ICHECK(info.offset % kAllocAlignment == 0 && info.nbytes <= file->size() &&
+           info.offset <= file->size() - info.nbytes)
+        << "Invalid parameters file format";
+  }
+
+  Map<String, NDArray> params;
+  for (size_t i = 0; i < infos.size(); ++i) {
+    const MappedTensorInfo& info = infos[i];
+    const char* data = file->data() + info.offset;
+    // without mmap the file is in a buffer that may not be aligned
+    if (in_place && reinterpret_cast<uintptr_t>(data) % kAllocAlignment == 0) {
+      MappedTensorContext* ctx = new MappedTensorContext();
+      ctx->file = file;
+      ctx->shape = info.shape;
+      DLTensor& tensor = ctx->tensor.dl_tensor;
+      tensor.data = const_cast<char*>(data);
+      tensor.device = dev;
+      tensor.ndim = static_cast<int>(ctx->shape.size());
+      tensor.dtype = info.dtype;
+      tensor.shape = ctx->shape.data();
+      tensor.strides = nullptr;
+      tensor.byte_offset = 0;
+      ctx->tensor.manager_ctx = ctx;
+      ctx->tensor.deleter = MappedTensorContext::Deleter;
+      params.Set(names[i], NDArray::FromDLPack(&ctx->tensor));
+      continue;
+    }
+    NDArray array = NDArray::Empty(ShapeTuple(info.shape), info.dtype, dev);
+    ICHECK_EQ(GetDataSize(*array.operator->()), info.nbytes) << "Invalid parameters file format";
+    // upload in chunks, the disk reads of the next chunk overlap with the copy of this one
+    file->WillNeed(info.offset, chunk_bytes);
+    for (uint64_t begin = 0; begin < info.nbytes; begin += chunk_bytes) {
+      int64_t size = static_cast<int64_t>(std::min<uint64_t>(chunk_bytes, info.nbytes - begin));
+      file->WillNeed(info.offset + begin + size, chunk_bytes);
+      DLTensor from{const_cast<char*>(data + begin), Device{kDLCPU, 0}, 1,
+                    DLDataType{kDLUInt, 8, 1}, &size, nullptr, 0};
+      DLTensor to = *array.operator->();
+      to.ndim = 1;
+      to.dtype = DLDataType{kDLUInt, 8, 1};
+      to.shape = &size;
+      to.strides = nullptr;
+      to.byte_offset += begin;
+      NDArray::CopyFromTo(&from, &to);
+    }
+    params.Set(names[i], array);
+  }
+  if (!in_place) {
+    DeviceAPI::Get(dev)->StreamSync(dev, nullptr);
+  }
+  return params;
+}
+
 TVM_REGISTER_GLOBAL("runtime.SaveParams").set_body_typed([](const Map<String, NDArray>& params) {
   std::string s = ::tvm::runtime::SaveParams(params);
   // copy return array so it is owned by the ret value
@@ -259,5 +469,15 @@ TVM_REGISTER_GLOBAL("runtime.LoadParamsFromFile").set_body_typed([](const String
   return LoadParams(&strm);
 });
 
+TVM_REGISTER_GLOBAL("runtime.SaveParamsMapped")
+    .set_body_typed([](const Map<String, NDArray>& params, const String& path, int64_t alignment) {
+      SaveParamsMapped(path, params, alignment);
+    });
+
+TVM_REGISTER_GLOBAL("runtime.LoadParamsMapped")
+    .set_body_typed([](const String& path, Device dev, int64_t chunk_bytes) {
+      return LoadParamsMapped(path, dev, chunk_bytes);
+    });
+
 }  // namespace runtime
 }  // namespace tvm
@@ -26,6 +26,7 @@
 
 #include <tvm/runtime/container/map.h>
 #include <tvm/runtime/container/string.h>
+#include <tvm/runtime/device_api.h>
 
 #include <string>
 #include <unordered_map>
@@ -130,6 +131,35 @@ std::string SaveParams(const Map<String, NDArray>& params);
  */
 void SaveParams(dmlc::Stream* strm, const Map<String, NDArray>& params);
 
+constexpr uint64_t kTVMNDArrayMappedListMagic = 0xF7E58D4F05049CB8;
+/*!
+ * \brief Save parameters to a file in the mapped format.
+ *
+ *  The header lists the name, dtype, shape, offset and size of each tensor, and the data of the
+ *  tensors follow at offsets that are multiples of the alignment, so that LoadParamsMapped can
+ *  use them in place.
+ *
+ * \param path The path to the parameter file.
+ * \param params Parameters to save.
+ * \param alignment The alignment of the tensor offsets, a multiple of kAllocAlignment.
+ */
+void SaveParamsMapped(const std::string& path, const Map<String, NDArray>& params,
+                      size_t alignment = kAllocAlignment);
+/*!
+ * \brief Load parameters from a file in the mapped format.
+ *
+ *  The file is memory mapped. On CPU the arrays point into the mapping, copy-on-write, and
+ *  keep it alive. On other devices the arrays are uploaded in chunks, the pages of the next
+ *  chunk being read ahead while the current one is copied.
+ *
+ * \param path The path to the parameter file.
+ * \param dev The device of the loaded arrays.
+ * \param chunk_bytes The size of the chunks uploaded to a device.
+ * \return Map of parameter name to parameter value.
+ */
+Map<String, NDArray> LoadParamsMapped(const std::string& path, Device dev = {kDLCPU, 0},
+                                      size_t chunk_bytes = 64 << 20);
+
 /*!
  * \brief A dmlc stream which wraps standard file operations.
  */
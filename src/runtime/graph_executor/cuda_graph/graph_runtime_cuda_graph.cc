@@ -21,8 +21,15 @@
  * \file graph_executor_cuda_graph.cc
  */
 
+#include <cuda.h>
 #include <tvm/runtime/registry.h>
 
+#include <cstring>
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 #include "../../cuda/cuda_common.h"
 #include "../graph_executor.h"
 
@@ -38,17 +45,33 @@ namespace runtime {
  *  (1) Using CUDA stream capture API to capture a series of operations on
  *  CUDA stream, and automatically generates a graph (2) Building a graph
  *  using CUDA graph API manually. This implementation uses stream capture.
+ *
+ *  The inputs and outputs bound without copy (set_input_zero_copy, bind_input and the output
+ *  counterparts) after the capture are rebound in the instantiated graph: the kernel parameters
+ *  holding their pointers are patched (cuGraphExecKernelNodeSetParams) before the launch. The
+ *  graph is captured again when a pointer can not be patched.
  */
 class GraphExecutorCudaGraph : public GraphExecutor {
  public:
+  ~GraphExecutorCudaGraph() {
+    DestroyGraph();
+    if (capture_stream_ != nullptr) {
+      const Device& dev = data_entry_[entry_id(0, 0)]->device;
+      TVMStreamFree(dev.device_type, dev.device_id, capture_stream_);
+    }
+  }
+
   /*!
    * \brief Begin CUDA graph capture on stream, the stream enters capture mode.
    */
   void StartCapture() {
     const Device& dev = data_entry_[entry_id(0, 0)]->device;
 
-    TVMStreamCreate(dev.device_type, dev.device_id, &capture_stream_);
+    if (capture_stream_ == nullptr) {
+      TVMStreamCreate(dev.device_type, dev.device_id, &capture_stream_);
+    }
     TVMSetStream(dev.device_type, dev.device_id, capture_stream_);
+    num_streams_ = 1;
 
     CUDA_CALL(cudaStreamBeginCapture(static_cast<cudaStream_t>(capture_stream_),
                                      cudaStreamCaptureModeGlobal));
@@ -58,6 +81,8 @@ class GraphExecutorCudaGraph : public GraphExecutor {
    * \brief Launch the instantiated graph on stream
    */
   void RunCudaGraph() {
+    ICHECK(cuda_graph_exec_ != nullptr) << "Capture the CUDA graph before running it";
+    RebindPointers();
     cudaStream_t cuStream = static_cast<cudaStream_t>(capture_stream_);
     CUDA_CALL(cudaGraphLaunch(cuda_graph_exec_, cuStream));
     CUDA_CALL(cudaStreamSynchronize(cuStream));
@@ -76,7 +101,74 @@ class GraphExecutorCudaGraph : public GraphExecutor {
     CUDA_CALL(cudaGraphGetNodes(graph, nodes, &numNodes));
     LOG(INFO) << "Num of nodes in the cuda graph created using stream capture API = " << numNodes;
 
+    DestroyGraph();
+    cuda_graph_ = graph;
     CUDA_CALL(cudaGraphInstantiate(&cuda_graph_exec_, graph, NULL, NULL, 0));
+    IndexPointerSlots();
+  }
+
+  /*!
+   * \brief Capture the ops on up to num_streams streams, the ops independent in the graph running
+   * concurrently in the CUDA graph. An op continues the stream of one of its dependencies if it was
+   * the last op there, else takes the next stream in turn, and waits on the events recorded after
+   * its dependencies on the other streams. The CUDA graph is instantiated as by EndCapture.
+   * \param num_streams The number of streams.
+   */
+  void CaptureMultiStream(int num_streams) {
+    ICHECK_GE(num_streams, 1);
+    const Device& dev = data_entry_[entry_id(0, 0)]->device;
+    std::vector<std::vector<uint32_t>> deps = OpDependencies();
+    StartCapture();
+    num_streams_ = num_streams;
+    std::vector<cudaStream_t> streams(num_streams, static_cast<cudaStream_t>(capture_stream_));
+    std::vector<cudaEvent_t> events;
+    auto record = [&events](cudaStream_t stream) {
+      cudaEvent_t event;
+      CUDA_CALL(cudaEventCreateWithFlags(&event, cudaEventDisableTiming));
+      CUDA_CALL(cudaEventRecord(event, stream));
+      events.push_back(event);
+      return event;
+    };
+    // the other streams join the capture by waiting on the capture stream
+    cudaEvent_t fork = record(streams[0]);
+    for (int i = 1; i < num_streams; ++i) {
+      CUDA_CALL(cudaStreamCreateWithFlags(&streams[i], cudaStreamNonBlocking));
+      CUDA_CALL(cudaStreamWaitEvent(streams[i], fork, 0));
+    }
+    std::vector<int> stream_of(op_execs_.size(), -1);
+    std::vector<cudaEvent_t> done(op_execs_.size(), nullptr);
+    std::vector<int64_t> last_op(num_streams, -1);
+    int next_stream = 0;
+    for (uint32_t nid = 0; nid < op_execs_.size(); ++nid) {
+      if (!op_execs_[nid]) continue;
+      int s = -1;
+      for (uint32_t dep : deps[nid]) {
+        if (last_op[stream_of[dep]] == dep) {
+          s = stream_of[dep];
+          break;
+        }
+      }
+      if (s < 0) {
+        s = next_stream;
+        next_stream = (next_stream + 1) % num_streams;
+      }
+      for (uint32_t dep : deps[nid]) {
+        if (stream_of[dep] != s) CUDA_CALL(cudaStreamWaitEvent(streams[s], done[dep], 0));
+      }
+      TVMSetStream(dev.device_type, dev.device_id, streams[s]);
+      op_execs_[nid]();
+      done[nid] = record(streams[s]);
+      stream_of[nid] = s;
+      last_op[s] = nid;
+    }
+    // the other streams rejoin the capture stream before the capture ends
+    for (int i = 1; i < num_streams; ++i) {
+      CUDA_CALL(cudaStreamWaitEvent(streams[0], record(streams[i]), 0));
+    }
+    TVMSetStream(dev.device_type, dev.device_id, capture_stream_);
+    EndCapture();
+    for (cudaEvent_t event : events) CUDA_CALL(cudaEventDestroy(event));
+    for (int i = 1; i < num_streams; ++i) CUDA_CALL(cudaStreamDestroy(streams[i]));
   }
 
   /*!
@@ -86,11 +178,212 @@ class GraphExecutorCudaGraph : public GraphExecutor {
    */
   PackedFunc GetFunction(const String& name, const ObjectPtr<Object>& sptr_to_self);
 
+  /*! \return The number of the zero-copy inputs and outputs whose pointers are patched in the
+   *  captured graph, the other ones are rebound by capturing the graph again. */
+  int NumPatchableEntries() const {
+    int count = 0;
+    for (const auto& kv : bound_entries_) count += kv.second.patchable;
+    return count;
+  }
+
  private:
+  /*! \brief The parameters of a kernel node of the graph holding the pointer of an entry. */
+  struct KernelNode {
+    CUgraphNode node;
+    CUDA_KERNEL_NODE_PARAMS params;
+    /*! \brief The values of the parameters, at the offsets. */
+    std::vector<char> values;
+    std::vector<size_t> offsets;
+  };
+  /*! \brief An input or output entry and the parameters holding its pointer in the graph. */
+  struct BoundEntry {
+    /*! \brief The pointer in the instantiated graph. */
+    void* ptr;
+    size_t nbytes;
+    /*! \brief Whether all the uses of the pointer are found in the kernel parameters. */
+    bool patchable;
+    /*! \brief The kernel nodes (in kernel_nodes_) and the byte offsets in their values. */
+    std::vector<std::pair<size_t, size_t>> slots;
+  };
+
+  // The pointer of an entry passed to the ops, changed by the zero-copy binds.
+  void* CurrentPointer(uint32_t eid) const {
+    if (!input_dltensors_[eid].empty()) return input_dltensors_[eid][0]->data;
+    if (!output_dltensors_[eid].empty()) return output_dltensors_[eid][0]->data;
+    return nullptr;
+  }
+
+  /*!
+   * \brief Find the kernel parameters holding the pointers of the inputs and the outputs in the
+   * captured graph. An entry is patchable when the kernels hold its pointer as a parameter and no
+   * pointer derived from it (e.g. an offset computed by the host code), and for an output when its
+   * storage is not shared with other entries, whose kernels hold the same pointer. The parameters
+   * of the kernels are listed with cuFuncGetParamInfo, since CUDA 12.4.
+   */
+  void IndexPointerSlots() {
+    kernel_nodes_.clear();
+    bound_entries_.clear();
+    std::unordered_map<int, int> storage_uses;
+    for (size_t eid = 0; eid < data_entry_.size(); ++eid) {
+      storage_uses[attrs_.storage_id[eid]]++;
+    }
+    // the entries sharing the storage of an input are its views (e.g. a reshape), rebound with it
+    std::vector<std::pair<uint32_t, bool>> eids;
+    for (uint32_t nid : input_nodes_) eids.emplace_back(entry_id(nid, 0), false);
+    for (const NodeEntry& e : outputs_) eids.emplace_back(entry_id(e), true);
+    for (const auto& [eid, output] : eids) {
+      void* ptr = CurrentPointer(eid);
+      if (ptr == nullptr || bound_entries_.count(eid)) continue;
+      bool shared = output && storage_uses[attrs_.storage_id[eid]] > 1;
+      bound_entries_[eid] = {ptr, GetDataSize(*data_entry_[eid].operator->()), !shared, {}};
+    }
+#if CUDA_VERSION >= 12040
+    size_t num_nodes = 0;
+    CUDA_DRIVER_CALL(cuGraphGetNodes(cuda_graph_, nullptr, &num_nodes));
+    std::vector<CUgraphNode> nodes(num_nodes);
+    CUDA_DRIVER_CALL(cuGraphGetNodes(cuda_graph_, nodes.data(), &num_nodes));
+    for (CUgraphNode node : nodes) {
+      CUgraphNodeType type;
+      CUDA_DRIVER_CALL(cuGraphNodeGetType(node, &type));
+      if (type != CU_GRAPH_NODE_TYPE_KERNEL) continue;
+      KernelNode kernel{node, {}, {}, {}};
+      CUDA_DRIVER_CALL(cuGraphKernelNodeGetParams(node, &kernel.params));
+      // the params packed in a buffer (extra) are not listed, their pointers are not found
+      if (kernel.params.kernelParams == nullptr) continue;
+      // the offsets of the values and their sizes
+      std::vector<std::pair<size_t, size_t>> params;
+      size_t param_offset, param_size;
+      for (size_t i = 0; cuFuncGetParamInfo(kernel.params.func, i, &param_offset, &param_size) ==
+                         CUDA_SUCCESS;
+           ++i) {
+        kernel.offsets.push_back(kernel.values.size());
+        const char* value = static_cast<const char*>(kernel.params.kernelParams[i]);
+        kernel.values.insert(kernel.values.end(), value, value + param_size);
+        params.emplace_back(kernel.offsets.back(), param_size);
+      }
+      bool used = false;
+      for (const auto& [value_offset, size] : params) {
+        if (size != sizeof(void*)) continue;
+        char* value;
+        std::memcpy(&value, kernel.values.data() + value_offset, sizeof(void*));
+        for (auto& [eid, entry] : bound_entries_) {
+          char* begin = static_cast<char*>(entry.ptr);
+          if (value == begin) {
+            entry.slots.emplace_back(kernel_nodes_.size(), value_offset);
+            used = true;
+          } else if (value > begin && value < begin + entry.nbytes) {
+            entry.patchable = false;
+          }
+        }
+      }
+      if (used) kernel_nodes_.push_back(std::move(kernel));
+    }
+#endif
+    for (auto& kv : bound_entries_) {
+      if (kv.second.slots.empty()) kv.second.patchable = false;
+    }
+  }
+
+  // Patch the pointers of the entries rebound since the capture, or capture the graph again.
+  void RebindPointers() {
+    std::set<size_t> dirty;
+    bool recapture = false;
+    for (auto& [eid, entry] : bound_entries_) {
+      void* ptr = CurrentPointer(eid);
+      if (ptr == entry.ptr) continue;
+      if (!entry.patchable) {
+        recapture = true;
+        break;
+      }
+      for (const auto& [index, offset] : entry.slots) {
+        std::memcpy(kernel_nodes_[index].values.data() + offset, &ptr, sizeof(void*));
+        dirty.insert(index);
+      }
+      entry.ptr = ptr;
+    }
+    if (recapture) {
+      Recapture();
+      return;
+    }
+    for (size_t index : dirty) {
+      KernelNode& kernel = kernel_nodes_[index];
+      std::vector<void*> args;
+      for (size_t offset : kernel.offsets) args.push_back(kernel.values.data() + offset);
+      CUDA_KERNEL_NODE_PARAMS params = kernel.params;
+      params.kernelParams = args.data();
+      params.extra = nullptr;
+      CUDA_DRIVER_CALL(cuGraphExecKernelNodeSetParams(
+          reinterpret_cast<CUgraphExec>(cuda_graph_exec_), kernel.node, &params));
+    }
+  }
+
+  // Capture the graph again as the last capture, with the current pointers.
+  void Recapture() {
+    if (num_streams_ > 1) {
+      CaptureMultiStream(num_streams_);
+    } else {
+      StartCapture();
+      GraphExecutor::Run();
+      EndCapture();
+    }
+  }
+
+  void DestroyGraph() {
+    if (cuda_graph_exec_ != nullptr) cudaGraphExecDestroy(cuda_graph_exec_);
+    if (cuda_graph_ != nullptr) cudaGraphDestroy(cuda_graph_);
+    cuda_graph_exec_ = nullptr;
+    cuda_graph_ = nullptr;
+  }
+
+  /*!
+   * \brief The ops each op waits on: the last writer of the storage of its inputs, and the last
+   * writer and the readers since of the storage of its outputs. The planned storage is shared by
+   * the entries not alive at the same time, the ops of independent branches may still conflict
+   * on it.
+   */
+  std::vector<std::vector<uint32_t>> OpDependencies() const {
+    std::vector<int64_t> last_writer(storage_pool_.size(), -1);
+    std::vector<std::vector<uint32_t>> readers(storage_pool_.size());
+    std::vector<std::vector<uint32_t>> deps(op_execs_.size());
+    for (uint32_t nid = 0; nid < op_execs_.size(); ++nid) {
+      if (!op_execs_[nid]) continue;
+      const auto& inode = nodes_[nid];
+      std::set<uint32_t> wait;
+      for (const auto& e : inode.inputs) {
+        int sid = attrs_.storage_id[entry_id(e)];
+        if (last_writer[sid] >= 0) wait.insert(last_writer[sid]);
+      }
+      for (uint32_t index = 0; index < inode.param.num_outputs; ++index) {
+        int sid = attrs_.storage_id[entry_id(nid, index)];
+        if (last_writer[sid] >= 0) wait.insert(last_writer[sid]);
+        for (uint32_t reader : readers[sid]) wait.insert(reader);
+      }
+      wait.erase(nid);
+      deps[nid].assign(wait.begin(), wait.end());
+      for (const auto& e : inode.inputs) {
+        readers[attrs_.storage_id[entry_id(e)]].push_back(nid);
+      }
+      for (uint32_t index = 0; index < inode.param.num_outputs; ++index) {
+        int sid = attrs_.storage_id[entry_id(nid, index)];
+        last_writer[sid] = nid;
+        readers[sid].clear();
+      }
+    }
+    return deps;
+  }
+
   /*! \brief The Cuda stream on which to capture a CUDA graph. */
-  TVMStreamHandle capture_stream_;
+  TVMStreamHandle capture_stream_{nullptr};
+  /*! \brief The captured CUDA graph. */
+  cudaGraph_t cuda_graph_{nullptr};
   /*! \brief The captured CUDA graph will be instantiated to this. */
-  cudaGraphExec_t cuda_graph_exec_;
+  cudaGraphExec_t cuda_graph_exec_{nullptr};
+  /*! \brief The number of streams of the last capture. */
+  int num_streams_{1};
+  /*! \brief The kernel nodes holding the pointers of the bound entries. */
+  std::vector<KernelNode> kernel_nodes_;
+  /*! \brief The inputs and outputs by entry id. */
+  std::unordered_map<uint32_t, BoundEntry> bound_entries_;
 };
 
 PackedFunc GraphExecutorCudaGraph::GetFunction(const String& name,
@@ -101,8 +394,16 @@ PackedFunc GraphExecutorCudaGraph::GetFunction(const String& name,
   } else if (name == "start_capture") {
     return PackedFunc(
         [sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { this->StartCapture(); });
+  } else if (name == "capture_multi_stream") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      this->CaptureMultiStream(args[0]);
+    });
   } else if (name == "end_capture") {
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { this->EndCapture(); });
+  } else if (name == "num_patchable_entries") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      *rv = this->NumPatchableEntries();
+    });
   } else {
     return GraphExecutor::GetFunction(name, sptr_to_self);
   }
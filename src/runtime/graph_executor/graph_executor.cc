@@ -59,10 +59,31 @@ constexpr auto Is2DStorage = IsTextureStorage;
  * \brief Run all the operations one by one.
  */
 void GraphExecutor::Run() {
+  if (streamer_ != nullptr) streamer_->BeginRun();
+  if (sampling_profiler_ != nullptr && sampling_profiler_->StartRequest()) {
+    for (size_t i = 0; i < op_execs_.size(); ++i) {
+      if (!op_execs_[i]) continue;
+      if (l2_prefetcher_ != nullptr) PrefetchL2(i);
+      if (streamer_ != nullptr) streamer_->BeforeOp(i);
+      sampling_profiler_->StartCall(nodes_[i].param.func_name,
+                                    data_entry_[entry_id(i, 0)]->device);
+      op_execs_[i]();
+      sampling_profiler_->StopCall();
+      if (streamer_ != nullptr) streamer_->AfterOp(i);
+    }
+    sampling_profiler_->StopRequest();
+    if (streamer_ != nullptr) streamer_->EndRun();
+    return;
+  }
   // setup the array and requirements.
   for (size_t i = 0; i < op_execs_.size(); ++i) {
-    if (op_execs_[i]) op_execs_[i]();
+    if (!op_execs_[i]) continue;
+    if (l2_prefetcher_ != nullptr) PrefetchL2(i);
+    if (streamer_ != nullptr) streamer_->BeforeOp(i);
+    op_execs_[i]();
+    if (streamer_ != nullptr) streamer_->AfterOp(i);
   }
+  if (streamer_ != nullptr) streamer_->EndRun();
 }
 
 /*!
@@ -89,6 +110,7 @@ void GraphExecutor::Init(const std::string& graph_json, tvm::runtime::Module mod
   }
   this->SetupStorage();
   this->SetupOpExecs();
+  if (!streamed_params_.empty()) this->SetupWeightStreaming();
   for (size_t i = 0; i < input_nodes_.size(); i++) {
     const uint32_t nid = input_nodes_[i];
     std::string& name = nodes_[nid].name;
@@ -180,7 +202,20 @@ int GraphExecutor::GetOutputIndex(const std::string& name) {
 void GraphExecutor::SetInput(int index, DLTensor* data_in) {
   ICHECK_LT(static_cast<size_t>(index), input_nodes_.size());
   uint32_t eid = this->entry_id(input_nodes_[index], 0);
-  data_entry_[eid].CopyFrom(data_in);
+  if (streamed_index_[eid] >= 0) {
+    streamer_->SetParam(streamed_index_[eid], data_in);
+    return;
+  }
+  // the copy goes to the own array of the executor, which replaces an array bound to the input
+  if (static_cast<size_t>(index) < bound_inputs_.size() && bound_inputs_[index].defined()) {
+    bound_inputs_[index] = NDArray();
+    PatchInput(eid, static_cast<char*>(data_entry_[eid]->data) + data_entry_[eid]->byte_offset);
+  }
+  // an upload from the host returns once staged, the work queued afterwards waits for it
+  DLTensor* target = const_cast<DLTensor*>(data_entry_[eid].operator->());
+  Device dev = target->device;
+  NDArray::CopyFromToAsync(data_in, target)
+      .StreamWait(DeviceAPI::Get(dev)->GetCurrentStream(dev));
 }
 /*!
  * \brief Check the legality of external DLTensor*.
@@ -212,9 +247,7 @@ void GraphExecutor::SetInputZeroCopy(int index, DLTensor* data_ref) {
   // check the consistency of input
   CheckExternalDLTensor(data_ref, eid);
   // Update the data pointer for each argument of each op
-  for (DLTensor* t : input_dltensors_[eid]) {
-    t->data = static_cast<char*>(data_ref->data) + data_ref->byte_offset;
-  }
+  PatchInput(eid, static_cast<char*>(data_ref->data) + data_ref->byte_offset);
 }
 /*!
  * \brief set index-th output to the graph without copying the data.
@@ -230,16 +263,63 @@ void GraphExecutor::SetOutputZeroCopy(int index, DLTensor* data_ref) {
   // check the consistency of output
   CheckExternalDLTensor(data_ref, output_node_eid);
 
-  // Update the data pointer for output op
-  for (DLTensor* t : output_dltensors_[output_node_eid]) {
-    t->data = static_cast<char*>(data_ref->data) + data_ref->byte_offset;
+  PatchOutput(output_node_eid, static_cast<char*>(data_ref->data) + data_ref->byte_offset);
+}
+
+void GraphExecutor::PatchInput(uint32_t eid, void* data) {
+  for (DLTensor* t : input_dltensors_[eid]) {
+    t->data = data;
   }
+}
 
+void GraphExecutor::PatchOutput(uint32_t eid, void* data) {
+  // Update the data pointer for output op
+  for (DLTensor* t : output_dltensors_[eid]) {
+    t->data = data;
+  }
   // Update the input of the op connected to the output
-  for (DLTensor* t : both_output_opinput_dltensors_[output_node_eid]) {
-    t->data = static_cast<char*>(data_ref->data) + data_ref->byte_offset;
+  for (DLTensor* t : both_output_opinput_dltensors_[eid]) {
+    t->data = data;
   }
 }
+
+void GraphExecutor::BindInput(int index, NDArray data) {
+  SetInputZeroCopy(index, const_cast<DLTensor*>(data.operator->()));
+  bound_inputs_.resize(input_nodes_.size());
+  bound_inputs_[index] = std::move(data);
+}
+
+void GraphExecutor::BindOutput(int index, NDArray data) {
+  SetOutputZeroCopy(index, const_cast<DLTensor*>(data.operator->()));
+  bound_outputs_.resize(outputs_.size());
+  bound_outputs_[index] = std::move(data);
+}
+
+void GraphExecutor::CheckSwap(const NDArray& bound, const NDArray& data) const {
+  ICHECK(data->device.device_type == bound->device.device_type &&
+         data->device.device_id == bound->device.device_id &&
+         GetDataSize(*data.operator->()) == GetDataSize(*bound.operator->()))
+      << "The swapped array should be of the size and on the device of the bound one";
+  ICHECK_EQ(reinterpret_cast<size_t>(static_cast<char*>(data->data) + data->byte_offset) %
+                kAllocAlignment,
+            0);
+}
+
+void GraphExecutor::SwapInput(int index, NDArray data) {
+  ICHECK(static_cast<size_t>(index) < bound_inputs_.size() && bound_inputs_[index].defined())
+      << "The input " << index << " should be bound before it is swapped";
+  CheckSwap(bound_inputs_[index], data);
+  PatchInput(entry_id(input_nodes_[index], 0), static_cast<char*>(data->data) + data->byte_offset);
+  bound_inputs_[index] = std::move(data);
+}
+
+void GraphExecutor::SwapOutput(int index, NDArray data) {
+  ICHECK(static_cast<size_t>(index) < bound_outputs_.size() && bound_outputs_[index].defined())
+      << "The output " << index << " should be bound before it is swapped";
+  CheckSwap(bound_outputs_[index], data);
+  PatchOutput(entry_id(outputs_[index]), static_cast<char*>(data->data) + data->byte_offset);
+  bound_outputs_[index] = std::move(data);
+}
 /*!
  * \brief Get the number of outputs
  *
@@ -261,6 +341,10 @@ int GraphExecutor::NumInputs() const { return input_nodes_.size(); }
 NDArray GraphExecutor::GetInput(int index) const {
   ICHECK_LT(static_cast<size_t>(index), input_nodes_.size());
   uint32_t eid = this->entry_id(input_nodes_[index], 0);
+  // the entry of a streamed param has no storage of its own, its value is the host array
+  if (streamer_ != nullptr && streamed_index_[eid] >= 0) {
+    return streamer_->host(streamed_index_[eid]);
+  }
   return data_entry_[eid];
 }
 /*!
@@ -309,7 +393,11 @@ void GraphExecutor::LoadParams(dmlc::Stream* strm) {
     int in_idx = GetInputIndex(p.first);
     if (in_idx < 0) continue;
     uint32_t eid = this->entry_id(input_nodes_[in_idx], 0);
-    data_entry_[eid].CopyFrom(p.second);
+    if (streamed_index_[eid] >= 0) {
+      streamer_->SetParam(streamed_index_[eid], p.second.operator->());
+    } else {
+      data_entry_[eid].CopyFrom(p.second);
+    }
   }
 }
 
@@ -329,6 +417,13 @@ void GraphExecutor::ShareParams(const GraphExecutor& other, dmlc::Stream* strm)
     if (in_idx < 0) continue;
     uint32_t eid = this->entry_id(input_nodes_[in_idx], 0);
     ICHECK_LT(eid, data_entry_.size());
+    // the streamed params stay streamed from their own host arrays
+    if (streamed_index_[eid] >= 0) continue;
+    // a param streamed by the other executor has no device array to share, it is copied
+    if (other.streamer_ != nullptr && other.streamed_index_[eid] >= 0) {
+      data_entry_[eid].CopyFrom(other.GetInput(in_idx));
+      continue;
+    }
     ICHECK_EQ(data_entry_[eid].use_count(), 1);
     data_entry_[eid] = other.GetInput(GetInputIndex(names[i]));
     ICHECK_GT(data_entry_[eid].use_count(), 1);
@@ -338,6 +433,49 @@ void GraphExecutor::ShareParams(const GraphExecutor& other, dmlc::Stream* strm)
   this->SetupOpExecs();
 }
 
+void GraphExecutor::ShareStorage(const GraphExecutor& other) {
+  ICHECK_EQ(attrs_.storage_id.size(), other.attrs_.storage_id.size())
+      << "The storage can only be shared by the executors of the same graph";
+  ICHECK_EQ(storage_pool_.size(), other.storage_pool_.size())
+      << "The storage can only be shared by the executors of the same graph";
+  std::vector<bool> input_sid(storage_pool_.size(), false);
+  for (uint32_t nid : input_nodes_) {
+    input_sid[attrs_.storage_id[entry_id(nid, 0)]] = true;
+  }
+  for (size_t sid = 0; sid < storage_pool_.size(); ++sid) {
+    if (input_sid[sid]) continue;
+    const NDArray& storage = other.storage_pool_[sid];
+    ICHECK(storage->device.device_type == storage_pool_[sid]->device.device_type &&
+           storage->device.device_id == storage_pool_[sid]->device.device_id &&
+           GetDataSize(*storage.operator->()) >= GetDataSize(*storage_pool_[sid].operator->()))
+        << "The storage " << sid << " can not be shared, the executors should be of the same "
+        << "graph on the same devices";
+    storage_pool_[sid] = storage;
+    for (uint32_t eid : sid_to_eid_[sid]) {
+      data_entry_[eid] = storage.CreateView(attrs_.shape[eid], data_entry_[eid]->dtype);
+    }
+  }
+  this->SetupOpExecs();
+}
+
+void GraphExecutor::SetStreamedParams(const Map<String, NDArray>& params, int64_t window_bytes,
+                                      int64_t min_bytes, bool pin) {
+  ICHECK(data_entry_.empty()) << "The streamed params should be set before Init";
+  ICHECK_GE(window_bytes, 0);
+  for (const auto& kv : params) {
+    if (static_cast<int64_t>(GetDataSize(*kv.second.operator->())) >= min_bytes) {
+      streamed_params_.Set(kv.first, kv.second);
+    }
+  }
+  stream_window_bytes_ = static_cast<size_t>(window_bytes);
+  pin_streamed_params_ = pin;
+}
+
+bool GraphExecutor::IsStreamed(const std::string& name) {
+  int in_idx = GetInputIndex(name);
+  return in_idx >= 0 && streamed_index_[entry_id(input_nodes_[in_idx], 0)] >= 0;
+}
+
 void GraphExecutor::LinkedNDArrayDeleter(Object* container) {
   // container is the NDArray::Container which needs to get deleted.
   // The data member points to global const memory, so it does not need deleting.
@@ -447,8 +585,41 @@ void GraphExecutor::SetupStorage() {
     }
   }
 
+  // The streamed params get no storage, their entries point into the window of the streamer. A
+  // param is streamed if an op reads it and its storage is not shared with another entry.
+  streamed_index_.assign(num_node_entries(), -1);
+  std::vector<bool> streamed_sid(pool_entry.size(), false);
+  if (!streamed_params_.empty()) {
+    std::vector<int> sid_entries(pool_entry.size(), 0);
+    for (int storage_id : attrs_.storage_id) ++sid_entries[storage_id];
+    std::vector<bool> read(num_node_entries(), false);
+    for (const Node& node : nodes_) {
+      for (const NodeEntry& e : node.inputs) read[entry_id(e)] = true;
+    }
+    for (const NodeEntry& e : outputs_) read[entry_id(e)] = false;
+    for (uint32_t nid : input_nodes_) {
+      uint32_t eid = entry_id(nid, 0);
+      uint32_t sid = static_cast<uint32_t>(attrs_.storage_id[eid]);
+      const PoolEntry& pit = pool_entry[sid];
+      if (streamed_params_.count(nodes_[nid].name) && read[eid] && sid_entries[sid] == 1 &&
+          !pit.linked_param.defined() && pit.scope.empty() &&
+          pit.device_type == static_cast<int>(devices_[0].device_type)) {
+        streamed_sid[sid] = true;
+        streamed_index_[eid] = 0;
+      }
+    }
+  }
+
+  // TVM_GRAPH_EXECUTOR_ALLOCATOR=caching takes the storage of the global scope from the caching
+  // allocator, which keeps it for the next executors once this one is destroyed.
+  static const AllocatorType global_alloc_type = [] {
+    const char* val = getenv("TVM_GRAPH_EXECUTOR_ALLOCATOR");
+    return val != nullptr && std::string(val) == "caching" ? AllocatorType::kCaching
+                                                           : AllocatorType::kNaive;
+  }();
   // Allocate the space.
-  for (const auto& pit : pool_entry) {
+  for (size_t sid = 0; sid < pool_entry.size(); ++sid) {
+    const PoolEntry& pit = pool_entry[sid];
     // This for loop is very fast since there are usually only a couple of
     // devices available on the same hardware.
     const auto& cit = std::find_if(devices_.begin(), devices_.end(), [&pit](const Device& d) {
@@ -457,6 +628,11 @@ void GraphExecutor::SetupStorage() {
     Device dev = cit == devices_.end() ? devices_[0] : *cit;
     if (pit.linked_param.defined()) {
       storage_pool_.push_back(pit.linked_param);
+    } else if (streamed_sid[sid]) {
+      std::vector<int64_t> shape{(pit.shape[0] + 3) / 4};
+      auto* container = new NDArray::Container(nullptr, shape, pit.dtype, dev);
+      container->SetDeleter(GraphExecutor::LinkedNDArrayDeleter);
+      storage_pool_.push_back(NDArray(GetObjectPtr<Object>(container)));
     } else {
       std::vector<int64_t> shape = pit.shape;
       if (shape.size() == 1) {
@@ -466,7 +642,8 @@ void GraphExecutor::SetupStorage() {
       if (!pit.scope.empty()) {
         mem_scope = String(pit.scope);
       }
-      storage_pool_.push_back(MemoryManager::GetOrCreateAllocator(dev, AllocatorType::kNaive)
+      AllocatorType alloc_type = mem_scope.defined() ? AllocatorType::kNaive : global_alloc_type;
+      storage_pool_.push_back(MemoryManager::GetOrCreateAllocator(dev, alloc_type)
                                   ->Empty(shape, pit.dtype, dev, mem_scope));
     }
   }
@@ -493,9 +670,10 @@ void GraphExecutor::SetupStorage() {
 
 void GraphExecutor::SetupOpExecs() {
   op_execs_.resize(this->GetNumOfNodes());
-  input_dltensors_.resize(num_node_entries());
-  output_dltensors_.resize(num_node_entries());
-  both_output_opinput_dltensors_.resize(num_node_entries());
+  // the op arguments of the previous setup, if any, are released
+  input_dltensors_.assign(num_node_entries(), {});
+  output_dltensors_.assign(num_node_entries(), {});
+  both_output_opinput_dltensors_.assign(num_node_entries(), {});
   std::unordered_set<uint32_t> input_node_eids;
   for (size_t i = 0; i < input_nodes_.size(); i++) {
     uint32_t nid = input_nodes_[i];
@@ -557,6 +735,122 @@ void GraphExecutor::SetupOpExecs() {
       }
     }
   }
+  // the bound arrays stay bound to the new op arguments
+  for (size_t i = 0; i < bound_inputs_.size(); ++i) {
+    if (bound_inputs_[i].defined()) BindInput(i, bound_inputs_[i]);
+  }
+  for (size_t i = 0; i < bound_outputs_.size(); ++i) {
+    if (bound_outputs_[i].defined()) BindOutput(i, bound_outputs_[i]);
+  }
+  // and the streamed params to the window
+  if (streamer_ != nullptr) PatchStreamedParams();
+}
+
+void GraphExecutor::SetupWeightStreaming() {
+  // the first and the last op reading each streamed entry
+  std::unordered_map<uint32_t, std::pair<size_t, size_t>> uses;
+  for (uint32_t nid = 0; nid < this->GetNumOfNodes(); ++nid) {
+    if (nodes_[nid].op_type != "tvm_op") continue;
+    for (const auto& e : nodes_[nid].inputs) {
+      uint32_t eid = this->entry_id(e);
+      if (streamed_index_[eid] < 0) continue;
+      auto it = uses.find(eid);
+      if (it == uses.end()) {
+        uses[eid] = {nid, nid};
+      } else {
+        it->second.second = nid;
+      }
+    }
+  }
+  // the streamed input nodes in the order of their first use
+  std::vector<uint32_t> nids;
+  for (uint32_t nid : input_nodes_) {
+    if (streamed_index_[this->entry_id(nid, 0)] >= 0) nids.push_back(nid);
+  }
+  if (nids.empty()) {
+    streamed_params_ = {};
+    return;
+  }
+  std::sort(nids.begin(), nids.end(), [this, &uses](uint32_t a, uint32_t b) {
+    return uses[this->entry_id(a, 0)].first < uses[this->entry_id(b, 0)].first;
+  });
+  Device dev = data_entry_[this->entry_id(nids[0], 0)]->device;
+  Device pinned{kDLCPU, 0};
+  if (dev.device_type == kDLCUDA) pinned = {kDLCUDAHost, 0};
+  if (dev.device_type == kDLROCM) pinned = {kDLROCMHost, 0};
+  std::vector<WeightStreamer::Param> params;
+  for (uint32_t nid : nids) {
+    uint32_t eid = this->entry_id(nid, 0);
+    NDArray host = streamed_params_[nodes_[nid].name];
+    ICHECK_EQ(GetDataSize(*host.operator->()), GetDataSize(*data_entry_[eid].operator->()))
+        << "The streamed param " << nodes_[nid].name << " is not of the size of the input";
+    if (pin_streamed_params_ && pinned.device_type != kDLCPU) {
+      NDArray copy = NDArray::Empty(host.Shape(), host.DataType(), pinned);
+      copy.CopyFrom(host);
+      host = copy;
+    }
+    params.push_back({host, uses[eid].first, uses[eid].second});
+  }
+  streamer_ = std::make_unique<WeightStreamer>(dev, std::move(params), this->GetNumOfNodes(),
+                                               stream_window_bytes_);
+  for (size_t k = 0; k < nids.size(); ++k) {
+    streamed_index_[this->entry_id(nids[k], 0)] = k;
+  }
+  PatchStreamedParams();
+  // the host arrays are held by the streamer
+  streamed_params_ = {};
+}
+
+int64_t GraphExecutor::SetL2Prefetch(bool enable, int64_t persisting_bytes) {
+  ICHECK(!op_execs_.empty()) << "The L2 prefetch should be set after Init";
+  l2_prefetcher_.reset();
+  l2_prefetch_eids_.clear();
+  if (!enable) return 0;
+  // the resident params on the CUDA device read by each op, the streamed ones are not uploaded
+  // yet when the previous op runs
+  std::vector<std::vector<uint32_t>> params(op_execs_.size());
+  Device dev{kDLCPU, 0};
+  for (uint32_t nid = 0; nid < this->GetNumOfNodes(); ++nid) {
+    if (nodes_[nid].op_type != "tvm_op") continue;
+    for (const auto& e : nodes_[nid].inputs) {
+      uint32_t eid = this->entry_id(e);
+      if (nodes_[e.node_id].op_type != "null" || streamed_index_[eid] >= 0) continue;
+      if (data_entry_[eid]->device.device_type != kDLCUDA) continue;
+      dev = data_entry_[eid]->device;
+      params[nid].push_back(eid);
+    }
+  }
+  if (dev.device_type != kDLCUDA) {
+    LOG(WARNING) << "The L2 prefetch is disabled, no op reads params on a CUDA device";
+    return 0;
+  }
+  l2_prefetcher_ = std::make_unique<L2Prefetcher>(dev, persisting_bytes);
+  // each op prefetches the params of the next op reading params
+  l2_prefetch_eids_.resize(op_execs_.size());
+  std::vector<uint32_t>* next = nullptr;
+  for (size_t i = op_execs_.size(); i-- > 0;) {
+    if (next != nullptr) l2_prefetch_eids_[i] = *next;
+    if (!params[i].empty()) next = &params[i];
+  }
+  return l2_prefetcher_->persisting_bytes();
+}
+
+void GraphExecutor::PrefetchL2(size_t op) {
+  if (l2_prefetch_eids_[op].empty()) return;
+  // the arguments of the ops are patched by the zero copy inputs and the shared params
+  l2_prefetch_tensors_.clear();
+  for (uint32_t eid : l2_prefetch_eids_[op]) {
+    l2_prefetch_tensors_.push_back(input_dltensors_[eid].empty()
+                                       ? data_entry_[eid].operator->()
+                                       : input_dltensors_[eid][0]);
+  }
+  l2_prefetcher_->Prefetch(l2_prefetch_tensors_);
+}
+
+void GraphExecutor::PatchStreamedParams() {
+  for (uint32_t eid = 0; eid < streamed_index_.size(); ++eid) {
+    if (streamed_index_[eid] >= 0) PatchInput(eid, streamer_->Address(streamed_index_[eid]));
+  }
 }
 
 std::pair<std::function<void()>, std::shared_ptr<GraphExecutor::OpArgs>> GraphExecutor::CreateTVMOp(
@@ -678,6 +972,22 @@ PackedFunc GraphExecutor::GetFunction(const String& name, const ObjectPtr<Object
         [sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { *rv = this->NumInputs(); });
   } else if (name == "run") {
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { this->Run(); });
+  } else if (name == "enable_sampling_profiler") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      int sample_every = args[0];
+      int64_t capacity = args[1];
+      sampling_profiler_ = std::make_unique<profiling::SamplingProfiler>(sample_every, capacity);
+    });
+  } else if (name == "sampling_profiler_chrome_trace") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      ICHECK(sampling_profiler_ != nullptr) << "The sampling profiler is not enabled";
+      *rv = sampling_profiler_->AsChromeTrace();
+    });
+  } else if (name == "sampling_profiler_prometheus") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      ICHECK(sampling_profiler_ != nullptr) << "The sampling profiler is not enabled";
+      *rv = sampling_profiler_->AsPrometheus();
+    });
   } else if (name == "run_from_inputs") {
     return PackedFunc(
         [sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
@@ -718,6 +1028,49 @@ PackedFunc GraphExecutor::GetFunction(const String& name, const ObjectPtr<Object
       dmlc::MemoryStringStream strm(const_cast<std::string*>(&param_blob));
       this->ShareParams(dynamic_cast<const GraphExecutor&>(*module.operator->()), &strm);
     });
+  } else if (name == "bind_input" || name == "swap_input") {
+    bool swap = name == "swap_input";
+    return PackedFunc([sptr_to_self, this, swap](TVMArgs args, TVMRetValue* rv) {
+      int in_idx = String::CanConvertFrom(args[0]) ? this->GetInputIndex(args[0].operator String())
+                                                   : args[0].operator int();
+      ICHECK_GE(in_idx, 0) << "Invalid input name";
+      if (swap) {
+        this->SwapInput(in_idx, args[1]);
+      } else {
+        this->BindInput(in_idx, args[1]);
+      }
+    });
+  } else if (name == "bind_output" || name == "swap_output") {
+    bool swap = name == "swap_output";
+    return PackedFunc([sptr_to_self, this, swap](TVMArgs args, TVMRetValue* rv) {
+      int out_idx = String::CanConvertFrom(args[0])
+                        ? this->GetOutputIndex(args[0].operator String())
+                        : args[0].operator int();
+      ICHECK_GE(out_idx, 0) << "Invalid output name";
+      if (swap) {
+        this->SwapOutput(out_idx, args[1]);
+      } else {
+        this->BindOutput(out_idx, args[1]);
+      }
+    });
+  } else if (name == "share_storage") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      const auto& module = args[0].operator Module();
+      ICHECK_EQ(module.operator->()->type_key(), std::string("GraphExecutor"));
+      this->ShareStorage(dynamic_cast<const GraphExecutor&>(*module.operator->()));
+    });
+  } else if (name == "is_streamed") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      *rv = this->IsStreamed(args[0].operator String());
+    });
+  } else if (name == "set_l2_prefetch") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      *rv = this->SetL2Prefetch(args[0], args[1]);
+    });
+  } else if (name == "get_stream_window_bytes") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      *rv = streamer_ != nullptr ? static_cast<int64_t>(streamer_->window_bytes()) : int64_t(0);
+    });
   } else if (name == "get_input_index") {
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
       CHECK(String::CanConvertFrom(args[0])) << "Input key is not a string";
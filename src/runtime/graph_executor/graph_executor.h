@@ -40,6 +40,10 @@
 #include <utility>
 #include <vector>
 
+#include "../sampling_profiler.h"
+#include "l2_prefetcher.h"
+#include "weight_streamer.h"
+
 namespace tvm {
 namespace runtime {
 
@@ -155,6 +159,33 @@ class TVM_DLL GraphExecutor : public ModuleNode {
    * \param data_ref The output data that is referred.
    */
   void SetOutputZeroCopy(int index, DLTensor* data_ref);
+  /*!
+   * \brief Bind index-th input to data for all the following runs, as SetInputZeroCopy but
+   *  holding a reference to data until the input is bound again or set by SetInput.
+   * \param index The input index.
+   * \param data The input data that is referred.
+   */
+  void BindInput(int index, NDArray data);
+  /*!
+   * \brief Bind index-th output to data for all the following runs, as SetOutputZeroCopy but
+   *  holding a reference to data until the output is bound again.
+   * \param index The output index.
+   * \param data The output data that is referred.
+   */
+  void BindOutput(int index, NDArray data);
+  /*!
+   * \brief Swap the bound index-th input for data of the same size on the same device, only the
+   *  pointers of the op arguments are patched, e.g. to alternate between two buffers.
+   * \param index The input index.
+   * \param data The input data that is referred.
+   */
+  void SwapInput(int index, NDArray data);
+  /*!
+   * \brief Swap the bound index-th output for data of the same size on the same device.
+   * \param index The output index.
+   * \param data The output data that is referred.
+   */
+  void SwapOutput(int index, NDArray data);
   /*!
    * \brief Get the number of outputs
    *
@@ -206,6 +237,43 @@ class TVM_DLL GraphExecutor : public ModuleNode {
    */
   void ShareParams(const GraphExecutor& other, dmlc::Stream* strm);
 
+  /*!
+   * \brief Share the planned storage of the intermediate results and the outputs with a
+   * pre-existing GraphExecutor instance of the same graph, the storage of the inputs and the
+   * params stays separate. The instances sharing their storage must not run concurrently, and
+   * the outputs of one are overwritten by the next run of the others.
+   * \param other A GraphExecutor instance of the same graph on the same devices.
+   */
+  void ShareStorage(const GraphExecutor& other);
+
+  /*!
+   * \brief Keep the given params in the host memory and stream them through a window of device
+   *  memory during the runs, instead of allocating their storage on the device. To be called
+   *  before Init, the params read by no op or sharing their storage stay resident.
+   * \param params The params, e.g. loaded from a file with LoadParamsMapped.
+   * \param window_bytes The size of the window, 0 to size it from the params read by the ops.
+   * \param min_bytes The size of the smallest streamed param, the smaller ones stay resident.
+   * \param pin Whether to copy the streamed params into the pinned host memory of the device.
+   */
+  void SetStreamedParams(const Map<String, NDArray>& params, int64_t window_bytes,
+                         int64_t min_bytes, bool pin);
+
+  /*!
+   * \brief Whether the param is streamed from the host memory, see SetStreamedParams.
+   * \param name The name of the param.
+   */
+  bool IsStreamed(const std::string& name);
+
+  /*!
+   * \brief Prefetch the params of the next op reading params into the L2 cache of the CUDA device
+   *  while each op runs, see L2Prefetcher. To be called after Init.
+   * \param enable Whether to prefetch the params.
+   * \param persisting_bytes The size of the persisting L2 cache set aside for the params, -1 for
+   *  the max of the device and 0 for none.
+   * \return The size of the persisting L2 cache, 0 if none is set aside.
+   */
+  int64_t SetL2Prefetch(bool enable, int64_t persisting_bytes);
+
   /*!
    * \brief Get total number of nodes.
    * \return Total number of nodes.
@@ -428,12 +496,28 @@ class TVM_DLL GraphExecutor : public ModuleNode {
   void SetupStorage();
   /*! \brief Setup the executors. */
   void SetupOpExecs();
+  /*! \brief Plan the streaming of the streamed params over the ops and patch their arguments. */
+  void SetupWeightStreaming();
+  /*! \brief Point the op arguments of the streamed params to their regions of the window. */
+  void PatchStreamedParams();
+  /*! \brief Prefetch the params of the next op reading params into the L2 cache before op runs. */
+  void PrefetchL2(size_t op);
   /*!
    * \brief Check the legality of external DLTensor*.
    * \param external The external DLTensor*.
    * \param eid The data_enrty_ index.
    */
   void CheckExternalDLTensor(const DLTensor* external, uint32_t eid) const;
+  /*!
+   * \brief Check that data can replace the bound array of the same size on the same device.
+   * \param bound The bound array.
+   * \param data The array to swap in.
+   */
+  void CheckSwap(const NDArray& bound, const NDArray& data) const;
+  /*! \brief Point the op arguments reading the eid-th input entry to data. */
+  void PatchInput(uint32_t eid, void* data);
+  /*! \brief Point the op arguments of the eid-th output entry to data. */
+  void PatchOutput(uint32_t eid, void* data);
   /*!
    * \brief Create an execution function given input.
    * \param attrs The node attributes.
@@ -484,6 +568,28 @@ class TVM_DLL GraphExecutor : public ModuleNode {
   std::vector<size_t> data_alignment_;
   /*! \brief Operator on each node. */
   std::vector<std::function<void()>> op_execs_;
+  /*! \brief The always-on profiler of the sampled runs, null unless it was enabled. */
+  std::unique_ptr<profiling::SamplingProfiler> sampling_profiler_;
+  /*! \brief The params to stream, see SetStreamedParams. */
+  Map<String, NDArray> streamed_params_;
+  /*! \brief The size of the window of the streamed params, 0 to size it from the ops. */
+  size_t stream_window_bytes_{0};
+  /*! \brief Whether to pin the host memory of the streamed params. */
+  bool pin_streamed_params_{false};
+  /*! \brief The index in streamer_ of the param of each entry, -1 for the resident entries. */
+  std::vector<int64_t> streamed_index_;
+  /*! \brief The streaming of the params, null unless params are streamed. */
+  std::unique_ptr<WeightStreamer> streamer_;
+  /*! \brief The resident params of the next op reading params, prefetched during each op. */
+  std::vector<std::vector<uint32_t>> l2_prefetch_eids_;
+  /*! \brief The tensors prefetched before an op. */
+  std::vector<const DLTensor*> l2_prefetch_tensors_;
+  /*! \brief The prefetch of the params into the L2 cache, null unless it is enabled. */
+  std::unique_ptr<L2Prefetcher> l2_prefetcher_;
+  /*! \brief The arrays bound to the inputs by BindInput, undefined for the others. */
+  std::vector<NDArray> bound_inputs_;
+  /*! \brief The arrays bound to the outputs by BindOutput, undefined for the others. */
+  std::vector<NDArray> bound_outputs_;
   /*! \brief Linked parameter lookup function. */
   PackedFunc lookup_linked_param_;
   /*! \brief Module's _lookup_linked_param function, used by DefaultLookupLinkedParam. */
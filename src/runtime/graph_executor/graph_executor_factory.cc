@@ -93,6 +93,19 @@ PackedFunc GraphExecutorFactory::GetFunction(
       }
       *rv = this->CudaGraphExecutorCreate(devices);
     });
+  } else if (name == "streamed_create") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      ICHECK_GE(args.size(), 5);
+      int64_t window_bytes = args[0];
+      int64_t min_bytes = args[1];
+      bool pin = args[2];
+      Map<String, NDArray> params = args[3];
+      std::vector<Device> devices;
+      for (int i = 4; i < args.num_args; ++i) {
+        devices.emplace_back(args[i].operator Device());
+      }
+      *rv = this->StreamedExecutorCreate(devices, params, window_bytes, min_bytes, pin);
+    });
   } else {
     return PackedFunc();
   }
@@ -124,6 +137,30 @@ Module GraphExecutorFactory::ExecutorCreate(const std::vector<Device>& devs) {
   return Module(exec);
 }
 
+Module GraphExecutorFactory::StreamedExecutorCreate(const std::vector<Device>& devs,
+                                                    const Map<String, NDArray>& params,
+                                                    int64_t window_bytes, int64_t min_bytes,
+                                                    bool pin) {
+  // the given params replace the ones of the factory, e.g. with arrays mapped from a file
+  std::unordered_map<std::string, tvm::runtime::NDArray> value = this->params_;
+  for (const auto& kv : params) {
+    value[kv.first] = kv.second;
+  }
+  Map<String, NDArray> streamed;
+  for (const auto& kv : value) {
+    streamed.Set(kv.first, kv.second);
+  }
+  auto exec = make_object<GraphExecutor>();
+  exec->SetStreamedParams(streamed, window_bytes, min_bytes, pin);
+  exec->Init(this->graph_json_, this->imports_[0], devs, PackedFunc());
+  std::unordered_map<std::string, tvm::runtime::NDArray> resident;
+  for (const auto& kv : value) {
+    if (!exec->IsStreamed(kv.first)) resident.insert(kv);
+  }
+  SetParams(exec.get(), resident);
+  return Module(exec);
+}
+
 Module GraphExecutorFactory::DebugExecutorCreate(const std::vector<Device>& devs) {
   const PackedFunc* pf = tvm::runtime::Registry::Get("tvm.graph_executor_debug.create");
   ICHECK(pf != nullptr) << "Cannot find function tvm.graph_executor_debug.create in registry. "
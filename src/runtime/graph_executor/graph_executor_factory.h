@@ -92,6 +92,21 @@ class TVM_DLL GraphExecutorFactory : public runtime::ModuleNode {
    */
   Module DebugExecutorCreate(const std::vector<Device>& devs);
 
+  /*!
+   * \brief Create an executor module streaming its large params from the host memory, see
+   *  GraphExecutor::SetStreamedParams.
+   * \param devs The device of the host and devices where graph nodes will be
+   *  executed on.
+   * \param params The params replacing the ones of the factory, e.g. mapped from a file.
+   * \param window_bytes The size of the window of device memory, 0 to size it from the ops.
+   * \param min_bytes The size of the smallest streamed param.
+   * \param pin Whether to copy the streamed params into the pinned host memory.
+   * \return created executor module
+   */
+  Module StreamedExecutorCreate(const std::vector<Device>& devs,
+                                const Map<String, NDArray>& params, int64_t window_bytes,
+                                int64_t min_bytes, bool pin);
+
   /*!
    * \brief Create a specific cuda graph executor module
    * \param devs The device of the host and devices where graph nodes will be
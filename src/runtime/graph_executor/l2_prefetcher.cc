@@ -0,0 +1,82 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file l2_prefetcher.cc
+ */
+#include "l2_prefetcher.h"
+
+#include <tvm/runtime/logging.h>
+#include <tvm/runtime/registry.h>
+
+#include <algorithm>
+
+namespace tvm {
+namespace runtime {
+
+L2Prefetcher::L2Prefetcher(Device dev, int64_t persisting_bytes)
+    : dev_(dev), api_(DeviceAPI::Get(dev)) {
+  ICHECK_EQ(dev.device_type, kDLCUDA) << "The L2 prefetch needs a CUDA device";
+  const PackedFunc* prefetch = Registry::Get("runtime.cuda.l2_prefetch");
+  const PackedFunc* set_limit = Registry::Get("runtime.cuda.set_persisting_l2_limit");
+  const PackedFunc* get_limit = Registry::Get("runtime.cuda.get_persisting_l2_limit");
+  ICHECK(prefetch != nullptr && set_limit != nullptr && get_limit != nullptr)
+      << "The runtime is built without CUDA";
+  prefetch_ = *prefetch;
+  if (persisting_bytes != 0) {
+    set_limit_ = *set_limit;
+    saved_persisting_bytes_ = (*get_limit)(dev.device_id);
+    persisting_bytes_ = set_limit_(dev.device_id, persisting_bytes);
+  }
+  if (persisting_bytes_ > 0) {
+    budget_bytes_ = static_cast<size_t>(persisting_bytes_);
+  } else {
+    TVMRetValue l2_bytes;
+    api_->GetAttr(dev, kL2CacheSizeBytes, &l2_bytes);
+    budget_bytes_ = static_cast<size_t>(l2_bytes.operator int64_t()) / 2;
+  }
+  side_stream_ = api_->CreateStream(dev_);
+  ops_done_ = api_->CreateEvent(dev_);
+}
+
+L2Prefetcher::~L2Prefetcher() {
+  api_->StreamSync(dev_, side_stream_);
+  if (ops_done_ != nullptr) api_->FreeEvent(dev_, ops_done_);
+  if (side_stream_ != nullptr) api_->FreeStream(dev_, side_stream_);
+  // the limit set aside by the constructor goes back to the one before
+  if (set_limit_ != nullptr) set_limit_(dev_.device_id, saved_persisting_bytes_);
+}
+
+void L2Prefetcher::Prefetch(const std::vector<const DLTensor*>& tensors) {
+  if (tensors.empty()) return;
+  // the wait captures the ops queued so far, the event is recorded again by the next prefetch
+  api_->RecordEvent(dev_, ops_done_, api_->GetCurrentStream(dev_));
+  api_->StreamWaitEvent(dev_, side_stream_, ops_done_);
+  size_t budget = budget_bytes_;
+  for (const DLTensor* tensor : tensors) {
+    if (budget == 0) break;
+    size_t nbytes = std::min(GetDataSize(*tensor), budget);
+    budget -= nbytes;
+    void* ptr = static_cast<char*>(tensor->data) + tensor->byte_offset;
+    prefetch_(dev_.device_id, ptr, static_cast<int64_t>(nbytes), side_stream_, persisting_bytes_);
+  }
+}
+
+}  // namespace runtime
+}  // namespace tvm
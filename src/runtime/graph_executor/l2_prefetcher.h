@@ -0,0 +1,87 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file src/runtime/graph_executor/l2_prefetcher.h
+ * \brief The prefetch of the params of the next op into the L2 cache of a CUDA device while the
+ *  current op runs.
+ */
+#ifndef TVM_RUNTIME_GRAPH_EXECUTOR_L2_PREFETCHER_H_
+#define TVM_RUNTIME_GRAPH_EXECUTOR_L2_PREFETCHER_H_
+
+#include <tvm/runtime/c_runtime_api.h>
+#include <tvm/runtime/device_api.h>
+#include <tvm/runtime/packed_func.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace tvm {
+namespace runtime {
+
+/*!
+ * \brief Prefetches tensors into the L2 cache of a CUDA device on a side stream.
+ *
+ * The memory bound ops (e.g. the layers of a decode step) only start reading their weights from
+ * the device memory once they run. A prefetch queued before an op waits on an event for the ops
+ * queued before it, so that the lines of the next op are loaded while the op runs and not ahead
+ * of the whole run, which would evict them. The lines are loaded into the persisting part of the
+ * L2 cache when it is set aside, so that the streaming accesses of the current op do not evict
+ * them, and the prefetch is truncated to the part of the cache they can hold.
+ */
+class L2Prefetcher {
+ public:
+  /*!
+   * \brief Create the side stream and set the persisting part of the L2 cache.
+   * \param dev The CUDA device of the tensors.
+   * \param persisting_bytes The size of the persisting L2 cache, -1 for the max of the device and
+   *  0 to load the lines as normal ones. The size before is restored by the destructor.
+   */
+  L2Prefetcher(Device dev, int64_t persisting_bytes);
+  ~L2Prefetcher();
+
+  /*! \return The size of the persisting L2 cache, 0 if none is set aside. */
+  int64_t persisting_bytes() const { return persisting_bytes_; }
+  /*!
+   * \brief Prefetch the tensors once the ops queued so far on the current stream are done.
+   * \param tensors The tensors, the bytes beyond the budget of the cache are not prefetched.
+   */
+  void Prefetch(const std::vector<const DLTensor*>& tensors);
+
+ private:
+  Device dev_;
+  DeviceAPI* api_;
+  /*! \brief runtime.cuda.l2_prefetch */
+  PackedFunc prefetch_;
+  int64_t persisting_bytes_{0};
+  /*! \brief runtime.cuda.set_persisting_l2_limit, null when the limit is left unchanged. */
+  PackedFunc set_limit_;
+  /*! \brief The size of the persisting L2 cache before the constructor set it. */
+  int64_t saved_persisting_bytes_{0};
+  /*! \brief The bytes prefetched for an op, the persisting L2 cache or half of the L2 cache. */
+  size_t budget_bytes_{0};
+  TVMStreamHandle side_stream_{nullptr};
+  /*! \brief The end of the ops queued on the current stream before a prefetch. */
+  TVMEventHandle ops_done_{nullptr};
+};
+
+}  // namespace runtime
+}  // namespace tvm
+
+#endif  // TVM_RUNTIME_GRAPH_EXECUTOR_L2_PREFETCHER_H_
@@ -0,0 +1,178 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file weight_streamer.cc
+ */
+#include "weight_streamer.h"
+
+#include <tvm/runtime/logging.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace tvm {
+namespace runtime {
+namespace {
+/*! \brief The alignment of the regions in the window. */
+constexpr size_t kRegionAlignment = 256;
+
+size_t RegionBytes(const NDArray& arr) {
+  size_t nbytes = GetDataSize(*arr.operator->());
+  return (nbytes + kRegionAlignment - 1) / kRegionAlignment * kRegionAlignment;
+}
+}  // namespace
+
+bool WeightStreamer::Plan(std::vector<Param>* params, size_t window_bytes) {
+  size_t head = 0;
+  int64_t issue_after = -1;
+  for (size_t k = 0; k < params->size(); ++k) {
+    Param& p = (*params)[k];
+    size_t size = RegionBytes(p.host);
+    if (size > window_bytes) return false;
+    if (head + size > window_bytes) head = 0;
+    p.offset = head;
+    head += size;
+    // the region is free once the ops reading its previous occupants are done
+    p.wait_op = -1;
+    for (size_t j = 0; j < k; ++j) {
+      const Param& q = (*params)[j];
+      if (q.offset < p.offset + size && p.offset < q.offset + RegionBytes(q.host)) {
+        p.wait_op = std::max(p.wait_op, static_cast<int64_t>(q.last_op));
+      }
+    }
+    if (p.wait_op >= static_cast<int64_t>(p.first_op)) return false;
+    // the uploads are queued in order on the copy stream
+    issue_after = std::max(issue_after, p.wait_op);
+    p.issue_after = issue_after;
+  }
+  return true;
+}
+
+WeightStreamer::WeightStreamer(Device dev, std::vector<Param> params, size_t num_ops,
+                               size_t window_bytes)
+    : dev_(dev), api_(DeviceAPI::Get(dev)), params_(std::move(params)) {
+  size_t total = 0, largest = 0;
+  std::vector<size_t> live(num_ops, 0);
+  for (size_t k = 0; k < params_.size(); ++k) {
+    const Param& p = params_[k];
+    ICHECK(k == 0 || params_[k - 1].first_op <= p.first_op)
+        << "The streamed params should be sorted by their first op";
+    ICHECK(p.first_op <= p.last_op && p.last_op < num_ops);
+    size_t size = RegionBytes(p.host);
+    total += size;
+    largest = std::max(largest, size);
+    for (size_t op = p.first_op; op <= p.last_op; ++op) live[op] += size;
+  }
+  if (window_bytes == 0) {
+    // twice the params read by an op leaves room to upload the next ones during the op, the
+    // window grows until the ring of the regions fits, at worst holding all the params
+    size_t peak = live.empty() ? 0 : *std::max_element(live.begin(), live.end());
+    window_bytes = std::min(2 * peak, total);
+    while (!Plan(&params_, window_bytes)) {
+      window_bytes = std::min(window_bytes + window_bytes / 2 + kRegionAlignment, total);
+    }
+  } else if (!Plan(&params_, window_bytes)) {
+    LOG(FATAL) << "The window of " << window_bytes << " bytes is too small for the streamed "
+               << "params read by the ops, the largest is of " << largest << " bytes";
+  }
+  window_bytes_ = window_bytes;
+  window_ = NDArray::Empty({static_cast<int64_t>(std::max<size_t>(window_bytes_, 1))},
+                           DLDataType{kDLUInt, 8, 1}, dev_);
+  copy_stream_ = api_->CreateStream(dev_);
+  uploads_.resize(params_.size());
+  frees_region_.assign(num_ops, false);
+  op_done_.assign(num_ops, nullptr);
+  first_param_of_op_.assign(num_ops, -1);
+  for (size_t k = 0; k < params_.size(); ++k) {
+    const Param& p = params_[k];
+    first_param_of_op_[p.first_op] = k;
+    if (p.wait_op >= 0 && !frees_region_[p.wait_op]) {
+      frees_region_[p.wait_op] = true;
+      op_done_[p.wait_op] = api_->CreateEvent(dev_);
+    }
+  }
+  run_done_ = api_->CreateEvent(dev_);
+}
+
+WeightStreamer::~WeightStreamer() {
+  api_->StreamSync(dev_, copy_stream_);
+  uploads_.clear();
+  for (TVMEventHandle event : op_done_) {
+    if (event != nullptr) api_->FreeEvent(dev_, event);
+  }
+  if (run_done_ != nullptr) api_->FreeEvent(dev_, run_done_);
+  if (copy_stream_ != nullptr) api_->FreeStream(dev_, copy_stream_);
+}
+
+void* WeightStreamer::Address(size_t i) const {
+  ICHECK_LT(i, params_.size());
+  return static_cast<char*>(window_->data) + params_[i].offset;
+}
+
+void WeightStreamer::SetParam(size_t i, const DLTensor* data) {
+  ICHECK_LT(i, params_.size());
+  // the host array may be shared or mapped from a file, a copy replaces it once it is uploaded
+  api_->StreamSync(dev_, copy_stream_);
+  const NDArray& host = params_[i].host;
+  NDArray copy = NDArray::Empty(host.Shape(), host.DataType(), host->device);
+  copy.CopyFrom(data);
+  params_[i].host = std::move(copy);
+}
+
+void WeightStreamer::Issue(size_t i) {
+  const Param& p = params_[i];
+  if (p.wait_op >= 0) api_->StreamWaitEvent(dev_, copy_stream_, op_done_[p.wait_op]);
+  DLTensor target = *window_.operator->();
+  target.ndim = p.host->ndim;
+  target.shape = p.host->shape;
+  target.dtype = p.host->dtype;
+  target.strides = nullptr;
+  target.byte_offset = p.offset;
+  uploads_[i] = NDArray::CopyFromToAsync(p.host.operator->(), &target, copy_stream_);
+}
+
+void WeightStreamer::BeginRun() {
+  compute_stream_ = api_->GetCurrentStream(dev_);
+  // the regions free at the start are still read by the ops of the previous run
+  if (ran_) api_->StreamWaitEvent(dev_, copy_stream_, run_done_);
+  ran_ = true;
+  for (next_ = 0; next_ < params_.size() && params_[next_].issue_after < 0; ++next_) {
+    Issue(next_);
+  }
+}
+
+void WeightStreamer::BeforeOp(size_t op) {
+  // the uploads are in order on the copy stream, the last one of the op covers the others
+  int64_t k = first_param_of_op_[op];
+  if (k >= 0) uploads_[k].StreamWait(compute_stream_);
+}
+
+void WeightStreamer::AfterOp(size_t op) {
+  if (frees_region_[op]) api_->RecordEvent(dev_, op_done_[op], compute_stream_);
+  for (; next_ < params_.size() && params_[next_].issue_after <= static_cast<int64_t>(op);
+       ++next_) {
+    Issue(next_);
+  }
+}
+
+void WeightStreamer::EndRun() { api_->RecordEvent(dev_, run_done_, compute_stream_); }
+
+}  // namespace runtime
+}  // namespace tvm
@@ -0,0 +1,136 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file src/runtime/graph_executor/weight_streamer.h
+ * \brief The streaming of the params of a graph from the host memory through a window of device
+ *  memory, for the models whose params do not fit on the device.
+ */
+#ifndef TVM_RUNTIME_GRAPH_EXECUTOR_WEIGHT_STREAMER_H_
+#define TVM_RUNTIME_GRAPH_EXECUTOR_WEIGHT_STREAMER_H_
+
+#include <tvm/runtime/c_runtime_api.h>
+#include <tvm/runtime/device_api.h>
+#include <tvm/runtime/ndarray.h>
+
+#include <cstdint>
+#include <vector>
+
+namespace tvm {
+namespace runtime {
+
+/*!
+ * \brief Uploads the streamed params of a graph into a window of device memory during its runs.
+ *
+ * Each param is uploaded once per run, before the first op reading it, into a region of the
+ * window that the params read by earlier ops free once their last op is done. The regions are
+ * allocated as a ring in the order of the first uses when the streamer is created, so that the
+ * address of a param is fixed and the op arguments are patched once. The uploads are queued on a
+ * copy stream: an upload waits for the last op reading the previous occupants of its region, and
+ * an op waits for the uploads of its params, with device events, so the uploads of the next ops
+ * overlap the computation of the current ones without blocking the host.
+ */
+class WeightStreamer {
+ public:
+  /*! \brief A param streamed from the host. */
+  struct Param {
+    /*! \brief The array in the host memory, pinned or not. */
+    NDArray host;
+    /*! \brief The first op reading the param. */
+    size_t first_op;
+    /*! \brief The last op reading the param. */
+    size_t last_op;
+    /*! \brief The offset of its region in the window, set by the plan. */
+    size_t offset{0};
+    /*! \brief The op whose completion frees its region, -1 if it is free at the start. */
+    int64_t wait_op{-1};
+    /*! \brief The op after which its upload is queued, -1 at the start of the run. */
+    int64_t issue_after{-1};
+  };
+
+  /*!
+   * \brief Plan the window and allocate it.
+   * \param dev The device of the window.
+   * \param params The streamed params, sorted by their first op.
+   * \param num_ops The number of ops of the graph.
+   * \param window_bytes The size of the window, 0 to size it from the params read by the ops.
+   */
+  WeightStreamer(Device dev, std::vector<Param> params, size_t num_ops, size_t window_bytes);
+  ~WeightStreamer();
+
+  /*! \return The address of the i-th param in the window. */
+  void* Address(size_t i) const;
+  /*! \return The size of the window. */
+  size_t window_bytes() const { return window_bytes_; }
+  /*! \return The number of streamed params. */
+  size_t num_params() const { return params_.size(); }
+  /*! \return The host array of the i-th param. */
+  const NDArray& host(size_t i) const { return params_[i].host; }
+  /*!
+   * \brief Copy data into the host array of the i-th param, once its uploads are done.
+   * \param i The index of the param.
+   * \param data The new value of the param.
+   */
+  void SetParam(size_t i, const DLTensor* data);
+
+  /*! \brief Queue the uploads of the start of a run, after the ops of the previous run. */
+  void BeginRun();
+  /*! \brief Make the op wait for the uploads of the params it reads first. */
+  void BeforeOp(size_t op);
+  /*! \brief Queue the uploads into the regions the op frees, and the next ones in order. */
+  void AfterOp(size_t op);
+  /*! \brief Mark the end of the ops of the run. */
+  void EndRun();
+
+ private:
+  /*!
+   * \brief Allocate the regions of the params in a window as a ring.
+   * \return false if the window is too small for the params live at an op.
+   */
+  static bool Plan(std::vector<Param>* params, size_t window_bytes);
+  /*! \brief Queue the upload of the i-th param on the copy stream. */
+  void Issue(size_t i);
+
+  Device dev_;
+  DeviceAPI* api_;
+  std::vector<Param> params_;
+  size_t window_bytes_;
+  NDArray window_;
+  TVMStreamHandle copy_stream_{nullptr};
+  /*! \brief The stream of the ops of the current run. */
+  TVMStreamHandle compute_stream_{nullptr};
+  /*! \brief The uploads of the params in the current run. */
+  std::vector<CopyEvent> uploads_;
+  /*! \brief Whether each op frees a region, the last reading one of its params. */
+  std::vector<bool> frees_region_;
+  /*! \brief The completion of the ops freeing a region. */
+  std::vector<TVMEventHandle> op_done_;
+  /*! \brief The last param first read by each op, -1 if none. */
+  std::vector<int64_t> first_param_of_op_;
+  /*! \brief The end of the ops of the last run. */
+  TVMEventHandle run_done_{nullptr};
+  bool ran_{false};
+  /*! \brief The next param to upload in the current run. */
+  size_t next_{0};
+};
+
+}  // namespace runtime
+}  // namespace tvm
+
+#endif  // TVM_RUNTIME_GRAPH_EXECUTOR_WEIGHT_STREAMER_H_
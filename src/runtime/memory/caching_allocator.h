@@ -0,0 +1,352 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file src/runtime/memory/caching_allocator.h
+ * \brief The allocator caching the device memory in size classes, in the manner of the caching
+ * allocator of PyTorch
+ *
+ * The requests are rounded up to the size classes, the powers of two and the 1.25x, 1.5x and 1.75x
+ * steps between them (512 B at least). The memory is reserved in segments (2 MB for the requests of
+ * at most 1 MB, 20 MB up to 10 MB, the request rounded to 2 MB above) which are split into the
+ * blocks handed out at multiples of 512 B (the alignment of the blocks, the size classes below 1 KB
+ * only step by 128 B), the freed blocks are coalesced with their free neighbours and the segments
+ * entirely free are only returned to the device on an out of memory error. The free blocks are
+ * kept per stream (the current stream of the device at the allocation), a block is only reused on
+ * the stream it was allocated on. The blocks up to 1 MB freed by a thread are first kept in a small
+ * cache of the thread per size class, which serves its next allocations of the class without a
+ * lock.
+ */
+#ifndef TVM_RUNTIME_MEMORY_CACHING_ALLOCATOR_H_
+#define TVM_RUNTIME_MEMORY_CACHING_ALLOCATOR_H_
+
+#include <tvm/runtime/device_api.h>
+#include <tvm/runtime/memory/memory_manager.h>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+
+namespace tvm {
+namespace runtime {
+namespace memory {
+
+class CachingAllocator final : public Allocator {
+ public:
+  static constexpr size_t kMinBlockSize = 512;
+  static constexpr size_t kSmallSize = 1 << 20;
+  static constexpr size_t kSmallSegment = 2 << 20;
+  static constexpr size_t kLargeSegment = 20 << 20;
+  static constexpr size_t kMinLargeAlloc = 10 << 20;
+  static constexpr size_t kRoundLarge = 2 << 20;
+  // the size classes up to kSmallSize, 4 per power of two from kMinBlockSize
+  static constexpr int kNumCachedClasses = 45;
+  // the blocks of each class in the cache of a thread
+  static constexpr int kCacheDepth = 4;
+
+  explicit CachingAllocator(Device dev)
+      : Allocator(kCaching),
+        used_memory_(0),
+        device_(dev),
+        splittable_(dev.device_type == kDLCPU || dev.device_type == kDLCUDA ||
+                    dev.device_type == kDLCUDAHost || dev.device_type == kDLCUDAManaged ||
+                    dev.device_type == kDLROCM || dev.device_type == kDLROCMHost) {
+    static std::atomic<uint64_t> next_id{0};
+    id_ = next_id.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(RegistryMutex());
+    Registry()[id_] = this;
+  }
+
+  ~CachingAllocator() {
+    {
+      std::lock_guard<std::mutex> lock(RegistryMutex());
+      Registry().erase(id_);
+    }
+    std::lock_guard<std::mutex> lock(mu_);
+    ReleaseCached();
+  }
+
+  /*! \brief Round nbytes up to its size class. */
+  static size_t RoundSize(size_t nbytes) {
+    if (nbytes <= kMinBlockSize) return kMinBlockSize;
+    size_t octave = kMinBlockSize;
+    while (octave <= nbytes / 2) octave *= 2;
+    size_t step = octave / 4;
+    return (nbytes + step - 1) / step * step;
+  }
+
+  Buffer Alloc(size_t nbytes, size_t alignment, DLDataType type_hint) override {
+    Buffer buf;
+    buf.device = device_;
+    buf.size = RoundSize(nbytes);
+    buf.alloc_type = kCaching;
+    buf.stream = DeviceAPI::Get(device_)->GetCurrentStream(device_);
+    if (buf.size <= kSmallSize) {
+      buf.data = GetThreadCache()->Pop(ClassIndex(buf.size), buf.stream);
+      if (buf.data != nullptr) return buf;
+    }
+    std::lock_guard<std::mutex> lock(mu_);
+    buf.data = AllocBlock(buf.size, buf.stream, alignment, type_hint);
+    return buf;
+  }
+
+  Buffer Alloc(ShapeTuple shape, DLDataType type_hint, const std::string& mem_scope) override {
+    if (mem_scope.empty() || mem_scope == "global") {
+      return Allocator::Alloc(device_, shape, type_hint, mem_scope);
+    }
+    LOG(FATAL) << "This alloc should be implemented";
+    return {};
+  }
+
+  void Free(const Buffer& buffer) override {
+    if (buffer.size <= kSmallSize &&
+        GetThreadCache()->Push(ClassIndex(buffer.size), buffer.data, buffer.stream)) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mu_);
+    FreeBlock(buffer.data);
+  }
+
+  size_t UsedMemory() const override { return used_memory_.load(std::memory_order_relaxed); }
+
+ private:
+  /*! \brief A block of a segment, its neighbours in the segment are linked. */
+  struct Block {
+    void* ptr;
+    size_t size;
+    TVMStreamHandle stream;
+    bool small;
+    bool allocated{false};
+    Block* prev{nullptr};
+    Block* next{nullptr};
+  };
+
+  struct BlockLess {
+    bool operator()(const Block* a, const Block* b) const {
+      if (a->stream != b->stream) return std::less<TVMStreamHandle>()(a->stream, b->stream);
+      if (a->size != b->size) return a->size < b->size;
+      return std::less<void*>()(a->ptr, b->ptr);
+    }
+  };
+
+  /*! \brief The freed blocks of a thread for one allocator, up to kCacheDepth per class. */
+  struct ThreadCache {
+    struct Entry {
+      void* data;
+      TVMStreamHandle stream;
+    };
+    Entry entries[kNumCachedClasses][kCacheDepth];
+    int count[kNumCachedClasses] = {0};
+
+    void* Pop(int cls, TVMStreamHandle stream) {
+      for (int i = count[cls] - 1; i >= 0; --i) {
+        if (entries[cls][i].stream == stream) {
+          void* data = entries[cls][i].data;
+          entries[cls][i] = entries[cls][--count[cls]];
+          return data;
+        }
+      }
+      return nullptr;
+    }
+
+    bool Push(int cls, void* data, TVMStreamHandle stream) {
+      if (count[cls] == kCacheDepth) return false;
+      entries[cls][count[cls]++] = {data, stream};
+      return true;
+    }
+
+    // return the blocks to the pool of the allocator, mu_ of the allocator held
+    void Flush(CachingAllocator* alloc) {
+      for (int cls = 0; cls < kNumCachedClasses; ++cls) {
+        for (int i = 0; i < count[cls]; ++i) alloc->FreeBlock(entries[cls][i].data);
+        count[cls] = 0;
+      }
+    }
+  };
+
+  /*!
+   * \brief The caches of a thread by the allocator id. The caches of the allocators still alive
+   * are flushed when the thread exits, the ones of the destroyed allocators are dropped.
+   */
+  struct ThreadCaches {
+    std::unordered_map<uint64_t, std::unique_ptr<ThreadCache>> caches;
+    uint64_t last_id{~uint64_t(0)};
+    ThreadCache* last{nullptr};
+
+    ~ThreadCaches() {
+      std::lock_guard<std::mutex> registry_lock(RegistryMutex());
+      for (auto& kv : caches) {
+        auto it = Registry().find(kv.first);
+        if (it == Registry().end()) continue;
+        std::lock_guard<std::mutex> lock(it->second->mu_);
+        kv.second->Flush(it->second);
+      }
+    }
+  };
+
+  static std::mutex& RegistryMutex() {
+    static auto* mu = new std::mutex();
+    return *mu;
+  }
+
+  static std::unordered_map<uint64_t, CachingAllocator*>& Registry() {
+    static auto* registry = new std::unordered_map<uint64_t, CachingAllocator*>();
+    return *registry;
+  }
+
+  /*! \brief The index of a size class of at most kSmallSize. */
+  static int ClassIndex(size_t size) {
+    int octave = 0;
+    while ((kMinBlockSize << (octave + 1)) <= size) ++octave;
+    size_t step = (kMinBlockSize << octave) / 4;
+    return octave * 4 + static_cast<int>(size / step) - 4;
+  }
+
+  ThreadCache* GetThreadCache() {
+    thread_local ThreadCaches tls;
+    if (tls.last_id != id_) {
+      auto& cache = tls.caches[id_];
+      if (cache == nullptr) cache.reset(new ThreadCache());
+      tls.last_id = id_;
+      tls.last = cache.get();
+    }
+    return tls.last;
+  }
+
+  std::set<Block*, BlockLess>& Pool(bool small) { return small ? small_blocks_ : large_blocks_; }
+
+  void* AllocBlock(size_t size, TVMStreamHandle stream, size_t alignment, DLDataType type_hint) {
+    // the blocks split from the segments keep their alignment of kMinBlockSize
+    if (splittable_) size = (size + kMinBlockSize - 1) / kMinBlockSize * kMinBlockSize;
+    bool small = size <= kSmallSize;
+    auto& pool = Pool(small);
+    Block key{nullptr, size, stream, small};
+    auto it = pool.lower_bound(&key);
+    Block* block;
+    if (it != pool.end() && (*it)->stream == stream && (splittable_ || (*it)->size == size)) {
+      block = *it;
+      pool.erase(it);
+    } else {
+      size_t segment_size = size;
+      if (splittable_) {
+        ICHECK_LE(alignment, kMinBlockSize)
+            << "CachingAllocator can not align the blocks to " << alignment << " B";
+        alignment = kMinBlockSize;
+        size_t rounded_large = (size + kRoundLarge - 1) / kRoundLarge * kRoundLarge;
+        segment_size = small                    ? kSmallSegment
+                       : size < kMinLargeAlloc ? kLargeSegment
+                                               : rounded_large;
+      }
+      block = new Block{AllocSegment(segment_size, alignment, type_hint), segment_size, stream,
+                        small};
+    }
+    size_t remaining = block->size - size;
+    if (splittable_ && (small ? remaining >= kMinBlockSize : remaining > kSmallSize)) {
+      Block* rest = new Block{static_cast<char*>(block->ptr) + size, remaining, stream, small};
+      rest->prev = block;
+      rest->next = block->next;
+      if (block->next != nullptr) block->next->prev = rest;
+      block->next = rest;
+      block->size = size;
+      pool.insert(rest);
+    }
+    block->allocated = true;
+    allocated_[block->ptr] = block;
+    return block->ptr;
+  }
+
+  void* AllocSegment(size_t size, size_t alignment, DLDataType type_hint) {
+    void* ptr;
+    try {
+      ptr = DeviceAPI::Get(device_)->AllocDataSpace(device_, size, alignment, type_hint);
+    } catch (InternalError& err) {
+      LOG(WARNING) << "CachingAllocator got InternalError during allocation: " << err.message();
+      LOG(WARNING) << "Trying to release all unused memory and reallocate...";
+      GetThreadCache()->Flush(this);
+      ReleaseCached();
+      ptr = DeviceAPI::Get(device_)->AllocDataSpace(device_, size, alignment, type_hint);
+    }
+    used_memory_.fetch_add(size, std::memory_order_relaxed);
+    VLOG(1) << "allocate segment " << size << " B, used memory " << used_memory_ << " B";
+    return ptr;
+  }
+
+  void FreeBlock(void* ptr) {
+    auto it = allocated_.find(ptr);
+    ICHECK(it != allocated_.end()) << "CachingAllocator does not own the pointer " << ptr;
+    Block* block = it->second;
+    allocated_.erase(it);
+    block->allocated = false;
+    auto& pool = Pool(block->small);
+    if (Block* prev = block->prev; prev != nullptr && !prev->allocated) {
+      pool.erase(prev);
+      block->ptr = prev->ptr;
+      block->size += prev->size;
+      block->prev = prev->prev;
+      if (block->prev != nullptr) block->prev->next = block;
+      delete prev;
+    }
+    if (Block* next = block->next; next != nullptr && !next->allocated) {
+      pool.erase(next);
+      block->size += next->size;
+      block->next = next->next;
+      if (block->next != nullptr) block->next->prev = block;
+      delete next;
+    }
+    pool.insert(block);
+  }
+
+  // return the entirely free segments to the device, mu_ held
+  void ReleaseCached() {
+    for (bool small : {true, false}) {
+      auto& pool = Pool(small);
+      for (auto it = pool.begin(); it != pool.end();) {
+        Block* block = *it;
+        if (block->prev != nullptr || block->next != nullptr) {
+          ++it;
+          continue;
+        }
+        DeviceAPI::Get(device_)->FreeDataSpace(device_, block->ptr);
+        used_memory_.fetch_sub(block->size, std::memory_order_relaxed);
+        it = pool.erase(it);
+        delete block;
+      }
+    }
+    VLOG(1) << "release the free segments, used memory " << used_memory_ << " B";
+  }
+
+  std::atomic<size_t> used_memory_;
+  std::set<Block*, BlockLess> small_blocks_;
+  std::set<Block*, BlockLess> large_blocks_;
+  std::unordered_map<void*, Block*> allocated_;
+  std::mutex mu_;
+  Device device_;
+  bool splittable_;
+  uint64_t id_;
+};
+
+}  // namespace memory
+}  // namespace runtime
+}  // namespace tvm
+
+#endif  // TVM_RUNTIME_MEMORY_CACHING_ALLOCATOR_H_
@@ -26,8 +26,10 @@
 #include <memory>
 #include <utility>
 
+#include "caching_allocator.h"
 #include "naive_allocator.h"
 #include "pooled_allocator.h"
+#include "stream_ordered_allocator.h"
 
 namespace tvm {
 namespace runtime {
@@ -137,6 +139,16 @@ Allocator* MemoryManager::GetOrCreateAllocator(Device dev, AllocatorType type) {
         alloc.reset(new PooledAllocator(dev));
         break;
       }
+      case kCaching: {
+        VLOG(1) << "New caching allocator for " << dev;
+        alloc.reset(new CachingAllocator(dev));
+        break;
+      }
+      case kStreamOrdered: {
+        VLOG(1) << "New stream ordered allocator for " << dev;
+        alloc.reset(new StreamOrderedAllocator(dev));
+        break;
+      }
       default:
         LOG(FATAL) << "Unknown allocator type: " << type;
     }
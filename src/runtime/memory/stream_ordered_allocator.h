@@ -0,0 +1,84 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file src/runtime/memory/stream_ordered_allocator.h
+ * \brief The allocator ordering the allocations and the frees on the current stream of the device
+ *
+ * On CUDA this is cudaMallocAsync and cudaFreeAsync on the default memory pool of the device, which
+ * neither synchronize the device nor the other streams and reuse the freed memory across the
+ * streams in the order of their dependencies. The other devices allocate and free synchronously.
+ */
+#ifndef TVM_RUNTIME_MEMORY_STREAM_ORDERED_ALLOCATOR_H_
+#define TVM_RUNTIME_MEMORY_STREAM_ORDERED_ALLOCATOR_H_
+
+#include <tvm/runtime/device_api.h>
+#include <tvm/runtime/memory/memory_manager.h>
+
+#include <atomic>
+#include <string>
+
+namespace tvm {
+namespace runtime {
+namespace memory {
+
+class StreamOrderedAllocator final : public Allocator {
+ public:
+  explicit StreamOrderedAllocator(Device dev)
+      : Allocator(kStreamOrdered), used_memory_(0), device_(dev) {}
+
+  Buffer Alloc(size_t nbytes, size_t alignment, DLDataType type_hint) override {
+    DeviceAPI* api = DeviceAPI::Get(device_);
+    Buffer buf;
+    buf.device = device_;
+    buf.size = nbytes;
+    buf.alloc_type = kStreamOrdered;
+    buf.stream = api->GetCurrentStream(device_);
+    buf.data = api->AllocDataSpaceAsync(device_, nbytes, alignment, type_hint, buf.stream);
+    used_memory_.fetch_add(nbytes, std::memory_order_relaxed);
+    VLOG(1) << "allocate " << nbytes << " B, used memory " << used_memory_ << " B";
+    return buf;
+  }
+
+  Buffer Alloc(ShapeTuple shape, DLDataType type_hint, const std::string& mem_scope) override {
+    if (mem_scope.empty() || mem_scope == "global") {
+      return Allocator::Alloc(device_, shape, type_hint, mem_scope);
+    }
+    LOG(FATAL) << "This alloc should be implemented";
+    return {};
+  }
+
+  void Free(const Buffer& buffer) override {
+    DeviceAPI::Get(device_)->FreeDataSpaceAsync(buffer.device, buffer.data, buffer.stream);
+    used_memory_.fetch_sub(buffer.size, std::memory_order_relaxed);
+    VLOG(1) << "free " << buffer.size << " B, used memory " << used_memory_ << " B";
+  }
+
+  size_t UsedMemory() const override { return used_memory_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<size_t> used_memory_;
+  Device device_;
+};
+
+}  // namespace memory
+}  // namespace runtime
+}  // namespace tvm
+
+#endif  // TVM_RUNTIME_MEMORY_STREAM_ORDERED_ALLOCATOR_H_
@@ -64,6 +64,19 @@ namespace launch_param {
 /*! \brief A tag to specify whether or not dynamic shared memory is used */
 constexpr const char* kUseDynamicSharedMemoryTag = "tir.use_dyn_shared_memory";
 
+/*!
+ * \brief A tag to specify that the kernel is launched with the programmatic dependent launch: it
+ *  may start before the previous kernel of the stream completes, and waits for it on the device
+ *  (griddepcontrol.wait) before reading its results. It does not take a launch argument.
+ */
+constexpr const char* kUseProgrammaticDependentLaunchTag = "tir.use_programmatic_dependent_launch";
+
+/*!
+ * \brief A tag to specify that the kernel is launched as a cooperative kernel, its blocks being
+ *  all resident at once and synchronizing with each other. It does not take a launch argument.
+ */
+constexpr const char* kUseCooperativeLaunchTag = "tir.use_cooperative_launch";
+
 }  // namespace launch_param
 
 /*! \brief function information needed by device */
@@ -72,6 +85,20 @@ struct FunctionInfo {
   std::vector<DLDataType> arg_types;
   std::vector<std::string> launch_param_tags;
 
+  /*! \brief Extra information on how a handle argument is passed to the device function */
+  enum class ArgExtraTags : int {
+    kNone = 0,
+    /*! \brief The handle points to a 128-byte CUtensorMap, which is passed by value */
+    kTensorMap = 1,
+  };
+  /*! \brief Per-argument extra tags, can be empty when all the tags are kNone */
+  std::vector<ArgExtraTags> arg_extra_tags;
+  /*!
+   * \brief The last launch param tag of the binary format when arg_extra_tags follow them, the
+   *  functions without extra tags keep the format of the runtimes without them.
+   */
+  static constexpr const char* kArgExtraTagsMarker = "tir.arg_extra_tags";
+
   void Save(dmlc::JSONWriter* writer) const;
   void Load(dmlc::JSONReader* reader);
   void Save(dmlc::Stream* writer) const;
@@ -27,6 +27,12 @@
 #include <tvm/runtime/ndarray.h>
 #include <tvm/runtime/registry.h>
 
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
 #include "runtime_base.h"
 
 extern "C" {
@@ -305,6 +311,139 @@ void NDArray::CopyFromTo(const DLTensor* from, DLTensor* to, TVMStreamHandle str
   DeviceAPI::Get(dev)->CopyDataFromTo(const_cast<DLTensor*>(from), to, stream);
 }
 
+namespace {
+
+/*! \brief Record the work queued on the stream so far in a new event. */
+CopyEvent RecordCopyEvent(Device dev, TVMStreamHandle stream) {
+  DeviceAPI* api = DeviceAPI::Get(dev);
+  auto n = make_object<CopyEventObj>();
+  n->device = dev;
+  n->event = api->CreateEvent(dev);
+  api->RecordEvent(dev, n->event, stream);
+  return CopyEvent(n);
+}
+
+/*!
+ * \brief The pinned staging buffers of the uploads from pageable host memory to a device, filled
+ *  in turns. A buffer is refilled once the event recorded after its transfer is done, so that the
+ *  host fills the next buffers while the previous ones are transferred.
+ */
+class StagingPool {
+ public:
+  static constexpr size_t kChunkBytes = 4 << 20;
+  static constexpr int kNumBuffers = 4;
+
+  /*! \return The pool of the device, nullptr if the device has no pinned host memory. */
+  static StagingPool* Get(Device dev) {
+    if (dev.device_type != kDLCUDA) return nullptr;
+    static std::mutex mutex;
+    // NOTE: explicitly leaked to avoid exit-time destruction after the device api
+    static auto* pools = new std::unordered_map<int, std::unique_ptr<StagingPool>>();
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<StagingPool>& pool = (*pools)[dev.device_id];
+    if (pool == nullptr) {
+      pool.reset(new StagingPool(dev, Device{kDLCUDAHost, 0}));
+    }
+    return pool.get();
+  }
+
+  CopyEvent Upload(const DLTensor* from, DLTensor* to, TVMStreamHandle stream) {
+    ICHECK(IsContiguous(*from) && IsContiguous(*to))
+        << "CopyFromToAsync only support contiguous array for now";
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stream == nullptr) {
+      if (copy_stream_ == nullptr) {
+        copy_stream_ = api_->CreateStream(dev_);
+      }
+      stream = copy_stream_;
+      // the target may still be read by the work queued before
+      api_->SyncStreamFromTo(dev_, api_->GetCurrentStream(dev_), stream);
+    }
+    const char* src = static_cast<const char*>(from->data) + from->byte_offset;
+    size_t nbytes = GetDataSize(*from);
+    for (size_t begin = 0; begin < nbytes; begin += kChunkBytes) {
+      int64_t size = static_cast<int64_t>(std::min(kChunkBytes, nbytes - begin));
+      Buffer& buf = buffers_[next_];
+      next_ = (next_ + 1) % kNumBuffers;
+      if (buf.data == nullptr) {
+        buf.data =
+            api_->AllocDataSpace(host_, kChunkBytes, kAllocAlignment, DLDataType{kDLUInt, 8, 1});
+        buf.event = api_->CreateEvent(dev_);
+      } else {
+        api_->EventSync(dev_, buf.event);
+      }
+      std::memcpy(buf.data, src + begin, size);
+      DLTensor staged{buf.data, host_, 1, DLDataType{kDLUInt, 8, 1}, &size, nullptr, 0};
+      DLTensor target = *to;
+      target.ndim = 1;
+      target.dtype = DLDataType{kDLUInt, 8, 1};
+      target.shape = &size;
+      target.strides = nullptr;
+      target.byte_offset += begin;
+      api_->CopyDataFromTo(&staged, &target, stream);
+      api_->RecordEvent(dev_, buf.event, stream);
+    }
+    return RecordCopyEvent(dev_, stream);
+  }
+
+ private:
+  struct Buffer {
+    void* data{nullptr};
+    TVMEventHandle event{nullptr};
+  };
+
+  StagingPool(Device dev, Device host) : dev_(dev), host_(host), api_(DeviceAPI::Get(dev)) {}
+
+  std::mutex mutex_;
+  Device dev_;
+  Device host_;
+  DeviceAPI* api_;
+  TVMStreamHandle copy_stream_{nullptr};
+  Buffer buffers_[kNumBuffers];
+  int next_{0};
+};
+
+}  // namespace
+
+CopyEventObj::~CopyEventObj() {
+  if (event != nullptr) {
+    DeviceAPI::Get(device)->FreeEvent(device, event);
+  }
+}
+
+void CopyEvent::Wait() const {
+  const CopyEventObj* n = get();
+  if (n->event != nullptr) {
+    DeviceAPI::Get(n->device)->EventSync(n->device, n->event);
+  }
+}
+
+void CopyEvent::StreamWait(TVMStreamHandle stream) const {
+  const CopyEventObj* n = get();
+  if (n->event != nullptr) {
+    DeviceAPI::Get(n->device)->StreamWaitEvent(n->device, stream, n->event);
+  }
+}
+
+CopyEvent NDArray::CopyFromToAsync(const DLTensor* from, DLTensor* to, TVMStreamHandle stream) {
+  ICHECK_EQ(GetDataSize(*from), GetDataSize(*to))
+      << "TVMArrayCopyFromTo: The size must exactly match";
+  if (from->device.device_type == kDLCPU) {
+    if (StagingPool* pool = StagingPool::Get(to->device)) {
+      return pool->Upload(from, to, stream);
+    }
+  }
+  CopyFromTo(from, to, stream);
+  Device dev = from->device.device_type != kDLCPU ? from->device : to->device;
+  if (stream == nullptr) {
+    // ordered as CopyFromTo, as the copies without an event
+    auto n = make_object<CopyEventObj>();
+    n->device = dev;
+    return CopyEvent(n);
+  }
+  return RecordCopyEvent(dev, stream);
+}
+
 ShapeTuple NDArray::Shape() const { return get_mutable()->shape_; }
 
 runtime::DataType NDArray::DataType() const {
@@ -325,6 +464,7 @@ bool NDArray::IsAligned(const DLTensor& tensor) {
 }
 
 TVM_REGISTER_OBJECT_TYPE(NDArray::Container);
+TVM_REGISTER_OBJECT_TYPE(CopyEventObj);
 
 }  // namespace runtime
 }  // namespace tvm
@@ -359,6 +499,17 @@ int TVMArrayAlloc(const tvm_index_t* shape, int ndim, int dtype_code, int dtype_
 
 TVM_REGISTER_GLOBAL("runtime.TVMArrayAllocWithScope").set_body_typed(NDArray::Empty);
 
+// the copy of NDArray::CopyFromToAsync, the stream may be None
+TVM_REGISTER_GLOBAL("runtime.TVMArrayCopyFromToAsync")
+    .set_body_typed([](NDArray from, NDArray to, void* stream) {
+      return NDArray::CopyFromToAsync(from.operator->(), const_cast<DLTensor*>(to.operator->()),
+                                      stream);
+    });
+
+TVM_REGISTER_GLOBAL("runtime.CopyEventWait").set_body_typed([](CopyEvent event) {
+  event.Wait();
+});
+
 TVM_REGISTER_GLOBAL("runtime.TVMArrayCreateView").set_body_typed([](NDArray arr, ShapeTuple shape) {
   NDArray view = arr.CreateView(shape, arr->dtype);
   return view;
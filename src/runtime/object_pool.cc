@@ -0,0 +1,255 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file src/runtime/object_pool.cc
+ * \brief The thread-local object pools of PoolObjAllocator.
+ */
+#include <tvm/runtime/container/map.h>
+#include <tvm/runtime/container/shape_tuple.h>
+#include <tvm/runtime/memory.h>
+#include <tvm/runtime/registry.h>
+
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <string>
+
+namespace tvm {
+namespace runtime {
+
+namespace {
+
+constexpr size_t kNumSizeClasses = PoolObjAllocator::kMaxSize / PoolObjAllocator::kGranularity;
+/*! \brief The number of allocations and frees of a thread between the flushes of its counts. */
+constexpr int64_t kStatsFlushInterval = 4096;
+/*!
+ * \brief The bytes of free slots of a size class a thread keeps, beyond which
+ *  they go to the depot, e.g. when the thread frees what another allocated.
+ */
+constexpr size_t kMaxThreadFreeBytes = 4 * PoolObjAllocator::kPageBytes;
+
+inline size_t SizeClass(size_t size) {
+  return (size + PoolObjAllocator::kGranularity - 1) / PoolObjAllocator::kGranularity - 1;
+}
+
+inline size_t SlotBytes(size_t size_class) {
+  return (size_class + 1) * PoolObjAllocator::kGranularity;
+}
+
+/*! \brief A free slot, linked in the free list of its size class. */
+struct FreeSlot {
+  FreeSlot* next;
+};
+
+/*! \brief A free list and its length. */
+struct FreeList {
+  FreeSlot* head{nullptr};
+  FreeSlot* tail{nullptr};
+  size_t size{0};
+
+  void Push(FreeSlot* slot) {
+    slot->next = head;
+    if (head == nullptr) tail = slot;
+    head = slot;
+    ++size;
+  }
+
+  FreeSlot* Pop() {
+    FreeSlot* slot = head;
+    head = slot->next;
+    if (head == nullptr) tail = nullptr;
+    --size;
+    return slot;
+  }
+
+  void Splice(FreeList* other) {
+    if (other->head == nullptr) return;
+    other->tail->next = head;
+    if (head == nullptr) tail = other->tail;
+    head = other->head;
+    size += other->size;
+    *other = FreeList();
+  }
+};
+
+/*!
+ * \brief The free lists given back by the exited threads, the pages of all
+ *  the pools and the flushed counts of the threads.
+ */
+class PoolDepot {
+ public:
+  static PoolDepot* Global() {
+    // Never destroyed, the pools of the threads exiting after the static
+    // destructors still give their slots back.
+    static PoolDepot* inst = new PoolDepot();
+    return inst;
+  }
+
+  /*! \brief Moves the free slots of a size class to \p out, or carves a new page. */
+  void Refill(size_t size_class, FreeList* out) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (free_[size_class].head != nullptr) {
+      out->Splice(&free_[size_class]);
+      return;
+    }
+    size_t slot_bytes = SlotBytes(size_class);
+    char* page = static_cast<char*>(::operator new(PoolObjAllocator::kPageBytes));
+    for (size_t offset = 0; offset + slot_bytes <= PoolObjAllocator::kPageBytes;
+         offset += slot_bytes) {
+      out->Push(reinterpret_cast<FreeSlot*>(page + offset));
+    }
+    reserved_bytes_ += PoolObjAllocator::kPageBytes;
+  }
+
+  /*! \brief Takes the free slots of a size class. */
+  void GiveBack(size_t size_class, FreeList* list) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_[size_class].Splice(list);
+  }
+
+  void Flush(size_t size_class, int64_t num_allocs, int64_t num_frees) {
+    num_allocs_[size_class].fetch_add(num_allocs, std::memory_order_relaxed);
+    num_frees_[size_class].fetch_add(num_frees, std::memory_order_relaxed);
+  }
+
+  PoolObjAllocatorStats Stats() {
+    PoolObjAllocatorStats stats;
+    for (size_t i = 0; i < kNumSizeClasses; ++i) {
+      stats.slot_bytes.push_back(static_cast<int64_t>(SlotBytes(i)));
+      stats.num_allocs.push_back(num_allocs_[i].load(std::memory_order_relaxed));
+      stats.num_frees.push_back(num_frees_[i].load(std::memory_order_relaxed));
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats.reserved_bytes = reserved_bytes_;
+    return stats;
+  }
+
+ private:
+  std::mutex mutex_;
+  FreeList free_[kNumSizeClasses];
+  int64_t reserved_bytes_{0};
+  std::atomic<int64_t> num_allocs_[kNumSizeClasses] = {};
+  std::atomic<int64_t> num_frees_[kNumSizeClasses] = {};
+};
+
+/*! \brief The pool of a thread. */
+class ThreadPoolCache {
+ public:
+  ~ThreadPoolCache() {
+    PoolDepot* depot = PoolDepot::Global();
+    for (size_t i = 0; i < kNumSizeClasses; ++i) {
+      FlushStats(i);
+      depot->GiveBack(i, &free_[i]);
+    }
+    destroyed_ = true;
+  }
+
+  void* Allocate(size_t size_class) {
+    FreeList& list = free_[size_class];
+    if (list.head == nullptr) PoolDepot::Global()->Refill(size_class, &list);
+    CountOp(size_class, &num_allocs_[size_class]);
+    return list.Pop();
+  }
+
+  void Free(void* ptr, size_t size_class) {
+    FreeList& list = free_[size_class];
+    list.Push(static_cast<FreeSlot*>(ptr));
+    if (list.size * SlotBytes(size_class) > kMaxThreadFreeBytes) {
+      PoolDepot::Global()->GiveBack(size_class, &list);
+    }
+    CountOp(size_class, &num_frees_[size_class]);
+  }
+
+  /*! \brief Whether the pool of the current thread is destroyed, the thread is exiting. */
+  static thread_local bool destroyed_;
+
+ private:
+  void CountOp(size_t size_class, int64_t* counter) {
+    ++*counter;
+    if (++num_ops_ >= kStatsFlushInterval) {
+      for (size_t i = 0; i < kNumSizeClasses; ++i) FlushStats(i);
+      num_ops_ = 0;
+    }
+  }
+
+  void FlushStats(size_t size_class) {
+    PoolDepot::Global()->Flush(size_class, num_allocs_[size_class], num_frees_[size_class]);
+    num_allocs_[size_class] = 0;
+    num_frees_[size_class] = 0;
+  }
+
+  FreeList free_[kNumSizeClasses];
+  int64_t num_allocs_[kNumSizeClasses] = {};
+  int64_t num_frees_[kNumSizeClasses] = {};
+  int64_t num_ops_{0};
+};
+
+thread_local bool ThreadPoolCache::destroyed_ = false;
+
+ThreadPoolCache* CurrentPool() {
+  if (ThreadPoolCache::destroyed_) return nullptr;
+  static thread_local ThreadPoolCache pool;
+  return &pool;
+}
+
+}  // namespace
+
+void* PoolObjAllocator::Allocate(size_t size) {
+  size_t size_class = SizeClass(size);
+  if (ThreadPoolCache* pool = CurrentPool()) {
+    return pool->Allocate(size_class);
+  }
+  // The thread is exiting, allocate through the depot.
+  FreeList list;
+  PoolDepot* depot = PoolDepot::Global();
+  depot->Refill(size_class, &list);
+  void* ptr = list.Pop();
+  depot->GiveBack(size_class, &list);
+  depot->Flush(size_class, 1, 0);
+  return ptr;
+}
+
+void PoolObjAllocator::Free(void* ptr, size_t size) {
+  size_t size_class = SizeClass(size);
+  if (ThreadPoolCache* pool = CurrentPool()) {
+    pool->Free(ptr, size_class);
+    return;
+  }
+  FreeList list;
+  list.Push(static_cast<FreeSlot*>(ptr));
+  PoolDepot* depot = PoolDepot::Global();
+  depot->GiveBack(size_class, &list);
+  depot->Flush(size_class, 0, 1);
+}
+
+PoolObjAllocatorStats PoolObjAllocator::Stats() { return PoolDepot::Global()->Stats(); }
+
+TVM_REGISTER_GLOBAL("runtime.ObjectPoolStats").set_body_typed([]() {
+  PoolObjAllocatorStats stats = PoolObjAllocator::Stats();
+  Map<String, ShapeTuple> result;
+  result.Set("slot_bytes", ShapeTuple(stats.slot_bytes));
+  result.Set("num_allocs", ShapeTuple(stats.num_allocs));
+  result.Set("num_frees", ShapeTuple(stats.num_frees));
+  result.Set("reserved_bytes", ShapeTuple({stats.reserved_bytes}));
+  return result;
+});
+
+}  // namespace runtime
+}  // namespace tvm
@@ -480,6 +480,15 @@ class OpenCLModuleNode : public OpenCLModuleNodeBase {
                           const std::string& func_name, const KTRefEntry& e) override;
 
  private:
+  // The key of the program of func_name on dev in the program cache.
+  std::string ProgramCacheKey(const std::string& func_name, cl_device_id dev);
+  // Create the program of func_name on the device from the program cache, return false when it is
+  // not cached or the driver rejects the cached binary.
+  bool LoadCachedProgram(cl::OpenCLWorkspace* w, const std::string& func_name, int device_id,
+                         const std::string& key);
+  // Save the binary of the program of func_name on the device into the program cache.
+  void SaveCachedProgram(const std::string& func_name, int device_id, const std::string& key);
+
   // the binary data
   std::string data_;
   // The format
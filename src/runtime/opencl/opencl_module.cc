@@ -23,8 +23,14 @@
 #include "opencl_module.h"
 
 #include <dmlc/memory_io.h>
+#include <dmlc/parameter.h>
 #include <tvm/runtime/registry.h>
 
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <sstream>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -35,6 +41,35 @@
 namespace tvm {
 namespace runtime {
 
+namespace cl {
+std::string GetDeviceInfo(cl_device_id pid, cl_device_info param_name);
+}  // namespace cl
+
+namespace {
+
+// The directory of the persistent cache of the program binaries, empty when it is disabled.
+std::string& ProgramCacheDir() {
+  static std::string dir = dmlc::GetEnv("TVM_OPENCL_PROGRAM_CACHE_DIR", std::string());
+  return dir;
+}
+
+// 64 bit FNV-1a, unlike std::hash it is the same in every run.
+uint64_t HashString(const std::string& str) {
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (unsigned char c : str) {
+    hash = (hash ^ c) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+std::string ProgramCachePath(const std::string& key) {
+  std::ostringstream os;
+  os << ProgramCacheDir() << "/" << std::hex << HashString(key) << ".clbin";
+  return os.str();
+}
+
+}  // namespace
+
 class OpenCLWrappedFunc {
  public:
   // initialize the OpenCL function.
@@ -220,13 +255,106 @@ bool OpenCLModuleNode::IsProgramCreated(const std::string& func_name, int device
   return false;
 }
 
+std::string OpenCLModuleNode::ProgramCacheKey(const std::string& func_name, cl_device_id dev) {
+  std::ostringstream os;
+  os << "tvm.opencl.program.v1\n"
+     << cl::GetDeviceInfo(dev, CL_DEVICE_NAME) << "\n"
+     << cl::GetDeviceInfo(dev, CL_DEVICE_VERSION) << "\n"
+     << cl::GetDeviceInfo(dev, CL_DRIVER_VERSION) << "\n"
+     << func_name << "\n"
+     << std::hex << HashString(parsed_kernels_[func_name]) << std::dec << "\n"
+     << parsed_kernels_[func_name].size();
+  return os.str();
+}
+
+bool OpenCLModuleNode::LoadCachedProgram(cl::OpenCLWorkspace* w, const std::string& func_name,
+                                         int device_id, const std::string& key) {
+  std::ifstream fs(ProgramCachePath(key), std::ios::in | std::ios::binary);
+  if (fs.fail()) return false;
+  // The cache file is the key, a null character and the program binary.
+  std::string data((std::istreambuf_iterator<char>(fs)), std::istreambuf_iterator<char>());
+  if (data.size() <= key.size() + 1 || data.compare(0, key.size(), key) != 0 ||
+      data[key.size()] != '\0') {
+    return false;
+  }
+  size_t offset = key.size() + 1;
+  const unsigned char* binary = reinterpret_cast<const unsigned char*>(data.data()) + offset;
+  size_t len = data.size() - offset;
+  cl_device_id dev = w->devices[device_id];
+  auto platform = w->device_to_platform[dev];
+  cl_int binary_status = CL_SUCCESS;
+  cl_int err;
+  cl_program program = clCreateProgramWithBinary(w->contexts[platform], 1, &dev, &len, &binary,
+                                                 &binary_status, &err);
+  if (err == CL_SUCCESS && binary_status == CL_SUCCESS) {
+    err = clBuildProgram(program, 1, &dev, nullptr, nullptr, nullptr);
+  } else if (err == CL_SUCCESS) {
+    err = binary_status;
+  }
+  if (err != CL_SUCCESS) {
+    if (program != nullptr) clReleaseProgram(program);
+    LOG(WARNING) << "The cached OpenCL binary of " << func_name << " was rejected by the driver ("
+                 << cl::CLGetErrorString(err) << "), building it from source";
+    return false;
+  }
+  programs_[func_name][device_id] = program;
+  return true;
+}
+
+void OpenCLModuleNode::SaveCachedProgram(const std::string& func_name, int device_id,
+                                         const std::string& key) {
+  cl_program program = programs_[func_name][device_id];
+  size_t size = 0;
+  if (clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t), &size, nullptr) !=
+          CL_SUCCESS ||
+      size == 0) {
+    return;
+  }
+  std::string data = key;
+  data.push_back('\0');
+  data.resize(key.size() + 1 + size);
+  unsigned char* binary = reinterpret_cast<unsigned char*>(&data[key.size() + 1]);
+  if (clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(unsigned char*), &binary, nullptr) !=
+      CL_SUCCESS) {
+    return;
+  }
+  // Written to a temporary file renamed into place, so that the processes sharing the cache never
+  // read a partially written binary.
+  std::string path = ProgramCachePath(key);
+  std::string tmp_path = path + "." + std::to_string(std::random_device()()) + ".tmp";
+  {
+    std::ofstream fs(tmp_path, std::ios::out | std::ios::binary);
+    if (fs.fail()) {
+      LOG(WARNING) << "Cannot write the OpenCL program cache file " << tmp_path;
+      return;
+    }
+    fs.write(data.data(), data.size());
+    if (fs.fail()) {
+      fs.close();
+      std::remove(tmp_path.c_str());
+      return;
+    }
+  }
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    std::remove(tmp_path.c_str());
+  }
+}
+
 cl_kernel OpenCLModuleNode::InstallKernel(cl::OpenCLWorkspace* w, cl::OpenCLThreadEntry* t,
                                           const std::string& func_name, const KTRefEntry& e) {
   std::lock_guard<std::mutex> lock(build_lock_);
   int device_id = t->device.device_id;
   auto did = w->GetCLDeviceID(device_id);
   auto platform = w->device_to_platform[did];
-  if (!IsProgramCreated(func_name, device_id)) {
+  // The programs compiled from source are kept in the program cache when it is enabled, keyed by
+  // their source, the device and the driver version.
+  std::string cache_key;
+  bool cached = false;
+  if (!IsProgramCreated(func_name, device_id) && fmt_ == "cl" && !ProgramCacheDir().empty()) {
+    cache_key = ProgramCacheKey(func_name, did);
+    cached = LoadCachedProgram(w, func_name, device_id, cache_key);
+  }
+  if (!cached && !IsProgramCreated(func_name, device_id)) {
     // create program
     if (fmt_ == "cl") {
       const char* s = parsed_kernels_[func_name].c_str();
@@ -262,6 +390,9 @@ cl_kernel OpenCLModuleNode::InstallKernel(cl::OpenCLWorkspace* w, cl::OpenCLThre
                  << "\nError: " << cl::CLGetErrorString(err) << "\n"
                  << log;
     }
+    if (!cache_key.empty()) {
+      SaveCachedProgram(func_name, device_id, cache_key);
+    }
   }
   // build kernel
   cl_int err;
@@ -389,6 +520,10 @@ Module OpenCLModuleLoadBinary(void* strm) {
   return OpenCLModuleCreate(data, fmt, fmap, std::string());
 }
 
+TVM_REGISTER_GLOBAL("runtime.opencl.SetProgramCacheDir").set_body_typed([](std::string dir) {
+  ProgramCacheDir() = dir;
+});
+
 TVM_REGISTER_GLOBAL("runtime.module.loadfile_cl").set_body_typed(OpenCLModuleLoadFile);
 
 TVM_REGISTER_GLOBAL("runtime.module.loadfile_clbin").set_body_typed(OpenCLModuleLoadFile);
@@ -37,6 +37,8 @@
 #include <cstring>
 #include <vector>
 
+#include "meta_data.h"
+
 namespace tvm {
 namespace runtime {
 /*!
@@ -64,12 +66,15 @@ union ArgUnion64 {
  *
  * \param f with signiture (TVMArgs args, TVMRetValue* rv, void* void_args)
  * \param arg_types The arguments type information.
+ * \param arg_extra_tags The extra tags of the arguments, can be empty.
  * \tparam F the function type
  *
  * \return The wrapped packed function.
  */
 template <typename F>
-inline PackedFunc PackFuncVoidAddr(F f, const std::vector<DLDataType>& arg_types);
+inline PackedFunc PackFuncVoidAddr(
+    F f, const std::vector<DLDataType>& arg_types,
+    const std::vector<FunctionInfo::ArgExtraTags>& arg_extra_tags = {});
 /*!
  * \brief Create a packed function that from function only packs buffer arguments.
  *
@@ -127,7 +132,8 @@ enum ArgConvertCode {
   INT64_TO_UINT32,
   FLOAT64_TO_FLOAT32,
   FLOAT64_TO_FLOAT64,
-  HANDLE_TO_HANDLE
+  HANDLE_TO_HANDLE,
+  HANDLE_TO_TENSORMAP
 };
 
 inline ArgConvertCode GetArgConvertCode(DLDataType t) {
@@ -162,6 +168,11 @@ inline PackedFunc PackFuncVoidAddr_(F f, const std::vector<ArgConvertCode>& code
           addr[i] = (void*)&(args.values[i]);  // NOLINT(*)
           break;
         }
+        case HANDLE_TO_TENSORMAP: {
+          // the tensor map itself is the kernel parameter
+          addr[i] = args.values[i].v_handle;
+          break;
+        }
         case INT64_TO_INT32: {
           holder[i].v_int32 = static_cast<int32_t>(args.values[i].v_int64);
           addr[i] = &(holder[i]);
@@ -212,7 +223,8 @@ inline PackedFunc PackFuncNonBufferArg_(F f, int base, const std::vector<ArgConv
           holder[i].v_float32[0] = static_cast<float>(args.values[base + i].v_float64);
           break;
         }
-        case HANDLE_TO_HANDLE: {
+        case HANDLE_TO_HANDLE:
+        case HANDLE_TO_TENSORMAP: {
           LOG(FATAL) << "not reached";
           break;
         }
@@ -273,10 +285,18 @@ inline PackedFunc PackFuncPackedArg_(F f, const std::vector<ArgConvertCode>& cod
 }  // namespace detail
 
 template <typename F>
-inline PackedFunc PackFuncVoidAddr(F f, const std::vector<DLDataType>& arg_types) {
+inline PackedFunc PackFuncVoidAddr(
+    F f, const std::vector<DLDataType>& arg_types,
+    const std::vector<FunctionInfo::ArgExtraTags>& arg_extra_tags) {
   std::vector<detail::ArgConvertCode> codes(arg_types.size());
   for (size_t i = 0; i < arg_types.size(); ++i) {
-    codes[i] = detail::GetArgConvertCode(arg_types[i]);
+    if (i < arg_extra_tags.size() &&
+        arg_extra_tags[i] == FunctionInfo::ArgExtraTags::kTensorMap) {
+      ICHECK_EQ(arg_types[i].code, kTVMOpaqueHandle) << "A tensor map must be passed as handle";
+      codes[i] = detail::HANDLE_TO_TENSORMAP;
+    } else {
+      codes[i] = detail::GetArgConvertCode(arg_types[i]);
+    }
   }
   size_t num_void_args = arg_types.size();
   // specialization
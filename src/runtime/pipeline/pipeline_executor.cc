@@ -85,6 +85,9 @@ PackedFunc PipelineExecutor::GetFunction(const String& name,
   } else if (name == "get_execute_count") {
     return PackedFunc(
         [sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { *rv = this->GetExecutionCount(); });
+  } else if (name == "get_statistics") {
+    return PackedFunc(
+        [sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { *rv = this->GetStatistics(); });
   } else {
     LOG(FATAL) << "Unknown packed function: " << name;
   }
@@ -235,6 +238,18 @@ std::pair<int, int> PipelineExecutor::GetInputIndex(const std::string& name) {
  * \brief Getting the count of running pipeline.
  */
 int PipelineExecutor::GetExecutionCount() { return runtimes_.back()->GetExecutionCount(); }
+/*!
+ * \brief Getting the statistics of each pipeline stage in JSON form.
+ */
+std::string PipelineExecutor::GetStatistics() {
+  std::ostringstream os;
+  os << "[";
+  for (size_t i = 0; i < runtimes_.size(); i++) {
+    os << (i ? ", " : "") << runtimes_[i]->GetStatistics();
+  }
+  os << "]";
+  return os.str();
+}
 /*!
  * \brief Initialize the pipeline executor with a list of modules to be pipelined
  *  and config in JSON format.
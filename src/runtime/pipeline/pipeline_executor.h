@@ -99,6 +99,11 @@ class TVM_DLL PipelineExecutor : public ModuleNode {
    * \brief Getting the count of running pipeline.
    */
   int GetExecutionCount();
+  /*!
+   * \brief Getting the throughput, batching and queueing statistics of each pipeline stage.
+   * \return A JSON list with one object per backend runtime.
+   */
+  std::string GetStatistics();
   /*!
    * \brief Use the parameters group name to get the specific backend runtime then use
    *  the param_key_name to set param data for the said backend runtime.
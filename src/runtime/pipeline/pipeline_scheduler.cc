@@ -36,6 +36,8 @@ std::shared_ptr<GlobalRuntime> PipelineScheduler::PipelineInit(
   // Creating a list of runtimes.
   for (size_t i = 0; i < graph_modules_.size(); i++) {
     auto run_item = std::make_shared<BackendRuntime>(graph_modules_[i], i);
+    // The queues and the global outputs are created after the batching settings.
+    run_item->ConfigureBatching(pipeline_config.GetRuntimeConfig(i));
     runtimes.push_back(run_item);
   }
   // Creating the global runtime to represent the pipeline executor.
@@ -26,10 +26,12 @@
 #include <tvm/runtime/threading_backend.h>
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <limits>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <thread>
 #include <unordered_map>
@@ -66,6 +68,8 @@ enum InterfaceType {
   INPUT = 0,
   OUTPUT,
 };
+/*!\brief The clock used to time the pipeline stages.*/
+using PipelineClock = std::chrono::steady_clock;
 /*!\brief The state of the pipeline.*/
 enum PipelineState {
   STOPPED = 0,
@@ -157,6 +161,19 @@ class DataNotify {
     data_ready_ = false;
     return !GetExitState();
   }
+  /*!
+   *\brief Waiting for the notification until a deadline.
+   *\param deadline The time point after which the waiting gives up.
+   *\return Returning 'false' when the deadline passed without a notification, else true.
+   */
+  bool WaitUntil(PipelineClock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!notify_cv_.wait_until(lock, deadline, [&] { return this->data_ready_; })) {
+      return false;
+    }
+    data_ready_ = false;
+    return true;
+  }
   /*!brief Sending the notification in which the related data is ready.*/
   void Notify(void) {
     {
@@ -325,6 +342,7 @@ class ConfigRuntime {
   ConfigRuntime& operator=(const ConfigRuntime& output) {
     output_binding_map_ = output.GetOutBindings();
     cpu_affinity_ = output.GetCPUAffinity();
+    StoreBatching(output.GetBatchSize(), output.GetBatchTimeout(), output.GetQueueCapacity());
     return *this;
   }
 
@@ -342,6 +360,23 @@ class ConfigRuntime {
    * \param Returning the cpu affinity in text form.
    */
   std::string GetCPUAffinity() const { return cpu_affinity_; }
+  /*!
+   * \brief Store the micro-batching and queue settings.
+   * \param batch_size The number of requests coalesced into one run of the module.
+   * \param batch_timeout_us The time in microseconds to wait for a batch to fill up.
+   * \param queue_capacity The capacity of the input queues, 0 for the default.
+   */
+  void StoreBatching(int batch_size, int batch_timeout_us, int queue_capacity) {
+    batch_size_ = batch_size;
+    batch_timeout_us_ = batch_timeout_us;
+    queue_capacity_ = queue_capacity;
+  }
+  /*!\brief Getting the number of requests coalesced into one run of the module.*/
+  int GetBatchSize() const { return batch_size_; }
+  /*!\brief Getting the time in microseconds to wait for a batch to fill up.*/
+  int GetBatchTimeout() const { return batch_timeout_us_; }
+  /*!\brief Getting the capacity of the input queues, 0 for the default.*/
+  int GetQueueCapacity() const { return queue_capacity_; }
   /*!
    * \brief Enumerating the output configuration.
    * \param parse_function The callback function is used to parse the binding configeration.
@@ -413,6 +448,12 @@ class ConfigRuntime {
   std::unordered_map<int, ConfigBindings> output_binding_map_;
   /*!\brief The cpu affinity setting for the tvm thread pool.*/
   std::string cpu_affinity_;
+  /*!\brief The number of requests coalesced into one run of the module.*/
+  int batch_size_ = 1;
+  /*!\brief The time in microseconds to wait for a batch to fill up.*/
+  int batch_timeout_us_ = 0;
+  /*!\brief The capacity of the input queues, 0 for the default.*/
+  int queue_capacity_ = 0;
 };
 
 /*!
@@ -433,6 +474,14 @@ class ConfigPipelineExecution {
     auto config_runtime = config->second;
     return config_runtime.GetCPUAffinity();
   }
+  /*!\brief Get the configuration of a runtime, including its micro-batching settings.*/
+  const ConfigRuntime& GetRuntimeConfig(int runtime_idx) const {
+    auto config = config_.find(runtime_idx);
+    if (config == config_.end()) {
+      LOG(FATAL) << "Do not finding the runtime " << runtime_idx;
+    }
+    return config->second;
+  }
   /*!
    * \brief Enumerating the binding configuration for a specified runtime.
    * \param parse_function The callback function is used to parse the binding configuration.
@@ -503,6 +552,9 @@ class ConfigPipelineExecution {
       ConfigRuntime output;
       std::string dev;
       std::string cpu_affinity;
+      int batch_size = 1;
+      int batch_timeout_us = 0;
+      int queue_capacity = 0;
       while (reader->NextObjectItem(&key)) {
         if (key == "mod_idx") {
           reader->Read(&mod_idx);
@@ -512,6 +564,12 @@ class ConfigPipelineExecution {
           reader->Read(&output);
         } else if (key == "cpu_affinity") {
           reader->Read(&cpu_affinity);
+        } else if (key == "batch_size") {
+          reader->Read(&batch_size);
+        } else if (key == "batch_timeout_us") {
+          reader->Read(&batch_timeout_us);
+        } else if (key == "queue_capacity") {
+          reader->Read(&queue_capacity);
         } else {
           LOG(FATAL) << "do not support key " << key;
         }
@@ -521,6 +579,8 @@ class ConfigPipelineExecution {
       ICHECK(!output.Empty()) << "Invalid output binding result.";
       // Store the cpu affinity into the 'ConfigRuntime' structure.
       output.StoreCPUAffinity(cpu_affinity);
+      ICHECK(batch_size >= 1) << "Invalid batch_size value " << batch_size;
+      output.StoreBatching(batch_size, batch_timeout_us, queue_capacity);
       // Build the mapping of mod_idx and "ConfigRuntime".
       config_[mod_idx] = output;
     }
@@ -677,6 +737,8 @@ class BasicRuntime {
   explicit BasicRuntime(int runtime_idx) : runtime_idx_(runtime_idx) {}
   /*!\brief Return the index of the current module.*/
   int GetModuleIndex() { return runtime_idx_; }
+  /*!\brief Return the capacity of the input queues of this runtime, 0 for the default.*/
+  int GetQueueCapacity() const { return queue_capacity_; }
   /*!\brief Setting the data into this runtime via the input index.*/
   virtual void SetInput(const int index, DLTensor* data_in) {}
   /*!
@@ -721,6 +783,15 @@ class BasicRuntime {
   std::unordered_map<int, ForwardQueueMap> forward_queue_;
   /*!\brief The state of the pipeline.*/
   std::atomic<PipelineState> pipeline_state_{STOPPED};
+  /*!\brief The capacity of the input queues of this runtime, 0 for the default.*/
+  int queue_capacity_ = 0;
+  /*!\brief The time in microseconds spent waiting for the full queues of the children.*/
+  std::atomic<int64_t> backpressure_us_{0};
+  /*!\brief Returning the microseconds elapsed since a time point.*/
+  static int64_t ElapsedUs(PipelineClock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(PipelineClock::now() - start)
+        .count();
+  }
   /*!
    * \brief Generate the ID of an input queue.
    * \param runtime_index The index of backend runtime.
@@ -749,13 +820,18 @@ class BasicRuntime {
     }
     auto forward_queue = forward_queue_map->at(queue_id);
     // If the queue is full, keep try until the push get success or the pipeline run into
-    // a STOP state.
-    while (!forward_queue->Push<const DLTensor*>(data)) {
-      if (PipelineIsStop()) {
-        LOG(INFO) << "The forwarding process is stopped after the pipeline status is changed"
-                  << " into stop.";
-        return false;
+    // a STOP state. The child is behind, so this runtime is held back.
+    if (!forward_queue->Push<const DLTensor*>(data)) {
+      auto start = PipelineClock::now();
+      while (!forward_queue->Push<const DLTensor*>(data)) {
+        if (PipelineIsStop()) {
+          LOG(INFO) << "The forwarding process is stopped after the pipeline status is changed"
+                    << " into stop.";
+          return false;
+        }
+        std::this_thread::yield();
       }
+      backpressure_us_ += ElapsedUs(start);
     }
     child_runtime->ParentNotify(child_input_index);
     return true;
@@ -777,7 +853,9 @@ class BasicRuntime {
                  << " is already created!";
       return;
     }
-    auto queue = std::make_shared<ForwardQueue>(queue_id);
+    int capacity = child_runtime->GetQueueCapacity();
+    auto queue = capacity > 0 ? std::make_shared<ForwardQueue>(queue_id, capacity)
+                              : std::make_shared<ForwardQueue>(queue_id);
     queue_map[queue_id] = queue;
     // Use the created queue as the consumer queue for the input interface of this forwarding
     // pair.
@@ -810,6 +888,24 @@ class BackendRuntime : public BasicRuntime {
   std::thread thread_;
   /*!\brief The execution count of the 'RunPipeline' function. */
   uint32_t pipeline_execution_count_ = 0;
+  /*!\brief The number of requests coalesced into one run of the module.*/
+  int batch_size_ = 1;
+  /*!\brief The time to wait for a batch to fill up once its first request is loaded.*/
+  std::chrono::microseconds batch_timeout_{0};
+  /*!\brief The views of the batch slots of each input, created by 'SliceBatch'.*/
+  std::unordered_map<int, std::vector<DLTensor>> input_slots_;
+  /*!\brief The shape of the views in 'input_slots_'.*/
+  std::unordered_map<int, std::vector<int64_t>> input_slot_shapes_;
+  /*!\brief The number of runs of the module.*/
+  std::atomic<uint64_t> run_count_{0};
+  /*!\brief The number of requests processed, more than the runs when batching.*/
+  std::atomic<uint64_t> request_count_{0};
+  /*!\brief The time in microseconds spent running the module.*/
+  std::atomic<int64_t> busy_us_{0};
+  /*!\brief The time in microseconds spent waiting for the input data.*/
+  std::atomic<int64_t> wait_us_{0};
+  /*!\brief The time when the pipeline started.*/
+  PipelineClock::time_point start_time_;
   /*!
    *\brief In order to transfer data from one backend runtime to another, we need a local
    * tensor variable as a medium. "input_tensor_local_copy_" is a map including
@@ -827,14 +923,29 @@ class BackendRuntime : public BasicRuntime {
   /*!\brief The worker thread is used to execute the runtimes in pipeline.*/
   void StartWorkThread() {
     SetPipelineState(RUNNING);
+    start_time_ = PipelineClock::now();
     if (runtime_idx_ == 0) {
       this->SetCPUAffinity();
     } else {
       // Only launching the worker thread for the runtimes after the first runtime.
       thread_ = std::thread([&]() {
         this->SetCPUAffinity();
-        while (!this->WaitAndLoadPipelineData()) {
-          if (!this->RunPipeline()) {
+        while (true) {
+          auto wait_start = PipelineClock::now();
+          if (this->WaitAndLoadPipelineData()) break;
+          // Coalescing the requests queued behind the first one, until the batch is full or
+          // the batch timeout expires.
+          int batch = 1;
+          bool exit_notify = false;
+          auto deadline = PipelineClock::now() + batch_timeout_;
+          while (batch < batch_size_) {
+            bool timed_out = false;
+            exit_notify = this->WaitAndLoadPipelineData(batch, &deadline, &timed_out);
+            if (exit_notify || timed_out) break;
+            batch++;
+          }
+          wait_us_ += ElapsedUs(wait_start);
+          if (exit_notify || !this->RunPipeline(batch)) {
             break;
           }
         }
@@ -860,9 +971,14 @@ class BackendRuntime : public BasicRuntime {
   }
   /*!
    * \brief Waiting for the internal forwarding data.
+   * \param slot The batch slot which receives the data.
+   * \param deadline When it is set, giving up if no data comes in time for the first input. The
+   *  other inputs belong to a request which already started to arrive and are always waited for.
+   * \param timed_out Set to 'true' when giving up because of the deadline.
    * \return Returning 'true' when getting a 'exit' notification otherwise returning 'false'.
    */
-  bool WaitAndLoadPipelineData() {
+  bool WaitAndLoadPipelineData(int slot = 0, const PipelineClock::time_point* deadline = nullptr,
+                               bool* timed_out = nullptr) {
     std::unordered_map<int, std::shared_ptr<DataNotify>> notifys = parents_notify_;
     bool exit_notify = false;
     while (!notifys.empty() && !exit_notify) {
@@ -871,10 +987,17 @@ class BackendRuntime : public BasicRuntime {
       if ((exit_notify = notify->second->GetExitState())) break;
       // Getting the source which sends this notification.
       auto target_input_interface_index = notify->first;
+      bool may_time_out = deadline != nullptr && notifys.size() == parents_notify_.size();
       // Loading the binding data.
-      while (!this->LoadBindingData(target_input_interface_index)) {
+      while (!this->LoadBindingData(target_input_interface_index, slot)) {
         // Waiting for the notification.
-        if (!notify->second->Wait()) {
+        if (may_time_out) {
+          if (!notify->second->WaitUntil(*deadline)) {
+            *timed_out = true;
+            return false;
+          }
+          if ((exit_notify = notify->second->GetExitState())) break;
+        } else if (!notify->second->Wait()) {
           exit_notify = true;
           break;
         }
@@ -886,9 +1009,10 @@ class BackendRuntime : public BasicRuntime {
   /*!
    * \brief Loading the binding data.
    * \param input_index The index of the interface which will receive the forwarding data.
+   * \param slot The batch slot which receives the data.
    * \return Returning 'true' when data is loaded successfully, otherwise returning 'false'.
    */
-  bool LoadBindingData(int input_index) {
+  bool LoadBindingData(int input_index, int slot = 0) {
     if (input_queue_.find(input_index) == input_queue_.end()) {
       LOG(FATAL) << "Not finding the associated input queue of the input " << input_index << " !";
     }
@@ -898,29 +1022,78 @@ class BackendRuntime : public BasicRuntime {
     if (!queue->Poll<QueueData>(&data)) {
       return false;
     }
-    SetInput(input_index, data.GetDLData());
+    SetBatchInput(input_index, data.GetDLData(), slot);
     return true;
   }
+  /*!
+   * \brief Creating the views of the batch slots of a tensor, along its first axis.
+   * \param tensor The tensor holding 'batch_size_' requests.
+   * \param shape The storage of the shape of the views, which has to outlive them.
+   */
+  std::vector<DLTensor> SliceBatch(const DLTensor* tensor, std::vector<int64_t>* shape) {
+    ICHECK(tensor->ndim > 0 && tensor->strides == nullptr)
+        << "The runtime " << runtime_idx_ << " can not batch a scalar or a strided tensor";
+    ICHECK_EQ(tensor->shape[0] % batch_size_, 0)
+        << "The runtime " << runtime_idx_ << " coalesces " << batch_size_
+        << " requests, but a tensor has a first dimension of " << tensor->shape[0];
+    shape->assign(tensor->shape, tensor->shape + tensor->ndim);
+    (*shape)[0] /= batch_size_;
+    size_t slot_bytes = GetDataSize(*tensor) / batch_size_;
+    std::vector<DLTensor> slots(batch_size_, *tensor);
+    for (int i = 0; i < batch_size_; i++) {
+      slots[i].shape = shape->data();
+      slots[i].byte_offset = tensor->byte_offset + i * slot_bytes;
+    }
+    return slots;
+  }
+  /*!
+   * \brief Setting the data of one request into a batch slot of an input.
+   * \param index The input index.
+   * \param data_in The data of the request.
+   * \param slot The batch slot.
+   */
+  void SetBatchInput(int index, DLTensor* data_in, int slot) {
+    if (batch_size_ == 1) {
+      SetInput(index, data_in);
+      return;
+    }
+    auto slots = input_slots_.find(index);
+    if (slots == input_slots_.end()) {
+      NDArray input = GetInput(index);
+      std::vector<int64_t>* shape = &input_slot_shapes_[index];
+      slots = input_slots_.emplace(index, SliceBatch(input.operator->(), shape)).first;
+    }
+    CopyFromTo(data_in, &slots->second[slot]);
+  }
   /*!
    * \brief Forwarding the output data into the child runtimes.
    * \return bool Return false when the "PipelineIsStop" function returns true or this function
    *  reaches some errors. Otherwise, return true.
    */
-  bool ForwardingOutputDataToChildren(void) {
-    for (auto child : children_) {
-      auto output_idx = child.first;
-      if (forward_queue_.find(output_idx) == forward_queue_.end()) {
-        LOG(FATAL) << "Not find the forwarding queue map for output(" << output_idx << ")!";
-      }
-      NDArray output = GetOutput(output_idx);
-      auto forward_queue_map = forward_queue_[output_idx];
-      // Notifying the 'children runtime' that the forwarding data are ready.
-      for (auto module_pair : child.second) {
-        auto child_runtime = module_pair.first;
-        auto child_input_index = module_pair.second;
+  bool ForwardingOutputDataToChildren(int batch = 1) {
+    // The requests of a batch are forwarded in order, each one as a slot of the outputs.
+    for (int slot = 0; slot < batch; slot++) {
+      for (auto child : children_) {
+        auto output_idx = child.first;
+        if (forward_queue_.find(output_idx) == forward_queue_.end()) {
+          LOG(FATAL) << "Not find the forwarding queue map for output(" << output_idx << ")!";
+        }
+        NDArray output = GetOutput(output_idx);
         auto output_data = const_cast<DLTensor*>(output.operator->());
-        if (!ForwardData(&forward_queue_map, child_runtime, child_input_index, output_data)) {
-          return false;
+        std::vector<int64_t> slot_shape;
+        std::vector<DLTensor> slots;
+        if (batch_size_ > 1) {
+          slots = SliceBatch(output_data, &slot_shape);
+          output_data = &slots[slot];
+        }
+        auto forward_queue_map = forward_queue_[output_idx];
+        // Notifying the 'children runtime' that the forwarding data are ready.
+        for (auto module_pair : child.second) {
+          auto child_runtime = module_pair.first;
+          auto child_input_index = module_pair.second;
+          if (!ForwardData(&forward_queue_map, child_runtime, child_input_index, output_data)) {
+            return false;
+          }
         }
       }
     }
@@ -1002,6 +1175,40 @@ class BackendRuntime : public BasicRuntime {
    * \return The times of using pipeline function.
    */
   int GetExecutionCount() const { return pipeline_execution_count_; }
+  /*!
+   * \brief Setting the micro-batching and queue settings, before initializing the pipeline.
+   * \param config The configuration of this runtime.
+   */
+  void ConfigureBatching(const ConfigRuntime& config) {
+    batch_size_ = config.GetBatchSize();
+    batch_timeout_ = std::chrono::microseconds(config.GetBatchTimeout());
+    queue_capacity_ = config.GetQueueCapacity();
+    ICHECK(batch_size_ == 1 || runtime_idx_ != 0)
+        << "The first runtime runs in the caller thread and can not coalesce requests.";
+  }
+  /*!
+   * \brief Getting the statistics of this stage of the pipeline.
+   * \return The statistics in JSON form.
+   */
+  std::string GetStatistics() {
+    double elapsed_us = std::max<int64_t>(ElapsedUs(start_time_), 1);
+    uint64_t runs = run_count_.load(std::memory_order_relaxed);
+    uint64_t requests = request_count_.load(std::memory_order_relaxed);
+    int64_t busy_us = busy_us_.load(std::memory_order_relaxed);
+    size_t queued = 0;
+    for (auto queue : input_queue_) {
+      queued += queue.second->Size();
+    }
+    std::ostringstream os;
+    os << "{\"runtime_idx\": " << runtime_idx_ << ", \"batch_size\": " << batch_size_
+       << ", \"runs\": " << runs << ", \"requests\": " << requests
+       << ", \"average_batch\": " << (runs ? static_cast<double>(requests) / runs : 0.0)
+       << ", \"busy_us\": " << busy_us << ", \"wait_us\": " << wait_us_.load()
+       << ", \"backpressure_us\": " << backpressure_us_.load() << ", \"queued\": " << queued
+       << ", \"throughput\": " << requests * 1e6 / elapsed_us
+       << ", \"utilization\": " << busy_us / elapsed_us << "}";
+    return os.str();
+  }
   /*!
    * \brief Initializing data structures for the pipeline execution.
    * \param config The pipeline configueration.
@@ -1062,6 +1269,12 @@ class BackendRuntime : public BasicRuntime {
   /*!\brief Creating a NDArray containing same shape and data type with a module output. */
   NDArray CreateFromOutput(int idx) {
     NDArray data = get_output_(idx);
+    if (batch_size_ > 1) {
+      // The global outputs hold a single request.
+      std::vector<int64_t> slot_shape;
+      std::vector<DLTensor> slots = SliceBatch(data.operator->(), &slot_shape);
+      return CreateNDArrayFromDLTensor(&slots[0]);
+    }
     return CreateNDArrayFromDLTensor(const_cast<DLTensor*>(data.operator->()));
   }
   /*!\brief Return the number of output*/
@@ -1089,12 +1302,17 @@ class BackendRuntime : public BasicRuntime {
   void Run() { run_(); }
   /*!
    * \brief Running the runtime in the pipeline mode.
+   * \param batch The number of requests loaded in the batch slots of the inputs.
    * \return Returning false if the forwarding function failed. Otherwise, returning true.;
    */
-  bool RunPipeline() {
+  bool RunPipeline(int batch = 1) {
+    auto start = PipelineClock::now();
     Run();
-    bool ret = ForwardingOutputDataToChildren();
-    pipeline_execution_count_++;
+    busy_us_ += ElapsedUs(start);
+    run_count_++;
+    request_count_ += batch;
+    bool ret = ForwardingOutputDataToChildren(batch);
+    pipeline_execution_count_ += batch;
     return ret;
   }
 };
@@ -18,6 +18,7 @@
  */
 #ifndef TVM_RUNTIME_PIPELINE_SPSC_QUEUE_H_
 #define TVM_RUNTIME_PIPELINE_SPSC_QUEUE_H_
+#include <algorithm>
 #include <cstddef>
 #include <thread>
 /*!\brief A single producer and single consumer lock free queue.
@@ -25,7 +26,14 @@
 template <typename SlotType, typename IDType = int, int QueueLength = 1024>
 class SPSCLockFreeQueue {
  public:
-  explicit SPSCLockFreeQueue(IDType id) : id_(id) {}
+  /*!
+   * \brief Constructing the queue.
+   * \param id The ID of the queue.
+   * \param capacity The number of slots the producer can fill before 'Push' fails, at most
+   *  'QueueLength - 1'. The producer is held back once the consumer falls this far behind.
+   */
+  explicit SPSCLockFreeQueue(IDType id, size_t capacity = QueueLength - 1)
+      : len_(std::min<size_t>(std::max<size_t>(capacity, 1) + 1, QueueLength)), id_(id) {}
   /*A read barrier enforcing the CPU to performe the reads before this barrier.*/
   inline void read_barrier() { std::atomic_thread_fence(std::memory_order_acquire); }
   /*A write barrier enforcing the CPU to performe the writes before this barrier.*/
@@ -40,6 +48,11 @@ class SPSCLockFreeQueue {
     read_barrier();
     return head_ == tail_;
   }
+  /*!\brief Returning the number of slots holding data.*/
+  size_t Size() {
+    read_barrier();
+    return (tail_ + len_ - head_) % len_;
+  }
   /*!
    * \brief Pushing the data into the queue. Only a single producer will call this function.
    * \param data The data which is pushed into the queue.
@@ -73,7 +86,7 @@ class SPSCLockFreeQueue {
   size_t head_ = 0;
   /*!\brief The end of the queue at which elements are added.*/
   size_t tail_ = 0;
-  /*!\brief The length of the queue.*/
+  /*!\brief The length of the queue, one more than its capacity.*/
   size_t len_ = QueueLength;
   /*!\brief The queue used to store the data.*/
   SlotType queue_[QueueLength];
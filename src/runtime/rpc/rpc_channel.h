@@ -45,6 +45,23 @@ class RPCChannel {
    * \return The actual bytes sent.
    */
   virtual size_t Send(const void* data, size_t size) = 0;
+  /*!
+   * \brief Send a header followed by a payload, without first copying them into one buffer.
+   *
+   * The default sends from the header until it is done, then from the payload.
+   * Channels that support scatter-gather IO send both in one call.
+   *
+   * \param head The header pointer.
+   * \param head_size The size of the header.
+   * \param body The payload pointer.
+   * \param body_size The size of the payload.
+   * \return The actual bytes sent, counted from the start of the header.
+   */
+  virtual size_t SendGather(const void* head, size_t head_size, const void* body,
+                            size_t body_size) {
+    if (head_size != 0) return Send(head, head_size);
+    return Send(body, body_size);
+  }
   /*!
    * \brief Recv data from channel.
    *
@@ -33,8 +33,10 @@
 #include <array>
 #include <chrono>
 #include <cmath>
+#include <deque>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -43,6 +45,8 @@
 #include "../../support/utils.h"
 #include "../object_internal.h"
 #include "rpc_local_session.h"
+#include "rpc_session.h"
+#include "rpc_transfer.h"
 
 namespace tvm {
 namespace runtime {
@@ -860,6 +864,97 @@ void RPCEndpoint::CopyFromRemote(DLTensor* from, void* to_bytes, uint64_t nbytes
   handler_->FinishCopyAck();
 }
 
+void RPCEndpoint::CopyToRemotePipelined(void* from_bytes, DLTensor* to, uint64_t nbytes,
+                                        uint64_t block_size, int window) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  RPCCode code = RPCCode::kCopyToRemote;
+  ICHECK_GT(block_size, 0U);
+  ICHECK_GT(window, 0);
+
+  uint64_t base_offset = to->byte_offset;
+  uint64_t tensor_total_size_bytes = static_cast<uint64_t>(GetDataSize(*to));
+  ICHECK_LE(base_offset + nbytes, tensor_total_size_bytes)
+      << "CopyToRemote: overflow in tensor size: (byte_offset=" << base_offset
+      << ", nbytes=" << nbytes << ", tensor_total_size=" << tensor_total_size_bytes << ")";
+
+  auto wait_return = [this]() {
+    ICHECK(HandleUntilReturnEvent(true, [](TVMArgs) {}) == RPCCode::kReturn);
+  };
+  int in_flight = 0;
+  for (uint64_t offset = 0; offset < nbytes; offset += block_size) {
+    uint64_t size = std::min(block_size, nbytes - offset);
+    to->byte_offset = base_offset + offset;
+    uint64_t overhead = RemoteCopyCalculatePacketOverheadSize(to, code, size);
+    handler_->Write(overhead + size);
+    handler_->Write(code);
+    RPCReference::SendDLTensor(handler_, to);
+    handler_->Write(size);
+    FlushWriterWithPayload(static_cast<char*>(from_bytes) + offset, size);
+    // The server answers the packets in order, the oldest one is retired once the window is full.
+    if (++in_flight == window) {
+      wait_return();
+      --in_flight;
+    }
+  }
+  for (; in_flight > 0; --in_flight) wait_return();
+  to->byte_offset = base_offset;
+}
+
+void RPCEndpoint::CopyFromRemotePipelined(DLTensor* from, void* to_bytes, uint64_t nbytes,
+                                          uint64_t block_size, int window) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  RPCCode code = RPCCode::kCopyFromRemote;
+  ICHECK_GT(block_size, 0U);
+  ICHECK_GT(window, 0);
+
+  uint64_t base_offset = from->byte_offset;
+  uint64_t tensor_total_size_bytes = static_cast<uint64_t>(GetDataSize(*from));
+  ICHECK_LE(base_offset + nbytes, tensor_total_size_bytes)
+      << "CopyFromRemote: overflow in tensor size: (byte_offset=" << base_offset
+      << ", nbytes=" << nbytes << ", tensor_total_size=" << tensor_total_size_bytes << ")";
+
+  // The (offset, size) of the requested blocks whose ack is not read yet.
+  std::deque<std::pair<uint64_t, uint64_t>> pending;
+  auto receive = [&]() {
+    ICHECK(HandleUntilReturnEvent(true, [](TVMArgs) {}) == RPCCode::kCopyAck);
+    handler_->ReadArray(static_cast<char*>(to_bytes) + pending.front().first,
+                        pending.front().second);
+    handler_->FinishCopyAck();
+    pending.pop_front();
+  };
+  for (uint64_t offset = 0; offset < nbytes; offset += block_size) {
+    uint64_t size = std::min(block_size, nbytes - offset);
+    from->byte_offset = base_offset + offset;
+    uint64_t overhead = RemoteCopyCalculatePacketOverheadSize(from, code, size);
+    handler_->Write(overhead);
+    handler_->Write(code);
+    RPCReference::SendDLTensor(handler_, from);
+    handler_->Write(size);
+    FlushWriterWithPayload(nullptr, 0);
+    pending.emplace_back(offset, size);
+    if (pending.size() == static_cast<size_t>(window)) receive();
+  }
+  while (!pending.empty()) receive();
+  from->byte_offset = base_offset;
+}
+
+void RPCEndpoint::FlushWriterWithPayload(const void* payload, size_t size) {
+  CHECK(channel_) << "Expected connection to server " << name_
+                  << " to be active, but the connection was previously closed";
+  std::string head(writer_.bytes_available(), '\0');
+  writer_.Read(&head[0], head.size());
+  const char* body = static_cast<const char*>(payload);
+  size_t head_sent = 0, body_sent = 0;
+  while (head_sent < head.size() || body_sent < size) {
+    size_t n = channel_->SendGather(head.data() + head_sent, head.size() - head_sent,
+                                    body + body_sent, size - body_sent);
+    ICHECK_NE(n, 0U) << "Channel closes before the packet is sent";
+    size_t from_head = std::min(n, head.size() - head_sent);
+    head_sent += from_head;
+    body_sent += n - from_head;
+  }
+}
+
 // SysCallEventHandler functions
 void RPCGetGlobalFunc(RPCSession* handler, TVMArgs args, TVMRetValue* rv) {
   std::string name = args[0];
@@ -1027,55 +1122,55 @@ class RPCClientSession : public RPCSession, public DeviceAPI {
   }
 
   void CopyToRemote(void* local_from_bytes, DLTensor* remote_to, uint64_t nbytes) final {
-    RPCCode code = RPCCode::kCopyToRemote;
-    uint64_t overhead = RemoteCopyCalculatePacketOverheadSize(remote_to, code, nbytes);
-    uint64_t rpc_max_size = GetRPCMaxTransferSize();
-    ICHECK_GT(rpc_max_size, overhead) << "CopyToRemote: Invalid block size!";
-    const uint64_t block_size = rpc_max_size - overhead;
-    uint64_t block_count = 0;
-    const uint64_t num_blocks = nbytes / block_size;
-    void* from_bytes;
-
-    for (block_count = 0; block_count < num_blocks; block_count++) {
-      remote_to->byte_offset = block_count * block_size;
-      from_bytes = reinterpret_cast<void*>(
-          (reinterpret_cast<uint8_t*>(local_from_bytes) + block_count * block_size));
-      endpoint_->CopyToRemote(from_bytes, remote_to, block_size);
+    if (nbytes == 0) return;
+    PackedFuncHandle fetch = nullptr, store = nullptr;
+    RPCTensorDigest digest;
+    if (cache_min_bytes_ > 0 && nbytes >= static_cast<uint64_t>(cache_min_bytes_)) {
+      fetch = GetServerFunction("tvm.rpc.server.TensorCacheFetch");
+      store = GetServerFunction("tvm.rpc.server.TensorCacheStore");
+    }
+    if (fetch != nullptr && store != nullptr) {
+      digest = RPCContentDigest(local_from_bytes, nbytes);
+      if (CallTensorCacheFunc(fetch, remote_to, digest, nbytes)) return;
     }
 
-    const uint64_t remainder_bytes = nbytes % block_size;
-    if (remainder_bytes != 0) {
-      remote_to->byte_offset = block_count * block_size;
-      from_bytes = reinterpret_cast<void*>(
-          (reinterpret_cast<uint8_t*>(local_from_bytes) + block_count * block_size));
-      endpoint_->CopyToRemote(from_bytes, remote_to, remainder_bytes);
+    uint64_t block_size = GetTransferBlockSize(remote_to, RPCCode::kCopyToRemote);
+    PackedFuncHandle decompress = nullptr;
+    if (compress_min_bytes_ > 0 && nbytes >= static_cast<uint64_t>(compress_min_bytes_)) {
+      decompress = GetServerFunction("tvm.rpc.server.CopyToRemoteCompressed");
+    }
+    if (decompress != nullptr) {
+      CopyToRemoteCompressed(decompress, local_from_bytes, remote_to, nbytes, block_size);
+    } else {
+      endpoint_->CopyToRemotePipelined(local_from_bytes, remote_to, nbytes, block_size,
+                                       GetPipelineWindow());
+    }
+
+    if (fetch != nullptr && store != nullptr) {
+      CallTensorCacheFunc(store, remote_to, digest, nbytes);
     }
   }
 
   void CopyFromRemote(DLTensor* remote_from, void* local_to_bytes, uint64_t nbytes) final {
-    RPCCode code = RPCCode::kCopyFromRemote;
-    uint64_t overhead = RemoteCopyCalculatePacketOverheadSize(remote_from, code, nbytes);
-    uint64_t rpc_max_size = GetRPCMaxTransferSize();
-    ICHECK_GT(rpc_max_size, overhead) << "CopyFromRemote: Invalid block size!";
-    const uint64_t block_size = rpc_max_size - overhead;
-    uint64_t block_count = 0;
-    const uint64_t num_blocks = nbytes / block_size;
-    void* to_bytes;
-
-    for (block_count = 0; block_count < num_blocks; block_count++) {
-      remote_from->byte_offset = block_count * block_size;
-      to_bytes = reinterpret_cast<void*>(
-          (reinterpret_cast<uint8_t*>(local_to_bytes) + block_count * block_size));
-      endpoint_->CopyFromRemote(remote_from, to_bytes, block_size);
-    }
+    if (nbytes == 0) return;
+    uint64_t block_size = GetTransferBlockSize(remote_from, RPCCode::kCopyFromRemote);
+    endpoint_->CopyFromRemotePipelined(remote_from, local_to_bytes, nbytes, block_size,
+                                       GetPipelineWindow());
+  }
 
-    const uint64_t remainder_bytes = nbytes % block_size;
-    if (remainder_bytes != 0) {
-      remote_from->byte_offset = block_count * block_size;
-      to_bytes = reinterpret_cast<void*>(
-          (reinterpret_cast<uint8_t*>(local_to_bytes) + block_count * block_size));
-      endpoint_->CopyFromRemote(remote_from, to_bytes, remainder_bytes);
-    }
+  /*!
+   * \brief Sets how the bulk copies are transferred. A negative value keeps an option.
+   * \param block_bytes The payload bytes of each copy packet, 0 for the default.
+   * \param window The number of copy packets in flight, 0 for the default.
+   * \param cache_min_bytes The smallest upload keyed in the server tensor cache, 0 disables it.
+   * \param compress_min_bytes The smallest upload that is compressed, 0 disables compression.
+   */
+  void SetTransferOptions(int64_t block_bytes, int window, int64_t cache_min_bytes,
+                          int64_t compress_min_bytes) {
+    if (block_bytes >= 0) transfer_block_bytes_ = block_bytes;
+    if (window >= 0) pipeline_window_ = window;
+    if (cache_min_bytes >= 0) cache_min_bytes_ = cache_min_bytes;
+    if (compress_min_bytes >= 0) compress_min_bytes_ = compress_min_bytes;
   }
 
   void FreeHandle(void* handle, int type_code) final {
@@ -1155,6 +1250,7 @@ class RPCClientSession : public RPCSession, public DeviceAPI {
     if (rpc_func == nullptr) {
       rpc_chunk_max_size_bytes_ = (int64_t)kRPCMaxTransferSizeBytesDefault;
     } else {
+      crt_server_ = true;
       CallFunc(rpc_func, nullptr, nullptr, 0, [this](TVMArgs args) {
         // Use args[1] as return value, args[0] is tcode
         // Look at RPCWrappedFunc in src/runtime/rpc/rpc_module.cc
@@ -1167,14 +1263,109 @@ class RPCClientSession : public RPCSession, public DeviceAPI {
     return (uint64_t)rpc_chunk_max_size_bytes_;
   }
 
+  /*! \brief The payload bytes of a copy packet of \p tensor. */
+  uint64_t GetTransferBlockSize(DLTensor* tensor, RPCCode code) {
+    uint64_t overhead = RemoteCopyCalculatePacketOverheadSize(tensor, code, 0);
+    uint64_t rpc_max_size = GetRPCMaxTransferSize();
+    ICHECK_GT(rpc_max_size, overhead) << "Copy: Invalid block size!";
+    uint64_t block_size = rpc_max_size - overhead;
+    if (transfer_block_bytes_ > 0) {
+      block_size = std::min(block_size, static_cast<uint64_t>(transfer_block_bytes_));
+    } else if (!crt_server_) {
+      block_size = std::min(block_size, kDefaultTransferBlockBytes);
+    }
+    return block_size;
+  }
+
+  /*! \brief The CRT servers have room for a single packet, the others get a window. */
+  int GetPipelineWindow() {
+    GetRPCMaxTransferSize();
+    if (pipeline_window_ > 0) return pipeline_window_;
+    return crt_server_ ? 1 : kDefaultPipelineWindow;
+  }
+
+  /*! \brief Looks up a server function once, nullptr when the server does not have it. */
+  PackedFuncHandle GetServerFunction(const std::string& name) {
+    auto it = server_funcs_.find(name);
+    if (it == server_funcs_.end()) {
+      it = server_funcs_.emplace(name, GetFunction(name)).first;
+    }
+    return it->second;
+  }
+
+  /*! \brief Calls TensorCacheFetch or TensorCacheStore on \p remote_to. */
+  bool CallTensorCacheFunc(PackedFuncHandle func, DLTensor* remote_to,
+                           const RPCTensorDigest& digest, uint64_t nbytes) {
+    TVMValue values[4];
+    int type_codes[4];
+    TVMArgsSetter setter(values, type_codes);
+    setter(0, remote_to);
+    setter(1, static_cast<int64_t>(digest.first));
+    setter(2, static_cast<int64_t>(digest.second));
+    setter(3, static_cast<int64_t>(nbytes));
+    bool result = false;
+    // args[1] is the return value, args[0] is its tcode.
+    CallFunc(func, values, type_codes, 4,
+             [&result](TVMArgs args) { result = args[1].operator bool(); });
+    return result;
+  }
+
+  /*!
+   * \brief Uploads \p nbytes a block at a time, each block compressed when that saves at least a
+   * quarter of it and sent as a plain copy packet otherwise.
+   */
+  void CopyToRemoteCompressed(PackedFuncHandle decompress, void* local_from_bytes,
+                              DLTensor* remote_to, uint64_t nbytes, uint64_t block_size) {
+    uint64_t base_offset = remote_to->byte_offset;
+    for (uint64_t offset = 0; offset < nbytes; offset += block_size) {
+      uint64_t size = std::min(block_size, nbytes - offset);
+      char* block = static_cast<char*>(local_from_bytes) + offset;
+      remote_to->byte_offset = base_offset + offset;
+      std::string compressed = RPCCompressZeroRuns(block, size);
+      if (compressed.size() + size / 4 > size) {
+        endpoint_->CopyToRemotePipelined(block, remote_to, size, size, 1);
+        continue;
+      }
+      TVMByteArray bytes{compressed.data(), compressed.size()};
+      TVMValue values[3];
+      int type_codes[3];
+      TVMArgsSetter setter(values, type_codes);
+      setter(0, remote_to);
+      setter(1, bytes);
+      setter(2, static_cast<int64_t>(size));
+      CallFunc(decompress, values, type_codes, 3, [](TVMArgs args) {});
+    }
+    remote_to->byte_offset = base_offset;
+  }
+
+  /*! \brief The default payload bytes of a copy packet, small enough to overlap the blocks. */
+  static constexpr uint64_t kDefaultTransferBlockBytes = uint64_t(4) << 20;
+  /*! \brief The default number of copy packets in flight. */
+  static constexpr int kDefaultPipelineWindow = 4;
+
   std::shared_ptr<RPCEndpoint> endpoint_;
   int64_t rpc_chunk_max_size_bytes_ = -1;
+  // Whether the server is a CRT server, known once rpc_chunk_max_size_bytes_ is.
+  bool crt_server_ = false;
+  int64_t transfer_block_bytes_ = 0;
+  int pipeline_window_ = 0;
+  int64_t cache_min_bytes_ = 0;
+  int64_t compress_min_bytes_ = 0;
+  std::unordered_map<std::string, PackedFuncHandle> server_funcs_;
 };
 
 std::shared_ptr<RPCSession> CreateClientSession(std::shared_ptr<RPCEndpoint> endpoint) {
   return std::make_shared<RPCClientSession>(endpoint);
 }
 
+TVM_REGISTER_GLOBAL("rpc.SessSetTransferOptions")
+    .set_body_typed([](Module sess, int64_t block_bytes, int window, int64_t cache_min_bytes,
+                       int64_t compress_min_bytes) {
+      auto* client = dynamic_cast<RPCClientSession*>(RPCModuleGetSession(sess).get());
+      ICHECK(client != nullptr) << "SetTransferOptions expects a remote RPC session";
+      client->SetTransferOptions(block_bytes, window, cache_min_bytes, compress_min_bytes);
+    });
+
 uint64_t RemoteCopyCalculatePacketOverheadSize(DLTensor* tensor, RPCCode code, uint64_t nbytes) {
   uint64_t shape_bytes = tensor->ndim * sizeof(int64_t);
   uint64_t to_data = reinterpret_cast<uint64_t>(static_cast<uint8_t*>(tensor->data));
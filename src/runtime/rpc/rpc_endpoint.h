@@ -162,6 +162,30 @@ class RPCEndpoint {
    * \param type_hint Hint of content data type.
    */
   void CopyFromRemote(DLTensor* from, void* to_bytes, uint64_t nbytes);
+  /*!
+   * \brief Copy bytes into remote array content as a pipeline of blocks.
+   *
+   * Up to \p window blocks are sent before the first one is acknowledged, and each payload
+   * is sent straight from \p from_bytes instead of through the ring buffer.
+   *
+   * \param from_bytes The source host data.
+   * \param to The target array, its byte_offset is where the first block goes.
+   * \param nbytes The size of the memory in bytes.
+   * \param block_size The payload bytes of each packet.
+   * \param window The number of packets in flight.
+   */
+  void CopyToRemotePipelined(void* from_bytes, DLTensor* to, uint64_t nbytes,
+                             uint64_t block_size, int window);
+  /*!
+   * \brief Copy bytes from remote array content as a pipeline of blocks.
+   * \param from The source array, its byte_offset is where the first block comes from.
+   * \param to_bytes The target host data.
+   * \param nbytes The size of the memory in bytes.
+   * \param block_size The payload bytes of each packet.
+   * \param window The number of requests in flight.
+   */
+  void CopyFromRemotePipelined(DLTensor* from, void* to_bytes, uint64_t nbytes,
+                               uint64_t block_size, int window);
 
   /*!
    * \brief Call a remote defined system function with arguments.
@@ -189,6 +213,8 @@ class RPCEndpoint {
   // Handle events until receives a return
   // Also flushes channels so that the function advances.
   RPCCode HandleUntilReturnEvent(bool client_mode, RPCSession::FEncodeReturn setreturn);
+  // Send what is in the writer, followed by payload bytes that bypass it.
+  void FlushWriterWithPayload(const void* payload, size_t size);
   // Initalization
   void Init();
   // Internal channel.
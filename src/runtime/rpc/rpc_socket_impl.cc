@@ -22,9 +22,22 @@
  * \brief Socket based RPC implementation.
  */
 #include <tvm/runtime/registry.h>
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include "../../support/ring_buffer.h"
 #include "../../support/socket.h"
 #include "rpc_endpoint.h"
 #include "rpc_local_session.h"
@@ -52,6 +65,21 @@ class SockChannel final : public RPCChannel {
     }
     return static_cast<size_t>(n);
   }
+#ifndef _WIN32
+  size_t SendGather(const void* head, size_t head_size, const void* body,
+                    size_t body_size) final {
+    iovec iov[2];
+    iov[0].iov_base = const_cast<void*>(head);
+    iov[0].iov_len = head_size;
+    iov[1].iov_base = const_cast<void*>(body);
+    iov[1].iov_len = body_size;
+    ssize_t n = writev(sock_.sockfd, iov, 2);
+    if (n == -1) {
+      support::Socket::Error("SockChannel::SendGather");
+    }
+    return static_cast<size_t>(n);
+  }
+#endif
   size_t Recv(void* data, size_t size) final {
     ssize_t n = sock_.Recv(data, size);
     if (n == -1) {
@@ -64,8 +92,16 @@ class SockChannel final : public RPCChannel {
   support::TCPSocket sock_;
 };
 
-std::shared_ptr<RPCEndpoint> RPCConnect(std::string url, int port, std::string key,
-                                        bool enable_logging, TVMArgs init_seq) {
+/*!
+ * \brief Connects to an RPC server and runs the handshake.
+ * \param url The url of the host.
+ * \param port The port to connect to.
+ * \param key The key to match the server.
+ * \param remote_key The key of the server.
+ * \return The connected socket.
+ */
+support::TCPSocket RPCConnectSocket(std::string url, int port, std::string key,
+                                    std::string* remote_key) {
   support::TCPSocket sock;
   support::SockAddr addr(url.c_str(), port);
   sock.Create(addr.ss_family());
@@ -91,11 +127,18 @@ std::shared_ptr<RPCEndpoint> RPCConnect(std::string url, int port, std::string k
     LOG(FATAL) << "URL " << url << ":" << port << " is not TVM RPC server";
   }
   ICHECK_EQ(sock.RecvAll(&keylen, sizeof(keylen)), sizeof(keylen));
-  std::string remote_key;
+  remote_key->clear();
   if (keylen != 0) {
-    remote_key.resize(keylen);
-    ICHECK_EQ(sock.RecvAll(&remote_key[0], keylen), keylen);
+    remote_key->resize(keylen);
+    ICHECK_EQ(sock.RecvAll(&(*remote_key)[0], keylen), keylen);
   }
+  return sock;
+}
+
+std::shared_ptr<RPCEndpoint> RPCConnect(std::string url, int port, std::string key,
+                                        bool enable_logging, TVMArgs init_seq) {
+  std::string remote_key;
+  support::TCPSocket sock = RPCConnectSocket(url, port, key, &remote_key);
 
   std::unique_ptr<RPCChannel> channel = std::make_unique<SockChannel>(sock);
   if (enable_logging) {
@@ -142,6 +185,395 @@ TVM_REGISTER_GLOBAL("rpc.ServerLoop").set_body([](TVMArgs args, TVMRetValue* rv)
   }
 });
 
+/*!
+ * \brief The header of a frame of a multiplexed connection.
+ *
+ * A multiplexed connection starts with the usual handshake, with "-mux" among the options of the
+ * client key. Every byte after it belongs to a frame that carries the bytes of one stream, so
+ * each stream is a channel of its own with an endpoint of its own on both sides, and the calls of
+ * the streams are in flight together.
+ */
+struct MuxFrameHeader {
+  /*! \brief The id of the stream, picked by the client. */
+  uint32_t stream;
+  /*! \brief The MuxFrameKind. */
+  uint32_t kind;
+  /*! \brief The size of the payload. */
+  uint64_t nbytes;
+};
+
+/*! \brief The largest payload of a frame, the bytes of a larger send are split into frames. */
+constexpr uint64_t kMuxMaxFrameBytes = 1 << 20;
+
+/*! \brief The number of threads serving the streams of a multiplexed connection on the server. */
+constexpr size_t kMuxServerWorkers = 32;
+
+enum MuxFrameKind : uint32_t {
+  /*! \brief Opens a stream, the payload is the key of the device its calls are queued on. */
+  kMuxOpen = 0,
+  /*! \brief The payload is the next bytes of the stream. */
+  kMuxData = 1,
+  /*! \brief Closes a stream. */
+  kMuxClose = 2,
+};
+
+/*!
+ * \brief One side of a multiplexed connection, holding the bytes received for each stream until
+ * its channel reads them.
+ */
+class MuxConnection {
+ public:
+  /*!
+   * \param sock The connected socket.
+   * \param self_pump Whether the channels read the frames off the socket themselves, the one
+   *   that waits first reading for the others, or a dedicated thread calls Pump.
+   */
+  MuxConnection(support::TCPSocket sock, bool self_pump) : sock_(sock), self_pump_(self_pump) {}
+
+  ~MuxConnection() {
+    try {
+      if (!sock_.BadSocket()) sock_.Close();
+    } catch (...) {
+    }
+  }
+
+  void SendFrame(uint32_t stream, MuxFrameKind kind, const void* data, size_t size) {
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    const char* bytes = static_cast<const char*>(data);
+    do {
+      size_t nbytes = std::min<size_t>(size, kMuxMaxFrameBytes);
+      MuxFrameHeader header{stream, kind, static_cast<uint64_t>(nbytes)};
+      ICHECK_EQ(sock_.SendAll(&header, sizeof(header)), sizeof(header));
+      if (nbytes != 0) {
+        ICHECK_EQ(sock_.SendAll(bytes, nbytes), nbytes);
+      }
+      bytes += nbytes;
+      size -= nbytes;
+    } while (size != 0);
+  }
+
+  /*!
+   * \brief Reads the next frame off the socket and keeps its bytes for its stream.
+   * \param open The header and payload of a kMuxOpen frame, set when that is what was read.
+   * \return false once the connection is closed.
+   */
+  bool Pump(MuxFrameHeader* open = nullptr, std::string* open_payload = nullptr) {
+    MuxFrameHeader header;
+    std::string payload;
+    bool ok = false;
+    try {
+      ok = sock_.RecvAll(&header, sizeof(header)) == sizeof(header);
+      if (ok && header.nbytes > kMuxMaxFrameBytes) {
+        // Not a peer of this protocol, the connection is dropped rather than the size allocated.
+        LOG(WARNING) << "RPC frame of " << header.nbytes << " bytes exceeds the limit of "
+                     << kMuxMaxFrameBytes << " bytes, closing the connection";
+        ok = false;
+      }
+      if (ok && header.nbytes != 0) {
+        payload.resize(header.nbytes);
+        ok = sock_.RecvAll(&payload[0], header.nbytes) == header.nbytes;
+      }
+    } catch (const Error& e) {
+      // A reset connection ends the streams like a closed one.
+      ok = false;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!ok) {
+      closed_ = true;
+      for (auto& kv : inboxes_) kv.second.closed = true;
+    } else if (header.kind == kMuxOpen) {
+      inboxes_[header.stream];
+      if (open != nullptr) {
+        *open = header;
+        *open_payload = std::move(payload);
+      }
+    } else {
+      auto it = inboxes_.find(header.stream);
+      // The bytes of a stream closed on this side are dropped.
+      if (it != inboxes_.end()) {
+        if (header.kind == kMuxData) {
+          it->second.bytes.Write(payload.data(), payload.size());
+        } else {
+          it->second.closed = true;
+        }
+      }
+    }
+    cv_.notify_all();
+    return ok;
+  }
+
+  /*! \brief Opens the inbox of a stream opened on this side. */
+  void OpenStream(uint32_t stream) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    inboxes_[stream];
+  }
+
+  /*! \brief Drops the inbox of \p stream and tells the other side. */
+  void CloseStream(uint32_t stream) {
+    bool closed;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      inboxes_.erase(stream);
+      closed = closed_;
+    }
+    if (!closed) {
+      try {
+        SendFrame(stream, kMuxClose, nullptr, 0);
+      } catch (const Error& e) {
+        // The connection is going away too.
+      }
+    }
+  }
+
+  /*! \brief The bytes received for \p stream and not read yet. */
+  size_t BytesAvailable(uint32_t stream) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = inboxes_.find(stream);
+    return it == inboxes_.end() ? 0 : it->second.bytes.bytes_available();
+  }
+
+  /*! \brief Reads at most \p size bytes of \p stream, waiting for one, 0 once it is closed. */
+  size_t Recv(uint32_t stream, void* data, size_t size) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      auto it = inboxes_.find(stream);
+      if (it == inboxes_.end()) return 0;
+      Inbox& inbox = it->second;
+      if (inbox.bytes.bytes_available() != 0) {
+        size_t n = std::min(size, inbox.bytes.bytes_available());
+        inbox.bytes.Read(data, n);
+        return n;
+      }
+      if (inbox.closed || closed_) return 0;
+      if (self_pump_ && !pumping_) {
+        pumping_ = true;
+        lock.unlock();
+        Pump();
+        lock.lock();
+        pumping_ = false;
+        cv_.notify_all();
+      } else {
+        cv_.wait(lock);
+      }
+    }
+  }
+
+ private:
+  struct Inbox {
+    support::RingBuffer bytes;
+    bool closed{false};
+  };
+
+  support::TCPSocket sock_;
+  bool self_pump_;
+  std::mutex send_mutex_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::unordered_map<uint32_t, Inbox> inboxes_;
+  bool closed_{false};
+  bool pumping_{false};
+};
+
+/*! \brief The channel of the client side of a stream. */
+class MuxClientChannel final : public RPCChannel {
+ public:
+  MuxClientChannel(std::shared_ptr<MuxConnection> conn, uint32_t stream)
+      : conn_(conn), stream_(stream) {}
+  ~MuxClientChannel() { conn_->CloseStream(stream_); }
+
+  size_t Send(const void* data, size_t size) final {
+    conn_->SendFrame(stream_, kMuxData, data, size);
+    return size;
+  }
+  size_t Recv(void* data, size_t size) final { return conn_->Recv(stream_, data, size); }
+
+ private:
+  std::shared_ptr<MuxConnection> conn_;
+  uint32_t stream_;
+};
+
+/*!
+ * \brief The queue of the streams that execute on one device of the server. The calls of these
+ * streams run one at a time, in the order their bytes arrived.
+ */
+class MuxDeviceQueue {
+ public:
+  void Acquire(uint32_t stream) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    waiters_.push_back(stream);
+    cv_.wait(lock, [&]() { return !busy_ && waiters_.front() == stream; });
+    waiters_.pop_front();
+    busy_ = true;
+  }
+
+  void Release() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      busy_ = false;
+    }
+    cv_.notify_all();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<uint32_t> waiters_;
+  bool busy_{false};
+};
+
+/*!
+ * \brief The channel of the server side of a stream. The stream holds its device from the first
+ * byte of a request until it waits for the next one, that is while the request executes.
+ */
+class MuxServerChannel final : public RPCChannel {
+ public:
+  MuxServerChannel(std::shared_ptr<MuxConnection> conn, uint32_t stream,
+                   std::shared_ptr<MuxDeviceQueue> queue)
+      : conn_(conn), stream_(stream), queue_(queue) {}
+  ~MuxServerChannel() {
+    if (holding_) queue_->Release();
+    conn_->CloseStream(stream_);
+  }
+
+  size_t Send(const void* data, size_t size) final {
+    conn_->SendFrame(stream_, kMuxData, data, size);
+    return size;
+  }
+  size_t Recv(void* data, size_t size) final {
+    if (holding_ && conn_->BytesAvailable(stream_) == 0) {
+      queue_->Release();
+      holding_ = false;
+    }
+    size_t n = conn_->Recv(stream_, data, size);
+    if (n != 0 && !holding_) {
+      queue_->Acquire(stream_);
+      holding_ = true;
+    }
+    return n;
+  }
+
+ private:
+  std::shared_ptr<MuxConnection> conn_;
+  uint32_t stream_;
+  std::shared_ptr<MuxDeviceQueue> queue_;
+  bool holding_{false};
+};
+
+/*!
+ * \brief The threads serving the streams of a multiplexed connection, at most kMuxServerWorkers.
+ * A thread runs the server loop of one stream at a time, until the stream is closed, so the
+ * streams opened while all the threads are busy wait for one in the order they were opened.
+ */
+class MuxServerWorkers {
+ public:
+  explicit MuxServerWorkers(std::shared_ptr<MuxConnection> conn) : conn_(conn) {}
+
+  ~MuxServerWorkers() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      done_ = true;
+    }
+    cv_.notify_all();
+    for (std::thread& worker : workers_) worker.join();
+  }
+
+  void Serve(uint32_t stream, std::shared_ptr<MuxDeviceQueue> queue) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_.emplace_back(stream, std::move(queue));
+      if (idle_ < pending_.size() && workers_.size() < kMuxServerWorkers) {
+        workers_.emplace_back([this]() { this->Run(); });
+      }
+    }
+    cv_.notify_one();
+  }
+
+ private:
+  void Run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      ++idle_;
+      cv_.wait(lock, [this]() { return done_ || !pending_.empty(); });
+      --idle_;
+      if (pending_.empty()) return;
+      auto [stream, queue] = std::move(pending_.front());
+      pending_.pop_front();
+      lock.unlock();
+      try {
+        auto channel = std::make_unique<MuxServerChannel>(conn_, stream, queue);
+        RPCEndpoint::Create(std::move(channel), "MuxServerLoop", "")->ServerLoop();
+      } catch (const Error& e) {
+        LOG(WARNING) << "RPC stream " << stream << " ended with an error: " << e.what();
+      }
+      lock.lock();
+    }
+  }
+
+  std::shared_ptr<MuxConnection> conn_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::pair<uint32_t, std::shared_ptr<MuxDeviceQueue>>> pending_;
+  std::vector<std::thread> workers_;
+  size_t idle_{0};
+  bool done_{false};
+};
+
+/*!
+ * \brief Serves a multiplexed connection, the server loop of the endpoint of each stream running
+ * on one of the MuxServerWorkers.
+ */
+void RPCMuxServerLoop(int sockfd) {
+  support::TCPSocket sock(static_cast<support::TCPSocket::SockType>(sockfd));
+  auto conn = std::make_shared<MuxConnection>(sock, false);
+  std::unordered_map<std::string, std::shared_ptr<MuxDeviceQueue>> queues;
+  MuxServerWorkers workers(conn);
+
+  MuxFrameHeader open;
+  std::string device_key;
+  open.kind = kMuxData;
+  while (conn->Pump(&open, &device_key)) {
+    if (open.kind != kMuxOpen) continue;
+    std::shared_ptr<MuxDeviceQueue>& queue = queues[device_key];
+    if (queue == nullptr) queue = std::make_shared<MuxDeviceQueue>();
+    workers.Serve(open.stream, queue);
+    open.kind = kMuxData;
+  }
+}
+
+/*!
+ * \brief Connects to an RPC server with a multiplexed connection.
+ * \return A function that takes a device key and the arguments of InitRemoteSession and returns
+ *   the session of a new stream. Calls of sessions with the same device key execute one at a time
+ *   on the server.
+ */
+PackedFunc RPCMuxClientConnect(std::string url, int port, std::string key, bool enable_logging) {
+  std::string remote_key;
+  support::TCPSocket sock = RPCConnectSocket(url, port, "client:" + key, &remote_key);
+  auto conn = std::make_shared<MuxConnection>(sock, true);
+  auto next_stream = std::make_shared<std::atomic<uint32_t>>(0);
+  auto fopen = [conn, next_stream, key, remote_key, enable_logging](TVMArgs args,
+                                                                    TVMRetValue* rv) {
+    std::string device_key = args[0];
+    uint32_t stream = (*next_stream)++;
+    conn->OpenStream(stream);
+    conn->SendFrame(stream, kMuxOpen, device_key.data(), device_key.size());
+
+    std::unique_ptr<RPCChannel> channel = std::make_unique<MuxClientChannel>(conn, stream);
+    if (enable_logging) {
+      channel.reset(new RPCChannelLogging(std::move(channel)));
+    }
+    auto endpt = RPCEndpoint::Create(std::move(channel),
+                                     "client:" + key + "#" + std::to_string(stream), remote_key);
+    endpt->InitRemoteSession(TVMArgs(args.values + 1, args.type_codes + 1, args.size() - 1));
+    *rv = CreateRPCSessionModule(CreateClientSession(endpt));
+  };
+  return PackedFunc(fopen);
+}
+
+TVM_REGISTER_GLOBAL("rpc.ConnectMux").set_body_typed(RPCMuxClientConnect);
+
+TVM_REGISTER_GLOBAL("rpc.MuxServerLoop").set_body_typed(RPCMuxServerLoop);
+
 class SimpleSockHandler : public dmlc::Stream {
   // Things that will interface with user directly.
  public:
@@ -0,0 +1,288 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file rpc_transfer.cc
+ * \brief The content digest, the zero-run codec and the server tensor cache of RPC transfers.
+ */
+#include "rpc_transfer.h"
+
+#include <tvm/runtime/device_api.h>
+#include <tvm/runtime/logging.h>
+#include <tvm/runtime/registry.h>
+
+#include <cstring>
+#include <list>
+#include <map>
+#include <mutex>
+
+namespace tvm {
+namespace runtime {
+
+namespace {
+
+/*! \brief Zero runs shorter than this stay in the literal, where they cost no record. */
+constexpr size_t kMinZeroRun = 16;
+
+inline uint64_t RotateLeft(uint64_t x, int bits) { return (x << bits) | (x >> (64 - bits)); }
+
+void PutVarint(std::string* out, uint64_t value) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+uint64_t GetVarint(const uint8_t** begin, const uint8_t* end) {
+  uint64_t value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    ICHECK(*begin < end) << "RPCDecompressZeroRuns: truncated record";
+    uint8_t byte = *(*begin)++;
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) return value;
+  }
+  LOG(FATAL) << "RPCDecompressZeroRuns: malformed varint";
+  return 0;
+}
+
+/*!
+ * \brief Copies \p nbytes between host memory and the content of \p tensor, starting at its
+ * byte_offset, and waits for the copy.
+ */
+void CopyTensorBytes(void* host, DLTensor* tensor, uint64_t nbytes, bool to_tensor) {
+  int64_t shape = static_cast<int64_t>(nbytes);
+  DLTensor host_tensor;
+  host_tensor.data = host;
+  host_tensor.device = Device{kDLCPU, 0};
+  host_tensor.ndim = 1;
+  host_tensor.dtype = DLDataType{kDLUInt, 8, 1};
+  host_tensor.shape = &shape;
+  host_tensor.strides = nullptr;
+  host_tensor.byte_offset = 0;
+  DLTensor device_tensor = host_tensor;
+  device_tensor.data = tensor->data;
+  device_tensor.device = tensor->device;
+  device_tensor.byte_offset = tensor->byte_offset;
+
+  DeviceAPI* api = DeviceAPI::Get(tensor->device);
+  if (to_tensor) {
+    api->CopyDataFromTo(&host_tensor, &device_tensor, nullptr);
+  } else {
+    api->CopyDataFromTo(&device_tensor, &host_tensor, nullptr);
+  }
+  api->StreamSync(tensor->device, nullptr);
+}
+
+/*!
+ * \brief The host copies of the tensors uploaded to this server, keyed by content digest and
+ * evicted least recently used first.
+ *
+ * The cache lives in the process serving the session. The RPC server forks a process per
+ * connection, so the cache only spans the uploads of one session, e.g. the runs of the candidates
+ * of a measurement batch sharing their inputs, and is dropped when the session closes.
+ */
+class RPCTensorCache {
+ public:
+  static RPCTensorCache* Global() {
+    static RPCTensorCache* inst = new RPCTensorCache();
+    return inst;
+  }
+
+  bool Fetch(const RPCTensorDigest& digest, DLTensor* to, uint64_t nbytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = entries_.find(digest);
+    if (it == entries_.end() || it->second.bytes.size() != nbytes) {
+      ++num_misses_;
+      return false;
+    }
+    ++num_hits_;
+    lru_.splice(lru_.begin(), lru_, it->second.lru_pos);
+    CopyTensorBytes(&it->second.bytes[0], to, nbytes, true);
+    return true;
+  }
+
+  bool Store(const RPCTensorDigest& digest, DLTensor* from, uint64_t nbytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (nbytes == 0 || nbytes > capacity_ || entries_.count(digest)) return false;
+    while (bytes_ + nbytes > capacity_) Evict();
+    Entry& entry = entries_[digest];
+    entry.bytes.resize(nbytes);
+    CopyTensorBytes(&entry.bytes[0], from, nbytes, false);
+    entry.lru_pos = lru_.insert(lru_.begin(), digest);
+    bytes_ += nbytes;
+    return true;
+  }
+
+  void Clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    lru_.clear();
+    bytes_ = 0;
+    num_hits_ = 0;
+    num_misses_ = 0;
+  }
+
+  /*! \brief The value of the stat named "hits", "misses" or "bytes". */
+  int64_t GetStat(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (name == "hits") return static_cast<int64_t>(num_hits_);
+    if (name == "misses") return static_cast<int64_t>(num_misses_);
+    ICHECK_EQ(name, "bytes") << "Unknown tensor cache stat " << name;
+    return static_cast<int64_t>(bytes_);
+  }
+
+  void SetCapacity(uint64_t capacity) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    capacity_ = capacity;
+    while (bytes_ > capacity_) Evict();
+  }
+
+ private:
+  struct Entry {
+    std::string bytes;
+    std::list<RPCTensorDigest>::iterator lru_pos;
+  };
+
+  void Evict() {
+    ICHECK(!lru_.empty());
+    auto it = entries_.find(lru_.back());
+    bytes_ -= it->second.bytes.size();
+    entries_.erase(it);
+    lru_.pop_back();
+  }
+
+  std::mutex mutex_;
+  std::map<RPCTensorDigest, Entry> entries_;
+  std::list<RPCTensorDigest> lru_;
+  uint64_t bytes_{0};
+  uint64_t capacity_{uint64_t(1) << 30};
+  uint64_t num_hits_{0};
+  uint64_t num_misses_{0};
+};
+
+}  // namespace
+
+RPCTensorDigest RPCContentDigest(const void* data, size_t size) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  uint64_t h0 = 0xcbf29ce484222325ULL ^ size;
+  uint64_t h1 = 0x9e3779b97f4a7c15ULL + size;
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, bytes + i, sizeof(word));
+    h0 = (h0 ^ word) * 0x100000001b3ULL;
+    h1 = RotateLeft(h1 + word * 0xc2b2ae3d27d4eb4fULL, 31) * 0x9e3779b185ebca87ULL;
+  }
+  for (; i < size; ++i) {
+    h0 = (h0 ^ bytes[i]) * 0x100000001b3ULL;
+    h1 = RotateLeft(h1 + bytes[i] * 0xc2b2ae3d27d4eb4fULL, 31) * 0x9e3779b185ebca87ULL;
+  }
+  h1 ^= h1 >> 33;
+  h1 *= 0xff51afd7ed558ccdULL;
+  h1 ^= h1 >> 33;
+  return {h0, h1};
+}
+
+std::string RPCCompressZeroRuns(const void* data, size_t size) {
+  const char* bytes = static_cast<const char*>(data);
+  std::string out;
+  size_t literal_begin = 0;
+  size_t i = 0;
+  while (i < size) {
+    if (bytes[i] != 0) {
+      ++i;
+      continue;
+    }
+    size_t run_end = i;
+    while (run_end < size && bytes[run_end] == 0) ++run_end;
+    if (run_end - i >= kMinZeroRun || run_end == size) {
+      PutVarint(&out, i - literal_begin);
+      out.append(bytes + literal_begin, i - literal_begin);
+      PutVarint(&out, run_end - i);
+      literal_begin = run_end;
+    }
+    i = run_end;
+  }
+  if (literal_begin < size) {
+    PutVarint(&out, size - literal_begin);
+    out.append(bytes + literal_begin, size - literal_begin);
+    PutVarint(&out, 0);
+  }
+  return out;
+}
+
+void RPCDecompressZeroRuns(const void* data, size_t size, void* out, size_t out_size) {
+  const uint8_t* begin = static_cast<const uint8_t*>(data);
+  const uint8_t* end = begin + size;
+  char* dst = static_cast<char*>(out);
+  size_t written = 0;
+  while (begin < end) {
+    uint64_t literal = GetVarint(&begin, end);
+    ICHECK_LE(literal, static_cast<uint64_t>(end - begin)) << "RPCDecompressZeroRuns: truncated";
+    ICHECK_LE(written + literal, out_size) << "RPCDecompressZeroRuns: output overflow";
+    std::memcpy(dst + written, begin, literal);
+    begin += literal;
+    written += literal;
+    uint64_t zeros = GetVarint(&begin, end);
+    ICHECK_LE(written + zeros, out_size) << "RPCDecompressZeroRuns: output overflow";
+    std::memset(dst + written, 0, zeros);
+    written += zeros;
+  }
+  ICHECK_EQ(written, out_size) << "RPCDecompressZeroRuns: size mismatch";
+}
+
+TVM_REGISTER_GLOBAL("tvm.rpc.server.TensorCacheFetch")
+    .set_body_typed([](DLTensor* to, int64_t digest0, int64_t digest1, int64_t nbytes) {
+      RPCTensorDigest digest(static_cast<uint64_t>(digest0), static_cast<uint64_t>(digest1));
+      return RPCTensorCache::Global()->Fetch(digest, to, static_cast<uint64_t>(nbytes));
+    });
+
+TVM_REGISTER_GLOBAL("tvm.rpc.server.TensorCacheStore")
+    .set_body_typed([](DLTensor* from, int64_t digest0, int64_t digest1, int64_t nbytes) {
+      RPCTensorDigest digest(static_cast<uint64_t>(digest0), static_cast<uint64_t>(digest1));
+      return RPCTensorCache::Global()->Store(digest, from, static_cast<uint64_t>(nbytes));
+    });
+
+TVM_REGISTER_GLOBAL("tvm.rpc.server.TensorCacheClear").set_body_typed([]() {
+  RPCTensorCache::Global()->Clear();
+});
+
+TVM_REGISTER_GLOBAL("tvm.rpc.server.TensorCacheStat").set_body_typed([](std::string name) {
+  return RPCTensorCache::Global()->GetStat(name);
+});
+
+TVM_REGISTER_GLOBAL("tvm.rpc.server.TensorCacheSetCapacity").set_body_typed([](int64_t nbytes) {
+  ICHECK_GE(nbytes, 0);
+  RPCTensorCache::Global()->SetCapacity(static_cast<uint64_t>(nbytes));
+});
+
+TVM_REGISTER_GLOBAL("tvm.rpc.server.CopyToRemoteCompressed")
+    .set_body([](TVMArgs args, TVMRetValue* rv) {
+      DLTensor* to = args[0];
+      TVMByteArray compressed = args[1];
+      uint64_t nbytes = static_cast<uint64_t>(args[2].operator int64_t());
+      std::string bytes(nbytes, '\0');
+      RPCDecompressZeroRuns(compressed.data, compressed.size, &bytes[0], nbytes);
+      CopyTensorBytes(&bytes[0], to, nbytes, true);
+      *rv = true;
+    });
+
+}  // namespace runtime
+}  // namespace tvm
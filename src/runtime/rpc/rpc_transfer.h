@@ -0,0 +1,83 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file rpc_transfer.h
+ * \brief Helpers of the bulk tensor transfers between RPC endpoints.
+ *
+ * The server side of these transfers are the global functions registered in rpc_transfer.cc:
+ *
+ * - "tvm.rpc.server.TensorCacheFetch"(to, digest0, digest1, nbytes) copies a cached content
+ *   into \p to and returns whether the digest was cached.
+ * - "tvm.rpc.server.TensorCacheStore"(from, digest0, digest1, nbytes) caches the content of
+ *   \p from under the digest.
+ * - "tvm.rpc.server.TensorCacheStat"(name) returns the "hits", "misses" or "bytes" of the cache.
+ * - "tvm.rpc.server.CopyToRemoteCompressed"(to, bytes, nbytes) decompresses \p bytes into \p to.
+ *
+ * A client detects them with GetFunction and falls back to the plain copies when they are absent,
+ * as they are on the minrpc servers. The tensor cache is per session, it lives in the process the
+ * server forks for the connection.
+ */
+#ifndef TVM_RUNTIME_RPC_RPC_TRANSFER_H_
+#define TVM_RUNTIME_RPC_RPC_TRANSFER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+namespace tvm {
+namespace runtime {
+
+/*! \brief The 128-bit content digest the remote tensor cache is keyed by. */
+using RPCTensorDigest = std::pair<uint64_t, uint64_t>;
+
+/*!
+ * \brief Computes the digest of \p size bytes of content.
+ * \param data The content.
+ * \param size The size of the content in bytes.
+ * \return Two independent 64-bit hashes of the content and its size.
+ */
+RPCTensorDigest RPCContentDigest(const void* data, size_t size);
+
+/*!
+ * \brief Compresses the runs of zero bytes of \p data.
+ *
+ * The result is a sequence of records, each a varint literal length, the literal bytes and a
+ * varint zero-run length. Padded, masked and freshly initialized tensors shrink well, random
+ * payloads grow by a few bytes.
+ *
+ * \param data The content.
+ * \param size The size of the content in bytes.
+ * \return The compressed bytes.
+ */
+std::string RPCCompressZeroRuns(const void* data, size_t size);
+
+/*!
+ * \brief Decompresses the output of RPCCompressZeroRuns.
+ * \param data The compressed bytes.
+ * \param size The number of compressed bytes.
+ * \param out The decompressed content.
+ * \param out_size The size of the content, checked against the records.
+ */
+void RPCDecompressZeroRuns(const void* data, size_t size, void* out, size_t out_size);
+
+}  // namespace runtime
+}  // namespace tvm
+#endif  // TVM_RUNTIME_RPC_RPC_TRANSFER_H_
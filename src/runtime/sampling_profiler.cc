@@ -0,0 +1,218 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file src/runtime/sampling_profiler.cc
+ * \brief An always-on profiler of the operator calls of sampled requests.
+ */
+#include "sampling_profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <sstream>
+#include <utility>
+
+namespace tvm {
+namespace runtime {
+namespace profiling {
+
+namespace {
+
+/*! \brief The upper bounds of the histogram buckets, in seconds. */
+constexpr double kBucketBounds[] = {1e-6, 5e-6, 1e-5, 5e-5, 1e-4, 5e-4, 1e-3,
+                                    5e-3, 1e-2, 5e-2, 1e-1, 5e-1, 1.0};
+constexpr size_t kNumBuckets = sizeof(kBucketBounds) / sizeof(kBucketBounds[0]);
+
+/*! \brief Escapes \p str as the contents of a JSON or Prometheus label string. */
+std::string Escape(const std::string& str) {
+  std::string out;
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      out.push_back('\\');
+      out.push_back(c);
+    } else if (c == '\n') {
+      out += "\\n";
+    } else {
+      out.push_back(c);
+    }
+  }
+  return out;
+}
+
+int64_t NowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
+SamplingProfiler::SamplingProfiler(int sample_every, int64_t capacity)
+    : sample_every_(sample_every), capacity_(capacity) {
+  ICHECK_GT(sample_every, 0) << "SamplingProfiler: sample_every must be positive";
+  ICHECK_GT(capacity, 0) << "SamplingProfiler: capacity must be positive";
+}
+
+bool SamplingProfiler::StartRequest() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (in_request_) {
+    // The last sampled request threw before it was stopped.
+    in_request_ = false;
+    ++num_sampled_;
+  }
+  if (num_requests_++ % sample_every_ != 0) return false;
+  // The timers of the last sampled request have had all the requests since to complete.
+  Harvest();
+  in_request_ = true;
+  request_start_us_ = NowMicros();
+  return true;
+}
+
+void SamplingProfiler::StopRequest() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ICHECK(in_request_);
+  in_request_ = false;
+  ++num_sampled_;
+}
+
+void SamplingProfiler::StartCall(const String& name, Device dev) {
+  Timer timer = Timer::Start(dev);
+  std::lock_guard<std::mutex> lock(mutex_);
+  ICHECK(in_request_) << "SamplingProfiler: StartCall outside of a sampled request";
+  pending_.push_back({num_sampled_, request_start_us_, InternName(name), dev, timer});
+}
+
+void SamplingProfiler::StopCall() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ICHECK(!pending_.empty() && pending_.back().request == num_sampled_)
+      << "SamplingProfiler: StopCall without StartCall";
+  pending_.back().timer->Stop();
+}
+
+void SamplingProfiler::Harvest() {
+  const size_t record_bytes = sizeof(Record);
+  size_t kept = 0;
+  for (size_t i = 0; i < pending_.size(); ++i) {
+    PendingCall& call = pending_[i];
+    if (in_request_ && call.request == num_sampled_) {
+      pending_[kept++] = std::move(call);
+      continue;
+    }
+    Record record;
+    record.request = call.request;
+    record.request_start_us = call.request_start_us;
+    record.duration_ns = call.timer->SyncAndGetElapsedNanos();
+    record.name = call.name;
+    record.device_type = static_cast<int32_t>(call.dev.device_type);
+    record.device_id = call.dev.device_id;
+
+    while (records_.bytes_available() + record_bytes >
+           static_cast<size_t>(capacity_) * record_bytes) {
+      Record dropped;
+      records_.Read(&dropped, record_bytes);
+      ++num_dropped_;
+    }
+    records_.Write(&record, record_bytes);
+
+    double seconds = static_cast<double>(record.duration_ns) * 1e-9;
+    Histogram& hist = histograms_[record.name];
+    size_t bucket = std::lower_bound(kBucketBounds, kBucketBounds + kNumBuckets, seconds) -
+                    kBucketBounds;
+    ++hist.counts[bucket];
+    ++hist.count;
+    hist.sum_seconds += seconds;
+  }
+  pending_.resize(kept);
+}
+
+int32_t SamplingProfiler::InternName(const String& name) {
+  auto it = name_ids_.find(name);
+  if (it != name_ids_.end()) return it->second;
+  int32_t id = static_cast<int32_t>(names_.size());
+  names_.push_back(name);
+  name_ids_.emplace(name, id);
+  Histogram hist;
+  hist.counts.assign(kNumBuckets + 1, 0);
+  histograms_.push_back(std::move(hist));
+  return id;
+}
+
+std::string SamplingProfiler::AsChromeTrace() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Harvest();
+  std::ostringstream os;
+  os << "{\"traceEvents\":[";
+  // The end of the last call of a request on each device.
+  std::map<std::pair<int64_t, std::pair<int32_t, int32_t>>, double> device_end_us;
+  bool first = true;
+  while (records_.bytes_available() != 0) {
+    Record record;
+    records_.Read(&record, sizeof(Record));
+    auto key = std::make_pair(record.request, std::make_pair(record.device_type, record.device_id));
+    auto it = device_end_us.find(key);
+    double ts = it == device_end_us.end() ? static_cast<double>(record.request_start_us)
+                                          : it->second;
+    double dur = static_cast<double>(record.duration_ns) * 1e-3;
+    device_end_us[key] = ts + dur;
+    if (!first) os << ",";
+    first = false;
+    os << "{\"name\":\"" << Escape(names_[record.name]) << "\",\"ph\":\"X\",\"ts\":" << std::fixed
+       << ts << ",\"dur\":" << dur << ",\"pid\":\""
+       << DLDeviceType2Str(record.device_type) << record.device_id
+       << "\",\"tid\":0,\"args\":{\"request\":" << record.request << "}}";
+  }
+  os << "],\"otherData\":{\"sample_every\":" << sample_every_ << ",\"sampled\":" << num_sampled_
+     << ",\"dropped\":" << num_dropped_ << "}}";
+  num_dropped_ = 0;
+  return os.str();
+}
+
+std::string SamplingProfiler::AsPrometheus() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Harvest();
+  std::ostringstream os;
+  os << "# HELP tvm_requests_total Requests run, sampled or not.\n"
+     << "# TYPE tvm_requests_total counter\n"
+     << "tvm_requests_total " << num_requests_ << "\n"
+     << "# HELP tvm_sampled_requests_total Requests whose calls were profiled.\n"
+     << "# TYPE tvm_sampled_requests_total counter\n"
+     << "tvm_sampled_requests_total " << num_sampled_ << "\n"
+     << "# HELP tvm_call_duration_seconds Duration of the calls of the sampled requests.\n"
+     << "# TYPE tvm_call_duration_seconds histogram\n";
+  for (size_t i = 0; i < names_.size(); ++i) {
+    const Histogram& hist = histograms_[i];
+    if (hist.count == 0) continue;
+    std::string label = "call=\"" + Escape(names_[i]) + "\"";
+    int64_t cumulative = 0;
+    for (size_t b = 0; b < kNumBuckets; ++b) {
+      cumulative += hist.counts[b];
+      os << "tvm_call_duration_seconds_bucket{" << label << ",le=\"" << kBucketBounds[b]
+         << "\"} " << cumulative << "\n";
+    }
+    os << "tvm_call_duration_seconds_bucket{" << label << ",le=\"+Inf\"} " << hist.count << "\n"
+       << "tvm_call_duration_seconds_sum{" << label << "} " << hist.sum_seconds << "\n"
+       << "tvm_call_duration_seconds_count{" << label << "} " << hist.count << "\n";
+  }
+  return os.str();
+}
+
+}  // namespace profiling
+}  // namespace runtime
+}  // namespace tvm
@@ -0,0 +1,156 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file src/runtime/sampling_profiler.h
+ * \brief An always-on profiler of the operator calls of sampled requests.
+ */
+#ifndef TVM_RUNTIME_SAMPLING_PROFILER_H_
+#define TVM_RUNTIME_SAMPLING_PROFILER_H_
+
+#include <tvm/runtime/container/string.h>
+#include <tvm/runtime/profiling.h>
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../support/ring_buffer.h"
+
+namespace tvm {
+namespace runtime {
+namespace profiling {
+
+/*!
+ * \brief Profiles the calls of one request in every N, without synchronizing the devices.
+ *
+ * Unlike Profiler, which the debug executors use, the calls are timed with the asynchronous
+ * device timers (event pairs on CUDA) and nothing waits for them while the request runs. The
+ * timers of a sampled request are harvested when the next sampled request starts, or when a
+ * report is exported, by which time the device has long finished them.
+ *
+ * The harvested calls are appended to a bounded ring buffer, dropping the oldest ones when it is
+ * full, which AsChromeTrace drains. They are also counted in per-call histograms of their
+ * durations, which AsPrometheus reports and which are never reset.
+ *
+ * Example usage:
+ * \code{.cpp}
+ * SamplingProfiler prof(100, 1 << 16);
+ * if (prof.StartRequest()) {
+ *   prof.StartCall("my_gpu_kernel", gpu);
+ *   my_gpu_kernel();
+ *   prof.StopCall();
+ *   prof.StopRequest();
+ * } else {
+ *   my_gpu_kernel();
+ * }
+ * \endcode
+ */
+class SamplingProfiler {
+ public:
+  /*!
+   * \param sample_every Profile one request in this many.
+   * \param capacity The number of calls the ring buffer holds.
+   */
+  SamplingProfiler(int sample_every, int64_t capacity);
+
+  /*!
+   * \brief Starts a request.
+   * \return Whether the request is sampled, in which case its calls should be timed with
+   *   StartCall and StopCall and it should end with StopRequest.
+   */
+  bool StartRequest();
+  /*! \brief Ends a sampled request. */
+  void StopRequest();
+  /*!
+   * \brief Starts timing a call of a sampled request. The calls of a request do not nest.
+   * \param name The name of the call.
+   * \param dev The device the call runs on.
+   */
+  void StartCall(const String& name, Device dev);
+  /*! \brief Stops timing the last call. */
+  void StopCall();
+
+  /*!
+   * \brief Drains the calls of the ring buffer as a Chrome trace.
+   *
+   * Each device is a process of the trace. The calls of a request are laid out back to back from
+   * the host time at which the request started, as the device ran them.
+   *
+   * \return The trace, in the JSON format read by chrome://tracing and Perfetto.
+   */
+  std::string AsChromeTrace();
+  /*!
+   * \brief Reports the durations of the calls as Prometheus histograms.
+   * \return The histograms, in the Prometheus text exposition format.
+   */
+  std::string AsPrometheus();
+
+ private:
+  /*! \brief A timed call whose timer is not harvested yet. */
+  struct PendingCall {
+    int64_t request;
+    int64_t request_start_us;
+    int32_t name;
+    Device dev;
+    Timer timer;
+  };
+  /*! \brief A harvested call, as stored in the ring buffer. */
+  struct Record {
+    int64_t request;
+    int64_t request_start_us;
+    int64_t duration_ns;
+    int32_t name;
+    int32_t device_type;
+    int32_t device_id;
+  };
+  /*! \brief The histogram of the durations of the calls of one name. */
+  struct Histogram {
+    std::vector<int64_t> counts;
+    int64_t count{0};
+    double sum_seconds{0};
+  };
+
+  /*! \brief Harvests the pending calls. Needs mutex_. */
+  void Harvest();
+  /*! \brief Returns the id of \p name. Needs mutex_. */
+  int32_t InternName(const String& name);
+
+  int sample_every_;
+  int64_t capacity_;
+  int64_t num_requests_{0};
+  int64_t num_sampled_{0};
+  int64_t num_dropped_{0};
+  bool in_request_{false};
+  int64_t request_start_us_{0};
+
+  std::mutex mutex_;
+  std::vector<PendingCall> pending_;
+  support::RingBuffer records_;
+  std::vector<std::string> names_;
+  std::unordered_map<std::string, int32_t> name_ids_;
+  std::vector<Histogram> histograms_;
+};
+
+}  // namespace profiling
+}  // namespace runtime
+}  // namespace tvm
+#endif  // TVM_RUNTIME_SAMPLING_PROFILER_H_
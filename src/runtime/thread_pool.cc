@@ -32,10 +32,18 @@
 #if TVM_THREADPOOL_USE_OPENMP
 #include <omp.h>
 #endif
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 #include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <climits>
 #include <condition_variable>
 #include <cstring>
+#include <deque>
 #include <memory>
 #include <mutex>
 #include <sstream>
@@ -52,6 +60,18 @@ namespace {
 using support::IsNumber;
 constexpr uint32_t kDefaultSpinCount = 300000;
 
+// The number of tasks per worker of the work stealing launches, 0 for the static partition
+int GetWorkStealingChunks() {
+  const char* val = getenv("TVM_THREAD_POOL_WORK_STEALING");
+  return val ? std::max(atoi(val), 0) : 0;
+}
+
+// Whether the parallel launches of all the threads share one arena of workers
+bool GetSharedArena() {
+  const char* val = getenv("TVM_THREAD_POOL_SHARED_ARENA");
+  return val && atoi(val) != 0;
+}
+
 uint32_t GetSpinCount() {
   const char* val = getenv("TVM_THREAD_POOL_SPIN_COUNT");
   if (!val) {
@@ -94,6 +114,39 @@ class ParallelLauncher {
       this->env.sync_handle = nullptr;
     }
   }
+  // Reset the task request of a work stealing launch: the num_task tasks are split into one
+  // contiguous range per worker, each worker runs its range from the front and then steals the
+  // remaining tasks of the others from the back. No barrier is available.
+  void InitWorkStealing(FTVMParallelLambda flambda, void* cdata, int num_workers, int num_task) {
+    Init(flambda, cdata, num_task, false);
+    num_pending_.store(num_workers);
+    if (static_cast<size_t>(num_workers) > num_ranges_) {
+      ranges_.reset(new TaskRange[num_workers]);
+      num_ranges_ = num_workers;
+    }
+    num_workers_ = num_workers;
+    for (int i = 0; i < num_workers; ++i) {
+      uint64_t begin = static_cast<int64_t>(num_task) * i / num_workers;
+      uint64_t end = static_cast<int64_t>(num_task) * (i + 1) / num_workers;
+      ranges_[i].range.store(begin << 32 | end, std::memory_order_relaxed);
+    }
+    work_stealing = true;
+  }
+  // Run the tasks of a work stealing launch from the range of the worker, then the ones left in
+  // the ranges of the others, and signal the worker finished.
+  void RunWorkStealing(int worker_id) {
+    for (int k = 0; k < num_workers_; ++k) {
+      TaskRange& range = ranges_[(worker_id + k) % num_workers_];
+      // the ranges only shrink, the one of a victim is empty for good once left
+      for (int task_id; (task_id = range.Take(k != 0)) >= 0;) {
+        if ((*flambda)(task_id, &env, cdata) != 0) {
+          SignalJobError(task_id);
+          return;
+        }
+      }
+    }
+    SignalJobFinish();
+  }
   ~ParallelLauncher() { delete[] sync_counter_; }
   // Wait n jobs to finish
   int WaitForJobs() {
@@ -130,8 +183,26 @@ class ParallelLauncher {
   // Whether this thread is worker of the pool.
   // used to prevent recursive launch.
   bool is_worker{false};
+  // Whether the tasks are run by the work stealing workers, see InitWorkStealing
+  bool work_stealing{false};
 
  private:
+  /*! \brief The tasks [begin, end) left to a worker, packed in one word updated by CAS */
+  struct alignas(kL1CacheBytes) TaskRange {
+    std::atomic<uint64_t> range{0};
+    // Take the first task of the range (the owner) or the last one (a thief), -1 if empty
+    int Take(bool steal) {
+      uint64_t value = range.load(std::memory_order_acquire);
+      while (true) {
+        uint64_t begin = value >> 32, end = value & 0xFFFFFFFFu;
+        if (begin >= end) return -1;
+        uint64_t next = steal ? (begin << 32 | (end - 1)) : ((begin + 1) << 32 | end);
+        if (range.compare_exchange_weak(value, next, std::memory_order_acq_rel)) {
+          return static_cast<int>(steal ? end - 1 : begin);
+        }
+      }
+    }
+  };
   // The pending jobs.
   std::atomic<int32_t> num_pending_;
   // Whether error has been countered.
@@ -140,6 +211,71 @@ class ParallelLauncher {
   std::atomic<int32_t>* sync_counter_{nullptr};
   // The error message
   std::vector<std::string> par_errors_;
+  // The task ranges of the workers of a work stealing launch
+  std::unique_ptr<TaskRange[]> ranges_;
+  size_t num_ranges_{0};
+  int num_workers_{0};
+};
+
+/*!
+ * \brief Where the idle workers of a pool park, woken all at once by one futex wake per launch.
+ *  The workers spin before parking for about twice the usual gap between the launches of the
+ *  pool, learnt by the pool, and park right away when the launches are too far apart.
+ */
+class ParkingLot {
+ public:
+  // Park until the next WakeAll unless ready() holds
+  template <typename FReady>
+  void Park(FReady ready) {
+    while (true) {
+      int32_t epoch = epoch_.load();
+      if (ready()) return;
+      parked_.fetch_add(1);
+#if defined(__linux__)
+      syscall(SYS_futex, reinterpret_cast<int32_t*>(&epoch_), FUTEX_WAIT_PRIVATE, epoch, nullptr,
+              nullptr, 0);
+#else
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [&] { return epoch_.load() != epoch; });
+      }
+#endif
+      parked_.fetch_sub(1);
+    }
+  }
+  // Wake all the parked workers, a single system call whatever their number
+  void WakeAll() {
+    epoch_.fetch_add(1);
+    if (parked_.load() == 0) return;
+#if defined(__linux__)
+    syscall(SYS_futex, reinterpret_cast<int32_t*>(&epoch_), FUTEX_WAKE_PRIVATE, INT_MAX, nullptr,
+            nullptr, 0);
+#else
+    std::lock_guard<std::mutex> lock(mutex_);
+    cv_.notify_all();
+#endif
+  }
+  // Learn the gap between the end of a launch and the start of the next one
+  void RecordGap(int64_t gap_ns) {
+    gap_ns_ = gap_ns_ < 0 ? gap_ns : (3 * gap_ns_ + gap_ns) / 4;
+    spin_ns_.store(2 * gap_ns_ <= kMaxSpinNs ? 2 * gap_ns_ : 0, std::memory_order_relaxed);
+  }
+  // How long the idle workers spin before parking
+  int64_t SpinNs() const { return spin_ns_.load(std::memory_order_relaxed); }
+
+ private:
+  // the workers do not spin when the launches are more than 1ms apart
+  static constexpr int64_t kMaxSpinNs = 1000000;
+  // incremented by each WakeAll, the futex word
+  std::atomic<int32_t> epoch_{0};
+  std::atomic<int32_t> parked_{0};
+  std::atomic<int64_t> spin_ns_{kMaxSpinNs};
+  // the moving average of the gaps, written by the thread launching on the pool
+  int64_t gap_ns_{-1};
+#if !defined(__linux__)
+  std::mutex mutex_;
+  std::condition_variable cv_;
+#endif
 };
 
 /*! \brief Lock-free single-producer-single-consumer queue for each thread */
@@ -151,40 +287,42 @@ class SpscTaskQueue {
     int32_t task_id;
   };
 
-  SpscTaskQueue() : buffer_(new Task[kRingSize]), head_(0), tail_(0) {}
+  explicit SpscTaskQueue(ParkingLot* lot)
+      : buffer_(new Task[kRingSize]), head_(0), tail_(0), lot_(lot) {}
 
   ~SpscTaskQueue() { delete[] buffer_; }
 
   /*!
-   * \brief Push a task into the queue and notify the comsumer if it is on wait.
+   * \brief Push a task into the queue, the parked consumer is woken by ParkingLot::WakeAll.
    * \param input The task to be dequeued.
    */
   void Push(const Task& input) {
     while (!Enqueue(input)) {
       tvm::runtime::threading::Yield();
     }
-    if (pending_.fetch_add(1) == -1) {
-      std::unique_lock<std::mutex> lock(mutex_);
-      cv_.notify_one();
-    }
+    pending_.fetch_add(1);
   }
 
   /*!
-   * \brief Pop a task out of the queue and condition wait if no tasks.
+   * \brief Pop a task out of the queue and park if no tasks.
    * \param output The pointer to the task to be dequeued.
-   * \param spin_count The number of iterations to spin before sleep.
+   * \param spin_count The max number of iterations to spin before parking.
    * \return Whether pop is successful (true) or we need to exit now (false).
    */
   bool Pop(Task* output, uint32_t spin_count) {
     // Busy wait a bit when the queue is empty.
-    // If a new task comes to the queue quickly, this wait avoid the worker from sleeping.
-    // The default spin count is set by following the typical omp convention
-    for (uint32_t i = 0; i < spin_count && pending_.load() == 0; ++i) {
-      tvm::runtime::threading::Yield();
+    // If a new task comes to the queue quickly, this wait avoid the worker from sleeping. The
+    // wait is bounded by the spin count (the typical omp convention) and the spin time learnt
+    // by the pool.
+    if (pending_.load() == 0) {
+      auto deadline = std::chrono::steady_clock::now() + std::chrono::nanoseconds(lot_->SpinNs());
+      for (uint32_t i = 0; i < spin_count && pending_.load() == 0; ++i) {
+        if ((i & 63) == 0 && std::chrono::steady_clock::now() >= deadline) break;
+        tvm::runtime::threading::Yield();
+      }
     }
     if (pending_.fetch_sub(1) == 0) {
-      std::unique_lock<std::mutex> lock(mutex_);
-      cv_.wait(lock, [this] { return pending_.load() >= 0 || exit_now_.load(); });
+      lot_->Park([this] { return pending_.load() >= 0 || exit_now_.load(); });
     }
     if (exit_now_.load(std::memory_order_relaxed)) {
       return false;
@@ -201,9 +339,8 @@ class SpscTaskQueue {
    * \brief Signal to terminate the worker.
    */
   void SignalForKill() {
-    std::lock_guard<std::mutex> lock(mutex_);
     exit_now_.store(true);
-    cv_.notify_all();
+    lot_->WakeAll();
   }
 
  protected:
@@ -243,17 +380,15 @@ class SpscTaskQueue {
   std::atomic<uint32_t> tail_;
 
   cache_line_pad_t pad3_;
-  // pending tasks in the queue
-  std::atomic<int8_t> pending_{0};
+  // pending tasks in the queue, -1 when the consumer is parked
+  std::atomic<int32_t> pending_{0};
 
   cache_line_pad_t pad4_;
   // signal for exit now
   std::atomic<bool> exit_now_{false};
 
-  // internal mutex
-  std::mutex mutex_;
-  // cv for consumer
-  std::condition_variable cv_;
+  // where the consumer parks
+  ParkingLot* lot_;
 };
 
 // The thread pool
@@ -288,32 +423,13 @@ class ThreadPool {
     ParallelLauncher* launcher = ParallelLauncher::ThreadLocal();
     ICHECK(!launcher->is_worker)
         << "Cannot launch parallel job inside worker, consider fuse then parallel";
-    if (num_task == 0) {
-      num_task = num_workers_used_;
-    }
-    if (need_sync != 0) {
-      ICHECK_LE(num_task, num_workers_used_)
-          << "Request parallel sync task larger than number of threads used "
-          << " workers=" << num_workers_used_ << " request=" << num_task;
-    }
-    launcher->Init(flambda, cdata, num_task, need_sync != 0);
-    SpscTaskQueue::Task tsk;
-    tsk.launcher = launcher;
-    // if worker0 is taken by the main, queues_[0] is abandoned
-    for (int i = exclude_worker0_; i < num_task; ++i) {
-      tsk.task_id = i;
-      queues_[i]->Push(tsk);
-    }
-    // use the main thread to run task 0
-    if (exclude_worker0_) {
-      TVMParallelGroupEnv* penv = &(tsk.launcher->env);
-      if ((*tsk.launcher->flambda)(0, penv, cdata) == 0) {
-        tsk.launcher->SignalJobFinish();
-      } else {
-        tsk.launcher->SignalJobError(tsk.task_id);
-      }
+    auto start = std::chrono::steady_clock::now();
+    if (last_finish_.time_since_epoch().count() != 0) {
+      lot_.RecordGap(std::chrono::duration_cast<std::chrono::nanoseconds>(start - last_finish_)
+                         .count());
     }
-    int res = launcher->WaitForJobs();
+    int res = LaunchTasks(launcher, flambda, cdata, num_task, need_sync);
+    last_finish_ = std::chrono::steady_clock::now();
     return res;
   }
 
@@ -331,12 +447,15 @@ class ThreadPool {
 
   int32_t NumThreads() const { return num_workers_used_; }
 
+  // the number of tasks per worker of the work stealing launches, 0 to partition statically
+  void SetWorkStealingChunks(int chunks) { work_stealing_chunks_ = std::max(chunks, 0); }
+
  private:
   // Shared initialization code
   void Init() {
     for (int i = 0; i < num_workers_; ++i) {
       // The SpscTaskQueue only hosts ONE item at a time
-      queues_.emplace_back(std::make_unique<SpscTaskQueue>());
+      queues_.emplace_back(std::make_unique<SpscTaskQueue>(&lot_));
     }
     threads_ = std::make_unique<tvm::runtime::threading::ThreadGroup>(
         num_workers_, [this](int worker_id) { this->RunWorker(worker_id); },
@@ -344,6 +463,53 @@ class ThreadPool {
     num_workers_used_ = threads_->Configure(threading::ThreadGroup::kBig, 0, exclude_worker0_);
   }
 
+  // Push the tasks to the workers, wake the parked ones and run the task 0 on the main thread
+  int LaunchTasks(ParallelLauncher* launcher, FTVMParallelLambda flambda, void* cdata, int num_task,
+                  int need_sync) {
+    if (num_task == 0 && work_stealing_chunks_ > 0 && num_workers_used_ > 1) {
+      // the launches of the generated code are split into finer tasks balanced by work stealing,
+      // one task per worker would leave the cores idle on the unbalanced loops
+      launcher->InitWorkStealing(flambda, cdata, num_workers_used_,
+                                 num_workers_used_ * work_stealing_chunks_);
+      SpscTaskQueue::Task tsk{launcher, 0};
+      for (int i = exclude_worker0_; i < num_workers_used_; ++i) {
+        tsk.task_id = i;
+        queues_[i]->Push(tsk);
+      }
+      lot_.WakeAll();
+      if (exclude_worker0_) launcher->RunWorkStealing(0);
+      return launcher->WaitForJobs();
+    }
+    if (num_task == 0) {
+      num_task = num_workers_used_;
+    }
+    if (need_sync != 0) {
+      ICHECK_LE(num_task, num_workers_used_)
+          << "Request parallel sync task larger than number of threads used "
+          << " workers=" << num_workers_used_ << " request=" << num_task;
+    }
+    launcher->Init(flambda, cdata, num_task, need_sync != 0);
+    launcher->work_stealing = false;
+    SpscTaskQueue::Task tsk;
+    tsk.launcher = launcher;
+    // if worker0 is taken by the main, queues_[0] is abandoned
+    for (int i = exclude_worker0_; i < num_task; ++i) {
+      tsk.task_id = i;
+      queues_[i]->Push(tsk);
+    }
+    lot_.WakeAll();
+    // use the main thread to run task 0
+    if (exclude_worker0_) {
+      TVMParallelGroupEnv* penv = &(tsk.launcher->env);
+      if ((*tsk.launcher->flambda)(0, penv, cdata) == 0) {
+        tsk.launcher->SignalJobFinish();
+      } else {
+        tsk.launcher->SignalJobError(tsk.task_id);
+      }
+    }
+    return launcher->WaitForJobs();
+  }
+
   // Internal worker function.
   void RunWorker(int worker_id) {
     SpscTaskQueue* queue = queues_[worker_id].get();
@@ -355,6 +521,10 @@ class ThreadPool {
     static size_t spin_count = GetSpinCount();
     while (queue->Pop(&task, spin_count)) {
       ICHECK(task.launcher != nullptr);
+      if (task.launcher->work_stealing) {
+        task.launcher->RunWorkStealing(task.task_id);
+        continue;
+      }
       TVMParallelGroupEnv* penv = &(task.launcher->env);
       void* cdata = task.launcher->cdata;
       if ((*task.launcher->flambda)(task.task_id, penv, cdata) == 0) {
@@ -369,10 +539,140 @@ class ThreadPool {
   int num_workers_used_;
   // if or not to exclude worker 0 and use main to run task 0
   bool exclude_worker0_{true};
+  // the tasks per worker of the work stealing launches (TVM_THREAD_POOL_WORK_STEALING)
+  int work_stealing_chunks_{GetWorkStealingChunks()};
+  // where the idle workers park, outlives the queues
+  ParkingLot lot_;
+  // the end of the previous launch, for the spin time of the workers
+  std::chrono::steady_clock::time_point last_finish_;
   std::vector<std::unique_ptr<SpscTaskQueue>> queues_;
   std::unique_ptr<tvm::runtime::threading::ThreadGroup> threads_;
 };
 
+/*!
+ * \brief The workers shared by the parallel launches of all the threads of the process, instead of
+ *  a pool per calling thread. A launch is split into fine tasks taken one at a time from a shared
+ *  counter by its caller and by the idle workers, which pick the active launches in turn so that
+ *  the concurrent callers share the workers fairly. The caller runs tasks until none is left,
+ *  hence a launch from inside a task (nested parallelism) completes on the caller alone when no
+ *  worker is idle and recruits the idle ones otherwise. No barrier is available.
+ */
+class SharedArena {
+ public:
+  static SharedArena* Global() {
+    static SharedArena arena;
+    return &arena;
+  }
+
+  static std::atomic<bool>& Enabled() {
+    static std::atomic<bool> enabled{GetSharedArena()};
+    return enabled;
+  }
+
+  int Launch(FTVMParallelLambda flambda, void* cdata, int num_task) {
+    thread_local std::vector<std::unique_ptr<Job>> jobs;
+    thread_local size_t depth = 0;
+    if (depth == jobs.size()) jobs.emplace_back(std::make_unique<Job>());
+    Job* job = jobs[depth].get();
+    if (num_task == 0) num_task = (num_workers_ + 1) * kTasksPerWorker;
+    job->launcher.Init(flambda, cdata, num_task, false);
+    job->next_task.store(0);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      active_.push_back(job);
+      num_active_.fetch_add(1);
+    }
+    cv_.notify_all();
+    depth++;
+    while (job->RunOne()) {
+    }
+    depth--;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      Remove(job);
+    }
+    // the helpers may still run the last tasks
+    while (job->helpers.load() != 0) threading::Yield();
+    return job->launcher.WaitForJobs();
+  }
+
+ private:
+  static constexpr int kTasksPerWorker = 4;
+
+  struct Job {
+    ParallelLauncher launcher;
+    std::atomic<int> next_task{0};
+    // the workers taking a task of the job
+    std::atomic<int> helpers{0};
+    // Run the next task of the job, false if none is left
+    bool RunOne() {
+      int task_id = next_task.fetch_add(1);
+      if (task_id >= launcher.env.num_task) return false;
+      if ((*launcher.flambda)(task_id, &launcher.env, launcher.cdata) == 0) {
+        launcher.SignalJobFinish();
+      } else {
+        launcher.SignalJobError(task_id);
+      }
+      return true;
+    }
+  };
+
+  SharedArena() : num_workers_(std::max(threading::MaxConcurrency() - 1, 0)) {
+    for (int i = 0; i < num_workers_; ++i) {
+      workers_.emplace_back([this]() { RunWorker(); });
+    }
+  }
+
+  ~SharedArena() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      exit_now_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) worker.join();
+  }
+
+  void Remove(Job* job) {
+    auto it = std::find(active_.begin(), active_.end(), job);
+    if (it != active_.end()) {
+      active_.erase(it);
+      num_active_.fetch_sub(1);
+    }
+  }
+
+  void RunWorker() {
+    static size_t spin_count = GetSpinCount();
+    while (true) {
+      for (size_t i = 0; i < spin_count && num_active_.load() == 0; ++i) threading::Yield();
+      Job* job;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return !active_.empty() || exit_now_; });
+        if (exit_now_) return;
+        // the launches are taken in turn, one task at a time
+        job = active_.front();
+        active_.pop_front();
+        active_.push_back(job);
+        job->helpers.fetch_add(1);
+      }
+      if (!job->RunOne()) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Remove(job);
+      }
+      job->helpers.fetch_sub(1);
+    }
+  }
+
+  int num_workers_;
+  std::vector<std::thread> workers_;
+  // the launches with tasks left
+  std::deque<Job*> active_;
+  std::atomic<int> num_active_{0};
+  bool exit_now_{false};
+  std::mutex mutex_;
+  std::condition_variable cv_;
+};
+
 /*!
  * \brief args[0] is the AffinityMode, args[1] is the number of threads.
  *  args2 is a list of CPUs which is used to set the CPU affinity.
@@ -392,6 +692,36 @@ TVM_REGISTER_GLOBAL("runtime.config_threadpool").set_body([](TVMArgs args, TVMRe
   threading::Configure(mode, nthreads, cpus);
 });
 
+/*!
+ * \brief args[0] is the number of tasks per worker of the work stealing launches of the thread
+ *  pool of the calling thread, 0 to partition the parallel loops statically.
+ */
+TVM_REGISTER_GLOBAL("runtime.config_threadpool_work_stealing").set_body_typed([](int chunks) {
+#if !TVM_THREADPOOL_USE_OPENMP
+  ThreadPool::ThreadLocal()->SetWorkStealingChunks(chunks);
+#endif
+});
+
+/*!
+ * \brief args[0] is whether the parallel launches of all the threads share one arena of workers,
+ *  see SharedArena.
+ */
+TVM_REGISTER_GLOBAL("runtime.config_threadpool_shared_arena").set_body_typed([](bool enable) {
+  SharedArena::Enabled().store(enable);
+});
+
+/*!
+ * \brief The CPUs of the NUMA node args[0], as the CPU list of runtime.config_threadpool to group
+ *  the workers on the node.
+ */
+TVM_REGISTER_GLOBAL("runtime.numa_node_cpus").set_body_typed([](int node) {
+  Array<String> cpus;
+  for (unsigned int cpu = 0; cpu < std::thread::hardware_concurrency(); ++cpu) {
+    if (threading::NumaNodeOfCpu(cpu) == node) cpus.push_back(std::to_string(cpu));
+  }
+  return cpus;
+});
+
 TVM_REGISTER_GLOBAL("runtime.NumThreads").set_body_typed([]() -> int32_t {
   return threading::NumThreads();
 });
@@ -482,6 +812,9 @@ int TVMBackendParallelLaunch(FTVMParallelLambda flambda, void* cdata, int num_ta
     return 0;
   } else {
 #if !TVM_THREADPOOL_USE_OPENMP
+    if (tvm::runtime::SharedArena::Enabled().load(std::memory_order_relaxed)) {
+      return tvm::runtime::SharedArena::Global()->Launch(flambda, cdata, num_task);
+    }
     int res = tvm::runtime::ThreadPool::ThreadLocal()->Launch(flambda, cdata, num_task, 1);
     return res;
 #else
@@ -503,6 +836,9 @@ int TVMBackendParallelBarrier(int task_id, TVMParallelGroupEnv* penv) {
 #pragma omp barrier
 #else
   using tvm::runtime::kSyncStride;
+  ICHECK(penv->sync_handle != nullptr)
+      << "The parallel barrier is not available with the work stealing thread pool or the shared "
+         "arena, unset TVM_THREAD_POOL_WORK_STEALING and TVM_THREAD_POOL_SHARED_ARENA";
   int num_task = penv->num_task;
   std::atomic<int>* sync_counter = reinterpret_cast<std::atomic<int>*>(penv->sync_handle);
   int old_counter = sync_counter[task_id * kSyncStride].fetch_add(1, std::memory_order_release);
@@ -70,6 +70,8 @@ enum class StorageRank {
   kMMAMatrixB = 10,
   /*! \brief mma scope memory of accumulator */
   kMMAMatrixC = 11,
+  /*! \brief Metal SIMD group memory */
+  kMetalSimdGroup = 12,
 };
 
 /*!
@@ -126,6 +128,8 @@ struct StorageScope {
         return "m16n8k8.matrixB" + tag;
       case StorageRank::kMMAMatrixC:
         return "m16n8k8.matrixC" + tag;
+      case StorageRank::kMetalSimdGroup:
+        return "metal.simdgroup" + tag;
       default:
         LOG(FATAL) << "unknown storage scope";
     }
@@ -175,6 +179,9 @@ struct StorageScope {
     } else if (s.compare(0, 15, "m16n8k8.matrixC") == 0) {
       r.rank = StorageRank::kMMAMatrixC;
       r.tag = s.substr(15, std::string::npos);
+    } else if (s.compare(0, 15, "metal.simdgroup") == 0) {
+      r.rank = StorageRank::kMetalSimdGroup;
+      r.tag = s.substr(15, std::string::npos);
     } else {
       LOG(FATAL) << "unknown storage scope " << s;
     }
@@ -241,6 +248,10 @@ class LaunchParamConfig {
         ICHECK_EQ(i, launch_param_tags.size() - 1)
             << "kUseDynamicSharedMemoryTag should be the last tag in launch_param_tags.";
         use_dyn_shared_memory_ = true;
+      } else if (tag == launch_param::kUseProgrammaticDependentLaunchTag) {
+        use_programmatic_dependent_launch_ = true;
+      } else if (tag == launch_param::kUseCooperativeLaunchTag) {
+        use_cooperative_launch_ = true;
       } else {
         ThreadScope ts = ThreadScope::Create(tag);
         arg_index_map_.push_back(ts.rank * 3 + ts.dim_index);
@@ -272,6 +283,10 @@ class LaunchParamConfig {
   }
   // return the work dim
   size_t work_dim() const { return work_dim_; }
+  // whether the kernel is launched with the programmatic dependent launch
+  bool use_programmatic_dependent_launch() const { return use_programmatic_dependent_launch_; }
+  // whether the kernel is launched as a cooperative kernel
+  bool use_cooperative_launch() const { return use_cooperative_launch_; }
 
  private:
   /*! \brief base axis */
@@ -282,6 +297,10 @@ class LaunchParamConfig {
   std::vector<uint32_t> arg_index_map_;
   /*! \brief Whether or not use dynamic shared memory. */
   bool use_dyn_shared_memory_{false};
+  /*! \brief Whether or not use the programmatic dependent launch. */
+  bool use_programmatic_dependent_launch_{false};
+  /*! \brief Whether or not use the cooperative launch. */
+  bool use_cooperative_launch_{false};
 };
 
 }  // namespace runtime
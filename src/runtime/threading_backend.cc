@@ -46,7 +46,9 @@ extern "C" {
 #define HEXAGON_STACK_ALIGNMENT 32
 #endif
 #include <algorithm>
+#include <string>
 #include <thread>
+#include <vector>
 #define CURRENT_THREAD_HANDLE (static_cast<std::thread::native_handle_type>(0))
 namespace tvm {
 namespace runtime {
@@ -107,6 +109,42 @@ class QuRTThread {
 };
 #endif  // __hexagon__
 thread_local int max_concurrency = 0;
+
+// The NUMA node of each CPU from /sys/devices/system/node/node<k>/cpulist ("0-63,128-191")
+static const std::vector<int>& NumaNodes() {
+  static const std::vector<int> nodes = [] {
+    std::vector<int> nodes;
+#if defined(__linux__) || defined(__ANDROID__)
+    for (int node = 0;; ++node) {
+      std::ifstream ifs("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+      if (ifs.fail()) break;
+      std::string range;
+      while (std::getline(ifs, range, ',')) {
+        unsigned int first = 0, last = 0;
+        char dash = 0;
+        std::istringstream is(range);
+        if (!(is >> first)) continue;
+        last = (is >> dash >> last) ? last : first;
+        if (nodes.size() <= last) nodes.resize(last + 1, 0);
+        for (unsigned int cpu = first; cpu <= last; ++cpu) nodes[cpu] = node;
+      }
+    }
+#endif
+    return nodes;
+  }();
+  return nodes;
+}
+
+int NumaNodeCount() {
+  const auto& nodes = NumaNodes();
+  return nodes.empty() ? 1 : *std::max_element(nodes.begin(), nodes.end()) + 1;
+}
+
+int NumaNodeOfCpu(unsigned int cpu) {
+  const auto& nodes = NumaNodes();
+  return cpu < nodes.size() ? nodes[cpu] : 0;
+}
+
 class ThreadGroup::Impl {
  public:
   Impl(int num_workers, std::function<void(int)> worker_callback, bool exclude_worker0)
@@ -322,9 +360,13 @@ class ThreadGroup::Impl {
       max_freqs.push_back(std::make_pair(i, cur_freq));
     }
 
+    // the cores of the same frequency are grouped by NUMA node, so that the consecutive workers,
+    // which run the consecutive chunks of the parallel loops, share a node
     auto fcmpbyfreq = [](const std::pair<unsigned int, int64_t>& a,
                          const std::pair<unsigned int, int64_t>& b) {
-      return a.second == b.second ? a.first < b.first : a.second > b.second;
+      if (a.second != b.second) return a.second > b.second;
+      int node_a = NumaNodeOfCpu(a.first), node_b = NumaNodeOfCpu(b.first);
+      return node_a == node_b ? a.first < b.first : node_a < node_b;
     };
     std::sort(max_freqs.begin(), max_freqs.end(), fcmpbyfreq);
     int64_t big_freq = max_freqs.begin()->second;
@@ -0,0 +1,524 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file src/runtime/vm/batch_scheduler.cc
+ * \brief A continuous batching scheduler of the requests to a function of the Relay VM.
+ *
+ * The requests are queued, grouped by shape bucket and run as one batch along the first axis.
+ * Within a bucket the inputs are padded along the padding axis to a multiple of the bucket size,
+ * and the outputs are split back per request and cropped along that axis.
+ *
+ * The scheduling is iteration level: a request runs for a number of steps, the outputs of a step
+ * being fed back as the inputs of the next one, as for autoregressive decoding. Each step batches
+ * all the active requests, so that new requests join the running batches at the next step instead
+ * of waiting for them to finish.
+ *
+ * The steps are serialized, whether run by the stepping thread or by hand. A batch whose run
+ * throws fails its requests, the error being raised by their polls, and the other requests keep
+ * running.
+ */
+
+#include <tvm/runtime/container/adt.h>
+#include <tvm/runtime/data_type.h>
+#include <tvm/runtime/logging.h>
+#include <tvm/runtime/module.h>
+#include <tvm/runtime/ndarray.h>
+#include <tvm/runtime/packed_func.h>
+#include <tvm/runtime/registry.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace tvm {
+namespace runtime {
+namespace vm {
+
+/*! \brief A request to the scheduled function. */
+struct BatchRequest {
+  /*! \brief The inputs of the next step. */
+  std::vector<NDArray> inputs;
+  /*! \brief The outputs of the last step. */
+  std::vector<NDArray> outputs;
+  /*! \brief The number of steps left. */
+  int64_t steps_left;
+  /*! \brief Whether the request ran all its steps, or failed. */
+  bool done{false};
+  /*! \brief The error of the step which failed, empty if none did. */
+  std::string error;
+};
+
+class VMBatchScheduler : public ModuleNode {
+ public:
+  /*!
+   * \brief Create a scheduler of the requests to a function of a VM.
+   * \param vm The virtual machine module, initialized.
+   * \param func_name The function to run.
+   * \param max_batch_size The largest number of rows, along the first axis, of a batch.
+   * \param bucket_size The padded lengths are rounded up to a multiple of this.
+   * \param pad_axis The axis along which the inputs are padded, 0 to disable padding.
+   * \param pass_lengths Whether the lengths of the rows along the padding axis are passed as an
+   * extra int32 input, e.g. to mask the padding.
+   */
+  VMBatchScheduler(Module vm, std::string func_name, int64_t max_batch_size, int64_t bucket_size,
+                   int64_t pad_axis, bool pass_lengths)
+      : vm_(vm),
+        func_name_(func_name),
+        max_batch_size_(max_batch_size),
+        bucket_size_(std::max<int64_t>(bucket_size, 1)),
+        pad_axis_(pad_axis),
+        pass_lengths_(pass_lengths) {
+    ICHECK_GT(max_batch_size_, 0) << "The batch size should be positive.";
+    ICHECK_GE(pad_axis_, 0) << "The padding axis can not be negative.";
+    set_input_ = vm_.GetFunction("set_input");
+    invoke_ = vm_.GetFunction("invoke");
+  }
+
+  ~VMBatchScheduler() { Stop(); }
+
+  const char* type_key() const final { return "VMBatchScheduler"; }
+
+  PackedFunc GetFunction(const String& name, const ObjectPtr<Object>& sptr_to_self) final {
+    if (name == "submit") {
+      return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+        ICHECK_GE(args.size(), 2) << "The expected arguments are (num_steps, inputs...)";
+        std::vector<NDArray> inputs;
+        for (int i = 1; i < args.size(); ++i) {
+          inputs.push_back(args[i]);
+        }
+        *rv = Submit(args[0], std::move(inputs));
+      });
+    } else if (name == "step") {
+      return TypedPackedFunc<int64_t()>([sptr_to_self, this]() { return Step(); });
+    } else if (name == "run_until_done") {
+      return TypedPackedFunc<void()>([sptr_to_self, this]() {
+        while (Step() > 0) {
+        }
+      });
+    } else if (name == "poll") {
+      return TypedPackedFunc<Array<NDArray>(int64_t, bool)>(
+          [sptr_to_self, this](int64_t id, bool wait) { return Poll(id, wait); });
+    } else if (name == "num_pending") {
+      return TypedPackedFunc<int64_t()>([sptr_to_self, this]() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return static_cast<int64_t>(pending_.size());
+      });
+    } else if (name == "start") {
+      return TypedPackedFunc<void()>([sptr_to_self, this]() { Start(); });
+    } else if (name == "stop") {
+      return TypedPackedFunc<void()>([sptr_to_self, this]() { Stop(); });
+    } else if (name == "get_statistics") {
+      return TypedPackedFunc<String()>([sptr_to_self, this]() { return GetStatistics(); });
+    }
+    return PackedFunc(nullptr);
+  }
+
+  /*!
+   * \brief Queue a request.
+   * \param num_steps The number of steps to run the request for.
+   * \param inputs The inputs of the first step.
+   * \return The id of the request.
+   */
+  int64_t Submit(int64_t num_steps, std::vector<NDArray> inputs) {
+    ICHECK_GT(num_steps, 0) << "A request should run for at least one step.";
+    for (const NDArray& input : inputs) {
+      ICHECK(input->ndim > 0 && input.IsContiguous())
+          << "The inputs of a batched request should be contiguous tensors with a batch axis.";
+    }
+    auto request = std::make_shared<BatchRequest>();
+    request->inputs = std::move(inputs);
+    request->steps_left = num_steps;
+    std::lock_guard<std::mutex> lock(mutex_);
+    int64_t id = next_id_++;
+    requests_[id] = request;
+    pending_.push_back(id);
+    work_cv_.notify_one();
+    return id;
+  }
+
+  /*!
+   * \brief Run one step of every active request, batched by shape bucket.
+   * \return The number of requests which ran.
+   */
+  int64_t Step() {
+    std::lock_guard<std::mutex> step_lock(step_mutex_);
+    std::vector<int64_t> active;
+    std::unordered_map<int64_t, std::shared_ptr<BatchRequest>> requests;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      active.swap(pending_);
+      for (int64_t id : active) requests[id] = requests_.at(id);
+    }
+    if (active.empty()) return 0;
+
+    // Grouping by bucket, the batches of a bucket are cut at the maximal batch size.
+    std::map<std::string, std::vector<std::vector<int64_t>>> buckets;
+    try {
+      for (int64_t id : active) {
+        const std::shared_ptr<BatchRequest>& request = requests[id];
+        int64_t rows = request->inputs[0]->shape[0];
+        auto& batches = buckets[BucketKey(request->inputs)];
+        if (batches.empty() || BatchRows(batches.back(), requests) + rows > max_batch_size_) {
+          batches.emplace_back();
+        }
+        batches.back().push_back(id);
+      }
+    } catch (const std::exception& e) {
+      std::vector<BatchRequest*> failed;
+      for (int64_t id : active) failed.push_back(requests[id].get());
+      Fail(failed, e.what());
+      buckets.clear();
+    }
+
+    std::vector<int64_t> next;
+    for (auto& bucket : buckets) {
+      for (const std::vector<int64_t>& batch : bucket.second) {
+        std::vector<BatchRequest*> batch_requests;
+        for (int64_t id : batch) batch_requests.push_back(requests[id].get());
+        try {
+          RunBatch(batch_requests);
+        } catch (const std::exception& e) {
+          Fail(batch_requests, e.what());
+        }
+        for (int64_t id : batch) {
+          if (!requests[id]->done) next.push_back(id);
+        }
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    // The requests still running go first, ahead of the ones submitted during this step.
+    next.insert(next.end(), pending_.begin(), pending_.end());
+    pending_.swap(next);
+    done_cv_.notify_all();
+    return static_cast<int64_t>(active.size());
+  }
+
+  /*!
+   * \brief Get the outputs of a request, once it ran all its steps.
+   * \param id The id of the request.
+   * \param wait Whether to block until the request is done.
+   * \return The outputs, empty while the request is not done.
+   */
+  Array<NDArray> Poll(int64_t id, bool wait) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = requests_.find(id);
+    ICHECK(it != requests_.end()) << "Unknown or already polled request " << id;
+    std::shared_ptr<BatchRequest> request = it->second;
+    if (wait) {
+      if (!running_) {
+        lock.unlock();
+        while (!request->done && Step() > 0) {
+        }
+        lock.lock();
+      }
+      done_cv_.wait(lock, [&] { return request->done; });
+    }
+    if (!request->done) return {};
+    requests_.erase(id);
+    if (!request->error.empty()) {
+      LOG(FATAL) << "Request " << id << " failed: " << request->error;
+    }
+    return Array<NDArray>(request->outputs.begin(), request->outputs.end());
+  }
+
+  /*! \brief Start a thread stepping the requests as they come. */
+  void Start() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (running_) return;
+    running_ = true;
+    worker_ = std::thread([this]() {
+      while (true) {
+        {
+          std::unique_lock<std::mutex> lock(mutex_);
+          work_cv_.wait(lock, [this] { return !running_ || !pending_.empty(); });
+          if (!running_) break;
+        }
+        Step();
+      }
+    });
+  }
+
+  /*! \brief Stop the stepping thread. */
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!running_) return;
+      running_ = false;
+      work_cv_.notify_all();
+    }
+    if (worker_.joinable()) worker_.join();
+  }
+
+  /*! \brief Return the batching statistics in JSON form. */
+  String GetStatistics() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::ostringstream os;
+    os << "{\"batches\": " << num_batches_ << ", \"rows\": " << num_rows_
+       << ", \"padded_rows\": " << num_padded_rows_
+       << ", \"average_batch\": " << (num_batches_ ? double(num_rows_) / num_batches_ : 0.0)
+       << ", \"padding_ratio\": "
+       << (num_elements_ ? double(num_padding_elements_) / num_elements_ : 0.0) << "}";
+    return os.str();
+  }
+
+ private:
+  /*! \brief The length of an input along the padding axis, rounded up to the bucket size. */
+  int64_t PaddedLength(const NDArray& input) const {
+    int64_t length = input->shape[pad_axis_];
+    return (length + bucket_size_ - 1) / bucket_size_ * bucket_size_;
+  }
+
+  /*! \brief Whether an input is padded. */
+  bool IsPadded(const NDArray& input) const { return pad_axis_ > 0 && input->ndim > pad_axis_; }
+
+  /*! \brief The key of the bucket of a request, its shapes but the batch axis, padded. */
+  std::string BucketKey(const std::vector<NDArray>& inputs) const {
+    std::ostringstream os;
+    for (const NDArray& input : inputs) {
+      os << DLDataType2String(input->dtype) << "[";
+      for (int axis = 1; axis < input->ndim; ++axis) {
+        bool padded = IsPadded(input) && axis == pad_axis_;
+        os << (padded ? PaddedLength(input) : input->shape[axis]) << ",";
+      }
+      os << "]";
+    }
+    return os.str();
+  }
+
+  int64_t BatchRows(const std::vector<int64_t>& batch,
+                    const std::unordered_map<int64_t, std::shared_ptr<BatchRequest>>& requests) {
+    int64_t rows = 0;
+    for (int64_t id : batch) rows += requests.at(id)->inputs[0]->shape[0];
+    return rows;
+  }
+
+  /*! \brief The number of elements of a tensor. */
+  static int64_t NumElements(const NDArray& array) {
+    int64_t size = 1;
+    for (int i = 0; i < array->ndim; ++i) size *= array->shape[i];
+    return size;
+  }
+
+  /*!
+   * \brief Copy between a tensor and a slice of a tensor at least as long along each axis.
+   * The tensors have the same shape before \p axis, at which the large one may be longer.
+   * \param small The small tensor, on the CPU.
+   * \param large The large tensor, on the CPU.
+   * \param outer_offset The offset of the slice in the large tensor, in blocks before the axis.
+   * \param axis The axis along which the small tensor may be shorter.
+   * \param to_large Whether to copy from the small tensor into the large one, or the other way.
+   */
+  static void CopyBlocks(const NDArray& small, const NDArray& large, int64_t outer_offset,
+                         int axis, bool to_large) {
+    int64_t outer = 1;
+    for (int i = 0; i < axis; ++i) outer *= small->shape[i];
+    size_t small_block = GetDataSize(*small.operator->()) / outer;
+    size_t large_block = small_block;
+    if (axis < large->ndim) {
+      large_block = small_block / small->shape[axis] * large->shape[axis];
+    }
+    char* small_data = static_cast<char*>(small->data) + small->byte_offset;
+    char* large_data = static_cast<char*>(large->data) + large->byte_offset;
+    for (int64_t i = 0; i < outer; ++i) {
+      char* large_ptr = large_data + (outer_offset + i) * large_block;
+      char* small_ptr = small_data + i * small_block;
+      if (to_large) {
+        std::memcpy(large_ptr, small_ptr, small_block);
+      } else {
+        std::memcpy(small_ptr, large_ptr, small_block);
+      }
+    }
+  }
+
+  /*! \brief Run a step of a batch of requests of the same bucket. */
+  void RunBatch(const std::vector<BatchRequest*>& batch) {
+    Device cpu{kDLCPU, 0};
+    const std::vector<NDArray>& first = batch[0]->inputs;
+    std::vector<int64_t> rows;
+    int64_t total_rows = 0;
+    for (BatchRequest* request : batch) {
+      rows.push_back(request->inputs[0]->shape[0]);
+      total_rows += rows.back();
+    }
+
+    // Concatenating the inputs along the batch axis, padded along the padding axis.
+    std::vector<NDArray> batched;
+    int64_t padded_length = 0;
+    for (size_t k = 0; k < first.size(); ++k) {
+      std::vector<int64_t> shape(first[k]->shape, first[k]->shape + first[k]->ndim);
+      shape[0] = total_rows;
+      bool padded = IsPadded(first[k]);
+      if (padded) {
+        shape[pad_axis_] = PaddedLength(first[k]);
+        padded_length = shape[pad_axis_];
+      }
+      NDArray input = NDArray::Empty(shape, first[k]->dtype, cpu);
+      std::memset(input->data, 0, GetDataSize(*input.operator->()));
+      int64_t row_offset = 0;
+      for (size_t r = 0; r < batch.size(); ++r) {
+        NDArray src = batch[r]->inputs[k].CopyTo(cpu);
+        ICHECK_EQ(src->shape[0], rows[r]) << "The inputs of a request differ in batch size";
+        int axis = padded ? pad_axis_ : 1;
+        int64_t outer_offset = row_offset;
+        for (int i = 1; i < axis; ++i) outer_offset *= src->shape[i];
+        CopyBlocks(src, input, outer_offset, axis, true);
+        if (padded) {
+          num_padding_elements_ += (shape[pad_axis_] - src->shape[pad_axis_]) *
+                                   (NumElements(src) / src->shape[pad_axis_]);
+        }
+        num_elements_ += NumElements(input) / total_rows * rows[r];
+        row_offset += rows[r];
+      }
+      batched.push_back(input);
+    }
+    if (pass_lengths_) {
+      NDArray lengths = NDArray::Empty({total_rows}, DLDataType{kDLInt, 32, 1}, cpu);
+      int32_t* data = static_cast<int32_t*>(lengths->data);
+      for (BatchRequest* request : batch) {
+        const NDArray& input = request->inputs[0];
+        int32_t length = IsPadded(input) ? input->shape[pad_axis_] : 0;
+        for (int64_t i = 0; i < input->shape[0]; ++i) *data++ = length;
+      }
+      batched.push_back(lengths);
+    }
+
+    std::vector<NDArray> outputs = Invoke(batched);
+
+    // Splitting the outputs back per request, cropped along the padding axis.
+    for (size_t r = 0, row_offset = 0; r < batch.size(); row_offset += rows[r], ++r) {
+      BatchRequest* request = batch[r];
+      std::vector<NDArray> results;
+      for (const NDArray& output : outputs) {
+        ICHECK(output->ndim > 0 && output->shape[0] == total_rows)
+            << "The outputs should be batched along the first axis like the inputs";
+        std::vector<int64_t> shape(output->shape, output->shape + output->ndim);
+        shape[0] = rows[r];
+        int axis = 1;
+        if (padded_length && output->ndim > pad_axis_ && shape[pad_axis_] == padded_length &&
+            IsPadded(request->inputs[0])) {
+          shape[pad_axis_] = request->inputs[0]->shape[pad_axis_];
+          axis = pad_axis_;
+        }
+        NDArray result = NDArray::Empty(shape, output->dtype, cpu);
+        int64_t outer_offset = row_offset;
+        for (int i = 1; i < axis; ++i) outer_offset *= shape[i];
+        CopyBlocks(result, output, outer_offset, axis, false);
+        results.push_back(result);
+      }
+      request->outputs = results;
+      if (--request->steps_left > 0) {
+        // Feeding the outputs back as the inputs of the next step.
+        for (size_t k = 0; k < std::min(results.size(), request->inputs.size()); ++k) {
+          request->inputs[k] = results[k];
+        }
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    num_batches_ += 1;
+    num_rows_ += total_rows;
+    if (padded_length) num_padded_rows_ += total_rows;
+    for (BatchRequest* request : batch) request->done = request->steps_left == 0;
+  }
+
+  /*! \brief Mark the requests of a batch done with the error of its run. */
+  void Fail(const std::vector<BatchRequest*>& batch, const std::string& error) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (BatchRequest* request : batch) {
+      request->error = error;
+      request->done = true;
+    }
+  }
+
+  /*! \brief Invoke the function of the VM, returning its outputs on the CPU. */
+  std::vector<NDArray> Invoke(const std::vector<NDArray>& inputs) {
+    std::vector<TVMValue> values(inputs.size() + 1);
+    std::vector<int> codes(inputs.size() + 1);
+    TVMArgsSetter setter(values.data(), codes.data());
+    setter(0, func_name_);
+    for (size_t i = 0; i < inputs.size(); ++i) setter(i + 1, inputs[i]);
+    TVMRetValue rv;
+    set_input_.CallPacked(TVMArgs(values.data(), codes.data(), values.size()), &rv);
+    ObjectRef ret = invoke_(func_name_);
+
+    Device cpu{kDLCPU, 0};
+    std::vector<NDArray> outputs;
+    if (const auto* adt = ret.as<ADTObj>()) {
+      for (size_t i = 0; i < adt->size; ++i) {
+        outputs.push_back(Downcast<NDArray>((*adt)[i]).CopyTo(cpu));
+      }
+    } else {
+      outputs.push_back(Downcast<NDArray>(ret).CopyTo(cpu));
+    }
+    return outputs;
+  }
+
+  /*! \brief The virtual machine. */
+  Module vm_;
+  /*! \brief The function run for the requests. */
+  std::string func_name_;
+  int64_t max_batch_size_;
+  int64_t bucket_size_;
+  int64_t pad_axis_;
+  bool pass_lengths_;
+  PackedFunc set_input_;
+  PackedFunc invoke_;
+
+  /*! \brief Serializes the steps, of the stepping thread and of the callers. */
+  std::mutex step_mutex_;
+  /*! \brief Protects the requests, the queue and the statistics. */
+  std::mutex mutex_;
+  /*! \brief Signals the requests submitted to the stepping thread. */
+  std::condition_variable work_cv_;
+  /*! \brief Signals the end of a step to the waiting polls. */
+  std::condition_variable done_cv_;
+  std::unordered_map<int64_t, std::shared_ptr<BatchRequest>> requests_;
+  /*! \brief The requests to run at the next step, in order. */
+  std::vector<int64_t> pending_;
+  int64_t next_id_{0};
+  bool running_{false};
+  std::thread worker_;
+
+  int64_t num_batches_{0};
+  int64_t num_rows_{0};
+  int64_t num_padded_rows_{0};
+  int64_t num_elements_{0};
+  int64_t num_padding_elements_{0};
+};
+
+TVM_REGISTER_GLOBAL("runtime.VMBatchScheduler")
+    .set_body_typed([](Module vm, String func_name, int64_t max_batch_size, int64_t bucket_size,
+                       int64_t pad_axis, bool pass_lengths) {
+      return Module(make_object<VMBatchScheduler>(vm, func_name, max_batch_size, bucket_size,
+                                                  pad_axis, pass_lengths));
+    });
+
+}  // namespace vm
+}  // namespace runtime
+}  // namespace tvm
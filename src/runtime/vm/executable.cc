@@ -30,6 +30,7 @@
 #include <tvm/runtime/vm/vm.h>
 
 #include <algorithm>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
 #include <memory>
@@ -38,6 +39,7 @@
 #include <utility>
 #include <vector>
 
+#include "../../support/mapped_file.h"
 #include "../file_utils.h"
 #include "../library_module.h"
 #include "serialize_utils.h"
@@ -179,9 +181,9 @@ std::string Executable::GetBytecode() const {
 
 std::string Executable::GetConstants() const {
   std::ostringstream oss;
+  std::lock_guard<std::mutex> lock(lazy_mutex_);
   for (size_t i = 0; i < constants.size(); ++i) {
-    const auto& constant = constants[i];
-    auto ndarray = Downcast<NDArray>(constant);
+    NDArray ndarray = ReadConstant(i);
     oss << "VM Const[" << i
         << "]: " << RuntimeObject2String(ndarray, virtual_devices[host_device_index].first)
         << " on device index " << const_device_indexes[i] << std::endl;
@@ -222,8 +224,9 @@ std::string Executable::Stats() const {
 
   // Get the number of constants and the shape of each of them.
   oss << "  Constant shapes (# " << constants.size() << "): [";
-  for (const auto& it : constants) {
-    const auto constant = Downcast<NDArray>(it);
+  std::unique_lock<std::mutex> lock(lazy_mutex_);
+  for (size_t i = 0; i < constants.size(); ++i) {
+    const auto constant = ReadConstant(i);
     const auto& shape = constant.Shape();
 
     // Scalar
@@ -239,6 +242,7 @@ std::string Executable::Stats() const {
     oss.seekp(-2, oss.cur);
     oss << "], " << std::endl;
   }
+  lock.unlock();
   if (!constants.empty()) oss.seekp(-2, oss.cur);
   oss << "]" << std::endl;
 
@@ -278,6 +282,9 @@ void SaveHeader(dmlc::Stream* strm) {
 }
 
 TVMByteArray Executable::Save() {
+  // The lazy constants may be read from code_.
+  LoadLazyConstants();
+
   // Initialize the stream object.
   code_.clear();
   dmlc::MemoryStringStream strm(&code_);
@@ -313,6 +320,7 @@ void Executable::SaveVirtualDevicesSection(dmlc::Stream* strm) {
 
 Map<String, NDArray> Executable::GetLateBoundConstants(size_t byte_limit) {
   ICHECK(late_bound_constant_names.empty());
+  LoadLazyConstants();
   late_bound_constant_names.reserve(constants.size());
   Map<String, NDArray> map;
   size_t total_late_bound_bytes = 0;
@@ -361,7 +369,9 @@ void Executable::LoadLateBoundConstantsFromStream(dmlc::Stream* stream) {
 void Executable::LoadLateBoundConstantsFromMap(Map<String, NDArray> map) {
   for (size_t const_index = 0; const_index < constants.size(); ++const_index) {
     if (!late_bound_constant_names[const_index].defined()) {
-      ICHECK(constants[const_index].defined())
+      bool is_lazy = !lazy_constant_offsets_.empty() &&
+                     lazy_constant_offsets_[const_index] != kNotLazy;
+      ICHECK(constants[const_index].defined() || is_lazy)
           << "Undefined immediate constant at index " << const_index;
       continue;
     }
@@ -401,6 +411,24 @@ namespace {
 // Tags to distinguish immediate vs late-bound constants in constants table bytestream.
 constexpr uint32_t kImmediateConstTag = 0;
 constexpr uint32_t kLateBoundConstTag = 1;
+
+// Skips a tensor saved by SaveDLTensor, reading only its header.
+void SkipDLTensor(dmlc::SeekStream* strm) {
+  uint64_t header, reserved;
+  STREAM_CHECK(strm->Read(&header) && header == kTVMNDArrayMagic, "constant tensor");
+  STREAM_CHECK(strm->Read(&reserved), "constant tensor");
+  Device dev;
+  int ndim;
+  DLDataType dtype;
+  STREAM_CHECK(strm->Read(&dev) && strm->Read(&ndim) && strm->Read(&dtype), "constant tensor");
+  std::vector<int64_t> shape(ndim);
+  if (ndim != 0) {
+    STREAM_CHECK(strm->ReadArray(&shape[0], ndim), "constant tensor");
+  }
+  int64_t data_byte_size;
+  STREAM_CHECK(strm->Read(&data_byte_size) && data_byte_size >= 0, "constant tensor");
+  strm->Seek(strm->Tell() + static_cast<size_t>(data_byte_size));
+}
 }  // namespace
 
 void Executable::SaveConstantSection(dmlc::Stream* stream) {
@@ -444,6 +472,10 @@ void Executable::LoadConstantSection(dmlc::Stream* stream) {
   constants.resize(size);
   late_bound_constant_names.resize(size);
   bool any_late_bound = false;
+  // The immediate constants are left in the serialized executable when it is kept.
+  auto* seek_stream = dynamic_cast<dmlc::SeekStream*>(stream);
+  bool lazy = lazy_bytes_ != nullptr && seek_stream != nullptr;
+  if (lazy) lazy_constant_offsets_.assign(size, kNotLazy);
 
   // Load each of the constants.
   for (size_t const_index = 0; const_index < size; const_index++) {
@@ -452,9 +484,15 @@ void Executable::LoadConstantSection(dmlc::Stream* stream) {
     if (tag == kImmediateConstTag) {
       // Immediate constants tagged by 0.
       VLOG(1) << "load " << const_index << " as immediate";
-      runtime::NDArray ndarray;
-      STREAM_CHECK(ndarray.Load(stream), "constant tensor");
-      constants[const_index] = std::move(ndarray);
+      if (lazy) {
+        lazy_constant_offsets_[const_index] = seek_stream->Tell();
+        SkipDLTensor(seek_stream);
+        constants[const_index] = NDArray(nullptr);
+      } else {
+        runtime::NDArray ndarray;
+        STREAM_CHECK(ndarray.Load(stream), "constant tensor");
+        constants[const_index] = std::move(ndarray);
+      }
       late_bound_constant_names[const_index] = String(ObjectPtr<StringObj>(nullptr));
     } else if (tag == kLateBoundConstTag) {
       // Late-bound constants tagged by 1.
@@ -758,27 +796,87 @@ runtime::Module Executable::Load(const std::string& code, const runtime::Module
   }
 
   exec->code_ = code;
-  dmlc::MemoryStringStream strm(&exec->code_);
+  // The constants are deserialized from code_, which is only rewritten by Save once they are.
+  exec->LoadSections(std::shared_ptr<const char>(exec->code_.data(), [](const char*) {}),
+                     exec->code_.size());
+
+  return runtime::Module(exec);
+}
+
+runtime::Module Executable::LoadFromFile(const std::string& path, const runtime::Module lib) {
+  auto file = std::make_shared<support::MappedFile>(path);
+  ICHECK(file->good()) << "Cannot open the VM executable " << path;
+  // The file holds the serialized executable as a string: its size, then its bytes.
+  uint64_t size;
+  ICHECK_GE(file->size(), sizeof(size)) << "Invalid VM executable file " << path;
+  std::memcpy(&size, file->data(), sizeof(size));
+  if (!DMLC_IO_NO_ENDIAN_SWAP) dmlc::ByteSwap(&size, sizeof(size), 1);
+  ICHECK_EQ(file->size(), sizeof(size) + size) << "Invalid VM executable file " << path;
+
+  auto exec = make_object<Executable>();
+  if (lib.defined()) {
+    exec->SetLib(lib);
+  }
+  // The mapping lives as long as the constants not deserialized yet.
+  std::shared_ptr<const char> bytes(file->data() + sizeof(size), [file](const char*) {});
+  exec->LoadSections(std::move(bytes), static_cast<size_t>(size));
+  return runtime::Module(exec);
+}
+
+void Executable::LoadSections(std::shared_ptr<const char> bytes, size_t size) {
+  lazy_bytes_ = std::move(bytes);
+  lazy_bytes_size_ = size;
+  dmlc::MemoryFixedSizeStream strm(const_cast<char*>(lazy_bytes_.get()), size);
 
   // Load header.
   LoadHeader(&strm);
 
   // Virtual devices section
-  exec->LoadVirtualDevicesSection(&strm);
+  LoadVirtualDevicesSection(&strm);
 
   // Global section.
-  exec->LoadGlobalSection(&strm);
+  LoadGlobalSection(&strm);
 
   // Constant section.
-  exec->LoadConstantSection(&strm);
+  LoadConstantSection(&strm);
 
   // Primitive names that will be invoked by `InvokePacked` instructions.
-  exec->LoadPrimitiveOpNames(&strm);
+  LoadPrimitiveOpNames(&strm);
 
   // Code section.
-  exec->LoadCodeSection(&strm);
+  LoadCodeSection(&strm);
+}
 
-  return runtime::Module(exec);
+NDArray Executable::ReadConstant(Index const_index) const {
+  if (lazy_constant_offsets_.empty() || lazy_constant_offsets_[const_index] == kNotLazy) {
+    return Downcast<NDArray>(constants[const_index]);
+  }
+  size_t offset = lazy_constant_offsets_[const_index];
+  dmlc::MemoryFixedSizeStream strm(const_cast<char*>(lazy_bytes_.get()) + offset,
+                                   lazy_bytes_size_ - offset);
+  NDArray ndarray;
+  STREAM_CHECK(ndarray.Load(&strm), "constant tensor");
+  return ndarray;
+}
+
+ObjectRef Executable::GetConstant(Index const_index) {
+  ICHECK_LT(static_cast<size_t>(const_index), constants.size());
+  std::lock_guard<std::mutex> lock(lazy_mutex_);
+  if (!lazy_constant_offsets_.empty() && lazy_constant_offsets_[const_index] != kNotLazy) {
+    constants[const_index] = ReadConstant(const_index);
+    lazy_constant_offsets_[const_index] = kNotLazy;
+  }
+  return constants[const_index];
+}
+
+void Executable::LoadLazyConstants() {
+  std::lock_guard<std::mutex> lock(lazy_mutex_);
+  for (size_t i = 0; i < lazy_constant_offsets_.size(); ++i) {
+    if (lazy_constant_offsets_[i] != kNotLazy) constants[i] = ReadConstant(i);
+  }
+  lazy_constant_offsets_.clear();
+  lazy_bytes_.reset();
+  lazy_bytes_size_ = 0;
 }
 
 void Executable::LoadVirtualDevicesSection(dmlc::Stream* strm) {
@@ -1074,9 +1172,7 @@ TVM_REGISTER_GLOBAL("runtime.module.loadbinary_VMExecutable").set_body_typed(Exe
 
 // Load module from module.
 Module ExecutableLoadFile(const std::string& file_name, const String& format) {
-  tvm::runtime::SimpleBinaryFileStream stream(file_name, "rb");
-  auto exec = ExecutableLoadBinary(reinterpret_cast<void*>(&stream));
-  return exec;
+  return Executable::LoadFromFile(file_name, Module());
 }
 
 TVM_REGISTER_GLOBAL("runtime.module.loadfile_VMExecutable").set_body_typed(ExecutableLoadFile);
@@ -1131,6 +1227,11 @@ TVM_REGISTER_GLOBAL("runtime.Load_Executable")
       return Executable::Load(code, lib);
     });
 
+TVM_REGISTER_GLOBAL("runtime.Load_ExecutableFromFile")
+    .set_body_typed([](std::string path, runtime::Module lib) {
+      return Executable::LoadFromFile(path, lib);
+    });
+
 }  // namespace vm
 }  // namespace runtime
 }  // namespace tvm
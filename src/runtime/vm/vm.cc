@@ -124,7 +124,7 @@ ShapeTuple ToShape(NDArray shape_tensor) {
   return ShapeTuple(shape);
 }
 
-void VirtualMachine::OpStartHook(Instruction instr) {}
+void VirtualMachine::OpStartHook(const Instruction& instr) {}
 void VirtualMachine::OpStopHook() {}
 
 PackedFunc VirtualMachine::GetFunction(const String& name, const ObjectPtr<Object>& sptr_to_self) {
@@ -370,13 +370,33 @@ void VirtualMachine::CreateInputsOrCheckSize(const std::string& func_name, size_
   }
 }
 
+/*!
+ * \brief Upload an input to the device. An upload from the host returns once staged, the work
+ *  queued afterwards on the device waits for it.
+ */
+NDArray UploadInput(const DLTensor* tensor, Device dev) {
+  std::vector<int64_t> shape(tensor->shape, tensor->shape + tensor->ndim);
+  NDArray ret = NDArray::Empty(ShapeTuple(shape), tensor->dtype, dev);
+  NDArray::CopyFromToAsync(tensor, const_cast<DLTensor*>(ret.operator->()))
+      .StreamWait(DeviceAPI::Get(dev)->GetCurrentStream(dev));
+  return ret;
+}
+
 void VirtualMachine::SetInputTensorWithIndex(std::vector<ObjectRef>& tensors,
                                              const TVMArgValue& inp_tensor, int index, Device dev) {
   if (inp_tensor.type_code() == kTVMDLTensorHandle) {
     if (NDArray::AbilityOfZeroCopyForDLTensor(inp_tensor, dev)) {
       tensors[index] = NDArray::FromExternalDLTensor(*inp_tensor);
     } else {
-      tensors[index] = NDArray::NewFromDLTensor(inp_tensor, dev);
+      tensors[index] = UploadInput(inp_tensor, dev);
+    }
+  } else if (inp_tensor.IsObjectRef<NDArray>()) {
+    NDArray nd_array = inp_tensor;
+    if (nd_array->device.device_type != dev.device_type ||
+        nd_array->device.device_id != dev.device_id) {
+      tensors[index] = UploadInput(nd_array.operator->(), dev);
+    } else {
+      tensors[index] = nd_array;
     }
   } else {
     tensors[index] = CopyTo(inp_tensor, dev);
@@ -394,8 +414,9 @@ inline Allocator* VirtualMachine::GetAllocator(Index device_index) const {
 }
 
 void VirtualMachine::PushFrame(Index arg_count, Index ret_pc, const VMFunction& vm_func) {
-  auto frame = VMFrame(ret_pc, func_index_, arg_count, code_, vm_func.register_file_size);
-  frames_.push_back(frame);
+  register_base_ = registers_.size();
+  registers_.resize(register_base_ + vm_func.register_file_size);
+  frames_.emplace_back(ret_pc, func_index_, arg_count, code_, register_base_);
 }
 
 Index VirtualMachine::PopFrame() {
@@ -405,7 +426,10 @@ Index VirtualMachine::PopFrame() {
   code_ = fr.code;
   pc_ = fr.pc;
   auto call_stack_size = frames_.size();
+  // Release the objects of the frame, the capacity is kept for the next calls.
+  registers_.resize(fr.register_base);
   frames_.pop_back();
+  register_base_ = frames_.empty() ? 0 : frames_.back().register_base;
   return call_stack_size;
 }
 
@@ -457,17 +481,15 @@ void VirtualMachine::InvokePacked(Index packed_index, const PackedFunc& func, In
     }
   }
 
-  std::vector<TVMValue> values(arity);
-  std::vector<int> codes(arity);
-  runtime::TVMArgsSetter setter(values.data(), codes.data());
+  packed_values_.resize(arity);
+  packed_codes_.resize(arity);
+  runtime::TVMArgsSetter setter(packed_values_.data(), packed_codes_.data());
   int idx = 0;
   bool is_empty_output = false;
   for (Index i = 0; i < arg_count; i++) {
     if (const auto* dt_cell = args[i].as<ADTObj>()) {
       for (size_t fi = 0; fi < dt_cell->size; ++fi) {
-        auto obj = (*dt_cell)[fi];
-        auto nd_array = Downcast<NDArray>(obj);
-        setter(idx++, nd_array);
+        setter(idx++, Downcast<NDArray>((*dt_cell)[fi]));
       }
     } else {
       auto nd_array = Downcast<NDArray>(args[i]);
@@ -487,8 +509,19 @@ void VirtualMachine::InvokePacked(Index packed_index, const PackedFunc& func, In
 
   if (!is_empty_output) {
     TVMRetValue rv;
-    func.CallPacked(TVMArgs(values.data(), codes.data(), arity), &rv);
+    func.CallPacked(TVMArgs(packed_values_.data(), packed_codes_.data(), arity), &rv);
+  }
+}
+
+const PackedFunc& VirtualMachine::GetPackedFunc(Index packed_index) {
+  ICHECK_LT(static_cast<size_t>(packed_index), packed_funcs_.size());
+  PackedFunc& func = packed_funcs_[packed_index];
+  if (func == nullptr) {
+    const std::string& packed_name = packed_names_[packed_index];
+    func = exec_->GetLib().GetFunction(packed_name, /*query_imports=*/true);
+    ICHECK(func != nullptr) << "Cannot find function in module: " << packed_name;
   }
+  return func;
 }
 
 void VirtualMachine::LoadExecutable(const ObjectPtr<Executable>& exec) {
@@ -503,19 +536,26 @@ void VirtualMachine::LoadExecutable(const ObjectPtr<Executable>& exec) {
       << "If the executable has declared primitive functions, the "
       << "generated kernel library must non-be null.";
 
+  // The primitives are looked up in the library on their first call, the lookup of the
+  // primitives of a large library being a large part of the start of the VM.
+  packed_names_.clear();
   for (const auto& it : exec_->primitive_map) {
-    const auto& packed_name = it.first;
     auto packed_index = static_cast<size_t>(it.second);
-    if (packed_funcs_.size() <= packed_index) {
-      packed_funcs_.resize(packed_index + 1);
+    if (packed_names_.size() <= packed_index) {
+      packed_names_.resize(packed_index + 1);
     }
-    tvm::runtime::PackedFunc pf = lib.GetFunction(packed_name, /*query_imports=*/true);
-    ICHECK(pf != nullptr) << "Cannot find function in module: " << packed_name;
-    packed_funcs_[packed_index] = pf;
+    packed_names_[packed_index] = it.first;
+  }
+  for (size_t i = 0; i < packed_names_.size(); ++i) {
+    ICHECK(!packed_names_[i].empty()) << "Packed function " << i << " is not initialized";
   }
-  for (size_t i = 0; i < packed_funcs_.size(); ++i) {
-    ICHECK(packed_funcs_[i] != nullptr) << "Packed function " << i << " is not initialized";
+  packed_funcs_.assign(packed_names_.size(), PackedFunc(nullptr));
+  // Size the register file for a few nested calls of the largest function up front.
+  Index max_register_file_size = 0;
+  for (const auto& func : exec_->functions) {
+    max_register_file_size = std::max(max_register_file_size, func.register_file_size);
   }
+  registers_.reserve(4 * max_register_file_size);
 }
 
 void VirtualMachine::Init(const std::vector<Device>& physical_devices,
@@ -547,15 +587,20 @@ void VirtualMachine::Init(const std::vector<Device>& physical_devices,
 }
 
 inline void VirtualMachine::WriteRegister(Index r, const ObjectRef& val) {
-  frames_.back().register_file[r] = val;
+  registers_[register_base_ + r] = val;
 }
 
-ObjectRef VirtualMachine::ReadRegister(Index r) const { return frames_.back().register_file[r]; }
+const ObjectRef& VirtualMachine::ReadRegister(Index r) const {
+  return registers_[register_base_ + r];
+}
 
 int64_t VirtualMachine::LoadScalarInt(Index r) const {
   int64_t result = 0;
-  const auto& obj = ReadRegister(r);
-  NDArray array = Downcast<NDArray>(CopyTo(obj, GetDevice(exec_->host_device_index)));
+  NDArray array = Downcast<NDArray>(ReadRegister(r));
+  Device host = GetDevice(exec_->host_device_index);
+  if (array->device.device_type != host.device_type || array->device.device_id != host.device_id) {
+    array = array.CopyTo(host);
+  }
 
   switch (array->dtype.bits) {
     case 1: {
@@ -622,80 +667,125 @@ std::vector<Index> VirtualMachine::GetOutputTensorRegIndices() {
   return reg_indices;
 }
 
+/*
+ * The dispatch of RunLoop. With GCC and clang each handler jumps straight to the handler of the
+ * next instruction through a table of label addresses (direct threading), which gives every
+ * handler its own indirect branch so the predictor learns the common pairs of instructions, e.g.
+ * AllocTensor followed by InvokePacked. The other compilers use a switch in a loop.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define TVM_VM_THREADED_DISPATCH 1
+#define VM_OP(name) op_##name:
+#define VM_OP_UNKNOWN op_unknown
+#define VM_DISPATCH()                                                               \
+  do {                                                                              \
+    instr = &code_[pc_];                                                            \
+    VLOG(2) << "Executing(" << pc_ << "): " << *instr;                              \
+    if (static_cast<size_t>(instr->op) >= sizeof(dispatch_table) / sizeof(void*)) { \
+      goto op_unknown;                                                              \
+    }                                                                               \
+    goto* dispatch_table[static_cast<size_t>(instr->op)];                           \
+  } while (0)
+#else
+#define TVM_VM_THREADED_DISPATCH 0
+#define VM_OP(name) case Opcode::name:
+#define VM_OP_UNKNOWN default
+#define VM_DISPATCH() goto main_loop
+#endif
+
 void VirtualMachine::RunLoop(const std::vector<Index>& output_tensor_reg_indices) {
   ICHECK(this->exec_);
   ICHECK(this->code_);
   pc_ = 0;
   Index frame_start = frames_.size();
+  std::vector<ObjectRef> args;
+  const Instruction* instr;
+#if TVM_VM_THREADED_DISPATCH
+  // The handlers in the order of Opcode.
+  static const void* dispatch_table[] = {
+      &&op_Move,         &&op_Ret,          &&op_Invoke,       &&op_InvokeClosure,
+      &&op_InvokePacked, &&op_AllocTensor,  &&op_AllocTensorReg,
+      &&op_AllocADT,     &&op_AllocClosure, &&op_GetField,     &&op_If,
+      &&op_LoadConst,    &&op_Goto,         &&op_GetTag,       &&op_LoadConsti,
+      &&op_Fatal,        &&op_AllocStorage, &&op_ShapeOf,      &&op_ReshapeTensor,
+      &&op_DeviceCopy,   &&op_KillRegister};
+  static_assert(sizeof(dispatch_table) / sizeof(dispatch_table[0]) ==
+                    static_cast<size_t>(Opcode::KillRegister) + 1,
+                "The dispatch table must have a handler for each opcode");
+  VM_DISPATCH();
+  {
+#else
   while (true) {
   main_loop:
-    auto const& instr = code_[this->pc_];
-    VLOG(2) << "Executing(" << pc_ << "): " << instr;
+    instr = &code_[this->pc_];
+    VLOG(2) << "Executing(" << pc_ << "): " << *instr;
 
-    switch (instr.op) {
-      case Opcode::Move: {
+    switch (instr->op) {
+#endif
+      VM_OP(Move) {
         ObjectRef from_obj;
-        from_obj = ReadRegister(instr.from);
-        WriteRegister(instr.dst, from_obj);
+        from_obj = ReadRegister(instr->from);
+        WriteRegister(instr->dst, from_obj);
         pc_++;
-        goto main_loop;
+        VM_DISPATCH();
       }
-      case Opcode::Fatal: {
+      VM_OP(Fatal) {
         throw std::runtime_error("VM encountered fatal error");
       }
-      case Opcode::LoadConst: {
-        bool is_not_cached = const_pool_.size() <= static_cast<size_t>(instr.const_index) ||
-                             !const_pool_[instr.const_index].defined();
+      VM_OP(LoadConst) {
+        bool is_not_cached = const_pool_.size() <= static_cast<size_t>(instr->const_index) ||
+                             !const_pool_[instr->const_index].defined();
         if (is_not_cached) {
-          OpStartHook(instr);
+          OpStartHook(*instr);
         }
-        auto constant_obj = exec_->constants[instr.const_index];
         // We cache the allocated object in the constant pool. To measure, the
         // first iteration will set the pool up. The other iterations will
         // directly reuse the allocated objects.
-        if (const_pool_.size() <= static_cast<size_t>(instr.const_index)) {
-          const_pool_.resize(instr.const_index + 1);
+        if (const_pool_.size() <= static_cast<size_t>(instr->const_index)) {
+          const_pool_.resize(instr->const_index + 1);
         }
 
-        if (!const_pool_[instr.const_index].defined()) {
+        if (!const_pool_[instr->const_index].defined()) {
+          // Only fetched on a miss, GetConstant may load a late-bound constant.
+          auto constant_obj = exec_->GetConstant(instr->const_index);
           auto& [dev, mem_scope] =
-              exec_->virtual_devices[exec_->const_device_indexes[instr.const_index]];
-          const_pool_[instr.const_index] = CopyTo(constant_obj, dev, String(mem_scope));
+              exec_->virtual_devices[exec_->const_device_indexes[instr->const_index]];
+          const_pool_[instr->const_index] = CopyTo(constant_obj, dev, String(mem_scope));
         }
-        WriteRegister(instr.dst, const_pool_[instr.const_index]);
+        WriteRegister(instr->dst, const_pool_[instr->const_index]);
         if (is_not_cached) {
           OpStopHook();
         }
         pc_++;
-        goto main_loop;
+        VM_DISPATCH();
       }
-      case Opcode::LoadConsti: {
+      VM_OP(LoadConsti) {
         auto tensor = NDArray::Empty({1}, {kDLInt, 64, 1}, GetDevice(exec_->host_device_index));
-        reinterpret_cast<int64_t*>(tensor->data)[0] = instr.load_consti.val;
-        WriteRegister(instr.dst, tensor);
+        reinterpret_cast<int64_t*>(tensor->data)[0] = instr->load_consti.val;
+        WriteRegister(instr->dst, tensor);
         pc_++;
-        goto main_loop;
+        VM_DISPATCH();
       }
-      case Opcode::Invoke: {
-        std::vector<ObjectRef> args;
-        for (Index i = 0; i < instr.num_args; ++i) {
-          args.push_back(ReadRegister(instr.invoke_args_registers[i]));
+      VM_OP(Invoke) {
+        args.clear();
+        for (Index i = 0; i < instr->num_args; ++i) {
+          args.push_back(ReadRegister(instr->invoke_args_registers[i]));
         }
-        InvokeGlobal(exec_->functions[instr.func_index], args);
-        frames_.back().caller_return_register = instr.dst;
-        goto main_loop;
+        InvokeGlobal(exec_->functions[instr->func_index], args);
+        args.clear();
+        frames_.back().caller_return_register = instr->dst;
+        VM_DISPATCH();
       }
-      case Opcode::InvokePacked: {
-        ICHECK_LE(instr.packed_index, packed_funcs_.size());
-        const auto& func = packed_funcs_[instr.packed_index];
-        const auto& arity = instr.arity;
-        std::vector<ObjectRef> args;
+      VM_OP(InvokePacked) {
+        const auto& func = GetPackedFunc(instr->packed_index);
+        const auto& arity = instr->arity;
+        args.clear();
         for (Index i = 0; i < arity; ++i) {
-          auto arg = ReadRegister(instr.packed_args[i]);
+          const auto& arg = ReadRegister(instr->packed_args[i]);
           args.push_back(arg);
 #if TVM_LOG_DEBUG
           if (i < arity) {
-            const bool is_input = i < arity - instr.output_size;
+            const bool is_input = i < arity - instr->output_size;
             VLOG(2) << (is_input ? "input" : "placeholder") << " arg " << i << " = "
                     << RuntimeObject2String(arg, GetDevice(exec_->host_device_index),
                                             /*show_contents=*/is_input);
@@ -705,163 +795,166 @@ void VirtualMachine::RunLoop(const std::vector<Index>& output_tensor_reg_indices
 
         // We no longer need to write the registers back, we write directly
         // through the registers mutably.
-        InvokePacked(instr.packed_index, func, arity, instr.output_size, args);
+        InvokePacked(instr->packed_index, func, arity, instr->output_size, args);
+        args.clear();
 
 #if TVM_LOG_DEBUG
-        for (Index i = arity - instr.output_size; i < arity; ++i) {
-          auto arg = ReadRegister(instr.packed_args[i]);
+        for (Index i = arity - instr->output_size; i < arity; ++i) {
+          auto arg = ReadRegister(instr->packed_args[i]);
           VLOG(2) << "output arg " << i << " = "
                   << RuntimeObject2String(arg, GetDevice(exec_->host_device_index));
         }
 #endif
 
         pc_++;
-        goto main_loop;
+        VM_DISPATCH();
       }
-      case Opcode::InvokeClosure: {
-        auto object = ReadRegister(instr.closure);
+      VM_OP(InvokeClosure) {
+        auto object = ReadRegister(instr->closure);
         const auto* closure = object.as<VMClosureObj>();
         ICHECK(closure);
-        std::vector<ObjectRef> args;
-        for (auto free_var : closure->free_vars) {
+        args.clear();
+        for (const auto& free_var : closure->free_vars) {
           args.push_back(free_var);
         }
-        for (Index i = 0; i < instr.num_closure_args; ++i) {
-          args.push_back(ReadRegister(instr.closure_args[i]));
+        for (Index i = 0; i < instr->num_closure_args; ++i) {
+          args.push_back(ReadRegister(instr->closure_args[i]));
         }
         InvokeGlobal(exec_->functions[closure->func_index], args);
-        frames_.back().caller_return_register = instr.dst;
-        goto main_loop;
+        args.clear();
+        frames_.back().caller_return_register = instr->dst;
+        VM_DISPATCH();
       }
-      case Opcode::GetField: {
-        auto object = ReadRegister(instr.object);
+      VM_OP(GetField) {
+        auto object = ReadRegister(instr->object);
         const auto& tuple = Downcast<ADT>(object);
-        auto field = tuple[instr.field_index];
-        WriteRegister(instr.dst, field);
+        auto field = tuple[instr->field_index];
+        WriteRegister(instr->dst, field);
         pc_++;
-        goto main_loop;
+        VM_DISPATCH();
       }
-      case Opcode::GetTag: {
-        auto object = ReadRegister(instr.get_tag.object);
+      VM_OP(GetTag) {
+        auto object = ReadRegister(instr->get_tag.object);
         const auto& adt = Downcast<ADT>(object);
         auto tag = adt.tag();
         auto tag_tensor = NDArray::Empty({1}, {kDLInt, 32, 1}, GetDevice(exec_->host_device_index));
         reinterpret_cast<int32_t*>(tag_tensor->data)[0] = tag;
-        WriteRegister(instr.dst, tag_tensor);
+        WriteRegister(instr->dst, tag_tensor);
         pc_++;
-        goto main_loop;
+        VM_DISPATCH();
       }
-      case Opcode::Goto: {
-        pc_ += instr.pc_offset;
-        goto main_loop;
+      VM_OP(Goto) {
+        pc_ += instr->pc_offset;
+        VM_DISPATCH();
       }
-      case Opcode::If: {
-        int32_t test_val = LoadScalarInt(instr.if_op.test);
-        int32_t target_val = LoadScalarInt(instr.if_op.target);
+      VM_OP(If) {
+        int32_t test_val = LoadScalarInt(instr->if_op.test);
+        int32_t target_val = LoadScalarInt(instr->if_op.target);
 
         if (test_val == target_val) {
-          ICHECK_NE(instr.if_op.true_offset, 0);
-          pc_ += instr.if_op.true_offset;
+          ICHECK_NE(instr->if_op.true_offset, 0);
+          pc_ += instr->if_op.true_offset;
         } else {
-          ICHECK_NE(instr.if_op.false_offset, 0);
-          pc_ += instr.if_op.false_offset;
+          ICHECK_NE(instr->if_op.false_offset, 0);
+          pc_ += instr->if_op.false_offset;
         }
 
-        goto main_loop;
+        VM_DISPATCH();
       }
-      case Opcode::AllocTensor: {
-        OpStartHook(instr);
-        if (!output_tensor_reg_indices.empty() && FindIndex(output_tensor_reg_indices, instr.dst)) {
-          WriteAllocatedTensorFromOutside(instr);
+      VM_OP(AllocTensor) {
+        OpStartHook(*instr);
+        if (!output_tensor_reg_indices.empty() &&
+            FindIndex(output_tensor_reg_indices, instr->dst)) {
+          WriteAllocatedTensorFromOutside(*instr);
         } else {
-          WriteAllocatedTensor(instr);
+          WriteAllocatedTensor(*instr);
         }
         OpStopHook();
         pc_++;
-        goto main_loop;
+        VM_DISPATCH();
       }
-      case Opcode::AllocTensorReg: {
-        OpStartHook(instr);
+      VM_OP(AllocTensorReg) {
+        OpStartHook(*instr);
         Device cpu_dev = GetDevice(exec_->host_device_index);
-        auto shape_obj = ReadRegister(instr.alloc_tensor_reg.shape_register);
+        auto shape_obj = ReadRegister(instr->alloc_tensor_reg.shape_register);
         NDArray shape_tensor = Downcast<NDArray>(CopyTo(shape_obj, cpu_dev));
         auto shape = ToShape(shape_tensor);
-        auto storage_obj = ReadRegister(instr.alloc_tensor_reg.storage);
+        auto storage_obj = ReadRegister(instr->alloc_tensor_reg.storage);
         auto storage = Downcast<Storage>(storage_obj);
-        auto offset = LoadScalarInt(instr.alloc_tensor.offset);
-        auto obj = storage->AllocNDArray(offset, shape, instr.alloc_tensor_reg.dtype);
+        auto offset = LoadScalarInt(instr->alloc_tensor.offset);
+        auto obj = storage->AllocNDArray(offset, shape, instr->alloc_tensor_reg.dtype);
         VLOG(2) << "allocated "
                 << RuntimeObject2String(obj, GetDevice(exec_->host_device_index),
                                         /*show_contents=*/false);
 
-        WriteRegister(instr.dst, obj);
+        WriteRegister(instr->dst, obj);
         OpStopHook();
         pc_++;
-        goto main_loop;
+        VM_DISPATCH();
       }
-      case Opcode::AllocADT: {
+      VM_OP(AllocADT) {
         std::vector<ObjectRef> fields;
-        for (Index i = 0; i < instr.num_fields; ++i) {
-          fields.push_back(ReadRegister(instr.datatype_fields[i]));
+        for (Index i = 0; i < instr->num_fields; ++i) {
+          fields.push_back(ReadRegister(instr->datatype_fields[i]));
         }
-        ObjectRef obj = ADT(instr.constructor_tag, fields);
-        WriteRegister(instr.dst, obj);
+        ObjectRef obj = ADT(instr->constructor_tag, fields);
+        WriteRegister(instr->dst, obj);
         pc_++;
-        goto main_loop;
+        VM_DISPATCH();
       }
-      case Opcode::AllocClosure: {
+      VM_OP(AllocClosure) {
         std::vector<ObjectRef> free_vars;
-        for (Index i = 0; i < instr.num_freevar; i++) {
-          free_vars.push_back(ReadRegister(instr.free_vars[i]));
+        for (Index i = 0; i < instr->num_freevar; i++) {
+          free_vars.push_back(ReadRegister(instr->free_vars[i]));
         }
-        WriteRegister(instr.dst, VMClosure(instr.func_index, free_vars));
+        WriteRegister(instr->dst, VMClosure(instr->func_index, free_vars));
         pc_++;
-        goto main_loop;
+        VM_DISPATCH();
       }
-      case Opcode::AllocStorage: {
-        OpStartHook(instr);
+      VM_OP(AllocStorage) {
+        OpStartHook(*instr);
 
         auto storage_obj = SimpleObjAllocator().make_object<StorageObj>();
-        Allocator* allocator = GetAllocator(instr.alloc_storage.device_index);
+        Allocator* allocator = GetAllocator(instr->alloc_storage.device_index);
         ICHECK(allocator) << "Did you forget to init the VirtualMachine with devices?";
 
-        if (instr.alloc_storage.ndim > 0) {
+        if (instr->alloc_storage.ndim > 0) {
           std::string shape = "[";
-          for (uint32_t i = 0; i < instr.alloc_storage.ndim; ++i) {
+          for (uint32_t i = 0; i < instr->alloc_storage.ndim; ++i) {
             if (i > 0) {
               shape += ", ";
             }
-            shape += std::to_string(instr.alloc_storage.shape[i]);
+            shape += std::to_string(instr->alloc_storage.shape[i]);
           }
           shape += "]";
-          std::string mem_scope = exec_->virtual_devices[instr.alloc_storage.device_index].second;
-          VLOG(2) << "allocating with ndims=" << instr.alloc_storage.ndim << ", shape=" << shape
-                  << ", dtype_hint=" << DLDataType2String(instr.alloc_storage.dtype_hint)
-                  << ", device_index=" << instr.alloc_storage.device_index
+          std::string mem_scope = exec_->virtual_devices[instr->alloc_storage.device_index].second;
+          VLOG(2) << "allocating with ndims=" << instr->alloc_storage.ndim << ", shape=" << shape
+                  << ", dtype_hint=" << DLDataType2String(instr->alloc_storage.dtype_hint)
+                  << ", device_index=" << instr->alloc_storage.device_index
                   << ", memory_scope=" << mem_scope;
 
           std::vector<ShapeTuple::index_type> shape_;
-          shape_.resize(instr.alloc_storage.ndim);
-          shape_.assign(instr.alloc_storage.shape,
-                        instr.alloc_storage.shape + instr.alloc_storage.ndim);
+          shape_.resize(instr->alloc_storage.ndim);
+          shape_.assign(instr->alloc_storage.shape,
+                        instr->alloc_storage.shape + instr->alloc_storage.ndim);
           storage_obj->buffer =
-              allocator->Alloc(ShapeTuple(shape_), instr.alloc_storage.dtype_hint, mem_scope);
+              allocator->Alloc(ShapeTuple(shape_), instr->alloc_storage.dtype_hint, mem_scope);
         } else {
-          auto size = LoadScalarInt(instr.alloc_storage.allocation_size);
-          auto alignment = instr.alloc_storage.alignment;
+          auto size = LoadScalarInt(instr->alloc_storage.allocation_size);
+          auto alignment = instr->alloc_storage.alignment;
           VLOG(2) << "allocating with allocation_size=" << size << ", alignment=" << alignment
-                  << ", dtype_hint=" << DLDataType2String(instr.alloc_storage.dtype_hint)
-                  << ", device_index=" << instr.alloc_storage.device_index;
-          storage_obj->buffer = allocator->Alloc(size, alignment, instr.alloc_storage.dtype_hint);
+                  << ", dtype_hint=" << DLDataType2String(instr->alloc_storage.dtype_hint)
+                  << ", device_index=" << instr->alloc_storage.device_index;
+          storage_obj->buffer = allocator->Alloc(size, alignment, instr->alloc_storage.dtype_hint);
         }
         Storage storage(storage_obj);
-        WriteRegister(instr.dst, storage);
+        WriteRegister(instr->dst, storage);
         OpStopHook();
         pc_++;
-        goto main_loop;
+        VM_DISPATCH();
       }
-      case Opcode::ShapeOf: {
-        auto input = ReadRegister(instr.shape_of.tensor);
+      VM_OP(ShapeOf) {
+        auto input = ReadRegister(instr->shape_of.tensor);
         NDArray input_array = Downcast<NDArray>(input);
         int ndim = input_array->ndim;
         auto out_tensor =
@@ -871,15 +964,15 @@ void VirtualMachine::RunLoop(const std::vector<Index>& output_tensor_reg_indices
         }
         VLOG(2) << "shape = "
                 << RuntimeObject2String(out_tensor, GetDevice(exec_->host_device_index));
-        WriteRegister(instr.dst, out_tensor);
+        WriteRegister(instr->dst, out_tensor);
         pc_++;
-        goto main_loop;
+        VM_DISPATCH();
       }
-      case Opcode::Ret: {
+      VM_OP(Ret) {
         // If we have hit the point from which we started
         // running, we should return to the caller breaking
         // the dispatch loop.
-        return_register_ = ReadRegister(instr.result);
+        return_register_ = ReadRegister(instr->result);
         auto caller_return_register = frames_.back().caller_return_register;
 
         if (PopFrame() == frame_start) {
@@ -887,16 +980,16 @@ void VirtualMachine::RunLoop(const std::vector<Index>& output_tensor_reg_indices
           // Otherwise we are just returning from a local call.
         } else {
           WriteRegister(caller_return_register, return_register_);
-          goto main_loop;
+          VM_DISPATCH();
         }
       }
-      case Opcode::ReshapeTensor: {
-        OpStartHook(instr);
+      VM_OP(ReshapeTensor) {
+        OpStartHook(*instr);
         Device cpu_dev = GetDevice(exec_->host_device_index);
-        auto tensor_obj = ReadRegister(instr.reshape_tensor.tensor);
+        auto tensor_obj = ReadRegister(instr->reshape_tensor.tensor);
         NDArray tensor_arr = Downcast<NDArray>(tensor_obj);
         // Read the shape from shape tensor
-        auto shape_obj = ReadRegister(instr.reshape_tensor.newshape);
+        auto shape_obj = ReadRegister(instr->reshape_tensor.newshape);
         NDArray shape_tensor = Downcast<NDArray>(CopyTo(shape_obj, cpu_dev));
         const DLTensor* dl_tensor = shape_tensor.operator->();
         ICHECK_EQ(dl_tensor->dtype.code, 0u);
@@ -909,51 +1002,52 @@ void VirtualMachine::RunLoop(const std::vector<Index>& output_tensor_reg_indices
         VLOG(2) << "reshaped "
                 << RuntimeObject2String(tensor_obj, GetDevice(exec_->host_device_index)) << " to "
                 << RuntimeObject2String(out_tensor, GetDevice(exec_->host_device_index));
-        WriteRegister(instr.dst, out_tensor);
+        WriteRegister(instr->dst, out_tensor);
         OpStopHook();
         pc_++;
-        goto main_loop;
+        VM_DISPATCH();
       }
-      case Opcode::DeviceCopy: {
-        OpStartHook(instr);
-        auto tensor_src = ReadRegister(instr.device_copy.src);
+      VM_OP(DeviceCopy) {
+        OpStartHook(*instr);
+        auto tensor_src = ReadRegister(instr->device_copy.src);
         NDArray src_data = Downcast<NDArray>(tensor_src);
         Device actual_src_dev = src_data->device;
-        Device inst_src_dev = GetDevice(instr.device_copy.src_device_index);
+        Device inst_src_dev = GetDevice(instr->device_copy.src_device_index);
         ICHECK_EQ(actual_src_dev.device_type, inst_src_dev.device_type);
         ICHECK_EQ(actual_src_dev.device_id, inst_src_dev.device_id);
-        Device dst_dev = GetDevice(instr.device_copy.dst_device_index);
-        auto mem_scope = exec_->virtual_devices[instr.device_copy.dst_device_index].second;
+        Device dst_dev = GetDevice(instr->device_copy.dst_device_index);
+        auto mem_scope = exec_->virtual_devices[instr->device_copy.dst_device_index].second;
 
         NDArray dst_data = src_data.CopyTo(dst_dev, String(mem_scope));
-        WriteRegister(instr.dst, dst_data);
+        WriteRegister(instr->dst, dst_data);
         OpStopHook();
         pc_++;
-        goto main_loop;
+        VM_DISPATCH();
       }
-      case Opcode::KillRegister: {
-        OpStartHook(instr);
-        WriteRegister(instr.dst, ObjectRef());
+      VM_OP(KillRegister) {
+        OpStartHook(*instr);
+        WriteRegister(instr->dst, ObjectRef());
         OpStopHook();
         pc_++;
-        goto main_loop;
+        VM_DISPATCH();
       }
-      default:
-        LOG(FATAL) << "Unknown instruction opcode: " << int(instr.op);
+      VM_OP_UNKNOWN:
+        LOG(FATAL) << "Unknown instruction opcode: " << int(instr->op);
     }
+#if !TVM_VM_THREADED_DISPATCH
   }
+#endif
 }
 
-void VirtualMachine::WriteAllocatedTensor(const Instruction& instr) {
-  auto shape = std::vector<int64_t>(instr.alloc_tensor.ndim);
-
-  for (uint32_t i = 0; i < instr.alloc_tensor.ndim; ++i) {
-    shape[i] = instr.alloc_tensor.shape[i];
-  }
+#undef VM_DISPATCH
+#undef VM_OP_UNKNOWN
+#undef VM_OP
+#undef TVM_VM_THREADED_DISPATCH
 
-  auto storage_obj = ReadRegister(instr.alloc_tensor.storage);
+void VirtualMachine::WriteAllocatedTensor(const Instruction& instr) {
+  ShapeTuple shape(instr.alloc_tensor.shape, instr.alloc_tensor.shape + instr.alloc_tensor.ndim);
   auto offset = LoadScalarInt(instr.alloc_tensor.offset);
-  auto storage = Downcast<Storage>(storage_obj);
+  auto storage = Downcast<Storage>(ReadRegister(instr.alloc_tensor.storage));
   auto obj = storage->AllocNDArray(offset, shape, instr.alloc_tensor.dtype);
   VLOG(2) << "allocated "
           << RuntimeObject2String(obj, GetDevice(exec_->host_device_index),
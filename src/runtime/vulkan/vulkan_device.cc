@@ -20,7 +20,14 @@
 #include "vulkan_device.h"
 
 #include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
 #include <mutex>
+#include <random>
+#include <sstream>
 #include <unordered_map>
 #include <utility>
 
@@ -136,6 +143,10 @@ VulkanDeviceProperties::VulkanDeviceProperties(const VulkanInstance& instance,
 
   supports_cooperative_matrix = device.HasExtension("VK_NV_cooperative_matrix");
 
+#ifdef VK_KHR_cooperative_matrix
+  supports_cooperative_matrix_khr = device.HasExtension("VK_KHR_cooperative_matrix");
+#endif
+
   // The check of VK_SHADER_STAGE_COMPUTE_BIT isn't technically
   // needed, since it will be set so long at least one queue has
   // VK_QUEUE_COMPUTE_BIT.  Including it to avoid potential future
@@ -256,6 +267,8 @@ VulkanDevice::VulkanDevice(const VulkanInstance& instance, VkPhysicalDevice phy_
 
   vkGetDeviceQueue(device_, queue_family_index, 0, &queue);
 
+  CreatePipelineCache();
+
   // Find suitable memory type for staging and compute
   // Find suitable compute index.
   VkBuffer buffer;
@@ -349,6 +362,11 @@ VulkanDevice::~VulkanDevice() {
   staging_buffer_per_thread.Clear();
   uniform_buffer_per_thread.Clear();
 
+  if (pipeline_cache) {
+    SavePipelineCache();
+    vkDestroyPipelineCache(device_, pipeline_cache, nullptr);
+  }
+
   if (device_) {
     vkDestroyDevice(device_, nullptr);
   }
@@ -384,6 +402,9 @@ void VulkanDevice::do_swap(VulkanDevice&& other) {
   std::swap(physical_device_, other.physical_device_);
   std::swap(enabled_extensions, other.enabled_extensions);
   std::swap(device_, other.device_);
+  std::swap(pipeline_cache, other.pipeline_cache);
+  std::swap(pipeline_cache_path, other.pipeline_cache_path);
+  std::swap(pipeline_cache_dirty, other.pipeline_cache_dirty);
 }
 
 bool VulkanDevice::SupportsCompute() const { return queue_family_index != uint32_t(-1); }
@@ -438,7 +459,8 @@ std::vector<const char*> VulkanDevice::SelectEnabledExtensions() const {
                                                "VK_KHR_dedicated_allocation",
                                                "VK_KHR_spirv_1_4",
                                                "VK_KHR_shader_integer_dot_product",
-                                               "VK_NV_cooperative_matrix"};
+                                               "VK_NV_cooperative_matrix",
+                                               "VK_KHR_cooperative_matrix"};
 
   uint32_t device_extension_prop_count;
   VULKAN_CALL(vkEnumerateDeviceExtensionProperties(physical_device_, nullptr,
@@ -464,6 +486,10 @@ void VulkanDevice::CreateVkDevice(const VulkanInstance& instance) {
       VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_16BIT_STORAGE_FEATURES};
   VkPhysicalDeviceShaderFloat16Int8Features float16_int8 = {
       VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_FLOAT16_INT8_FEATURES};
+#ifdef VK_KHR_cooperative_matrix
+  VkPhysicalDeviceCooperativeMatrixFeaturesKHR cooperative_matrix = {
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_COOPERATIVE_MATRIX_FEATURES_KHR};
+#endif
 
   void** pp_next = &enabled_features.pNext;
   bool needs_float16_int8 = false;
@@ -500,6 +526,13 @@ void VulkanDevice::CreateVkDevice(const VulkanInstance& instance) {
     *pp_next = &float16_int8;
     pp_next = &float16_int8.pNext;
   }
+#ifdef VK_KHR_cooperative_matrix
+  if (device_properties.supports_cooperative_matrix_khr) {
+    cooperative_matrix.cooperativeMatrix = true;
+    *pp_next = &cooperative_matrix;
+    pp_next = &cooperative_matrix.pNext;
+  }
+#endif
 
   float priority = 1.0f;
 
@@ -532,6 +565,103 @@ void VulkanDevice::CreateVkDevice(const VulkanInstance& instance) {
   VULKAN_CALL(vkCreateDevice(physical_device_, &device_create_info, nullptr, &device_));
 }
 
+namespace {
+
+// The pipeline cache data starts with a header naming the device and
+// the driver that wrote it.  Drivers should, but aren't required to,
+// reject the data written by another one.
+bool IsCompatiblePipelineCacheData(const std::vector<char>& data,
+                                   const VkPhysicalDeviceProperties& props) {
+  const size_t header_size = 4 * sizeof(uint32_t) + VK_UUID_SIZE;
+  if (data.size() < header_size) {
+    return false;
+  }
+  uint32_t header[4];
+  std::memcpy(header, data.data(), sizeof(header));
+  return header[0] >= header_size && header[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         header[2] == props.vendorID && header[3] == props.deviceID &&
+         std::memcmp(data.data() + sizeof(header), props.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+}  // namespace
+
+void VulkanDevice::CreatePipelineCache() {
+  std::vector<char> initial_data;
+  if (const char* cache_dir = std::getenv("TVM_VULKAN_PIPELINE_CACHE_DIR")) {
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(physical_device_, &props);
+    std::ostringstream os;
+    os << cache_dir << "/vulkan_pipeline_cache_" << std::hex << props.vendorID << "_"
+       << props.deviceID << "_" << props.driverVersion << ".bin";
+    pipeline_cache_path = os.str();
+    std::ifstream fs(pipeline_cache_path, std::ios::in | std::ios::binary);
+    if (!fs.fail()) {
+      initial_data.assign(std::istreambuf_iterator<char>(fs), std::istreambuf_iterator<char>());
+      if (!IsCompatiblePipelineCacheData(initial_data, props)) {
+        initial_data.clear();
+      }
+    }
+  }
+
+  VkPipelineCacheCreateInfo cache_cinfo;
+  cache_cinfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  cache_cinfo.pNext = nullptr;
+  cache_cinfo.flags = 0;
+  cache_cinfo.initialDataSize = initial_data.size();
+  cache_cinfo.pInitialData = initial_data.empty() ? nullptr : initial_data.data();
+  VkResult res = vkCreatePipelineCache(device_, &cache_cinfo, nullptr, &pipeline_cache);
+  if (res != VK_SUCCESS && !initial_data.empty()) {
+    // Start from an empty cache rather than fail on a bad file.
+    cache_cinfo.initialDataSize = 0;
+    cache_cinfo.pInitialData = nullptr;
+    res = vkCreatePipelineCache(device_, &cache_cinfo, nullptr, &pipeline_cache);
+  }
+  VULKAN_CHECK_ERROR(res);
+}
+
+void VulkanDevice::MarkPipelineCacheDirty() const {
+  std::lock_guard<std::mutex> lock(pipeline_cache_mutex);
+  pipeline_cache_dirty = true;
+}
+
+void VulkanDevice::SavePipelineCache() const {
+  std::lock_guard<std::mutex> lock(pipeline_cache_mutex);
+  if (!pipeline_cache_dirty || pipeline_cache_path.empty()) {
+    return;
+  }
+  pipeline_cache_dirty = false;
+
+  size_t size = 0;
+  if (vkGetPipelineCacheData(device_, pipeline_cache, &size, nullptr) != VK_SUCCESS || size == 0) {
+    return;
+  }
+  std::vector<char> data(size);
+  if (vkGetPipelineCacheData(device_, pipeline_cache, &size, data.data()) != VK_SUCCESS) {
+    return;
+  }
+
+  // Written to a temporary file renamed into place, so that the
+  // processes sharing the file never read a partial cache.
+  std::string tmp_path =
+      pipeline_cache_path + "." + std::to_string(std::random_device()()) + ".tmp";
+  {
+    std::ofstream fs(tmp_path, std::ios::out | std::ios::binary);
+    if (fs.fail()) {
+      LOG(WARNING) << "Cannot write the Vulkan pipeline cache file " << tmp_path;
+      return;
+    }
+    fs.write(data.data(), size);
+    if (fs.fail()) {
+      fs.close();
+      std::remove(tmp_path.c_str());
+      return;
+    }
+  }
+  if (std::rename(tmp_path.c_str(), pipeline_cache_path.c_str()) != 0) {
+    std::remove(tmp_path.c_str());
+  }
+}
+
 VulkanStream& VulkanDevice::ThreadLocalStream() {
   return const_cast<VulkanStream&>(const_cast<const VulkanDevice*>(this)->ThreadLocalStream());
 }
@@ -89,6 +89,7 @@ struct VulkanDeviceProperties {
   bool supports_dedicated_allocation{false};
   bool supports_integer_dot_product{false};
   bool supports_cooperative_matrix{false};
+  bool supports_cooperative_matrix_khr{false};
   uint32_t supported_subgroup_operations{0};
   uint32_t max_num_threads{1};
   uint32_t thread_warp_size{1};
@@ -233,6 +234,23 @@ class VulkanDevice {
 
   VkQueue Queue() const { return queue; }
 
+  /*! \brief The pipeline cache used to create the compute pipelines
+   *
+   * When TVM_VULKAN_PIPELINE_CACHE_DIR is set, the cache is loaded
+   * from a file of that directory named after the device and driver,
+   * so that the pipelines created by an earlier run are not compiled
+   * again.  The data written by another device or driver is ignored.
+   */
+  VkPipelineCache pipeline_cache{VK_NULL_HANDLE};
+
+  //! \brief Note that a pipeline was added to pipeline_cache.
+  void MarkPipelineCacheDirty() const;
+
+  /*! \brief Write pipeline_cache to its file, if pipelines were
+   * created since it was last written.
+   */
+  void SavePipelineCache() const;
+
  private:
   /*! \brief Helper function for move assignment/construction
    *
@@ -261,6 +279,9 @@ class VulkanDevice {
    */
   void CreateVkDevice(const VulkanInstance& instance);
 
+  //! \brief Create pipeline_cache, from its file when there is one.
+  void CreatePipelineCache();
+
   //! \brief Handle to the Vulkan API physical device
   VkPhysicalDevice physical_device_{nullptr};
 
@@ -299,6 +320,15 @@ class VulkanDevice {
 
   //! \brief The VulkanUniformBuffer for each CPU thread.
   ThreadMap<VulkanUniformBuffer> uniform_buffer_per_thread;
+
+  //! \brief The file of pipeline_cache, empty when it isn't saved
+  std::string pipeline_cache_path;
+
+  //! \brief Mutex to protect the saving of pipeline_cache
+  mutable std::mutex pipeline_cache_mutex;
+
+  //! \brief Whether pipelines were created since pipeline_cache was saved
+  mutable bool pipeline_cache_dirty{false};
 };
 
 uint32_t FindMemoryType(const VulkanDevice& device, VkBufferCreateInfo info,
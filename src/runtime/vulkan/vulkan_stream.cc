@@ -19,8 +19,11 @@
 
 #include "vulkan_stream.h"
 
+#include <algorithm>
+
 #include "../../support/utils.h"
 #include "vulkan_device.h"
+#include "vulkan_wrapped_func.h"
 
 namespace tvm {
 namespace runtime {
@@ -79,42 +82,41 @@ void VulkanStream::Launch(const std::function<void(VulkanStreamState*)>& kernel)
   }
 }
 
-void VulkanStream::LaunchDeferred(const std::function<void()>& deferred_initializer,
-                                  const std::function<void(VulkanStreamState*)>& deferred_kernel,
-                                  const VulkanStreamToken& deferred_token) {
+void VulkanStream::LaunchDeferred(
+    const std::shared_ptr<VulkanPipeline>& pipeline, const std::vector<VkBuffer>& buffers,
+    const std::function<void(VkDescriptorSet)>& deferred_initializer,
+    const std::function<void(VulkanStreamState*, VkDescriptorSet)>& deferred_kernel) {
   ICHECK(!device_->UseImmediate());
 
-  // If the new kernel uses the same descriptor set as one of the
-  // kernels already in the command buffer, we need to synchronize
-  // first.
-  if (std::any_of(deferred_tokens_[deferred_token.descriptor_set_].begin(),
-                  deferred_tokens_[deferred_token.descriptor_set_].end(),
-                  [&](const VulkanStreamToken& token) {
-                    DCHECK(token.descriptor_set_ == deferred_token.descriptor_set_);
-                    return token.descriptor_set_ == deferred_token.descriptor_set_ &&
-                           token.buffers_ != deferred_token.buffers_;
-                  })) {
+  // The scalar arguments in the uniform buffer are written when the
+  // command buffer is recorded, and read when it executes.  Only one
+  // kernel of a submission can use it.
+  if (pipeline->use_ubo && deferred_uses_ubo_) {
     Synchronize();
   }
 
-  // If the new kernel uses the same buffers in the same descriptor
-  // set as an already-queued kernel, we don't need to initialize it
-  // again.  Since every VulkanWrappedFunc owns a single descriptor
-  // set, unless the same function is called with the same buffer
-  // arguments, deferred_initializer() will always be called.
-  if (!std::any_of(deferred_tokens_[deferred_token.descriptor_set_].begin(),
-                   deferred_tokens_[deferred_token.descriptor_set_].end(),
-                   [&](const VulkanStreamToken& token) {
-                     DCHECK(token.descriptor_set_ == deferred_token.descriptor_set_);
-                     return token.descriptor_set_ == deferred_token.descriptor_set_ &&
-                            token.buffers_ == deferred_token.buffers_;
-                   })) {
-    deferred_initializer();
+  // If the new kernel uses the same buffers as an already-queued
+  // kernel of the pipeline, its descriptor set doesn't need to be
+  // initialized again.  Otherwise the kernel takes a new descriptor
+  // set of the pipeline, no synchronization is needed.
+  DeferredDescriptorSets& sets = deferred_tokens_[pipeline.get()];
+  sets.pipeline = pipeline;
+  auto it = std::find_if(sets.tokens.begin(), sets.tokens.end(),
+                         [&](const VulkanStreamToken& token) { return token.buffers_ == buffers; });
+  VkDescriptorSet descriptor_set;
+  if (it != sets.tokens.end()) {
+    descriptor_set = it->descriptor_set_;
+  } else {
+    descriptor_set = pipeline->AcquireDescriptorSet();
+    deferred_initializer(descriptor_set);
+    sets.tokens.push_back({descriptor_set, buffers});
   }
 
   // Save the kernel itself to be called later.
-  deferred_kernels_.push_back(deferred_kernel);
-  deferred_tokens_[deferred_token.descriptor_set_].push_back(deferred_token);
+  deferred_kernels_.push_back([deferred_kernel, descriptor_set](VulkanStreamState* state) {
+    deferred_kernel(state, descriptor_set);
+  });
+  deferred_uses_ubo_ |= pipeline->use_ubo;
 }
 
 void VulkanStream::Synchronize() {
@@ -123,7 +125,7 @@ void VulkanStream::Synchronize() {
       deferred_kernel(state_.get());
     }
     deferred_kernels_.clear();
-    deferred_tokens_.clear();
+    deferred_uses_ubo_ = false;
   } else {
     DCHECK_EQ(deferred_kernels_.size(), 0);
     DCHECK_EQ(deferred_tokens_.size(), 0);
@@ -156,6 +158,14 @@ void VulkanStream::Synchronize() {
   VULKAN_CALL(vkResetCommandBuffer(state_->cmd_buffer_, 0));
   VULKAN_CALL(vkResetFences(*device_, 1, &(state_->fence_)));
 
+  // The command buffer completed, its descriptor sets can be reused.
+  for (const auto& kv : deferred_tokens_) {
+    for (const VulkanStreamToken& token : kv.second.tokens) {
+      kv.second.pipeline->ReleaseDescriptorSet(token.descriptor_set_);
+    }
+  }
+  deferred_tokens_.clear();
+
   // Re-initialize the command buffer
   VkCommandBufferBeginInfo cb_begin;
   cb_begin.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -163,6 +173,8 @@ void VulkanStream::Synchronize() {
   cb_begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
   cb_begin.pInheritanceInfo = nullptr;
   VULKAN_CALL(vkBeginCommandBuffer(state_->cmd_buffer_, &cb_begin));
+
+  device_->SavePipelineCache();
 }
 
 }  // namespace vulkan
@@ -33,6 +33,7 @@ namespace runtime {
 namespace vulkan {
 
 class VulkanDevice;
+struct VulkanPipeline;
 
 class VulkanStreamState {
  public:
@@ -40,7 +41,7 @@ class VulkanStreamState {
   VkFence fence_;
 };
 
-// Used to identify state that should only be used once-per-stream.
+// The descriptor set of the kernels of a pipeline in the command buffer bound to buffers_.
 struct VulkanStreamToken {
   VkDescriptorSet descriptor_set_{VK_NULL_HANDLE};
   std::vector<VkBuffer> buffers_;
@@ -86,19 +87,28 @@ class VulkanStream {
    * kernel is delayed, and isn't pushed to the command buffer until
    * all kernels are collected.
    *
-   * \param deferred_initializer Updates the descriptor set.  Only
-   * called if the deferred_token has differences from
+   * The kernels of the pipeline already in the command buffer with
+   * the same buffers share their descriptor set.  Otherwise a free set
+   * is taken from the pipeline's pool and written by
+   * deferred_initializer, so that the kernels of a pipeline with
+   * different buffers are batched in the same submission.  The sets
+   * return to the pipeline once the command buffer completed.
+   *
+   * \param pipeline The pipeline of the kernel.
    *
-   * \param deferred_kernel Submits updates to the command buffer.
+   * \param buffers The buffers bound to the descriptor set of the
+   * kernel.
    *
-   * \param deferred_token Indicates which descriptor set and buffers
-   * are accessed by this kernel.  No two kernels in the command
-   * buffer can use the same descriptor set.
+   * \param deferred_initializer Updates the descriptor set.  Only
+   * called for a set newly taken from the pool.
    *
+   * \param deferred_kernel Submits updates to the command buffer,
+   * using the descriptor set.
    */
-  void LaunchDeferred(const std::function<void()>& deferred_initializer,
-                      const std::function<void(VulkanStreamState*)>& deferred_kernel,
-                      const VulkanStreamToken& deferred_token);
+  void LaunchDeferred(
+      const std::shared_ptr<VulkanPipeline>& pipeline, const std::vector<VkBuffer>& buffers,
+      const std::function<void(VkDescriptorSet)>& deferred_initializer,
+      const std::function<void(VulkanStreamState*, VkDescriptorSet)>& deferred_kernel);
 
   // reset profiler state
   void ProfilerReset() {
@@ -120,10 +130,16 @@ class VulkanStream {
  private:
   const VulkanDevice* device_;
   std::unique_ptr<VulkanStreamState> state_;
-  // An index of deferred tokens, allowing us to efficiently detect duplicated
-  // deferred_initializer blocks.
-  std::unordered_map<VkDescriptorSet, std::vector<VulkanStreamToken>> deferred_tokens_;
+  // The descriptor sets taken by the deferred kernels, by pipeline, allowing us to efficiently
+  // detect duplicated deferred_initializer blocks.
+  struct DeferredDescriptorSets {
+    std::shared_ptr<VulkanPipeline> pipeline;
+    std::vector<VulkanStreamToken> tokens;
+  };
+  std::unordered_map<const VulkanPipeline*, DeferredDescriptorSets> deferred_tokens_;
   std::vector<std::function<void(VulkanStreamState*)>> deferred_kernels_;
+  // Whether a deferred kernel reads the thread local uniform buffer.
+  bool deferred_uses_ubo_{false};
   VkCommandPool cmd_pool_;
   VulkanStreamProfiler* profiler_ = nullptr;
 };
@@ -21,6 +21,7 @@
 
 #include <dmlc/memory_io.h>
 
+#include <algorithm>
 #include <utility>
 
 #include "../file_utils.h"
@@ -113,13 +114,14 @@ void VulkanWrappedFunc::operator()(TVMArgs args, TVMRetValue* rv,
 
   // Otherwise, the more expensive deferred path.
   std::vector<ArgUnion64> pack_args_storage(pack_args, pack_args + num_pack_args_);
-  const auto& deferred_initializer = [&device, pipeline, descriptor_buffers]() {
+  const auto& deferred_initializer = [&device, pipeline,
+                                      descriptor_buffers](VkDescriptorSet descriptor_set) {
     std::vector<VkWriteDescriptorSet> write_descriptor_sets;
     write_descriptor_sets.resize(descriptor_buffers.size());
     for (size_t i = 0; i < write_descriptor_sets.size(); i++) {
       write_descriptor_sets[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
       write_descriptor_sets[i].pNext = nullptr;
-      write_descriptor_sets[i].dstSet = pipeline->descriptor_set;
+      write_descriptor_sets[i].dstSet = descriptor_set;
       write_descriptor_sets[i].dstBinding = i;
       write_descriptor_sets[i].dstArrayElement = 0;
       write_descriptor_sets[i].descriptorCount = 1;
@@ -137,14 +139,13 @@ void VulkanWrappedFunc::operator()(TVMArgs args, TVMRetValue* rv,
     vkUpdateDescriptorSets(device, write_descriptor_sets.size(), write_descriptor_sets.data(), 0,
                            nullptr);
   };
-  const auto& deferred_kernel = [this, pipeline, wl, pack_args_storage, nbytes_scalars,
-                                 device_id](VulkanStreamState* state) {
+  const auto& deferred_kernel = [this, pipeline, wl, pack_args_storage, nbytes_scalars, device_id](
+                                    VulkanStreamState* state, VkDescriptorSet descriptor_set) {
     auto& device = VulkanDeviceAPI::Global()->device(device_id);
 
     vkCmdBindPipeline(state->cmd_buffer_, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline->pipeline);
     vkCmdBindDescriptorSets(state->cmd_buffer_, VK_PIPELINE_BIND_POINT_COMPUTE,
-                            pipeline->pipeline_layout, 0, 1, &(pipeline->descriptor_set), 0,
-                            nullptr);
+                            pipeline->pipeline_layout, 0, 1, &descriptor_set, 0, nullptr);
 
     if (pipeline->use_ubo) {
       auto& ubo = device.ThreadLocalUniformBuffer(nbytes_scalars);
@@ -166,13 +167,12 @@ void VulkanWrappedFunc::operator()(TVMArgs args, TVMRetValue* rv,
                          VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
                          1, &barrier_info, 0, nullptr, 0, nullptr);
   };
-  VulkanStreamToken deferred_token;
-  deferred_token.descriptor_set_ = pipeline->descriptor_set;
-  deferred_token.buffers_.resize(descriptor_buffers.size());
+  std::vector<VkBuffer> buffers(descriptor_buffers.size());
   for (size_t i = 0; i < descriptor_buffers.size(); ++i) {
-    deferred_token.buffers_[i] = descriptor_buffers[i].buffer;
+    buffers[i] = descriptor_buffers[i].buffer;
   }
-  device.ThreadLocalStream().LaunchDeferred(deferred_initializer, deferred_kernel, deferred_token);
+  device.ThreadLocalStream().LaunchDeferred(pipeline, buffers, deferred_initializer,
+                                            deferred_kernel);
 
   if (device.UseDebugUtilsLabel()) {
     VkDebugUtilsLabelEXT dispatch_label = {VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT,
@@ -184,6 +184,45 @@ void VulkanWrappedFunc::operator()(TVMArgs args, TVMRetValue* rv,
   }
 }
 
+VkDescriptorSet VulkanPipeline::AcquireDescriptorSet() {
+  std::lock_guard<std::mutex> lock(descriptor_mutex);
+  if (free_descriptor_sets.empty()) {
+    uint32_t num_sets = 4u << std::min<size_t>(descriptor_pools.size(), 6);
+    std::vector<VkDescriptorPoolSize> pool_sizes = descriptor_pool_sizes;
+    for (auto& pool_size : pool_sizes) {
+      pool_size.descriptorCount *= num_sets;
+    }
+    VkDescriptorPoolCreateInfo descrip_pool_cinfo;
+    descrip_pool_cinfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    descrip_pool_cinfo.pNext = nullptr;
+    descrip_pool_cinfo.flags = 0;
+    descrip_pool_cinfo.maxSets = num_sets;
+    descrip_pool_cinfo.poolSizeCount = pool_sizes.size();
+    descrip_pool_cinfo.pPoolSizes = pool_sizes.data();
+    VkDescriptorPool descriptor_pool;
+    VULKAN_CALL(vkCreateDescriptorPool(*device, &descrip_pool_cinfo, nullptr, &descriptor_pool));
+    descriptor_pools.push_back(descriptor_pool);
+
+    std::vector<VkDescriptorSetLayout> set_layouts(num_sets, descriptor_set_layout);
+    VkDescriptorSetAllocateInfo alloc_info;
+    alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    alloc_info.pNext = nullptr;
+    alloc_info.descriptorPool = descriptor_pool;
+    alloc_info.descriptorSetCount = num_sets;
+    alloc_info.pSetLayouts = set_layouts.data();
+    free_descriptor_sets.resize(num_sets);
+    VULKAN_CALL(vkAllocateDescriptorSets(*device, &alloc_info, free_descriptor_sets.data()));
+  }
+  VkDescriptorSet descriptor_set = free_descriptor_sets.back();
+  free_descriptor_sets.pop_back();
+  return descriptor_set;
+}
+
+void VulkanPipeline::ReleaseDescriptorSet(VkDescriptorSet descriptor_set) {
+  std::lock_guard<std::mutex> lock(descriptor_mutex);
+  free_descriptor_sets.push_back(descriptor_set);
+}
+
 VulkanModuleNode::~VulkanModuleNode() {
   // cleanup vulkan related caches.
   for (size_t device_id = 0; device_id < ecache_.size(); ++device_id) {
@@ -198,7 +237,9 @@ VulkanModuleNode::~VulkanModuleNode() {
       }
       vkDestroyPipeline(device, pe->pipeline, nullptr);
       vkDestroyPipelineLayout(device, pe->pipeline_layout, nullptr);
-      vkDestroyDescriptorPool(device, pe->descriptor_pool, nullptr);
+      for (VkDescriptorPool descriptor_pool : pe->descriptor_pools) {
+        vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
+      }
       vkDestroyDescriptorSetLayout(device, pe->descriptor_set_layout, nullptr);
       vkDestroyShaderModule(device, pe->shader, nullptr);
     }
@@ -230,6 +271,7 @@ std::shared_ptr<VulkanPipeline> VulkanModuleNode::GetPipeline(size_t device_id,
   }
   // Create new pipeline
   auto pe = std::make_shared<VulkanPipeline>();
+  pe->device = &device;
   {
     // create shader
     auto sit = smap_.find(func_name);
@@ -320,23 +362,8 @@ std::shared_ptr<VulkanPipeline> VulkanModuleNode::GetPipeline(size_t device_id,
   }
 
   if (!device.UseImmediate()) {
-    VkDescriptorPoolCreateInfo descrip_pool_cinfo;
-    descrip_pool_cinfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    descrip_pool_cinfo.pNext = nullptr;
-    descrip_pool_cinfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
-    descrip_pool_cinfo.maxSets = 1;
-    descrip_pool_cinfo.poolSizeCount = descriptor_set_pool_sizes.size();
-    descrip_pool_cinfo.pPoolSizes = descriptor_set_pool_sizes.data();
-    VULKAN_CALL(
-        vkCreateDescriptorPool(device, &descrip_pool_cinfo, nullptr, &(pe->descriptor_pool)));
-
-    VkDescriptorSetAllocateInfo alloc_info;
-    alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    alloc_info.pNext = nullptr;
-    alloc_info.descriptorPool = pe->descriptor_pool;
-    alloc_info.descriptorSetCount = 1;
-    alloc_info.pSetLayouts = &(pe->descriptor_set_layout);
-    VULKAN_CALL(vkAllocateDescriptorSets(device, &alloc_info, &(pe->descriptor_set)));
+    // The descriptor sets are allocated from the pools of the pipeline at the launches.
+    pe->descriptor_pool_sizes = descriptor_set_pool_sizes;
   }
 
   VkPushConstantRange crange;
@@ -382,8 +409,9 @@ std::shared_ptr<VulkanPipeline> VulkanModuleNode::GetPipeline(size_t device_id,
   pipeline_cinfo.layout = pe->pipeline_layout;
   pipeline_cinfo.basePipelineHandle = VK_NULL_HANDLE;
   pipeline_cinfo.basePipelineIndex = 0;
-  VULKAN_CALL(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipeline_cinfo, nullptr,
+  VULKAN_CALL(vkCreateComputePipelines(device, device.pipeline_cache, 1, &pipeline_cinfo, nullptr,
                                        &(pe->pipeline)));
+  device.MarkPipelineCacheDirty();
 
   if (device.UseImmediate()) {
     VkDescriptorUpdateTemplateCreateInfoKHR descrip_template_cinfo;
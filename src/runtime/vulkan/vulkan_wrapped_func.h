@@ -43,12 +43,26 @@ struct VulkanPipeline {
   VulkanDevice* device{nullptr};
   VkShaderModule shader{VK_NULL_HANDLE};
   VkDescriptorSetLayout descriptor_set_layout{VK_NULL_HANDLE};
-  VkDescriptorPool descriptor_pool{VK_NULL_HANDLE};
-  VkDescriptorSet descriptor_set{VK_NULL_HANDLE};
   VkPipelineLayout pipeline_layout{VK_NULL_HANDLE};
   VkPipeline pipeline{VK_NULL_HANDLE};
   VkDescriptorUpdateTemplateKHR descriptor_update_template{VK_NULL_HANDLE};
   bool use_ubo{false};
+
+  /*! \brief Take a free descriptor set for a deferred launch, without push descriptors.
+   *
+   * The sets are allocated from pools created on demand, each one holding twice the sets of
+   * the previous one.  A set is owned by the stream of the launch until the command buffer
+   * using it completed, the stream then returns it with ReleaseDescriptorSet.
+   */
+  VkDescriptorSet AcquireDescriptorSet();
+  void ReleaseDescriptorSet(VkDescriptorSet descriptor_set);
+
+  // The descriptors of one set, by type.
+  std::vector<VkDescriptorPoolSize> descriptor_pool_sizes;
+  std::vector<VkDescriptorPool> descriptor_pools;
+  std::vector<VkDescriptorSet> free_descriptor_sets;
+  // Guards the descriptor pools and the free sets, the pipeline is shared by the streams.
+  std::mutex descriptor_mutex;
 };
 
 class VulkanModuleNode;
@@ -199,6 +199,10 @@
 #define TVM_INFO_USE_SORT "NOT-FOUND"
 #endif
 
+#ifndef TVM_INFO_USE_SPIRV_KHR_COOPERATIVE_MATRIX
+#define TVM_INFO_USE_SPIRV_KHR_COOPERATIVE_MATRIX "NOT-FOUND"
+#endif
+
 #ifndef TVM_INFO_USE_NNPACK
 #define TVM_INFO_USE_NNPACK "NOT-FOUND"
 #endif
@@ -340,6 +344,7 @@ TVM_DLL Map<String, String> GetLibInfo() {
       {"USE_RTTI", TVM_INFO_USE_RTTI},
       {"USE_RUST_EXT", TVM_INFO_USE_RUST_EXT},
       {"USE_SORT", TVM_INFO_USE_SORT},
+      {"USE_SPIRV_KHR_COOPERATIVE_MATRIX", TVM_INFO_USE_SPIRV_KHR_COOPERATIVE_MATRIX},
       {"USE_SPIRV_KHR_INTEGER_DOT_PRODUCT", TVM_INFO_USE_SPIRV_KHR_INTEGER_DOT_PRODUCT},
       {"USE_STACKVM_RUNTIME", TVM_INFO_USE_STACKVM_RUNTIME},
       {"USE_TARGET_ONNX", TVM_INFO_USE_TARGET_ONNX},
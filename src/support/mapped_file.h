@@ -0,0 +1,130 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file mapped_file.h
+ * \brief View of the content of a file, memory mapped where the platform allows it.
+ */
+#ifndef TVM_SUPPORT_MAPPED_FILE_H_
+#define TVM_SUPPORT_MAPPED_FILE_H_
+
+#include <tvm/runtime/logging.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace tvm {
+namespace support {
+
+/*!
+ * \brief Platform independent file mapping.
+ *
+ * The pages are mapped lazily with mmap on POSIX, so that a large file is only paged in as it is
+ * read. Elsewhere the file is read into memory.
+ *
+ * A copy-on-write mapping can be written to, the writes are private and never reach the file.
+ */
+class MappedFile {
+ public:
+  /*!
+   * \brief Map the file at the path.
+   * \param path The path of the file.
+   * \param copy_on_write Whether the mapped pages are writable, privately.
+   * \note good() is false if the file cannot be opened.
+   */
+  explicit MappedFile(const std::string& path, bool copy_on_write = false) {
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return;
+    struct stat st;
+    if (fstat(fd, &st) == 0) {
+      good_ = true;
+      size_ = static_cast<size_t>(st.st_size);
+      if (size_ != 0) {
+        int prot = copy_on_write ? PROT_READ | PROT_WRITE : PROT_READ;
+        void* addr = mmap(nullptr, size_, prot, MAP_PRIVATE, fd, 0);
+        ICHECK(addr != MAP_FAILED) << "Cannot map the file " << path;
+        data_ = static_cast<const char*>(addr);
+        mapped_ = true;
+      }
+    }
+    close(fd);
+#else
+    std::ifstream is(path, std::ios::binary);
+    if (!is.good()) return;
+    std::ostringstream os;
+    os << is.rdbuf();
+    buffer_ = os.str();
+    good_ = true;
+    data_ = buffer_.data();
+    size_ = buffer_.size();
+#endif
+  }
+
+  ~MappedFile() {
+#ifndef _WIN32
+    if (mapped_) munmap(const_cast<char*>(data_), size_);
+#endif
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  /*! \return Whether the file has been opened. */
+  bool good() const { return good_; }
+  /*! \return The content of the file. */
+  const char* data() const { return data_; }
+  /*! \return The size of the file in bytes. */
+  size_t size() const { return size_; }
+
+  /*!
+   * \brief Hint that a range will be read soon, so that the pages are read ahead asynchronously.
+   * \param offset The start of the range.
+   * \param size The size of the range.
+   */
+  void WillNeed(size_t offset, size_t size) const {
+#ifndef _WIN32
+    if (!mapped_ || offset >= size_) return;
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t begin = offset / page * page;
+    size_t end = std::min(offset + size, size_);
+    madvise(const_cast<char*>(data_) + begin, end - begin, MADV_WILLNEED);
+#endif
+  }
+
+ private:
+  bool good_{false};
+  bool mapped_{false};
+  const char* data_{nullptr};
+  size_t size_{0};
+  std::string buffer_;
+};
+
+}  // namespace support
+}  // namespace tvm
+#endif  // TVM_SUPPORT_MAPPED_FILE_H_
@@ -1395,6 +1395,31 @@ llvm::Value* CodeGenLLVM::CreateIntrinsic(const CallNode* op) {
     TypedPointer buffer_ptr = CreateBufferPtr(MakeValue(load->buffer->data), load->buffer->dtype,
                                               indices_val, load->dtype);
     return buffer_ptr.addr;
+  } else if (op->op.same_as(builtin::masked_load()) || op->op.same_as(builtin::masked_store())) {
+    // lowered by the backends to the masked vector accesses, the mask registers of AVX-512
+    bool is_load = op->op.same_as(builtin::masked_load());
+    ICHECK_EQ(op->args.size(), 3U);
+    DataType dtype = is_load ? op->dtype : op->args[1].dtype();
+    llvm::Type* type = DTypeToLLVMType(dtype);
+    llvm::Value* ptr = MakeValue(op->args[0]);
+    unsigned addrspace = llvm::dyn_cast<llvm::PointerType>(ptr->getType())->getAddressSpace();
+    ptr = builder_->CreatePointerCast(ptr, type->getPointerTo(addrspace));
+#if TVM_LLVM_VERSION >= 110
+    llvm::Align align(std::max(1, dtype.bits() / 8));
+    if (is_load) {
+      llvm::Value* mask = MakeValue(op->args[1]);
+      llvm::Value* passthru = MakeValue(op->args[2]);
+#if TVM_LLVM_VERSION >= 130
+      return builder_->CreateMaskedLoad(type, ptr, align, mask, passthru);
+#else
+      return builder_->CreateMaskedLoad(ptr, align, mask, passthru);
+#endif
+    }
+    builder_->CreateMaskedStore(MakeValue(op->args[1]), ptr, align, MakeValue(op->args[2]));
+    return ConstInt32(0);
+#else
+    LOG(FATAL) << op->op << " requires LLVM 11 or later";
+#endif
   } else if (op->op.same_as(builtin::reinterpret()) && is_zero(op->args[0])) {
     return llvm::Constant::getNullValue(t_void_p_);
   } else if (op->op.same_as(builtin::isnullptr())) {
@@ -29,6 +29,7 @@
 #include <llvm/ADT/SmallString.h>
 #include <llvm/ADT/StringRef.h>
 #include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/Config/llvm-config.h>
 #include <llvm/ExecutionEngine/ExecutionEngine.h>
 #include <llvm/ExecutionEngine/MCJIT.h>  // Force linking of MCJIT
 #include <llvm/IR/DataLayout.h>
@@ -40,14 +41,17 @@
 #include <llvm/IR/Metadata.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IRReader/IRReader.h>
+#include <llvm/Linker/Linker.h>
 #include <llvm/Support/FileSystem.h>
 #include <llvm/Support/Host.h>
+#include <llvm/Support/Process.h>
 #include <llvm/Support/SourceMgr.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/Target/TargetMachine.h>
 #include <llvm/Target/TargetOptions.h>
 #include <llvm/Transforms/Utils/Cloning.h>
 #include <tvm/ir/module.h>
+#include <tvm/ir/transform.h>
 #include <tvm/relay/runtime.h>
 #include <tvm/runtime/container/array.h>
 #include <tvm/runtime/container/string.h>
@@ -57,16 +61,21 @@
 #include <tvm/runtime/object.h>
 #include <tvm/runtime/packed_func.h>
 #include <tvm/runtime/registry.h>
+#include <tvm/support/parallel_for.h>
 #include <tvm/support/with.h>
 #include <tvm/target/codegen.h>
 #include <tvm/target/target.h>
+#include <tvm/tir/stmt_functor.h>
 
 #include <algorithm>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <numeric>
 #include <sstream>
 #include <string>
 #include <system_error>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -206,7 +215,7 @@ constexpr auto llvm_assembly_file_target = llvm::CodeGenFileType::AssemblyFile;
 #endif
 
 bool LLVMAddPassesToEmitFile(llvm::TargetMachine* tm, llvm::legacy::PassManager* pm,
-                             llvm::raw_fd_ostream* dest,
+                             llvm::raw_pwrite_stream* dest,
                              decltype(llvm_object_file_target) llvm_file_target) {
 #if TVM_LLVM_VERSION <= 60
   return tm->addPassesToEmitFile(*pm, *dest, llvm_file_target);
@@ -215,17 +224,134 @@ bool LLVMAddPassesToEmitFile(llvm::TargetMachine* tm, llvm::legacy::PassManager*
 #endif
 }
 
+/*!
+ * \brief The directory caching the emitted object files, keyed by their LLVM IR and target, empty
+ *  when the cache is disabled. A tuning session rebuilds many candidates whose host module does not
+ *  change, and shares the directory across its builder workers.
+ */
+std::string& ObjectCacheDir() {
+  static std::string dir;
+  return dir;
+}
+
+std::mutex& ObjectCacheMutex() {
+  static std::mutex mutex;
+  return mutex;
+}
+
+/*!
+ * \brief The cache key of an object, two independent 64-bit hashes of its IR, target and the LLVM
+ *  version, the objects of a directory reused across LLVM upgrades being emitted again.
+ */
+std::string ObjectCacheKey(const std::string& ir, const std::string& target) {
+  std::string data = std::string(LLVM_VERSION_STRING) + "\n" + target + "\n" + ir;
+  uint64_t fnv = 14695981039346656037ULL;
+  for (unsigned char c : data) {
+    fnv = (fnv ^ c) * 1099511628211ULL;
+  }
+  std::ostringstream os;
+  os << std::hex << std::hash<std::string>()(data) << "-" << fnv << "-" << data.size();
+  return os.str();
+}
+
+using FuncList = std::vector<std::pair<GlobalVar, PrimFunc>>;
+
+/*!
+ * \brief Partition the PrimFuncs of a module into at most num_partitions lists of about the same
+ *  size, to be compiled into separate LLVM modules. The functions calling each other stay in the
+ *  same list, as the functions without a global symbol are private to their LLVM module.
+ */
+std::vector<FuncList> PartitionFunctions(const IRModule& mod, int num_partitions) {
+  FuncList funcs;
+  for (const auto& [gvar, func] : mod->functions) {
+    if (auto prim_func = func.as<PrimFunc>()) funcs.emplace_back(gvar, prim_func.value());
+  }
+  // sorted, so that the partitions do not depend on the order of the map
+  std::sort(funcs.begin(), funcs.end(), [](const auto& a, const auto& b) {
+    return a.first->name_hint < b.first->name_hint;
+  });
+  std::unordered_map<const GlobalVarNode*, size_t> index;
+  for (size_t i = 0; i < funcs.size(); ++i) index[funcs[i].first.get()] = i;
+
+  std::vector<size_t> parent(funcs.size());
+  std::iota(parent.begin(), parent.end(), 0);
+  std::function<size_t(size_t)> find = [&](size_t i) {
+    return parent[i] == i ? i : parent[i] = find(parent[i]);
+  };
+  std::vector<int64_t> weight(funcs.size(), 0);
+  for (size_t i = 0; i < funcs.size(); ++i) {
+    PostOrderVisit(funcs[i].second->body, [&](const ObjectRef& node) {
+      ++weight[i];
+      if (const auto* call = node.as<CallNode>()) {
+        if (const auto* callee = call->op.as<GlobalVarNode>()) {
+          auto it = index.find(callee);
+          if (it != index.end()) parent[find(it->second)] = find(i);
+        }
+      }
+    });
+  }
+
+  std::vector<std::vector<size_t>> groups;
+  std::vector<int64_t> group_weight;
+  std::unordered_map<size_t, size_t> group_of_root;
+  for (size_t i = 0; i < funcs.size(); ++i) {
+    auto [it, inserted] = group_of_root.emplace(find(i), groups.size());
+    if (inserted) {
+      groups.emplace_back();
+      group_weight.push_back(0);
+    }
+    groups[it->second].push_back(i);
+    group_weight[it->second] += weight[i];
+  }
+  // the heaviest groups first, each to the lightest partition
+  std::vector<size_t> order(groups.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&](size_t a, size_t b) { return group_weight[a] > group_weight[b]; });
+  std::vector<FuncList> partitions(std::min<size_t>(num_partitions, groups.size()));
+  std::vector<int64_t> partition_weight(partitions.size(), 0);
+  for (size_t g : order) {
+    size_t p = std::min_element(partition_weight.begin(), partition_weight.end()) -
+               partition_weight.begin();
+    for (size_t i : groups[g]) partitions[p].push_back(funcs[i]);
+    partition_weight[p] += group_weight[g];
+  }
+  return partitions;
+}
+
 }  // namespace
 
 void LLVMModuleNode::SaveToFile(const String& file_name_str, const String& format) {
   // CHECK(imports_.empty()) << "SaveToFile does not handle imported modules";
   std::string file_name = file_name_str;
   std::string fmt = runtime::GetFileFormat(file_name, format);
+  bool is_obj_file = fmt == "o" || fmt == "obj";
+  bool is_asm_file = fmt == "s" || fmt == "asm";
+  std::string cache_file;
+  if (is_obj_file) {
+    std::string cache_dir;
+    {
+      std::lock_guard<std::mutex> lock(ObjectCacheMutex());
+      cache_dir = ObjectCacheDir();
+    }
+    if (!cache_dir.empty()) {
+      std::string ir;
+      llvm::raw_string_ostream rso(ir);
+      module_->print(rso, nullptr);
+      rso.flush();
+      std::string target = LLVMTarget::GetTargetMetadata(*module_);
+      cache_file = cache_dir + "/" + ObjectCacheKey(ir, target) + ".o";
+    }
+  }
+  if (!cache_file.empty() && llvm::sys::fs::exists(cache_file)) {
+    std::string data;
+    runtime::LoadBinaryFromFile(cache_file, &data);
+    runtime::SaveBinaryToFile(file_name, data);
+    return;
+  }
   std::error_code ecode;
   llvm::raw_fd_ostream dest(file_name, ecode, llvm_open_output_flag);
   ICHECK_EQ(ecode.value(), 0) << "Cannot open file: " << file_name << " " << ecode.message();
-  bool is_obj_file = fmt == "o" || fmt == "obj";
-  bool is_asm_file = fmt == "s" || fmt == "asm";
   if (is_obj_file || is_asm_file) {
     auto llvm_file_target = is_obj_file ? llvm_object_file_target : llvm_assembly_file_target;
 
@@ -233,10 +359,24 @@ void LLVMModuleNode::SaveToFile(const String& file_name_str, const String& forma
     llvm::legacy::PassManager pass;
     llvm::TargetMachine* tm = llvm_target->GetOrCreateTargetMachine();
 
-    auto err = LLVMAddPassesToEmitFile(tm, &pass, &dest, llvm_file_target);
+    llvm::SmallString<0> obj;
+    llvm::raw_svector_ostream obj_os(obj);
+    llvm::raw_pwrite_stream* os = cache_file.empty() ? static_cast<llvm::raw_pwrite_stream*>(&dest)
+                                                     : &obj_os;
+    auto err = LLVMAddPassesToEmitFile(tm, &pass, os, llvm_file_target);
     ICHECK(!err) << "Cannot emit target CGFT_ObjectFile";
 
     pass.run(*CloneLLVMModule(module_));
+    if (!cache_file.empty()) {
+      dest << obj.str();
+      // written aside and renamed, so that a concurrent build never reads a partial object
+      std::string tmp_file = cache_file + "." + std::to_string(llvm::sys::Process::getProcessId()) +
+                             ".tmp";
+      runtime::SaveBinaryToFile(tmp_file, obj.str().str());
+      if (llvm::sys::fs::rename(tmp_file, cache_file)) {
+        llvm::sys::fs::remove(tmp_file);
+      }
+    }
   } else if (fmt == "ll") {
     module_->print(dest, nullptr);
   } else if (fmt == "bc") {
@@ -302,7 +442,6 @@ void LLVMModuleNode::Init(const IRModule& mod, const Target& target) {
   llvm_instance_ = std::make_unique<LLVMInstance>();
   With<LLVMTarget> llvm_target(*llvm_instance_, target);
   llvm::TargetMachine* tm = llvm_target->GetOrCreateTargetMachine();
-  std::unique_ptr<CodeGenLLVM> cg = CodeGenLLVM::Create(llvm_target.get());
 
   std::string entry_func;
   relay::Runtime runtime =
@@ -338,16 +477,66 @@ void LLVMModuleNode::Init(const IRModule& mod, const Target& target) {
   // ICHECK(funcs.size() > 0);
   // TODO(tqchen): remove the entry function behavior as it does not
   // makes sense when we start to use multiple modules.
-  cg->Init("TVMMod", llvm_target.get(), system_lib_prefix, system_lib_prefix.defined(),
-           target_c_runtime);
-  cg->SetFastMathFlags(llvm_target->GetFastMathFlags());
-
-  cg->AddFunctionsOrdered(mod->functions.begin(), mod->functions.end());
-  if (entry_func.length() != 0) {
-    cg->AddMainFunction(entry_func);
+  auto build = [&](LLVMTarget* llvm_target, const FuncList& funcs) {
+    std::unique_ptr<CodeGenLLVM> cg = CodeGenLLVM::Create(llvm_target);
+    cg->Init("TVMMod", llvm_target, system_lib_prefix, system_lib_prefix.defined(),
+             target_c_runtime);
+    cg->SetFastMathFlags(llvm_target->GetFastMathFlags());
+
+    cg->AddFunctionsOrdered(funcs.begin(), funcs.end());
+    for (const auto& kv : funcs) {
+      if (entry_func.length() != 0 &&
+          kv.second->GetAttr<String>(tvm::attr::kGlobalSymbol).value_or("") == entry_func) {
+        cg->AddMainFunction(entry_func);
+      }
+    }
+    return cg->Finish();
+  };
+
+  // The partitions are optimized in parallel, each in its own LLVM context, and linked through
+  // bitcode. Only without LLVM options, as they are global state applied by each LLVMTarget.
+  int num_partitions = tvm::transform::PassContext::Current()
+                           ->GetConfig<Integer>("target.llvm.num_partitions", Integer(1))
+                           .value()
+                           ->value;
+  std::vector<FuncList> partitions;
+  if (num_partitions > 1 && llvm_target->GetCommandLineOptions().empty()) {
+    partitions = PartitionFunctions(mod, num_partitions);
+  }
+  if (partitions.size() > 1) {
+    std::vector<std::string> bitcode(partitions.size());
+    {
+      // created on this thread, as the LLVMTargets save and restore the global LLVM options
+      std::vector<std::unique_ptr<LLVMInstance>> instances;
+      std::vector<std::unique_ptr<LLVMTarget>> targets;
+      for (size_t i = 0; i < partitions.size(); ++i) {
+        instances.push_back(std::make_unique<LLVMInstance>());
+        targets.push_back(std::make_unique<LLVMTarget>(*instances.back(), target));
+      }
+      int num_tasks = static_cast<int>(partitions.size());
+      support::parallel_for_dynamic(0, num_tasks, num_tasks, [&](int thread_id, int i) {
+        std::unique_ptr<llvm::Module> partition = build(targets[i].get(), partitions[i]);
+        llvm::raw_string_ostream os(bitcode[i]);
+#if TVM_LLVM_VERSION <= 60
+        llvm::WriteBitcodeToFile(partition.get(), os);
+#else
+        llvm::WriteBitcodeToFile(*partition, os);
+#endif
+        os.flush();
+      });
+    }
+    module_owning_ptr_ = llvm_instance_->ParseIR(bitcode[0]);
+    for (size_t i = 1; i < bitcode.size(); ++i) {
+      ICHECK(!llvm::Linker::linkModules(*module_owning_ptr_, llvm_instance_->ParseIR(bitcode[i])))
+          << "Failed to link the partitions of the module";
+    }
+  } else {
+    FuncList funcs;
+    for (const auto& [gvar, func] : mod->functions) {
+      if (auto prim_func = func.as<PrimFunc>()) funcs.emplace_back(gvar, prim_func.value());
+    }
+    module_owning_ptr_ = build(llvm_target.get(), funcs);
   }
-
-  module_owning_ptr_ = cg->Finish();
   module_ = module_owning_ptr_.get();
   llvm_target->SetTargetMetadata(module_);
   module_->addModuleFlag(llvm::Module::Override, "Debug Info Version",
@@ -455,6 +644,8 @@ void* LLVMModuleNode::GetFunctionAddr(const std::string& name,
   }
 }
 
+TVM_REGISTER_PASS_CONFIG_OPTION("target.llvm.num_partitions", Integer);
+
 TVM_REGISTER_GLOBAL("target.build.llvm")
     .set_body_typed([](IRModule mod, Target target) -> runtime::Module {
       auto n = make_object<LLVMModuleNode>();
@@ -585,6 +776,15 @@ TVM_REGISTER_GLOBAL("target.target_has_feature")
       return llvm_target.TargetHasCPUFeature(feature);
     });
 
+TVM_REGISTER_GLOBAL("target.llvm_set_object_cache_dir").set_body_typed([](String dir) {
+  std::lock_guard<std::mutex> lock(ObjectCacheMutex());
+  if (!dir.empty()) {
+    std::error_code ecode = llvm::sys::fs::create_directories(std::string(dir));
+    ICHECK(!ecode) << "Cannot create the object cache directory " << dir << " " << ecode.message();
+  }
+  ObjectCacheDir() = dir;
+});
+
 TVM_REGISTER_GLOBAL("target.llvm_version_major").set_body_typed([]() -> int {
   return TVM_LLVM_VERSION / 10;
 });
@@ -36,6 +36,7 @@ namespace codegen {
 
 void CodeGenMetal::InitFuncState(const PrimFunc& f) {
   CodeGenC::InitFuncState(f);
+  simdgroup_dtype_.clear();
   // analyze the data;
   for (Var arg : f->params) {
     if (arg.dtype().is_handle()) {
@@ -308,11 +309,71 @@ void CodeGenMetal::VisitExpr_(const CallNode* op, std::ostream& os) {  // NOLINT
     os << ">(";
     this->PrintExpr(op->args[0], os);
     os << "))";
+  } else if (op->op.same_as(builtin::make_filled_simdgroup_matrix())) {
+    ICHECK_EQ(op->args.size(), 5U);
+    Var var = Downcast<Var>(op->args[0]);
+    auto it = simdgroup_dtype_.find(var.get());
+    ICHECK(it != simdgroup_dtype_.end())
+        << "Cannot find the metal.simdgroup allocation of " << var;
+    CheckSimdgroupShape(op->args[3], op->args[4]);
+    os << PrintExpr(var) << "[" << PrintExpr(op->args[1]) << "] = make_filled_simdgroup_matrix<"
+       << it->second << ", " << PrintExpr(op->args[3]) << ", " << PrintExpr(op->args[4]) << ">("
+       << PrintExpr(op->args[2]) << ")";
+  } else if (op->op.same_as(builtin::simdgroup_load()) ||
+             op->op.same_as(builtin::simdgroup_store())) {
+    ICHECK_EQ(op->args.size(), 7U);
+    CheckSimdgroupShape(op->args[4], op->args[5]);
+    os << (op->op.same_as(builtin::simdgroup_load()) ? "simdgroup_load(" : "simdgroup_store(")
+       << PrintExpr(op->args[0]) << "[" << PrintExpr(op->args[1]) << "], "
+       << PrintExpr(op->args[2]) << ", " << PrintExpr(op->args[3]) << ", ulong2(0, 0), "
+       << PrintExpr(op->args[6]) << ")";
+  } else if (op->op.same_as(builtin::simdgroup_multiply_accumulate())) {
+    ICHECK_EQ(op->args.size(), 8U);
+    os << "simdgroup_multiply_accumulate(";
+    for (int i = 0; i < 8; i += 2) {
+      if (i != 0) os << ", ";
+      os << PrintExpr(op->args[i]) << "[" << PrintExpr(op->args[i + 1]) << "]";
+    }
+    os << ")";
   } else {
     CodeGenC::VisitExpr_(op, os);
   }
 }
 
+void CodeGenMetal::VisitStmt_(const AllocateNode* op) {
+  if (GetPtrStorageScope(op->buffer_var) != "metal.simdgroup") {
+    CodeGenC::VisitStmt_(op);
+    return;
+  }
+  ICHECK(!is_zero(op->condition));
+  std::string vid = AllocVarID(op->buffer_var.get());
+  size_t constant_size = op->ConstantAllocationSize();
+  ICHECK(constant_size > 0 && constant_size % 64 == 0)
+      << "The metal.simdgroup allocation " << vid
+      << " must hold a whole number of 8x8 matrices, got " << constant_size << " elements";
+  ICHECK(op->dtype == DataType::Float(16) || op->dtype == DataType::Float(32))
+      << "Only float16 and float32 simdgroup matrices are supported, got " << op->dtype;
+  // A simdgroup matrix is distributed over the threads of the simdgroup, the allocation holds
+  // the matrices rather than their elements.
+  std::ostringstream dtype_os;
+  PrintType(op->dtype, dtype_os);
+  simdgroup_dtype_[op->buffer_var.get()] = dtype_os.str();
+  alloc_storage_scope_[op->buffer_var.get()] = "metal.simdgroup";
+
+  this->PrintIndent();
+  stream << "simdgroup_" << dtype_os.str() << "8x8 " << vid << '[' << constant_size / 64
+         << "];\n";
+  RegisterHandleType(op->buffer_var.get(), op->dtype);
+  this->PrintStmt(op->body);
+}
+
+void CodeGenMetal::CheckSimdgroupShape(const PrimExpr& col, const PrimExpr& row) {
+  const IntImmNode* col_imm = col.as<IntImmNode>();
+  const IntImmNode* row_imm = row.as<IntImmNode>();
+  ICHECK(col_imm && row_imm && col_imm->value == 8 && row_imm->value == 8)
+      << "Only the 8x8 simdgroup matrices are supported, got " << col << "x" << row;
+}
+
 void CodeGenMetal::VisitExpr_(const FloatImmNode* op, std::ostream& os) {  // NOLINT(*)
   std::ostringstream temp;
   if (std::isinf(op->value)) {
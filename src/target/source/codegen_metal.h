@@ -27,6 +27,7 @@
 #include <tvm/target/codegen.h>
 
 #include <string>
+#include <unordered_map>
 
 #include "codegen_c.h"
 
@@ -54,13 +55,19 @@ class CodeGenMetal final : public CodeGenC {
   void VisitExpr_(const BroadcastNode* op, std::ostream& os) final;  // NOLINT(*)
   void VisitExpr_(const CallNode* op, std::ostream& os) final;       // NOLINT(*)
   void VisitExpr_(const FloatImmNode* op, std::ostream& os) final;   // NOLINT(*)
+  void VisitStmt_(const AllocateNode* op) final;                     // NOLINT(*)
 
   // reuse parent's function.
   using CodeGenC::PrintType;
 
  private:
+  // Checks the shape of a simdgroup matrix intrinsic is 8x8, the only one metal supports.
+  void CheckSimdgroupShape(const PrimExpr& col, const PrimExpr& row);
+
   int thread_index_bits_{32};
   int thread_work_dim_{0};
+  // The element type of the simdgroup matrices allocated in metal.simdgroup scope.
+  std::unordered_map<const VarNode*, std::string> simdgroup_dtype_;
   Target target_;
 };
 }  // namespace codegen
@@ -29,6 +29,7 @@
 #include "../../runtime/opencl/opencl_module.h"
 #include "../../runtime/texture.h"
 #include "../../runtime/thread_storage_scope.h"
+#include "../../support/utils.h"
 #include "../build_common.h"
 #include "../spirv/spirv_utils.h"
 
@@ -131,6 +132,15 @@ std::string CodeGenOpenCL::Finish() {
                    "#pragma OPENCL EXTENSION cl_khr_global_int32_extended_atomics : enable\n\n";
   }
 
+  if (enable_subgroup_shuffle_) {
+    decl_stream << "#ifdef cl_khr_subgroup_shuffle\n"
+                   "#pragma OPENCL EXTENSION cl_khr_subgroup_shuffle : enable\n"
+                   "#endif\n"
+                   "#ifdef cl_khr_subgroup_shuffle_relative\n"
+                   "#pragma OPENCL EXTENSION cl_khr_subgroup_shuffle_relative : enable\n"
+                   "#endif\n\n";
+  }
+
   // Enable OpenCL 1.2 sampler-less texture reads, but utilize
   // provided sampler in OpenCL 2.0.
   if (enable_compliant_texture_reads_) {
@@ -465,6 +475,13 @@ void CodeGenOpenCL::VisitExpr_(const CallNode* op, std::ostream& os) {
       enable_atomics_ = true;
     }
     CodeGenC::VisitExpr_(op, os);
+  } else if (op->op.same_as(builtin_call_pure_extern_)) {
+    auto func = Downcast<StringImm>(op->args[0]);
+    // Enable the subgroup shuffle extensions if used.
+    if (support::StartsWith(func->value, "sub_group_shuffle")) {
+      enable_subgroup_shuffle_ = true;
+    }
+    CodeGenC::VisitExpr_(op, os);
   } else {
     CodeGenC::VisitExpr_(op, os);
   }
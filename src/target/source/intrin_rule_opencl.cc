@@ -113,6 +113,37 @@ static PrimExpr DispatchIntelShuffle(const PrimExpr& e) {
 TVM_REGISTER_OP("tir.tvm_warp_shuffle")
     .set_attr<FLowerIntrinsic>("opencl.FLowerIntrinsic", DispatchIntelShuffle);
 
+// The targets with -supports_subgroup_shuffle use the shuffles of cl_khr_subgroup_shuffle and
+// cl_khr_subgroup_shuffle_relative instead, which the Adreno, Mali and Intel drivers expose.
+static PrimExpr DispatchSubgroupShuffle(const PrimExpr& e) {
+  const CallNode* call = e.as<CallNode>();
+  ICHECK(call != nullptr);
+  ICHECK_EQ(call->args.size(), 5);  // mask, value, warp_id, width, warp_size
+  arith::Analyzer analyzer;
+  ICHECK(analyzer.CanProve(call->args[3] == call->args[4]))
+      << "OpenCL subgroup shuffle does not support width != warp_size";
+  const char* name;
+  if (call->op.same_as(builtin::tvm_warp_shuffle())) {
+    name = "sub_group_shuffle";
+  } else if (call->op.same_as(builtin::tvm_warp_shuffle_up())) {
+    name = "sub_group_shuffle_up";
+  } else {
+    ICHECK(call->op.same_as(builtin::tvm_warp_shuffle_down()));
+    name = "sub_group_shuffle_down";
+  }
+  Array<PrimExpr> opencl_args{{StringImm(name), call->args[1], call->args[2]}};
+  return Call(call->dtype, builtin::call_pure_extern(), opencl_args);
+}
+
+TVM_REGISTER_OP("tir.tvm_warp_shuffle")
+    .set_attr<FLowerIntrinsic>("opencl.subgroup.FLowerIntrinsic", DispatchSubgroupShuffle);
+
+TVM_REGISTER_OP("tir.tvm_warp_shuffle_up")
+    .set_attr<FLowerIntrinsic>("opencl.subgroup.FLowerIntrinsic", DispatchSubgroupShuffle);
+
+TVM_REGISTER_OP("tir.tvm_warp_shuffle_down")
+    .set_attr<FLowerIntrinsic>("opencl.subgroup.FLowerIntrinsic", DispatchSubgroupShuffle);
+
 }  // namespace intrin
 }  // namespace codegen
 }  // namespace tvm
@@ -430,12 +430,8 @@ spirv::Value CodeGenSPIRV::VisitExpr_(const CallNode* op) {
     spirv::Value dst_ptr =
         builder_->StructArrayAccess(dst_ptr_type, var_map_[buffer_node], MakeValue(dst_index));
     spirv::Value src_ptr = VisitExpr(op->args[5]);
-    spirv::SType type_bool = builder_->GetSType(DataType::UInt(1));
-    spirv::Value t_val = builder_->UIntImm(type_bool, 1);
-    spirv::Value f_val = builder_->UIntImm(type_bool, 0);
-    spirv::Value loaded =
-        builder_->MakeValue(spv::OpCooperativeMatrixLoadNV, fragment_type, src_ptr, stride_val,
-                            (layout != "row_major") ? t_val : f_val);
+    spirv::Value loaded = builder_->CooperativeMatrixLoad(fragment_type, src_ptr, stride_val,
+                                                          layout != "row_major");
     builder_->MakeInst(spv::OpStore, dst_ptr, loaded, spv::MemoryAccessMaskNone);
     return spirv::Value();
   } else if (op->op.same_as(builtin::tvm_mma_sync())) {
@@ -471,8 +467,8 @@ spirv::Value CodeGenSPIRV::VisitExpr_(const CallNode* op) {
     spirv::Value loaded_a = builder_->MakeValue(spv::OpLoad, fragment_type_a, ptr_a, mask);
     spirv::Value loaded_b = builder_->MakeValue(spv::OpLoad, fragment_type_b, ptr_b, mask);
     spirv::Value loaded_c = builder_->MakeValue(spv::OpLoad, fragment_type_c, ptr_c, mask);
-    spirv::Value result = builder_->MakeValue(spv::OpCooperativeMatrixMulAddNV, fragment_type_d,
-                                              loaded_a, loaded_b, loaded_c);
+    spirv::Value result =
+        builder_->CooperativeMatrixMulAdd(fragment_type_d, loaded_a, loaded_b, loaded_c);
     builder_->MakeInst(spv::OpStore, ptr_d, result, spv::MemoryAccessMaskNone);
     return spirv::Value();
   } else if (op->op.same_as(builtin::tvm_store_matrix_sync())) {
@@ -492,11 +488,7 @@ spirv::Value CodeGenSPIRV::VisitExpr_(const CallNode* op) {
         builder_->StructArrayAccess(ptr_type, var_map_[buffer_node], MakeValue(index));
     uint32_t mask = spv::MemoryAccessMaskNone;
     spirv::Value loaded = builder_->MakeValue(spv::OpLoad, fragment_type, ptr, mask);
-    spirv::SType type_bool = builder_->GetSType(DataType::UInt(1));
-    spirv::Value t_val = builder_->UIntImm(type_bool, 1);
-    spirv::Value f_val = builder_->UIntImm(type_bool, 0);
-    builder_->MakeInst(spv::OpCooperativeMatrixStoreNV, dst_ptr, loaded, stride_val,
-                       (layout != "row_major") ? t_val : f_val);
+    builder_->CooperativeMatrixStore(dst_ptr, loaded, stride_val, layout != "row_major");
     return spirv::Value();
   } else if (op->op.same_as(builtin::address_of())) {
     const BufferLoadNode* load = op->args[0].as<BufferLoadNode>();
@@ -890,7 +882,13 @@ spirv::SType CodeGenSPIRV::GetFragmentSType(const VarNode* buffer, const DataTyp
   const std::string& shape_str = fragment_info_.at(buffer).shape;
   std::pair<int32_t, int32_t> dim = GetWmmaFragmentDimSize(shape_str, scope);
   int64_t size = dim.first * dim.second;
-  spirv::SType stype = builder_->GetSType(dtype.with_lanes(size), dim.first, dim.second);
+  spirv::MatrixUse use = spirv::MatrixUse::kAccumulator;
+  if (scope == "wmma.matrix_a") {
+    use = spirv::MatrixUse::kMatrixA;
+  } else if (scope == "wmma.matrix_b") {
+    use = spirv::MatrixUse::kMatrixB;
+  }
+  spirv::SType stype = builder_->GetSType(dtype.with_lanes(size), dim.first, dim.second, use);
   fragment_info_[buffer].stype = stype;
   return stype;
 }
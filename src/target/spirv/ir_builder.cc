@@ -60,7 +60,12 @@ void IRBuilder::InitHeader() {
   }
 #endif
 
-  if (spirv_support_.supports_cooperative_matrix) {
+  if (UseKHRCooperativeMatrix()) {
+#ifdef TVM_SPIRV_KHR_COOPERATIVE_MATRIX
+    capabilities_used_.insert(spv::CapabilityCooperativeMatrixKHR);
+    extensions_used_.insert("SPV_KHR_cooperative_matrix");
+#endif
+  } else if (spirv_support_.supports_cooperative_matrix) {
     capabilities_used_.insert(spv::CapabilityCooperativeMatrixNV);
     extensions_used_.insert("SPV_NV_cooperative_matrix");
   }
@@ -112,7 +117,7 @@ std::vector<uint32_t> IRBuilder::Finalize() {
   return data;
 }
 
-SType IRBuilder::GetSType(const DataType& dtype, uint32_t row, uint32_t col) {
+SType IRBuilder::GetSType(const DataType& dtype, uint32_t row, uint32_t col, MatrixUse use) {
   if (dtype == DataType::Int(32)) {
     return t_int32_;
   } else if (dtype == DataType::UInt(1)) {
@@ -131,13 +136,16 @@ SType IRBuilder::GetSType(const DataType& dtype, uint32_t row, uint32_t col) {
   } else {
     type_key |= static_cast<uint64_t>(row) << 32U;
     type_key |= static_cast<uint64_t>(col) << 40U;
+    if (UseKHRCooperativeMatrix()) {
+      type_key |= static_cast<uint64_t>(use) << 48U;
+    }
   }
 
   auto it = pod_type_tbl_.find(type_key);
   if (it != pod_type_tbl_.end()) {
     return it->second;
   }
-  SType t = DeclareType(dtype, row, col);
+  SType t = DeclareType(dtype, row, col, use);
   pod_type_tbl_[type_key] = t;
   return t;
 }
@@ -494,7 +502,7 @@ Value IRBuilder::GetConst_(const SType& dtype, const uint64_t* pvalue) {
   return ret;
 }
 
-SType IRBuilder::DeclareType(const DataType& dtype, uint32_t row, uint32_t col) {
+SType IRBuilder::DeclareType(const DataType& dtype, uint32_t row, uint32_t col, MatrixUse use) {
   AddCapabilityFor(dtype);
 
   if (dtype.lanes() == 1) {
@@ -523,7 +531,28 @@ SType IRBuilder::DeclareType(const DataType& dtype, uint32_t row, uint32_t col)
     if (row * col == 0) {
       ICHECK((row == 0) && (col == 0));
       ib_.Begin(spv::OpTypeVector).AddSeq(t, base_type, dtype.lanes()).Commit(&global_);
+    } else if (UseKHRCooperativeMatrix()) {
+#ifdef TVM_SPIRV_KHR_COOPERATIVE_MATRIX
+      SType t_uint32 = GetSType(DataType::UInt(32));
+      spv::CooperativeMatrixUse spv_use = spv::CooperativeMatrixUseMatrixAccumulatorKHR;
+      if (use == MatrixUse::kMatrixA) {
+        spv_use = spv::CooperativeMatrixUseMatrixAKHR;
+      } else if (use == MatrixUse::kMatrixB) {
+        spv_use = spv::CooperativeMatrixUseMatrixBKHR;
+      }
+      ib_.Begin(spv::OpTypeCooperativeMatrixKHR)
+          .AddSeq(t, base_type, UIntImm(t_uint32, spv::ScopeSubgroup), UIntImm(t_uint32, row),
+                  UIntImm(t_uint32, col), UIntImm(t_uint32, spv_use))
+          .Commit(&global_);
+#endif
     } else {
+      ICHECK(spirv_support_.supports_cooperative_matrix)
+          << "Vulkan target does not support cooperative matrices.  "
+          << "If your device supports VK_NV_cooperative_matrix or VK_KHR_cooperative_matrix, "
+          << "please either add -supports_cooperative_matrix=1 or "
+          << "-supports_cooperative_matrix_khr=1 to the target, "
+          << "or query all device parameters by adding -from_device=0.  "
+          << "The KHR cooperative matrices need USE_SPIRV_KHR_COOPERATIVE_MATRIX in config.cmake.";
       Value v_row = GetSpecConst(GetSType(DataType::UInt(32)), row);
       Value v_col = GetSpecConst(GetSType(DataType::UInt(32)), col);
       Value scope = UIntImm(GetSType(DataType::UInt(32)), spv::ScopeSubgroup);
@@ -641,6 +670,54 @@ Value IRBuilder::CallGLSL450(const SType& ret_type, uint32_t inst_id,
   return val;
 }
 
+bool IRBuilder::UseKHRCooperativeMatrix() const {
+#ifdef TVM_SPIRV_KHR_COOPERATIVE_MATRIX
+  return spirv_support_.supports_cooperative_matrix_khr;
+#else
+  return false;
+#endif
+}
+
+Value IRBuilder::CooperativeMatrixLoad(const SType& matrix_type, Value ptr, Value stride,
+                                       bool column_major) {
+#ifdef TVM_SPIRV_KHR_COOPERATIVE_MATRIX
+  if (UseKHRCooperativeMatrix()) {
+    Value layout = UIntImm(t_uint32_, column_major ? spv::CooperativeMatrixLayoutColumnMajorKHR
+                                                   : spv::CooperativeMatrixLayoutRowMajorKHR);
+    return MakeValue(spv::OpCooperativeMatrixLoadKHR, matrix_type, ptr, layout, stride);
+  }
+#endif
+  return MakeValue(spv::OpCooperativeMatrixLoadNV, matrix_type, ptr, stride,
+                   UIntImm(t_bool_, column_major));
+}
+
+void IRBuilder::CooperativeMatrixStore(Value ptr, Value matrix, Value stride, bool column_major) {
+#ifdef TVM_SPIRV_KHR_COOPERATIVE_MATRIX
+  if (UseKHRCooperativeMatrix()) {
+    Value layout = UIntImm(t_uint32_, column_major ? spv::CooperativeMatrixLayoutColumnMajorKHR
+                                                   : spv::CooperativeMatrixLayoutRowMajorKHR);
+    MakeInst(spv::OpCooperativeMatrixStoreKHR, ptr, matrix, layout, stride);
+    return;
+  }
+#endif
+  MakeInst(spv::OpCooperativeMatrixStoreNV, ptr, matrix, stride, UIntImm(t_bool_, column_major));
+}
+
+Value IRBuilder::CooperativeMatrixMulAdd(const SType& result_type, Value a, Value b, Value c) {
+#ifdef TVM_SPIRV_KHR_COOPERATIVE_MATRIX
+  if (UseKHRCooperativeMatrix()) {
+    // The signedness of the components is given by the Cooperative Matrix Operands.
+    uint32_t operands = 0;
+    if (a.stype.type.is_int()) operands |= 0x1;  // MatrixASignedComponentsKHR
+    if (b.stype.type.is_int()) operands |= 0x2;  // MatrixBSignedComponentsKHR
+    if (c.stype.type.is_int()) operands |= 0x4;  // MatrixCSignedComponentsKHR
+    if (result_type.type.is_int()) operands |= 0x8;  // MatrixResultSignedComponentsKHR
+    return MakeValue(spv::OpCooperativeMatrixMulAddKHR, result_type, a, b, c, operands);
+  }
+#endif
+  return MakeValue(spv::OpCooperativeMatrixMulAddNV, result_type, a, b, c);
+}
+
 Value IRBuilder::CallKHRIntegerDotProduct(const SType& ret_type, const std::vector<Value>& args,
                                           const DataType& dtype) {
   if (args.size() != 3) {
@@ -69,6 +69,18 @@ enum ValueKind {
   kSpecConst,
 };
 
+/*!
+ * \brief The use of a cooperative matrix type.
+ *
+ *  SPV_NV_cooperative_matrix has one type for all the operands of a multiply-add, while the
+ *  types of SPV_KHR_cooperative_matrix are specific to the operand they are used as.
+ */
+enum class MatrixUse : uint32_t {
+  kMatrixA,
+  kMatrixB,
+  kAccumulator,
+};
+
 /*! \brief Represent the SPIRV Value */
 struct Value {
   /*! \brief The Id to represent value */
@@ -442,9 +454,39 @@ class IRBuilder {
   /*!
    * \brief Get the spirv type for a given tvm data type.
    * \param dtype The data type.
+   * \param row The rows of a cooperative matrix type, or 0.
+   * \param col The columns of a cooperative matrix type, or 0.
+   * \param use The use of a cooperative matrix type, which only the KHR types depend on.
    * \return The corresponding spirv type.
    */
-  SType GetSType(const tvm::DataType& dtype, uint32_t row = 0, uint32_t col = 0);
+  SType GetSType(const tvm::DataType& dtype, uint32_t row = 0, uint32_t col = 0,
+                 MatrixUse use = MatrixUse::kAccumulator);
+  /*! \return Whether the cooperative matrices use SPV_KHR_cooperative_matrix, not the NV one. */
+  bool UseKHRCooperativeMatrix() const;
+  /*!
+   * \brief Load a cooperative matrix.
+   * \param matrix_type The cooperative matrix type.
+   * \param ptr The pointer to the first element.
+   * \param stride The elements between the rows (or columns) in memory.
+   * \param column_major Whether the matrix is column major in memory.
+   * \return The loaded matrix.
+   */
+  Value CooperativeMatrixLoad(const SType& matrix_type, Value ptr, Value stride,
+                              bool column_major);
+  /*!
+   * \brief Store a cooperative matrix.
+   * \param ptr The pointer to the first element.
+   * \param matrix The matrix.
+   * \param stride The elements between the rows (or columns) in memory.
+   * \param column_major Whether the matrix is column major in memory.
+   */
+  void CooperativeMatrixStore(Value ptr, Value matrix, Value stride, bool column_major);
+  /*!
+   * \brief Multiply-add cooperative matrices, a * b + c.
+   * \param result_type The type of the result, the type of c.
+   * \return The result.
+   */
+  Value CooperativeMatrixMulAdd(const SType& result_type, Value a, Value b, Value c);
   /*!
    * \brief Get the pointer type that points to value_type
    * \param value_type.
@@ -656,7 +698,8 @@ class IRBuilder {
   Value GetConst_(const SType& dtype, const uint64_t* pvalue);
 
   // declare type
-  SType DeclareType(const DataType& dtype, uint32_t row = 0, uint32_t col = 0);
+  SType DeclareType(const DataType& dtype, uint32_t row = 0, uint32_t col = 0,
+                    MatrixUse use = MatrixUse::kAccumulator);
 
   // Declare the appropriate SPIR-V capabilities and extensions to use
   // this data type.
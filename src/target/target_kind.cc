@@ -365,6 +365,10 @@ TVM_REGISTER_TARGET_KIND("opencl", kDLOpenCL)
     .add_attr_option<Integer>("max_num_threads", Integer(256))
     .add_attr_option<Integer>("thread_warp_size", Integer(1))
     .add_attr_option<Integer>("texture_spatial_limit", Integer(16384))
+    // Whether the device has cl_khr_subgroup_shuffle and cl_khr_subgroup_shuffle_relative, in
+    // which case the reductions over threadIdx.x use subgroup shuffles. thread_warp_size must
+    // then be the subgroup size of the kernels.
+    .add_attr_option<Bool>("supports_subgroup_shuffle")
     // Faced that Qualcomm OpenCL runtime crashed without any error message in
     // the case when the number of kernel arguments was pretty big. OpenCL doesn't
     // specify any limitations on the number of kernel arguments. max_function_args
@@ -402,6 +406,7 @@ TVM_REGISTER_TARGET_KIND("vulkan", kDLVulkan)
     .add_attr_option<Bool>("supports_dedicated_allocation")
     .add_attr_option<Bool>("supports_integer_dot_product")
     .add_attr_option<Bool>("supports_cooperative_matrix")
+    .add_attr_option<Bool>("supports_cooperative_matrix_khr")
     .add_attr_option<Integer>("supported_subgroup_operations")
     // Physical device limits
     .add_attr_option<Integer>("max_num_threads", Integer(256))
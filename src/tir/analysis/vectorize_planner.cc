@@ -0,0 +1,220 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file tir/analysis/vectorize_planner.cc
+ * \brief Plan the vectorization of a loop from the buffer accesses of its body.
+ */
+#include <tvm/arith/analyzer.h>
+#include <tvm/arith/pattern.h>
+#include <tvm/runtime/registry.h>
+#include <tvm/tir/analysis.h>
+#include <tvm/tir/builtin.h>
+#include <tvm/tir/op_attr_types.h>
+#include <tvm/tir/stmt_functor.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace tvm {
+namespace tir {
+
+namespace {
+
+/*! \brief An access of the loop body whose index is contiguous in the loop variable. */
+struct ContiguousAccess {
+  Buffer buffer;
+  /*! \brief The flat element offset accessed at the first iteration of the loop. */
+  PrimExpr base;
+};
+
+/*!
+ * \brief Collects the accesses of the body of an innermost loop, with the block iterators and the
+ *  let-bound variables substituted, and whether the body can be vectorized at all.
+ */
+class VectorAccessCollector : public StmtExprVisitor {
+ public:
+  explicit VectorAccessCollector(const For& loop) : loop_(loop) {}
+
+  bool Collect() {
+    VisitStmt(loop_->body);
+    return vectorizable_;
+  }
+
+  std::vector<ContiguousAccess> accesses;
+  /*! \brief The widest element type accessed in the loop, in bits. */
+  int max_bits = 0;
+
+ private:
+  void VisitStmt_(const ForNode* op) final { vectorizable_ = false; }
+  void VisitStmt_(const WhileNode* op) final { vectorizable_ = false; }
+  void VisitStmt_(const AllocateNode* op) final { vectorizable_ = false; }
+
+  void VisitStmt_(const LetStmtNode* op) final {
+    bindings_.Set(op->var, Substitute(op->value, bindings_));
+    StmtExprVisitor::VisitStmt_(op);
+  }
+
+  void VisitExpr_(const LetNode* op) final {
+    bindings_.Set(op->var, Substitute(op->value, bindings_));
+    StmtExprVisitor::VisitExpr_(op);
+  }
+
+  void VisitStmt_(const BlockRealizeNode* op) final {
+    const Block& block = op->block;
+    for (size_t i = 0; i < block->iter_vars.size(); ++i) {
+      PrimExpr binding = Substitute(op->iter_values[i], bindings_);
+      // The iterations of a reduction over the loop are not independent.
+      if (block->iter_vars[i]->iter_type != IterVarType::kDataPar && UsesLoopVar(binding)) {
+        vectorizable_ = false;
+      }
+      bindings_.Set(block->iter_vars[i]->var, binding);
+    }
+    StmtExprVisitor::VisitStmt_(op);
+  }
+
+  void VisitExpr_(const BufferLoadNode* op) final {
+    Record(op->buffer, op->indices, /*is_store=*/false);
+    StmtExprVisitor::VisitExpr_(op);
+  }
+
+  void VisitStmt_(const BufferStoreNode* op) final {
+    Record(op->buffer, op->indices, /*is_store=*/true);
+    StmtExprVisitor::VisitStmt_(op);
+  }
+
+  void VisitExpr_(const CallNode* op) final {
+    static auto op_call_effect = Op::GetAttrMap<TCallEffectKind>("TCallEffectKind");
+    // The external calls and the calls with side effects are scalarized by VectorizeLoop.
+    if (auto* ptr = op->op.as<OpNode>()) {
+      Op call_op = GetRef<Op>(ptr);
+      if (call_op.same_as(builtin::call_extern()) || call_op.same_as(builtin::call_pure_extern()) ||
+          call_op.same_as(builtin::call_llvm_intrin()) ||
+          call_op.same_as(builtin::call_llvm_pure_intrin()) ||
+          op_call_effect.get(call_op, Integer(static_cast<int>(CallEffectKind::kOpaque)))
+                  ->value > static_cast<int>(CallEffectKind::kReadState)) {
+        vectorizable_ = false;
+      }
+    } else {
+      vectorizable_ = false;
+    }
+    StmtExprVisitor::VisitExpr_(op);
+  }
+
+  bool UsesLoopVar(const PrimExpr& expr) const {
+    const VarNode* loop_var = loop_->loop_var.get();
+    return UsesVar(expr, [loop_var](const VarNode* var) { return var == loop_var; });
+  }
+
+  void Record(const Buffer& buffer, const Array<PrimExpr>& indices, bool is_store) {
+    if (buffer->dtype.lanes() != 1) {
+      vectorizable_ = false;
+      return;
+    }
+    Array<PrimExpr> substituted;
+    bool uses_loop_var = false;
+    for (const PrimExpr& index : indices) {
+      substituted.push_back(Substitute(index, bindings_));
+      uses_loop_var = uses_loop_var || UsesLoopVar(substituted.back());
+    }
+    if (!uses_loop_var) {
+      // A load invariant in the loop is broadcast, a store is a conflict between the lanes.
+      if (is_store) vectorizable_ = false;
+      return;
+    }
+    max_bits = std::max(max_bits, buffer->dtype.bits());
+    PrimExpr offset = buffer.OffsetOf(substituted).back();
+    Array<PrimExpr> coeffs = arith::DetectLinearEquation(offset, {loop_->loop_var});
+    if (coeffs.size() != 2 || !is_one(analyzer_.Simplify(coeffs[0]))) {
+      // Strided or gathered accesses.
+      vectorizable_ = false;
+      return;
+    }
+    PrimExpr base = analyzer_.Simplify(coeffs[1] + loop_->min);
+    // The alignment of the base is checked before the loop, it can't depend on the memory.
+    bool reads_memory = false;
+    PostOrderVisit(base, [&reads_memory](const ObjectRef& node) {
+      if (node->IsInstance<BufferLoadNode>()) reads_memory = true;
+    });
+    if (reads_memory) {
+      vectorizable_ = false;
+      return;
+    }
+    accesses.push_back({buffer, base});
+  }
+
+  const For& loop_;
+  Map<Var, PrimExpr> bindings_;
+  arith::Analyzer analyzer_;
+  bool vectorizable_ = true;
+};
+
+}  // namespace
+
+VectorizePlan PlanVectorize(const For& loop, int max_vector_bits, bool allow_runtime_checks) {
+  VectorizePlan plan;
+  plan.lanes = 1;
+  const int64_t* extent = as_const_int(loop->extent);
+  if (extent == nullptr || *extent <= 1) return plan;
+  VectorAccessCollector collector(loop);
+  if (!collector.Collect() || collector.accesses.empty()) return plan;
+
+  int lanes = 1;
+  while (lanes * 2 * collector.max_bits <= max_vector_bits) lanes *= 2;
+  arith::Analyzer analyzer;
+  for (; lanes > 1; lanes /= 2) {
+    if (*extent % lanes != 0) continue;
+    Array<PrimExpr> checks;
+    bool aligned = true;
+    for (const ContiguousAccess& access : collector.accesses) {
+      // The vectors are aligned if the data is, and if the first one starts at a multiple of the
+      // lanes: the next ones are lanes further.
+      int64_t vector_bytes = static_cast<int64_t>(lanes) * access.buffer->dtype.bytes();
+      if (access.buffer->data_alignment % vector_bytes != 0) {
+        aligned = false;
+        break;
+      }
+      PrimExpr check = analyzer.Simplify(floormod(access.base, lanes) == 0);
+      if (is_one(check)) continue;
+      if (!allow_runtime_checks || is_const_int(access.base)) {
+        aligned = false;
+        break;
+      }
+      bool duplicate = std::any_of(checks.begin(), checks.end(), [&check](const PrimExpr& other) {
+        return StructuralEqual()(check, other);
+      });
+      if (!duplicate) checks.push_back(check);
+    }
+    if (aligned) {
+      plan.lanes = lanes;
+      plan.alignment_checks = checks;
+      break;
+    }
+  }
+  return plan;
+}
+
+TVM_REGISTER_GLOBAL("tir.analysis.PlanVectorize")
+    .set_body_typed([](For loop, int max_vector_bits, bool allow_runtime_checks) {
+      VectorizePlan plan = PlanVectorize(loop, max_vector_bits, allow_runtime_checks);
+      return Array<ObjectRef>{Integer(plan.lanes), plan.alignment_checks};
+    });
+
+}  // namespace tir
+}  // namespace tvm
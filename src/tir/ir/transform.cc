@@ -23,12 +23,15 @@
  */
 #include <tvm/node/repr_printer.h>
 #include <tvm/runtime/registry.h>
+#include <tvm/support/parallel_for.h>
 #include <tvm/tir/transform.h>
 
 namespace tvm {
 namespace tir {
 namespace transform {
 
+TVM_REGISTER_PASS_CONFIG_OPTION("tir.parallel_function_passes", Bool);
+
 /*!
  * \brief Function level pass that applies transformations to all
  *        TIR functions within the module.
@@ -41,6 +44,9 @@ class PrimFuncPassNode : public PassNode {
   /*! \brief The pass function called on each. */
   runtime::TypedPackedFunc<PrimFunc(PrimFunc, IRModule, PassContext)> pass_func;
 
+  /*! \brief Whether the pass only reads and writes the function it is given. */
+  bool function_local = false;
+
   void VisitAttrs(tvm::AttrVisitor* v) { v->Visit("pass_info", &pass_info); }
 
   /*!
@@ -71,17 +77,18 @@ class PrimFuncPass : public Pass {
    */
   TVM_DLL PrimFuncPass(
       runtime::TypedPackedFunc<PrimFunc(PrimFunc, IRModule, PassContext)> pass_func,
-      PassInfo pass_info);
+      PassInfo pass_info, bool function_local = false);
 
   TVM_DEFINE_OBJECT_REF_METHODS(PrimFuncPass, Pass, PrimFuncPassNode);
 };
 
 PrimFuncPass::PrimFuncPass(
     runtime::TypedPackedFunc<PrimFunc(PrimFunc, IRModule, PassContext)> pass_func,
-    PassInfo pass_info) {
+    PassInfo pass_info, bool function_local) {
   auto n = make_object<PrimFuncPassNode>();
   n->pass_func = std::move(pass_func);
   n->pass_info = std::move(pass_info);
+  n->function_local = function_local;
   data_ = std::move(n);
 }
 
@@ -92,17 +99,45 @@ IRModule PrimFuncPassNode::operator()(IRModule mod, const PassContext& pass_ctx)
 
   IRModuleNode* mod_ptr = mod.CopyOnWrite();
   auto* func_dict = mod_ptr->functions.CopyOnWrite();
-  // directly loop over the underlying dict
-  for (auto& kv : *func_dict) {
-    // only picks up tir::PrimFunc
-    if (kv.second->IsInstance<PrimFuncNode>()) {
-      // move out the function so that it is the only copy.
-      PrimFunc func = Downcast<PrimFunc>(std::move(kv.second));
-      func = pass_func(std::move(func), mod, pass_ctx);
-      kv.second = std::move(func);
-
-      if (!kv.second.defined()) {
-        deleted_list.push_back(Downcast<GlobalVar>(kv.first));
+  bool parallel =
+      function_local &&
+      pass_ctx->GetConfig<Bool>("tir.parallel_function_passes", Bool(false)).value();
+  if (parallel) {
+    // Only this thread touches the dict: the functions are moved out, transformed by the
+    // workers in their own slots and moved back once all of them are done. The iter maps shared
+    // by an arith::IterMapCacheScope of this thread are not seen by the workers, the shared cache
+    // is not synchronized.
+    std::vector<std::pair<GlobalVar, ObjectRef*>> entries;
+    std::vector<PrimFunc> funcs;
+    for (auto& kv : *func_dict) {
+      if (kv.second->IsInstance<PrimFuncNode>()) {
+        entries.emplace_back(Downcast<GlobalVar>(kv.first), &kv.second);
+        funcs.push_back(Downcast<PrimFunc>(std::move(kv.second)));
+      }
+    }
+    support::parallel_for(0, static_cast<int>(funcs.size()), [&](int i) {
+      pass_ctx.RunOnWorkerThread(
+          [&]() { funcs[i] = pass_func(std::move(funcs[i]), mod, pass_ctx); });
+    });
+    for (size_t i = 0; i < entries.size(); ++i) {
+      if (!funcs[i].defined()) {
+        deleted_list.push_back(entries[i].first);
+      }
+      *entries[i].second = std::move(funcs[i]);
+    }
+  } else {
+    // directly loop over the underlying dict
+    for (auto& kv : *func_dict) {
+      // only picks up tir::PrimFunc
+      if (kv.second->IsInstance<PrimFuncNode>()) {
+        // move out the function so that it is the only copy.
+        PrimFunc func = Downcast<PrimFunc>(std::move(kv.second));
+        func = pass_func(std::move(func), mod, pass_ctx);
+        kv.second = std::move(func);
+
+        if (!kv.second.defined()) {
+          deleted_list.push_back(Downcast<GlobalVar>(kv.first));
+        }
       }
     }
   }
@@ -118,9 +153,9 @@ IRModule PrimFuncPassNode::operator()(IRModule mod, const PassContext& pass_ctx)
 
 Pass CreatePrimFuncPass(
     const runtime::TypedPackedFunc<PrimFunc(PrimFunc, IRModule, PassContext)>& pass_func,
-    int opt_level, String name, tvm::Array<String> required) {
+    int opt_level, String name, tvm::Array<String> required, bool function_local) {
   PassInfo pass_info = PassInfo(opt_level, name, required);
-  return PrimFuncPass(pass_func, pass_info);
+  return PrimFuncPass(pass_func, pass_info, function_local);
 }
 
 TVM_REGISTER_NODE_TYPE(PrimFuncPassNode);
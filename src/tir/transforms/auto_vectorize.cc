@@ -0,0 +1,94 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file auto_vectorize.cc
+ * \brief Vectorize the innermost serial loops left by the schedules, as planned by PlanVectorize.
+ */
+#include <tvm/runtime/registry.h>
+#include <tvm/tir/analysis.h>
+#include <tvm/tir/op.h>
+#include <tvm/tir/stmt_functor.h>
+#include <tvm/tir/transform.h>
+
+namespace tvm {
+namespace tir {
+
+class AutoVectorizer : public StmtExprMutator {
+ public:
+  explicit AutoVectorizer(int max_vector_bits) : max_vector_bits_(max_vector_bits) {}
+
+ private:
+  Stmt VisitStmt_(const ForNode* op) final {
+    For loop = Downcast<For>(StmtExprMutator::VisitStmt_(op));
+    // The loops the schedule decided about are left as they are.
+    if (loop->kind != ForKind::kSerial || loop->thread_binding.defined() ||
+        !loop->annotations.empty()) {
+      return std::move(loop);
+    }
+    VectorizePlan plan = PlanVectorize(loop, max_vector_bits_, /*allow_runtime_checks=*/true);
+    if (plan.lanes == 1) return std::move(loop);
+
+    int64_t extent = Downcast<IntImm>(loop->extent)->value;
+    Stmt vectorized;
+    if (extent == plan.lanes) {
+      For vector_loop = loop;
+      vector_loop.CopyOnWrite()->kind = ForKind::kVectorized;
+      vectorized = vector_loop;
+    } else {
+      DataType dtype = loop->loop_var.dtype();
+      Var outer = loop->loop_var.copy_with_suffix(".outer");
+      Var inner = loop->loop_var.copy_with_suffix(".inner");
+      PrimExpr index = loop->min + outer * make_const(dtype, plan.lanes) + inner;
+      Stmt body = Substitute(loop->body, {{loop->loop_var, index}});
+      body = For(inner, make_zero(dtype), make_const(dtype, plan.lanes), ForKind::kVectorized,
+                 body);
+      vectorized = For(outer, make_zero(dtype), make_const(dtype, extent / plan.lanes),
+                       ForKind::kSerial, body, NullOpt, {}, loop->span);
+    }
+    if (plan.alignment_checks.empty()) return vectorized;
+    // The vector fast path, when the accesses are aligned at runtime.
+    PrimExpr aligned = plan.alignment_checks[0];
+    for (size_t i = 1; i < plan.alignment_checks.size(); ++i) {
+      aligned = aligned && plan.alignment_checks[i];
+    }
+    return IfThenElse(likely(aligned), vectorized, loop);
+  }
+
+  int max_vector_bits_;
+};
+
+namespace transform {
+
+Pass AutoVectorize() {
+  auto pass_func = [=](PrimFunc f, IRModule m, PassContext ctx) {
+    int max_vector_bits =
+        ctx->GetConfig<Integer>("tir.vectorize_dynamic_vector_bits", Integer(128)).value()->value;
+    auto* n = f.CopyOnWrite();
+    n->body = AutoVectorizer(max_vector_bits)(std::move(n->body));
+    return f;
+  };
+  return CreatePrimFuncPass(pass_func, 0, "tir.AutoVectorize", {});
+}
+
+TVM_REGISTER_GLOBAL("tir.transform.AutoVectorize").set_body_typed(AutoVectorize);
+
+}  // namespace transform
+}  // namespace tir
+}  // namespace tvm
@@ -24,9 +24,14 @@
 #include <tvm/tir/analysis.h>
 #include <tvm/tir/builtin.h>
 #include <tvm/tir/expr.h>
+#include <tvm/tir/op.h>
 #include <tvm/tir/stmt_functor.h>
 #include <tvm/tir/transform.h>
 
+#include <sstream>
+#include <string>
+#include <unordered_set>
+
 #include "../ir/buffer_common.h"
 #include "storage_access.h"
 #include "tvm/tir/stmt.h"
@@ -148,6 +153,13 @@ class PTXAsyncCopyInjector : public StmtMutator {
                       load->buffer->data, src_offset, PrimExpr(bytes), predicate_value}));
           }
         }
+        WarnSynchronous(store, "its vectorized indices are not a supported pattern");
+      } else {
+        std::ostringstream reason;
+        reason << "it copies " << bytes << " bytes per access while cp.async takes 4, 8 or 16, "
+               << "the copy is not vectorized (the elements are not contiguous or aligned in "
+               << "both buffers)";
+        WarnSynchronous(store, reason.str());
       }
     }
     return StmtMutator::VisitStmt_(store);
@@ -173,18 +185,36 @@ class PTXAsyncCopyInjector : public StmtMutator {
             if (auto* f = call->args[2].as<FloatImmNode>()) {
               else_value_is_zero = f->value == 0.0f;
             }
+            // the integer copies fill zeros as well
+            else_value_is_zero |= is_zero(call->args[2]);
             if (else_value_is_zero) {
               return InjectPTX(load, store, true, call->args[0]);
             }
+            WarnSynchronous(store, "the value of its out of bound elements is not zero");
+            return StmtMutator::VisitStmt_(store);
           }
         }
       }
+      WarnSynchronous(store, "the stored value is computed from the loaded one (e.g. a cast)");
     }
     return StmtMutator::VisitStmt_(store);
   }
 
  private:
+  // Warn once per buffer about the copies from the global memory left synchronous in an async
+  // scope, each of them waits for its load before the next statement of the stage is issued.
+  void WarnSynchronous(const BufferStoreNode* store, const std::string& reason) {
+    bool from_global = false;
+    PostOrderVisit(store->value, [&](const ObjectRef& node) {
+      if (auto load = node.as<BufferLoadNode>()) from_global |= load->buffer.scope() == "global";
+    });
+    if (!from_global || !warned_.insert(store->buffer.get()).second) return;
+    LOG(WARNING) << "The copy from the global memory into " << store->buffer->name
+                 << " in a pipelined loop is synchronous: " << reason;
+  }
+
   bool in_async{false};
+  std::unordered_set<const BufferNode*> warned_;
 };
 
 namespace transform {
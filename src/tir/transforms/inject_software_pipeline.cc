@@ -25,6 +25,7 @@
 #include <tvm/tir/builtin.h>
 #include <tvm/tir/transform.h>
 
+#include <algorithm>
 #include <unordered_set>
 
 #include "../../support/utils.h"
@@ -316,9 +317,10 @@ class PipelineRewriter : public StmtExprMutator {
       const Array<Buffer> pipeline_allocs, const For& pipeline_loop,
       const PipelineInfo& pipeline_info,
       const std::unordered_map<const VarNode*, FragmentInfo>& fragment_info,
-      const Map<String, ObjectRef> preserved_annotations) {
+      const Map<String, ObjectRef> preserved_annotations, bool async_buffer_groups) {
     PipelineRewriter rewriter(buffer_data_to_buffer, double_buffers, pipeline_allocs, pipeline_loop,
-                              pipeline_info, fragment_info, preserved_annotations);
+                              pipeline_info, fragment_info, preserved_annotations,
+                              async_buffer_groups);
     return rewriter.BuildPipeline();
   }
 
@@ -328,7 +330,7 @@ class PipelineRewriter : public StmtExprMutator {
                    const Array<Buffer>& pipeline_allocs, const For& pipeline_loop,
                    const PipelineInfo& pipeline_info,
                    const std::unordered_map<const VarNode*, FragmentInfo>& fragment_info,
-                   const Map<String, ObjectRef> preserved_annotations)
+                   const Map<String, ObjectRef> preserved_annotations, bool async_buffer_groups)
 
       : buffer_data_to_buffer_(std::move(buffer_data_to_buffer)),
         double_buffers_(double_buffers),
@@ -336,7 +338,8 @@ class PipelineRewriter : public StmtExprMutator {
         pipeline_loop_(pipeline_loop),
         pipeline_info_(pipeline_info),
         fragment_info_(fragment_info),
-        preserved_annotations_(preserved_annotations) {}
+        preserved_annotations_(preserved_annotations),
+        async_buffer_groups_(async_buffer_groups) {}
 
   Stmt BuildPipeline() {
     // Step 1: Analyze accesses to the buffers in the pipeline and compute the number of versions
@@ -538,7 +541,7 @@ class PipelineRewriter : public StmtExprMutator {
 
   // Per-stage states that are local to each of pipeline prologue, body, and epilogue.
   struct AsyncStateLocal {
-    struct {
+    struct PendingWait {
       // The index into a list of blocks, where async_wait_queue should be attached at the
       // beginning.
       int insert_before;
@@ -549,6 +552,10 @@ class PipelineRewriter : public StmtExprMutator {
       bool valid() const { return wait_count.defined(); }
     } pending_wait;
 
+    // The stricter waits of the consumers after the one of pending_wait, kept apart from it
+    // rather than coalesced with it when the async operations are committed per buffer.
+    std::vector<PendingWait> later_waits;
+
     // Destination buffers of async operations that have been encountered so far in the loop
     //
     // for (size_t i = 0; i < new_blocks.size(); ++i) {
@@ -656,12 +663,48 @@ class PipelineRewriter : public StmtExprMutator {
       auto& dep_local_state = (*async_states_local)[producer_stage_idx];
       const auto num_commit_group = dep_local_state.commit_groups.size();
       std::vector<Optional<PrimExpr>> producer_head_per_commit;
+      // The groups of the consumed iteration committed after the last one the block reads.
+      int num_later_groups = 0;
 
       if (num_commit_group == 0) {
         // Epilogue, no async producer. Since "local" producer_head is not available, use
         // "global" producer_head.
         ICHECK(!dep_local_state.producer_head);
         producer_head_per_commit.push_back(async_states[producer_stage_idx].producer_head);
+      } else if (async_buffer_groups_) {
+        // With a commit group per buffer, the groups the block doesn't read can be in flight too:
+        // all the groups of the later iterations, and the groups of the consumed iteration
+        // committed after the last one the block reads.
+        //
+        // for i in range(13):
+        //     async_commit_queue(0):
+        //        A_shared[(i + 3) % 4] = A[...]
+        //     async_commit_queue(0):
+        //        B_shared[(i + 3) % 4] = B[...]
+        //     async_wait_queue(0, 7):
+        //        compute_a(A_shared[i])
+        //     async_wait_queue(0, 6):
+        //        compute_b(A_shared[i], B_shared[i])
+        //
+        // compute_a waits for A_shared[i] only, (i + 3) - i commits of each buffer and B_shared[i]
+        // can be in flight.
+        ICHECK(dep_local_state.producer_head);
+        std::vector<bool> group_seen(num_commit_group, false);
+        for (const auto& kv : buffer_to_commit_group) {
+          if (dep_local_state.seen.count(kv.first)) group_seen[kv.second] = true;
+        }
+        int last_read_group = -1;
+        for (auto read_region : new_blocks[i].block->reads) {
+          if (!async_states[producer_stage_idx].writes(read_region->buffer)) continue;
+          last_read_group =
+              std::max(last_read_group, buffer_to_commit_group.at(read_region->buffer.get()));
+        }
+        for (size_t group = 0; group < num_commit_group; ++group) {
+          producer_head_per_commit.push_back(group_seen[group]
+                                                 ? dep_local_state.producer_head.value()
+                                                 : dep_local_state.producer_head.value() - 1);
+        }
+        num_later_groups = static_cast<int>(num_commit_group) - 1 - last_read_group;
       } else {
         ICHECK(dep_local_state.producer_head);
         std::vector<bool> need_wait_count(num_commit_group, true);
@@ -697,13 +740,19 @@ class PipelineRewriter : public StmtExprMutator {
             return PrimExpr(0);
           }
         }
-        return sum;
+        return sum + num_later_groups;
       }();
 
       auto& pending_wait = dep_local_state.pending_wait;
+      auto& later_waits = dep_local_state.later_waits;
 
       if (!pending_wait.valid()) {
         pending_wait = {static_cast<int>(i), wait_count};
+      } else if (async_buffer_groups_) {
+        const auto& last_wait = later_waits.empty() ? pending_wait : later_waits.back();
+        if (analyzer_.CanProve(wait_count < last_wait.wait_count)) {
+          later_waits.push_back({static_cast<int>(i), wait_count});
+        }
       } else if (analyzer_.CanProve(wait_count < pending_wait.wait_count)) {
         // Coalesce multiple wait_queue if the later one allows fewer in-flight ops.
         pending_wait = {pending_wait.insert_before, wait_count};
@@ -719,12 +768,15 @@ class PipelineRewriter : public StmtExprMutator {
       arith::Analyzer* ana_normalized) const {
     std::vector<RewrittenBlockInfo> new_blocks = blocks;
     std::vector<int> commit_group_indices(new_blocks.size(), -1);
+    // The index of the commit group of each block in its stage.
+    std::vector<int> commit_group_ids(new_blocks.size(), -1);
     for (const auto& [stage_id, state] : async_states_local) {
       if (!state.commit_groups.empty()) {
         for (size_t i = 0; i < state.commit_groups.size(); ++i) {
           for (size_t j = 0; j < state.commit_groups[i].size(); ++j) {
             ICHECK(state.commit_groups[i][0] + j < new_blocks.size());
             commit_group_indices[state.commit_groups[i][0] + j] = stage_id;
+            commit_group_ids[state.commit_groups[i][0] + j] = i;
           }
         }
       }
@@ -739,16 +791,19 @@ class PipelineRewriter : public StmtExprMutator {
                        AttrStmt(zero, tir::attr::async_wait_inflight_count, wait_count, n->body));
         };
 
-        if (state.predicate && !ana_normalized->CanProve(state.predicate.value())) {
-          // If the async operation that this wait_queue is waiting on is predicated, and we cannot
-          // prove that the predicate is always true, the precise wait count is only valid
-          // at iterations where the predicate is true;
-          auto wait_count = Call(DataType::Int(32), builtin::if_then_else(),
-                                 {state.predicate.value(), state.pending_wait.wait_count, 0});
-          attach_wait_scope(state.pending_wait.insert_before, stage_id, wait_count);
-        } else {
-          attach_wait_scope(state.pending_wait.insert_before, stage_id,
-                            state.pending_wait.wait_count);
+        std::vector<AsyncStateLocal::PendingWait> waits{state.pending_wait};
+        waits.insert(waits.end(), state.later_waits.begin(), state.later_waits.end());
+        for (const auto& pending_wait : waits) {
+          if (state.predicate && !ana_normalized->CanProve(state.predicate.value())) {
+            // If the async operation that this wait_queue is waiting on is predicated, and we
+            // cannot prove that the predicate is always true, the precise wait count is only valid
+            // at iterations where the predicate is true;
+            auto wait_count = Call(DataType::Int(32), builtin::if_then_else(),
+                                   {state.predicate.value(), pending_wait.wait_count, 0});
+            attach_wait_scope(pending_wait.insert_before, stage_id, wait_count);
+          } else {
+            attach_wait_scope(pending_wait.insert_before, stage_id, pending_wait.wait_count);
+          }
         }
       }
     }
@@ -763,8 +818,11 @@ class PipelineRewriter : public StmtExprMutator {
       } else {
         Array<Stmt> group_bodies;
         auto stage_id = commit_group_indices[i];
+        auto group_id = commit_group_ids[i];
         auto predicate = new_blocks[i].predicate;
-        for (; i < commit_group_indices.size() && commit_group_indices[i] == stage_id; ++i) {
+        for (; i < commit_group_indices.size() && commit_group_indices[i] == stage_id &&
+               commit_group_ids[i] == group_id;
+             ++i) {
           ICHECK(tvm::StructuralEqual()(predicate, new_blocks[i].predicate))
               << "Predicates in the same stage are expected to be identical";
           group_bodies.push_back(new_blocks[i].block->body);
@@ -857,7 +915,18 @@ class PipelineRewriter : public StmtExprMutator {
         auto& local_state = async_states_local[stage];
 
         int commit_group_id = -1;
-        if (local_state.commit_groups.empty() || local_state.consumed) {
+        // With async_buffer_groups_, a copy into another buffer than the ones of the last group
+        // gets its own group.
+        int last_group = static_cast<int>(local_state.commit_groups.size()) - 1;
+        bool new_buffer = async_buffer_groups_ && last_group >= 0 &&
+                          std::any_of(new_block->writes.begin(), new_block->writes.end(),
+                                      [&](const BufferRegion& write_region) {
+                                        auto it =
+                                            buffer_to_commit_group.find(write_region->buffer.get());
+                                        return it == buffer_to_commit_group.end() ||
+                                               it->second != last_group;
+                                      });
+        if (local_state.commit_groups.empty() || local_state.consumed || new_buffer) {
           // consumed == true means there is already a consumer stage waiting for an
           // eariler async operation of this stage. In such cases, we make multiple commit_queue
           // for this stage.
@@ -957,6 +1026,8 @@ class PipelineRewriter : public StmtExprMutator {
   Array<Block> ordered_stmts_;
   std::map<int, AsyncStateGlobal> async_states;
   Map<String, ObjectRef> preserved_annotations_;
+  /*! \brief Whether the async copies of a stage into different buffers are committed apart. */
+  bool async_buffer_groups_;
 };
 
 /*!
@@ -995,9 +1066,9 @@ void BuildDependencyGraph(
 
 class PipelineInjector : private StmtExprMutator {
  public:
-  static Stmt Inject(const PrimFunc& func) {
+  static Stmt Inject(const PrimFunc& func, bool async_buffer_groups) {
     auto global_symbol = func->GetAttr<String>(tvm::attr::kGlobalSymbol);
-    PipelineInjector injector(global_symbol);
+    PipelineInjector injector(global_symbol, async_buffer_groups);
     for (const auto& kv : func->buffer_map) {
       const Buffer& buffer = kv.second;
       injector.buffer_data_to_buffer_.Set(buffer->data, buffer);
@@ -1007,7 +1078,8 @@ class PipelineInjector : private StmtExprMutator {
   }
 
  private:
-  explicit PipelineInjector(Optional<String> global_symbol) : global_symbol_(global_symbol) {}
+  PipelineInjector(Optional<String> global_symbol, bool async_buffer_groups)
+      : global_symbol_(global_symbol), async_buffer_groups_(async_buffer_groups) {}
 
   /*!
    * \brief Check the pipeline satisfies the following conditions:
@@ -1150,7 +1222,8 @@ class PipelineInjector : private StmtExprMutator {
     // Step 4: Rewrite the pipeline body.
     Stmt pipeline = PipelineRewriter::Rewrite(buffer_data_to_buffer_, double_buffers,
                                               pipeline_allocs, GetRef<For>(op), pipeline_info,
-                                              fragment_info_, preserved_annotations);
+                                              fragment_info_, preserved_annotations,
+                                              async_buffer_groups_);
 
     if (const auto* realize = op->body.as<BlockRealizeNode>()) {
       const auto& block = realize->block;
@@ -1220,20 +1293,25 @@ class PipelineInjector : private StmtExprMutator {
   std::unordered_map<const VarNode*, FragmentInfo> fragment_info_;
   std::unordered_set<Buffer, ObjectPtrHash, ObjectPtrEqual> double_buffers;
   Optional<String> global_symbol_;
+  bool async_buffer_groups_;
 };
 
 }  // namespace software_pipeline
 
 namespace transform {
 
+TVM_REGISTER_PASS_CONFIG_OPTION("tir.async_buffer_commit_groups", Bool);
+
 /*!
  * \brief Transform annotated loops into pipelined one that parallelize producers and consumers.
  * \return The IR transform pass.
  */
 Pass InjectSoftwarePipeline() {
   auto pass_func = [=](PrimFunc f, IRModule m, PassContext ctx) {
+    bool async_buffer_groups =
+        ctx->GetConfig<Bool>("tir.async_buffer_commit_groups", Bool(false)).value();
     auto* fptr = f.CopyOnWrite();
-    fptr->body = software_pipeline::PipelineInjector::Inject(f);
+    fptr->body = software_pipeline::PipelineInjector::Inject(f, async_buffer_groups);
     fptr->body = ConvertSSA(std::move(fptr->body));
     return f;
   };
@@ -44,6 +44,7 @@ struct LoopPartitionConfigNode : public tvm::AttrsNode<LoopPartitionConfigNode>
   bool partition_const_loop;
   bool no_unroll_loop_with_extent_one;
   bool unroll_loop_with_partition_hint_no_interval;
+  bool partition_vectorized_tail;
 
   TVM_DECLARE_ATTRS(LoopPartitionConfigNode, "tir.transform.LoopPartitionConfig") {
     TVM_ATTR_FIELD(partition_const_loop).describe("Split constant loop").set_default(false);
@@ -53,6 +54,9 @@ struct LoopPartitionConfigNode : public tvm::AttrsNode<LoopPartitionConfigNode>
     TVM_ATTR_FIELD(unroll_loop_with_partition_hint_no_interval)
         .describe("Unroll loops with pragma_loop_partition_hint and no interval")
         .set_default(false);
+    TVM_ATTR_FIELD(partition_vectorized_tail)
+        .describe("Split constant loops around vectorized loops so only the tail is predicated")
+        .set_default(false);
   }
 };
 
@@ -97,12 +101,15 @@ using ExpressionSet = std::unordered_set<PrimExpr, ObjectPtrHash, ObjectPtrEqual
 class CandidateSelector final : public StmtExprVisitor {
  public:
   using VarIsUsed = bool;
-  explicit CandidateSelector(bool partition_const_loop)
-      : partition_const_loop_(partition_const_loop) {}
+  explicit CandidateSelector(bool partition_const_loop, bool partition_vectorized_tail = false)
+      : partition_const_loop_(partition_const_loop),
+        partition_vectorized_tail_(partition_vectorized_tail) {}
 
   void VisitStmt_(const ForNode* op) final {
-    // partition const loop when sets partition_const_loop_
-    if (!is_const_int(op->min) || !is_const_int(op->extent) || partition_const_loop_) {
+    // partition const loop when sets partition_const_loop_, or when it encloses a vectorized
+    // loop with partition_vectorized_tail_, so the full vectors are not predicated
+    if (!is_const_int(op->min) || !is_const_int(op->extent) || partition_const_loop_ ||
+        (partition_vectorized_tail_ && HasVectorizedLoop(op->body))) {
       // always treat var with hint to be partitioned
       const VarNode* var = op->loop_var.get();
       if (partition_hint_vars.count(var)) {
@@ -193,9 +200,18 @@ class CandidateSelector final : public StmtExprVisitor {
   std::unordered_set<const VarNode*> partition_hint_vars;
 
  private:
+  static bool HasVectorizedLoop(const Stmt& body) {
+    bool found = false;
+    PostOrderVisit(body, [&found](const ObjectRef& n) {
+      if (const auto* loop = n.as<ForNode>()) found |= loop->kind == ForKind::kVectorized;
+    });
+    return found;
+  }
+
   bool in_likely_{false};
   bool no_split_{false};
   bool partition_const_loop_{false};
+  bool partition_vectorized_tail_{false};
   std::unordered_map<const VarNode*, VarIsUsed> record_;
   arith::Analyzer analyzer_;
 };
@@ -382,8 +398,9 @@ class ThreadPartitionInserter : public StmtMutator {
 class LoopPartitioner : public StmtMutator {
  public:
   explicit LoopPartitioner(bool partition_const_loop, bool no_unroll_loop_with_extent_one,
-                           bool unroll_loop_with_partition_hint_no_interval)
-      : selector(CandidateSelector(partition_const_loop)),
+                           bool unroll_loop_with_partition_hint_no_interval,
+                           bool partition_vectorized_tail = false)
+      : selector(CandidateSelector(partition_const_loop, partition_vectorized_tail)),
         no_unroll_loop_with_extent_one_(no_unroll_loop_with_extent_one),
         unroll_loop_with_partition_hint_no_interval_(unroll_loop_with_partition_hint_no_interval) {}
 
@@ -729,9 +746,10 @@ class RemoveLikelyTagsAndHints : public StmtExprMutator {
 };
 
 Stmt LoopPartition(Stmt stmt, bool partition_const_loop, bool no_unroll_loop_with_extent_one,
-                   bool unroll_loop_with_partition_hint_no_interval) {
+                   bool unroll_loop_with_partition_hint_no_interval,
+                   bool partition_vectorized_tail) {
   stmt = LoopPartitioner(partition_const_loop, no_unroll_loop_with_extent_one,
-                         unroll_loop_with_partition_hint_no_interval)
+                         unroll_loop_with_partition_hint_no_interval, partition_vectorized_tail)
              .VisitAndMutate(std::move(stmt));
   stmt = RemoveLikelyTagsAndHints()(std::move(stmt));
   return stmt;
@@ -748,7 +766,8 @@ Pass LoopPartition() {
     }
     n->body = LoopPartition(std::move(n->body), cfg.value()->partition_const_loop,
                             cfg.value()->no_unroll_loop_with_extent_one,
-                            cfg.value()->unroll_loop_with_partition_hint_no_interval);
+                            cfg.value()->unroll_loop_with_partition_hint_no_interval,
+                            cfg.value()->partition_vectorized_tail);
     return f;
   };
   return CreatePrimFuncPass(pass_func, 0, "tir.LoopPartition", {});
@@ -42,9 +42,14 @@ class IntrinInjecter : public tvm::arith::IRMutatorWithAnalyzer {
   using IRMutatorWithAnalyzer::VisitStmt_;
   using FLowerGeneral = runtime::TypedPackedFunc<PrimExpr(PrimExpr)>;
 
-  IntrinInjecter(arith::Analyzer* analyzer, std::string target, std::string mtriple = "")
+  IntrinInjecter(arith::Analyzer* analyzer, std::string target, std::string mtriple = "",
+                 std::string variant = "")
       : IRMutatorWithAnalyzer(analyzer) {
     std::vector<std::string> patterns;
+    // The rules of a variant of the target take precedence over the rules of the target.
+    if (!variant.empty()) {
+      patterns.push_back(target + "." + variant + ".FLowerIntrinsic");
+    }
     patterns.push_back(target + ".FLowerIntrinsic");
     patterns.push_back(target + ".FLegalize");
     bool is_llvm_aarch64 = (mtriple.find("aarch64") != std::string::npos);
@@ -387,8 +392,13 @@ Pass LowerIntrin() {
     ICHECK(target.defined()) << "LowerIntrin: Require the target attribute";
     arith::Analyzer analyzer;
     auto mtriple = target.value()->GetAttr<runtime::String>("mtriple", "");
-    n->body =
-        IntrinInjecter(&analyzer, target.value()->kind->name, mtriple.value())(std::move(n->body));
+    std::string variant;
+    if (target.value()->kind->name == "opencl" &&
+        target.value()->GetAttr<Bool>("supports_subgroup_shuffle").value_or(Bool(false))) {
+      variant = "subgroup";
+    }
+    n->body = IntrinInjecter(&analyzer, target.value()->kind->name, mtriple.value(),
+                             variant)(std::move(n->body));
     return f;
   };
   return CreatePrimFuncPass(pass_func, 0, "tir.LowerIntrin", {});
@@ -718,14 +718,19 @@ class ThreadAllreduceBuilder final : public StmtExprMutator {
   //
   // Note: The ROCm backend will only have warp reductions for now.
   // Also, the warp/wavefront size differs (64 on rocm, 32 on cuda and metal).
+  // OpenCL has them when the device has the subgroup shuffles, thread_warp_size
+  // being the subgroup size.
   bool IsWarpReduction(const std::vector<DataType>& types, int group_extent, int reduce_extent,
                        int contiguous_reduce_extent) {
+    bool is_opencl_subgroup =
+        target_->kind->name == "opencl" && warp_size_ > 1 &&
+        target_->GetAttr<Bool>("supports_subgroup_shuffle").value_or(Bool(false));
     if ((target_->kind->name != "cuda") && (target_->kind->name != "rocm") &&
-        (target_->kind->name != "metal")) {
+        (target_->kind->name != "metal") && !is_opencl_subgroup) {
       return false;
     }
 
-    need_warp_shuffle_mask_ = target_->kind->name != "metal";
+    need_warp_shuffle_mask_ = target_->kind->name != "metal" && !is_opencl_subgroup;
 
     // rocm only supports 32 bit operands for shuffling at the moment
     if ((target_->kind->name == "rocm") &&
@@ -42,6 +42,8 @@ namespace tir {
 
 static constexpr const char* kDeviceContextVar = "device_api_context";
 
+TVM_REGISTER_PASS_CONFIG_OPTION("tir.make_packed_api.emit_unpacked", Bool);
+
 namespace {
 class ReturnRewriter : public StmtMutator {
  public:
@@ -382,10 +384,98 @@ PrimFunc MakePackedAPI(PrimFunc func) {
   return func;
 }
 
+/* \brief Make the unpacked entry point of a function, if it has one
+ *
+ * The unpacked entry point "<global_symbol>_unpacked" takes the data
+ * pointer of each buffer argument and the value of each scalar
+ * argument directly, followed by the device id, and returns zero on
+ * success like the packed one.  It skips the unboxing of the packed
+ * arguments and the checks of the DLTensor fields, so the caller
+ * must pass contiguous buffers of the declared shapes.
+ *
+ * \param func The function before MakePackedAPI
+ *
+ * \returns The unpacked entry point, or NullOpt if the function does
+ * not return void or its buffers have a symbolic shape, stride or
+ * offset, which only the DLTensor arguments can define.
+ */
+Optional<PrimFunc> MakeUnpackedAPI(const PrimFunc& func) {
+  auto global_symbol = RequiresPackedAPI(func);
+  if (!global_symbol.defined()) {
+    return NullOpt;
+  }
+  std::string name_hint = global_symbol.value();
+
+  auto target = func->GetAttr<Target>(tvm::attr::kTarget);
+  if (!target || !target.value()->GetHost()) {
+    return NullOpt;
+  }
+  Target target_host = target.value()->GetHost().value();
+  int target_device_type = target.value()->GetTargetDeviceType();
+
+  const auto* ret_type = func->ret_type.as<PrimTypeNode>();
+  if (ret_type == nullptr || !ret_type->dtype.is_void()) {
+    return NullOpt;
+  }
+
+  const Stmt nop = Evaluate(0);
+  Array<Var> params;
+  std::vector<Stmt> buffer_declarations;
+  for (const Var& param : func->params) {
+    if (param->name_hint == kDeviceContextVar) {
+      return NullOpt;
+    }
+    if (auto buffer = func->buffer_map.Get(param)) {
+      params.push_back(buffer.value()->data);
+      buffer_declarations.push_back(DeclBuffer(buffer.value(), nop));
+    } else {
+      params.push_back(param);
+    }
+  }
+  Var device_id("dev_id");
+  Integer device_type(target_device_type);
+  params.push_back(device_id);
+
+  Stmt body = AttrStmt(make_zero(DataType::Int(32)), attr::compute_scope,
+                       StringImm(name_hint + "_unpacked_compute_"), func->body);
+  if (!UndefinedVars(body, params).empty()) {
+    return NullOpt;
+  }
+  if (runtime::DeviceAPI::NeedSetDevice(target_device_type)) {
+    Stmt set_device =
+        Evaluate(Call(DataType::Int(32), builtin::tvm_call_packed(),
+                      {StringImm(runtime::symbol::tvm_set_device), device_type, device_id}));
+    body = SeqStmt({set_device, body});
+  }
+  body = SeqStmt({body, Evaluate(ret(Integer(0)))});
+
+  ObjectRef node = String("default");
+  std::vector<Stmt> device_attrs = {AttrStmt(node, attr::device_id, device_id, nop),
+                                    AttrStmt(node, attr::device_type, device_type, nop)};
+  body = MergeNest({device_attrs, buffer_declarations}, body);
+
+  PrimFunc unpacked = func;
+  auto* unpacked_ptr = unpacked.CopyOnWrite();
+  unpacked_ptr->params = params;
+  unpacked_ptr->body = body;
+  unpacked_ptr->buffer_map = Map<Var, Buffer>();
+  unpacked_ptr->ret_type = PrimType(DataType::Int(32));
+  unpacked_ptr->checked_type_ = unpacked_ptr->func_type_annotation();
+  unpacked = WithoutAttr(std::move(unpacked), tir::attr::kIsEntryFunc);
+  unpacked = WithAttrs(std::move(unpacked),
+                       {{tvm::attr::kGlobalSymbol, String(name_hint + "_unpacked")},
+                        {tvm::attr::kCallingConv, Integer(CallingConv::kDefault)},
+                        {tvm::attr::kTarget, target_host}});
+  // The packed entry point keeps the variables of the body.
+  return RenewDefs(unpacked);
+}
+
 namespace transform {
 
 Pass MakePackedAPI() {
   auto pass_func = [](IRModule mod, PassContext ctx) {
+    bool emit_unpacked =
+        ctx->GetConfig<Bool>("tir.make_packed_api.emit_unpacked", Bool(false)).value();
     Map<GlobalVar, String> packed_func_methods;
     for (const auto& [gvar, base_func] : mod->functions) {
       if (auto opt = base_func.as<PrimFunc>()) {
@@ -408,6 +498,13 @@ Pass MakePackedAPI() {
           func.CopyOnWrite()->body = body.value();
         }
 
+        if (emit_unpacked) {
+          if (auto unpacked = MakeUnpackedAPI(func)) {
+            std::string name = unpacked.value()->GetAttr<String>(tvm::attr::kGlobalSymbol).value();
+            updates->Add(GlobalVar(name), unpacked.value());
+          }
+        }
+
         func = MakePackedAPI(std::move(func));
 
         if (!func.same_as(orig_func)) {
@@ -229,8 +229,9 @@ class DynSharedMemLinearAccessPatternFinder final : public StmtExprVisitor {
 class DynamicSharedMemoryRewriter : public StmtExprMutator {
  public:
   explicit DynamicSharedMemoryRewriter(
-      const std::unordered_map<const VarNode*, const AllocateNode*>& dyn_shmem_allocs)
-      : dyn_shmem_allocs_{dyn_shmem_allocs} {}
+      const std::unordered_map<const VarNode*, const AllocateNode*>& dyn_shmem_allocs,
+      int align_bytes)
+      : dyn_shmem_allocs_{dyn_shmem_allocs}, align_bytes_{align_bytes} {}
 
   /*!
    * \brief plan the memory reuse for all the buffer allocated in the statement
@@ -259,7 +260,7 @@ class DynamicSharedMemoryRewriter : public StmtExprMutator {
         max_layer_num = std::max(max_layer_num, static_cast<int>(e->allocs.size()));
       }
       // calculate align for each layer of each storage entry.
-      std::vector<int> align(max_layer_num, 0);
+      std::vector<int> align(max_layer_num, align_bytes_);
       for (const StorageEntry* e : all_entry) {
         for (int i = 0; i < static_cast<int>(e->allocs.size()); i++) {
           for (const VarNode* buffer : e->allocs[i]) {
@@ -598,6 +599,8 @@ class DynamicSharedMemoryRewriter : public StmtExprMutator {
   std::unordered_map<const VarNode*, PrimExpr> buffer_byte_offsets_;
   // The mapping from the original buffer objects to their location in the merged buffer.
   std::unordered_map<const BufferNode*, Buffer> buffer_remap_;
+  // The minimal alignment in bytes of the merged buffers
+  int align_bytes_;
   // The flag indicating whether the merged buffer has been allocated
   bool allocated_{false};
   // Locations of free ops.
@@ -612,11 +615,11 @@ class DynamicSharedMemoryRewriter : public StmtExprMutator {
   support::Arena arena_;
 };
 
-Stmt MergeDynamicSharedMemoryAllocations(Stmt stmt) {
+Stmt MergeDynamicSharedMemoryAllocations(Stmt stmt, int align_bytes) {
   AllocateCollector collector;
   collector(stmt);
   if (collector.dyn_shmem_allocs_.size() > 1) {
-    DynamicSharedMemoryRewriter rewriter(collector.dyn_shmem_allocs_);
+    DynamicSharedMemoryRewriter rewriter(collector.dyn_shmem_allocs_, align_bytes);
     rewriter.PlanReuse(stmt);
     return rewriter(std::move(stmt));
   }
@@ -625,10 +628,10 @@ Stmt MergeDynamicSharedMemoryAllocations(Stmt stmt) {
 
 namespace transform {
 
-Pass MergeDynamicSharedMemoryAllocations() {
-  auto pass_func = [](PrimFunc f, IRModule m, PassContext ctx) {
+Pass MergeDynamicSharedMemoryAllocations(int align_bytes) {
+  auto pass_func = [align_bytes](PrimFunc f, IRModule m, PassContext ctx) {
     auto* n = f.CopyOnWrite();
-    n->body = MergeDynamicSharedMemoryAllocations(std::move(n->body));
+    n->body = MergeDynamicSharedMemoryAllocations(std::move(n->body), align_bytes);
     return f;
   };
   return CreatePrimFuncPass(pass_func, 0, "tir.MergeDynamicSharedMemoryAllocations", {});
@@ -133,6 +133,21 @@ void StorageAccessVisitor::VisitStmt_(const AttrStmtNode* op) {
       StmtExprVisitor::VisitStmt_(op);
     }
     env_threads_.pop_back();
+  } else if (op->attr_key == attr::thread_partial_scope) {
+    // The region is run by a group of threads with its own barrier, the condition selecting the
+    // group does not prevent inserting syncs inside.
+    int condition_counter = condition_counter_;
+    condition_counter_ = 0;
+    scope_.push_back(std::vector<StmtEntry>());
+    StmtExprVisitor::VisitStmt_(op);
+    StmtEntry s;
+    s.stmt = op;
+    s.access = Summarize(std::move(scope_.back()), nullptr);
+    scope_.pop_back();
+    condition_counter_ = condition_counter;
+    if (!s.access.empty()) {
+      scope_.back().emplace_back(std::move(s));
+    }
   } else if (op->attr_key == attr::hand_threaded) {
     // skip this pass on blocks that were hand_threaded
     // this avoids control flow and read/write conflicts
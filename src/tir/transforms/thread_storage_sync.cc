@@ -318,6 +318,11 @@ class ThreadSyncInserter : public StmtExprMutator {
       Stmt barrier;
       if (sync_scope_.rank == StorageRank::kGlobal) {
         barrier = MakeGlobalBarrier();
+      } else if (partial_scope_ != nullptr) {
+        // tvm_storage_sync(scope, barrier_id, num_threads)
+        barrier = Evaluate(Call(DataType::Int(32), builtin::tvm_storage_sync(),
+                                {StringImm(sync_scope_.to_string()),
+                                 Downcast<PrimExpr>(partial_scope_->node), partial_scope_->value}));
       } else {
         barrier = Evaluate(Call(DataType::Int(32), builtin::tvm_storage_sync(),
                                 {StringImm(sync_scope_.to_string())}));
@@ -359,6 +364,12 @@ class ThreadSyncInserter : public StmtExprMutator {
         is_lead_ = PrimExpr();
       }
       return ret;
+    } else if (op->attr_key == attr::thread_partial_scope) {
+      const AttrStmtNode* prev = partial_scope_;
+      partial_scope_ = op;
+      Stmt ret = StmtExprMutator::VisitStmt_(op);
+      partial_scope_ = prev;
+      return ret;
     } else {
       return StmtExprMutator::VisitStmt_(op);
     }
@@ -445,6 +456,8 @@ class ThreadSyncInserter : public StmtExprMutator {
   bool in_thread_env_{false};
   // memorized results
   std::vector<const AttrStmtNode*> thread_extents_;
+  // the innermost thread_partial_scope
+  const AttrStmtNode* partial_scope_{nullptr};
   size_t num_work_dim_{0};
   PrimExpr num_blocks_;
   PrimExpr is_lead_;
@@ -23,6 +23,7 @@
 // Loop vectorizer as in Halide pipeline.
 #include <tvm/arith/analyzer.h>
 #include <tvm/runtime/registry.h>
+#include <tvm/target/target.h>
 #include <tvm/tir/analysis.h>
 #include <tvm/tir/builtin.h>
 #include <tvm/tir/expr.h>
@@ -31,6 +32,7 @@
 #include <tvm/tir/stmt_functor.h>
 #include <tvm/tir/transform.h>
 
+#include <algorithm>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -142,6 +144,67 @@ class VecAllocAccess : public StmtExprMutator {
 };
 
 // We use ExprFunctor directly instead of StmtExprMutator
+/*!
+ * \brief Rewrite the contiguous vector loads of a vectorized value into masked loads, which do
+ *  not read the inactive lanes.
+ */
+class MaskedAccessRewriter : public ExprMutator {
+ public:
+  explicit MaskedAccessRewriter(PrimExpr mask) : mask_(mask) {}
+
+  // Whether the access is a ramp of stride one over a flat buffer of scalars
+  static bool IsContiguous(const Buffer& buffer, const Array<PrimExpr>& indices, int lanes) {
+    if (buffer->dtype.lanes() != 1 || indices.size() != 1) return false;
+    const auto* ramp = indices[0].as<RampNode>();
+    return ramp && ramp->lanes == lanes && is_one(ramp->stride) && !HasLoad(ramp->base);
+  }
+
+  static bool HasLoad(const PrimExpr& e) {
+    bool has_load = false;
+    PostOrderVisit(e, [&](const ObjectRef& n) { has_load |= n->IsInstance<BufferLoadNode>(); });
+    return has_load;
+  }
+
+  // whether a load is not contiguous or an op may trap in the inactive lanes
+  bool failed{false};
+
+ private:
+  PrimExpr VisitExpr_(const BufferLoadNode* op) final {
+    int lanes = mask_.dtype().lanes();
+    if (op->dtype.lanes() != lanes || !IsContiguous(op->buffer, op->indices, lanes)) {
+      failed = true;
+      return GetRef<PrimExpr>(op);
+    }
+    PrimExpr ptr = Call(DataType::Handle(), builtin::address_of(), {GetRef<PrimExpr>(op)});
+    return Call(op->dtype, builtin::masked_load(), {ptr, mask_, make_zero(op->dtype)});
+  }
+  PrimExpr VisitExpr_(const CallNode* op) final {
+    int64_t effect = op_call_effect_.get(op->op, Integer(-1)).IntValue();
+    if (effect < 0 || effect > static_cast<int64_t>(CallEffectKind::kReadState)) {
+      failed = true;
+      return GetRef<PrimExpr>(op);
+    }
+    return ExprMutator::VisitExpr_(op);
+  }
+  // the integer divisions by the zeros of the inactive lanes trap
+  PrimExpr VisitExpr_(const DivNode* op) final { return Divide(op); }
+  PrimExpr VisitExpr_(const ModNode* op) final { return Divide(op); }
+  PrimExpr VisitExpr_(const FloorDivNode* op) final { return Divide(op); }
+  PrimExpr VisitExpr_(const FloorModNode* op) final { return Divide(op); }
+
+  template <typename T>
+  PrimExpr Divide(const T* op) {
+    if (!op->dtype.is_float()) {
+      failed = true;
+      return GetRef<PrimExpr>(op);
+    }
+    return ExprMutator::VisitExpr_(op);
+  }
+
+  PrimExpr mask_;
+  OpAttrMap<TCallEffectKind> op_call_effect_ = Op::GetAttrMap<TCallEffectKind>("TCallEffectKind");
+};
+
 // This is because the transformation can change the dtype of the Expr
 // The existing ExprMutator transformation rules may not be well defined.
 class Vectorizer : public StmtMutator, public ExprFunctor<PrimExpr(const PrimExpr&)> {
@@ -149,7 +212,8 @@ class Vectorizer : public StmtMutator, public ExprFunctor<PrimExpr(const PrimExp
   using ExprFunctor::VisitExpr;
   using StmtMutator::operator();
 
-  Vectorizer(Var var, int var_lanes) : var_(var), var_lanes_(var_lanes) {
+  Vectorizer(Var var, int var_lanes, bool masked_tail = false)
+      : var_(var), var_lanes_(var_lanes), masked_tail_(masked_tail) {
     ramp_ = Ramp(IntImm(var->dtype, 0), IntImm(var->dtype, 1), var_lanes);
   }
 
@@ -467,6 +531,11 @@ class Vectorizer : public StmtMutator, public ExprFunctor<PrimExpr(const PrimExp
     ICHECK(!op->condition.dtype().is_vector());
     PrimExpr condition = this->VisitExpr(op->condition);
     if (condition.dtype().is_vector()) {
+      if (masked_tail_ && !op->else_case) {
+        if (Optional<Stmt> masked = MaskStores(condition, op->then_case)) {
+          return masked.value();
+        }
+      }
       return Scalarize(GetRef<Stmt>(op));
     }
     Stmt then_case = this->VisitStmt(op->then_case);
@@ -541,6 +610,41 @@ class Vectorizer : public StmtMutator, public ExprFunctor<PrimExpr(const PrimExp
     return Allocate(op->buffer_var, op->dtype, extents, condition, body);
   }
 
+  // Store the lanes where the condition holds with masked stores, the loads of the values being
+  // masked as well, as the tail of a loop that does not divide by the lanes. NullOpt when an
+  // access is not contiguous or an op may trap in the inactive lanes.
+  Optional<Stmt> MaskStores(PrimExpr mask, const Stmt& body) {
+    if (const auto* call = mask.as<CallNode>()) {
+      if (call->op.same_as(builtin::likely())) mask = call->args[0];
+    }
+    if (!mask.dtype().is_bool() || MaskedAccessRewriter::HasLoad(mask)) return NullOpt;
+    int lanes = mask.dtype().lanes();
+    Array<Stmt> stores;
+    if (const auto* seq = body.as<SeqStmtNode>()) {
+      stores = seq->seq;
+    } else {
+      stores.push_back(body);
+    }
+    Array<Stmt> masked;
+    for (const Stmt& stmt : stores) {
+      if (!stmt->IsInstance<BufferStoreNode>()) return NullOpt;
+      Stmt vec = this->VisitStmt(stmt);
+      const auto* store = vec.as<BufferStoreNode>();
+      if (!store || store->value.dtype().lanes() != lanes ||
+          !MaskedAccessRewriter::IsContiguous(store->buffer, store->indices, lanes)) {
+        return NullOpt;
+      }
+      MaskedAccessRewriter rewriter(mask);
+      PrimExpr value = rewriter(store->value);
+      if (rewriter.failed) return NullOpt;
+      PrimExpr ptr = Call(DataType::Handle(), builtin::address_of(),
+                          {BufferLoad(store->buffer, store->indices)});
+      masked.push_back(
+          Evaluate(Call(DataType::Int(32), builtin::masked_store(), {ptr, value, mask})));
+    }
+    return SeqStmt::Flatten(masked);
+  }
+
   // scalarize the statment
   Stmt Scalarize(Stmt stmt) {
     Var idx(var_->name_hint + ".s", var_->dtype);
@@ -562,6 +666,8 @@ class Vectorizer : public StmtMutator, public ExprFunctor<PrimExpr(const PrimExp
   Var var_;
   // the lanes.
   int var_lanes_;
+  // whether the conditional stores are masked rather than scalarized
+  bool masked_tail_;
   // ramp representing the var.
   PrimExpr ramp_;
   // flag to mark requirment of scalarization.
@@ -633,18 +739,60 @@ class Vectorizer : public StmtMutator, public ExprFunctor<PrimExpr(const PrimExp
 
 class LoopVectorizer : public StmtMutator {
  public:
+  explicit LoopVectorizer(bool masked_tail = false, int dynamic_vector_bits = 128)
+      : masked_tail_(masked_tail), dynamic_vector_bits_(dynamic_vector_bits) {}
+
   Stmt VisitStmt_(const ForNode* op) final {
     if (op->kind == ForKind::kVectorized) {
       ICHECK(is_zero(op->min));
       auto* extent_as_int = op->extent.as<IntImmNode>();
+      if (!extent_as_int && op->extent.dtype().is_int()) {
+        return VectorizeDynamic(op);
+      }
       if (!extent_as_int || extent_as_int->value < 1) {
         LOG(FATAL) << "Failed to vectorize loop with extent " << op->extent;
       }
-      return Vectorizer(op->loop_var, static_cast<int>(extent_as_int->value))(op->body);
+      return Vectorizer(op->loop_var, static_cast<int>(extent_as_int->value),
+                        masked_tail_)(op->body);
     } else {
       return StmtMutator::VisitStmt_(op);
     }
   }
+
+ private:
+  // Strip mine a loop of dynamic extent into the full vectors of the widest element of the body
+  // in the vector bits, and a predicated tail, which is masked with masked_tail_.
+  Stmt VectorizeDynamic(const ForNode* op) {
+    int bits = 8;
+    PostOrderVisit(op->body, [&bits](const ObjectRef& n) {
+      if (const auto* store = n.as<BufferStoreNode>()) {
+        bits = std::max(bits, store->value.dtype().bits());
+      } else if (const auto* load = n.as<BufferLoadNode>()) {
+        bits = std::max(bits, load->dtype.bits());
+      }
+    });
+    int lanes = std::max(1, dynamic_vector_bits_ / bits);
+    DataType dtype = op->extent.dtype();
+    // no full vector (and no tail lane, which starts at 0) for a non-positive extent
+    PrimExpr num_full = floordiv(max(op->extent, make_zero(dtype)), make_const(dtype, lanes));
+    PrimExpr tail_min = num_full * make_const(dtype, lanes);
+
+    Var outer = op->loop_var.copy_with_suffix(".outer");
+    Var lane = op->loop_var.copy_with_suffix(".inner");
+    Stmt full = Substitute(op->body, {{op->loop_var, outer * make_const(dtype, lanes) + lane}});
+    full = Vectorizer(lane, lanes, masked_tail_)(std::move(full));
+    full = For(outer, make_zero(dtype), num_full, ForKind::kSerial, std::move(full));
+
+    Var tail_lane = op->loop_var.copy_with_suffix(".tail");
+    PrimExpr index = tail_min + tail_lane;
+    Stmt tail = IfThenElse(likely(index < op->extent),
+                           Substitute(op->body, {{op->loop_var, index}}));
+    tail = Vectorizer(tail_lane, lanes, masked_tail_)(std::move(tail));
+    return SeqStmt({full, tail});
+  }
+
+  bool masked_tail_;
+  int dynamic_vector_bits_;
 };
 
 Stmt VectorizeLoop(Stmt stmt) { return LoopVectorizer()(std::move(stmt)); }
@@ -666,12 +814,22 @@ Stmt SkipVectorize(Stmt stmt) { return VectorizeSkipper()(std::move(stmt)); }
 
 namespace transform {
 
+TVM_REGISTER_PASS_CONFIG_OPTION("tir.vectorize_masked_tail", Bool);
+TVM_REGISTER_PASS_CONFIG_OPTION("tir.vectorize_dynamic_vector_bits", Integer);
+
 // TODO(tvm-team): Make it as a target property.
 Pass VectorizeLoop(bool enable_vectorize) {
   auto pass_func = [=](PrimFunc f, IRModule m, PassContext ctx) {
     auto* n = f.CopyOnWrite();
     if (enable_vectorize) {
-      n->body = LoopVectorizer()(std::move(n->body));
+      // the masked accesses are lowered by the llvm backends only
+      bool masked_tail = ctx->GetConfig<Bool>("tir.vectorize_masked_tail", Bool(false)).value();
+      if (auto target = f->GetAttr<Target>(tvm::attr::kTarget)) {
+        masked_tail = masked_tail && target.value()->kind->name == "llvm";
+      }
+      int vector_bits =
+          ctx->GetConfig<Integer>("tir.vectorize_dynamic_vector_bits", Integer(128)).value()->value;
+      n->body = LoopVectorizer(masked_tail, vector_bits)(std::move(n->body));
     } else {
       n->body = VectorizeSkipper()(std::move(n->body));
     }
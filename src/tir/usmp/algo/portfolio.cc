@@ -0,0 +1,322 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file tir/usmp/algo/portfolio.cc
+ * \brief A time bounded portfolio of the USMP algorithms.
+ *
+ * greedy_by_size, greedy_by_conflicts and hill_climb are run in turn, and instances with few
+ * buffers are then solved exactly by a branch and bound in the time left. The allocation with the
+ * smallest total pool size is kept.
+ *
+ * The exact search places the buffers by non-decreasing offsets. Any allocation can be compacted
+ * so that each buffer sits at offset 0 or right above a conflicting buffer of the same pool, so
+ * only those offsets are tried.
+ */
+
+#include <tvm/ir/transform.h>
+#include <tvm/runtime/registry.h>
+#include <tvm/tir/usmp/algorithms.h>
+#include <tvm/tir/usmp/utils.h>
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tvm {
+namespace tir {
+namespace usmp {
+namespace algo {
+
+using Clock = std::chrono::steady_clock;
+
+/*! \brief The largest offset + size of the buffers placed in each pool. */
+static std::unordered_map<PoolInfo, size_t, ObjectPtrHash, ObjectPtrEqual> PoolSizes(
+    const Map<BufferInfo, PoolAllocation>& allocations) {
+  std::unordered_map<PoolInfo, size_t, ObjectPtrHash, ObjectPtrEqual> pool_sizes;
+  for (const auto& it : allocations) {
+    size_t end = it.second->byte_offset.IntValue() + it.first->size_bytes.IntValue();
+    pool_sizes[it.second->pool_info] = std::max(pool_sizes[it.second->pool_info], end);
+  }
+  return pool_sizes;
+}
+
+/*! \brief Returns whether no conflicting buffers overlap and every pool is within its size hint. */
+static bool IsValidAllocation(const Map<BufferInfo, PoolAllocation>& allocations) {
+  for (const auto& it : allocations) {
+    const PoolAllocation& pa = it.second;
+    if (!pa->pool_info.defined()) return false;
+    int64_t begin = pa->byte_offset.IntValue();
+    int64_t end = begin + it.first->size_bytes.IntValue();
+    int64_t size_hint = pa->pool_info->size_hint_bytes.IntValue();
+    if (size_hint != kUnrestrictedPoolSizeHint && end > size_hint) return false;
+    for (const auto& conflict_obj : it.first->conflicts) {
+      BufferInfo conflict = Downcast<BufferInfo>(conflict_obj);
+      auto other = allocations.Get(conflict);
+      if (!other || !other.value()->pool_info.same_as(pa->pool_info)) continue;
+      int64_t other_begin = other.value()->byte_offset.IntValue();
+      int64_t other_end = other_begin + conflict->size_bytes.IntValue();
+      if (begin < other_end && other_begin < end) return false;
+    }
+  }
+  return true;
+}
+
+/*! \brief Branch and bound search of the allocation with the smallest total pool size. */
+class ExactAllocator {
+ public:
+  ExactAllocator(const Array<BufferInfo>& buffer_info_arr, Clock::time_point deadline)
+      : deadline_(deadline) {
+    std::unordered_map<const BufferInfoNode*, size_t> index;
+    for (const BufferInfo& buf_info : buffer_info_arr) {
+      index[buf_info.get()] = buffers_.size();
+      buffers_.push_back(buf_info);
+    }
+    std::unordered_map<PoolInfo, size_t, ObjectPtrHash, ObjectPtrEqual> pool_index;
+    for (const BufferInfo& buf_info : buffers_) {
+      std::vector<size_t> pools;
+      for (const PoolInfo& pool_info : buf_info->pool_candidates) {
+        auto it = pool_index.find(pool_info);
+        if (it == pool_index.end()) {
+          it = pool_index.emplace(pool_info, pools_.size()).first;
+          pools_.push_back(pool_info);
+        }
+        pools.push_back(it->second);
+      }
+      candidates_.push_back(std::move(pools));
+      std::vector<size_t> conflicts;
+      for (const auto& conflict : buf_info->conflicts) {
+        auto it = index.find(conflict.as<BufferInfoNode>());
+        if (it != index.end()) conflicts.push_back(it->second);
+      }
+      conflicts_.push_back(std::move(conflicts));
+    }
+  }
+
+  /*!
+   * \brief Searches for an allocation smaller than \p upper_bound, stopping at \p lower_bound.
+   * \return The allocation found, empty if none beats the upper bound in time.
+   */
+  Map<BufferInfo, PoolAllocation> PlanMemory(size_t upper_bound, size_t lower_bound) {
+    size_t n = buffers_.size();
+    best_total_ = upper_bound;
+    lower_bound_ = lower_bound;
+    placed_.assign(n, false);
+    offsets_.assign(n, 0);
+    pool_of_.assign(n, 0);
+    pool_tops_.assign(pools_.size(), 0);
+    Search(0, 0, 0);
+
+    Map<BufferInfo, PoolAllocation> result;
+    for (size_t i = 0; i < best_offsets_.size(); ++i) {
+      result.Set(buffers_[i], PoolAllocation(pools_[best_pools_[i]], Integer(best_offsets_[i])));
+    }
+    return result;
+  }
+
+  /*! \return Whether the search ran out of time before it was exhaustive. */
+  bool timed_out() const { return timed_out_; }
+
+ private:
+  void Search(size_t depth, size_t last_offset, size_t last_index) {
+    if (timed_out_ || best_total_ <= lower_bound_) return;
+    if ((++visited_ & 0xff) == 0 && Clock::now() > deadline_) {
+      timed_out_ = true;
+      return;
+    }
+    if (depth == buffers_.size()) {
+      best_total_ = Total(pool_tops_);
+      best_offsets_ = offsets_;
+      best_pools_ = pool_of_;
+      return;
+    }
+    for (size_t i = 0; i < buffers_.size(); ++i) {
+      if (placed_[i]) continue;
+      size_t size = buffers_[i]->size_bytes.IntValue();
+      size_t alignment = std::max<int64_t>(buffers_[i]->alignment.IntValue(), 1);
+      for (size_t pool : candidates_[i]) {
+        std::vector<size_t> offsets = {0};
+        for (size_t j : conflicts_[i]) {
+          if (placed_[j] && pool_of_[j] == pool) {
+            size_t end = offsets_[j] + buffers_[j]->size_bytes.IntValue();
+            offsets.push_back((end + alignment - 1) / alignment * alignment);
+          }
+        }
+        std::sort(offsets.begin(), offsets.end());
+        offsets.erase(std::unique(offsets.begin(), offsets.end()), offsets.end());
+        for (size_t offset : offsets) {
+          // Visit each set of placements once, by non-decreasing offsets then indices.
+          if (offset < last_offset || (depth > 0 && offset == last_offset && i <= last_index)) {
+            continue;
+          }
+          if (!Fits(i, pool, offset, size)) continue;
+          size_t old_top = pool_tops_[pool];
+          pool_tops_[pool] = std::max(old_top, offset + size);
+          if (Total(pool_tops_) < best_total_) {
+            placed_[i] = true;
+            offsets_[i] = offset;
+            pool_of_[i] = pool;
+            Search(depth + 1, offset, i);
+            placed_[i] = false;
+          }
+          pool_tops_[pool] = old_top;
+        }
+      }
+    }
+  }
+
+  bool Fits(size_t i, size_t pool, size_t offset, size_t size) const {
+    int64_t size_hint = pools_[pool]->size_hint_bytes.IntValue();
+    if (size_hint != kUnrestrictedPoolSizeHint && offset + size > static_cast<size_t>(size_hint)) {
+      return false;
+    }
+    for (size_t j : conflicts_[i]) {
+      if (!placed_[j] || pool_of_[j] != pool) continue;
+      size_t end = offsets_[j] + buffers_[j]->size_bytes.IntValue();
+      if (offset < end && offsets_[j] < offset + size) return false;
+    }
+    return true;
+  }
+
+  static size_t Total(const std::vector<size_t>& pool_tops) {
+    size_t total = 0;
+    for (size_t top : pool_tops) total += top;
+    return total;
+  }
+
+  Clock::time_point deadline_;
+  std::vector<BufferInfo> buffers_;
+  std::vector<PoolInfo> pools_;
+  std::vector<std::vector<size_t>> candidates_;
+  std::vector<std::vector<size_t>> conflicts_;
+
+  std::vector<bool> placed_;
+  std::vector<size_t> offsets_;
+  std::vector<size_t> pool_of_;
+  std::vector<size_t> pool_tops_;
+
+  size_t best_total_{0};
+  size_t lower_bound_{0};
+  std::vector<size_t> best_offsets_;
+  std::vector<size_t> best_pools_;
+  size_t visited_{0};
+  bool timed_out_{false};
+};
+
+Map<String, ObjectRef> AllocationMetrics(const Map<BufferInfo, PoolAllocation>& allocations,
+                                         const Integer& memory_pressure) {
+  size_t total = 0;
+  Map<String, Integer> pool_bytes;
+  for (const auto& it : PoolSizes(allocations)) {
+    total += it.second;
+    pool_bytes.Set(it.first->pool_name, Integer(it.second));
+  }
+  size_t buffer_bytes = 0;
+  for (const auto& it : allocations) buffer_bytes += it.first->size_bytes.IntValue();
+  // The bytes of the pools that are never used by the live buffers at the peak.
+  double fragmentation =
+      total == 0 ? 0.0 : 1.0 - static_cast<double>(memory_pressure.IntValue()) / total;
+  return {{"total_bytes", Integer(total)},
+          {"pool_bytes", pool_bytes},
+          {"buffer_bytes", Integer(buffer_bytes)},
+          {"memory_pressure", memory_pressure},
+          {"fragmentation", FloatImm(DataType::Float(64), fragmentation)}};
+}
+
+Map<BufferInfo, PoolAllocation> Portfolio(const Array<BufferInfo>& buffer_info_arr,
+                                          const Integer& memory_pressure) {
+  tvm::transform::PassContext ctx = tvm::transform::PassContext::Current();
+  int64_t time_limit_ms =
+      ctx->GetConfig<Integer>(kUSMPPortfolioTimeLimitOption, Integer(1000)).value().IntValue();
+  int64_t exact_max_buffers =
+      ctx->GetConfig<Integer>(kUSMPPortfolioExactMaxBuffersOption, Integer(12)).value().IntValue();
+  Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(time_limit_ms);
+
+  using Algorithm = std::function<Map<BufferInfo, PoolAllocation>(const Array<BufferInfo>&,
+                                                                  const Integer&)>;
+  std::vector<std::pair<std::string, Algorithm>> algorithms = {
+      {"greedy_by_size", GreedyBySize},
+      {"greedy_by_conflicts", GreedyByConflicts},
+      {"hill_climb", HillClimb}};
+
+  Map<BufferInfo, PoolAllocation> best;
+  std::string best_name;
+  size_t best_total = 0;
+  std::string last_error;
+  auto consider = [&](const std::string& name, const Map<BufferInfo, PoolAllocation>& result) {
+    if (!IsValidAllocation(result)) return;
+    size_t total = 0;
+    for (const auto& it : PoolSizes(result)) total += it.second;
+    VLOG(1) << "USMP portfolio: " << name << " allocates " << total << " bytes";
+    if (best_name.empty() || total < best_total) {
+      best = result;
+      best_name = name;
+      best_total = total;
+    }
+  };
+  for (const auto& algorithm : algorithms) {
+    // The greedy allocations always run, so that there is a result to fall back to.
+    if (!best_name.empty() && Clock::now() > deadline) break;
+    try {
+      consider(algorithm.first, algorithm.second(buffer_info_arr, memory_pressure));
+    } catch (const Error& e) {
+      last_error = e.what();
+    }
+  }
+  if (static_cast<int64_t>(buffer_info_arr.size()) <= exact_max_buffers &&
+      Clock::now() < deadline) {
+    ExactAllocator exact(buffer_info_arr, deadline);
+    size_t upper_bound = best_name.empty() ? std::numeric_limits<size_t>::max() : best_total;
+    Map<BufferInfo, PoolAllocation> result =
+        exact.PlanMemory(upper_bound, memory_pressure.IntValue());
+    if (!result.empty()) {
+      consider(exact.timed_out() ? "exact (timed out)" : "exact", result);
+    }
+  }
+  CHECK(!best_name.empty()) << "TVM USMP Error: no algorithm of the portfolio could fit the "
+                               "buffers in the pools. Please increase the size_hints for memory "
+                               "pools.\n"
+                            << last_error;
+
+  Map<String, ObjectRef> metrics = AllocationMetrics(best, memory_pressure);
+  VLOG(1) << "USMP portfolio picked " << best_name << ": " << best_total
+          << " bytes for a memory pressure of " << memory_pressure << " bytes, fragmentation "
+          << Downcast<FloatImm>(metrics["fragmentation"])->value;
+  return best;
+}
+
+TVM_REGISTER_GLOBAL("tir.usmp.algo.portfolio")
+    .set_body_typed([](Array<BufferInfo> buffer_info_arr, Integer memory_pressure) {
+      return Portfolio(buffer_info_arr, memory_pressure);
+    });
+
+TVM_REGISTER_GLOBAL("tir.usmp.algo.allocation_metrics")
+    .set_body_typed([](Map<BufferInfo, PoolAllocation> allocations, Integer memory_pressure) {
+      return AllocationMetrics(allocations, memory_pressure);
+    });
+
+}  // namespace algo
+}  // namespace usmp
+}  // namespace tir
+}  // namespace tvm
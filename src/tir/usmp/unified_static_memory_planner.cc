@@ -42,6 +42,9 @@ TVM_REGISTER_PASS_CONFIG_OPTION(kUSMPEnableOption, Bool);
 TVM_REGISTER_PASS_CONFIG_OPTION(kUSMPAlgorithmOption, String);
 TVM_REGISTER_PASS_CONFIG_OPTION(kUSMPUseWorkspaceIO, Bool);
 TVM_REGISTER_PASS_CONFIG_OPTION(kUSMPCustomAlgorithmOption, String);
+TVM_REGISTER_PASS_CONFIG_OPTION(kUSMPPortfolioTimeLimitOption, Integer);
+TVM_REGISTER_PASS_CONFIG_OPTION(kUSMPPortfolioExactMaxBuffersOption, Integer);
+TVM_REGISTER_PASS_CONFIG_OPTION(kUSMPStaticArenaOption, Bool);
 
 namespace tir {
 namespace usmp {
@@ -52,10 +55,11 @@ static std::unordered_map<String, std::function<Map<BufferInfo, PoolAllocation>(
                                       const Array<BufferInfo>&, const Integer&)>>
     algorithms{{"greedy_by_size", algo::GreedyBySize},
                {"greedy_by_conflicts", algo::GreedyByConflicts},
-               {"hill_climb", algo::HillClimb}};
+               {"hill_climb", algo::HillClimb},
+               {"portfolio", algo::Portfolio}};
 
 IRModule PlanMemory(const IRModule& mod, String algo, bool use_workspace_io,
-                    Optional<String> opt_custom_algo) {
+                    Optional<String> opt_custom_algo, bool static_arena) {
   VLOG(1) << "workspace required = " << CalculateModuleWorkspaceSize(mod);
   IRModule module = mod->ShallowCopy();
   if (use_workspace_io) {
@@ -91,6 +95,9 @@ IRModule PlanMemory(const IRModule& mod, String algo, bool use_workspace_io,
         GetIOPoolAllocations(buffer_info_pool_allocations);
     module = WithAttr(module, tvm::attr::kIOTensorPoolAllocations, io_pool_allocations);
   }
+  if (static_arena) {
+    module = WithAttr(module, tvm::attr::kArenaBufferAllocations, buffer_info_pool_allocations);
+  }
   tir::PrimFunc tir_main_func =
       Downcast<tir::PrimFunc>(module->Lookup(::tvm::runtime::symbol::tvm_module_main));
   Optional<Array<tir::usmp::AllocatedPoolInfo>> allocated_pool_infos =
@@ -112,6 +119,7 @@ tvm::transform::Pass UnifiedStaticMemoryPlanner() {
     auto algorithm_str = ctx->GetConfig(kUSMPAlgorithmOption, String(usmp::kDefaultAlgo));
     auto use_workspace_io = ctx->GetConfig(kUSMPUseWorkspaceIO, Bool(false));
     auto custom_algorithm_str = ctx->GetConfig<String>(kUSMPCustomAlgorithmOption);
+    auto static_arena = ctx->GetConfig(kUSMPStaticArenaOption, Bool(false));
     tvm::relay::Executor executor_config =
         m->GetAttr<tvm::relay::Executor>(tvm::attr::kExecutor).value();
     String interface_api = executor_config->GetAttr<String>("interface-api").value_or("packed");
@@ -125,7 +133,8 @@ tvm::transform::Pass UnifiedStaticMemoryPlanner() {
     }
     return Downcast<IRModule>(
         usmp::PlanMemory(m, algorithm_str.value_or(String(usmp::kDefaultAlgo)),
-                         use_workspace_io.value_or(Bool(false)), custom_algorithm_str));
+                         use_workspace_io.value_or(Bool(false)), custom_algorithm_str,
+                         static_arena.value_or(Bool(false))));
   };
 
   return tvm::transform::CreateModulePass(usmp_main_pass_func, 0,
@@ -25,10 +25,15 @@
 #include "auto_vectorize.h"
 
 #include <tvm/arith/iter_affine_map.h>
+#include <tvm/tir/analysis.h>
 #include <tvm/tir/builtin.h>
 #include <tvm/tir/stmt_functor.h>
+#include <tvm/tir/transform.h>
 
+#include <algorithm>
 #include <numeric>
+#include <unordered_set>
+#include <vector>
 
 #include "../arith/int_operator.h"
 #include "../arith/ir_visitor_with_analyzer.h"
@@ -40,9 +45,28 @@ namespace tl {
 
 using namespace tir;
 
+TVM_REGISTER_PASS_CONFIG_OPTION("tl.disable_vectorize_alignment_check", Bool);
+
+// tl::AtomicAdd(address_of(dst[...]), src[...]), the value should be read from the registers
+static bool IsVectorizableAtomicAdd(const CallNode* call) {
+  if (!call->op.same_as(builtin::call_extern()) || call->args.size() != 3) return false;
+  auto name = call->args[0].as<StringImmNode>();
+  if (name == nullptr || name->value != "tl::AtomicAdd") return false;
+  auto dst = call->args[1].as<CallNode>();
+  if (dst == nullptr || !dst->op.same_as(builtin::address_of())) return false;
+  PrimExpr value = call->args[2];
+  if (auto cast = value.as<CastNode>()) value = cast->value;
+  auto src = value.as<BufferLoadNode>();
+  if (src == nullptr) return false;
+  return src->buffer.scope() == "local" || src->buffer.scope() == "local.fragment";
+}
+
 class VectorizePlanner : public arith::IRVisitorWithAnalyzer {
  public:
-  VectorizePlanner() = default;
+  // With runtime_alignment, the global accesses whose offset can't be proven aligned (e.g. the
+  // views with an offset of a tensor) are planned as if aligned, see RuntimeChecks.
+  explicit VectorizePlanner(bool runtime_alignment = false)
+      : runtime_alignment_(runtime_alignment) {}
 
   int Plan(const For& node) {
     this->operator()(node);
@@ -50,6 +74,46 @@ class VectorizePlanner : public arith::IRVisitorWithAnalyzer {
     return vector_size_;
   }
 
+  // The conditions under which the vector size is valid: the alignment of the global pointers,
+  // which torch passes as the data pointers of the views, and of the offsets planned as aligned.
+  // NullOpt if the loop accesses the shared memory, whose copies must keep their static vector
+  // size (e.g. for cp.async), or if a condition depends on the loop itself.
+  Optional<Array<PrimExpr>> RuntimeChecks(int vector_size) {
+    if (has_shared_memory_access_) return NullOpt;
+    Array<PrimExpr> checks;
+    if (vector_size == 1) return checks;
+    auto add_check = [&checks](const PrimExpr& check) {
+      for (const PrimExpr& other : checks) {
+        if (StructuralEqual()(check, other)) return;
+      }
+      checks.push_back(check);
+    };
+    for (const PrimExpr& base : global_bases_) {
+      PrimExpr check = analyzer_.Simplify(FloorMod(base, vector_size) == 0);
+      if (is_one(check)) continue;
+      bool local_var = UsesVar(check, [this](const VarNode* var) {
+        return iter_map_.count(GetRef<Var>(var)) || let_vars_.count(var);
+      });
+      if (local_var) return NullOpt;
+      add_check(check);
+    }
+    for (const Buffer& buffer : global_buffers_) {
+      int bytes = std::min(vector_size * buffer->dtype.bytes(), vector_load_bits_max_ / 8);
+      if (bytes <= buffer->dtype.bytes()) continue;
+      Array<PrimExpr> args{StringImm("tl::is_aligned"), buffer->data,
+                           IntImm(DataType::Int(32), bytes)};
+      add_check(Call(DataType::Bool(), builtin::call_extern(), args));
+    }
+    // the symbolic strides of the strided views, see StridedVectorSize
+    for (const PrimExpr& stride : unit_strides_) {
+      add_check(analyzer_.Simplify(stride == 1));
+    }
+    for (const PrimExpr& stride : aligned_strides_) {
+      add_check(analyzer_.Simplify(FloorMod(stride, vector_size) == 0));
+    }
+    return checks;
+  }
+
  private:
   void VisitStmt_(const ForNode* node) final {
     inner_for_ = node;
@@ -57,11 +121,24 @@ class VectorizePlanner : public arith::IRVisitorWithAnalyzer {
     arith::IRVisitorWithAnalyzer::VisitStmt_(node);
   }
 
+  void VisitStmt_(const LetStmtNode* node) final {
+    let_vars_.insert(node->var.get());
+    arith::IRVisitorWithAnalyzer::VisitStmt_(node);
+  }
+
+  void VisitExpr_(const LetNode* node) final {
+    let_vars_.insert(node->var.get());
+    arith::IRVisitorWithAnalyzer::VisitExpr_(node);
+  }
+
   void VisitExpr_(const BufferLoadNode* node) final {
     if (node->buffer.scope() == "shared" || node->buffer.scope() == "global" ||
         node->buffer.scope() == "shared.dyn")
       has_nonlocal_memory_access_ = true;
-    UpdateVectorSize(node->indices, node->buffer);
+    if (node->buffer.scope() == "shared" || node->buffer.scope() == "shared.dyn")
+      has_shared_memory_access_ = true;
+    // a load invariant in the vectorized loop is broadcast, e.g. the row index of a gather copy
+    if (!IsLoopInvariant(node->indices)) UpdateVectorSize(node->indices, node->buffer);
     return arith::IRVisitorWithAnalyzer::VisitExpr_(node);
   }
 
@@ -69,6 +146,8 @@ class VectorizePlanner : public arith::IRVisitorWithAnalyzer {
     if (node->buffer.scope() == "shared" || node->buffer.scope() == "global" ||
         node->buffer.scope() == "shared.dyn")
       has_nonlocal_memory_access_ = true;
+    if (node->buffer.scope() == "shared" || node->buffer.scope() == "shared.dyn")
+      has_shared_memory_access_ = true;
     UpdateVectorSize(node->indices, node->buffer);
     return arith::IRVisitorWithAnalyzer::VisitStmt_(node);
   }
@@ -82,8 +161,13 @@ class VectorizePlanner : public arith::IRVisitorWithAnalyzer {
     if (node->op == builtin::if_then_else()) {
       CheckConditionVectorized(node->args[0]);
     } else if (node->op == builtin::call_extern()) {
-      // do not vectorize extern calls
-      vector_size_ = 1;
+      if (IsVectorizableAtomicAdd(node)) {
+        // atomics on up to 4 consecutive elements, see tl::AtomicAddx2/x4
+        vector_size_ = arith::ZeroAwareGCD(vector_size_, 4);
+      } else {
+        // do not vectorize extern calls
+        vector_size_ = 1;
+      }
     }
     return arith::IRVisitorWithAnalyzer::VisitExpr_(node);
   }
@@ -92,6 +176,15 @@ class VectorizePlanner : public arith::IRVisitorWithAnalyzer {
     // TODO: perform some checks here
   }
 
+  bool IsLoopInvariant(const Array<PrimExpr>& indices) const {
+    if (!inner_for_) return false;
+    const VarNode* var = inner_for_->loop_var.get();
+    for (const auto& index : indices) {
+      if (UsesVar(index, [var](const VarNode* v) { return v == var; })) return false;
+    }
+    return true;
+  }
+
   void UpdateVectorSize(const Array<PrimExpr> indices, const Buffer& buffer) {
     if (!inner_for_) return;
     auto extent_ptr = inner_for_->extent.as<IntImmNode>();
@@ -107,16 +200,62 @@ class VectorizePlanner : public arith::IRVisitorWithAnalyzer {
 
     PrimExpr lsi = indices.back();
     auto iter_sum = arith::NormalizeToIterSum(lsi, iter_map_, &analyzer_);
-    int access_vector_size = GetVectorSize(iter_sum, inner_for_->loop_var, max_vector_size);
+    bool runtime_base = runtime_alignment_ && buffer.scope() == "global" &&
+                        !is_const_int(iter_sum->base);
+    if (buffer.scope() == "global") {
+      if (runtime_base) global_bases_.push_back(iter_sum->base);
+      if (std::none_of(global_buffers_.begin(), global_buffers_.end(),
+                       [&buffer](const Buffer& other) { return other.same_as(buffer); }))
+        global_buffers_.push_back(buffer);
+    }
+    if (!buffer->strides.empty()) {
+      max_vector_size = StridedVectorSize(buffer, indices, max_vector_size);
+    }
+    int access_vector_size =
+        GetVectorSize(iter_sum, inner_for_->loop_var, max_vector_size, runtime_base);
     int vector_size = arith::ZeroAwareGCD(max_vector_size, access_vector_size);
     vector_size_ = arith::ZeroAwareGCD(vector_size, vector_size_);
   }
 
-  int GetVectorSize(arith::IterSumExpr iter_sum, Var last_var, int max_vector_size) {
+  // The vector size, up to max_vector_size, allowed by the strides of a strided view (e.g. a
+  // transposed or sliced torch tensor): the vectors run along the last dim, which must have a
+  // unit stride, and start at a multiple of the vector size if the other strides are multiples of
+  // it. With runtime_alignment the symbolic strides of the global views are checked at runtime,
+  // otherwise they must be proven.
+  int StridedVectorSize(const Buffer& buffer, const Array<PrimExpr>& indices, int max_vector_size) {
+    const Array<PrimExpr>& strides = buffer->strides;
+    bool runtime = runtime_alignment_ && buffer.scope() == "global";
+    auto add_unique = [](std::vector<PrimExpr>* exprs, const PrimExpr& expr) {
+      for (const PrimExpr& other : *exprs) {
+        if (StructuralEqual()(expr, other)) return;
+      }
+      exprs->push_back(expr);
+    };
+    if (!analyzer_.CanProveEqual(strides.back(), 1)) {
+      if (!runtime || is_const_int(strides.back())) return 1;
+      add_unique(&unit_strides_, strides.back());
+    }
+    int vector_size = max_vector_size;
+    for (size_t i = 0; i + 1 < strides.size(); i++) {
+      if (is_zero(indices[i])) continue;
+      if (auto stride = as_const_int(strides[i])) {
+        vector_size = arith::ZeroAwareGCD(vector_size, *stride);
+      } else if (runtime) {
+        add_unique(&aligned_strides_, strides[i]);
+      } else {
+        while (vector_size > 1 && !analyzer_.CanProveEqual(FloorMod(strides[i], vector_size), 0))
+          vector_size /= 2;
+      }
+    }
+    return vector_size;
+  }
+
+  int GetVectorSize(arith::IterSumExpr iter_sum, Var last_var, int max_vector_size,
+                    bool runtime_base) {
     int vector_size = 2;
     while ((max_vector_size % vector_size) == 0) {
       bool can_vector_load = true;
-      if (!analyzer_.CanProveEqual(FloorMod(iter_sum->base, vector_size), 0))
+      if (!runtime_base && !analyzer_.CanProveEqual(FloorMod(iter_sum->base, vector_size), 0))
         can_vector_load = false;
 
       for (const auto& split : iter_sum->args) {
@@ -146,7 +285,17 @@ class VectorizePlanner : public arith::IRVisitorWithAnalyzer {
   const ForNode* inner_for_;
   Map<Var, Range> iter_map_;
   bool has_nonlocal_memory_access_ = false;
+  bool has_shared_memory_access_ = false;
   int vector_size_ = 128;
+  const bool runtime_alignment_;
+  // the offsets of the global accesses planned as aligned, and the global buffers accessed
+  std::vector<PrimExpr> global_bases_;
+  std::vector<Buffer> global_buffers_;
+  // the symbolic strides of the global views checked at runtime: the strides of the last dims,
+  // equal to 1, and the other strides, multiples of the vector size
+  std::vector<PrimExpr> unit_strides_;
+  std::vector<PrimExpr> aligned_strides_;
+  std::unordered_set<const VarNode*> let_vars_;
 };
 
 class VectorizeRewriter : public StmtExprMutator {
@@ -166,6 +315,7 @@ class VectorizeRewriter : public StmtExprMutator {
       ICHECK(extent % vector_size_ == 0);
       ICHECK(is_zero(fnode->min));
       if (extent == vector_size_) {
+        if (auto atomic = VectorizeAtomicAdd(fnode->loop_var, fnode->body)) return atomic.value();
         fnode.CopyOnWrite()->kind = ForKind::kVectorized;
         return fnode;
       } else {
@@ -174,7 +324,11 @@ class VectorizeRewriter : public StmtExprMutator {
         Map<Var, PrimExpr> vmap;
         vmap.Set(fnode->loop_var, outer_var * vector_size_ + inner_var);
         Stmt body = Substitute(fnode->body, vmap);
-        body = For(inner_var, 0, vector_size_, ForKind::kVectorized, body);
+        if (auto atomic = VectorizeAtomicAdd(inner_var, body)) {
+          body = atomic.value();
+        } else {
+          body = For(inner_var, 0, vector_size_, ForKind::kVectorized, body);
+        }
         body = For(outer_var, 0, extent / vector_size_, fnode->kind, body, fnode->thread_binding,
                    fnode->annotations, fnode->span);
         return body;
@@ -184,19 +338,61 @@ class VectorizeRewriter : public StmtExprMutator {
     }
   }
 
+  // The vectorized loop of tl::AtomicAdd into a single tl::AtomicAddx2/x4 call
+  Optional<Stmt> VectorizeAtomicAdd(const Var& var, const Stmt& body) {
+    auto eval = body.as<EvaluateNode>();
+    if (eval == nullptr) return NullOpt;
+    auto call = eval->value.as<CallNode>();
+    if (call == nullptr || !IsVectorizableAtomicAdd(call)) return NullOpt;
+    ICHECK(vector_size_ == 2 || vector_size_ == 4);
+    PrimExpr value = call->args[2];
+    if (auto cast = value.as<CastNode>()) value = cast->value;
+    Map<Var, PrimExpr> vmap;
+    vmap.Set(var, make_zero(var.dtype()));
+    PrimExpr dst = Substitute(call->args[1], vmap);
+    PrimExpr src = Call(DataType::Handle(), builtin::address_of(), {Substitute(value, vmap)});
+    std::string name = "tl::AtomicAddx" + std::to_string(vector_size_);
+    return Evaluate(
+        Call(call->dtype, builtin::call_extern(), {StringImm(name), dst, src}, call->span));
+  }
+
   const ForNode* inner_for_;
   const int vector_size_;
 };
 
-int GetVectorizeSize(const For& loop) { return VectorizePlanner().Plan(loop); }
+// The vector size of the loop and, unless tl.disable_vectorize_alignment_check is set, the runtime
+// checks under which it is valid. The loops whose checks can't be hoisted out of them are planned
+// with the alignments proven statically.
+static int PlanVectorize(const For& loop, Array<PrimExpr>* checks) {
+  auto ctxt = transform::PassContext::Current();
+  bool runtime_alignment =
+      !ctxt->GetConfig<Bool>("tl.disable_vectorize_alignment_check", Bool(false)).value();
+  if (runtime_alignment) {
+    VectorizePlanner planner(/*runtime_alignment=*/true);
+    int vector_size = planner.Plan(loop);
+    if (auto runtime_checks = planner.RuntimeChecks(vector_size)) {
+      if (checks != nullptr) *checks = runtime_checks.value();
+      return vector_size;
+    }
+  }
+  return VectorizePlanner().Plan(loop);
+}
+
+int GetVectorizeSize(const For& loop) { return PlanVectorize(loop, nullptr); }
 
 Stmt VectorizeLoop(const For& loop, int vectorize_hint) {
+  Array<PrimExpr> checks;
   if (vectorize_hint <= 0) {
-    vectorize_hint = GetVectorizeSize(loop);
+    vectorize_hint = PlanVectorize(loop, &checks);
   }
   if (vectorize_hint == 1) return loop;
   auto rewriter = VectorizeRewriter(vectorize_hint);
-  return rewriter(loop);
+  Stmt vectorized = rewriter(loop);
+  if (checks.empty()) return vectorized;
+  // the scalar loop for the misaligned views
+  PrimExpr aligned = checks[0];
+  for (size_t i = 1; i < checks.size(); i++) aligned = aligned && checks[i];
+  return IfThenElse(likely(aligned), vectorized, loop);
 }
 
 }  // namespace tl
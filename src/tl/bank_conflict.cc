@@ -0,0 +1,324 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file bank_conflict.cc
+ * \brief Estimate the bank conflicts of shared memory accesses and plan the shared layouts
+ */
+
+#include "bank_conflict.h"
+
+#include <tvm/tir/builtin.h>
+#include <tvm/tir/expr_functor.h>
+#include <tvm/tir/stmt_functor.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <sstream>
+#include <unordered_set>
+
+#include "auto_vectorize.h"
+#include "op.h"
+
+namespace tvm {
+namespace tl {
+
+using namespace tir;
+
+// Evaluate an integer expression with all the variables bound, unbound variables (e.g. the outer
+// serial loops) are taken as zero.
+class ConstIntEvaluator : public ExprFunctor<int64_t(const PrimExpr&)> {
+ public:
+  void Bind(const Var& var, int64_t value) { values_[var.get()] = value; }
+
+  bool failed() const { return failed_; }
+
+ private:
+  int64_t VisitExpr_(const IntImmNode* op) final { return op->value; }
+  int64_t VisitExpr_(const VarNode* op) final {
+    auto it = values_.find(op);
+    return it == values_.end() ? 0 : it->second;
+  }
+  int64_t VisitExpr_(const CastNode* op) final { return VisitExpr(op->value); }
+  int64_t VisitExpr_(const AddNode* op) final { return VisitExpr(op->a) + VisitExpr(op->b); }
+  int64_t VisitExpr_(const SubNode* op) final { return VisitExpr(op->a) - VisitExpr(op->b); }
+  int64_t VisitExpr_(const MulNode* op) final { return VisitExpr(op->a) * VisitExpr(op->b); }
+  int64_t VisitExpr_(const MinNode* op) final {
+    return std::min(VisitExpr(op->a), VisitExpr(op->b));
+  }
+  int64_t VisitExpr_(const MaxNode* op) final {
+    return std::max(VisitExpr(op->a), VisitExpr(op->b));
+  }
+  int64_t VisitExpr_(const FloorDivNode* op) final {
+    int64_t a = VisitExpr(op->a), b = VisitExpr(op->b);
+    if (b == 0) return Fail();
+    int64_t q = a / b;
+    return (a % b != 0 && ((a < 0) != (b < 0))) ? q - 1 : q;
+  }
+  int64_t VisitExpr_(const FloorModNode* op) final {
+    int64_t a = VisitExpr(op->a), b = VisitExpr(op->b);
+    if (b == 0) return Fail();
+    int64_t r = a % b;
+    return (r != 0 && ((r < 0) != (b < 0))) ? r + b : r;
+  }
+  int64_t VisitExpr_(const DivNode* op) final {
+    int64_t b = VisitExpr(op->b);
+    return b == 0 ? Fail() : VisitExpr(op->a) / b;
+  }
+  int64_t VisitExpr_(const ModNode* op) final {
+    int64_t b = VisitExpr(op->b);
+    return b == 0 ? Fail() : VisitExpr(op->a) % b;
+  }
+  int64_t VisitExprDefault_(const Object* op) final { return Fail(); }
+
+  int64_t Fail() {
+    failed_ = true;
+    return 0;
+  }
+
+  std::unordered_map<const VarNode*, int64_t> values_;
+  bool failed_ = false;
+};
+
+// An element accessed by a thread of the first warp, the elements accessed with the same step
+// are issued by the same instruction.
+struct AccessRecord {
+  int64_t step;
+  int64_t thread;
+  int64_t row, col;
+};
+
+struct SharedAccess {
+  std::vector<AccessRecord> records;
+  // number of elements accessed by a thread in one instruction
+  int vector_size;
+};
+
+class SharedAccessCollector : public StmtExprVisitor {
+ public:
+  SharedAccessCollector(const Map<For, Fragment>& for_map, const Map<Buffer, Layout>& layout_map)
+      : for_map_(for_map), layout_map_(layout_map) {}
+
+  std::vector<Buffer> buffers_;
+  std::unordered_map<const BufferNode*, std::vector<SharedAccess>> accesses_;
+  std::unordered_set<const VarNode*> invalid_;
+
+ private:
+  // The number of points evaluated for a parallel loop
+  static constexpr int64_t kMaxLoopPoints = 1 << 18;
+
+  bool IsShared(const Buffer& buffer) const {
+    return buffer.scope() == "shared" || buffer.scope() == "shared.dyn";
+  }
+
+  void VisitStmt_(const BlockNode* op) final {
+    for (const auto& buffer : op->alloc_buffers) {
+      if (!IsShared(buffer) || layout_map_.count(buffer) || buffer->shape.size() != 2) continue;
+      if (!as_const_int(buffer->shape[0]) || !as_const_int(buffer->shape[1])) continue;
+      int bits = buffer->dtype.bits() * buffer->dtype.lanes();
+      if (bits != 8 && bits != 16 && bits != 32) continue;
+      buffers_.push_back(buffer);
+      tracked_.insert(buffer->data.get());
+    }
+    StmtExprVisitor::VisitStmt_(op);
+  }
+
+  void VisitStmt_(const ForNode* op) final {
+    if (root_ == nullptr && for_map_.count(GetRef<For>(op))) {
+      root_ = op;
+      StmtExprVisitor::VisitStmt_(op);
+      root_ = nullptr;
+      return;
+    }
+    StmtExprVisitor::VisitStmt_(op);
+  }
+
+  void VisitStmt_(const BufferStoreNode* op) final {
+    AddAccess(op->buffer, op->indices);
+    StmtExprVisitor::VisitStmt_(op);
+  }
+
+  void VisitExpr_(const BufferLoadNode* op) final {
+    AddAccess(op->buffer, op->indices);
+    StmtExprVisitor::VisitExpr_(op);
+  }
+
+  void VisitExpr_(const VarNode* op) final {
+    // the data pointer is used directly, e.g. by a tile op or tvm_access_ptr
+    if (tracked_.count(op)) invalid_.insert(op);
+  }
+
+  void VisitExpr_(const CallNode* op) final {
+    if (op->op.same_as(builtin::address_of()) || op->op.same_as(region())) {
+      if (const auto* load = op->args[0].as<BufferLoadNode>()) {
+        invalid_.insert(load->buffer->data.get());
+      }
+    }
+    StmtExprVisitor::VisitExpr_(op);
+  }
+
+  void AddAccess(const Buffer& buffer, const Array<PrimExpr>& indices) {
+    if (!tracked_.count(buffer->data.get()) || invalid_.count(buffer->data.get())) return;
+    if (root_ == nullptr) {
+      invalid_.insert(buffer->data.get());
+      return;
+    }
+    Array<Var> loop_vars;
+    std::vector<int64_t> extents;
+    int64_t num_points = 1;
+    for (const ForNode* loop = root_; loop != nullptr; loop = loop->body.as<ForNode>()) {
+      auto extent = as_const_int(loop->extent);
+      if (loop->kind != ForKind::kParallel || !extent || !is_zero(loop->min)) break;
+      loop_vars.push_back(loop->loop_var);
+      extents.push_back(*extent);
+      num_points *= *extent;
+    }
+    Fragment loop_layout = for_map_[GetRef<For>(root_)];
+    if (loop_vars.size() != loop_layout->InputDim() || num_points > kMaxLoopPoints) {
+      invalid_.insert(buffer->data.get());
+      return;
+    }
+
+    SharedAccess access;
+    access.vector_size = GetVectorizeSize(GetRef<For>(root_));
+    PrimExpr local_index = loop_layout->GetFlattenedIndice();
+    ConstIntEvaluator evaluator;
+    evaluator.Bind(loop_layout->thread_replicate_->var, 0);
+    std::vector<int64_t> point(extents.size(), 0);
+    for (int64_t n = 0; n < num_points; n++) {
+      for (int64_t i = extents.size() - 1, rest = n; i >= 0; i--) {
+        point[i] = rest % extents[i];
+        rest /= extents[i];
+        evaluator.Bind(loop_vars[i], point[i]);
+        evaluator.Bind(loop_layout->forward_var_[i]->var, point[i]);
+      }
+      int64_t thread = evaluator(loop_layout->forward_thread_);
+      if (thread >= 32) continue;
+      int64_t local = evaluator(local_index);
+      if (local % access.vector_size != 0) continue;
+      access.records.push_back({local / access.vector_size, thread, evaluator(indices[0]),
+                                evaluator(indices[1])});
+    }
+    if (evaluator.failed()) {
+      invalid_.insert(buffer->data.get());
+      return;
+    }
+    accesses_[buffer.get()].push_back(std::move(access));
+  }
+
+  const Map<For, Fragment>& for_map_;
+  const Map<Buffer, Layout>& layout_map_;
+  std::unordered_set<const VarNode*> tracked_;
+  const ForNode* root_ = nullptr;
+};
+
+// The number of shared memory wavefronts to serve the accesses with the layout. A warp is served
+// in phases when each thread accesses more than one bank (e.g. 8 threads per phase for 128-bit
+// accesses), the conflicts of a phase are the most distinct words accessed in a single bank.
+int64_t CountWavefronts(const std::vector<SharedAccess>& accesses, const Layout& layout,
+                        int bits) {
+  PrimExpr offset = layout->GetFlattenedIndice();
+  ConstIntEvaluator evaluator;
+  int64_t wavefronts = 0;
+  for (const auto& access : accesses) {
+    int words_per_thread = std::max<int>(1, access.vector_size * bits / 32);
+    int threads_per_phase = std::max(1, 32 / words_per_thread);
+    std::map<std::pair<int64_t, int64_t>, std::map<int64_t, std::set<int64_t>>> phases;
+    for (const auto& record : access.records) {
+      evaluator.Bind(layout->forward_var_[0]->var, record.row);
+      evaluator.Bind(layout->forward_var_[1]->var, record.col);
+      int64_t word = evaluator(offset) * bits / 32;
+      auto& banks = phases[{record.step, record.thread / threads_per_phase}];
+      for (int w = 0; w < words_per_thread; w++) banks[(word + w) % 32].insert(word + w);
+    }
+    for (const auto& [_, banks] : phases) {
+      size_t ways = 1;
+      for (const auto& [bank, words] : banks) ways = std::max(ways, words.size());
+      wavefronts += ways;
+    }
+  }
+  if (evaluator.failed()) return -1;
+  return wavefronts;
+}
+
+Map<Buffer, Layout> PlanSharedMemoryLayout(const Stmt& body, const Map<For, Fragment>& for_map,
+                                           const Map<Buffer, Layout>& layout_map, bool verbose) {
+  SharedAccessCollector collector(for_map, layout_map);
+  collector(body);
+
+  Map<Buffer, Layout> results;
+  for (const auto& buffer : collector.buffers_) {
+    if (collector.invalid_.count(buffer->data.get())) continue;
+    auto it = collector.accesses_.find(buffer.get());
+    if (it == collector.accesses_.end()) continue;
+    const auto& accesses = it->second;
+
+    int rows = *as_const_int(buffer->shape[0]);
+    int cols = *as_const_int(buffer->shape[1]);
+    int bits = buffer->dtype.bits() * buffer->dtype.lanes();
+    int max_vector_bits = 0;
+    for (const auto& access : accesses) {
+      max_vector_bits = std::max(max_vector_bits, access.vector_size * bits);
+    }
+
+    // the candidates are ordered by preference, the row-major layout is kept on a tie
+    std::vector<std::pair<std::string, Layout>> candidates;
+    IterVar i(Range(0, rows), Var("i"), IterVarType::kDataPar);
+    IterVar j(Range(0, cols), Var("j"), IterVarType::kDataPar);
+    candidates.emplace_back("row-major", Layout({i, j}, {i->var, j->var}));
+    int vector_size = 128 / bits;
+    if (rows % 8 == 0 && cols % (vector_size * 8) == 0) {
+      candidates.emplace_back("swizzle", makeGemmABLayoutFullBank(rows, cols, bits));
+    } else if (rows % 8 == 0 && cols % (vector_size * 4) == 0) {
+      candidates.emplace_back("swizzle", makeGemmABLayoutHalfBank(rows, cols, bits));
+    }
+    // padding a row by a single bank breaks the alignment of the vectorized accesses
+    if (cols * bits % 128 == 0) {
+      candidates.emplace_back("padding(16B)",
+                              Layout({i, j}, {i->var * (cols + vector_size) + j->var}));
+    }
+    if (max_vector_bits <= 32) {
+      candidates.emplace_back("padding(4B)",
+                              Layout({i, j}, {i->var * (cols + 32 / bits) + j->var}));
+    }
+
+    std::ostringstream os;
+    int64_t best = -1;
+    size_t best_idx = 0;
+    for (size_t k = 0; k < candidates.size(); k++) {
+      int64_t wavefronts = CountWavefronts(accesses, candidates[k].second, bits);
+      if (wavefronts < 0) continue;
+      os << " " << candidates[k].first << " " << wavefronts;
+      if (best < 0 || wavefronts < best) {
+        best = wavefronts;
+        best_idx = k;
+      }
+    }
+    if (verbose) {
+      LOG(INFO) << "Shared memory wavefronts of the first warp on " << buffer->name << ":"
+                << os.str() << ", use " << candidates[best_idx].first;
+    }
+    if (best_idx != 0) results.Set(buffer, candidates[best_idx].second);
+  }
+  return results;
+}
+
+}  // namespace tl
+}  // namespace tvm
@@ -0,0 +1,56 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file bank_conflict.h
+ * \brief Estimate the bank conflicts of shared memory accesses and plan the shared layouts
+ */
+
+#ifndef TVM_TL_BANK_CONFLICT_H_
+#define TVM_TL_BANK_CONFLICT_H_
+
+#include <tvm/tir/stmt.h>
+
+#include "layout.h"
+
+namespace tvm {
+namespace tl {
+
+using namespace tir;
+
+/*!
+ * \brief Choose the layouts of the shared buffers that are only accessed in parallel loops.
+ *
+ * The accesses of the first warp are evaluated with the inferred loop partitions, the row-major,
+ * XOR swizzled and padded layouts are compared by the number of shared memory wavefronts and the
+ * one with the least conflicts is taken. Buffers that already have a layout are left unchanged.
+ *
+ * \param body The function body before the layouts are applied.
+ * \param for_map The thread partition of each parallel loop.
+ * \param layout_map The layouts inferred from the tile ops and annotations.
+ * \param verbose Log the estimated wavefronts of each candidate layout.
+ * \return The new layouts of the shared buffers, row-major buffers are not included.
+ */
+Map<Buffer, Layout> PlanSharedMemoryLayout(const Stmt& body, const Map<For, Fragment>& for_map,
+                                           const Map<Buffer, Layout>& layout_map, bool verbose);
+
+}  // namespace tl
+}  // namespace tvm
+
+#endif  // TVM_TL_BANK_CONFLICT_H_
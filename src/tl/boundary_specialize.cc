@@ -0,0 +1,200 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file boundary_specialize.cc
+ * \brief Split a kernel into an interior path without boundary checks and a guarded tail path
+ */
+
+#include <tvm/tir/analysis.h>
+#include <tvm/tir/builtin.h>
+#include <tvm/tir/op.h>
+#include <tvm/tir/stmt_functor.h>
+#include <tvm/tir/transform.h>
+
+#include <unordered_set>
+
+#include "op.h"
+
+namespace tvm {
+namespace tl {
+
+using namespace tir;
+
+TVM_REGISTER_PASS_CONFIG_OPTION("tl.disable_boundary_specialization", Bool);
+
+static void SplitConjunction(const PrimExpr& cond, Array<PrimExpr>* atoms) {
+  if (auto op = cond.as<AndNode>()) {
+    SplitConjunction(op->a, atoms);
+    SplitConjunction(op->b, atoms);
+  } else {
+    atoms->push_back(cond);
+  }
+}
+
+static bool ContainsExpr(const Array<PrimExpr>& exprs, const PrimExpr& expr) {
+  for (const auto& e : exprs) {
+    if (StructuralEqual()(e, expr)) return true;
+  }
+  return false;
+}
+
+/*!
+ * \brief Drop the given conditions from all the if statements, they are known to hold.
+ */
+class ConditionEliminator : public StmtMutator {
+ public:
+  explicit ConditionEliminator(const Array<PrimExpr>& conds) : conds_(conds) {}
+
+ private:
+  Stmt VisitStmt_(const IfThenElseNode* op) final {
+    IfThenElse stmt = Downcast<IfThenElse>(StmtMutator::VisitStmt_(op));
+    Array<PrimExpr> atoms;
+    SplitConjunction(stmt->condition, &atoms);
+    PrimExpr cond;
+    for (const auto& atom : atoms) {
+      if (ContainsExpr(conds_, atom)) continue;
+      cond = cond.defined() ? And(cond, atom) : atom;
+    }
+    if (!cond.defined()) return stmt->then_case;
+    if (cond.same_as(stmt->condition)) return stmt;
+    return IfThenElse(cond, stmt->then_case, stmt->else_case);
+  }
+
+  const Array<PrimExpr>& conds_;
+};
+
+/*!
+ * \brief Specialize the kernels for the tiles inside the buffers.
+ *
+ * The boundary checks of the copies (see CopyArgs::MakeTilePredicate) and other if statements
+ * that only depend on the block indices and the shapes are uniform within a block. The kernel body
+ * is duplicated under their conjunction: the interior tiles run a copy with these checks removed,
+ * and the tail tiles run the original body.
+ */
+class BoundarySpecializer : public StmtExprMutator {
+ public:
+  static PrimFunc Substitute(PrimFunc f) {
+    BoundarySpecializer specializer;
+    PrimFuncNode* fptr = f.CopyOnWrite();
+    fptr->body = specializer(std::move(fptr->body));
+    return f;
+  }
+
+ private:
+  BoundarySpecializer() = default;
+
+  Stmt VisitStmt_(const AttrStmtNode* op) final {
+    if (op->attr_key == attr::kKernelSchedule) {
+      // stream-K requires the reduction loop at the top level of the kernel
+      if (Downcast<StringImm>(op->value)->value == "stream_k") return GetRef<Stmt>(op);
+      return StmtExprMutator::VisitStmt_(op);
+    }
+    if (op->attr_key != tir::attr::thread_extent) return StmtExprMutator::VisitStmt_(op);
+    IterVar iv = Downcast<IterVar>(op->node);
+    if (std::string(iv->thread_tag).rfind("blockIdx", 0) == 0)
+      return StmtExprMutator::VisitStmt_(op);
+    thread_vars_.insert(iv->var.get());
+    auto realize = op->body.as<BlockRealizeNode>();
+    if (!realize) return StmtExprMutator::VisitStmt_(op);
+    // the body of T.Kernel
+    Block block = realize->block;
+    Stmt body = block->body;
+    if (auto swizzle = body.as<AttrStmtNode>()) {
+      if (swizzle->attr_key == "threadblock_swizzle_pattern") {
+        body = AttrStmt(swizzle->node, swizzle->attr_key, swizzle->value,
+                        Specialize(swizzle->body));
+      }
+    }
+    if (body.same_as(block->body)) body = Specialize(body);
+    if (body.same_as(block->body)) return GetRef<Stmt>(op);
+    block.CopyOnWrite()->body = body;
+    BlockRealize new_realize = GetRef<BlockRealize>(realize);
+    new_realize.CopyOnWrite()->block = block;
+    return AttrStmt(op->node, op->attr_key, op->value, new_realize);
+  }
+
+  Stmt Specialize(const Stmt& body) {
+    std::unordered_set<const VarNode*> defined;
+    Array<PrimExpr> conds;
+    bool has_tile_copy = false;
+    PostOrderVisit(body, [&](const ObjectRef& node) {
+      if (auto op = node.as<ForNode>()) {
+        defined.insert(op->loop_var.get());
+      } else if (auto op = node.as<LetStmtNode>()) {
+        defined.insert(op->var.get());
+      } else if (auto op = node.as<LetNode>()) {
+        defined.insert(op->var.get());
+      } else if (auto op = node.as<BlockNode>()) {
+        for (const auto& iv : op->iter_vars) defined.insert(iv->var.get());
+      } else if (auto op = node.as<AttrStmtNode>()) {
+        if (auto iv = op->node.as<IterVarNode>()) defined.insert(iv->var.get());
+      } else if (auto op = node.as<IfThenElseNode>()) {
+        SplitConjunction(op->condition, &conds);
+      } else if (auto op = node.as<CallNode>()) {
+        // the bulk copies (TMA) are bound checked by the hardware, keep these kernels as is
+        if (op->op.same_as(tl::copy())) has_tile_copy = true;
+      }
+    });
+    if (has_tile_copy) return body;
+
+    Array<PrimExpr> uniform_conds;
+    for (const auto& cond : conds) {
+      // only the range checks, e.g. by * 128 + 128 <= m
+      if (!cond->IsInstance<LTNode>() && !cond->IsInstance<LENode>() &&
+          !cond->IsInstance<GTNode>() && !cond->IsInstance<GENode>())
+        continue;
+      if (SideEffect(cond) > CallEffectKind::kPure) continue;
+      bool uniform = true;
+      PostOrderVisit(cond, [&](const ObjectRef& node) {
+        if (auto var = node.as<VarNode>()) {
+          if (defined.count(var) || thread_vars_.count(var)) uniform = false;
+        }
+      });
+      if (uniform && !ContainsExpr(uniform_conds, cond)) uniform_conds.push_back(cond);
+    }
+    if (uniform_conds.empty()) return body;
+
+    PrimExpr interior = uniform_conds[0];
+    for (size_t i = 1; i < uniform_conds.size(); i++) interior = And(interior, uniform_conds[i]);
+    Stmt fast_path = ConditionEliminator(uniform_conds)(body);
+    return IfThenElse(interior, fast_path, body);
+  }
+
+  std::unordered_set<const VarNode*> thread_vars_;
+};
+
+using namespace tir::transform;
+
+tvm::transform::Pass BoundarySpecialize() {
+  auto pass_func = [=](PrimFunc f, IRModule m, PassContext ctx) {
+    if (ctx->GetConfig<Bool>("tl.disable_boundary_specialization", Bool(false)).value())
+      return f;
+    return BoundarySpecializer::Substitute(std::move(f));
+  };
+  // the two paths share the definitions of the loop variables and buffers
+  return tvm::transform::Sequential(
+      {CreatePrimFuncPass(pass_func, 0, "tl.BoundarySpecialize", {}), ConvertSSA()},
+      "tl.BoundarySpecialize");
+}
+
+TVM_REGISTER_GLOBAL("tl.BoundarySpecialize").set_body_typed(BoundarySpecialize);
+
+}  // namespace tl
+}  // namespace tvm
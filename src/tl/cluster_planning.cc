@@ -27,20 +27,34 @@
 #include <tvm/tir/stmt_functor.h>
 #include <tvm/tir/transform.h>
 
+#include "op.h"
+#include "target_utils.h"
+
 namespace tvm {
 namespace tir {
 
+TVM_REGISTER_PASS_CONFIG_OPTION("tl.cluster_size", Integer);
+
 class ClusterPlanner {
  public:
   static PrimFunc Substitute(PrimFunc& f) {
+    auto target = f->GetAttr<Target>(tvm::attr::kTarget);
+    if (!target.defined() || !tl::TargetIsHopper(target.value().get())) return f;
+    // 1 (the default): no clusters, 0: pick the cluster size from the reuse. The clusters only
+    // pay off with the multicast copies of the warp specialized loops, and otherwise constrain
+    // the scheduling of the blocks, so they are opt-in.
+    int cluster_size = tvm::transform::PassContext::Current()
+                           ->GetConfig<Integer>("tl.cluster_size", Integer(1))
+                           .value()
+                           ->value;
+    ICHECK(cluster_size >= 0 && cluster_size <= 8 && (cluster_size & (cluster_size - 1)) == 0)
+        << "tl.cluster_size should be one of 0 (auto), 1 (none), 2, 4 and 8, got " << cluster_size;
+    if (cluster_size == 1) return f;
+
     // Step 1: Collect the read region of the function
-    Map<Var, Buffer> buffer_data_to_buffer_;
-    for (const auto& [_, buffer] : f->buffer_map) {
-      buffer_data_to_buffer_.Set(buffer->data, buffer);
-    }
-    Block block(/*iter_vars=*/{}, /*reads=*/{}, /*writes=*/{}, /*name_hint=*/"", /*body*/ f->body);
-    Array<Array<BufferRegion>> access = GetBlockReadWriteRegion(block, buffer_data_to_buffer_);
-    auto reads = access[0];
+    ReadRegionCollector collector;
+    collector(f->body);
+    auto reads = collector.reads_;
 
     BlockIdxVisitor blockIdx_visitor;
     blockIdx_visitor(f->body);
@@ -49,6 +63,7 @@ class ClusterPlanner {
     // Step 2: Collect mem resue count for clustering on each dimention.
     std::unordered_map<const IterVarNode*, size_t> mem_reuse_count;
     for (auto iv : dom_map) mem_reuse_count[iv] = 0;
+    size_t mem_total = 0;
 
     for (const auto& buffer_region : reads) {
       PrimExpr size = buffer_region->buffer->dtype.bits();
@@ -59,30 +74,48 @@ class ClusterPlanner {
       }
       size = arith::Analyzer().Simplify(size);
       if (auto imm = size.as<IntImmNode>()) {
+        mem_total += imm->value;
         for (auto iv : dom_map) {
           if (visitor.seen_.count(iv->var.get()) == 0) mem_reuse_count[iv] += imm->value;
         }
       }
     }
 
-    // Step 3: Pick the cluster dimension with the largest mem_reuse.
+    // Step 3: Pick the cluster size and dimension with the largest mem_reuse. The blocks of a
+    // cluster share the reused data, doubling the cluster size to c cuts mem_reuse / c more
+    // loads, the cluster grows while this is at least a quarter of the total loads.
+    auto pick_size = [&](size_t mem_reuse, int64_t extent) {
+      if (cluster_size != 0) return extent % cluster_size == 0 ? cluster_size : 1;
+      int best = 1;
+      for (int c = 2; c <= 8; c *= 2) {
+        if (extent % c != 0 || 4 * mem_reuse < c * mem_total) break;
+        best = c;
+      }
+      return best;
+    };
     size_t mem_reuse_max = 0;
-    String cluster_tag;
+    const IterVarNode* cluster_iv = nullptr;
+    int cluster_iv_size = 1;
     for (auto iv : dom_map) {
       if (auto extent = iv->dom->extent.as<IntImmNode>()) {
-        if (extent->value % cluster_size_ == 0 && mem_reuse_count[iv] > mem_reuse_max) {
-          cluster_tag = iv->thread_tag;
+        int size = pick_size(mem_reuse_count[iv], extent->value);
+        if (size > 1 && mem_reuse_count[iv] > mem_reuse_max) {
+          cluster_iv = iv;
+          cluster_iv_size = size;
           mem_reuse_max = mem_reuse_count[iv];
         }
       }
     }
 
-    if (mem_reuse_max > 0) {
-      cluster_tag = "clusterIdx" + String(cluster_tag.c_str() + strlen("blockIdx"));
-      return WithAttr(f, cluster_tag, Integer(cluster_size_));
-    } else {
-      return f;
+    if (cluster_iv != nullptr) {
+      String cluster_tag =
+          "clusterIdx" + String(cluster_iv->thread_tag.c_str() + strlen("blockIdx"));
+      f = WithAttr(f, cluster_tag, Integer(cluster_iv_size));
+      // the attribute in the kernel body is kept by the host device split for the codegen
+      ClusterAnnotator annotator(cluster_iv, cluster_iv_size);
+      f.CopyOnWrite()->body = annotator(f->body);
     }
+    return f;
   }
 
  private:
@@ -95,6 +128,36 @@ class ClusterPlanner {
     std::unordered_set<const VarNode*> seen_;
   };
 
+  // Collect the regions read from the global buffers, including the ones of the tile ops.
+  class ReadRegionCollector : public StmtExprVisitor {
+   public:
+    ReadRegionCollector(){};
+    void VisitExpr_(const CallNode* op) final {
+      if (op->op.same_as(tl::region())) {
+        auto load = op->args[0].as<BufferLoadNode>();
+        ICHECK(load);
+        int access_mask = Downcast<IntImm>(op->args[1])->value;
+        if ((access_mask & 1) && load->buffer.scope() == "global") {
+          Region region;
+          for (size_t i = 0; i < load->indices.size(); i++) {
+            region.push_back(Range::FromMinExtent(load->indices[i], op->args[2 + i]));
+          }
+          reads_.push_back(BufferRegion(load->buffer, region));
+        }
+        for (const auto& index : load->indices) VisitExpr(index);
+        return;
+      }
+      StmtExprVisitor::VisitExpr_(op);
+    }
+    void VisitExpr_(const BufferLoadNode* op) final {
+      if (op->buffer.scope() == "global") {
+        reads_.push_back(BufferRegion::FromPoint(op->buffer, op->indices));
+      }
+      StmtExprVisitor::VisitExpr_(op);
+    }
+    Array<BufferRegion> reads_;
+  };
+
   class BlockIdxVisitor : public StmtVisitor {
    public:
     BlockIdxVisitor(){};
@@ -111,8 +174,25 @@ class ClusterPlanner {
     std::unordered_set<const IterVarNode*> dom_map_;
   };
 
-  /*! \brief Currently set the plossible cluster size as 2 */
-  const static int cluster_size_ = 2;
+  class ClusterAnnotator : public StmtMutator {
+   public:
+    ClusterAnnotator(const IterVarNode* iv, int cluster_size)
+        : iv_(iv), cluster_size_(cluster_size) {}
+    Stmt VisitStmt_(const AttrStmtNode* attr) final {
+      Stmt stmt = StmtMutator::VisitStmt_(attr);
+      if (attr->attr_key == attr::thread_extent && attr->node.get() == iv_) {
+        auto node = stmt.as<AttrStmtNode>();
+        Stmt body =
+            AttrStmt(attr->node, tl::attr::kClusterSize, Integer(cluster_size_), node->body);
+        return AttrStmt(node->node, node->attr_key, node->value, body);
+      }
+      return stmt;
+    }
+
+   private:
+    const IterVarNode* iv_;
+    int cluster_size_;
+  };
 };
 
 PrimFunc ClusterPlanning(PrimFunc f) { return ClusterPlanner::Substitute(f); }
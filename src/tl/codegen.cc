@@ -24,19 +24,23 @@
 #include "codegen.h"
 
 #include <tvm/arith/analyzer.h>
+#include <tvm/ir/transform.h>
 #include <tvm/runtime/registry.h>
+#include <tvm/tir/stmt_functor.h>
 
+#include <cctype>
 #include <cmath>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include "../target/source/ptx.h"
 #include "op.h"
 
 namespace tvm {
 namespace codegen {
 
-CodeGenTL::CodeGenTL() { restrict_keyword_ = "__restrict__"; }
+CodeGenTL::CodeGenTL(bool hip) : hip_(hip) { restrict_keyword_ = "__restrict__"; }
 
 void CodeGenTL::PrintFuncPrefix(std::ostream& os) { os << "extern \"C\" __global__ "; }
 
@@ -53,10 +57,26 @@ class LaunchConfigExtractor : public tir::StmtVisitor {
         threadIdx_z_ext = op->value;
       }
     }
+    if (op->attr_key == tl::attr::kMinBlocksPerSM) {
+      min_blocks_per_sm = Downcast<Integer>(op->value)->value;
+    }
+    if (op->attr_key == tl::attr::kClusterSize) {
+      IterVar iv = Downcast<IterVar>(op->node);
+      int64_t size = Downcast<Integer>(op->value)->value;
+      if (iv->thread_tag == "blockIdx.x") {
+        cluster_dims[0] = size;
+      } else if (iv->thread_tag == "blockIdx.y") {
+        cluster_dims[1] = size;
+      } else if (iv->thread_tag == "blockIdx.z") {
+        cluster_dims[2] = size;
+      }
+    }
     StmtVisitor::VisitStmt_(op);
   }
 
  public:
+  int64_t cluster_dims[3] = {1, 1, 1};
+  int64_t min_blocks_per_sm = 0;
   PrimExpr threadIdx_x_ext = Integer(1);
   PrimExpr threadIdx_y_ext = Integer(1);
   PrimExpr threadIdx_z_ext = Integer(1);
@@ -65,6 +85,10 @@ class LaunchConfigExtractor : public tir::StmtVisitor {
 void CodeGenTL::PrintExtraAttrs(const PrimFunc& f) {
   LaunchConfigExtractor extractor;
   extractor(f->body);
+  if (extractor.cluster_dims[0] * extractor.cluster_dims[1] * extractor.cluster_dims[2] > 1) {
+    stream << " __cluster_dims__(" << extractor.cluster_dims[0] << ", " << extractor.cluster_dims[1]
+           << ", " << extractor.cluster_dims[2] << ")";
+  }
   arith::Analyzer analyzer;
   PrimExpr threadIdx_ext = analyzer.Simplify(extractor.threadIdx_x_ext * extractor.threadIdx_y_ext *
                                              extractor.threadIdx_z_ext);
@@ -73,15 +97,228 @@ void CodeGenTL::PrintExtraAttrs(const PrimFunc& f) {
       // unable to extract the number of threads per block, hence directly return
       return;
     }
-    stream << " __launch_bounds__(" << threadIdx_ext_int->value << ")";
+    stream << " __launch_bounds__(" << threadIdx_ext_int->value;
+    // the second argument of HIP is the min waves per EU, not the min blocks per CU
+    if (extractor.min_blocks_per_sm > 0 && !hip_) stream << ", " << extractor.min_blocks_per_sm;
+    stream << ")";
   }
 }
 
+std::unordered_set<const VarNode*> CollectTensorMapParams(const PrimFunc& f) {
+  std::unordered_set<const VarNode*> tensor_maps;
+  tir::PostOrderVisit(f->body, [&](const ObjectRef& node) {
+    if (auto call = node.as<CallNode>()) {
+      if (call->op.same_as(tl::tma_load()) || call->op.same_as(tl::tma_load_multicast())) {
+        if (auto var = call->args[0].as<VarNode>()) tensor_maps.insert(var);
+      }
+    }
+  });
+  return tensor_maps;
+}
+
+// read by the codegen, loads the read-only params through the L1 and texture path (tl::ldg)
+TVM_REGISTER_PASS_CONFIG_OPTION("tl.disable_ldg", Bool);
+
+/*!
+ * \brief The pointer params of a kernel which it only reads: no store, no pointer to them
+ * passed to a call which may write (an access_ptr without the write mask, the source of a
+ * cp.async), and no other use of the pointer (e.g. a let binding or an extern call taking it).
+ * The params of the kernels waiting for the signals of the peers are written during the kernel.
+ */
+class ReadOnlyParamCollector : public tir::StmtExprVisitor {
+ public:
+  static std::unordered_set<const VarNode*> Collect(const PrimFunc& f) {
+    ReadOnlyParamCollector collector;
+    collector(f->body);
+    std::unordered_set<const VarNode*> read_only;
+    if (collector.waits_signal_) return read_only;
+    auto tensor_maps = CollectTensorMapParams(f);
+    for (const auto& param : f->params) {
+      if (param.dtype().is_handle() && !tensor_maps.count(param.get()) &&
+          !collector.written_.count(param.get())) {
+        read_only.insert(param.get());
+      }
+    }
+    return read_only;
+  }
+
+ private:
+  void VisitStmt_(const BufferStoreNode* op) final {
+    written_.insert(op->buffer->data.get());
+    StmtExprVisitor::VisitStmt_(op);
+  }
+
+  void VisitExpr_(const VarNode* op) final { written_.insert(op); }
+
+  void VisitExpr_(const CallNode* op) final {
+    if (op->op.same_as(builtin::tvm_access_ptr())) {
+      auto rw_mask = op->args[4].as<IntImmNode>();
+      if (auto var = op->args[1].as<VarNode>()) {
+        if (rw_mask == nullptr || (rw_mask->value & 2)) written_.insert(var);
+      }
+      for (size_t i = 2; i < op->args.size(); i++) VisitExpr(op->args[i]);
+      return;
+    }
+    if (op->op.same_as(builtin::ptx_cp_async())) {
+      for (size_t i = 0; i < op->args.size(); i++) {
+        if (i != 2 || !op->args[i]->IsInstance<VarNode>()) VisitExpr(op->args[i]);
+      }
+      return;
+    }
+    if (op->op.same_as(builtin::address_of())) {
+      if (auto load = op->args[0].as<BufferLoadNode>()) {
+        written_.insert(load->buffer->data.get());
+      }
+    } else if (op->op.same_as(builtin::call_extern())) {
+      auto name = op->args[0].as<StringImmNode>();
+      if (name != nullptr && name->value == "tl::signal_wait") waits_signal_ = true;
+    }
+    StmtExprVisitor::VisitExpr_(op);
+  }
+
+  std::unordered_set<const VarNode*> written_;
+  bool waits_signal_ = false;
+};
+
+void CodeGenTL::AddFunction(const PrimFunc& f) {
+  // Same as CodeGenC::AddFunction, except that the tensor maps are passed by value
+  this->InitFuncState(f);
+  ReserveKeywordsAsUnique();
+
+  auto global_symbol = f->GetAttr<String>(tvm::attr::kGlobalSymbol);
+  ICHECK(global_symbol.defined())
+      << "CodeGenC: Expect PrimFunc to have the global_symbol attribute";
+  bool no_alias = f->HasNonzeroAttr(tir::attr::kNoAlias);
+  auto tensor_maps = CollectTensorMapParams(f);
+  // the loads through the non-coherent cache need the params not to alias the written ones, which
+  // is the contract of the restrict params
+  read_only_params_.clear();
+  auto ctxt = transform::PassContext::Current();
+  if (no_alias && !hip_ && !ctxt->GetConfig<Bool>("tl.disable_ldg", Bool(false)).value()) {
+    read_only_params_ = ReadOnlyParamCollector::Collect(f);
+  }
+
+  this->PrintFuncPrefix(stream);
+  PrintType(f->ret_type, stream);
+  this->PrintExtraAttrs(f);
+  this->stream << " " << static_cast<std::string>(global_symbol.value()) << "(";
+
+  for (size_t i = 0; i < f->params.size(); ++i) {
+    tir::Var v = f->params[i];
+    std::string vid = AllocVarID(v.get());
+    if (i != 0) stream << ", ";
+    if (tensor_maps.count(v.get())) {
+      stream << "__grid_constant__ const CUtensorMap";
+    } else if (v.dtype().is_handle()) {
+      auto it = alloc_storage_scope_.find(v.get());
+      if (it != alloc_storage_scope_.end()) {
+        PrintStorageScope(it->second, stream);
+      }
+
+      PrintType(GetType(v), stream);
+      if (auto* ptr = v->type_annotation.as<PointerTypeNode>()) {
+        if (auto* prim = ptr->element_type.as<PrimTypeNode>()) {
+          RegisterHandleType(v.get(), prim->dtype);
+        }
+      }
+
+      if (no_alias) {
+        PrintRestrict(v, stream);
+      }
+    } else {
+      PrintType(GetType(v), stream);
+    }
+    stream << ' ' << vid;
+  }
+  stream << ") {\n";
+  this->PreFunctionBody(f);
+  int func_scope = this->BeginScope();
+  this->PrintStmt(f->body);
+  this->EndScope(func_scope);
+  this->PrintIndent();
+  this->stream << "}\n\n";
+}
+
+namespace {
+// The headers of tl_templates besides copy.h (and common.h), included by the kernels using them
+enum TemplateHeader : int {
+  kGemmHeader = 1,
+  kReduceHeader = 2,
+  kScanHeader = 4,
+  kTopKHeader = 8,
+  kSwizzleHeader = 16,
+  kRandomHeader = 32,
+  kGridSyncHeader = 64,
+  kAllHeaders = 127,
+};
+
+// The headers of the tl:: names printed by the codegen and the frontend, by the prefix of the
+// names, the first match wins. The names of common.h and copy.h need no header.
+const std::vector<std::pair<std::string, int>>& TemplateHeaderOfNames() {
+  static const std::vector<std::pair<std::string, int>> names = {
+      {"AtomicAdd", 0}, {"exp2_approx", 0}, {"is_aligned", 0}, {"ldg", 0},
+      {"named_barrier_sync", 0},
+      {"pdl_", 0}, {"peer_ptr", 0}, {"shfl_sync", 0}, {"signal_", 0}, {"timer_", 0},
+      {"half_t", 0}, {"bfloat16_t", 0}, {"float_e4m3_t", 0}, {"float_e5m2_t", 0},
+      {"cp_async", 0}, {"cast_smem_ptr_to_int", 0}, {"CacheHint", 0}, {"make_l2_policy", 0},
+      {"ptx_ldmatrix", 0}, {"cluster_sync", 0}, {"fence_barrier_init", 0}, {"mbarrier_", 0},
+      {"tma_load", 0}, {"warpgroup_reg_", 0},
+      {"gemm", kGemmHeader}, {"wgmma", kGemmHeader}, {"Dequant", kGemmHeader},
+      {"PrologueOp", kGemmHeader}, {"NoPrologue", kGemmHeader},
+      {"AllReduce", kReduceHeader}, {"AbsMaxOp", kReduceHeader}, {"MaxOp", kReduceHeader},
+      {"MinOp", kReduceHeader}, {"ProdOp", kReduceHeader}, {"SumOp", kReduceHeader},
+      {"ArgMax", kReduceHeader}, {"Welford", kReduceHeader}, {"shfl_xor", kReduceHeader},
+      {"WarpScan", kScanHeader}, {"TopK", kTopKHeader}, {"topk_", kTopKHeader},
+      {"rasterization2D", kSwizzleHeader},
+      {"group_search", kSwizzleHeader}, {"ragged_tile_search", kSwizzleHeader},
+      {"semaphore_", kSwizzleHeader}, {"stream_k_", kSwizzleHeader},
+      {"hilbert_point", kSwizzleHeader}, {"morton_point", kSwizzleHeader},
+      {"slice_block_index", kSwizzleHeader}, {"rand_", kRandomHeader},
+      {"philox", kRandomHeader}, {"stochastic_round", kRandomHeader},
+      {"grid_sync", kGridSyncHeader},
+  };
+  return names;
+}
+
+// The headers of the tl:: names of the code, all of them for a name of no known header (e.g. an
+// extern call of a new template) so that the kernel still compiles.
+int UsedTemplateHeaders(const std::string& code) {
+  auto is_ident = [](char c) { return std::isalnum(static_cast<unsigned char>(c)) || c == '_'; };
+  int headers = 0;
+  for (size_t pos = code.find("tl::"); pos != std::string::npos; pos = code.find("tl::", pos)) {
+    bool qualified = pos == 0 || !is_ident(code[pos - 1]);
+    pos += 4;
+    if (!qualified) continue;
+    size_t end = pos;
+    while (end < code.size() && is_ident(code[end])) ++end;
+    std::string name = code.substr(pos, end - pos);
+    int header = kAllHeaders;
+    for (const auto& kv : TemplateHeaderOfNames()) {
+      if (name.rfind(kv.first, 0) == 0) {
+        header = kv.second;
+        break;
+      }
+    }
+    headers |= header;
+    if (headers == kAllHeaders) break;
+  }
+  return headers;
+}
+}  // namespace
+
 std::string CodeGenTL::Finish() {
-  decl_stream << "#include <tl_templates/gemm.h>\n";
-  decl_stream << "#include <tl_templates/copy.h>\n";
-  decl_stream << "#include <tl_templates/reduce.h>\n";
-  decl_stream << "#include <tl_templates/threadblock_swizzle.h>\n";
+  std::string dir = hip_ ? "tl_templates/hip/" : "tl_templates/";
+  // only the headers used by the kernels are included, the kernels are compiled one by one when
+  // autotuning and parsing the CUTLASS and CuTe templates of gemm.h takes most of their time
+  int headers = UsedTemplateHeaders(decl_stream.str()) | UsedTemplateHeaders(stream.str());
+  if (headers & kGemmHeader) decl_stream << "#include <" << dir << "gemm.h>\n";
+  decl_stream << "#include <" << dir << "copy.h>\n";
+  if (headers & kReduceHeader) decl_stream << "#include <" << dir << "reduce.h>\n";
+  if (headers & kScanHeader) decl_stream << "#include <" << dir << "scan.h>\n";
+  if (headers & kTopKHeader) decl_stream << "#include <" << dir << "topk.h>\n";
+  if (headers & kSwizzleHeader) decl_stream << "#include <tl_templates/threadblock_swizzle.h>\n";
+  if ((headers & kRandomHeader) && !hip_) decl_stream << "#include <tl_templates/random.h>\n";
+  if (headers & kGridSyncHeader) decl_stream << "#include <tl_templates/grid_sync.h>\n";
   decl_stream << "\n";
   return CodeGenC::Finish();
 }
@@ -91,7 +328,8 @@ void CodeGenTL::VisitStmt_(const tir::ForNode* op) {
     PrintIndent();
     stream << "#pragma unroll\n";
   }
-  std::string extent = PrintExpr(arith::Analyzer().Simplify(op->extent + op->min));
+  std::string extent =
+      PrintExpr(is_zero(op->min) ? op->extent : arith::Analyzer().Simplify(op->extent + op->min));
   PrintIndent();
   std::string vid = AllocVarID(op->loop_var.get());
   std::string start = PrintExpr(op->min);
@@ -188,11 +426,21 @@ void CodeGenTL::PrintType(DataType t, std::ostream& os) {  // NOLINT(*)
     if (!fail) return;
   } else if (t.is_float8()) {
     if (t.is_scalar()) {
-      os << "unsigned char";  // __nv_fp8_storage_t is an alias of unsigned char
+      // the cutlass types, which select the fp8 mma of tl::gemm
+      if (t.code() == DataType::kE4M3Float) {
+        os << "float_e4m3_t";
+      } else if (t.code() == DataType::kE5M2Float) {
+        os << "float_e5m2_t";
+      } else {
+        os << "unsigned char";  // __nv_fp8_storage_t is an alias of unsigned char
+      }
     } else if (lanes == 2) {
       os << "unsigned short int";  // __nv_fp8x2_storage_t is an alias of unsigned short
     } else if (lanes == 4) {
       os << "unsigned int";  // __nv_fp8x4_storage_t is an alias of unsigned int
+    } else if (lanes == 8 || lanes == 16) {
+      // the 64 and 128 bit accesses of the vectorized copies
+      os << "uint" << lanes / 4;
     } else {
       fail = true;
     }
@@ -487,7 +735,14 @@ void CodeGenTL::PrintStorageSync(const CallNode* op) {
     // DO nothing.
   } else if (sync == "shared" || sync == "shared.dyn") {
     this->PrintIndent();
-    this->stream << "__syncthreads();\n";
+    if (op->args.size() == 3) {
+      // the threads of a thread_partial_scope
+      std::string barrier_id = this->PrintExpr(op->args[1]);
+      std::string num_threads = this->PrintExpr(op->args[2]);
+      this->stream << "tl::named_barrier_sync(" << barrier_id << ", " << num_threads << ");\n";
+    } else {
+      this->stream << "__syncthreads();\n";
+    }
   }
 }
 
@@ -497,7 +752,8 @@ void CodeGenTL::PrintStorageScope(const std::string& scope, std::ostream& os) {
   if (scope == "shared") {
     os << "__shared__ ";
   } else if (scope == "shared.dyn") {
-    os << "extern __shared__ ";
+    // the swizzled tma and wgmma operands require 1024 bytes alignment
+    os << "extern __shared__ __align__(1024) ";
   }
 }
 
@@ -608,6 +864,8 @@ void CodeGenTL::VisitExpr_(const CallNode* op, std::ostream& os) {
     std::string src = this->PrintExpr(op->args[2]);
     std::string src_offset = this->PrintExpr(op->args[3]);
     std::string size = this->PrintExpr(op->args[4]);
+    if (cache_hint_ != 0 || l2_prefetch_ != -1)
+      size += ", " + std::to_string(l2_prefetch_) + ", " + std::to_string(cache_hint_);
     // use size of argument list to indicate whether or not to use predicated cp.async
     if (op->args.size() == 5) {
       this->PrintIndent();
@@ -626,6 +884,64 @@ void CodeGenTL::VisitExpr_(const CallNode* op, std::ostream& os) {
     this->PrintIndent();
     int n = Downcast<IntImm>(op->args[0])->value;
     this->stream << "tl::cp_async_wait<" << n << ">();\n";
+  } else if (op->op.same_as(tl::tma_load()) || op->op.same_as(tl::tma_load_multicast())) {
+    this->PrintIndent();
+    // the multicast copies are issued without the cache hint
+    if (op->op.same_as(tl::tma_load_multicast())) {
+      this->stream << "tl::tma_load_multicast(";
+    } else if (cache_hint_ != 0) {
+      this->stream << "tl::tma_load<" << cache_hint_ << ">(";
+    } else {
+      this->stream << "tl::tma_load(";
+    }
+    for (size_t i = 0; i < op->args.size(); i++) {
+      if (i > 0) this->stream << ", ";
+      this->stream << this->PrintExpr(op->args[i]);
+    }
+    this->stream << ");\n";
+  } else if (op->op.same_as(tl::mbarrier_wait())) {
+    std::string barrier = this->PrintExpr(op->args[0]);
+    std::string phase = this->PrintExpr(op->args[1]);
+    this->PrintIndent();
+    this->stream << "tl::mbarrier_wait(" << barrier << ", " << phase << ");\n";
+  } else if (op->op.same_as(tl::pdl_trigger()) || op->op.same_as(tl::pdl_wait())) {
+    // the HIP kernels are launched in the stream order, the previous kernel completed already
+    if (hip_) return;
+    this->PrintIndent();
+    bool trigger = op->op.same_as(tl::pdl_trigger());
+    this->stream << (trigger ? "tl::pdl_trigger();\n" : "tl::pdl_wait();\n");
+  } else if (op->op.same_as(tl::grid_sync())) {
+    ICHECK(!hip_) << "T.grid_sync is not supported on ROCm";
+    this->PrintIndent();
+    this->stream << "tl::grid_sync();\n";
+  } else if (op->op.same_as(builtin::ptx_ldmatrix())) {
+    // args: trans, the number of matrices, ".b16", the registers and their offset, the shared
+    // memory and its offset
+    ICHECK(!hip_) << "ldmatrix is not supported on ROCm";
+    bool trans = Downcast<Bool>(op->args[0])->value;
+    int num = Downcast<Integer>(op->args[1])->value;
+    ICHECK_EQ(Downcast<StringImm>(op->args[2])->value, ".b16")
+        << "ldmatrix loads 16-bit elements, got " << op->args[2];
+    std::string local = this->PrintExpr(op->args[3]);
+    std::string local_offset = this->PrintExpr(op->args[4]);
+    std::string smem = this->PrintExpr(op->args[5]);
+    std::string smem_offset = this->PrintExpr(op->args[6]);
+    this->PrintIndent();
+    this->stream << "tl::ptx_ldmatrix<" << num << ", " << (trans ? "true" : "false") << ">("
+                 << smem << " + " << smem_offset << ", " << local << " + " << local_offset
+                 << ");\n";
+  } else if (op->op.same_as(builtin::ptx_mma())) {
+    // args: the shape, the layouts and the dtypes of A and B, the dtype of C, A, B and C with
+    // their offsets in elements, saturate, as in CodeGenCUDA
+    ICHECK(!hip_) << "mma.sync is not supported on ROCm";
+    ICHECK_EQ(op->args.size(), 13U);
+    auto str = [&](int i) { return std::string(Downcast<StringImm>(op->args[i])->value); };
+    std::string asm_code = PrintMMAAssembly(
+        str(0), str(1), str(2), str(3), str(4), str(5), this->PrintExpr(op->args[6]),
+        this->PrintExpr(op->args[7]), this->PrintExpr(op->args[8]), this->PrintExpr(op->args[9]),
+        this->PrintExpr(op->args[10]), this->PrintExpr(op->args[11]), "", "", "", "", false,
+        Downcast<Bool>(op->args[12])->value);
+    this->stream << asm_code;
   } else {
     CodeGenC::VisitExpr_(op, os);
   }
@@ -650,6 +966,14 @@ void CodeGenTL::VisitStmt_(const AttrStmtNode* op) {
     ICHECK(inner);
     this->VisitStmt(inner->body);
     return;
+  } else if (op->attr_key == tl::attr::kCacheHint) {
+    int cache_hint = cache_hint_, l2_prefetch = l2_prefetch_;
+    cache_hint_ = Downcast<Integer>(op->node)->value;
+    l2_prefetch_ = Downcast<Integer>(op->value)->value;
+    this->VisitStmt(op->body);
+    cache_hint_ = cache_hint;
+    l2_prefetch_ = l2_prefetch;
+    return;
   } else if (op->attr_key == "threadblock_swizzle_pattern") {
     this->PrintIndent();
     const StringImmNode* pattern = op->value.as<StringImmNode>();
@@ -860,6 +1184,9 @@ void CodeGenTL::HandleVolatileLoads(const std::string& value, const BufferLoadNo
     os << "(";
     PrintType(op->dtype, os);
     os << ")(" << value << ")";
+  } else if (read_only_params_.count(op->buffer->data.get()) && op->dtype.bits() >= 8 &&
+             !op->dtype.is_bool() && op->buffer->dtype.bits() >= 8) {
+    os << "tl::ldg(&(" << value << "))";
   } else {
     os << value;
   }
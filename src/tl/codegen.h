@@ -30,15 +30,24 @@
 
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "../target/source/codegen_c.h"
 
 namespace tvm {
 namespace codegen {
 
+// The kernel params used as the tensor maps of tl::tma_load, which are passed by value
+std::unordered_set<const VarNode*> CollectTensorMapParams(const PrimFunc& f);
+
+// Compile the generated code into cubin in-process with NVRTC
+std::string TLNVRTCCompile(const std::string& code, Target target);
+
 class CodeGenTL final : public CodeGenC {
  public:
-  CodeGenTL();
+  // hip: generate the HIP source of the ROCm targets, which includes tl_templates/hip
+  explicit CodeGenTL(bool hip = false);
+  void AddFunction(const PrimFunc& f);
   std::string Finish();
   // override behavior
   void PrintFuncPrefix(std::ostream& os) final;
@@ -76,6 +85,13 @@ class CodeGenTL final : public CodeGenC {
   // Whether scope such as "__shared__" or "__constant__"  is part of type.
   bool IsScopePartOfType() const final { return false; }
 
+  bool hip_;
+  // The cache hint and the L2 prefetch size of the copies being printed, see attr::kCacheHint
+  int cache_hint_ = 0;
+  int l2_prefetch_ = -1;
+  // The pointer params only read by the kernel being printed, loaded with tl::ldg
+  std::unordered_set<const VarNode*> read_only_params_;
+
   friend void PrintConst(const FloatImmNode* op, std::ostream& os, CodeGenTL* p);
 };
 
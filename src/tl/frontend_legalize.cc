@@ -22,13 +22,18 @@
  * \brief Legalize the program from frontend
  */
 
+#include <tvm/tir/builtin.h>
 #include <tvm/tir/op.h>
 #include <tvm/tir/stmt_functor.h>
 #include <tvm/tir/transform.h>
 
+#include <algorithm>
+#include <unordered_set>
+
 #include "../arith/ir_mutator_with_analyzer.h"
 #include "layout.h"
 #include "op.h"
+#include "target_utils.h"
 
 namespace tvm {
 namespace tl {
@@ -42,9 +47,20 @@ class FrontendLegalizer : public arith::IRMutatorWithAnalyzer {
     FrontendLegalizer substituter(&analyzer);
     for (const auto& [_, buffer] : f->buffer_map) {
       substituter.buffer_data_to_buffer_.Set(buffer->data, buffer);
+      substituter.param_data_.insert(buffer->data.get());
+    }
+    auto target = f->GetAttr<Target>(tvm::attr::kTarget);
+    ICHECK(target.defined()) << "FrontendLegalize: Require the target attribute";
+    substituter.target_ = target.value();
+    auto ctxt = tvm::transform::PassContext::Current();
+    if (TargetHasAsyncCopy(target.value().get()) &&
+        !ctxt->GetConfig<Bool>("tl.disable_smem_staging", Bool(false)).value()) {
+      substituter.smem_headroom_ = GetSharedMemoryHeadroom(f->body, target.value().get());
     }
     PrimFuncNode* fptr = f.CopyOnWrite();
-    fptr->body = substituter.VisitStmt(f->body);
+    // moving the body out lets the mutator rewrite the uniquely owned nodes in place
+    fptr->body = substituter(std::move(fptr->body));
+    fptr->body = AllocateGlobalWorkspaces(substituter.global_workspaces_, std::move(fptr->body));
     return f;
   }
 
@@ -55,17 +71,47 @@ class FrontendLegalizer : public arith::IRMutatorWithAnalyzer {
     for (auto buffer : op->alloc_buffers) {
       buffer_data_to_buffer_.Set(buffer->data, buffer);
     }
-    return arith::IRMutatorWithAnalyzer::VisitStmt_(op);
+    Block block = Downcast<Block>(arith::IRMutatorWithAnalyzer::VisitStmt_(op));
+    // the staging buffers are allocated with the buffers they are casted into
+    Array<Buffer> staging;
+    for (const auto& buffer : op->alloc_buffers) {
+      auto it = staging_buffers_.find(buffer.get());
+      if (it == staging_buffers_.end()) continue;
+      for (const auto& stage : it->second) staging.push_back(stage);
+      staging_buffers_.erase(it);
+    }
+    if (!staging.empty()) {
+      auto n = block.CopyOnWrite();
+      for (const auto& stage : staging) n->alloc_buffers.push_back(stage);
+    }
+    return std::move(block);
+  }
+
+  Stmt VisitStmt_(const SeqStmtNode* op) final {
+    // keep the two copies of a staged copy at the level of the pipeline body
+    Array<Stmt> seq = op->seq.Map([this](const Stmt& stmt) { return VisitStmt(stmt); });
+    // an unchanged sequence is kept, rather than rebuilt, when it is already flat
+    if (seq.same_as(op->seq)) return SeqStmt::Flatten(GetRef<SeqStmt>(op));
+    return SeqStmt::Flatten(seq);
   }
 
   Stmt VisitStmt_(const ForNode* node) final {
+    bool pipelined = node->annotations.count("num_stages") > 0;
     if (node->kind == ForKind::kParallel) {
       parallel_for_scope_++;
     }
+    int64_t num_stages = num_stages_;
+    if (pipelined) {
+      pipelined_scope_++;
+      // auto is resolved later by PlanNumStages, which fits the stages in the shared memory
+      num_stages_ = std::max<int64_t>(Downcast<Integer>(node->annotations["num_stages"])->value, 1);
+    }
     auto n = StmtExprMutator::VisitStmt_(node);
     if (node->kind == ForKind::kParallel) {
       parallel_for_scope_--;
     }
+    if (pipelined) pipelined_scope_--;
+    num_stages_ = num_stages;
     return n;
   }
 
@@ -75,38 +121,329 @@ class FrontendLegalizer : public arith::IRMutatorWithAnalyzer {
     if (auto call = new_node.as<EvaluateNode>()->value.as<CallNode>()) {
       if (call->op.same_as(tl::fill())) {
         return LowerFill(call->args);
+      } else if (call->op.same_as(tl::atomic_add())) {
+        return LowerAtomicAdd(call->args);
+      } else if (call->op.same_as(tl::reduce_across_blocks())) {
+        return LowerReduceAcrossBlocks(call->args);
+      } else if (call->op.same_as(tl::gather_copy())) {
+        return LowerGatherCopy(call->args);
+      } else if (call->op.same_as(tl::conv_copy())) {
+        return LowerConvCopy(call->args);
       } else if (call->op.same_as(tl::copy())) {
-        return LowerCopy(call->args);
+        CopyArgs args = CopyArgs::Parse(call->args);
+        // bulk copies are lowered after the layout of the shared buffer is inferred
+        if (parallel_for_scope_ == 0 && IsBulkLoad(args)) return new_node;
+        Stmt staged = LowerStagedCopy(args);
+        if (staged.defined()) return staged;
+        return LowerCopy(args);
       }
     }
     return new_node;
   }
 
-  Stmt LowerCopy(const Array<PrimExpr>& call_args) {
-    CopyArgs args = CopyArgs::Parse(call_args);
+  /*!
+   * \brief The copies from the global memory with a cast can not be made asynchronous, in a
+   * pipelined loop they are split into an asynchronous copy into a shared buffer of the src dtype,
+   * multi-buffered by the pipeline, and a cast from it into dst next to the consumers. The copy
+   * is left synchronous if the versions of the staging buffer do not fit in the shared memory
+   * left by the kernel, or with the pass config tl.disable_smem_staging.
+   */
+  Stmt LowerStagedCopy(const CopyArgs& args) {
+    auto is_shared = [](const Buffer& buffer) {
+      return buffer.scope() == "shared" || buffer.scope() == "shared.dyn";
+    };
+    if (pipelined_scope_ == 0 || parallel_for_scope_ > 0) return Stmt();
+    if (args.src.scope() != "global" || !is_shared(args.dst)) return Stmt();
+    if (args.src->dtype == args.dst->dtype || args.src->dtype.lanes() != 1) return Stmt();
+    if (!TargetHasAsyncCopy(target_.get())) return Stmt();
+    Array<PrimExpr> shape;
+    Array<Range> stage_range;
+    for (const auto& range : args.src_range) {
+      if (!as_const_int(range->extent)) return Stmt();
+      shape.push_back(range->extent);
+      stage_range.push_back(Range::FromMinExtent(0, range->extent));
+    }
+    int64_t stage_bytes = num_stages_ * args.src->dtype.bytes();
+    for (const auto& extent : shape) stage_bytes *= *as_const_int(extent);
+    if (stage_bytes > smem_headroom_) return Stmt();
+    smem_headroom_ -= stage_bytes;
+    Buffer stage = decl_buffer(shape, args.src->dtype, args.dst->name + "_staged",
+                               args.dst.scope());
+    staging_buffers_[args.dst.get()].push_back(stage);
+    buffer_data_to_buffer_.Set(stage->data, stage);
+
+    CopyArgs load{args.src, stage, args.src_range, stage_range, args.cache_hint, args.l2_prefetch,
+                  args.bound};
+    CopyArgs cast{stage, args.dst, stage_range, args.dst_range};
+    Stmt load_stmt;
+    if (IsBulkLoad(load)) {
+      Array<PrimExpr> copy_args = {MakeRegion(load.src, load.src_range, 1),
+                                   MakeRegion(load.dst, load.dst_range, 2),
+                                   Integer(static_cast<int>(load.cache_hint)),
+                                   Integer(load.l2_prefetch)};
+      load_stmt = Evaluate(Call(DataType::Handle(), tl::copy(), copy_args));
+    } else {
+      load_stmt = LowerCopy(load);
+    }
+    return SeqStmt({load_stmt, LowerCopy(cast)});
+  }
+
+  static PrimExpr MakeRegion(const Buffer& buffer, const Array<Range>& ranges, int access) {
+    Array<PrimExpr> mins, args;
+    for (const auto& range : ranges) mins.push_back(range->min);
+    args.push_back(BufferLoad(buffer, mins));
+    args.push_back(Integer(access));
+    for (const auto& range : ranges) args.push_back(range->extent);
+    return Call(DataType::Handle(), tl::region(), args);
+  }
+
+  // The tensor maps of the bulk loads are encoded on the host from the buffers passed to the
+  // kernel, the buffers declared in the kernel (the peer buffers) are copied by the threads
+  bool IsBulkLoad(const CopyArgs& args) const {
+    return args.CheckBulkLoad(target_.get()) && param_data_.count(args.src->data.get());
+  }
+
+  Stmt LowerCopy(const CopyArgs& args) {
+    Stmt body = MakeCopyLoop(args, true);
+    if (parallel_for_scope_ > 0) return body;
+    // Tiles that lie inside the buffers take an unpredicated copy that can be vectorized, only the
+    // boundary tiles of a dynamic (or non-divisible) shape pay for the per-element predicates.
+    PrimExpr src_tile = args.MakeTilePredicate(analyzer_, args.Extents(0), 0);
+    PrimExpr dst_tile = args.MakeTilePredicate(analyzer_, args.Extents(1), 1);
+    if (!src_tile.defined() && !dst_tile.defined()) return body;
+    PrimExpr tile_predicate;
+    if (src_tile.defined() && dst_tile.defined())
+      tile_predicate = And(src_tile, dst_tile);
+    else
+      tile_predicate = src_tile.defined() ? src_tile : dst_tile;
+    return IfThenElse(tile_predicate, MakeCopyLoop(args, false), body);
+  }
+
+  Stmt MakeCopyLoop(const CopyArgs& args, bool predicated) {
     Array<IterVar> loop_vars = args.MakeIterVars();
     for (const auto& iv : loop_vars) analyzer_->Bind(iv->var, iv->dom);
 
     Array<PrimExpr> src_indices = args.MakeIndices(loop_vars, 0);
     Array<PrimExpr> dst_indices = args.MakeIndices(loop_vars, 1);
 
-    PrimExpr src_predicate = args.MakePredicate(analyzer_, loop_vars, args.src->shape, 0);
-    PrimExpr dst_predicate = args.MakePredicate(analyzer_, loop_vars, args.dst->shape, 1);
+    PrimExpr src_predicate, dst_predicate;
+    if (predicated) {
+      src_predicate = args.MakePredicate(analyzer_, loop_vars, args.Extents(0), 0);
+      dst_predicate = args.MakePredicate(analyzer_, loop_vars, args.Extents(1), 1);
+    }
 
     PrimExpr value = BufferLoad(args.src, src_indices);
     if (args.src->dtype != args.dst->dtype) value = Cast(args.dst->dtype, value);
     if (src_predicate.defined())
       value = if_then_else(src_predicate, value, make_zero(args.dst->dtype));
 
-    Stmt body = BufferStore(args.dst, value, dst_indices);
+    Stmt body = args.MakeCacheHintScope(BufferStore(args.dst, value, dst_indices));
+    if (dst_predicate.defined()) body = IfThenElse(dst_predicate, body);
+
+    for (int i = loop_vars.size() - 1; i >= 0; i--) {
+      body = For(loop_vars[i]->var, 0, loop_vars[i]->dom->extent, ForKind::kParallel, body);
+    }
+    return body;
+  }
+
+  /*!
+   * \brief The gather loop of an im2col tile. When the channels are a multiple of the columns of
+   * the tile, the tile lies within a single kernel tap: its columns are contiguous channels of a
+   * pixel, so the loop is vectorized into 16 bytes (cp.async) copies with a predicate per pixel
+   * for the padding. Otherwise each element is gathered from its own tap.
+   */
+  Stmt LowerConvCopy(const Array<PrimExpr>& call_args) {
+    ConvCopyArgs args = ConvCopyArgs::Parse(call_args);
+    const Buffer& src = args.src;
+    auto rows = as_const_int(args.dst_range[0]->extent);
+    auto cols = as_const_int(args.dst_range[1]->extent);
+    ICHECK(rows && cols) << "conv_copy requires a static tile, got " << args.dst_range;
+    Var i("i"), j("j");
+    analyzer_->Bind(i, Range(0, static_cast<int>(*rows)));
+    analyzer_->Bind(j, Range(0, static_cast<int>(*cols)));
+
+    PrimExpr m = args.m_offset + i;
+    PrimExpr pixels = args.out_h * args.out_w;
+    PrimExpr n = floordiv(m, pixels);
+    PrimExpr oh = floordiv(floormod(m, pixels), args.out_w);
+    PrimExpr ow = floormod(m, args.out_w);
+
+    PrimExpr channels = src->shape[3];
+    int num_taps = args.kernel[0] * args.kernel[1];
+    PrimExpr tap, c;
+    Array<PrimExpr> conds;
+    if (analyzer_->CanProveEqual(floormod(channels, static_cast<int>(*cols)), 0) &&
+        analyzer_->CanProveEqual(floormod(args.k_offset, static_cast<int>(*cols)), 0)) {
+      PrimExpr tile = floordiv(args.k_offset, static_cast<int>(*cols));
+      PrimExpr tiles_per_tap = floordiv(channels, static_cast<int>(*cols));
+      tap = floordiv(tile, tiles_per_tap);
+      c = floormod(tile, tiles_per_tap) * static_cast<int>(*cols) + j;
+    } else {
+      PrimExpr k = args.k_offset + j;
+      tap = floordiv(k, channels);
+      c = floormod(k, channels);
+      conds.push_back(tap < num_taps);
+    }
+    PrimExpr kh = floordiv(tap, args.kernel[1]), kw = floormod(tap, args.kernel[1]);
+
+    Array<PrimExpr> src_indices = {n};
+    PrimExpr pixel[2] = {oh, ow}, tap_pos[2] = {kh, kw};
+    for (int d = 0; d < 2; d++) {
+      PrimExpr extent = src->shape[1 + d];
+      if (args.mode == ConvCopyArgs::Mode::kFprop) {
+        PrimExpr pos =
+            pixel[d] * args.stride[d] + tap_pos[d] * args.dilation[d] - args.padding[d];
+        conds.push_back(pos >= 0);
+        conds.push_back(pos < extent);
+        src_indices.push_back(pos);
+      } else {
+        // the output pixels whose window covers this input pixel at the tap
+        PrimExpr scaled = pixel[d] + args.padding[d] - tap_pos[d] * args.dilation[d];
+        PrimExpr pos = floordiv(scaled, args.stride[d]);
+        conds.push_back(scaled >= 0);
+        if (args.stride[d] > 1) conds.push_back(floormod(scaled, args.stride[d]) == 0);
+        conds.push_back(pos < extent);
+        src_indices.push_back(pos);
+      }
+    }
+    src_indices.push_back(c);
+    conds.push_back(n < src->shape[0]);
+
+    PrimExpr predicate;
+    for (const auto& cond : conds) {
+      if (analyzer_->CanProve(cond)) continue;
+      predicate = predicate.defined() ? And(predicate, cond) : cond;
+    }
+    PrimExpr value = BufferLoad(src, src_indices);
+    if (src->dtype != args.dst->dtype) value = Cast(args.dst->dtype, value);
+    if (predicate.defined()) value = if_then_else(predicate, value, make_zero(args.dst->dtype));
+    Stmt body = BufferStore(
+        args.dst, value, {args.dst_range[0]->min + i, args.dst_range[1]->min + j});
+    body = For(j, 0, static_cast<int>(*cols), ForKind::kParallel, body);
+    return For(i, 0, static_cast<int>(*rows), ForKind::kParallel, body);
+  }
+
+  /*!
+   * \brief The copy loop of a gather copy, the src row is read from the index buffer. The index
+   * does not depend on the columns, so the rows are vectorized into 16 bytes (cp.async) copies
+   * like a plain copy, each chunk loading its row index once. A scatter copy indexes the dst rows
+   * instead, its rows are vectorized stores.
+   */
+  Stmt LowerGatherCopy(const Array<PrimExpr>& call_args) {
+    GatherCopyArgs args = GatherCopyArgs::Parse(call_args);
+    const CopyArgs& copy = args.copy;
+    Array<IterVar> loop_vars = copy.MakeIterVars();
+    for (const auto& iv : loop_vars) analyzer_->Bind(iv->var, iv->dom);
+
+    Array<PrimExpr> src_indices = copy.MakeIndices(loop_vars, 0);
+    Array<PrimExpr> dst_indices = copy.MakeIndices(loop_vars, 1);
+    // the indexed rows are in bound, only the other dims of the global buffer are checked
+    Array<PrimExpr> src_extents = copy.src->shape, dst_extents = copy.dst->shape;
+    if (args.scatter) {
+      dst_extents.Set(0, copy.dst_range[0]->extent);
+    } else {
+      src_extents.Set(0, copy.src_range[0]->extent);
+    }
+    PrimExpr src_predicate = copy.MakePredicate(analyzer_, loop_vars, src_extents, 0);
+    PrimExpr dst_predicate = copy.MakePredicate(analyzer_, loop_vars, dst_extents, 1);
+    if (args.scatter) {
+      dst_indices.Set(0, args.MakeIndexedRow(dst_indices[0]));
+    } else {
+      src_indices.Set(0, args.MakeIndexedRow(src_indices[0]));
+    }
+
+    PrimExpr value = BufferLoad(copy.src, src_indices);
+    if (copy.src->dtype != copy.dst->dtype) value = Cast(copy.dst->dtype, value);
+    if (src_predicate.defined())
+      value = if_then_else(src_predicate, value, make_zero(copy.dst->dtype));
+    Stmt body = copy.MakeCacheHintScope(BufferStore(copy.dst, value, dst_indices));
     if (dst_predicate.defined()) body = IfThenElse(dst_predicate, body);
+    for (int i = loop_vars.size() - 1; i >= 0; i--) {
+      body = For(loop_vars[i]->var, 0, loop_vars[i]->dom->extent, ForKind::kParallel, body);
+    }
+    return body;
+  }
+
+  Stmt LowerAtomicAdd(const Array<PrimExpr>& call_args) {
+    CopyArgs args = CopyArgs::Parse(call_args);
+    Array<IterVar> loop_vars = args.MakeIterVars();
+    for (const auto& iv : loop_vars) analyzer_->Bind(iv->var, iv->dom);
 
+    Array<PrimExpr> src_indices = args.MakeIndices(loop_vars, 0);
+    Array<PrimExpr> dst_indices = args.MakeIndices(loop_vars, 1);
+    PrimExpr dst_predicate = args.MakePredicate(analyzer_, loop_vars, args.dst->shape, 1);
+    // vectorized by the loop vectorizer when the src is in the registers, see auto_vectorize.cc
+    PrimExpr dst_ptr =
+        Call(DataType::Handle(), builtin::address_of(), {BufferLoad(args.dst, dst_indices)});
+    PrimExpr value = BufferLoad(args.src, src_indices);
+    Stmt body = Evaluate(Call(DataType::Handle(), builtin::call_extern(),
+                              {StringImm("tl::AtomicAdd"), dst_ptr, value}));
+    if (dst_predicate.defined()) body = IfThenElse(dst_predicate, body);
     for (int i = loop_vars.size() - 1; i >= 0; i--) {
       body = For(loop_vars[i]->var, 0, loop_vars[i]->dom->extent, ForKind::kParallel, body);
     }
     return body;
   }
 
+  Stmt LowerReduceAcrossBlocks(const Array<PrimExpr>& call_args) {
+    ReduceAcrossBlocksArgs args = ReduceAcrossBlocksArgs::Parse(call_args);
+    const CopyArgs& copy = args.copy;
+    ICHECK(copy.src.scope() == "local.fragment" && copy.dst.scope() == "global")
+        << "reduce_across_blocks should reduce a fragment into the global memory";
+    Array<IterVar> loop_vars = copy.MakeIterVars();
+    for (const auto& iv : loop_vars) analyzer_->Bind(iv->var, iv->dom);
+
+    Array<PrimExpr> src_indices = copy.MakeIndices(loop_vars, 0);
+    Array<PrimExpr> dst_indices = copy.MakeIndices(loop_vars, 1);
+    PrimExpr dst_predicate = copy.MakePredicate(analyzer_, loop_vars, copy.dst->shape, 1);
+    PrimExpr value = BufferLoad(copy.src, src_indices);
+    if (copy.src->dtype != copy.dst->dtype) value = Cast(copy.dst->dtype, value);
+
+    Stmt body;
+    if (args.mode == ReduceAcrossBlocksArgs::Mode::kAtomic) {
+      PrimExpr dst_ptr =
+          Call(DataType::Handle(), builtin::address_of(), {BufferLoad(copy.dst, dst_indices)});
+      body = Evaluate(Call(DataType::Handle(), builtin::call_extern(),
+                           {StringImm("tl::AtomicAdd"), dst_ptr, value}));
+    } else {
+      // the first split overwrites dst
+      value = if_then_else(EQ(args.split_idx, 0), value, BufferLoad(copy.dst, dst_indices) + value);
+      body = BufferStore(copy.dst, value, dst_indices);
+    }
+    if (dst_predicate.defined()) body = IfThenElse(dst_predicate, body);
+    for (int i = loop_vars.size() - 1; i >= 0; i--) {
+      body = For(loop_vars[i]->var, 0, loop_vars[i]->dom->extent, ForKind::kParallel, body);
+    }
+    if (args.mode == ReduceAcrossBlocksArgs::Mode::kAtomic) return body;
+
+    // one semaphore per tile of dst, counting the splits added into it
+    PrimExpr tile = 0;
+    int64_t num_tiles = 1;
+    for (size_t i = 0; i < copy.dst_range.size(); i++) {
+      auto shape = as_const_int(copy.dst->shape[i]);
+      auto extent = as_const_int(copy.dst_range[i]->extent);
+      ICHECK(shape && extent) << "reduce_across_blocks requires a static dst region, got "
+                              << copy.dst_range;
+      int64_t tiles = (*shape + *extent - 1) / *extent;
+      tile = tile * static_cast<int>(tiles) + floordiv(copy.dst_range[i]->min, *extent);
+      num_tiles *= tiles;
+    }
+    Buffer semaphore = decl_buffer({static_cast<int>(num_tiles)}, DataType::Int(32),
+                                   copy.dst->name + "_semaphore", "global");
+    PrimExpr semaphore_ptr =
+        Call(DataType::Handle(), builtin::address_of(), {BufferLoad(semaphore, {tile})});
+    auto extern_call = [](const std::string& name, Array<PrimExpr> args) {
+      args.insert(args.begin(), StringImm(name));
+      return Evaluate(Call(DataType::Handle(), builtin::call_extern(), args));
+    };
+    Stmt wait = extern_call("tl::semaphore_wait", {semaphore_ptr, args.split_idx});
+    Stmt release = extern_call("tl::semaphore_release", {semaphore_ptr, args.split_idx + 1});
+    Stmt stmt = SeqStmt({wait, body, release});
+    // the semaphores are zeroed for each launch
+    global_workspaces_.push_back(semaphore);
+    return stmt;
+  }
+
   Stmt LowerFill(const Array<PrimExpr>& clear_args) {
     FillArgs args = FillArgs::Parse(clear_args, buffer_data_to_buffer_);
     int ndim = args.dst->shape.size();
@@ -139,6 +476,8 @@ class FrontendLegalizer : public arith::IRMutatorWithAnalyzer {
   }
 
   Stmt VisitStmt_(const LetStmtNode* node) final {
+    // the data pointers of the buffers declared in the kernel, e.g. the peer buffers, are kept
+    if (node->var.dtype().is_handle()) return arith::IRMutatorWithAnalyzer::VisitStmt_(node);
     let_bindings_[node->var.get()] = node->value;
     return arith::IRMutatorWithAnalyzer::VisitStmt(node->body);
   }
@@ -149,8 +488,19 @@ class FrontendLegalizer : public arith::IRMutatorWithAnalyzer {
   }
 
   int parallel_for_scope_ = 0;
+  int pipelined_scope_ = 0;
+  // the num_stages of the innermost pipelined loop
+  int64_t num_stages_ = 1;
+  // the shared memory bytes left for the staging buffers, 0 if tl.disable_smem_staging is set
+  int64_t smem_headroom_ = 0;
+  // the staging buffers of the staged copies, by the buffer they are casted into
+  std::unordered_map<const BufferNode*, Array<Buffer>> staging_buffers_;
   std::unordered_map<const VarNode*, PrimExpr> let_bindings_;
+  std::unordered_set<const VarNode*> param_data_;
   Map<Var, Buffer> buffer_data_to_buffer_;
+  // the global workspaces of the kernel, see AllocateGlobalWorkspaces
+  Array<Buffer> global_workspaces_;
+  Target target_;
 };
 
 using namespace tir::transform;
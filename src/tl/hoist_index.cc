@@ -0,0 +1,247 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file hoist_index.cc
+ * \brief Hoist the loop invariant index arithmetic of the device kernels out of the loops, right
+ * before the codegen
+ */
+
+#include <tvm/tir/builtin.h>
+#include <tvm/tir/op.h>
+#include <tvm/tir/stmt_functor.h>
+#include <tvm/tir/transform.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../arith/ir_mutator_with_analyzer.h"
+
+namespace tvm {
+namespace tl {
+
+using namespace tir;
+
+TVM_REGISTER_PASS_CONFIG_OPTION("tl.disable_index_hoisting", Bool);
+
+/*!
+ * \brief The indices made by the layouts (the swizzles, the thread and the local index of the
+ * fragments) mix the terms of the thread and of the outer loops with the ones of the inner
+ * loops, e.g. (tx >> 3) * 64 + ((tx & 7) ^ (k & 7)) * 8 + k * 512 in a pipelined loop over k.
+ * The integer sums are split into the terms depending on the loop vars and the others, the
+ * invariant terms and the invariant subexpressions are bound to variables before the outermost
+ * loop they do not depend on: the ones of the thread only become the per-thread bases computed
+ * once at the top of the kernel. The divisions and the remainders of the non-negative values by
+ * the powers of two are made shifts and masks on the way.
+ */
+class IndexHoister : public arith::IRMutatorWithAnalyzer {
+ public:
+  static Stmt Run(const Stmt& stmt) {
+    arith::Analyzer analyzer;
+    IndexHoister hoister(&analyzer);
+    return hoister.VisitStmt(stmt);
+  }
+
+ private:
+  using arith::IRMutatorWithAnalyzer::IRMutatorWithAnalyzer;
+  using arith::IRMutatorWithAnalyzer::VisitExpr;
+
+  Stmt VisitStmt_(const ForNode* op) final {
+    PrimExpr min = VisitExpr(op->min), extent = VisitExpr(op->extent);
+    analyzer_->Bind(op->loop_var, Range::FromMinExtent(min, extent));
+    frames_.emplace_back();
+    var_depth_[op->loop_var.get()] = frames_.size();
+    Stmt body = VisitStmt(op->body);
+    std::vector<std::pair<Var, PrimExpr>> lets = std::move(frames_.back());
+    frames_.pop_back();
+    Stmt stmt = For(op->loop_var, min, extent, op->kind, body, op->thread_binding,
+                    op->annotations);
+    for (auto it = lets.rbegin(); it != lets.rend(); it++) {
+      stmt = LetStmt(it->first, it->second, stmt);
+    }
+    return stmt;
+  }
+
+  Stmt VisitStmt_(const LetStmtNode* op) final {
+    var_depth_[op->var.get()] = frames_.size();
+    return arith::IRMutatorWithAnalyzer::VisitStmt_(op);
+  }
+
+  Stmt VisitStmt_(const AttrStmtNode* op) final {
+    // the values of the attributes are kept as they are, e.g. the launch extents
+    if (op->attr_key == tir::attr::thread_extent || op->attr_key == tir::attr::virtual_thread) {
+      IterVar iv = Downcast<IterVar>(op->node);
+      var_depth_[iv->var.get()] = frames_.size();
+      analyzer_->Bind(iv->var, Range::FromMinExtent(0, op->value));
+    }
+    Stmt body = VisitStmt(op->body);
+    if (body.same_as(op->body)) return GetRef<Stmt>(op);
+    return AttrStmt(op->node, op->attr_key, op->value, body);
+  }
+
+  PrimExpr VisitExpr_(const LetNode* op) final {
+    var_depth_[op->var.get()] = frames_.size();
+    return arith::IRMutatorWithAnalyzer::VisitExpr_(op);
+  }
+
+  PrimExpr VisitExpr_(const DivNode* op) final {
+    PrimExpr ret = arith::IRMutatorWithAnalyzer::VisitExpr_(op);
+    int shift;
+    if (auto div = ret.as<DivNode>()) {
+      if (is_const_power_of_two_integer(div->b, &shift) &&
+          analyzer_->CanProveGreaterEqual(div->a, 0)) {
+        return div->a >> make_const(div->dtype, shift);
+      }
+    }
+    return ret;
+  }
+
+  PrimExpr VisitExpr_(const ModNode* op) final {
+    PrimExpr ret = arith::IRMutatorWithAnalyzer::VisitExpr_(op);
+    int shift;
+    if (auto mod = ret.as<ModNode>()) {
+      if (is_const_power_of_two_integer(mod->b, &shift) &&
+          analyzer_->CanProveGreaterEqual(mod->a, 0)) {
+        return mod->a & make_const(mod->dtype, (int64_t(1) << shift) - 1);
+      }
+    }
+    return ret;
+  }
+
+  PrimExpr VisitExpr(const PrimExpr& expr) final {
+    if (hoisting_ || frames_.empty() || !expr.dtype().is_int() || !expr.dtype().is_scalar()) {
+      return arith::IRMutatorWithAnalyzer::VisitExpr(expr);
+    }
+    if (IsTrivial(expr)) return expr;
+    int depth = Depth(expr);
+    if (depth < static_cast<int>(frames_.size())) return Hoist(expr, depth);
+    if (expr.as<AddNode>() == nullptr) return arith::IRMutatorWithAnalyzer::VisitExpr(expr);
+    // the invariant terms of the sum are gathered into one hoisted term
+    std::vector<PrimExpr> terms;
+    CollectTerms(expr, &terms);
+    PrimExpr invariant, variant;
+    int invariant_depth = 0;
+    for (const auto& term : terms) {
+      int term_depth = Depth(term);
+      if (term_depth < static_cast<int>(frames_.size())) {
+        invariant = invariant.defined() ? invariant + term : term;
+        invariant_depth = std::max(invariant_depth, term_depth);
+      } else {
+        PrimExpr value = VisitExpr(term);
+        variant = variant.defined() ? variant + value : value;
+      }
+    }
+    if (!invariant.defined()) return variant;
+    if (!IsTrivial(invariant)) invariant = Hoist(invariant, invariant_depth);
+    return variant + invariant;
+  }
+
+  static void CollectTerms(const PrimExpr& expr, std::vector<PrimExpr>* terms) {
+    if (auto add = expr.as<AddNode>()) {
+      CollectTerms(add->a, terms);
+      CollectTerms(add->b, terms);
+    } else {
+      terms->push_back(expr);
+    }
+  }
+
+  // the vars, the constants and their casts cost nothing to recompute
+  static bool IsTrivial(const PrimExpr& expr) {
+    if (expr->IsInstance<VarNode>() || expr->IsInstance<IntImmNode>()) return true;
+    if (auto cast = expr.as<CastNode>()) return IsTrivial(cast->value);
+    return false;
+  }
+
+  // The number of the enclosing loops the value of expr depends on, the number of the enclosing
+  // loops plus one if it can not be moved (memory reads, calls, divisions by a variable).
+  int Depth(const PrimExpr& expr) const {
+    const int pinned = frames_.size() + 1;
+    int depth = 0;
+    PostOrderVisit(expr, [&](const ObjectRef& node) {
+      if (auto var = node.as<VarNode>()) {
+        auto it = var_depth_.find(var);
+        if (it != var_depth_.end()) depth = std::max(depth, it->second);
+      } else if (node->IsInstance<BufferLoadNode>() || node->IsInstance<LetNode>()) {
+        depth = pinned;
+      } else if (auto call = node.as<CallNode>()) {
+        bool pure = call->op.same_as(builtin::shift_right()) ||
+                    call->op.same_as(builtin::shift_left()) ||
+                    call->op.same_as(builtin::bitwise_and()) ||
+                    call->op.same_as(builtin::bitwise_or()) ||
+                    call->op.same_as(builtin::bitwise_xor()) ||
+                    call->op.same_as(builtin::bitwise_not());
+        if (!pure) depth = pinned;
+      } else if (auto div = node.as<DivNode>()) {
+        if (!is_const_int(div->b)) depth = pinned;
+      } else if (auto mod = node.as<ModNode>()) {
+        if (!is_const_int(mod->b)) depth = pinned;
+      } else if (auto div = node.as<FloorDivNode>()) {
+        if (!is_const_int(div->b)) depth = pinned;
+      } else if (auto mod = node.as<FloorModNode>()) {
+        if (!is_const_int(mod->b)) depth = pinned;
+      }
+    });
+    return depth;
+  }
+
+  // Bind expr before the loop of depth + 1, the same expressions sharing their variable. The
+  // subexpressions of expr are not hoisted on their own.
+  PrimExpr Hoist(PrimExpr expr, int depth) {
+    hoisting_ = true;
+    expr = arith::IRMutatorWithAnalyzer::VisitExpr(expr);
+    hoisting_ = false;
+    auto& lets = frames_[depth];
+    for (const auto& [var, value] : lets) {
+      if (StructuralEqual()(value, expr)) return var;
+    }
+    Var var("idx", expr.dtype());
+    var_depth_[var.get()] = depth;
+    lets.emplace_back(var, expr);
+    return var;
+  }
+
+  // the lets hoisted before each enclosing loop, from the outermost
+  std::vector<std::vector<std::pair<Var, PrimExpr>>> frames_;
+  // the number of the enclosing loops where the vars are defined, the params and the launch
+  // vars outside of the loops are not recorded
+  std::unordered_map<const VarNode*, int> var_depth_;
+  bool hoisting_ = false;
+};
+
+namespace transform {
+
+using namespace tir::transform;
+
+tvm::transform::Pass HoistIndex() {
+  auto pass_func = [=](PrimFunc f, IRModule m, PassContext ctx) {
+    if (ctx->GetConfig<Bool>("tl.disable_index_hoisting", Bool(false)).value()) return f;
+    auto* n = f.CopyOnWrite();
+    n->body = IndexHoister::Run(n->body);
+    return f;
+  };
+  return CreatePrimFuncPass(pass_func, 0, "tl.HoistIndex", {});
+}
+
+TVM_REGISTER_GLOBAL("tl.HoistIndex").set_body_typed(HoistIndex);
+}  // namespace transform
+
+}  // namespace tl
+}  // namespace tvm
@@ -25,16 +25,20 @@
 #include <tvm/tir/builtin.h>
 #include <tvm/tir/transform.h>
 
+#include <algorithm>
 #include <unordered_set>
 
 #include "../support/utils.h"
 #include "../tir/schedule/utils.h"
 #include "../tir/transforms/ir_utils.h"
+#include "op.h"
 
 namespace tvm {
 namespace tl {
 using namespace tir;
 
+TVM_REGISTER_PASS_CONFIG_OPTION("tl.disable_async_buffer_groups", Bool);
+
 /*!
  * \brief Create a block and infer the access region with the given body.
  *
@@ -66,6 +70,8 @@ struct PipelineAnnotation {
   int stage;
   int order;
   bool async;
+  // stores the registers loaded by the previous iteration, see attr::kPipelineRegisterStaged
+  bool register_staged = false;
 };
 
 using PipelineInfo = std::unordered_map<Block, PipelineAnnotation, ObjectPtrHash, ObjectPtrEqual>;
@@ -213,12 +219,14 @@ class PipelineBodyRewriter : public StmtExprMutator {
 class PipelineRewriter : public StmtExprMutator {
  public:
   PipelineRewriter(Map<Var, Buffer> buffer_data_to_buffer, const Array<Buffer>& pipeline_allocs,
-                   const For& pipeline_loop, const PipelineInfo& pipeline_info)
+                   const For& pipeline_loop, const PipelineInfo& pipeline_info,
+                   bool async_buffer_groups)
 
       : buffer_data_to_buffer_(std::move(buffer_data_to_buffer)),
         pipeline_allocs_(pipeline_allocs),
         pipeline_loop_(pipeline_loop),
-        pipeline_info_(pipeline_info) {}
+        pipeline_info_(pipeline_info),
+        async_buffer_groups_(async_buffer_groups) {}
 
   Stmt BuildPipeline() {
     // Step 1: Analyze accesses to the buffers in the pipeline and compute the number of versions
@@ -254,15 +262,26 @@ class PipelineRewriter : public StmtExprMutator {
       int stage = pipeline_info_[block].stage;
       if (pipeline_info_[block].async) {
         auto& state = async_states[stage];
-        if (state.commit_groups.empty() || consumed.count(stage)) {
+        Array<Buffer> dst_buffers;
+        for (auto write_region : block->writes) {
+          dst_buffers.push_back(buffer_remap_.count(write_region->buffer)
+                                    ? buffer_remap_[write_region->buffer]
+                                    : write_region->buffer);
+        }
+        // A copy into another buffer than the ones of the last group gets its own group, so that
+        // the consumers of the buffers committed earlier don't wait for it.
+        bool new_buffer = async_buffer_groups_ &&
+                          std::any_of(dst_buffers.begin(), dst_buffers.end(), [&](const Buffer& b) {
+                            auto it = state.buffer_to_commit_group_.find(b.get());
+                            return it == state.buffer_to_commit_group_.end() ||
+                                   it->second != static_cast<int>(state.commit_groups.size()) - 1;
+                          });
+        if (state.commit_groups.empty() || consumed.count(stage) || new_buffer) {
           state.commit_groups.push_back({});
         }
         state.commit_groups.back().push_back(pipeline_info_[block].order);
         consumed.erase(stage);
-        for (auto write_region : block->writes) {
-          auto buffer = buffer_remap_.count(write_region->buffer)
-                            ? buffer_remap_[write_region->buffer]
-                            : write_region->buffer;
+        for (const Buffer& buffer : dst_buffers) {
           state.buffer_to_commit_group_[buffer.get()] = state.commit_groups.size() - 1;
         }
       }
@@ -514,7 +533,9 @@ class PipelineRewriter : public StmtExprMutator {
         in_flight_cnt += producer_head - consumer_head;
       }
 
-      // We can relax the in-flight-count by the number of independent commit.
+      // We can relax the in-flight-count by the number of independent commit, i.e. the groups
+      // committed after the last one holding a buffer read by the block: with a group per buffer,
+      // the consumer of the first operand doesn't wait for the copies of the next ones.
       std::unordered_set<int> dependent_groups;
       for (const auto& read_region : new_blocks[i].block->reads) {
         if (state.buffer_to_commit_group_.count(read_region->buffer.get()))
@@ -566,6 +587,11 @@ class PipelineRewriter : public StmtExprMutator {
                      new_blocks[i].stage, block->body);
         block = MakeBlock(commit_queue_scope, buffer_data_to_buffer_);
       }
+      // the waits of the async copies are timed with the stage consuming them
+      std::string timer = "stage " + std::to_string(new_blocks[i].stage) + " #" +
+                          std::to_string(new_blocks[i].order);
+      Stmt timed = MakeTimerScope(block->body, timer);
+      if (!timed.same_as(block->body)) block.CopyOnWrite()->body = timed;
       stmts.push_back(BlockRealize({}, new_blocks[i].predicate, block));
     }
 
@@ -635,6 +661,18 @@ class PipelineRewriter : public StmtExprMutator {
         n->body = AttrStmt(make_zero(DataType::Int(32)), tir::attr::async_scope, 1, n->body);
       }
 
+      if (pipeline_info_[block].register_staged && !need_bound_check) {
+        // In the steady state the stores of the staged registers write the version of the shared
+        // buffer the later stages of the iteration do not read, the thread sync only needs a
+        // barrier against the reads of the previous iterations.
+        for (const BufferRegion& write : block->writes) {
+          if (buffer_remap_.count(write->buffer)) {
+            BlockNode* n = new_block.CopyOnWrite();
+            n->body = AttrStmt(write->buffer->data, tir::attr::double_buffer_write, 1, n->body);
+          }
+        }
+      }
+
       new_blocks.push_back(
           {stage, order, inbound, new_block, normalized_access_index, pipeline_info_[block].async});
     }
@@ -659,10 +697,14 @@ class PipelineRewriter : public StmtExprMutator {
         const String& key = kv.first;
         if (kv.first != tir::attr::software_pipeline_stage &&
             kv.first != tir::attr::software_pipeline_order &&
-            kv.first != tir::attr::software_pipeline_async_stages) {
+            kv.first != tir::attr::software_pipeline_async_stages &&
+            kv.first != attr::kPipelineRegisterStaged) {
           preserved_annotations.Set(key, kv.second);
         }
       }
+      if (!need_bound_check) {
+        preserved_annotations.Set(attr::kPipelineStages, Integer(max_stage_ + 1));
+      }
       new_loop = For(Downcast<Var>(new_loop_var), pipeline_loop_->min, extent,
                      unroll_loop ? ForKind::kUnrolled : pipeline_loop_->kind, std::move(new_loop),
                      NullOpt, preserved_annotations);
@@ -685,6 +727,8 @@ class PipelineRewriter : public StmtExprMutator {
   Map<Buffer, Buffer> buffer_remap_;
   Array<Block> ordered_stmts_;
   std::map<int, AsyncStateGlobal> async_states;
+  /*! \brief Whether the async copies of a stage into different buffers are committed apart. */
+  bool async_buffer_groups_;
 };
 
 /*!
@@ -723,9 +767,9 @@ void BuildDependencyGraph(
 
 class PipelineInjector : private StmtExprMutator {
  public:
-  static Stmt Inject(const PrimFunc& func) {
+  static Stmt Inject(const PrimFunc& func, bool async_buffer_groups) {
     auto global_symbol = func->GetAttr<String>(tvm::attr::kGlobalSymbol);
-    PipelineInjector injector(global_symbol);
+    PipelineInjector injector(global_symbol, async_buffer_groups);
     for (const auto& kv : func->buffer_map) {
       const Buffer& buffer = kv.second;
       injector.buffer_data_to_buffer_.Set(buffer->data, buffer);
@@ -734,7 +778,8 @@ class PipelineInjector : private StmtExprMutator {
   }
 
  private:
-  explicit PipelineInjector(Optional<String> global_symbol) : global_symbol_(global_symbol) {}
+  PipelineInjector(Optional<String> global_symbol, bool async_buffer_groups)
+      : global_symbol_(global_symbol), async_buffer_groups_(async_buffer_groups) {}
 
   /*!
    * \brief Check the pipeline satisfies the following conditions:
@@ -854,12 +899,19 @@ class PipelineInjector : private StmtExprMutator {
       }
     }
 
+    std::unordered_set<int> register_staged;
+    if (auto annot = op->annotations.Get(attr::kPipelineRegisterStaged)) {
+      for (auto i : Downcast<Array<Integer>>(annot)) {
+        register_staged.insert(i->value);
+      }
+    }
+
     for (size_t i = 0; i < pipeline_stages.size(); i++) {
       int stage = static_cast<int>(pipeline_stages[i]->value);
       bool is_async = pipeline_async_stages.find(stage) != pipeline_async_stages.end();
       PipelineAnnotation stage_order{stage,
                                      /*order=*/static_cast<int>(pipeline_orders[i]->value),
-                                     is_async};
+                                     is_async, register_staged.count(i) > 0};
       pipeline_info.emplace(original_order[i], stage_order);
     }
 
@@ -867,7 +919,8 @@ class PipelineInjector : private StmtExprMutator {
 
     // Step 4: Rewrite the pipeline body.
     Stmt pipeline =
-        PipelineRewriter(buffer_data_to_buffer_, pipeline_allocs, GetRef<For>(op), pipeline_info)
+        PipelineRewriter(buffer_data_to_buffer_, pipeline_allocs, GetRef<For>(op), pipeline_info,
+                         async_buffer_groups_)
             .BuildPipeline();
 
     if (const auto* realize = op->body.as<BlockRealizeNode>()) {
@@ -911,6 +964,7 @@ class PipelineInjector : private StmtExprMutator {
 
   Map<Var, Buffer> buffer_data_to_buffer_;
   Optional<String> global_symbol_;
+  bool async_buffer_groups_;
 };
 
 /*!
@@ -920,12 +974,15 @@ class PipelineInjector : private StmtExprMutator {
 tir::transform::Pass InjectSoftwarePipeline() {
   using namespace tir::transform;
   auto pass_func = [=](PrimFunc f, IRModule m, PassContext ctx) {
+    bool async_buffer_groups =
+        !ctx->GetConfig<Bool>("tl.disable_async_buffer_groups", Bool(false)).value();
     auto* fptr = f.CopyOnWrite();
-    fptr->body = PipelineInjector::Inject(f);
+    fptr->body = PipelineInjector::Inject(f, async_buffer_groups);
     fptr->body = ConvertSSA(std::move(fptr->body));
     return f;
   };
-  return CreatePrimFuncPass(pass_func, 0, "tl.InjectSoftwarePipeline", {});
+  return CreatePrimFuncPass(pass_func, 0, "tl.InjectSoftwarePipeline", {},
+                            /*function_local=*/true);
 }
 
 TVM_REGISTER_GLOBAL("tl.InjectSoftwarePipeline").set_body_typed(InjectSoftwarePipeline);
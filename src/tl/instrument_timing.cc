@@ -0,0 +1,114 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file instrument_timing.cc
+ * \brief Time the pipeline stages and the tile ops of the kernels into a device ring buffer
+ */
+
+#include <tvm/tir/builtin.h>
+#include <tvm/tir/op.h>
+#include <tvm/tir/stmt_functor.h>
+#include <tvm/tir/transform.h>
+
+#include "op.h"
+
+namespace tvm {
+namespace tl {
+
+using namespace tir;
+
+// the stages of the pipelined loops and the tile ops are bracketed by timers (default false)
+TVM_REGISTER_PASS_CONFIG_OPTION("tl.instrument_timing", Bool);
+// the number of records of the ring buffer of the timers (default 65536)
+TVM_REGISTER_PASS_CONFIG_OPTION("tl.timer_capacity", Integer);
+
+Stmt MakeTimerScope(const Stmt& stmt, const std::string& name) {
+  auto ctxt = transform::PassContext::Current();
+  if (!ctxt->GetConfig<Bool>("tl.instrument_timing", Bool(false)).value()) return stmt;
+  if (auto seq = stmt.as<SeqStmtNode>()) {
+    // keep the statements at the same level for the pipeline planning
+    return SeqStmt(seq->seq.Map([&](const Stmt& s) { return MakeTimerScope(s, name); }));
+  }
+  return AttrStmt(StringImm(name), attr::kTimer, 0, stmt);
+}
+
+/*!
+ * \brief Replace the body of the timer scopes with the reads of %globaltimer and clock64 before the
+ * body, and the record of the elapsed time after it by lane 0 of each warp (tl::timer_record). The
+ * timers are numbered in the order of their first scope, the value of the kept kTimer AttrStmt.
+ */
+class TimerInstrumenter : public StmtMutator {
+ public:
+  TimerInstrumenter(Var trace, int capacity) : trace_(trace), capacity_(capacity) {}
+
+  int num_timers() const { return static_cast<int>(tags_.size()); }
+
+ private:
+  Stmt VisitStmt_(const AttrStmtNode* op) final {
+    if (op->attr_key != attr::kTimer) return StmtMutator::VisitStmt_(op);
+    Stmt body = VisitStmt(op->body);
+    std::string name = Downcast<StringImm>(op->node)->value;
+    auto it = tags_.emplace(name, static_cast<int>(tags_.size())).first;
+    Var start_ns("timer_ns", DataType::UInt(64));
+    Var start_cycles("timer_cycles", DataType::Int(64));
+    Stmt record = Evaluate(Call(DataType::Handle(), builtin::call_extern(),
+                                {StringImm("tl::timer_record"), trace_, capacity_, it->second,
+                                 start_ns, start_cycles}));
+    body = SeqStmt({body, record});
+    body = LetStmt(start_cycles,
+                   Call(DataType::Int(64), builtin::call_extern(), {StringImm("clock64")}), body);
+    body = LetStmt(start_ns,
+                   Call(DataType::UInt(64), builtin::call_extern(), {StringImm("tl::timer_ns")}),
+                   body);
+    return AttrStmt(op->node, attr::kTimer, it->second, body);
+  }
+
+  Var trace_;
+  int capacity_;
+  std::unordered_map<std::string, int> tags_;
+};
+
+using namespace tir::transform;
+
+tvm::transform::Pass InstrumentTiming() {
+  auto pass_func = [=](PrimFunc f, IRModule m, PassContext ctx) {
+    int64_t capacity = ctx->GetConfig<Integer>("tl.timer_capacity", Integer(65536)).value()->value;
+    ICHECK_GT(capacity, 0) << "tl.timer_capacity must be positive";
+    // the ring buffer is the last argument of the function, a header record holding the number of
+    // records written followed by the records of 4 int64 values
+    Buffer trace = decl_buffer({make_const(DataType::Int(32), (capacity + 1) * 4)},
+                               DataType::Int(64), "tl_trace");
+    TimerInstrumenter instrumenter(trace->data, static_cast<int>(capacity));
+    Stmt body = instrumenter(f->body);
+    if (instrumenter.num_timers() == 0) return f;
+    PrimFuncNode* fptr = f.CopyOnWrite();
+    fptr->body = body;
+    Var param("tl_trace", DataType::Handle());
+    fptr->params.push_back(param);
+    fptr->buffer_map.Set(param, trace);
+    return f;
+  };
+  return CreatePrimFuncPass(pass_func, 0, "tl.InstrumentTiming", {});
+}
+
+TVM_REGISTER_GLOBAL("tl.InstrumentTiming").set_body_typed(InstrumentTiming);
+
+}  // namespace tl
+}  // namespace tvm
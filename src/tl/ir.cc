@@ -54,7 +54,7 @@ ForFrame ParallelFor(Array<PrimExpr> extents) {
   return ForFrame(n);
 }
 
-ForFrame PipelinedFor(PrimExpr start, PrimExpr stop, int num_stages) {
+ForFrame PipelinedFor(PrimExpr start, PrimExpr stop, int num_stages, String mode) {
   using namespace tvm::tir;
   ObjectPtr<ForFrameNode> n = make_object<ForFrameNode>();
   DataType dtype = stop.dtype();
@@ -65,7 +65,11 @@ ForFrame PipelinedFor(PrimExpr start, PrimExpr stop, int num_stages) {
     int n = vars.size();
     ICHECK(n == 1);
     Map<String, ObjectRef> anno;
-    if (num_stages > 0) anno.Set("num_stages", PrimExpr(num_stages));
+    // -1 is num_stages="auto" (tl::attr::kAutoNumStages), resolved by the PlanNumStages pass
+    ICHECK_GE(num_stages, -1);
+    if (num_stages != 0) anno.Set("num_stages", PrimExpr(num_stages));
+    ICHECK(mode == "default" || mode == "warp_specialized") << "Unknown pipeline mode " << mode;
+    if (mode != "default") anno.Set("pipeline_mode", mode);
     body = For(vars[0], doms[0]->min, doms[0]->extent, ForKind::kSerial, std::move(body),
                /*thread_binding=*/NullOpt, /*annotations=*/anno);
     return body;
@@ -114,12 +118,24 @@ class KernelLaunchFrame : public TIRFrame {
                                                     KernelLaunchFrameNode);
 };
 
-KernelLaunchFrame KernelLaunch(Array<PrimExpr> grid_size, PrimExpr extent) {
+KernelLaunchFrame KernelLaunch(Array<PrimExpr> grid_size, PrimExpr extent, String schedule,
+                               int min_blocks_per_sm) {
   ObjectPtr<KernelLaunchFrameNode> n = make_object<KernelLaunchFrameNode>();
   ICHECK(grid_size.size() <= 3);
+  ICHECK(schedule == "default" || schedule == "persistent" || schedule == "stream_k")
+      << "Unknown kernel schedule " << schedule;
+  // tl::attr::kKernelSchedule, lowered by the PersistentKernel pass
+  if (schedule != "default") {
+    n->frames.push_back(Attr(ObjectRef(), "kernel_schedule", StringImm(schedule)));
+  }
   if (grid_size.size() > 0) n->frames.push_back(LaunchThread("blockIdx.x", grid_size[0]));
   if (grid_size.size() > 1) n->frames.push_back(LaunchThread("blockIdx.y", grid_size[1]));
   if (grid_size.size() > 2) n->frames.push_back(LaunchThread("blockIdx.z", grid_size[2]));
+  ICHECK_GE(min_blocks_per_sm, 0);
+  // tl::attr::kMinBlocksPerSM, inside the kernel so that it stays with the device function
+  if (min_blocks_per_sm > 0) {
+    n->frames.push_back(Attr(ObjectRef(), "min_blocks_per_sm", Integer(min_blocks_per_sm)));
+  }
   n->frames.push_back(LaunchThread("threadIdx.x", extent));
   n->frames.push_back(Block(""));
   return KernelLaunchFrame(n);
@@ -26,9 +26,16 @@
 #include "layout.h"
 
 #include <tvm/arith/pattern.h>
+#include <tvm/node/structural_hash.h>
 #include <tvm/tir/op.h>
 #include <tvm/tir/stmt_functor.h>
 
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
 #include "../arith/pattern_match.h"
 #include "arith.h"
 #include "helper.h"
@@ -178,6 +185,11 @@ Fragment FragmentNode::DeReplicate() const {
 }
 
 Layout LayoutNode::Inverse() const {
+  std::call_once(inverse_once_, [this]() { inverse_ = ComputeInverse(); });
+  return Downcast<Layout>(inverse_);
+}
+
+Layout LayoutNode::ComputeInverse() const {
   Map<Var, Range> input_iters;
   arith::Analyzer analyzer;
   for (auto iv : forward_var_) {
@@ -211,6 +223,11 @@ Layout LayoutNode::Inverse() const {
 }
 
 int LayoutNode::VectorSize() const {
+  std::call_once(vector_size_once_, [this]() { vector_size_ = ComputeVectorSize(); });
+  return vector_size_;
+}
+
+int LayoutNode::ComputeVectorSize() const {
   auto last_dim = OutputShape().back().as<IntImm>();
   if (!last_dim.defined()) return 1;
   int vector_size = 2;
@@ -293,12 +310,14 @@ void FragmentNode::UpdateAnalyzer(arith::Analyzer* analyzer) const {
 }
 
 PrimExpr FragmentNode::ThreadExtent() const {
-  Array<PrimExpr> ret(OutputDim(), 1);
-  arith::Analyzer analyzer;
-  UpdateAnalyzer(&analyzer);
-  auto ist = analyzer.int_set(forward_thread_ + 1);
-  CHECK(is_one(ist.min()));
-  return ist.max();
+  std::call_once(thread_extent_once_, [this]() {
+    arith::Analyzer analyzer;
+    UpdateAnalyzer(&analyzer);
+    auto ist = analyzer.int_set(forward_thread_ + 1);
+    CHECK(is_one(ist.min()));
+    thread_extent_ = ist.max();
+  });
+  return thread_extent_;
 }
 
 PrimExpr FragmentNode::ForwardThread(const Array<PrimExpr>& vars,
@@ -315,7 +334,7 @@ PrimExpr FragmentNode::ForwardThread(const Array<PrimExpr>& vars,
   return Substitute(forward_thread_, vmap);
 }
 
-Layout FragmentNode::Inverse() const {
+Layout FragmentNode::ComputeInverse() const {
   auto new_fwd_vars = forward_var_;
   new_fwd_vars.push_back(thread_replicate_);
   auto new_fwd_index = forward_index_;
@@ -350,7 +369,49 @@ void FragmentNode::DebugOutput() const {
   LOG_DEBUG << "Fragment Index: " << forward_thread_;
 }
 
+// The hash of the fields of a layout. The free variables are mapped by their first occurrence, so
+// that the fresh input variables given first are mapped by their position, as SEqualReduce maps
+// them by substituting the same variables into both layouts.
+static size_t HashLayoutFields(const Array<ObjectRef>& fields) {
+  return SHashHandlerDefault().Hash(fields, /*map_free_vars=*/true);
+}
+
+size_t LayoutNode::StructuralHashValue() const {
+  std::call_once(hash_once_, [this]() { hash_ = ComputeStructuralHash(); });
+  return hash_;
+}
+
+size_t LayoutNode::ComputeStructuralHash() const {
+  Array<PrimExpr> vars;
+  for (size_t i = 0; i < this->InputDim(); i++) vars.push_back(Var());
+  return HashLayoutFields({vars, this->InputShape(), this->Forward(vars)});
+}
+
+size_t FragmentNode::ComputeStructuralHash() const {
+  Array<PrimExpr> vars;
+  Var rep_var{};
+  for (size_t i = 0; i < this->InputDim(); i++) vars.push_back(Var());
+  return HashLayoutFields({vars, rep_var, this->ReplicateExtent(), this->InputShape(),
+                           this->Forward(vars), this->ForwardThread(vars, rep_var)});
+}
+
+size_t FragmentNode::ThreadHashValue() const {
+  std::call_once(thread_hash_once_, [this]() {
+    Array<PrimExpr> vars;
+    Var rep_var{};
+    for (size_t i = 0; i < this->InputDim(); i++) vars.push_back(Var());
+    thread_hash_ = HashLayoutFields(
+        {vars, rep_var, this->ReplicateExtent(), this->ForwardThread(vars, rep_var)});
+  });
+  return thread_hash_;
+}
+
+void LayoutNode::SHashReduce(SHashReducer hash_reduce) const {
+  hash_reduce(static_cast<uint64_t>(this->StructuralHashValue()));
+}
+
 bool LayoutNode::SEqualReduce(const LayoutNode* other, SEqualReducer equal) const {
+  if (this->StructuralHashValue() != other->StructuralHashValue()) return false;
   Array<PrimExpr> vars;
   for (size_t i = 0; i < this->InputDim(); i++) vars.push_back(Var());
   return this->InputDim() == other->InputDim() && equal(this->InputShape(), other->InputShape()) &&
@@ -358,6 +419,7 @@ bool LayoutNode::SEqualReduce(const LayoutNode* other, SEqualReducer equal) cons
 }
 
 bool FragmentNode::SEqualReduce(const FragmentNode* other, SEqualReducer equal) const {
+  if (this->StructuralHashValue() != other->StructuralHashValue()) return false;
   this->ReplicateExtent() == other->ReplicateExtent();
   equal(this->ThreadExtent(), other->ThreadExtent());
   Array<PrimExpr> vars;
@@ -372,7 +434,9 @@ bool FragmentNode::SEqualReduce(const FragmentNode* other, SEqualReducer equal)
 }
 
 bool FragmentThreadEqual(const Fragment& a, const Fragment& b) {
+  if (a.same_as(b)) return true;
   if (a->InputDim() != b->InputDim()) return false;
+  if (a->ThreadHashValue() != b->ThreadHashValue()) return false;
   if (!StructuralEqual()(a->ReplicateExtent(), b->ReplicateExtent())) return false;
   Var rep = Var();
   Array<PrimExpr> vars;
@@ -411,8 +475,8 @@ Fragment makeGemmFragmentC_F64(const int block_m, const int block_n, const int w
   return block_layout;
 }
 
-Fragment makeGemmFragmentC(const int block_m, const int block_n, const int warp_m, const int warp_n,
-                           const int element_size) {
+static Fragment makeGemmFragmentCUncached(const int block_m, const int block_n, const int warp_m,
+                                          const int warp_n, const int element_size) {
   if (element_size == 64) return makeGemmFragmentC_F64(block_m, block_n, warp_m, warp_n);
   ICHECK(block_m % warp_m == 0);
   ICHECK(block_n % warp_n == 0);
@@ -424,8 +488,28 @@ Fragment makeGemmFragmentC(const int block_m, const int block_n, const int warp_
   return block_layout;
 }
 
-Fragment makeGemmFragmentA(const int block_m, const int block_n, const int block_k,
-                           const int warp_m, const int warp_n) {
+static Fragment makeGemmFragmentCHopperUncached(const int block_m, const int block_n,
+                                                const int warp_m, const int warp_n,
+                                                const int element_size) {
+  ICHECK(block_m % warp_m == 0);
+  ICHECK(block_n % warp_n == 0);
+  ICHECK(warp_m % 16 == 0);
+  ICHECK(warp_n % 8 == 0);
+  ICHECK((block_m / warp_m) % 4 == 0) << "wgmma requires 4 warps along M in a warpgroup";
+  // the N extent of a single wgmma atom, which should be aligned with the selector in gemm_sm90.h
+  int atom_n = 256;
+  while (warp_n % atom_n != 0) atom_n -= 8;
+  auto base_layout = makeGemmFragment8x8()->Repeat({2, 1}, false);
+  // 4 warps of a warpgroup are stacked along M, the atom holds atom_n / 8 tiles in registers
+  auto warpgroup_layout =
+      base_layout->Repeat({4, 1}, true, false)->Repeat({1, atom_n / 8}, false, false);
+  auto block_layout =
+      warpgroup_layout->Repeat({block_m / warp_m / 4, block_n / warp_n}, true, false);
+  return block_layout->Repeat({warp_m / 16, warp_n / atom_n}, false, false);
+}
+
+static Fragment makeGemmFragmentAUncached(const int block_m, const int block_n, const int block_k,
+                                          const int warp_m, const int warp_n) {
   // assume not transposed
   ICHECK(block_m % warp_m == 0);
   ICHECK(block_n % warp_n == 0);
@@ -437,8 +521,8 @@ Fragment makeGemmFragmentA(const int block_m, const int block_n, const int block
   return block_layout;
 }
 
-Fragment makeGemmFragmentB(const int block_m, const int block_n, const int block_k,
-                           const int warp_m, const int warp_n) {
+static Fragment makeGemmFragmentBUncached(const int block_m, const int block_n, const int block_k,
+                                          const int warp_m, const int warp_n) {
   // transposed
   ICHECK(warp_n % 8 == 0);
   ICHECK(block_k % 16 == 0);
@@ -448,6 +532,38 @@ Fragment makeGemmFragmentB(const int block_m, const int block_n, const int block
   return block_layout;
 }
 
+// The 16x16 accumulators of v_mfma_f32_16x16x16 on a wavefront of 64 lanes: lane l holds the 4
+// rows 4 * (l / 16) + r of the column l % 16
+static Fragment makeGemmFragmentCCDNAUncached(const int block_m, const int block_n,
+                                              const int warp_m, const int warp_n) {
+  ICHECK(block_m % warp_m == 0);
+  ICHECK(block_n % warp_n == 0);
+  ICHECK(warp_m % 16 == 0);
+  ICHECK(warp_n % 16 == 0);
+  IterVar i = make_itervar("i", 16);
+  IterVar j = make_itervar("j", 16);
+  IterVar rep = make_itervar("rep", 1);
+  auto base_layout = Fragment({i, j}, {FloorMod(i, 4)}, j + 16 * FloorDiv(i, 4), rep);
+  auto warp_layout = base_layout->Repeat({block_m / warp_m, block_n / warp_n}, true, false);
+  return warp_layout->Repeat({warp_m / 16, warp_n / 16}, false, false);
+}
+
+// The A operand of v_mfma_f32_16x16x16 in registers: lane l holds A[l % 16, 4 * (l / 16) + r]
+static Fragment makeGemmFragmentACDNAUncached(const int block_m, const int block_n,
+                                              const int block_k, const int warp_m,
+                                              const int warp_n) {
+  ICHECK(block_m % warp_m == 0);
+  ICHECK(block_n % warp_n == 0);
+  ICHECK(warp_m % 16 == 0);
+  ICHECK(block_k % 16 == 0);
+  IterVar i = make_itervar("i", 16);
+  IterVar k = make_itervar("k", 16);
+  IterVar rep = make_itervar("rep", 1);
+  auto base_layout = Fragment({i, k}, {FloorMod(k, 4)}, i + 16 * FloorDiv(k, 4), rep);
+  auto warp_layout = base_layout->Repeat({block_m / warp_m, 1}, true)->Replicate(block_n / warp_n);
+  return warp_layout->Repeat({warp_m / 16, block_k / 16}, false, false);
+}
+
 Fragment makeGemmFragment32x32(int element_size) {
   IterVar i = make_itervar("i", 32);
   IterVar j = make_itervar("j", 32);
@@ -469,8 +585,9 @@ Fragment makeGemmFragment32x32(int element_size) {
   }
 }
 
-Fragment makeGemmVoltaFragmentC(const int block_m, const int block_n, const int warp_m,
-                                const int warp_n, int element_size) {
+static Fragment makeGemmVoltaFragmentCUncached(const int block_m, const int block_n,
+                                               const int warp_m, const int warp_n,
+                                               int element_size) {
   ICHECK(block_m % warp_m == 0);
   ICHECK(block_n % warp_n == 0);
   ICHECK(warp_m % 32 == 0);
@@ -481,8 +598,9 @@ Fragment makeGemmVoltaFragmentC(const int block_m, const int block_n, const int
   return block_layout;
 }
 
-Fragment makeGemmVoltaFragmentA(const int block_m, const int block_n, const int block_k,
-                                const int warp_m, const int warp_n) {
+static Fragment makeGemmVoltaFragmentAUncached(const int block_m, const int block_n,
+                                               const int block_k, const int warp_m,
+                                               const int warp_n) {
   // assume not transposed
   ICHECK(block_m % warp_m == 0);
   ICHECK(block_n % warp_n == 0);
@@ -518,6 +636,49 @@ PrimExpr xor8x8(const PrimExpr& i, const PrimExpr j) {
   return 2 * xor4x4(i1, j1) + xor2x2(i0, j0);
 }
 
+int ScanThreadsPerRow(int extent, int num_threads) {
+  int lanes = 1;
+  while (lanes * 2 <= 32 && num_threads % (lanes * 2) == 0 && extent % (lanes * 2) == 0) {
+    lanes *= 2;
+  }
+  return lanes;
+}
+
+Fragment makeScanFragment(const Array<PrimExpr>& shape, int dim, int num_threads) {
+  auto extent = as_const_int(shape[dim]);
+  ICHECK(extent) << "The scanned dim requires a static extent, got " << shape;
+  int lanes = ScanThreadsPerRow(*extent, num_threads);
+  int local = *extent / lanes;
+  int row_groups = num_threads / lanes;
+  Array<IterVar> vars;
+  PrimExpr row = 0;
+  int64_t num_rows = 1;
+  for (size_t i = 0; i < shape.size(); i++) {
+    vars.push_back(make_itervar("i" + std::to_string(i), shape[i]));
+    if (static_cast<int>(i) == dim) continue;
+    auto row_extent = as_const_int(shape[i]);
+    ICHECK(row_extent) << "Scan requires a static shape, got " << shape;
+    row = row * static_cast<int>(*row_extent) + vars[i]->var;
+    num_rows *= *row_extent;
+  }
+  PrimExpr col = vars[dim]->var;
+  // a row is scanned by lanes consecutive threads holding local consecutive elements each, the
+  // rows are distributed round-robin on the groups of threads and replicated if there are fewer
+  if (num_rows >= row_groups) {
+    ICHECK(num_rows % row_groups == 0)
+        << "Scan of " << num_rows << " rows requires a multiple of " << row_groups << " rows";
+    IterVar rep = make_itervar("rep", 1);
+    PrimExpr thd = FloorMod(row, row_groups) * lanes + FloorDiv(col, local);
+    PrimExpr idx = FloorDiv(row, row_groups) * local + FloorMod(col, local);
+    return Fragment(vars, {idx}, thd, rep);
+  }
+  ICHECK(row_groups % num_rows == 0)
+      << "Scan of " << num_rows << " rows requires a divisor of " << row_groups << " rows";
+  IterVar rep = make_itervar("rep", static_cast<int>(row_groups / num_rows));
+  PrimExpr thd = (row + rep->var * static_cast<int>(num_rows)) * lanes + FloorDiv(col, local);
+  return Fragment(vars, {FloorMod(col, local)}, thd, rep);
+}
+
 Layout makeGemmABLayoutHalfBank(int stride, int continuous, int element_size) {
   // Swizzle 2 bit
   IterVar i = make_itervar("i", stride);
@@ -553,14 +714,17 @@ Layout makeGemmABLayoutFullBank(int stride, int continuous, int element_size) {
 }
 
 Layout makeGemmABLayoutF64_Kinner(int stride, int continuous) {
-  // Swizzle<2, 0, 4>
+  // Swizzle<2, 2, 2>: the 64-bit loads of the m8n8k4 operands by a half warp read 4 rows and 4
+  // consecutive k of each row, the groups of 4 k are permuted by the row so that the 16 loads
+  // cover the 16 bank pairs. The groups stay contiguous for the 128-bit copies from the global
+  // memory.
   IterVar i = make_itervar("i", stride);
   IterVar j = make_itervar("j", continuous);
   PrimExpr tc = FloorDiv(j, 16);
   PrimExpr ts = FloorDiv(i, 4);
   PrimExpr c = FloorMod(j, 16);
   PrimExpr s = FloorMod(i, 4);
-  PrimExpr swizzled_c = FloorDiv(c, 4) * 4 + xor4x4(FloorMod(c, 4), s);
+  PrimExpr swizzled_c = FloorMod(c, 4) + xor4x4(FloorDiv(c, 4), s) * 4;
   PrimExpr index = swizzled_c + s * 16;
   return Layout({i, j}, {tc, ts, index});
 }
@@ -658,7 +822,8 @@ Layout makeGemmVoltaABLayout(int stride, int continuous, bool is_a, int kfactor)
   return makeGemmABLayoutPadded(stride, continuous, 16);
 }
 
-Layout makeGemmABLayout(int stride, int continuous, int element_size, int kfactor) {
+static Layout makeGemmABLayoutUncached(int stride, int continuous, int element_size,
+                                       int kfactor) {
   if (element_size == 64) {
     if (kfactor == 1 && continuous % 16 == 0)  // float64 KxN
       return makeGemmABLayoutF64_Kouter(stride, continuous);
@@ -678,6 +843,99 @@ Layout makeGemmABLayout(int stride, int continuous, int element_size, int kfacto
   }
 }
 
+// The layouts of the gemm operands and accumulators are memoized by their arguments: the ops using
+// the same layout share one node, with its inverse, vector size and thread extent computed once,
+// and compare equal by address.
+template <typename T>
+static T MemoizeLayout(const std::string& key, const std::function<T()>& make) {
+  static std::mutex mutex;
+  // never freed, the layouts may be used by the static destructors of the other modules
+  static auto* cache = new std::unordered_map<std::string, ObjectRef>();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = cache->find(key);
+    if (it != cache->end()) return Downcast<T>(it->second);
+  }
+  T layout = make();
+  std::lock_guard<std::mutex> lock(mutex);
+  return Downcast<T>(cache->emplace(key, layout).first->second);
+}
+
+template <typename... Args>
+static std::string LayoutKey(const char* name, Args... args) {
+  std::ostringstream os;
+  os << name;
+  ((os << ',' << args), ...);
+  return os.str();
+}
+
+Fragment makeGemmFragmentC(const int block_m, const int block_n, const int warp_m, const int warp_n,
+                           const int element_size) {
+  return MemoizeLayout<Fragment>(
+      LayoutKey("C", block_m, block_n, warp_m, warp_n, element_size),
+      [&]() { return makeGemmFragmentCUncached(block_m, block_n, warp_m, warp_n, element_size); });
+}
+
+Fragment makeGemmFragmentCHopper(const int block_m, const int block_n, const int warp_m,
+                                 const int warp_n, const int element_size) {
+  return MemoizeLayout<Fragment>(LayoutKey("CHopper", block_m, block_n, warp_m, warp_n,
+                                           element_size),
+                                 [&]() {
+                                   return makeGemmFragmentCHopperUncached(block_m, block_n, warp_m,
+                                                                          warp_n, element_size);
+                                 });
+}
+
+Fragment makeGemmFragmentA(const int block_m, const int block_n, const int block_k,
+                           const int warp_m, const int warp_n) {
+  return MemoizeLayout<Fragment>(
+      LayoutKey("A", block_m, block_n, block_k, warp_m, warp_n),
+      [&]() { return makeGemmFragmentAUncached(block_m, block_n, block_k, warp_m, warp_n); });
+}
+
+Fragment makeGemmFragmentB(const int block_m, const int block_n, const int block_k,
+                           const int warp_m, const int warp_n) {
+  return MemoizeLayout<Fragment>(
+      LayoutKey("B", block_m, block_n, block_k, warp_m, warp_n),
+      [&]() { return makeGemmFragmentBUncached(block_m, block_n, block_k, warp_m, warp_n); });
+}
+
+Fragment makeGemmFragmentCCDNA(const int block_m, const int block_n, const int warp_m,
+                               const int warp_n) {
+  return MemoizeLayout<Fragment>(
+      LayoutKey("CCDNA", block_m, block_n, warp_m, warp_n),
+      [&]() { return makeGemmFragmentCCDNAUncached(block_m, block_n, warp_m, warp_n); });
+}
+
+Fragment makeGemmFragmentACDNA(const int block_m, const int block_n, const int block_k,
+                               const int warp_m, const int warp_n) {
+  return MemoizeLayout<Fragment>(
+      LayoutKey("ACDNA", block_m, block_n, block_k, warp_m, warp_n),
+      [&]() { return makeGemmFragmentACDNAUncached(block_m, block_n, block_k, warp_m, warp_n); });
+}
+
+Layout makeGemmABLayout(int stride, int continuous, int element_size, int kfactor) {
+  return MemoizeLayout<Layout>(
+      LayoutKey("AB", stride, continuous, element_size, kfactor),
+      [&]() { return makeGemmABLayoutUncached(stride, continuous, element_size, kfactor); });
+}
+
+Fragment makeGemmVoltaFragmentC(const int block_m, const int block_n, const int warp_m,
+                                const int warp_n, int element_size) {
+  return MemoizeLayout<Fragment>(
+      LayoutKey("VoltaC", block_m, block_n, warp_m, warp_n, element_size), [&]() {
+        return makeGemmVoltaFragmentCUncached(block_m, block_n, warp_m, warp_n, element_size);
+      });
+}
+
+Fragment makeGemmVoltaFragmentA(const int block_m, const int block_n, const int block_k,
+                                const int warp_m, const int warp_n) {
+  return MemoizeLayout<Fragment>(
+      LayoutKey("VoltaA", block_m, block_n, block_k, warp_m, warp_n), [&]() {
+        return makeGemmVoltaFragmentAUncached(block_m, block_n, block_k, warp_m, warp_n);
+      });
+}
+
 TVM_REGISTER_NODE_TYPE(LayoutNode);
 TVM_REGISTER_NODE_TYPE(FragmentNode);
 
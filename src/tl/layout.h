@@ -28,6 +28,8 @@
 
 #include <tvm/arith/analyzer.h>
 
+#include <mutex>
+
 namespace tvm {
 namespace tl {
 
@@ -48,7 +50,8 @@ class LayoutNode : public Object {
 
   Array<PrimExpr> OutputShape() const;
 
-  virtual Layout Inverse() const;
+  // The inverse, computed on the first call: the layouts are immutable.
+  Layout Inverse() const;
 
   Array<PrimExpr> Forward(const Array<PrimExpr>& vars) const;
 
@@ -60,14 +63,30 @@ class LayoutNode : public Object {
 
   virtual void UpdateAnalyzer(arith::Analyzer* analyzer) const;
 
+  // The structural hash, computed on the first call: the layouts whose hashes differ are not
+  // equal, so SEqualReduce compares the expressions only when the hashes match.
+  size_t StructuralHashValue() const;
+
   void VisitAttrs(tvm::AttrVisitor* v);
   static constexpr bool _type_has_method_sequal_reduce = true;
+  static constexpr bool _type_has_method_shash_reduce = true;
   bool SEqualReduce(const LayoutNode* other, SEqualReducer equal) const;
+  void SHashReduce(SHashReducer hash_reduce) const;
   static constexpr const char* _type_key = "tl.Layout";
   TVM_DECLARE_BASE_OBJECT_INFO(LayoutNode, Object);
 
   Array<PrimExpr> forward_index_;
   Array<IterVar> forward_var_;
+
+ protected:
+  virtual Layout ComputeInverse() const;
+  int ComputeVectorSize() const;
+  virtual size_t ComputeStructuralHash() const;
+
+  mutable std::once_flag inverse_once_, vector_size_once_, hash_once_;
+  mutable ObjectRef inverse_;
+  mutable int vector_size_ = 0;
+  mutable size_t hash_ = 0;
 };
 
 /*!
@@ -84,8 +103,6 @@ class FragmentNode : public LayoutNode {
  public:
   FragmentNode() = default;
 
-  Layout Inverse() const final;
-
   void UpdateAnalyzer(arith::Analyzer* analyzer) const final;
 
   PrimExpr ThreadExtent() const;
@@ -103,6 +120,9 @@ class FragmentNode : public LayoutNode {
 
   Fragment CondenseReplicateVar() const;
 
+  // The hash of the mapping to the threads, computed on the first call, see FragmentThreadEqual.
+  size_t ThreadHashValue() const;
+
   void DebugOutput() const final;
 
   void VisitAttrs(tvm::AttrVisitor* v);
@@ -112,6 +132,14 @@ class FragmentNode : public LayoutNode {
 
   PrimExpr forward_thread_;
   IterVar thread_replicate_;
+
+ protected:
+  Layout ComputeInverse() const final;
+  size_t ComputeStructuralHash() const final;
+
+  mutable std::once_flag thread_extent_once_, thread_hash_once_;
+  mutable PrimExpr thread_extent_;
+  mutable size_t thread_hash_ = 0;
 };
 
 /*!
@@ -129,11 +157,24 @@ bool FragmentThreadEqual(const Fragment& a, const Fragment& b);
 
 Fragment makeGemmFragmentC(const int block_m, const int block_n, const int warp_m, const int warp_n,
                            const int element_size);
+Fragment makeGemmFragmentCHopper(const int block_m, const int block_n, const int warp_m,
+                                 const int warp_n, const int element_size);
 Fragment makeGemmFragmentA(const int block_m, const int block_n, const int block_k,
                            const int warp_m, const int warp_n);
 Fragment makeGemmFragmentB(const int block_m, const int block_n, const int block_k,
                            const int warp_m, const int warp_n);
+// The accumulators and the A operand in registers of the MFMA gemm of CDNA, see hip/gemm.h
+Fragment makeGemmFragmentCCDNA(const int block_m, const int block_n, const int warp_m,
+                               const int warp_n);
+Fragment makeGemmFragmentACDNA(const int block_m, const int block_n, const int block_k,
+                               const int warp_m, const int warp_n);
+// The blocked layout of the scans along dim: each row is held by ScanThreadsPerRow consecutive
+// threads (a power of 2 up to a warp), each thread holding a contiguous part of the row.
+int ScanThreadsPerRow(int extent, int num_threads);
+Fragment makeScanFragment(const Array<PrimExpr>& shape, int dim, int num_threads);
 Layout makeGemmABLayout(int stride, int continuous, int element_size, int kfactor);
+Layout makeGemmABLayoutFullBank(int stride, int continuous, int element_size);
+Layout makeGemmABLayoutHalfBank(int stride, int continuous, int element_size);
 
 Fragment makeGemmVoltaFragmentC(const int block_m, const int block_n, const int warp_m,
                                 const int warp_n, const int element_size);
@@ -26,6 +26,10 @@
 
 #include <tvm/tir/op.h>
 
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
 #include "arith.h"
 #include "auto_vectorize.h"
 #include "loop_partition.h"
@@ -38,10 +42,13 @@ using namespace tir;
 
 ForNodeLayoutInfer::ForNodeLayoutInfer(const ForNode* root, IterVar thread_var)
     : root_(root), thread_var_(thread_var) {
+  analyzer_.Bind(pair_var_->var, pair_var_->dom);
   VisitStmt_(root);
   // Check if the buffer indice matches full range
-  for (const auto& [buffer, indices] : indice_map_) {
-    Layout layout(loop_vars_, indices);
+  for (const auto& [buffer, _] : indice_map_) {
+    Array<IterVar> vars = loop_vars_;
+    Array<PrimExpr> indices = AccessIndices(buffer, &vars);
+    Layout layout(vars, indices);
     ICHECK(StructuralEqual()(buffer->shape, layout->OutputShape()))
         << "Parallel for over fragment does not match full region, " << buffer->shape << " "
         << layout->OutputShape();
@@ -49,6 +56,7 @@ ForNodeLayoutInfer::ForNodeLayoutInfer(const ForNode* root, IterVar thread_var)
 }
 
 bool ForNodeLayoutInfer::IsCommonAccessIndice(const Buffer& buffer) const {
+  if (pair_map_.count(buffer)) return false;
   auto common_indice = loop_vars_.Map([](const auto& iv) { return iv->var; });
   return StructuralEqual()(indice_map_[buffer], common_indice);
 }
@@ -62,29 +70,60 @@ void ForNodeLayoutInfer::VisitStmt_(const ForNode* op) {
 
 void ForNodeLayoutInfer::VisitStmt_(const BufferStoreNode* op) {
   if (op->buffer.scope() == "local.fragment") {
-    if (indice_map_.find(op->buffer) != indice_map_.end()) {
-      ICHECK(StructuralEqual()(indice_map_.at(op->buffer), op->indices))
-          << op->buffer << ": " << op->indices << " and " << indice_map_.at(op->buffer);
-    } else {
-      indice_map_.Set(op->buffer, op->indices);
-    }
+    RecordAccess(op->buffer, op->indices);
     buffer_is_write_.insert(op->buffer);
   }
   StmtExprVisitor::VisitStmt_(op);
 }
 
 void ForNodeLayoutInfer::VisitExpr_(const BufferLoadNode* op) {
-  if (op->buffer.scope() == "local.fragment") {
-    if (indice_map_.find(op->buffer) != indice_map_.end()) {
-      ICHECK(StructuralEqual()(indice_map_.at(op->buffer), op->indices))
-          << op->buffer << ": " << op->indices << " and " << indice_map_.at(op->buffer);
-    } else {
-      indice_map_.Set(op->buffer, op->indices);
-    }
-  }
+  if (op->buffer.scope() == "local.fragment") RecordAccess(op->buffer, op->indices);
   StmtExprVisitor::VisitExpr_(op);
 }
 
+void ForNodeLayoutInfer::RecordAccess(const Buffer& buffer, const Array<PrimExpr>& indices) {
+  if (indice_map_.find(buffer) == indice_map_.end()) {
+    indice_map_.Set(buffer, indices);
+    return;
+  }
+  Array<PrimExpr> first = indice_map_.at(buffer);
+  if (StructuralEqual()(first, indices)) return;
+  // a second element per iteration, at a constant offset along a single dim
+  int dim = -1;
+  int64_t offset = 0;
+  bool paired = first.size() == indices.size();
+  for (size_t i = 0; paired && i < indices.size(); i++) {
+    PrimExpr diff = analyzer_.Simplify(indices[i] - first[i]);
+    if (is_zero(diff)) continue;
+    auto value = as_const_int(diff);
+    paired = value != nullptr && dim == -1;
+    dim = i;
+    offset = value ? *value : 0;
+  }
+  ICHECK(paired) << buffer << ": " << indices << " and " << first;
+  if (dim == -1) return;
+  auto it = pair_map_.find(buffer);
+  if (it == pair_map_.end()) {
+    // the first element of a pair is the lower one
+    if (offset < 0) indice_map_.Set(buffer, indices);
+    pair_map_[buffer] = {dim, offset < 0 ? -offset : offset};
+  } else {
+    ICHECK(it->second.first == dim && it->second.second == offset)
+        << buffer << ": " << indices << " is neither " << first << " nor its pair";
+  }
+}
+
+Array<PrimExpr> ForNodeLayoutInfer::AccessIndices(const Buffer& buffer,
+                                                  Array<IterVar>* vars) const {
+  Array<PrimExpr> indices = indice_map_[buffer];
+  auto it = pair_map_.find(buffer);
+  if (it == pair_map_.end()) return indices;
+  auto [dim, offset] = it->second;
+  vars->push_back(pair_var_);
+  indices.Set(dim, indices[dim] + pair_var_->var * static_cast<int>(offset));
+  return indices;
+}
+
 LayoutMap ForNodeLayoutInfer::Inference(const LayoutMap& layout_map, InferLevel level) {
   if (loop_layout_.defined()) return {};
   if (level == InferLevel::kStrict) return {};
@@ -134,7 +173,8 @@ LayoutMap ForNodeLayoutInfer::Inference(const LayoutMap& layout_map, InferLevel
       int vector_size = GetVectorizeSize(GetRef<For>(root_));
       auto num_thread = as_const_int(thread_var_->dom->extent);
       ICHECK(num_thread != nullptr);
-      loop_layout_ = PlanLoopPartition(root_, *num_thread, vector_size);
+      // no fragment of the loop has a layout yet, the partition only decides its memory accesses
+      loop_layout_ = PlanLoopPartitionByCost(root_, *num_thread, vector_size);
     }
     PrimExpr loop_thread_extent = loop_layout_->ThreadExtent();
     if (!analyzer_.CanProveEqual(loop_thread_extent, thread_var_->dom->extent))
@@ -155,12 +195,14 @@ Fragment ForNodeLayoutInfer::CompleteBufferFragment(const Buffer& buffer) {
   ICHECK(loop_layout_.defined());
   if (IsCommonAccessIndice(buffer)) return loop_layout_;
 
-  PrimExpr rep_b =
-      MakeFlattenedExpression(DivideUnusedIterators(indice_map_[buffer], loop_vars_, &analyzer_));
+  // the elements of a paired buffer are indexed by the loop vars and the pair selector
+  Array<IterVar> vars = loop_vars_;
+  Array<PrimExpr> indices = AccessIndices(buffer, &vars);
+  PrimExpr rep_b = MakeFlattenedExpression(DivideUnusedIterators(indices, vars, &analyzer_));
 
-  auto bijective_indice = indice_map_[buffer];
+  auto bijective_indice = indices;
   bijective_indice.push_back(rep_b);
-  Layout ind_inv = Layout(loop_vars_, bijective_indice)->Inverse();
+  Layout ind_inv = Layout(vars, bijective_indice)->Inverse();
 
   PrimExpr indice_rep_extent = ind_inv->InputShape().back();  // this is the size of rep_b
   PrimExpr loop_rep_extent = loop_layout_->ReplicateExtent();
@@ -175,12 +217,163 @@ Fragment ForNodeLayoutInfer::CompleteBufferFragment(const Buffer& buffer) {
     fwd.push_back(var);
   }
   fwd.push_back(FloorMod(rep, indice_rep_extent));
-  PrimExpr thd_b =
-      loop_layout_->ForwardThread(ind_inv->Forward(fwd), FloorDiv(rep, indice_rep_extent));
+  Array<PrimExpr> iteration = ind_inv->Forward(fwd);
+  if (vars.size() > loop_vars_.size()) iteration.pop_back();  // both elements of a pair
+  PrimExpr thd_b = loop_layout_->ForwardThread(iteration, FloorDiv(rep, indice_rep_extent));
 
   return Fragment(iter_vars, {}, thd_b, rep)->CondenseReplicateVar();
 }
 
+// Evaluates the integer index expressions of the layouts on constant loop variables, fails on the
+// other expressions.
+class IndexEvaluator : public ExprFunctor<int64_t(const PrimExpr&)> {
+ public:
+  void Bind(const Var& var, int64_t value) { env_[var.get()] = value; }
+  bool ok() const { return ok_; }
+
+ private:
+  int64_t VisitExpr_(const IntImmNode* op) final { return op->value; }
+  int64_t VisitExpr_(const VarNode* op) final {
+    auto it = env_.find(op);
+    if (it == env_.end()) return Fail();
+    return it->second;
+  }
+  int64_t VisitExpr_(const CastNode* op) final { return VisitExpr(op->value); }
+  int64_t VisitExpr_(const AddNode* op) final { return VisitExpr(op->a) + VisitExpr(op->b); }
+  int64_t VisitExpr_(const SubNode* op) final { return VisitExpr(op->a) - VisitExpr(op->b); }
+  int64_t VisitExpr_(const MulNode* op) final { return VisitExpr(op->a) * VisitExpr(op->b); }
+  int64_t VisitExpr_(const MinNode* op) final {
+    return std::min(VisitExpr(op->a), VisitExpr(op->b));
+  }
+  int64_t VisitExpr_(const MaxNode* op) final {
+    return std::max(VisitExpr(op->a), VisitExpr(op->b));
+  }
+  int64_t VisitExpr_(const FloorDivNode* op) final {
+    int64_t a = VisitExpr(op->a), b = VisitExpr(op->b);
+    if (b == 0) return Fail();
+    return a / b - ((a % b != 0) && ((a < 0) != (b < 0)));
+  }
+  int64_t VisitExpr_(const FloorModNode* op) final {
+    int64_t a = VisitExpr(op->a), b = VisitExpr(op->b);
+    if (b == 0) return Fail();
+    int64_t m = a % b;
+    return m != 0 && ((m < 0) != (b < 0)) ? m + b : m;
+  }
+  int64_t VisitExpr_(const DivNode* op) final {
+    int64_t a = VisitExpr(op->a), b = VisitExpr(op->b);
+    return b == 0 ? Fail() : a / b;
+  }
+  int64_t VisitExpr_(const ModNode* op) final {
+    int64_t a = VisitExpr(op->a), b = VisitExpr(op->b);
+    return b == 0 ? Fail() : a % b;
+  }
+  int64_t VisitExpr_(const SelectNode* op) final {
+    return VisitExpr(op->condition) ? VisitExpr(op->true_value) : VisitExpr(op->false_value);
+  }
+  int64_t VisitExpr_(const EQNode* op) final { return VisitExpr(op->a) == VisitExpr(op->b); }
+  int64_t VisitExpr_(const LTNode* op) final { return VisitExpr(op->a) < VisitExpr(op->b); }
+  int64_t VisitExpr_(const GENode* op) final { return VisitExpr(op->a) >= VisitExpr(op->b); }
+  int64_t VisitExprDefault_(const Object* op) final { return Fail(); }
+  int64_t Fail() {
+    ok_ = false;
+    return 0;
+  }
+
+  std::unordered_map<const VarNode*, int64_t> env_;
+  bool ok_ = true;
+};
+
+Array<Buffer> ForNodeLayoutInfer::GetConflictingBuffers(const LayoutMap& layout_map) {
+  Array<Buffer> conflicts;
+  if (!loop_layout_.defined()) return conflicts;
+  for (const auto& [buffer, _] : indice_map_) {
+    if (!layout_map.count(buffer)) continue;
+    auto layout = layout_map[buffer].as<Fragment>().value();
+    if (layout.same_as(loop_layout_) && IsCommonAccessIndice(buffer)) continue;
+    if (!IsThreadCompatible(buffer, layout)) conflicts.push_back(buffer);
+  }
+  return conflicts;
+}
+
+// A thread reading an element must hold a replica of it, the replicas written must all be written.
+// The thread mappings are compared symbolically without replication, and on all the iterations of
+// the loop otherwise. The loops too large to be enumerated are assumed compatible.
+bool ForNodeLayoutInfer::IsThreadCompatible(const Buffer& buffer, const Fragment& layout) {
+  auto loop_rep = as_const_int(loop_layout_->ReplicateExtent());
+  auto buffer_rep = as_const_int(layout->ReplicateExtent());
+  if (!loop_rep || !buffer_rep) return true;
+  Var rep("rep");
+  Array<PrimExpr> vars = loop_vars_.Map([](const auto& iv) -> PrimExpr { return iv->var; });
+  PrimExpr loop_thread = loop_layout_->ForwardThread(vars, rep);
+  // the threads holding the element of the iteration, and the second one of a pair
+  std::vector<PrimExpr> buffer_threads = {layout->ForwardThread(indice_map_[buffer], rep)};
+  auto pair = pair_map_.find(buffer);
+  if (pair != pair_map_.end()) {
+    auto [dim, offset] = pair->second;
+    Array<PrimExpr> second = indice_map_[buffer];
+    second.Set(dim, second[dim] + static_cast<int>(offset));
+    buffer_threads.push_back(layout->ForwardThread(second, rep));
+  }
+  if (*loop_rep == 1 && *buffer_rep == 1) {
+    Map<Var, PrimExpr> vmap = {{rep, make_zero(rep.dtype())}};
+    bool proven = true;
+    for (const PrimExpr& buffer_thread : buffer_threads) {
+      proven = proven && analyzer_.CanProveEqual(Substitute(loop_thread, vmap),
+                                                 Substitute(buffer_thread, vmap));
+    }
+    if (proven) return true;
+  }
+
+  constexpr int64_t kMaxEnumeratedAccesses = 1 << 18;
+  std::vector<int64_t> mins, extents;
+  int64_t num_points = 1;
+  for (const auto& iv : loop_vars_) {
+    auto min = as_const_int(iv->dom->min), extent = as_const_int(iv->dom->extent);
+    if (!min || !extent) return true;
+    mins.push_back(*min);
+    extents.push_back(*extent);
+    num_points *= *extent;
+  }
+  int64_t num_accesses = buffer_threads.size();
+  if (num_points * (*loop_rep + num_accesses * *buffer_rep) > kMaxEnumeratedAccesses) return true;
+
+  bool is_write = buffer_is_write_.count(buffer);
+  IndexEvaluator eval;
+  std::vector<int64_t> loop_threads, owners;
+  for (int64_t point = 0; point < num_points; point++) {
+    int64_t rest = point;
+    for (int i = static_cast<int>(loop_vars_.size()) - 1; i >= 0; i--) {
+      eval.Bind(loop_vars_[i]->var, mins[i] + rest % extents[i]);
+      rest /= extents[i];
+    }
+    loop_threads.clear();
+    // the replicas of a loop with a predicate run by the first one only
+    for (int64_t r = 0; r < (predicate_.defined() ? 1 : *loop_rep); r++) {
+      eval.Bind(rep, r);
+      loop_threads.push_back(eval(loop_thread));
+    }
+    std::sort(loop_threads.begin(), loop_threads.end());
+    for (const PrimExpr& buffer_thread : buffer_threads) {
+      owners.clear();
+      for (int64_t r = 0; r < *buffer_rep; r++) {
+        eval.Bind(rep, r);
+        owners.push_back(eval(buffer_thread));
+      }
+      if (!eval.ok()) return true;
+      std::sort(owners.begin(), owners.end());
+      for (int64_t t : loop_threads) {
+        if (!std::binary_search(owners.begin(), owners.end(), t)) return false;
+      }
+      if (is_write) {
+        for (int64_t t : owners) {
+          if (!std::binary_search(loop_threads.begin(), loop_threads.end(), t)) return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
 GemmOpLayoutInfer::GemmOpLayoutInfer(const GemmArgs& gemm_args, size_t block_size,
                                      const TargetNode* target)
     : args(gemm_args), block_size_(block_size), target_(target) {}
@@ -190,9 +383,60 @@ LayoutMap GemmOpLayoutInfer::Inference(const LayoutMap& layout_map, InferLevel l
 
   LayoutMap results;
   ICHECK(args.C.scope() == "local.fragment");
-  auto [warp_m, warp_n] = args.ComputeWarpPartition(block_size_ / 32);
+  if (args.IsFP8Gemm()) {
+    // the fp8 mma only takes K-major operands, ldmatrix can not transpose 8-bit elements
+    ICHECK(!args.trans_A && args.trans_B)
+        << "The fp8 gemm requires K-major operands, i.e. A [M, K] and B [N, K] with transpose_B";
+    ICHECK(args.A.scope() == "shared" || args.A.scope() == "shared.dyn")
+        << "The fp8 gemm requires A in shared memory";
+    ICHECK(args.C->dtype == DataType::Float(32)) << "The fp8 gemm accumulates in float32";
+    ICHECK(TargetHasFP8MMA(target_))
+        << "The fp8 gemm requires sm_89 or later, got " << target_->str();
+  }
+  if (args.E.defined()) {
+    // the metadata stays row-major, each thread reads one 32-bit word of it per mma step
+    ICHECK(TargetIsAmpereOrLater(target_))
+        << "The sparse gemm requires sm80 or later, got " << target_->str();
+    ICHECK((args.A.scope() == "shared" || args.A.scope() == "shared.dyn") &&
+           (args.B.scope() == "shared" || args.B.scope() == "shared.dyn") &&
+           (args.E.scope() == "shared" || args.E.scope() == "shared.dyn"))
+        << "The sparse gemm reads A, B and the metadata from shared memory";
+  }
+  if (TargetIsTuring(target_)) {
+    // the only float16 mma of sm75 in cute_gemm.h accumulates in float32
+    ICHECK(args.promote_every == 0 && !args.C->dtype.is_float16())
+        << "The float16 accumulation requires sm80 or later, got " << target_->str();
+  }
+  if (args.promote_every > 0) {
+    ICHECK(TargetIsAmpereOrLater(target_))
+        << "The promoted accumulation requires sm80 or later, got " << target_->str();
+    ICHECK(args.b_format.empty()) << "The quantized gemm accumulates in the dtype of C";
+  }
+  if (!args.prologue.empty()) {
+    // applied to the registers loaded by the mma of the warps, see tl::gemm_ss_prologue
+    ICHECK(TargetIsTuring(target_) || TargetIsAmpereOrLater(target_))
+        << "The gemm prologue requires sm75 or later, got " << target_->str();
+  }
+  int num_warps = block_size_ / TargetGetWarpSize(target_);
+  auto [warp_m, warp_n] = args.ComputeWarpPartition(num_warps, target_);
 
-  if (TargetIsVolta(target_)) {
+  if (args.CheckWGMMA(num_warps, target_)) {
+    auto fragment = makeGemmFragmentCHopper(args.M, args.N, args.M / warp_m, args.N / warp_n,
+                                            args.C->dtype.bits());
+    results.Set(args.C, fragment);
+    if (args.A.scope() == "shared" || args.A.scope() == "shared.dyn") {
+      results.Set(args.A,
+                  makeGemmABLayout(*as_const_int(args.A->shape[0]), *as_const_int(args.A->shape[1]),
+                                   args.A->dtype.bits(), args.trans_A ? 1 : 2));
+    } else {
+      results.Set(args.A,
+                  makeGemmFragmentA(args.M, args.N, args.K, args.M / warp_m, args.N / warp_n));
+    }
+    results.Set(args.B,
+                makeGemmABLayout(*as_const_int(args.B->shape[0]), *as_const_int(args.B->shape[1]),
+                                 args.B->dtype.bits(), args.trans_B ? 2 : 1));
+  } else if (TargetIsVolta(target_)) {
+    ICHECK(args.b_format.empty()) << "The quantized gemm requires sm75 or later";
     auto fragment = makeGemmVoltaFragmentC(args.M, args.N, args.M / warp_m, args.N / warp_n,
                                            args.C->dtype.bits());
     results.Set(args.C, fragment);
@@ -212,7 +456,7 @@ LayoutMap GemmOpLayoutInfer::Inference(const LayoutMap& layout_map, InferLevel l
     results.Set(args.B, makeGemmVoltaABLayout(*as_const_int(args.B->shape[0]),
                                               *as_const_int(args.B->shape[1]), false,
                                               args.trans_B ? 2 : 1));
-  } else if (TargetIsAmpere(target_) || TargetIsTuring(target_)) {
+  } else if (TargetIsTuring(target_) || TargetIsAmpereOrLater(target_)) {
     auto fragment =
         makeGemmFragmentC(args.M, args.N, args.M / warp_m, args.N / warp_n, args.C->dtype.bits());
     results.Set(args.C, fragment);
@@ -228,7 +472,12 @@ LayoutMap GemmOpLayoutInfer::Inference(const LayoutMap& layout_map, InferLevel l
     } else {
       ICHECK(0);
     }
-    if (args.B.scope() == "shared" || args.B.scope() == "shared.dyn") {
+    if (!args.b_format.empty()) {
+      // the packed B is read byte by byte from its row-major layout by tl::gemm_ss_dequant, a
+      // row is a contiguous K / 2 bytes
+      ICHECK(args.B.scope() == "shared" || args.B.scope() == "shared.dyn")
+          << "The quantized B should be in shared memory, got " << args.B;
+    } else if (args.B.scope() == "shared" || args.B.scope() == "shared.dyn") {
       results.Set(args.B,
                   makeGemmABLayout(*as_const_int(args.B->shape[0]), *as_const_int(args.B->shape[1]),
                                    args.B->dtype.bits(), args.trans_B ? 2 : 1));
@@ -240,6 +489,28 @@ LayoutMap GemmOpLayoutInfer::Inference(const LayoutMap& layout_map, InferLevel l
       ICHECK(0);
     }
 
+  } else if (TargetIsCDNA(target_)) {
+    ICHECK(args.b_format.empty()) << "The quantized gemm is not supported on " << target_->str();
+    ICHECK((args.A->dtype.is_float16() || args.A->dtype.is_bfloat16()) &&
+           args.A->dtype == args.B->dtype && args.C->dtype == DataType::Float(32))
+        << "The MFMA gemm takes float16 or bfloat16 operands accumulated in float32";
+    results.Set(args.C, makeGemmFragmentCCDNA(args.M, args.N, args.M / warp_m, args.N / warp_n));
+    if (args.A.scope() == "shared" || args.A.scope() == "shared.dyn") {
+      results.Set(args.A,
+                  makeGemmABLayout(*as_const_int(args.A->shape[0]), *as_const_int(args.A->shape[1]),
+                                   args.A->dtype.bits(), args.trans_A ? 1 : 2));
+    } else if (args.A.scope() == "local.fragment") {
+      ICHECK(args.trans_A == false);
+      results.Set(args.A, makeGemmFragmentACDNA(args.M, args.N, args.K, args.M / warp_m,
+                                                args.N / warp_n));
+    } else {
+      ICHECK(0);
+    }
+    ICHECK(args.B.scope() == "shared" || args.B.scope() == "shared.dyn")
+        << "The MFMA gemm requires B in shared memory, got " << args.B;
+    results.Set(args.B,
+                makeGemmABLayout(*as_const_int(args.B->shape[0]), *as_const_int(args.B->shape[1]),
+                                 args.B->dtype.bits(), args.trans_B ? 2 : 1));
   } else {
     ICHECK(0) << "Not supported " << target_->str();
   }
@@ -256,16 +527,20 @@ LayoutMap ReduceOpLayoutInfer::Inference(const LayoutMap& layout_map, InferLevel
       layout_map.count(args.src) && !layout_map.count(args.dst)) {
     auto src_layout = layout_map[args.src].as<Fragment>().value();
 
-    PrimExpr indice_rep_extent = args.src->shape[args.dim];
+    PrimExpr indice_rep_extent = 1;
+    for (int dim : args.dims) indice_rep_extent = indice_rep_extent * args.src->shape[dim];
     PrimExpr src_rep_extent = src_layout->ReplicateExtent();
     PrimExpr dest_buffer_rep_extent = indice_rep_extent * src_rep_extent;
     IterVar rep = IterVar(Range(0, dest_buffer_rep_extent), Var("rep"), IterVarType::kDataPar);
 
+    // the reduced dims are replicated, rep enumerates them from the first reduced dim
     Array<IterVar> iter_vars;
     Array<PrimExpr> fwd;
+    PrimExpr rep_rest = rep->var;
     for (size_t i = 0; i < src_layout->InputDim(); i++) {
-      if (int(i) == args.dim) {
-        fwd.push_back(FloorMod(rep, indice_rep_extent));
+      if (std::count(args.dims.begin(), args.dims.end(), int(i))) {
+        fwd.push_back(FloorMod(rep_rest, args.src->shape[i]));
+        rep_rest = FloorDiv(rep_rest, args.src->shape[i]);
       } else {
         auto var = Var("i" + std::to_string(i));
         iter_vars.push_back(
@@ -275,8 +550,68 @@ LayoutMap ReduceOpLayoutInfer::Inference(const LayoutMap& layout_map, InferLevel
     }
     auto thd = src_layout->ForwardThread(fwd, FloorDiv(rep, indice_rep_extent));
     Fragment dst_layout = Fragment(iter_vars, {}, thd, rep)->CondenseReplicateVar();
+    if (args.aux.defined() && !layout_map.count(args.aux))
+      return {{args.dst, dst_layout}, {args.aux, dst_layout}};
     return {{args.dst, dst_layout}};
   }
+  // the aux output is laid out as dst
+  if (args.aux.defined() && layout_map.count(args.dst) && !layout_map.count(args.aux))
+    return {{args.aux, layout_map[args.dst]}};
+  return {};
+}
+
+ScanOpLayoutInfer::ScanOpLayoutInfer(const ScanArgs& scan_args, size_t block_size)
+    : args(scan_args), block_size_(block_size) {}
+
+LayoutMap ScanOpLayoutInfer::Inference(const LayoutMap& layout_map, InferLevel level) {
+  // the warp scan requires the blocked layout, set it before the loops infer their own layouts
+  if (level != InferLevel::kStrict) return {};
+  ICHECK(args.src.scope() == "local.fragment" && args.dst.scope() == "local.fragment")
+      << "Scan requires fragments, got " << args.src << " and " << args.dst;
+  Fragment layout = makeScanFragment(args.src->shape, args.dim, block_size_);
+  LayoutMap results;
+  for (const auto& buffer : {args.src, args.dst}) {
+    if (layout_map.count(buffer)) {
+      ICHECK(StructuralEqual()(layout_map[buffer], layout))
+          << "Scan requires the blocked layout of " << buffer
+          << ", copy it into a fragment only used by the scan";
+    } else {
+      results.Set(buffer, layout);
+    }
+  }
+  return results;
+}
+
+OnlineSoftmaxLayoutInfer::OnlineSoftmaxLayoutInfer(const OnlineSoftmaxArgs& softmax_args,
+                                                   size_t block_size)
+    : args(softmax_args), block_size_(block_size) {}
+
+LayoutMap OnlineSoftmaxLayoutInfer::Inference(const LayoutMap& layout_map, InferLevel level) {
+  // the row statistics are laid out as the row max of the scores, replicated on the threads of
+  // a row, and the scores and the accumulator take the layouts of their gemms
+  if (level >= InferLevel::kStrict || !layout_map.count(args.scores)) return {};
+  LayoutMap results;
+  if (!layout_map.count(args.m)) {
+    results = ReduceOpLayoutInfer(args.MakeRowMax(), block_size_).Inference(layout_map, level);
+  }
+  Layout stat = results.count(args.m) ? results[args.m] : layout_map[args.m];
+  if (!layout_map.count(args.l)) results.Set(args.l, stat);
+  return results;
+}
+
+ShuffleLayoutInfer::ShuffleLayoutInfer(const ShuffleLayoutArgs& shuffle_args)
+    : args(shuffle_args) {}
+
+LayoutMap ShuffleLayoutInfer::Inference(const LayoutMap& layout_map, InferLevel level) {
+  // the shuffle takes any pair of layouts, a fragment without another use gets the layout of the
+  // other one once the other ops have set theirs, the shuffle is then a plain register copy
+  if (level != InferLevel::kFree) return {};
+  ICHECK(args.src.scope() == "local.fragment" && args.dst.scope() == "local.fragment")
+      << "The shuffle requires fragments, got " << args.src << " and " << args.dst;
+  if (layout_map.count(args.src) && !layout_map.count(args.dst))
+    return {{args.dst, layout_map[args.src]}};
+  if (layout_map.count(args.dst) && !layout_map.count(args.src))
+    return {{args.src, layout_map[args.dst]}};
   return {};
 }
 
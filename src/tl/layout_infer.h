@@ -28,6 +28,9 @@
 #include <tvm/target/target.h>
 #include <tvm/tir/stmt_functor.h>
 
+#include <unordered_map>
+#include <utility>
+
 #include "layout.h"
 #include "op.h"
 
@@ -58,13 +61,21 @@ class ForNodeLayoutInfer : public LayoutInferBase, StmtExprVisitor {
   const ForNode* GetRoot() const { return root_; }
   Map<Buffer, Array<PrimExpr>> GetIndiceMap() const { return indice_map_; }
   PrimExpr GetPredicate() const { return predicate_; }
+  // The fragments accessed by the loop whose layout in layout_map does not give each thread the
+  // elements of its iterations under the loop layout.
+  Array<Buffer> GetConflictingBuffers(const LayoutMap& layout_map);
 
  private:
   Fragment CompleteBufferFragment(const Buffer& buffer);
+  bool IsThreadCompatible(const Buffer& buffer, const Fragment& layout);
   bool IsCommonAccessIndice(const Buffer& buffer) const;
   void VisitStmt_(const ForNode* op) final;
   void VisitStmt_(const BufferStoreNode* op) final;
   void VisitExpr_(const BufferLoadNode* op) final;
+  void RecordAccess(const Buffer& buffer, const Array<PrimExpr>& indices);
+  // The indices of the elements of buffer accessed by an iteration over vars, the loop vars and
+  // the pair selector of the paired buffers.
+  Array<PrimExpr> AccessIndices(const Buffer& buffer, Array<IterVar>* vars) const;
   void AddPredicate(PrimExpr expr) {
     predicate_ = predicate_.defined() ? And(expr, predicate_) : expr;
   }
@@ -72,6 +83,11 @@ class ForNodeLayoutInfer : public LayoutInferBase, StmtExprVisitor {
   IterVar thread_var_;
 
   Map<Buffer, Array<PrimExpr>> indice_map_;
+  // The fragments accessed at two elements per iteration, the element of indice_map_ and the one
+  // at a constant offset along a dim, e.g. the pairs (j, j + dim / 2) of a rotary embedding. Both
+  // elements must be held by the thread of the iteration: {dim, offset}.
+  std::unordered_map<Buffer, std::pair<int, int64_t>, ObjectPtrHash, ObjectPtrEqual> pair_map_;
+  IterVar pair_var_{Range(0, 2), Var("pair"), IterVarType::kDataPar};
   std::unordered_set<Buffer, ObjectPtrHash, ObjectPtrEqual> buffer_is_write_;
   Array<IterVar> loop_vars_;
   Fragment loop_layout_;
@@ -101,6 +117,35 @@ class ReduceOpLayoutInfer : public LayoutInferBase {
   const size_t block_size_;
 };
 
+class ScanOpLayoutInfer : public LayoutInferBase {
+ public:
+  ScanOpLayoutInfer(const ScanArgs& scan_args, size_t block_size);
+  LayoutMap Inference(const LayoutMap& layout_map, InferLevel level) final;
+
+ private:
+  const ScanArgs args;
+  const size_t block_size_;
+};
+
+class OnlineSoftmaxLayoutInfer : public LayoutInferBase {
+ public:
+  OnlineSoftmaxLayoutInfer(const OnlineSoftmaxArgs& softmax_args, size_t block_size);
+  LayoutMap Inference(const LayoutMap& layout_map, InferLevel level) final;
+
+ private:
+  const OnlineSoftmaxArgs args;
+  const size_t block_size_;
+};
+
+class ShuffleLayoutInfer : public LayoutInferBase {
+ public:
+  explicit ShuffleLayoutInfer(const ShuffleLayoutArgs& shuffle_args);
+  LayoutMap Inference(const LayoutMap& layout_map, InferLevel level) final;
+
+ private:
+  const ShuffleLayoutArgs args;
+};
+
 }  // namespace tl
 }  // namespace tvm
 
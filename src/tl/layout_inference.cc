@@ -22,15 +22,19 @@
  * \brief infer the fragment/shared memory layout
  */
 
+#include <tvm/tir/analysis.h>
+#include <tvm/tir/builtin.h>
 #include <tvm/tir/op.h>
 #include <tvm/tir/stmt_functor.h>
 #include <tvm/tir/transform.h>
 #include <tvm/tir/utils.h>
 
+#include <array>
 #include <queue>
 
 #include "../arith/ir_mutator_with_analyzer.h"
 #include "auto_vectorize.h"
+#include "bank_conflict.h"
 #include "layout_infer.h"
 #include "loop_partition.h"
 
@@ -40,10 +44,19 @@ namespace tl {
 using namespace tir;
 using arith::IRMutatorWithAnalyzer;
 
+TVM_REGISTER_PASS_CONFIG_OPTION("tl.disable_shared_layout_planning", Bool);
+TVM_REGISTER_PASS_CONFIG_OPTION("tl.debug_bank_conflict", Bool);
+// Disable the optional shared staging buffers of the lowering: the fragment stores to the global
+// memory and the casting copies of the pipelined loops (FrontendLegalize) are lowered directly
+TVM_REGISTER_PASS_CONFIG_OPTION("tl.disable_smem_staging", Bool);
+
 struct LayoutInferenceResult {
   Map<Buffer, Layout> layout_map;
   Map<For, Fragment> for_map;
   Map<For, PrimExpr> predicate_map;
+  // the op (a parallel loop or a tile op call) requiring another layout for a fragment, if any
+  const Object* conflict_node = nullptr;
+  Buffer conflict_buffer;
 };
 
 class BufferUseDefCollector : public StmtExprVisitor {
@@ -53,19 +66,39 @@ class BufferUseDefCollector : public StmtExprVisitor {
   LayoutInferenceResult Run() {
     Map<Buffer, Layout> layout_map = annotated_layout_map_;
     int num_infer = infer_list_.size();
+    infer_buffers_.resize(num_infer);
 
     // maintain a bfs queue and infer common layout
     std::queue<int> q;
     std::vector<bool> in_queue(num_infer, true);
     for (int i = 0; i < num_infer; i++) q.push(i);
 
+    // The layouts are only added to layout_map and never changed, so the input of an op is the
+    // set of its buffers having a layout, i.e. their number. An op run again at the same level
+    // with the same number returns the same updates, which are already in layout_map: skip it.
+    std::vector<std::array<int, 3>> known_at_last_run(num_infer, {-1, -1, -1});
+    const Object* conflict_node = nullptr;
+    Buffer conflict_buffer;
+    auto count_known = [&](int infer_id) {
+      int count = 0;
+      for (const auto& buffer : infer_buffers_[infer_id]) count += layout_map.count(buffer);
+      return count;
+    };
+
     auto run_infer_step = [&](int cur_infer_id, InferLevel level, bool update_queue) {
+      int& last_known = known_at_last_run[cur_infer_id][static_cast<int>(level)];
+      if (last_known == count_known(cur_infer_id)) return;
       auto next = infer_list_[cur_infer_id];
       auto updates = next->Inference(layout_map, level);
       for (const auto& [buffer, layout] : updates) {
         if (layout_map.count(buffer)) {
-          ICHECK(StructuralEqual()(layout, layout_map[buffer]))
-              << "Get different layout for " << buffer;
+          const Layout& existing = layout_map[buffer];
+          if (layout.same_as(existing) || StructuralEqual()(layout, existing)) continue;
+          ICHECK(buffer.scope() == "local.fragment") << "Get different layout for " << buffer;
+          if (!conflict_buffer.defined()) {
+            conflict_node = infer_nodes_[cur_infer_id];
+            conflict_buffer = buffer;
+          }
         } else {
           layout_map.Set(buffer, layout);
           if (!update_queue) continue;
@@ -77,6 +110,7 @@ class BufferUseDefCollector : public StmtExprVisitor {
           }
         }
       }
+      last_known = count_known(cur_infer_id);
     };
     auto finish_infer_queue = [&]() {
       while (!q.empty()) {
@@ -95,12 +129,29 @@ class BufferUseDefCollector : public StmtExprVisitor {
     // step2, infer common layout with bfs
     finish_infer_queue();
 
-    // step 3, relax the infer constraint to free and rerun.
+    // step 3, relax the infer constraint to free and rerun, in the order of the program on the
+    // loops without a layout after the previous ones (the worklist), the other ops are skipped
+    // unless their buffers got new layouts
     for (int i = 0; i < num_infer; i++) {
+      if (auto for_infer = std::dynamic_pointer_cast<ForNodeLayoutInfer>(infer_list_[i])) {
+        if (for_infer->GetLoopLayout().defined()) continue;
+      }
       run_infer_step(i, InferLevel::kFree, true);
       finish_infer_queue();
     }
 
+    // A loop takes the layout of one of its fragments, the layouts of the others must give each
+    // thread the elements of its iterations.
+    for (int i = 0; i < num_infer && !conflict_buffer.defined(); i++) {
+      if (auto for_infer = std::dynamic_pointer_cast<ForNodeLayoutInfer>(infer_list_[i])) {
+        auto buffers = for_infer->GetConflictingBuffers(layout_map);
+        if (buffers.empty()) continue;
+        conflict_node = infer_nodes_[i];
+        conflict_buffer = buffers[0];
+      }
+    }
+    if (conflict_buffer.defined()) return {layout_map, {}, {}, conflict_node, conflict_buffer};
+
     // Check that all fragments have been inferred
     for (const auto& [buffer, _] : use_list_) {
       if (buffer.scope() == "local.fragment" && layout_map.count(buffer) == 0)
@@ -142,17 +193,34 @@ class BufferUseDefCollector : public StmtExprVisitor {
     ICHECK(thread_var_.defined());
     auto thread_block_size = as_const_int(thread_var_->dom->extent);
     ICHECK(thread_block_size);
-    if (op->op.same_as(gemm())) {
-      GemmArgs args = GemmArgs::Parse(op->args, buffer_data_to_buffer_);
+    if (op->op.same_as(gemm()) || op->op.same_as(gemm_sp())) {
+      GemmArgs args = op->op.same_as(gemm())
+                          ? GemmArgs::Parse(op->args, buffer_data_to_buffer_)
+                          : GemmArgs::ParseSparse(op->args, buffer_data_to_buffer_);
       p = std::make_shared<GemmOpLayoutInfer>(args, *thread_block_size, target_);
       access_regions.insert({args.A, args.B, args.C});
+      if (args.E.defined()) access_regions.insert(args.E);
     } else if (op->op.same_as(reduce())) {
       ReduceArgs args = ReduceArgs::Parse(op->args, buffer_data_to_buffer_);
       p = std::make_shared<ReduceOpLayoutInfer>(args, *thread_block_size);
       access_regions.insert({args.src, args.dst});
+      if (args.aux.defined()) access_regions.insert(args.aux);
+    } else if (op->op.same_as(scan())) {
+      ScanArgs args = ScanArgs::Parse(op->args, buffer_data_to_buffer_);
+      p = std::make_shared<ScanOpLayoutInfer>(args, *thread_block_size);
+      access_regions.insert({args.src, args.dst});
+    } else if (op->op.same_as(online_softmax())) {
+      OnlineSoftmaxArgs args = OnlineSoftmaxArgs::Parse(op->args, buffer_data_to_buffer_);
+      p = std::make_shared<OnlineSoftmaxLayoutInfer>(args, *thread_block_size);
+      access_regions.insert({args.scores, args.m, args.l, args.acc});
+    } else if (op->op.same_as(shuffle_layout())) {
+      ShuffleLayoutArgs args = ShuffleLayoutArgs::Parse(op->args, buffer_data_to_buffer_);
+      p = std::make_shared<ShuffleLayoutInfer>(args);
+      access_regions.insert({args.src, args.dst});
     }
     if (p) {
       infer_list_.push_back(p);
+      infer_nodes_.push_back(op);
       for (const auto& buffer : access_regions) {
         addToUseList(buffer);
       }
@@ -165,6 +233,8 @@ class BufferUseDefCollector : public StmtExprVisitor {
       use_list_[buffer] = {};
     }
     use_list_[buffer].push_back(infer_idx);
+    if (static_cast<int>(infer_buffers_.size()) <= infer_idx) infer_buffers_.resize(infer_idx + 1);
+    infer_buffers_[infer_idx].push_back(buffer);
   }
 
   void VisitStmt_(const ForNode* op) final {
@@ -172,6 +242,7 @@ class BufferUseDefCollector : public StmtExprVisitor {
       ICHECK(thread_var_.defined());
       auto infer = std::make_shared<ForNodeLayoutInfer>(op, thread_var_);
       infer_list_.push_back(infer);
+      infer_nodes_.push_back(op);
       for (const auto& [buffer, _] : infer->GetIndiceMap()) {
         addToUseList(buffer);
       }
@@ -208,22 +279,239 @@ class BufferUseDefCollector : public StmtExprVisitor {
 
   Map<Var, Buffer> buffer_data_to_buffer_;
   std::vector<std::shared_ptr<LayoutInferBase>> infer_list_;
+  std::vector<const Object*> infer_nodes_;
   std::unordered_map<Buffer, std::vector<int>, ObjectPtrHash, ObjectPtrEqual> use_list_;
+  // the buffers accessed by each op, the inverse of use_list_
+  std::vector<std::vector<Buffer>> infer_buffers_;
   IterVar thread_var_;
   const TargetNode* target_;
   LayoutMap annotated_layout_map_;
 };
 
+/*!
+ * \brief Resolve a layout conflict on a fragment: the op requiring another layout accesses a new
+ * fragment instead, which takes the layout of the op. The new fragment is copied from the original
+ * one before the op, and back after it when the op writes it, through a shared memory buffer that
+ * holds both layouts. The copies are placed around the outermost loop enclosing the op in which no
+ * other statement accesses the fragment, e.g. out of the K loop of a gemm accumulating into it.
+ */
+class LayoutConflictResolver : public StmtExprMutator {
+ public:
+  static Stmt Resolve(const Stmt& body, const Object* node, const Buffer& buffer) {
+    LayoutConflictResolver resolver(buffer);
+    resolver.Locate(body, node);
+    ICHECK(resolver.target_) << "Can not find the op of the layout conflict on " << buffer;
+    return resolver.VisitStmt(body);
+  }
+
+ private:
+  explicit LayoutConflictResolver(const Buffer& buffer) : buffer_(buffer) {
+    conv_ = decl_buffer(buffer->shape, buffer->dtype, buffer->name + "_conv", "local.fragment");
+    stage_ = decl_buffer(buffer->shape, buffer->dtype, buffer->name + "_conv_stage", "shared.dyn");
+  }
+
+  // Find the statement of the op and the loops enclosing it within the scope of the fragment.
+  class TargetLocator : public StmtVisitor {
+   public:
+    TargetLocator(const Object* node, const Buffer& buffer) : node_(node), buffer_(buffer) {}
+    const Object* target = nullptr;
+    std::vector<const ForNode*> path;
+
+   private:
+    void VisitStmt(const Stmt& stmt) final {
+      if (target) return;
+      const auto* eval = stmt.as<EvaluateNode>();
+      if (stmt.get() == node_ || (eval && eval->value.get() == node_)) {
+        target = stmt.get();
+        path.assign(loops_.begin() + alloc_depth_, loops_.end());
+        return;
+      }
+      StmtVisitor::VisitStmt(stmt);
+    }
+    void VisitStmt_(const BlockNode* op) final {
+      for (const auto& buffer : op->alloc_buffers) {
+        if (buffer.same_as(buffer_)) alloc_depth_ = loops_.size();
+      }
+      StmtVisitor::VisitStmt_(op);
+    }
+    void VisitStmt_(const ForNode* op) final {
+      loops_.push_back(op);
+      StmtVisitor::VisitStmt_(op);
+      loops_.pop_back();
+    }
+
+    const Object* node_;
+    Buffer buffer_;
+    std::vector<const ForNode*> loops_;
+    size_t alloc_depth_ = 0;
+  };
+
+  // Find the op, its accesses to the fragment and the conversion point.
+  void Locate(const Stmt& body, const Object* node) {
+    TargetLocator locator(node, buffer_);
+    locator(body);
+    target_ = locator.target;
+    if (!target_) return;
+    int mask = AccessMask(GetRef<Stmt>(static_cast<const StmtNode*>(target_)));
+    anchor_ = target_;
+    for (const ForNode* loop : locator.path) {
+      if (!AccessedOutsideTarget(GetRef<Stmt>(loop))) {
+        anchor_ = loop;
+        break;
+      }
+    }
+    copy_in_ = (mask & 1) || anchor_ != target_;
+    copy_out_ = mask & 2;
+  }
+
+  // 1 if the op reads the fragment, 2 if it writes it
+  int AccessMask(const Stmt& stmt) {
+    int mask = 0;
+    PreOrderVisit(stmt, [&](const ObjectRef& node) {
+      if (const auto* load = node.as<BufferLoadNode>()) {
+        if (load->buffer.same_as(buffer_)) mask |= 1;
+      } else if (const auto* store = node.as<BufferStoreNode>()) {
+        if (store->buffer.same_as(buffer_)) mask |= 2;
+      } else if (const auto* call = node.as<CallNode>()) {
+        if (call->op.same_as(builtin::tvm_access_ptr())) {
+          if (call->args[1].same_as(buffer_->data)) mask |= *as_const_int(call->args[4]);
+          return false;
+        }
+        if (call->op.same_as(region())) {
+          const auto* load = call->args[0].as<BufferLoadNode>();
+          if (load && load->buffer.same_as(buffer_)) mask |= *as_const_int(call->args[1]);
+          return false;
+        }
+      } else if (const auto* var = node.as<VarNode>()) {
+        // an access of unknown kind
+        if (var == buffer_->data.get()) mask |= 3;
+      }
+      return true;
+    });
+    return mask;
+  }
+
+  bool AccessedOutsideTarget(const Stmt& stmt) {
+    bool accessed = false;
+    PreOrderVisit(stmt, [&](const ObjectRef& node) {
+      if (accessed || node.get() == target_) return false;
+      if (const auto* load = node.as<BufferLoadNode>()) {
+        accessed = load->buffer.same_as(buffer_);
+      } else if (const auto* store = node.as<BufferStoreNode>()) {
+        accessed = store->buffer.same_as(buffer_);
+      } else if (node.get() == buffer_->data.get()) {
+        accessed = true;
+      }
+      return !accessed;
+    });
+    return accessed;
+  }
+
+  // dst = src with a parallel loop through the staging shared buffer, the layout of dst is not
+  // inferred from the loop writing it
+  Stmt MakeStagedCopy(const Buffer& src, const Buffer& dst) {
+    auto make_loop = [&](const Buffer& from, const Buffer& to, bool skip_layout_infer) {
+      Array<Var> vars;
+      Array<PrimExpr> indices;
+      for (size_t i = 0; i < src->shape.size(); i++) {
+        Var var("i" + std::to_string(i), src->shape[i].dtype());
+        vars.push_back(var);
+        indices.push_back(var);
+      }
+      Stmt body = BufferStore(to, BufferLoad(from, indices), indices);
+      for (int i = static_cast<int>(vars.size()) - 1; i >= 0; i--) {
+        Map<String, ObjectRef> annotations;
+        if (i == 0 && skip_layout_infer) annotations.Set(attr::kSkipLayoutInfer, PrimExpr(1));
+        body = For(vars[i], make_zero(src->shape[i].dtype()), src->shape[i], ForKind::kParallel,
+                   body, NullOpt, annotations);
+      }
+      return body;
+    };
+    return SeqStmt({make_loop(src, stage_, false), make_loop(stage_, dst, true)});
+  }
+
+  Stmt VisitStmt(const Stmt& stmt) final {
+    bool is_target = stmt.get() == target_;
+    if (is_target) in_target_ = true;
+    Stmt result = StmtExprMutator::VisitStmt(stmt);
+    if (is_target) in_target_ = false;
+    if (stmt.get() != anchor_) return result;
+    Array<Stmt> seq;
+    if (copy_in_) seq.push_back(MakeStagedCopy(buffer_, conv_));
+    seq.push_back(result);
+    if (copy_out_) seq.push_back(MakeStagedCopy(conv_, buffer_));
+    return SeqStmt(seq);
+  }
+
+  Stmt VisitStmt_(const BlockNode* op) final {
+    Block block = Downcast<Block>(StmtExprMutator::VisitStmt_(op));
+    for (const auto& buffer : op->alloc_buffers) {
+      if (!buffer.same_as(buffer_)) continue;
+      auto block_ptr = block.CopyOnWrite();
+      block_ptr->alloc_buffers.push_back(conv_);
+      block_ptr->alloc_buffers.push_back(stage_);
+    }
+    return block;
+  }
+
+  PrimExpr VisitExpr_(const VarNode* op) final {
+    if (in_target_ && op == buffer_->data.get()) return conv_->data;
+    return GetRef<PrimExpr>(op);
+  }
+
+  PrimExpr VisitExpr_(const BufferLoadNode* op) final {
+    auto load = Downcast<BufferLoad>(StmtExprMutator::VisitExpr_(op));
+    if (in_target_ && op->buffer.same_as(buffer_)) load.CopyOnWrite()->buffer = conv_;
+    return load;
+  }
+
+  Stmt VisitStmt_(const BufferStoreNode* op) final {
+    auto store = Downcast<BufferStore>(StmtExprMutator::VisitStmt_(op));
+    if (in_target_ && op->buffer.same_as(buffer_)) store.CopyOnWrite()->buffer = conv_;
+    return store;
+  }
+
+  Buffer buffer_, conv_, stage_;
+  const Object* target_ = nullptr;
+  const Object* anchor_ = nullptr;
+  bool copy_in_ = false, copy_out_ = false, in_target_ = false;
+};
+
 class LayoutInferencer : public IRMutatorWithAnalyzer {
  public:
   static PrimFunc Substitute(PrimFunc f) {
-    BufferUseDefCollector collector;
-    collector.Collect(f);
-    auto result = collector.Run();
+    // each conflict is resolved with a new fragment, and the inference is run again
+    constexpr int kMaxLayoutConflicts = 16;
+    LayoutInferenceResult result;
+    for (int num_conflicts = 0;; num_conflicts++) {
+      BufferUseDefCollector collector;
+      collector.Collect(f);
+      result = collector.Run();
+      if (!result.conflict_buffer.defined()) break;
+      ICHECK_LT(num_conflicts, kMaxLayoutConflicts)
+          << "Get different layout for " << result.conflict_buffer;
+      f.CopyOnWrite()->body = LayoutConflictResolver::Resolve(f->body, result.conflict_node,
+                                                              result.conflict_buffer);
+    }
+    auto ctxt = tvm::transform::PassContext::Current();
+    if (!ctxt->GetConfig<Bool>("tl.disable_shared_layout_planning", Bool(false)).value()) {
+      bool verbose = ctxt->GetConfig<Bool>("tl.debug_bank_conflict", Bool(false)).value();
+      auto shared_layouts =
+          PlanSharedMemoryLayout(f->body, result.for_map, result.layout_map, verbose);
+      for (const auto& [buffer, layout] : shared_layouts) result.layout_map.Set(buffer, layout);
+    }
     arith::Analyzer analyzer;
+    analyzer.EnableSimplifyCache();
+    analyzer.EnableIterMapCache();
     LayoutInferencer substituter(result, &analyzer);
+    if (!ctxt->GetConfig<Bool>("tl.disable_smem_staging", Bool(false)).value()) {
+      auto target = f->GetAttr<Target>(tvm::attr::kTarget);
+      substituter.smem_headroom_ = GetSharedMemoryHeadroom(f->body, target.value().get());
+    }
     PrimFuncNode* fptr = f.CopyOnWrite();
-    fptr->body = substituter.VisitStmt(f->body);
+    // moving the body out lets the mutator rewrite the uniquely owned nodes in place, the loops
+    // of the inference result are shared with it and are copied
+    fptr->body = substituter(std::move(fptr->body));
     return f;
   }
 
@@ -249,6 +537,8 @@ class LayoutInferencer : public IRMutatorWithAnalyzer {
             << "Cannot inference fragment layout for " << buffer;
       }
     }
+    for (const auto& buffer : workspaces_) block_ptr->alloc_buffers.push_back(buffer);
+    workspaces_.clear();
     block_ptr->annotations.Set(attr::kLayoutMap, new_layout_map);
     return block;
   }
@@ -279,6 +569,28 @@ class LayoutInferencer : public IRMutatorWithAnalyzer {
     return IRMutatorWithAnalyzer::VisitExpr_(var);
   }
 
+  PrimExpr VisitExpr_(const CallNode* op) final {
+    // A tile region on a buffer with layout is rewritten to the whole physical buffer, the tile
+    // op takes the logical shape from the layout.
+    if (op->op.same_as(region())) {
+      auto load = op->args[0].as<BufferLoadNode>();
+      ICHECK(load);
+      if (new_alloc_.count(load->buffer->data)) {
+        auto new_buffer = new_alloc_[load->buffer->data];
+        for (size_t i = 0; i < load->indices.size(); i++) {
+          ICHECK(is_zero(load->indices[i]) &&
+                 analyzer_->CanProveEqual(op->args[2 + i], load->buffer->shape[i]))
+              << "Tile region on " << load->buffer << " should cover the whole buffer";
+        }
+        Array<PrimExpr> mins(new_buffer->shape.size(), make_zero(DataType::Int(32)));
+        Array<PrimExpr> new_args = {BufferLoad(new_buffer, mins), op->args[1]};
+        for (const auto& extent : new_buffer->shape) new_args.push_back(extent);
+        return Call(op->dtype, op->op, new_args, op->span);
+      }
+    }
+    return IRMutatorWithAnalyzer::VisitExpr_(op);
+  }
+
   PrimExpr VisitExpr_(const BufferLoadNode* op) final {
     if (new_alloc_.count(op->buffer->data)) {
       auto new_indices = result_.layout_map[op->buffer]->Forward(op->indices);
@@ -299,6 +611,10 @@ class LayoutInferencer : public IRMutatorWithAnalyzer {
   }
 
   Stmt VisitStmt_(const ForNode* op) final {
+    if (result_.for_map.count(GetRef<For>(op))) {
+      if (auto stmt = LowerLdmatrixCopy(op)) return stmt.value();
+      if (auto stmt = LowerFragmentStore(op)) return stmt.value();
+    }
     Stmt body = IRMutatorWithAnalyzer::VisitStmt_(op);
     if (result_.for_map.count(GetRef<For>(op))) {
       auto loop_layout = result_.for_map[GetRef<For>(op)];
@@ -315,6 +631,200 @@ class LayoutInferencer : public IRMutatorWithAnalyzer {
     return body;
   }
 
+  // A parallel loop copying a shared tile into a 16-bit gemm operand fragment, whose layout is
+  // built by makeGemmFragmentA/B, is lowered to ldmatrix. Each ldmatrix.x4 fills the registers of
+  // a 16x16 mma operand tile for a whole warp, the B operand is stored K-major in shared memory
+  // and is loaded with ldmatrix.trans.
+  Optional<Stmt> LowerLdmatrixCopy(const ForNode* op) {
+    const auto* inner = op->body.as<ForNode>();
+    if (inner == nullptr || op->kind != ForKind::kParallel || inner->kind != ForKind::kParallel)
+      return NullOpt;
+    if (!is_zero(op->min) || !is_zero(inner->min)) return NullOpt;
+    const auto* store = inner->body.as<BufferStoreNode>();
+    if (store == nullptr || store->buffer.scope() != "local.fragment") return NullOpt;
+    const auto* load = store->value.as<BufferLoadNode>();
+    if (load == nullptr) return NullOpt;
+    const Buffer& fragment = store->buffer;
+    const Buffer& shared = load->buffer;
+    if (shared.scope() != "shared" && shared.scope() != "shared.dyn") return NullOpt;
+    if (fragment->dtype.bits() != 16 || shared->dtype != fragment->dtype) return NullOpt;
+    if (fragment->shape.size() != 2 || shared->shape.size() != 2) return NullOpt;
+    if (!store->indices[0].same_as(op->loop_var) || !store->indices[1].same_as(inner->loop_var))
+      return NullOpt;
+    PrimExpr row_base = analyzer_->Simplify(load->indices[0] - op->loop_var);
+    PrimExpr col_base = analyzer_->Simplify(load->indices[1] - inner->loop_var);
+    auto use_loop_var = [&](const VarNode* v) {
+      return v == op->loop_var.get() || v == inner->loop_var.get();
+    };
+    if (UsesVar(row_base, use_loop_var) || UsesVar(col_base, use_loop_var)) return NullOpt;
+
+    // every 8 elements along the rows must be contiguous and 16 bytes aligned
+    if (result_.layout_map.count(shared)) {
+      if (result_.layout_map[shared]->VectorSize() < 8) return NullOpt;
+    } else {
+      auto stride = as_const_int(shared->shape[1]);
+      if (!stride || *stride % 8 != 0) return NullOpt;
+    }
+    if (!analyzer_->CanProveEqual(FloorMod(col_base, 8), 0)) return NullOpt;
+
+    auto rows = as_const_int(fragment->shape[0]);
+    auto cols = as_const_int(fragment->shape[1]);
+    auto num_thread = as_const_int(thread_var_->dom->extent);
+    if (!rows || !cols || !num_thread || *num_thread % 32 != 0) return NullOpt;
+    if (!result_.layout_map.count(fragment)) return NullOpt;
+    auto layout = result_.layout_map[fragment].as<Fragment>().value();
+
+    Var tx = thread_var_->var;
+    PrimExpr lane = FloorMod(tx, 32), warp = FloorDiv(tx, 32);
+    Buffer local = new_alloc_[fragment->data];
+    auto make_ldmatrix = [&](const std::string& name, PrimExpr row, PrimExpr col,
+                             PrimExpr local_offset) {
+      PrimExpr smem_ptr = Call(DataType::Handle(), builtin::address_of(),
+                               {BufferLoad(shared, {row_base + row, col_base + col})});
+      PrimExpr local_ptr = Call(DataType::Handle(), builtin::address_of(),
+                                {BufferLoad(local, {local_offset})});
+      return Evaluate(Call(DataType::Handle(), builtin::call_extern(),
+                           {StringImm(name), VisitExpr(smem_ptr), local_ptr}));
+    };
+
+    int num_warp = *num_thread / 32;
+    for (int warp_m = 1; warp_m <= num_warp; warp_m++) {
+      if (num_warp % warp_m != 0) continue;
+      int warp_n = num_warp / warp_m;
+      // A operand [M, K], the warps are stacked along M and replicated along N
+      if (*rows % (16 * warp_m) == 0 && *cols % 16 == 0 &&
+          StructuralEqual()(layout, makeGemmFragmentA(*rows, 8 * warp_n, *cols,
+                                                      *rows / warp_m, 8))) {
+        int tiles_m = *rows / warp_m / 16, tiles_k = *cols / 16;
+        Var g("g");
+        PrimExpr row = FloorMod(g, tiles_m) * 16 * warp_m + FloorMod(warp, warp_m) * 16 +
+                       FloorMod(lane, 16);
+        PrimExpr col = FloorDiv(g, tiles_m) * 16 + FloorDiv(lane, 16) * 8;
+        return For(g, 0, tiles_m * tiles_k, ForKind::kUnrolled,
+                   make_ldmatrix("tl::ptx_ldmatrix_x4", row, col, g * 8));
+      }
+      // B operand [K, N], the warps are stacked along N and replicated along M
+      if (*rows % 16 == 0 && *cols % (8 * warp_n) == 0 &&
+          StructuralEqual()(layout,
+                            makeGemmFragmentB(16 * warp_m, *cols, *rows, 16, *cols / warp_n))) {
+        int tiles_k = *rows / 16, tiles_n = *cols / warp_n / 8;
+        // the x4 variant loads two adjacent tiles along N when they are contiguous in registers
+        int tiles_per_load = tiles_n % 2 == 0 ? 2 : 1;
+        Var g("g");
+        PrimExpr tile_n = FloorMod(g, tiles_n / tiles_per_load) * tiles_per_load;
+        PrimExpr tile_k = FloorDiv(g, tiles_n / tiles_per_load);
+        PrimExpr row = tile_k * 16 + FloorMod(lane, 16);
+        PrimExpr col = tile_n * 8 * warp_n + FloorDiv(warp, warp_m) * 8;
+        if (tiles_per_load == 2) col += FloorDiv(lane, 16) * 8 * warp_n;
+        std::string name = tiles_per_load == 2 ? "tl::ptx_ldmatrix_x4_trans"
+                                               : "tl::ptx_ldmatrix_x2_trans";
+        return For(g, 0, tiles_k * tiles_n / tiles_per_load, ForKind::kUnrolled,
+                   make_ldmatrix(name, row, col, (tile_n + tile_k * tiles_n) * 4));
+      }
+    }
+    return NullOpt;
+  }
+
+  // A parallel loop writing a whole 2D fragment to the global memory follows the mma layout, so
+  // that each thread stores a few scattered elements. Such loops are split into a store into a
+  // swizzled shared buffer with the fragment layout and a copy from the shared buffer to the global
+  // memory with a new loop layout, which coalesces into 128-bit stores. The barriers in between are
+  // inserted by ThreadSync. The staging buffer is only used if it fits in the shared memory left
+  // by the kernel, and not with the pass config tl.disable_smem_staging.
+  Optional<Stmt> LowerFragmentStore(const ForNode* op) {
+    Array<Var> loop_vars;
+    Array<PrimExpr> indices, extents;
+    Stmt body = GetRef<Stmt>(op);
+    while (const auto* loop = body.as<ForNode>()) {
+      if (loop->kind != ForKind::kParallel || !is_zero(loop->min)) return NullOpt;
+      loop_vars.push_back(loop->loop_var);
+      indices.push_back(loop->loop_var);
+      extents.push_back(loop->extent);
+      body = loop->body;
+    }
+    PrimExpr condition;
+    if (const auto* if_stmt = body.as<IfThenElseNode>()) {
+      if (if_stmt->else_case.defined()) return NullOpt;
+      condition = if_stmt->condition;
+      body = if_stmt->then_case;
+    }
+    const auto* store = body.as<BufferStoreNode>();
+    if (store == nullptr || store->buffer.scope() != "global") return NullOpt;
+    PrimExpr value = store->value;
+    if (const auto* cast = value.as<CastNode>()) value = cast->value;
+    const auto* load = value.as<BufferLoadNode>();
+    if (load == nullptr || load->buffer.scope() != "local.fragment") return NullOpt;
+    if (loop_vars.size() != 2 || load->buffer->shape.size() != 2) return NullOpt;
+    for (size_t i = 0; i < 2; i++) {
+      if (!load->indices[i].same_as(loop_vars[i]) ||
+          !analyzer_->CanProveEqual(extents[i], load->buffer->shape[i]))
+        return NullOpt;
+    }
+    auto rows = as_const_int(load->buffer->shape[0]);
+    auto cols = as_const_int(load->buffer->shape[1]);
+    auto num_thread = as_const_int(thread_var_->dom->extent);
+    DataType dtype = store->buffer->dtype;
+    if (!rows || !cols || !num_thread || *rows % 8 != 0) return NullOpt;
+    if (dtype.bits() != 16 && dtype.bits() != 32) return NullOpt;
+
+    int vector_size = 128 / dtype.bits();
+    Layout staging_layout;
+    if (*cols % (vector_size * 8) == 0) {
+      staging_layout = makeGemmABLayoutFullBank(*rows, *cols, dtype.bits());
+    } else if (*cols % (vector_size * 4) == 0) {
+      staging_layout = makeGemmABLayoutHalfBank(*rows, *cols, dtype.bits());
+    } else {
+      return NullOpt;
+    }
+    Buffer staging = decl_buffer(staging_layout->OutputShape(), dtype,
+                                 load->buffer->name + "_staging", "shared.dyn");
+    // the stores stay scattered if the staging buffer does not fit in the shared memory left
+    int64_t staging_bytes = *rows * *cols * dtype.bytes();
+    if (staging_bytes > smem_headroom_) return NullOpt;
+    smem_headroom_ -= staging_bytes;
+    workspaces_.push_back(staging);
+
+    auto make_loop = [&](const Array<Var>& vars, Stmt body) {
+      for (int i = static_cast<int>(vars.size()) - 1; i >= 0; i--) {
+        body = For(vars[i], 0, extents[i], ForKind::kParallel, body);
+      }
+      return Downcast<For>(body);
+    };
+
+    // fragment -> shared, partitioned with the fragment layout
+    For stage_loop = make_loop(
+        loop_vars, BufferStore(staging, store->value, staging_layout->Forward(indices)));
+    Stmt stage = IRMutatorWithAnalyzer::VisitStmt_(stage_loop.get());
+    stage = PartitionLoop(stage.as<ForNode>(), thread_var_->var, analyzer_,
+                          result_.for_map[GetRef<For>(op)]);
+    if (stage.as<For>()) stage = VectorizeLoop(stage.as<For>().value());
+    if (result_.predicate_map.count(GetRef<For>(op))) {
+      stage = IfThenElse(result_.predicate_map[GetRef<For>(op)], stage);
+    }
+
+    // shared -> global, partitioned for vectorized accesses along the rows
+    Array<Var> new_vars;
+    Map<Var, PrimExpr> vmap;
+    for (const auto& var : loop_vars) {
+      Var new_var = var.copy_with_suffix("");
+      new_vars.push_back(new_var);
+      vmap.Set(var, new_var);
+    }
+    Stmt copy_body =
+        BufferStore(store->buffer, BufferLoad(staging, staging_layout->Forward(indices)),
+                    store->indices);
+    if (condition.defined()) copy_body = IfThenElse(condition, copy_body);
+    For copy_loop = make_loop(new_vars, Substitute(copy_body, vmap));
+    Fragment copy_layout =
+        PlanLoopPartition(copy_loop.get(), *num_thread, GetVectorizeSize(copy_loop));
+    Stmt copy = PartitionLoop(copy_loop.get(), thread_var_->var, analyzer_, copy_layout);
+    if (copy.as<For>()) copy = VectorizeLoop(copy.as<For>().value());
+    if (!analyzer_->CanProveEqual(copy_layout->ThreadExtent(), thread_var_->dom->extent)) {
+      copy = IfThenElse(thread_var_->var < copy_layout->ThreadExtent(), copy);
+    }
+    return SeqStmt({stage, copy});
+  }
+
   Stmt VisitStmt_(const AttrStmtNode* op) final {
     if (op->attr_key == tir::attr::thread_extent) {
       IterVar iv = Downcast<IterVar>(op->node);
@@ -329,7 +839,10 @@ class LayoutInferencer : public IRMutatorWithAnalyzer {
  private:
   const LayoutInferenceResult result_;
   Map<Var, Buffer> new_alloc_;
+  Array<Buffer> workspaces_;
   IterVar thread_var_;
+  // the shared memory bytes left for the staging buffers, 0 if tl.disable_smem_staging is set
+  int64_t smem_headroom_ = 0;
 };
 
 tvm::transform::Pass LayoutInference() {
@@ -337,7 +850,7 @@ tvm::transform::Pass LayoutInference() {
   auto pass_func = [=](PrimFunc f, IRModule m, PassContext ctx) {
     return LayoutInferencer::Substitute(std::move(f));
   };
-  return CreatePrimFuncPass(pass_func, 0, "tl.LayoutInference", {});
+  return CreatePrimFuncPass(pass_func, 0, "tl.LayoutInference", {}, /*function_local=*/true);
 }
 
 TVM_REGISTER_GLOBAL("tl.LayoutInference").set_body_typed(LayoutInference);
@@ -0,0 +1,297 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file local_array_promotion.cc
+ * \brief Keep the local arrays in registers: the accesses by indices which are not constant after
+ * the unrolling are unrolled or made select chains, the other ones are reported
+ */
+
+#include <tvm/tir/op.h>
+#include <tvm/tir/stmt_functor.h>
+#include <tvm/tir/transform.h>
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "../tir/transforms/ir_utils.h"
+
+namespace tvm {
+namespace tl {
+
+using namespace tir;
+
+TVM_REGISTER_PASS_CONFIG_OPTION("tl.disable_local_array_promotion", Bool);
+
+// the copies of the statements made by the unrolling of the loops of an access
+static constexpr int64_t kMaxUnrolledNodes = 4096;
+// the elements of the local arrays accessed through a select chain
+static constexpr int64_t kMaxSelectElements = 16;
+
+/*!
+ * \brief The local arrays (the lowered fragments and local buffers) are registers only when all
+ * their indices are constants in the generated code, a single access by a dynamic index makes
+ * nvcc place the whole array in the local memory. The indices may only depend on the vars of the
+ * loops which are unrolled with a constant extent, the other vars are the ones of the loops left
+ * serial (e.g. the ones made after LoopPragmaUnroll, or with too many iterations), of the
+ * threads, or loaded from memory.
+ *
+ * The loops of the accesses depending on serial loops of constant extents are unrolled when the
+ * copies of their bodies stay small. The scalar accesses of the small arrays are rewritten to
+ * selects over the elements otherwise, and the remaining ones are reported with the array.
+ */
+class LocalArrayAccessPlanner : public StmtExprVisitor {
+ public:
+  // the serial loops to unroll
+  std::unordered_set<const ForNode*> unroll;
+  // the accesses (loads and stores) rewritten to select chains
+  std::unordered_set<const Object*> select;
+  // the accesses left dynamic, with their index
+  std::vector<std::pair<Buffer, PrimExpr>> dynamic;
+
+ private:
+  // The loops which must be unrolled for an index to become constant, or not resolvable.
+  struct Dependence {
+    std::unordered_set<const ForNode*> loops;
+    bool resolvable = true;
+  };
+
+  void VisitStmt_(const AllocateNode* op) final {
+    int64_t elements = 1;
+    for (const auto& extent : op->extents) {
+      auto imm = as_const_int(extent);
+      elements = imm ? elements * *imm : -1;
+      if (!imm) break;
+    }
+    // the dynamic local arrays are placed in the local memory anyway
+    if (GetPtrStorageScope(op->buffer_var) == "local" && elements > 1) {
+      local_elements_[op->buffer_var.get()] = elements;
+    }
+    StmtExprVisitor::VisitStmt_(op);
+  }
+
+  void VisitStmt_(const ForNode* op) final {
+    auto extent = as_const_int(op->extent);
+    if (op->kind == ForKind::kUnrolled && extent != nullptr) {
+      unrolled_vars_.insert(op->loop_var.get());
+    } else {
+      Dependence dep;
+      if (op->kind == ForKind::kSerial && extent != nullptr && is_const_int(op->min)) {
+        dep.loops.insert(op);
+      } else {
+        dep.resolvable = false;
+      }
+      var_deps_[op->loop_var.get()] = std::move(dep);
+    }
+    loops_.push_back(op);
+    StmtExprVisitor::VisitStmt_(op);
+    loops_.pop_back();
+  }
+
+  void VisitStmt_(const LetStmtNode* op) final {
+    var_deps_[op->var.get()] = DependenceOf(op->value);
+    StmtExprVisitor::VisitStmt_(op);
+  }
+
+  void VisitExpr_(const LetNode* op) final {
+    var_deps_[op->var.get()] = DependenceOf(op->value);
+    StmtExprVisitor::VisitExpr_(op);
+  }
+
+  void VisitStmt_(const AttrStmtNode* op) final {
+    if (op->attr_key == tir::attr::thread_extent || op->attr_key == tir::attr::virtual_thread) {
+      Dependence dep;
+      dep.resolvable = false;
+      var_deps_[Downcast<IterVar>(op->node)->var.get()] = std::move(dep);
+    }
+    StmtExprVisitor::VisitStmt_(op);
+  }
+
+  void VisitExpr_(const BufferLoadNode* op) final {
+    Plan(op, op->buffer, op->indices);
+    StmtExprVisitor::VisitExpr_(op);
+  }
+
+  void VisitStmt_(const BufferStoreNode* op) final {
+    Plan(op, op->buffer, op->indices);
+    StmtExprVisitor::VisitStmt_(op);
+  }
+
+  void Plan(const Object* access, const Buffer& buffer, const Array<PrimExpr>& indices) {
+    auto it = local_elements_.find(buffer->data.get());
+    if (it == local_elements_.end() || indices.size() != 1) return;
+    PrimExpr index = indices[0];
+    bool scalar = index.dtype().is_scalar();
+    if (auto ramp = index.as<RampNode>()) index = ramp->base;
+    Dependence dep = DependenceOf(index);
+    if (dep.resolvable && dep.loops.empty()) return;
+    if (dep.resolvable && UnrolledNodes(dep.loops) <= kMaxUnrolledNodes) {
+      unroll.insert(dep.loops.begin(), dep.loops.end());
+    } else if (scalar && it->second <= kMaxSelectElements) {
+      select.insert(access);
+    } else {
+      dynamic.emplace_back(buffer, indices[0]);
+    }
+  }
+
+  Dependence DependenceOf(const PrimExpr& expr) const {
+    Dependence dep;
+    PostOrderVisit(expr, [&](const ObjectRef& node) {
+      if (auto var = node.as<VarNode>()) {
+        if (unrolled_vars_.count(var)) return;
+        auto it = var_deps_.find(var);
+        // the params
+        if (it == var_deps_.end()) {
+          dep.resolvable = false;
+          return;
+        }
+        dep.resolvable &= it->second.resolvable;
+        dep.loops.insert(it->second.loops.begin(), it->second.loops.end());
+      } else if (node->IsInstance<BufferLoadNode>()) {
+        dep.resolvable = false;
+      }
+    });
+    return dep;
+  }
+
+  // The statements made by unrolling the loops: the nodes of the outermost one times the
+  // iterations of the loops nested in it.
+  int64_t UnrolledNodes(const std::unordered_set<const ForNode*>& loops) const {
+    const ForNode* outermost = nullptr;
+    int64_t trips = 1;
+    for (const ForNode* loop : loops_) {
+      if (!loops.count(loop)) continue;
+      if (outermost == nullptr) outermost = loop;
+      trips *= *as_const_int(loop->extent);
+    }
+    if (outermost == nullptr) return 0;
+    int64_t nodes = 0;
+    PostOrderVisit(outermost->body, [&nodes](const ObjectRef& node) {
+      if (node->IsInstance<StmtNode>()) nodes++;
+    });
+    return nodes * trips;
+  }
+
+  std::unordered_map<const VarNode*, int64_t> local_elements_;
+  std::unordered_map<const VarNode*, Dependence> var_deps_;
+  std::unordered_set<const VarNode*> unrolled_vars_;
+  std::vector<const ForNode*> loops_;
+};
+
+class LocalArrayPromoter : public StmtExprMutator {
+ public:
+  explicit LocalArrayPromoter(const LocalArrayAccessPlanner& plan) : plan_(plan) {}
+
+ private:
+  Stmt VisitStmt_(const AllocateNode* op) final {
+    int64_t elements = 1;
+    for (const auto& extent : op->extents) {
+      auto imm = as_const_int(extent);
+      elements = imm ? elements * *imm : -1;
+      if (!imm) break;
+    }
+    elements_[op->buffer_var.get()] = elements;
+    return StmtExprMutator::VisitStmt_(op);
+  }
+
+  Stmt VisitStmt_(const ForNode* op) final {
+    Stmt body = VisitStmt(op->body);
+    if (!plan_.unroll.count(op)) {
+      if (body.same_as(op->body)) return GetRef<Stmt>(op);
+      For loop = GetRef<For>(op);
+      loop.CopyOnWrite()->body = body;
+      return loop;
+    }
+    int64_t min = *as_const_int(op->min), extent = *as_const_int(op->extent);
+    Array<Stmt> seq;
+    for (int64_t i = 0; i < extent; i++) {
+      seq.push_back(Substitute(body, {{op->loop_var, make_const(op->loop_var.dtype(), min + i)}}));
+    }
+    return SeqStmt::Flatten(seq);
+  }
+
+  // buffer[index] -> index == 0 ? buffer[0] : (index == 1 ? buffer[1] : ...)
+  PrimExpr VisitExpr_(const BufferLoadNode* op) final {
+    PrimExpr load = StmtExprMutator::VisitExpr_(op);
+    if (!plan_.select.count(op)) return load;
+    const auto* node = load.as<BufferLoadNode>();
+    PrimExpr index = node->indices[0];
+    int64_t elements = elements_.at(node->buffer->data.get());
+    PrimExpr value = BufferLoad(node->buffer, {make_const(index.dtype(), elements - 1)});
+    for (int64_t k = elements - 2; k >= 0; k--) {
+      PrimExpr k_index = make_const(index.dtype(), k);
+      value = Select(index == k_index, BufferLoad(node->buffer, {k_index}), value);
+    }
+    return value;
+  }
+
+  // buffer[index] = v -> buffer[k] = index == k ? v : buffer[k] for each element k
+  Stmt VisitStmt_(const BufferStoreNode* op) final {
+    Stmt store = StmtExprMutator::VisitStmt_(op);
+    if (!plan_.select.count(op)) return store;
+    const auto* node = store.as<BufferStoreNode>();
+    Var index("local_index", node->indices[0].dtype());
+    Var value("local_value", node->value.dtype());
+    int64_t elements = elements_.at(node->buffer->data.get());
+    Array<Stmt> seq;
+    for (int64_t k = 0; k < elements; k++) {
+      PrimExpr k_index = make_const(index.dtype(), k);
+      PrimExpr old_value = BufferLoad(node->buffer, {k_index});
+      seq.push_back(BufferStore(node->buffer, Select(index == k_index, value, old_value),
+                                {k_index}));
+    }
+    return LetStmt(index, node->indices[0], LetStmt(value, node->value, SeqStmt(seq)));
+  }
+
+  const LocalArrayAccessPlanner& plan_;
+  std::unordered_map<const VarNode*, int64_t> elements_;
+};
+
+namespace transform {
+
+using namespace tir::transform;
+
+tvm::transform::Pass PromoteLocalArray() {
+  auto pass_func = [=](PrimFunc f, IRModule m, PassContext ctx) {
+    if (ctx->GetConfig<Bool>("tl.disable_local_array_promotion", Bool(false)).value()) return f;
+    LocalArrayAccessPlanner plan;
+    plan(f->body);
+    String name = f->GetAttr<String>(tvm::attr::kGlobalSymbol).value_or("the kernel");
+    for (const auto& [buffer, index] : plan.dynamic) {
+      LOG(WARNING) << "The local array " << buffer->name << " of " << name
+                   << " is accessed by the index " << index
+                   << ", which is not a constant after the unrolling: nvcc places the array in "
+                      "the local memory. Make the loops of the access T.unroll or index it by "
+                      "the loop vars of T.Parallel.";
+    }
+    if (plan.unroll.empty() && plan.select.empty()) return f;
+    auto* n = f.CopyOnWrite();
+    // the unrolled copies of the bodies and of the select chains bind the same let vars
+    n->body = ConvertSSA(LocalArrayPromoter(plan)(std::move(n->body)));
+    return f;
+  };
+  return CreatePrimFuncPass(pass_func, 0, "tl.PromoteLocalArray", {});
+}
+
+TVM_REGISTER_GLOBAL("tl.PromoteLocalArray").set_body_typed(PromoteLocalArray);
+}  // namespace transform
+
+}  // namespace tl
+}  // namespace tvm
@@ -26,6 +26,11 @@
 
 #include <tvm/tir/stmt_functor.h>
 
+#include <algorithm>
+#include <map>
+#include <set>
+#include <vector>
+
 namespace tvm {
 namespace tl {
 
@@ -117,29 +122,60 @@ class LoopPramaUnroller : public StmtExprMutator {
   }
 };
 
+// The order in which the elements of a loop are dealt to the threads
+enum class PartitionOrder {
+  kRowMajor,
+  kColumnMajor,
+  // the lanes of a warp cover 8 rows of 4 vectors of the two innermost loops
+  kWarpTiled,
+};
+
 class LoopPartitioner : public StmtExprVisitor {
  public:
   LoopPartitioner() = default;
 
-  Fragment Partition(const ForNode* op, int num_thread, int vectorize_size) {
+  Fragment Partition(const ForNode* op, int num_thread, int vectorize_size,
+                     PartitionOrder order = PartitionOrder::kRowMajor) {
     this->VisitStmt_(op);
     int loop_size_full = 1;
     PrimExpr flattened = 0;
+    std::vector<int> extents;
     for (size_t i = 0; i < loop_vars_.size(); i++) {
       auto ext_ptr = as_const_int(loop_vars_[i]->dom->extent);
       ICHECK(ext_ptr);
-      int extent = *ext_ptr;
-      loop_size_full *= extent;
-      flattened = flattened * extent + loop_vars_[i]->var;
+      extents.push_back(*ext_ptr);
+      loop_size_full *= *ext_ptr;
     }
     ICHECK(loop_size_full % vectorize_size == 0);
+    if (order == PartitionOrder::kColumnMajor) {
+      for (int i = static_cast<int>(loop_vars_.size()) - 1; i >= 0; i--)
+        flattened = flattened * extents[i] + loop_vars_[i]->var;
+    } else {
+      for (size_t i = 0; i < loop_vars_.size(); i++)
+        flattened = flattened * extents[i] + loop_vars_[i]->var;
+    }
     PrimExpr access_idx = FloorDiv(flattened, vectorize_size);
+    if (order == PartitionOrder::kWarpTiled) {
+      size_t n = loop_vars_.size();
+      ICHECK(n >= 2 && extents[n - 2] % 8 == 0 && extents[n - 1] % (4 * vectorize_size) == 0);
+      PrimExpr row = loop_vars_[n - 2]->var, col = loop_vars_[n - 1]->var;
+      int tiles_per_row = extents[n - 1] / (4 * vectorize_size);
+      PrimExpr tile = FloorDiv(row, 8) * tiles_per_row + FloorDiv(col, 4 * vectorize_size);
+      for (size_t i = 0; i + 2 < n; i++) {
+        tile = tile + loop_vars_[i]->var * (extents[n - 2] / 8 * tiles_per_row);
+      }
+      PrimExpr lane = FloorMod(row, 8) * 4 + FloorDiv(FloorMod(col, 4 * vectorize_size),
+                                                       vectorize_size);
+      access_idx = tile * 32 + lane;
+    }
     PrimExpr thd = FloorMod(access_idx, num_thread);
     PrimExpr idx =
         FloorDiv(access_idx, num_thread) * vectorize_size + FloorMod(flattened, vectorize_size);
     return Fragment(loop_vars_, {idx}, {thd}, {});
   }
 
+  const Array<IterVar>& GetLoopVars() const { return loop_vars_; }
+
  private:
   void VisitStmt_(const ForNode* node) final {
     if (node->kind == ForKind::kParallel) {
@@ -160,6 +196,147 @@ Fragment PlanLoopPartition(const ForNode* op, size_t num_thread, int vectorize_s
   return partitioner.Partition(op, num_thread, vectorize_size);
 }
 
+// The global and shared memory accesses of the first warp along the first iterations of its
+// threads, costed by the 32-byte sectors of the global accesses and the wavefronts of the shared
+// accesses, 4 bytes per bank, times the warp instructions of the loop. The addresses are taken
+// relative to the first thread, the accesses whose offsets are not constant are not costed.
+class LoopPartitionCostModel : public StmtExprVisitor {
+ public:
+  LoopPartitionCostModel(const Fragment& loop_layout, const Array<IterVar>& loop_vars,
+                         int num_thread, int vectorize_size)
+      : vector_size_(vectorize_size) {
+    auto inv = loop_layout->Inverse();
+    // the iterations of the first vector of the lanes
+    for (int t = 0; t < std::min(num_thread, 32); t++) {
+      std::vector<Map<Var, PrimExpr>> elements;
+      for (int e = 0; e < vector_size_; e++) {
+        auto iters = inv->Forward({Integer(e), Integer(t)});
+        Map<Var, PrimExpr> vmap;
+        for (size_t i = 0; i < loop_vars.size(); i++)
+          vmap.Set(loop_vars[i]->var, analyzer_.Simplify(iters[i]));
+        elements.push_back(vmap);
+      }
+      lanes_.push_back(elements);
+    }
+    int64_t loop_size = 1;
+    for (const auto& iv : loop_vars) loop_size *= *as_const_int(iv->dom->extent);
+    num_warp_instrs_ = std::max<int64_t>(loop_size / (32 * vector_size_), 1);
+  }
+
+  int64_t Cost(const Stmt& body) {
+    cost_ = 0;
+    VisitStmt(body);
+    return cost_;
+  }
+
+ private:
+  void VisitExpr_(const BufferLoadNode* op) final {
+    AddAccess(op->buffer, op->indices);
+    StmtExprVisitor::VisitExpr_(op);
+  }
+  void VisitStmt_(const BufferStoreNode* op) final {
+    AddAccess(op->buffer, op->indices);
+    StmtExprVisitor::VisitStmt_(op);
+  }
+
+  void AddAccess(const Buffer& buffer, const Array<PrimExpr>& indices) {
+    std::string scope = buffer.scope();
+    bool is_shared = scope == "shared" || scope == "shared.dyn";
+    if (scope != "global" && !is_shared) return;
+    PrimExpr offset = 0, stride = 1;
+    for (int i = static_cast<int>(indices.size()) - 1; i >= 0; i--) {
+      offset = offset + indices[i] * stride;
+      stride = stride * buffer->shape[i];
+    }
+    PrimExpr base = Substitute(offset, lanes_[0][0]);
+    int bytes = buffer->dtype.bytes();
+    std::vector<std::vector<int64_t>> addrs;
+    for (const auto& elements : lanes_) {
+      std::vector<int64_t> lane_addrs;
+      for (const auto& vmap : elements) {
+        auto diff = as_const_int(analyzer_.Simplify(Substitute(offset, vmap) - base));
+        if (!diff) return;
+        lane_addrs.push_back(*diff * bytes);
+      }
+      addrs.push_back(lane_addrs);
+    }
+    int64_t per_instr = 0;
+    if (!is_shared) {
+      std::set<int64_t> sectors;
+      for (const auto& lane_addrs : addrs) {
+        for (int64_t addr : lane_addrs) sectors.insert(FloorDivInt(addr, 32));
+      }
+      // a sector from the DRAM or the L2 is costlier than an instruction
+      per_instr = 4 * sectors.size();
+    } else {
+      // a wavefront serves 128 bytes, the lanes are split into phases of that many bytes
+      int64_t lane_bytes = vector_size_ * bytes;
+      int lanes_per_phase = std::max<int64_t>(1, 128 / std::max<int64_t>(lane_bytes, 4));
+      for (size_t begin = 0; begin < addrs.size(); begin += lanes_per_phase) {
+        std::map<int64_t, std::set<int64_t>> bank_words;
+        for (size_t t = begin; t < std::min(addrs.size(), begin + lanes_per_phase); t++) {
+          for (int64_t addr : addrs[t]) {
+            int64_t word = FloorDivInt(addr, 4);
+            bank_words[FloorModInt(word, 32)].insert(word);
+          }
+        }
+        size_t wavefronts = 1;
+        for (const auto& [_, words] : bank_words) wavefronts = std::max(wavefronts, words.size());
+        per_instr += wavefronts;
+      }
+    }
+    cost_ += (per_instr + 1) * num_warp_instrs_;
+  }
+
+  static int64_t FloorDivInt(int64_t a, int64_t b) { return a >= 0 ? a / b : -((-a + b - 1) / b); }
+  static int64_t FloorModInt(int64_t a, int64_t b) { return a - FloorDivInt(a, b) * b; }
+
+  int64_t vector_size_;
+  int64_t num_warp_instrs_;
+  std::vector<std::vector<Map<Var, PrimExpr>>> lanes_;
+  arith::Analyzer analyzer_;
+  int64_t cost_ = 0;
+};
+
+Fragment PlanLoopPartitionByCost(const ForNode* op, size_t num_thread, int vectorize_size) {
+  Fragment best = PlanLoopPartition(op, num_thread, vectorize_size);
+  LoopPartitioner collector;
+  collector.Partition(op, num_thread, 1);
+  const Array<IterVar>& loop_vars = collector.GetLoopVars();
+  std::vector<int> extents;
+  int64_t loop_size = 1;
+  for (const auto& iv : loop_vars) {
+    extents.push_back(*as_const_int(iv->dom->extent));
+    loop_size *= extents.back();
+  }
+  // too few iterations per thread to matter
+  if (loop_size < static_cast<int64_t>(num_thread) * 2) return best;
+
+  int64_t best_cost =
+      LoopPartitionCostModel(best, loop_vars, num_thread, vectorize_size).Cost(op->body);
+  size_t n = loop_vars.size();
+  for (int vec = vectorize_size; vec >= 1; vec /= 2) {
+    std::vector<PartitionOrder> orders = {PartitionOrder::kRowMajor};
+    if (n >= 2) orders.push_back(PartitionOrder::kColumnMajor);
+    if (n >= 2 && num_thread % 32 == 0 && extents[n - 2] % 8 == 0 &&
+        extents[n - 1] % (4 * vec) == 0)
+      orders.push_back(PartitionOrder::kWarpTiled);
+    for (auto order : orders) {
+      // the column-major order deals single elements, the vectors are along the innermost loop
+      if (order == PartitionOrder::kColumnMajor && vec != 1) continue;
+      if (order == PartitionOrder::kRowMajor && vec == vectorize_size) continue;
+      LoopPartitioner partitioner;
+      Fragment candidate = partitioner.Partition(op, num_thread, vec, order);
+      int64_t cost = LoopPartitionCostModel(candidate, loop_vars, num_thread, vec).Cost(op->body);
+      if (cost < best_cost) {
+        best = candidate;
+        best_cost = cost;
+      }
+    }
+  }
+  return best;
+}
+
 Stmt LoopPragmaUnroll(Stmt stmt) {
   LoopPramaUnroller unroller;
   return unroller(stmt);
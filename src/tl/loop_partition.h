@@ -39,6 +39,14 @@ Stmt PartitionLoop(const ForNode* op, const Var& thread, arith::Analyzer* analyz
 
 Fragment PlanLoopPartition(const ForNode* op, size_t num_thread, int vectorize_size);
 
+/*!
+ * \brief Plan the partition of a loop among candidates: the row-major partition by vectors of
+ * vectorize_size and the smaller powers of two, the column-major one and the warp tiles of 8 x 4
+ * vectors. The cheapest one by the memory accesses of the first warp is kept, the row-major
+ * partition by vectorize_size on a tie.
+ */
+Fragment PlanLoopPartitionByCost(const ForNode* op, size_t num_thread, int vectorize_size);
+
 Stmt LoopPragmaUnroll(Stmt stmt);
 
 }  // namespace tl
@@ -22,32 +22,53 @@
  * \brief Lower the tile op for further codegen.
  */
 
+#include <tvm/tir/analysis.h>
 #include <tvm/tir/builtin.h>
 #include <tvm/tir/stmt_functor.h>
 #include <tvm/tir/transform.h>
 
+#include <algorithm>
+#include <unordered_map>
+
 #include "../arith/ir_mutator_with_analyzer.h"
 #include "arith.h"
+#include "auto_vectorize.h"
 #include "helper.h"
 #include "layout.h"
 #include "loop_partition.h"
 #include "op.h"
+#include "target_utils.h"
 
 namespace tvm {
 namespace tl {
 
 using namespace tir;
 
+TVM_REGISTER_PASS_CONFIG_OPTION("tl.gemm_ptx_mma", Bool);
+
 class LowerTileOpPass : arith::IRMutatorWithAnalyzer {
  public:
   static PrimFunc Substitute(PrimFunc f) {
     arith::Analyzer analyzer;
+    analyzer.EnableSimplifyCache();
+    analyzer.EnableIterMapCache();
     LowerTileOpPass substituter(&analyzer);
     for (const auto& [_, buffer] : f->buffer_map) {
       substituter.buffer_data_to_buffer_.Set(buffer->data, buffer);
     }
+    auto target = f->GetAttr<Target>(tvm::attr::kTarget);
+    ICHECK(target.defined()) << "LowerTileOpPass: Require the target attribute";
+    substituter.target_ = target.value();
+    substituter.gemm_ptx_mma_ = transform::PassContext::Current()
+                                    ->GetConfig<Bool>("tl.gemm_ptx_mma", Bool(false))
+                                    .value();
     PrimFuncNode* fptr = f.CopyOnWrite();
-    fptr->body = substituter.VisitStmt(f->body);
+    // moving the body out lets the mutator rewrite the uniquely owned nodes in place
+    fptr->body = substituter(std::move(fptr->body));
+    // The tensor maps are encoded on the host side and passed to the kernel by value
+    for (auto it = substituter.tensor_maps_.rbegin(); it != substituter.tensor_maps_.rend(); it++) {
+      fptr->body = MakeTensorMapEncode(it->first, it->second, fptr->body);
+    }
     return f;
   }
 
@@ -69,43 +90,235 @@ class LowerTileOpPass : arith::IRMutatorWithAnalyzer {
       auto block_ptr = block.CopyOnWrite();
       for (const auto& buffer : workspaces_) block_ptr->alloc_buffers.push_back(buffer);
       workspaces_.clear();
+      reduce_workspaces_.clear();
     }
     return block;
   }
 
+  Stmt VisitStmt_(const SeqStmtNode* op) final {
+    // A tile op can be lowered into several statements, keep them at the same level so that the
+    // pipeline planning can schedule them separately.
+    Array<Stmt> seq = op->seq.Map([this](const Stmt& stmt) { return VisitStmt(stmt); });
+    // an unchanged sequence is kept, rather than rebuilt, when it is already flat
+    if (seq.same_as(op->seq)) return SeqStmt::Flatten(GetRef<SeqStmt>(op));
+    return SeqStmt::Flatten(seq);
+  }
+
   Stmt VisitStmt_(const EvaluateNode* node) final {
     if (auto call = node->value.as<CallNode>()) {
       if (call->op.same_as(tl::gemm())) {
-        return LowerGemm(call->args);
+        return MakeTimerScope(LowerGemm(call->args), "gemm");
+      } else if (call->op.same_as(tl::gemm_sp())) {
+        return MakeTimerScope(LowerGemmSp(call->args), "gemm_sp");
       } else if (call->op.same_as(tl::reduce())) {
-        return LowerReduce(call->args);
+        return MakeTimerScope(LowerReduce(call->args), "reduce");
+      } else if (call->op.same_as(tl::scan())) {
+        return MakeTimerScope(LowerScan(call->args), "scan");
+      } else if (call->op.same_as(tl::topk())) {
+        return MakeTimerScope(LowerTopK(call->args), "topk");
+      } else if (call->op.same_as(tl::online_softmax())) {
+        return MakeTimerScope(LowerOnlineSoftmax(call->args), "online_softmax");
+      } else if (call->op.same_as(tl::shuffle_layout())) {
+        return LowerShuffleLayout(call->args);
+      } else if (call->op.same_as(tl::copy())) {
+        // not timed here, WarpSpecialized matches the statements of the bulk copies, the copies are
+        // timed with the stages of the pipelined loops
+        return LowerCopy(call->args);
       }
     }
     return GetRef<Evaluate>(node);
   }
 
   PrimExpr GetWorkspace(int num_elem, DataType dtype) {
+    // The reductions of a block share the workspace of the same type and size, tl::AllReduce
+    // synchronizes the block before writing it.
+    for (const auto& workspace : reduce_workspaces_) {
+      if (workspace->dtype == dtype && is_const_int(workspace->shape[0], num_elem))
+        return workspace.access_ptr(2);
+    }
     // TODO: fix merge dyn shared memory pass
     auto workspace = decl_buffer({PrimExpr(num_elem)}, dtype, "workspace", "shared.dyn");
     workspaces_.push_back(workspace);
+    reduce_workspaces_.push_back(workspace);
     return workspace.access_ptr(2);  // write
   }
 
+  Var GetTensorMap(const Buffer& buffer, const Array<PrimExpr>& encode_args) {
+    for (const auto& [var, args] : tensor_maps_) {
+      if (StructuralEqual()(args, encode_args)) return var;
+    }
+    Var var(buffer->name + "_desc", DataType::Handle());
+    tensor_maps_.emplace_back(var, encode_args);
+    return var;
+  }
+
+  // Only the copies passing CopyArgs::CheckBulkLoad are left to this pass by FrontendLegalize.
+  Stmt LowerCopy(const Array<PrimExpr>& call_args) {
+    CopyArgs args = CopyArgs::Parse(call_args);
+    Layout dst_layout;
+    if (layout_map_.count(args.dst)) {
+      // the region covers the whole physical buffer, recover the logical one from the layout
+      dst_layout = layout_map_[args.dst];
+      args.dst_range = dst_layout->InputShape().Map([](const PrimExpr& e) { return Range(0, e); });
+    }
+    Stmt bulk_load = LowerBulkLoad(args, dst_layout);
+    if (bulk_load.defined()) return bulk_load;
+    return LowerCopyLoop(args, dst_layout);
+  }
+
+  Stmt LowerBulkLoad(const CopyArgs& args, const Layout& dst_layout) {
+    int rank = args.src_range.size();
+    int bits = args.src->dtype.bits();
+    // tensor map dims are ordered from the innermost
+    Array<PrimExpr> box;
+    for (int i = rank - 1; i >= 0; i--) box.push_back(args.src_range[i]->extent);
+    int swizzle = 0;  // CU_TENSOR_MAP_SWIZZLE_NONE
+    int num_box = 1;
+    if (dst_layout.defined()) {
+      // The full/half bank swizzled layouts are the 128B/64B tma swizzle patterns, where the
+      // continuous dim is split into chunks of 128B/64B and each chunk is loaded as a box.
+      if (dst_layout->InputDim() != 2) return Stmt();
+      auto stride = as_const_int(dst_layout->InputShape()[0]);
+      auto continuous = as_const_int(dst_layout->InputShape()[1]);
+      if (stride == nullptr || continuous == nullptr || *stride % 8 != 0) return Stmt();
+      if (!analyzer_->CanProveEqual(box[0], static_cast<int>(*continuous))) return Stmt();
+      int vector_size = 128 / bits;
+      int inner_box;
+      if (*continuous % (vector_size * 8) == 0 &&
+          StructuralEqual()(dst_layout, makeGemmABLayoutFullBank(*stride, *continuous, bits))) {
+        swizzle = 3;  // CU_TENSOR_MAP_SWIZZLE_128B
+        inner_box = vector_size * 8;
+      } else if (*continuous % (vector_size * 4) == 0 &&
+                 StructuralEqual()(dst_layout,
+                                   makeGemmABLayoutHalfBank(*stride, *continuous, bits))) {
+        swizzle = 2;  // CU_TENSOR_MAP_SWIZZLE_64B
+        inner_box = vector_size * 4;
+      } else {
+        return Stmt();
+      }
+      num_box = *continuous / inner_box;
+      box.Set(0, inner_box);
+    }
+
+    const Buffer& src = args.src;
+    int bytes = src->dtype.bytes();
+    Array<PrimExpr> global_dim, global_stride;
+    PrimExpr stride = make_const(DataType::Int(64), bytes);
+    for (int i = rank - 1; i >= 0; i--) {
+      global_dim.push_back(cast(DataType::Int(64), src->shape[i]));
+      if (src->strides.empty()) {
+        global_stride.push_back(stride);
+        stride = stride * cast(DataType::Int(64), src->shape[i]);
+      } else {
+        global_stride.push_back(cast(DataType::Int(64), src->strides[i]) * bytes);
+      }
+    }
+    Array<PrimExpr> encode_args = {Integer(src->dtype.code()), Integer(bits), Integer(rank),
+                                   src->data};
+    for (const auto& e : global_dim) encode_args.push_back(e);
+    for (const auto& e : global_stride) encode_args.push_back(e);
+    for (const auto& e : box) encode_args.push_back(e);
+    for (int i = 0; i < rank; i++) encode_args.push_back(Integer(1));  // element strides
+    encode_args.push_back(Integer(0));                                  // no interleave
+    encode_args.push_back(Integer(swizzle));
+    encode_args.push_back(Integer(2));  // CU_TENSOR_MAP_L2_PROMOTION_L2_128B
+    encode_args.push_back(Integer(0));  // fill zeros for the out of bound elements
+    Var tensor_map = GetTensorMap(src, encode_args);
+
+    // The barrier is initialized by every load, so that the phase to wait is always 0. It is
+    // allocated with the shared buffer, which gives one barrier per stage after pipelining.
+    Buffer barrier = decl_buffer({1}, DataType::UInt(64), "mbarrier", "shared");
+    workspaces_.push_back(barrier);
+
+    PrimExpr box_elems = 1;
+    for (const auto& e : box) box_elems = box_elems * e;
+    box_elems = analyzer_->Simplify(box_elems);
+    PrimExpr total_bytes = analyzer_->Simplify(box_elems * num_box * bytes);
+
+    Array<Stmt> issue;
+    issue.push_back(Evaluate(Call(DataType::Handle(), builtin::call_extern(),
+                                  {StringImm("tl::mbarrier_init_expect_tx"),
+                                   barrier.access_ptr(3), total_bytes})));
+    for (int i = 0; i < num_box; i++) {
+      // the barrier access is already recorded by the init, mask it out for the sync planning
+      Array<PrimExpr> load_args = {
+          tensor_map, barrier.access_ptr(0),
+          args.dst.access_ptr(2, DataType::Handle(), 1, box_elems * i, box_elems)};
+      for (int j = rank - 1; j >= 0; j--) {
+        PrimExpr coord = args.src_range[j]->min;
+        if (j == rank - 1) coord = coord + box[0] * i;
+        load_args.push_back(cast(DataType::Int(32), analyzer_->Simplify(coord)));
+      }
+      issue.push_back(Evaluate(Call(DataType::Handle(), tma_load(), load_args)));
+    }
+    Stmt issue_stmt = args.MakeCacheHintScope(IfThenElse(EQ(thread_var_, 0), SeqStmt(issue)));
+    Stmt wait_stmt = Evaluate(
+        Call(DataType::Handle(), mbarrier_wait(), {barrier.access_ptr(1), Integer(0)}));
+    return SeqStmt({issue_stmt, wait_stmt});
+  }
+
+  Stmt LowerCopyLoop(const CopyArgs& args, const Layout& dst_layout) {
+    Array<IterVar> loop_vars = args.MakeIterVars();
+    for (const auto& iv : loop_vars) analyzer_->Bind(iv->var, iv->dom);
+    Array<PrimExpr> src_indices = args.MakeIndices(loop_vars, 0);
+    Array<PrimExpr> dst_indices = args.MakeIndices(loop_vars, 1);
+    if (dst_layout.defined()) dst_indices = dst_layout->Forward(dst_indices);
+
+    PrimExpr value = BufferLoad(args.src, src_indices);
+    PrimExpr src_predicate = args.MakePredicate(analyzer_, loop_vars, args.Extents(0), 0);
+    if (src_predicate.defined())
+      value = if_then_else(src_predicate, value, make_zero(args.dst->dtype));
+    Stmt body = args.MakeCacheHintScope(BufferStore(args.dst, value, dst_indices));
+    for (int i = loop_vars.size() - 1; i >= 0; i--) {
+      body = For(loop_vars[i]->var, 0, loop_vars[i]->dom->extent, ForKind::kParallel, body);
+    }
+
+    // partition the loop as the layout inference does for the loops without fragments
+    For loop = Downcast<For>(body);
+    Fragment loop_layout =
+        PlanLoopPartition(loop.get(), thread_block_size_, GetVectorizeSize(loop));
+    Stmt stmt = PartitionLoop(loop.get(), thread_var_, analyzer_, loop_layout);
+    if (stmt.as<For>()) stmt = VectorizeLoop(stmt.as<For>().value());
+    PrimExpr loop_thread_extent = loop_layout->ThreadExtent();
+    if (!analyzer_->CanProveEqual(loop_thread_extent, static_cast<int>(thread_block_size_)))
+      stmt = IfThenElse(LT(thread_var_, loop_thread_extent), stmt);
+    return stmt;
+  }
+
   Stmt LowerReduce(const Array<PrimExpr>& call_args) {
     ReduceArgs args = ReduceArgs::Parse(call_args, buffer_data_to_buffer_);
+    auto is_shared = [](const Buffer& buffer) {
+      return buffer.scope() == "shared" || buffer.scope() == "shared.dyn";
+    };
+    if (is_shared(args.src)) {
+      ICHECK(is_shared(args.dst))
+          << "Reduce of a shared buffer requires the dst on shared memory, got " << args.dst;
+      ICHECK(!args.aux.defined()) << "argmax and welford only reduce fragments";
+      return LowerSharedReduce(args);
+    }
     ICHECK(args.src.scope() == "local" && args.dst.scope() == "local")
-        << "Reduce for shared memory not implemented.";
+        << "Reduce of a fragment requires the dst to be a fragment, got " << args.dst;
     Fragment src = layout_map_[args.src].as<Fragment>().value();
     Fragment dst = layout_map_[args.dst].as<Fragment>().value();
-    ICHECK(src->InputDim() == dst->InputDim() + 1);
+    ICHECK(src->InputDim() == dst->InputDim() + args.dims.size());
     Array<IterVar> dst_vars;
     for (size_t i = 0; i < dst->InputDim(); i++) {
       Var var = Var(std::string{char('i' + i)});
       dst_vars.push_back(IterVar(Range(0, dst->InputShape()[i]), var, IterVarType::kDataPar));
     }
     Array<IterVar> src_vars = dst_vars;
-    src_vars.insert(src_vars.begin() + args.dim,
-                    {Range(0, src->InputShape()[args.dim]), Var("rv"), IterVarType::kDataPar});
+    for (size_t i = 0; i < args.dims.size(); i++) {
+      int dim = args.dims[i];
+      IterVar rv(Range(0, src->InputShape()[dim]), Var("rv" + std::to_string(i)),
+                 IterVarType::kDataPar);
+      src_vars.insert(src_vars.begin() + dim, rv);
+    }
+    auto is_reduce_var = [&](const Var& var) {
+      for (int dim : args.dims) {
+        if (var.same_as(src_vars[dim]->var)) return true;
+      }
+      return false;
+    };
     Array<PrimExpr> src_indices =
         src->Forward(src_vars.Map([](const auto& iv) { return PrimExpr(iv->var); }));
     Array<PrimExpr> dst_indices =
@@ -113,25 +326,67 @@ class LowerTileOpPass : arith::IRMutatorWithAnalyzer {
 
     Array<Stmt> stmts;
 
-    // make reduce-init stmt
-    if (args.clear) stmts.push_back(BufferStore(args.dst, args.MakeInitValue(), dst_indices));
+    using ReduceType = ReduceArgs::ReduceType;
+    bool is_argmax = args.type == ReduceType::kArgMax;
+    bool is_welford = args.type == ReduceType::kWelford;
+    if (is_argmax || is_welford) {
+      ICHECK(args.aux.defined() && args.aux.scope() == "local")
+          << "The second output of argmax/welford should be a fragment";
+    }
+    ICHECK(!is_argmax || args.dims.size() == 1) << "argmax reduces a single dim";
+
+    // make reduce-init stmt, the struct-valued reductions always start from the init state
+    if (args.clear || is_argmax || is_welford)
+      stmts.push_back(BufferStore(args.dst, args.MakeInitValue(), dst_indices));
+    if (is_argmax) stmts.push_back(BufferStore(args.aux, make_const(args.aux->dtype, -1),
+                                               dst_indices));
+    if (is_welford) stmts.push_back(BufferStore(args.aux, make_zero(args.aux->dtype), dst_indices));
 
     // make thread-local reduce
     Array<PrimExpr> src_indice_compressed;
     Array<IterVar> src_var_compressed;
     for (size_t i = 0; i < src->OutputDim(); i++) {
-      PrimExpr expr;
-      IterVar var;
-      std::tie(expr, var) =
-          CompressIterator(src_indices[i], src_vars, src_vars[args.dim], analyzer_);
+      PrimExpr expr = src_indices[i];
+      Array<IterVar> iters = src_vars;
+      for (int dim : args.dims) {
+        IterVar var;
+        std::tie(expr, var) = CompressIterator(expr, iters, iters[dim], analyzer_);
+        iters.Set(dim, var);
+        src_var_compressed.push_back(var);
+      }
       src_indice_compressed.push_back(expr);
-      src_var_compressed.push_back(var);
     }
-    Stmt reduce_local = BufferStore(args.dst,
-                                    args.MakeReduce(BufferLoad(args.dst, dst_indices),
-                                                    BufferLoad(args.src, src_indice_compressed)),
-                                    dst_indices);
-    for (int i = src->OutputDim() - 1; i >= 0; i--) {
+    PrimExpr src_value = BufferLoad(args.src, src_indice_compressed);
+    PrimExpr dst_value = BufferLoad(args.dst, dst_indices);
+    // the number of the elements reduced by each thread
+    PrimExpr local_count = 1;
+    for (const auto& iv : src_var_compressed) local_count = local_count * iv->dom->extent;
+    local_count = analyzer_->Simplify(local_count);
+    Stmt reduce_local;
+    if (is_argmax) {
+      // the index along the reduced dim, recovered from the thread and the local index
+      Array<PrimExpr> inverse_args = src_indice_compressed;
+      inverse_args.push_back(thread_var_);
+      PrimExpr index = src->Inverse()->Forward(inverse_args)[args.dims[0]];
+      index = analyzer_->Simplify(cast(args.aux->dtype, index));
+      PrimExpr value = cast(args.dst->dtype, src_value);
+      PrimExpr aux_value = BufferLoad(args.aux, dst_indices);
+      PrimExpr take = value > dst_value || (value == dst_value && index < aux_value);
+      reduce_local = IfThenElse(take, SeqStmt({BufferStore(args.dst, value, dst_indices),
+                                               BufferStore(args.aux, index, dst_indices)}));
+    } else if (is_welford) {
+      // the welford update with the 1-based position n among the local elements, aux holds M2
+      PrimExpr n = 0;
+      for (const auto& iv : src_var_compressed) n = n * iv->dom->extent + iv->var;
+      n = cast(args.dst->dtype, n + 1);
+      PrimExpr delta = cast(args.dst->dtype, src_value) - dst_value;
+      PrimExpr m2 = BufferLoad(args.aux, dst_indices) + delta * delta * (n - 1) / n;
+      reduce_local = SeqStmt({BufferStore(args.aux, m2, dst_indices),
+                              BufferStore(args.dst, dst_value + delta / n, dst_indices)});
+    } else {
+      reduce_local = BufferStore(args.dst, args.MakeReduce(dst_value, src_value), dst_indices);
+    }
+    for (int i = src_var_compressed.size() - 1; i >= 0; i--) {
       reduce_local =
           For(src_var_compressed[i]->var, 0, src_var_compressed[i]->dom->extent, ForKind::kUnrolled,
               reduce_local, NullOpt, {{tir::attr::pragma_unroll_explicit, Bool(false)}});
@@ -142,29 +397,53 @@ class LowerTileOpPass : arith::IRMutatorWithAnalyzer {
     PrimExpr src_thread =
         src->ForwardThread(src_vars.Map([](const auto& iv) { return PrimExpr(iv->var); }), {});
     auto iter_sum = arith::NormalizeToIterSum(src_thread, ToVMap(src_vars), analyzer_);
+    auto address_of = [](const Buffer& buffer, const Array<PrimExpr>& indices) {
+      return Call(DataType::Handle(), builtin::address_of(), {BufferLoad(buffer, indices)});
+    };
+    PrimExpr total_count = local_count;
     for (const auto& iter_split : iter_sum->args) {
       auto mark = iter_split->source->source.as<Var>();
       ICHECK(mark.defined());
-      if (mark.value().same_as(src_vars[args.dim]->var)) {
+      if (is_reduce_var(mark.value())) {
         auto scale = as_const_int(iter_split->scale);
         auto extent = as_const_int(iter_split->extent);
         ICHECK(scale != nullptr && extent != nullptr);
         if (*extent == 1) continue;
         int reducing_threads = (*extent) * (*scale);
+        // the struct payloads take at most 4 (argmax) or 6 (welford) words per thread
+        PrimExpr workspace;
+        if (reducing_threads >= 32) {
+          int words = is_argmax ? 4 : is_welford ? 6 : 1;
+          DataType dtype = words == 1 ? args.dst->dtype : DataType::Int(32);
+          workspace = GetWorkspace(thread_block_size_ * words, dtype);
+        }
         std::stringstream ss;
+        if (is_argmax || is_welford) {
+          ss << (is_argmax ? "tl::AllReduceArgMax<" : "tl::AllReduceWelford<") << reducing_threads
+             << ", " << (*scale) << ">";
+          Array<PrimExpr> call_args = {StringImm(ss.str()), address_of(args.dst, dst_indices),
+                                       address_of(args.aux, dst_indices)};
+          if (is_welford) call_args.push_back(cast(DataType::Float(32), total_count));
+          if (workspace.defined()) call_args.push_back(workspace);
+          stmts.push_back(Evaluate(Call(DataType::Handle(), builtin::call_extern(), call_args)));
+          total_count = total_count * (*extent);
+          continue;
+        }
         ss << "tl::AllReduce<" << args.MakeCodegenReducer() << ", " << reducing_threads << ", "
            << (*scale) << ">::run";
         Array<PrimExpr> thread_reduce_args = {StringImm(ss.str()),
                                               BufferLoad(args.dst, dst_indices)};
-        if (reducing_threads >= 32) {
-          PrimExpr workspace = GetWorkspace(thread_block_size_, args.dst->dtype);
-          thread_reduce_args.push_back(workspace);
-        }
+        if (workspace.defined()) thread_reduce_args.push_back(workspace);
         auto call = Call(args.dst->dtype, builtin::call_extern(), thread_reduce_args);
         stmts.push_back(BufferStore(args.dst, call, dst_indices));
       }
     }
-    Stmt reduce_interthread = BufferStore(args.dst, BufferLoad(args.dst, dst_indices), dst_indices);
+    // the variance from M2
+    if (is_welford) {
+      PrimExpr count = cast(args.aux->dtype, analyzer_->Simplify(total_count));
+      PrimExpr variance = BufferLoad(args.aux, dst_indices) / count;
+      stmts.push_back(BufferStore(args.aux, variance, dst_indices));
+    }
 
     // make the outer spatial loop
     Stmt body = SeqStmt(stmts);
@@ -176,31 +455,688 @@ class LowerTileOpPass : arith::IRMutatorWithAnalyzer {
     return body;
   }
 
+  /*!
+   * \brief One step of the online softmax, as a loop over the rows of the statistics partitioned
+   * by their layout. Each thread takes the max of its part of the row in registers, the max is
+   * combined with a single tl::AllReduce, the exponentials are computed with ex2.approx (log2(e)
+   * folded into the scale) in the same register loop as the partial row sum, which takes the
+   * second tl::AllReduce, then the row of the accumulator held by the thread is rescaled.
+   */
+  Stmt LowerOnlineSoftmax(const Array<PrimExpr>& call_args) {
+    OnlineSoftmaxArgs args = OnlineSoftmaxArgs::Parse(call_args, buffer_data_to_buffer_);
+    for (const auto& buffer : {args.scores, args.m, args.l, args.acc}) {
+      ICHECK(buffer.scope() == "local") << "The online softmax requires fragments, got " << buffer;
+    }
+    Fragment scores = layout_map_[args.scores].as<Fragment>().value();
+    Fragment stat = layout_map_[args.m].as<Fragment>().value();
+    Fragment acc = layout_map_[args.acc].as<Fragment>().value();
+    ICHECK(StructuralEqual()(layout_map_[args.l], stat))
+        << "The row max and the row sum should have the same layout";
+
+    IterVar row(Range(0, stat->InputShape()[0]), Var("i"), IterVarType::kDataPar);
+    // the columns of a fragment held by the thread, compressed out of the local indices
+    auto local_columns = [&](const Fragment& layout, Array<IterVar>* col_vars) {
+      IterVar col(Range(0, layout->InputShape()[1]), Var("j"), IterVarType::kDataPar);
+      Array<IterVar> iters = {row, col};
+      Array<PrimExpr> indices = layout->Forward({row->var, col->var});
+      Array<PrimExpr> compressed;
+      for (const auto& index : indices) {
+        auto [expr, var] = CompressIterator(index, iters, col, analyzer_);
+        col_vars->push_back(var);
+        compressed.push_back(expr);
+      }
+      return compressed;
+    };
+    // the column loops are made with fresh vars, a loop var is bound once
+    auto make_unrolled = [](const Array<IterVar>& vars, Stmt body) {
+      Map<Var, PrimExpr> vmap;
+      for (const auto& iv : vars) vmap.Set(iv->var, iv->var.copy_with_suffix(""));
+      body = Substitute(body, vmap);
+      for (int i = vars.size() - 1; i >= 0; i--) {
+        body = For(Downcast<Var>(vmap[vars[i]->var]), 0, vars[i]->dom->extent, ForKind::kUnrolled,
+                   body, NullOpt, {{tir::attr::pragma_unroll_explicit, Bool(false)}});
+      }
+      return body;
+    };
+    {
+      // the thread holding m[i] must hold its row of the accumulator
+      Var col("j");
+      analyzer_->Bind(row->var, row->dom);
+      PrimExpr min_cols = min(scores->InputShape()[1], acc->InputShape()[1]);
+      analyzer_->Bind(col, Range(0, analyzer_->Simplify(min_cols)));
+      ICHECK(analyzer_->CanProveEqual(scores->ForwardThread({row->var, col}, {}),
+                                      acc->ForwardThread({row->var, col}, {})))
+          << "The online softmax requires the rows of " << args.acc << " on the threads of the "
+          << "rows of " << args.scores << ", use the same warp policy for their gemms";
+    }
+
+    Array<IterVar> score_cols, acc_cols;
+    Array<PrimExpr> score_indices = local_columns(scores, &score_cols);
+    Array<PrimExpr> acc_indices = local_columns(acc, &acc_cols);
+    Array<PrimExpr> stat_indices = stat->Forward({row->var});
+    PrimExpr score = BufferLoad(args.scores, score_indices);
+    PrimExpr m = BufferLoad(args.m, stat_indices);
+
+    // [0] the previous max and then the rescale factor, [1] the row sum, [2] the scaled max
+    Buffer temp = decl_buffer({3}, args.m->dtype, "softmax_stat", "local");
+    workspaces_.push_back(temp);
+    PrimExpr rescale = BufferLoad(temp, {0}), row_sum = BufferLoad(temp, {1});
+    PrimExpr ref = BufferLoad(temp, {2});
+    PrimExpr scale = analyzer_->Simplify(cast(args.m->dtype, args.scale) *
+                                         make_const(args.m->dtype, 1.4426950408889634));
+    auto exp2 = [&](const PrimExpr& x) {
+      return Call(args.m->dtype, builtin::call_extern(), {StringImm("tl::exp2_approx"), x});
+    };
+    // the reductions among the threads of a row
+    std::vector<std::pair<int, int>> all_reduces;
+    {
+      IterVar col(Range(0, scores->InputShape()[1]), Var("j"), IterVarType::kDataPar);
+      PrimExpr thread = scores->ForwardThread({row->var, col->var}, {});
+      auto iter_sum = arith::NormalizeToIterSum(thread, ToVMap({row, col}), analyzer_);
+      for (const auto& split : iter_sum->args) {
+        auto mark = split->source->source.as<Var>();
+        ICHECK(mark.defined());
+        if (!mark.value().same_as(col->var)) continue;
+        auto split_scale = as_const_int(split->scale);
+        auto extent = as_const_int(split->extent);
+        ICHECK(split_scale != nullptr && extent != nullptr);
+        if (*extent == 1) continue;
+        all_reduces.emplace_back((*extent) * (*split_scale), *split_scale);
+      }
+    }
+    auto all_reduce = [&](const std::string& reducer, const PrimExpr& value) {
+      PrimExpr result = value;
+      for (const auto& [threads, thread_scale] : all_reduces) {
+        std::stringstream ss;
+        ss << "tl::AllReduce<" << reducer << ", " << threads << ", " << thread_scale << ">::run";
+        Array<PrimExpr> reduce_args = {StringImm(ss.str()), result};
+        if (threads >= 32) reduce_args.push_back(GetWorkspace(thread_block_size_, value->dtype));
+        result = Call(value->dtype, builtin::call_extern(), reduce_args);
+      }
+      return result;
+    };
+
+    PrimExpr neg_inf = make_const(args.m->dtype, -INFINITY);
+    Array<Stmt> stmts;
+    stmts.push_back(BufferStore(temp, m, {0}));
+    stmts.push_back(make_unrolled(score_cols, BufferStore(args.m, Max(m, score), stat_indices)));
+    if (!all_reduces.empty()) stmts.push_back(BufferStore(args.m, all_reduce("tl::MaxOp", m),
+                                                          stat_indices));
+    stmts.push_back(BufferStore(temp, if_then_else(m == neg_inf, make_zero(m->dtype), m * scale),
+                                {2}));
+    stmts.push_back(BufferStore(temp, exp2(rescale * scale - ref), {0}));
+    stmts.push_back(BufferStore(temp, make_zero(m->dtype), {1}));
+    stmts.push_back(make_unrolled(
+        score_cols, SeqStmt({BufferStore(args.scores, exp2(score * scale - ref), score_indices),
+                             BufferStore(temp, row_sum + score, {1})})));
+    if (!all_reduces.empty()) stmts.push_back(BufferStore(temp, all_reduce("tl::SumOp", row_sum),
+                                                          {1}));
+    PrimExpr l = BufferLoad(args.l, stat_indices);
+    stmts.push_back(BufferStore(args.l, l * rescale + row_sum, stat_indices));
+    PrimExpr acc_value = BufferLoad(args.acc, acc_indices);
+    stmts.push_back(make_unrolled(acc_cols, BufferStore(args.acc, acc_value * rescale,
+                                                        acc_indices)));
+
+    Stmt body = For(row->var, 0, row->dom->extent, ForKind::kParallel, SeqStmt(stmts));
+    return PartitionLoop(body.as<ForNode>(), thread_var_, analyzer_, stat);
+  }
+
+  /*!
+   * \brief Move a fragment into another layout through the registers.
+   *
+   * The local index j of the dst fragment on the thread tx holds the element Inverse(j, tx) of
+   * the tile, which is the local index l of the src fragment on the thread s. dst[j] = src[l] if s
+   * is tx, as for the accumulators of a gemm and the A operand of the next one, or the value of
+   * src[l] on the lane s with tl::shfl_sync if s is in the warp of tx and l does not depend on tx
+   * (each lane gives its element l at the step j). The steps are proven on an unrolled loop over j,
+   * or one by one with j constant, and the fragment goes through the shared memory otherwise.
+   */
+  Stmt LowerShuffleLayout(const Array<PrimExpr>& call_args) {
+    ShuffleLayoutArgs args = ShuffleLayoutArgs::Parse(call_args, buffer_data_to_buffer_);
+    ICHECK(args.src.scope() == "local" && args.dst.scope() == "local")
+        << "The shuffle requires fragments, got " << args.src << " and " << args.dst;
+    Fragment src = layout_map_[args.src].as<Fragment>().value();
+    Fragment dst = layout_map_[args.dst].as<Fragment>().value();
+    ICHECK(src->OutputDim() == 1 && dst->OutputDim() == 1)
+        << "The shuffle requires the fragments with a single local dimension";
+    auto local_size = as_const_int(analyzer_->Simplify(dst->OutputShape()[0]));
+    ICHECK(local_size);
+    Var j("j");
+    if (StructuralEqual()(src, dst)) {
+      Stmt body = BufferStore(args.dst, cast(args.dst->dtype, BufferLoad(args.src, {j})), {j});
+      return For(j, 0, static_cast<int>(*local_size), ForKind::kUnrolled, body);
+    }
+
+    int warp_size = TargetGetWarpSize(target_.get());
+    PrimExpr tx = thread_var_;
+    PrimExpr in_dst = analyzer_->Simplify(tx < dst->ThreadExtent());
+    // the store of the step j, undefined if neither a register move nor a shuffle
+    auto make_step = [&](const PrimExpr& local) -> Optional<Stmt> {
+      Array<PrimExpr> inverse = dst->Inverse()->Forward({local, tx});
+      Array<PrimExpr> indices(inverse.begin(), inverse.begin() + dst->InputDim());
+      PrimExpr src_thread = analyzer_->Simplify(src->ForwardThread(indices, make_zero(tx.dtype())));
+      PrimExpr src_local = analyzer_->Simplify(src->Forward(indices)[0]);
+      if (analyzer_->CanProveEqual(src_thread, tx)) {
+        Stmt store = BufferStore(args.dst, cast(args.dst->dtype, BufferLoad(args.src, {src_local})),
+                                 {local});
+        return is_one(in_dst) ? store : IfThenElse(in_dst, store);
+      }
+      bool same_warp = analyzer_->CanProveEqual(floordiv(src_thread, warp_size),
+                                                floordiv(tx, warp_size));
+      auto uses_tx = [&](const VarNode* v) { return v == thread_var_.get(); };
+      if (!same_warp || UsesVar(src_local, uses_tx)) return NullOpt;
+      // all the lanes take part in the shuffle, the ones out of dst only fill unused registers
+      PrimExpr value = Call(args.src->dtype, builtin::call_extern(),
+                            {StringImm("tl::shfl_sync"), BufferLoad(args.src, {src_local}),
+                             floormod(src_thread, warp_size)});
+      return BufferStore(args.dst, cast(args.dst->dtype, value), {local});
+    };
+
+    analyzer_->Bind(j, Range(0, static_cast<int>(*local_size)));
+    if (auto step = make_step(j)) {
+      return For(j, 0, static_cast<int>(*local_size), ForKind::kUnrolled, step.value());
+    }
+    Array<Stmt> steps;
+    for (int64_t i = 0; i < *local_size; i++) {
+      auto step = make_step(make_const(j.dtype(), i));
+      if (!step.defined()) return LowerShuffleLayoutShared(args, src, dst);
+      steps.push_back(step.value());
+    }
+    return SeqStmt(steps);
+  }
+
+  // The shuffle through a shared buffer of the shape of the tile, the threads of src write their
+  // elements and the ones of dst read theirs, the barriers are inserted by ThreadSync.
+  Stmt LowerShuffleLayoutShared(const ShuffleLayoutArgs& args, const Fragment& src,
+                                const Fragment& dst) {
+    Buffer stage = decl_buffer(src->InputShape(), args.src->dtype, args.src->name + "_shuffle",
+                               "shared.dyn");
+    workspaces_.push_back(stage);
+    PrimExpr tx = thread_var_;
+    auto make_loop = [&](const Fragment& layout, auto make_store) {
+      Var local("j");
+      Array<PrimExpr> inverse = layout->Inverse()->Forward({local, tx});
+      Array<PrimExpr> indices(inverse.begin(), inverse.begin() + layout->InputDim());
+      Stmt body = make_store(local, indices);
+      PrimExpr in_layout = analyzer_->Simplify(tx < layout->ThreadExtent());
+      if (!is_one(in_layout)) body = IfThenElse(in_layout, body);
+      return For(local, 0, analyzer_->Simplify(layout->OutputShape()[0]), ForKind::kUnrolled,
+                 body);
+    };
+    Stmt write = make_loop(src, [&](const Var& local, const Array<PrimExpr>& indices) {
+      return BufferStore(stage, BufferLoad(args.src, {local}), indices);
+    });
+    Stmt read = make_loop(dst, [&](const Var& local, const Array<PrimExpr>& indices) {
+      return BufferStore(args.dst, cast(args.dst->dtype, BufferLoad(stage, indices)), {local});
+    });
+    return SeqStmt({write, read});
+  }
+
+  /*!
+   * \brief Reduce a shared buffer into a shared buffer with all the threads of the block.
+   *
+   * Each dst element is reduced by a group of threads (a power of 2 dividing the block size):
+   * the threads of a group accumulate a strided part of the reduced elements in a register, and
+   * the partial results are combined with tl::AllReduce. The groups loop over the dst elements,
+   * all the threads run the same number of iterations since AllReduce may synchronize the block.
+   */
+  Stmt LowerSharedReduce(const ReduceArgs& args) {
+    auto logical_shape = [&](const Buffer& buffer) {
+      return layout_map_.count(buffer) ? layout_map_[buffer]->InputShape() : buffer->shape;
+    };
+    auto physical_indices = [&](const Buffer& buffer, const Array<PrimExpr>& indices) {
+      return layout_map_.count(buffer) ? layout_map_[buffer]->Forward(indices) : indices;
+    };
+    Array<PrimExpr> src_shape = logical_shape(args.src);
+    std::vector<int64_t> out_extents, reduce_extents;
+    int64_t num_out = 1, num_reduce = 1;
+    for (size_t i = 0; i < src_shape.size(); i++) {
+      auto extent = as_const_int(src_shape[i]);
+      ICHECK(extent) << "Reduce of a shared buffer requires a static shape, got " << src_shape;
+      if (std::count(args.dims.begin(), args.dims.end(), int(i))) {
+        reduce_extents.push_back(*extent);
+        num_reduce *= *extent;
+      } else {
+        out_extents.push_back(*extent);
+        num_out *= *extent;
+      }
+    }
+    Array<PrimExpr> dst_shape = logical_shape(args.dst);
+    PrimExpr dst_size = 1;
+    for (const auto& e : dst_shape) dst_size = dst_size * e;
+    ICHECK(analyzer_->CanProveEqual(dst_size, static_cast<int>(num_out)))
+        << "The shape of dst " << dst_shape << " does not match src " << src_shape
+        << " reduced on the dims";
+
+    int threads = thread_block_size_;
+    int group = 1;
+    while (group < num_reduce && group * 2 <= 1024 && threads % (group * 2) == 0 &&
+           num_out * group * 2 <= threads) {
+      group *= 2;
+    }
+    int num_groups = threads / group;
+    int64_t num_passes = (num_out + num_groups - 1) / num_groups;
+    int64_t num_steps = (num_reduce + group - 1) / group;
+
+    // row-major unflatten of a linear index into the given extents
+    auto unflatten = [](PrimExpr index, const std::vector<int64_t>& extents) {
+      std::vector<PrimExpr> indices(extents.size());
+      for (int i = extents.size() - 1; i >= 0; i--) {
+        indices[i] = floormod(index, static_cast<int>(extents[i]));
+        index = floordiv(index, static_cast<int>(extents[i]));
+      }
+      return indices;
+    };
+    Var pass_var("p"), step_var("r");
+    PrimExpr out = pass_var * num_groups + floordiv(thread_var_, group);
+    PrimExpr lane = floormod(thread_var_, group);
+    PrimExpr reduce_index = step_var * group + lane;
+    std::vector<PrimExpr> out_indices = unflatten(out, out_extents);
+    std::vector<PrimExpr> reduce_indices = unflatten(reduce_index, reduce_extents);
+    Array<PrimExpr> src_indices;
+    for (size_t i = 0, out_idx = 0, reduce_idx = 0; i < src_shape.size(); i++) {
+      if (std::count(args.dims.begin(), args.dims.end(), int(i)))
+        src_indices.push_back(reduce_indices[reduce_idx++]);
+      else
+        src_indices.push_back(out_indices[out_idx++]);
+    }
+    Array<PrimExpr> dst_indices;
+    {
+      std::vector<int64_t> dst_extents;
+      for (const auto& e : dst_shape) {
+        ICHECK(as_const_int(e)) << "Reduce into a shared buffer requires a static shape";
+        dst_extents.push_back(*as_const_int(e));
+      }
+      for (const auto& e : unflatten(out, dst_extents)) dst_indices.push_back(e);
+    }
+
+    Buffer acc = decl_buffer({1}, args.dst->dtype, args.dst->name + "_acc", "local");
+    workspaces_.push_back(acc);
+    PrimExpr acc_value = BufferLoad(acc, {0});
+
+    Array<Stmt> stmts;
+    stmts.push_back(BufferStore(acc, args.MakeInitValue(), {0}));
+    Stmt accumulate = BufferStore(
+        acc,
+        args.MakeReduce(acc_value, BufferLoad(args.src, physical_indices(args.src, src_indices))),
+        {0});
+    PrimExpr out_valid = num_out % num_groups == 0 ? Bool(true) : out < static_cast<int>(num_out);
+    PrimExpr reduce_valid =
+        num_reduce % group == 0 ? Bool(true) : reduce_index < static_cast<int>(num_reduce);
+    PrimExpr valid = analyzer_->Simplify(And(out_valid, reduce_valid));
+    if (!is_one(valid)) accumulate = IfThenElse(valid, accumulate);
+    stmts.push_back(For(step_var, 0, static_cast<int>(num_steps), ForKind::kSerial, accumulate));
+    if (group > 1) {
+      std::stringstream ss;
+      ss << "tl::AllReduce<" << args.MakeCodegenReducer() << ", " << group << ", 1>::run";
+      Array<PrimExpr> thread_reduce_args = {StringImm(ss.str()), acc_value};
+      if (group >= 32) thread_reduce_args.push_back(GetWorkspace(threads, args.dst->dtype));
+      stmts.push_back(
+          BufferStore(acc, Call(args.dst->dtype, builtin::call_extern(), thread_reduce_args), {0}));
+    }
+    Array<PrimExpr> dst_physical = physical_indices(args.dst, dst_indices);
+    PrimExpr value = acc_value;
+    if (!args.clear) value = args.MakeReduce(BufferLoad(args.dst, dst_physical), value);
+    PrimExpr store_valid = analyzer_->Simplify(And(out_valid, EQ(lane, 0)));
+    Stmt store = BufferStore(args.dst, value, dst_physical);
+    if (!is_one(store_valid)) store = IfThenElse(store_valid, store);
+    stmts.push_back(store);
+
+    Stmt body = SeqStmt(stmts);
+    if (num_passes > 1)
+      body = For(pass_var, 0, static_cast<int>(num_passes), ForKind::kSerial, body);
+    else
+      body = Substitute(body, {{pass_var, make_zero(pass_var.dtype())}});
+    return body;
+  }
+
+  /*!
+   * \brief Scan the rows of a fragment in the blocked layout of makeScanFragment.
+   *
+   * Each thread scans its contiguous part of a row in registers, the totals of the parts are
+   * scanned among the threads of the row with tl::WarpScan, and the exclusive prefix of each
+   * thread is combined into its elements.
+   */
+  Stmt LowerScan(const Array<PrimExpr>& call_args) {
+    ScanArgs args = ScanArgs::Parse(call_args, buffer_data_to_buffer_);
+    ICHECK(args.src.scope() == "local" && args.dst.scope() == "local")
+        << "Scan requires fragments, got " << args.src << " and " << args.dst;
+    Fragment src = layout_map_[args.src].as<Fragment>().value();
+    Fragment dst = layout_map_[args.dst].as<Fragment>().value();
+    Array<PrimExpr> shape = src->InputShape();
+    ICHECK(StructuralEqual()(src, makeScanFragment(shape, args.dim, thread_block_size_)) &&
+           StructuralEqual()(src, dst))
+        << "Scan requires the blocked layout of " << args.src << " and " << args.dst;
+    int extent = *as_const_int(shape[args.dim]);
+    int lanes = ScanThreadsPerRow(extent, thread_block_size_);
+    int local = extent / lanes;
+    auto local_size = as_const_int(analyzer_->Simplify(src->OutputShape()[0]));
+    ICHECK(local_size);
+    int num_rows = *local_size / local;
+
+    // acc[0] holds the running value, acc[1] the loaded element of an exclusive scan
+    Buffer acc = decl_buffer({2}, args.dst->dtype, args.dst->name + "_scan", "local");
+    workspaces_.push_back(acc);
+    PrimExpr acc_value = BufferLoad(acc, {0});
+    PrimExpr identity = args.MakeIdentity();
+    Var row("j"), col("k");
+    PrimExpr index = row * local + col;
+    PrimExpr src_value = BufferLoad(args.src, {index});
+    auto make_unrolled = [](const Var& var, int extent, Stmt body) {
+      return For(var, 0, extent, ForKind::kUnrolled, body, NullOpt,
+                 {{tir::attr::pragma_unroll_explicit, Bool(false)}});
+    };
+
+    Array<Stmt> stmts;
+    stmts.push_back(BufferStore(acc, identity, {0}));
+    Stmt scan_local;
+    if (args.exclusive) {
+      // load first, src and dst can be the same buffer
+      scan_local = SeqStmt({BufferStore(acc, cast(args.dst->dtype, src_value), {1}),
+                            BufferStore(args.dst, acc_value, {index}),
+                            BufferStore(acc, args.MakeCombine(acc_value, BufferLoad(acc, {1})),
+                                        {0})});
+    } else {
+      scan_local = SeqStmt({BufferStore(acc, args.MakeCombine(acc_value, src_value), {0}),
+                            BufferStore(args.dst, acc_value, {index})});
+    }
+    stmts.push_back(make_unrolled(col, local, scan_local));
+    if (lanes > 1) {
+      std::stringstream ss;
+      ss << "tl::WarpScan<" << args.MakeCodegenOp() << ", " << lanes << ">::exclusive";
+      auto prefix = Call(args.dst->dtype, builtin::call_extern(),
+                         {StringImm(ss.str()), acc_value, identity});
+      stmts.push_back(BufferStore(acc, prefix, {0}));
+      // a loop var is bound once
+      Var col_prefix("k");
+      PrimExpr prefix_index = row * local + col_prefix;
+      PrimExpr dst_value = BufferLoad(args.dst, {prefix_index});
+      stmts.push_back(make_unrolled(
+          col_prefix, local,
+          BufferStore(args.dst, args.MakeCombine(acc_value, dst_value), {prefix_index})));
+    }
+    return make_unrolled(row, num_rows, SeqStmt(stmts));
+  }
+
+  /*!
+   * \brief Select the top k of the rows of a shared buffer with tl::TopK, all the threads of the
+   * block select each row in turn: a radix select of the k-th largest element with shared memory
+   * histograms, a compaction of the selected elements with warp ballots and a bitonic sort.
+   */
+  Stmt LowerTopK(const Array<PrimExpr>& call_args) {
+    TopKArgs args = TopKArgs::Parse(call_args, buffer_data_to_buffer_);
+    for (const Buffer& buffer : {args.src, args.values, args.indices}) {
+      ICHECK(buffer.scope() == "shared" || buffer.scope() == "shared.dyn")
+          << "TopK requires shared buffers, got " << buffer << " in " << buffer.scope();
+      ICHECK(!layout_map_.count(buffer))
+          << "TopK requires the row-major layout of " << buffer << ", got " << layout_map_[buffer];
+    }
+    int64_t rows = 1;
+    for (size_t i = 0; i + 1 < args.src->shape.size(); i++) {
+      auto extent = as_const_int(args.src->shape[i]);
+      ICHECK(extent) << "TopK requires a static shape, got " << args.src->shape;
+      rows *= *extent;
+    }
+    auto n = as_const_int(args.src->shape.back());
+    auto k = as_const_int(args.values->shape.back());
+    ICHECK(n && k) << "TopK requires a static shape, got " << args.src->shape << " and "
+                   << args.values->shape;
+    int warp_size = TargetGetWarpSize(target_.get());
+    ICHECK(thread_block_size_ % warp_size == 0)
+        << "TopK requires whole warps, got " << thread_block_size_ << " threads";
+    // the histogram, the state of the select and the selected keys and indices, see tl::TopK
+    int capacity = 1;
+    while (capacity < *k) capacity *= 2;
+    PrimExpr workspace = GetWorkspace(256 + 4 + 2 * capacity, DataType::Int(32));
+    std::stringstream ss;
+    ss << "tl::TopK<" << thread_block_size_ << ", " << *k << ">::run";
+    Array<PrimExpr> topk_args = {StringImm(ss.str()),
+                                 args.src.access_ptr(1),
+                                 args.values.access_ptr(3),
+                                 args.indices.access_ptr(3),
+                                 static_cast<int>(rows),
+                                 static_cast<int>(*n),
+                                 cast(DataType::Int(32), args.valid),
+                                 cast(DataType::Int(32), args.index_offset),
+                                 Bool(args.merge),
+                                 workspace};
+    return Evaluate(Call(DataType::Handle(), builtin::call_extern(), topk_args));
+  }
+
   Stmt LowerGemm(const Array<PrimExpr>& call_args) {
     GemmArgs args = GemmArgs::Parse(call_args, buffer_data_to_buffer_);
-    ICHECK(thread_block_size_ % 32 == 0);
-    auto [warp_m, warp_n] = args.ComputeWarpPartition(thread_block_size_ / 32);
+    int warp_size = TargetGetWarpSize(target_.get());
+    ICHECK(thread_block_size_ % warp_size == 0);
+    int num_warps = thread_block_size_ / warp_size;
+    auto [warp_m, warp_n] = args.ComputeWarpPartition(num_warps, target_.get());
+    if (gemm_ptx_mma_ && !args.CheckWGMMA(num_warps, target_.get()) &&
+        TargetIsAmpereOrLater(target_.get())) {
+      if (auto stmt = LowerGemmPTX(args, warp_m, warp_n)) return stmt.value();
+      LOG(WARNING) << "tl.gemm_ptx_mma: the gemm of " << args.A << " and " << args.B << " into "
+                   << args.C << " is not supported by the mma builtins, it is lowered to the "
+                   << "CUTLASS templates";
+    }
     std::stringstream ss;
     std::string op_name = "tl::gemm_ss";
-    if (args.A.scope() == "local") {
+    if (args.CheckWGMMA(num_warps, target_.get())) {
+      op_name = args.A.scope() == "local" ? "tl::wgmma_rs" : "tl::wgmma_ss";
+    } else if (args.A.scope() == "local") {
       ICHECK(args.B.scope() != "local");
       op_name = "tl::gemm_rs";
     } else if (args.B.scope() == "local") {
       op_name = "tl::gemm_sr";
     }
+    if (!args.b_format.empty()) {
+      ICHECK(op_name == "tl::gemm_ss" || op_name == "tl::gemm_rs")
+          << "The quantized B should be in shared memory";
+      ICHECK_EQ(args.promote_every, 0) << "The quantized gemm accumulates in the dtype of C";
+      op_name += "_dequant";
+    } else if (!args.prologue.empty()) {
+      ICHECK(op_name == "tl::gemm_ss" || op_name == "tl::gemm_sr")
+          << "The prologue transforms the shared A on load";
+      op_name += "_prologue";
+    } else if (args.promote_every > 0) {
+      op_name += "_promote";
+    }
     ss << op_name << "<" << args.M << ", " << args.N << ", " << args.K << ", ";
     ss << warp_m << ", " << warp_n << ", ";
-    ss << args.trans_A << ", " << args.trans_B << ">";
+    ss << args.trans_A << ", " << args.trans_B;
+    if (!args.b_format.empty()) {
+      static const std::unordered_map<std::string, std::string> formats = {
+          {"int4", "kInt4"}, {"uint4", "kUInt4"}, {"fp4", "kFP4"}, {"nf4", "kNF4"}};
+      ss << ", tl::DequantFormat::" << formats.at(args.b_format) << ", " << args.group_size
+         << ", " << args.scale.defined() << ", " << args.zeros.defined();
+    } else if (!args.prologue.empty()) {
+      static const std::unordered_map<std::string, std::string> ops = {
+          {"mul_m", "kMulM"}, {"mul_k", "kMulK"}, {"add_m", "kAddM"}, {"add_k", "kAddK"},
+          {"scale", "kScale"}, {"relu", "kRelu"}, {"silu", "kSilu"}, {"gelu", "kGelu"}};
+      ss << ", " << args.promote_every;
+      for (const std::string& op : args.prologue) {
+        ss << ", tl::PrologueOp::" << ops.at(op);
+      }
+    } else if (args.promote_every > 0) {
+      ss << ", " << args.promote_every;
+    }
+    ss << ">";
 
     Array<PrimExpr> new_args;
     new_args.push_back(StringImm(ss.str()));
     new_args.push_back(call_args[0]);
     new_args.push_back(call_args[1]);
     new_args.push_back(call_args[2]);
+    if (!args.b_format.empty()) {
+      new_args.push_back(call_args[12]);
+      new_args.push_back(call_args[13]);
+    }
+    for (const PrimExpr& operand : args.prologue_operands) {
+      new_args.push_back(operand);
+    }
     auto new_call = Call(DataType::Handle(), builtin::call_extern(), new_args);
     return Evaluate(new_call);
   }
 
+  /*!
+   * \brief Lower a gemm into the ldmatrix and mma.sync (m16n8k16) builtins rather than a call of
+   *  the CUTLASS templates, with the pass config tl.gemm_ptx_mma.
+   *
+   * The warp w computes the tile of the rows w % warp_m and the columns w / warp_m of C, as in
+   * makeGemmFragmentC. At each step of 16 along K, the 16-row tiles of A of the warp are loaded
+   * with ldmatrix.x4 (unless A is a fragment already) and its 8-column tiles of B with
+   * ldmatrix.x2, then each 16x8 tile of C is accumulated by an mma. The registers of C and of a
+   * fragment A are located with their layouts, which must give the elements of an mma operand
+   * to the lane of the mma at consecutive offsets. NullOpt if the gemm is not supported.
+   */
+  Optional<Stmt> LowerGemmPTX(const GemmArgs& args, int warp_m, int warp_n) {
+    auto is_shared = [](const Buffer& buffer) {
+      return buffer.scope() == "shared" || buffer.scope() == "shared.dyn";
+    };
+    DataType ab_dtype = args.A->dtype, c_dtype = args.C->dtype;
+    if (!(ab_dtype.is_float16() || ab_dtype.is_bfloat16()) || args.B->dtype != ab_dtype ||
+        !(c_dtype == DataType::Float(32) || (ab_dtype.is_float16() && c_dtype.is_float16()))) {
+      return NullOpt;
+    }
+    if (!args.b_format.empty() || !args.prologue.empty() || args.promote_every > 0 ||
+        !is_shared(args.B) || !(is_shared(args.A) || args.A.scope() == "local") ||
+        args.C.scope() != "local") {
+      return NullOpt;
+    }
+    if (args.M % warp_m != 0 || args.N % warp_n != 0 || args.K % 16 != 0) return NullOpt;
+    int tile_m = args.M / warp_m, tile_n = args.N / warp_n;
+    if (tile_m % 16 != 0 || tile_n % 8 != 0) return NullOpt;
+    for (const Buffer& buffer : {args.A, args.B, args.C}) {
+      if (!layout_map_.count(buffer)) return NullOpt;
+      // the rows of 8 elements loaded by ldmatrix must be contiguous and 16 bytes aligned
+      if (is_shared(buffer) && layout_map_[buffer]->VectorSize() < 8) return NullOpt;
+    }
+
+    PrimExpr tx = thread_var_;
+    PrimExpr lane = FloorMod(tx, 32), warp = FloorDiv(tx, 32);
+    PrimExpr group = FloorDiv(lane, 4), thread_in_group = FloorMod(lane, 4);
+    PrimExpr row0 = FloorMod(warp, warp_m) * tile_m, col0 = FloorDiv(warp, warp_m) * tile_n;
+    int num_m = tile_m / 16, num_n = tile_n / 8, num_k = args.K / 16;
+    Var ki("ki"), mi("mi"), ni("ni");
+    analyzer_->Bind(ki, Range(0, num_k));
+    analyzer_->Bind(mi, Range(0, num_m));
+    analyzer_->Bind(ni, Range(0, num_n));
+    // the register offset of the elements of an mma operand, held by the lane at consecutive
+    // offsets independent of the thread, undefined otherwise
+    auto uses_tx = [&](const VarNode* v) { return v == thread_var_.get(); };
+    auto register_offset = [&](const Buffer& buffer, const std::vector<Array<PrimExpr>>& elems,
+                               const PrimExpr& rep) -> Optional<PrimExpr> {
+      auto layout = layout_map_[buffer].as<Fragment>();
+      if (!layout.defined() || layout.value()->OutputDim() != 1) return NullOpt;
+      PrimExpr first = analyzer_->Simplify(layout.value()->Forward(elems[0])[0]);
+      if (UsesVar(first, uses_tx)) return NullOpt;
+      for (size_t i = 0; i < elems.size(); i++) {
+        if (!analyzer_->CanProveEqual(layout.value()->Forward(elems[i])[0],
+                                      first + static_cast<int>(i)) ||
+            !analyzer_->CanProveEqual(layout.value()->ForwardThread(elems[i], rep), tx)) {
+          return NullOpt;
+        }
+      }
+      return first;
+    };
+    // the 16x8 tile (mi, ni) of C: c0, c1 at the row group and the columns 2 * thread_in_group
+    // and the next one, c2, c3 at the row group + 8
+    PrimExpr row = row0 + mi * 16 + group, col = col0 + ni * 8 + thread_in_group * 2;
+    Optional<PrimExpr> c_offset = register_offset(
+        args.C, {{row, col}, {row, col + 1}, {row + 8, col}, {row + 8, col + 1}}, 0);
+    if (!c_offset.defined()) return NullOpt;
+    // the 16x16 tile (mi, ki) of a fragment A, replicated over the warps along N
+    Optional<PrimExpr> a_offset;
+    if (!is_shared(args.A)) {
+      if (args.trans_A) return NullOpt;
+      PrimExpr k = ki * 16 + thread_in_group * 2;
+      std::vector<Array<PrimExpr>> elems;
+      for (int k_half : {0, 8}) {
+        for (int m_half : {0, 8}) {
+          elems.push_back({row + m_half, k + k_half});
+          elems.push_back({row + m_half, k + k_half + 1});
+        }
+      }
+      a_offset = register_offset(args.A, elems, FloorDiv(warp, warp_m));
+      if (!a_offset.defined()) return NullOpt;
+    }
+
+    auto smem_address = [&](const Buffer& buffer, const PrimExpr& i, const PrimExpr& j) {
+      Array<PrimExpr> indices = layout_map_[buffer]->Forward({i, j});
+      indices = indices.Map([&](const PrimExpr& e) { return analyzer_->Simplify(e); });
+      return Call(DataType::Handle(), builtin::address_of(), {BufferLoad(buffer, indices)});
+    };
+    auto ldmatrix = [&](bool trans, int num, const Buffer& regs, const PrimExpr& offset,
+                        const PrimExpr& address) {
+      return Evaluate(Call(ab_dtype, builtin::ptx_ldmatrix(),
+                           {Bool(trans), num, StringImm(".b16"), regs->data, offset, address, 0}));
+    };
+    // the registers of the shared operands are double buffered: the loads of the step k + 1 are
+    // issued before the mma of the step k, which they overlap
+    Buffer a_regs, b_regs = decl_buffer({2 * num_n * 4}, ab_dtype, args.B->name + "_regs", "local");
+    if (is_shared(args.A)) {
+      a_regs = decl_buffer({2 * num_m * 8}, ab_dtype, args.A->name + "_regs", "local");
+    }
+    auto make_loads = [&](const PrimExpr& k_step) {
+      Array<Stmt> loads;
+      PrimExpr k = k_step * 16, stage = FloorMod(k_step, 2);
+      if (a_regs.defined()) {
+        // the lanes 8 * q to 8 * q + 7 give the rows of the 8x8 matrix q of a 16x16 tile, q % 2
+        // selects the half along M and q / 2 the half along K
+        Var i("i");
+        PrimExpr m = row0 + i * 16;
+        PrimExpr address =
+            args.trans_A ? smem_address(args.A, k + FloorMod(lane, 8) + FloorDiv(lane, 16) * 8,
+                                        m + FloorMod(FloorDiv(lane, 8), 2) * 8)
+                         : smem_address(args.A, m + FloorMod(lane, 16), k + FloorDiv(lane, 16) * 8);
+        loads.push_back(
+            For(i, 0, num_m, ForKind::kUnrolled,
+                ldmatrix(args.trans_A, 4, a_regs, (stage * num_m + i) * 8, address)));
+      }
+      // the lanes 0 to 7 give the rows of the 8x8 matrix of the first 8 k of an 8-column tile,
+      // the lanes 8 to 15 the ones of the next 8 k
+      Var j("j");
+      PrimExpr n = col0 + j * 8;
+      PrimExpr address = args.trans_B ? smem_address(args.B, n + FloorMod(lane, 8),
+                                                     k + FloorMod(FloorDiv(lane, 8), 2) * 8)
+                                      : smem_address(args.B, k + FloorMod(lane, 16), n);
+      loads.push_back(For(j, 0, num_n, ForKind::kUnrolled,
+                          ldmatrix(!args.trans_B, 2, b_regs, (stage * num_n + j) * 4, address)));
+      return SeqStmt::Flatten(loads);
+    };
+
+    PrimExpr stage = FloorMod(ki, 2);
+    if (a_regs.defined()) a_offset = (stage * num_m + mi) * 8;
+    Buffer a_source = a_regs.defined() ? a_regs : args.A;
+    std::string ab_name = runtime::DLDataType2String(ab_dtype);
+    std::string c_name = runtime::DLDataType2String(c_dtype);
+    Stmt mma = Evaluate(Call(DataType::Void(), builtin::ptx_mma(),
+                             {StringImm("m16n8k16"), StringImm("row"), StringImm("col"),
+                              StringImm(ab_name), StringImm(ab_name), StringImm(c_name),
+                              a_source->data, a_offset.value(), b_regs->data,
+                              (stage * num_n + ni) * 4, args.C->data, c_offset.value(),
+                              Bool(false)}));
+    Stmt step = SeqStmt({IfThenElse(ki + 1 < num_k, make_loads(ki + 1)),
+                         For(mi, 0, num_m, ForKind::kUnrolled,
+                             For(ni, 0, num_n, ForKind::kUnrolled, mma))});
+    if (a_regs.defined()) workspaces_.push_back(a_regs);
+    workspaces_.push_back(b_regs);
+    return SeqStmt({make_loads(0), For(ki, 0, num_k, ForKind::kUnrolled, step)});
+  }
+
+  // The sparse gemm with mma.sp, the warps are partitioned as for the dense gemm on mma.sync
+  Stmt LowerGemmSp(const Array<PrimExpr>& call_args) {
+    GemmArgs args = GemmArgs::ParseSparse(call_args, buffer_data_to_buffer_);
+    int warp_size = TargetGetWarpSize(target_.get());
+    ICHECK(thread_block_size_ % warp_size == 0);
+    auto [warp_m, warp_n] = args.ComputeWarpPartition(thread_block_size_ / warp_size,
+                                                      target_.get());
+    std::stringstream ss;
+    ss << "tl::gemm_sp_ss<" << args.M << ", " << args.N << ", " << args.K << ", " << warp_m << ", "
+       << warp_n << ", " << args.trans_B << ">";
+    auto new_call = Call(DataType::Handle(), builtin::call_extern(),
+                         {StringImm(ss.str()), call_args[0], call_args[9], call_args[1],
+                          call_args[2]});
+    return Evaluate(new_call);
+  }
+
   Stmt VisitStmt_(const AttrStmtNode* op) final {
     if (op->attr_key == tir::attr::thread_extent) {
       IterVar iv = Downcast<IterVar>(op->node);
@@ -216,9 +1152,16 @@ class LowerTileOpPass : arith::IRMutatorWithAnalyzer {
 
   Map<Var, Buffer> buffer_data_to_buffer_;
   Map<Buffer, Layout> layout_map_;
+  Target target_;
+  // lower the gemms into the ldmatrix and mma builtins, see LowerGemmPTX
+  bool gemm_ptx_mma_ = false;
+  // tensor maps with their encoding arguments, see tvm_tensormap_create_tiled
+  std::vector<std::pair<Var, Array<PrimExpr>>> tensor_maps_;
   Var thread_var_;
   size_t thread_block_size_ = 0;
   Array<Buffer> workspaces_;
+  // the workspaces of tl::AllReduce allocated in the current block, see GetWorkspace
+  Array<Buffer> reduce_workspaces_;
 };
 
 namespace transform {
@@ -229,7 +1172,7 @@ tvm::transform::Pass LowerTileOp() {
   auto pass_func = [=](PrimFunc f, IRModule m, PassContext ctx) {
     return LowerTileOpPass::Substitute(std::move(f));
   };
-  return CreatePrimFuncPass(pass_func, 0, "tl.LowerTileOp", {});
+  return CreatePrimFuncPass(pass_func, 0, "tl.LowerTileOp", {}, /*function_local=*/true);
 }
 
 TVM_REGISTER_GLOBAL("tl.LowerTileOp").set_body_typed(LowerTileOp);
@@ -0,0 +1,469 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file lower_tile_op_cpu.cc
+ * \brief Lower the tile programs to the loops of the CPU targets.
+ */
+
+#include <tvm/tir/builtin.h>
+#include <tvm/tir/stmt_functor.h>
+#include <tvm/tir/transform.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../arith/ir_mutator_with_analyzer.h"
+#include "op.h"
+
+namespace tvm {
+namespace tl {
+
+using namespace tir;
+
+// The lanes of the vectorized innermost loops, one AVX-512 register of float32 (LLVM splits it
+// into the registers of the narrower vector units)
+static constexpr int kCPUVectorLanes = 16;
+
+/*!
+ * \brief A T.Kernel runs on the CPU as a parallel loop over its blocks, lowered by the LLVM
+ * codegen to TVMBackendParallelLaunch on the TVM thread pool. The threads of a block are dropped:
+ * the tile ops are lowered to loops running the whole tile in one CPU thread, the T.Parallel loops
+ * become serial loops with the innermost one vectorized, so the fragments are processed in vector
+ * registers.
+ */
+class CPUTileOpLowerer : public arith::IRMutatorWithAnalyzer {
+ public:
+  static PrimFunc Substitute(PrimFunc f) {
+    arith::Analyzer analyzer;
+    CPUTileOpLowerer substituter(&analyzer);
+    for (const auto& [_, buffer] : f->buffer_map) {
+      substituter.buffer_data_to_buffer_.Set(buffer->data, buffer);
+    }
+    PrimFuncNode* fptr = f.CopyOnWrite();
+    fptr->body = substituter.VisitStmt(f->body);
+    return f;
+  }
+
+ private:
+  using arith::IRMutatorWithAnalyzer::IRMutatorWithAnalyzer;
+
+  Stmt VisitStmt_(const BlockNode* op) final {
+    for (auto buffer : op->alloc_buffers) buffer_data_to_buffer_.Set(buffer->data, buffer);
+    auto block = Downcast<Block>(arith::IRMutatorWithAnalyzer::VisitStmt_(op));
+    if (!workspaces_.empty()) {
+      auto block_ptr = block.CopyOnWrite();
+      for (const auto& buffer : workspaces_) block_ptr->alloc_buffers.push_back(buffer);
+      workspaces_.clear();
+    }
+    return block;
+  }
+
+  Stmt VisitStmt_(const AttrStmtNode* op) final {
+    if (op->attr_key == attr::kMinBlocksPerSM || op->attr_key == attr::kClusterSize ||
+        op->attr_key == attr::kKernelSchedule) {
+      return VisitStmt(op->body);
+    }
+    if (op->attr_key != tir::attr::thread_extent) {
+      return arith::IRMutatorWithAnalyzer::VisitStmt_(op);
+    }
+    IterVar iv = Downcast<IterVar>(op->node);
+    if (iv->thread_tag.rfind("threadIdx", 0) == 0) {
+      ICHECK(!UsesVar(op->body, [&](const VarNode* var) { return var == iv->var.get(); }))
+          << "The CPU targets run the tile ops of a block in one thread, " << iv->thread_tag
+          << " can not be used in the kernel";
+      return VisitStmt(op->body);
+    }
+    ICHECK(iv->thread_tag.rfind("blockIdx", 0) == 0) << "Unknown thread tag " << iv->thread_tag;
+    bool outermost = block_vars_.empty();
+    block_vars_.emplace_back(iv->var, op->value);
+    analyzer_->Bind(iv->var, Range::FromMinExtent(0, op->value));
+    Stmt body = VisitStmt(op->body);
+    if (!outermost) return body;
+
+    // the blocks of the grid fused into one parallel loop, blockIdx.x being the fastest
+    Var block("block_idx", op->value.dtype());
+    PrimExpr rest = block, num_blocks = make_const(op->value.dtype(), 1);
+    std::vector<std::pair<Var, PrimExpr>> bindings;
+    for (size_t i = 0; i < block_vars_.size(); i++) {
+      const auto& [var, extent] = block_vars_[i];
+      bool last = i + 1 == block_vars_.size();
+      bindings.emplace_back(var, last ? rest : floormod(rest, extent));
+      rest = floordiv(rest, extent);
+      num_blocks = num_blocks * extent;
+    }
+    for (auto it = bindings.rbegin(); it != bindings.rend(); it++) {
+      body = LetStmt(it->first, it->second, body);
+    }
+    block_vars_.clear();
+    return For(block, 0, analyzer_->Simplify(num_blocks), ForKind::kParallel, body);
+  }
+
+  Stmt VisitStmt_(const ForNode* op) final {
+    int num_parallel = num_parallel_loops_;
+    For loop = Downcast<For>(arith::IRMutatorWithAnalyzer::VisitStmt_(op));
+    if (block_vars_.empty()) return loop;
+    // the annotations of T.Pipelined and of the layout inference have no use here
+    loop.CopyOnWrite()->annotations = {};
+    if (loop->kind != ForKind::kParallel) return loop;
+    bool innermost = num_parallel_loops_ == num_parallel;
+    num_parallel_loops_++;
+    loop.CopyOnWrite()->kind = ForKind::kSerial;
+    return innermost ? Vectorize(loop) : loop;
+  }
+
+  Stmt VisitStmt_(const EvaluateNode* node) final {
+    if (auto call = node->value.as<CallNode>()) {
+      if (call->op.same_as(tl::gemm())) {
+        return LowerGemm(call->args);
+      } else if (call->op.same_as(tl::reduce())) {
+        return LowerReduce(call->args);
+      } else if (call->op.same_as(tl::scan())) {
+        return LowerScan(call->args);
+      } else if (call->op.same_as(tl::online_softmax())) {
+        return LowerOnlineSoftmax(call->args);
+      } else if (call->op.same_as(tl::shuffle_layout())) {
+        return LowerShuffleLayout(call->args);
+      } else if (call->op.same_as(tl::gemm_sp())) {
+        LOG(FATAL) << "The CPU targets do not support the 2:4 sparse gemm (T.gemm_sp)";
+      }
+      if (auto op = call->op.as<OpNode>()) {
+        ICHECK(op->name.rfind("tl.", 0) != 0) << "The CPU targets do not support " << op->name;
+      }
+      if (call->op.same_as(builtin::call_extern())) {
+        auto name = call->args[0].as<StringImmNode>();
+        ICHECK(name == nullptr || name->value.rfind("tl::", 0) != 0)
+            << "The CPU targets do not support " << name->value
+            << ", the atomics and the semaphores across the blocks are CUDA only";
+      }
+    }
+    return arith::IRMutatorWithAnalyzer::VisitStmt_(node);
+  }
+
+  // The innermost loop vectorized by kCPUVectorLanes, or serial if its extent is not a multiple
+  static Stmt Vectorize(For loop) {
+    auto extent = as_const_int(loop->extent);
+    if (extent == nullptr || !is_zero(loop->min)) return loop;
+    if (*extent <= kCPUVectorLanes) {
+      loop.CopyOnWrite()->kind = ForKind::kVectorized;
+      return loop;
+    }
+    if (*extent % kCPUVectorLanes != 0) return loop;
+    Var outer = loop->loop_var.copy_with_suffix("_outer");
+    Var inner = loop->loop_var.copy_with_suffix("_inner");
+    Map<Var, PrimExpr> vmap;
+    vmap.Set(loop->loop_var, outer * kCPUVectorLanes + inner);
+    Stmt body = tir::Substitute(loop->body, vmap);
+    body = For(inner, 0, kCPUVectorLanes, ForKind::kVectorized, body);
+    return For(outer, 0, static_cast<int>(*extent / kCPUVectorLanes), ForKind::kSerial, body);
+  }
+
+  static Stmt MakeLoops(const Array<Var>& vars, const Array<PrimExpr>& extents, Stmt body) {
+    for (int i = vars.size() - 1; i >= 0; i--) {
+      body = For(vars[i], 0, extents[i], ForKind::kSerial, body);
+    }
+    return body;
+  }
+
+  /*!
+   * \brief The gemm as the i-k-j loop nest accumulating the rows of C, the j loop vectorized into
+   * the FMAs of the vector units of the target (AVX-512, AVX2 or NEON) by the LLVM codegen.
+   */
+  Stmt LowerGemm(const Array<PrimExpr>& call_args) {
+    GemmArgs args = GemmArgs::Parse(call_args, buffer_data_to_buffer_);
+    ICHECK(args.b_format.empty()) << "The CPU targets do not support the quantized gemm";
+    ICHECK(args.prologue.empty()) << "The CPU targets do not support the gemm prologue";
+    ICHECK(!args.IsFP8Gemm()) << "The CPU targets do not support the float8 gemm";
+    ICHECK_EQ(args.promote_every, 0)
+        << "The CPU targets do not support the float16 accumulation promoted into a float32 C, "
+        << "accum=\"fp16\" requires a float16 C";
+    for (const auto& buffer : {args.A, args.B, args.C}) {
+      ICHECK(buffer->shape.size() == 2) << "The gemm requires 2-d operands, got " << buffer;
+    }
+    Var i("i"), j("j"), k("k");
+    PrimExpr a = BufferLoad(args.A, args.trans_A ? Array<PrimExpr>{k, i} : Array<PrimExpr>{i, k});
+    PrimExpr b = BufferLoad(args.B, args.trans_B ? Array<PrimExpr>{j, k} : Array<PrimExpr>{k, j});
+    DataType dtype = args.C->dtype;
+    PrimExpr c = BufferLoad(args.C, {i, j});
+    Stmt body = BufferStore(args.C, c + cast(dtype, a) * cast(dtype, b), {i, j});
+    body = Vectorize(For(j, 0, args.N, ForKind::kSerial, body));
+    return MakeLoops({i, k}, {args.M, args.K}, body);
+  }
+
+  Stmt LowerReduce(const Array<PrimExpr>& call_args) {
+    ReduceArgs args = ReduceArgs::Parse(call_args, buffer_data_to_buffer_);
+    using ReduceType = ReduceArgs::ReduceType;
+    bool is_argmax = args.type == ReduceType::kArgMax;
+    bool is_welford = args.type == ReduceType::kWelford;
+    ICHECK(!is_argmax || args.dims.size() == 1) << "argmax reduces a single dim";
+    Array<Var> dst_vars, reduce_vars;
+    Array<PrimExpr> dst_extents, reduce_extents, src_indices, dst_indices;
+    for (size_t i = 0; i < args.src->shape.size(); i++) {
+      if (std::find(args.dims.begin(), args.dims.end(), static_cast<int>(i)) != args.dims.end()) {
+        Var var("rv" + std::to_string(reduce_vars.size()));
+        reduce_vars.push_back(var);
+        reduce_extents.push_back(args.src->shape[i]);
+        src_indices.push_back(var);
+      } else {
+        Var var(std::string{char('i' + dst_vars.size())});
+        dst_vars.push_back(var);
+        dst_extents.push_back(args.src->shape[i]);
+        src_indices.push_back(var);
+        dst_indices.push_back(var);
+      }
+    }
+    if (dst_indices.empty()) dst_indices.push_back(0);
+
+    Array<Stmt> stmts;
+    if (args.clear || is_argmax || is_welford)
+      stmts.push_back(BufferStore(args.dst, args.MakeInitValue(), dst_indices));
+    if (is_argmax) stmts.push_back(BufferStore(args.aux, make_const(args.aux->dtype, -1),
+                                               dst_indices));
+    if (is_welford) stmts.push_back(BufferStore(args.aux, make_zero(args.aux->dtype), dst_indices));
+
+    PrimExpr src_value = BufferLoad(args.src, src_indices);
+    PrimExpr dst_value = BufferLoad(args.dst, dst_indices);
+    Stmt reduce;
+    if (is_argmax) {
+      // the first index wins the ties
+      PrimExpr value = cast(args.dst->dtype, src_value);
+      reduce = IfThenElse(value > dst_value,
+                          SeqStmt({BufferStore(args.dst, value, dst_indices),
+                                   BufferStore(args.aux, cast(args.aux->dtype, reduce_vars[0]),
+                                               dst_indices)}));
+    } else if (is_welford) {
+      // the welford update with the 1-based position n among the reduced elements, aux holds M2
+      PrimExpr n = 0;
+      for (size_t i = 0; i < reduce_vars.size(); i++) n = n * reduce_extents[i] + reduce_vars[i];
+      n = cast(args.dst->dtype, n + 1);
+      PrimExpr delta = cast(args.dst->dtype, src_value) - dst_value;
+      PrimExpr m2 = BufferLoad(args.aux, dst_indices) + delta * delta * (n - 1) / n;
+      reduce = SeqStmt({BufferStore(args.aux, m2, dst_indices),
+                        BufferStore(args.dst, dst_value + delta / n, dst_indices)});
+    } else {
+      reduce = BufferStore(args.dst, args.MakeReduce(dst_value, src_value), dst_indices);
+    }
+    stmts.push_back(MakeLoops(reduce_vars, reduce_extents, reduce));
+    // the variance from M2
+    if (is_welford) {
+      PrimExpr count = 1;
+      for (const auto& extent : reduce_extents) count = count * extent;
+      PrimExpr variance = BufferLoad(args.aux, dst_indices) / cast(args.aux->dtype, count);
+      stmts.push_back(BufferStore(args.aux, variance, dst_indices));
+    }
+    return MakeLoops(dst_vars, dst_extents, SeqStmt::Flatten(stmts));
+  }
+
+  // The fragments are plain arrays, the shuffle is an element-wise copy
+  Stmt LowerShuffleLayout(const Array<PrimExpr>& call_args) {
+    ShuffleLayoutArgs args = ShuffleLayoutArgs::Parse(call_args, buffer_data_to_buffer_);
+    Array<Var> vars;
+    for (size_t i = 0; i < args.src->shape.size(); i++) {
+      vars.push_back(Var(std::string{char('i' + i)}));
+    }
+    Array<PrimExpr> indices(vars.begin(), vars.end());
+    PrimExpr value = cast(args.dst->dtype, BufferLoad(args.src, indices));
+    Stmt body = BufferStore(args.dst, value, indices);
+    if (!vars.empty()) {
+      body = Vectorize(For(vars.back(), 0, args.src->shape.back(), ForKind::kSerial, body));
+      vars.pop_back();
+    }
+    return MakeLoops(vars, args.src->shape, body);
+  }
+
+  // The scan along dim as a sequential loop carrying the running value in a local scalar
+  Stmt LowerScan(const Array<PrimExpr>& call_args) {
+    ScanArgs args = ScanArgs::Parse(call_args, buffer_data_to_buffer_);
+    Buffer carry = decl_buffer({1}, args.dst->dtype, "scan_carry", "local");
+    workspaces_.push_back(carry);
+    Array<Var> vars;
+    Array<PrimExpr> extents, indices;
+    for (size_t i = 0; i < args.src->shape.size(); i++) {
+      if (static_cast<int>(i) == args.dim) continue;
+      Var var(std::string{char('i' + vars.size())});
+      vars.push_back(var);
+      extents.push_back(args.src->shape[i]);
+    }
+    Var s("s");
+    for (size_t i = 0, j = 0; i < args.src->shape.size(); i++) {
+      indices.push_back(static_cast<int>(i) == args.dim ? PrimExpr(s) : PrimExpr(vars[j++]));
+    }
+    // the src element is read first, src and dst can be the same buffer
+    PrimExpr value = BufferLoad(carry, {0});
+    PrimExpr combined = args.MakeCombine(value, BufferLoad(args.src, indices));
+    Stmt step;
+    if (args.exclusive) {
+      Var next("next", args.dst->dtype);
+      step = LetStmt(next, combined, SeqStmt({BufferStore(args.dst, value, indices),
+                                              BufferStore(carry, next, {0})}));
+    } else {
+      step = SeqStmt({BufferStore(carry, combined, {0}), BufferStore(args.dst, value, indices)});
+    }
+    Stmt body = SeqStmt({BufferStore(carry, args.MakeIdentity(), {0}),
+                         For(s, 0, args.src->shape[args.dim], ForKind::kSerial, step)});
+    return MakeLoops(vars, extents, body);
+  }
+
+  /*!
+   * \brief One step of the online softmax as a loop over the rows, the same updates as the CUDA
+   * lowering with the scans of a row as vectorized loops.
+   */
+  Stmt LowerOnlineSoftmax(const Array<PrimExpr>& call_args) {
+    OnlineSoftmaxArgs args = OnlineSoftmaxArgs::Parse(call_args, buffer_data_to_buffer_);
+    DataType dtype = args.m->dtype;
+    Var i("i");
+    PrimExpr m = BufferLoad(args.m, {i});
+
+    // [0] the previous max and then the rescale factor, [1] the row sum, [2] the scaled max
+    Buffer temp = decl_buffer({3}, dtype, "softmax_stat", "local");
+    workspaces_.push_back(temp);
+    PrimExpr rescale = BufferLoad(temp, {0}), row_sum = BufferLoad(temp, {1});
+    PrimExpr ref = BufferLoad(temp, {2});
+    PrimExpr scale =
+        analyzer_->Simplify(cast(dtype, args.scale) * make_const(dtype, 1.4426950408889634));
+    // the column loops are made with fresh vars, a loop var is bound once
+    auto columns = [&](const Buffer& buffer, auto make_body) {
+      Var j("j");
+      return For(j, 0, buffer->shape[1], ForKind::kSerial, make_body(j));
+    };
+    auto score = [&](const Var& j) { return BufferLoad(args.scores, {i, j}); };
+
+    Array<Stmt> stmts;
+    stmts.push_back(BufferStore(temp, m, {0}));
+    stmts.push_back(columns(args.scores, [&](const Var& j) {
+      return BufferStore(args.m, Max(m, score(j)), {i});
+    }));
+    stmts.push_back(BufferStore(temp,
+                                if_then_else(m == make_const(dtype, -INFINITY), make_zero(dtype),
+                                             m * scale),
+                                {2}));
+    stmts.push_back(BufferStore(temp, exp2(rescale * scale - ref), {0}));
+    stmts.push_back(BufferStore(temp, make_zero(dtype), {1}));
+    stmts.push_back(columns(args.scores, [&](const Var& j) {
+      return SeqStmt({BufferStore(args.scores, exp2(score(j) * scale - ref), {i, j}),
+                      BufferStore(temp, row_sum + score(j), {1})});
+    }));
+    PrimExpr l = BufferLoad(args.l, {i});
+    stmts.push_back(BufferStore(args.l, l * rescale + row_sum, {i}));
+    stmts.push_back(Vectorize(columns(args.acc, [&](const Var& j) {
+      return BufferStore(args.acc, BufferLoad(args.acc, {i, j}) * rescale, {i, j});
+    })));
+    return For(i, 0, args.m->shape[0], ForKind::kSerial, SeqStmt(stmts));
+  }
+
+  // the blockIdx vars of the enclosing T.Kernel and their extents
+  std::vector<std::pair<Var, PrimExpr>> block_vars_;
+  int num_parallel_loops_ = 0;
+  Map<Var, Buffer> buffer_data_to_buffer_;
+  Array<Buffer> workspaces_;
+};
+
+/*!
+ * \brief The shared buffers of a block become the "global" allocations of the CPU codegen, taken
+ * from the thread-local workspace pool of TVMBackendAllocWorkspace when larger than the stack
+ * allocations (so a block reuses the same cache-resident arena across the blocks of its thread),
+ * the fragments become the "local" allocations kept in registers or on the stack.
+ */
+class CPUBufferScopeRewriter : public StmtExprMutator {
+ public:
+  static PrimFunc Substitute(PrimFunc f) {
+    CPUBufferScopeRewriter rewriter;
+    PrimFuncNode* fptr = f.CopyOnWrite();
+    fptr->body = rewriter.VisitStmt(f->body);
+    return f;
+  }
+
+ private:
+  Stmt VisitStmt_(const BlockNode* op) final {
+    for (const auto& buffer : op->alloc_buffers) {
+      std::string scope = buffer.scope();
+      if (scope == "shared" || scope == "shared.dyn") {
+        Remap(buffer, "global");
+      } else if (scope == "local.fragment") {
+        Remap(buffer, "local");
+      }
+    }
+    auto block = Downcast<Block>(StmtExprMutator::VisitStmt_(op));
+    auto remap_region = [this](const BufferRegion& region) {
+      return BufferRegion(GetBuffer(region->buffer), region->region);
+    };
+    auto block_ptr = block.CopyOnWrite();
+    block_ptr->alloc_buffers = block->alloc_buffers.Map([this](auto b) { return GetBuffer(b); });
+    block_ptr->reads = block->reads.Map(remap_region);
+    block_ptr->writes = block->writes.Map(remap_region);
+    block_ptr->match_buffers = block->match_buffers.Map([&](const MatchBufferRegion& match) {
+      return MatchBufferRegion(match->buffer, remap_region(match->source));
+    });
+    return block;
+  }
+
+  PrimExpr VisitExpr_(const BufferLoadNode* op) final {
+    auto load = Downcast<BufferLoad>(StmtExprMutator::VisitExpr_(op));
+    Buffer buffer = GetBuffer(load->buffer);
+    if (!buffer.same_as(load->buffer)) load.CopyOnWrite()->buffer = buffer;
+    return load;
+  }
+
+  Stmt VisitStmt_(const BufferStoreNode* op) final {
+    auto store = Downcast<BufferStore>(StmtExprMutator::VisitStmt_(op));
+    Buffer buffer = GetBuffer(store->buffer);
+    if (!buffer.same_as(store->buffer)) store.CopyOnWrite()->buffer = buffer;
+    return store;
+  }
+
+  PrimExpr VisitExpr_(const VarNode* op) final {
+    auto it = var_remap_.find(op);
+    return it == var_remap_.end() ? GetRef<PrimExpr>(op) : it->second;
+  }
+
+  void Remap(const Buffer& buffer, const std::string& scope) {
+    Var data(buffer->data->name_hint, PointerType(PrimType(buffer->dtype), scope));
+    Buffer new_buffer = buffer;
+    new_buffer.CopyOnWrite()->data = data;
+    buffer_remap_[buffer.get()] = new_buffer;
+    var_remap_[buffer->data.get()] = data;
+  }
+
+  Buffer GetBuffer(const Buffer& buffer) const {
+    auto it = buffer_remap_.find(buffer.get());
+    return it == buffer_remap_.end() ? buffer : it->second;
+  }
+
+  std::unordered_map<const BufferNode*, Buffer> buffer_remap_;
+  std::unordered_map<const VarNode*, Var> var_remap_;
+};
+
+namespace transform {
+
+using namespace tir::transform;
+
+tvm::transform::Pass LowerTileOpCPU() {
+  auto pass_func = [=](PrimFunc f, IRModule m, PassContext ctx) {
+    return CPUBufferScopeRewriter::Substitute(CPUTileOpLowerer::Substitute(std::move(f)));
+  };
+  return CreatePrimFuncPass(pass_func, 0, "tl.LowerTileOpCPU", {});
+}
+
+TVM_REGISTER_GLOBAL("tl.LowerTileOpCPU").set_body_typed(LowerTileOpCPU);
+}  // namespace transform
+
+}  // namespace tl
+}  // namespace tvm
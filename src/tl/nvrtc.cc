@@ -0,0 +1,112 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file nvrtc.cc
+ * \brief Compile the generated code with NVRTC
+ */
+
+#include <nvrtc.h>
+#include <tvm/runtime/registry.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <mutex>
+
+#include "../runtime/file_utils.h"
+#include "codegen.h"
+
+namespace tvm {
+namespace codegen {
+
+#define TL_NVRTC_CALL(x)                                                                     \
+  {                                                                                          \
+    nvrtcResult result = x;                                                                  \
+    if (result != NVRTC_SUCCESS) {                                                           \
+      LOG(FATAL) << "NvrtcError: " #x " failed with error: " << nvrtcGetErrorString(result); \
+    }                                                                                        \
+  }
+
+// defined in target/opt/build_cuda_on.cc
+std::string FindCUDAIncludePath();
+
+// The options are shared with the nvcc path (tvm_tl_cuda_compile_options in engine.py), so that
+// both compilers see the same arch, include paths and flags.
+static std::vector<std::string> GetCompileOptions(Target target) {
+  using tvm::runtime::Registry;
+  const auto* f = Registry::Get("tvm_tl_cuda_compile_options");
+  ICHECK(f) << "tvm_tl_cuda_compile_options is not registered, import tvm.tl first";
+  Array<String> options = (*f)(target);
+  std::vector<std::string> result(options.begin(), options.end());
+  result.push_back("--include-path=" + FindCUDAIncludePath());
+  // the headers are parsed into a precompiled header once and reused by the later kernels, which
+  // is supported since CUDA 12.1. A kernel includes only the tl_templates it uses, so there is one
+  // header per set of templates, kept apart per arch, options and version of the templates (the
+  // compile key) so that the stale ones are never tried.
+  int major, minor;
+  TL_NVRTC_CALL(nvrtcVersion(&major, &minor));
+  if (major > 12 || (major == 12 && minor >= 1)) {
+    std::string pch_dir = runtime::GetCacheDir() + "/tl_nvrtc_pch";
+    if (const auto* fkey = Registry::Get("tvm_tl_cuda_compile_key")) {
+      std::string key = (*fkey)(target);
+      pch_dir += "/" + key.substr(0, 16);
+    }
+    std::error_code ec;
+    std::filesystem::create_directories(pch_dir, ec);
+    if (!ec) {
+      result.push_back("-pch");
+      result.push_back("--pch-dir=" + pch_dir);
+    }
+  }
+  return result;
+}
+
+std::string TLNVRTCCompile(const std::string& code, Target target) {
+  std::vector<std::string> options = GetCompileOptions(target);
+  std::vector<const char*> option_cstrs;
+  for (const auto& option : options) option_cstrs.push_back(option.c_str());
+
+  // the precompiled header directory is not safe to be written concurrently, the compilations
+  // which create or use the precompiled headers are serialized, the others run concurrently
+  static std::mutex pch_mutex;
+  std::unique_lock<std::mutex> pch_lock(pch_mutex, std::defer_lock);
+  if (std::find(options.begin(), options.end(), "-pch") != options.end()) pch_lock.lock();
+
+  nvrtcProgram prog;
+  TL_NVRTC_CALL(nvrtcCreateProgram(&prog, code.c_str(), "tl_kernel.cu", 0, nullptr, nullptr));
+  nvrtcResult compile_res = nvrtcCompileProgram(prog, option_cstrs.size(), option_cstrs.data());
+  if (pch_lock.owns_lock()) pch_lock.unlock();
+
+  size_t log_size;
+  TL_NVRTC_CALL(nvrtcGetProgramLogSize(prog, &log_size));
+  std::string log(log_size, '\0');
+  TL_NVRTC_CALL(nvrtcGetProgramLog(prog, &log[0]));
+  ICHECK_EQ(compile_res, NVRTC_SUCCESS) << log;
+
+  // a real sm_ arch is passed, so the cubin is emitted and the driver doesn't need to jit the ptx
+  size_t cubin_size;
+  TL_NVRTC_CALL(nvrtcGetCUBINSize(prog, &cubin_size));
+  std::string cubin(cubin_size, '\0');
+  TL_NVRTC_CALL(nvrtcGetCUBIN(prog, &cubin[0]));
+  TL_NVRTC_CALL(nvrtcDestroyProgram(&prog));
+  return cubin;
+}
+
+}  // namespace codegen
+}  // namespace tvm
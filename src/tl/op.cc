@@ -28,8 +28,14 @@
 #include <tvm/tir/builtin.h>
 #include <tvm/tir/op.h>
 #include <tvm/tir/op_attr_types.h>
+#include <tvm/tir/stmt_functor.h>
+
+#include <algorithm>
+#include <sstream>
+#include <unordered_set>
 
 #include "helper.h"
+#include "target_utils.h"
 
 namespace tvm {
 namespace tl {
@@ -49,7 +55,10 @@ using namespace tir;
 TIR_DEFINE_TL_FUNC(gemm).set_num_inputs(5).set_attr<TCallEffectKind>(
     "TCallEffectKind", Integer(CallEffectKind::kOpaque));
 
-TIR_DEFINE_TL_FUNC(copy).set_num_inputs(2).set_attr<TCallEffectKind>(
+TIR_DEFINE_TL_FUNC(gemm_sp).set_num_inputs(10).set_attr<TCallEffectKind>(
+    "TCallEffectKind", Integer(CallEffectKind::kOpaque));
+
+TIR_DEFINE_TL_FUNC(copy).set_num_inputs(-1).set_attr<TCallEffectKind>(
     "TCallEffectKind", Integer(CallEffectKind::kOpaque));
 
 TIR_DEFINE_TL_FUNC(fill).set_num_inputs(2).set_attr<TCallEffectKind>(
@@ -58,9 +67,83 @@ TIR_DEFINE_TL_FUNC(fill).set_num_inputs(2).set_attr<TCallEffectKind>(
 TIR_DEFINE_TL_FUNC(reduce).set_num_inputs(4).set_attr<TCallEffectKind>(
     "TCallEffectKind", Integer(CallEffectKind::kOpaque));
 
+TIR_DEFINE_TL_FUNC(scan).set_num_inputs(5).set_attr<TCallEffectKind>(
+    "TCallEffectKind", Integer(CallEffectKind::kOpaque));
+
+TIR_DEFINE_TL_FUNC(topk).set_num_inputs(6).set_attr<TCallEffectKind>(
+    "TCallEffectKind", Integer(CallEffectKind::kOpaque));
+
+TIR_DEFINE_TL_FUNC(online_softmax)
+    .set_num_inputs(5)
+    .set_attr<TCallEffectKind>("TCallEffectKind", Integer(CallEffectKind::kOpaque));
+
+TIR_DEFINE_TL_FUNC(shuffle_layout)
+    .set_num_inputs(2)
+    .set_attr<TCallEffectKind>("TCallEffectKind", Integer(CallEffectKind::kOpaque));
+
 TIR_DEFINE_TL_FUNC(region).set_num_inputs(-1).set_attr<TCallEffectKind>(
     "TCallEffectKind", Integer(CallEffectKind::kPure));
 
+TIR_DEFINE_TL_FUNC(reduce_across_blocks)
+    .set_num_inputs(5)
+    .set_attr<TCallEffectKind>("TCallEffectKind", Integer(CallEffectKind::kOpaque));
+
+TIR_DEFINE_TL_FUNC(conv_copy).set_num_inputs(15).set_attr<TCallEffectKind>(
+    "TCallEffectKind", Integer(CallEffectKind::kOpaque));
+
+TIR_DEFINE_TL_FUNC(gather_copy).set_num_inputs(-1).set_attr<TCallEffectKind>(
+    "TCallEffectKind", Integer(CallEffectKind::kOpaque));
+
+TIR_DEFINE_TL_FUNC(atomic_add).set_num_inputs(2).set_attr<TCallEffectKind>(
+    "TCallEffectKind", Integer(CallEffectKind::kOpaque));
+
+TIR_DEFINE_TL_FUNC(tma_load).set_num_inputs(-1).set_attr<TCallEffectKind>(
+    "TCallEffectKind", Integer(CallEffectKind::kOpaque));
+
+TIR_DEFINE_TL_FUNC(tma_load_multicast).set_num_inputs(-1).set_attr<TCallEffectKind>(
+    "TCallEffectKind", Integer(CallEffectKind::kOpaque));
+
+TIR_DEFINE_TL_FUNC(mbarrier_wait).set_num_inputs(2).set_attr<TCallEffectKind>(
+    "TCallEffectKind", Integer(CallEffectKind::kOpaque));
+
+TIR_DEFINE_TL_FUNC(pdl_trigger).set_num_inputs(0).set_attr<TCallEffectKind>(
+    "TCallEffectKind", Integer(CallEffectKind::kOpaque));
+
+TIR_DEFINE_TL_FUNC(pdl_wait).set_num_inputs(0).set_attr<TCallEffectKind>(
+    "TCallEffectKind", Integer(CallEffectKind::kOpaque));
+
+TIR_DEFINE_TL_FUNC(grid_sync).set_num_inputs(0).set_attr<TCallEffectKind>(
+    "TCallEffectKind", Integer(CallEffectKind::kOpaque));
+
+Stmt MakeTensorMapEncode(const Var& tensor_map, const Array<PrimExpr>& encode_args, Stmt body) {
+  Array<PrimExpr> packed_args = {StringImm("tvm_tensormap_create_tiled"), tensor_map};
+  for (const auto& arg : encode_args) packed_args.push_back(arg);
+  Stmt encode = Evaluate(Call(DataType::Int(32), builtin::tvm_call_packed(), packed_args));
+  // a CUtensorMap takes 128 bytes
+  PrimExpr alloca = Call(DataType::Handle(), builtin::tvm_stack_alloca(),
+                         {StringImm("arg_value"), IntImm(DataType::Int(32), 16)});
+  return LetStmt(tensor_map, alloca, SeqStmt({encode, body}));
+}
+
+Optional<Stmt> MatchTensorMapEncode(const Stmt& stmt, Var* tensor_map,
+                                    Array<PrimExpr>* encode_args) {
+  auto let = stmt.as<LetStmtNode>();
+  if (let == nullptr) return NullOpt;
+  auto alloca = let->value.as<CallNode>();
+  if (alloca == nullptr || !alloca->op.same_as(builtin::tvm_stack_alloca())) return NullOpt;
+  auto seq = let->body.as<SeqStmtNode>();
+  if (seq == nullptr || seq->size() != 2) return NullOpt;
+  auto eval = seq->seq[0].as<EvaluateNode>();
+  if (eval == nullptr) return NullOpt;
+  auto call = eval->value.as<CallNode>();
+  if (call == nullptr || !call->op.same_as(builtin::tvm_call_packed())) return NullOpt;
+  auto name = call->args[0].as<StringImmNode>();
+  if (name == nullptr || name->value != "tvm_tensormap_create_tiled") return NullOpt;
+  *tensor_map = let->var;
+  *encode_args = Array<PrimExpr>(call->args.begin() + 2, call->args.end());
+  return seq->seq[1];
+}
+
 static Var GetVarFromAccessPtr(const PrimExpr& expr) {
   auto call = expr.as<CallNode>();
   ICHECK(call);
@@ -106,9 +189,107 @@ GemmArgs GemmArgs::Parse(const Array<PrimExpr>& args, const Map<Var, Buffer>& vm
   gemm_args.N = args[6].as<IntImm>().value()->value;
   gemm_args.K = args[7].as<IntImm>().value()->value;
   gemm_args.policy = static_cast<GemmWarpPolicy>(args[8].as<IntImm>().value()->value);
+  // the accumulation mode, empty to accumulate in the dtype of C
+  std::string accum = args[9].as<StringImm>().value()->value;
+  const std::string promote_prefix = "promote_every:";
+  if (accum == "fp32") {
+    ICHECK(gemm_args.C->dtype == DataType::Float(32))
+        << "accum=\"fp32\" requires a float32 C, got " << gemm_args.C;
+  } else if (accum == "fp16") {
+    if (gemm_args.C->dtype == DataType::Float(32)) gemm_args.promote_every = gemm_args.K;
+  } else if (accum.rfind(promote_prefix, 0) == 0) {
+    gemm_args.promote_every = std::stoi(accum.substr(promote_prefix.size()));
+    ICHECK_GT(gemm_args.promote_every, 0) << "Invalid accumulation mode " << accum;
+  } else {
+    ICHECK(accum.empty()) << "Unknown accumulation mode " << accum;
+  }
+  if (accum == "fp16" || gemm_args.promote_every > 0) {
+    ICHECK(gemm_args.A->dtype.is_float16() && gemm_args.B->dtype.is_float16())
+        << "The float16 accumulation takes float16 operands, got " << gemm_args.A->dtype
+        << " and " << gemm_args.B->dtype;
+    ICHECK(gemm_args.C->dtype.is_float16() || gemm_args.C->dtype == DataType::Float(32))
+        << "The float16 accumulation requires a float16 or float32 C, got " << gemm_args.C;
+    ICHECK(gemm_args.promote_every == 0 || gemm_args.C->dtype == DataType::Float(32))
+        << "The promoted accumulation requires a float32 C, got " << gemm_args.C;
+  }
+  if (args.size() > 10 && !args[10].as<StringImm>().value()->value.empty()) {
+    // the dequantization of B, the absent scale and zeros are passed as 0
+    gemm_args.b_format = args[10].as<StringImm>().value()->value;
+    gemm_args.group_size = args[11].as<IntImm>().value()->value;
+    if (args[12]->IsInstance<CallNode>()) gemm_args.scale = vmap[GetVarFromAccessPtr(args[12])];
+    if (args[13]->IsInstance<CallNode>()) gemm_args.zeros = vmap[GetVarFromAccessPtr(args[13])];
+    const std::string& format = gemm_args.b_format;
+    ICHECK(format == "int4" || format == "uint4" || format == "fp4" || format == "nf4")
+        << "Unknown format of the quantized B: " << format;
+    ICHECK(gemm_args.trans_B) << "The quantized B is packed along K and requires transpose_B";
+    ICHECK(gemm_args.B->dtype == DataType::UInt(8) || gemm_args.B->dtype == DataType::Int(8))
+        << "The quantized B is packed in bytes, got " << gemm_args.B->dtype;
+    ICHECK(gemm_args.A->dtype.is_float16() || gemm_args.A->dtype.is_bfloat16())
+        << "The quantized B is dequantized to the dtype of A, got " << gemm_args.A->dtype;
+    ICHECK(!gemm_args.zeros.defined() || format == "int4" || format == "uint4")
+        << "Zero points are only for the integer formats";
+    for (const auto& buffer : {gemm_args.scale, gemm_args.zeros}) {
+      ICHECK(!buffer.defined() || buffer->dtype == gemm_args.A->dtype)
+          << "The scales and zero points should be " << gemm_args.A->dtype << ", got " << buffer;
+    }
+    int group_size = gemm_args.group_size;
+    ICHECK(group_size <= 0 || gemm_args.K % group_size == 0 || group_size % gemm_args.K == 0)
+        << "The group size " << group_size << " should divide or be a multiple of K";
+  }
+  if (args.size() > 14) {
+    // the comma separated names of the prologue ops, then one operand per op
+    std::stringstream names(args[14].as<StringImm>().value()->value);
+    std::string name;
+    while (std::getline(names, name, ',')) gemm_args.prologue.push_back(name);
+    ICHECK_EQ(gemm_args.prologue.size() + 15, args.size())
+        << "The gemm prologue takes one operand per op";
+    static const std::unordered_set<std::string> ops = {"mul_m", "mul_k", "add_m", "add_k",
+                                                        "scale", "relu",  "silu",  "gelu"};
+    for (size_t i = 0; i < gemm_args.prologue.size(); i++) {
+      ICHECK(ops.count(gemm_args.prologue[i])) << "Unknown prologue op " << gemm_args.prologue[i];
+      gemm_args.prologue_operands.push_back(args[15 + i]);
+    }
+    ICHECK(gemm_args.A.scope() == "shared" || gemm_args.A.scope() == "shared.dyn")
+        << "The prologue transforms the shared A on load, got " << gemm_args.A << " in "
+        << gemm_args.A.scope() << ", apply the ops to the fragment instead";
+    ICHECK(gemm_args.A->dtype.is_float16() || gemm_args.A->dtype.is_bfloat16() ||
+           gemm_args.A->dtype == DataType::Float(32))
+        << "The prologue transforms a float16, bfloat16 or float32 A, got " << gemm_args.A->dtype;
+    ICHECK(gemm_args.b_format.empty()) << "The quantized gemm does not take a prologue";
+  }
   return gemm_args;
 }
 
+GemmArgs GemmArgs::ParseSparse(const Array<PrimExpr>& args, const Map<Var, Buffer>& vmap) {
+  // the args of a dense gemm accumulating in the dtype of C, then the metadata
+  Array<PrimExpr> gemm_args(args.begin(), args.begin() + 9);
+  gemm_args.push_back(StringImm(""));
+  GemmArgs sparse_args = Parse(gemm_args, vmap);
+  sparse_args.E = vmap[GetVarFromAccessPtr(args[9])];
+  ICHECK(!sparse_args.trans_A) << "The sparse A is compressed along K and can not be transposed";
+  ICHECK(sparse_args.A->shape.size() == 2 &&
+         is_const_int(sparse_args.A->shape[1], sparse_args.K / 2))
+      << "The sparse A should be compressed into [M, K / 2], got " << sparse_args.A;
+  ICHECK(sparse_args.K % 32 == 0) << "The sparse gemm requires K a multiple of 32";
+  DataType meta_dtype = sparse_args.E->dtype;
+  ICHECK((meta_dtype.is_int() || meta_dtype.is_uint()) && meta_dtype.bits() == 32 &&
+         sparse_args.E->shape.size() == 2 &&
+         is_const_int(sparse_args.E->shape[1], sparse_args.K / 32))
+      << "The metadata should be a 32-bit [M, K / 32] buffer, got " << sparse_args.E;
+  ICHECK((sparse_args.A->dtype.is_float16() || sparse_args.A->dtype.is_bfloat16()) &&
+         sparse_args.A->dtype == sparse_args.B->dtype &&
+         sparse_args.C->dtype == DataType::Float(32))
+      << "The sparse gemm takes float16 or bfloat16 operands accumulated in float32";
+  return sparse_args;
+}
+
+bool GemmArgs::IsFP8Gemm() const {
+  auto is_fp8 = [](DataType dtype) {
+    return dtype.code() == DataType::kE4M3Float || dtype.code() == DataType::kE5M2Float;
+  };
+  return is_fp8(A->dtype) && is_fp8(B->dtype);
+}
+
 std::vector<int> toPrimeFactors(int x) {
   int i = 2;
   std::vector<int> result;
@@ -123,8 +304,42 @@ std::vector<int> toPrimeFactors(int x) {
   return result;
 }
 
-std::pair<int, int> GemmArgs::ComputeWarpPartition(int num_warps) const {
+std::pair<int, int> GemmArgs::ComputeWarpPartition(int num_warps,
+                                                   const TargetNode* target) const {
   int m_warp = 1, n_warp = 1;
+  if (CheckWGMMA(num_warps, target)) {
+    // wgmma is issued by a warpgroup of 4 warps along M, each warpgroup handles at least 64 rows.
+    int num_warpgroups = num_warps / 4;
+    int m_wg = 1, n_wg = 1;
+    if (this->policy == GemmWarpPolicy::kFullRow) {
+      m_wg = num_warpgroups;
+      ICHECK(this->M % (64 * num_warpgroups) == 0);
+    } else if (this->policy == GemmWarpPolicy::kFullCol) {
+      n_wg = num_warpgroups;
+      ICHECK(this->N % (8 * num_warpgroups) == 0);
+    } else if (this->policy == GemmWarpPolicy::kSquare) {
+      for (int factor : toPrimeFactors(num_warpgroups)) {
+        bool M_divisible = (this->M % (64 * factor * m_wg)) == 0;
+        bool N_divisible = (this->N % (8 * factor * n_wg)) == 0;
+        if (M_divisible && N_divisible) {
+          if (this->M / m_wg >= this->N / n_wg)
+            m_wg *= factor;
+          else
+            n_wg *= factor;
+        } else if (M_divisible) {
+          m_wg *= factor;
+        } else if (N_divisible) {
+          n_wg *= factor;
+        } else {
+          ICHECK(0) << "Cannot compute warpgroup partition for shape" << M << " " << N
+                    << " with num_warps " << num_warps;
+        }
+      }
+    } else {
+      ICHECK(0) << "Unknown GemmWarpPolicy";
+    }
+    return {m_wg * 4, n_wg};
+  }
   if (this->policy == GemmWarpPolicy::kFullRow) {
     m_warp = num_warps;
     ICHECK(this->M % num_warps == 0);
@@ -158,6 +373,33 @@ std::pair<int, int> GemmArgs::ComputeWarpPartition(int num_warps) const {
   return {m_warp, n_warp};
 }
 
+bool GemmArgs::CheckWGMMA(int num_warps, const TargetNode* target) const {
+  if (!TargetIsHopper(target) || num_warps % 4 != 0) return false;
+  // fragments are converted into local buffers after layout inference
+  auto in_register = [](const Buffer& buf) {
+    return buf.scope() == "local.fragment" || buf.scope() == "local";
+  };
+  if (!in_register(C) || in_register(B)) return false;
+  if (in_register(A) && trans_A) return false;
+  // the promoted accumulation, the prologue and the sparse A are made by the mma of the warps
+  if (promote_every > 0 || !prologue.empty() || E.defined()) return false;
+  if (IsFP8Gemm()) {
+    // the fp8 wgmma reads K-major operands from shared memory
+    if (in_register(A) || trans_A || !trans_B || K % 32 != 0) return false;
+  } else if (!(A->dtype.is_float16() || A->dtype.is_bfloat16()) || A->dtype != B->dtype) {
+    return false;
+  }
+  if (!(C->dtype.is_float() && (C->dtype.bits() == 32 || C->dtype.bits() == 16))) return false;
+  if (M % 64 != 0 || N % 8 != 0 || K % 16 != 0) return false;
+  // The shared memory operands must be in one of the swizzled layouts accepted by the smem
+  // descriptors, which requires the continuous dimension to be a multiple of 64 bytes.
+  int min_continuous = 512 / A->dtype.bits();
+  int continuous_A = trans_A ? M : K;
+  int continuous_B = trans_B ? K : N;
+  if (!in_register(A) && continuous_A % min_continuous != 0) return false;
+  return continuous_B % min_continuous == 0;
+}
+
 CopyArgs CopyArgs::Parse(const Array<PrimExpr>& args) {
   Array<Range> rgs[2];
   Buffer bf[2];
@@ -171,11 +413,30 @@ CopyArgs CopyArgs::Parse(const Array<PrimExpr>& args) {
   CopyArgs copy_args;
   std::tie(copy_args.src, copy_args.dst) = std::tie(bf[0], bf[1]);
   std::tie(copy_args.src_range, copy_args.dst_range) = std::tie(rgs[0], rgs[1]);
+  if (args.size() > 2) {
+    ICHECK(args.size() == 4 || args.size() == 5)
+        << "copy takes a src, a dst, a cache hint, an L2 prefetch size and a bound of the rows";
+    int hint = args[2].as<IntImmNode>()->value;
+    ICHECK(hint >= 0 && hint <= 3) << "Unknown cache hint " << hint;
+    copy_args.cache_hint = static_cast<CacheHint>(hint);
+    copy_args.l2_prefetch = args[3].as<IntImmNode>()->value;
+    int prefetch = copy_args.l2_prefetch;
+    ICHECK(prefetch == -1 || prefetch == 0 || prefetch == 64 || prefetch == 128 || prefetch == 256)
+        << "The L2 prefetch size should be 0, 64, 128 or 256 bytes, got " << prefetch;
+    if (args.size() == 5) copy_args.bound = args[4];
+  }
   // check range equal
   copy_args.CheckRangeEqual();
   return copy_args;
 }
 
+Stmt CopyArgs::MakeCacheHintScope(Stmt body) const {
+  if (src.scope() != "global" || (cache_hint == CacheHint::kNone && l2_prefetch == -1))
+    return body;
+  return AttrStmt(Integer(static_cast<int>(cache_hint)), attr::kCacheHint, Integer(l2_prefetch),
+                  body);
+}
+
 bool CopyArgs::CheckRangeEqual() const {
   Array<Range> lhs, rhs;
   for (const auto& rg : src_range)
@@ -185,6 +446,50 @@ bool CopyArgs::CheckRangeEqual() const {
   return StructuralEqual()(lhs, rhs);
 }
 
+Array<PrimExpr> CopyArgs::Extents(int src_dst) const {
+  const Buffer& buffer = src_dst == 0 ? src : dst;
+  Array<PrimExpr> extents = buffer->shape;
+  if (bound.defined() && buffer.scope() == "global") extents.Set(0, bound);
+  return extents;
+}
+
+bool CopyArgs::CheckBulkLoad(const TargetNode* target) const {
+  if (!TargetIsHopper(target)) return false;
+  // the tensor maps fill the out of bound elements past the end of the tensor only
+  if (bound.defined()) return false;
+  if (src.scope() != "global" || (dst.scope() != "shared.dyn" && dst.scope() != "shared"))
+    return false;
+  if (src->dtype != dst->dtype || src->dtype.lanes() != 1) return false;
+  // tensor maps support 1 to 5 dimensions
+  if (src->shape.size() > 5 || !is_zero(src->elem_offset)) return false;
+  // the shared buffer is fully written, so that its layout can be applied to the whole box
+  arith::Analyzer analyzer;
+  for (size_t i = 0; i < dst_range.size(); i++) {
+    if (!is_zero(dst_range[i]->min) ||
+        !analyzer.CanProveEqual(dst_range[i]->extent, dst->shape[i]))
+      return false;
+  }
+  // box dims are limited to 256 and the inner box must be a multiple of 16 bytes
+  for (const auto& rg : src_range) {
+    auto extent = as_const_int(rg->extent);
+    if (extent == nullptr || *extent > 256) return false;
+  }
+  int bytes = src->dtype.bytes();
+  if (*as_const_int(src_range.back()->extent) * bytes % 16 != 0) return false;
+  // global strides must be a multiple of 16 bytes
+  if (src->strides.empty()) {
+    auto inner = as_const_int(src->shape.back());
+    if (src->shape.size() > 1 && (inner == nullptr || *inner * bytes % 16 != 0)) return false;
+  } else {
+    if (!is_one(src->strides.back())) return false;
+    for (size_t i = 0; i + 1 < src->strides.size(); i++) {
+      auto stride = as_const_int(src->strides[i]);
+      if (stride == nullptr || *stride * bytes % 16 != 0) return false;
+    }
+  }
+  return true;
+}
+
 Array<IterVar> CopyArgs::MakeIterVars() const {
   Array<IterVar> loop_vars;
   size_t idx = 0;
@@ -240,6 +545,87 @@ PrimExpr CopyArgs::MakePredicate(arith::Analyzer* analyzer, const Array<IterVar>
   }
 }
 
+PrimExpr CopyArgs::MakeTilePredicate(arith::Analyzer* analyzer, Array<PrimExpr> extents,
+                                     int src_dst) const {
+  Array<Range> ranges = src_dst == 0 ? src_range : dst_range;
+  ICHECK(extents.size() == ranges.size()) << extents << " " << ranges;
+  PrimExpr result;
+  auto append = [&](PrimExpr cond) {
+    if (analyzer->CanProve(cond)) return;
+    result = result.defined() ? And(result, cond) : cond;
+  };
+  for (size_t i = 0; i < ranges.size(); i++) {
+    if (is_one(ranges[i]->extent)) continue;
+    append(ranges[i]->min + ranges[i]->extent <= extents[i]);
+    append(ranges[i]->min >= 0);
+  }
+  return result;
+}
+
+ConvCopyArgs ConvCopyArgs::Parse(const Array<PrimExpr>& args) {
+  ConvCopyArgs conv_args;
+  conv_args.src = GetBufferFromRegion(args[0]);
+  conv_args.dst = GetBufferFromRegion(args[1]);
+  conv_args.dst_range = ParseRegionArgs(args[1].as<CallNode>());
+  conv_args.m_offset = args[2];
+  conv_args.k_offset = args[3];
+  conv_args.out_h = args[4];
+  conv_args.out_w = args[5];
+  for (int i = 0; i < 2; i++) {
+    conv_args.kernel[i] = args[6 + i].as<IntImmNode>()->value;
+    conv_args.stride[i] = args[8 + i].as<IntImmNode>()->value;
+    conv_args.padding[i] = args[10 + i].as<IntImmNode>()->value;
+    conv_args.dilation[i] = args[12 + i].as<IntImmNode>()->value;
+    ICHECK(conv_args.kernel[i] > 0 && conv_args.stride[i] > 0 && conv_args.dilation[i] > 0 &&
+           conv_args.padding[i] >= 0)
+        << "Invalid convolution kernel " << conv_args.kernel[i] << ", stride "
+        << conv_args.stride[i] << ", padding " << conv_args.padding[i] << " or dilation "
+        << conv_args.dilation[i];
+  }
+  int mode = args[14].as<IntImmNode>()->value;
+  ICHECK(mode == 0 || mode == 1) << "Unknown conv_copy mode " << mode;
+  conv_args.mode = static_cast<Mode>(mode);
+  ICHECK_EQ(conv_args.src->shape.size(), 4) << "conv_copy reads an NHWC src, got " << conv_args.src;
+  ICHECK_EQ(conv_args.dst_range.size(), 2)
+      << "conv_copy writes a 2D tile of the im2col matrix, got " << conv_args.dst_range;
+  return conv_args;
+}
+
+GatherCopyArgs GatherCopyArgs::Parse(const Array<PrimExpr>& args) {
+  GatherCopyArgs gather_args;
+  // the optional cache hint and L2 prefetch size follow the row offset
+  Array<PrimExpr> copy_args = {args[0], args[1]};
+  if (args.size() > 5) copy_args.insert(copy_args.end(), args.begin() + 5, args.end());
+  gather_args.copy = CopyArgs::Parse(copy_args);
+  auto index = args[2].as<CallNode>();
+  ICHECK(index && index->op.same_as(region()));
+  auto load = index->args[0].as<BufferLoadNode>();
+  ICHECK(load);
+  gather_args.index = load->buffer;
+  gather_args.index_base = load->indices;
+  ICHECK(gather_args.index->dtype.is_int() || gather_args.index->dtype.is_uint())
+      << "The gather index should be integers, got " << gather_args.index;
+  gather_args.page_size = args[3];
+  gather_args.row_offset = args[4];
+  const CopyArgs& copy = gather_args.copy;
+  gather_args.scatter = copy.src.scope() != "global" && copy.dst.scope() == "global";
+  const Buffer& indexed = gather_args.scatter ? copy.dst : copy.src;
+  const Range& rows = gather_args.scatter ? copy.dst_range[0] : copy.src_range[0];
+  ICHECK(is_zero(rows->min)) << "The indexed rows of " << indexed << " should start at 0";
+  return gather_args;
+}
+
+PrimExpr GatherCopyArgs::MakeIndexedRow(const PrimExpr& r) const {
+  PrimExpr row = row_offset + r;
+  Array<PrimExpr> indices = index_base;
+  PrimExpr page = row;
+  if (!is_one(page_size)) page = floordiv(row, page_size);
+  indices.Set(indices.size() - 1, indices.back() + page);
+  PrimExpr src_row = cast(row.dtype(), BufferLoad(index, indices));
+  if (is_one(page_size)) return src_row;
+  return src_row * page_size + floormod(row, page_size);
+}
+
 FillArgs FillArgs::Parse(const Array<PrimExpr>& args, const Map<Var, Buffer>& vmap) {
   FillArgs fill_args;
   fill_args.dst = vmap[GetVarFromAccessPtr(args[0])];
@@ -256,27 +642,242 @@ ReduceArgs ReduceArgs::Parse(const Array<PrimExpr>& args, const Map<Var, Buffer>
   reduce_args.src = vmap[GetVarFromAccessPtr(args[0])];
   reduce_args.dst = vmap[GetVarFromAccessPtr(args[1])];
   String reduce_type = args[2].as<StringImm>().value()->value;
-  reduce_args.dim = args[3].as<IntImm>().value()->value;
+  // the extra reduced dims and the aux buffer follow the clear flag
+  reduce_args.dims.push_back(args[3].as<IntImm>().value()->value);
+  for (size_t i = 5; i < args.size(); i++) {
+    if (auto dim = args[i].as<IntImm>()) {
+      reduce_args.dims.push_back(dim.value()->value);
+    } else {
+      ICHECK(!reduce_args.aux.defined()) << "Multiple aux buffers of reduce";
+      reduce_args.aux = vmap[GetVarFromAccessPtr(args[i])];
+    }
+  }
+  std::sort(reduce_args.dims.begin(), reduce_args.dims.end());
+  int ndim = reduce_args.src->shape.size();
+  for (size_t i = 0; i < reduce_args.dims.size(); i++) {
+    ICHECK(reduce_args.dims[i] >= 0 && reduce_args.dims[i] < ndim)
+        << "Invalid reduce dim " << reduce_args.dims[i] << " of " << reduce_args.src;
+    ICHECK(i == 0 || reduce_args.dims[i] != reduce_args.dims[i - 1])
+        << "Duplicated reduce dim " << reduce_args.dims[i];
+  }
   if (reduce_type == "sum")
     reduce_args.type = ReduceType::kSum;
+  else if (reduce_type == "sumsq")
+    reduce_args.type = ReduceType::kSumSq;
   else if (reduce_type == "max")
     reduce_args.type = ReduceType::kMax;
   else if (reduce_type == "min")
     reduce_args.type = ReduceType::kMin;
+  else if (reduce_type == "absmax")
+    reduce_args.type = ReduceType::kAbsMax;
+  else if (reduce_type == "prod")
+    reduce_args.type = ReduceType::kProd;
+  else if (reduce_type == "argmax")
+    reduce_args.type = ReduceType::kArgMax;
+  else if (reduce_type == "welford")
+    reduce_args.type = ReduceType::kWelford;
   else
     ICHECK(0) << "Unknown reduce type: " << reduce_type;
   reduce_args.clear = args[4].as<Bool>().value();
+  // the partial sums of squares are not squared again
+  ICHECK(reduce_args.clear || reduce_args.type != ReduceType::kSumSq)
+      << "The sumsq reduce should clear its output";
+  bool has_aux =
+      reduce_args.type == ReduceType::kArgMax || reduce_args.type == ReduceType::kWelford;
+  ICHECK_EQ(has_aux, reduce_args.aux.defined())
+      << "The second output of reduce " << reduce_type << " is " << reduce_args.aux;
+  return reduce_args;
+}
+
+ScanArgs ScanArgs::Parse(const Array<PrimExpr>& args, const Map<Var, Buffer>& vmap) {
+  ScanArgs scan_args;
+  scan_args.src = vmap[GetVarFromAccessPtr(args[0])];
+  scan_args.dst = vmap[GetVarFromAccessPtr(args[1])];
+  String scan_type = args[2].as<StringImm>().value()->value;
+  if (scan_type == "sum")
+    scan_args.type = ScanType::kSum;
+  else if (scan_type == "max")
+    scan_args.type = ScanType::kMax;
+  else
+    ICHECK(0) << "Unknown scan type: " << scan_type;
+  scan_args.dim = args[3].as<IntImm>().value()->value;
+  ICHECK(scan_args.dim >= 0 && scan_args.dim < static_cast<int>(scan_args.src->shape.size()))
+      << "Invalid scan dim " << scan_args.dim << " of " << scan_args.src;
+  ICHECK(StructuralEqual()(scan_args.src->shape, scan_args.dst->shape))
+      << "The scan dst " << scan_args.dst << " should have the shape of src " << scan_args.src;
+  scan_args.exclusive = args[4].as<Bool>().value();
+  return scan_args;
+}
+
+TopKArgs TopKArgs::Parse(const Array<PrimExpr>& args, const Map<Var, Buffer>& vmap) {
+  TopKArgs topk_args;
+  topk_args.src = vmap[GetVarFromAccessPtr(args[0])];
+  topk_args.values = vmap[GetVarFromAccessPtr(args[1])];
+  topk_args.indices = vmap[GetVarFromAccessPtr(args[2])];
+  topk_args.index_offset = args[3];
+  topk_args.merge = args[4].as<Bool>().value();
+  topk_args.valid = args[5];
+  const auto& src_shape = topk_args.src->shape;
+  const auto& shape = topk_args.values->shape;
+  ICHECK(StructuralEqual()(shape, topk_args.indices->shape))
+      << "The topk indices " << topk_args.indices << " should have the shape of the values "
+      << topk_args.values;
+  ICHECK(topk_args.indices->dtype == DataType::Int(32))
+      << "The topk indices should be int32, got " << topk_args.indices->dtype;
+  ICHECK(src_shape.size() == shape.size() &&
+         StructuralEqual()(Array<PrimExpr>(src_shape.begin(), src_shape.end() - 1),
+                           Array<PrimExpr>(shape.begin(), shape.end() - 1)))
+      << "The topk values " << topk_args.values << " of shape " << shape
+      << " should select the last dim of " << topk_args.src << " of shape " << src_shape;
+  return topk_args;
+}
+
+OnlineSoftmaxArgs OnlineSoftmaxArgs::Parse(const Array<PrimExpr>& args,
+                                           const Map<Var, Buffer>& vmap) {
+  OnlineSoftmaxArgs softmax_args;
+  softmax_args.scores = vmap[GetVarFromAccessPtr(args[0])];
+  softmax_args.m = vmap[GetVarFromAccessPtr(args[1])];
+  softmax_args.l = vmap[GetVarFromAccessPtr(args[2])];
+  softmax_args.acc = vmap[GetVarFromAccessPtr(args[3])];
+  softmax_args.scale = args[4];
+  ICHECK_EQ(softmax_args.scores->shape.size(), 2) << "The scores should be a 2D fragment";
+  ICHECK_EQ(softmax_args.acc->shape.size(), 2) << "The accumulator should be a 2D fragment";
+  for (const auto& buffer : {softmax_args.m, softmax_args.l}) {
+    ICHECK(buffer->shape.size() == 1 &&
+           StructuralEqual()(buffer->shape[0], softmax_args.scores->shape[0]))
+        << "The row statistics should have a row of the scores per element, got " << buffer;
+  }
+  ICHECK(StructuralEqual()(softmax_args.acc->shape[0], softmax_args.scores->shape[0]))
+      << "The accumulator should have the rows of the scores, got " << softmax_args.acc;
+  for (const auto& buffer :
+       {softmax_args.scores, softmax_args.m, softmax_args.l, softmax_args.acc}) {
+    ICHECK(buffer->dtype.is_float() && buffer->dtype.bits() == 32)
+        << "The online softmax works on float32 fragments, got " << buffer;
+  }
+  return softmax_args;
+}
+
+ShuffleLayoutArgs ShuffleLayoutArgs::Parse(const Array<PrimExpr>& args,
+                                           const Map<Var, Buffer>& vmap) {
+  ShuffleLayoutArgs shuffle_args;
+  shuffle_args.src = vmap[GetVarFromAccessPtr(args[0])];
+  shuffle_args.dst = vmap[GetVarFromAccessPtr(args[1])];
+  ICHECK(StructuralEqual()(shuffle_args.src->shape, shuffle_args.dst->shape))
+      << "The shuffle dst " << shuffle_args.dst << " should have the shape of src "
+      << shuffle_args.src;
+  ICHECK(!shuffle_args.src.same_as(shuffle_args.dst))
+      << "The shuffle can not be in place, got " << shuffle_args.src;
+  return shuffle_args;
+}
+
+ReduceArgs OnlineSoftmaxArgs::MakeRowMax() const {
+  ReduceArgs reduce_args;
+  reduce_args.src = scores;
+  reduce_args.dst = m;
+  reduce_args.dims = {1};
+  reduce_args.type = ReduceArgs::ReduceType::kMax;
+  reduce_args.clear = false;
+  return reduce_args;
+}
+
+ReduceAcrossBlocksArgs ReduceAcrossBlocksArgs::Parse(const Array<PrimExpr>& args) {
+  ReduceAcrossBlocksArgs reduce_args;
+  reduce_args.copy = CopyArgs::Parse(args);
+  reduce_args.split_idx = args[2];
+  reduce_args.num_splits = args[3];
+  reduce_args.mode = static_cast<Mode>(args[4].as<IntImm>().value()->value);
   return reduce_args;
 }
 
+Stmt AllocateGlobalWorkspaces(const Array<Buffer>& workspaces, Stmt body) {
+  for (auto it = workspaces.rbegin(); it != workspaces.rend(); ++it) {
+    const Buffer& buffer = *it;
+    PrimExpr size = make_const(DataType::Int(64), 1);
+    for (const auto& extent : buffer->shape) size = size * cast(DataType::Int(64), extent);
+    PrimExpr nbytes = size * buffer->dtype.bytes() * buffer->dtype.lanes();
+    Stmt zero = Evaluate(Call(DataType::Int(32), builtin::tvm_call_packed(),
+                              {StringImm("runtime.cuda.memset_zero"), buffer->data, nbytes}));
+    body = Allocate(buffer->data, buffer->dtype, {size}, const_true(), SeqStmt({zero, body}));
+  }
+  return body;
+}
+
+int64_t GetSharedMemoryHeadroom(const Stmt& body, const TargetNode* target) {
+  auto is_shared = [](const Buffer& buffer) {
+    return buffer.scope() == "shared" || buffer.scope() == "shared.dyn";
+  };
+  auto buffer_bytes = [](const Buffer& buffer) -> int64_t {
+    int64_t bytes = buffer->dtype.bytes() * buffer->dtype.lanes();
+    for (const auto& extent : buffer->shape) {
+      auto imm = as_const_int(extent);
+      if (!imm) return 0;
+      bytes *= *imm;
+    }
+    return bytes;
+  };
+  int64_t used = 0, min_blocks_per_sm = 0;
+  PostOrderVisit(body, [&](const ObjectRef& node) {
+    if (const auto* block = node.as<BlockNode>()) {
+      for (const auto& buffer : block->alloc_buffers) {
+        if (is_shared(buffer)) used += buffer_bytes(buffer);
+      }
+    } else if (const auto* attr = node.as<AttrStmtNode>()) {
+      if (attr->attr_key == attr::kMinBlocksPerSM)
+        min_blocks_per_sm = Downcast<Integer>(attr->value)->value;
+    } else if (const auto* loop = node.as<ForNode>()) {
+      auto anno = loop->annotations.Get("num_stages");
+      int64_t num_stages = anno.defined() ? Downcast<Integer>(anno)->value : 1;
+      if (num_stages <= 1) return;
+      // the extra versions of the shared buffers written from the global memory
+      std::unordered_set<const BufferNode*> staged;
+      auto add_staged = [&](const Buffer& buffer) {
+        if (is_shared(buffer) && staged.insert(buffer.get()).second)
+          used += (num_stages - 1) * buffer_bytes(buffer);
+      };
+      PostOrderVisit(loop->body, [&](const ObjectRef& stmt) {
+        if (const auto* call = stmt.as<CallNode>()) {
+          if (!call->op.same_as(copy())) return;
+          auto src = call->args[0].as<CallNode>(), dst = call->args[1].as<CallNode>();
+          if (!src || !dst || !src->op.same_as(region()) || !dst->op.same_as(region())) return;
+          if (Downcast<BufferLoad>(src->args[0])->buffer.scope() == "global")
+            add_staged(Downcast<BufferLoad>(dst->args[0])->buffer);
+        } else if (const auto* store = stmt.as<BufferStoreNode>()) {
+          bool from_global = false;
+          PostOrderVisit(store->value, [&](const ObjectRef& value) {
+            if (const auto* load = value.as<BufferLoadNode>())
+              from_global |= load->buffer.scope() == "global";
+          });
+          if (from_global) add_staged(store->buffer);
+        }
+      });
+    }
+  });
+  int64_t budget = TargetGetMaxSharedMemoryPerBlock(target);
+  if (min_blocks_per_sm > 1) {
+    // the shared memory of an SM also holds 1KB per block reserved by the system
+    budget = std::min<int64_t>(budget,
+                               TargetGetSharedMemoryPerSM(target) / min_blocks_per_sm - 1024);
+  }
+  return budget - used;
+}
+
 PrimExpr ReduceArgs::MakeInitValue() const {
   switch (type) {
     case ReduceType::kSum:
+    case ReduceType::kSumSq:
       return make_zero(dst->dtype);
     case ReduceType::kMax:
       return make_const(dst->dtype, -INFINITY);
     case ReduceType::kMin:
       return make_const(dst->dtype, INFINITY);
+    case ReduceType::kAbsMax:
+      return make_zero(dst->dtype);
+    case ReduceType::kProd:
+      return make_const(dst->dtype, 1);
+    case ReduceType::kArgMax:
+      return make_const(dst->dtype, -INFINITY);
+    case ReduceType::kWelford:
+      return make_zero(dst->dtype);
     default:
       ICHECK(0);
   }
@@ -290,10 +891,16 @@ PrimExpr ReduceArgs::MakeReduce(const PrimExpr& a, const PrimExpr& b) const {
   switch (type) {
     case ReduceType::kSum:
       return lhs + rhs;
+    case ReduceType::kSumSq:
+      return lhs + rhs * rhs;
     case ReduceType::kMax:
       return Max(lhs, rhs);
     case ReduceType::kMin:
       return Min(lhs, rhs);
+    case ReduceType::kAbsMax:
+      return Max(lhs, abs(rhs));
+    case ReduceType::kProd:
+      return lhs * rhs;
     default:
       ICHECK(0);
       return PrimExpr(0);
@@ -303,11 +910,55 @@ PrimExpr ReduceArgs::MakeReduce(const PrimExpr& a, const PrimExpr& b) const {
 std::string ReduceArgs::MakeCodegenReducer() const {
   switch (type) {
     case ReduceType::kSum:
+    case ReduceType::kSumSq:
       return "tl::SumOp";
     case ReduceType::kMax:
       return "tl::MaxOp";
     case ReduceType::kMin:
       return "tl::MinOp";
+    case ReduceType::kAbsMax:
+      return "tl::AbsMaxOp";
+    case ReduceType::kProd:
+      return "tl::ProdOp";
+    default:
+      ICHECK(0);
+      return "";
+  }
+}
+
+PrimExpr ScanArgs::MakeIdentity() const {
+  switch (type) {
+    case ScanType::kSum:
+      return make_zero(dst->dtype);
+    case ScanType::kMax:
+      return make_const(dst->dtype, -INFINITY);
+    default:
+      ICHECK(0);
+  }
+}
+
+PrimExpr ScanArgs::MakeCombine(const PrimExpr& a, const PrimExpr& b) const {
+  PrimExpr lhs = a, rhs = b;
+  if (lhs->dtype != rhs->dtype) {
+    rhs = Cast(lhs->dtype, rhs);
+  }
+  switch (type) {
+    case ScanType::kSum:
+      return lhs + rhs;
+    case ScanType::kMax:
+      return Max(lhs, rhs);
+    default:
+      ICHECK(0);
+      return PrimExpr(0);
+  }
+}
+
+std::string ScanArgs::MakeCodegenOp() const {
+  switch (type) {
+    case ScanType::kSum:
+      return "tl::SumOp";
+    case ScanType::kMax:
+      return "tl::MaxOp";
     default:
       ICHECK(0);
       return "";
@@ -28,7 +28,12 @@
 
 #include <tvm/arith/analyzer.h>
 #include <tvm/ir/op.h>
+#include <tvm/target/target.h>
 #include <tvm/tir/buffer.h>
+#include <tvm/tir/stmt.h>
+
+#include <string>
+#include <vector>
 
 namespace tvm {
 namespace tl {
@@ -39,12 +44,121 @@ TVM_DLL const Op& copy();
 
 TVM_DLL const Op& gemm();
 
+// gemm_sp(A, B, C, transpose_A, transpose_B, M, N, K, policy, E), C += A @ B with the 2:4 sparse A
+// compressed into [M, K / 2] and its metadata E, see GemmArgs::E
+TVM_DLL const Op& gemm_sp();
+
 TVM_DLL const Op& fill();
 
 TVM_DLL const Op& region();
 
 TVM_DLL const Op& reduce();
 
+// scan(src, dst, scan_type, dim, exclusive), the prefix sums (or maxima) of the src fragment along
+// dim into the dst fragment
+TVM_DLL const Op& scan();
+
+// topk(src, values, indices, index_offset, merge, valid), the k largest elements of the rows of the
+// shared src and their indices into the shared values and indices, see TopKArgs
+TVM_DLL const Op& topk();
+
+// online_softmax(scores, m, l, acc, scale), one step of the online softmax of the rows of the
+// scores fragment, see OnlineSoftmaxArgs
+TVM_DLL const Op& online_softmax();
+
+// shuffle_layout(src, dst), move the src fragment into the dst fragment of the same shape and of
+// another layout through the registers, see ShuffleLayoutArgs
+TVM_DLL const Op& shuffle_layout();
+
+// reduce_across_blocks(src, dst, split_idx, num_splits, mode), sum the src fragments of the blocks
+// of a split into the dst region in the global memory
+TVM_DLL const Op& reduce_across_blocks();
+
+// conv_copy(src, dst, m_offset, k_offset, out_h, out_w, kernel_h, kernel_w, stride_h, stride_w,
+// pad_h, pad_w, dilation_h, dilation_w, mode), gather a tile of the implicit im2col matrix of the
+// NHWC src into dst, see ConvCopyArgs
+TVM_DLL const Op& conv_copy();
+
+// gather_copy(src, dst, index, page_size, row_offset[, cache_hint, l2_prefetch]), copy the rows of
+// src selected by the index buffer into dst, or the rows of src into the rows of dst selected by
+// it, see GatherCopyArgs
+TVM_DLL const Op& gather_copy();
+
+// atomic_add(src, dst), atomically add the src region into the dst region element-wise
+TVM_DLL const Op& atomic_add();
+
+// tma_load(tensor_map, mbarrier, smem_ptr, coord_0, coord_1, ...), issue a bulk tensor copy from
+// global to shared memory, coordinates are ordered from the innermost dimension.
+TVM_DLL const Op& tma_load();
+
+// tma_load_multicast(tensor_map, mbarrier, smem_ptr, multicast_mask, coord_0, coord_1, ...), same
+// as tma_load but the box is also written to the blocks of the cluster in multicast_mask.
+TVM_DLL const Op& tma_load_multicast();
+
+// mbarrier_wait(mbarrier, phase), wait for the phase of the mbarrier to complete.
+TVM_DLL const Op& mbarrier_wait();
+
+// pdl_trigger(), allow the next kernel of the stream launched with the programmatic dependent
+// launch to start once all the blocks of this kernel called it or exited.
+TVM_DLL const Op& pdl_trigger();
+
+// pdl_wait(), wait for the previous kernel of the stream to complete and its writes to be visible.
+// The kernels calling it are launched with the programmatic dependent launch, see
+// launch_param::kUseProgrammaticDependentLaunchTag.
+TVM_DLL const Op& pdl_wait();
+
+// grid_sync(), a barrier of all the threads of the grid, the writes to the global memory made
+// before it being visible to all the blocks after it. The kernels calling it are launched as
+// cooperative kernels, see launch_param::kUseCooperativeLaunchTag.
+TVM_DLL const Op& grid_sync();
+
+// The host side encoding of a tensor map through tvm_tensormap_create_tiled, encode_args are
+// (dtype_code, dtype_bits, rank, global_address, global_dim[rank], global_stride[rank],
+// box_dim[rank], element_strides[rank], interleave, swizzle, l2_promotion, oob_fill).
+Stmt MakeTensorMapEncode(const Var& tensor_map, const Array<PrimExpr>& encode_args, Stmt body);
+
+// Match a statement made by MakeTensorMapEncode, returns the body on success.
+Optional<Stmt> MatchTensorMapEncode(const Stmt& stmt, Var* tensor_map,
+                                    Array<PrimExpr>* encode_args);
+
+namespace attr {
+// AttrStmt on the body of a blockIdx thread_extent, the blocks along this dimension are launched
+// as thread block clusters of the given size.
+constexpr const char* kClusterSize = "cluster_size";
+
+// AttrStmt around the launch of T.Kernel, the schedule of the tiles, see PersistentKernel
+constexpr const char* kKernelSchedule = "kernel_schedule";
+
+// AttrStmt between the blockIdx and the threadIdx launches of T.Kernel, the minimum number of
+// blocks per SM of __launch_bounds__
+constexpr const char* kMinBlocksPerSM = "min_blocks_per_sm";
+
+// The num_stages annotation of T.Pipelined(num_stages="auto"), resolved by PlanNumStages
+constexpr int kAutoNumStages = -1;
+// Annotation of the pipelined loops sized by PlanNumStages, the copies from the shared memory to
+// the registers are prefetched one iteration ahead by PipelinePlanning
+constexpr const char* kPipelinePrefetch = "pipeline_prefetch";
+// Annotation of the pipelined loops on the targets without the asynchronous copies, the indices
+// of the statements storing the registers loaded by the previous iteration into the shared
+// memory, see PipelinePlanning. InjectSoftwarePipeline marks them as double buffer writes.
+constexpr const char* kPipelineRegisterStaged = "pipeline_register_staged";
+// Annotation of the steady state loops emitted by InjectSoftwarePipeline, the number of stages of
+// the pipeline reported in the kernel metadata
+constexpr const char* kPipelineStages = "tl.pipeline_stages";
+
+// AttrStmt around the stores of a copy from the global memory with T.copy(cache_hint=...,
+// l2_prefetch=...), the node is the CopyArgs::CacheHint and the value the L2 prefetch size
+constexpr const char* kCacheHint = "tl.cache_hint";
+
+// AttrStmt around the statements timed in the instrumented kernels (pass config
+// tl.instrument_timing), the node is the name of the timer, see InstrumentTiming
+constexpr const char* kTimer = "tl.timer";
+}  // namespace attr
+
+// Wrap each statement of stmt in a kTimer AttrStmt named name if the timing instrumentation is
+// enabled, stmt is returned unchanged otherwise.
+Stmt MakeTimerScope(const Stmt& stmt, const std::string& name);
+
 struct GemmArgs {
   tir::Buffer A, B, C;
   bool trans_A, trans_B;
@@ -54,25 +168,120 @@ struct GemmArgs {
     kFullRow = 1,
     kFullCol = 2,
   } policy;
+  // The format of a packed 4-bit B operand dequantized in registers ("int4", "uint4", "fp4" or
+  // "nf4"), empty if B is not quantized. B is then a [N, K / 2] uint8 shared buffer with the even
+  // k in the low nibble, scaled by scale[n, k / group_size] with the optional zero point.
+  std::string b_format;
+  int group_size = -1;
+  tir::Buffer scale, zeros;
+  // The mma accumulates float16 A and B in float16 and the partial sums are added into the float32
+  // C every promote_every k-steps of the mma and at the end of the gemm, 0 if the mma accumulates
+  // in the dtype of C. Set by accum="fp16" with a float32 C (promoted once per gemm) or by
+  // accum="promote_every:n".
+  int promote_every = 0;
+  // The element-wise ops applied in order to the elements of a shared A between their load into
+  // the registers and the mma, see T.gemm(prologue=...): "mul_m", "mul_k", "add_m" and "add_k"
+  // take a vector of M or K elements, "scale" a float32 scalar, "relu", "silu" and "gelu" an unused
+  // 0. Empty if A is used as is.
+  std::vector<std::string> prologue;
+  Array<PrimExpr> prologue_operands;
+  // The metadata of a 2:4 sparse A (gemm_sp), undefined for the dense gemms. Of each group of 4
+  // consecutive elements along K of a row, 2 are kept in the compressed A [M, K / 2] in the order
+  // of K and their indices in the group (2 bits each, the lower one first) are packed into the
+  // 32-bit E [M, K / 32], the group g of E[m, k] in the bits [4 * g, 4 * g + 4).
+  tir::Buffer E;
 
   static GemmArgs Parse(const Array<PrimExpr>& args, const Map<Var, Buffer>& vmap);
+  static GemmArgs ParseSparse(const Array<PrimExpr>& args, const Map<Var, Buffer>& vmap);
+
+  std::pair<int, int> ComputeWarpPartition(int num_warps, const TargetNode* target) const;
+
+  // Whether this gemm can be lowered to the sm90 warpgroup-level wgmma instructions.
+  bool CheckWGMMA(int num_warps, const TargetNode* target) const;
 
-  std::pair<int, int> ComputeWarpPartition(int num_warps) const;
+  // Whether A and B are e4m3/e5m2, accumulated in float32.
+  bool IsFP8Gemm() const;
 };
 
 struct CopyArgs {
   tir::Buffer src, dst;
   Array<Range> src_range, dst_range;
+  // the L2 eviction priority of the global accesses and the size in bytes of the L2 prefetch of
+  // the async copies (0, 64, 128 or 256), -1 for the default of TL_ENABLE_L2_PREFETCH
+  enum class CacheHint {
+    kNone = 0,
+    kEvictFirst = 1,
+    kEvictLast = 2,
+    kNoAllocate = 3,
+  } cache_hint = CacheHint::kNone;
+  int l2_prefetch = -1;
+  // the end of the rows of the global buffers if defined, e.g. of a sequence of a ragged batch:
+  // the rows past it are read as zeros and not written
+  PrimExpr bound;
 
   static CopyArgs Parse(const Array<PrimExpr>& args);
 
+  // The extents of the src (0) or dst (1) buffer checked by the predicates, its shape with the
+  // bound of the rows of a global buffer.
+  Array<PrimExpr> Extents(int src_dst) const;
+
   Array<IterVar> MakeIterVars() const;
   // ivs: itervars returned by MakeIterVars()
   // src_dst: 0 for src_indices, 1 for dst_indices
   Array<PrimExpr> MakeIndices(const Array<IterVar>& ivs, int src_dst) const;
   PrimExpr MakePredicate(arith::Analyzer* analyzer, const Array<IterVar>& ivs,
                          Array<PrimExpr> extents, int src_dst) const;
+  // Whether the whole region lies inside extents, undefined if it can be proven statically.
+  PrimExpr MakeTilePredicate(arith::Analyzer* analyzer, Array<PrimExpr> extents,
+                             int src_dst) const;
   bool CheckRangeEqual() const;
+
+  // Whether this copy can be lowered to a sm90 bulk tensor copy (TMA), dst must be fully covered.
+  bool CheckBulkLoad(const TargetNode* target) const;
+
+  // Wrap the stores or the bulk copies of the global memory into the cache hint of the copy.
+  tir::Stmt MakeCacheHintScope(tir::Stmt body) const;
+};
+
+/*!
+ * \brief The tile [m_offset, m_offset + rows) x [k_offset, k_offset + cols) of the im2col matrix
+ * of an implicit GEMM convolution. Its rows are the pixels (n, h, w) of an out_h x out_w image and
+ * its columns the kernel taps and channels (kh, kw, c) of the NHWC src.
+ */
+struct ConvCopyArgs {
+  tir::Buffer src, dst;
+  Array<Range> dst_range;
+  PrimExpr m_offset, k_offset;
+  PrimExpr out_h, out_w;
+  int kernel[2], stride[2], padding[2], dilation[2];
+  enum class Mode {
+    // the rows are the output pixels, src the input (also the A^T operand of wgrad)
+    kFprop = 0,
+    // the rows are the input pixels, src the output gradient
+    kDgrad = 1,
+  } mode;
+
+  static ConvCopyArgs Parse(const Array<PrimExpr>& args);
+};
+
+/*!
+ * \brief A copy whose src rows (dim 0) are read through an index buffer, e.g. the pages of a paged
+ * KV cache. The row r of the tile is the src row index[base + p] * page_size + s with
+ * (p, s) = divmod(row_offset + r, page_size), src_range[0] is [0, rows) of the tile. When only
+ * dst is global, the copy scatters the rows of the tile into the dst rows selected the same way,
+ * e.g. the tokens appended to a paged KV cache.
+ */
+struct GatherCopyArgs {
+  CopyArgs copy;
+  tir::Buffer index;
+  Array<PrimExpr> index_base;
+  PrimExpr page_size, row_offset;
+  bool scatter = false;
+
+  static GatherCopyArgs Parse(const Array<PrimExpr>& args);
+
+  // The row of the global buffer of the tile row r.
+  PrimExpr MakeIndexedRow(const PrimExpr& r) const;
 };
 
 struct FillArgs {
@@ -84,11 +293,21 @@ struct FillArgs {
 
 struct ReduceArgs {
   tir::Buffer src, dst;
-  int dim;
+  // the second output of the struct-valued reductions: the index of argmax (dst holds the max)
+  // and the variance of welford (dst holds the mean), undefined otherwise
+  tir::Buffer aux;
+  // the reduced dims of src in ascending order
+  std::vector<int> dims;
   enum class ReduceType {
     kSum,
+    // the sum of the squares, e.g. the RMS of a row
+    kSumSq,
     kMax,
     kMin,
+    kAbsMax,
+    kProd,
+    kArgMax,
+    kWelford,
   } type;
   bool clear;
   static ReduceArgs Parse(const Array<PrimExpr>& args, const Map<Var, Buffer>& vmap);
@@ -98,8 +317,95 @@ struct ReduceArgs {
   std::string MakeCodegenReducer() const;
 };
 
+struct ScanArgs {
+  tir::Buffer src, dst;
+  int dim;
+  enum class ScanType {
+    kSum,
+    kMax,
+  } type;
+  // dst[i] excludes src[i], the first element gets the identity
+  bool exclusive;
+  static ScanArgs Parse(const Array<PrimExpr>& args, const Map<Var, Buffer>& vmap);
+
+  PrimExpr MakeIdentity() const;
+  PrimExpr MakeCombine(const PrimExpr& a, const PrimExpr& b) const;
+  std::string MakeCodegenOp() const;
+};
+
+/*!
+ * \brief The k largest elements of each row of src [..., n] and their column indices plus
+ * index_offset into values [..., k] and indices [..., k] (int32), in descending order. Only the
+ * first valid columns of src are candidates. With merge the elements already in values and indices
+ * are candidates too, so that the top k of the rows can be accumulated over the tiles of src.
+ */
+struct TopKArgs {
+  tir::Buffer src, values, indices;
+  PrimExpr index_offset, valid;
+  bool merge;
+  static TopKArgs Parse(const Array<PrimExpr>& args, const Map<Var, Buffer>& vmap);
+};
+
+/*!
+ * \brief The online softmax step of a tile of attention scores. With the running row max m, the
+ * running row sum l and the output accumulator acc, each row i is updated as
+ *   m' = max(m, max_j scores[i, j]), p[i, j] = 2^((scores[i, j] - m') * scale * log2(e)),
+ *   r = 2^((m - m') * scale * log2(e)), l = l * r + sum_j p[i, j], acc[i, :] *= r,
+ * p being written back into scores. The rows of m' = -inf (fully masked) are taken as 0.
+ */
+struct OnlineSoftmaxArgs {
+  tir::Buffer scores, m, l, acc;
+  PrimExpr scale;
+
+  static OnlineSoftmaxArgs Parse(const Array<PrimExpr>& args, const Map<Var, Buffer>& vmap);
+
+  // The reduction giving the layout of m and l from the scores.
+  ReduceArgs MakeRowMax() const;
+};
+
+/*!
+ * \brief The move of a fragment between two layouts, e.g. the accumulators of a gemm into the A
+ * operand in registers of the next gemm. The layouts are the ones inferred from the other uses of
+ * src and dst, the one missing is taken from the other, and dst[i] = src[i] (cast to the dtype of
+ * dst) is lowered with the register moves and the warp shuffles derived from the layouts.
+ */
+struct ShuffleLayoutArgs {
+  tir::Buffer src, dst;
+
+  static ShuffleLayoutArgs Parse(const Array<PrimExpr>& args, const Map<Var, Buffer>& vmap);
+};
+
+struct ReduceAcrossBlocksArgs {
+  // the src fragment and the dst region
+  CopyArgs copy;
+  PrimExpr split_idx, num_splits;
+  enum class Mode {
+    // the blocks add into dst in the order of split_idx, serialized by a semaphore
+    kDeterministic = 0,
+    // the blocks add into the zero initialized dst with atomics
+    kAtomic = 1,
+  } mode;
+
+  static ReduceAcrossBlocksArgs Parse(const Array<PrimExpr>& args);
+};
+
 Array<Range> ParseRegionArgs(const tir::CallNode* call);
 
+/*!
+ * \brief Allocate the global workspaces used by the kernels of body for each call of the host
+ *  function (TVMBackendAllocWorkspace), zeroed on the stream before the kernels. The kernels take
+ *  them as params, so concurrent launches do not share them.
+ */
+Stmt AllocateGlobalWorkspaces(const Array<Buffer>& workspaces, Stmt body);
+
+/*!
+ * \brief The shared memory left to a block of the kernel of body on target, for the optional
+ *  shared staging buffers of the lowering (see the pass config tl.disable_smem_staging). The shared
+ *  buffers of static shapes allocated in body are counted, those written from the global memory
+ *  in a loop of num_stages > 1 once per stage.
+ */
+int64_t GetSharedMemoryHeadroom(const Stmt& body, const TargetNode* target);
+
 }  // namespace tl
 }  // namespace tvm
 
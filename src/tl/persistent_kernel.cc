@@ -0,0 +1,327 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file persistent_kernel.cc
+ * \brief Run the tiles of a kernel with a fixed number of blocks (persistent and stream-K)
+ */
+
+#include <tvm/runtime/device_api.h>
+#include <tvm/tir/builtin.h>
+#include <tvm/tir/op.h>
+#include <tvm/tir/stmt_functor.h>
+#include <tvm/tir/transform.h>
+
+#include <algorithm>
+
+#include "op.h"
+
+namespace tvm {
+namespace tl {
+
+using namespace tir;
+
+TVM_REGISTER_PASS_CONFIG_OPTION("tl.num_sms", Integer);
+TVM_REGISTER_PASS_CONFIG_OPTION("tl.ctas_per_sm", Integer);
+
+/*!
+ * \brief Rewrite the kernels launched with T.Kernel(..., schedule="persistent"/"stream_k").
+ *
+ * The grid is replaced by num_sms * ctas_per_sm blocks along blockIdx.x, which loop over the
+ * tiles of the original grid. With stream-K, the iterations of the reduction loop of all the tiles
+ * are split evenly among the blocks. A tile computed by several blocks is reduced through a global
+ * workspace: the blocks with the first iterations add their partial accumulators into it, and the
+ * block with the last iterations waits for them and runs the epilogue.
+ */
+class PersistentKernelRewriter : public StmtExprMutator {
+ public:
+  static PrimFunc Substitute(PrimFunc f) {
+    PersistentKernelRewriter rewriter;
+    PrimFuncNode* fptr = f.CopyOnWrite();
+    fptr->body = rewriter(f->body);
+    fptr->body = AllocateGlobalWorkspaces(rewriter.global_workspaces_, std::move(fptr->body));
+    return f;
+  }
+
+ private:
+  PersistentKernelRewriter() = default;
+
+  Stmt VisitStmt_(const AttrStmtNode* op) final {
+    if (op->attr_key != attr::kKernelSchedule) return StmtExprMutator::VisitStmt_(op);
+    std::string schedule = Downcast<StringImm>(op->value)->value;
+    ICHECK(schedule == "persistent" || schedule == "stream_k") << "Unknown schedule " << schedule;
+    int num_ctas = GetNumCTAs(GetMinBlocksPerSM(op->body));
+    if (num_ctas == 0) {
+      LOG(WARNING) << "Can not get the number of SMs, set tl.num_sms to use the " << schedule
+                   << " schedule";
+      return op->body;
+    }
+    return Rewrite(op->body, num_ctas, schedule == "stream_k");
+  }
+
+  // T.Kernel(..., min_blocks_per_sm=k), 1 if not set
+  static int GetMinBlocksPerSM(const Stmt& kernel) {
+    Stmt stmt = kernel;
+    while (auto attr = stmt.as<AttrStmtNode>()) {
+      if (attr->attr_key == attr::kMinBlocksPerSM) return Downcast<Integer>(attr->value)->value;
+      stmt = attr->body;
+    }
+    return 1;
+  }
+
+  static int GetNumCTAs(int default_ctas_per_sm) {
+    auto ctxt = tvm::transform::PassContext::Current();
+    int num_sms = ctxt->GetConfig<Integer>("tl.num_sms", Integer(0)).value()->value;
+    int ctas_per_sm =
+        ctxt->GetConfig<Integer>("tl.ctas_per_sm", Integer(default_ctas_per_sm)).value()->value;
+    ICHECK_GT(ctas_per_sm, 0);
+    if (num_sms == 0) {
+      Device dev{kDLCUDA, 0};
+      auto api = runtime::DeviceAPI::Get(dev, /*allow_missing=*/true);
+      if (api == nullptr) return 0;
+      runtime::TVMRetValue exist, count;
+      api->GetAttr(dev, runtime::kExist, &exist);
+      if (!static_cast<int>(exist)) return 0;
+      api->GetAttr(dev, runtime::kMultiProcessorCount, &count);
+      num_sms = count;
+    }
+    return num_sms * ctas_per_sm;
+  }
+
+  Stmt Rewrite(const Stmt& kernel, int num_ctas, bool stream_k) {
+    // Step 1: peel the launch of the kernel, T.Kernel binds blockIdx.x/y/z and threadIdx.x
+    Array<IterVar> block_ivs;
+    Optional<PrimExpr> min_blocks_per_sm;
+    Stmt stmt = kernel;
+    while (auto attr = stmt.as<AttrStmtNode>()) {
+      if (attr->attr_key == attr::kMinBlocksPerSM) {
+        min_blocks_per_sm = attr->value;
+        stmt = attr->body;
+        continue;
+      }
+      if (attr->attr_key != tir::attr::thread_extent) break;
+      IterVar iv = Downcast<IterVar>(attr->node);
+      if (std::string(iv->thread_tag).rfind("blockIdx", 0) != 0) break;
+      block_ivs.push_back(iv);
+      stmt = attr->body;
+    }
+    auto thread_attr = stmt.as<AttrStmtNode>();
+    ICHECK(thread_attr && thread_attr->attr_key == tir::attr::thread_extent);
+    auto realize = thread_attr->body.as<BlockRealizeNode>();
+    ICHECK(realize) << "Expect the block of T.Kernel";
+    ICHECK(!block_ivs.empty());
+
+    PrimExpr num_tiles = 1;
+    for (const auto& iv : block_ivs) num_tiles = num_tiles * iv->dom->extent;
+    if (auto tiles = as_const_int(num_tiles)) num_ctas = std::min<int64_t>(num_ctas, *tiles);
+    PrimExpr ctas = make_const(num_tiles.dtype(), num_ctas);
+    Var cta_var("cta", num_tiles.dtype());
+    IterVar cta(Range::FromMinExtent(make_zero(cta_var.dtype()), ctas), cta_var,
+                IterVarType::kThreadIndex, "blockIdx.x");
+
+    Block block = realize->block;
+    Stmt body = block->body;
+    if (auto swizzle = body.as<AttrStmtNode>()) {
+      if (swizzle->attr_key == "threadblock_swizzle_pattern") {
+        LOG(WARNING) << "T.use_swizzle is ignored by the persistent kernels";
+        body = swizzle->body;
+      }
+    }
+    // the original block indices are computed from the tile index
+    auto bind_tile = [&](PrimExpr tile, Stmt body) {
+      std::vector<std::pair<Var, PrimExpr>> binds;
+      for (const auto& iv : block_ivs) {
+        binds.emplace_back(iv->var, floormod(tile, iv->dom->extent));
+        tile = floordiv(tile, iv->dom->extent);
+      }
+      for (auto it = binds.rbegin(); it != binds.rend(); it++)
+        body = LetStmt(it->first, it->second, body);
+      return body;
+    };
+
+    Optional<Stmt> new_body;
+    if (stream_k) new_body = RewriteStreamK(block, body, cta_var, ctas, num_tiles, bind_tile);
+    if (!new_body.defined()) {
+      // Persistent: block cta runs the tiles cta, cta + num_ctas, ...
+      Var iter("tile_iter", cta_var.dtype());
+      Var tile("tile", cta_var.dtype());
+      Stmt loop_body = LetStmt(tile, cta_var + iter * ctas, bind_tile(tile, body));
+      PrimExpr num_iters = floordiv(num_tiles - cta_var + ctas - 1, ctas);
+      new_body = For(iter, make_zero(iter.dtype()), num_iters, ForKind::kSerial, loop_body);
+    }
+    block.CopyOnWrite()->body = new_body.value();
+    BlockRealize new_realize = GetRef<BlockRealize>(realize);
+    new_realize.CopyOnWrite()->block = block;
+    Stmt launch =
+        AttrStmt(thread_attr->node, thread_attr->attr_key, thread_attr->value, new_realize);
+    if (min_blocks_per_sm.defined()) {
+      launch = AttrStmt(ObjectRef(), attr::kMinBlocksPerSM, min_blocks_per_sm.value(), launch);
+    }
+    return AttrStmt(cta, tir::attr::thread_extent, ctas, launch);
+  }
+
+  template <typename FBind>
+  Optional<Stmt> RewriteStreamK(const Block& block, const Stmt& body, const Var& cta,
+                                const PrimExpr& ctas, const PrimExpr& num_tiles, FBind bind_tile) {
+    // Step 1: match prologue; for k in range(k_iters): ... T.gemm(..., C_local, ...); epilogue
+    Array<Stmt> seq;
+    if (auto seq_stmt = body.as<SeqStmtNode>()) {
+      seq = seq_stmt->seq;
+    } else {
+      seq.push_back(body);
+    }
+    Map<Var, Buffer> vmap;
+    for (const auto& buffer : block->alloc_buffers) vmap.Set(buffer->data, buffer);
+    int loop_idx = -1;
+    Array<Buffer> accums;
+    for (size_t i = 0; i < seq.size(); i++) {
+      auto loop = seq[i].as<ForNode>();
+      if (loop == nullptr) continue;
+      Array<Buffer> loop_accums;
+      PostOrderVisit(loop->body, [&](const ObjectRef& node) {
+        auto call = node.as<CallNode>();
+        if (call == nullptr || !(call->op.same_as(gemm()) || call->op.same_as(gemm_sp()))) return;
+        Buffer C = vmap[GetVarFromAccessPtr(call->args[2])];
+        if (std::find_if(loop_accums.begin(), loop_accums.end(),
+                         [&](const Buffer& b) { return b.same_as(C); }) == loop_accums.end())
+          loop_accums.push_back(C);
+      });
+      if (loop_accums.empty()) continue;
+      if (loop_idx >= 0) return Fail("more than one reduction loop");
+      loop_idx = i;
+      accums = loop_accums;
+    }
+    if (loop_idx < 0) return Fail("no reduction loop with T.gemm");
+    for (const auto& C : accums) {
+      if (C.scope() != "local.fragment") return Fail("the accumulator is not a fragment");
+      if (C->dtype != DataType::Float(32)) return Fail("the accumulator is not float32");
+      for (const auto& s : C->shape) {
+        if (!s->IsInstance<IntImmNode>()) return Fail("the accumulator has a dynamic shape");
+      }
+    }
+    For loop = Downcast<For>(seq[loop_idx]);
+    DataType dtype = cta.dtype();
+
+    // Step 2: the iterations [begin, end) of block cta, containing the units of tiles
+    // [tile_begin, tile_end], which are run backward. So that the partial accumulators of a tile
+    // are first written by the blocks before, and then read by the block with its last iterations.
+    PrimExpr k_iters = cast(dtype, loop->extent);
+    PrimExpr total = num_tiles * k_iters;
+    PrimExpr iters_per_cta = floordiv(total + ctas - 1, ctas);
+    Var begin("iter_begin", dtype), end("iter_end", dtype);
+    PrimExpr tile_begin = floordiv(begin, k_iters);
+    PrimExpr tile_end = floordiv(end - 1, k_iters);
+    Var unit("unit", dtype), tile("tile", dtype), k_begin("k_begin", dtype), k_end("k_end", dtype);
+
+    // Step 3: the workspace of the split tiles, a tile is split by at most one block boundary
+    // per block, and indexed by the block running its first iteration.
+    // They are allocated and zeroed for each launch, see AllocateGlobalWorkspaces.
+    Array<Buffer> workspaces;
+    Buffer counter = decl_buffer({ctas}, DataType::Int(32), "stream_k_counter", "global");
+    workspaces.push_back(counter);
+    PrimExpr slot = floordiv(tile * k_iters, iters_per_cta);
+    PrimExpr num_contributors = floordiv(tile * k_iters + k_iters - 1, iters_per_cta) - slot;
+    PrimExpr counter_ptr = Call(DataType::Handle(), builtin::address_of(),
+                                {BufferLoad(counter, {slot})});
+
+    Array<Stmt> contribute, finish;
+    for (size_t i = 0; i < accums.size(); i++) {
+      const Buffer& C = accums[i];
+      Array<PrimExpr> shape = {ctas};
+      for (const auto& s : C->shape) shape.push_back(s);
+      Buffer workspace = decl_buffer(shape, C->dtype, C->name + "_workspace", "global");
+      workspaces.push_back(workspace);
+      Array<Var> vars;
+      Array<PrimExpr> indices, ws_indices = {slot};
+      for (size_t j = 0; j < C->shape.size(); j++) {
+        vars.push_back(Var("i" + std::to_string(j), C->shape[j].dtype()));
+        indices.push_back(vars.back());
+        ws_indices.push_back(vars.back());
+      }
+      auto make_parallel = [&](Stmt stmt) {
+        for (int j = vars.size() - 1; j >= 0; j--) {
+          stmt = For(vars[j], make_zero(vars[j].dtype()), C->shape[j], ForKind::kParallel, stmt);
+        }
+        return stmt;
+      };
+      PrimExpr ws_ptr = Call(DataType::Handle(), builtin::address_of(),
+                             {BufferLoad(workspace, ws_indices)});
+      contribute.push_back(make_parallel(Evaluate(Call(DataType::Handle(),
+                                                       builtin::call_extern(),
+                                                       {StringImm("atomicAdd"), ws_ptr,
+                                                        BufferLoad(C, indices)}))));
+      PrimExpr partial = BufferLoad(workspace, ws_indices);
+      finish.push_back(make_parallel(BufferStore(C, BufferLoad(C, indices) + partial, indices)));
+    }
+    auto extern_call = [](const std::string& name, Array<PrimExpr> args) {
+      args.insert(args.begin(), StringImm(name));
+      return Evaluate(Call(DataType::Handle(), builtin::call_extern(), args));
+    };
+    contribute.push_back(extern_call("tl::stream_k_signal", {counter_ptr}));
+    finish.insert(finish.begin(),
+                  extern_call("tl::stream_k_wait", {counter_ptr, num_contributors}));
+
+    // Step 4: the unit runs iterations [k_begin, k_end) of the tile, the epilogue is run by the
+    // block with the last iteration.
+    Array<Stmt> unit_body(seq.begin(), seq.begin() + loop_idx);
+    For unit_loop = loop;
+    unit_loop.CopyOnWrite()->min = loop->min + cast(loop->min.dtype(), k_begin);
+    unit_loop.CopyOnWrite()->extent = cast(loop->extent.dtype(), k_end - k_begin);
+    unit_body.push_back(unit_loop);
+    PrimExpr finished = EQ(k_end, k_iters);
+    unit_body.push_back(IfThenElse(LT(k_end - k_begin, k_iters),
+                                   IfThenElse(finished, SeqStmt(finish), SeqStmt(contribute))));
+    if (loop_idx + 1 < static_cast<int>(seq.size())) {
+      Array<Stmt> epilogue(seq.begin() + loop_idx + 1, seq.end());
+      unit_body.push_back(IfThenElse(finished, SeqStmt::Flatten(epilogue)));
+    }
+    Stmt stmt = bind_tile(tile, SeqStmt::Flatten(unit_body));
+    stmt = LetStmt(k_end, min(end, tile * k_iters + k_iters) - tile * k_iters, stmt);
+    stmt = LetStmt(k_begin, max(begin, tile * k_iters) - tile * k_iters, stmt);
+    stmt = LetStmt(tile, tile_end - unit, stmt);
+    stmt = For(unit, make_zero(dtype), tile_end - tile_begin + 1, ForKind::kSerial, stmt);
+    stmt = IfThenElse(LT(begin, end), stmt);
+    stmt = LetStmt(end, min(begin + iters_per_cta, total), stmt);
+    stmt = LetStmt(begin, cta * iters_per_cta, stmt);
+    for (const auto& buffer : workspaces) global_workspaces_.push_back(buffer);
+    return stmt;
+  }
+
+  static Optional<Stmt> Fail(const std::string& reason) {
+    LOG(WARNING) << "Fall back to the persistent schedule from stream-K, " << reason;
+    return NullOpt;
+  }
+
+  // the workspaces of the stream-K kernels
+  Array<Buffer> global_workspaces_;
+};
+
+using namespace tir::transform;
+
+tvm::transform::Pass PersistentKernel() {
+  auto pass_func = [=](PrimFunc f, IRModule m, PassContext ctx) {
+    return PersistentKernelRewriter::Substitute(std::move(f));
+  };
+  return CreatePrimFuncPass(pass_func, 0, "tl.PersistentKernel", {});
+}
+
+TVM_REGISTER_GLOBAL("tl.PersistentKernel").set_body_typed(PersistentKernel);
+
+}  // namespace tl
+}  // namespace tvm
@@ -27,6 +27,15 @@
 #include <tvm/tir/stmt_functor.h>
 #include <tvm/tir/transform.h>
 
+#include <algorithm>
+#include <functional>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "op.h"
 #include "target_utils.h"
 
 namespace tvm {
@@ -56,6 +65,112 @@ bool MayConflict(Region region1, Region region2) {
   return true;
 }
 
+/*!
+ * \brief Split a copy from the global memory into a shared buffer, made of the loops of constant
+ * extents, the conditions and the stores of the global values, into the loads of the values into
+ * a local buffer and the stores of the local buffer into the shared one. Both statements keep the
+ * structure of the copy, the values are placed in the local buffer in the order of the loops.
+ */
+class RegisterStagedCopySplitter {
+ public:
+  // Fails if stmt is not such a copy or its values take more than max_bytes per thread
+  static bool Split(const Stmt& stmt, int64_t max_bytes, Stmt* load, Stmt* store, Buffer* reg) {
+    RegisterStagedCopySplitter splitter;
+    if (!splitter.Check(stmt, 1) || !splitter.dst_.defined()) return false;
+    if (splitter.num_elems_ * splitter.dst_->dtype.bytes() > max_bytes) return false;
+    splitter.reg_ = decl_buffer({Integer(splitter.num_elems_)}, splitter.dst_->dtype,
+                                splitter.dst_->name + "_reg", "local");
+    std::tie(*load, *store) = splitter.Build(stmt);
+    *reg = splitter.reg_;
+    return true;
+  }
+
+ private:
+  bool Check(const Stmt& stmt, int64_t elems) {
+    if (const auto* loop = stmt.as<ForNode>()) {
+      const auto* extent = as_const_int(loop->extent);
+      if (extent == nullptr || loop->kind == ForKind::kThreadBinding) return false;
+      return Check(loop->body, elems * *extent);
+    } else if (const auto* cond = stmt.as<IfThenElseNode>()) {
+      return !cond->else_case.defined() && Check(cond->then_case, elems);
+    } else if (const auto* attr = stmt.as<AttrStmtNode>()) {
+      return attr->attr_key == attr::kCacheHint && Check(attr->body, elems);
+    } else if (const auto* seq = stmt.as<SeqStmtNode>()) {
+      for (const auto& s : seq->seq) {
+        if (!Check(s, elems)) return false;
+      }
+      return true;
+    } else if (const auto* store = stmt.as<BufferStoreNode>()) {
+      const Buffer& buffer = store->buffer;
+      if (buffer.scope() != "shared" && buffer.scope() != "shared.dyn") return false;
+      if (dst_.defined() && !dst_.same_as(buffer)) return false;
+      if (store->value.dtype().lanes() != 1) return false;
+      // the value only reads the global memory, the indices read nothing
+      bool from_global = false, valid = true;
+      PostOrderVisit(store->value, [&](const ObjectRef& node) {
+        if (const auto* load = node.as<BufferLoadNode>()) {
+          from_global |= load->buffer.scope() == "global";
+          valid &= load->buffer.scope() == "global";
+        }
+      });
+      for (const auto& index : store->indices) {
+        PostOrderVisit(index, [&](const ObjectRef& node) {
+          valid &= !node->IsInstance<BufferLoadNode>();
+        });
+      }
+      dst_ = buffer;
+      num_elems_ += elems;
+      return from_global && valid;
+    }
+    return false;
+  }
+
+  std::pair<Stmt, Stmt> Build(const Stmt& stmt) {
+    if (const auto* loop = stmt.as<ForNode>()) {
+      loops_.emplace_back(loop->loop_var - loop->min, *as_const_int(loop->extent));
+      auto [load, store] = Build(loop->body);
+      loops_.pop_back();
+      Var var = loop->loop_var.copy_with_suffix("");
+      store = Substitute(store, {{loop->loop_var, var}});
+      return {For(loop->loop_var, loop->min, loop->extent, loop->kind, load, loop->thread_binding,
+                  loop->annotations),
+              For(var, loop->min, loop->extent, loop->kind, store, loop->thread_binding,
+                  loop->annotations)};
+    } else if (const auto* cond = stmt.as<IfThenElseNode>()) {
+      auto [load, store] = Build(cond->then_case);
+      return {IfThenElse(cond->condition, load), IfThenElse(cond->condition, store)};
+    } else if (const auto* attr = stmt.as<AttrStmtNode>()) {
+      // the cache hints are on the global loads
+      auto [load, store] = Build(attr->body);
+      return {AttrStmt(attr->node, attr->attr_key, attr->value, load), store};
+    } else if (const auto* seq = stmt.as<SeqStmtNode>()) {
+      Array<Stmt> loads, stores;
+      for (const auto& s : seq->seq) {
+        auto [load, store] = Build(s);
+        loads.push_back(load);
+        stores.push_back(store);
+      }
+      return {SeqStmt(loads), SeqStmt(stores)};
+    }
+    const auto* store = stmt.as<BufferStoreNode>();
+    ICHECK(store);
+    PrimExpr index = make_const(DataType::Int(32), offset_);
+    int64_t stride = 1;
+    for (auto it = loops_.rbegin(); it != loops_.rend(); it++) {
+      index = index + it->first * make_const(it->first.dtype(), stride);
+      stride *= it->second;
+    }
+    offset_ += stride;
+    return {BufferStore(reg_, store->value, {index}),
+            BufferStore(store->buffer, BufferLoad(reg_, {index}), store->indices)};
+  }
+
+  Buffer dst_, reg_;
+  int64_t num_elems_ = 0, offset_ = 0;
+  // the offsets of the enclosing loop vars from their min and the extents of the loops
+  std::vector<std::pair<PrimExpr, int64_t>> loops_;
+};
+
 }  // namespace
 
 class PipelinePlanner : public StmtExprMutator {
@@ -79,9 +194,46 @@ class PipelinePlanner : public StmtExprMutator {
     int original_order;
     int order = -1, stage = -1;
     bool copy_stage = false;
+    // a copy from the shared buffers written by the copy stages into the registers
+    bool prefetch_stage = false;
     int last_use_stage = -1;
   };
 
+  // The statements reading only shared buffers written by the copy stages, and writing only local
+  // buffers that a later statement reads and no other one writes, are prefetched.
+  void FindPrefetchStages(std::vector<PipelineStageInfo>* infos) {
+    std::unordered_set<const BufferNode*> staged;
+    for (const auto& pinfo : *infos) {
+      if (!pinfo.copy_stage) continue;
+      for (const auto& region : pinfo.writes) staged.insert(region->buffer.get());
+    }
+    auto is_local = [](const Buffer& buffer) {
+      return buffer.scope() == "local" || buffer.scope() == "local.fragment";
+    };
+    for (auto& pinfo : *infos) {
+      if (pinfo.copy_stage || pinfo.reads.empty() || pinfo.writes.empty()) continue;
+      bool candidate = true;
+      for (const auto& region : pinfo.reads) candidate &= staged.count(region->buffer.get()) > 0;
+      for (const auto& region : pinfo.writes) candidate &= is_local(region->buffer);
+      if (!candidate) continue;
+      bool used_later = false, written_elsewhere = false;
+      for (const auto& other : *infos) {
+        if (&other == &pinfo) continue;
+        for (const auto& write : pinfo.writes) {
+          for (const auto& region : other.reads) {
+            if (region->buffer.same_as(write->buffer) &&
+                other.original_order > pinfo.original_order)
+              used_later = true;
+          }
+          for (const auto& region : other.writes) {
+            if (region->buffer.same_as(write->buffer)) written_elsewhere = true;
+          }
+        }
+      }
+      pinfo.prefetch_stage = used_later && !written_elsewhere;
+    }
+  }
+
   PipelineStageInfo MakePipelineStageInfo(Stmt stmt, int idx) {
     Block block(/*iter_vars=*/{}, /*reads=*/{}, /*writes=*/{}, /*name_hint=*/"", /*body*/ stmt);
     Array<Array<BufferRegion>> access = GetBlockReadWriteRegion(block, buffer_data_to_buffer_);
@@ -93,6 +245,13 @@ class PipelinePlanner : public StmtExprMutator {
       if (region->buffer.scope() == "global") pinfo.copy_stage = true;
     for (auto region : pinfo.writes)
       if (region->buffer.scope() == "global") pinfo.copy_stage = true;
+    // the global tensor of a bulk copy is only referred by the tensor map
+    PostOrderVisit(stmt, [&](const ObjectRef& node) {
+      if (auto call = node.as<CallNode>()) {
+        if (call->op.same_as(tma_load()) || call->op.same_as(tma_load_multicast()))
+          pinfo.copy_stage = true;
+      }
+    });
     return std::move(pinfo);
   }
 
@@ -123,11 +282,18 @@ class PipelinePlanner : public StmtExprMutator {
       auto pinfo = MakePipelineStageInfo(pipeline_body_seq->seq[i], i);
       pipeline_stage_infos.push_back(std::move(pinfo));
     }
+    // the prefetch stages run a stage ahead of the compute, after a copy stage
+    if (loop->annotations.count(attr::kPipelinePrefetch) && num_stages >= 2) {
+      FindPrefetchStages(&pipeline_stage_infos);
+    }
+    auto is_producer = [](const PipelineStageInfo& pinfo) {
+      return pinfo.copy_stage || pinfo.prefetch_stage;
+    };
 
     // analysis use-def chain
     for (auto& pinfo : pipeline_stage_infos) {
       for (int i = pinfo.original_order + 1; i < static_cast<int>(pipeline_body_seq->size()); i++) {
-        if (!pinfo.copy_stage) continue;
+        if (!is_producer(pinfo)) continue;
         for (const BufferRegion& read : pipeline_stage_infos[i].reads) {
           if (std::find_if(pinfo.writes.begin(), pinfo.writes.end(), [&](const BufferRegion& r) {
                 return r->buffer == read->buffer && MayConflict(r->region, read->region);
@@ -147,18 +313,25 @@ class PipelinePlanner : public StmtExprMutator {
       }
     }
 
-    // Making stages and orders
+    // Making stages and orders, the producers of a statement follow it in the order: the copies
+    // at stage 0, the prefetches at the stage before the compute, then their own copies
     int order_idx = 0;
-    for (auto& pinfo : pipeline_stage_infos) {
-      if (pinfo.copy_stage && pinfo.last_use_stage != -1) continue;
-      pinfo.order = order_idx++;
-      pinfo.stage = num_stages;
+    std::function<void(int)> order_producers = [&](int consumer) {
       for (auto& pinfo_1 : pipeline_stage_infos) {
-        if (pinfo_1.copy_stage && pinfo_1.last_use_stage == pinfo.original_order) {
+        if (is_producer(pinfo_1) && pinfo_1.last_use_stage == consumer) {
           pinfo_1.order = order_idx++;
-          pinfo_1.stage = 0;
+          pinfo_1.stage = pinfo_1.copy_stage ? 0 : num_stages - 1;
+          if (pinfo_1.prefetch_stage) order_producers(pinfo_1.original_order);
         }
       }
+    };
+    bool has_prefetch = false;
+    for (auto& pinfo : pipeline_stage_infos) {
+      has_prefetch |= pinfo.prefetch_stage;
+      if (is_producer(pinfo) && pinfo.last_use_stage != -1) continue;
+      pinfo.order = order_idx++;
+      pinfo.stage = num_stages;
+      order_producers(pinfo.original_order);
     }
     ICHECK(size_t(order_idx) == pipeline_stage_infos.size());
 
@@ -179,7 +352,7 @@ class PipelinePlanner : public StmtExprMutator {
       if (copy_order_min > non_copy_order_max) return copy_stage_cnt;
       return -1;
     }();
-    if (copy_stage_at_end > 0 && num_stages >= 2) {
+    if (copy_stage_at_end > 0 && num_stages >= 2 && !has_prefetch) {
       for (auto& pinfo : pipeline_stage_infos) {  // move copy to the begining
         pinfo.order = (pinfo.order + copy_stage_at_end) % pipeline_stage_infos.size();
         if (!pinfo.copy_stage) pinfo.stage--;
@@ -189,11 +362,20 @@ class PipelinePlanner : public StmtExprMutator {
     // Finally, make the pipeline annotation
     Map<String, ObjectRef> annotations;
     for (const auto& [key, value] : loop->annotations) {
-      if (key != "num_stages") {
+      if (key != "num_stages" && key != attr::kPipelinePrefetch) {
         annotations.Set(key, value);
       }
     }
 
+    if (!TargetHasAsyncCopy(target_) && num_stages >= 2) {
+      Stmt body = StageCopiesInRegisters(loop->body, pipeline_body_seq, pipeline_stage_infos,
+                                         &annotations);
+      if (!body.same_as(loop->body)) {
+        return For(loop->loop_var, loop->min, loop->extent, loop->kind, body,
+                   loop->thread_binding, annotations);
+      }
+    }
+
     std::vector<Integer> orders, stages;
     orders.reserve(pipeline_stage_infos.size());
     stages.reserve(pipeline_stage_infos.size());
@@ -211,6 +393,91 @@ class PipelinePlanner : public StmtExprMutator {
                loop->thread_binding, annotations);
   }
 
+  /*!
+   * \brief Without the asynchronous copies, a copy stage stalls on its global loads before it can
+   * store into the shared memory. The copies read by later stages only are split by
+   * RegisterStagedCopySplitter: the loads into the registers stay in the stage of the copy, the
+   * stores into the shared memory move one stage later with all the other statements. An
+   * iteration stores the tile loaded by the previous one into the next version of the shared
+   * buffer, then issues the loads of the following tile, which are in flight during the compute.
+   * Returns the new body of the pipelined loop with its stage and order annotations set, or body
+   * if no copy is split.
+   */
+  Stmt StageCopiesInRegisters(const Stmt& body, const SeqStmtNode* seq,
+                              const std::vector<PipelineStageInfo>& infos,
+                              Map<String, ObjectRef>* annotations) {
+    // the registers of a thread holding the tiles in flight
+    constexpr int64_t kMaxStagedBytes = 256;
+    int64_t budget = kMaxStagedBytes;
+    std::vector<Stmt> loads(infos.size()), stores(infos.size());
+    Array<Buffer> regs;
+    for (const auto& pinfo : infos) {
+      if (!pinfo.copy_stage || pinfo.stage != 0) continue;
+      bool read_later = true;
+      for (const auto& other : infos) {
+        for (const auto& read : other.reads) {
+          for (const auto& write : pinfo.writes) {
+            if (read->buffer.same_as(write->buffer)) read_later &= other.stage > 0;
+          }
+        }
+      }
+      Buffer reg;
+      int i = pinfo.original_order;
+      if (!read_later || !RegisterStagedCopySplitter::Split(seq->seq[i], budget, &loads[i],
+                                                             &stores[i], &reg)) {
+        continue;
+      }
+      budget -= reg->dtype.bytes() * Downcast<IntImm>(reg->shape[0])->value;
+      regs.push_back(reg);
+    }
+    if (regs.empty()) return body;
+
+    // the stores first, then the loads, then the other statements in their order
+    std::vector<const PipelineStageInfo*> others;
+    for (const auto& pinfo : infos) {
+      if (!loads[pinfo.original_order].defined()) others.push_back(&pinfo);
+    }
+    std::sort(others.begin(), others.end(),
+              [](const auto* a, const auto* b) { return a->order < b->order; });
+    std::unordered_map<int, int> other_order;
+    for (size_t i = 0; i < others.size(); i++) {
+      other_order[others[i]->original_order] = regs.size() * 2 + i;
+    }
+    Array<Stmt> new_seq;
+    Array<Integer> stages, orders, staged_stores;
+    int num_stores = 0, num_loads = regs.size();
+    for (const auto& pinfo : infos) {
+      int i = pinfo.original_order;
+      if (loads[i].defined()) {
+        new_seq.push_back(loads[i]);
+        stages.push_back(pinfo.stage);
+        orders.push_back(num_loads++);
+        staged_stores.push_back(new_seq.size());
+        new_seq.push_back(stores[i]);
+        stages.push_back(pinfo.stage + 1);
+        orders.push_back(num_stores++);
+      } else {
+        new_seq.push_back(seq->seq[i]);
+        stages.push_back(pinfo.stage + 1);
+        orders.push_back(other_order[i]);
+      }
+    }
+    annotations->Set(tir::attr::software_pipeline_stage, stages);
+    annotations->Set(tir::attr::software_pipeline_order, orders);
+    annotations->Set(attr::kPipelineRegisterStaged, staged_stores);
+
+    // the registers are allocated with the buffers of the loop body
+    if (const auto* realize = body.as<BlockRealizeNode>()) {
+      Block block = realize->block;
+      auto n = block.CopyOnWrite();
+      n->body = SeqStmt(new_seq);
+      for (const auto& reg : regs) n->alloc_buffers.push_back(reg);
+      return BlockRealize(realize->iter_values, realize->predicate, block);
+    }
+    return BlockRealize({}, Bool(true),
+                        Block({}, {}, {}, "", SeqStmt(new_seq), NullOpt, regs));
+  }
+
   Stmt VisitStmt_(const BlockNode* op) final {
     for (const auto& buffer : op->alloc_buffers) {
       buffer_data_to_buffer_.Set(buffer->data, buffer);
@@ -226,6 +493,137 @@ class PipelinePlanner : public StmtExprMutator {
   const TargetNode* target_;
 };
 
+/*!
+ * \brief Resolve num_stages="auto" of the pipelined loops while the copies and the gemms are still
+ * tile ops. The loads of an iteration are issued num_stages - 1 iterations ahead of its compute:
+ * enough iterations to cover the latency of the global memory, as long as a version of the
+ * shared buffers written from the global memory per stage fits in the shared memory of a block.
+ */
+class NumStagesPlanner : public StmtExprMutator {
+ public:
+  static Stmt Substitute(const PrimFunc& f) {
+    auto target = f->GetAttr<Target>(tvm::attr::kTarget);
+    ICHECK(target.defined()) << "PlanNumStages: Require the target attribute";
+    NumStagesPlanner planner(target.value().get());
+    PostOrderVisit(f->body, [&](const ObjectRef& node) {
+      if (const auto* block = node.as<BlockNode>()) {
+        for (const auto& buffer : block->alloc_buffers) {
+          if (IsShared(buffer)) planner.shared_bytes_ += BufferBytes(buffer);
+        }
+      } else if (const auto* attr = node.as<AttrStmtNode>()) {
+        if (attr->attr_key == attr::kMinBlocksPerSM)
+          planner.min_blocks_per_sm_ = Downcast<Integer>(attr->value)->value;
+      }
+    });
+    return planner(f->body);
+  }
+
+ private:
+  explicit NumStagesPlanner(const TargetNode* target) : target_(target) {}
+
+  static bool IsShared(const Buffer& buffer) {
+    return buffer.scope() == "shared" || buffer.scope() == "shared.dyn";
+  }
+
+  static int64_t BufferBytes(const Buffer& buffer) {
+    int64_t bytes = buffer->dtype.bytes() * buffer->dtype.lanes();
+    for (const auto& extent : buffer->shape) {
+      auto imm = as_const_int(extent);
+      if (!imm) return 0;
+      bytes *= *imm;
+    }
+    return bytes;
+  }
+
+  static Optional<Buffer> RegionBuffer(const PrimExpr& expr) {
+    if (const auto* call = expr.as<CallNode>()) {
+      if (call->op.same_as(region())) return Downcast<BufferLoad>(call->args[0])->buffer;
+    }
+    return NullOpt;
+  }
+
+  Stmt VisitStmt_(const ForNode* op) final {
+    For loop = Downcast<For>(StmtExprMutator::VisitStmt_(op));
+    auto anno = loop->annotations.Get("num_stages");
+    if (!anno.defined() || Downcast<Integer>(anno)->value != attr::kAutoNumStages) return loop;
+
+    // the shared buffers written from the global memory and the flops of the gemms per iteration
+    std::unordered_set<const BufferNode*> staged;
+    int64_t stage_bytes = 0, flops = 0;
+    auto add_staged = [&](const Buffer& buffer) {
+      if (!IsShared(buffer) || !staged.insert(buffer.get()).second) return;
+      stage_bytes += BufferBytes(buffer);
+    };
+    PostOrderVisit(loop->body, [&](const ObjectRef& node) {
+      if (const auto* call = node.as<CallNode>()) {
+        if (call->op.same_as(copy())) {
+          auto src = RegionBuffer(call->args[0]), dst = RegionBuffer(call->args[1]);
+          if (src && dst && src.value().scope() == "global") add_staged(dst.value());
+        } else if (call->op.same_as(gemm()) || call->op.same_as(gemm_sp())) {
+          int64_t m = Downcast<IntImm>(call->args[5])->value;
+          int64_t n = Downcast<IntImm>(call->args[6])->value;
+          int64_t k = Downcast<IntImm>(call->args[7])->value;
+          // the sparse tensor cores skip half of the products
+          flops += (call->op.same_as(gemm()) ? 2 : 1) * m * n * k;
+        }
+      } else if (const auto* store = node.as<BufferStoreNode>()) {
+        bool from_global = false;
+        PostOrderVisit(store->value, [&](const ObjectRef& value) {
+          if (const auto* load = value.as<BufferLoadNode>())
+            from_global |= load->buffer.scope() == "global";
+        });
+        if (from_global) add_staged(store->buffer);
+      }
+    });
+
+    auto n = loop.CopyOnWrite();
+    if (stage_bytes == 0) {
+      // nothing is loaded from the global memory, the loop is not pipelined
+      n->annotations.erase("num_stages");
+      return loop;
+    }
+    n->annotations.Set("num_stages", Integer(PlanNumStages(loop, stage_bytes, flops)));
+    n->annotations.Set(attr::kPipelinePrefetch, Integer(1));
+    return loop;
+  }
+
+  int PlanNumStages(const For& loop, int64_t stage_bytes, int64_t flops) {
+    // the latency of a load from the global memory in cycles
+    constexpr int64_t kGlobalLatency = 600;
+    constexpr int64_t kMaxNumStages = 8;
+    int64_t compute = flops / TargetGetTensorCoreFlopsPerCycle(target_);
+    int64_t memory = stage_bytes / TargetGetGlobalBytesPerCycle(target_);
+    int64_t iteration = std::max<int64_t>({compute, memory, 1});
+    int64_t num_stages = 1 + (kGlobalLatency + memory + iteration - 1) / iteration;
+
+    int64_t budget = TargetGetMaxSharedMemoryPerBlock(target_);
+    if (min_blocks_per_sm_ > 1) {
+      // the shared memory of an SM also holds 1KB per block reserved by the system
+      budget = std::min(budget, TargetGetSharedMemoryPerSM(target_) / min_blocks_per_sm_ - 1024);
+    }
+    int64_t fit = (budget - (shared_bytes_ - stage_bytes)) / stage_bytes;
+    num_stages = std::min({num_stages, fit, kMaxNumStages});
+    if (auto extent = as_const_int(loop->extent)) num_stages = std::min(num_stages, *extent);
+    return static_cast<int>(std::max<int64_t>(num_stages, 1));
+  }
+
+  const TargetNode* target_;
+  int64_t shared_bytes_ = 0;
+  int64_t min_blocks_per_sm_ = 0;
+};
+
+tvm::transform::Pass PlanNumStages() {
+  using namespace tir::transform;
+  auto pass_func = [=](PrimFunc f, IRModule m, PassContext ctx) {
+    PrimFuncNode* fptr = f.CopyOnWrite();
+    fptr->body = NumStagesPlanner::Substitute(f);
+    return f;
+  };
+  return CreatePrimFuncPass(pass_func, 0, "tl.PlanNumStages", {});
+}
+
+TVM_REGISTER_GLOBAL("tl.PlanNumStages").set_body_typed(PlanNumStages);
+
 tvm::transform::Pass PipelinePlanning() {
   using namespace tir::transform;
   auto pass_func = [=](PrimFunc f, IRModule m, PassContext ctx) {
@@ -233,7 +631,7 @@ tvm::transform::Pass PipelinePlanning() {
     fptr->body = PipelinePlanner::Substitute(f);
     return f;
   };
-  return CreatePrimFuncPass(pass_func, 0, "tl.PipelinePlanning", {});
+  return CreatePrimFuncPass(pass_func, 0, "tl.PipelinePlanning", {}, /*function_local=*/true);
 }
 
 TVM_REGISTER_GLOBAL("tl.PipelinePlanning").set_body_typed(PipelinePlanning);
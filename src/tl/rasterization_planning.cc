@@ -0,0 +1,277 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file rasterization_planning.cc
+ * \brief Pick the order, the panel width and the blockIdx.z interleaving of T.use_swizzle("auto")
+ * from the global memory footprint of the blocks and the L2 size of the device
+ */
+
+#include <tvm/runtime/device_api.h>
+#include <tvm/tir/analysis.h>
+#include <tvm/tir/stmt_functor.h>
+#include <tvm/tir/transform.h>
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "op.h"
+#include "target_utils.h"
+
+namespace tvm {
+namespace tl {
+
+using namespace tir;
+
+TVM_REGISTER_PASS_CONFIG_OPTION("tl.l2_cache_bytes", Integer);
+
+// An attribute of the device 0, 0 without a device
+static int64_t QueryDevice(runtime::DeviceAttrKind kind) {
+  Device dev{kDLCUDA, 0};
+  auto api = runtime::DeviceAPI::Get(dev, /*allow_missing=*/true);
+  if (api == nullptr) return 0;
+  runtime::TVMRetValue exist, value;
+  api->GetAttr(dev, runtime::kExist, &exist);
+  if (!static_cast<int>(exist)) return 0;
+  api->GetAttr(dev, kind, &value);
+  return static_cast<int64_t>(value);
+}
+
+/*!
+ * \brief The bytes of the global memory read by a block over the whole kernel, the strips shared
+ * by the blocks of a row of the grid (indexed by blockIdx.y only), of a column (by blockIdx.x
+ * only), and the parts of both that do not depend on blockIdx.z.
+ */
+class BlockFootprintCollector : public StmtExprVisitor {
+ public:
+  BlockFootprintCollector(const VarNode* bx, const VarNode* by, const VarNode* bz)
+      : bx_(bx), by_(by), bz_(bz) {}
+
+  double row_bytes = 0, col_bytes = 0;
+  double row_z_shared = 0, col_z_shared = 0;
+
+ private:
+  void VisitStmt_(const ForNode* op) final {
+    loops_.push_back(op);
+    StmtExprVisitor::VisitStmt_(op);
+    loops_.pop_back();
+  }
+
+  void VisitExpr_(const CallNode* op) final {
+    if (op->op.same_as(tl::region())) {
+      auto load = op->args[0].as<BufferLoadNode>();
+      ICHECK(load);
+      int access_mask = Downcast<IntImm>(op->args[1])->value;
+      if ((access_mask & 1) && load->buffer.scope() == "global") {
+        Array<PrimExpr> extents(op->args.begin() + 2, op->args.end());
+        AddRead(load->buffer, load->indices, extents);
+      }
+      for (const auto& index : load->indices) VisitExpr(index);
+      return;
+    }
+    StmtExprVisitor::VisitExpr_(op);
+  }
+
+  void VisitExpr_(const BufferLoadNode* op) final {
+    if (op->buffer.scope() == "global") AddRead(op->buffer, op->indices, {});
+    StmtExprVisitor::VisitExpr_(op);
+  }
+
+  // The loops iterating the region are counted into its bytes
+  void AddRead(const Buffer& buffer, const Array<PrimExpr>& mins, const Array<PrimExpr>& extents) {
+    std::unordered_set<const VarNode*> used;
+    for (const auto& index : mins) {
+      PostOrderVisit(index, [&](const ObjectRef& node) {
+        if (auto var = node.as<VarNode>()) used.insert(var);
+      });
+    }
+    double bytes = buffer->dtype.bytes() * buffer->dtype.lanes();
+    for (const auto& extent : extents) {
+      auto imm = as_const_int(extent);
+      if (!imm) return;
+      bytes *= *imm;
+    }
+    for (const ForNode* loop : loops_) {
+      if (!used.count(loop->loop_var.get())) continue;
+      auto imm = as_const_int(loop->extent);
+      if (!imm) return;
+      bytes *= *imm;
+    }
+    bool x = used.count(bx_), y = used.count(by_), z = bz_ && used.count(bz_);
+    if (x == y) return;
+    (y ? row_bytes : col_bytes) += bytes;
+    if (!z) (y ? row_z_shared : col_z_shared) += bytes;
+  }
+
+  const VarNode *bx_, *by_, *bz_;
+  std::vector<const ForNode*> loops_;
+};
+
+/*!
+ * \brief Resolves T.use_swizzle("auto"). With a wave of W blocks and p rows of blockIdx.y in a
+ * panel, the row order reads the row strips of a panel once if the p row strips and the W / p
+ * column strips of a wave fit in the L2, and the column strips once per panel unless all of them
+ * fit with the row strips of a panel. The order and the panel with the fewest estimated reads are
+ * taken, the column order swaps the roles of the rows and the columns.
+ */
+class RasterizationPlanner : public StmtExprMutator {
+ public:
+  RasterizationPlanner(int64_t l2_bytes, int64_t num_sms)
+      : l2_bytes_(l2_bytes), num_sms_(num_sms) {}
+
+ private:
+  Stmt VisitStmt_(const AttrStmtNode* op) final {
+    if (op->attr_key == tir::attr::thread_extent) {
+      IterVar iv = Downcast<IterVar>(op->node);
+      std::string tag = iv->thread_tag;
+      if (tag.rfind("blockIdx", 0) == 0) block_ivs_[tag.back() - 'x'] = iv;
+    } else if (op->attr_key == attr::kMinBlocksPerSM) {
+      min_blocks_per_sm_ = Downcast<Integer>(op->value)->value;
+    } else if (op->attr_key == "threadblock_swizzle_pattern") {
+      auto pattern = op->value.as<StringImmNode>();
+      if (pattern && pattern->value == "auto") {
+        Stmt body = VisitStmt(op->body);
+        return AttrStmt(ObjectRef(), op->attr_key, StringImm(Plan(op)), body, op->span);
+      }
+    }
+    return StmtExprMutator::VisitStmt_(op);
+  }
+
+  std::string Plan(const AttrStmtNode* op) {
+    auto options = Downcast<Array<ObjectRef>>(op->node);
+    ICHECK_EQ(options.size(), 3);
+    std::string order = Downcast<String>(options[0]);
+    int panel = Downcast<IntImm>(options[1])->value;
+    int interleave = Downcast<IntImm>(options[2])->value;
+
+    auto extent = [&](int dim) -> int64_t {
+      if (!block_ivs_[dim].defined()) return 1;
+      auto imm = as_const_int(block_ivs_[dim]->dom->extent);
+      return imm ? *imm : -1;
+    };
+    int64_t gx = extent(0), gy = extent(1), gz = extent(2);
+    auto var = [&](int dim) {
+      return block_ivs_[dim].defined() ? block_ivs_[dim]->var.get() : nullptr;
+    };
+    BlockFootprintCollector footprint(var(0), var(1), var(2));
+    footprint(op->body);
+    double row = footprint.row_bytes, col = footprint.col_bytes;
+    // the dynamic grids and the blocks without shared strips keep the default panel of 8 rows
+    if (gx <= 0 || gy <= 0 || gz <= 0 || row + col == 0) {
+      return MakePattern(order == "auto" ? "row" : order, panel ? panel : 8, interleave == 1);
+    }
+    // the slices sharing an operand run the blocks of the same tile together
+    bool z_inner = interleave == -1
+                       ? gz > 1 && (footprint.row_z_shared > 0 || footprint.col_z_shared > 0)
+                       : interleave == 1;
+    double wave = static_cast<double>(num_sms_ * std::max<int64_t>(min_blocks_per_sm_, 1));
+    if (z_inner) {
+      row = footprint.row_z_shared + (row - footprint.row_z_shared) * gz;
+      col = footprint.col_z_shared + (col - footprint.col_z_shared) * gz;
+      wave = std::max(1.0, wave / gz);
+    }
+    // half of the L2, the far partition and the outputs take the rest
+    double budget = l2_bytes_ / 2.0;
+
+    if (order == "morton" || order == "hilbert") {
+      if (panel == 0) {
+        panel = 1;
+        while (panel * 2 <= std::min(gx, gy) && 4.0 * panel * panel <= wave &&
+               panel * 2 * (row + col) <= budget) {
+          panel *= 2;
+        }
+      }
+      return MakePattern(order, panel, z_inner);
+    }
+
+    // the reads of the row order with the panels of p rows of a grid_rows x grid_cols grid
+    auto reads = [&](int64_t p, int64_t grid_rows, int64_t grid_cols, double row, double col) {
+      double window = p * row + wave / p * col;
+      double row_reads = window <= budget ? 1.0 : std::max(1.0, grid_cols * p / wave);
+      double col_reads = grid_cols * col + p * row <= budget ? 1.0 : std::ceil(1.0 * grid_rows / p);
+      return std::make_pair(grid_rows * row * row_reads + grid_cols * col * col_reads, window);
+    };
+    std::string best_order = "row";
+    int best_panel = panel ? panel : 1;
+    std::pair<double, double> best = {INFINITY, INFINITY};
+    for (std::string candidate : {"row", "column"}) {
+      if (order != "auto" && order != candidate) continue;
+      bool is_row = candidate == "row";
+      int64_t rows = is_row ? gy : gx, cols = is_row ? gx : gy;
+      for (int p = 1; p <= 32; p *= 2) {
+        if (panel && p != panel) continue;
+        if (!panel && p > 1 && p > rows) break;
+        auto cost = is_row ? reads(p, rows, cols, row, col) : reads(p, rows, cols, col, row);
+        if (cost < best) {
+          best = cost;
+          best_order = candidate;
+          best_panel = p;
+        }
+      }
+    }
+    return MakePattern(best_order, best_panel, z_inner);
+  }
+
+  static std::string MakePattern(const std::string& order, int panel, bool z_inner) {
+    std::ostringstream os;
+    const char* z = z_inner ? "true" : "false";
+    if (order == "row") {
+      os << "tl::rasterization2DRow<" << panel << ", " << z << ">";
+    } else if (order == "column") {
+      os << "tl::rasterization2DColumn<" << panel << ", " << z << ">";
+    } else {
+      ICHECK(order == "morton" || order == "hilbert") << "Unknown rasterization order " << order;
+      os << "tl::rasterization2DCurve<" << panel << ", " << (order == "hilbert" ? "true" : "false")
+         << ", " << z << ">";
+    }
+    return os.str();
+  }
+
+  int64_t l2_bytes_, num_sms_;
+  IterVar block_ivs_[3];
+  int64_t min_blocks_per_sm_ = 0;
+};
+
+using namespace tir::transform;
+
+tvm::transform::Pass RasterizationPlanning() {
+  auto pass_func = [=](PrimFunc f, IRModule m, PassContext ctx) {
+    int64_t l2_bytes = ctx->GetConfig<Integer>("tl.l2_cache_bytes", Integer(0)).value()->value;
+    int64_t num_sms = ctx->GetConfig<Integer>("tl.num_sms", Integer(0)).value()->value;
+    if (l2_bytes == 0) l2_bytes = QueryDevice(runtime::kL2CacheSizeBytes);
+    if (num_sms == 0) num_sms = QueryDevice(runtime::kMultiProcessorCount);
+    auto target = f->GetAttr<Target>(tvm::attr::kTarget);
+    if (l2_bytes == 0 && target) l2_bytes = TargetGetL2CacheSize(target.value().get());
+    if (num_sms == 0 && target) num_sms = TargetGetNumSMs(target.value().get());
+    auto* n = f.CopyOnWrite();
+    n->body = RasterizationPlanner(l2_bytes, std::max<int64_t>(num_sms, 1))(n->body);
+    return f;
+  };
+  return CreatePrimFuncPass(pass_func, 0, "tl.RasterizationPlanning", {});
+}
+
+TVM_REGISTER_GLOBAL("tl.RasterizationPlanning").set_body_typed(RasterizationPlanning);
+
+}  // namespace tl
+}  // namespace tvm
@@ -0,0 +1,158 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file register_usage.cc
+ * \brief Estimate the registers and shared memory of the kernels, warn about the spills and the
+ * occupancy below min_blocks_per_sm
+ */
+
+#include <tvm/tir/op.h>
+#include <tvm/tir/stmt_functor.h>
+#include <tvm/tir/transform.h>
+
+#include <algorithm>
+
+#include "../tir/transforms/ir_utils.h"
+#include "op.h"
+#include "target_utils.h"
+
+namespace tvm {
+namespace tl {
+
+using namespace tir;
+
+TVM_REGISTER_PASS_CONFIG_OPTION("tl.disable_register_usage_warning", Bool);
+
+/*!
+ * \brief The launch bounds and the memory of a kernel: the peak number of bytes per thread of the
+ * local arrays (the lowered fragments and the local buffers) live at the same time, the
+ * multi-buffered ones of the pipelined loops included, and the bytes of shared memory. The grid,
+ * the block and the stages of the software pipelines are kept for the kernel metadata.
+ */
+class KernelResourceEstimator : public StmtVisitor {
+ public:
+  int64_t peak_local_bytes = 0;
+  int64_t shared_bytes = 0;
+  int64_t num_threads = 1;
+  int64_t min_blocks_per_sm = 0;
+  // the extents of blockIdx.x/y/z and threadIdx.x/y/z, symbolic with the dynamic shapes
+  Array<PrimExpr> grid_dims{Integer(1), Integer(1), Integer(1)};
+  Array<PrimExpr> block_dims{Integer(1), Integer(1), Integer(1)};
+  Array<Integer> pipeline_stages;
+
+ private:
+  void VisitStmt_(const AllocateNode* op) final {
+    std::string scope = GetPtrStorageScope(op->buffer_var);
+    int64_t bytes = op->dtype.bytes() * op->dtype.lanes();
+    for (const auto& extent : op->extents) {
+      auto imm = as_const_int(extent);
+      // the dynamic local arrays are placed in the local memory anyway
+      bytes = imm ? bytes * *imm : 0;
+    }
+    if (scope == "shared" || scope == "shared.dyn") shared_bytes += bytes;
+    if (scope != "local") bytes = 0;
+    live_bytes_ += bytes;
+    peak_local_bytes = std::max(peak_local_bytes, live_bytes_);
+    StmtVisitor::VisitStmt_(op);
+    live_bytes_ -= bytes;
+  }
+
+  void VisitStmt_(const AttrStmtNode* op) final {
+    if (op->attr_key == tir::attr::thread_extent) {
+      IterVar iv = Downcast<IterVar>(op->node);
+      std::string tag = iv->thread_tag;
+      if (tag.rfind("threadIdx", 0) == 0) {
+        if (auto extent = as_const_int(op->value)) num_threads *= *extent;
+        block_dims.Set(tag.back() - 'x', op->value);
+      } else if (tag.rfind("blockIdx", 0) == 0) {
+        grid_dims.Set(tag.back() - 'x', op->value);
+      }
+    } else if (op->attr_key == attr::kMinBlocksPerSM) {
+      min_blocks_per_sm = Downcast<Integer>(op->value)->value;
+    }
+    StmtVisitor::VisitStmt_(op);
+  }
+
+  void VisitStmt_(const ForNode* op) final {
+    if (auto stages = op->annotations.Get(attr::kPipelineStages)) {
+      pipeline_stages.push_back(Downcast<Integer>(stages));
+    }
+    StmtVisitor::VisitStmt_(op);
+  }
+
+  int64_t live_bytes_ = 0;
+};
+
+// The registers per thread available under __launch_bounds__(num_threads, min_blocks): the
+// register file of an SM (64K 32-bit registers) split among the warps of the blocks, allocated by
+// 8 registers per thread.
+static int64_t RegisterBudget(int64_t num_threads, int64_t min_blocks) {
+  int64_t warps = (num_threads + 31) / 32 * std::max<int64_t>(min_blocks, 1);
+  return std::min<int64_t>(255, 65536 / (warps * 32) / 8 * 8);
+}
+
+using namespace tir::transform;
+
+tvm::transform::Pass EstimateRegisterUsage() {
+  auto pass_func = [=](PrimFunc f, IRModule m, PassContext ctx) {
+    KernelResourceEstimator estimator;
+    estimator(f->body);
+    String name = f->GetAttr<String>(tvm::attr::kGlobalSymbol).value_or("the kernel");
+    int64_t registers = (estimator.peak_local_bytes + 3) / 4;
+    int64_t min_blocks = estimator.min_blocks_per_sm;
+    int64_t budget = RegisterBudget(estimator.num_threads, min_blocks);
+    bool warn = !ctx->GetConfig<Bool>("tl.disable_register_usage_warning", Bool(false)).value();
+    if (warn && registers > budget) {
+      LOG(WARNING) << "The local arrays of " << name << " need about " << registers
+                   << " registers per thread, over the " << budget << " registers available with "
+                   << estimator.num_threads << " threads and "
+                   << std::max<int64_t>(min_blocks, 1)
+                   << " blocks per SM, the kernel will spill to the local memory. Use smaller "
+                      "tiles or more threads.";
+    }
+    if (auto target = f->GetAttr<Target>(tvm::attr::kTarget)) {
+      int64_t max_shared = TargetGetMaxSharedMemoryPerBlock(target.value().get());
+      ICHECK_LE(estimator.shared_bytes, max_shared)
+          << name << " uses " << estimator.shared_bytes << " bytes of shared memory, over the "
+          << max_shared << " bytes available to a block on " << target.value()->str();
+      // the shared memory of an SM also holds 1KB per block reserved by the system
+      int64_t per_block = estimator.shared_bytes + 1024;
+      int64_t fit = TargetGetSharedMemoryPerSM(target.value().get()) / per_block;
+      if (warn && min_blocks > fit) {
+        LOG(WARNING) << name << " requests " << min_blocks << " blocks per SM, only " << fit
+                     << " fit in the shared memory with " << estimator.shared_bytes
+                     << " bytes per block";
+      }
+    }
+    f = WithAttr(std::move(f), "tl.num_threads", Integer(estimator.num_threads));
+    f = WithAttr(std::move(f), "tl.min_blocks_per_sm", Integer(min_blocks));
+    f = WithAttr(std::move(f), "tl.shared_memory_bytes", Integer(estimator.shared_bytes));
+    f = WithAttr(std::move(f), "tl.grid_dims", estimator.grid_dims);
+    f = WithAttr(std::move(f), "tl.block_dims", estimator.block_dims);
+    f = WithAttr(std::move(f), "tl.pipeline_stages", estimator.pipeline_stages);
+    return WithAttr(std::move(f), "tl.local_registers", Integer(registers));
+  };
+  return CreatePrimFuncPass(pass_func, 0, "tl.EstimateRegisterUsage", {});
+}
+
+TVM_REGISTER_GLOBAL("tl.EstimateRegisterUsage").set_body_typed(EstimateRegisterUsage);
+
+}  // namespace tl
+}  // namespace tvm
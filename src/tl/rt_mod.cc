@@ -17,43 +17,283 @@
  * under the License.
  */
 
+#include <dmlc/memory_io.h>
+#include <tvm/ir/transform.h>
+#include <tvm/node/structural_hash.h>
+#include <tvm/tir/stmt_functor.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <thread>
+
 #include "../runtime/cuda/cuda_module.h"
+#include "../runtime/file_utils.h"
+#include "../support/utils.h"
 #include "../target/build_common.h"
 #include "codegen.h"
+#include "op.h"
+#include "target_utils.h"
 
 namespace tvm {
 namespace codegen {
 
+TVM_REGISTER_PASS_CONFIG_OPTION("tl.use_nvrtc", Bool);
+// read by tl.lower, removes the argument checks of the host functions
+TVM_REGISTER_PASS_CONFIG_OPTION("tl.disable_host_checks", Bool);
+// read by tvm_tl_cuda_compile, compiles to a cubin with the ptxas resource usage (default true)
+TVM_REGISTER_PASS_CONFIG_OPTION("tl.ptxas_report", Bool);
+// read by tvm_tl_cuda_compile, the SMs (e.g. [80, 86, 89]) of a fatbin loaded without JIT on each
+TVM_REGISTER_PASS_CONFIG_OPTION("tl.cuda_archs", Array<Integer>);
+
+// The fatbins of nvcc --fatbin start with the magic 0xBA55ED50, the cubins are ELF files
+static bool IsFatbin(const std::string& data) {
+  return data.size() >= 4 && static_cast<uint8_t>(data[0]) == 0x50 &&
+         static_cast<uint8_t>(data[1]) == 0xED && static_cast<uint8_t>(data[2]) == 0x55 &&
+         static_cast<uint8_t>(data[3]) == 0xBA;
+}
+
+static bool CallsOp(const PrimFunc& f, const Op& op) {
+  bool found = false;
+  tir::PostOrderVisit(f->body, [&](const ObjectRef& node) {
+    if (auto call = node.as<CallNode>()) {
+      if (call->op.same_as(op)) found = true;
+    }
+  });
+  return found;
+}
+
+static std::unordered_map<std::string, runtime::FunctionInfo> ExtractTLFuncInfo(
+    const IRModule& mod) {
+  auto fmap = ExtractFuncInfo(mod);
+  for (auto kv : mod->functions) {
+    auto f = Downcast<PrimFunc>(kv.second);
+    auto global_symbol = f->GetAttr<String>(tvm::attr::kGlobalSymbol);
+    auto& info = fmap[static_cast<std::string>(global_symbol.value())];
+    // the kernels waiting for the previous kernel with T.pdl_wait may start before it completes
+    if (CallsOp(f, tl::pdl_wait())) {
+      info.launch_param_tags.insert(info.launch_param_tags.begin(),
+                                    runtime::launch_param::kUseProgrammaticDependentLaunchTag);
+    }
+    // the blocks synchronizing with T.grid_sync must all be resident
+    if (CallsOp(f, tl::grid_sync())) {
+      info.launch_param_tags.insert(info.launch_param_tags.begin(),
+                                    runtime::launch_param::kUseCooperativeLaunchTag);
+    }
+    auto tensor_maps = CollectTensorMapParams(f);
+    if (tensor_maps.empty()) continue;
+    for (const auto& param : f->params) {
+      info.arg_extra_tags.push_back(tensor_maps.count(param.get())
+                                        ? runtime::FunctionInfo::ArgExtraTags::kTensorMap
+                                        : runtime::FunctionInfo::ArgExtraTags::kNone);
+    }
+  }
+  return fmap;
+}
+
+// Compile in-process with NVRTC instead of calling nvcc through tvm_tl_cuda_compile
+static bool UseNVRTC() {
+  auto ctxt = transform::PassContext::Current();
+  return ctxt->GetConfig<Bool>("tl.use_nvrtc", Bool(false)).value();
+}
+
+// The compiled kernels are cached on disk under $TL_KERNEL_CACHE_DIR (or the tvm cache dir), keyed
+// by the structural hash of the device module, the target, the pass configs read by CodeGenTL
+// (tl.disable_ldg) and the compile key returned by tvm_tl_cuda_compile_key, which covers the nvcc
+// options, the template versions and the libtvm build. Returns the path without extension, or
+// an empty string if the cache is disabled by TL_DISABLE_KERNEL_CACHE.
+static std::string GetKernelCachePath(const IRModule& mod, const Target& target) {
+  using tvm::runtime::Registry;
+  const char* disable = getenv("TL_DISABLE_KERNEL_CACHE");
+  if (disable != nullptr && std::string(disable) != "0") return "";
+  std::string key = target->str();
+  if (UseNVRTC()) key += "nvrtc";
+  // the read only parameters loaded through tl::ldg, see CodeGenTL::AddFunction
+  auto ctxt = transform::PassContext::Current();
+  if (ctxt->GetConfig<Bool>("tl.disable_ldg", Bool(false)).value()) key += "disable_ldg";
+  if (const auto* f = Registry::Get("tvm_tl_cuda_compile_key")) {
+    key += (*f)(target).operator std::string();
+  }
+  uint64_t hash = StructuralHash()(mod);
+  hash = support::HashCombine(hash, String::StableHashBytes(key.data(), key.size()));
+
+  const char* env_dir = getenv("TL_KERNEL_CACHE_DIR");
+  std::string dir = env_dir ? env_dir : runtime::GetCacheDir() + "/tl_kernels";
+  std::error_code ec;
+  std::filesystem::create_directories(dir, ec);
+  if (ec) {
+    LOG(WARNING) << "Cannot create the kernel cache directory " << dir << ": " << ec.message();
+    return "";
+  }
+  std::ostringstream os;
+  os << dir << "/" << std::hex << std::setw(16) << std::setfill('0') << hash;
+  return os.str();
+}
+
+// The 64-bit key alone may collide, an entry is only used if its source starts with the source
+// generated for the module (followed by the compile report), otherwise it is compiled again and
+// overwritten.
+static Optional<runtime::Module> LoadCachedKernel(const std::string& path,
+                                                  const std::string& source) {
+  if (!std::filesystem::exists(path + ".cu")) return NullOpt;
+  for (std::string fmt : {"fatbin", "cubin", "ptx"}) {
+    std::string file = path + "." + fmt;
+    // the meta file is written last, a partially written entry is not visible
+    if (!std::filesystem::exists(runtime::GetMetaFilePath(file))) continue;
+    std::string data, code;
+    runtime::LoadBinaryFromFile(path + ".cu", &code);
+    if (code.compare(0, source.size(), source) != 0) return NullOpt;
+    std::unordered_map<std::string, runtime::FunctionInfo> fmap;
+    runtime::LoadBinaryFromFile(file, &data);
+    runtime::LoadMetaDataFromFile(runtime::GetMetaFilePath(file), &fmap);
+    return runtime::CUDAModuleCreate(data, fmt, fmap, code);
+  }
+  return NullOpt;
+}
+
+// Each file is written to a temporary file and renamed, so that the processes (or threads of
+// tl.lower_many) compiling the same kernel concurrently never read a partial entry.
+static void SaveCachedKernel(const std::string& path, const std::string& data,
+                             const std::string& fmt, const std::string& code,
+                             const std::unordered_map<std::string, runtime::FunctionInfo>& fmap) {
+  std::string file = path + "." + fmt;
+  std::string meta_file = runtime::GetMetaFilePath(file);
+  std::string tmp_suffix = ".tmp" + std::to_string(getpid()) + "_" +
+                           std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+  std::error_code ec;
+  runtime::SaveBinaryToFile(path + ".cu" + tmp_suffix, code);
+  std::filesystem::rename(path + ".cu" + tmp_suffix, path + ".cu", ec);
+  runtime::SaveBinaryToFile(file + tmp_suffix, data);
+  std::filesystem::rename(file + tmp_suffix, file, ec);
+  runtime::SaveMetaDataToFile(meta_file + tmp_suffix, fmap);
+  std::filesystem::rename(meta_file + tmp_suffix, meta_file, ec);
+  if (ec) LOG(WARNING) << "Cannot save the kernel cache " << file << ": " << ec.message();
+}
+
+// The HIP source of the ROCm targets compiled by tvm_tl_hip_compile into a code object (hsaco),
+// loaded by the ROCm runtime through its loadbinary_hsaco, which is only registered in the builds
+// with USE_ROCM. The kernel cache and the resource reports are CUDA only.
+static runtime::Module BuildTLHIP(IRModule mod, Target target) {
+  using tvm::runtime::Registry;
+  ICHECK(tl::TargetIsCDNA(target.get()))
+      << "The TL kernels require the MFMA of CDNA (gfx908, gfx90a or gfx94x), got "
+      << target->str();
+  CodeGenTL cg(/*hip=*/true);
+  cg.Init(/*output_ssa=*/false);
+  for (auto kv : mod->functions) {
+    ICHECK(kv.second->IsInstance<PrimFuncNode>()) << "CodeGenTL: Can only take PrimFunc";
+    auto f = Downcast<PrimFunc>(kv.second);
+    auto calling_conv = f->GetAttr<Integer>(tvm::attr::kCallingConv);
+    ICHECK(calling_conv == CallingConv::kDeviceKernelLaunch);
+    cg.AddFunction(f);
+  }
+  std::string code = cg.Finish();
+  const auto* f = Registry::Get("tvm_tl_hip_compile");
+  ICHECK(f != nullptr) << "tvm_tl_hip_compile is not registered, import tvm.tl";
+  std::string hsaco = (*f)(code, target).operator std::string();
+  const auto* load = Registry::Get("runtime.module.loadbinary_hsaco");
+  ICHECK(load != nullptr) << "The ROCm targets require TVM built with USE_ROCM";
+  // the serialized form of the ROCm modules: the format, the function infos and the code object
+  std::string blob;
+  dmlc::MemoryStringStream stream(&blob);
+  stream.Write(std::string("hsaco"));
+  stream.Write(ExtractFuncInfo(mod));
+  stream.Write(hsaco);
+  stream.Seek(0);
+  return (*load)(static_cast<void*>(&stream));
+}
+
 runtime::Module BuildTL(IRModule mod, Target target) {
   using tvm::runtime::Registry;
+  if (tl::TargetIsRocm(target.get())) return BuildTLHIP(mod, target);
   bool output_ssa = false;
   CodeGenTL cg;
   cg.Init(output_ssa);
 
+  // the launch bounds, the shared memory and the launch configuration of the kernels (see
+  // EstimateRegisterUsage), kept as comments following the source like the ptxas report
+  std::ostringstream info;
   for (auto kv : mod->functions) {
     ICHECK(kv.second->IsInstance<PrimFuncNode>()) << "CodeGenTL: Can only take PrimFunc";
     auto f = Downcast<PrimFunc>(kv.second);
     auto calling_conv = f->GetAttr<Integer>(tvm::attr::kCallingConv);
     ICHECK(calling_conv == CallingConv::kDeviceKernelLaunch);
     cg.AddFunction(f);
+    if (auto threads = f->GetAttr<Integer>("tl.num_threads")) {
+      info << "\n// tl info : " << f->GetAttr<String>(tvm::attr::kGlobalSymbol).value() << ": "
+           << threads.value()->value << " threads, "
+           << f->GetAttr<Integer>("tl.min_blocks_per_sm").value()->value << " min blocks per SM, "
+           << f->GetAttr<Integer>("tl.shared_memory_bytes").value()->value
+           << " bytes shared memory";
+      auto dims = [](const Array<PrimExpr>& dims) {
+        std::ostringstream os;
+        os << "(" << dims[0] << ", " << dims[1] << ", " << dims[2] << ")";
+        return os.str();
+      };
+      info << "\n// tl launch : " << f->GetAttr<String>(tvm::attr::kGlobalSymbol).value()
+           << ": grid " << dims(f->GetAttr<Array<PrimExpr>>("tl.grid_dims").value())
+           << ", block " << dims(f->GetAttr<Array<PrimExpr>>("tl.block_dims").value()) << ", "
+           << f->GetAttr<Integer>("tl.local_registers").value()->value << " local registers, "
+           << "pipeline stages "
+           << f->GetAttr<Array<Integer>>("tl.pipeline_stages").value_or(Array<Integer>());
+    }
+    // the names of the timers of the instrumented kernels, decoded by tl.decode_timer_trace
+    std::map<int64_t, std::string> timers;
+    int64_t timer_capacity = 0;
+    tir::PostOrderVisit(f->body, [&](const ObjectRef& node) {
+      if (auto attr = node.as<tir::AttrStmtNode>()) {
+        if (attr->attr_key == tl::attr::kTimer) {
+          int64_t tag = Downcast<Integer>(attr->value)->value;
+          timers[tag] = Downcast<tir::StringImm>(attr->node)->value;
+        }
+      } else if (auto call = node.as<tir::CallNode>()) {
+        auto name = call->args.empty() ? nullptr : call->args[0].as<tir::StringImmNode>();
+        if (name && name->value == "tl::timer_record") {
+          timer_capacity = Downcast<Integer>(call->args[2])->value;
+        }
+      }
+    });
+    if (!timers.empty()) {
+      info << "\n// tl timer : " << f->GetAttr<String>(tvm::attr::kGlobalSymbol).value() << ": "
+           << timer_capacity << " records: ";
+      for (auto it = timers.begin(); it != timers.end(); it++) {
+        info << (it == timers.begin() ? "" : ";") << it->first << "=" << it->second;
+      }
+    }
   }
 
   std::string code = cg.Finish();
+  std::string cache_path = GetKernelCachePath(mod, target);
+  if (!cache_path.empty()) {
+    if (auto cached = LoadCachedKernel(cache_path, code)) return cached.value();
+  }
   std::string fmt = "ptx";
   std::string ptx;
-  if (const auto* f = Registry::Get("tvm_tl_cuda_compile")) {
+  if (UseNVRTC()) {
+    ptx = TLNVRTCCompile(code, target);
+    fmt = "cubin";
+  } else if (const auto* f = Registry::Get("tvm_tl_cuda_compile")) {
     ptx = (*f)(code, target).operator std::string();
-    if (ptx[0] != '/') fmt = "cubin";
+    if (ptx[0] != '/') fmt = IsFatbin(ptx) ? "fatbin" : "cubin";
+    // the registers and spills of the kernels, kept with the source in the module and the cache
+    if (const auto* report = Registry::Get("tvm_tl_cuda_compile_report")) {
+      code += (*report)(code).operator std::string();
+    }
   } else {
     ICHECK(0);
   }
-  return runtime::CUDAModuleCreate(ptx, fmt, ExtractFuncInfo(mod), code);
+  code += info.str();
+  auto fmap = ExtractTLFuncInfo(mod);
+  if (!cache_path.empty()) SaveCachedKernel(cache_path, ptx, fmt, code, fmap);
+  return runtime::CUDAModuleCreate(ptx, fmt, fmap, code);
 }
 
 String BuildTLDebug(IRModule mod, Target target) {
   using tvm::runtime::Registry;
   bool output_ssa = false;
-  CodeGenTL cg;
+  CodeGenTL cg(tl::TargetIsRocm(target.get()));
   cg.Init(output_ssa);
 
   for (auto kv : mod->functions) {
@@ -0,0 +1,393 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file shared_memory_reuse.cc
+ * \brief Pack the dynamic shared memory buffers of a kernel by their live ranges among the top
+ * level statements of the kernel, before MergeDynamicSharedMemoryAllocations
+ */
+
+#include <tvm/tir/analysis.h>
+#include <tvm/tir/builtin.h>
+#include <tvm/tir/op.h>
+#include <tvm/tir/stmt_functor.h>
+#include <tvm/tir/transform.h>
+
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "../tir/transforms/ir_utils.h"
+
+namespace tvm {
+namespace tl {
+
+using namespace tir;
+
+TVM_REGISTER_PASS_CONFIG_OPTION("tl.disable_shared_memory_reuse", Bool);
+
+static bool IsDynShared(const VarNode* var) {
+  return GetPtrStorageScope(GetRef<Var>(var)) == "shared.dyn";
+}
+
+static bool IsSharedSync(const Stmt& stmt) {
+  auto eval = stmt.as<EvaluateNode>();
+  if (eval == nullptr) return false;
+  auto call = eval->value.as<CallNode>();
+  if (call == nullptr || !call->op.same_as(builtin::tvm_storage_sync())) return false;
+  auto scope = call->args[0].as<StringImmNode>();
+  return scope && (scope->value == "shared" || scope->value == "shared.dyn");
+}
+
+static void FlattenSeq(const Stmt& stmt, std::vector<Stmt>* seq) {
+  if (auto op = stmt.as<SeqStmtNode>()) {
+    for (const auto& s : op->seq) FlattenSeq(s, seq);
+  } else {
+    seq->push_back(stmt);
+  }
+}
+
+/*!
+ * \brief The dynamic shared buffers touched by a statement. A raw reference to a buffer var
+ * outside of tvm_access_ptr can not be offset, it disables the reuse.
+ */
+class DynSharedTouchCollector : public StmtExprVisitor {
+ public:
+  std::unordered_set<const VarNode*> touched;
+  bool raw_reference = false;
+
+ private:
+  void VisitStmt_(const AllocateNode* op) final {
+    Touch(op->buffer_var.get());
+    StmtExprVisitor::VisitStmt_(op);
+  }
+  void VisitStmt_(const DeclBufferNode* op) final {
+    Touch(op->buffer->data.get());
+    StmtExprVisitor::VisitStmt_(op);
+  }
+  void VisitStmt_(const BufferStoreNode* op) final {
+    Touch(op->buffer->data.get());
+    StmtExprVisitor::VisitStmt_(op);
+  }
+  void VisitExpr_(const BufferLoadNode* op) final {
+    Touch(op->buffer->data.get());
+    StmtExprVisitor::VisitExpr_(op);
+  }
+  void VisitExpr_(const CallNode* op) final {
+    if (op->op.same_as(builtin::tvm_access_ptr())) {
+      Touch(op->args[1].as<VarNode>());
+      for (size_t i = 2; i < op->args.size(); i++) VisitExpr(op->args[i]);
+      return;
+    }
+    StmtExprVisitor::VisitExpr_(op);
+  }
+  void VisitExpr_(const VarNode* op) final {
+    if (IsDynShared(op)) raw_reference = true;
+  }
+  void Touch(const VarNode* var) {
+    if (var && IsDynShared(var)) touched.insert(var);
+  }
+};
+
+/*!
+ * \brief Packs the dynamic shared buffers into a single allocation, the buffers whose live ranges
+ * among the top level statements of the kernel do not intersect share the memory.
+ *
+ * A statement is the unit of the liveness, so a buffer used in a loop is live in all its
+ * iterations (the versions of the multi-buffered buffers in the pipelined loops included) and the
+ * buffers of the specialized paths of a block-uniform if are packed separately. ThreadSync has run
+ * on the separate buffers, a buffer reusing the memory of a dead one waits for the threads still
+ * reading it with a barrier before its first statement, unless there is one already.
+ */
+class SharedMemoryReuse : public StmtExprMutator {
+ public:
+  static Stmt Run(const Stmt& body) {
+    SharedMemoryReuse reuse;
+    if (!reuse.Plan(body)) return body;
+    return reuse.VisitStmt(body);
+  }
+
+ private:
+  struct Region {
+    std::vector<Stmt> seq;
+    std::unordered_map<const VarNode*, int64_t> offsets;
+    std::unordered_set<size_t> sync_before;
+  };
+
+  bool Plan(const Stmt& body) {
+    PostOrderVisit(body, [&](const ObjectRef& node) {
+      if (auto alloc = node.as<AllocateNode>()) {
+        if (IsDynShared(alloc->buffer_var.get())) allocs_[alloc->buffer_var.get()] = alloc;
+      } else if (auto attr = node.as<AttrStmtNode>()) {
+        if (attr->attr_key == tir::attr::thread_extent) {
+          IterVar iv = Downcast<IterVar>(attr->node);
+          if (std::string(iv->thread_tag).rfind("threadIdx", 0) == 0)
+            thread_vars_.insert(iv->var.get());
+        }
+      }
+    });
+    if (allocs_.size() < 2) return false;
+    for (const auto& [_, alloc] : allocs_) {
+      if (alloc->ConstantAllocationSize() == 0) return false;
+    }
+    if (!FindRegions(body)) return false;
+    std::unordered_set<const VarNode*> planned;
+    for (auto& region : regions_) {
+      if (!PlanRegion(&region)) return false;
+      for (const auto& [var, _] : region.offsets) planned.insert(var);
+    }
+    // the buffers out of the regions are left to the merge pass
+    return planned.size() == allocs_.size();
+  }
+
+  // The regions are the statement sequences under the launch, the paths of a block-uniform if
+  // (e.g. from BoundarySpecialize) are separate regions.
+  bool FindRegions(const Stmt& stmt) {
+    auto uses_dyn = [&](const PrimExpr& expr) {
+      return UsesVar(expr, [&](const VarNode* var) { return allocs_.count(var) > 0; });
+    };
+    if (auto op = stmt.as<AttrStmtNode>()) {
+      if (uses_dyn(op->value)) return false;
+      return FindRegions(op->body);
+    } else if (auto op = stmt.as<LetStmtNode>()) {
+      if (uses_dyn(op->value)) return false;
+      return FindRegions(op->body);
+    } else if (auto op = stmt.as<AllocateNode>()) {
+      return FindRegions(op->body);
+    } else if (auto op = stmt.as<DeclBufferNode>()) {
+      return FindRegions(op->body);
+    } else if (auto op = stmt.as<IfThenElseNode>()) {
+      bool uniform = !UsesVar(op->condition,
+                              [&](const VarNode* var) { return thread_vars_.count(var) > 0; });
+      if (uniform && !uses_dyn(op->condition)) {
+        if (!FindRegions(op->then_case)) return false;
+        return !op->else_case.defined() || FindRegions(op->else_case.value());
+      }
+    }
+    Region region;
+    FlattenSeq(stmt, &region.seq);
+    region_index_[stmt.get()] = regions_.size();
+    regions_.push_back(std::move(region));
+    return true;
+  }
+
+  bool PlanRegion(Region* region) {
+    struct Item {
+      const VarNode* var;
+      size_t first, last;
+      int64_t size, align, offset = -1;
+    };
+    std::unordered_map<const VarNode*, Item> items;
+    std::vector<bool> has_sync(region->seq.size(), false);
+    for (size_t i = 0; i < region->seq.size(); i++) {
+      has_sync[i] = IsSharedSync(region->seq[i]);
+      DynSharedTouchCollector collector;
+      collector(region->seq[i]);
+      if (collector.raw_reference) return false;
+      for (const VarNode* var : collector.touched) {
+        if (!allocs_.count(var)) return false;
+        auto it = items.find(var);
+        if (it != items.end()) {
+          it->second.last = i;
+          continue;
+        }
+        const AllocateNode* alloc = allocs_.at(var);
+        int64_t size = alloc->ConstantAllocationSize() * alloc->dtype.bytes();
+        size *= alloc->dtype.lanes();
+        // the swizzled tma boxes are aligned to their swizzle pattern of up to 1024B, which
+        // divides their size
+        int64_t align = 16;
+        while (align < 1024 && size % (align * 2) == 0) align *= 2;
+        items[var] = Item{var, i, i, size, align};
+      }
+    }
+    std::vector<Item*> order;
+    for (auto& [_, item] : items) order.push_back(&item);
+    std::sort(order.begin(), order.end(), [](const Item* a, const Item* b) {
+      if (a->first != b->first) return a->first < b->first;
+      if (a->size != b->size) return a->size > b->size;
+      return a->var->name_hint < b->var->name_hint;
+    });
+    std::vector<Item*> placed;
+    auto overlap = [](int64_t a0, int64_t a1, int64_t b0, int64_t b1) {
+      return a0 < b1 && b0 < a1;
+    };
+    for (Item* item : order) {
+      std::vector<Item*> live;
+      for (Item* other : placed) {
+        if (other->first <= item->last && item->first <= other->last) live.push_back(other);
+      }
+      std::vector<int64_t> candidates = {0};
+      for (Item* other : live) {
+        int64_t end = other->offset + other->size;
+        candidates.push_back((end + item->align - 1) / item->align * item->align);
+      }
+      std::sort(candidates.begin(), candidates.end());
+      for (int64_t offset : candidates) {
+        bool fits = true;
+        for (Item* other : live) {
+          fits &= !overlap(offset, offset + item->size, other->offset, other->offset + other->size);
+        }
+        if (fits) {
+          item->offset = offset;
+          break;
+        }
+      }
+      // the threads still using the dead buffers in this memory are waited for
+      for (Item* other : placed) {
+        if (other->last >= item->first) continue;
+        if (!overlap(item->offset, item->offset + item->size, other->offset,
+                     other->offset + other->size))
+          continue;
+        bool synced = region->sync_before.count(item->first) > 0;
+        for (size_t k = other->last + 1; k < item->first && !synced; k++) {
+          synced = has_sync[k] || region->sync_before.count(k);
+        }
+        if (!synced) region->sync_before.insert(item->first);
+      }
+      placed.push_back(item);
+      region->offsets[item->var] = item->offset;
+      merged_bytes_ = std::max(merged_bytes_, item->offset + item->size);
+    }
+    return true;
+  }
+
+  Stmt VisitStmt(const Stmt& stmt) final {
+    auto it = region_index_.find(stmt.get());
+    if (it == region_index_.end()) return StmtExprMutator::VisitStmt(stmt);
+    // rewrite the statements of a region with its offsets and barriers
+    const Region& region = regions_[it->second];
+    region_index_.erase(it);
+    auto offsets = offsets_;
+    offsets_ = &region.offsets;
+    Array<Stmt> seq;
+    for (size_t i = 0; i < region.seq.size(); i++) {
+      if (region.sync_before.count(i)) {
+        seq.push_back(Evaluate(Call(DataType::Int(32), builtin::tvm_storage_sync(),
+                                    {StringImm("shared")})));
+      }
+      seq.push_back(VisitStmt(region.seq[i]));
+    }
+    offsets_ = offsets;
+    return SeqStmt::Flatten(seq);
+  }
+
+  Stmt VisitStmt_(const AttrStmtNode* op) final {
+    if (op->attr_key == tir::attr::thread_extent && !allocated_) {
+      // the merged buffer is allocated at the beginning of the launch, as the merge pass does
+      allocated_ = true;
+      Stmt body = VisitStmt(op->body);
+      body = Allocate(merged_var_, DataType::UInt(8), {Integer(merged_bytes_)}, const_true(), body);
+      return AttrStmt(op->node, op->attr_key, op->value, body, op->span);
+    }
+    return StmtExprMutator::VisitStmt_(op);
+  }
+
+  Stmt VisitStmt_(const AllocateNode* op) final {
+    if (allocs_.count(op->buffer_var.get())) return VisitStmt(op->body);
+    return StmtExprMutator::VisitStmt_(op);
+  }
+
+  Stmt VisitStmt_(const DeclBufferNode* op) final {
+    auto node = Downcast<DeclBuffer>(StmtExprMutator::VisitStmt_(op));
+    Buffer buffer = RemapBuffer(node->buffer);
+    if (!buffer.same_as(node->buffer)) node.CopyOnWrite()->buffer = buffer;
+    return std::move(node);
+  }
+
+  PrimExpr VisitExpr_(const BufferLoadNode* op) final {
+    auto node = Downcast<BufferLoad>(StmtExprMutator::VisitExpr_(op));
+    return VisitBufferAccess(std::move(node));
+  }
+
+  Stmt VisitStmt_(const BufferStoreNode* op) final {
+    auto node = Downcast<BufferStore>(StmtExprMutator::VisitStmt_(op));
+    return VisitBufferAccess(std::move(node));
+  }
+
+  template <typename Node>
+  Node VisitBufferAccess(Node node) {
+    if (!allocs_.count(node->buffer->data.get())) return node;
+    ICHECK_EQ(node->indices.size(), 1) << "SharedMemoryReuse expects flat memory buffers";
+    PrimExpr offset = GetOffset(node->buffer->data.get(), node->buffer->dtype);
+    auto writer = node.CopyOnWrite();
+    writer->indices = {node->indices[0] + offset};
+    writer->buffer = RemapBuffer(node->buffer);
+    return node;
+  }
+
+  PrimExpr VisitExpr_(const CallNode* op) final {
+    if (op->op.same_as(builtin::tvm_access_ptr())) {
+      auto var = op->args[1].as<VarNode>();
+      if (var && allocs_.count(var)) {
+        PrimExpr offset = VisitExpr(op->args[2]) + GetOffset(var, op->args[0].dtype());
+        return Call(op->dtype, op->op,
+                    {op->args[0], merged_var_, offset, VisitExpr(op->args[3]), op->args[4]});
+      }
+    }
+    return StmtExprMutator::VisitExpr_(op);
+  }
+
+  PrimExpr GetOffset(const VarNode* var, DataType dtype) {
+    ICHECK(offsets_ && offsets_->count(var)) << "The shared buffer " << var->name_hint
+                                             << " is accessed out of its region";
+    int64_t bytes = offsets_->at(var);
+    int64_t elem_bytes = dtype.bytes() * dtype.lanes();
+    ICHECK_EQ(bytes % elem_bytes, 0);
+    return make_const(DataType::Int(32), bytes / elem_bytes);
+  }
+
+  Buffer RemapBuffer(const Buffer& buffer) {
+    if (!allocs_.count(buffer->data.get())) return buffer;
+    auto it = buffer_remap_.find(buffer.get());
+    if (it != buffer_remap_.end()) return it->second;
+    Buffer remapped = buffer;
+    remapped.CopyOnWrite()->data = merged_var_;
+    buffer_remap_[buffer.get()] = remapped;
+    return remapped;
+  }
+
+  std::unordered_map<const VarNode*, const AllocateNode*> allocs_;
+  std::unordered_set<const VarNode*> thread_vars_;
+  std::vector<Region> regions_;
+  std::unordered_map<const Object*, size_t> region_index_;
+  const std::unordered_map<const VarNode*, int64_t>* offsets_ = nullptr;
+  std::unordered_map<const BufferNode*, Buffer> buffer_remap_;
+  int64_t merged_bytes_ = 0;
+  bool allocated_ = false;
+  Var merged_var_{"buf_dyn_shmem", PointerType(PrimType(DataType::UInt(8)), "shared.dyn")};
+};
+
+using namespace tir::transform;
+
+tvm::transform::Pass SharedMemoryReusePass() {
+  auto pass_func = [=](PrimFunc f, IRModule m, PassContext ctx) {
+    if (ctx->GetConfig<Bool>("tl.disable_shared_memory_reuse", Bool(false)).value()) return f;
+    auto* n = f.CopyOnWrite();
+    n->body = SharedMemoryReuse::Run(n->body);
+    return f;
+  };
+  return CreatePrimFuncPass(pass_func, 0, "tl.SharedMemoryReuse", {});
+}
+
+TVM_REGISTER_GLOBAL("tl.SharedMemoryReuse").set_body_typed(SharedMemoryReusePass);
+
+}  // namespace tl
+}  // namespace tvm
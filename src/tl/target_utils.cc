@@ -24,10 +24,22 @@
 
 #include "target_utils.h"
 
+#include <string>
+
 namespace tvm {
 namespace tl {
 
 bool TargetIsCuda(const TargetNode* target) { return target->GetTargetDeviceType() == kDLCUDA; }
+bool TargetIsRocm(const TargetNode* target) { return target->GetTargetDeviceType() == kDLROCM; }
+
+// The gfx version of the ROCm targets, e.g. 0x90a for gfx90a
+int GetGfxVersion(const TargetNode* target) {
+  auto s = target->GetAttr<String>("mcpu");
+  ICHECK(s.defined()) << "The ROCm target requires -mcpu, e.g. rocm -mcpu=gfx90a";
+  std::string mcpu = s.value();
+  ICHECK_EQ(mcpu.rfind("gfx", 0), 0) << "Unknown ROCm mcpu " << mcpu;
+  return static_cast<int>(std::stoi(mcpu.substr(3), nullptr, 16));
+}
 
 int GetArchInt(const TargetNode* target) {
   auto s = target->GetAttr<String>("arch");
@@ -57,7 +69,90 @@ bool TargetIsAmpere(const TargetNode* target) {
   return arch >= 80 && arch < 90;
 }
 
-bool TargetHasAsyncCopy(const TargetNode* target) { return TargetIsAmpere(target); }
+bool TargetIsHopper(const TargetNode* target) {
+  if (!TargetIsCuda(target)) return false;
+  int arch = GetArchInt(target);
+  return arch == 90;
+}
+
+bool TargetIsAmpereOrLater(const TargetNode* target) {
+  if (!TargetIsCuda(target)) return false;
+  return GetArchInt(target) >= 80;
+}
+
+bool TargetIsCDNA(const TargetNode* target) {
+  if (!TargetIsRocm(target)) return false;
+  int gfx = GetGfxVersion(target);
+  return gfx == 0x908 || gfx == 0x90a || (gfx >= 0x940 && gfx < 0x950);
+}
+
+int TargetGetWarpSize(const TargetNode* target) { return TargetIsCDNA(target) ? 64 : 32; }
+
+bool TargetHasAsyncCopy(const TargetNode* target) { return TargetIsAmpereOrLater(target); }
+
+bool TargetHasFP8MMA(const TargetNode* target) {
+  if (!TargetIsCuda(target)) return false;
+  return GetArchInt(target) >= 89;
+}
+
+int TargetGetSharedMemoryPerSM(const TargetNode* target) {
+  if (TargetIsCDNA(target)) return 64 << 10;
+  int arch = GetArchInt(target);
+  if (arch >= 90) return 228 << 10;
+  if (arch == 80 || arch == 87) return 164 << 10;
+  if (arch >= 80) return 100 << 10;
+  if (arch >= 75) return 64 << 10;
+  return 96 << 10;
+}
+
+int TargetGetMaxSharedMemoryPerBlock(const TargetNode* target) {
+  if (TargetIsCDNA(target)) return 64 << 10;
+  // 1KB of the shared memory is reserved for each block since sm_80
+  int arch = GetArchInt(target);
+  return TargetGetSharedMemoryPerSM(target) - (arch >= 80 ? 1 << 10 : 0);
+}
+
+int TargetGetTensorCoreFlopsPerCycle(const TargetNode* target) {
+  if (TargetIsCDNA(target)) return GetGfxVersion(target) >= 0x940 ? 2048 : 1024;
+  int arch = GetArchInt(target);
+  if (arch >= 90) return 4096;
+  if (arch == 80 || arch == 87) return 2048;
+  if (arch >= 70) return 1024;
+  return 256;
+}
+
+int TargetGetGlobalBytesPerCycle(const TargetNode* target) {
+  if (TargetIsCDNA(target)) return GetGfxVersion(target) == 0x908 ? 6 : 8;
+  int arch = GetArchInt(target);
+  if (arch >= 90) return 14;
+  if (arch == 80 || arch == 87) return 10;
+  return 8;
+}
+
+int64_t TargetGetL2CacheSize(const TargetNode* target) {
+  // the L2 of a GCD (MI200) or of an XCD (MI300), the blocks are spread over the XCDs
+  if (TargetIsCDNA(target)) return GetGfxVersion(target) >= 0x940 ? 4 << 20 : 8 << 20;
+  int arch = GetArchInt(target);
+  if (arch >= 90) return 50 << 20;
+  if (arch == 89) return 72 << 20;
+  if (arch == 80) return 40 << 20;
+  if (arch == 75) return 4 << 20;
+  return 6 << 20;
+}
+
+int TargetGetNumSMs(const TargetNode* target) {
+  if (TargetIsCDNA(target)) {
+    int gfx = GetGfxVersion(target);
+    return gfx >= 0x940 ? 304 : gfx == 0x90a ? 110 : 120;
+  }
+  int arch = GetArchInt(target);
+  if (arch >= 90) return 132;
+  if (arch == 89) return 128;
+  if (arch == 80) return 108;
+  if (arch >= 80) return 84;
+  if (arch == 75) return 72;
+  return 80;
+}
 
 }  // namespace tl
 }  // namespace tvm
@@ -32,12 +32,37 @@ namespace tvm {
 namespace tl {
 
 bool TargetIsCuda(const TargetNode* target);
+bool TargetIsRocm(const TargetNode* target);
 
 bool TargetIsVolta(const TargetNode* target);
 bool TargetIsTuring(const TargetNode* target);
 bool TargetIsAmpere(const TargetNode* target);
+// sm_90 only, the wgmma, TMA and warp specialization paths are not used by the later archs
+bool TargetIsHopper(const TargetNode* target);
+// sm_80 and later, with the mma.sync and cp.async of Ampere
+bool TargetIsAmpereOrLater(const TargetNode* target);
+// The AMD Instinct GPUs with the MFMA matrix cores: gfx908 (MI100), gfx90a (MI200), gfx94x (MI300)
+bool TargetIsCDNA(const TargetNode* target);
+
+// The threads of a warp, 64 for the wavefronts of CDNA
+int TargetGetWarpSize(const TargetNode* target);
 
 bool TargetHasAsyncCopy(const TargetNode* target);
+bool TargetHasFP8MMA(const TargetNode* target);
+
+// The shared memory (LDS on CDNA) of an SM (CU), and the most a block can use (opt-in), in bytes
+int TargetGetSharedMemoryPerSM(const TargetNode* target);
+int TargetGetMaxSharedMemoryPerBlock(const TargetNode* target);
+
+// The dense fp16 tensor core flops and the DRAM bytes an SM processes per cycle, at the peak of the
+// flagship GPU of the architecture
+int TargetGetTensorCoreFlopsPerCycle(const TargetNode* target);
+int TargetGetGlobalBytesPerCycle(const TargetNode* target);
+
+// The L2 size in bytes and the number of SMs of the flagship GPU of the architecture, for the
+// compilation without a device
+int64_t TargetGetL2CacheSize(const TargetNode* target);
+int TargetGetNumSMs(const TargetNode* target);
 
 }  // namespace tl
 }  // namespace tvm
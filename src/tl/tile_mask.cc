@@ -0,0 +1,180 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file tile_mask.cc
+ * \brief Classify the tiles of an element-wise mask as full, partial or empty
+ */
+
+#include <tvm/arith/analyzer.h>
+#include <tvm/arith/pattern.h>
+#include <tvm/runtime/registry.h>
+#include <tvm/tir/analysis.h>
+#include <tvm/tir/op.h>
+
+namespace tvm {
+namespace tl {
+
+using namespace tir;
+
+/*!
+ * \brief The conditions under which mask(i, j) holds for all (full) or for none (empty) of the
+ * elements of the box of the rows and the columns. The comparisons of expressions affine in i and
+ * j with constant coefficients are bounded on the corners of the box, the other atoms using i or
+ * j are unknown (neither full nor empty), so the tiles are only classified conservatively.
+ */
+class TileMaskClassifier {
+ public:
+  TileMaskClassifier(Var i, Var j, Range rows, Range cols)
+      : vars_({i, j}), ranges_({rows, cols}) {}
+
+  std::pair<PrimExpr, PrimExpr> Classify(const PrimExpr& mask) {
+    if (auto op = mask.as<AndNode>()) {
+      auto [full_a, empty_a] = Classify(op->a);
+      auto [full_b, empty_b] = Classify(op->b);
+      return {full_a && full_b, empty_a || empty_b};
+    } else if (auto op = mask.as<OrNode>()) {
+      auto [full_a, empty_a] = Classify(op->a);
+      auto [full_b, empty_b] = Classify(op->b);
+      return {full_a || full_b, empty_a && empty_b};
+    } else if (auto op = mask.as<NotNode>()) {
+      auto [full, empty] = Classify(op->a);
+      return {empty, full};
+    }
+    if (!UsesVar(mask, [this](const VarNode* v) {
+          return v == vars_[0].get() || v == vars_[1].get();
+        })) {
+      return {mask, !mask};
+    }
+    // the bounds of lhs - rhs on the box
+    PrimExpr diff;
+    if (auto op = mask.as<LTNode>()) {
+      diff = op->a - op->b;
+    } else if (auto op = mask.as<LENode>()) {
+      diff = op->a - op->b;
+    } else if (auto op = mask.as<GTNode>()) {
+      diff = op->a - op->b;
+    } else if (auto op = mask.as<GENode>()) {
+      diff = op->a - op->b;
+    } else if (auto op = mask.as<EQNode>()) {
+      diff = op->a - op->b;
+    } else if (auto op = mask.as<NENode>()) {
+      diff = op->a - op->b;
+    } else {
+      return Unknown();
+    }
+    Array<PrimExpr> coeffs = arith::DetectLinearEquation(diff, vars_);
+    if (coeffs.empty()) return Unknown();
+    PrimExpr lo = coeffs[2], hi = coeffs[2];
+    for (int d = 0; d < 2; d++) {
+      auto coeff = as_const_int(coeffs[d]);
+      if (coeff == nullptr) return Unknown();
+      PrimExpr first = ranges_[d]->min, last = ranges_[d]->min + ranges_[d]->extent - 1;
+      if (*coeff > 0) {
+        lo = lo + coeffs[d] * first;
+        hi = hi + coeffs[d] * last;
+      } else if (*coeff < 0) {
+        lo = lo + coeffs[d] * last;
+        hi = hi + coeffs[d] * first;
+      }
+    }
+    PrimExpr zero = make_zero(lo.dtype());
+    if (mask.as<LTNode>()) return {hi < zero, lo >= zero};
+    if (mask.as<LENode>()) return {hi <= zero, lo > zero};
+    if (mask.as<GTNode>()) return {lo > zero, hi <= zero};
+    if (mask.as<GENode>()) return {lo >= zero, hi < zero};
+    if (mask.as<EQNode>()) return {lo == zero && hi == zero, lo > zero || hi < zero};
+    return {lo > zero || hi < zero, lo == zero && hi == zero};
+  }
+
+ private:
+  static std::pair<PrimExpr, PrimExpr> Unknown() { return {Bool(false), Bool(false)}; }
+
+  Array<Var> vars_;
+  Array<Range> ranges_;
+};
+
+/*!
+ * \brief Tighten [start, stop) of the column tiles k so that the tiles for which one of the
+ * disjuncts of empty(k) holds are left out. The disjuncts are comparisons affine in k with a
+ * constant coefficient, the others are kept in the range.
+ */
+static void TightenTileRange(const PrimExpr& empty, const Var& k, PrimExpr* start,
+                             PrimExpr* stop) {
+  if (auto op = empty.as<OrNode>()) {
+    TightenTileRange(op->a, k, start, stop);
+    TightenTileRange(op->b, k, start, stop);
+    return;
+  }
+  // as e > 0 over the integers
+  PrimExpr e;
+  if (auto op = empty.as<LTNode>()) {
+    e = op->b - op->a;
+  } else if (auto op = empty.as<LENode>()) {
+    e = op->b - op->a + 1;
+  } else if (auto op = empty.as<GTNode>()) {
+    e = op->a - op->b;
+  } else if (auto op = empty.as<GENode>()) {
+    e = op->a - op->b + 1;
+  } else {
+    return;
+  }
+  if (!e.dtype().is_int()) return;
+  Array<PrimExpr> coeffs = arith::DetectLinearEquation(e, {k});
+  if (coeffs.empty()) return;
+  auto a = as_const_int(coeffs[0]);
+  if (a == nullptr || *a == 0) return;
+  PrimExpr b = coeffs[1];
+  if (*a > 0) {
+    // a * k + b > 0 for k >= floor(-b / a) + 1
+    *stop = min(*stop, floordiv(-b, coeffs[0]) + 1);
+  } else {
+    // b > -a * k for k < ceil(b / -a)
+    PrimExpr neg_a = make_const(b.dtype(), -*a);
+    *start = max(*start, floordiv(b + neg_a - 1, neg_a));
+  }
+}
+
+TVM_REGISTER_GLOBAL("tl.ClassifyTileMask")
+    .set_body_typed([](PrimExpr mask, Var i, Var j, PrimExpr row_min, PrimExpr row_extent,
+                       PrimExpr col_min, PrimExpr col_extent) {
+      TileMaskClassifier classifier(i, j, Range::FromMinExtent(row_min, row_extent),
+                                    Range::FromMinExtent(col_min, col_extent));
+      auto [full, empty] = classifier.Classify(mask);
+      arith::Analyzer analyzer;
+      return Array<PrimExpr>{analyzer.Simplify(full), analyzer.Simplify(empty)};
+    });
+
+TVM_REGISTER_GLOBAL("tl.TileMaskRange")
+    .set_body_typed([](PrimExpr mask, Var i, Var j, PrimExpr row_min, PrimExpr block_M,
+                       PrimExpr block_N, PrimExpr num_tiles) {
+      Var k("k", num_tiles.dtype());
+      TileMaskClassifier classifier(i, j, Range::FromMinExtent(row_min, block_M),
+                                    Range::FromMinExtent(k * block_N, block_N));
+      PrimExpr empty = classifier.Classify(mask).second;
+      PrimExpr start = make_zero(num_tiles.dtype()), stop = num_tiles;
+      TightenTileRange(empty, k, &start, &stop);
+      arith::Analyzer analyzer;
+      start = analyzer.Simplify(start);
+      stop = analyzer.Simplify(max(stop, start));
+      return Array<PrimExpr>{start, stop};
+    });
+
+}  // namespace tl
+}  // namespace tvm
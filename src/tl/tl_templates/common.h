@@ -3,11 +3,14 @@
 #include <cuda_runtime.h>
 #include <cutlass/array.h>
 #include <cutlass/fast_math.h>
+#include <cutlass/float8.h>
 #include <cutlass/numeric_types.h>
 #include <math_constants.h>
 
 using cutlass::Array;
 using cutlass::bfloat16_t;
+using cutlass::float_e4m3_t;
+using cutlass::float_e5m2_t;
 using cutlass::half_t;
 using cutlass::tfloat32_t;
 
@@ -34,3 +37,187 @@ inline __device__ unsigned __pack_half2(const bfloat16_t x, const bfloat16_t y)
   unsigned v1 = *((unsigned short*)&y);
   return (v1 << 16) | v0;
 }
+
+namespace tl {
+
+// Synchronize a group of threads with the named barrier, id 0 is used by __syncthreads.
+__forceinline__ __device__ void named_barrier_sync(int barrier_id, int num_threads) {
+  asm volatile("bar.sync %0, %1;" ::"r"(barrier_id), "r"(num_threads));
+}
+
+// 2^x with ex2.approx, the exponentials of the online softmax with log2(e) folded into the scale
+__forceinline__ __device__ float exp2_approx(float x) {
+  float y;
+  asm("ex2.approx.ftz.f32 %0, %1;" : "=f"(y) : "f"(x));
+  return y;
+}
+
+// The %globaltimer nanoseconds, comparable across the SMs unlike clock64
+__forceinline__ __device__ uint64_t timer_ns() {
+  uint64_t t;
+  asm volatile("mov.u64 %0, %%globaltimer;" : "=l"(t));
+  return t;
+}
+
+// Lane 0 of each warp appends the record of a timer of the instrumented kernels (pass config
+// tl.instrument_timing) to the ring buffer of capacity records following the header record, whose
+// first value counts the records written: {sm << 32 | block, warp << 32 | tag, start ns,
+// elapsed ns << 32 | elapsed cycles}.
+__forceinline__ __device__ void timer_record(int64_t* trace, int capacity, int tag,
+                                             uint64_t start_ns, int64_t start_cycles) {
+  int64_t cycles = clock64() - start_cycles;
+  uint64_t ns = timer_ns() - start_ns;
+  if ((threadIdx.x & 31) != 0) return;
+  unsigned sm;
+  asm volatile("mov.u32 %0, %%smid;" : "=r"(sm));
+  unsigned block = blockIdx.x + gridDim.x * (blockIdx.y + gridDim.y * blockIdx.z);
+  unsigned long long slot =
+      atomicAdd(reinterpret_cast<unsigned long long*>(trace), 1ull) % capacity;
+  int64_t* record = trace + 4 * (slot + 1);
+  record[0] = (static_cast<int64_t>(sm) << 32) | block;
+  record[1] = (static_cast<int64_t>(threadIdx.x >> 5) << 32) | tag;
+  record[2] = static_cast<int64_t>(start_ns);
+  record[3] = static_cast<int64_t>((ns << 32) | (static_cast<uint64_t>(cycles) & 0xffffffffu));
+}
+
+// Whether ptr is aligned to bytes, the runtime check of the loops vectorized by the auto vectorizer
+// whose global buffers may be views with an offset
+__forceinline__ __device__ bool is_aligned(const void* ptr, int bytes) {
+  return reinterpret_cast<uintptr_t>(ptr) % bytes == 0;
+}
+
+// Load through the read-only non-coherent cache (ld.global.nc), the loads of the kernel params
+// which the kernel does not write. The types of 1 to 16 bytes aligned to their size are loaded as
+// the integers of the same size.
+template <typename T>
+__forceinline__ __device__ T ldg(const T* ptr) {
+  T value;
+  if constexpr (sizeof(T) == 16 && alignof(T) >= 16) {
+    uint4 v = __ldg(reinterpret_cast<const uint4*>(ptr));
+    memcpy(&value, &v, sizeof(T));
+  } else if constexpr (sizeof(T) == 8 && alignof(T) >= 8) {
+    uint2 v = __ldg(reinterpret_cast<const uint2*>(ptr));
+    memcpy(&value, &v, sizeof(T));
+  } else if constexpr (sizeof(T) == 4 && alignof(T) >= 4) {
+    unsigned v = __ldg(reinterpret_cast<const unsigned*>(ptr));
+    memcpy(&value, &v, sizeof(T));
+  } else if constexpr (sizeof(T) == 2 && alignof(T) >= 2) {
+    unsigned short v = __ldg(reinterpret_cast<const unsigned short*>(ptr));
+    memcpy(&value, &v, sizeof(T));
+  } else if constexpr (sizeof(T) == 1) {
+    unsigned char v = __ldg(reinterpret_cast<const unsigned char*>(ptr));
+    memcpy(&value, &v, sizeof(T));
+  } else {
+    value = *ptr;
+  }
+  return value;
+}
+
+template <typename T, typename T_src>
+__forceinline__ __device__ void AtomicAdd(T* address, T_src val) {
+  if constexpr (std::is_same_v<T, half_t>) {
+    atomicAdd(reinterpret_cast<__half*>(address), static_cast<half_t>(val).to_half());
+  } else if constexpr (std::is_same_v<T, bfloat16_t>) {
+    bfloat16_t v = static_cast<bfloat16_t>(val);
+    atomicAdd(reinterpret_cast<__nv_bfloat16*>(address), *reinterpret_cast<__nv_bfloat16*>(&v));
+  } else {
+    atomicAdd(address, static_cast<T>(val));
+  }
+}
+
+// Atomically add 2 consecutive values in registers to address, aligned to the vector size
+template <typename T, typename T_src>
+__forceinline__ __device__ void AtomicAddx2(T* address, const T_src* val) {
+  if constexpr (std::is_same_v<T, half_t>) {
+    unsigned v = __pack_half2(static_cast<half_t>(val[0]), static_cast<half_t>(val[1]));
+    atomicAdd(reinterpret_cast<half2*>(address), *reinterpret_cast<half2*>(&v));
+  } else if constexpr (std::is_same_v<T, bfloat16_t>) {
+    unsigned v = __pack_half2(static_cast<bfloat16_t>(val[0]), static_cast<bfloat16_t>(val[1]));
+    atomicAdd(reinterpret_cast<__nv_bfloat162*>(address), *reinterpret_cast<__nv_bfloat162*>(&v));
+#if defined(__CUDA_ARCH__) && __CUDA_ARCH__ >= 900
+  } else if constexpr (std::is_same_v<T, float>) {
+    atomicAdd(reinterpret_cast<float2*>(address),
+              make_float2(static_cast<float>(val[0]), static_cast<float>(val[1])));
+#endif
+  } else {
+    AtomicAdd(address, val[0]);
+    AtomicAdd(address + 1, val[1]);
+  }
+}
+
+template <typename T, typename T_src>
+__forceinline__ __device__ void AtomicAddx4(T* address, const T_src* val) {
+#if defined(__CUDA_ARCH__) && __CUDA_ARCH__ >= 900
+  if constexpr (std::is_same_v<T, float>) {
+    atomicAdd(reinterpret_cast<float4*>(address),
+              make_float4(static_cast<float>(val[0]), static_cast<float>(val[1]),
+                          static_cast<float>(val[2]), static_cast<float>(val[3])));
+    return;
+  }
+#endif
+  AtomicAddx2(address, val);
+  AtomicAddx2(address + 2, val + 2);
+}
+
+// The value of x on the lane of the warp, see the shuffles of T.shuffle_layout
+template <typename T>
+__forceinline__ __device__ T shfl_sync(T x, int lane) {
+  return T(__shfl_sync(uint32_t(-1), x, lane));
+}
+
+// The copy of a buffer on the device of rank, peers holding the addresses of the copies of all the
+// ranks mapped into this process (tl.make_peer_table)
+__forceinline__ __device__ void* peer_ptr(const int64_t* peers, int rank) {
+  return reinterpret_cast<void*>(__ldg(peers + rank));
+}
+
+// Wait until the signal, possibly written by the peers, reaches at least value, called by all the
+// threads of the block. The writes made before the signal_set/signal_add of the producer are
+// visible to the block after it.
+__forceinline__ __device__ void signal_wait(int* signal, int value) {
+  if (threadIdx.x == 0) {
+    int current;
+    do {
+      asm volatile("ld.acquire.sys.global.b32 %0, [%1];" : "=r"(current) : "l"(signal) : "memory");
+    } while (current < value);
+  }
+  __syncthreads();
+}
+
+// Set the signal to value after the global writes of all the threads of the block, including those
+// to the peers, called by all the threads of the block
+__forceinline__ __device__ void signal_set(int* signal, int value) {
+  __syncthreads();
+  if (threadIdx.x == 0) {
+    __threadfence_system();
+    asm volatile("st.release.sys.global.b32 [%0], %1;" : : "l"(signal), "r"(value) : "memory");
+  }
+}
+
+// Add value to the signal after the global writes of the block, e.g. the count of the tiles of a
+// shard written by the producers
+__forceinline__ __device__ void signal_add(int* signal, int value) {
+  __syncthreads();
+  if (threadIdx.x == 0) {
+    __threadfence_system();
+    asm volatile("red.release.sys.global.add.s32 [%0], %1;" : : "l"(signal), "r"(value) : "memory");
+  }
+}
+
+// Allow the next kernel of the stream, launched with the programmatic dependent launch, to start
+// once all the blocks of this kernel called it or exited (T.pdl_trigger)
+__forceinline__ __device__ void pdl_trigger() {
+#if defined(__CUDA_ARCH__) && __CUDA_ARCH__ >= 900
+  asm volatile("griddepcontrol.launch_dependents;" ::: "memory");
+#endif
+}
+
+// Wait for the previous kernel of the stream to complete, its writes being visible after it
+// (T.pdl_wait). Returns immediately if the kernel was not launched as a dependent.
+__forceinline__ __device__ void pdl_wait() {
+#if defined(__CUDA_ARCH__) && __CUDA_ARCH__ >= 900
+  asm volatile("griddepcontrol.wait;" ::: "memory");
+#endif
+}
+
+}  // namespace tl
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cuda.h>
+
 #include "common.h"
 
 namespace tl {
@@ -23,56 +25,144 @@ __forceinline__ __device__ unsigned int cast_smem_ptr_to_int(const void* const s
   return smem_int;
 }
 
-template <int N>
-__forceinline__ __device__ void cp_async_gs(void const* const smem_addr, void* global_ptr) {
-  static_assert(N == 16 || N == 8 || N == 4);
-  unsigned int addr = cast_smem_ptr_to_int(smem_addr);
-  if constexpr (N == 16) {
-    __asm__ __volatile__(
+// The L2 eviction priorities of T.copy(cache_hint=...), see CopyArgs::CacheHint. no_allocate
+// streams the lines through the L2 at the lowest priority, without the L2 prefetch.
+enum class CacheHint : int { kNone = 0, kEvictFirst = 1, kEvictLast = 2, kNoAllocate = 3 };
+
+// The L2 prefetch size in bytes of the copies without l2_prefetch
 #if TL_ENABLE_L2_PREFETCH
-        "cp.async.cg.shared.global.L2::128B [%0], [%1], %2;"
+constexpr int kDefaultL2Prefetch = 128;
 #else
-        "cp.async.cg.shared.global [%0], [%1], %2;"
+constexpr int kDefaultL2Prefetch = 0;
 #endif
-        ::"r"(addr),
-        "l"((void*)(global_ptr)), "n"(N));
+
+// The cache policy applying the eviction priority of Hint to all the accessed lines
+template <int Hint>
+__forceinline__ __device__ uint64_t make_l2_policy() {
+  uint64_t policy;
+  if constexpr (Hint == int(CacheHint::kEvictLast)) {
+    asm volatile("createpolicy.fractional.L2::evict_last.b64 %0, 1.0;" : "=l"(policy));
   } else {
-    __asm__ __volatile__(
-#if TL_ENABLE_L2_PREFETCH
-        "cp.async.ca.shared.global.L2::128B [%0], [%1], %2;"
-#else
-        "cp.async.ca.shared.global [%0], [%1], %2;"
-#endif
-        ::"r"(addr),
-        "l"((void*)(global_ptr)), "n"(N));
+    asm volatile("createpolicy.fractional.L2::evict_first.b64 %0, 1.0;" : "=l"(policy));
   }
+  return policy;
 }
 
-template <int N>
-__forceinline__ __device__ void cp_async_gs_conditional(void const* const smem_addr,
-                                                        void* global_ptr, bool cond) {
+#define TL_CP_ASYNC(LEVEL, PREFETCH)                                                              \
+  if constexpr (Hint == int(CacheHint::kNone)) {                                                  \
+    asm volatile("cp.async." LEVEL ".shared.global" PREFETCH " [%0], [%1], %2, %3;" ::"r"(addr), \
+                 "l"(global_ptr), "n"(N), "r"(src_size));                                         \
+  } else {                                                                                        \
+    asm volatile("cp.async." LEVEL ".shared.global.L2::cache_hint" PREFETCH                       \
+                 " [%0], [%1], %2, %3, %4;" ::"r"(addr),                                          \
+                 "l"(global_ptr), "n"(N), "r"(src_size), "l"(make_l2_policy<Hint>()));            \
+  }
+
+#define TL_CP_ASYNC_PREFETCH(LEVEL)       \
+  if constexpr (prefetch == 0) {          \
+    TL_CP_ASYNC(LEVEL, "")                \
+  } else if constexpr (prefetch == 64) {  \
+    TL_CP_ASYNC(LEVEL, ".L2::64B")        \
+  } else if constexpr (prefetch == 128) { \
+    TL_CP_ASYNC(LEVEL, ".L2::128B")       \
+  } else {                                \
+    TL_CP_ASYNC(LEVEL, ".L2::256B")       \
+  }
+
+// Copy N bytes, the src_size first ones from global_ptr and zeros for the others. Prefetch is the
+// L2 prefetch size in bytes (-1 for kDefaultL2Prefetch) and Hint the CacheHint of the lines.
+template <int N, int Prefetch, int Hint>
+__forceinline__ __device__ void cp_async_gs_impl(void const* const smem_addr, void* global_ptr,
+                                                 int src_size) {
   static_assert(N == 16 || N == 8 || N == 4);
-  int bytes = cond ? N : 0;
+  static_assert(Prefetch == -1 || Prefetch == 0 || Prefetch == 64 || Prefetch == 128 ||
+                Prefetch == 256);
+  constexpr int prefetch = Hint == int(CacheHint::kNoAllocate) ? 0
+                           : Prefetch == -1                    ? kDefaultL2Prefetch
+                                                               : Prefetch;
   unsigned int addr = cast_smem_ptr_to_int(smem_addr);
+  // only the 16-byte copies can bypass the L1
   if constexpr (N == 16) {
-    __asm__ __volatile__(
-#if TL_ENABLE_L2_PREFETCH
-        "cp.async.cg.shared.global.L2::128B [%0], [%1], %2, %3;"
-#else
-        "cp.async.cg.shared.global [%0], [%1], %2, %3;"
-#endif
-        ::"r"(addr),
-        "l"((void*)(global_ptr)), "n"(N), "r"(bytes));
+    TL_CP_ASYNC_PREFETCH("cg")
   } else {
-    __asm__ __volatile__(
-#if TL_ENABLE_L2_PREFETCH
-        "cp.async.ca.shared.global.L2::128B [%0], [%1], %2, %3;"
-#else
-        "cp.async.ca.shared.global [%0], [%1], %2, %3;"
-#endif
-        ::"r"(addr),
-        "l"((void*)(global_ptr)), "n"(N), "r"(bytes));
+    TL_CP_ASYNC_PREFETCH("ca")
+  }
+}
+
+#undef TL_CP_ASYNC_PREFETCH
+#undef TL_CP_ASYNC
+
+template <int N, int Prefetch = -1, int Hint = 0>
+__forceinline__ __device__ void cp_async_gs(void const* const smem_addr, void* global_ptr) {
+  cp_async_gs_impl<N, Prefetch, Hint>(smem_addr, global_ptr, N);
+}
+
+template <int N, int Prefetch = -1, int Hint = 0>
+__forceinline__ __device__ void cp_async_gs_conditional(void const* const smem_addr,
+                                                        void* global_ptr, bool cond) {
+  cp_async_gs_impl<N, Prefetch, Hint>(smem_addr, global_ptr, cond ? N : 0);
+}
+
+// Each lane provides the address of a row of 8 contiguous 16-bit elements, the layout of the
+// loaded registers is aligned with makeGemmFragmentA/B in layout.cc.
+template <typename T>
+__forceinline__ __device__ void ptx_ldmatrix_x4(void const* const smem_ptr, T* local_ptr) {
+  static_assert(sizeof(T) == 2);
+  unsigned int addr = cast_smem_ptr_to_int(smem_ptr);
+  unsigned int* value = reinterpret_cast<unsigned int*>(local_ptr);
+  asm volatile("ldmatrix.sync.aligned.m8n8.x4.shared.b16 {%0, %1, %2, %3}, [%4];\n"
+               : "=r"(value[0]), "=r"(value[1]), "=r"(value[2]), "=r"(value[3])
+               : "r"(addr));
+}
+
+template <typename T>
+__forceinline__ __device__ void ptx_ldmatrix_x4_trans(void const* const smem_ptr, T* local_ptr) {
+  static_assert(sizeof(T) == 2);
+  unsigned int addr = cast_smem_ptr_to_int(smem_ptr);
+  unsigned int* value = reinterpret_cast<unsigned int*>(local_ptr);
+  asm volatile("ldmatrix.sync.aligned.m8n8.x4.trans.shared.b16 {%0, %1, %2, %3}, [%4];\n"
+               : "=r"(value[0]), "=r"(value[1]), "=r"(value[2]), "=r"(value[3])
+               : "r"(addr));
+}
+
+template <typename T>
+__forceinline__ __device__ void ptx_ldmatrix_x2_trans(void const* const smem_ptr, T* local_ptr) {
+  static_assert(sizeof(T) == 2);
+  unsigned int addr = cast_smem_ptr_to_int(smem_ptr);
+  unsigned int* value = reinterpret_cast<unsigned int*>(local_ptr);
+  asm volatile("ldmatrix.sync.aligned.m8n8.x2.trans.shared.b16 {%0, %1}, [%2];\n"
+               : "=r"(value[0]), "=r"(value[1])
+               : "r"(addr));
+}
+
+template <typename T>
+__forceinline__ __device__ void ptx_ldmatrix_x2(void const* const smem_ptr, T* local_ptr) {
+  static_assert(sizeof(T) == 2);
+  unsigned int addr = cast_smem_ptr_to_int(smem_ptr);
+  unsigned int* value = reinterpret_cast<unsigned int*>(local_ptr);
+  asm volatile("ldmatrix.sync.aligned.m8n8.x2.shared.b16 {%0, %1}, [%2];\n"
+               : "=r"(value[0]), "=r"(value[1])
+               : "r"(addr));
+}
+
+// The builtin ptx_ldmatrix of the gemms lowered with tl.gemm_ptx_mma: num (2 or 4) matrices,
+// the lanes 8 * i to 8 * i + 7 provide the addresses of the rows of the matrix i.
+template <int num, bool trans, typename T>
+__forceinline__ __device__ void ptx_ldmatrix(void const* const smem_ptr, T* local_ptr) {
+  static_assert(num == 2 || num == 4, "ldmatrix of 2 or 4 matrices");
+  if constexpr (num == 4 && trans) {
+    ptx_ldmatrix_x4_trans(smem_ptr, local_ptr);
+  } else if constexpr (num == 4) {
+    ptx_ldmatrix_x4(smem_ptr, local_ptr);
+  } else if constexpr (trans) {
+    ptx_ldmatrix_x2_trans(smem_ptr, local_ptr);
+  } else {
+    ptx_ldmatrix_x2(smem_ptr, local_ptr);
   }
 }
 
 }  // namespace tl
+
+#if (defined(__CUDA_ARCH__) && (__CUDA_ARCH__ >= 900))
+#include "copy_sm90.h"
+#endif
@@ -0,0 +1,317 @@
+#pragma once
+
+#include "copy.h"
+
+namespace tl {
+
+__forceinline__ __device__ void mbarrier_init(uint64_t* smem_barrier, uint32_t arrive_count) {
+  uint32_t smem_int_ptr = cast_smem_ptr_to_int(smem_barrier);
+  asm volatile("mbarrier.init.shared::cta.b64 [%1], %0;" ::"r"(arrive_count), "r"(smem_int_ptr));
+}
+
+__forceinline__ __device__ void fence_barrier_init() {
+  asm volatile("fence.mbarrier_init.release.cluster;" ::: "memory");
+}
+
+__forceinline__ __device__ void mbarrier_arrive_expect_tx(uint64_t* smem_barrier,
+                                                          uint32_t transaction_bytes) {
+  uint32_t smem_int_ptr = cast_smem_ptr_to_int(smem_barrier);
+  asm volatile("mbarrier.arrive.expect_tx.shared::cta.b64 _, [%1], %0;" ::"r"(transaction_bytes),
+               "r"(smem_int_ptr));
+}
+
+__forceinline__ __device__ void mbarrier_arrive(uint64_t* smem_barrier) {
+  uint32_t smem_int_ptr = cast_smem_ptr_to_int(smem_barrier);
+  asm volatile("mbarrier.arrive.shared::cta.b64 _, [%0];" ::"r"(smem_int_ptr));
+}
+
+// Arrive on the barrier at the same offset in the shared memory of block cta_id of the cluster
+__forceinline__ __device__ void mbarrier_arrive(uint64_t* smem_barrier, uint32_t cta_id) {
+  uint32_t smem_int_ptr = cast_smem_ptr_to_int(smem_barrier);
+  asm volatile(
+      "{\n"
+      ".reg .b32 remAddr32;\n"
+      "mapa.shared::cluster.u32  remAddr32, %0, %1;\n"
+      "mbarrier.arrive.shared::cluster.b64  _, [remAddr32];\n"
+      "}\n" ::"r"(smem_int_ptr),
+      "r"(cta_id));
+}
+
+// Synchronize all the threads of the cluster, also orders the shared memory accesses among them
+__forceinline__ __device__ void cluster_sync() {
+  asm volatile("barrier.cluster.arrive.aligned;\n" ::: "memory");
+  asm volatile("barrier.cluster.wait.aligned;\n" ::: "memory");
+}
+
+// Called by a single thread before issuing the bulk copies which complete the transactions
+__forceinline__ __device__ void mbarrier_init_expect_tx(uint64_t* smem_barrier,
+                                                        uint32_t transaction_bytes) {
+  mbarrier_init(smem_barrier, 1);
+  fence_barrier_init();
+  mbarrier_arrive_expect_tx(smem_barrier, transaction_bytes);
+}
+
+__forceinline__ __device__ void mbarrier_wait(uint64_t* smem_barrier, int phase_bit) {
+  uint32_t smem_int_ptr = cast_smem_ptr_to_int(smem_barrier);
+  asm volatile(
+      "{\n"
+      ".reg .pred P1;\n"
+      "LAB_WAIT:\n"
+      "mbarrier.try_wait.parity.shared::cta.b64 P1, [%0], %1;\n"
+      "@P1 bra.uni DONE;\n"
+      "bra.uni LAB_WAIT;\n"
+      "DONE:\n"
+      "}\n" ::"r"(smem_int_ptr),
+      "r"(phase_bit));
+}
+
+__forceinline__ __device__ void tma_load(const CUtensorMap& descriptor, uint64_t* smem_barrier,
+                                         void const* const smem_ptr, int32_t crd0) {
+  uint64_t gmem_int_desc = reinterpret_cast<uint64_t>(&descriptor);
+  uint32_t smem_int_mbar = cast_smem_ptr_to_int(smem_barrier);
+  uint32_t smem_int_ptr = cast_smem_ptr_to_int(smem_ptr);
+  asm volatile(
+      "cp.async.bulk.tensor.1d.shared::cluster.global.mbarrier::complete_tx::bytes"
+      " [%0], [%1, {%3}], [%2];"
+      :
+      : "r"(smem_int_ptr), "l"(gmem_int_desc), "r"(smem_int_mbar), "r"(crd0)
+      : "memory");
+}
+
+__forceinline__ __device__ void tma_load(const CUtensorMap& descriptor, uint64_t* smem_barrier,
+                                         void const* const smem_ptr, int32_t crd0, int32_t crd1) {
+  uint64_t gmem_int_desc = reinterpret_cast<uint64_t>(&descriptor);
+  uint32_t smem_int_mbar = cast_smem_ptr_to_int(smem_barrier);
+  uint32_t smem_int_ptr = cast_smem_ptr_to_int(smem_ptr);
+  asm volatile(
+      "cp.async.bulk.tensor.2d.shared::cluster.global.mbarrier::complete_tx::bytes"
+      " [%0], [%1, {%3, %4}], [%2];"
+      :
+      : "r"(smem_int_ptr), "l"(gmem_int_desc), "r"(smem_int_mbar), "r"(crd0), "r"(crd1)
+      : "memory");
+}
+
+__forceinline__ __device__ void tma_load(const CUtensorMap& descriptor, uint64_t* smem_barrier,
+                                         void const* const smem_ptr, int32_t crd0, int32_t crd1,
+                                         int32_t crd2) {
+  uint64_t gmem_int_desc = reinterpret_cast<uint64_t>(&descriptor);
+  uint32_t smem_int_mbar = cast_smem_ptr_to_int(smem_barrier);
+  uint32_t smem_int_ptr = cast_smem_ptr_to_int(smem_ptr);
+  asm volatile(
+      "cp.async.bulk.tensor.3d.shared::cluster.global.mbarrier::complete_tx::bytes"
+      " [%0], [%1, {%3, %4, %5}], [%2];"
+      :
+      : "r"(smem_int_ptr), "l"(gmem_int_desc), "r"(smem_int_mbar), "r"(crd0), "r"(crd1),
+        "r"(crd2)
+      : "memory");
+}
+
+__forceinline__ __device__ void tma_load(const CUtensorMap& descriptor, uint64_t* smem_barrier,
+                                         void const* const smem_ptr, int32_t crd0, int32_t crd1,
+                                         int32_t crd2, int32_t crd3) {
+  uint64_t gmem_int_desc = reinterpret_cast<uint64_t>(&descriptor);
+  uint32_t smem_int_mbar = cast_smem_ptr_to_int(smem_barrier);
+  uint32_t smem_int_ptr = cast_smem_ptr_to_int(smem_ptr);
+  asm volatile(
+      "cp.async.bulk.tensor.4d.shared::cluster.global.mbarrier::complete_tx::bytes"
+      " [%0], [%1, {%3, %4, %5, %6}], [%2];"
+      :
+      : "r"(smem_int_ptr), "l"(gmem_int_desc), "r"(smem_int_mbar), "r"(crd0), "r"(crd1),
+        "r"(crd2), "r"(crd3)
+      : "memory");
+}
+
+__forceinline__ __device__ void tma_load(const CUtensorMap& descriptor, uint64_t* smem_barrier,
+                                         void const* const smem_ptr, int32_t crd0, int32_t crd1,
+                                         int32_t crd2, int32_t crd3, int32_t crd4) {
+  uint64_t gmem_int_desc = reinterpret_cast<uint64_t>(&descriptor);
+  uint32_t smem_int_mbar = cast_smem_ptr_to_int(smem_barrier);
+  uint32_t smem_int_ptr = cast_smem_ptr_to_int(smem_ptr);
+  asm volatile(
+      "cp.async.bulk.tensor.5d.shared::cluster.global.mbarrier::complete_tx::bytes"
+      " [%0], [%1, {%3, %4, %5, %6, %7}], [%2];"
+      :
+      : "r"(smem_int_ptr), "l"(gmem_int_desc), "r"(smem_int_mbar), "r"(crd0), "r"(crd1),
+        "r"(crd2), "r"(crd3), "r"(crd4)
+      : "memory");
+}
+
+// Same as tma_load, the lines are loaded with the cache policy of the CacheHint Hint
+template <int Hint>
+__forceinline__ __device__ void tma_load(const CUtensorMap& descriptor, uint64_t* smem_barrier,
+                                         void const* const smem_ptr, int32_t crd0) {
+  uint64_t gmem_int_desc = reinterpret_cast<uint64_t>(&descriptor);
+  uint32_t smem_int_mbar = cast_smem_ptr_to_int(smem_barrier);
+  uint32_t smem_int_ptr = cast_smem_ptr_to_int(smem_ptr);
+  asm volatile(
+      "cp.async.bulk.tensor.1d.shared::cluster.global.mbarrier::complete_tx::bytes"
+      ".L2::cache_hint [%0], [%1, {%4}], [%2], %3;"
+      :
+      : "r"(smem_int_ptr), "l"(gmem_int_desc), "r"(smem_int_mbar), "l"(make_l2_policy<Hint>()),
+        "r"(crd0)
+      : "memory");
+}
+
+template <int Hint>
+__forceinline__ __device__ void tma_load(const CUtensorMap& descriptor, uint64_t* smem_barrier,
+                                         void const* const smem_ptr, int32_t crd0, int32_t crd1) {
+  uint64_t gmem_int_desc = reinterpret_cast<uint64_t>(&descriptor);
+  uint32_t smem_int_mbar = cast_smem_ptr_to_int(smem_barrier);
+  uint32_t smem_int_ptr = cast_smem_ptr_to_int(smem_ptr);
+  asm volatile(
+      "cp.async.bulk.tensor.2d.shared::cluster.global.mbarrier::complete_tx::bytes"
+      ".L2::cache_hint [%0], [%1, {%4, %5}], [%2], %3;"
+      :
+      : "r"(smem_int_ptr), "l"(gmem_int_desc), "r"(smem_int_mbar), "l"(make_l2_policy<Hint>()),
+        "r"(crd0), "r"(crd1)
+      : "memory");
+}
+
+template <int Hint>
+__forceinline__ __device__ void tma_load(const CUtensorMap& descriptor, uint64_t* smem_barrier,
+                                         void const* const smem_ptr, int32_t crd0, int32_t crd1,
+                                         int32_t crd2) {
+  uint64_t gmem_int_desc = reinterpret_cast<uint64_t>(&descriptor);
+  uint32_t smem_int_mbar = cast_smem_ptr_to_int(smem_barrier);
+  uint32_t smem_int_ptr = cast_smem_ptr_to_int(smem_ptr);
+  asm volatile(
+      "cp.async.bulk.tensor.3d.shared::cluster.global.mbarrier::complete_tx::bytes"
+      ".L2::cache_hint [%0], [%1, {%4, %5, %6}], [%2], %3;"
+      :
+      : "r"(smem_int_ptr), "l"(gmem_int_desc), "r"(smem_int_mbar), "l"(make_l2_policy<Hint>()),
+        "r"(crd0), "r"(crd1), "r"(crd2)
+      : "memory");
+}
+
+template <int Hint>
+__forceinline__ __device__ void tma_load(const CUtensorMap& descriptor, uint64_t* smem_barrier,
+                                         void const* const smem_ptr, int32_t crd0, int32_t crd1,
+                                         int32_t crd2, int32_t crd3) {
+  uint64_t gmem_int_desc = reinterpret_cast<uint64_t>(&descriptor);
+  uint32_t smem_int_mbar = cast_smem_ptr_to_int(smem_barrier);
+  uint32_t smem_int_ptr = cast_smem_ptr_to_int(smem_ptr);
+  asm volatile(
+      "cp.async.bulk.tensor.4d.shared::cluster.global.mbarrier::complete_tx::bytes"
+      ".L2::cache_hint [%0], [%1, {%4, %5, %6, %7}], [%2], %3;"
+      :
+      : "r"(smem_int_ptr), "l"(gmem_int_desc), "r"(smem_int_mbar), "l"(make_l2_policy<Hint>()),
+        "r"(crd0), "r"(crd1), "r"(crd2), "r"(crd3)
+      : "memory");
+}
+
+template <int Hint>
+__forceinline__ __device__ void tma_load(const CUtensorMap& descriptor, uint64_t* smem_barrier,
+                                         void const* const smem_ptr, int32_t crd0, int32_t crd1,
+                                         int32_t crd2, int32_t crd3, int32_t crd4) {
+  uint64_t gmem_int_desc = reinterpret_cast<uint64_t>(&descriptor);
+  uint32_t smem_int_mbar = cast_smem_ptr_to_int(smem_barrier);
+  uint32_t smem_int_ptr = cast_smem_ptr_to_int(smem_ptr);
+  asm volatile(
+      "cp.async.bulk.tensor.5d.shared::cluster.global.mbarrier::complete_tx::bytes"
+      ".L2::cache_hint [%0], [%1, {%4, %5, %6, %7, %8}], [%2], %3;"
+      :
+      : "r"(smem_int_ptr), "l"(gmem_int_desc), "r"(smem_int_mbar), "l"(make_l2_policy<Hint>()),
+        "r"(crd0), "r"(crd1), "r"(crd2), "r"(crd3), "r"(crd4)
+      : "memory");
+}
+
+// Same as tma_load, the box is written to the same offset in the shared memory of all the blocks
+// in multicast_mask, completing the transactions on their barriers at the same offset.
+__forceinline__ __device__ void tma_load_multicast(const CUtensorMap& descriptor,
+                                                   uint64_t* smem_barrier,
+                                                   void const* const smem_ptr,
+                                                   uint16_t multicast_mask, int32_t crd0) {
+  uint64_t gmem_int_desc = reinterpret_cast<uint64_t>(&descriptor);
+  uint32_t smem_int_mbar = cast_smem_ptr_to_int(smem_barrier);
+  uint32_t smem_int_ptr = cast_smem_ptr_to_int(smem_ptr);
+  asm volatile(
+      "cp.async.bulk.tensor.1d.shared::cluster.global.mbarrier::complete_tx::bytes"
+      ".multicast::cluster [%0], [%1, {%4}], [%2], %3;"
+      :
+      : "r"(smem_int_ptr), "l"(gmem_int_desc), "r"(smem_int_mbar), "h"(multicast_mask),
+        "r"(crd0)
+      : "memory");
+}
+
+__forceinline__ __device__ void tma_load_multicast(const CUtensorMap& descriptor,
+                                                   uint64_t* smem_barrier,
+                                                   void const* const smem_ptr,
+                                                   uint16_t multicast_mask, int32_t crd0,
+                                                   int32_t crd1) {
+  uint64_t gmem_int_desc = reinterpret_cast<uint64_t>(&descriptor);
+  uint32_t smem_int_mbar = cast_smem_ptr_to_int(smem_barrier);
+  uint32_t smem_int_ptr = cast_smem_ptr_to_int(smem_ptr);
+  asm volatile(
+      "cp.async.bulk.tensor.2d.shared::cluster.global.mbarrier::complete_tx::bytes"
+      ".multicast::cluster [%0], [%1, {%4, %5}], [%2], %3;"
+      :
+      : "r"(smem_int_ptr), "l"(gmem_int_desc), "r"(smem_int_mbar), "h"(multicast_mask),
+        "r"(crd0), "r"(crd1)
+      : "memory");
+}
+
+__forceinline__ __device__ void tma_load_multicast(const CUtensorMap& descriptor,
+                                                   uint64_t* smem_barrier,
+                                                   void const* const smem_ptr,
+                                                   uint16_t multicast_mask, int32_t crd0,
+                                                   int32_t crd1, int32_t crd2) {
+  uint64_t gmem_int_desc = reinterpret_cast<uint64_t>(&descriptor);
+  uint32_t smem_int_mbar = cast_smem_ptr_to_int(smem_barrier);
+  uint32_t smem_int_ptr = cast_smem_ptr_to_int(smem_ptr);
+  asm volatile(
+      "cp.async.bulk.tensor.3d.shared::cluster.global.mbarrier::complete_tx::bytes"
+      ".multicast::cluster [%0], [%1, {%4, %5, %6}], [%2], %3;"
+      :
+      : "r"(smem_int_ptr), "l"(gmem_int_desc), "r"(smem_int_mbar), "h"(multicast_mask),
+        "r"(crd0), "r"(crd1), "r"(crd2)
+      : "memory");
+}
+
+__forceinline__ __device__ void tma_load_multicast(const CUtensorMap& descriptor,
+                                                   uint64_t* smem_barrier,
+                                                   void const* const smem_ptr,
+                                                   uint16_t multicast_mask, int32_t crd0,
+                                                   int32_t crd1, int32_t crd2, int32_t crd3) {
+  uint64_t gmem_int_desc = reinterpret_cast<uint64_t>(&descriptor);
+  uint32_t smem_int_mbar = cast_smem_ptr_to_int(smem_barrier);
+  uint32_t smem_int_ptr = cast_smem_ptr_to_int(smem_ptr);
+  asm volatile(
+      "cp.async.bulk.tensor.4d.shared::cluster.global.mbarrier::complete_tx::bytes"
+      ".multicast::cluster [%0], [%1, {%4, %5, %6, %7}], [%2], %3;"
+      :
+      : "r"(smem_int_ptr), "l"(gmem_int_desc), "r"(smem_int_mbar), "h"(multicast_mask),
+        "r"(crd0), "r"(crd1), "r"(crd2), "r"(crd3)
+      : "memory");
+}
+
+__forceinline__ __device__ void tma_load_multicast(const CUtensorMap& descriptor,
+                                                   uint64_t* smem_barrier,
+                                                   void const* const smem_ptr,
+                                                   uint16_t multicast_mask, int32_t crd0,
+                                                   int32_t crd1, int32_t crd2, int32_t crd3,
+                                                   int32_t crd4) {
+  uint64_t gmem_int_desc = reinterpret_cast<uint64_t>(&descriptor);
+  uint32_t smem_int_mbar = cast_smem_ptr_to_int(smem_barrier);
+  uint32_t smem_int_ptr = cast_smem_ptr_to_int(smem_ptr);
+  asm volatile(
+      "cp.async.bulk.tensor.5d.shared::cluster.global.mbarrier::complete_tx::bytes"
+      ".multicast::cluster [%0], [%1, {%4, %5, %6, %7, %8}], [%2], %3;"
+      :
+      : "r"(smem_int_ptr), "l"(gmem_int_desc), "r"(smem_int_mbar), "h"(multicast_mask),
+        "r"(crd0), "r"(crd1), "r"(crd2), "r"(crd3), "r"(crd4)
+      : "memory");
+}
+
+// Rebalance the registers between the warpgroups of a warp specialized kernel, executed by all
+// the threads of the warpgroup.
+template <uint32_t RegCount>
+__forceinline__ __device__ void warpgroup_reg_alloc() {
+  asm volatile("setmaxnreg.inc.sync.aligned.u32 %0;\n" : : "n"(RegCount));
+}
+
+template <uint32_t RegCount>
+__forceinline__ __device__ void warpgroup_reg_dealloc() {
+  asm volatile("setmaxnreg.dec.sync.aligned.u32 %0;\n" : : "n"(RegCount));
+}
+
+}  // namespace tl
@@ -48,6 +48,51 @@ struct DispatchInstruction<half_t, half_t, float> {
 };
 #endif
 
+#if (defined(__CUDA_ARCH__) && (__CUDA_ARCH__ >= 890))
+// The fp8 mma of sm_89, the operands are distributed as the ones of the int8 m16n8k32 mma and
+// both are K-major
+#define TL_DEFINE_SM89_FP8_MMA(Name, A, B, type_a, type_b)                                        \
+  namespace tl {                                                                                \
+  struct Name {                                                                                 \
+    using DRegisters = float[4];                                                                \
+    using ARegisters = uint32_t[4];                                                             \
+    using BRegisters = uint32_t[2];                                                             \
+    using CRegisters = float[4];                                                                \
+    CUTE_HOST_DEVICE static void fma(float& d0, float& d1, float& d2, float& d3,                \
+                                     uint32_t const& a0, uint32_t const& a1, uint32_t const& a2, \
+                                     uint32_t const& a3, uint32_t const& b0, uint32_t const& b1, \
+                                     float const& c0, float const& c1, float const& c2,         \
+                                     float const& c3) {                                         \
+      asm volatile("mma.sync.aligned.m16n8k32.row.col.f32." type_a "." type_b ".f32 "           \
+                   "{%0, %1, %2, %3}, {%4, %5, %6, %7}, {%8, %9}, {%10, %11, %12, %13};\n"      \
+                   : "=f"(d0), "=f"(d1), "=f"(d2), "=f"(d3)                                     \
+                   : "r"(a0), "r"(a1), "r"(a2), "r"(a3), "r"(b0), "r"(b1), "f"(c0), "f"(c1),    \
+                     "f"(c2), "f"(c3));                                                         \
+    }                                                                                           \
+  };                                                                                            \
+  }                                                                                             \
+  namespace cute {                                                                              \
+  template <>                                                                                   \
+  struct MMA_Traits<tl::Name> : MMA_Traits<SM80_16x8x32_S32S8S8S32_TN> {                        \
+    using ValTypeD = float;                                                                     \
+    using ValTypeA = A;                                                                         \
+    using ValTypeB = B;                                                                         \
+    using ValTypeC = float;                                                                     \
+  };                                                                                            \
+  }                                                                                             \
+  template <>                                                                                   \
+  struct DispatchInstruction<A, B, float> {                                                     \
+    using MMA = MMA_Atom<tl::Name>;                                                             \
+    using MMA_Group = Layout<Shape<_1, _2, _1>>;                                                \
+  };
+
+TL_DEFINE_SM89_FP8_MMA(SM89_16x8x32_F32E4M3E4M3F32_TN, float_e4m3_t, float_e4m3_t, "e4m3", "e4m3")
+TL_DEFINE_SM89_FP8_MMA(SM89_16x8x32_F32E4M3E5M2F32_TN, float_e4m3_t, float_e5m2_t, "e4m3", "e5m2")
+TL_DEFINE_SM89_FP8_MMA(SM89_16x8x32_F32E5M2E4M3F32_TN, float_e5m2_t, float_e4m3_t, "e5m2", "e4m3")
+TL_DEFINE_SM89_FP8_MMA(SM89_16x8x32_F32E5M2E5M2F32_TN, float_e5m2_t, float_e5m2_t, "e5m2", "e5m2")
+#undef TL_DEFINE_SM89_FP8_MMA
+#endif
+
 template <int Bits, int N, int K, bool K_inner, typename Enable = void>
 struct OperandTraits {
   // Primary template, use padded layout and default copy
@@ -141,8 +186,10 @@ struct OperandTraits<8, N, K, true, typename std::enable_if<K % 128 == 0>::type>
 
 template <int N, int K>
 struct OperandTraits<64, N, K, true, typename std::enable_if<K % 16 == 0>::type> {
+  // the groups of 4 k are permuted by the row, the 64-bit loads of a half warp (4 rows and 4 k)
+  // are conflict free, see makeGemmABLayoutF64_Kinner
   using LayoutAtom =
-      decltype(composition(Swizzle<2, 0, 4>{}, Layout<Shape<_4, _16>, Stride<_16, _1>>{}));
+      decltype(composition(Swizzle<2, 2, 2>{}, Layout<Shape<_4, _16>, Stride<_16, _1>>{}));
   using Layout = decltype(tile_to_shape(LayoutAtom{}, Shape<Int<N>, Int<K>>{}));
   using Copy = DefaultCopy;
 };
@@ -155,16 +202,86 @@ struct OperandTraits<64, N, K, false, typename std::enable_if<N % 16 == 0>::type
   using Copy = DefaultCopy;
 };
 
+namespace tl {
+
+// The element-wise ops applied in order to the elements of A between their load into the
+// registers and the mma, see T.gemm(prologue=...). Each op takes one operand: a pointer to a
+// vector of M (the _m ops) or K (the _k ops) elements, the scalar of kScale, an unused 0 for the
+// activations.
+enum class PrologueOp { kMulM, kMulK, kAddM, kAddK, kScale, kRelu, kSilu, kGelu };
+
+template <PrologueOp op, typename Operand>
+CUTE_DEVICE float apply_prologue_op(float x, int m, int k, Operand const& operand) {
+  if constexpr (op == PrologueOp::kMulM) {
+    return x * static_cast<float>(operand[m]);
+  } else if constexpr (op == PrologueOp::kMulK) {
+    return x * static_cast<float>(operand[k]);
+  } else if constexpr (op == PrologueOp::kAddM) {
+    return x + static_cast<float>(operand[m]);
+  } else if constexpr (op == PrologueOp::kAddK) {
+    return x + static_cast<float>(operand[k]);
+  } else if constexpr (op == PrologueOp::kScale) {
+    return x * static_cast<float>(operand);
+  } else if constexpr (op == PrologueOp::kRelu) {
+    return fmaxf(x, 0.f);
+  } else if constexpr (op == PrologueOp::kSilu) {
+    return x / (1.f + __expf(-x));
+  } else {
+    // the tanh approximation, as T.gelu
+    return 0.5f * x * (1.f + tanhf(0.7978845608028654f * (x + 0.044715f * x * x * x)));
+  }
+}
+
+template <PrologueOp... ops>
+struct PrologueOps {};
+
+// The identity, the gemms without a prologue
+struct NoPrologue {
+  static constexpr bool kEnabled = false;
+};
+
+template <typename Ops, typename... Operands>
+struct Prologue;
+
+template <PrologueOp... ops, typename... Operands>
+struct Prologue<PrologueOps<ops...>, Operands...> {
+  static_assert(sizeof...(ops) == sizeof...(Operands), "one operand per prologue op");
+  static constexpr bool kEnabled = true;
+  cute::tuple<Operands...> operands;
+
+  // the element of A at (m, k) of the tile, the ops are evaluated in float32
+  template <typename T>
+  CUTE_DEVICE T operator()(T x, int m, int k) const {
+    return T(apply(static_cast<float>(x), m, k, std::index_sequence_for<Operands...>{}));
+  }
+
+  template <size_t... I>
+  CUTE_DEVICE float apply(float x, int m, int k, std::index_sequence<I...>) const {
+    ((x = apply_prologue_op<ops>(x, m, k, cute::get<I>(operands))), ...);
+    return x;
+  }
+};
+
+}  // namespace tl
+
+// With promote_every > 0 the mma accumulates in float16 into partial sums, added into the float32
+// accumulators every promote_every k-steps and after the last one
 template <int M, int N, int K, int num_warp_m, int num_warp_n, bool trans_A, bool trans_B,
-          typename A_type_raw, typename B_type_raw, typename C_type_raw>
+          typename A_type_raw, typename B_type_raw, typename C_type_raw, int promote_every = 0>
 class GemmTensorOp {
  public:
   using A_type = typename std::conditional<std::is_same<A_type_raw, float>::value, tfloat32_t,
                                            A_type_raw>::type;
   using B_type = typename std::conditional<std::is_same<B_type_raw, float>::value, tfloat32_t,
-                                           A_type_raw>::type;
+                                           B_type_raw>::type;
   using C_type = C_type_raw;
-  using Instruction = DispatchInstruction<A_type, B_type, C_type>;
+  static constexpr bool kPromote = promote_every > 0;
+  static_assert(!kPromote || (std::is_same_v<A_type, half_t> && std::is_same_v<B_type, half_t> &&
+                              std::is_same_v<C_type, float>),
+                "The promoted accumulation takes float16 operands and float32 accumulators");
+  // the f16 and f32 accumulators of the mma have the same layout
+  using MmaC_type = typename std::conditional<kPromote, half_t, C_type>::type;
+  using Instruction = DispatchInstruction<A_type, B_type, MmaC_type>;
 
   using OperandATraits = OperandTraits<sizeof_bits<A_type>::value, M, K, !trans_A>;
   using OperandBTraits = OperandTraits<sizeof_bits<B_type>::value, N, K, trans_B>;
@@ -191,7 +308,46 @@ class GemmTensorOp {
       return layout;
   }
 
-  static CUTE_DEVICE void body(A_type_raw* pA, B_type_raw* pB, C_type_raw* pC) {
+  template <class TensorC>
+  static CUTE_DEVICE auto make_partial(TensorC const& acc) {
+    Tensor partial = make_tensor<MmaC_type>(acc.layout());
+    if constexpr (kPromote) clear(partial);
+    return partial;
+  }
+
+  // acc += A_k B_k of the k-step k out of num_k, through the float16 partial sums if promoted
+  template <class TensorA, class TensorB, class TensorC, class TensorP>
+  static CUTE_DEVICE void mma_step(TileMma& tiled_mma, TensorA const& a, TensorB const& b,
+                                   TensorC& acc, TensorP& partial, int k, int num_k) {
+    if constexpr (kPromote) {
+      gemm(tiled_mma, a, b, partial);
+      if ((k + 1) % promote_every == 0 || k == num_k - 1) {
+        CUTE_UNROLL
+        for (int i = 0; i < size(acc); ++i) acc(i) += static_cast<C_type>(partial(i));
+        clear(partial);
+      }
+    } else {
+      gemm(tiled_mma, a, b, acc);
+    }
+  }
+
+  // Apply the prologue to the k-group k of the A fragment, coord holds the (m, k) coordinates of
+  // its elements in the tile
+  template <class TensorA, class TensorCoord, class Prologue>
+  static CUTE_DEVICE void apply_prologue(TensorA& a, TensorCoord const& coord,
+                                         Prologue const& prologue, int k) {
+    CUTE_UNROLL
+    for (int j = 0; j < size<1>(a); ++j) {
+      CUTE_UNROLL
+      for (int i = 0; i < size<0>(a); ++i) {
+        a(i, j, k) = prologue(a(i, j, k), get<0>(coord(i, j, k)), get<1>(coord(i, j, k)));
+      }
+    }
+  }
+
+  template <class Prologue = tl::NoPrologue>
+  static CUTE_DEVICE void body(A_type_raw* pA, B_type_raw* pB, C_type_raw* pC,
+                               Prologue const& prologue = {}) {
     const int tid = threadIdx.x;
     Tensor sA = make_tensor(make_smem_ptr(reinterpret_cast<A_type*>(pA)), SmemLayoutA{});
     Tensor sB = make_tensor(make_smem_ptr(reinterpret_cast<B_type*>(pB)), SmemLayoutB{});
@@ -212,15 +368,24 @@ class GemmTensorOp {
 
     Tensor acc = make_tensor(make_rmem_ptr(reinterpret_cast<C_type*>(pC)),
                              partition_shape_C(tiled_mma, Shape<Int<M>, Int<N>>{}));
+    Tensor partial = make_partial(acc);
 
     // when layout is KxN and n_warp is 1, there seem to be a bug, use this as a workaround
     auto tCrA_view = make_tensor(tCrA.data(), remove_swizzle(tCrA.layout()));
     auto tCrB_view = make_tensor(tCrB.data(), remove_swizzle(tCrB.layout()));
+    Tensor tCcA = thr_mma.partition_A(make_identity_tensor(Shape<Int<M>, Int<K>>{}));
+    // the fragments hold all the k-groups, load the k-group k + 1 while the mma of k runs
+    copy(tiled_copy_A, tCsA(_, _, 0), tCrA_copy_view(_, _, 0));
+    copy(tiled_copy_B, tCsB(_, _, 0), tCrB_copy_view(_, _, 0));
     CUTE_UNROLL
     for (int k = 0; k < size<2>(tCrA); ++k) {
-      copy(tiled_copy_A, tCsA(_, _, k), tCrA_copy_view(_, _, k));
-      copy(tiled_copy_B, tCsB(_, _, k), tCrB_copy_view(_, _, k));
-      gemm(tiled_mma, tCrA_view(_, _, k), tCrB_view(_, _, k), acc);
+      if (k < size<2>(tCrA) - 1) {
+        copy(tiled_copy_A, tCsA(_, _, k + 1), tCrA_copy_view(_, _, k + 1));
+        copy(tiled_copy_B, tCsB(_, _, k + 1), tCrB_copy_view(_, _, k + 1));
+      }
+      if constexpr (Prologue::kEnabled) apply_prologue(tCrA_view, tCcA, prologue, k);
+      mma_step(tiled_mma, tCrA_view(_, _, k), tCrB_view(_, _, k), acc, partial, k,
+               size<2>(tCrA));
     }
   }
 
@@ -239,6 +404,7 @@ class GemmTensorOp {
 
     Tensor acc = make_tensor(make_rmem_ptr(reinterpret_cast<C_type*>(pC)),
                              partition_shape_C(tiled_mma, Shape<Int<M>, Int<N>>{}));
+    Tensor partial = make_partial(acc);
     Tensor tCrA = make_tensor(make_rmem_ptr(reinterpret_cast<A_type*>(pA)),
                               partition_shape_A(tiled_mma, Shape<Int<M>, Int<K>>{}));
 
@@ -249,11 +415,13 @@ class GemmTensorOp {
       if (k < size<2>(tCrA) - 1) {
         copy(tiled_copy_B, tCsB(_, _, k + 1), tCrB_copy_view(_, _, k + 1));
       }
-      gemm(tiled_mma, tCrA(_, _, k), tCrB_view(_, _, k), acc);
+      mma_step(tiled_mma, tCrA(_, _, k), tCrB_view(_, _, k), acc, partial, k, size<2>(tCrA));
     }
   }
 
-  static CUTE_DEVICE void body_sr(A_type_raw* pA, B_type_raw* pB, C_type_raw* pC) {
+  template <class Prologue = tl::NoPrologue>
+  static CUTE_DEVICE void body_sr(A_type_raw* pA, B_type_raw* pB, C_type_raw* pC,
+                                  Prologue const& prologue = {}) {
     const int tid = threadIdx.x;
     Tensor sA = make_tensor(make_smem_ptr(reinterpret_cast<A_type*>(pA)), SmemLayoutA{});
     TileMma tiled_mma;
@@ -268,17 +436,20 @@ class GemmTensorOp {
 
     Tensor acc = make_tensor(make_rmem_ptr(reinterpret_cast<C_type*>(pC)),
                              partition_shape_C(tiled_mma, Shape<Int<M>, Int<N>>{}));
+    Tensor partial = make_partial(acc);
     Tensor tCrB = make_tensor(make_rmem_ptr(reinterpret_cast<B_type*>(pB)),
                               partition_shape_B(tiled_mma, Shape<Int<N>, Int<K>>{}));
 
     auto tCrA_view = make_tensor(tCrA.data(), remove_swizzle(tCrA.layout()));
+    Tensor tCcA = thr_mma.partition_A(make_identity_tensor(Shape<Int<M>, Int<K>>{}));
     copy(tiled_copy_A, tCsA(_, _, 0), tCrA_copy_view(_, _, 0));
     CUTE_UNROLL
     for (int k = 0; k < size<2>(tCrA); ++k) {
       if (k < size<2>(tCrA) - 1) {
         copy(tiled_copy_A, tCsA(_, _, k + 1), tCrA_copy_view(_, _, k + 1));
       }
-      gemm(tiled_mma, tCrA_view(_, _, k), tCrB(_, _, k), acc);
+      if constexpr (Prologue::kEnabled) apply_prologue(tCrA_view, tCcA, prologue, k);
+      mma_step(tiled_mma, tCrA_view(_, _, k), tCrB(_, _, k), acc, partial, k, size<2>(tCrA));
     }
   }
 };
@@ -309,4 +480,52 @@ CUTLASS_DEVICE void gemm_sr(A_type* pA, B_type* pB, C_type* accum) {
   MMA::body_sr(pA, pB, accum);
 }
 
+// The float16 mma with the partial sums promoted into the float32 accum every promote_every
+// k-steps, see T.gemm(accum=...)
+template <int M, int N, int K, int num_warp_m, int num_warp_n, bool trans_A, bool trans_B,
+          int promote_every, typename A_type, typename B_type, typename C_type>
+CUTLASS_DEVICE void gemm_ss_promote(A_type* pA, B_type* pB, C_type* accum) {
+  using MMA = GemmTensorOp<M, N, K, num_warp_m, num_warp_n, trans_A, trans_B, A_type, B_type,
+                           C_type, promote_every>;
+  MMA::body(pA, pB, accum);
+}
+
+template <int M, int N, int K, int num_warp_m, int num_warp_n, bool trans_A, bool trans_B,
+          int promote_every, typename A_type, typename B_type, typename C_type>
+CUTLASS_DEVICE void gemm_rs_promote(A_type* pA, B_type* pB, C_type* accum) {
+  using MMA = GemmTensorOp<M, N, K, num_warp_m, num_warp_n, trans_A, trans_B, A_type, B_type,
+                           C_type, promote_every>;
+  MMA::body_rs(pA, pB, accum);
+}
+
+template <int M, int N, int K, int num_warp_m, int num_warp_n, bool trans_A, bool trans_B,
+          int promote_every, typename A_type, typename B_type, typename C_type>
+CUTLASS_DEVICE void gemm_sr_promote(A_type* pA, B_type* pB, C_type* accum) {
+  using MMA = GemmTensorOp<M, N, K, num_warp_m, num_warp_n, trans_A, trans_B, A_type, B_type,
+                           C_type, promote_every>;
+  MMA::body_sr(pA, pB, accum);
+}
+
+// The gemms with the prologue ops applied to the elements of the shared A in the registers before
+// each mma step, one operand per op, see T.gemm(prologue=...)
+template <int M, int N, int K, int num_warp_m, int num_warp_n, bool trans_A, bool trans_B,
+          int promote_every, PrologueOp... ops, typename A_type, typename B_type, typename C_type,
+          typename... Operands>
+CUTLASS_DEVICE void gemm_ss_prologue(A_type* pA, B_type* pB, C_type* accum, Operands... operands) {
+  using MMA = GemmTensorOp<M, N, K, num_warp_m, num_warp_n, trans_A, trans_B, A_type, B_type,
+                           C_type, promote_every>;
+  MMA::body(pA, pB, accum,
+            Prologue<PrologueOps<ops...>, Operands...>{cute::tuple<Operands...>(operands...)});
+}
+
+template <int M, int N, int K, int num_warp_m, int num_warp_n, bool trans_A, bool trans_B,
+          int promote_every, PrologueOp... ops, typename A_type, typename B_type, typename C_type,
+          typename... Operands>
+CUTLASS_DEVICE void gemm_sr_prologue(A_type* pA, B_type* pB, C_type* accum, Operands... operands) {
+  using MMA = GemmTensorOp<M, N, K, num_warp_m, num_warp_n, trans_A, trans_B, A_type, B_type,
+                           C_type, promote_every>;
+  MMA::body_sr(pA, pB, accum,
+               Prologue<PrologueOps<ops...>, Operands...>{cute::tuple<Operands...>(operands...)});
+}
+
 }  // namespace tl
@@ -1,9 +1,19 @@
 #pragma once
 
-#if (defined(__CUDA_ARCH__) && (__CUDA_ARCH__ >= 750))
+#if (defined(__CUDA_ARCH__) && (__CUDA_ARCH__ >= 900))
+#include "gemm_sm90.h"
+#elif (defined(__CUDA_ARCH__) && (__CUDA_ARCH__ >= 750))
 #include "cute_gemm.h"
 #elif (defined(__CUDA_ARCH__) && (__CUDA_ARCH__ >= 700))
 #include "gemm_sm70.h"
 #else
 
 #endif
+
+#if (defined(__CUDA_ARCH__) && (__CUDA_ARCH__ >= 750))
+#include "gemm_dequant.h"
+#endif
+
+#if (defined(__CUDA_ARCH__) && (__CUDA_ARCH__ >= 800))
+#include "gemm_sp.h"
+#endif
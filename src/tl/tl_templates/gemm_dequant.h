@@ -0,0 +1,223 @@
+#pragma once
+
+#include <cuda_bf16.h>
+#include <cuda_fp16.h>
+
+#include "cute_gemm.h"
+
+namespace tl {
+
+// The 4-bit formats of a packed B operand, two elements per byte with the even k in the low nibble
+enum class DequantFormat { kInt4, kUInt4, kFP4, kNF4 };
+
+// The NormalFloat4 code book of QLoRA
+static __constant__ float kNF4Values[16] = {
+    -1.0f,        -0.69619280f, -0.52507305f, -0.39491749f, -0.28444138f, -0.18477343f,
+    -0.09105004f, 0.0f,         0.07958030f,  0.16093020f,  0.24611230f,  0.33791524f,
+    0.44070983f,  0.56261700f,  0.72295684f,  1.0f};
+
+template <int lut>
+__device__ inline uint32_t lop3(uint32_t a, uint32_t b, uint32_t c) {
+  uint32_t d;
+  asm volatile("lop3.b32 %0, %1, %2, %3, %4;\n" : "=r"(d) : "r"(a), "r"(b), "r"(c), "n"(lut));
+  return d;
+}
+
+// The pair of 16-bit values in a 32-bit register, and the magic number 2^m whose exponent makes the
+// low mantissa bits an integer: the bits (magic | q) hold the value 2^m + q.
+template <typename T>
+struct Pair;
+
+template <>
+struct Pair<half_t> {
+  using Type = __half2;
+  static constexpr uint32_t kMagic = 0x64006400;  // 1024
+  static constexpr float kMagicValue = 1024.f;
+  static __device__ inline Type splat(float x) { return __float2half2_rn(x); }
+  static __device__ inline Type from_half2(__half2 x) { return x; }
+  static __device__ inline Type from_float2(float x, float y) { return __floats2half2_rn(x, y); }
+};
+
+template <>
+struct Pair<bfloat16_t> {
+  using Type = __nv_bfloat162;
+  static constexpr uint32_t kMagic = 0x43004300;  // 128
+  static constexpr float kMagicValue = 128.f;
+  static __device__ inline Type splat(float x) { return __float2bfloat162_rn(x); }
+  static __device__ inline Type from_half2(__half2 x) {
+    return __float22bfloat162_rn(__half22float2(x));
+  }
+  static __device__ inline Type from_float2(float x, float y) {
+    return __floats2bfloat162_rn(x, y);
+  }
+};
+
+template <typename T, DequantFormat format>
+struct Dequant {
+  using P = Pair<T>;
+  using T2 = typename P::Type;
+
+  // Dequantize the two nibbles of packed into the values (lo, hi) times scale minus the zero point.
+  // nf4 looks up the code book in the registers of the warp, nf4_value is kNF4Values[lane % 16].
+  static __device__ inline T2 run(uint32_t packed, float scale, float zero, float nf4_value) {
+    // the low nibble in the bits [0, 4) and the high nibble in the bits [16, 20)
+    uint32_t x = packed | (packed << 12);
+    if constexpr (format == DequantFormat::kInt4 || format == DequantFormat::kUInt4) {
+      // (x & 0x000f000f) | magic, the sign bit of int4 is flipped, i.e. the value is offset by 8
+      uint32_t bits = format == DequantFormat::kUInt4
+                          ? lop3<(0xf0 & 0xcc) | 0xaa>(x, 0x000f000f, P::kMagic)
+                          : lop3<(0xf0 & 0xcc) ^ 0xaa>(x, 0x000f000f, P::kMagic | 0x00080008);
+      float offset = P::kMagicValue + zero + (format == DequantFormat::kInt4 ? 8.f : 0.f);
+      T2 value = *reinterpret_cast<T2*>(&bits);
+      return __hmul2(__hsub2(value, P::splat(offset)), P::splat(scale));
+    } else if constexpr (format == DequantFormat::kFP4) {
+      // e2m1 to half: the exponent and mantissa bits below the half ones and the sign moved, the
+      // result (subnormals included) is the fp4 value times 2^-14
+      uint32_t bits = ((x & 0x00070007) << 9) | ((x & 0x00080008) << 12);
+      __half2 value = __hmul2(*reinterpret_cast<__half2*>(&bits), __float2half2_rn(16384.f));
+      return __hmul2(P::from_half2(value), P::splat(scale));
+    } else {
+      float lo = __shfl_sync(uint32_t(-1), nf4_value, packed & 0xf);
+      float hi = __shfl_sync(uint32_t(-1), nf4_value, (packed >> 4) & 0xf);
+      return P::from_float2(lo * scale, hi * scale);
+    }
+  }
+};
+
+template <typename T>
+struct NonDeduced {
+  using Type = T;
+};
+
+// A gemm with a packed 4-bit B ([N, K / 2] bytes in shared memory) dequantized in registers
+// before each mma step, with the per group scales and zero points [N, max(K / group_size, 1)] in
+// shared memory.
+template <int M, int N, int K, int num_warp_m, int num_warp_n, bool trans_A, DequantFormat format,
+          int group_size, bool has_scale, bool has_zeros, typename A_type_raw, typename C_type_raw>
+class GemmDequantOp {
+ public:
+  using Base = GemmTensorOp<M, N, K, num_warp_m, num_warp_n, trans_A, true, A_type_raw, A_type_raw,
+                            C_type_raw>;
+  using A_type = typename Base::A_type;
+  using C_type = C_type_raw;
+  using TileMma = typename Base::TileMma;
+  static_assert(sizeof(A_type) == 2, "the quantized B is dequantized to half or bfloat16");
+  static_assert(group_size <= 0 || K % group_size == 0 || group_size % K == 0);
+  static constexpr int num_groups = group_size <= 0 || group_size >= K ? 1 : K / group_size;
+  using Dq = Dequant<A_type, format>;
+  using T2 = typename Dq::T2;
+
+  // Fill the B fragment of the mma step k, the pairs (k, k + 1) with an even k of the 16-bit mma
+  // operands share a register and are unpacked from a single byte.
+  template <class FragB, class CoordB>
+  static CUTE_DEVICE void dequant(FragB& frag, CoordB const& coord, const uint8_t* pB,
+                                  const A_type* scales, const A_type* zeros, float nf4_value,
+                                  int k) {
+    CUTE_UNROLL
+    for (int j = 0; j < size<1>(frag); ++j) {
+      CUTE_UNROLL
+      for (int i = 0; i < size<0>(frag); i += 2) {
+        const int n = get<0>(coord(i, j, k)), kk = get<1>(coord(i, j, k));
+        const int group = n * num_groups + (num_groups == 1 ? 0 : kk / group_size);
+        float scale = has_scale ? float(scales[group]) : 1.f;
+        float zero = has_zeros ? float(zeros[group]) : 0.f;
+        uint32_t packed = pB[n * (K / 2) + kk / 2];
+        bool paired = kk % 2 == 0 && get<0>(coord(i + 1, j, k)) == n &&
+                      get<1>(coord(i + 1, j, k)) == kk + 1;
+        if (paired) {
+          *reinterpret_cast<T2*>(&frag(i, j, k)) = Dq::run(packed, scale, zero, nf4_value);
+        } else {
+          // the elements of another mma layout, unpacked one by one
+          CUTE_UNROLL
+          for (int v = 0; v < 2; ++v) {
+            const int vn = get<0>(coord(i + v, j, k)), vk = get<1>(coord(i + v, j, k));
+            const int vgroup = vn * num_groups + (num_groups == 1 ? 0 : vk / group_size);
+            float vscale = has_scale ? float(scales[vgroup]) : 1.f;
+            float vzero = has_zeros ? float(zeros[vgroup]) : 0.f;
+            uint32_t byte = pB[vn * (K / 2) + vk / 2];
+            T2 value = Dq::run(byte, vscale, vzero, nf4_value);
+            frag(i + v, j, k) = reinterpret_cast<A_type*>(&value)[vk % 2];
+          }
+        }
+      }
+    }
+  }
+
+  static CUTE_DEVICE float nf4_value() {
+    return format == DequantFormat::kNF4 ? kNF4Values[threadIdx.x % 16] : 0.f;
+  }
+
+  static CUTE_DEVICE void body(A_type_raw* pA, const uint8_t* pB, C_type_raw* pC,
+                               const A_type* scales, const A_type* zeros) {
+    const int tid = threadIdx.x;
+    Tensor sA = make_tensor(make_smem_ptr(reinterpret_cast<A_type*>(pA)),
+                            typename Base::SmemLayoutA{});
+    TileMma tiled_mma;
+    auto thr_mma = tiled_mma.get_thread_slice(tid);
+    auto tiled_copy_A = make_tiled_copy_A(typename Base::SmemCopyA{}, tiled_mma);
+    auto thr_copy_A = tiled_copy_A.get_thread_slice(tid);
+
+    Tensor tCrA = thr_mma.partition_fragment_A(sA);
+    Tensor tCsA = thr_copy_A.partition_S(sA);
+    Tensor tCrA_copy_view = thr_copy_A.retile_D(tCrA);
+    auto tCrA_view = make_tensor(tCrA.data(), Base::remove_swizzle(tCrA.layout()));
+
+    // the (n, k) coordinates of the B elements held by the thread
+    Tensor tCcB = thr_mma.partition_B(make_identity_tensor(Shape<Int<N>, Int<K>>{}));
+    Tensor tCrB = make_tensor<A_type>(partition_shape_B(tiled_mma, Shape<Int<N>, Int<K>>{}));
+    Tensor acc = make_tensor(make_rmem_ptr(reinterpret_cast<C_type*>(pC)),
+                             partition_shape_C(tiled_mma, Shape<Int<M>, Int<N>>{}));
+    const float nf4 = nf4_value();
+    CUTE_UNROLL
+    for (int k = 0; k < size<2>(tCrA); ++k) {
+      copy(tiled_copy_A, tCsA(_, _, k), tCrA_copy_view(_, _, k));
+      dequant(tCrB, tCcB, pB, scales, zeros, nf4, k);
+      gemm(tiled_mma, tCrA_view(_, _, k), tCrB(_, _, k), acc);
+    }
+  }
+
+  static CUTE_DEVICE void body_rs(A_type_raw* pA, const uint8_t* pB, C_type_raw* pC,
+                                  const A_type* scales, const A_type* zeros) {
+    const int tid = threadIdx.x;
+    TileMma tiled_mma;
+    auto thr_mma = tiled_mma.get_thread_slice(tid);
+    Tensor tCcB = thr_mma.partition_B(make_identity_tensor(Shape<Int<N>, Int<K>>{}));
+    Tensor tCrB = make_tensor<A_type>(partition_shape_B(tiled_mma, Shape<Int<N>, Int<K>>{}));
+    Tensor acc = make_tensor(make_rmem_ptr(reinterpret_cast<C_type*>(pC)),
+                             partition_shape_C(tiled_mma, Shape<Int<M>, Int<N>>{}));
+    Tensor tCrA = make_tensor(make_rmem_ptr(reinterpret_cast<A_type*>(pA)),
+                              partition_shape_A(tiled_mma, Shape<Int<M>, Int<K>>{}));
+    const float nf4 = nf4_value();
+    CUTE_UNROLL
+    for (int k = 0; k < size<2>(tCrA); ++k) {
+      dequant(tCrB, tCcB, pB, scales, zeros, nf4, k);
+      gemm(tiled_mma, tCrA(_, _, k), tCrB(_, _, k), acc);
+    }
+  }
+};
+
+template <int M, int N, int K, int num_warp_m, int num_warp_n, bool trans_A, bool trans_B,
+          DequantFormat format, int group_size, bool has_scale, bool has_zeros, typename A_type,
+          typename B_type, typename C_type>
+CUTLASS_DEVICE void gemm_ss_dequant(A_type* pA, B_type* pB, C_type* accum,
+                                    const typename NonDeduced<A_type>::Type* scales,
+                                    const typename NonDeduced<A_type>::Type* zeros) {
+  static_assert(trans_B, "the quantized B is packed along K");
+  using MMA = GemmDequantOp<M, N, K, num_warp_m, num_warp_n, trans_A, format, group_size,
+                            has_scale, has_zeros, A_type, C_type>;
+  MMA::body(pA, reinterpret_cast<const uint8_t*>(pB), accum, scales, zeros);
+}
+
+template <int M, int N, int K, int num_warp_m, int num_warp_n, bool trans_A, bool trans_B,
+          DequantFormat format, int group_size, bool has_scale, bool has_zeros, typename A_type,
+          typename B_type, typename C_type>
+CUTLASS_DEVICE void gemm_rs_dequant(A_type* pA, B_type* pB, C_type* accum,
+                                    const typename NonDeduced<A_type>::Type* scales,
+                                    const typename NonDeduced<A_type>::Type* zeros) {
+  static_assert(trans_B, "the quantized B is packed along K");
+  using MMA = GemmDequantOp<M, N, K, num_warp_m, num_warp_n, trans_A, format, group_size,
+                            has_scale, has_zeros, A_type, C_type>;
+  MMA::body_rs(pA, reinterpret_cast<const uint8_t*>(pB), accum, scales, zeros);
+}
+
+}  // namespace tl
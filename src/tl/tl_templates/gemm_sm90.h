@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cute/arch/mma_sm90_gmma.hpp>
+#include <cute/atom/mma_traits_sm90_gmma.hpp>
+
+#include "cute_gemm.h"
+
+// K-major operands, should be aligned with makeGemmABLayoutFullBank/HalfBank in layout.cc
+template <GMMA::Major major, class T, int MN, int K>
+struct WgmmaOperandTraits {
+  static_assert(major == GMMA::Major::K);
+  static_assert(K % 32 == 0);
+  using LayoutAtom = typename std::conditional<K % 64 == 0, GMMA::Layout_K_SW128_Atom<T>,
+                                               GMMA::Layout_K_SW64_Atom<T>>::type;
+  using Layout = decltype(tile_to_shape(LayoutAtom{}, Shape<Int<MN>, Int<K>>{}));
+};
+
+// MN-major operands, the 8xK groups are placed along K first
+template <class T, int MN, int K>
+struct WgmmaOperandTraits<GMMA::Major::MN, T, MN, K> {
+  static_assert(MN % 32 == 0);
+  using LayoutAtom = typename std::conditional<MN % 64 == 0, GMMA::Layout_MN_SW128_Atom<T>,
+                                               GMMA::Layout_MN_SW64_Atom<T>>::type;
+  using Layout = decltype(tile_to_shape(LayoutAtom{}, Shape<Int<MN>, Int<K>>{}, Step<_2, _1>{}));
+};
+
+template <int M, int N, int K, int num_warp_m, int num_warp_n, bool trans_A, bool trans_B,
+          typename A_type, typename B_type, typename C_type>
+class WgmmaTensorOp {
+ public:
+  static_assert(num_warp_m % 4 == 0, "wgmma requires 4 warps along M in a warpgroup");
+  static constexpr int num_wg_m = num_warp_m / 4;
+  static constexpr int num_wg_n = num_warp_n;
+  static constexpr int warp_n = N / num_wg_n;
+  static_assert(M % (64 * num_wg_m) == 0);
+  static_assert(N % num_wg_n == 0 && warp_n % 8 == 0);
+
+  static constexpr GMMA::Major GmmaMajorA = trans_A ? GMMA::Major::MN : GMMA::Major::K;
+  static constexpr GMMA::Major GmmaMajorB = trans_B ? GMMA::Major::K : GMMA::Major::MN;
+
+  using SmemLayoutA = typename WgmmaOperandTraits<GmmaMajorA, A_type, M, K>::Layout;
+  using SmemLayoutB = typename WgmmaOperandTraits<GmmaMajorB, B_type, N, K>::Layout;
+
+  // Each warpgroup computes a 64 x warp_n atom, the selector picks the largest atom N dividing
+  // warp_n, which is used in makeGemmFragmentCHopper as well.
+  using AtomShape = Shape<_64, Int<warp_n>, Int<K>>;
+  using WarpgroupLayout = Layout<Shape<Int<num_wg_m>, Int<num_wg_n>, _1>>;
+  using TiledMmaSS = decltype(make_tiled_mma(
+      GMMA::ss_op_selector<A_type, B_type, C_type, AtomShape, GmmaMajorA, GmmaMajorB>(),
+      WarpgroupLayout{}));
+  using TiledMmaRS = decltype(make_tiled_mma(
+      GMMA::rs_op_selector<A_type, B_type, C_type, AtomShape, GMMA::Major::K, GmmaMajorB>(),
+      WarpgroupLayout{}));
+
+  static CUTE_DEVICE void body(A_type* pA, B_type* pB, C_type* pC) {
+    const int tid = threadIdx.x;
+    Tensor sA = make_tensor(make_smem_ptr(pA), SmemLayoutA{});
+    Tensor sB = make_tensor(make_smem_ptr(pB), SmemLayoutB{});
+    TiledMmaSS tiled_mma;
+    // the accumulator is always initialized by the program (e.g. T.clear)
+    tiled_mma.accumulate_ = GMMA::ScaleOut::One;
+    auto thr_mma = tiled_mma.get_thread_slice(tid);
+
+    // A and B are read from shared memory through the wgmma descriptors
+    Tensor tCrA = thr_mma.make_fragment_A(thr_mma.partition_A(sA));
+    Tensor tCrB = thr_mma.make_fragment_B(thr_mma.partition_B(sB));
+    Tensor acc = make_tensor(make_rmem_ptr(pC),
+                             partition_shape_C(tiled_mma, Shape<Int<M>, Int<N>>{}));
+
+    warpgroup_fence_operand(acc);
+    warpgroup_arrive();
+    CUTE_UNROLL
+    for (int k = 0; k < size<2>(tCrA); ++k) {
+      gemm(tiled_mma, tCrA(_, _, k), tCrB(_, _, k), acc);
+    }
+    warpgroup_commit_batch();
+    warpgroup_wait<0>();
+    warpgroup_fence_operand(acc);
+  }
+
+  static CUTE_DEVICE void body_rs(A_type* pA, B_type* pB, C_type* pC) {
+    const int tid = threadIdx.x;
+    Tensor sB = make_tensor(make_smem_ptr(pB), SmemLayoutB{});
+    TiledMmaRS tiled_mma;
+    tiled_mma.accumulate_ = GMMA::ScaleOut::One;
+    auto thr_mma = tiled_mma.get_thread_slice(tid);
+
+    Tensor tCrB = thr_mma.make_fragment_B(thr_mma.partition_B(sB));
+    Tensor tCrA = make_tensor(make_rmem_ptr(pA),
+                              partition_shape_A(tiled_mma, Shape<Int<M>, Int<K>>{}));
+    Tensor acc = make_tensor(make_rmem_ptr(pC),
+                             partition_shape_C(tiled_mma, Shape<Int<M>, Int<N>>{}));
+
+    warpgroup_fence_operand(tCrA);
+    warpgroup_fence_operand(acc);
+    warpgroup_arrive();
+    CUTE_UNROLL
+    for (int k = 0; k < size<2>(tCrA); ++k) {
+      gemm(tiled_mma, tCrA(_, _, k), tCrB(_, _, k), acc);
+    }
+    warpgroup_commit_batch();
+    warpgroup_wait<0>();
+    warpgroup_fence_operand(acc);
+    warpgroup_fence_operand(tCrA);
+  }
+};
+
+namespace tl {
+
+template <int M, int N, int K, int num_warp_m, int num_warp_n, bool trans_A, bool trans_B,
+          typename A_type, typename B_type, typename C_type>
+CUTLASS_DEVICE void wgmma_ss(A_type* pA, B_type* pB, C_type* accum) {
+  using MMA =
+      WgmmaTensorOp<M, N, K, num_warp_m, num_warp_n, trans_A, trans_B, A_type, B_type, C_type>;
+  MMA::body(pA, pB, accum);
+}
+
+template <int M, int N, int K, int num_warp_m, int num_warp_n, bool trans_A, bool trans_B,
+          typename A_type, typename B_type, typename C_type>
+CUTLASS_DEVICE void wgmma_rs(A_type* pA, B_type* pB, C_type* accum) {
+  using MMA =
+      WgmmaTensorOp<M, N, K, num_warp_m, num_warp_n, trans_A, trans_B, A_type, B_type, C_type>;
+  MMA::body_rs(pA, pB, accum);
+}
+
+}  // namespace tl
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "cute_gemm.h"
+
+namespace tl {
+
+// The block gemm of a 2:4 sparse A with mma.sp.sync.m16n8k32 on the sparse tensor cores of sm_80
+// and later. Of each group of 4 consecutive elements along K of a row of A, the 2 kept ones are in
+// the compressed A [M, K / 2] in the order of K and their indices in the group (2 bits each, the
+// lower one first) in the metadata E [M, K / 32], the group g of E[m, k] in the bits [4g, 4g + 4).
+// The warps tile C as makeGemmFragmentC (warp w at (w % num_warp_m, w / num_warp_m)), for the tile
+// (mi, ni) lane l holds C[l / 4 (+ 8), 2 * (l % 4) + c] at accum[4 * (mi + ni * warp_rows)].
+template <int M, int N, int K, int num_warp_m, int num_warp_n, bool trans_B, typename A_type,
+          typename B_type, typename C_type>
+class GemmSparseOp {
+ public:
+  static constexpr int warp_rows = M / num_warp_m / 16;
+  static constexpr int warp_cols = N / num_warp_n / 8;
+  static_assert(M % (16 * num_warp_m) == 0 && N % (8 * num_warp_n) == 0 && K % 32 == 0);
+  static_assert(std::is_same_v<A_type, B_type> &&
+                    (std::is_same_v<A_type, half_t> || std::is_same_v<A_type, bfloat16_t>),
+                "The sparse gemm takes float16 or bfloat16 operands");
+  static_assert(std::is_same_v<C_type, float>, "The sparse gemm accumulates in float32");
+
+  // the layouts of makeGemmABLayout, the compressed A is K-major
+  using SmemLayoutA = typename OperandTraits<16, M, K / 2, true>::Layout;
+  using SmemLayoutB = typename OperandTraits<16, N, K, trans_B>::Layout;
+
+  // The elements (row, col) and (row, col + 1) of a shared tensor in a register, col even. The
+  // swizzles move chunks of 8 elements, the pair is contiguous if col is the continuous dimension.
+  template <bool contiguous, class SmemTensor>
+  static __device__ __forceinline__ uint32_t load_pair(SmemTensor const& s, int row, int col) {
+    if constexpr (contiguous) {
+      return *reinterpret_cast<const uint32_t*>(&s(row, col));
+    } else {
+      return uint32_t(s(row, col).raw()) | (uint32_t(s(row, col + 1).raw()) << 16);
+    }
+  }
+
+  // The threads 0 and 1 of each quad give the metadata of the rows l / 4 and l / 4 + 8 (sparsity
+  // selector 0)
+  static __device__ __forceinline__ void mma_sp(const uint32_t (&a)[4], const uint32_t (&b)[4],
+                                                float* c, uint32_t e) {
+    if constexpr (std::is_same_v<A_type, half_t>) {
+      asm volatile(
+          "mma.sp.sync.aligned.m16n8k32.row.col.f32.f16.f16.f32 {%0, %1, %2, %3}, "
+          "{%4, %5, %6, %7}, {%8, %9, %10, %11}, {%0, %1, %2, %3}, %12, 0x0;\n"
+          : "+f"(c[0]), "+f"(c[1]), "+f"(c[2]), "+f"(c[3])
+          : "r"(a[0]), "r"(a[1]), "r"(a[2]), "r"(a[3]), "r"(b[0]), "r"(b[1]), "r"(b[2]),
+            "r"(b[3]), "r"(e));
+    } else {
+      asm volatile(
+          "mma.sp.sync.aligned.m16n8k32.row.col.f32.bf16.bf16.f32 {%0, %1, %2, %3}, "
+          "{%4, %5, %6, %7}, {%8, %9, %10, %11}, {%0, %1, %2, %3}, %12, 0x0;\n"
+          : "+f"(c[0]), "+f"(c[1]), "+f"(c[2]), "+f"(c[3])
+          : "r"(a[0]), "r"(a[1]), "r"(a[2]), "r"(a[3]), "r"(b[0]), "r"(b[1]), "r"(b[2]),
+            "r"(b[3]), "r"(e));
+    }
+  }
+
+  template <typename E_type>
+  static __device__ void body(A_type* pA, const E_type* pE, B_type* pB, C_type* accum) {
+    static_assert(sizeof(E_type) == 4, "The metadata is packed into 32-bit words");
+    const int warp = threadIdx.x / 32, lane = threadIdx.x % 32;
+    const int warp_m = warp % num_warp_m, warp_n = warp / num_warp_m;
+    const int group = lane / 4, t = lane % 4;
+    Tensor sA = make_tensor(make_smem_ptr(pA), SmemLayoutA{});
+    Tensor sB = make_tensor(make_smem_ptr(pB), SmemLayoutB{});
+#pragma unroll
+    for (int k = 0; k < K; k += 32) {
+      // B: the rows k + 2t + 8r of the column n
+      uint32_t b[warp_cols][4];
+#pragma unroll
+      for (int ni = 0; ni < warp_cols; ni++) {
+        const int n = (ni * num_warp_n + warp_n) * 8 + group;
+#pragma unroll
+        for (int r = 0; r < 4; r++) b[ni][r] = load_pair<trans_B>(sB, n, k + 2 * t + 8 * r);
+      }
+#pragma unroll
+      for (int mi = 0; mi < warp_rows; mi++) {
+        // the compressed A of the step is the 16x16 A of the dense m16n8k16
+        const int row = (mi * num_warp_m + warp_m) * 16 + group, col = k / 2 + 2 * t;
+        uint32_t a[4] = {load_pair<true>(sA, row, col), load_pair<true>(sA, row + 8, col),
+                         load_pair<true>(sA, row, col + 8), load_pair<true>(sA, row + 8, col + 8)};
+        uint32_t e = static_cast<uint32_t>(pE[(row + 8 * (t % 2)) * (K / 32) + k / 32]);
+#pragma unroll
+        for (int ni = 0; ni < warp_cols; ni++) {
+          mma_sp(a, b[ni], accum + 4 * (mi + ni * warp_rows), e);
+        }
+      }
+    }
+  }
+};
+
+template <int M, int N, int K, int num_warp_m, int num_warp_n, bool trans_B, typename A_type,
+          typename E_type, typename B_type, typename C_type>
+CUTLASS_DEVICE void gemm_sp_ss(A_type* pA, E_type* pE, B_type* pB, C_type* accum) {
+  using MMA = GemmSparseOp<M, N, K, num_warp_m, num_warp_n, trans_B, A_type, B_type, C_type>;
+  MMA::body(pA, pE, pB, accum);
+}
+
+}  // namespace tl
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cooperative_groups.h>
+
+#include "common.h"
+
+namespace tl {
+
+// The barrier of all the threads of the grid (T.grid_sync), the global writes made before it are
+// visible to all the blocks after it. The kernel is launched as a cooperative kernel by the
+// runtime, which checks that all its blocks are resident at once.
+__forceinline__ __device__ void grid_sync() { cooperative_groups::this_grid().sync(); }
+
+}  // namespace tl
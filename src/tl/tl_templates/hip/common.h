@@ -0,0 +1,119 @@
+#pragma once
+
+#include <hip/hip_bf16.h>
+#include <hip/hip_fp16.h>
+#include <hip/hip_runtime.h>
+
+#include <type_traits>
+
+// The names of the CUDA source printed by CodeGenTL, for the HIP source of the CDNA targets
+using half_t = __half;
+using bfloat16_t = __hip_bfloat16;
+using nv_bfloat162 = __hip_bfloat162;
+
+#define hexp __expf
+#define hlog __logf
+#define hsqrt sqrtf
+#define htanh tanhf
+#define hpow powf
+
+#define uint unsigned int
+#define uchar unsigned char
+#define ushort unsigned short
+
+#define CUDART_INF_F __builtin_huge_valf()
+#define CUDART_NAN_F __builtin_nanf("")
+#define CUDART_INF __builtin_huge_val()
+#define CUDART_NAN __builtin_nan("")
+
+// Pack two half_t values.
+inline __device__ unsigned __pack_half2(const half_t x, const half_t y) {
+  unsigned v0 = *((unsigned short*)&x);
+  unsigned v1 = *((unsigned short*)&y);
+  return (v1 << 16) | v0;
+}
+
+// Pack two bfloat16_t values.
+inline __device__ unsigned __pack_half2(const bfloat16_t x, const bfloat16_t y) {
+  unsigned v0 = *((unsigned short*)&x);
+  unsigned v1 = *((unsigned short*)&y);
+  return (v1 << 16) | v0;
+}
+
+inline __device__ unsigned __pack_nv_bfloat162(const bfloat16_t x, const bfloat16_t y) {
+  return __pack_half2(x, y);
+}
+
+inline __device__ unsigned __pack_bfloat162(const bfloat16_t x, const bfloat16_t y) {
+  return __pack_half2(x, y);
+}
+
+namespace tl {
+
+// The lanes of a wavefront of CDNA
+constexpr int kWarpSize = 64;
+
+// v_exp_f32 with -ffast-math
+__forceinline__ __device__ float exp2_approx(float x) { return exp2f(x); }
+
+// The constant 100MHz counter of s_memrealtime in nanoseconds, comparable across the CUs
+__forceinline__ __device__ uint64_t timer_ns() { return __builtin_amdgcn_s_memrealtime() * 10; }
+
+// Whether ptr is aligned to bytes, the runtime check of the loops vectorized by the auto vectorizer
+// whose global buffers may be views with an offset
+__forceinline__ __device__ bool is_aligned(const void* ptr, int bytes) {
+  return reinterpret_cast<uintptr_t>(ptr) % bytes == 0;
+}
+
+// Lane 0 of each wavefront appends the record of a timer of the instrumented kernels, the same
+// records as the CUDA tl::timer_record with the hardware id of the CU in place of the SM
+__forceinline__ __device__ void timer_record(int64_t* trace, int capacity, int tag,
+                                             uint64_t start_ns, int64_t start_cycles) {
+  int64_t cycles = clock64() - start_cycles;
+  uint64_t ns = timer_ns() - start_ns;
+  if (threadIdx.x % kWarpSize != 0) return;
+  unsigned cu = __smid();
+  unsigned block = blockIdx.x + gridDim.x * (blockIdx.y + gridDim.y * blockIdx.z);
+  unsigned long long slot =
+      atomicAdd(reinterpret_cast<unsigned long long*>(trace), 1ull) % capacity;
+  int64_t* record = trace + 4 * (slot + 1);
+  record[0] = (static_cast<int64_t>(cu) << 32) | block;
+  record[1] = (static_cast<int64_t>(threadIdx.x / kWarpSize) << 32) | tag;
+  record[2] = static_cast<int64_t>(start_ns);
+  record[3] = static_cast<int64_t>((ns << 32) | (static_cast<uint64_t>(cycles) & 0xffffffffu));
+}
+
+template <typename T, typename T_src>
+__forceinline__ __device__ void AtomicAdd(T* address, T_src val) {
+  if constexpr (std::is_same_v<T, half_t> || std::is_same_v<T, bfloat16_t>) {
+    atomicAdd(address, static_cast<T>(static_cast<float>(val)));
+  } else {
+    atomicAdd(address, static_cast<T>(val));
+  }
+}
+
+template <typename T, typename T_src>
+__forceinline__ __device__ void AtomicAddx2(T* address, const T_src* val) {
+  if constexpr (std::is_same_v<T, half_t>) {
+    atomicAdd(reinterpret_cast<__half2*>(address),
+              __half2(static_cast<half_t>(static_cast<float>(val[0])),
+                      static_cast<half_t>(static_cast<float>(val[1]))));
+  } else {
+    AtomicAdd(address, val[0]);
+    AtomicAdd(address + 1, val[1]);
+  }
+}
+
+template <typename T, typename T_src>
+__forceinline__ __device__ void AtomicAddx4(T* address, const T_src* val) {
+  AtomicAddx2(address, val);
+  AtomicAddx2(address + 2, val + 2);
+}
+
+// The value of x on the lane of the wavefront, see the shuffles of T.shuffle_layout
+template <typename T>
+__forceinline__ __device__ T shfl_sync(T x, int lane) {
+  return T(__shfl(x, lane));
+}
+
+}  // namespace tl
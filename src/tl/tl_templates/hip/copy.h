@@ -0,0 +1,49 @@
+#pragma once
+
+#include "common.h"
+
+namespace tl {
+
+// CDNA has no asynchronous copy to the LDS (TargetHasAsyncCopy is false), the pipelines of the
+// ROCm targets are planned without it. The entries below keep the sources using them explicitly
+// compiling: a copy goes through the registers with a global load of N bytes (the buffer loads
+// of the compiler) and completes before returning, so the commits and the waits are no-ops.
+template <int N>
+struct CopyVector;
+
+template <>
+struct CopyVector<16> {
+  using type = uint4;
+};
+
+template <>
+struct CopyVector<8> {
+  using type = uint2;
+};
+
+template <>
+struct CopyVector<4> {
+  using type = unsigned int;
+};
+
+__forceinline__ __device__ void cp_async_commit() {}
+
+template <int N>
+__forceinline__ __device__ void cp_async_wait() {}
+
+// Prefetch and Hint are the L2 hints of the CUDA copies, which have no equivalent here
+template <int N, int Prefetch = -1, int Hint = 0>
+__forceinline__ __device__ void cp_async_gs(void const* const smem_addr, void* global_ptr) {
+  using T = typename CopyVector<N>::type;
+  *reinterpret_cast<T*>(const_cast<void*>(smem_addr)) = *reinterpret_cast<const T*>(global_ptr);
+}
+
+template <int N, int Prefetch = -1, int Hint = 0>
+__forceinline__ __device__ void cp_async_gs_conditional(void const* const smem_addr,
+                                                        void* global_ptr, bool cond) {
+  using T = typename CopyVector<N>::type;
+  *reinterpret_cast<T*>(const_cast<void*>(smem_addr)) =
+      cond ? *reinterpret_cast<const T*>(global_ptr) : T{};
+}
+
+}  // namespace tl
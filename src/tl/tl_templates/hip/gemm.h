@@ -0,0 +1,157 @@
+#pragma once
+
+#include "common.h"
+
+namespace tl {
+
+// The offset of (i, j) in a stride x continuous tile of the shared memory (LDS), swizzled as by
+// makeGemmABLayout in layout.cc, which the layout inference sets on the gemm operands. k_outer is
+// the kfactor 1 of the layout, i.e. the continuous dimension is M or N.
+template <int stride, int continuous, int bits, bool k_outer>
+struct GemmSmemLayout {
+  static constexpr int vec = 128 / bits;
+  static constexpr bool padded = (k_outer && bits == 8) || continuous % (vec * 4) != 0;
+  static constexpr bool full_bank = continuous % (vec * 8) == 0;
+  static constexpr int padded_continuous =
+      (bits * continuous) % 256 == 0 ? continuous + vec : continuous;
+
+  static __device__ __forceinline__ int offset(int i, int j) {
+    if constexpr (padded) {
+      return i * padded_continuous + j;
+    } else if constexpr (full_bank) {
+      // 8 chunks of 128 bits per row of 8 rows, the chunk xor the row
+      const int c = j / vec, s = i % 8;
+      return (c / 8) * stride * 8 * vec + (i / 8) * 64 * vec + (((c % 8) ^ s) + s * 8) * vec +
+             j % vec;
+    } else {
+      // 4 chunks of 128 bits per row of 8 rows, the chunk xor half the row
+      const int c = j / vec, s = i % 8;
+      return (c / 4) * stride * 4 * vec + (i / 8) * 32 * vec + (((c % 4) ^ (s / 2)) + s * 4) * vec +
+             j % vec;
+    }
+  }
+};
+
+// The block gemm with v_mfma_f32_16x16x16 on the wavefronts of 64 lanes, num_warp_m x num_warp_n
+// wavefronts (wavefront w at (w % num_warp_m, w / num_warp_m)) each computing the interleaved
+// 16x16 tiles of makeGemmFragmentCCDNA. For the tile (mi, ni) of a wavefront lane l holds
+// A[l % 16, 4 * (l / 16) + r], B[4 * (l / 16) + r, l % 16] and the accumulators
+// C[4 * (l / 16) + r, l % 16] at accum[4 * (mi + ni * warp_rows) + r], r = 0..3.
+template <int M, int N, int K, int num_warp_m, int num_warp_n, bool trans_A, bool trans_B,
+          typename A_type, typename B_type, typename C_type>
+class GemmMFMA {
+ public:
+  static constexpr int warp_rows = M / num_warp_m / 16;
+  static constexpr int warp_cols = N / num_warp_n / 16;
+  static_assert(M % (16 * num_warp_m) == 0 && N % (16 * num_warp_n) == 0 && K % 16 == 0);
+  static_assert(std::is_same_v<A_type, B_type> &&
+                    (std::is_same_v<A_type, half_t> || std::is_same_v<A_type, bfloat16_t>),
+                "The MFMA gemm takes float16 or bfloat16 operands");
+  static_assert(std::is_same_v<C_type, float>, "The MFMA gemm accumulates in float32");
+
+  using SmemA = GemmSmemLayout<trans_A ? K : M, trans_A ? M : K, 16, trans_A>;
+  using SmemB = GemmSmemLayout<trans_B ? N : K, trans_B ? K : N, 16, !trans_B>;
+  using floatx4 = float __attribute__((ext_vector_type(4)));
+  using halfx4 = _Float16 __attribute__((ext_vector_type(4)));
+  using shortx4 = short __attribute__((ext_vector_type(4)));
+
+  // The 4 values along K at (row, k..k+3) of the operand stored as [rows, K] (K-major) or
+  // [K, rows], the K-major ones are 64 contiguous bits in a chunk of the swizzle
+  template <typename Smem, bool k_major, typename T>
+  static __device__ __forceinline__ shortx4 load_operand(const T* smem, int row, int k) {
+    if constexpr (k_major) {
+      return *reinterpret_cast<const shortx4*>(smem + Smem::offset(row, k));
+    } else {
+      shortx4 value;
+#pragma unroll
+      for (int r = 0; r < 4; r++) {
+        value[r] = __builtin_bit_cast(short, smem[Smem::offset(k + r, row)]);
+      }
+      return value;
+    }
+  }
+
+  static __device__ __forceinline__ void mfma(shortx4 a, shortx4 b, C_type* c) {
+    floatx4 acc = {c[0], c[1], c[2], c[3]};
+    if constexpr (std::is_same_v<A_type, half_t>) {
+      acc = __builtin_amdgcn_mfma_f32_16x16x16f16(__builtin_bit_cast(halfx4, a),
+                                                  __builtin_bit_cast(halfx4, b), acc, 0, 0, 0);
+    } else {
+      acc = __builtin_amdgcn_mfma_f32_16x16x16bf16_1k(a, b, acc, 0, 0, 0);
+    }
+#pragma unroll
+    for (int r = 0; r < 4; r++) c[r] = acc[r];
+  }
+
+  static __device__ void body(A_type* pA, B_type* pB, C_type* accum) {
+    const int warp = threadIdx.x / kWarpSize, lane = threadIdx.x % kWarpSize;
+    const int warp_m = warp % num_warp_m, warp_n = warp / num_warp_m;
+    const int row = lane % 16, k_lane = 4 * (lane / 16);
+#pragma unroll
+    for (int k = 0; k < K; k += 16) {
+      shortx4 a[warp_rows], b[warp_cols];
+#pragma unroll
+      for (int mi = 0; mi < warp_rows; mi++) {
+        a[mi] = load_operand<SmemA, !trans_A>(pA, (mi * num_warp_m + warp_m) * 16 + row,
+                                              k + k_lane);
+      }
+#pragma unroll
+      for (int ni = 0; ni < warp_cols; ni++) {
+        b[ni] = load_operand<SmemB, trans_B>(pB, (ni * num_warp_n + warp_n) * 16 + row,
+                                             k + k_lane);
+      }
+#pragma unroll
+      for (int mi = 0; mi < warp_rows; mi++) {
+#pragma unroll
+        for (int ni = 0; ni < warp_cols; ni++) {
+          mfma(a[mi], b[ni], accum + 4 * (mi + ni * warp_rows));
+        }
+      }
+    }
+  }
+
+  // A in the registers of makeGemmFragmentACDNA: the 4 values of the tile (mi, k / 16) at
+  // 4 * (mi + k / 16 * warp_rows)
+  static __device__ void body_rs(A_type* pA, B_type* pB, C_type* accum) {
+    static_assert(!trans_A, "The A in registers should not be transposed");
+    const int warp = threadIdx.x / kWarpSize, lane = threadIdx.x % kWarpSize;
+    const int warp_n = warp / num_warp_m;
+    const int row = lane % 16, k_lane = 4 * (lane / 16);
+#pragma unroll
+    for (int k = 0; k < K; k += 16) {
+      shortx4 b[warp_cols];
+#pragma unroll
+      for (int ni = 0; ni < warp_cols; ni++) {
+        b[ni] = load_operand<SmemB, trans_B>(pB, (ni * num_warp_n + warp_n) * 16 + row,
+                                             k + k_lane);
+      }
+#pragma unroll
+      for (int mi = 0; mi < warp_rows; mi++) {
+        const A_type* a = pA + 4 * (mi + k / 16 * warp_rows);
+        shortx4 a_value;
+#pragma unroll
+        for (int r = 0; r < 4; r++) a_value[r] = __builtin_bit_cast(short, a[r]);
+#pragma unroll
+        for (int ni = 0; ni < warp_cols; ni++) {
+          mfma(a_value, b[ni], accum + 4 * (mi + ni * warp_rows));
+        }
+      }
+    }
+  }
+};
+
+template <int M, int N, int K, int num_warp_m, int num_warp_n, bool trans_A, bool trans_B,
+          typename A_type, typename B_type, typename C_type>
+__device__ void gemm_ss(A_type* pA, B_type* pB, C_type* accum) {
+  using MMA = GemmMFMA<M, N, K, num_warp_m, num_warp_n, trans_A, trans_B, A_type, B_type, C_type>;
+  MMA::body(pA, pB, accum);
+}
+
+template <int M, int N, int K, int num_warp_m, int num_warp_n, bool trans_A, bool trans_B,
+          typename A_type, typename B_type, typename C_type>
+__device__ void gemm_rs(A_type* pA, B_type* pB, C_type* accum) {
+  using MMA = GemmMFMA<M, N, K, num_warp_m, num_warp_n, trans_A, trans_B, A_type, B_type, C_type>;
+  MMA::body_rs(pA, pB, accum);
+}
+
+}  // namespace tl
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "common.h"
+
+namespace tl {
+
+struct SumOp {
+  template <typename T>
+  __device__ inline T operator()(T const& x, T const& y) {
+    return x + y;
+  }
+};
+
+struct MaxOp {
+  template <typename T>
+  __device__ inline T operator()(T const& x, T const& y) {
+    return x > y ? x : y;
+  }
+};
+
+struct MinOp {
+  template <typename T>
+  __device__ inline T operator()(T const& x, T const& y) {
+    return x < y ? x : y;
+  }
+};
+
+struct AbsMaxOp {
+  template <typename T>
+  __device__ inline T operator()(T const& x, T const& y) {
+    T abs_x = x < T(0) ? T(-x) : x, abs_y = y < T(0) ? T(-y) : y;
+    return abs_x > abs_y ? abs_x : abs_y;
+  }
+};
+
+struct ProdOp {
+  template <typename T>
+  __device__ inline T operator()(T const& x, T const& y) {
+    return x * y;
+  }
+};
+
+// The struct-valued payloads, shuffled field by field
+template <typename T>
+struct ArgMaxPair {
+  T value;
+  int index;
+};
+
+template <typename T>
+struct WelfordState {
+  float count;
+  T mean, m2;
+};
+
+struct ArgMaxOp {
+  template <typename T>
+  __device__ inline ArgMaxPair<T> operator()(ArgMaxPair<T> const& x, ArgMaxPair<T> const& y) {
+    // the first index wins the ties
+    bool take_y = y.value > x.value || (y.value == x.value && y.index < x.index);
+    return take_y ? y : x;
+  }
+};
+
+// Chan's parallel combination of the welford states
+struct WelfordOp {
+  template <typename T>
+  __device__ inline WelfordState<T> operator()(WelfordState<T> const& x,
+                                               WelfordState<T> const& y) {
+    float count = x.count + y.count;
+    if (count == 0) return x;
+    T delta = y.mean - x.mean;
+    T ratio = T(y.count / count);
+    return {count, x.mean + delta * ratio, x.m2 + y.m2 + delta * delta * T(x.count) * ratio};
+  }
+};
+
+// The 32-bit word of the lane whose index differs by offset in the wavefront. The exchanges
+// inside the rows of 16 lanes use the DPP modifiers of the ALU operands (xor 1 and 2 as quad
+// permutations) or ds_swizzle (xor up to 16 in the bit mask mode), which do not go through the
+// LDS addresses like the ds_bpermute of __shfl_xor, only needed across the 32-lane halves.
+template <int offset>
+__device__ inline int shfl_xor_b32(int x) {
+  if constexpr (offset == 1) {
+    // quad_perm:[1, 0, 3, 2]
+    return __builtin_amdgcn_mov_dpp(x, 0xb1, 0xf, 0xf, false);
+  } else if constexpr (offset == 2) {
+    // quad_perm:[2, 3, 0, 1]
+    return __builtin_amdgcn_mov_dpp(x, 0x4e, 0xf, 0xf, false);
+  } else if constexpr (offset < 32) {
+    // and_mask 0x1f, or_mask 0, xor_mask offset
+    return __builtin_amdgcn_ds_swizzle(x, (offset << 10) | 0x1f);
+  } else {
+    return __shfl_xor(x, offset);
+  }
+}
+
+template <int offset, typename T>
+__device__ inline T shfl_xor(T x) {
+  if constexpr (sizeof(T) == 4) {
+    return __builtin_bit_cast(T, shfl_xor_b32<offset>(__builtin_bit_cast(int, x)));
+  } else if constexpr (sizeof(T) == 2) {
+    // the 16-bit values are widened to a word
+    unsigned short bits = __builtin_bit_cast(unsigned short, x);
+    return __builtin_bit_cast(T, static_cast<unsigned short>(shfl_xor_b32<offset>(bits)));
+  } else {
+    return T(__shfl_xor(x, offset));
+  }
+}
+
+template <int offset, typename T>
+__device__ inline ArgMaxPair<T> shfl_xor(ArgMaxPair<T> x) {
+  return {shfl_xor<offset>(x.value), shfl_xor<offset>(x.index)};
+}
+
+template <int offset, typename T>
+__device__ inline WelfordState<T> shfl_xor(WelfordState<T> x) {
+  return {shfl_xor<offset>(x.count), shfl_xor<offset>(x.mean), shfl_xor<offset>(x.m2)};
+}
+
+// Reduce x among the threads whose indices only differ in the bits [scale, threads), all of them
+// get the result, like the CUDA tl::AllReduce with the wavefronts of 64 lanes in place of the
+// warps: the reductions inside a wavefront use the lane exchanges only, those across wavefronts
+// exchange the per wavefront partials once through red_buf (one element per thread of the block).
+template <class Reducer, int threads, int scale>
+struct AllReduce {
+  static_assert(threads == 1024 or threads == 512 or threads == 256 or threads == 128 or
+                threads == 64 or threads == 32 or threads == 16 or threads == 8 or threads == 4 or
+                threads == 2);
+  static_assert(threads % scale == 0);
+  template <typename T>
+  static __device__ inline T run(T x, T* red_buf = nullptr) {
+    if constexpr (threads <= kWarpSize) {
+      constexpr int offset = threads / 2;
+      x = Reducer()(x, shfl_xor<offset>(x));
+      if constexpr (offset == scale) {
+        return x;
+      } else {
+        return AllReduce<Reducer, offset, scale>::run(x);
+      }
+    } else if constexpr (scale >= kWarpSize) {
+      // the reduced threads are in different wavefronts
+      __syncthreads();
+      red_buf[threadIdx.x] = x;
+      __syncthreads();
+      const int first = threadIdx.x - threadIdx.x % threads + threadIdx.x % scale;
+      x = red_buf[first];
+#pragma unroll
+      for (int i = 1; i < threads / scale; i++) x = Reducer()(x, red_buf[first + i * scale]);
+      return x;
+    } else {
+      x = AllReduce<Reducer, kWarpSize, scale>::run(x);
+      // one partial per wavefront and per (threadIdx.x % scale)
+      const int warp = threadIdx.x / kWarpSize, lane = threadIdx.x % kWarpSize;
+      __syncthreads();
+      if (lane < scale) red_buf[warp * scale + lane] = x;
+      __syncthreads();
+      const int first = (warp - warp % (threads / kWarpSize)) * scale + lane % scale;
+      x = red_buf[first];
+#pragma unroll
+      for (int i = 1; i < threads / kWarpSize; i++) x = Reducer()(x, red_buf[first + i * scale]);
+      return x;
+    }
+  }
+};
+
+// In-place entries of the struct-valued reductions, red_buf holds one payload per thread
+template <int threads, int scale, typename T>
+__device__ inline void AllReduceArgMax(T* value, int* index, void* red_buf = nullptr) {
+  ArgMaxPair<T> x = AllReduce<ArgMaxOp, threads, scale>::run(
+      ArgMaxPair<T>{*value, *index}, reinterpret_cast<ArgMaxPair<T>*>(red_buf));
+  *value = x.value;
+  *index = x.index;
+}
+
+template <int threads, int scale, typename T>
+__device__ inline void AllReduceWelford(T* mean, T* m2, float count, void* red_buf = nullptr) {
+  WelfordState<T> x = AllReduce<WelfordOp, threads, scale>::run(
+      WelfordState<T>{count, *mean, *m2}, reinterpret_cast<WelfordState<T>*>(red_buf));
+  *mean = x.mean;
+  *m2 = x.m2;
+}
+
+}  // namespace tl
@@ -0,0 +1,196 @@
+#pragma once
+
+#include "common.h"
+
+namespace tl {
+
+// The order preserving map of the floats to the unsigned integers, the larger float gets the larger
+// key: the k largest elements are the ones of the k largest keys.
+__device__ __forceinline__ uint32_t topk_key(float x) {
+  uint32_t bits = __float_as_uint(x);
+  return (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+}
+
+__device__ __forceinline__ float topk_value(uint32_t key) {
+  return __uint_as_float((key & 0x80000000u) ? key & 0x7fffffffu : ~key);
+}
+
+// the smallest power of 2 >= k
+constexpr int topk_capacity(int k) { return k <= 1 ? 1 : 2 * topk_capacity((k + 1) / 2); }
+
+// The k largest elements of the rows of src [rows, n] and their column indices plus index_offset
+// into values and indices [rows, k], in descending order, the smaller index first among the equal
+// values. Only the first valid columns of src are candidates, and with merge the elements already
+// in values and indices too. All the threads of the block select the rows in turn:
+//  - the k-th largest key is found by a radix select, 8 bits at a time from the most significant
+//    ones: the shared memory histogram counts the digits of the keys matching the digits found so
+//    far, and a wavefront finds the bin of the k-th key from the suffix sums of the bins,
+//  - when the k-th key has more ties than needed, a second radix select over the complemented
+//    indices of its ties finds the ones of the smallest indices,
+//  - the keys larger than the k-th one and the selected ties are compacted into the workspace,
+//    the slots of the selected elements of a wavefront are taken by one atomic of a ballot,
+//  - the selected keys are sorted by a bitonic sort in the workspace.
+// workspace holds workspace_size ints, the block is synchronized before and after using it.
+template <int threads, int k>
+struct TopK {
+  static_assert(threads % 64 == 0 && threads <= 1024);
+  static_assert(k >= 1);
+  static constexpr int capacity = topk_capacity(k);
+  static constexpr int bins = 256;
+  // the histogram, the state of the select and of the compaction, the selected keys and indices
+  static constexpr int workspace_size = bins + 4 + 2 * capacity;
+
+  template <typename S, typename T>
+  static __device__ void run(const S* src, T* values, int* indices, int rows, int n, int valid,
+                             int index_offset, bool merge, int* workspace) {
+    int* hist = workspace;
+    int* state = workspace + bins;
+    uint32_t* keys = reinterpret_cast<uint32_t*>(workspace + bins + 4);
+    int* ids = workspace + bins + 4 + capacity;
+    const int lane = threadIdx.x % 64;
+    const int count = max(0, min(valid, n));
+    const int total = count + (merge ? k : 0);
+    for (int row = 0; row < rows; row++) {
+      const S* row_src = src + row * n;
+      T* row_values = values + row * k;
+      int* row_indices = indices + row * k;
+      // the candidates are the columns of src followed by the elements of values
+      auto key_of = [&](int i) {
+        return topk_key(i < count ? float(row_src[i]) : float(row_values[i - count]));
+      };
+      auto index_of = [&](int i) { return i < count ? index_offset + i : row_indices[i - count]; };
+
+      __syncthreads();
+      if (total <= k) {
+        for (int i = threadIdx.x; i < total; i += threads) {
+          keys[i] = key_of(i);
+          ids[i] = index_of(i);
+        }
+      } else {
+        // The radix select of the kk-th largest of the keys key_fn(i) of the candidates with
+        // eligible(i): returns it, with the number of its ties among the kk largest in remaining
+        // and the number of all its ties in ties.
+        auto radix_select = [&](auto key_fn, auto eligible, int kk, int& remaining, int& ties) {
+          uint32_t prefix = 0, mask = 0;
+          remaining = kk;
+          for (int shift = 24; shift >= 0; shift -= 8) {
+            for (int i = threadIdx.x; i < bins; i += threads) hist[i] = 0;
+            __syncthreads();
+            for (int i = threadIdx.x; i < total; i += threads) {
+              if (!eligible(i)) continue;
+              uint32_t key = key_fn(i);
+              if ((key & mask) == prefix) atomicAdd(&hist[(key >> shift) & (bins - 1)], 1);
+            }
+            __syncthreads();
+            if (threadIdx.x < 64) {
+              constexpr int per_lane = bins / 64;
+              int sum = 0;
+              for (int b = 0; b < per_lane; b++) sum += hist[lane * per_lane + b];
+              // the keys in the bins of the lanes >= lane
+              int suffix = sum;
+#pragma unroll
+              for (int offset = 1; offset < 64; offset *= 2) {
+                int y = __shfl_down(suffix, offset);
+                if (lane + offset < 64) suffix += y;
+              }
+              int above = suffix - sum;
+              uint64_t found = __ballot(above < remaining && remaining <= suffix);
+              if (lane == __ffsll(found) - 1) {
+                for (int b = per_lane - 1; b >= 0; b--) {
+                  int bin = lane * per_lane + b;
+                  if (above + hist[bin] >= remaining) {
+                    state[0] = bin;
+                    state[1] = remaining - above;
+                    state[2] = hist[bin];
+                    break;
+                  }
+                  above += hist[bin];
+                }
+              }
+            }
+            __syncthreads();
+            prefix |= uint32_t(state[0]) << shift;
+            mask |= uint32_t(bins - 1) << shift;
+            remaining = state[1];
+          }
+          ties = state[2];
+          __syncthreads();
+          return prefix;
+        };
+        // the k-th key, and the number of its ties to select
+        int remaining, ties;
+        const uint32_t prefix = radix_select(key_of, [](int) { return true; }, k, remaining, ties);
+        // Among more ties of the k-th key than needed, the ones of the smallest indices are taken:
+        // their complemented indices are at least the remaining-th largest one of the ties.
+        uint32_t min_tie_id = 0;
+        if (ties > remaining) {
+          int id_remaining, id_ties;
+          min_tie_id = radix_select([&](int i) { return ~uint32_t(index_of(i)); },
+                                    [&](int i) { return key_of(i) == prefix; }, remaining,
+                                    id_remaining, id_ties);
+        }
+        if (threadIdx.x == 0) state[2] = state[3] = 0;
+        __syncthreads();
+
+        const int num_greater = k - remaining;
+        const uint64_t lower = (uint64_t(1) << lane) - 1;
+        for (int base = threadIdx.x - lane; base < total; base += threads) {
+          int i = base + lane;
+          uint32_t key = i < total ? key_of(i) : 0;
+          bool greater = i < total && key > prefix;
+          bool tie = i < total && key == prefix && ~uint32_t(index_of(i)) >= min_tie_id;
+          uint64_t greater_mask = __ballot(greater);
+          uint64_t tie_mask = __ballot(tie);
+          int greater_slot = 0, tie_slot = 0;
+          if (lane == 0 && greater_mask) {
+            greater_slot = atomicAdd(&state[2], __popcll(greater_mask));
+          }
+          if (lane == 0 && tie_mask) tie_slot = atomicAdd(&state[3], __popcll(tie_mask));
+          greater_slot = __shfl(greater_slot, 0) + __popcll(greater_mask & lower);
+          tie_slot = __shfl(tie_slot, 0) + __popcll(tie_mask & lower);
+          if (greater) {
+            keys[greater_slot] = key;
+            ids[greater_slot] = index_of(i);
+          } else if (tie && tie_slot < remaining) {
+            keys[num_greater + tie_slot] = key;
+            ids[num_greater + tie_slot] = index_of(i);
+          }
+        }
+      }
+      // the padding is sorted last: the key of -inf and the largest unsigned index
+      for (int i = min(total, k) + threadIdx.x; i < capacity; i += threads) {
+        keys[i] = topk_key(-INFINITY);
+        ids[i] = -1;
+      }
+
+      for (int size = 2; size <= capacity; size *= 2) {
+        for (int stride = size / 2; stride > 0; stride /= 2) {
+          __syncthreads();
+          for (int i = threadIdx.x; i < capacity / 2; i += threads) {
+            int lo = 2 * i - (i & (stride - 1)), hi = lo + stride;
+            bool hi_first = keys[hi] > keys[lo] ||
+                            (keys[hi] == keys[lo] && uint32_t(ids[hi]) < uint32_t(ids[lo]));
+            // the blocks of size are sorted in alternate orders, the last one is the whole buffer
+            bool descending = (lo & size) == 0;
+            if (hi_first == descending) {
+              uint32_t key = keys[lo];
+              keys[lo] = keys[hi];
+              keys[hi] = key;
+              int id = ids[lo];
+              ids[lo] = ids[hi];
+              ids[hi] = id;
+            }
+          }
+        }
+      }
+      __syncthreads();
+      for (int i = threadIdx.x; i < k; i += threads) {
+        row_values[i] = T(topk_value(keys[i]));
+        row_indices[i] = ids[i];
+      }
+    }
+    __syncthreads();
+  }
+};
+
+}  // namespace tl
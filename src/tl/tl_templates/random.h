@@ -0,0 +1,86 @@
+#pragma once
+
+#include "common.h"
+
+namespace tl {
+
+// Philox4x32-10 (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3"): the four random
+// words of the 128 bit counter under the 64 bit key. The numbers are a pure function of the key
+// and the counter, so any thread regenerates the numbers of any element, e.g. the dropout mask of
+// the forward pass in the backward pass, whatever the layout of its fragments.
+__forceinline__ __device__ uint4 philox4x32(uint4 ctr, uint2 key) {
+  constexpr uint32_t kMul0 = 0xD2511F53u, kMul1 = 0xCD9E8D57u;
+  constexpr uint32_t kWeyl0 = 0x9E3779B9u, kWeyl1 = 0xBB67AE85u;
+#pragma unroll
+  for (int round = 0; round < 10; ++round) {
+    uint32_t hi0 = __umulhi(kMul0, ctr.x), lo0 = kMul0 * ctr.x;
+    uint32_t hi1 = __umulhi(kMul1, ctr.z), lo1 = kMul1 * ctr.z;
+    ctr = make_uint4(hi1 ^ ctr.y ^ key.x, lo1, hi0 ^ ctr.w ^ key.y, lo0);
+    key.x += kWeyl0;
+    key.y += kWeyl1;
+  }
+  return ctr;
+}
+
+// 32 random bits of the element counter of the stream seed (T.rand_uniform and T.rand).
+__forceinline__ __device__ uint32_t rand_bits(uint64_t seed, uint64_t counter) {
+  uint4 ctr =
+      make_uint4(static_cast<uint32_t>(counter), static_cast<uint32_t>(counter >> 32), 0u, 0u);
+  uint2 key = make_uint2(static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32));
+  return philox4x32(ctr, key).x;
+}
+
+// A uniform float in [0, 1), the 24 high bits of rand_bits.
+__forceinline__ __device__ float rand_uniform(uint64_t seed, uint64_t counter) {
+  return static_cast<float>(rand_bits(seed, counter) >> 8) * 5.9604644775390625e-8f;
+}
+
+// The fields of the types rounded by stochastic_round: the bits of the mantissa, the exponent of
+// the smallest normal value (the spacing of the subnormals) and the largest finite value.
+template <typename T>
+struct StochasticRoundTraits;
+
+template <>
+struct StochasticRoundTraits<half_t> {
+  static constexpr int kMantissa = 10, kMinExp = -14;
+  static constexpr float kMax = 65504.0f;
+};
+
+template <>
+struct StochasticRoundTraits<float_e4m3_t> {
+  static constexpr int kMantissa = 3, kMinExp = -6;
+  static constexpr float kMax = 448.0f;
+};
+
+template <>
+struct StochasticRoundTraits<float_e5m2_t> {
+  static constexpr int kMantissa = 2, kMinExp = -14;
+  static constexpr float kMax = 57344.0f;
+};
+
+// Rounds x to T up (in magnitude) with the probability of its distance to the value below over
+// the spacing of T at x, so that the rounding is unbiased in expectation (T.stochastic_cast). The
+// finite values are saturated to the range of T.
+template <typename T>
+__forceinline__ __device__ T stochastic_round(float x, uint64_t seed, uint64_t counter) {
+  using Traits = StochasticRoundTraits<T>;
+  if (!isfinite(x)) return T(x);
+  float a = fabsf(x);
+  // the spacing of T at a, a power of 2 so that a / ulp is exact
+  int exp = a == 0.0f ? Traits::kMinExp : max(ilogbf(a), Traits::kMinExp);
+  float ulp = ldexpf(1.0f, exp - Traits::kMantissa);
+  float q = floorf(a / ulp + rand_uniform(seed, counter)) * ulp;
+  return T(copysignf(fminf(q, Traits::kMax), x));
+}
+
+// bfloat16 keeps the 16 high bits of the float: the random 16 low bits are added before they are
+// truncated, the carry rounding up.
+template <>
+__forceinline__ __device__ bfloat16_t stochastic_round<bfloat16_t>(float x, uint64_t seed,
+                                                                   uint64_t counter) {
+  if (!isfinite(x)) return bfloat16_t(x);
+  uint32_t bits = (__float_as_uint(x) + (rand_bits(seed, counter) & 0xFFFFu)) & 0xFFFF0000u;
+  return bfloat16_t::bitcast(static_cast<uint16_t>(bits >> 16));
+}
+
+}  // namespace tl
@@ -25,6 +25,75 @@ struct MinOp {
   }
 };
 
+struct AbsMaxOp {
+  template <typename T>
+  __device__ inline T operator()(T const& x, T const& y) {
+    return cutlass::fast_max(x < T(0) ? -x : x, y < T(0) ? -y : y);
+  }
+};
+
+struct ProdOp {
+  template <typename T>
+  __device__ inline T operator()(T const& x, T const& y) {
+    return x * y;
+  }
+};
+
+// The struct-valued payloads, shuffled field by field
+template <typename T>
+struct ArgMaxPair {
+  T value;
+  int index;
+};
+
+template <typename T>
+struct WelfordState {
+  float count;
+  T mean, m2;
+};
+
+struct ArgMaxOp {
+  template <typename T>
+  __device__ inline ArgMaxPair<T> operator()(ArgMaxPair<T> const& x, ArgMaxPair<T> const& y) {
+    // the first index wins the ties
+    bool take_y = y.value > x.value || (y.value == x.value && y.index < x.index);
+    return take_y ? y : x;
+  }
+};
+
+// Chan's parallel combination of the welford states
+struct WelfordOp {
+  template <typename T>
+  __device__ inline WelfordState<T> operator()(WelfordState<T> const& x,
+                                               WelfordState<T> const& y) {
+    float count = x.count + y.count;
+    if (count == 0) return x;
+    T delta = y.mean - x.mean;
+    T ratio = T(y.count / count);
+    return {count, x.mean + delta * ratio, x.m2 + y.m2 + delta * delta * T(x.count) * ratio};
+  }
+};
+
+template <typename T>
+__device__ inline T shfl_xor(T x, int offset) {
+  return T(__shfl_xor_sync(uint32_t(-1), x, offset));
+}
+
+template <typename T>
+__device__ inline ArgMaxPair<T> shfl_xor(ArgMaxPair<T> x, int offset) {
+  return {shfl_xor(x.value, offset), shfl_xor(x.index, offset)};
+}
+
+template <typename T>
+__device__ inline WelfordState<T> shfl_xor(WelfordState<T> x, int offset) {
+  return {shfl_xor(x.count, offset), shfl_xor(x.mean, offset), shfl_xor(x.m2, offset)};
+}
+
+// Reduce x among the threads whose indices only differ in the bits [scale, threads), all of them
+// get the result. Inside a warp the partial results are exchanged with shuffles. A reduction across
+// warps (threads > 32) exchanges the per warp partials once through red_buf (one element per
+// thread of the block), the block is synchronized before the exchange so that red_buf can be
+// reused by the next reduction.
 template <class Reducer, int threads, int scale>
 struct AllReduce {
   static_assert(threads == 1024 or threads == 512 or threads == 256 or threads == 128 or
@@ -33,21 +102,55 @@ struct AllReduce {
   static_assert(threads % scale == 0);
   template <typename T>
   static __device__ inline T run(T x, T* red_buf = nullptr) {
-    constexpr int offset = threads / 2;
-    if constexpr (offset >= 32) {
+    if constexpr (threads <= 32) {
+      constexpr int offset = threads / 2;
+      x = Reducer()(x, shfl_xor(x, offset));
+      if constexpr (offset == scale) {
+        return x;
+      } else {
+        return AllReduce<Reducer, offset, scale>::run(x);
+      }
+    } else if constexpr (scale >= 32) {
+      // the reduced threads are in different warps
       __syncthreads();
       red_buf[threadIdx.x] = x;
       __syncthreads();
-      x = Reducer()(x, red_buf[threadIdx.x ^ offset]);
-    } else {
-      x = Reducer()(x, T(__shfl_xor_sync(uint32_t(-1), x, offset)));
-    }
-    if constexpr (offset == scale) {
+      const int first = threadIdx.x - threadIdx.x % threads + threadIdx.x % scale;
+      x = red_buf[first];
+#pragma unroll
+      for (int i = 1; i < threads / scale; i++) x = Reducer()(x, red_buf[first + i * scale]);
       return x;
     } else {
-      return AllReduce<Reducer, offset, scale>::run(x, red_buf);
+      x = AllReduce<Reducer, 32, scale>::run(x);
+      // one partial per warp and per (threadIdx.x % scale)
+      const int warp = threadIdx.x / 32, lane = threadIdx.x % 32;
+      __syncthreads();
+      if (lane < scale) red_buf[warp * scale + lane] = x;
+      __syncthreads();
+      const int first = (warp - warp % (threads / 32)) * scale + lane % scale;
+      x = red_buf[first];
+#pragma unroll
+      for (int i = 1; i < threads / 32; i++) x = Reducer()(x, red_buf[first + i * scale]);
+      return x;
     }
   }
 };
 
+// In-place entries of the struct-valued reductions, red_buf holds one payload per thread
+template <int threads, int scale, typename T>
+__device__ inline void AllReduceArgMax(T* value, int* index, void* red_buf = nullptr) {
+  ArgMaxPair<T> x = AllReduce<ArgMaxOp, threads, scale>::run(
+      ArgMaxPair<T>{*value, *index}, reinterpret_cast<ArgMaxPair<T>*>(red_buf));
+  *value = x.value;
+  *index = x.index;
+}
+
+template <int threads, int scale, typename T>
+__device__ inline void AllReduceWelford(T* mean, T* m2, float count, void* red_buf = nullptr) {
+  WelfordState<T> x = AllReduce<WelfordOp, threads, scale>::run(
+      WelfordState<T>{count, *mean, *m2}, reinterpret_cast<WelfordState<T>*>(red_buf));
+  *mean = x.mean;
+  *m2 = x.m2;
+}
+
 }  // namespace tl
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "common.h"
+#include "reduce.h"
+
+namespace tl {
+
+// Kogge-Stone scan of x among the groups of lanes consecutive threads of a warp, the scanned
+// elements are ordered by the lane index in the group.
+template <class Op, int lanes>
+struct WarpScan {
+  static_assert(lanes == 32 or lanes == 16 or lanes == 8 or lanes == 4 or lanes == 2);
+  template <typename T>
+  static __device__ inline T inclusive(T x) {
+    const int lane = threadIdx.x % lanes;
+#pragma unroll
+    for (int offset = 1; offset < lanes; offset *= 2) {
+      T y = T(__shfl_up_sync(uint32_t(-1), x, offset, lanes));
+      if (lane >= offset) x = Op()(x, y);
+    }
+    return x;
+  }
+
+  // the first lane of each group gets the identity
+  template <typename T>
+  static __device__ inline T exclusive(T x, T identity) {
+    T y = T(__shfl_up_sync(uint32_t(-1), inclusive(x), 1, lanes));
+    return threadIdx.x % lanes == 0 ? identity : y;
+  }
+};
+
+}  // namespace tl
@@ -1,39 +1,221 @@
 #pragma once
 
+// shared by the CUDA and the HIP sources
+#if defined(__HIPCC__)
+#include "hip/common.h"
+#else
 #include "common.h"
+#endif
 
 namespace tl {
 
-template <int panel_width>
+// The index of the block in its blockIdx.z slice and the slice. The slices are launched one after
+// the other, or with interleave_z the blocks of the same tile of all the slices together.
+template <bool interleave_z>
+__device__ __forceinline__ int2 slice_block_index() {
+  if (!interleave_z) return {int(blockIdx.x + blockIdx.y * gridDim.x), int(blockIdx.z)};
+  const int block_idx = blockIdx.x + (blockIdx.y + blockIdx.z * gridDim.y) * gridDim.x;
+  return {int(block_idx / gridDim.z), int(block_idx % gridDim.z)};
+}
+
+template <int panel_width, bool interleave_z = false>
 __device__ dim3 rasterization2DRow() {
-  const int block_idx = blockIdx.x + blockIdx.y * gridDim.x;
+  const int2 slice_idx = slice_block_index<interleave_z>();
+  const int block_idx = slice_idx.x;
   const int grid_size = gridDim.x * gridDim.y;
   const int panel_size = panel_width * gridDim.x;
   const int panel_offset = block_idx % panel_size;
   const int panel_idx = block_idx / panel_size;
-  const int total_panel = cutlass::ceil_div(grid_size, panel_size);
+  const int total_panel = (grid_size + panel_size - 1) / panel_size;
   const int stride =
       panel_idx + 1 < total_panel ? panel_width : (grid_size - panel_idx * panel_size) / gridDim.x;
   const int col_idx =
       (panel_idx & 1) ? gridDim.x - 1 - panel_offset / stride : panel_offset / stride;
   const int row_idx = panel_offset % stride + panel_idx * panel_width;
-  return {col_idx, row_idx, blockIdx.z};
+  return {col_idx, row_idx, slice_idx.y};
 }
 
-template <int panel_width>
+template <int panel_width, bool interleave_z = false>
 __device__ dim3 rasterization2DColumn() {
-  const int block_idx = blockIdx.x + blockIdx.y * gridDim.x;
+  const int2 slice_idx = slice_block_index<interleave_z>();
+  const int block_idx = slice_idx.x;
   const int grid_size = gridDim.x * gridDim.y;
   const int panel_size = panel_width * gridDim.y;
   const int panel_offset = block_idx % panel_size;
   const int panel_idx = block_idx / panel_size;
-  const int total_panel = cutlass::ceil_div(grid_size, panel_size);
+  const int total_panel = (grid_size + panel_size - 1) / panel_size;
   const int stride =
       panel_idx + 1 < total_panel ? panel_width : (grid_size - panel_idx * panel_size) / gridDim.y;
   const int row_idx =
       (panel_idx & 1) ? gridDim.y - 1 - panel_offset / stride : panel_offset / stride;
   const int col_idx = panel_offset % stride + panel_idx * panel_width;
-  return {col_idx, row_idx, blockIdx.z};
+  return {col_idx, row_idx, slice_idx.y};
+}
+
+// The point d of the Z-order curve over a side x side square
+template <int side>
+__device__ __forceinline__ int2 morton_point(int d) {
+  int x = 0, y = 0;
+#pragma unroll
+  for (int bit = 0; (1 << bit) < side; bit++) {
+    x |= ((d >> (2 * bit)) & 1) << bit;
+    y |= ((d >> (2 * bit + 1)) & 1) << bit;
+  }
+  return {x, y};
+}
+
+// The point d of the Hilbert curve over a side x side square, from (0, 0) to (side - 1, 0)
+template <int side>
+__device__ __forceinline__ int2 hilbert_point(int d) {
+  int x = 0, y = 0;
+#pragma unroll
+  for (int s = 1; s < side; s *= 2) {
+    const int rx = 1 & (d / 2);
+    const int ry = 1 & (d ^ rx);
+    if (ry == 0) {
+      if (rx == 1) {
+        x = s - 1 - x;
+        y = s - 1 - y;
+      }
+      const int t = x;
+      x = y;
+      y = t;
+    }
+    x += s * rx;
+    y += s * ry;
+    d /= 4;
+  }
+  return {x, y};
+}
+
+// The panels of side rows of rasterization2DRow cut into side x side squares launched in the order
+// of the Hilbert (or Z-order) curve, side a power of 2. The columns past the last square of a panel
+// and the rows of the last partial panel are launched by columns.
+template <int side, bool hilbert, bool interleave_z = false>
+__device__ dim3 rasterization2DCurve() {
+  static_assert((side & (side - 1)) == 0, "The side of the curve should be a power of 2");
+  const int2 slice_idx = slice_block_index<interleave_z>();
+  const int panel_size = side * gridDim.x;
+  const int panel_idx = slice_idx.x / panel_size;
+  const int panel_offset = slice_idx.x % panel_size;
+  const int row0 = panel_idx * side;
+  const int rows = min(side, int(gridDim.y) - row0);
+  const int squares = rows == side ? gridDim.x / side : 0;
+  if (panel_offset < squares * side * side) {
+    const int square = panel_offset / (side * side);
+    const int2 point = hilbert ? hilbert_point<side>(panel_offset % (side * side))
+                               : morton_point<side>(panel_offset % (side * side));
+    // the squares of the odd panels are serpentined back, mirrored to continue the curve
+    const int col_idx = (panel_idx & 1) ? (squares - square) * side - 1 - point.x
+                                        : square * side + point.x;
+    return {col_idx, row0 + point.y, slice_idx.y};
+  }
+  const int offset = panel_offset - squares * side * side;
+  return {squares * side + offset / rows, row0 + offset % rows, slice_idx.y};
+}
+
+// Called by all the threads of the block after adding the partial accumulators into the workspace
+__device__ __forceinline__ void stream_k_signal(int* counter) {
+  __threadfence();
+  __syncthreads();
+  if (threadIdx.x == 0) atomicAdd(counter, 1);
+}
+
+// Called by all the threads of the block before reading the partial accumulators of the other
+// blocks
+__device__ __forceinline__ void stream_k_wait(int* counter, int expected) {
+  if (threadIdx.x == 0) {
+    while (atomicAdd(counter, 0) < expected) {
+    }
+  }
+  __syncthreads();
+  __threadfence();
+}
+
+// Wait until the semaphore reaches value, called by all the threads of the block
+__device__ __forceinline__ void semaphore_wait(int* semaphore, int value) {
+  if (threadIdx.x == 0) {
+    while (atomicAdd(semaphore, 0) != value) {
+    }
+  }
+  __syncthreads();
+  __threadfence();
+}
+
+// Set the semaphore to value after the global writes of all the threads of the block
+__device__ __forceinline__ void semaphore_release(int* semaphore, int value) {
+  __threadfence();
+  __syncthreads();
+  if (threadIdx.x == 0) atomicExch(semaphore, value);
+}
+
+// The group of a tile in the grouped kernels. offsets (num_groups + 1 elements) is the prefix sum
+// of the number of tiles of the groups, returns g with offsets[g] <= tile < offsets[g + 1], or
+// num_groups past the last tile. The lanes of a warp test 32 groups per step, so the hundreds of
+// groups take a few loads instead of a dependent binary search. Called by all the threads of the
+// block with the same tile.
+__device__ __forceinline__ int group_search(const int* offsets, int num_groups, int tile) {
+  for (int base = 0; base < num_groups; base += 32) {
+    const int g = base + threadIdx.x % 32;
+    // the offsets are non decreasing, the groups ending before tile are the first lanes
+    const bool before = g < num_groups && __ldg(offsets + g + 1) <= tile;
+#if defined(__HIPCC__)
+    // the two halves of a wavefront of 64 lanes test the same groups
+    const uint32_t mask = uint32_t(__ballot(before) >> (threadIdx.x % 64 / 32 * 32));
+#else
+    const uint32_t mask = __ballot_sync(uint32_t(-1), before);
+#endif
+    if (mask != uint32_t(-1)) return base + __popc(mask);
+  }
+  return num_groups;
+}
+
+// The sequence of a tile of a ragged batch whose rows are packed, the sequence s holding the rows
+// [cu_seqlens[s], cu_seqlens[s + 1]) in ceildiv(length, block) tiles. The tiles are numbered
+// across the sequences in order, the lanes of a warp count the tiles of 32 sequences per step with
+// a prefix sum, so no tile table is needed. Returns the first row of the tile << 32 | the
+// sequence, the sequence being batch past the last tile. Called by all the threads of the block
+// with the same tile.
+__device__ __forceinline__ int64_t ragged_tile_search(const int* cu_seqlens, int batch, int block,
+                                                      int tile) {
+  const int lane = threadIdx.x % 32;
+  int before = 0;  // the tiles of the sequences of the previous steps
+  for (int base = 0; base < batch; base += 32) {
+    const int s = base + lane;
+    const int tiles =
+        s < batch ? (__ldg(cu_seqlens + s + 1) - __ldg(cu_seqlens + s) + block - 1) / block : 0;
+    int end = tiles;  // the inclusive prefix sum of the tiles of the lanes
+#pragma unroll
+    for (int delta = 1; delta < 32; delta *= 2) {
+#if defined(__HIPCC__)
+      const int other = __shfl_up(end, delta, 32);
+#else
+      const int other = __shfl_up_sync(uint32_t(-1), end, delta);
+#endif
+      if (lane >= delta) end += other;
+    }
+    const bool ended = before + end <= tile;
+#if defined(__HIPCC__)
+    const uint32_t mask = uint32_t(__ballot(ended) >> (threadIdx.x % 64 / 32 * 32));
+    const int total = __shfl(end, 31, 32);
+#else
+    const uint32_t mask = __ballot_sync(uint32_t(-1), ended);
+    const int total = __shfl_sync(uint32_t(-1), end, 31);
+#endif
+    if (mask != uint32_t(-1)) {
+      const int seq = base + __popc(mask);
+      // the tiles before seq, the exclusive prefix sum of its lane
+#if defined(__HIPCC__)
+      const int first = before + __shfl(end - tiles, __popc(mask), 32);
+#else
+      const int first = before + __shfl_sync(uint32_t(-1), end - tiles, __popc(mask));
+#endif
+      const int row = __ldg(cu_seqlens + seq) + (tile - first) * block;
+      return (static_cast<int64_t>(row) << 32) | static_cast<uint32_t>(seq);
+    }
+    before += total;
+  }
+  return (static_cast<int64_t>(__ldg(cu_seqlens + batch)) << 32) | static_cast<uint32_t>(batch);
 }
 
 }  // namespace tl
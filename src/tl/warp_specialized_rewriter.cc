@@ -0,0 +1,608 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file warp_specialized_rewriter.cc
+ * \brief Split the pipelined loops into producer and consumer warps (sm90+)
+ */
+
+#include <tvm/arith/analyzer.h>
+#include <tvm/node/structural_equal.h>
+#include <tvm/tir/analysis.h>
+#include <tvm/tir/builtin.h>
+#include <tvm/tir/op.h>
+#include <tvm/tir/stmt_functor.h>
+#include <tvm/tir/transform.h>
+
+#include <algorithm>
+#include <optional>
+
+#include "op.h"
+#include "target_utils.h"
+
+namespace tvm {
+namespace tl {
+
+using namespace tir;
+
+/*!
+ * \brief Rewrite the buffers written by the bulk copies to have one version per stage.
+ */
+class StageBufferRewriter : public StmtExprMutator {
+ public:
+  StageBufferRewriter(const Map<Var, Buffer>& buffer_remap, PrimExpr stage)
+      : buffer_remap_(buffer_remap), stage_(stage) {}
+
+  PrimExpr RewriteAccessPtr(const Call& call, Optional<Integer> access_mask = NullOpt) {
+    ICHECK(call->op.same_as(builtin::tvm_access_ptr()));
+    auto it = buffer_remap_.find(Downcast<Var>(call->args[1]));
+    if (it == buffer_remap_.end()) return call;
+    const Buffer& new_buffer = (*it).second;
+    PrimExpr stage_size = 1;
+    for (size_t i = 1; i < new_buffer->shape.size(); i++) stage_size *= new_buffer->shape[i];
+    Array<PrimExpr> new_args = call->args;
+    new_args.Set(2, call->args[2] + stage_ * stage_size);
+    if (access_mask.defined()) new_args.Set(4, access_mask.value());
+    return Call(call->dtype, call->op, new_args, call->span);
+  }
+
+ private:
+  Stmt VisitStmt_(const BufferStoreNode* op) final {
+    BufferStore store = Downcast<BufferStore>(StmtExprMutator::VisitStmt_(op));
+    auto it = buffer_remap_.find(store->buffer->data);
+    if (it == buffer_remap_.end()) return std::move(store);
+    auto* n = store.CopyOnWrite();
+    n->buffer = (*it).second;
+    n->indices.insert(n->indices.begin(), stage_);
+    return std::move(store);
+  }
+
+  PrimExpr VisitExpr_(const BufferLoadNode* op) final {
+    BufferLoad load = Downcast<BufferLoad>(StmtExprMutator::VisitExpr_(op));
+    auto it = buffer_remap_.find(load->buffer->data);
+    if (it == buffer_remap_.end()) return std::move(load);
+    auto* n = load.CopyOnWrite();
+    n->buffer = (*it).second;
+    n->indices.insert(n->indices.begin(), stage_);
+    return std::move(load);
+  }
+
+  PrimExpr VisitExpr_(const CallNode* op) final {
+    Call call = Downcast<Call>(StmtExprMutator::VisitExpr_(op));
+    if (call->op.same_as(builtin::tvm_access_ptr())) return RewriteAccessPtr(call);
+    return std::move(call);
+  }
+
+  Map<Var, Buffer> buffer_remap_;
+  PrimExpr stage_;
+};
+
+/*!
+ * \brief Lower the loops of T.Pipelined(..., mode="warp_specialized").
+ *
+ * A producer warpgroup is appended to the thread block, one of its threads issues the bulk
+ * copies (lowered by LowerTileOp) into a ring of num_stages buffers, while the original threads
+ * become the consumers running the rest of the block. The two groups are synchronized through a
+ * full and an empty mbarrier per stage:
+ *
+ *   if threadIdx.x < num_consumer_threads:
+ *     consumer prologue
+ *     for k: wait(full[k % S]); consumer body of stage k % S; arrive(empty[k % S])
+ *     consumer epilogue
+ *   else:
+ *     for k: wait(empty[k % S]); issue the copies of stage k % S on full[k % S]
+ */
+class WarpSpecializedRewriter : public StmtExprMutator {
+ public:
+  static PrimFunc Substitute(PrimFunc f) {
+    auto target = f->GetAttr<Target>(tvm::attr::kTarget);
+    ICHECK(target.defined()) << "WarpSpecialized: Require the target attribute";
+    WarpSpecializedRewriter rewriter;
+    rewriter.target_ = target.value();
+    // peel the tensor maps encoded by LowerTileOp, the multicast copies add their own ones
+    Stmt body = f->body;
+    while (true) {
+      Var tensor_map;
+      Array<PrimExpr> encode_args;
+      Optional<Stmt> inner = MatchTensorMapEncode(body, &tensor_map, &encode_args);
+      if (!inner.defined()) break;
+      rewriter.tensor_maps_.emplace_back(tensor_map, encode_args);
+      body = inner.value();
+    }
+    body = rewriter(body);
+    for (auto it = rewriter.tensor_maps_.rbegin(); it != rewriter.tensor_maps_.rend(); it++) {
+      body = MakeTensorMapEncode(it->first, it->second, body);
+    }
+    PrimFuncNode* fptr = f.CopyOnWrite();
+    fptr->body = body;
+    return f;
+  }
+
+ private:
+  WarpSpecializedRewriter() = default;
+
+  // The producer is a single warpgroup, only one of its threads issues the copies.
+  static constexpr int kNumProducerThreads = 128;
+
+  struct BulkCopy {
+    PrimExpr bytes;
+    Array<Call> loads;
+    // the attr::kCacheHint scope of the copy, if any
+    Optional<AttrStmt> cache_hint;
+  };
+
+  // A copy shared by the blocks of the cluster, each block loads a slice of the outermost box
+  // dimension into all the blocks.
+  struct MulticastInfo {
+    Var tensor_map;
+    int64_t slice_rows{0}, slice_elems{0};
+  };
+
+  Stmt VisitStmt_(const AttrStmtNode* op) final {
+    if (op->attr_key == tl::attr::kClusterSize) {
+      cluster_var_ = Downcast<IterVar>(op->node)->var;
+      cluster_size_ = Downcast<Integer>(op->value)->value;
+      Stmt stmt = StmtExprMutator::VisitStmt_(op);
+      cluster_var_ = Var();
+      cluster_size_ = 1;
+      return stmt;
+    }
+    if (op->attr_key == tir::attr::thread_extent) {
+      IterVar iv = Downcast<IterVar>(op->node);
+      if (iv->thread_tag == "threadIdx.x") {
+        auto extent = as_const_int(op->value);
+        if (extent == nullptr) return StmtExprMutator::VisitStmt_(op);
+        thread_var_ = iv->var;
+        num_threads_ = *extent;
+        Stmt body = VisitStmt(op->body);
+        thread_var_ = Var();
+        if (!specialized_) return AttrStmt(op->node, op->attr_key, op->value, body);
+        PrimExpr new_extent = make_const(op->value.dtype(), num_threads_ + kNumProducerThreads);
+        IterVar new_iv(Range::FromMinExtent(iv->dom->min, new_extent), iv->var, iv->iter_type,
+                       iv->thread_tag, iv->span);
+        return AttrStmt(new_iv, op->attr_key, new_extent, body);
+      }
+    }
+    return StmtExprMutator::VisitStmt_(op);
+  }
+
+  Stmt VisitStmt_(const ForNode* op) final {
+    For loop = Downcast<For>(StmtExprMutator::VisitStmt_(op));
+    // the top level loops are handled by the block
+    if (!IsWarpSpecialized(op) || top_level_loops_.count(op)) return std::move(loop);
+    LOG(WARNING) << "WarpSpecialized: The warp specialized pipeline should be a top level loop "
+                    "of the kernel, fall back to the default pipeline";
+    return DropMode(loop);
+  }
+
+  Stmt VisitStmt_(const BlockNode* op) final {
+    // the code around the pipelined loop is assigned to the consumers, so the loop should be a
+    // direct child of the block
+    auto get_seq = [](const Stmt& body) -> Array<Stmt> {
+      if (auto seq_stmt = body.as<SeqStmtNode>()) return seq_stmt->seq;
+      return {body};
+    };
+    for (const auto& stmt : get_seq(op->body)) {
+      if (IsWarpSpecialized(stmt.as<ForNode>())) top_level_loops_.insert(stmt.as<ForNode>());
+    }
+    Block block = Downcast<Block>(StmtExprMutator::VisitStmt_(op));
+    Array<Stmt> seq = get_seq(block->body);
+    int loop_idx = -1;
+    bool changed = false;
+    for (size_t i = 0; i < seq.size(); i++) {
+      if (!IsWarpSpecialized(seq[i].as<ForNode>())) continue;
+      if (loop_idx == -1 && !specialized_) {
+        loop_idx = i;
+      } else {
+        LOG(WARNING) << "WarpSpecialized: Only one warp specialized pipeline is supported in a "
+                        "kernel, fall back to the default pipeline";
+        seq.Set(i, DropMode(Downcast<For>(seq[i])));
+        changed = true;
+      }
+    }
+    if (loop_idx != -1) {
+      std::string reason;
+      Optional<Block> new_block = Rewrite(block, seq, loop_idx, &reason);
+      if (new_block.defined()) {
+        specialized_ = true;
+        return new_block.value();
+      }
+      LOG(WARNING) << "WarpSpecialized: " << reason << ", fall back to the default pipeline";
+      seq.Set(loop_idx, DropMode(Downcast<For>(seq[loop_idx])));
+      changed = true;
+    }
+    if (changed) block.CopyOnWrite()->body = SeqStmt::Flatten(seq);
+    return std::move(block);
+  }
+
+  Optional<Block> Rewrite(const Block& block, const Array<Stmt>& seq, int loop_idx,
+                          std::string* reason) {
+    For loop = Downcast<For>(seq[loop_idx]);
+    if (!thread_var_.defined()) {
+      *reason = "Require a constant threadIdx.x extent";
+      return NullOpt;
+    }
+    if (!TargetIsHopper(target_.get())) {
+      *reason = "Require a sm90 target";
+      return NullOpt;
+    }
+    if (num_threads_ % kNumProducerThreads != 0) {
+      *reason = "Require the number of threads to be a multiple of 128";
+      return NullOpt;
+    }
+    int num_stages = 1;
+    if (auto anno = loop->annotations.Get("num_stages")) {
+      num_stages = std::max(1, static_cast<int>(Downcast<Integer>(anno)->value));
+    }
+
+    // Step 1: split the loop body into the bulk copies and the consumer statements
+    Array<Stmt> body;
+    if (auto seq_stmt = loop->body.as<SeqStmtNode>()) {
+      body = seq_stmt->seq;
+    } else {
+      body = {loop->body};
+    }
+    std::vector<BulkCopy> copies;
+    Array<Stmt> consumer_body;
+    std::unordered_set<const VarNode*> old_barriers;
+    for (const auto& stmt : body) {
+      if (auto eval = stmt.as<EvaluateNode>()) {
+        if (auto call = eval->value.as<CallNode>()) {
+          if (call->op.same_as(mbarrier_wait())) continue;
+        }
+      }
+      if (!ContainsBulkCopy(stmt)) {
+        consumer_body.push_back(stmt);
+        continue;
+      }
+      auto copy = MatchBulkCopy(stmt);
+      if (!copy.has_value()) {
+        *reason = "Unrecognized bulk copy in the pipelined loop";
+        return NullOpt;
+      }
+      for (const auto& load : copy->loads) {
+        old_barriers.insert(Downcast<Call>(load->args[1])->args[1].as<VarNode>());
+      }
+      copies.push_back(copy.value());
+    }
+    if (copies.empty()) {
+      *reason = "No bulk copy (TMA) in the pipelined loop";
+      return NullOpt;
+    }
+
+    // Step 2: the shared buffers written by the copies get one version per stage, they should
+    // only be used by the loop.
+    Map<Var, Buffer> buffer_remap;
+    for (const auto& copy : copies) {
+      for (const auto& load : copy.loads) {
+        Var data = Downcast<Var>(Downcast<Call>(load->args[2])->args[1]);
+        if (buffer_remap.count(data)) continue;
+        auto it = std::find_if(block->alloc_buffers.begin(), block->alloc_buffers.end(),
+                               [&](const Buffer& buf) { return buf->data.same_as(data); });
+        if (it == block->alloc_buffers.end()) {
+          *reason = "The copied buffer " + data->name_hint + " is not allocated in the kernel";
+          return NullOpt;
+        }
+        ObjectPtr<BufferNode> new_buffer = make_object<BufferNode>(*((*it).get()));
+        new_buffer->shape.insert(new_buffer->shape.begin(), PrimExpr(num_stages));
+        if (new_buffer->strides.size()) {
+          PrimExpr stride_0 = new_buffer->strides[0] * new_buffer->shape[1];
+          new_buffer->strides.insert(new_buffer->strides.begin(), stride_0);
+        }
+        buffer_remap.Set(data, Buffer(new_buffer));
+      }
+    }
+    for (size_t i = 0; i < seq.size(); i++) {
+      if (static_cast<int>(i) == loop_idx) continue;
+      bool used = UsesVar(seq[i], [&](const VarNode* v) {
+        return buffer_remap.count(GetRef<Var>(v)) != 0;
+      });
+      if (used) {
+        *reason = "The copied buffers should only be used in the pipelined loop";
+        return NullOpt;
+      }
+    }
+
+    // Step 3: the copies not depending on the cluster dimension are multicast
+    std::unordered_map<const CallNode*, MulticastInfo> multicast;
+    for (const auto& copy : copies) {
+      for (const auto& load : copy.loads) {
+        MulticastInfo info = GetMulticast(load);
+        if (info.tensor_map.defined()) multicast[load.get()] = info;
+      }
+    }
+    // the empty barrier of a stage is released by the consumers of all the blocks in the cluster
+    int num_release_blocks = multicast.empty() ? 1 : cluster_size_;
+
+    // Step 4: make the barriers
+    DataType dtype = thread_var_.dtype();
+    PrimExpr num_consumer_threads = make_const(dtype, num_threads_);
+    Buffer full_barrier = decl_buffer({num_stages}, DataType::UInt(64), "full_barrier", "shared");
+    Buffer empty_barrier =
+        decl_buffer({num_stages}, DataType::UInt(64), "empty_barrier", "shared");
+    auto barrier_ptr = [](const Buffer& barrier, PrimExpr stage) {
+      // the barriers are not tracked by the sync planning
+      return barrier.access_ptr(0, DataType::Handle(), 1, stage, 1);
+    };
+    auto extern_call = [](const std::string& name, Array<PrimExpr> args) {
+      args.insert(args.begin(), StringImm(name));
+      return Evaluate(Call(DataType::Handle(), builtin::call_extern(), args));
+    };
+    Array<Stmt> init;
+    for (int i = 0; i < num_stages; i++) {
+      init.push_back(extern_call("tl::mbarrier_init",
+                                 {barrier_ptr(full_barrier, i), static_cast<int>(copies.size())}));
+      init.push_back(
+          extern_call("tl::mbarrier_init", {barrier_ptr(empty_barrier, i),
+                                            static_cast<int>(num_threads_ * num_release_blocks)}));
+    }
+    init.push_back(extern_call("tl::fence_barrier_init", {}));
+    // the barriers of the other blocks in the cluster are used by the multicast copies
+    Stmt init_sync =
+        multicast.empty()
+            ? Evaluate(Call(DataType::Int(32), builtin::tvm_storage_sync(), {StringImm("shared")}))
+            : extern_call("tl::cluster_sync", {});
+    Stmt init_stmt = SeqStmt({IfThenElse(EQ(thread_var_, 0), SeqStmt(init)), init_sync});
+
+    auto [producer_regs, consumer_regs] = ComputeRegisters(num_threads_ / kNumProducerThreads);
+
+    // Step 5: the producer issues the copies of stage k after the consumers release it
+    Var producer_var = loop->loop_var.copy_with_suffix("");
+    PrimExpr producer_iter = producer_var - loop->min;
+    PrimExpr producer_stage = floormod(producer_iter, num_stages);
+    StageBufferRewriter producer_rewriter(buffer_remap, producer_stage);
+    Array<Stmt> producer_body;
+    producer_body.push_back(Evaluate(
+        Call(DataType::Handle(), mbarrier_wait(),
+             {barrier_ptr(empty_barrier, producer_stage),
+              floormod(floordiv(producer_iter, num_stages) + 1, 2)})));
+    for (const auto& copy : copies) {
+      producer_body.push_back(extern_call("tl::mbarrier_arrive_expect_tx",
+                                          {barrier_ptr(full_barrier, producer_stage), copy.bytes}));
+      for (const auto& load : copy.loads) {
+        Array<PrimExpr> args = load->args;
+        args.Set(1, barrier_ptr(full_barrier, producer_stage));
+        // completed through the full barrier, so not tracked by the sync planning
+        args.Set(2, producer_rewriter.RewriteAccessPtr(Downcast<Call>(args[2]), Integer(0)));
+        auto it = multicast.find(load.get());
+        if (it == multicast.end()) {
+          Stmt issue = Evaluate(Call(load->dtype, load->op, args, load->span));
+          if (auto hint = copy.cache_hint) {
+            issue =
+                AttrStmt(hint.value()->node, hint.value()->attr_key, hint.value()->value, issue);
+          }
+          producer_body.push_back(issue);
+          continue;
+        }
+        const MulticastInfo& info = it->second;
+        PrimExpr rank = floormod(cluster_var_, cluster_size_);
+        Call smem_ptr = Downcast<Call>(args[2]);
+        Array<PrimExpr> ptr_args = smem_ptr->args;
+        ptr_args.Set(2, ptr_args[2] + rank * make_const(ptr_args[2].dtype(), info.slice_elems));
+        args.Set(0, info.tensor_map);
+        args.Set(2, Call(smem_ptr->dtype, smem_ptr->op, ptr_args));
+        PrimExpr outer_coord = args[args.size() - 1];
+        args.Set(args.size() - 1,
+                 outer_coord + cast(outer_coord.dtype(), rank) * static_cast<int>(info.slice_rows));
+        args.insert(args.begin() + 3, IntImm(DataType::UInt(16), (1 << cluster_size_) - 1));
+        producer_body.push_back(
+            Evaluate(Call(load->dtype, tma_load_multicast(), args, load->span)));
+      }
+    }
+    Map<Var, PrimExpr> vmap;
+    vmap.Set(loop->loop_var, producer_var);
+    Stmt producer_loop = For(producer_var, loop->min, loop->extent, ForKind::kSerial,
+                             tir::Substitute(SeqStmt(producer_body), vmap));
+    Stmt producer = SeqStmt(
+        {extern_call("tl::warpgroup_reg_dealloc<" + std::to_string(producer_regs) + ">", {}),
+         IfThenElse(EQ(thread_var_, num_consumer_threads), producer_loop)});
+
+    // Step 6: the consumers run the rest of the block
+    PrimExpr consumer_iter = loop->loop_var - loop->min;
+    PrimExpr consumer_stage = floormod(consumer_iter, num_stages);
+    Array<Stmt> consumer_loop_body;
+    consumer_loop_body.push_back(
+        Evaluate(Call(DataType::Handle(), mbarrier_wait(),
+                      {barrier_ptr(full_barrier, consumer_stage),
+                       floormod(floordiv(consumer_iter, num_stages), 2)})));
+    StageBufferRewriter consumer_rewriter(buffer_remap, consumer_stage);
+    for (const auto& stmt : consumer_body) consumer_loop_body.push_back(consumer_rewriter(stmt));
+    if (num_release_blocks == 1) {
+      consumer_loop_body.push_back(
+          extern_call("tl::mbarrier_arrive", {barrier_ptr(empty_barrier, consumer_stage)}));
+    } else {
+      for (int i = 0; i < num_release_blocks; i++) {
+        consumer_loop_body.push_back(extern_call(
+            "tl::mbarrier_arrive", {barrier_ptr(empty_barrier, consumer_stage), Integer(i)}));
+      }
+    }
+    Map<String, ObjectRef> annotations;
+    for (const auto& [key, value] : loop->annotations) {
+      if (key != "num_stages" && key != "pipeline_mode" && key != attr::kPipelinePrefetch)
+        annotations.Set(key, value);
+    }
+    For consumer_loop(loop->loop_var, loop->min, loop->extent, loop->kind,
+                      SeqStmt(consumer_loop_body), loop->thread_binding, annotations, loop->span);
+    Array<Stmt> consumer_seq;
+    consumer_seq.push_back(
+        extern_call("tl::warpgroup_reg_alloc<" + std::to_string(consumer_regs) + ">", {}));
+    for (size_t i = 0; i < seq.size(); i++) {
+      consumer_seq.push_back(static_cast<int>(i) == loop_idx ? Stmt(consumer_loop) : seq[i]);
+    }
+    // named barrier 0 is used by __syncthreads
+    Stmt consumer = AttrStmt(Integer(1), tir::attr::thread_partial_scope, num_consumer_threads,
+                             SeqStmt(consumer_seq));
+
+    Array<Stmt> new_body = {init_stmt,
+                            IfThenElse(LT(thread_var_, num_consumer_threads), consumer, producer)};
+    // no block may exit while the others in the cluster still access its shared memory
+    if (!multicast.empty()) new_body.push_back(extern_call("tl::cluster_sync", {}));
+
+    Array<Buffer> alloc_buffers;
+    for (const auto& buffer : block->alloc_buffers) {
+      if (old_barriers.count(buffer->data.get())) continue;
+      auto it = buffer_remap.find(buffer->data);
+      alloc_buffers.push_back(it == buffer_remap.end() ? buffer : (*it).second);
+    }
+    alloc_buffers.push_back(full_barrier);
+    alloc_buffers.push_back(empty_barrier);
+    Block new_block = block;
+    auto* n = new_block.CopyOnWrite();
+    n->body = SeqStmt(new_body);
+    n->alloc_buffers = alloc_buffers;
+    return new_block;
+  }
+
+  MulticastInfo GetMulticast(const Call& load) {
+    MulticastInfo info;
+    if (cluster_size_ <= 1) return info;
+    for (size_t i = 3; i < load->args.size(); i++) {
+      if (UsesVar(load->args[i], [&](const VarNode* v) { return v == cluster_var_.get(); }))
+        return info;
+    }
+    auto it = std::find_if(tensor_maps_.begin(), tensor_maps_.end(),
+                           [&](const auto& kv) { return kv.first.same_as(load->args[0]); });
+    if (it == tensor_maps_.end()) return info;
+    Var tensor_map = it->first;
+    Array<PrimExpr> encode_args = it->second;
+    int rank = Downcast<Integer>(encode_args[2])->value;
+    int bits = Downcast<Integer>(encode_args[1])->value;
+    int swizzle = Downcast<Integer>(encode_args[5 + 4 * rank])->value;
+    int box_begin = 4 + 2 * rank;
+    int64_t box_elems = 1;
+    for (int i = 0; i < rank; i++) {
+      auto box = as_const_int(encode_args[box_begin + i]);
+      if (box == nullptr) return info;
+      box_elems *= *box;
+    }
+    int64_t outer = *as_const_int(encode_args[box_begin + rank - 1]);
+    if (outer % cluster_size_ != 0) return info;
+    // the slices should keep the alignment of the (swizzled) box
+    int64_t slice_bytes = box_elems / cluster_size_ * bits / 8;
+    if (slice_bytes % (swizzle == 0 ? 128 : 1024) != 0) return info;
+    encode_args.Set(box_begin + rank - 1, Integer(outer / cluster_size_));
+    info.slice_rows = outer / cluster_size_;
+    info.slice_elems = box_elems / cluster_size_;
+    for (const auto& [var, args] : tensor_maps_) {
+      if (StructuralEqual()(args, encode_args)) {
+        info.tensor_map = var;
+        return info;
+      }
+    }
+    info.tensor_map = Var(tensor_map->name_hint + "_multicast", DataType::Handle());
+    tensor_maps_.emplace_back(info.tensor_map, encode_args);
+    return info;
+  }
+
+  // The registers per thread of the producer and the consumers, keeping the register file
+  // (512 registers per thread of a warpgroup) unchanged.
+  static std::pair<int, int> ComputeRegisters(int num_consumer_groups) {
+    int producer_regs = num_consumer_groups <= 2 ? 40 : 24;
+    int consumer_regs = std::min(240, (512 - producer_regs) / num_consumer_groups / 8 * 8);
+    return {producer_regs, consumer_regs};
+  }
+
+  static bool IsWarpSpecialized(const ForNode* loop) {
+    if (loop == nullptr) return false;
+    auto mode = loop->annotations.Get("pipeline_mode");
+    return mode.defined() && Downcast<String>(mode) == "warp_specialized";
+  }
+
+  static For DropMode(For loop) {
+    loop.CopyOnWrite()->annotations.erase("pipeline_mode");
+    return loop;
+  }
+
+  static bool ContainsBulkCopy(const Stmt& stmt) {
+    bool found = false;
+    PostOrderVisit(stmt, [&](const ObjectRef& node) {
+      if (auto call = node.as<CallNode>()) {
+        if (call->op.same_as(tma_load())) found = true;
+      }
+    });
+    return found;
+  }
+
+  // Match the bulk copy issued by LowerTileOp:
+  //   if threadIdx.x == 0:
+  //     tl::mbarrier_init_expect_tx(barrier, bytes)
+  //     tma_load(tensor_map, barrier, smem_ptr, coords...)
+  //     ...
+  std::optional<BulkCopy> MatchBulkCopy(const Stmt& stmt) const {
+    BulkCopy copy;
+    const IfThenElseNode* if_node = stmt.as<IfThenElseNode>();
+    if (auto attr = stmt.as<AttrStmtNode>()) {
+      if (attr->attr_key != attr::kCacheHint) return std::nullopt;
+      copy.cache_hint = GetRef<AttrStmt>(attr);
+      if_node = attr->body.as<IfThenElseNode>();
+    }
+    if (if_node == nullptr || if_node->else_case.defined()) return std::nullopt;
+    auto seq = if_node->then_case.as<SeqStmtNode>();
+    if (seq == nullptr || seq->size() < 2) return std::nullopt;
+    for (size_t i = 0; i < seq->size(); i++) {
+      auto eval = seq->seq[i].as<EvaluateNode>();
+      if (eval == nullptr) return std::nullopt;
+      auto call = eval->value.as<CallNode>();
+      if (call == nullptr) return std::nullopt;
+      if (i == 0) {
+        if (!call->op.same_as(builtin::call_extern()) ||
+            Downcast<StringImm>(call->args[0])->value != "tl::mbarrier_init_expect_tx")
+          return std::nullopt;
+        copy.bytes = call->args[2];
+      } else {
+        if (!call->op.same_as(tma_load())) return std::nullopt;
+        // the producer thread can not see the values computed by the consumers
+        for (size_t j = 3; j < call->args.size(); j++) {
+          bool has_load = false;
+          PostOrderVisit(call->args[j], [&](const ObjectRef& node) {
+            if (auto load = node.as<BufferLoadNode>()) {
+              if (load->buffer.scope() != "global") has_load = true;
+            }
+          });
+          if (has_load) return std::nullopt;
+        }
+        copy.loads.push_back(GetRef<Call>(call));
+      }
+    }
+    return copy;
+  }
+
+  Target target_;
+  // tensor maps with their encoding arguments, see MakeTensorMapEncode
+  std::vector<std::pair<Var, Array<PrimExpr>>> tensor_maps_;
+  std::unordered_set<const ForNode*> top_level_loops_;
+  Var cluster_var_;
+  int64_t cluster_size_{1};
+  Var thread_var_;
+  int64_t num_threads_{0};
+  bool specialized_{false};
+};
+
+tvm::transform::Pass WarpSpecialized() {
+  using namespace tir::transform;
+  auto pass_func = [=](PrimFunc f, IRModule m, PassContext ctx) {
+    return WarpSpecializedRewriter::Substitute(std::move(f));
+  };
+  return CreatePrimFuncPass(pass_func, 0, "tl.WarpSpecialized", {}, /*function_local=*/true);
+}
+
+TVM_REGISTER_GLOBAL("tl.WarpSpecialized").set_body_typed(WarpSpecialized);
+
+}  // namespace tl
+}  // namespace tvm
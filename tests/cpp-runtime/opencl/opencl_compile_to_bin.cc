@@ -20,7 +20,12 @@
 #include <gtest/gtest.h>
 #include <tvm/runtime/profiling.h>
 
+#include <tvm/runtime/registry.h>
+
+#include <algorithm>
 #include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <regex>
 
 #include "../src/runtime/opencl/opencl_common.h"
@@ -206,3 +211,52 @@ TEST_F(OpenCLCompileBin, SourceVsBinaryCompilationPerf) {
   }
   ASSERT_LT(compileFromBinTimeMS, compileFromSourceTimeMS);
 }
+
+TEST_F(OpenCLCompileBin, ProgramCache) {
+  namespace fs = std::filesystem;
+  fs::remove_all(m_tmpDirName);
+  fs::create_directories(m_tmpDirName);
+  const PackedFunc* set_cache_dir = Registry::Get("runtime.opencl.SetProgramCacheDir");
+  ASSERT_NE(set_cache_dir, nullptr);
+  (*set_cache_dir)(m_tmpDirName);
+
+  auto install_all = [&]() {
+    OpenCLModuleNode module(m_dataSrc, "cl", m_fmap, std::string());
+    module.Init();
+    for (size_t i = 0; i < m_kernelNames.size(); ++i) {
+      OpenCLModuleNode::KTRefEntry e = {i, 1};
+      module.InstallKernel(m_workspace, m_workspace->GetThreadEntry(), m_kernelNames[i], e);
+    }
+  };
+  auto list_cache = [&]() {
+    std::vector<fs::path> files;
+    for (const auto& entry : fs::directory_iterator(m_tmpDirName)) files.push_back(entry.path());
+    std::sort(files.begin(), files.end());
+    return files;
+  };
+  // The first run compiles from source and fills the cache, the second one loads the binaries.
+  install_all();
+  std::vector<fs::path> cache_files = list_cache();
+  ASSERT_EQ(cache_files.size(), m_kernelNames.size());
+  // A program rebuilt from source would be saved again, replacing its file with a new one.
+  const auto saved_time = std::chrono::floor<std::chrono::seconds>(
+      fs::file_time_type::clock::now() - std::chrono::hours(1));
+  for (const auto& path : cache_files) fs::last_write_time(path, saved_time);
+  install_all();
+  ASSERT_EQ(list_cache(), cache_files);
+  for (const auto& path : cache_files) {
+    ASSERT_EQ(fs::last_write_time(path), saved_time) << path << " was rebuilt";
+  }
+
+  // The invalid cache files are ignored and replaced.
+  for (const auto& path : cache_files) {
+    std::ofstream(path, std::ios::out | std::ios::binary | std::ios::trunc) << "garbage";
+  }
+  install_all();
+  for (const auto& path : cache_files) {
+    ASSERT_GT(fs::file_size(path), 7u);
+  }
+
+  (*set_cache_dir)(std::string());
+  fs::remove_all(m_tmpDirName);
+}
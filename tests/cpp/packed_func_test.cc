@@ -267,6 +267,50 @@ TEST(PackedFunc, ObjectConversion) {
   pf2(ObjectRef(m), Module());
 }
 
+TEST(TypedPackedFunc, TypedEntry) {
+  using namespace tvm;
+  using namespace tvm::runtime;
+  auto typed_obj = [](const auto& f) {
+    return static_cast<const PackedFuncObj*>(f.packed().get());
+  };
+  {
+    TypedPackedFunc<int(int, int)> add([](int x, int y) { return x + y; });
+    ICHECK((detail::TypedLambdaObj<int, int, int>::Matches(typed_obj(add))));
+    ICHECK_EQ(add(1, 2), 3);
+    ICHECK_EQ(add.packed()(1, 2).operator int(), 3);
+    // a TypedPackedFunc of another signature calls it boxed
+    TypedPackedFunc<int64_t(int64_t, int64_t)> add64(add.packed());
+    ICHECK_EQ(add64(1, 2), 3);
+  }
+  {
+    // a void signature discards the value returned by the lambda
+    int calls = 0;
+    TypedPackedFunc<void(int)> count([&calls](int x) {
+      calls += x;
+      return calls;
+    });
+    ICHECK((detail::TypedLambdaObj<void, int>::Matches(typed_obj(count))));
+    count(2);
+    count.packed()(3);
+    ICHECK_EQ(calls, 5);
+    TypedPackedFunc<void()> nothing([]() {});
+    nothing();
+  }
+  {
+    // the value of the lambda converts to the return type of the signature
+    TypedPackedFunc<ObjectRef(String)> make_var([](String name) { return tir::Var(name); });
+    ICHECK((detail::TypedLambdaObj<ObjectRef, String>::Matches(typed_obj(make_var))));
+    ICHECK(Downcast<tir::Var>(make_var("x"))->name_hint == "x");
+  }
+  {
+    TypedPackedFunc<int(int)> boxed(PackedFunc([](TVMArgs args, TVMRetValue* rv) {
+      *rv = args[0].operator int() + 1;
+    }));
+    ICHECK(!(detail::TypedLambdaObj<int, int>::Matches(typed_obj(boxed))));
+    ICHECK_EQ(boxed(1), 2);
+  }
+}
+
 TEST(TypedPackedFunc, RValue) {
   using namespace tvm;
   using namespace tvm::runtime;
@@ -21,9 +21,15 @@
 #include <gtest/gtest.h>
 #include <tvm/runtime/memory/memory_manager.h>
 
+#include <condition_variable>
 #include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
 
+#include "../../../../src/runtime/memory/caching_allocator.h"
 #include "../../../../src/runtime/memory/pooled_allocator.h"
+#include "../../../../src/runtime/memory/stream_ordered_allocator.h"
 
 namespace tvm {
 namespace runtime {
@@ -202,6 +208,162 @@ TEST_F(TvmVMMemoryManagerTest, PooledAllocOpenCLTexture) {
     EXPECT_NE(what.find(pattern), std::string::npos) << what;
   }
 }
+TEST_F(TvmVMMemoryManagerTest, CachingAllocBasic) {
+  Device dev = {kDLCPU, 0};
+  Allocator* allocator = MemoryManagerWrapper::GetOrCreateAllocator(dev, kCaching);
+  EXPECT_EQ(allocator->UsedMemory(), 0);
+  EXPECT_EQ(CachingAllocator::RoundSize(1), CachingAllocator::kMinBlockSize);
+  EXPECT_EQ(CachingAllocator::RoundSize(1025), 1280);
+  EXPECT_EQ(CachingAllocator::RoundSize(3000), 3072);
+  auto buff = allocator->Alloc(64, 32, DataType::Float(32));
+  EXPECT_EQ(buff.size, CachingAllocator::kMinBlockSize);
+  // the small blocks are split from a segment of kSmallSegment
+  EXPECT_EQ(allocator->UsedMemory(), CachingAllocator::kSmallSegment);
+  auto other = allocator->Alloc(100 << 10, 32, DataType::Float(32));
+  EXPECT_EQ(allocator->UsedMemory(), CachingAllocator::kSmallSegment);
+  allocator->Free(buff);
+  // served again by the cache of the thread
+  auto again = allocator->Alloc(64, 32, DataType::Float(32));
+  EXPECT_EQ(again.data, buff.data);
+  allocator->Free(again);
+  allocator->Free(other);
+  EXPECT_EQ(allocator->UsedMemory(), CachingAllocator::kSmallSegment);
+}
+
+TEST_F(TvmVMMemoryManagerTest, CachingAllocLarge) {
+  Device dev = {kDLCPU, 0};
+  Allocator* allocator = MemoryManagerWrapper::GetOrCreateAllocator(dev, kCaching);
+  auto first = allocator->Alloc(2 << 20, 32, DataType::Float(32));
+  auto second = allocator->Alloc(2 << 20, 32, DataType::Float(32));
+  // both are split from one segment of kLargeSegment
+  EXPECT_EQ(allocator->UsedMemory(), CachingAllocator::kLargeSegment);
+  EXPECT_EQ(static_cast<char*>(second.data), static_cast<char*>(first.data) + (2 << 20));
+  allocator->Free(first);
+  allocator->Free(second);
+  // the freed blocks are coalesced, a request of the whole segment reuses it
+  auto whole = allocator->Alloc(CachingAllocator::kLargeSegment, 32, DataType::Float(32));
+  EXPECT_EQ(whole.data, first.data);
+  EXPECT_EQ(allocator->UsedMemory(), CachingAllocator::kLargeSegment);
+  allocator->Free(whole);
+  // a request of at least kMinLargeAlloc has its own segment of its size class
+  auto huge = allocator->Alloc(CachingAllocator::kLargeSegment + 1, 32, DataType::Float(32));
+  EXPECT_EQ(huge.size, 24 << 20);
+  EXPECT_EQ(allocator->UsedMemory(), CachingAllocator::kLargeSegment + (24 << 20));
+  allocator->Free(huge);
+}
+
+TEST_F(TvmVMMemoryManagerTest, CachingAllocAligned) {
+  Device dev = {kDLCPU, 0};
+  Allocator* allocator = MemoryManagerWrapper::GetOrCreateAllocator(dev, kCaching);
+  // the size class of 640 B is not a multiple of kMinBlockSize, the next block still is aligned
+  auto first = allocator->Alloc(640, CachingAllocator::kMinBlockSize, DataType::Float(32));
+  EXPECT_EQ(first.size, 640);
+  auto second = allocator->Alloc(1280, CachingAllocator::kMinBlockSize, DataType::Float(32));
+  auto third = allocator->Alloc(64, CachingAllocator::kMinBlockSize, DataType::Float(32));
+  for (const auto& buff : {first, second, third}) {
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(buff.data) % CachingAllocator::kMinBlockSize, 0);
+  }
+  allocator->Free(first);
+  allocator->Free(second);
+  allocator->Free(third);
+  EXPECT_EQ(allocator->UsedMemory(), CachingAllocator::kSmallSegment);
+}
+
+TEST_F(TvmVMMemoryManagerTest, CachingFreeFromAnotherThread) {
+  Device dev = {kDLCPU, 0};
+  Allocator* allocator = MemoryManagerWrapper::GetOrCreateAllocator(dev, kCaching);
+  auto buff = allocator->Alloc(4096, 32, DataType::Float(32));
+  // the block goes to the cache of the other thread, flushed to the allocator when it exits
+  std::thread([&]() { allocator->Free(buff); }).join();
+  auto again = allocator->Alloc(4096, 32, DataType::Float(32));
+  EXPECT_EQ(again.data, buff.data);
+  EXPECT_EQ(allocator->UsedMemory(), CachingAllocator::kSmallSegment);
+
+  // a block allocated by another thread is freed by this one
+  Buffer from_thread;
+  std::thread([&]() { from_thread = allocator->Alloc(4096, 32, DataType::Float(32)); }).join();
+  EXPECT_NE(from_thread.data, again.data);
+  allocator->Free(from_thread);
+  allocator->Free(again);
+  EXPECT_EQ(allocator->UsedMemory(), CachingAllocator::kSmallSegment);
+}
+
+TEST_F(TvmVMMemoryManagerTest, CachingThreadExitAfterAllocatorDestroyed) {
+  Device dev = {kDLCPU, 0};
+  Allocator* allocator = MemoryManagerWrapper::GetOrCreateAllocator(dev, kCaching);
+  std::mutex mu;
+  std::condition_variable cv;
+  bool freed = false, cleared = false;
+  std::thread worker([&]() {
+    auto buff = allocator->Alloc(4096, 32, DataType::Float(32));
+    allocator->Free(buff);
+    std::unique_lock<std::mutex> lock(mu);
+    freed = true;
+    cv.notify_all();
+    cv.wait(lock, [&]() { return cleared; });
+    // the cache of this thread still holds the block of the destroyed allocator, dropped on exit
+  });
+  {
+    std::unique_lock<std::mutex> lock(mu);
+    cv.wait(lock, [&]() { return freed; });
+  }
+  MemoryManagerWrapper::Global()->clear();
+  {
+    std::lock_guard<std::mutex> lock(mu);
+    cleared = true;
+  }
+  cv.notify_all();
+  worker.join();
+}
+
+TEST_F(TvmVMMemoryManagerTest, StreamOrderedAllocCUDA) {
+  bool enabled = tvm::runtime::RuntimeEnabled("cuda");
+  if (!enabled) {
+    LOG(INFO) << "Skip stream ordered alloc test because cuda runtime is disabled.\n";
+    return;
+  }
+  Device dev = {kDLCUDA, 0};
+  Device cpu = {kDLCPU, 0};
+  DeviceAPI* api = DeviceAPI::Get(dev);
+  TVMStreamHandle stream = api->CreateStream(dev);
+  api->SetStream(dev, stream);
+  Allocator* allocator = MemoryManagerWrapper::GetOrCreateAllocator(dev, kStreamOrdered);
+  EXPECT_EQ(allocator->UsedMemory(), 0);
+
+  int64_t n = 1024;
+  size_t nbytes = n * sizeof(float);
+  auto copy = [&](void* from, Device from_dev, void* to, Device to_dev) {
+    DLTensor src{from, from_dev, 1, DataType::Float(32), &n, nullptr, 0};
+    DLTensor dst{to, to_dev, 1, DataType::Float(32), &n, nullptr, 0};
+    api->CopyDataFromTo(&src, &dst, stream);
+  };
+  std::vector<float> ones(n, 1.0f), twos(n, 2.0f), result(n, 0.0f);
+
+  auto first = allocator->Alloc(nbytes, 64, DataType::Float(32));
+  EXPECT_EQ(first.stream, stream);
+  EXPECT_EQ(first.alloc_type, kStreamOrdered);
+  EXPECT_EQ(allocator->UsedMemory(), nbytes);
+  copy(ones.data(), cpu, first.data, dev);
+  allocator->Free(first);
+  EXPECT_EQ(allocator->UsedMemory(), 0);
+
+  // the block freed on the stream is reused by the next allocation on it without a sync, and the
+  // writes to it are ordered after the ones to the freed block
+  auto second = allocator->Alloc(nbytes, 64, DataType::Float(32));
+  EXPECT_EQ(second.data, first.data);
+  EXPECT_EQ(allocator->UsedMemory(), nbytes);
+  copy(twos.data(), cpu, second.data, dev);
+  copy(second.data, dev, result.data(), cpu);
+  api->StreamSync(dev, stream);
+  EXPECT_EQ(result, twos);
+  allocator->Free(second);
+  EXPECT_EQ(allocator->UsedMemory(), 0);
+
+  api->StreamSync(dev, stream);
+  api->SetStream(dev, nullptr);
+  api->FreeStream(dev, stream);
+}
+
 }  // namespace memory
 }  // namespace runtime
 }  // namespace tvm
@@ -0,0 +1,128 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <gtest/gtest.h>
+#include <tvm/runtime/memory.h>
+
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace tvm {
+namespace runtime {
+namespace {
+
+// Each test uses its own size class, the pools of the main thread outlive the tests.
+size_t SizeClass(size_t size) { return (size - 1) / PoolObjAllocator::kGranularity; }
+
+TEST(PoolObjAllocator, Reuse) {
+  void* first = PoolObjAllocator::Allocate(48);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(first) % PoolObjAllocator::kGranularity, 0u);
+  // rounded up to the same size class
+  void* second = PoolObjAllocator::Allocate(33);
+  EXPECT_NE(first, second);
+  PoolObjAllocator::Free(second, 33);
+  EXPECT_EQ(PoolObjAllocator::Allocate(48), second);
+  PoolObjAllocator::Free(second, 48);
+  PoolObjAllocator::Free(first, 48);
+}
+
+TEST(PoolObjAllocator, FreeFromAnotherThread) {
+  constexpr size_t kSize = 112;
+  // more than the free bytes a thread keeps, the excess goes to the depot
+  size_t num_slots = 8 * PoolObjAllocator::kPageBytes / kSize;
+  std::vector<void*> slots;
+  std::thread([&]() {
+    for (size_t i = 0; i < num_slots; ++i) slots.push_back(PoolObjAllocator::Allocate(kSize));
+  }).join();
+  for (void* slot : slots) PoolObjAllocator::Free(slot, kSize);
+  // the slots allocated by the exited thread are reused by the others
+  std::set<void*> freed(slots.begin(), slots.end());
+  void* reused = PoolObjAllocator::Allocate(kSize);
+  EXPECT_TRUE(freed.count(reused));
+  PoolObjAllocator::Free(reused, kSize);
+  // and the excess is refilled from the depot by a new thread
+  std::thread([&]() { reused = PoolObjAllocator::Allocate(kSize); }).join();
+  EXPECT_TRUE(freed.count(reused));
+  PoolObjAllocator::Free(reused, kSize);
+}
+
+TEST(PoolObjAllocator, ThreadExit) {
+  constexpr size_t kSize = 240;
+  void* freed = nullptr;
+  std::thread([&]() {
+    freed = PoolObjAllocator::Allocate(kSize);
+    PoolObjAllocator::Free(freed, kSize);
+  }).join();
+  // the free list of the exited thread moved to the depot, the next thread refills from it
+  void* reused = nullptr;
+  std::thread([&]() {
+    reused = PoolObjAllocator::Allocate(kSize);
+    PoolObjAllocator::Free(reused, kSize);
+  }).join();
+  EXPECT_EQ(reused, freed);
+}
+
+/*! \brief Frees its slot when the thread exits, after the pool of the thread is destroyed. */
+struct FreeAtExit {
+  void* slot{nullptr};
+  size_t size{0};
+  ~FreeAtExit() {
+    if (slot != nullptr) PoolObjAllocator::Free(slot, size);
+  }
+};
+
+TEST(PoolObjAllocator, FreeAfterPoolDestroyed) {
+  constexpr size_t kSize = 176;
+  size_t size_class = SizeClass(kSize);
+  int64_t frees = PoolObjAllocator::Stats().num_frees[size_class];
+  std::thread([&]() {
+    // constructed first, so destroyed after the pool of the thread
+    static thread_local FreeAtExit at_exit;
+    at_exit.size = kSize;
+    at_exit.slot = PoolObjAllocator::Allocate(kSize);
+  }).join();
+  EXPECT_EQ(PoolObjAllocator::Stats().num_frees[size_class], frees + 1);
+}
+
+TEST(PoolObjAllocator, Stats) {
+  constexpr size_t kSize = 208;
+  constexpr int kNumAllocs = 10;
+  size_t size_class = SizeClass(kSize);
+  PoolObjAllocatorStats before = PoolObjAllocator::Stats();
+  ASSERT_EQ(before.slot_bytes.size(), PoolObjAllocator::kMaxSize / PoolObjAllocator::kGranularity);
+  for (size_t i = 0; i < before.slot_bytes.size(); ++i) {
+    EXPECT_EQ(before.slot_bytes[i], static_cast<int64_t>((i + 1) * PoolObjAllocator::kGranularity));
+  }
+  std::thread([&]() {
+    std::vector<void*> slots;
+    for (int i = 0; i < kNumAllocs; ++i) slots.push_back(PoolObjAllocator::Allocate(kSize));
+    for (void* slot : slots) PoolObjAllocator::Free(slot, kSize);
+  }).join();
+  // the counts of a thread are flushed when it exits
+  PoolObjAllocatorStats after = PoolObjAllocator::Stats();
+  EXPECT_EQ(after.num_allocs[size_class] - before.num_allocs[size_class], kNumAllocs);
+  EXPECT_EQ(after.num_frees[size_class] - before.num_frees[size_class], kNumAllocs);
+  EXPECT_GE(after.reserved_bytes, before.reserved_bytes);
+  EXPECT_EQ(after.reserved_bytes % static_cast<int64_t>(PoolObjAllocator::kPageBytes), 0);
+}
+
+}  // namespace
+}  // namespace runtime
+}  // namespace tvm
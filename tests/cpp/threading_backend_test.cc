@@ -20,14 +20,18 @@
 #include <dmlc/logging.h>
 #include <gtest/gtest.h>
 #include <tvm/runtime/c_backend_api.h>
+#include <tvm/runtime/registry.h>
 #include <tvm/runtime/threading_backend.h>
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <memory>
 #include <sstream>
 #include <thread>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 constexpr size_t N = 128;
 void AtomicCompute(int task_id, size_t n, std::atomic<size_t>* acc, TVMParallelGroupEnv* penv) {
@@ -118,6 +122,47 @@ static FTVMParallelLambda affinity_check_task_id = [](int task_id, TVMParallelGr
   return 0;
 };
 
+// The runs of each task id of a launch, the ids of the first quarter being much longer
+struct TaskCounts {
+  static constexpr int kMaxTasks = 1 << 14;
+  std::vector<std::atomic<int>> counts = std::vector<std::atomic<int>>(kMaxTasks);
+  std::atomic<int> num_task{0};
+
+  void Reset() {
+    for (auto& count : counts) count.store(0, std::memory_order_relaxed);
+    num_task.store(0);
+  }
+};
+
+static FTVMParallelLambda count_uneven_task = [](int task_id, TVMParallelGroupEnv* penv,
+                                                 void* cdata) -> int {
+  auto* data = reinterpret_cast<TaskCounts*>(cdata);
+  data->num_task.store(penv->num_task);
+  if (task_id >= TaskCounts::kMaxTasks) return -1;
+  if (task_id < penv->num_task / 4) {
+    std::this_thread::sleep_for(std::chrono::microseconds(20));
+  }
+  data->counts[task_id].fetch_add(1);
+  return 0;
+};
+
+// A parallel launch from each task, summing 0..N-1 once per task of the outer launch
+static FTVMParallelLambda nested_launch = [](int task_id, TVMParallelGroupEnv* penv,
+                                             void* cdata) -> int {
+  auto* acc = reinterpret_cast<std::atomic<size_t>*>(cdata);
+  std::atomic<size_t> inner(0);
+  int ret = TVMBackendParallelLaunch(atomic_add_task_id, &inner, 0);
+  acc->fetch_add(inner.load(), std::memory_order_relaxed);
+  return ret;
+};
+
+static FTVMParallelLambda sleep_task = [](int task_id, TVMParallelGroupEnv* penv,
+                                          void* cdata) -> int {
+  reinterpret_cast<std::atomic<bool>*>(cdata)->store(true);
+  std::this_thread::sleep_for(std::chrono::milliseconds(2));
+  return 0;
+};
+
 TEST(ThreadingBackend, TVMBackendParallelLaunch) {
   std::atomic<size_t> acc(0);
   TVMBackendParallelLaunch(atomic_add_task_id, &acc, 0);
@@ -185,3 +230,113 @@ TEST(ThreadingBackend, TVMBackendAffinityConfigure) {
     t->join();
   }
 }
+
+TEST(ThreadingBackend, WorkStealingUnevenRanges) {
+  const auto* config = tvm::runtime::Registry::Get("runtime.config_threadpool_work_stealing");
+  ASSERT_NE(config, nullptr);
+  // the owners take their ranges from the front while the thieves take the long tasks of the
+  // first ranges from the back, each task must run exactly once whatever the interleaving
+  auto run = [config](std::vector<int> chunks_list, int num_launches) {
+    TaskCounts data;
+    for (int chunks : chunks_list) {
+      (*config)(chunks);
+      for (int i = 0; i < num_launches; ++i) {
+        data.Reset();
+        ASSERT_EQ(TVMBackendParallelLaunch(count_uneven_task, &data, 0), 0);
+        int num_task = data.num_task.load();
+        ASSERT_GT(num_task, 0);
+        for (int task_id = 0; task_id < num_task; ++task_id) {
+          ASSERT_EQ(data.counts[task_id].load(), 1) << "task " << task_id << " of " << num_task;
+        }
+      }
+    }
+    (*config)(0);
+  };
+  run({1, 3, 16}, 100);
+  // the pools of the concurrent callers steal within their own launches
+  std::vector<std::unique_ptr<std::thread>> ts;
+  for (int t = 0; t < 4; ++t) {
+    ts.emplace_back(new std::thread([&run, t]() { run({t + 2}, 50); }));
+  }
+  for (auto& t : ts) {
+    t->join();
+  }
+}
+
+TEST(ThreadingBackend, SharedArenaNestedAndConcurrent) {
+  if (tvm::runtime::threading::MaxConcurrency() <= 1) {
+    return;
+  }
+  const auto* config = tvm::runtime::Registry::Get("runtime.config_threadpool_shared_arena");
+  ASSERT_NE(config, nullptr);
+  (*config)(true);
+  constexpr int kNumOuter = 8;
+  // the concurrent callers launch flat and nested jobs on the same workers
+  std::vector<std::unique_ptr<std::thread>> ts;
+  for (int t = 0; t < 4; ++t) {
+    ts.emplace_back(new std::thread([]() {
+      for (int i = 0; i < 50; ++i) {
+        std::atomic<size_t> acc(0);
+        EXPECT_EQ(TVMBackendParallelLaunch(atomic_add_task_id, &acc, 0), 0);
+        EXPECT_EQ(acc.load(), N * (N - 1) / 2);
+        std::atomic<size_t> nested(0);
+        EXPECT_EQ(TVMBackendParallelLaunch(nested_launch, &nested, kNumOuter), 0);
+        EXPECT_EQ(nested.load(), kNumOuter * N * (N - 1) / 2);
+      }
+    }));
+  }
+  for (auto& t : ts) {
+    t->join();
+  }
+
+  // the workers take the active launches in turn, a long launch does not hold them all: the
+  // short launches started meanwhile complete before it
+  std::atomic<bool> long_started(false), long_done(false);
+  std::thread long_caller([&]() {
+    EXPECT_EQ(TVMBackendParallelLaunch(sleep_task, &long_started, 200), 0);
+    long_done.store(true);
+  });
+  while (!long_started.load()) std::this_thread::yield();
+  for (int i = 0; i < 20; ++i) {
+    std::atomic<size_t> acc(0);
+    EXPECT_EQ(TVMBackendParallelLaunch(atomic_add_task_id, &acc, 0), 0);
+    EXPECT_EQ(acc.load(), N * (N - 1) / 2);
+  }
+  EXPECT_FALSE(long_done.load());
+  long_caller.join();
+  (*config)(false);
+}
+
+TEST(ThreadingBackend, ParkAndWakeUnderLoad) {
+  // the threads hogging the cores delay the workers between their check of the epoch and their
+  // futex wait, the window the wake of the next launch must not be lost in
+  std::atomic<bool> stop(false);
+  std::vector<std::thread> load;
+  for (unsigned i = 0; i < std::max(std::thread::hardware_concurrency() / 2, 1u); ++i) {
+    load.emplace_back([&stop]() {
+      while (!stop.load(std::memory_order_relaxed)) {
+      }
+    });
+  }
+  // the gaps above 1ms make the workers park right away, the short ones keep them spinning, so
+  // the launches alternate between the parked and the spinning workers
+  std::vector<std::unique_ptr<std::thread>> ts;
+  for (int t = 0; t < 2; ++t) {
+    ts.emplace_back(new std::thread([t]() {
+      for (int i = 0; i < 200; ++i) {
+        std::atomic<size_t> acc(0);
+        EXPECT_EQ(TVMBackendParallelLaunch(atomic_add_task_id, &acc, 0), 0);
+        EXPECT_EQ(acc.load(), N * (N - 1) / 2);
+        int gap_us = (i + t) % 3 == 0 ? 0 : (i % 3 == 1 ? 50 : 1500);
+        if (gap_us != 0) std::this_thread::sleep_for(std::chrono::microseconds(gap_us));
+      }
+    }));
+  }
+  for (auto& t : ts) {
+    t->join();
+  }
+  stop.store(true);
+  for (auto& t : load) {
+    t.join();
+  }
+}
@@ -0,0 +1,109 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Benchmarks the MVE (Helium) micro kernels of the int8 conv2d, depthwise_conv2d and dense
+schedules against the v7e-m DSP ones, on the boards with MVE (e.g. Cortex-M55)."""
+
+import logging
+
+import numpy as np
+import pytest
+
+import tvm
+import tvm.testing
+import tvm.micro.testing
+from tvm import relay
+
+RUNS_PER_SAMPLE = 20
+
+
+def _get_int8_model():
+    """A small int8 NHWC network whose operators are scheduled by the DSP strategies."""
+    data = relay.var("data", relay.TensorType((1, 24, 24, 16), "int8"))
+    rng = np.random.default_rng(0)
+
+    def _const(shape):
+        return relay.const(rng.integers(-10, 10, size=shape, dtype="int8"))
+
+    conv = relay.nn.conv2d(
+        data,
+        _const((3, 3, 32, 16)),
+        padding=(1, 1),
+        channels=32,
+        kernel_size=(3, 3),
+        data_layout="NHWC",
+        kernel_layout="HWOI",
+        out_dtype="int32",
+    )
+    conv = relay.cast(relay.clip(relay.right_shift(conv, relay.const(8)), -128, 127), "int8")
+    depthwise = relay.nn.conv2d(
+        conv,
+        _const((3, 3, 32, 1)),
+        padding=(1, 1),
+        groups=32,
+        channels=32,
+        kernel_size=(3, 3),
+        data_layout="NHWC",
+        kernel_layout="HWOI",
+        out_dtype="int32",
+    )
+    depthwise = relay.cast(
+        relay.clip(relay.right_shift(depthwise, relay.const(8)), -128, 127), "int8"
+    )
+    dense = relay.nn.dense(
+        relay.reshape(depthwise, (1, -1)), _const((16, 24 * 24 * 32)), out_dtype="int32"
+    )
+    mod = tvm.IRModule.from_expr(relay.Function([data], dense))
+    return relay.transform.InferType()(mod)
+
+
+def _run(platform, board, target, mod, build_dir, sample):
+    with tvm.micro.testing.create_aot_session(
+        platform, board, target, mod, {}, build_dir=build_dir
+    ) as session:
+        aot_executor = tvm.runtime.executor.aot_executor.AotModule(session.create_aot_executor())
+        aot_executor.get_input(0).copyfrom(sample)
+        result = aot_executor.module.time_evaluator("run", session.device, number=RUNS_PER_SAMPLE)()
+        return aot_executor.get_output(0).numpy(), result.mean
+
+
+@pytest.mark.requires_hardware
+@tvm.testing.requires_micro
+def test_mve_kernels_benchmark(platform, board, tmp_path):
+    target = tvm.micro.testing.get_target(platform, board)
+    if not target.features.has_mve:
+        pytest.skip(f"{board} has no MVE")
+    if "mattr" in target.attrs:
+        pytest.skip("the target already sets -mattr")
+    dsp_target = tvm.target.Target(f"{target} -mattr=+nomve")
+
+    mod = _get_int8_model()
+    sample = np.random.randint(low=-128, high=127, size=(1, 24, 24, 16), dtype=np.int8)
+    mve_output, mve_runtime = _run(platform, board, target, mod, tmp_path / "mve", sample)
+    dsp_output, dsp_runtime = _run(platform, board, dsp_target, mod, tmp_path / "dsp", sample)
+
+    logging.info(
+        "MVE: %.3f ms, DSP: %.3f ms, speedup %.2fx",
+        mve_runtime * 1e3,
+        dsp_runtime * 1e3,
+        dsp_runtime / mve_runtime,
+    )
+    np.testing.assert_array_equal(mve_output, dsp_output)
+    assert mve_runtime < dsp_runtime
+
+
+if __name__ == "__main__":
+    tvm.testing.main()
@@ -65,7 +65,55 @@ def test_dtype():
     assert dtype.type_code == tvm.DataTypeCode.HANDLE
 
 
+
+# more than the 4 pinned staging buffers of 4 MiB, with a partial last chunk
+_STAGED_ELEMS = (5 << 20) + 123
+
+
+@tvm.testing.requires_cuda
+def test_copy_async_staged():
+    dev = tvm.cuda(0)
+    copy_async = tvm.get_global_func("runtime.TVMArrayCopyFromToAsync")
+    wait = tvm.get_global_func("runtime.CopyEventWait")
+    expected = np.random.uniform(size=_STAGED_ELEMS).astype("float32")
+    for explicit_stream in [False, True]:
+        src = tvm.nd.array(expected)
+        dst = tvm.nd.empty(expected.shape, "float32", dev)
+        stream = dev.create_raw_stream() if explicit_stream else None
+        event = copy_async(src, dst, stream)
+        # the source is staged on return, overwriting it does not change the copy
+        src.copyfrom(np.zeros_like(expected))
+        if explicit_stream:
+            dev.sync(stream)
+            dev.free_raw_stream(stream)
+        else:
+            wait(event)
+        np.testing.assert_equal(dst.numpy(), expected)
+
+
+@tvm.testing.requires_cuda
+def test_set_input_staged():
+    from tvm import relay
+    from tvm.contrib import graph_executor
+
+    dev = tvm.cuda(0)
+    x = relay.var("x", shape=(_STAGED_ELEMS,), dtype="float32")
+    func = relay.Function([x], x + relay.const(1.0))
+    lib = relay.build(tvm.IRModule.from_expr(func), target="cuda")
+    m = graph_executor.GraphModule(lib["default"](dev))
+    expected = np.random.uniform(size=_STAGED_ELEMS).astype("float32")
+    src = tvm.nd.array(expected)
+    # the packed set_input uploads the host array through the staging buffers
+    m.module["set_input"]("x", src)
+    src.copyfrom(np.zeros_like(expected))
+    m.run()
+    np.testing.assert_equal(m.get_input(0).numpy(), expected)
+    np.testing.assert_allclose(m.get_output(0).numpy(), expected + 1.0)
+
+
 if __name__ == "__main__":
     test_nd_create()
     test_fp16_conversion()
     test_dtype()
+    test_copy_async_staged()
+    test_set_input_staged()
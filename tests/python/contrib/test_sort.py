@@ -91,6 +91,90 @@ def test_sort_np():
     tvm.testing.assert_allclose(c.numpy(), np_out, rtol=1e-5)
 
 
+def test_sort_long_rows():
+    # The long rows are sorted by the radix sort on the thread pool and topk selects without a full
+    # sort, the ties must stay in index order.
+    dshape = (8, 3000)
+    k = 10
+    data = te.placeholder(dshape, name="data", dtype="int32")
+    out = te.extern(
+        dshape,
+        [data],
+        lambda ins, outs: tvm.tir.call_packed(
+            "tvm.contrib.sort.argsort", ins[0], outs[0], -1, False
+        ),
+        dtype="int32",
+        name="argsort_tensor",
+    )
+    values, indices = te.extern(
+        [(dshape[0], k), (dshape[0], k)],
+        [data],
+        lambda ins, outs: tvm.tir.call_packed(
+            "tvm.contrib.sort.topk", ins[0], outs[0], outs[1], k, -1, "both", False
+        ),
+        dtype=["int32", "int32"],
+        name="topk_tensor",
+    )
+
+    dev = tvm.cpu(0)
+    s = te.create_schedule([out.op, values.op])
+    f = tvm.build(s, [data, out, values, indices], "llvm")
+
+    np_data = np.random.randint(-50, 50, size=dshape).astype(data.dtype)
+    np_out = np.argsort(-np_data, axis=-1, kind="stable")
+    a = tvm.nd.array(np_data, dev)
+    b = tvm.nd.array(np.zeros(dshape, dtype=out.dtype), dev)
+    c = tvm.nd.array(np.zeros((dshape[0], k), dtype=values.dtype), dev)
+    d = tvm.nd.array(np.zeros((dshape[0], k), dtype=indices.dtype), dev)
+    f(a, b, c, d)
+    tvm.testing.assert_allclose(b.numpy(), np_out)
+    tvm.testing.assert_allclose(d.numpy(), np_out[:, :k])
+    tvm.testing.assert_allclose(c.numpy(), np.take_along_axis(np_data, np_out[:, :k], axis=-1))
+
+
+def test_sort_nan_and_signed_zeros():
+    # The NaNs sort last in both orders and -0.0 ties with 0.0 in index order, alike for the short
+    # rows sorted by stable_sort, the long ones sorted by the radix sort and the topk selection.
+    k = 10
+    for length in [16, 1000]:
+        for is_ascend in [True, False]:
+            dshape = (4, length)
+            data = te.placeholder(dshape, name="data", dtype="float32")
+            out = te.extern(
+                dshape,
+                [data],
+                lambda ins, outs: tvm.tir.call_packed(
+                    "tvm.contrib.sort.argsort", ins[0], outs[0], -1, is_ascend
+                ),
+                dtype="int32",
+                name="argsort_tensor",
+            )
+            indices = te.extern(
+                (dshape[0], k),
+                [data],
+                lambda ins, outs: tvm.tir.call_packed(
+                    "tvm.contrib.sort.topk", ins[0], outs[0], k, -1, "indices", is_ascend
+                ),
+                dtype="int32",
+                name="topk_tensor",
+            )
+            s = te.create_schedule([out.op, indices.op])
+            f = tvm.build(s, [data, out, indices], "llvm")
+
+            choices = np.array([np.nan, -np.nan, 0.0, -0.0, 1.0, -1.0, np.inf, -np.inf], "float32")
+            np_data = np.random.choice(choices, size=dshape).astype("float32")
+            np_data[:, :k] = np.nan
+            keys = np_data if is_ascend else -np_data
+            np_out = np.argsort(keys, axis=-1, kind="stable")
+
+            dev = tvm.cpu(0)
+            b = tvm.nd.array(np.zeros(dshape, dtype="int32"), dev)
+            c = tvm.nd.array(np.zeros((dshape[0], k), dtype="int32"), dev)
+            f(tvm.nd.array(np_data, dev), b, c)
+            np.testing.assert_equal(b.numpy(), np_out)
+            np.testing.assert_equal(c.numpy(), np_out[:, :k])
+
+
 def test_sort_by_key_gpu():
     size = 6
     keys = te.placeholder((size,), name="keys", dtype="int32")
@@ -126,4 +210,6 @@ def test_sort_by_key_gpu():
 if __name__ == "__main__":
     test_sort()
     test_sort_np()
+    test_sort_long_rows()
+    test_sort_nan_and_signed_zeros()
     test_sort_by_key_gpu()
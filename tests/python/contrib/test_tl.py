@@ -0,0 +1,128 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+import pytest
+
+import tvm
+import tvm.testing
+from tvm import relay
+from tvm.relay import transform
+from tvm.relay.op.contrib.tl import _dense_parallel_program, fuse_parallel_tl_dense, pattern_table
+
+
+def _composite_functions(mod):
+    functions = []
+
+    def visit(node):
+        if isinstance(node, relay.Function) and node.attrs and "Composite" in node.attrs:
+            functions.append(node)
+
+    relay.analysis.post_order_visit(mod["main"], visit)
+    return functions
+
+
+def _composites(mod):
+    return [str(func.attrs["Composite"]) for func in _composite_functions(mod)]
+
+
+def _merge_composite(func):
+    mod = tvm.IRModule.from_expr(func)
+    return tvm.transform.Sequential(
+        [transform.InferType(), transform.MergeComposite(pattern_table())]
+    )(mod)
+
+
+def _dense_fp8(M, N, K):
+    data = relay.var("data", shape=(M, K), dtype="e4m3_float8")
+    weight = relay.var("weight", shape=(N, K), dtype="e4m3_float8")
+    out = relay.nn.dense(data, weight, out_dtype="float32")
+    out = relay.cast(relay.multiply(out, relay.const(0.5, "float32")), "float16")
+    return relay.Function([data, weight], out)
+
+
+@pytest.mark.parametrize("arch, offloaded", [("sm_80", False), ("sm_89", True), ("sm_90", True)])
+def test_dense_fp8_arch(arch, offloaded):
+    with tvm.target.Target(f"cuda -arch={arch}"):
+        mod = _merge_composite(_dense_fp8(64, 64, 64))
+    assert ("tl.dense_fp8" in _composites(mod)) == offloaded
+
+
+def test_dense_fp8_not_cuda():
+    with tvm.target.Target("llvm"):
+        mod = _merge_composite(_dense_fp8(64, 64, 64))
+    assert "tl.dense_fp8" not in _composites(mod)
+
+
+def _qkv_dense(M, K, N):
+    """The q, k and v projections of the same input, the last one with a bias and relu."""
+    data = relay.var("data", shape=(M, K), dtype="float16")
+    weights = [relay.var(f"w{i}", shape=(N, K), dtype="float16") for i in range(3)]
+    bias = relay.var("bias", shape=(N,), dtype="float16")
+    outs = [relay.nn.dense(data, weight) for weight in weights]
+    outs[2] = relay.nn.relu(relay.nn.bias_add(outs[2], bias))
+    return relay.Function([data] + weights + [bias], relay.Tuple(outs))
+
+
+def _parallel_composite(M, K, N):
+    mod = fuse_parallel_tl_dense(_merge_composite(_qkv_dense(M, K, N)))
+    fused = [
+        func
+        for func in _composite_functions(mod)
+        if str(func.attrs["Composite"]) == "tl.dense_parallel"
+    ]
+    assert len(fused) == 1
+    return fused[0]
+
+
+def test_fuse_parallel_dense():
+    composite = _parallel_composite(256, 64, 128)
+    assert isinstance(composite.body, relay.Tuple)
+    slices = [str(field.op.attrs["Composite"]) for field in composite.body.fields]
+    assert slices == ["tl.dense", "tl.dense", "tl.dense_bias_relu"]
+    # the input, the three weights and the bias
+    assert len(composite.params) == 5
+
+
+def test_fuse_parallel_dense_min_num_branches():
+    mod = _merge_composite(_qkv_dense(256, 64, 128))
+    assert "tl.dense_parallel" not in _composites(fuse_parallel_tl_dense(mod, min_num_branches=4))
+
+
+def test_dense_parallel_program():
+    M, K, N = 256, 64, 128
+    func = _dense_parallel_program(_parallel_composite(M, K, N))
+    names = [func.buffer_map[param].name for param in func.params]
+    assert names == ["A", "B0", "B1", "B2", "Bias2", "C0", "C1", "C2"]
+    assert [int(dim) for dim in func.buffer_map[func.params[-1]].shape] == [M, N]
+
+    # the blocks along x are split between the slices by a chain of branches on bx
+    conditions = []
+    launches = {}
+
+    def visit(node):
+        if isinstance(node, tvm.tir.IfThenElse):
+            conditions.append(node.condition)
+        elif isinstance(node, tvm.tir.AttrStmt) and node.attr_key == "thread_extent":
+            launches[node.node.thread_tag] = int(node.value)
+
+    tvm.tir.stmt_functor.post_order_visit(func.body, visit)
+    assert sorted(int(cond.b) for cond in conditions) == [1, 2]
+    assert launches["blockIdx.x"] == 3 * N // 128
+    assert launches["blockIdx.y"] == M // 128
+
+
+if __name__ == "__main__":
+    tvm.testing.main()
@@ -0,0 +1,98 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+import numpy as np
+import tvm
+import tvm.testing
+from tvm import relay
+from tvm.relay import transform
+from utils.adreno_utils import build_run_compare, build_run_compare_vm
+
+
+executor_type = tvm.testing.parameter("ge", "vm")
+dtype = tvm.testing.parameter("float32", "float16")
+
+
+def _dense(M, K, N, dtype, constant_weight=True):
+    A = relay.var("data", shape=(M, K), dtype=dtype)
+    if constant_weight:
+        B = relay.const(np.random.uniform(-1, 1, (N, K)).astype(dtype))
+    else:
+        B = relay.var("weight", shape=(N, K), dtype=dtype)
+    out = relay.nn.dense(A, B)
+    return relay.Function(relay.analysis.free_vars(out), out)
+
+
+def _alter_layout(func, target):
+    mod = tvm.IRModule.from_expr(func)
+    with tvm.target.Target(target):
+        with tvm.transform.PassContext(opt_level=3):
+            mod = transform.InferType()(mod)
+            return transform.AlterOpLayout()(mod)
+
+
+def _ops(mod):
+    calls = []
+
+    def visit(node):
+        if isinstance(node, relay.Call) and isinstance(node.op, tvm.ir.Op):
+            calls.append(node)
+
+    relay.analysis.post_order_visit(mod["main"], visit)
+    return calls
+
+
+def test_dense_alter_layout(dtype):
+    """The dense of a constant weight becomes a 1x1 conv2d in the NHWC4c / HWIO4o layouts"""
+    mod = _alter_layout(_dense(64, 32, 48, dtype), "opencl -device=adreno")
+    convs = [call for call in _ops(mod) if call.op.name == "nn.conv2d"]
+    assert len(convs) == 1 and not [call for call in _ops(mod) if call.op.name == "nn.dense"]
+    assert convs[0].attrs.data_layout == "NHWC4c"
+    assert convs[0].attrs.kernel_layout == "HWIO4o"
+    assert [int(dim) for dim in convs[0].checked_type.shape] == [1, 16, 4, 12, 4]
+    assert [int(dim) for dim in mod["main"].body.checked_type.shape] == [64, 48]
+
+
+def test_dense_alter_layout_unsupported(dtype):
+    """The dense of a weight param, or of the shapes the image2d conv2d does not tile, is kept"""
+    for func in (_dense(64, 32, 48, dtype, constant_weight=False), _dense(40, 32, 48, dtype)):
+        mod = _alter_layout(func, "opencl -device=adreno")
+        assert [call.op.name for call in _ops(mod)] == ["nn.dense"]
+    # Only on Adreno
+    mod = _alter_layout(_dense(64, 32, 48, dtype), "opencl")
+    assert [call.op.name for call in _ops(mod)] == ["nn.dense"]
+
+
+@tvm.testing.requires_opencl
+@tvm.testing.parametrize_targets("opencl -device=adreno")
+def test_dense_texture(remote, target, executor_type, dtype):
+    input_shape = (128, 64)
+    weight_shape = (96, 64)
+    A = relay.var("data", shape=input_shape, dtype=dtype)
+    B = relay.var("weight", shape=weight_shape, dtype=dtype)
+    mod = relay.Function([A, B], relay.nn.dense(A, B))
+    np.random.seed(1)
+    params1 = {"weight": tvm.nd.array(np.random.uniform(-1, 1, weight_shape).astype(dtype))}
+
+    if executor_type == "ge":
+        build_run_compare(remote, mod, params1, {"data": input_shape}, {"data": dtype}, target)
+    else:
+        build_run_compare_vm(remote, mod, params1, {"data": input_shape}, {"data": dtype}, target)
+
+
+if __name__ == "__main__":
+    tvm.testing.main()
@@ -26,7 +26,7 @@ from tvm.micro.testing.aot_test_utils import (
 
 class BasicDenseTests:
     @tvm.testing.requires_corstone300
-    def test_dense(self, shape, weight_shape, dtype, schedule_name, enable_bias):
+    def test_dense(self, shape, weight_shape, dtype, schedule_name, enable_bias, mcpu):
         """Test a subgraph with a single dense operator."""
         ishape = shape
         wshape = weight_shape
@@ -62,7 +62,7 @@ class BasicDenseTests:
             use_unpacked_api=True,
             target_opts={
                 "-keys": "arm_cpu",
-                "-mcpu": "cortex-m7",
+                "-mcpu": mcpu,
             },
             schedule_name=schedule_name,
         )
@@ -82,6 +82,13 @@ class TestDense(BasicDenseTests):
     dtype = tvm.testing.parameter("int8", "int16")
     schedule_name = tvm.testing.parameter("dense_dsp.arm_cpu")
     enable_bias = tvm.testing.parameter(False, True)
+    mcpu = tvm.testing.parameter("cortex-m7")
+
+
+class TestDenseMVE(TestDense):
+    """This test is for the MVE (Helium) micro kernels of the dense_dsp schedule."""
+
+    mcpu = tvm.testing.parameter("cortex-m55")
 
 
 if __name__ == "__main__":
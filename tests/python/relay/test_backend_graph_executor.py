@@ -184,6 +184,43 @@ def test_plan_memory():
     )
 
 
+def test_reorder_for_memory():
+    # the post-order keeps exp(x) alive while exp(y) is computed and reduced to an index
+    x = relay.var("x", shape=(1024,))
+    y = relay.var("y", shape=(512,))
+    index = relay.argmax(relay.exp(y))
+    func = relay.Function([x, y], relay.take(relay.exp(x), index))
+    mod = relay.transform.InferType()(tvm.IRModule.from_expr(func))
+    func = mod["main"]
+
+    f_reorder = tvm.get_global_func("relay.backend.ReorderForMemory")
+    f_peak = tvm.get_global_func("relay.backend.EstimatePeakActivationBytes")
+    reordered = f_reorder(func)
+    assert isinstance(reordered.body, relay.Let)
+    assert reordered.body.value.args[0].same_as(func.params[1])
+    # exp(x) is only computed after exp(y) is freed, next to the 4 B index
+    assert f_peak(reordered) == 4096 + 4 + 4
+
+    with tvm.transform.PassContext(config={"relay.backend.reorder_for_memory": True}):
+        lib = relay.build(mod, target="llvm")
+    x_data = np.random.uniform(size=(1024,)).astype("float32")
+    y_data = np.random.uniform(size=(512,)).astype("float32")
+    exe = graph_executor.GraphModule(lib["default"](tvm.cpu()))
+    exe.run(x=x_data, y=y_data)
+    expected = np.exp(x_data)[np.argmax(y_data)]
+    tvm.testing.assert_allclose(exe.get_output(0).numpy(), expected, rtol=1e-5)
+
+
+def test_reorder_for_memory_keeps_post_order():
+    # the post-order frees exp(x) before exp(y) is computed, there is nothing to gain
+    x = relay.var("x", shape=(1024,))
+    y = relay.var("y", shape=(512,))
+    func = relay.Function([x, y], relay.add(relay.sum(relay.exp(x)), relay.sum(relay.exp(y))))
+    func = relay.transform.InferType()(tvm.IRModule.from_expr(func))["main"]
+    f_reorder = tvm.get_global_func("relay.backend.ReorderForMemory")
+    assert f_reorder(func).same_as(func)
+
+
 def test_plan_2d_memory():
     """Verification if GraphPlanMemory manages 2d memory reffered as
     global.texture* memory scopes in json file."""
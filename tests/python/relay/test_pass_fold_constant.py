@@ -554,6 +554,54 @@ def test_fold_requantize():
     tvm.ir.assert_structural_equal(a, b)
 
 
+def test_fold_subgraphs():
+    """The chains of foldable calls are folded as a whole, all of them by one evaluation."""
+    w_data = [np.random.uniform(size=(4, 6)).astype("float32") for _ in range(3)]
+    t = relay.TensorType([6, 4], "float32")
+
+    def before():
+        x = relay.var("x", t)
+        y = x
+        for i, data in enumerate(w_data):
+            w = relay.transpose(relay.reshape(relay.const(data), (4, 6)))
+            w = relay.multiply(w, relay.const(2.0, "float32"))
+            y = relay.add(y, w)
+            if i == 0:
+                # a foldable call also used by a call of non-constant arguments
+                y = relay.subtract(y, relay.negative(w))
+        return relay.Function([x], y)
+
+    def expected():
+        x = relay.var("x", t)
+        y = x
+        for i, data in enumerate(w_data):
+            y = relay.add(y, relay.const(data.T * 2))
+            if i == 0:
+                y = relay.subtract(y, relay.const(-data.T * 2))
+        return relay.Function([x], y)
+
+    zexpected = run_opt_pass(expected(), transform.InferType())
+    transform.ClearFoldConstantCache()
+    for cache_bytes in [0, 1 << 20]:
+        with tvm.transform.PassContext(config={"relay.FoldConstant.cache_bytes": cache_bytes}):
+            for _ in range(2):
+                zz = run_opt_pass(before(), transform.FoldConstant())
+                tvm.ir.assert_structural_equal(zz, zexpected)
+        # the cache is off by default and with 0 bytes
+        assert (transform.FoldConstantCacheBytes() > 0) == (cache_bytes > 0)
+
+    # a pass run with fewer bytes evicts down to them
+    with tvm.transform.PassContext(config={"relay.FoldConstant.cache_bytes": 1}):
+        run_opt_pass(before(), transform.FoldConstant())
+    assert transform.FoldConstantCacheBytes() == 0
+
+    with tvm.transform.PassContext(config={"relay.FoldConstant.cache_bytes": 1 << 20}):
+        run_opt_pass(before(), transform.FoldConstant())
+    assert transform.FoldConstantCacheBytes() > 0
+    transform.ClearFoldConstantCache()
+    assert transform.FoldConstantCacheBytes() == 0
+
+
 def test_pass_link_params():
     """
     This test checks ensures that proper executor is passed to interpreter instance
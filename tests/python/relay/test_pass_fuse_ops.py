@@ -944,5 +944,58 @@ def test_fuse_max_num_args(target_name, shape_type):
     assert tvm.ir.structural_equal(fused, expected)
 
 
+def _attention(q, k, v):
+    scores = relay.nn.batch_matmul(q, k, transpose_b=True)
+    probs = relay.nn.softmax(relay.multiply(scores, relay.const(0.125, "float16")))
+    return relay.nn.batch_matmul(probs, v, transpose_b=False)
+
+
+def _outlined_attention_symbols(func, compiler):
+    with tvm.transform.PassContext(
+        opt_level=2, config={"relay.FuseOps.attention_compiler": compiler}
+    ):
+        fused = run_opt_pass(func, transform.FuseOps())
+    symbols = []
+
+    def visit(node):
+        if isinstance(node, relay.Function) and node.attrs and "Compiler" in node.attrs:
+            symbols.append(str(node.attrs["global_symbol"]))
+
+    relay.analysis.post_order_visit(fused, visit)
+    return sorted(symbols)
+
+
+def test_outline_attention():
+    """Each attention of the function is outlined to its own symbol"""
+    checked = []
+
+    @tvm.register_func("relay.ext.test_fuse_attention.check_attention", override=True)
+    def check_attention(call):
+        checked.append(call)
+        return True
+
+    q, k, v = (relay.var(name, shape=(4, 64, 64), dtype="float16") for name in "qkv")
+    out = _attention(_attention(q, k, v), k, v)
+    symbols = _outlined_attention_symbols(relay.Function([q, k, v], out), "test_fuse_attention")
+    assert symbols == [
+        "tvmgen_test_fuse_attention_main_attention_0",
+        "tvmgen_test_fuse_attention_main_attention_1",
+    ]
+    assert len(checked) == 2
+
+
+def test_outline_attention_rejected():
+    """Nothing is outlined without the check_attention of the compiler, or if it rejects it"""
+
+    @tvm.register_func("relay.ext.test_fuse_attention_reject.check_attention", override=True)
+    def check_attention(call):
+        return False
+
+    q, k, v = (relay.var(name, shape=(4, 64, 64), dtype="float16") for name in "qkv")
+    func = relay.Function([q, k, v], _attention(q, k, v))
+    assert _outlined_attention_symbols(func, "test_fuse_attention_reject") == []
+    assert _outlined_attention_symbols(func, "test_fuse_attention_unregistered") == []
+
+
 if __name__ == "__main__":
     tvm.testing.main()
@@ -623,5 +623,62 @@ def test_pipeline():
             reset_cpu_affinity(affinity)
 
 
+def test_pipeline_micro_batching():
+    if not pipeline_executor_build.pipeline_executor_build_enabled():
+        return
+    num_requests = 4
+    # The second stage coalesces two requests of shape (1, 3) into one run.
+    data = relay.var("data_0", relay.TensorType((1, 3), "float32"))
+    mod1 = tvm.IRModule.from_expr(relay.Function([data], relay.add(data, relay.const(1.0))))
+    data = relay.var("data_0", relay.TensorType((2, 3), "float32"))
+    mod2 = tvm.IRModule.from_expr(relay.Function([data], relay.multiply(data, relay.const(2.0))))
+
+    pipe_config = pipeline_executor_build.PipelineConfig()
+    pipe_config["input"]["data_a"].connect(pipe_config[mod1]["input"]["data_0"])
+    pipe_config[mod1]["output"][0].connect(pipe_config[mod2]["input"]["data_0"])
+    pipe_config[mod2]["output"][0].connect(pipe_config["output"]["0"])
+    for mod in [mod1, mod2]:
+        pipe_config[mod].target = "llvm"
+        pipe_config[mod].dev = tvm.cpu(0)
+    pipe_config[mod2].batch_size = 2
+    pipe_config[mod2].batch_timeout_us = 100000
+    pipe_config[mod2].queue_capacity = 2
+    mconfig = pipe_config.get_config()["module_connection"]
+    assert "batch_size" not in mconfig[mod1]["pipeline"]
+    assert mconfig[mod2]["pipeline"]["batch_size"] == 2
+    assert mconfig[mod2]["pipeline"]["queue_capacity"] == 2
+
+    with tvm.transform.PassContext(opt_level=3):
+        pipeline_mod_factory = pipeline_executor_build.build(pipe_config)
+    pipeline_module = pipeline_executor.PipelineModule(pipeline_mod_factory)
+    datas = [np.full((1, 3), i, "float32") for i in range(num_requests)]
+    for data in datas:
+        pipeline_module.set_input("data_a", tvm.nd.array(data))
+        pipeline_module.run()
+
+    # Each request of a batch is forwarded as its own output, in order.
+    for data in datas:
+        outputs = pipeline_module.get_output()
+        for _ in range(50):
+            if outputs:
+                break
+            time.sleep(0.1)
+            outputs = pipeline_module.get_output()
+        assert len(outputs) == 1
+        tvm.testing.assert_allclose(outputs[0].numpy(), (data + 1) * 2)
+
+    statistics = pipeline_module.get_statistics()
+    assert len(statistics) == 2
+    assert statistics[0]["batch_size"] == 1
+    assert statistics[0]["requests"] == num_requests
+    stage = statistics[1]
+    assert stage["batch_size"] == 2
+    assert stage["requests"] == num_requests
+    assert num_requests // 2 <= stage["runs"] <= num_requests
+    assert stage["average_batch"] == pytest.approx(num_requests / stage["runs"])
+    assert stage["queued"] == 0
+    assert 0 <= stage["utilization"] <= 1
+
+
 if __name__ == "__main__":
     tvm.testing.main()
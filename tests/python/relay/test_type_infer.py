@@ -590,5 +590,34 @@ def test_argreduce_infer_return_type():
         )
 
 
+def test_infer_type_incremental():
+    x = relay.var("x", shape=(2, 3))
+    mod = tvm.IRModule()
+    f = relay.GlobalVar("f")
+    g = relay.GlobalVar("g")
+    mod[f] = relay.Function([x], relay.nn.relu(x))
+    y = relay.var("y", shape=(2, 3))
+    mod[g] = relay.Function([y], relay.exp(y))
+    z = relay.var("z", shape=(2, 3))
+    mod["main"] = relay.Function([z], f(z))
+    mod = transform.InferType()(mod)
+
+    # only the rewritten function and its caller are typed again
+    w = relay.var("w", shape=(2, 3))
+    mod[f] = relay.Function([w], relay.sum(w, axis=1))
+    typed_g, typed_main = mod[g], mod["main"]
+    new_mod = transform.InferTypeIncremental()(mod)
+    assert new_mod[g].same_as(typed_g)
+    assert not new_mod["main"].same_as(typed_main)
+    assert new_mod["main"].body.checked_type == relay.TensorType((2,), "float32")
+    expected = transform.InferType()(mod)
+    tvm.ir.assert_structural_equal(new_mod, expected, map_free_vars=True)
+
+    # a typed module is unchanged
+    typed_funcs = {gv: new_mod[gv] for gv in new_mod.get_global_vars()}
+    typed_mod = transform.InferTypeIncremental()(new_mod)
+    assert all(typed_mod[gv].same_as(func) for gv, func in typed_funcs.items())
+
+
 if __name__ == "__main__":
     tvm.testing.main()
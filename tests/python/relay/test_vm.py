@@ -16,6 +16,7 @@
 # under the License.
 import numpy as np
 import pytest
+import re
 import time
 from unittest.mock import patch
 
@@ -1341,6 +1342,9 @@ def test_multi_targets():
             mod, target={"cpu": tvm.target.Target("llvm"), "cuda": tvm.target.Target("cuda")}
         )
 
+    # the values crossing the devices are copied by the device_copy instructions
+    assert "device_copy" in exe.bytecode
+
     # Run
     vm = runtime.vm.VirtualMachine(exe, [tvm.cuda(), tvm.cpu()])
     x_data = np.random.rand(
@@ -1563,5 +1567,184 @@ def test_load_late_bound_consts_via_map_with_no_late_bound_consts():
     tvm.testing.assert_allclose(expected, actual.numpy())
 
 
+def test_shape_buckets():
+    # a position-wise layer over a dynamic sequence length, masked, with a tuple output
+    x = relay.var("x", shape=(1, relay.Any(), 8), dtype="float32")
+    mask = relay.var("mask", shape=(1, relay.Any()), dtype="float32")
+    w = relay.var("w", shape=(16, 8), dtype="float32")
+    y = relay.nn.dense(relay.reshape(x, (-1, 8)), w)
+    y = relay.reshape(y, (1, -1, 16)) * relay.expand_dims(mask, 2)
+    total = relay.sum(y)
+    mod = IRModule.from_expr(relay.Function([x, mask, w], relay.Tuple([y, total])))
+    w_np = np.random.uniform(size=(16, 8)).astype("float32")
+
+    buckets = vm.ShapeBuckets({"x": 1, "mask": 1}, buckets=[8, 16, 32], out_axes=[1, None])
+    exe = relay.vm.compile(mod, "llvm", params={"w": w_np}, shape_buckets=buckets)
+    for name in ["main__bucket8", "main__bucket16", "main__bucket32", "main__generic"]:
+        assert name in exe.bytecode
+    vm_exec = runtime.vm.VirtualMachine(exe, tvm.cpu())
+    for length in [5, 16, 40]:
+        x_np = np.random.uniform(size=(1, length, 8)).astype("float32")
+        mask_np = np.ones((1, length), "float32")
+        y_out, total_out = vm_exec.invoke("main", x_np, mask_np)
+        y_ref = np.matmul(x_np, w_np.T)
+        tvm.testing.assert_allclose(y_out.numpy(), y_ref, rtol=1e-5)
+        tvm.testing.assert_allclose(total_out.numpy(), y_ref.sum(), rtol=1e-4)
+
+
+def _batch_scheduler(**kwargs):
+    x = relay.var("x", shape=(relay.Any(), 8), dtype="float32")
+    mod = IRModule.from_expr(relay.Function([x], x + relay.const(1.0)))
+    exe = relay.vm.compile(mod, "llvm")
+    return runtime.vm.BatchScheduler(runtime.vm.VirtualMachine(exe, tvm.cpu()), **kwargs)
+
+
+def test_batch_scheduler():
+    sched = _batch_scheduler(max_batch_size=4)
+    inputs = [np.random.uniform(size=(rows, 8)).astype("float32") for rows in [1, 2, 3]]
+    ids = [sched.submit(x_np, num_steps=2) for x_np in inputs]
+    sched.run_until_done()
+    for request, x_np in zip(ids, inputs):
+        tvm.testing.assert_allclose(sched.poll(request)[0].numpy(), x_np + 2)
+    # (1, 2) then (3) for each of the 2 steps
+    assert sched.get_statistics()["batches"] == 4
+
+
+def test_batch_scheduler_error():
+    sched = _batch_scheduler()
+    x_np = np.ones((2, 8), "float32")
+    good = sched.submit(x_np)
+    # a rank the function does not accept fails its own batch only
+    bad = sched.submit(np.ones((2, 3, 8), "float32"))
+    sched.run_until_done()
+    tvm.testing.assert_allclose(sched.poll(good)[0].numpy(), x_np + 1)
+    with pytest.raises(tvm.TVMError):
+        sched.poll(bad)
+
+    sched.start()
+    bad = sched.submit(np.ones((2, 3, 8), "float32"))
+    with pytest.raises(tvm.TVMError):
+        sched.poll(bad, wait=True)
+    sched.stop()
+    assert sched.num_pending == 0
+
+
+def test_batch_scheduler_concurrent_steps():
+    import threading
+
+    sched = _batch_scheduler(max_batch_size=8)
+    sched.start()
+    inputs = [np.random.uniform(size=(1, 8)).astype("float32") for _ in range(32)]
+    stepping = True
+
+    def step():
+        while stepping:
+            sched.step()
+
+    threads = [threading.Thread(target=step) for _ in range(2)]
+    for thread in threads:
+        thread.start()
+    ids = [sched.submit(x_np, num_steps=3) for x_np in inputs]
+    outputs = [sched.poll(request, wait=True) for request in ids]
+    stepping = False
+    for thread in threads:
+        thread.join()
+    sched.stop()
+    for output, x_np in zip(outputs, inputs):
+        tvm.testing.assert_allclose(output[0].numpy(), x_np + 3)
+
+
+# the names of the opcodes of the VM, in the order of Opcode in bytecode.h
+_OPCODES = [
+    "Move",
+    "Ret",
+    "Invoke",
+    "InvokeClosure",
+    "InvokePacked",
+    "AllocTensor",
+    "AllocTensorReg",
+    "AllocADT",
+    "AllocClosure",
+    "GetField",
+    "If",
+    "LoadConst",
+    "Goto",
+    "GetTag",
+    "LoadConsti",
+    "Fatal",
+    "AllocStorage",
+    "ShapeOf",
+    "ReshapeTensor",
+    "DeviceCopy",
+    "KillRegister",
+]
+
+
+def _opcodes(exe):
+    """The opcodes of the instructions of an executable, the first field of its bytecode lines."""
+    return {int(m.group(1)) for m in re.finditer(r"^\s*\d+: (\d+) ", exe.bytecode, re.M)}
+
+
+@tvm.testing.requires_llvm
+def test_vm_dispatch_every_opcode():
+    """Run programs which together execute every instruction of the dispatch of RunLoop but
+    DeviceCopy, covered by test_multi_targets."""
+    dev = tvm.cpu()
+    opcodes = set()
+
+    def run(mod, *args):
+        with tvm.transform.PassContext(opt_level=3):
+            exe = relay.vm.compile(mod, "llvm")
+        opcodes.update(_opcodes(exe))
+        return runtime.vm.VirtualMachine(exe, dev).invoke("main", *args)
+
+    # the constructors, the matches, the calls of the global functions and a closure
+    mod = tvm.IRModule()
+    Prelude(mod)
+    _, cons, nil = mod.get_type("List")
+    x = relay.var("x", "int32")
+    y = relay.var("y", "int32")
+    items = cons(relay.const(1), cons(relay.const(2), cons(relay.const(3), nil())))
+    list_map = mod.get_global_var("map")
+    mod["main"] = relay.Function(
+        [y], mod.get_global_var("sum")(list_map(relay.Function([x], x + y), items))
+    )
+    tvm.testing.assert_allclose(run(mod, np.array(10, "int32")).numpy(), 36)
+
+    # the if and the recursion of a loop
+    mod = tvm.IRModule()
+    sum_up = relay.GlobalVar("sum_up")
+    i = relay.var("i", shape=[], dtype="int32")
+    sb = ScopeBuilder()
+    with sb.if_scope(relay.equal(i, relay.const(0, dtype="int32"))):
+        sb.ret(i)
+    with sb.else_scope():
+        sb.ret(relay.add(sum_up(relay.subtract(i, relay.const(1, dtype="int32"))), i))
+    mod[sum_up] = relay.Function([i], sb.get(), ret_type=relay.TensorType([], "int32"))
+    i = relay.var("i", shape=[], dtype="int32")
+    mod["main"] = relay.Function([i], sum_up(i))
+    tvm.testing.assert_allclose(run(mod, np.array(10, "int32")).numpy(), 55)
+
+    # the dynamic shapes, allocated from registers, and the reshapes
+    x_np = np.random.uniform(size=(8, 16)).astype("float32")
+    x = relay.var("x", shape=(relay.Any(), 16), dtype="float32")
+    shape = relay.var("shape", shape=(3,), dtype="int32")
+    z = relay.exp(relay.reshape(relay.reshape(x, [-1, 4]), shape))
+    mod = tvm.IRModule.from_expr(relay.Function([x, shape], z))
+    res = run(mod, x_np, np.array([8, 2, 8], "int32"))
+    tvm.testing.assert_allclose(res.numpy(), np.exp(x_np).reshape([8, 2, 8]), rtol=1e-5)
+
+    # an incomplete match
+    mod = tvm.IRModule()
+    Prelude(mod)
+    _, cons, nil = mod.get_type("List")
+    mod["main"] = relay.Function([], mod.get_global_var("tl")(nil()))
+    with pytest.raises(tvm.error.TVMError):
+        run(mod)
+
+    missing = [name for op, name in enumerate(_OPCODES) if op not in opcodes]
+    assert missing == ["DeviceCopy"], missing
+
+
 if __name__ == "__main__":
     tvm.testing.main()
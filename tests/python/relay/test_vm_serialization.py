@@ -145,6 +145,33 @@ def test_save_load():
     tvm.testing.assert_allclose(res.numpy(), x_data + x_data)
 
 
+def test_load_file():
+    x = relay.var("x", shape=(10, 10))
+    c0 = relay.const(np.random.rand(10, 10).astype("float32"))
+    c1 = relay.const(np.random.rand(10, 10).astype("float32"))
+    f = relay.Function([x], x * c0 + c1)
+    x_data = np.random.rand(10, 10).astype("float32")
+
+    exe = create_exec(f)
+    tmp = utils.tempdir()
+    path = tmp.relpath("exe.vm")
+    exe.mod.save(path)
+
+    # the constants are mapped from the file and deserialized on their first use
+    des_exec = _vm.Executable.load_exec_file(path, exe.lib)
+    des_vm = _vm.VirtualMachine(des_exec, tvm.cpu())
+    res = des_vm.run(x_data)
+    ref = x_data * c0.data.numpy() + c1.data.numpy()
+    tvm.testing.assert_allclose(res.numpy(), ref, rtol=1e-5)
+    assert des_exec.constants == exe.constants
+
+    # saving deserializes the constants left in the file
+    code, _ = des_exec.save()
+    des_exec = _vm.Executable.load_exec(code, exe.lib)
+    res = _vm.VirtualMachine(des_exec, tvm.cpu()).run(x_data)
+    tvm.testing.assert_allclose(res.numpy(), ref, rtol=1e-5)
+
+
 def test_const():
     c = relay.const(1.0, "float32")
     x = relay.var("x", shape=(10, 10), dtype="float32")
@@ -58,5 +58,38 @@ def test_layer_norm(target, dev, shape, axis, episilon=1e-5, dtype="float32", rt
     tvm.testing.assert_allclose(b_tvm.numpy(), b_np, rtol=rtol, atol=atol)
 
 
+@tvm.testing.parametrize_targets("llvm")
+@pytest.mark.parametrize("shape", [[4, 64], [2, 3, 100]])
+@pytest.mark.parametrize("scale,center", [(True, True), (False, False)])
+def test_layer_norm_simd(target, dev, shape, scale, center, epsilon=1e-5, dtype="float32"):
+    data = te.placeholder(shape, dtype=dtype, name="data")
+    gamma = te.placeholder(shape[-1:], dtype=dtype, name="gamma")
+    beta = te.placeholder(shape[-1:], dtype=dtype, name="beta")
+    B = topi.x86.layer_norm_simd(
+        data, gamma if scale else None, beta if center else None, [-1], epsilon
+    )
+
+    # an offset mean checks the precision of the Welford pass
+    data_np = np.random.uniform(100, 101, size=shape).astype(dtype)
+    gamma_np = np.random.uniform(size=shape[-1:]).astype(dtype)
+    beta_np = np.random.uniform(size=shape[-1:]).astype(dtype)
+    b_np = tvm.topi.testing.layer_norm_python(
+        data_np.astype("float64"),
+        gamma_np if scale else np.ones_like(gamma_np),
+        beta_np if center else np.zeros_like(beta_np),
+        (len(shape) - 1,),
+        epsilon,
+    )
+
+    with tvm.target.Target(target):
+        s = topi.x86.schedule_simd_row(B)
+    args = [data] + ([gamma] if scale else []) + ([beta] if center else []) + [B]
+    arrays = [data_np] + ([gamma_np] if scale else []) + ([beta_np] if center else [])
+    arrays = [tvm.nd.array(a, dev) for a in arrays]
+    b_tvm = tvm.nd.array(np.zeros(shape, dtype=dtype), dev)
+    tvm.build(s, args, target)(*arrays, b_tvm)
+    tvm.testing.assert_allclose(b_tvm.numpy(), b_np, rtol=1e-4, atol=1e-4)
+
+
 if __name__ == "__main__":
     tvm.testing.main()
@@ -106,5 +106,21 @@ def test_softmax(target, dev, shape, dtype, ref_data, softmax_operation, axis):
     tvm.testing.assert_allclose(b.numpy(), b_np, rtol=1e-5)
 
 
+@tvm.testing.parametrize_targets("llvm")
+@pytest.mark.parametrize("shape", [(4, 37), (2, 3, 64), (5,)])
+def test_softmax_simd(target, dev, shape, dtype):
+    A = te.placeholder(shape, dtype=dtype, name="A")
+    B = topi.x86.softmax_simd(A)
+    C = topi.add(B, tvm.tir.const(1, dtype))
+    with tvm.target.Target(target):
+        s = topi.x86.schedule_simd_row(C)
+    a_np = np.random.uniform(-4, 4, size=shape).astype(dtype)
+    b_np = tvm.topi.testing.softmax_python(a_np.reshape(-1, shape[-1])).reshape(shape) + 1
+    a = tvm.nd.array(a_np, dev)
+    c = tvm.nd.array(np.zeros(shape, dtype=dtype), dev)
+    tvm.build(s, [A, C], target)(a, c)
+    tvm.testing.assert_allclose(c.numpy(), b_np, rtol=1e-5)
+
+
 if __name__ == "__main__":
     tvm.testing.main()
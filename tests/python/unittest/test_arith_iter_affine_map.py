@@ -1348,5 +1348,31 @@ def test_detect_iter_map_with_bufferload_recursion():
     assert len(result.indices) == 0
 
 
+def test_iter_map_cache_scope():
+    x = tvm.tir.Var("x", "int32")
+    y = tvm.tir.Var("y", "int32")
+    n = tvm.tir.Var("n", "int32")
+    indices = [x, y // 2, y % 2]
+
+    def detect(dom):
+        res = tvm.arith.detect_iter_map(indices, var_dom(dom), check_level="bijective")
+        assert not res.errors
+        return res
+
+    fresh = detect([(x, 8), (y, 4)])
+    with tvm.arith.IterMapCacheScope():
+        first = detect([(x, 8), (y, 4)])
+        second = detect([(x, 8), (y, 4)])
+        # symbolic domains are not shared
+        detect([(x, n), (y, 4)])
+    tvm.ir.assert_structural_equal(first.indices, fresh.indices)
+    tvm.ir.assert_structural_equal(second.indices, fresh.indices)
+    # a cached result has its own marks
+    mark = first.indices[1].args[0].source
+    assert first.indices[2].args[0].source.same_as(mark)
+    assert not second.indices[1].args[0].source.same_as(mark)
+    assert second.indices[2].args[0].source.same_as(second.indices[1].args[0].source)
+
+
 if __name__ == "__main__":
     tvm.testing.main()
@@ -53,6 +53,31 @@ def test_simplify_symbolic_comparison():
     assert ana.can_prove((n + 31) // 32 * 32 >= i0 * 32 + i1, PS.SYMBOLIC_BOUND)
 
 
+def test_simplify_cache_kept_by_unchanged_binding():
+    ana = tvm.arith.Analyzer()
+    ana.enable_simplify_cache()
+    x, y = tir.Var("x", "int32"), tir.Var("y", "int32")
+    expr = (x + y) // 4 * 4 + (x + y) % 4
+
+    ana.bind(x, 8)
+    result = ana.simplify(expr)
+    size = ana.simplify_cache_stats["size"]
+    assert size > 0
+    # binding x to the same value keeps the results
+    ana.bind(x, 8)
+    hits = ana.simplify_cache_stats["hit"]
+    tvm.ir.assert_structural_equal(ana.simplify(expr), result)
+    assert ana.simplify_cache_stats["size"] == size
+    assert ana.simplify_cache_stats["hit"] > hits
+    # binding another var drops them, binding it again to the same range does not
+    ana.bind(y, tvm.ir.Range(0, 4))
+    assert ana.simplify_cache_stats["size"] == 0
+    ana.simplify(expr)
+    size = ana.simplify_cache_stats["size"]
+    ana.bind(y, tvm.ir.Range(0, 4))
+    assert ana.simplify_cache_stats["size"] == size > 0
+
+
 def test_regression_simplify_inf_recursion():
     ana = tvm.arith.Analyzer()
     cond = tir.Var("cond", "int32")
@@ -23,6 +23,7 @@
 import os
 import copy
 import numpy as np
+import pytest
 import tvm
 from tvm import te
 import tvm.relay.testing
@@ -31,7 +32,7 @@ from tvm import autotvm
 from tvm import relay
 from tvm.autotvm.task import ConfigEntity
 from tvm.autotvm.measure import MeasureResult, MeasureInput
-from tvm.autotvm.graph_tuner import DPTuner, PBQPTuner
+from tvm.autotvm.graph_tuner import DPTuner, PBQPTuner, plan_layouts
 
 
 def _create_args(dshape, kshape, strides, padding, dilation, layout, out_layout, dtype, out_dtype):
@@ -231,6 +232,56 @@ def test_graph_tuner_layout_transform_runner():
         )
 
 
+def test_graph_tuner_model_layout_transform():
+    log_file = "%s/test_tuner.log" % (os.getcwd())
+    target = "llvm"
+    dshape = (1, 3, 8, 8)
+    dtype = "float32"
+    layout = "NCHW"
+    conv2d = relay.op.get("nn.conv2d")
+    target_ops = [conv2d]
+
+    g, records, _, ltf_keys, _ = _create_data(target, dshape, dtype, layout)
+    executor = DPTuner(g, {"data": dshape}, records, target_ops, target=target, log_file=log_file)
+    bandwidth = 1e9
+    executor.model_layout_transform(bandwidth=bandwidth, overhead=0)
+    out = executor.layout_transform_perf_records
+    for ltf_workload in ltf_keys:
+        # the transforms read and write the 4 bytes of each element
+        expected_time = 2 * 4 * np.prod(ltf_workload[1][1]) / bandwidth
+        out_time = out[ltf_workload][1].costs[0]
+        assert np.isclose(expected_time, out_time), "Modeled time mismatch for %s" % str(
+            ltf_workload
+        )
+
+
+def test_plan_layouts():
+    log_file = "%s/test_tuner.log" % (os.getcwd())
+    target = "llvm"
+    dshape = (1, 3, 8, 8)
+    dtype = "float32"
+    layout = "NCHW"
+    conv2d = relay.op.get("nn.conv2d")
+    target_ops = [conv2d]
+
+    g, records, ltf_records, _, _ = _create_data(target, dshape, dtype, layout)
+    plan = plan_layouts(
+        g, {"data": dshape}, records, target, layout_records=ltf_records, log_file=log_file
+    )
+    assert isinstance(plan, autotvm.task.ApplyGraphBest)
+    executor = DPTuner(g, {"data": dshape}, records, target_ops, target=target, log_file=log_file)
+    executor.benchmark_layout_transform(layout_records=ltf_records, infer_layout=True)
+    executor.run()
+    expected_out = [record[0].config for record in executor.get_optimal_records()]
+    assert [record[0].config for record in plan._records] == expected_out
+
+    # the time of the layout transforms is modeled without layout records
+    plan = plan_layouts(g, {"data": dshape}, records, target, solver="pbqp", log_file=log_file)
+    assert len(plan._records) == 3
+    with pytest.raises(ValueError):
+        plan_layouts(g, {"data": dshape}, records, target, solver="greedy", log_file=log_file)
+
+
 def test_DPTuner_run():
     log_file = "%s/test_tuner.log" % (os.getcwd())
     target = "llvm"
@@ -778,6 +829,8 @@ def test_triangle_block():
 
 if __name__ == "__main__":
     test_graph_tuner_layout_transform()
+    test_graph_tuner_model_layout_transform()
+    test_plan_layouts()
     test_DPTuner_run()
     test_PBQPTuner_run()
     test_many_sub_graphs()
@@ -93,9 +93,11 @@ def _create_schedule(mod: IRModule, sch_fn: Callable[[Schedule], None]) -> Sched
     return sch
 
 
-def _create_tmp_database(tmpdir: str, mod_eq: str = "structural") -> ms.database.JSONDatabase:
-    path_workload = osp.join(tmpdir, "workloads.json")
-    path_tuning_record = osp.join(tmpdir, "tuning_records.json")
+def _create_tmp_database(
+    tmpdir: str, mod_eq: str = "structural", ext: str = ".json"
+) -> ms.database.JSONDatabase:
+    path_workload = osp.join(tmpdir, "workloads" + ext)
+    path_tuning_record = osp.join(tmpdir, "tuning_records" + ext)
     return ms.database.JSONDatabase(path_workload, path_tuning_record, module_equality=mod_eq)
 
 
@@ -368,10 +370,12 @@ def test_meta_schedule_database_sorting():
             _equal_record(ret[1], records[2])
 
 
-def test_meta_schedule_database_reload():
+# the tables of the paths ending with .bin are in the binary format of tvm.ir.save_binary
+@pytest.mark.parametrize("ext", [".json", ".bin"])
+def test_meta_schedule_database_reload(ext):
     mod: IRModule = Matmul
     with tempfile.TemporaryDirectory() as tmpdir:
-        database = _create_tmp_database(tmpdir)
+        database = _create_tmp_database(tmpdir, ext=ext)
         token = database.commit_workload(mod)
         trace = _create_schedule(mod, _schedule_matmul).trace
         records = [
@@ -584,6 +588,40 @@ def test_json_database_get_top_k(k, expected):
     assert result == expected
 
 
+@pytest.mark.parametrize(
+    "k,expected",
+    [
+        (0, []),
+        (4, [[0.0, 2.0], [2.0], [1.5, 4.5], [3.0, 1e10]]),
+        (5, [[0.0, 2.0], [2.0], [1.5, 4.5], [3.0, 1e10]]),
+    ],
+)
+def test_indexed_database_get_top_k(k, expected):
+    run_secs_list = [[1.5, 4.5], [], [0.0, 2.0], None, [2.0], [3.0, 1e10], [1e10]]
+    with tempfile.TemporaryDirectory() as tmpdir:
+        database = ms.database.IndexedDatabase(work_dir=tmpdir)
+        assert call_get_top_k(run_secs_list, database, k) == expected
+        # reopened, the records are read through the index
+        database = ms.database.IndexedDatabase(work_dir=tmpdir)
+        assert osp.exists(database.path_tuning_record + ".idx")
+        assert len(database) == len(run_secs_list)
+        result = call_get_top_k([], database, k)
+    assert result == expected
+
+
+def test_indexed_database_indexes_appended_records():
+    with tempfile.TemporaryDirectory() as tmpdir:
+        database = ms.database.IndexedDatabase(work_dir=tmpdir)
+        call_get_top_k([[3.0]], database, 1)
+        # the records appended to the same tables by another database after the index was written
+        call_get_top_k([[1.0], [2.0]], ms.database.JSONDatabase(work_dir=tmpdir), 1)
+        database = ms.database.IndexedDatabase(work_dir=tmpdir)
+        assert len(database) == 3
+        assert call_get_top_k([], database, 3) == [[1.0], [2.0], [3.0]]
+        # and the records committed since it was opened
+        assert call_get_top_k([[1.5]], database, 3) == [[1.0], [1.5], [2.0]]
+
+
 def MatmulFunc() -> IRModule:
     a = relay.var("a", relay.TensorType((1024, 1024), "float32"))
     b = relay.var("b", relay.TensorType((1024, 1024), "float32"))
@@ -206,6 +206,24 @@ def test_parallel_vectorize_add():
     assert_structural_equal_ignore_global_symbol(sch.mod["main"], after_postproc_add)
 
 
+def test_vectorize_part_of_long_inner_loop():
+    @T.prim_func
+    def before(A: T.Buffer((16, 1024), "float32"), B: T.Buffer((16, 1024), "float32")):
+        with T.block("root"):
+            T.block_attr({"meta_schedule.vectorize": 64})
+            for i, j in T.grid(16, 1024):
+                with T.block("add"):
+                    vi, vj = T.axis.remap("SS", [i, j])
+                    B[vi, vj] = A[vi, vj] + T.float32(1)
+
+    sch = Schedule(before)
+    assert RewriteParallelVectorizeUnroll().apply(sch)
+    loops = [sch.get(loop) for loop in sch.get_loops(sch.get_block("add"))]
+    # 16 lanes of float32, the 64 bytes of the data alignment of the buffers
+    assert [int(loop.extent) for loop in loops] == [16, 64, 16]
+    assert loops[-1].kind == tvm.tir.ForKind.VECTORIZED
+
+
 def test_no_unroll_for_spatial_block():
     # fmt: off
     @T.prim_func
@@ -625,6 +625,34 @@ def test_multi_level_tiling_hexagon():
     )
 
 
+def test_multi_level_tiling_hexagon_vtcm_pipeline():
+    target_hexagon = target.hexagon("v69", num_cores=4)
+    mod = te.create_prim_func(
+        te_workload.conv2d_nhwc(
+            1, 56, 56, 64, 64, 3, 1, 1, 1, in_dtype="float16", out_dtype="float16"
+        )
+    )
+    actual = generate_design_space(
+        kind="cuda",
+        mod=mod,
+        target=Target(target_hexagon, host=target_hexagon),
+        types=None,
+        sch_rules=[
+            ms.schedule_rule.MultiLevelTilingWideVector(
+                structure="SRSRS",
+                vector_length_in_bits=1024,
+                max_innermost_factor=64,
+                reuse_read=ms.schedule_rule.ReuseType(req="must", levels=[2], scope="global.vtcm"),
+                reuse_write=None,
+            )
+        ],
+    )
+    # The reads cached in VTCM are double buffered in one of the sketches
+    scripts = [sketch.mod.script() for sketch in actual]
+    assert any("global.vtcm" in script for script in scripts)
+    assert any("software_pipeline_async_stages" in script for script in scripts)
+
+
 def test_cache_read_specify_consumer():
     @T.prim_func
     def cache_read_specify_consumer_0(
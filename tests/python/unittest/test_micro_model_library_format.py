@@ -408,6 +408,67 @@ def test_export_model_library_format_workspace(executor, runtime):
         )
 
 
+def _build_dense_softmax(config):
+    # The output of the dense is a workspace buffer of main, too large for the stack.
+    relay_mod = tvm.relay.fromtext(
+        """
+        #[version = "0.0.5"]
+        def @main(%data: Tensor[(4, 256), float32], %weight: Tensor[(256, 256), float32]) {
+          %0 = nn.dense(%data, %weight, units=256);
+          nn.softmax(%0)
+        }
+        """
+    )
+    with tvm.transform.PassContext(
+        opt_level=3, config=dict({"tir.disable_vectorize": True}, **config)
+    ):
+        return tvm.relay.build(
+            relay_mod,
+            tvm.target.target.micro("host"),
+            executor=Executor("aot"),
+            runtime=Runtime("crt"),
+            mod_name="dense_softmax",
+        )
+
+
+def _export_memory_map(factory):
+    temp_dir = utils.tempdir()
+    mlf_tar_path = temp_dir.relpath("lib.tar")
+    micro.export_model_library_format(factory, mlf_tar_path)
+    extract_dir = temp_dir.relpath("extract")
+    os.mkdir(extract_dir)
+    tarfile.open(mlf_tar_path).extractall(extract_dir)
+    with open(os.path.join(extract_dir, "metadata.json")) as json_f:
+        metadata = json.load(json_f)
+    return metadata["modules"][factory.libmod_name]["memory"]
+
+
+@tvm.testing.requires_micro
+def test_export_model_library_format_static_arena():
+    memory = _export_memory_map(_build_dense_softmax({"tir.usmp.static_arena": True}))
+    arena = memory["arena"]
+    assert arena
+    buffers = [buffer for pool in arena.values() for buffer in pool["buffers"]]
+    # The output of the dense is planned in a pool.
+    assert any(buffer["size_bytes"] >= 4 * 256 * 4 for buffer in buffers)
+    for pool in arena.values():
+        offsets = [buffer["offset_bytes"] for buffer in pool["buffers"]]
+        assert offsets == sorted(offsets)
+        assert pool["high_water_mark_bytes"] == max(
+            buffer["offset_bytes"] + buffer["size_bytes"] for buffer in pool["buffers"]
+        )
+
+    # The layout is only exported in the static arena mode.
+    memory = _export_memory_map(_build_dense_softmax({"tir.usmp.enable": True}))
+    assert "arena" not in memory
+
+
+@tvm.testing.requires_micro
+def test_static_arena_needs_usmp():
+    with pytest.raises(tvm.TVMError, match="tir.usmp.static_arena"):
+        _build_dense_softmax({"tir.usmp.static_arena": True, "tir.usmp.enable": False})
+
+
 @tvm.testing.requires_micro
 def test_export_non_dso_exportable():
     module = tvm.support.FrontendTestModule()
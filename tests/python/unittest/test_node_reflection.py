@@ -195,5 +195,47 @@ def test_alloc_const():
     np.testing.assert_array_equal(np_data, alloc_const2.data.numpy())
 
 
+
+def test_saveload_binary():
+    A = te.placeholder((16, 16), name="A")
+    B = te.compute((16, 16), lambda i, j: A[i, j] * 2.0 + 1.0, name="B")
+    mod = tvm.IRModule({"main": te.create_prim_func([A, B])})
+    mod2 = tvm.ir.load_binary(tvm.ir.save_binary(mod))
+    tvm.ir.assert_structural_equal(mod, mod2)
+    # the blob of the same module is deterministic
+    assert tvm.ir.save_binary(mod) == tvm.ir.save_binary(mod2)
+
+    dev = tvm.cpu(0)
+    arr = tvm.nd.array(np.random.rand(3, 5).astype("float32"), device=dev)
+    arr2 = tvm.ir.load_binary(tvm.ir.save_binary(arr))
+    np.testing.assert_array_equal(arr.numpy(), arr2.numpy())
+
+    x = tvm.tir.Var("x", "int32")
+    obj = {
+        "expr": x + tvm.tir.const(1.5, "float32").astype("int32"),
+        "array": [tvm.tir.const(1, "int64"), tvm.runtime.String("str"), x],
+        "tensor": arr,
+    }
+    obj2 = tvm.ir.load_binary(tvm.ir.save_binary(obj))
+    tvm.ir.assert_structural_equal(obj, obj2, map_free_vars=True)
+    # the var shared by the fields stays shared
+    assert obj2["array"][2].same_as(obj2["expr"].a)
+    np.testing.assert_array_equal(arr.numpy(), obj2["tensor"].numpy())
+
+
+def test_load_binary_truncated_or_corrupted():
+    dev = tvm.cpu(0)
+    x = tvm.tir.Var("x", "int32")
+    blob = bytes(tvm.ir.save_binary([x + 1, tvm.nd.array(np.arange(4, dtype="int32"), dev)]))
+    # every prefix ends within a section of the blob
+    for size in range(len(blob)):
+        with pytest.raises(tvm.TVMError, match="BinaryReader"):
+            tvm.ir.load_binary(blob[:size])
+    with pytest.raises(tvm.TVMError, match="not a binary graph"):
+        tvm.ir.load_binary(b"\x00" * len(blob))
+    with pytest.raises(tvm.TVMError, match="not a binary graph"):
+        tvm.ir.load_binary(tvm.ir.save_json(x).encode())
+
+
 if __name__ == "__main__":
     tvm.testing.main()
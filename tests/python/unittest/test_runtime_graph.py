@@ -14,7 +14,9 @@
 # KIND, either express or implied.  See the License for the
 # specific language governing permissions and limitations
 # under the License.
+import struct
 import tempfile
+import pytest
 import tvm
 import tvm.testing
 from tvm import te, runtime
@@ -119,6 +121,58 @@ def test_graph_simple():
     check_sharing()
 
 
+@tvm.testing.requires_llvm
+def test_set_input_after_bind_input():
+    x = relay.var("x", shape=(4,))
+    func = relay.Function([x], relay.add(x, relay.const(1.0)))
+    graph, lib, _ = relay.build(func, target="llvm")
+    mod = graph_executor.create(graph, lib, tvm.cpu(0))
+
+    bound = tvm.nd.array(np.zeros((4,), "float32"))
+    mod.bind_input("x", bound)
+    mod.run()
+    np.testing.assert_equal(mod.get_output(0).numpy(), np.ones((4,), "float32"))
+
+    # set_input drops the binding, the bound array is left untouched
+    a = np.random.uniform(size=(4,)).astype("float32")
+    mod.set_input("x", a)
+    mod.run()
+    np.testing.assert_equal(mod.get_output(0).numpy(), a + 1)
+    np.testing.assert_equal(bound.numpy(), np.zeros((4,), "float32"))
+
+
+def test_load_params_mapped_checks_header():
+    x = np.arange(4, dtype="float32")
+    temp = utils.tempdir()
+    path = temp.relpath("params.bin")
+    runtime.save_param_dict_mapped({"x": tvm.nd.array(x)}, path)
+    np.testing.assert_equal(runtime.load_param_dict_mapped(path)["x"].numpy(), x)
+
+    with open(path, "rb") as f:
+        data = bytearray(f.read())
+    # magic, alignment, the names ["x"], their count, then the dtype, shape, offset and nbytes
+    offset_pos = 8 + 8 + (8 + 8 + 1) + 8 + 4 + (8 + 8)
+    nbytes_pos = offset_pos + 8
+    assert struct.unpack_from("<Q", data, nbytes_pos)[0] == x.nbytes
+
+    def check_invalid(dim, offset, nbytes):
+        bad = bytearray(data)
+        struct.pack_into("<qQQ", bad, offset_pos - 8, dim, offset, nbytes)
+        bad_path = temp.relpath("bad.bin")
+        with open(bad_path, "wb") as f:
+            f.write(bad)
+        with pytest.raises(tvm.TVMError, match="Invalid parameters file format"):
+            runtime.load_param_dict_mapped(bad_path)
+
+    offset = struct.unpack_from("<Q", data, offset_pos)[0]
+    # nbytes not matching the shape and dtype
+    check_invalid(4, offset, x.nbytes - 4)
+    # the bytes of the shape overflowing
+    check_invalid(2**62, offset, 0)
+    # offset + nbytes wrapping around to 0
+    check_invalid(2**61, 2**63, 2**63)
+
+
 def test_load_unexpected_params():
     # Test whether graph_executor.load_params works if parameters
     # are provided that are not an expected input.
@@ -151,5 +205,130 @@ def test_save_load_file():
         np.testing.assert_equal(p, params_loaded["x"].numpy())
 
 
+def test_streamed_params():
+    # A chain of dense layers whose weights are streamed through a window holding two of them, so
+    # that the regions of the window are reused by the later layers and by the next run.
+    num_layers, units = 6, 64
+    x = relay.var("x", shape=(1, units))
+    y = x
+    params = {}
+    for i in range(num_layers):
+        w = relay.var("w%d" % i, shape=(units, units))
+        y = relay.nn.relu(relay.nn.dense(y, w))
+        params["w%d" % i] = np.random.uniform(-0.1, 0.1, (units, units)).astype("float32")
+    mod = tvm.IRModule.from_expr(relay.Function(relay.analysis.free_vars(y), y))
+    lib = relay.build(mod, target="llvm", params=params)
+
+    ref = graph_executor.GraphModule(lib["default"](tvm.cpu(0)))
+    weight_bytes = units * units * 4
+    streamed = graph_executor.create_streamed(lib, tvm.cpu(0), 2 * weight_bytes, min_bytes=0)
+    names = list(lib.get_params().keys())
+    assert len(names) == num_layers
+    assert all(streamed.is_streamed(name) for name in names)
+    assert streamed.get_stream_window_bytes() == 2 * weight_bytes
+    for _ in range(2):
+        data = np.random.uniform(size=(1, units)).astype("float32")
+        ref.run(x=data)
+        streamed.run(x=data)
+        tvm.testing.assert_allclose(streamed.get_output(0).numpy(), ref.get_output(0).numpy())
+
+    # a new value of a streamed param is uploaded by the next runs
+    new_w = np.zeros_like(lib.get_params()[names[0]].numpy())
+    ref.set_input(names[0], new_w)
+    streamed.set_input(names[0], new_w)
+    ref.run(x=data)
+    streamed.run(x=data)
+    tvm.testing.assert_allclose(streamed.get_output(0).numpy(), ref.get_output(0).numpy())
+    # the value of a streamed param is its host array
+    np.testing.assert_equal(streamed.get_input(names[0]).numpy(), new_w)
+
+    # the streamed params stay in the window when the storage of the ops is shared
+    sharing = graph_executor.create_streamed(lib, tvm.cpu(0), 2 * weight_bytes, min_bytes=0)
+    sharing.set_input(names[0], new_w)
+    sharing.share_storage(streamed)
+    sharing.run(x=data)
+    tvm.testing.assert_allclose(sharing.get_output(0).numpy(), ref.get_output(0).numpy())
+
+    # the params shared from a streamed executor are copied from their host arrays
+    resident = graph_executor.GraphModule(lib["default"](tvm.cpu(0)))
+    resident.share_params(streamed, tvm.runtime.save_param_dict(lib.get_params()))
+    resident.run(x=data)
+    tvm.testing.assert_allclose(resident.get_output(0).numpy(), ref.get_output(0).numpy())
+
+    # the default window is sized from the params read by the ops
+    auto = graph_executor.create_streamed(lib, tvm.cpu(0), min_bytes=0)
+    assert weight_bytes <= auto.get_stream_window_bytes() <= num_layers * weight_bytes
+    auto.run(x=data)
+    tvm.testing.assert_allclose(auto.get_output(0).numpy(), ref.get_output(0).numpy())
+
+
+@tvm.testing.requires_llvm
+def test_sampling_profiler():
+    # A single fused operator, timed in one run of every two.
+    x = relay.var("x", shape=(1, 16))
+    func = relay.Function([x], relay.nn.relu(relay.add(x, relay.const(1.0))))
+    lib = relay.build(tvm.IRModule.from_expr(func), target="llvm")
+    mod = graph_executor.GraphModule(lib["default"](tvm.cpu(0)))
+    with pytest.raises(tvm.TVMError):
+        mod.sampling_profile_chrome_trace()
+
+    mod.enable_sampling_profiler(sample_every=2, capacity=2)
+    data = np.random.uniform(-1, 1, size=(1, 16)).astype("float32")
+    for _ in range(5):
+        mod.run(x=data)
+    tvm.testing.assert_allclose(mod.get_output(0).numpy(), np.maximum(data + 1, 0))
+
+    # The runs 0, 2 and 4 are sampled, the call of the first one is dropped from the buffer.
+    trace = json.loads(mod.sampling_profile_chrome_trace())
+    assert trace["otherData"] == {"sample_every": 2, "sampled": 3, "dropped": 1}
+    events = trace["traceEvents"]
+    assert [event["args"]["request"] for event in events] == [1, 2]
+    assert all("fused" in event["name"] and event["pid"] == "cpu0" for event in events)
+    assert all(event["ph"] == "X" and event["dur"] >= 0 for event in events)
+    assert events[0]["ts"] <= events[1]["ts"]
+    # The buffer is drained by the export.
+    trace = json.loads(mod.sampling_profile_chrome_trace())
+    assert trace["traceEvents"] == []
+    assert trace["otherData"]["dropped"] == 0
+
+    # The histograms are never reset and count all the sampled calls.
+    metrics = mod.sampling_profile_prometheus().splitlines()
+    assert "tvm_requests_total 5" in metrics
+    assert "tvm_sampled_requests_total 3" in metrics
+    counts = [line for line in metrics if line.startswith("tvm_call_duration_seconds_count")]
+    assert len(counts) == 1 and counts[0].endswith(" 3")
+    assert any(
+        line.startswith("tvm_call_duration_seconds_bucket") and 'le="+Inf"} 3' in line
+        for line in metrics
+    )
+
+
+@tvm.testing.requires_cuda
+def test_l2_prefetch():
+    # The weights of the next dense layer are prefetched into the L2 cache during each layer.
+    num_layers, units = 4, 256
+    x = relay.var("x", shape=(1, units))
+    y = x
+    params = {}
+    for i in range(num_layers):
+        w = relay.var("w%d" % i, shape=(units, units))
+        y = relay.nn.relu(relay.nn.dense(y, w))
+        params["w%d" % i] = np.random.uniform(-0.1, 0.1, (units, units)).astype("float32")
+    mod = tvm.IRModule.from_expr(relay.Function(relay.analysis.free_vars(y), y))
+    lib = relay.build(mod, target="cuda", params=params)
+    dev = tvm.cuda(0)
+    ref = graph_executor.GraphModule(lib["default"](dev))
+    prefetched = graph_executor.GraphModule(lib["default"](dev))
+    assert prefetched.set_l2_prefetch(True, persisting_bytes=-1) >= 0
+    for _ in range(2):
+        data = np.random.uniform(size=(1, units)).astype("float32")
+        ref.run(x=data)
+        prefetched.run(x=data)
+        tvm.testing.assert_allclose(prefetched.get_output(0).numpy(), ref.get_output(0).numpy())
+    assert prefetched.set_l2_prefetch(False) == 0
+    prefetched.run(x=data)
+    tvm.testing.assert_allclose(prefetched.get_output(0).numpy(), ref.get_output(0).numpy())
+
+
 if __name__ == "__main__":
     tvm.testing.main()
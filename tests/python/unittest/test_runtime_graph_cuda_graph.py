@@ -96,5 +96,39 @@ def test_graph_simple():
     check_verify()
 
 
+@tvm.testing.requires_cudagraph
+def test_graph_rebind():
+    # The inputs and outputs rebound after the capture are patched into the captured graph.
+    from tvm import relay
+
+    def build(n):
+        x = relay.var("x", shape=(n, 16))
+        y = relay.nn.relu(relay.add(relay.reshape(x, (n * 16,)), relay.const(1.0)))
+        lib = relay.build(tvm.IRModule.from_expr(relay.Function([x], y)), target="cuda")
+        return cuda_graph_executor.create(lib.get_graph_json(), lib.get_lib(), dev)
+
+    dev = tvm.cuda(0)
+    mod = build(4)
+    mod.capture_cuda_graph()
+    for _ in range(3):
+        a = np.random.uniform(-1, 1, size=(4, 16)).astype("float32")
+        x, out = tvm.nd.array(a, dev), tvm.nd.empty((64,), "float32", dev)
+        mod.set_input_zero_copy("x", x)
+        mod.set_output_zero_copy(0, out)
+        mod.run_cuda_graph()
+        tvm.testing.assert_allclose(out.numpy(), np.maximum(a.reshape(64) + 1, 0))
+    assert mod.num_patchable_entries() >= 0
+
+    graphs = cuda_graph_executor.BucketedCudaGraph({n: build(n) for n in [2, 8]})
+    assert graphs.buckets == [2, 8]
+    for size in [1, 2, 5, 8, 3]:
+        bucket = graphs.select(size)
+        a = np.random.uniform(-1, 1, size=(bucket, 16)).astype("float32")
+        out = graphs.run(size, x=a).get_output(0).numpy()
+        tvm.testing.assert_allclose(out, np.maximum(a.reshape(-1) + 1, 0))
+    with pytest.raises(ValueError):
+        graphs.select(9)
+
+
 if __name__ == "__main__":
-    test_graph_simple()
+    tvm.testing.main()
@@ -176,6 +176,34 @@ def test_rpc_large_array():
     check_remote()
 
 
+@tvm.testing.requires_rpc
+def test_rpc_tensor_cache():
+    server = rpc.Server()
+    remote = rpc.connect("127.0.0.1", server.port)
+
+    def check_remote():
+        dev = remote.cpu(0)
+        remote.set_transfer_options(cache_min_bytes=1024)
+        remote.clear_tensor_cache()
+        a_np = np.random.uniform(size=(1024,)).astype("float32")
+        b_np = np.random.uniform(size=(1024,)).astype("float32")
+        a = tvm.nd.array(a_np, dev)
+        assert remote.tensor_cache_stats() == {"hits": 0, "misses": 1, "bytes": a_np.nbytes}
+        a_again = tvm.nd.array(a_np, dev)
+        assert remote.tensor_cache_stats() == {"hits": 1, "misses": 1, "bytes": a_np.nbytes}
+        b = tvm.nd.array(b_np, dev)
+        # below cache_min_bytes
+        tvm.nd.array(np.ones((16,), "float32"), dev)
+        assert remote.tensor_cache_stats() == {"hits": 1, "misses": 2, "bytes": 2 * a_np.nbytes}
+        np.testing.assert_equal(a.numpy(), a_np)
+        np.testing.assert_equal(a_again.numpy(), a_np)
+        np.testing.assert_equal(b.numpy(), b_np)
+        remote.clear_tensor_cache()
+        assert remote.tensor_cache_stats() == {"hits": 0, "misses": 0, "bytes": 0}
+
+    check_remote()
+
+
 @tvm.testing.skip_if_32bit(reason="skipping test for i386.")
 @tvm.testing.requires_rpc
 def test_rpc_echo():
@@ -637,3 +665,36 @@ def test_rpc_session_timeout_error(with_proxy):
     if with_proxy:
         proxy.terminate()
     tracker.terminate()
+
+
+@tvm.testing.requires_rpc
+def test_rpc_multiplexed_large_array():
+    """The arrays larger than a frame are split into frames and reassembled"""
+    server = rpc.Server(key="x1")
+    conn = rpc.connect_multiplexed("127.0.0.1", server.port, key="x1")
+
+    def check_remote():
+        remotes = [conn.session(device_key="cpu") for _ in range(2)]
+        # 4MB, several frames of the multiplexed connection
+        a_np = np.random.uniform(size=(1024, 1024)).astype("float32")
+        for remote in remotes:
+            a = tvm.nd.array(a_np, remote.cpu(0))
+            np.testing.assert_equal(a.numpy(), a_np)
+
+    check_remote()
+
+
+@tvm.testing.requires_rpc
+def test_rpc_multiplexed_many_sessions():
+    """The closed sessions free their server threads for the next ones"""
+    server = rpc.Server(key="x1")
+    conn = rpc.connect_multiplexed("127.0.0.1", server.port, key="x1")
+
+    def check_remote():
+        # more sessions than the threads serving a connection, opened one after the other
+        for i in range(40):
+            remote = conn.session(device_key="cpu")
+            assert remote.get_function("rpc.test.addone")(i) == i + 1
+            del remote
+
+    check_remote()
@@ -26,7 +26,7 @@ import sys
 import tvm
 import tvm.testing
 from tvm import te
-from tvm.contrib import clang, utils
+from tvm.contrib import cc, clang, popen_pool, utils
 from tvm.relay.backend import Runtime
 from tvm.script import tir as T, ir as I
 from tvm.target.codegen import llvm_get_intrinsic_name, llvm_lookup_intrinsic_id
@@ -1109,5 +1109,100 @@ def test_call_extern_returning_void():
     built = tvm.build(func, target="llvm")
 
 
+
+def _many_funcs_module():
+    n = 64
+    A = te.placeholder((n,), name="A")
+    mod = tvm.IRModule()
+    for k in range(8):
+        B = te.compute(A.shape, lambda i: A[i] * float(k + 1) + 1.0, name="B")
+        mod.update(tvm.lower(te.create_schedule(B.op), [A, B], name=f"scale{k}"))
+
+    # the callers and the callee are kept in one partition
+    @I.ir_module
+    class Calls:
+        @T.prim_func
+        def caller0(A: T.Buffer(1, dtype="float32")):
+            T.func_attr({"global_symbol": "caller0"})
+            Calls.subroutine(A.data)
+
+        @T.prim_func
+        def caller1(A: T.Buffer(1, dtype="float32")):
+            T.func_attr({"global_symbol": "caller1"})
+            Calls.subroutine(A.data)
+            Calls.subroutine(A.data)
+
+        @T.prim_func
+        def subroutine(A_data: T.handle("float32")):
+            T.func_attr({"global_symbol": "subroutine", "calling_conv": -1})
+            A = T.decl_buffer(1, dtype="float32", data=A_data)
+            A[0] = A[0] * 2.0 + 1.0
+
+    mod.update(Calls)
+    return mod
+
+
+def _check_many_funcs(m, dev):
+    a_np = np.random.uniform(size=64).astype("float32")
+    for k in range(8):
+        b = tvm.nd.array(np.zeros(64, "float32"), dev)
+        m[f"scale{k}"](tvm.nd.array(a_np, dev), b)
+        tvm.testing.assert_allclose(b.numpy(), a_np * (k + 1) + 1.0, rtol=1e-6)
+    for name, expected in [("caller0", 3.0), ("caller1", 7.0)]:
+        arr = tvm.nd.array(np.ones(1, "float32"), dev)
+        m[name](arr)
+        assert arr.numpy()[0] == expected
+
+
+@tvm.testing.requires_llvm
+@pytest.mark.parametrize("num_partitions", [2, 4])
+def test_llvm_num_partitions(num_partitions):
+    mod = _many_funcs_module()
+    dev = tvm.cpu()
+    serial = tvm.build(mod, target="llvm")
+    with tvm.transform.PassContext(config={"target.llvm.num_partitions": num_partitions}):
+        partitioned = tvm.build(mod, target="llvm")
+    _check_many_funcs(serial, dev)
+    _check_many_funcs(partitioned, dev)
+
+    # each partition has its startup function registering the symbols of the system lib, the
+    # module context being shared by the link
+    runtime = Runtime("cpp", {"system-lib": True})
+    with tvm.transform.PassContext(config={"target.llvm.num_partitions": num_partitions}):
+        system_lib = tvm.build(mod, target="llvm", runtime=runtime)
+    source = system_lib.get_source("ll")
+    startups = re.findall(r"define internal void @__tvm_module_startup(\.\d+)?\(", source)
+    assert len(startups) == num_partitions
+    if sys.platform == "win32":
+        return
+    temp = utils.tempdir()
+    path_obj = temp.relpath("lib.o")
+    path_dso = temp.relpath("lib.so")
+    system_lib.save(path_obj)
+    cc.create_shared(path_dso, [path_obj])
+
+    def popen_check():
+        import ctypes
+
+        import tvm.runtime
+
+        ctypes.CDLL(path_dso)
+        mm = tvm.runtime.system_lib()
+        dev = tvm.cpu()
+        a_np = np.random.uniform(size=64).astype("float32")
+        for k in range(8):
+            b = tvm.nd.array(np.zeros(64, "float32"), dev)
+            mm[f"scale{k}"](tvm.nd.array(a_np, dev), b)
+            np.testing.assert_allclose(b.numpy(), a_np * (k + 1) + 1.0, rtol=1e-6)
+        arr = tvm.nd.array(np.ones(1, "float32"), dev)
+        mm["caller1"](arr)
+        assert arr.numpy()[0] == 7.0
+
+    # the system lib is loaded in a different process
+    worker = popen_pool.PopenWorker()
+    worker.send(popen_check)
+    worker.recv()
+
+
 if __name__ == "__main__":
     tvm.testing.main()
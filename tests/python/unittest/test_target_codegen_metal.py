@@ -21,6 +21,7 @@ import tvm.script
 import tvm.testing
 from tvm import te
 from tvm.script import tir as T
+from tvm.tir.tensor_intrin.metal import get_simdgroup_intrin_group
 
 
 @tvm.testing.requires_gpu
@@ -169,5 +170,65 @@ def test_vectorized_uint8():
     np.testing.assert_allclose(b_nd.numpy(), a.astype("float32"), atol=1e-5, rtol=1e-5)
 
 
+@tvm.testing.requires_gpu
+@tvm.testing.requires_metal
+def test_simdgroup_matmul():
+    M = N = K = 16
+    dtype = "float16"
+
+    @T.prim_func
+    def matmul(a: T.handle, b: T.handle, c: T.handle):
+        A = T.match_buffer(a, (M, K), dtype)
+        B = T.match_buffer(b, (K, N), dtype)
+        C = T.match_buffer(c, (M, N), dtype)
+        # a single simdgroup computes all the 8x8 tiles
+        for tx in T.thread_binding(32, thread="threadIdx.x"):
+            for i, j, k in T.grid(M, N, K):
+                with T.block("C"):
+                    vi, vj, vk = T.axis.remap("SSR", [i, j, k])
+                    with T.init():
+                        C[vi, vj] = T.float16(0)
+                    C[vi, vj] = C[vi, vj] + A[vi, vk] * B[vk, vj]
+
+    sch = tvm.tir.Schedule(matmul)
+    block = sch.get_block("C")
+    _, i, j, k = sch.get_loops(block)
+    i0, i1 = sch.split(i, [None, 8])
+    j0, j1 = sch.split(j, [None, 8])
+    k0, k1 = sch.split(k, [None, 8])
+    sch.reorder(i0, j0, k0, i1, j1, k1)
+    for buffer in ["A", "B"]:
+        sch.compute_at(sch.cache_read(block, buffer, "shared"), k0)
+    A_simdgroup = sch.cache_read(block, "A", "metal.simdgroup")
+    B_simdgroup = sch.cache_read(block, "B", "metal.simdgroup")
+    sch.compute_at(A_simdgroup, k0)
+    sch.compute_at(B_simdgroup, k0)
+    C_simdgroup = sch.cache_write(block, 0, "metal.simdgroup")
+    sch.reverse_compute_at(C_simdgroup, j0)
+    init = sch.decompose_reduction(block, k0)
+
+    intrins = get_simdgroup_intrin_group("shared", "global", dtype)
+    sch.tensorize(sch.get_loops(init)[-2], intrins["init"])
+    sch.tensorize(sch.get_loops(A_simdgroup)[-2], intrins["load_a"])
+    sch.tensorize(sch.get_loops(B_simdgroup)[-2], intrins["load_b"])
+    sch.tensorize(i1, intrins["compute"])
+    sch.tensorize(sch.get_loops(C_simdgroup)[-2], intrins["store"])
+
+    f = tvm.build(sch.mod, target="metal")
+    source = f.imported_modules[0].get_source()
+    assert "simdgroup_half8x8" in source
+    assert "simdgroup_multiply_accumulate" in source
+
+    dev = tvm.metal()
+    a_np = np.random.uniform(-1, 1, (M, K)).astype(dtype)
+    b_np = np.random.uniform(-1, 1, (K, N)).astype(dtype)
+    a = tvm.nd.array(a_np, dev)
+    b = tvm.nd.array(b_np, dev)
+    c = tvm.nd.empty((M, N), dtype, dev)
+    f(a, b, c)
+    c_np = a_np.astype("float32") @ b_np.astype("float32")
+    tvm.testing.assert_allclose(c.numpy(), c_np, rtol=1e-2, atol=1e-2)
+
+
 if __name__ == "__main__":
     tvm.testing.main()
@@ -149,6 +149,31 @@ def test_opencl_erf():
     check_erf(dev, 1, "float64")
 
 
+def test_opencl_subgroup_shuffle_reduction():
+    def build_sum(target):
+        n, m = 4, 16
+        A = te.placeholder((n, m), name="A")
+        k = te.reduce_axis((0, m), name="k")
+        B = te.compute((n,), lambda i: te.sum(A[i, k], axis=k), name="B")
+        s = te.create_schedule(B.op)
+        s[B].bind(B.op.axis[0], te.thread_axis("blockIdx.x"))
+        s[B].bind(B.op.reduce_axis[0], te.thread_axis("threadIdx.x"))
+        fun = tvm.build(s, [A, B], target)
+        return fun.imported_modules[0].get_source()
+
+    # The reduction over the subgroup of 16 threads uses the subgroup shuffles
+    source_str = build_sum("opencl -supports_subgroup_shuffle=1 -thread_warp_size=16")
+    assert "sub_group_shuffle_down(" in source_str
+    assert "sub_group_shuffle(" in source_str
+    assert "#pragma OPENCL EXTENSION cl_khr_subgroup_shuffle : enable" in source_str
+    assert "#pragma OPENCL EXTENSION cl_khr_subgroup_shuffle_relative : enable" in source_str
+
+    # and the shared memory otherwise
+    source_str = build_sum(target)
+    assert "sub_group_shuffle" not in source_str
+    assert "__local" in source_str
+
+
 @tvm.testing.requires_gpu
 @tvm.testing.requires_opencl
 def test_opencl_type_casting():
@@ -19,6 +19,8 @@ import os
 from posixpath import split
 import random
 import re
+import subprocess
+import sys
 import threading
 
 import numpy as np
@@ -233,6 +235,82 @@ def test_vulkan_bool_load(target, dev):
     tvm.testing.assert_allclose(b.numpy(), ref)
 
 
+def _build_add_one(target, n):
+    A = te.placeholder((n,), name="A")
+    B = te.compute(A.shape, lambda i: A[i] + 1.0, name="B")
+    s = te.create_schedule(B.op)
+    xo, xi = s[B].split(B.op.axis[0], factor=32)
+    s[B].bind(xo, te.thread_axis("blockIdx.x"))
+    s[B].bind(xi, te.thread_axis("threadIdx.x"))
+    return tvm.build(s, [A, B], target)
+
+
+@tvm.testing.parametrize_targets("vulkan")
+def test_vulkan_deferred_launches(target, dev):
+    """The launches with other buffers are batched until the stream synchronizes, taking more
+    descriptor sets than the first pool of the pipeline holds"""
+    n, num_launches = 64, 40
+    func = _build_add_one(target, n)
+    inputs = [tvm.nd.array(np.full(n, i, "float32"), dev) for i in range(num_launches)]
+    outputs = [tvm.nd.empty((n,), "float32", dev) for _ in range(num_launches)]
+    for a, b in zip(inputs, outputs):
+        func(a, b)
+    # The identical launches are queued once.
+    for _ in range(3):
+        func(inputs[0], outputs[0])
+    dev.sync()
+    for i, b in enumerate(outputs):
+        tvm.testing.assert_allclose(b.numpy(), np.full(n, i + 1, "float32"))
+
+    # The descriptor sets are reused once the stream synchronized.
+    for a, b in zip(reversed(inputs), outputs):
+        func(a, b)
+    dev.sync()
+    for i, b in enumerate(outputs):
+        tvm.testing.assert_allclose(b.numpy(), np.full(n, num_launches - i, "float32"))
+
+
+@tvm.testing.requires_vulkan
+def test_vulkan_pipeline_cache(tmp_path):
+    """The pipeline cache is saved to TVM_VULKAN_PIPELINE_CACHE_DIR and reloaded by the next
+    processes, ignoring the files it cannot read"""
+    script = "\n".join(
+        [
+            "import numpy as np",
+            "import tvm",
+            "from tvm import te",
+            "A = te.placeholder((64,), name='A')",
+            "B = te.compute(A.shape, lambda i: A[i] + 1.0, name='B')",
+            "s = te.create_schedule(B.op)",
+            "xo, xi = s[B].split(B.op.axis[0], factor=32)",
+            "s[B].bind(xo, te.thread_axis('blockIdx.x'))",
+            "s[B].bind(xi, te.thread_axis('threadIdx.x'))",
+            "func = tvm.build(s, [A, B], 'vulkan')",
+            "dev = tvm.vulkan(0)",
+            "a = tvm.nd.array(np.arange(64, dtype='float32'), dev)",
+            "b = tvm.nd.empty((64,), 'float32', dev)",
+            "func(a, b)",
+            "np.testing.assert_allclose(b.numpy(), np.arange(64, dtype='float32') + 1)",
+        ]
+    )
+    env = dict(os.environ, TVM_VULKAN_PIPELINE_CACHE_DIR=str(tmp_path))
+
+    def run():
+        subprocess.run([sys.executable, "-c", script], env=env, check=True)
+        assert not list(tmp_path.glob("*.tmp"))
+        return sorted(tmp_path.glob("vulkan_pipeline_cache_*.bin"))
+
+    cache_files = run()
+    assert cache_files
+    assert all(path.stat().st_size > 0 for path in cache_files)
+    assert run() == cache_files
+
+    for path in cache_files:
+        path.write_bytes(b"not a pipeline cache")
+    assert run() == cache_files
+    assert all(path.read_bytes() != b"not a pipeline cache" for path in cache_files)
+
+
 def check_mod(target, dev, mod, x_np, res_np):
     res = relay.create_executor("vm", mod=mod, device=dev, target=target).evaluate()(x_np).numpy()
     tvm.testing.assert_allclose(res, res_np, atol=1e-5)
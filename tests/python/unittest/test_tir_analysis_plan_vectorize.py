@@ -0,0 +1,122 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+# pylint: disable=missing-function-docstring
+import tvm
+import tvm.testing
+from tvm import tir
+from tvm.script import tir as T
+
+
+def _innermost_loop(func):
+    loops = []
+    tir.stmt_functor.post_order_visit(
+        func.body, lambda stmt: loops.append(stmt) if isinstance(stmt, tir.For) else None
+    )
+    return loops[0]
+
+
+def test_contiguous():
+    @T.prim_func
+    def func(A: T.Buffer((16, 64), "float32"), B: T.Buffer((16, 64), "float32")):
+        for i, j in T.grid(16, 64):
+            B[i, j] = A[i, j] + T.float32(1)
+
+    loop = _innermost_loop(func)
+    assert tir.analysis.plan_vectorize(loop, 128) == (4, [])
+    assert tir.analysis.plan_vectorize(loop, 512) == (16, [])
+
+
+def test_widest_element_type():
+    @T.prim_func
+    def func(A: T.Buffer((64,), "int8"), B: T.Buffer((64,), "int32")):
+        for i in range(64):
+            B[i] = T.Cast("int32", A[i])
+
+    assert tir.analysis.plan_vectorize(_innermost_loop(func), 128) == (4, [])
+
+
+def test_broadcast_load():
+    @T.prim_func
+    def func(A: T.Buffer((16, 64), "float32"), b: T.Buffer((16,), "float32")):
+        for i, j in T.grid(16, 64):
+            A[i, j] = A[i, j] * b[i]
+
+    assert tir.analysis.plan_vectorize(_innermost_loop(func), 128) == (4, [])
+
+
+def test_not_vectorizable():
+    @T.prim_func
+    def strided(A: T.Buffer((64, 64), "float32"), B: T.Buffer((64,), "float32")):
+        for i in range(64):
+            B[i] = A[i, 0]
+
+    @T.prim_func
+    def reduction(A: T.Buffer((64,), "float32"), B: T.Buffer((1,), "float32")):
+        for i in range(64):
+            B[0] = B[0] + A[i]
+
+    @T.prim_func
+    def extern(A: T.Buffer((64,), "float32")):
+        for i in range(64):
+            A[i] = T.call_extern("float32", "f", A[i])
+
+    for func in [strided, reduction, extern]:
+        assert tir.analysis.plan_vectorize(_innermost_loop(func), 128) == (1, [])
+
+
+def test_alignment():
+    @T.prim_func
+    def shifted(A: T.Buffer((65,), "float32"), B: T.Buffer((64,), "float32")):
+        for i in range(64):
+            B[i] = A[i + 1]
+
+    @T.prim_func
+    def dynamic(a: T.handle, b: T.handle, n: T.int32):
+        A = T.match_buffer(a, (n,), "float32")
+        B = T.match_buffer(b, (64,), "float32")
+        for i in range(64):
+            B[i] = A[i + n - 64]
+
+    # The first vector of A is misaligned
+    assert tir.analysis.plan_vectorize(_innermost_loop(shifted), 128) == (1, [])
+    # Its alignment is only known at runtime
+    assert tir.analysis.plan_vectorize(_innermost_loop(dynamic), 128) == (1, [])
+    lanes, checks = tir.analysis.plan_vectorize(_innermost_loop(dynamic), 128, True)
+    assert lanes == 4
+    assert len(checks) == 1
+
+
+def test_auto_vectorize():
+    @T.prim_func
+    def func(a: T.handle, b: T.handle, n: T.int32):
+        A = T.match_buffer(a, (n,), "float32")
+        B = T.match_buffer(b, (64,), "float32")
+        for i in range(64):
+            B[i] = A[i + n - 64] + T.float32(1)
+
+    mod = tir.transform.AutoVectorize()(tvm.IRModule.from_expr(func))
+    body = mod["main"].body
+    # The vector fast path, and the scalar loop for the misaligned offsets
+    assert isinstance(body, tir.IfThenElse)
+    assert body.then_case.kind == tir.ForKind.SERIAL and body.then_case.extent.value == 16
+    assert body.then_case.body.kind == tir.ForKind.VECTORIZED
+    assert body.then_case.body.extent.value == 4
+    assert body.else_case.kind == tir.ForKind.SERIAL and body.else_case.extent.value == 64
+
+
+if __name__ == "__main__":
+    tvm.testing.main()
@@ -419,5 +419,28 @@ def test_ir_module_equal():
     assert '<root>.functions[I.GlobalVar("func")].body.extent.value' in err.value.args[0]
 
 
+def test_structural_hash_cache_module_mutation():
+    def make_func(n):
+        buf = tvm.tir.decl_buffer((1,), "int32", name="A")
+        stores = [tvm.tir.BufferStore(buf, buf[0] + i, [0]) for i in range(n)]
+        return tvm.tir.PrimFunc([buf.data], tvm.tir.SeqStmt(stores), buffer_map={buf.data: buf})
+
+    mod = tvm.IRModule({"main": make_func(32)})
+    expected = tvm.ir.structural_hash(mod)
+    tvm.ir.set_structural_hash_cache_size(1024)
+    try:
+        assert tvm.ir.structural_hash(mod) == expected
+        assert tvm.ir.structural_hash(mod) == expected
+        # the module is mutated in place, its hash must not come from the cache
+        mod["other"] = make_func(48)
+        mod.update_func(mod.get_global_var("main"), make_func(40))
+        cached = tvm.ir.structural_hash(mod)
+        tvm.ir.set_structural_hash_cache_size(0)
+        assert cached == tvm.ir.structural_hash(mod)
+        assert cached != expected
+    finally:
+        tvm.ir.set_structural_hash_cache_size(0)
+
+
 if __name__ == "__main__":
     tvm.testing.main()
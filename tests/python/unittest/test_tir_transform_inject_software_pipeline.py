@@ -1322,6 +1322,69 @@ def test_async_producer_interleaving():
     tvm.ir.assert_structural_equal(mod["main"], ref.with_attr("global_symbol", "main"), True)
 
 
+def test_async_buffer_commit_groups():
+    @T.prim_func
+    def two_consumers(
+        A: T.Buffer((16, 16), "float32"),
+        B: T.Buffer((16, 16), "float32"),
+        C: T.Buffer((16, 16), "float32"),
+        D: T.Buffer((16, 16), "float32"),
+    ):
+        for tx in T.thread_binding(0, 16, thread="threadIdx.x"):
+            for i in range(16):
+                with T.block("compute"):
+                    T.reads(A[tx, i], B[tx, i])
+                    T.writes(C[tx, i], D[tx, i])
+                    A_shared = T.alloc_buffer((16, 1), dtype="float32", scope="shared")
+                    B_shared = T.alloc_buffer((16, 1), dtype="float32", scope="shared")
+                    with T.block():
+                        T.reads(A[tx, i])
+                        T.writes(A_shared[tx, 0])
+                        A_shared[tx, 0] = A[tx, i]
+                    with T.block():
+                        T.reads(B[tx, i])
+                        T.writes(B_shared[tx, 0])
+                        B_shared[tx, 0] = B[tx, i]
+                    with T.block():
+                        T.reads(A_shared[tx, 0])
+                        T.writes(C[tx, i])
+                        C[tx, i] = A_shared[tx, 0] * T.float32(2)
+                    with T.block():
+                        T.reads(A_shared[tx, 0], B_shared[tx, 0])
+                        T.writes(D[tx, i])
+                        D[tx, i] = A_shared[tx, 0] + B_shared[tx, 0]
+
+    sch = tvm.tir.Schedule(two_consumers.with_attr("global_symbol", "main"))
+    _, loop = sch.get_loops(sch.get_block("compute"))
+    sch.annotate(loop, ann_key="software_pipeline_stage", ann_val=[0, 0, 3, 3])
+    sch.annotate(loop, ann_key="software_pipeline_order", ann_val=[0, 1, 2, 3])
+    sch.annotate(loop, ann_key="software_pipeline_async_stages", ann_val=[0])
+
+    def pipelined_body(config):
+        with tvm.transform.PassContext(config=config):
+            mod = tvm.tir.transform.InjectSoftwarePipeline()(sch.mod)
+        loops = []
+        tvm.tir.stmt_functor.post_order_visit(
+            mod["main"].body, lambda stmt: loops.append(stmt) if isinstance(stmt, tir.For) else None
+        )
+        (body,) = [loop for loop in loops if loop.extent.value == 13]
+        commits, waits = [], []
+
+        def visit(stmt):
+            if isinstance(stmt, tir.AttrStmt) and stmt.attr_key == "async_commit_queue_scope":
+                commits.append(stmt)
+            if isinstance(stmt, tir.AttrStmt) and stmt.attr_key == "async_wait_inflight_count":
+                waits.append(stmt.value.value)
+
+        tvm.tir.stmt_functor.post_order_visit(body, visit)
+        return len(commits), sorted(waits)
+
+    # A and B are committed together, the consumer of A waits for B too.
+    assert pipelined_body({}) == (1, [3])
+    # A and B are committed apart, the consumer of A lets B and the later copies be in flight.
+    assert pipelined_body({"tir.async_buffer_commit_groups": True}) == (2, [6, 7])
+
+
 def test_three_stage_compute_two_stage_async():
     mod = tvm.IRModule.from_expr(three_stage_compute.with_attr("global_symbol", "main"))
     sch = tvm.tir.Schedule(mod)
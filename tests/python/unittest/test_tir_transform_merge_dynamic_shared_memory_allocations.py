@@ -327,6 +327,28 @@ def test_dyn_shared_more_dtype():
         check_target(target)
 
 
+def test_dyn_shared_align_bytes():
+    """The merged buffers start at the multiples of align_bytes"""
+
+    @T.prim_func
+    def func(A: T.Buffer((100,), "int8"), B: T.Buffer((100,), "int8")):
+        threadIdx_x = T.launch_thread("threadIdx.x", 100)
+        A_sh_data = T.allocate([100], "int8", "shared.dyn")
+        A_sh = T.Buffer(100, "int8", data=A_sh_data, scope="shared.dyn")
+        B_sh_data = T.allocate([100], "int8", "shared.dyn")
+        B_sh = T.Buffer(100, "int8", data=B_sh_data, scope="shared.dyn")
+        A_sh[threadIdx_x] = A[threadIdx_x]
+        B_sh[threadIdx_x] = A[threadIdx_x]
+        T.tvm_storage_sync("shared.dyn")
+        B[threadIdx_x] = A_sh[99 - threadIdx_x] + B_sh[threadIdx_x]
+
+    mod = tvm.IRModule.from_expr(func)
+    merged = tvm.tir.transform.MergeDynamicSharedMemoryAllocations()(mod)
+    verify_single_allocation(merged["main"].body, 200)
+    aligned = tvm.tir.transform.MergeDynamicSharedMemoryAllocations(align_bytes=1024)(mod)
+    verify_single_allocation(aligned["main"].body, 2048)
+
+
 class TestMatmul(tvm.testing.CompareBeforeAfter):
     """Shared allocations should be merged, preserving DeclBuffer if present
 
@@ -14,9 +14,14 @@
 # KIND, either express or implied.  See the License for the
 # specific language governing permissions and limitations
 # under the License.
+import contextlib
+
+import pytest
+
 import tvm
 import tvm.testing
-from tvm import te
+import tvm.tl.language as T
+from tvm import te, tir, tl
 
 
 def test_prim_func_pass():
@@ -63,6 +68,58 @@ def test_cow_pass():
     assert func_hash == mod["main"].__hash__()
 
 
+def _matmul(M, N, K, block_M, block_N, block_K, num_stages):
+    @T.prim_func
+    def main(
+        A: T.Buffer((M, K), "float16"),
+        B: T.Buffer((K, N), "float16"),
+        C: T.Buffer((M, N), "float16"),
+    ):
+        with T.Kernel(T.ceildiv(N, block_N), T.ceildiv(M, block_M), threads=128) as (bx, by):
+            A_shared = T.alloc_shared((block_M, block_K), "float16")
+            B_shared = T.alloc_shared((block_K, block_N), "float16")
+            C_local = T.alloc_fragment((block_M, block_N), "float32")
+            T.clear(C_local)
+            for k in T.Pipelined(T.ceildiv(K, block_K), num_stages=num_stages):
+                T.copy(A[by * block_M, k * block_K], A_shared)
+                T.copy(B[k * block_K, bx * block_N], B_shared)
+                T.gemm(A_shared, B_shared, C_local)
+            T.copy(C_local, C[by * block_M, bx * block_N])
+
+    return main
+
+
+def _lower_function_local(mod, parallel):
+    target = tvm.target.Target("cuda -arch=sm_80", host="llvm")
+    config = {"tir.parallel_function_passes": parallel}
+    with tvm.transform.PassContext(config=config):
+        mod = tir.transform.BindTarget(target)(mod)
+        mod = tl.transform.FrontendLegalize()(mod)
+        mod = tir.transform.Simplify()(mod)
+        # the function-local passes, which transform the functions in parallel
+        mod = tl.transform.LayoutInference()(mod)
+        mod = tl.transform.LowerTileOp()(mod)
+        mod = tir.transform.PlanAndUpdateBufferAllocationLocation()(mod)
+        mod = tl.transform.PipelinePlanning()(mod)
+        mod = tl.transform.InjectSoftwarePipeline()(mod)
+    return mod
+
+
+@pytest.mark.parametrize("share_iter_maps", [False, True])
+def test_parallel_function_passes(share_iter_maps):
+    funcs = {}
+    for i, (block_M, block_N) in enumerate([(64, 64), (64, 128), (128, 64), (128, 128)] * 4):
+        name = f"matmul_{i}"
+        func = _matmul(512, 512, 256 + 64 * i, block_M, block_N, 32, 2 + i % 2)
+        funcs[name] = func.with_attr("global_symbol", name)
+
+    serial = _lower_function_local(tvm.IRModule(funcs), parallel=False)
+    # the workers do not see the iter maps shared by a scope on the calling thread
+    with tvm.arith.IterMapCacheScope() if share_iter_maps else contextlib.nullcontext():
+        parallel = _lower_function_local(tvm.IRModule(funcs), parallel=True)
+    assert len(parallel.functions) == len(funcs)
+    tvm.ir.assert_structural_equal(parallel, serial)
+
+
 if __name__ == "__main__":
-    test_cow_pass()
-    test_prim_func_pass()
+    tvm.testing.main()
@@ -14,8 +14,13 @@
 # KIND, either express or implied.  See the License for the
 # specific language governing permissions and limitations
 # under the License.
+import numpy as np
+import pytest
+
 import tvm
+import tvm.testing
 from tvm import te
+from tvm.script import tir as T
 
 
 def test_vectorize_loop():
@@ -226,6 +231,129 @@ def test_vectorize_dtype_mismatch():
     tvm.lower(s, [A], "llvm", simple_mode=True)
 
 
+
+def _vectorize_tail(dtype, value):
+    n = te.var("n")
+    ib = tvm.tir.ir_builder.create()
+    A = ib.pointer(dtype, name="A")
+    B = ib.pointer(dtype, name="B")
+    with ib.for_range(0, 4, kind="vectorize") as i:
+        with ib.if_scope(i < n):
+            A[i] = value(B[i])
+    mod = tvm.IRModule.from_expr(tvm.tir.PrimFunc([A, B, n], ib.get()))
+    with tvm.transform.PassContext(config={"tir.vectorize_masked_tail": True}):
+        return tvm.tir.transform.VectorizeLoop()(mod)["main"].body
+
+
+def test_vectorize_masked_tail():
+    stmt = _vectorize_tail("float32", lambda b: b + 1.0)
+    assert isinstance(stmt, tvm.tir.Evaluate)
+    store = stmt.value
+    assert store.op.same_as(tvm.ir.Op.get("tir.masked_store"))
+    ptr, value, mask = store.args
+    assert ptr.op.same_as(tvm.ir.Op.get("tir.address_of"))
+    assert isinstance(ptr.args[0].indices[0], tvm.tir.Ramp)
+    assert value.dtype == "float32x4"
+    assert mask.dtype == "boolx4"
+    # the load of the value is masked too
+    load = value.a
+    assert load.op.same_as(tvm.ir.Op.get("tir.masked_load"))
+    tvm.ir.assert_structural_equal(load.args[1], mask)
+    tvm.ir.assert_structural_equal(load.args[2], tvm.tir.Broadcast(tvm.tir.const(0, "float32"), 4))
+
+    # the integer divisions trap in the inactive lanes, the tail is scalarized
+    stmt = _vectorize_tail("int32", lambda b: tvm.tir.floordiv(100, b))
+    assert isinstance(stmt, tvm.tir.For)
+
+    # the masked accesses are off by default
+    n = te.var("n")
+    ib = tvm.tir.ir_builder.create()
+    A = ib.pointer("float32", name="A")
+    with ib.for_range(0, 4, kind="vectorize") as i:
+        with ib.if_scope(i < n):
+            A[i] = 1.0
+    mod = tvm.IRModule.from_expr(tvm.tir.PrimFunc([A, n], ib.get()))
+    assert isinstance(tvm.tir.transform.VectorizeLoop()(mod)["main"].body, tvm.tir.For)
+
+
+@tvm.testing.requires_llvm
+def test_vectorize_masked_tail_llvm():
+    @T.prim_func
+    def func(A: T.Buffer((16,), "float32"), B: T.Buffer((16,), "float32")):
+        for i_0 in range(4):
+            for i_1 in T.vectorized(4):
+                if i_0 * 4 + i_1 < 13:
+                    B[i_0 * 4 + i_1] = A[i_0 * 4 + i_1] * 2.0 + 1.0
+
+    with tvm.transform.PassContext(config={"tir.vectorize_masked_tail": True}):
+        assert "masked_store" in tvm.lower(func).script()
+        f = tvm.build(func, target="llvm")
+
+    dev = tvm.cpu(0)
+    a_np = np.random.uniform(size=16).astype("float32")
+    a = tvm.nd.array(a_np, dev)
+    b = tvm.nd.array(np.full(16, -1.0, "float32"), dev)
+    f(a, b)
+    # the first lane of the last vector is stored, the lanes past the extent are untouched
+    np.testing.assert_allclose(b.numpy()[:13], a_np[:13] * 2.0 + 1.0, rtol=1e-6)
+    np.testing.assert_array_equal(b.numpy()[13:], np.full(3, -1.0, "float32"))
+
+
+
+@T.prim_func
+def dynamic_extent(a: T.handle, b: T.handle, n: T.int32):
+    A = T.match_buffer(a, (16,), "float32")
+    B = T.match_buffer(b, (16,), "float32")
+    for i in T.vectorized(n):
+        B[i] = A[i] * 2.0 + 1.0
+
+
+def _vectorize_dynamic(config):
+    mod = tvm.IRModule({"main": dynamic_extent})
+    with tvm.transform.PassContext(config=config):
+        return tvm.tir.transform.VectorizeLoop()(mod)["main"]
+
+
+def test_vectorize_dynamic():
+    func = _vectorize_dynamic({})
+    n = func.params[2]
+    full, tail = func.body.seq
+    # the full vectors of 128 bits, none for a non-positive extent
+    assert isinstance(full, tvm.tir.For) and full.kind == tvm.tir.ForKind.SERIAL
+    tvm.ir.assert_structural_equal(full.extent, tvm.tir.floordiv(tvm.tir.Max(n, 0), 4))
+    assert full.body.value.dtype == "float32x4"
+    assert isinstance(full.body.indices[0], tvm.tir.Ramp)
+    # the predicated tail is scalarized without tir.vectorize_masked_tail
+    assert isinstance(tail, tvm.tir.For) and tail.extent.value == 4
+    assert isinstance(tail.body, tvm.tir.IfThenElse)
+
+    func = _vectorize_dynamic({"tir.vectorize_dynamic_vector_bits": 256})
+    full, tail = func.body.seq
+    assert full.body.value.dtype == "float32x8"
+    assert tail.extent.value == 8
+
+    func = _vectorize_dynamic({"tir.vectorize_masked_tail": True})
+    full, tail = func.body.seq
+    assert tail.value.op.same_as(tvm.ir.Op.get("tir.masked_store"))
+    assert tail.value.args[1].dtype == "float32x4"
+
+
+@tvm.testing.requires_llvm
+@pytest.mark.parametrize("masked_tail", [False, True])
+def test_vectorize_dynamic_llvm(masked_tail):
+    with tvm.transform.PassContext(config={"tir.vectorize_masked_tail": masked_tail}):
+        f = tvm.build(dynamic_extent, target="llvm")
+    dev = tvm.cpu(0)
+    a_np = np.random.uniform(size=16).astype("float32")
+    a = tvm.nd.array(a_np, dev)
+    for n in [0, -3, 3, 4, 13, 16]:
+        b = tvm.nd.array(np.full(16, -1.0, "float32"), dev)
+        f(a, b, n)
+        m = max(n, 0)
+        np.testing.assert_allclose(b.numpy()[:m], a_np[:m] * 2.0 + 1.0, rtol=1e-6)
+        np.testing.assert_array_equal(b.numpy()[m:], np.full(16 - m, -1.0, "float32"))
+
+
 if __name__ == "__main__":
     test_vectorize_vector()
     test_vectorize_with_if()
@@ -236,3 +364,8 @@ if __name__ == "__main__":
     test_vectorize_let()
     test_vectorize_while_fail()
     test_vectorize_dtype_mismatch()
+    test_vectorize_masked_tail()
+    test_vectorize_masked_tail_llvm()
+    test_vectorize_dynamic()
+    test_vectorize_dynamic_llvm(False)
+    test_vectorize_dynamic_llvm(True)
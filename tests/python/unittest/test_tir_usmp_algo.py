@@ -124,7 +124,9 @@ def test_no_pool_error():
         buffer_pool_allocations = fusmp_algo(buffer_info_arr, 0)
 
 
-@pytest.mark.parametrize("algorithm", ["greedy_by_size", "greedy_by_conflicts", "hill_climb"])
+@pytest.mark.parametrize(
+    "algorithm", ["greedy_by_size", "greedy_by_conflicts", "hill_climb", "portfolio"]
+)
 def test_name_based_ordering(algorithm):
     """This checks when the size and conlicts are same a stable result is generated"""
 
@@ -161,7 +163,12 @@ def test_name_based_ordering(algorithm):
 
 @pytest.mark.parametrize(
     ["algorithm", "workspace_size"],
-    [("greedy_by_size", 140), ("greedy_by_conflicts", 140), ("hill_climb", 140)],
+    [
+        ("greedy_by_size", 140),
+        ("greedy_by_conflicts", 140),
+        ("hill_climb", 140),
+        ("portfolio", 140),
+    ],
 )
 def test_linear(algorithm, workspace_size):
     """
@@ -223,7 +230,12 @@ def test_linear(algorithm, workspace_size):
 
 @pytest.mark.parametrize(
     ["algorithm", "workspace_size"],
-    [("greedy_by_size", 190), ("greedy_by_conflicts", 320), ("hill_climb", 190)],
+    [
+        ("greedy_by_size", 190),
+        ("greedy_by_conflicts", 320),
+        ("hill_climb", 190),
+        ("portfolio", 190),
+    ],
 )
 def test_fanout(algorithm, workspace_size):
     """
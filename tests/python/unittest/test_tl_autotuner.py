@@ -0,0 +1,47 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+import tvm
+import tvm.testing
+from tvm import tir
+from tvm.tl.autotuner import _ResourceCollector
+
+
+def _alloc_func(shapes, scope):
+    n = tir.Var("n", "int32")
+    buffers = [tir.decl_buffer(shape(n), "float16", scope=scope) for shape in shapes]
+    block = tir.Block([], [], [], "root", tir.Evaluate(0), alloc_buffers=buffers)
+    return tir.PrimFunc([n], tir.BlockRealize([], True, block))
+
+
+def test_resource_collector_static_shape():
+    func = _alloc_func([lambda n: (64, 32)], "shared.dyn")
+    assert _ResourceCollector(func).shared_memory() == 64 * 32 * 2
+
+
+def test_resource_collector_dynamic_shape():
+    # a bounded dynamic extent is counted by its upper bound
+    func = _alloc_func([lambda n: (tir.min(n, 128), 32)], "shared.dyn")
+    assert _ResourceCollector(func).shared_memory() == 128 * 32 * 2
+    # an unbounded one is not counted
+    func = _alloc_func([lambda n: (n, 32), lambda n: (16, 32)], "shared.dyn")
+    assert _ResourceCollector(func).shared_memory() == 16 * 32 * 2
+    func = _alloc_func([lambda n: (n, 32)], "local.fragment")
+    assert _ResourceCollector(func).registers_per_thread() == 0
+
+
+if __name__ == "__main__":
+    tvm.testing.main()
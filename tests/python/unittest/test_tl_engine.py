@@ -0,0 +1,51 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+import pytest
+
+import tvm
+import tvm.testing
+from tvm.tl.engine import _get_cuda_compile_options
+
+
+def _arch_flags(arch, cuda_archs):
+    target = tvm.target.Target(f"cuda -arch={arch}")
+    with tvm.transform.PassContext(config={"tl.cuda_archs": cuda_archs}):
+        return _get_cuda_compile_options(target)[0]
+
+
+def test_cuda_archs_fatbin():
+    assert _arch_flags("sm_80", [80, 90]) == [
+        "-gencode=arch=compute_80,code=sm_80",
+        "-gencode=arch=compute_90,code=sm_90",
+        "-gencode=arch=compute_90,code=compute_90",
+    ]
+
+
+def test_cuda_archs_arch_specific():
+    # The PTX of sm_90a is not forward compatible, only its SASS is emitted.
+    assert _arch_flags("sm_90", [90]) == ["-gencode=arch=compute_90a,code=sm_90a"]
+    with pytest.raises(ValueError, match="only run on sm_90"):
+        _arch_flags("sm_90", [90, 100])
+
+
+def test_cuda_archs_older_than_target():
+    with pytest.raises(ValueError, match="can not run on sm_80"):
+        _arch_flags("sm_90", [80])
+
+
+if __name__ == "__main__":
+    tvm.testing.main()
@@ -0,0 +1,125 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+import gc
+import os
+
+import pytest
+
+import tvm
+import tvm.testing
+from tvm import tl
+import tvm.tl.language as T
+
+torch = pytest.importorskip("torch")
+
+
+def _add_one_program(n, block):
+    @T.prim_func
+    def main(A: T.Buffer((n,), "float32"), B: T.Buffer((n,), "float32")):
+        with T.Kernel(n // block, threads=block) as bx:
+            for i in T.Parallel(block):
+                B[bx * block + i] = A[bx * block + i] + 1.0
+
+    return main
+
+
+@tvm.testing.requires_cuda
+def test_raw_kernel_unpacked_entry_checks_arguments():
+    n = 1024
+    with tvm.transform.PassContext(config={"tir.make_packed_api.emit_unpacked": True}):
+        mod, _ = tl.lower(_add_one_program(n, 128))
+    kernel = tl.RawKernel(mod, "main")
+    assert kernel.unpacked_entry is not None
+
+    a = torch.randn(n, device="cuda")
+    b = torch.empty(n, device="cuda")
+    # the first call goes through the checked host function, the second through the unpacked entry
+    for _ in range(2):
+        b.zero_()
+        kernel(a, b)
+        torch.testing.assert_close(b, a + 1)
+    assert kernel._checked_signature is not None
+
+    # a strided view of the same shape is not taken by the unpacked entry
+    a_strided = torch.randn(2 * n, device="cuda")[::2]
+    kernel(a_strided, b)
+    torch.testing.assert_close(b, a_strided + 1)
+
+    # the host function rejects the arguments the unpacked entry would have accepted blindly
+    with pytest.raises(tvm.TVMError):
+        kernel(torch.randn(2 * n, device="cuda"), torch.empty(2 * n, device="cuda"))
+    with pytest.raises(tvm.TVMError):
+        kernel(a.half(), b.half())
+    with pytest.raises(tvm.TVMError):
+        kernel(a.cpu(), b.cpu())
+
+
+@tvm.testing.requires_cuda
+def test_raw_kernel_removes_temp_dir():
+    n = 1024
+    mod, _ = tl.lower(_add_one_program(n, 128))
+    kernel = tl.RawKernel(mod, "main")
+    tmp_dir = os.path.dirname(kernel.library_path)
+    assert os.path.exists(kernel.library_path)
+    del kernel
+    gc.collect()
+    assert not os.path.exists(tmp_dir)
+
+
+@tvm.testing.requires_cuda
+def test_set_tvm_stream_invalidated():
+    from tvm.tl.utils import _stream_state  # pylint: disable=import-outside-toplevel
+
+    stream = torch.cuda.Stream()
+    tl.set_tvm_stream(stream)
+    key = _stream_state.stream
+    assert key[:2] == (torch.cuda.current_device(), stream.cuda_stream)
+    # a destroyed stream is set again even if the new one has the same handle
+    tl.invalidate_tvm_stream(stream)
+    assert _stream_state.stream is None
+    tl.set_tvm_stream(stream)
+    assert _stream_state.stream[:2] == key[:2] and _stream_state.stream != key
+
+    partition = tl.SMPartition(torch.cuda.get_device_properties(0).multi_processor_count)
+    tl.set_tvm_stream(partition)
+    del partition
+    gc.collect()
+    assert _stream_state.stream is None
+
+
+@tvm.testing.requires_cuda
+def test_convert_torch_out_checks_tensor():
+    n = 1024
+    mod, params = tl.lower(_add_one_program(n, 128))
+    kernel = tl.ConvertTorch(mod, params, [1])
+    a = torch.randn(n, device="cuda")
+    out = torch.empty(n, device="cuda")
+    assert kernel(a, out=out) is out
+    torch.testing.assert_close(out, a + 1)
+
+    with pytest.raises(AssertionError, match="torch.float32"):
+        kernel(a, out=torch.empty(n, device="cuda", dtype=torch.float16))
+    with pytest.raises(AssertionError, match="shape"):
+        kernel(a, out=torch.empty(2 * n, device="cuda"))
+    with pytest.raises(AssertionError, match="cuda"):
+        kernel(a, out=torch.empty(n))
+    with pytest.raises(AssertionError, match="contiguous"):
+        kernel(a, out=torch.empty(2 * n, device="cuda")[::2])
+
+
+if __name__ == "__main__":
+    tvm.testing.main()
@@ -0,0 +1,66 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+import tvm
+import tvm.testing
+from tvm.tl.layout import Fragment, Layout
+
+
+def _assert_equal(a, b):
+    assert tvm.ir.structural_equal(a, b)
+    assert tvm.ir.structural_hash(a) == tvm.ir.structural_hash(b)
+
+
+def _assert_not_equal(a, b):
+    assert not tvm.ir.structural_equal(a, b)
+    assert tvm.ir.structural_hash(a) != tvm.ir.structural_hash(b)
+
+
+def test_layout_structural_equal():
+    row_major = Layout((8, 16), lambda i, j: i * 16 + j)
+    # The input variables are fresh for each layout, mapped by their position.
+    _assert_equal(row_major, Layout((8, 16), lambda i, j: i * 16 + j))
+    _assert_not_equal(row_major, Layout((8, 16), lambda i, j: j * 8 + i))
+    _assert_not_equal(row_major, Layout((16, 8), lambda i, j: i * 8 + j))
+    _assert_not_equal(row_major, Layout((8, 16), lambda i, j: [i, j]))
+
+
+def test_layout_hash_is_stable():
+    layout = Layout((8, 16), lambda i, j: i * 16 + j)
+    assert tvm.ir.structural_hash(layout) == tvm.ir.structural_hash(layout)
+    # The layouts are compared structurally as the fields of other nodes.
+    _assert_equal([layout, 1], [Layout((8, 16), lambda i, j: i * 16 + j), 1])
+
+
+def test_fragment_structural_equal():
+    def thread(i, j):
+        return i * 4 + j // 2
+
+    fragment = Fragment((8, 8), thread)
+    _assert_equal(fragment, Fragment((8, 8), thread))
+    # The same index with another thread mapping.
+    _assert_not_equal(fragment, Fragment((8, 8), lambda i, j: j * 4 + i // 2))
+    # Replicated on another thread.
+    replicated = Fragment((8, 8), lambda i, j, rep: thread(i, j) + rep * 32, replicate=2)
+    _assert_not_equal(fragment, replicated)
+    _assert_equal(
+        replicated, Fragment((8, 8), lambda i, j, rep: thread(i, j) + rep * 32, replicate=2)
+    )
+    _assert_not_equal(fragment, Layout((8, 8), lambda i, j: i * 8 + j))
+
+
+if __name__ == "__main__":
+    tvm.testing.main()
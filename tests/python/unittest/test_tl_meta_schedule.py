@@ -0,0 +1,77 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+import numpy as np
+
+import tvm
+import tvm.testing
+from tvm import meta_schedule as ms
+from tvm import relay, tir
+from tvm.contrib import graph_executor
+from tvm.tl import meta_schedule as tl_ms
+
+
+def _dense_module(M, N, K):
+    data = relay.var("data", shape=(M, K), dtype="float16")
+    weight = relay.var("weight", shape=(N, K), dtype="float16")
+    out = relay.nn.dense(data, weight, out_dtype="float32")
+    return tvm.IRModule.from_expr(relay.Function([data, weight], out))
+
+
+def _sources(mod):
+    yield mod.type_key, mod.get_source() if mod.type_key in ("cuda", "c") else ""
+    for imported in mod.imported_modules:
+        yield from _sources(imported)
+
+
+@tvm.testing.requires_cuda
+def test_relay_dense_with_gemm_config():
+    M, N, K = 256, 256, 128
+    target = tvm.target.Target("cuda")
+    mod = _dense_module(M, N, K)
+    tasks = ms.relay_integration.extract_tasks(mod, target, {})
+    database = ms.database.MemoryDatabase()
+    annotated = 0
+    for task in tasks:
+        workload = task.dispatched[0]
+        sch = tir.Schedule(workload)
+        if tl_ms.match_gemm(workload["main"]) is None:
+            continue
+        tl_ms.schedule_gemm(sch, target)
+        database.commit_tuning_record(
+            ms.database.TuningRecord(
+                sch.trace, database.commit_workload(workload), [1.0], target=target
+            )
+        )
+        annotated += 1
+    assert annotated == 1
+
+    lib = ms.relay_integration.compile_relay(database, mod, target, {})
+    sources = [source for kind, source in _sources(lib.get_lib()) if kind == "cuda"]
+    assert any("tl::gemm" in source for source in sources)
+
+    data = np.random.uniform(-1, 1, (M, K)).astype("float16")
+    weight = np.random.uniform(-1, 1, (N, K)).astype("float16")
+    dev = tvm.cuda()
+    runtime = graph_executor.GraphModule(lib["default"](dev))
+    runtime.set_input(data=data, weight=weight)
+    runtime.run()
+    expected = data.astype("float32") @ weight.astype("float32").T
+    tvm.testing.assert_allclose(runtime.get_output(0).numpy(), expected, rtol=1e-2, atol=1e-2)
+
+
+if __name__ == "__main__":
+    tvm.testing.main()
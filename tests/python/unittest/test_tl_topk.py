@@ -0,0 +1,66 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+import numpy as np
+
+import tvm
+import tvm.testing
+from tvm import tl
+import tvm.tl.language as T
+
+
+def _topk_program(rows, n, k, tiles):
+    @T.prim_func
+    def main(
+        A: T.Buffer((rows, tiles * n), "float32"),
+        Values: T.Buffer((rows, k), "float32"),
+        Indices: T.Buffer((rows, k), "int32"),
+    ):
+        with T.Kernel(1, threads=128) as _:
+            src = T.alloc_shared((rows, n), "float32")
+            values = T.alloc_shared((rows, k), "float32")
+            indices = T.alloc_shared((rows, k), "int32")
+            T.fill(values, -T.infinity("float32"))
+            T.fill(indices, -1)
+            for t in T.serial(tiles):
+                T.copy(A[0, t * n], src)
+                T.topk(src, values, indices, t * n, merge=True)
+            T.copy(values, Values)
+            T.copy(indices, Indices)
+
+    return main
+
+
+@tvm.testing.requires_cuda
+def test_topk_ties_by_index():
+    # The few distinct values tie far more often than k, the ties must be taken and ordered by
+    # index, within a tile and across the merged tiles.
+    rows, n, k = 4, 512, 16
+    for tiles in [1, 2]:
+        mod, _ = tl.lower(_topk_program(rows, n, k, tiles))
+        a_np = np.random.randint(0, 4, size=(rows, tiles * n)).astype("float32")
+        dev = tvm.cuda(0)
+        a = tvm.nd.array(a_np, dev)
+        values = tvm.nd.empty((rows, k), "float32", dev)
+        indices = tvm.nd.empty((rows, k), "int32", dev)
+        mod(a, values, indices)
+        expected = np.argsort(-a_np, axis=-1, kind="stable")[:, :k]
+        np.testing.assert_equal(indices.numpy(), expected)
+        np.testing.assert_equal(values.numpy(), np.take_along_axis(a_np, expected, axis=-1))
+
+
+if __name__ == "__main__":
+    tvm.testing.main()
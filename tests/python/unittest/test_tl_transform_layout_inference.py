@@ -0,0 +1,80 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+import tvm
+import tvm.testing
+from tvm import tl, tir
+import tvm.tl.language as T
+
+
+def _gemm_store_program(n, pad):
+    @T.prim_func
+    def main(
+        A: T.Buffer((n, n), "float16"),
+        B: T.Buffer((n, n), "float16"),
+        C: T.Buffer((n, n), "float16"),
+    ):
+        with T.Kernel(1, threads=128) as _:
+            A_shared = T.alloc_shared((n, n), "float16")
+            B_shared = T.alloc_shared((n, n), "float16")
+            # the shared memory used by the rest of the kernel
+            pad_shared = T.alloc_shared((pad,), "float16")
+            C_local = T.alloc_fragment((n, n), "float32")
+            T.clear(C_local)
+            T.copy(A, A_shared)
+            T.copy(B, B_shared)
+            T.fill(pad_shared, 0)
+            T.gemm(A_shared, B_shared, C_local)
+            for i, j in T.Parallel(n, n):
+                C[i, j] = C_local[i, j]
+
+    return main
+
+
+def _staging_buffers(func, config=None):
+    target = tvm.target.Target("cuda -arch=sm_80", host="llvm")
+    mod = tvm.IRModule({"main": func})
+    with tvm.transform.PassContext(config=config or {}):
+        mod = tir.transform.BindTarget(target)(mod)
+        mod = tl.transform.FrontendLegalize()(mod)
+        mod = tir.transform.Simplify()(mod)
+        mod = tl.transform.LayoutInference()(mod)
+    names = []
+
+    def visit(node):
+        if isinstance(node, tir.Block):
+            names.extend(buffer.name for buffer in node.alloc_buffers)
+
+    tir.stmt_functor.post_order_visit(mod["main"].body, visit)
+    return [name for name in names if name.endswith("_staging")]
+
+
+def test_fragment_store_staging():
+    assert _staging_buffers(_gemm_store_program(128, 8)) == ["C_local_staging"]
+
+
+def test_fragment_store_staging_over_budget():
+    # 64KB of operands and 80KB of pad leave less than the 32KB of the staging buffer on sm_80
+    assert not _staging_buffers(_gemm_store_program(128, 40960))
+
+
+def test_fragment_store_staging_disabled():
+    config = {"tl.disable_smem_staging": True}
+    assert not _staging_buffers(_gemm_store_program(128, 8), config)
+
+
+if __name__ == "__main__":
+    tvm.testing.main()
@@ -0,0 +1,96 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+import tvm
+import tvm.testing
+from tvm import tl, tir
+import tvm.tl.language as T
+
+
+def _gemm_program(M, N, K, dtype, accum_dtype):
+    @T.prim_func
+    def main(
+        A: T.Buffer((M, K), dtype),
+        B: T.Buffer((K, N), dtype),
+        C: T.Buffer((M, N), accum_dtype),
+    ):
+        with T.Kernel(1, threads=128) as _:
+            A_shared = T.alloc_shared((M, K), dtype)
+            B_shared = T.alloc_shared((K, N), dtype)
+            C_local = T.alloc_fragment((M, N), accum_dtype)
+            T.clear(C_local)
+            T.copy(A, A_shared)
+            T.copy(B, B_shared)
+            T.gemm(A_shared, B_shared, C_local)
+            T.copy(C_local, C)
+
+    return main
+
+
+def _lowered_calls(func, config=None, arch="sm_80"):
+    target = tvm.target.Target(f"cuda -arch={arch}", host="llvm")
+    mod = tvm.IRModule({"main": func})
+    with tvm.transform.PassContext(config=config or {}):
+        mod = tir.transform.BindTarget(target)(mod)
+        mod = tl.transform.FrontendLegalize()(mod)
+        mod = tir.transform.Simplify()(mod)
+        mod = tl.transform.LayoutInference()(mod)
+        mod = tl.transform.LowerTileOp()(mod)
+    calls = []
+
+    def visit(node):
+        if isinstance(node, tir.Call):
+            if node.op.same_as(tvm.ir.Op.get("tir.call_extern")):
+                calls.append(str(node.args[0].value).split("<")[0])
+            else:
+                calls.append(node.op.name)
+
+    tir.stmt_functor.post_order_visit(mod["main"].body, visit)
+    return calls
+
+
+def test_gemm_ptx_mma():
+    config = {"tl.gemm_ptx_mma": True}
+    calls = _lowered_calls(_gemm_program(64, 64, 64, "float16", "float32"), config)
+    assert "tir.ptx_ldmatrix" in calls
+    assert "tir.ptx_mma" in calls
+    assert "tl::gemm_ss" not in calls
+
+
+def test_gemm_ptx_mma_bfloat16():
+    config = {"tl.gemm_ptx_mma": True}
+    calls = _lowered_calls(_gemm_program(64, 64, 64, "bfloat16", "float32"), config)
+    assert "tir.ptx_mma" in calls and "tl::gemm_ss" not in calls
+
+
+def test_gemm_ptx_mma_disabled():
+    calls = _lowered_calls(_gemm_program(64, 64, 64, "float16", "float32"))
+    assert "tl::gemm_ss" in calls
+    assert "tir.ptx_mma" not in calls and "tir.ptx_ldmatrix" not in calls
+
+
+def test_gemm_ptx_mma_unsupported():
+    # The tf32 gemm keeps the CUTLASS templates.
+    config = {"tl.gemm_ptx_mma": True}
+    calls = _lowered_calls(_gemm_program(64, 64, 64, "float32", "float32"), config)
+    assert "tl::gemm_ss" in calls and "tir.ptx_mma" not in calls
+    # and so do the gemms of the targets before sm_80.
+    calls = _lowered_calls(_gemm_program(64, 64, 64, "float16", "float32"), config, "sm_75")
+    assert "tl::gemm_ss" in calls and "tir.ptx_mma" not in calls
+
+
+if __name__ == "__main__":
+    tvm.testing.main()
@@ -0,0 +1,73 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+import tvm
+import tvm.testing
+from tvm import tl
+from tvm.script import tir as T
+
+
+def _count(stmt, node_type):
+    nodes = []
+    tvm.tir.stmt_functor.post_order_visit(
+        stmt, lambda n: nodes.append(n) if isinstance(n, node_type) else None
+    )
+    return nodes
+
+
+def test_unroll_with_let():
+    @T.prim_func
+    def func(A: T.Buffer((8,), "float32"), B: T.Buffer((8,), "float32")):
+        acc = T.decl_buffer((8,), "float32", scope="local")
+        for i in range(8):
+            v: T.float32 = A[i] * T.float32(2)
+            acc[i] = v
+        for i in range(8):
+            B[i] = acc[i]
+
+    mod = tl.transform.PromoteLocalArray()(tvm.IRModule.from_expr(func))
+    body = mod["main"].body
+    assert not _count(body, tvm.tir.For)
+    lets = _count(body, tvm.tir.LetStmt)
+    assert len(lets) == 8
+    # the copies of the body bind distinct vars, as required by the analyzer of Simplify
+    assert len({let.var for let in lets}) == 8
+    mod = tvm.tir.transform.Simplify()(mod)
+    assert not _count(mod["main"].body, tvm.tir.For)
+
+
+def test_select_in_unrolled_loop():
+    @T.prim_func
+    def func(A: T.Buffer((4,), "float32"), idx: T.Buffer((4,), "int32")):
+        acc = T.decl_buffer((4,), "float32", scope="local")
+        for i in range(4):
+            acc[i] = A[i]
+            acc[idx[i]] = acc[idx[i]] + T.float32(1)
+        for i in range(4):
+            A[i] = acc[i]
+
+    mod = tl.transform.PromoteLocalArray()(tvm.IRModule.from_expr(func))
+    body = mod["main"].body
+    assert not _count(body, tvm.tir.For)
+    # the select chain of the store is copied by the unrolling of its loop
+    lets = _count(body, tvm.tir.LetStmt)
+    assert len(lets) == 8
+    assert len({let.var for let in lets}) == 8
+    tvm.tir.transform.Simplify()(mod)
+
+
+if __name__ == "__main__":
+    tvm.testing.main()
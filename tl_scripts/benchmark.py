@@ -0,0 +1,146 @@
+"""Benchmark the kernels of tl_scripts over a fixed matrix of shapes against the vendor libraries
+(torch.matmul on cuBLAS, torch.conv2d on cuDNN, FlashAttention), save the results of the GPU as
+JSON and flag the cases slower than a previous run.
+
+    python benchmark.py --output results
+    python benchmark.py --output results --baseline results/NVIDIA_A100-SXM4-80GB.json
+"""
+
+import argparse
+import json
+import os
+import sys
+from functools import partial
+
+import torch
+from tvm import tl
+
+from conv_example import convolution, ref_program as conv_ref
+from dgemm_example import dgemm, ref_program as dgemm_ref
+from gemm_example import matmul, ref_program as gemm_ref
+from mha_example import flashattn, ref_program as mha_ref
+from reduce_example import reduce_sum, ref_program as reduce_ref
+from rms_norm import rms_norm, ref_program as rms_norm_ref
+from splitk_example import matmul_splitk, ref_program as splitk_ref
+
+
+def make_cases():
+    """The cases by name: (program, result_idx, supply type, baseline, flops, tolerance)."""
+    Integer, Normal = tl.TensorSupplyType.Integer, tl.TensorSupplyType.Normal
+    cases = {}
+    # the projections of LLM prefill and decode
+    for M, N, K in [(4096, 4096, 4096), (8192, 8192, 8192), (4096, 11008, 4096), (128, 4096, 4096)]:
+        program = matmul(M, N, K, 128, 128, 32)
+        cases[f"gemm_{M}x{N}x{K}"] = (program, [2], Integer, gemm_ref, 2 * M * N * K, 0)
+    # the float64 gemms of the scientific codes, against cuBLAS DGEMM
+    for M, N, K in [(4096, 4096, 4096), (8192, 8192, 8192)]:
+        program = dgemm(M, N, K, 64, 64, 16)
+        cases[f"dgemm_{M}x{N}x{K}"] = (program, [2], Normal, dgemm_ref, 2 * M * N * K, 0)
+    for M, N, K, split in [(128, 4096, 16384, 4), (8192, 8192, 8192, 4)]:
+        program = matmul_splitk(M, N, K, 128, 128, 32, split)
+        cases[f"splitk_{M}x{N}x{K}_{split}"] = (program, [2], Integer, splitk_ref, 2 * M * N * K, 0)
+    # the attention of LLM prefill
+    for batch, heads, seq_len, dim, causal in [(4, 32, 2048, 128, True), (4, 32, 2048, 128, False)]:
+        program = flashattn(batch, heads, seq_len, dim, causal, 64, 64)
+        flops = 4 * batch * heads * seq_len * seq_len * dim // (2 if causal else 1)
+        name = f"mha_{batch}x{heads}x{seq_len}x{dim}" + ("_causal" if causal else "")
+        cases[name] = (program, [3], Normal, partial(mha_ref, casual=causal), flops, 0.01)
+    # the 3x3 convolutions of vision backbones
+    conv_shapes = [(32, 128, 28, 28, 128), (32, 256, 14, 14, 256), (8, 256, 128, 128, 256)]
+    for N, C, H, W, INC in conv_shapes:
+        program = convolution(N, C, H, W, INC, 3, 3, 1, 1, 1)
+        baseline = partial(conv_ref, stride=1, padding=1, dilation=1)
+        flops = 2 * N * C * H * W * INC * 3 * 3
+        cases[f"conv_{N}x{H}x{W}x{INC}_{C}"] = (program, [2], Integer, baseline, flops, 0)
+    # the memory bound kernels
+    for M, N in [(4096, 4096), (8192, 8192)]:
+        cases[f"rms_norm_{M}x{N}"] = (rms_norm(M, N, 1), [1], Normal, rms_norm_ref, 0, 1e-5)
+        program = reduce_sum(M, N, 64, 128)
+        cases[f"reduce_sum_{M}x{N}"] = (program, [1], Integer, reduce_ref, 0, 0)
+    return cases
+
+
+def run_case(case, args):
+    program, result_idx, supply, baseline, flops, tolerance = case
+    mod, params = tl.lower(program)
+    profiler = tl.Profiler(mod, params, result_idx, supply)
+    if args.check:
+        profiler.assert_allclose(baseline, rtol=max(tolerance, 1e-5), atol=max(tolerance, 1e-8))
+    entry = profiler.summarize(program, warmup=args.warmup, rep=args.rep).to_dict()
+    if flops:
+        # the useful flops, e.g. without the masked tiles of the causal attention
+        entry["flops"] = flops
+        entry["tflops"] = flops / entry["latency_ms"] * 1e-9
+    try:
+        entry["baseline_ms"] = profiler.do_bench(baseline, warmup=args.warmup, rep=args.rep)
+        entry["speedup"] = entry["baseline_ms"] / entry["latency_ms"]
+    except Exception as err:  # pylint: disable=broad-except
+        # e.g. flash_attn is not installed
+        print(f"  no baseline: {err}")
+    return entry
+
+
+def compare(results, previous, threshold):
+    """The cases slower than in the previous results by more than threshold (relative)."""
+    regressions = []
+    for name, entry in results.items():
+        old = previous.get(name, {})
+        if "latency_ms" not in entry or "latency_ms" not in old:
+            continue
+        ratio = entry["latency_ms"] / old["latency_ms"]
+        if ratio > 1 + threshold:
+            regressions.append((name, old["latency_ms"], entry["latency_ms"], ratio))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--output", default="results", help="the directory of the JSON results")
+    parser.add_argument("--baseline", help="the JSON results of a previous run to compare to")
+    parser.add_argument("--threshold", type=float, default=0.05, help="the allowed slowdown")
+    parser.add_argument("--filter", default="", help="run the cases whose name contains it")
+    parser.add_argument("--check", action="store_true", help="check the outputs to the baselines")
+    parser.add_argument("--warmup", type=int, default=25)
+    parser.add_argument("--rep", type=int, default=100)
+    args = parser.parse_args()
+
+    gpu = torch.cuda.get_device_name()
+    results = {}
+    for name, case in make_cases().items():
+        if args.filter not in name:
+            continue
+        print(name)
+        try:
+            results[name] = run_case(case, args)
+        except Exception as err:  # pylint: disable=broad-except
+            print(f"  failed: {err}")
+            results[name] = {"error": str(err)}
+            continue
+        entry = results[name]
+        line = f"  {entry['latency_ms']:.3f} ms, {entry['roofline']:.0%} of roofline"
+        if "speedup" in entry:
+            line += f", {entry['speedup']:.2f}x the baseline"
+        print(line)
+
+    os.makedirs(args.output, exist_ok=True)
+    path = os.path.join(args.output, gpu.replace(" ", "_") + ".json")
+    with open(path, "w") as f:
+        json.dump({"gpu": gpu, "results": results}, f, indent=2)
+    print(f"saved {path}")
+
+    failed = [name for name, entry in results.items() if "error" in entry]
+    regressions = []
+    if args.baseline:
+        with open(args.baseline) as f:
+            previous = json.load(f)
+        if previous.get("gpu") != gpu:
+            print(f"warning: comparing {gpu} to results of {previous.get('gpu')}")
+        regressions = compare(results, previous["results"], args.threshold)
+        for name, old, new, ratio in regressions:
+            print(f"REGRESSION {name}: {old:.3f} ms -> {new:.3f} ms ({ratio - 1:+.1%})")
+    if failed or regressions:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,117 @@
+"""Track the compile time of the kernels of tl_scripts (the cases of benchmark.py): time tl.lower
+per pass with CompileProfile, save the results of the commit as JSON and flag the cases and the
+passes slower than a previous run.
+
+    python compile_benchmark.py --output compile_results
+    python compile_benchmark.py --output compile_results --baseline compile_results/<commit>.json
+
+The kernel cache is pointed to an empty directory, so that nvcc runs on each compilation.
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+
+from tvm import tl
+
+from benchmark import make_cases
+
+
+def git_commit():
+    try:
+        command = ["git", "rev-parse", "--short", "HEAD"]
+        return subprocess.run(command, capture_output=True, check=True).stdout.decode().strip()
+    except (OSError, subprocess.CalledProcessError):
+        return "unknown"
+
+
+def compile_case(program, repeat):
+    """The fastest of repeat compilations: its total seconds and its seconds per pass."""
+    best = None
+    for _ in range(repeat):
+        with tempfile.TemporaryDirectory(prefix="tl_compile_bench_") as cache_dir:
+            os.environ["TL_KERNEL_CACHE_DIR"] = cache_dir
+            profile = tl.CompileProfile()
+            tl.lower(program, profile=profile)
+        if best is None or profile.total_seconds < best.total_seconds:
+            best = profile
+    return {"total_seconds": best.total_seconds, "passes": best.by_pass(), "profile": best}
+
+
+def compare(results, previous, threshold, min_seconds):
+    """The cases and passes slower than in the previous results by more than threshold
+    (relative), ignoring the passes faster than min_seconds in both runs."""
+    regressions = []
+    for name, entry in results.items():
+        old = previous.get(name, {})
+        if "total_seconds" not in entry or "total_seconds" not in old:
+            continue
+        ratio = entry["total_seconds"] / old["total_seconds"]
+        if ratio > 1 + threshold:
+            regressions.append((name, old["total_seconds"], entry["total_seconds"], ratio))
+        for pass_name, seconds in entry["passes"].items():
+            old_seconds = old["passes"].get(pass_name)
+            if old_seconds is None or max(seconds, old_seconds) < min_seconds:
+                continue
+            ratio = seconds / max(old_seconds, 1e-9)
+            if ratio > 1 + threshold:
+                regressions.append((f"{name} {pass_name}", old_seconds, seconds, ratio))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--output", default="compile_results", help="the directory of the JSON")
+    parser.add_argument("--baseline", help="the JSON results of a previous run to compare to")
+    parser.add_argument("--threshold", type=float, default=0.2, help="the allowed slowdown")
+    parser.add_argument(
+        "--min-seconds", type=float, default=0.05, help="the passes faster than it are not compared"
+    )
+    parser.add_argument("--filter", default="", help="run the cases whose name contains it")
+    parser.add_argument("--repeat", type=int, default=3, help="compile each case this many times")
+    parser.add_argument("--verbose", action="store_true", help="print the table of each case")
+    args = parser.parse_args()
+
+    commit = git_commit()
+    results = {}
+    for name, case in make_cases().items():
+        if args.filter not in name:
+            continue
+        print(name)
+        try:
+            entry = compile_case(case[0], args.repeat)
+        except Exception as err:  # pylint: disable=broad-except
+            print(f"  failed: {err}")
+            results[name] = {"error": str(err)}
+            continue
+        profile = entry.pop("profile")
+        if args.verbose:
+            print(profile.table())
+        slowest = sorted(entry["passes"].items(), key=lambda item: -item[1])[:3]
+        summary = ", ".join(f"{pass_name} {seconds * 1e3:.0f} ms" for pass_name, seconds in slowest)
+        print(f"  {entry['total_seconds'] * 1e3:.0f} ms ({summary})")
+        results[name] = entry
+
+    os.makedirs(args.output, exist_ok=True)
+    path = os.path.join(args.output, commit + ".json")
+    with open(path, "w") as f:
+        json.dump({"commit": commit, "results": results}, f, indent=2)
+    print(f"saved {path}")
+
+    failed = [name for name, entry in results.items() if "error" in entry]
+    regressions = []
+    if args.baseline:
+        with open(args.baseline) as f:
+            previous = json.load(f)
+        regressions = compare(results, previous["results"], args.threshold, args.min_seconds)
+        for name, old, new, ratio in regressions:
+            print(f"REGRESSION {name}: {old * 1e3:.1f} ms -> {new * 1e3:.1f} ms ({ratio - 1:+.1%})")
+    if failed or regressions:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -34,20 +34,17 @@ def convolution(N, C, H, W, INC, KW, KH, P, S, D):
 
             T.clear(out_local)
             for k_iter in T.Pipelined(T.ceildiv(KH * KW * INC, block_K), num_stages=3):
-                for i, j in T.Parallel(block_M, block_K):
-                    k = k_iter * block_K + j
-                    m = by * block_M + i
-                    access_h = m % (H * W) // W * S + k // (KW * INC) * D - P
-                    access_w = m % W * S + k // INC % KW * D - P
-                    in_bound = (
-                        (access_h >= 0)
-                        and (access_w >= 0)
-                        and (access_h < INH)
-                        and (access_w < INW)
-                    )
-                    data_shared[i, j] = T.if_then_else(
-                        in_bound, data[m // (H * W), access_h, access_w, k % INC], 0
-                    )
+                T.im2col_copy(
+                    data,
+                    data_shared,
+                    by * block_M,
+                    k_iter * block_K,
+                    (H, W),
+                    (KH, KW),
+                    stride=S,
+                    padding=P,
+                    dilation=D,
+                )
                 T.copy(kernel_flat[k_iter * block_K, bx * block_N], kernel_shared)
                 T.gemm(data_shared, kernel_shared, out_local)
 
@@ -0,0 +1,136 @@
+import torch
+from tvm import tl
+import tvm.tl.language as T
+
+
+def decode_attention(
+    batch, heads, kv_heads, dim, max_pos, page_size, max_pages, num_pages, block_N
+):
+    """A decode step of a GQA layer with a paged KV cache in a single kernel: the rotary embedding
+    of the new Q and K in registers, the append of the new K and V to the cache, and the attention
+    of the heads of a KV head over the cached tokens and the new one."""
+    groups = heads // kv_heads
+    sm_scale = (1.0 / dim) ** 0.5
+    dtype = "float16"
+    accum_dtype = "float"
+    cache_shape = (num_pages, page_size, kv_heads, dim)
+    flat_shape = (num_pages * page_size, kv_heads, dim)
+
+    @T.prim_func
+    def main(
+        Q: T.Buffer((batch, heads, dim), dtype),
+        K_new: T.Buffer((batch, kv_heads, dim), dtype),
+        V_new: T.Buffer((batch, kv_heads, dim), dtype),
+        cos: T.Buffer((max_pos, dim // 2), "float32"),
+        sin: T.Buffer((max_pos, dim // 2), "float32"),
+        positions: T.Buffer((batch,), "int32"),
+        block_table: T.Buffer((batch, max_pages), "int32"),
+        K_cache: T.Buffer(cache_shape, dtype),
+        V_cache: T.Buffer(cache_shape, dtype),
+        Output: T.Buffer((batch, heads, dim), dtype),
+    ):
+        K_flat = T.Buffer(flat_shape, dtype, K_cache.data)
+        V_flat = T.Buffer(flat_shape, dtype, V_cache.data)
+        with T.Kernel(kv_heads, batch, threads=128) as (bx, by):
+            Q_local = T.alloc_fragment([groups, dim], dtype)
+            Q_shared = T.alloc_shared([groups, dim], dtype)
+            K_local = T.alloc_fragment([1, dim], dtype)
+            V_local = T.alloc_fragment([1, dim], dtype)
+            K_shared = T.alloc_shared([block_N, dim], dtype)
+            V_shared = T.alloc_shared([block_N, dim], dtype)
+            acc_s = T.alloc_fragment([groups, block_N], accum_dtype)
+            acc_s_cast = T.alloc_fragment([groups, block_N], dtype)
+            acc_o = T.alloc_fragment([groups, dim], accum_dtype)
+            scores_max = T.alloc_fragment([groups], accum_dtype)
+            logsum = T.alloc_fragment([groups], accum_dtype)
+
+            pos = positions[by]
+            T.copy(Q[by, bx * groups : (bx + 1) * groups, :], Q_local)
+            T.rotary(Q_local, cos[pos, :], sin[pos, :])
+            T.copy(Q_local, Q_shared)
+            T.copy(K_new[by, bx : bx + 1, :], K_local)
+            T.rotary(K_local, cos[pos, :], sin[pos, :])
+            T.copy(V_new[by, bx : bx + 1, :], V_local)
+            T.scatter_copy(K_local, K_flat[:, bx, :], block_table[by, 0], page_size, pos)
+            T.scatter_copy(V_local, V_flat[:, bx, :], block_table[by, 0], page_size, pos)
+            # the appended rows are read back by the gathers of the block
+            T.evaluate(T.tvm_storage_sync("shared"))
+
+            T.fill(acc_o, 0)
+            T.fill(logsum, 0)
+            T.fill(scores_max, -T.infinity(accum_dtype))
+            for k in T.Pipelined(T.ceildiv(pos + 1, block_N), num_stages=2):
+                row = k * block_N
+                T.gather_copy(K_flat[:, bx, :], K_shared, block_table[by, 0], page_size, row)
+                T.clear(acc_s)
+                T.gemm(Q_shared, K_shared, acc_s, transpose_B=True)
+                T.mask(acc_s, lambda i, j: j <= pos, 0, row)
+                T.gather_copy(V_flat[:, bx, :], V_shared, block_table[by, 0], page_size, row)
+                T.online_softmax(acc_s, scores_max, logsum, acc_o, sm_scale)
+                T.copy(acc_s, acc_s_cast)
+                T.gemm(acc_s_cast, V_shared, acc_o)
+            for i, j in T.Parallel(groups, dim):
+                acc_o[i, j] /= logsum[i]
+            T.copy(acc_o, Output[by, bx * groups : (bx + 1) * groups, :])
+
+    return main
+
+
+def rotate(x, cos, sin):
+    half = x.shape[-1] // 2
+    x1, x2 = x[..., :half].float(), x[..., half:].float()
+    return torch.cat([x1 * cos - x2 * sin, x2 * cos + x1 * sin], -1).to(x.dtype)
+
+
+def ref_program(q, k_new, v_new, cos, sin, positions, block_table, k_cache, v_cache):
+    """The separate steps of the decode: the rotary embedding, the cache append, the attention."""
+    page_size, groups = k_cache.shape[1], q.shape[1] // k_new.shape[1]
+    outputs = []
+    for b, pos in enumerate(positions.tolist()):
+        q_b = rotate(q[b], cos[pos], sin[pos])
+        page, slot = block_table[b, pos // page_size], pos % page_size
+        k_cache[page, slot] = rotate(k_new[b], cos[pos], sin[pos])
+        v_cache[page, slot] = v_new[b]
+        rows = torch.arange(pos + 1, device=q.device)
+        pages = block_table[b, rows // page_size]
+        keys = k_cache[pages, rows % page_size].repeat_interleave(groups, 1).float()
+        values = v_cache[pages, rows % page_size].repeat_interleave(groups, 1).float()
+        scores = torch.einsum("hd,thd->ht", q_b.float(), keys) / q.shape[-1] ** 0.5
+        outputs.append(torch.einsum("ht,thd->hd", scores.softmax(-1), values))
+    return torch.stack(outputs).to(q.dtype)
+
+
+if __name__ == "__main__":
+    BATCH, HEADS, KV_HEADS, D_HEAD = 32, 32, 2, 128
+    PAGE_SIZE, MAX_PAGES, MAX_POS, BLOCK_N = 16, 128, 2048, 64
+    num_pages = BATCH * MAX_PAGES
+    program = decode_attention(
+        BATCH, HEADS, KV_HEADS, D_HEAD, MAX_POS, PAGE_SIZE, MAX_PAGES, num_pages, BLOCK_N
+    )
+    mod, params = tl.lower(program)
+    mod = tl.ConvertTorch(mod, params, [])
+
+    def randn(*shape):
+        return torch.randn(*shape, device="cuda", dtype=torch.float16)
+
+    q = randn(BATCH, HEADS, D_HEAD)
+    k_new, v_new = randn(BATCH, KV_HEADS, D_HEAD), randn(BATCH, KV_HEADS, D_HEAD)
+    inv_freq = 1.0 / 10000 ** (torch.arange(0, D_HEAD, 2, device="cuda").float() / D_HEAD)
+    angles = torch.arange(MAX_POS, device="cuda").float()[:, None] * inv_freq[None]
+    cos, sin = angles.cos().contiguous(), angles.sin().contiguous()
+    positions = torch.randint(0, MAX_POS - 1, (BATCH,), device="cuda", dtype=torch.int32)
+    block_table = torch.randperm(num_pages, device="cuda", dtype=torch.int32).view(BATCH, MAX_PAGES)
+    k_cache = randn(num_pages, PAGE_SIZE, KV_HEADS, D_HEAD)
+    v_cache = randn(num_pages, PAGE_SIZE, KV_HEADS, D_HEAD)
+    out = torch.empty_like(q)
+
+    k_ref, v_ref = k_cache.clone(), v_cache.clone()
+    ref = ref_program(q, k_new, v_new, cos, sin, positions, block_table, k_ref, v_ref)
+    mod(q, k_new, v_new, cos, sin, positions, block_table, k_cache, v_cache, out)
+    torch.testing.assert_close(out, ref, atol=1e-2, rtol=1e-2)
+    torch.testing.assert_close(k_cache, k_ref, atol=1e-2, rtol=1e-2)
+
+    latency = tl.utils.do_bench(
+        lambda: mod(q, k_new, v_new, cos, sin, positions, block_table, k_cache, v_cache, out)
+    )
+    print("{:.3f} ms".format(latency))
@@ -0,0 +1,111 @@
+"""DGEMM and planar ZGEMM on the float64 tensor cores (sm_80 and later) against cuBLAS.
+
+    python dgemm_example.py
+"""
+
+import torch
+from tvm import tl
+import tvm.tl.language as T
+
+
+def dgemm(M, N, K, block_M, block_N, block_K, num_stages=3):
+    dtype = "float64"
+
+    @T.prim_func
+    def main(A: T.Buffer((M, K), dtype), B: T.Buffer((K, N), dtype), C: T.Buffer((M, N), dtype)):
+        with T.Kernel(T.ceildiv(N, block_N), T.ceildiv(M, block_M), threads=128) as (bx, by):
+            A_shared = T.alloc_shared((block_M, block_K), dtype)
+            B_shared = T.alloc_shared((block_K, block_N), dtype)
+            C_local = T.alloc_fragment((block_M, block_N), dtype)
+            T.clear(C_local)
+            for k in T.Pipelined(T.ceildiv(K, block_K), num_stages=num_stages):
+                T.copy(A[by * block_M, k * block_K], A_shared)
+                T.copy(B[k * block_K, bx * block_N], B_shared)
+                T.gemm(A_shared, B_shared, C_local)
+            T.copy(C_local, C[by * block_M, bx * block_N])
+
+    return main
+
+
+def zgemm(M, N, K, block_M, block_N, block_K, num_stages=2):
+    """C = A @ B on the planar complex float64 matrices, each a pair of real and imaginary
+    matrices, with the four real gemms of T.complex_gemm."""
+    dtype = "float64"
+
+    @T.prim_func
+    def main(
+        A_re: T.Buffer((M, K), dtype),
+        A_im: T.Buffer((M, K), dtype),
+        B_re: T.Buffer((K, N), dtype),
+        B_im: T.Buffer((K, N), dtype),
+        C_re: T.Buffer((M, N), dtype),
+        C_im: T.Buffer((M, N), dtype),
+    ):
+        with T.Kernel(T.ceildiv(N, block_N), T.ceildiv(M, block_M), threads=128) as (bx, by):
+            A_re_shared = T.alloc_shared((block_M, block_K), dtype)
+            A_im_shared = T.alloc_shared((block_M, block_K), dtype)
+            B_re_shared = T.alloc_shared((block_K, block_N), dtype)
+            B_im_shared = T.alloc_shared((block_K, block_N), dtype)
+            C_re_local = T.alloc_fragment((block_M, block_N), dtype)
+            C_im_local = T.alloc_fragment((block_M, block_N), dtype)
+            C_neg_local = T.alloc_fragment((block_M, block_N), dtype)
+            T.clear(C_re_local)
+            T.clear(C_im_local)
+            T.clear(C_neg_local)
+            for k in T.Pipelined(T.ceildiv(K, block_K), num_stages=num_stages):
+                T.copy(A_re[by * block_M, k * block_K], A_re_shared)
+                T.copy(A_im[by * block_M, k * block_K], A_im_shared)
+                T.copy(B_re[k * block_K, bx * block_N], B_re_shared)
+                T.copy(B_im[k * block_K, bx * block_N], B_im_shared)
+                T.complex_gemm(
+                    (A_re_shared, A_im_shared),
+                    (B_re_shared, B_im_shared),
+                    (C_re_local, C_im_local),
+                    C_neg_local,
+                )
+            T.complex_gemm_finalize((C_re_local, C_im_local), C_neg_local)
+            T.copy(C_re_local, C_re[by * block_M, bx * block_N])
+            T.copy(C_im_local, C_im[by * block_M, bx * block_N])
+
+    return main
+
+
+def ref_program(A, B):
+    return A @ B
+
+
+def ref_complex_program(A_re, A_im, B_re, B_im):
+    C = torch.complex(A_re, A_im) @ torch.complex(B_re, B_im)
+    return C.real, C.imag
+
+
+if __name__ == "__main__":
+    M, N, K, block_M, block_N, block_K = 4096, 4096, 4096, 64, 64, 16
+    flops = 2 * M * N * K
+
+    program = dgemm(M, N, K, block_M, block_N, block_K)
+    mod, params = tl.lower(program)
+    profiler = tl.Profiler(mod, params, [2], tl.TensorSupplyType.Normal)
+    profiler.assert_allclose(ref_program, rtol=1e-9, atol=1e-9)
+    latency = profiler.do_bench(profiler.func)
+    baseline = profiler.do_bench(ref_program)
+    print("DGEMM: {:.3f} ms, {:.2f} TFlops".format(latency, flops / latency * 1e-9))
+    print("cuBLAS DGEMM: {:.3f} ms, {:.2f} TFlops".format(baseline, flops / baseline * 1e-9))
+
+    program = zgemm(M, N, K, block_M, block_N, block_K)
+    mod, params = tl.lower(program)
+    mod = tl.ConvertTorch(mod, params, [])
+    A_re, A_im = (torch.randn(M, K, device="cuda", dtype=torch.float64) for _ in range(2))
+    B_re, B_im = (torch.randn(K, N, device="cuda", dtype=torch.float64) for _ in range(2))
+    C_re = torch.empty(M, N, device="cuda", dtype=torch.float64)
+    C_im = torch.empty_like(C_re)
+    mod(A_re, A_im, B_re, B_im, C_re, C_im)
+    ref_re, ref_im = ref_complex_program(A_re, A_im, B_re, B_im)
+    torch.testing.assert_close(C_re, ref_re, rtol=1e-9, atol=1e-9)
+    torch.testing.assert_close(C_im, ref_im, rtol=1e-9, atol=1e-9)
+    # a complex multiply-add is 4 real ones
+    latency = tl.utils.do_bench(lambda: mod(A_re, A_im, B_re, B_im, C_re, C_im))
+    A, B = torch.complex(A_re, A_im), torch.complex(B_re, B_im)
+    baseline = tl.utils.do_bench(lambda: A @ B)
+    print("ZGEMM: {:.3f} ms, {:.2f} TFlops".format(latency, 4 * flops / latency * 1e-9))
+    print("cuBLAS ZGEMM: {:.3f} ms, {:.2f} TFlops".format(baseline, 4 * flops / baseline * 1e-9))
@@ -0,0 +1,77 @@
+"""Dropout fused into the epilogue of a copy, its mask regenerated by another kernel with other
+block sizes from the seed and the counters of the elements, and the bias of the stochastic
+rounding to bfloat16.
+
+    python dropout_example.py
+"""
+
+import torch
+from tvm import tl
+import tvm.tl.language as T
+
+
+def dropout(M, N, p, block_M, block_N):
+    """y = dropout(x), the element (i, j) at the counter i * N + j."""
+    dtype = "float"
+
+    @T.prim_func
+    def main(X: T.Buffer((M, N), dtype), Y: T.Buffer((M, N), dtype), seed: T.int64):
+        with T.Kernel(T.ceildiv(N, block_N), T.ceildiv(M, block_M), threads=128) as (bx, by):
+            x = T.alloc_fragment((block_M, block_N), dtype)
+            T.copy(X[by * block_M, bx * block_N], x)
+            offset = by * block_M * N + bx * block_N
+            T.copy(x, Y[by * block_M, bx * block_N], epilogue=[T.dropout(p, seed, offset, [N, 1])])
+
+    return main
+
+
+def keep_mask(M, N, p, block_M, block_N):
+    """The mask of dropout regenerated with T.rand, 1 for the kept elements."""
+    dtype = "float"
+
+    @T.prim_func
+    def main(Mask: T.Buffer((M, N), dtype), seed: T.int64):
+        with T.Kernel(T.ceildiv(N, block_N), T.ceildiv(M, block_M), threads=128) as (bx, by):
+            offset = by * block_M * N + bx * block_N
+            r = T.rand(seed, offset, (block_M, block_N), [N, 1])
+            for i, j in T.Parallel(block_M, block_N):
+                r[i, j] = T.if_then_else(r[i, j] < p, T.float32(0), T.float32(1))
+            T.copy(r, Mask[by * block_M, bx * block_N])
+
+    return main
+
+
+def stochastic_round(N, block_N):
+    """Y = X rounded to bfloat16 stochastically, the element j at the counter j."""
+
+    @T.prim_func
+    def main(X: T.Buffer((N,), "float"), Y: T.Buffer((N,), "bfloat16"), seed: T.int64):
+        with T.Kernel(T.ceildiv(N, block_N), threads=128) as bx:
+            x = T.alloc_fragment((block_N,), "float")
+            T.copy(X[bx * block_N], x)
+            rounding = T.stochastic_round("bfloat16", seed, bx * block_N)
+            T.copy(x, Y[bx * block_N], epilogue=[rounding])
+
+    return main
+
+
+def compile(program):
+    mod, params = tl.lower(program)
+    return tl.ConvertTorch(mod, params, [])
+
+
+if __name__ == "__main__":
+    M, N, P, SEED = 4096, 4096, 0.1, 1234
+    x = torch.randn(M, N, device="cuda", dtype=torch.float32)
+    y = torch.empty_like(x)
+    mask = torch.empty_like(x)
+    compile(dropout(M, N, P, 64, 64))(x, y, SEED)
+    compile(keep_mask(M, N, P, 128, 32))(mask, SEED)
+    torch.testing.assert_close(y, x * mask / (1 - P))
+    print("dropped: {:.4f}, p = {}".format(1 - mask.mean().item(), P))
+
+    # 1 + a third of the spacing of bfloat16 at 1, rounded up a third of the time
+    x = torch.full((1 << 20,), 1 + 2**-7 / 3, device="cuda", dtype=torch.float32)
+    y = torch.empty(x.shape, device="cuda", dtype=torch.bfloat16)
+    compile(stochastic_round(x.numel(), 1024))(x, y, SEED)
+    print("mean of the stochastic rounding: {:.6f}, x = {:.6f}".format(y.float().mean(), x[0]))
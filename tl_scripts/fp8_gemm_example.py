@@ -0,0 +1,84 @@
+import torch
+from tvm import tl
+import tvm.tl.language as T
+
+
+def matmul_fp8(M, N, K, block_M, block_N, block_K, dtype="e4m3_float8"):
+    """C = (A * scale_a) @ (B * scale_b).T with a per-tensor scale, applied in the epilogue."""
+    accum_dtype = "float"
+
+    @T.prim_func
+    def main(
+        A: T.Buffer((M, K), dtype),
+        B: T.Buffer((N, K), dtype),
+        scale: T.Buffer((1,), accum_dtype),
+        C: T.Buffer((M, N), "float16"),
+    ):
+        with T.Kernel(T.ceildiv(N, block_N), T.ceildiv(M, block_M), threads=128) as (bx, by):
+            A_shared = T.alloc_shared((block_M, block_K), dtype)
+            B_shared = T.alloc_shared((block_N, block_K), dtype)
+            C_local = T.alloc_fragment((block_M, block_N), accum_dtype)
+            T.clear(C_local)
+            for k in T.Pipelined(T.ceildiv(K, block_K), num_stages=3):
+                T.copy(A[by * block_M, k * block_K], A_shared)
+                T.copy(B[bx * block_N, k * block_K], B_shared)
+                # the fp8 operands are K-major
+                T.gemm(A_shared, B_shared, C_local, transpose_B=True)
+            for i, j in T.Parallel(block_M, block_N):
+                C_local[i, j] = C_local[i, j] * scale[0]
+            T.copy(C_local, C[by * block_M, bx * block_N])
+
+    return main
+
+
+def matmul_fp8_blockwise(M, N, K, block_M, block_N, dtype="e4m3_float8"):
+    """The per-block scaling: A has a scale per row and 128 columns, B per 128 x 128 block. The
+    partial product of each K block is scaled before the accumulation."""
+    accum_dtype = "float"
+    block_K = 128
+    assert block_N == 128
+
+    @T.prim_func
+    def main(
+        A: T.Buffer((M, K), dtype),
+        B: T.Buffer((N, K), dtype),
+        scale_a: T.Buffer((M, K // block_K), accum_dtype),
+        scale_b: T.Buffer((N // block_N, K // block_K), accum_dtype),
+        C: T.Buffer((M, N), "float16"),
+    ):
+        with T.Kernel(T.ceildiv(N, block_N), T.ceildiv(M, block_M), threads=128) as (bx, by):
+            A_shared = T.alloc_shared((block_M, block_K), dtype)
+            B_shared = T.alloc_shared((block_N, block_K), dtype)
+            C_partial = T.alloc_fragment((block_M, block_N), accum_dtype)
+            C_local = T.alloc_fragment((block_M, block_N), accum_dtype)
+            T.clear(C_local)
+            for k in T.Pipelined(K // block_K, num_stages=3):
+                T.copy(A[by * block_M, k * block_K], A_shared)
+                T.copy(B[bx * block_N, k * block_K], B_shared)
+                T.clear(C_partial)
+                T.gemm(A_shared, B_shared, C_partial, transpose_B=True)
+                for i, j in T.Parallel(block_M, block_N):
+                    C_local[i, j] += (
+                        C_partial[i, j] * scale_a[by * block_M + i, k] * scale_b[bx, k]
+                    )
+            T.copy(C_local, C[by * block_M, bx * block_N])
+
+    return main
+
+
+def ref_program(A, B, scale):
+    return ((A.float() @ B.float().T) * scale).half()
+
+
+if __name__ == "__main__":
+    M, N, K = 8192, 8192, 8192
+    total_flops = 2 * M * N * K
+    program = matmul_fp8(M, N, K, 128, 128, 128)
+    mod, params = tl.lower(program)
+
+    mod = tl.Profiler(mod, params, [3], tl.TensorSupplyType.Integer)
+    mod.assert_allclose(ref_program, atol=1e-2, rtol=1e-2)
+
+    latency = mod.do_bench(mod.func)
+    print("{:.2f} ms".format(latency))
+    print("{:.2f} TFlops".format(total_flops / latency * 1e-9))
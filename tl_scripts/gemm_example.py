@@ -39,6 +39,7 @@ if __name__ == "__main__":
     latency = mod.do_bench(ref_program, warmup=500)
     print("{:.2f} ms".format(latency))
     print("{:.2f} TFlops".format(total_flops / latency * 1e-9))
-    latency = mod.do_bench(mod.func)
-    print("{:.2f} ms".format(latency))
-    print("{:.2f} TFlops".format(total_flops / latency * 1e-9))
+    result = mod.summarize(program)
+    print("{:.2f} ms".format(result.latency_ms))
+    print("{:.2f} TFlops".format(result.tflops))
+    print("{:.0%} of the {}-bound roofline".format(result.roofline, result.bound))
@@ -0,0 +1,83 @@
+"""Softmax over long rows in a single launch: the blocks of a row reduce their chunks, exchange
+the partial statistics through the global memory and T.grid_sync, then normalize their chunks.
+
+    python grid_sync_softmax_example.py
+"""
+
+import torch
+from tvm import tl
+import tvm.tl.language as T
+
+
+def softmax(batch, cols, splits, block_N):
+    """Each row is split into splits chunks of cols // splits, one block per chunk. The grid of
+    splits * batch blocks must be resident at once, see T.grid_sync."""
+    dtype = "float"
+    chunk = cols // splits
+    assert chunk % block_N == 0
+
+    @T.prim_func
+    def main(
+        X: T.Buffer((batch, cols), dtype),
+        Y: T.Buffer((batch, cols), dtype),
+        Partial_max: T.Buffer((batch, splits), dtype),
+        Partial_sum: T.Buffer((batch, splits), dtype),
+    ):
+        with T.Kernel(splits, batch, threads=128) as (bx, by):
+            x = T.alloc_fragment((1, block_N), dtype)
+            partial = T.alloc_fragment((1, splits), dtype)
+            tile_sum = T.alloc_fragment((1,), dtype)
+            row_max = T.alloc_fragment((1,), dtype)
+            row_sum = T.alloc_fragment((1,), dtype)
+
+            # the max and the sum of the exponentials of the chunk
+            T.fill(row_max, -T.infinity(dtype))
+            for t in T.serial(chunk // block_N):
+                T.copy(X[by, bx * chunk + t * block_N], x)
+                T.reduce_max(x, row_max, dim=1, clear=False)
+            T.clear(row_sum)
+            for t in T.serial(chunk // block_N):
+                T.copy(X[by, bx * chunk + t * block_N], x)
+                for i, j in T.Parallel(1, block_N):
+                    x[i, j] = T.exp(x[i, j] - row_max[i])
+                T.reduce_sum(x, tile_sum, dim=1)
+                for i in T.Parallel(1):
+                    row_sum[i] += tile_sum[i]
+            for i in T.Parallel(1):
+                Partial_max[by, bx] = row_max[i]
+                Partial_sum[by, bx] = row_sum[i]
+
+            T.grid_sync()
+
+            # the statistics of the whole row from the partial ones of its blocks
+            T.copy(Partial_max[by, 0], partial)
+            T.reduce_max(partial, row_max, dim=1)
+            for i, j in T.Parallel(1, splits):
+                partial[i, j] = Partial_sum[by, j] * T.exp(Partial_max[by, j] - row_max[i])
+            T.reduce_sum(partial, row_sum, dim=1)
+            for t in T.serial(chunk // block_N):
+                T.copy(X[by, bx * chunk + t * block_N], x)
+                for i, j in T.Parallel(1, block_N):
+                    x[i, j] = T.exp(x[i, j] - row_max[i]) / row_sum[i]
+                T.copy(x, Y[by, bx * chunk + t * block_N])
+
+    return main
+
+
+if __name__ == "__main__":
+    BATCH, COLS, SPLITS, BLOCK_N = 8, 1 << 20, 32, 1024
+    program = softmax(BATCH, COLS, SPLITS, BLOCK_N)
+    mod, params = tl.lower(program)
+    mod = tl.ConvertTorch(mod, params, [])
+
+    x = torch.randn(BATCH, COLS, device="cuda", dtype=torch.float32)
+    y = torch.empty_like(x)
+    partial_max = torch.empty(BATCH, SPLITS, device="cuda", dtype=torch.float32)
+    partial_sum = torch.empty_like(partial_max)
+    mod(x, y, partial_max, partial_sum)
+    torch.testing.assert_close(y, torch.softmax(x, dim=-1), rtol=1e-5, atol=1e-8)
+
+    latency = tl.utils.do_bench(lambda: mod(x, y, partial_max, partial_sum))
+    baseline = tl.utils.do_bench(lambda: torch.softmax(x, dim=-1))
+    print("grid_sync softmax: {:.3f} ms".format(latency))
+    print("torch softmax: {:.3f} ms".format(baseline))
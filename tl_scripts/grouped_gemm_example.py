@@ -0,0 +1,68 @@
+import torch
+from tvm import tl
+import tvm.tl.language as T
+
+
+def grouped_gemm(total_M, N, K, num_groups, block_M, block_N, block_K, dtype="float16"):
+    """C[rows of g] = A[rows of g] @ B[g].T for the groups of rows of A, e.g. the tokens routed to
+    the experts of a MoE layer. The tiles of all the groups run in a single persistent launch."""
+    accum_dtype = "float"
+    # the bound of the number of tiles, the blocks past the last tile of the groups exit
+    max_tiles = (total_M + block_M - 1) // block_M + num_groups
+
+    @T.prim_func
+    def main(
+        A: T.Buffer((total_M, K), dtype),
+        B: T.Buffer((num_groups, N, K), dtype),
+        row_offsets: T.Buffer((num_groups + 1,), "int32"),
+        tile_offsets: T.Buffer((num_groups + 1,), "int32"),
+        C: T.Buffer((total_M, N), dtype),
+    ):
+        with T.Kernel(
+            T.ceildiv(N, block_N), max_tiles, threads=128, schedule="persistent"
+        ) as (bx, by):
+            A_shared = T.alloc_shared((block_M, block_K), dtype)
+            B_shared = T.alloc_shared((block_N, block_K), dtype)
+            C_local = T.alloc_fragment((block_M, block_N), accum_dtype)
+            g = T.group_search(tile_offsets, num_groups, by)
+            if g < num_groups:
+                row = row_offsets[g] + (by - tile_offsets[g]) * block_M
+                T.clear(C_local)
+                for k in T.Pipelined(T.ceildiv(K, block_K), num_stages=3):
+                    T.copy(A[row : row + block_M, k * block_K : (k + 1) * block_K], A_shared)
+                    T.copy(
+                        B[g, bx * block_N : (bx + 1) * block_N, k * block_K : (k + 1) * block_K],
+                        B_shared,
+                    )
+                    T.gemm(A_shared, B_shared, C_local, transpose_B=True)
+                # the last tile of a group does not write the rows of the next group
+                for i, j in T.Parallel(block_M, block_N):
+                    if row + i < row_offsets[g + 1]:
+                        C[row + i, bx * block_N + j] = C_local[i, j]
+
+    return main
+
+
+if __name__ == "__main__":
+    num_groups, N, K = 64, 4096, 4096
+    block_M, block_N, block_K = 64, 128, 32
+    group_sizes = torch.randint(0, 256, (num_groups,), device="cuda")
+    total_M = int(group_sizes.sum())
+    row_offsets, tile_offsets = tl.make_group_offsets(group_sizes, block_M)
+
+    program = grouped_gemm(total_M, N, K, num_groups, block_M, block_N, block_K)
+    mod, params = tl.lower(program)
+    mod = tl.ConvertTorch(mod, params, [])
+
+    a = torch.randn(total_M, K, device="cuda", dtype=torch.float16)
+    b = torch.randn(num_groups, N, K, device="cuda", dtype=torch.float16)
+    c = torch.empty(total_M, N, device="cuda", dtype=torch.float16)
+    mod(a, b, row_offsets, tile_offsets, c)
+
+    rows = row_offsets.tolist()
+    ref = torch.cat([a[rows[g] : rows[g + 1]] @ b[g].T for g in range(num_groups)])
+    torch.testing.assert_close(c, ref, atol=1e-2, rtol=1e-2)
+
+    latency = tl.utils.do_bench(lambda: mod(a, b, row_offsets, tile_offsets, c))
+    print("{:.2f} ms".format(latency))
+    print("{:.2f} TFlops".format(2 * total_M * N * K / latency * 1e-9))
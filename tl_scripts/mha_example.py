@@ -1,15 +1,18 @@
 import torch
-from tvm import tl
+from tvm import tir, tl
 import tvm.tl.language as T
 from functools import partial
 
 
 def flashattn(batch, heads, seq_len, dim, is_casual, block_M, block_N):
-    scale = (1.0 / dim) ** 0.5 * 1.44269504  # log2(e)
+    sm_scale = (1.0 / dim) ** 0.5
     shape = [batch, seq_len, heads, dim]
     dtype = "float16"
     accum_dtype = "float"
 
+    def causal_mask(i, j):
+        return i >= j
+
     @T.prim_func
     def main(
         Q: T.Buffer(shape, dtype),
@@ -26,9 +29,6 @@ def flashattn(batch, heads, seq_len, dim, is_casual, block_M, block_N):
             acc_s_cast = T.alloc_fragment([block_M, block_N], dtype)
             acc_o = T.alloc_fragment([block_M, dim], accum_dtype)
             scores_max = T.alloc_fragment([block_M], accum_dtype)
-            scores_max_prev = T.alloc_fragment([block_M], accum_dtype)
-            scores_scale = T.alloc_fragment([block_M], accum_dtype)
-            scores_sum = T.alloc_fragment([block_M], accum_dtype)
             logsum = T.alloc_fragment([block_M], accum_dtype)
 
             T.annotate_layout({Q_shared: tl.layout.make_swizzled_layout(Q_shared)})
@@ -37,35 +37,22 @@ def flashattn(batch, heads, seq_len, dim, is_casual, block_M, block_N):
             T.fill(logsum, 0)
             T.fill(scores_max, -T.infinity(accum_dtype))
             T.copy(Q_shared, Q_local)
-            for i, j in T.Parallel(block_M, dim):
-                Q_local[i, j] *= scale
-            loop_range = (
-                T.ceildiv((bx + 1) * block_M, block_N) if is_casual else T.ceildiv(seq_len, block_N)
+            num_tiles = T.ceildiv(seq_len, block_N)
+            start, stop = (
+                T.mask_range(causal_mask, bx * block_M, block_M, block_N, num_tiles)
+                if is_casual
+                else (0, num_tiles)
             )
-            for k in T.Pipelined(loop_range, num_stages=1):
+            for k in T.Pipelined(start, stop, num_stages=1):
                 T.copy(K[bz, k * block_N : (k + 1) * block_N, by, :], K_shared)
-                if is_casual:
-                    for i, j in T.Parallel(block_M, block_N):
-                        acc_s[i, j] = T.if_then_else(
-                            bx * block_M + i >= k * block_N + j, 0, -T.infinity(acc_s.dtype)
-                        )
-                else:
-                    T.clear(acc_s)
+                T.clear(acc_s)
                 T.gemm(Q_local, K_shared, acc_s, transpose_B=True, policy=T.GemmWarpPolicy.FullRow)
+                if is_casual:
+                    T.mask(acc_s, causal_mask, bx * block_M, k * block_N)
                 T.copy(V[bz, k * block_N : (k + 1) * block_N, by, :], V_shared)
-                T.copy(scores_max, scores_max_prev)
-                T.reduce_max(acc_s, scores_max, dim=1, clear=False)
-                for i in T.Parallel(block_M):
-                    scores_scale[i] = T.exp2(scores_max_prev[i] - scores_max[i])
-                for i, j in T.Parallel(block_M, dim):
-                    acc_o[i, j] *= scores_scale[i]
-                for i, j in T.Parallel(block_M, block_N):
-                    acc_s[i, j] = T.exp2(acc_s[i, j] - scores_max[i])
+                T.online_softmax(acc_s, scores_max, logsum, acc_o, sm_scale)
                 T.copy(acc_s, acc_s_cast)
                 T.gemm(acc_s_cast, V_shared, acc_o, policy=T.GemmWarpPolicy.FullRow)
-                T.reduce_sum(acc_s, scores_sum, dim=1)
-                for i in T.Parallel(block_M):
-                    logsum[i] = logsum[i] * scores_scale[i] + scores_sum[i]
             for i, j in T.Parallel(block_M, dim):
                 acc_o[i, j] /= logsum[i]
             T.copy(acc_o, Output[bz, bx * block_M : (bx + 1) * block_M, by, :])
@@ -73,13 +60,139 @@ def flashattn(batch, heads, seq_len, dim, is_casual, block_M, block_N):
     return main
 
 
+def num_kv_splits(batch, heads, seq_len_q, seq_len_kv, block_M, block_N, num_sms):
+    """The splits of the KV sequence of each (batch, head, q-tile) filling the num_sms SMs with one
+    block each, so that the grid of flashattn_split_kv stays resident for its T.grid_sync."""
+    blocks = batch * heads * ((seq_len_q + block_M - 1) // block_M)
+    kv_tiles = (seq_len_kv + block_N - 1) // block_N
+    return max(1, min(num_sms // blocks, kv_tiles))
+
+
+def flashattn_split_kv(
+    batch, heads, seq_len_q, seq_len_kv, dim, is_casual, block_M, block_N, num_split
+):
+    """The attention of a few queries over a long KV sequence (decode), the KV sequence of each
+    (batch, head, q-tile) being split across num_split blocks (FlashDecoding) so that the small
+    batches still occupy the SMs. Each block writes its partial output, normalized by its own sum,
+    and the log-sum-exp of its rows to the workspaces O_partial and LSE; after a T.grid_sync the
+    block of split 0 merges the partial outputs weighted by exp(lse - max lse). The queries are
+    the last seq_len_q positions of the sequence for the causal mask."""
+    sm_scale = (1.0 / dim) ** 0.5
+    q_shape = [batch, seq_len_q, heads, dim]
+    kv_shape = [batch, seq_len_kv, heads, dim]
+    q_tiles = (seq_len_q + block_M - 1) // block_M
+    # the rows of the last q-tile beyond seq_len_q are written to the workspaces and dropped
+    padded_q = q_tiles * block_M
+    dtype = "float16"
+    accum_dtype = "float"
+    # the warps of a small q-tile (e.g. a single query padded to 16 rows) split the columns
+    policy = T.GemmWarpPolicy.FullRow if block_M >= 64 else T.GemmWarpPolicy.Square
+
+    def causal_mask(i, j):
+        return i + (seq_len_kv - seq_len_q) >= j
+
+    def mask(i, j):
+        return tir.all(causal_mask(i, j), j < seq_len_kv) if is_casual else j < seq_len_kv
+
+    @T.prim_func
+    def main(
+        Q: T.Buffer(q_shape, dtype),
+        K: T.Buffer(kv_shape, dtype),
+        V: T.Buffer(kv_shape, dtype),
+        Output: T.Buffer(q_shape, dtype),
+        O_partial: T.Buffer([batch, heads, num_split, padded_q, dim], accum_dtype),
+        LSE: T.Buffer([batch, heads, num_split, padded_q], accum_dtype),
+    ):
+        with T.Kernel(num_split * q_tiles, heads, batch, threads=128) as (bx, by, bz):
+            Q_shared = T.alloc_shared([block_M, dim], dtype)
+            K_shared = T.alloc_shared([block_N, dim], dtype)
+            V_shared = T.alloc_shared([block_N, dim], dtype)
+            acc_s = T.alloc_fragment([block_M, block_N], accum_dtype)
+            acc_s_cast = T.alloc_fragment([block_M, block_N], dtype)
+            acc_o = T.alloc_fragment([block_M, dim], accum_dtype)
+            scores_max = T.alloc_fragment([block_M], accum_dtype)
+            logsum = T.alloc_fragment([block_M], accum_dtype)
+
+            split = bx // q_tiles
+            q_start = bx % q_tiles * block_M
+            T.copy(Q[bz, q_start : q_start + block_M, by, :], Q_shared)
+            T.fill(acc_o, 0)
+            T.fill(logsum, 0)
+            T.fill(scores_max, -T.infinity(accum_dtype))
+            num_tiles = T.ceildiv(seq_len_kv, block_N)
+            start, stop = (
+                T.mask_range(causal_mask, q_start, block_M, block_N, num_tiles)
+                if is_casual
+                else (0, num_tiles)
+            )
+            # the KV tiles of the q-tile are split evenly, the last splits may be empty
+            split_tiles = T.ceildiv(stop - start, num_split)
+            split_start = start + split * split_tiles
+            split_stop = T.max(split_start, T.min(stop, split_start + split_tiles))
+            for k in T.Pipelined(split_start, split_stop, num_stages=2):
+                T.copy(K[bz, k * block_N : (k + 1) * block_N, by, :], K_shared)
+                T.clear(acc_s)
+                T.gemm(Q_shared, K_shared, acc_s, transpose_B=True, policy=policy)
+                if is_casual or seq_len_kv % block_N != 0:
+                    T.mask(acc_s, mask, q_start, k * block_N)
+                T.copy(V[bz, k * block_N : (k + 1) * block_N, by, :], V_shared)
+                T.online_softmax(acc_s, scores_max, logsum, acc_o, sm_scale)
+                T.copy(acc_s, acc_s_cast)
+                T.gemm(acc_s_cast, V_shared, acc_o, policy=policy)
+
+            if num_split == 1:
+                for i, j in T.Parallel(block_M, dim):
+                    acc_o[i, j] /= logsum[i]
+                T.copy(acc_o, Output[bz, q_start : q_start + block_M, by, :])
+            else:
+                # the rows with no unmasked key in the split are weighted 0 by lse = -inf
+                for i, j in T.Parallel(block_M, dim):
+                    acc_o[i, j] = T.if_then_else(logsum[i] > 0, acc_o[i, j] / logsum[i], 0)
+                T.copy(acc_o, O_partial[bz, by, split, q_start : q_start + block_M, :])
+                for i in T.Parallel(block_M):
+                    LSE[bz, by, split, q_start + i] = T.if_then_else(
+                        logsum[i] > 0,
+                        T.log(logsum[i]) + scores_max[i] * sm_scale,
+                        -T.infinity(accum_dtype),
+                    )
+
+                T.grid_sync()
+
+                lse_local = T.alloc_fragment([block_M, num_split], accum_dtype)
+                lse_max = T.alloc_fragment([block_M], accum_dtype)
+                lse_sum = T.alloc_fragment([block_M], accum_dtype)
+                weights = T.alloc_shared([block_M, num_split], accum_dtype)
+                if split == 0:
+                    for i, s in T.Parallel(block_M, num_split):
+                        lse_local[i, s] = LSE[bz, by, s, q_start + i]
+                    T.reduce_max(lse_local, lse_max, dim=1)
+                    for i, s in T.Parallel(block_M, num_split):
+                        lse_local[i, s] = T.if_then_else(
+                            lse_max[i] > -T.infinity(accum_dtype),
+                            T.exp(lse_local[i, s] - lse_max[i]),
+                            0,
+                        )
+                    T.reduce_sum(lse_local, lse_sum, dim=1)
+                    for i, s in T.Parallel(block_M, num_split):
+                        weights[i, s] = T.if_then_else(
+                            lse_sum[i] > 0, lse_local[i, s] / lse_sum[i], 0
+                        )
+                    T.clear(acc_o)
+                    for s in T.serial(num_split):
+                        for i, j in T.Parallel(block_M, dim):
+                            acc_o[i, j] += weights[i, s] * O_partial[bz, by, s, q_start + i, j]
+                    T.copy(acc_o, Output[bz, q_start : q_start + block_M, by, :])
+
+    return main
+
+
 def ref_program(Q, K, V, casual):
     from flash_attn.flash_attn_interface import flash_attn_func
 
     return flash_attn_func(Q, K, V, causal=casual)
 
 
-if __name__ == "__main__":
+def bench_prefill():
     BATCH, H, N_CTX, D_HEAD = 64, 12, 2048, 256
     casual = True
     flops_per_matmul = 2.0 * BATCH * H * N_CTX * N_CTX * D_HEAD
@@ -89,14 +202,38 @@ if __name__ == "__main__":
     BLOCK_M = 64
     BLOCK_N = 64 if D_HEAD <= 128 else 32
     program = flashattn(BATCH, H, N_CTX, D_HEAD, casual, BLOCK_M, BLOCK_N)
-    ref_program = partial(ref_program, casual=casual)
+    ref = partial(ref_program, casual=casual)
     mod, params = tl.lower(program)
     mod = tl.Profiler(mod, params, [3], tl.TensorSupplyType.Normal)
-    mod.assert_allclose(ref_program, rtol=0.01, atol=0.01)
+    mod.assert_allclose(ref, rtol=0.01, atol=0.01)
 
-    latency = mod.do_bench(ref_program, warmup=500)
+    latency = mod.do_bench(ref, warmup=500)
     print("{:.2f} ms".format(latency))
     print("{:.2f} TFlops".format(total_flops / latency * 1e-9))
     latency = mod.do_bench(mod)
     print("{:.2f} ms".format(latency))
     print("{:.2f} TFlops".format(total_flops / latency * 1e-9))
+
+
+def bench_decode():
+    # a single query of batch 1 over a long context: B x H blocks would leave most SMs idle
+    BATCH, H, N_Q, N_CTX, D_HEAD = 1, 32, 1, 65536, 128
+    BLOCK_M, BLOCK_N = 16, 64
+    num_sms = torch.cuda.get_device_properties(torch.cuda.current_device()).multi_processor_count
+    num_split = num_kv_splits(BATCH, H, N_Q, N_CTX, BLOCK_M, BLOCK_N, num_sms)
+    total_bytes = 2 * 2.0 * BATCH * H * N_CTX * D_HEAD
+    for splits in (1, num_split):
+        program = flashattn_split_kv(BATCH, H, N_Q, N_CTX, D_HEAD, True, BLOCK_M, BLOCK_N, splits)
+        mod, params = tl.lower(program)
+        mod = tl.Profiler(mod, params, [3], tl.TensorSupplyType.Normal)
+        mod.assert_allclose(
+            lambda Q, K, V, *workspaces: ref_program(Q, K, V, True), rtol=0.01, atol=0.01
+        )
+        latency = mod.do_bench(mod)
+        print("split-KV decode, {} splits: {:.3f} ms".format(splits, latency))
+        print("{:.2f} GB/s".format(total_bytes / latency * 1e-6))
+
+
+if __name__ == "__main__":
+    bench_prefill()
+    bench_decode()
@@ -39,19 +39,10 @@ def rms_norm(M, N, blk_m):
     @T.prim_func
     def main(A: T.Buffer((M, N), dtype), B: T.Buffer((M, N), dtype)):
         with T.Kernel(T.ceildiv(M, blk_m), threads=128) as bx:
-            A_shared = T.alloc_shared((blk_m, N), dtype)
+            # the rows stay in registers from the load to the store
             A_local = T.alloc_fragment((blk_m, N), dtype)
-            A_powsum = T.alloc_fragment((blk_m,), dtype)
-
-            T.copy(A[bx * blk_m : (bx + 1) * blk_m, :], A_shared)
-            for i, j in T.Parallel(blk_m, N):
-                A_local[i, j] = A_shared[i, j] * A_shared[i, j]
-            T.reduce_sum(A_local, A_powsum, dim=1)
-            for i in T.Parallel(blk_m):
-                A_powsum[i] = T.rsqrt(A_powsum[i] / N) + 1e-12
-            for i, j in T.Parallel(blk_m, N):
-                A_shared[i, j] *= A_powsum[i]
-            T.copy(A_shared, B[bx * blk_m : (bx + 1) * blk_m, :])
+            T.copy(A[bx * blk_m : (bx + 1) * blk_m, :], A_local)
+            T.rms_norm(A_local, B[bx * blk_m : (bx + 1) * blk_m, :], eps=1e-12)
 
     return main
 
@@ -11,9 +11,6 @@ def matmul_splitk(M, N, K, blk_m, blk_n, block_K, split):
 
     @T.prim_func
     def main(A: T.Buffer((M, K), dtype), B: T.Buffer((K, N), dtype), C: T.Buffer((M, N), dtype)):
-        SplitC = T.alloc_buffer(
-            [split, (M + blk_m - 1) // blk_m * blk_m, (N + blk_n - 1) // blk_n * blk_n], dtype
-        )
         with T.Kernel(T.ceildiv(N, blk_n), T.ceildiv(M, blk_m), split) as (bx, by, bz):
             A_shared = T.alloc_shared((blk_m, block_K), dtype)
             B_shared = T.alloc_shared((block_K, blk_n), dtype)
@@ -24,17 +21,7 @@ def matmul_splitk(M, N, K, blk_m, blk_n, block_K, split):
                 T.copy(B[KK * bz + k * block_K, bx * blk_n], B_shared)
                 T.gemm(A_shared, B_shared, C_local)
 
-            T.copy(
-                C_local,
-                SplitC[bz, by * blk_m : (by + 1) * blk_m, bx * blk_n : (bx + 1) * blk_n],
-            )
-        with T.Kernel(T.ceildiv(N, blk_n), T.ceildiv(M, blk_m)) as (bx, by):
-            acc = T.alloc_fragment((blk_m, blk_n), dtype)
-            T.clear(acc)
-            for k in range(split):
-                for i, j in T.Parallel(blk_m, blk_n):
-                    acc[i, j] += SplitC[k, blk_m * by + i, blk_n * bx + j]
-            T.copy(acc, C[by * blk_m, bx * blk_n])
+            T.reduce_across_blocks(C_local, C[by * blk_m, bx * blk_n], bz, split)
 
     return main
 
@@ -0,0 +1,60 @@
+"""The attention scores Q @ K^T of each head, read from the views of a packed QKV tensor without
+making them contiguous: Q and K are declared with the strides of the views. tl.jit compiles the
+program for the strides of the tensors, so the vectorization of the copies is checked against
+them at compile time, see T.copy.
+
+    python strided_qk_example.py
+"""
+
+import torch
+from tvm import tl
+import tvm.tl.language as T
+
+
+@tl.jit(out_idx=[2])
+def qk_scores(q, k, block_M=64, block_N=64):
+    batch, seq_len, heads, dim = q.shape
+    dtype = tl.map_tvm_type(q.dtype)
+    accum_dtype = "float"
+    shape = [batch, seq_len, heads, dim]
+    q_strides, k_strides = q.stride(), k.stride()
+
+    @T.prim_func
+    def main(
+        Q: T.Buffer(shape, dtype, strides=q_strides),
+        K: T.Buffer(shape, dtype, strides=k_strides),
+        S: T.Buffer((batch, heads, seq_len, seq_len), accum_dtype),
+    ):
+        # a block per tile of the scores of a (batch, head) of blockIdx.z
+        with T.Kernel(
+            T.ceildiv(seq_len, block_N), T.ceildiv(seq_len, block_M), batch * heads, threads=128
+        ) as (bx, by, bz):
+            Q_shared = T.alloc_shared((block_M, dim), dtype)
+            K_shared = T.alloc_shared((block_N, dim), dtype)
+            S_local = T.alloc_fragment((block_M, block_N), accum_dtype)
+            b = bz // heads
+            h = bz % heads
+            T.copy(Q[b, by * block_M : (by + 1) * block_M, h, :], Q_shared)
+            T.copy(K[b, bx * block_N : (bx + 1) * block_N, h, :], K_shared)
+            T.clear(S_local)
+            T.gemm(Q_shared, K_shared, S_local, transpose_B=True)
+            T.copy(
+                S_local,
+                S[b, h, by * block_M : (by + 1) * block_M, bx * block_N : (bx + 1) * block_N],
+            )
+
+    return main
+
+
+if __name__ == "__main__":
+    BATCH, SEQ_LEN, HEADS, DIM = 8, 1024, 16, 64
+    qkv = torch.randn(BATCH, SEQ_LEN, 3, HEADS, DIM, device="cuda", dtype=torch.float16)
+    q, k = qkv[:, :, 0], qkv[:, :, 1]
+    scores = qk_scores(q, k)
+    ref = torch.einsum("bshd,bthd->bhst", q.float(), k.float())
+    torch.testing.assert_close(scores, ref, rtol=1e-2, atol=1e-2)
+
+    latency = tl.utils.do_bench(lambda: qk_scores(q, k))
+    baseline = tl.utils.do_bench(lambda: qk_scores(q.contiguous(), k.contiguous()))
+    print("strided views: {:.3f} ms".format(latency))
+    print("contiguous copies: {:.3f} ms".format(baseline))
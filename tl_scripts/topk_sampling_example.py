@@ -0,0 +1,116 @@
+import torch
+from tvm import tl
+import tvm.tl.language as T
+
+
+def logits_topk(batch, vocab, dim, k, splits, block_M, block_N, block_K):
+    """The top k logits of Hidden @ Weight^T and their token ids, without the logits in memory:
+    each block computes the logits of the vocabulary tiles of its split with T.gemm and merges
+    them into the running top k of its rows. The candidates of the splits are merged by
+    merge_topk."""
+    dtype = "float16"
+    accum_dtype = "float"
+    split_size = (vocab + splits * block_N - 1) // (splits * block_N) * block_N
+
+    @T.prim_func
+    def main(
+        Hidden: T.Buffer((batch, dim), dtype),
+        Weight: T.Buffer((vocab, dim), dtype),
+        Values: T.Buffer((splits, batch, k), accum_dtype),
+        Indices: T.Buffer((splits, batch, k), "int32"),
+    ):
+        with T.Kernel(splits, T.ceildiv(batch, block_M), threads=128) as (bx, by):
+            A_shared = T.alloc_shared((block_M, block_K), dtype)
+            B_shared = T.alloc_shared((block_N, block_K), dtype)
+            logits_local = T.alloc_fragment((block_M, block_N), accum_dtype)
+            logits = T.alloc_shared((block_M, block_N), accum_dtype)
+            top_values = T.alloc_shared((block_M, k), accum_dtype)
+            top_indices = T.alloc_shared((block_M, k), "int32")
+
+            T.fill(top_values, -T.infinity(accum_dtype))
+            T.fill(top_indices, -1)
+            for t in T.serial(split_size // block_N):
+                col = bx * split_size + t * block_N
+                T.clear(logits_local)
+                for ko in T.Pipelined(T.ceildiv(dim, block_K), num_stages=3):
+                    T.copy(Hidden[by * block_M, ko * block_K], A_shared)
+                    T.copy(Weight[col, ko * block_K], B_shared)
+                    T.gemm(A_shared, B_shared, logits_local, transpose_B=True)
+                T.copy(logits_local, logits)
+                T.topk(logits, top_values, top_indices, col, merge=True, valid=vocab - col)
+            T.copy(top_values, Values[bx, by * block_M, 0])
+            T.copy(top_indices, Indices[bx, by * block_M, 0])
+
+    return main
+
+
+def merge_topk(batch, k, splits, block_M):
+    """The top k of the candidates of the splits, the positions selected among the candidates of a
+    row are mapped back to their token ids."""
+    accum_dtype = "float"
+
+    @T.prim_func
+    def main(
+        Values: T.Buffer((splits, batch, k), accum_dtype),
+        Indices: T.Buffer((splits, batch, k), "int32"),
+        Out_values: T.Buffer((batch, k), accum_dtype),
+        Out_indices: T.Buffer((batch, k), "int32"),
+    ):
+        with T.Kernel(T.ceildiv(batch, block_M), threads=128) as bx:
+            candidates = T.alloc_shared((block_M, k), accum_dtype)
+            top_values = T.alloc_shared((block_M, k), accum_dtype)
+            top_positions = T.alloc_shared((block_M, k), "int32")
+
+            T.fill(top_values, -T.infinity(accum_dtype))
+            T.fill(top_positions, 0)
+            for s in T.serial(splits):
+                T.copy(Values[s, bx * block_M, 0], candidates)
+                T.topk(candidates, top_values, top_positions, s * k, merge=True)
+            T.copy(top_values, Out_values[bx * block_M, 0])
+            for i, j in T.Parallel(block_M, k):
+                if bx * block_M + i < batch:
+                    position = top_positions[i, j]
+                    Out_indices[bx * block_M + i, j] = Indices[
+                        position // k, bx * block_M + i, position % k
+                    ]
+
+    return main
+
+
+def ref_program(hidden, weight, k):
+    logits = hidden.float() @ weight.float().T
+    return logits.topk(k, dim=-1)
+
+
+if __name__ == "__main__":
+    BATCH, VOCAB, DIM, TOP_K, SPLITS = 16, 128256, 4096, 50, 64
+    BLOCK_M, BLOCK_N, BLOCK_K = 16, 128, 32
+    program = logits_topk(BATCH, VOCAB, DIM, TOP_K, SPLITS, BLOCK_M, BLOCK_N, BLOCK_K)
+    mod, params = tl.lower(program)
+    mod = tl.ConvertTorch(mod, params, [])
+    merge_program = merge_topk(BATCH, TOP_K, SPLITS, BLOCK_M)
+    merge_mod, merge_params = tl.lower(merge_program)
+    merge_mod = tl.ConvertTorch(merge_mod, merge_params, [])
+
+    hidden = torch.randn(BATCH, DIM, device="cuda", dtype=torch.float16)
+    weight = torch.randn(VOCAB, DIM, device="cuda", dtype=torch.float16) / DIM**0.5
+    values = torch.empty(SPLITS, BATCH, TOP_K, device="cuda", dtype=torch.float32)
+    indices = torch.empty(SPLITS, BATCH, TOP_K, device="cuda", dtype=torch.int32)
+    out_values = torch.empty(BATCH, TOP_K, device="cuda", dtype=torch.float32)
+    out_indices = torch.empty(BATCH, TOP_K, device="cuda", dtype=torch.int32)
+
+    def run():
+        mod(hidden, weight, values, indices)
+        merge_mod(values, indices, out_values, out_indices)
+
+    run()
+    ref_values, _ = ref_program(hidden, weight, TOP_K)
+    torch.testing.assert_close(out_values, ref_values, atol=1e-2, rtol=1e-2)
+    # the ids may differ among the (nearly) equal logits, their logits may not
+    logits = hidden.float() @ weight.float().T
+    torch.testing.assert_close(
+        logits.gather(1, out_indices.long()), ref_values, atol=1e-2, rtol=1e-2
+    )
+
+    latency = tl.utils.do_bench(run)
+    print("{:.3f} ms".format(latency))
@@ -0,0 +1,100 @@
+import torch
+from tvm import tl
+import tvm.tl.language as T
+
+
+def flashattn_varlen(batch, total_len, heads, dim, is_casual, block_M, block_N):
+    """The attention of a ragged batch of sequences packed along the rows of Q, K and V
+    ([total_len, heads, dim], the sequence b holding the rows [cu_seqlens[b], cu_seqlens[b + 1])).
+    The row tiles of all the sequences run in a single launch without padding."""
+    sm_scale = (1.0 / dim) ** 0.5
+    shape = [total_len, heads, dim]
+    dtype = "float16"
+    accum_dtype = "float"
+    # the bound of the number of row tiles, the blocks past the last tile exit
+    max_tiles = (total_len + block_M - 1) // block_M + batch
+
+    @T.prim_func
+    def main(
+        Q: T.Buffer(shape, dtype),
+        K: T.Buffer(shape, dtype),
+        V: T.Buffer(shape, dtype),
+        cu_seqlens: T.Buffer((batch + 1,), "int32"),
+        Output: T.Buffer(shape, dtype),
+    ):
+        with T.Kernel(max_tiles, heads, threads=128) as (bx, by):
+            Q_shared = T.alloc_shared([block_M, dim], dtype)
+            K_shared = T.alloc_shared([block_N, dim], dtype)
+            V_shared = T.alloc_shared([block_N, dim], dtype)
+            acc_s = T.alloc_fragment([block_M, block_N], accum_dtype)
+            acc_s_cast = T.alloc_fragment([block_M, block_N], dtype)
+            acc_o = T.alloc_fragment([block_M, dim], accum_dtype)
+            scores_max = T.alloc_fragment([block_M], accum_dtype)
+            logsum = T.alloc_fragment([block_M], accum_dtype)
+
+            seq, start, end = T.ragged_tile(cu_seqlens, batch, block_M, bx)
+            if seq < batch:
+                begin = cu_seqlens[seq]
+                T.copy(Q[start : start + block_M, by, :], Q_shared, bound=end)
+                T.fill(acc_o, 0)
+                T.fill(logsum, 0)
+                T.fill(scores_max, -T.infinity(accum_dtype))
+                # the key tiles up to the last row of the tile with the causal mask
+                last = T.min(start + block_M, end) if is_casual else end
+                for k in T.Pipelined(T.ceildiv(last - begin, block_N), num_stages=1):
+                    kv = begin + k * block_N
+                    T.copy(K[kv : kv + block_N, by, :], K_shared, bound=end)
+                    T.clear(acc_s)
+                    T.gemm(Q_shared, K_shared, acc_s, transpose_B=True)
+                    # the keys of the next sequence are read as zeros
+                    T.mask(acc_s, lambda i, j: j < end, start, kv)
+                    if is_casual:
+                        T.mask(acc_s, lambda i, j: i >= j, start, kv)
+                    T.copy(V[kv : kv + block_N, by, :], V_shared, bound=end)
+                    T.online_softmax(acc_s, scores_max, logsum, acc_o, sm_scale)
+                    T.copy(acc_s, acc_s_cast)
+                    T.gemm(acc_s_cast, V_shared, acc_o)
+                for i, j in T.Parallel(block_M, dim):
+                    acc_o[i, j] /= logsum[i]
+                T.copy(acc_o, Output[start : start + block_M, by, :], bound=end)
+
+    return main
+
+
+def ref_program(Q, K, V, cu_seqlens, casual):
+    offsets = cu_seqlens.tolist()
+    outputs = []
+    for b in range(len(offsets) - 1):
+        q, k, v = (x[offsets[b] : offsets[b + 1]].transpose(0, 1).float() for x in (Q, K, V))
+        scores = q @ k.transpose(1, 2) / q.shape[-1] ** 0.5
+        if casual:
+            n = q.shape[1]
+            mask = torch.ones(n, n, dtype=torch.bool, device=Q.device).tril()
+            scores = scores.masked_fill(~mask, float("-inf"))
+        outputs.append((scores.softmax(-1) @ v).transpose(0, 1))
+    return torch.cat(outputs).to(Q.dtype)
+
+
+if __name__ == "__main__":
+    BATCH, H, D_HEAD = 16, 12, 128
+    casual = True
+    BLOCK_M, BLOCK_N = 64, 64
+    seqlens = torch.randint(128, 2048, (BATCH,), device="cuda")
+    total_len = int(seqlens.sum())
+    cu_seqlens, _ = tl.make_group_offsets(seqlens, BLOCK_M)
+
+    program = flashattn_varlen(BATCH, total_len, H, D_HEAD, casual, BLOCK_M, BLOCK_N)
+    mod, params = tl.lower(program)
+    mod = tl.ConvertTorch(mod, params, [])
+
+    q, k, v = (
+        torch.randn(total_len, H, D_HEAD, device="cuda", dtype=torch.float16) for _ in range(3)
+    )
+    out = torch.empty_like(q)
+    mod(q, k, v, cu_seqlens, out)
+    torch.testing.assert_close(out, ref_program(q, k, v, cu_seqlens, casual), atol=1e-2, rtol=1e-2)
+
+    flops = sum(4.0 * H * n * n * D_HEAD for n in seqlens.tolist()) * (0.5 if casual else 1)
+    latency = tl.utils.do_bench(lambda: mod(q, k, v, cu_seqlens, out))
+    print("{:.2f} ms".format(latency))
+    print("{:.2f} TFlops".format(flops / latency * 1e-9))
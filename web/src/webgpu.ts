@@ -42,6 +42,27 @@ interface FunctionInfo {
   launch_param_tags: Array<string>;
 }
 
+interface PendingReadback {
+  buffer: GPUBuffer;
+  to: Pointer;
+  nbytes: number;
+}
+
+/**
+ * The number of dispatches recorded before the commands are submitted, so that the GPU starts
+ * on the first kernels of a long invocation while the next ones are recorded.
+ */
+const kMaxDispatchesPerSubmit = 128;
+/** The number of free staging buffers kept by each pool. */
+const kMaxPooledStagingBuffers = 16;
+
+/** The size of the staging buffers, a power of 2 so that they are reused for similar copies. */
+function stagingBufferSize(nbytes: number): number {
+  let size = 256;
+  while (size < nbytes) size *= 2;
+  return size;
+}
+
 /**
  * WebGPU context
  * Manages all the webgpu resources here.
@@ -55,6 +76,19 @@ export class WebGPUContext {
   private bufferTableFreeId: Array<number> = [];
   private pendingRead: Promise<void> = Promise.resolve();
   private numPendingReads = 0;
+  // The commands recorded since the last submit, the dispatches and the copies of a whole graph
+  // or VM invocation are submitted together instead of one submit per kernel.
+  private encoder?: GPUCommandEncoder = undefined;
+  // The compute pass of the consecutive dispatches, ended by a copy or a submit.
+  private computePass?: GPUComputePassEncoder = undefined;
+  private numRecordedDispatches = 0;
+  private flushScheduled = false;
+  // The staging buffers of the uploads and the readbacks recorded since the last submit.
+  private pendingUploads: Array<GPUBuffer> = [];
+  private pendingReadbacks: Array<PendingReadback> = [];
+  // The staging buffers whose copies are done, mapped for writing and unmapped respectively.
+  private uploadPool: Array<GPUBuffer> = [];
+  private readbackPool: Array<GPUBuffer> = [];
 
   constructor(memory: Memory, device: GPUDevice) {
     this.memory = memory;
@@ -65,6 +99,7 @@ export class WebGPUContext {
    * Wait for all pending GPU tasks to complete
    */
   async sync(): Promise<void> {
+    this.flush();
     if (this.numPendingReads != 0) {
       await Promise.all([
         this.device.queue.onSubmittedWorkDone(),
@@ -132,8 +167,7 @@ export class WebGPUContext {
     }
 
     const submitShader = (...args: Array<GPUPointer | number>): void => {
-      const commandEncoder = this.device.createCommandEncoder();
-      const compute = commandEncoder.beginComputePass();
+      const compute = this.getComputePass();
       compute.setPipeline(pipeline);
       const bindGroupEntries: Array<GPUBindGroupEntry> = [];
       assert(args.length == layoutEntries.length + dispatchToDim.length);
@@ -156,9 +190,8 @@ export class WebGPUContext {
         wl[dispatchToDim[i]] = args[layoutEntries.length + i];
       }
       compute.dispatchWorkgroups(wl[0], wl[1], wl[2])
-      compute.end()
-      const command = commandEncoder.finish();
-      this.device.queue.submit([command]);
+      this.numRecordedDispatches += 1;
+      if (this.numRecordedDispatches >= kMaxDispatchesPerSubmit) this.flush();
     };
 
     return submitShader;
@@ -227,6 +260,8 @@ export class WebGPUContext {
     this.bufferTable[idx] = undefined;
     assert(buffer !== undefined);
     this.bufferTableFreeId.push(idx);
+    // the recorded commands using the buffer are submitted before it is destroyed
+    if (this.encoder !== undefined) this.flush();
     buffer.destroy();
   }
 
@@ -236,30 +271,20 @@ export class WebGPUContext {
     toOffset: number,
     nbytes: number
   ): void {
-    // Perhaps it would be more useful to use a staging buffer?
-    const gpuTemp = this.device.createBuffer({
-      mappedAtCreation: true,
-      size: nbytes,
-      usage: GPUBufferUsage.MAP_WRITE | GPUBufferUsage.COPY_SRC
-    });
-
-    const cpuTemp = gpuTemp.getMappedRange();
-
-    const viewU8 = new Uint8Array(cpuTemp);
+    // the data is written into a mapped staging buffer of the pool and copied in the order of
+    // the recorded commands, queue.writeBuffer would run before the commands not submitted yet
+    const staging = this.acquireUploadBuffer(nbytes);
+    const viewU8 = new Uint8Array(staging.getMappedRange());
     viewU8.set(this.memory.loadRawBytes(from, nbytes));
-    gpuTemp.unmap();
-
-    const copyEncoder = this.device.createCommandEncoder();
-    copyEncoder.copyBufferToBuffer(
-      gpuTemp,
+    staging.unmap();
+    this.getCopyEncoder().copyBufferToBuffer(
+      staging,
       0,
       this.gpuBufferFromPtr(to),
       toOffset,
       nbytes
     );
-    const copyCommands = copyEncoder.finish();
-    this.device.queue.submit([copyCommands]);
-    gpuTemp.destroy();
+    this.pendingUploads.push(staging);
   }
 
   private deviceCopyFromGPU(
@@ -268,41 +293,24 @@ export class WebGPUContext {
     to: Pointer,
     nbytes: number
   ): void {
-    // Perhaps it would be more useful to resuse a staging buffer?
-    const gpuTemp = this.device.createBuffer({
-      size: nbytes,
+    // the copy is recorded with the other commands, the staging buffer is mapped once they are
+    // submitted, so that the readbacks of all the outputs of an invocation are in flight together
+    const size = stagingBufferSize(nbytes);
+    const index = this.readbackPool.findIndex((buffer) => buffer.size == size);
+    const staging = index >= 0 ? this.readbackPool.splice(index, 1)[0] : this.device.createBuffer({
+      size: size,
       usage: GPUBufferUsage.MAP_READ | GPUBufferUsage.COPY_DST,
     });
-
-    const copyEncoder = this.device.createCommandEncoder();
-    copyEncoder.copyBufferToBuffer(
+    this.getCopyEncoder().copyBufferToBuffer(
       this.gpuBufferFromPtr(from),
       fromOffset,
-      gpuTemp,
+      staging,
       0,
       nbytes
     );
-    const copyCommands = copyEncoder.finish();
-    this.device.queue.submit([copyCommands]);
-
+    this.pendingReadbacks.push({ buffer: staging, to: to, nbytes: nbytes });
     this.numPendingReads += 1;
-
-    const readEvent = gpuTemp.mapAsync(GPUMapMode.READ).then(() => {
-      const data = gpuTemp.getMappedRange();
-      this.memory.storeRawBytes(to, new Uint8Array(data));
-      this.numPendingReads -= 1;
-      gpuTemp.destroy();
-    });
-
-    if (this.numPendingReads == 1) {
-      this.pendingRead = readEvent;
-    } else {
-      this.pendingRead = Promise.all([
-        this.pendingRead,
-        readEvent,
-        // eslint-disable-next-line @typescript-eslint/no-empty-function
-      ]).then(() => {});
-    }
+    this.scheduleFlush();
   }
 
   private deviceCopyWithinGPU(
@@ -312,16 +320,108 @@ export class WebGPUContext {
     toOffset: number,
     nbytes: number
   ): void {
-    const copyEncoder = this.device.createCommandEncoder();
-    copyEncoder.copyBufferToBuffer(
+    this.getCopyEncoder().copyBufferToBuffer(
       this.gpuBufferFromPtr(from),
       fromOffset,
       this.gpuBufferFromPtr(to),
       toOffset,
       nbytes
     );
-    const copyCommands = copyEncoder.finish();
-    this.device.queue.submit([copyCommands]);
+  }
+
+  /**
+   * Submit the recorded commands, then map the staging buffers of their readbacks and recycle
+   * the ones of their uploads once the copies are done.
+   */
+  private flush(): void {
+    if (this.encoder === undefined) return;
+    if (this.computePass !== undefined) {
+      this.computePass.end();
+      this.computePass = undefined;
+    }
+    this.device.queue.submit([this.encoder.finish()]);
+    this.encoder = undefined;
+    this.numRecordedDispatches = 0;
+
+    for (const staging of this.pendingUploads) {
+      staging.mapAsync(GPUMapMode.WRITE).then(() => {
+        if (this.uploadPool.length < kMaxPooledStagingBuffers) {
+          this.uploadPool.push(staging);
+        } else {
+          staging.destroy();
+        }
+      });
+    }
+    this.pendingUploads = [];
+
+    for (const readback of this.pendingReadbacks) {
+      const readEvent = readback.buffer.mapAsync(GPUMapMode.READ).then(() => {
+        const data = readback.buffer.getMappedRange();
+        this.memory.storeRawBytes(readback.to, new Uint8Array(data, 0, readback.nbytes));
+        this.numPendingReads -= 1;
+        readback.buffer.unmap();
+        if (this.readbackPool.length < kMaxPooledStagingBuffers) {
+          this.readbackPool.push(readback.buffer);
+        } else {
+          readback.buffer.destroy();
+        }
+      });
+      this.pendingRead = Promise.all([
+        this.pendingRead,
+        readEvent,
+        // eslint-disable-next-line @typescript-eslint/no-empty-function
+      ]).then(() => {});
+    }
+    this.pendingReadbacks = [];
+  }
+
+  /**
+   * Submit the recorded commands at the end of the current task, after the synchronous calls of
+   * the invocation recording them.
+   */
+  private scheduleFlush(): void {
+    if (this.flushScheduled) return;
+    this.flushScheduled = true;
+    Promise.resolve().then(() => {
+      this.flushScheduled = false;
+      this.flush();
+    });
+  }
+
+  private getEncoder(): GPUCommandEncoder {
+    if (this.encoder === undefined) {
+      this.encoder = this.device.createCommandEncoder();
+      this.scheduleFlush();
+    }
+    return this.encoder;
+  }
+
+  private getComputePass(): GPUComputePassEncoder {
+    if (this.computePass === undefined) {
+      this.computePass = this.getEncoder().beginComputePass();
+    }
+    return this.computePass;
+  }
+
+  /** The encoder of a copy, which is recorded outside of the compute pass. */
+  private getCopyEncoder(): GPUCommandEncoder {
+    const encoder = this.getEncoder();
+    if (this.computePass !== undefined) {
+      this.computePass.end();
+      this.computePass = undefined;
+    }
+    return encoder;
+  }
+
+  private acquireUploadBuffer(nbytes: number): GPUBuffer {
+    const size = stagingBufferSize(nbytes);
+    const index = this.uploadPool.findIndex((buffer) => buffer.size == size);
+    if (index >= 0) return this.uploadPool.splice(index, 1)[0];
+    return this.device.createBuffer({
+      mappedAtCreation: true,
+      size: size,
+      usage: GPUBufferUsage.MAP_WRITE | GPUBufferUsage.COPY_SRC
+    });
   }
 
   private gpuBufferFromPtr(ptr: GPUPointer): GPUBuffer {
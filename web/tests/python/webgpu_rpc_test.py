@@ -76,7 +76,24 @@ def test_rpc():
         np.testing.assert_allclose(b.numpy(), np.log(np.abs(a.numpy()) + 1), atol=1e-5, rtol=1e-5)
         print("Test pass..")
 
+    def check_batched(remote):
+        # The dispatches and the copies are recorded into one command encoder, more dispatches
+        # than a submit holds. Each upload must land between the dispatches recorded around it.
+        dev = remote.webgpu(0)
+        addone = remote.system_lib().get_function("addone")
+        inputs = [np.random.uniform(-1, 1, size=n).astype(A.dtype) for _ in range(4)]
+        a = tvm.nd.empty((n,), A.dtype, dev)
+        outputs = [tvm.nd.empty((n,), A.dtype, dev) for _ in inputs]
+        for data, b in zip(inputs, outputs):
+            a.copyfrom(data)
+            for _ in range(100):
+                addone(a, b)
+        for data, b in zip(inputs, outputs):
+            np.testing.assert_allclose(b.numpy(), np.log(np.abs(data) + 1), atol=1e-5, rtol=1e-5)
+        print("Test batched pass..")
+
     check(remote)
+    check_batched(remote)
 
 
 test_rpc()